@@ -37,6 +37,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cmath>
 
 #include <limits>
+#include <vector>
 
 namespace
 {
@@ -44,6 +45,35 @@ constexpr static const float RAD = 0.017453292519943295769236907684886f;
 // earth radius varies between 6,356.750-6,378.135 km (3,949.901-3,963.189mi)
 // The IUGG value for the equatorial radius is 6378.137 km (3963.19 miles)
 constexpr static const float earth_radius = 6372797.560856f;
+
+// haversine of the central angle between two points, from the differences of their latitudes
+// and longitudes and the cosines of their latitudes
+inline double great_circle_distance_from_radians(const double delta_lat,
+                                                 const double delta_lon,
+                                                 const double cos_lat1,
+                                                 const double cos_lat2)
+{
+    const double sin_half_delta_lat = std::sin(delta_lat / 2.0);
+    const double sin_half_delta_lon = std::sin(delta_lon / 2.);
+    const double aHarv = sin_half_delta_lat * sin_half_delta_lat +
+                         cos_lat1 * cos_lat2 * sin_half_delta_lon * sin_half_delta_lon;
+    const double cHarv = 2. * std::atan2(std::sqrt(aHarv), std::sqrt(1.0 - aHarv));
+    return earth_radius * cHarv;
+}
+
+// bearing in degrees from 0 to 360 with the same rounding as coordinate_calculation::bearing
+inline float normalize_bearing(float result)
+{
+    while (result < 0.f)
+    {
+        result += 360.f;
+    }
+    while (result >= 360.f)
+    {
+        result -= 360.f;
+    }
+    return result;
+}
 }
 
 namespace coordinate_calculation
@@ -71,10 +101,7 @@ double great_circle_distance(const int lat1,
     const double dLong = dlong1 - dlong2;
     const double dLat = dlat1 - dlat2;
 
-    const double aHarv = std::pow(std::sin(dLat / 2.0), 2.0) +
-                         std::cos(dlat1) * std::cos(dlat2) * std::pow(std::sin(dLong / 2.), 2);
-    const double cHarv = 2. * std::atan2(std::sqrt(aHarv), std::sqrt(1.0 - aHarv));
-    return earth_radius * cHarv;
+    return great_circle_distance_from_radians(dLat, dLong, std::cos(dlat1), std::cos(dlat2));
 }
 
 double great_circle_distance(const FixedPointCoordinate &coordinate_1,
@@ -156,15 +183,50 @@ float perpendicular_distance_from_projected_coordinate(
     const std::pair<double, double> &projected_coordinate,
     FixedPointCoordinate &nearest_location,
     float &ratio)
+{
+    return perpendicular_distance_from_projected_coordinates(
+        segment_source, segment_target,
+        {projected_latitude(segment_source), projected_latitude(segment_target)}, query_location,
+        projected_coordinate, nearest_location, ratio);
+}
+
+double projected_latitude(const FixedPointCoordinate &coordinate)
+{
+    return mercator::lat2y(coordinate.lat / COORDINATE_PRECISION);
+}
+
+float perpendicular_distance_from_projected_coordinates(
+    const FixedPointCoordinate &segment_source,
+    const FixedPointCoordinate &segment_target,
+    const std::pair<double, double> &projected_segment_latitudes,
+    const FixedPointCoordinate &query_location,
+    const std::pair<double, double> &projected_coordinate)
+{
+    float ratio;
+    FixedPointCoordinate nearest_location;
+
+    return perpendicular_distance_from_projected_coordinates(
+        segment_source, segment_target, projected_segment_latitudes, query_location,
+        projected_coordinate, nearest_location, ratio);
+}
+
+float perpendicular_distance_from_projected_coordinates(
+    const FixedPointCoordinate &segment_source,
+    const FixedPointCoordinate &segment_target,
+    const std::pair<double, double> &projected_segment_latitudes,
+    const FixedPointCoordinate &query_location,
+    const std::pair<double, double> &projected_coordinate,
+    FixedPointCoordinate &nearest_location,
+    float &ratio)
 {
     BOOST_ASSERT(query_location.is_valid());
 
     // initialize values
     const double x = projected_coordinate.first;
     const double y = projected_coordinate.second;
-    const double a = mercator::lat2y(segment_source.lat / COORDINATE_PRECISION);
+    const double a = projected_segment_latitudes.first;
     const double b = segment_source.lon / COORDINATE_PRECISION;
-    const double c = mercator::lat2y(segment_target.lat / COORDINATE_PRECISION);
+    const double c = projected_segment_latitudes.second;
     const double d = segment_target.lon / COORDINATE_PRECISION;
     double p, q /*,mX*/, nY;
     if (std::abs(a - c) > std::numeric_limits<double>::epsilon())
@@ -231,9 +293,8 @@ float perpendicular_distance_from_projected_coordinate(
 
 void lat_or_lon_to_string(const int value, std::string &output)
 {
-    char buffer[12];
-    buffer[11] = 0; // zero termination
-    output = printInt<11, 6>(buffer, value);
+    char buffer[COORDINATE_STRING_LENGTH + 1];
+    output = printCoordinate(buffer, value);
 }
 
 float deg_to_rad(const float degree)
@@ -257,17 +318,93 @@ float bearing(const FixedPointCoordinate &first_coordinate,
     const float y = std::sin(lon_delta) * std::cos(lat2);
     const float x =
         std::cos(lat1) * std::sin(lat2) - std::sin(lat1) * std::cos(lat2) * std::cos(lon_delta);
-    float result = rad_to_deg(std::atan2(y, x));
-    while (result < 0.f)
+    return normalize_bearing(rad_to_deg(std::atan2(y, x)));
+}
+
+void great_circle_distances(const FixedPointCoordinate *coordinates,
+                            const std::size_t count,
+                            double *distances)
+{
+    if (count < 2)
     {
-        result += 360.f;
+        return;
+    }
+    std::vector<double> lats(count), lons(count), cos_lats(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        lats[i] = static_cast<double>(coordinates[i].lat / COORDINATE_PRECISION) * RAD;
+        lons[i] = static_cast<double>(coordinates[i].lon / COORDINATE_PRECISION) * RAD;
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        cos_lats[i] = std::cos(lats[i]);
     }
+    for (std::size_t i = 0; i + 1 < count; ++i)
+    {
+        distances[i] = great_circle_distance_from_radians(
+            lats[i] - lats[i + 1], lons[i] - lons[i + 1], cos_lats[i], cos_lats[i + 1]);
+    }
+}
 
-    while (result >= 360.f)
+void euclidean_distances(const FixedPointCoordinate *coordinates,
+                         const std::size_t count,
+                         float *distances)
+{
+    if (count < 2)
     {
-        result -= 360.f;
+        return;
+    }
+    std::vector<float> lats(count), lons(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        lats[i] = (coordinates[i].lat / COORDINATE_PRECISION) * RAD;
+        lons[i] = (coordinates[i].lon / COORDINATE_PRECISION) * RAD;
+    }
+    for (std::size_t i = 0; i + 1 < count; ++i)
+    {
+        const float x_value = (lons[i + 1] - lons[i]) * std::cos((lats[i] + lats[i + 1]) / 2.f);
+        const float y_value = lats[i + 1] - lats[i];
+        distances[i] = std::hypot(x_value, y_value) * earth_radius;
+    }
+}
+
+void great_circle_distances(const FixedPointCoordinate &origin,
+                            const FixedPointCoordinate *targets,
+                            const std::size_t count,
+                            double *distances)
+{
+    const double origin_lat = static_cast<double>(origin.lat / COORDINATE_PRECISION) * RAD;
+    const double origin_lon = static_cast<double>(origin.lon / COORDINATE_PRECISION) * RAD;
+    const double cos_origin_lat = std::cos(origin_lat);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const double lat = static_cast<double>(targets[i].lat / COORDINATE_PRECISION) * RAD;
+        const double lon = static_cast<double>(targets[i].lon / COORDINATE_PRECISION) * RAD;
+        distances[i] = great_circle_distance_from_radians(origin_lat - lat, origin_lon - lon,
+                                                          cos_origin_lat, std::cos(lat));
+    }
+}
+
+void bearings(const FixedPointCoordinate &origin,
+              const FixedPointCoordinate *targets,
+              const std::size_t count,
+              float *bearings)
+{
+    const float origin_lat = deg_to_rad(origin.lat / COORDINATE_PRECISION);
+    const float sin_origin_lat = std::sin(origin_lat);
+    const float cos_origin_lat = std::cos(origin_lat);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const float lon_diff =
+            targets[i].lon / COORDINATE_PRECISION - origin.lon / COORDINATE_PRECISION;
+        const float lon_delta = deg_to_rad(lon_diff);
+        const float lat = deg_to_rad(targets[i].lat / COORDINATE_PRECISION);
+        const float cos_lat = std::cos(lat);
+        const float y = std::sin(lon_delta) * cos_lat;
+        const float x =
+            cos_origin_lat * std::sin(lat) - sin_origin_lat * cos_lat * std::cos(lon_delta);
+        bearings[i] = normalize_bearing(rad_to_deg(std::atan2(y, x)));
     }
-    return result;
 }
 
 }
@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 struct FixedPointCoordinate;
 
+#include <cstddef>
 #include <string>
 #include <utility>
 
@@ -72,11 +73,52 @@ namespace coordinate_calculation
         FixedPointCoordinate &nearest_location,
         float &ratio);
 
+    // mercator y of the latitude of a coordinate, as precomputed for the nodes of a dataset
+    double projected_latitude(const FixedPointCoordinate &coordinate);
+
+    // as above, but with the projected latitudes of the segment source and target
+    float perpendicular_distance_from_projected_coordinates(
+        const FixedPointCoordinate &segment_source,
+        const FixedPointCoordinate &segment_target,
+        const std::pair<double, double> &projected_segment_latitudes,
+        const FixedPointCoordinate &query_location,
+        const std::pair<double, double> &projected_coordinate);
+
+    float perpendicular_distance_from_projected_coordinates(
+        const FixedPointCoordinate &segment_source,
+        const FixedPointCoordinate &segment_target,
+        const std::pair<double, double> &projected_segment_latitudes,
+        const FixedPointCoordinate &query_location,
+        const std::pair<double, double> &projected_coordinate,
+        FixedPointCoordinate &nearest_location,
+        float &ratio);
+
     float deg_to_rad(const float degree);
     float rad_to_deg(const float radian);
 
     float bearing(const FixedPointCoordinate &first_coordinate,
                   const FixedPointCoordinate &second_coordinate);
+
+    // Batch versions of the functions above, with the same results. They convert every
+    // coordinate once and share the trigonometry of a coordinate between all its pairs.
+
+    // distance between every coordinate and the next one, writes count - 1 values
+    void great_circle_distances(const FixedPointCoordinate *coordinates,
+                                const std::size_t count,
+                                double *distances);
+    void euclidean_distances(const FixedPointCoordinate *coordinates,
+                             const std::size_t count,
+                             float *distances);
+
+    // distance and bearing from the origin to each of count targets
+    void great_circle_distances(const FixedPointCoordinate &origin,
+                                const FixedPointCoordinate *targets,
+                                const std::size_t count,
+                                double *distances);
+    void bearings(const FixedPointCoordinate &origin,
+                  const FixedPointCoordinate *targets,
+                  const std::size_t count,
+                  float *bearings);
 }
 
 #endif // COORDINATE_CALCULATION
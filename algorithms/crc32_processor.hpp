@@ -32,39 +32,182 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cpuid.h>
 #endif
 
-#include <boost/crc.hpp> // for boost::crc_32_type
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
+#include <cstdint>
+#include <cstring>
+
+#include <array>
 #include <iterator>
+#include <type_traits>
+#include <vector>
 
+// CRC32C without initial and final inversion, as computed by the crc32 instruction of SSE4.2.
+// Without it a table is used. Contiguous data is split into chunks that are checksummed in
+// parallel, their checksums are combined into the one of the whole range. The checksum is the
+// same whether it is computed at once, in chunks, by hardware or by the table.
 class IteratorbasedCRC32
 {
   public:
     bool using_hardware() const { return use_hardware_implementation; }
 
-    IteratorbasedCRC32() : crc(0) { use_hardware_implementation = detect_hardware_support(); }
+    IteratorbasedCRC32() : use_hardware_implementation(detect_hardware_support()) {}
+
+    template <class Iterator> unsigned operator()(Iterator iter, const Iterator end) const
+    {
+        return compute(iter, end, std::is_pointer<Iterator>());
+    }
+
+    // checksum of the length bytes at data
+    unsigned checksum(const void *data, const std::size_t length) const
+    {
+        const char *bytes = static_cast<const char *>(data);
+        if (length < 2 * CHUNK_BYTES)
+        {
+            return update(0, bytes, length);
+        }
+
+        const std::size_t number_of_chunks = (length + CHUNK_BYTES - 1) / CHUNK_BYTES;
+        std::vector<std::uint32_t> chunk_checksums(number_of_chunks);
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, number_of_chunks),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+                              for (auto chunk = range.begin(); chunk != range.end(); ++chunk)
+                              {
+                                  const std::size_t begin = chunk * CHUNK_BYTES;
+                                  const std::size_t chunk_length =
+                                      length - begin < CHUNK_BYTES ? length - begin : CHUNK_BYTES;
+                                  chunk_checksums[chunk] = update(0, bytes + begin, chunk_length);
+                              }
+                          });
+
+        const std::size_t last_chunk_length = length - (number_of_chunks - 1) * CHUNK_BYTES;
+        std::uint32_t crc = chunk_checksums.front();
+        for (std::size_t chunk = 1; chunk + 1 < number_of_chunks; ++chunk)
+        {
+            crc = multiply(crc, tables().chunk_shift) ^ chunk_checksums[chunk];
+        }
+        return multiply(crc, shift_for(last_chunk_length)) ^ chunk_checksums.back();
+    }
+
+    // checksum of the concatenation of two byte ranges from their checksums, lets files be
+    // checksummed buffer by buffer
+    static unsigned combine(const unsigned first_checksum,
+                            const unsigned second_checksum,
+                            const std::size_t second_length)
+    {
+        return multiply(first_checksum, shift_for(second_length)) ^ second_checksum;
+    }
+
+  private:
+    // reflected Castagnoli polynomial 0x1EDC6F41
+    static constexpr std::uint32_t POLYNOMIAL = 0x82F63B78;
+    static constexpr std::size_t CHUNK_BYTES = 1 << 20;
+    // the hardware path interleaves three independent streams of this many bytes
+    static constexpr std::size_t LANE_BYTES = 1 << 12;
 
-    template <class Iterator> unsigned operator()(Iterator iter, const Iterator end)
+    struct Tables
     {
-        unsigned crc = 0;
-        while (iter != end)
+        Tables()
         {
-            using value_type = typename std::iterator_traits<Iterator>::value_type;
-            const char *data = reinterpret_cast<const char *>(&(*iter));
+            for (std::uint32_t byte = 0; byte < 256; ++byte)
+            {
+                std::uint32_t crc = byte;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc & 1) ? (crc >> 1) ^ POLYNOMIAL : crc >> 1;
+                }
+                bytes[byte] = crc;
+            }
+            // x^1, then x^2, x^4, ... by squaring
+            powers[0] = std::uint32_t(1) << 30;
+            for (std::size_t i = 1; i < powers.size(); ++i)
+            {
+                powers[i] = multiply(powers[i - 1], powers[i - 1]);
+            }
+            lane_shift = power_of_x(8 * static_cast<std::uint64_t>(LANE_BYTES), powers);
+            chunk_shift = power_of_x(8 * static_cast<std::uint64_t>(CHUNK_BYTES), powers);
+        }
+
+        std::array<std::uint32_t, 256> bytes;
+        // x^(2^i) modulo the polynomial
+        std::array<std::uint32_t, 64> powers;
+        std::uint32_t lane_shift;
+        std::uint32_t chunk_shift;
+    };
 
-            if (use_hardware_implementation)
+    static const Tables &tables()
+    {
+        static const Tables instance;
+        return instance;
+    }
+
+    // product of two polynomials modulo the polynomial, in reflected bit order
+    static std::uint32_t multiply(std::uint32_t a, std::uint32_t b)
+    {
+        std::uint32_t product = 0;
+        for (std::uint32_t bit = std::uint32_t(1) << 31; bit != 0 && a != 0; bit >>= 1)
+        {
+            if (a & bit)
             {
-                crc = compute_in_hardware(data, sizeof(value_type));
+                product ^= b;
+                a ^= bit;
             }
-            else
+            b = (b & 1) ? (b >> 1) ^ POLYNOMIAL : b >> 1;
+        }
+        return product;
+    }
+
+    static std::uint32_t power_of_x(std::uint64_t exponent,
+                                    const std::array<std::uint32_t, 64> &powers)
+    {
+        std::uint32_t result = std::uint32_t(1) << 31;
+        for (std::size_t i = 0; exponent != 0; ++i, exponent >>= 1)
+        {
+            if (exponent & 1)
             {
-                crc = compute_in_software(data, sizeof(value_type));
+                result = multiply(result, powers[i]);
             }
-            ++iter;
+        }
+        return result;
+    }
+
+    // Appending length zero bytes multiplies a checksum by this, thus the checksum of a
+    // concatenation AB is multiply(crc(A), shift_for(|B|)) ^ crc(B).
+    static std::uint32_t shift_for(const std::size_t length)
+    {
+        return power_of_x(8 * static_cast<std::uint64_t>(length), tables().powers);
+    }
+
+    template <class Iterator>
+    unsigned compute(Iterator iter, const Iterator end, std::false_type) const
+    {
+        using value_type = typename std::iterator_traits<Iterator>::value_type;
+        std::uint32_t crc = 0;
+        for (; iter != end; ++iter)
+        {
+            crc = update(crc, reinterpret_cast<const char *>(&(*iter)), sizeof(value_type));
         }
         return crc;
     }
 
-  private:
+    template <class Iterator>
+    unsigned compute(const Iterator begin, const Iterator end, std::true_type) const
+    {
+        using value_type = typename std::iterator_traits<Iterator>::value_type;
+        return checksum(begin, static_cast<std::size_t>(end - begin) * sizeof(value_type));
+    }
+
+    std::uint32_t update(const std::uint32_t crc, const char *data, const std::size_t length) const
+    {
+        if (use_hardware_implementation)
+        {
+            return update_in_hardware(crc, data, length);
+        }
+        return update_in_software(crc, data, length);
+    }
+
     bool detect_hardware_support() const
     {
         static const int sse42_bit = 0x00100000;
@@ -73,40 +216,63 @@ class IteratorbasedCRC32
         return sse42_found;
     }
 
-    unsigned compute_in_software(const char *str, unsigned len)
+    static std::uint32_t update_in_software(std::uint32_t crc, const char *data, std::size_t length)
     {
-        crc_processor.process_bytes(str, len);
-        return crc_processor.checksum();
+        const auto &bytes = tables().bytes;
+        while (length--)
+        {
+            crc = (crc >> 8) ^ bytes[(crc ^ static_cast<unsigned char>(*data++)) & 0xff];
+        }
+        return crc;
     }
 
-    // adapted from http://byteworm.com/2010/10/13/crc32/
-    unsigned compute_in_hardware(const char *str, unsigned len)
+    static std::uint32_t update_in_hardware(std::uint32_t crc, const char *data, std::size_t length)
     {
-#if defined(__x86_64__)
-        unsigned q = len / sizeof(unsigned);
-        unsigned r = len % sizeof(unsigned);
-        unsigned *p = (unsigned *)str;
-
-        // crc=0;
-        while (q--)
+#if defined(__x86_64__) && !defined(_MSC_VER)
+        // the latency of the instruction is three times its throughput
+        while (length >= 3 * LANE_BYTES)
         {
-            __asm__ __volatile__(".byte 0xf2, 0xf, 0x38, 0xf1, 0xf1;"
-                                 : "=S"(crc)
-                                 : "0"(crc), "c"(*p));
-            ++p;
+            std::uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+            for (std::size_t offset = 0; offset < LANE_BYTES; offset += 8)
+            {
+                crc0 = crc32_word(crc0, data + offset);
+                crc1 = crc32_word(crc1, data + LANE_BYTES + offset);
+                crc2 = crc32_word(crc2, data + 2 * LANE_BYTES + offset);
+            }
+            const std::uint32_t lane_shift = tables().lane_shift;
+            crc = multiply(multiply(static_cast<std::uint32_t>(crc0), lane_shift) ^
+                               static_cast<std::uint32_t>(crc1),
+                           lane_shift) ^
+                  static_cast<std::uint32_t>(crc2);
+            data += 3 * LANE_BYTES;
+            length -= 3 * LANE_BYTES;
         }
 
-        str = reinterpret_cast<char *>(p);
-        while (r--)
+        std::uint64_t crc64 = crc;
+        for (; length >= 8; length -= 8, data += 8)
+        {
+            crc64 = crc32_word(crc64, data);
+        }
+        crc = static_cast<std::uint32_t>(crc64);
+        for (; length > 0; --length, ++data)
         {
-            __asm__ __volatile__(".byte 0xf2, 0xf, 0x38, 0xf1, 0xf1;"
-                                 : "=S"(crc)
-                                 : "0"(crc), "c"(*str));
-            ++str;
+            __asm__("crc32b %1, %0" : "+r"(crc) : "rm"(*data));
         }
+        return crc;
+#else
+        return update_in_software(crc, data, length);
 #endif
+    }
+
+#if defined(__x86_64__) && !defined(_MSC_VER)
+    static std::uint64_t crc32_word(std::uint64_t crc, const char *data)
+    {
+        std::uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        __asm__("crc32q %1, %0" : "+r"(crc) : "rm"(word));
         return crc;
     }
+#endif
 
     inline unsigned cpuid() const
     {
@@ -124,8 +290,6 @@ class IteratorbasedCRC32
     }
 #endif
 
-    boost::crc_optimal<32, 0x1EDC6F41, 0x0, 0x0, true, true> crc_processor;
-    unsigned crc;
     bool use_hardware_implementation;
 };
 
@@ -136,6 +300,12 @@ struct RangebasedCRC32
         return crc32(std::begin(iterable), std::end(iterable));
     }
 
+    // vectors are contiguous and checksummed in parallel chunks
+    template <typename T> unsigned operator()(const std::vector<T> &vector)
+    {
+        return crc32.checksum(vector.data(), vector.size() * sizeof(T));
+    }
+
     bool using_hardware() const { return crc32.using_hardware(); }
 
   private:
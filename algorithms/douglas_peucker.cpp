@@ -35,6 +35,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <cmath>
 #include <algorithm>
 #include <iterator>
+#include <limits>
+#include <tuple>
 
 namespace
 {
@@ -52,7 +54,7 @@ struct CoordinatePairCalculator
         second_lon = (coordinate_b.lon / COORDINATE_PRECISION) * RAD;
     }
 
-    int operator()(FixedPointCoordinate &other) const
+    int operator()(const FixedPointCoordinate &other) const
     {
         // set third coordinate c
         const float RAD = 0.017453292519943295769236907684886f;
@@ -162,3 +164,72 @@ void DouglasPeucker::Run(RandomAccessIt begin, RandomAccessIt end, const unsigne
         }
     }
 }
+
+void DouglasPeucker::ComputeZoomLevels(const std::vector<FixedPointCoordinate> &geometry,
+                                       std::vector<std::uint8_t> &zoom_levels)
+{
+    const std::uint8_t never_kept = static_cast<std::uint8_t>(DOUGLAS_PEUCKER_THRESHOLDS.size());
+    zoom_levels.assign(geometry.size(), never_kept);
+    if (geometry.empty())
+    {
+        return;
+    }
+    zoom_levels.front() = 0;
+    zoom_levels.back() = 0;
+
+    // Run() splits every range at its farthest point, as long as that distance exceeds the
+    // threshold. The split point does not depend on the threshold, so a point is kept iff all
+    // split distances on its way down the recursion exceed the threshold. Each range carries the
+    // smallest split distance above it.
+    using Range = std::tuple<std::size_t, std::size_t, int>;
+    std::stack<Range> range_stack;
+    if (geometry.size() > 2)
+    {
+        range_stack.emplace(0, geometry.size() - 1, std::numeric_limits<int>::max());
+    }
+    while (!range_stack.empty())
+    {
+        const Range range = range_stack.top();
+        range_stack.pop();
+        const std::size_t left_border = std::get<0>(range);
+        const std::size_t right_border = std::get<1>(range);
+
+        int max_int_distance = 0;
+        std::size_t farthest_index = right_border;
+        const CoordinatePairCalculator dist_calc(geometry[left_border], geometry[right_border]);
+        for (std::size_t i = left_border + 1; i < right_border; ++i)
+        {
+            const int distance = dist_calc(geometry[i]);
+            if (distance > max_int_distance)
+            {
+                farthest_index = i;
+                max_int_distance = distance;
+            }
+        }
+
+        const int importance = std::min(max_int_distance, std::get<2>(range));
+        // thresholds decrease with the zoom level, find the first one that is exceeded
+        const auto level_iter = std::find_if(DOUGLAS_PEUCKER_THRESHOLDS.begin(),
+                                             DOUGLAS_PEUCKER_THRESHOLDS.end(),
+                                             [importance](const int threshold)
+                                             {
+                                                 return importance > threshold;
+                                             });
+        if (DOUGLAS_PEUCKER_THRESHOLDS.end() == level_iter)
+        {
+            // nothing in between is kept at any zoom level
+            continue;
+        }
+        zoom_levels[farthest_index] = static_cast<std::uint8_t>(
+            std::distance(DOUGLAS_PEUCKER_THRESHOLDS.begin(), level_iter));
+
+        if (1 < farthest_index - left_border)
+        {
+            range_stack.emplace(left_border, farthest_index, importance);
+        }
+        if (1 < right_border - farthest_index)
+        {
+            range_stack.emplace(farthest_index, right_border, importance);
+        }
+    }
+}
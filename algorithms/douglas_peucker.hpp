@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/segment_information.hpp"
 
 #include <array>
+#include <cstdint>
 #include <stack>
 #include <utility>
 #include <vector>
@@ -76,6 +77,12 @@ class DouglasPeucker
   public:
     void Run(RandomAccessIt begin, RandomAccessIt end, const unsigned zoom_level);
     void Run(std::vector<SegmentInformation> &input_geometry, const unsigned zoom_level);
+
+    // Computes for every point the lowest zoom level at which Run() keeps it, given that only
+    // the end points are pre-selected. The end points get zoom level 0, points that are not
+    // kept at any zoom level get DOUGLAS_PEUCKER_THRESHOLDS.size().
+    static void ComputeZoomLevels(const std::vector<FixedPointCoordinate> &geometry,
+                                  std::vector<std::uint8_t> &zoom_levels);
 };
 
 #endif /* DOUGLAS_PEUCKER_HPP_ */
@@ -6,8 +6,18 @@
 #include "../data_structures/restriction_map.hpp"
 #include "../data_structures/percent.hpp"
 
+#include "../util/integer_range.hpp"
 #include "../util/simple_logger.hpp"
 
+#include <boost/assert.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
 GraphCompressor::GraphCompressor(SpeedProfileProperties speed_profile)
     : speed_profile(std::move(speed_profile))
 {
@@ -47,124 +57,406 @@ void GraphCompressor::Compress(const std::unordered_set<NodeID>& barrier_nodes,
             continue;
         }
 
-        //    reverse_e2   forward_e2
-        // u <---------- v -----------> w
-        //    ----------> <-----------
-        //    forward_e1   reverse_e1
-        //
-        // Will be compressed to:
-        //
-        //    reverse_e1
-        // u <---------- w
-        //    ---------->
-        //    forward_e1
-        //
-        // If the edges are compatible.
-
-        const bool reverse_edge_order = graph.GetEdgeData(graph.BeginEdges(node_v)).reversed;
-        const EdgeID forward_e2 = graph.BeginEdges(node_v) + reverse_edge_order;
-        BOOST_ASSERT(SPECIAL_EDGEID != forward_e2);
-        BOOST_ASSERT(forward_e2 >= graph.BeginEdges(node_v) &&
-                     forward_e2 < graph.EndEdges(node_v));
-        const EdgeID reverse_e2 = graph.BeginEdges(node_v) + 1 - reverse_edge_order;
-        BOOST_ASSERT(SPECIAL_EDGEID != reverse_e2);
-        BOOST_ASSERT(reverse_e2 >= graph.BeginEdges(node_v) &&
-                     reverse_e2 < graph.EndEdges(node_v));
-
-        const EdgeData &fwd_edge_data2 = graph.GetEdgeData(forward_e2);
-        const EdgeData &rev_edge_data2 = graph.GetEdgeData(reverse_e2);
-
-        const NodeID node_w = graph.GetTarget(forward_e2);
-        BOOST_ASSERT(SPECIAL_NODEID != node_w);
-        BOOST_ASSERT(node_v != node_w);
-        const NodeID node_u = graph.GetTarget(reverse_e2);
-        BOOST_ASSERT(SPECIAL_NODEID != node_u);
-        BOOST_ASSERT(node_u != node_v);
-
-        const EdgeID forward_e1 = graph.FindEdge(node_u, node_v);
-        BOOST_ASSERT(SPECIAL_EDGEID != forward_e1);
-        BOOST_ASSERT(node_v == graph.GetTarget(forward_e1));
-        const EdgeID reverse_e1 = graph.FindEdge(node_w, node_v);
-        BOOST_ASSERT(SPECIAL_EDGEID != reverse_e1);
-        BOOST_ASSERT(node_v == graph.GetTarget(reverse_e1));
-
-        const EdgeData &fwd_edge_data1 = graph.GetEdgeData(forward_e1);
-        const EdgeData &rev_edge_data1 = graph.GetEdgeData(reverse_e1);
-
-        if (graph.FindEdgeInEitherDirection(node_u, node_w) != SPECIAL_EDGEID)
-        {
-            continue;
-        }
+        const bool has_node_penalty = traffic_lights.find(node_v) != traffic_lights.end();
+        CompressNode(node_v, has_node_penalty, restriction_map, graph, geometry_compressor);
+    }
+
+    // no more geometries are added, move them into their final layout
+    geometry_compressor.Flatten();
+
+    PrintStatistics(original_number_of_nodes, original_number_of_edges, graph);
+}
 
-        // this case can happen if two ways with different names overlap
-        if (fwd_edge_data1.name_id != rev_edge_data1.name_id ||
-            fwd_edge_data2.name_id != rev_edge_data2.name_id)
+void GraphCompressor::CompressParallel(const std::unordered_set<NodeID>& barrier_nodes,
+                                       const std::unordered_set<NodeID>& traffic_lights,
+                                       RestrictionMap& restriction_map,
+                                       NodeBasedDynamicGraph& graph,
+                                       CompressedEdgeContainer& geometry_compressor)
+{
+    const unsigned original_number_of_nodes = graph.GetNumberOfNodes();
+    const unsigned original_number_of_edges = graph.GetNumberOfEdges();
+
+    std::vector<bool> is_barrier(original_number_of_nodes, false);
+    for (const NodeID node : barrier_nodes)
+    {
+        is_barrier[node] = true;
+    }
+    std::vector<bool> has_traffic_light(original_number_of_nodes, false);
+    for (const NodeID node : traffic_lights)
+    {
+        has_traffic_light[node] = true;
+    }
+
+    // compressing a node never changes the degree of any node, so the candidates are the same
+    // regardless of the order in which they are compressed
+    std::vector<std::uint8_t> is_candidate(original_number_of_nodes, 0);
+    tbb::parallel_for(tbb::blocked_range<NodeID>(0, original_number_of_nodes, 4096),
+                      [&](const tbb::blocked_range<NodeID> &range)
+                      {
+                          for (const auto node : osrm::irange(range.begin(), range.end()))
+                          {
+                              is_candidate[node] = 2 == graph.GetOutDegree(node) &&
+                                                   !is_barrier[node] &&
+                                                   !restriction_map.IsViaNode(node);
+                          }
+                      });
+
+    // interior nodes of chain i are chain_nodes[chain_offsets[i]..chain_offsets[i+1]) in order,
+    // chain_incoming_edges holds for each of them the edge from its successor to the node
+    std::vector<std::size_t> chain_offsets(1, 0);
+    std::vector<NodeID> chain_nodes;
+    std::vector<EdgeID> chain_incoming_edges;
+    std::vector<NodeID> chain_first_nodes;
+    std::vector<NodeID> chain_last_nodes;
+    std::vector<EdgeID> chain_first_edges;
+    // nodes that are compressed node by node after the chains
+    std::vector<NodeID> sequential_nodes;
+
+    std::vector<bool> is_visited(original_number_of_nodes, false);
+    std::vector<NodeID> backward_walk;
+    std::vector<NodeID> forward_walk;
+    std::vector<NodeID> chain;
+    for (const NodeID start_node : osrm::irange(0u, original_number_of_nodes))
+    {
+        if (!is_candidate[start_node] || is_visited[start_node])
         {
             continue;
         }
 
-        if (fwd_edge_data1.IsCompatibleTo(fwd_edge_data2) && rev_edge_data1.IsCompatibleTo(rev_edge_data2))
+        // loops, and nodes with both edges to the same neighbor, are not simple
+        bool is_simple = true;
+        const auto walk = [&](const NodeID first_neighbor, std::vector<NodeID> &nodes)
         {
-            BOOST_ASSERT(graph.GetEdgeData(forward_e1).name_id ==
-                         graph.GetEdgeData(reverse_e1).name_id);
-            BOOST_ASSERT(graph.GetEdgeData(forward_e2).name_id ==
-                         graph.GetEdgeData(reverse_e2).name_id);
-
-            // Get distances before graph is modified
-            const int forward_weight1 = graph.GetEdgeData(forward_e1).distance;
-            const int forward_weight2 = graph.GetEdgeData(forward_e2).distance;
+            nodes.clear();
+            NodeID previous = start_node;
+            NodeID current = first_neighbor;
+            while (is_candidate[current] && current != start_node)
+            {
+                nodes.push_back(current);
+                const EdgeID first_edge = graph.BeginEdges(current);
+                const NodeID first_target = graph.GetTarget(first_edge);
+                const NodeID second_target = graph.GetTarget(first_edge + 1);
+                if (first_target == second_target)
+                {
+                    is_simple = false;
+                    return current;
+                }
+                const NodeID next = first_target == previous ? second_target : first_target;
+                previous = current;
+                current = next;
+            }
+            if (current == start_node)
+            {
+                is_simple = false;
+            }
+            return current;
+        };
+
+        const EdgeID start_edge = graph.BeginEdges(start_node);
+        const NodeID first_node = walk(graph.GetTarget(start_edge), backward_walk);
+        NodeID last_node = first_node;
+        forward_walk.clear();
+        if (is_simple)
+        {
+            last_node = walk(graph.GetTarget(start_edge + 1), forward_walk);
+        }
 
-            BOOST_ASSERT(0 != forward_weight1);
-            BOOST_ASSERT(0 != forward_weight2);
+        chain.assign(backward_walk.rbegin(), backward_walk.rend());
+        chain.push_back(start_node);
+        chain.insert(chain.end(), forward_walk.begin(), forward_walk.end());
 
-            const int reverse_weight1 = graph.GetEdgeData(reverse_e1).distance;
-            const int reverse_weight2 = graph.GetEdgeData(reverse_e2).distance;
+        // the turn restriction fixups are only done sequentially
+        bool touches_restriction =
+            restriction_map.IsViaNode(first_node) || restriction_map.IsViaNode(last_node);
+        for (const NodeID node : chain)
+        {
+            is_visited[node] = true;
+            touches_restriction = touches_restriction || restriction_map.IsSourceNode(node);
+        }
 
-            BOOST_ASSERT(0 != reverse_weight1);
-            BOOST_ASSERT(0 != reverse_weight2);
+        if (!is_simple || first_node == last_node || touches_restriction)
+        {
+            sequential_nodes.insert(sequential_nodes.end(), chain.begin(), chain.end());
+            continue;
+        }
 
-            const bool has_node_penalty = traffic_lights.find(node_v) != traffic_lights.end();
+        chain_first_nodes.push_back(first_node);
+        chain_last_nodes.push_back(last_node);
+        chain_first_edges.push_back(graph.FindEdge(first_node, chain.front()));
+        BOOST_ASSERT(SPECIAL_EDGEID != chain_first_edges.back());
+        for (const auto i : osrm::irange<std::size_t>(0, chain.size()))
+        {
+            const NodeID successor = i + 1 < chain.size() ? chain[i + 1] : last_node;
+            chain_nodes.push_back(chain[i]);
+            chain_incoming_edges.push_back(graph.FindEdge(successor, chain[i]));
+            BOOST_ASSERT(SPECIAL_EDGEID != chain_incoming_edges.back());
+        }
+        chain_offsets.push_back(chain_nodes.size());
+    }
 
-            // add weight of e2's to e1
-            graph.GetEdgeData(forward_e1).distance += fwd_edge_data2.distance;
-            graph.GetEdgeData(reverse_e1).distance += rev_edge_data2.distance;
-            if (has_node_penalty)
+    // Chains don't share any edges, only their end points. The updates of the geometries are
+    // buffered per block of chains and applied in block order, so the geometry ids don't depend
+    // on the scheduling.
+    const constexpr std::size_t CHAINS_PER_BLOCK = 1024;
+    const std::size_t number_of_chains = chain_first_nodes.size();
+    const std::size_t number_of_blocks = (number_of_chains + CHAINS_PER_BLOCK - 1) / CHAINS_PER_BLOCK;
+    std::vector<std::vector<GeometryUpdate>> block_geometry_updates(number_of_blocks);
+    std::vector<std::vector<NodeID>> block_compressed_nodes(number_of_blocks);
+    std::vector<std::vector<NodeID>> block_deferred_nodes(number_of_blocks);
+
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, number_of_blocks, 1),
+        [&](const tbb::blocked_range<std::size_t> &range)
+        {
+            for (const auto block : osrm::irange(range.begin(), range.end()))
             {
-                graph.GetEdgeData(forward_e1).distance +=
-                    speed_profile.traffic_signal_penalty;
-                graph.GetEdgeData(reverse_e1).distance +=
-                    speed_profile.traffic_signal_penalty;
+                auto &geometry_updates = block_geometry_updates[block];
+                auto &compressed_nodes = block_compressed_nodes[block];
+                auto &deferred_nodes = block_deferred_nodes[block];
+
+                const std::size_t last_chain =
+                    std::min(number_of_chains, (block + 1) * CHAINS_PER_BLOCK);
+                for (const auto chain_id : osrm::irange(block * CHAINS_PER_BLOCK, last_chain))
+                {
+                    // The node with the largest id is the last one Compress visits in the
+                    // chain, only its compression might connect the end points, which might
+                    // already be connected by an edge or by another chain. It is left for the
+                    // sequential pass, the other nodes don't depend on the order.
+                    const auto chain_begin = chain_nodes.begin() + chain_offsets[chain_id];
+                    const auto chain_end = chain_nodes.begin() + chain_offsets[chain_id + 1];
+                    const NodeID deferred_node = *std::max_element(chain_begin, chain_end);
+                    deferred_nodes.push_back(deferred_node);
+
+                    // the edge from the nearest uncompressed node on the left into the chain
+                    NodeID left_node = chain_first_nodes[chain_id];
+                    EdgeID left_edge = chain_first_edges[chain_id];
+                    for (const auto i :
+                         osrm::irange(chain_offsets[chain_id], chain_offsets[chain_id + 1]))
+                    {
+                        const NodeID node_v = chain_nodes[i];
+                        const bool is_last_node = i + 1 == chain_offsets[chain_id + 1];
+                        const NodeID right_node =
+                            is_last_node ? chain_last_nodes[chain_id] : chain_nodes[i + 1];
+                        const EdgeID right_edge = chain_incoming_edges[i];
+
+                        CompressibleNode node;
+                        if (node_v == deferred_node ||
+                            !GetCompressibleNode(node_v, graph,
+                                                 [&](const NodeID neighbor)
+                                                 {
+                                                     BOOST_ASSERT(neighbor == left_node ||
+                                                                  neighbor == right_node);
+                                                     return neighbor == left_node ? left_edge
+                                                                                  : right_edge;
+                                                 },
+                                                 node))
+                        {
+                            left_node = node_v;
+                            const EdgeID first_edge = graph.BeginEdges(node_v);
+                            left_edge = graph.GetTarget(first_edge) == right_node ? first_edge
+                                                                                  : first_edge + 1;
+                            continue;
+                        }
+
+                        // left_edge now points to right_node
+                        const auto updates =
+                            MergeEdges(node, has_traffic_light[node_v], graph);
+                        geometry_updates.insert(geometry_updates.end(), updates.begin(),
+                                                updates.end());
+                        compressed_nodes.push_back(node_v);
+                    }
+                }
             }
+        });
 
-            // extend e1's to targets of e2's
-            graph.SetTarget(forward_e1, node_w);
-            graph.SetTarget(reverse_e1, node_u);
-
-            // remove e2's (if bidir, otherwise only one)
-            graph.DeleteEdge(node_v, forward_e2);
-            graph.DeleteEdge(node_v, reverse_e2);
-
-            // update any involved turn restrictions
-            restriction_map.FixupStartingTurnRestriction(node_u, node_v, node_w);
-            restriction_map.FixupArrivingTurnRestriction(node_u, node_v, node_w, graph);
-
-            restriction_map.FixupStartingTurnRestriction(node_w, node_v, node_u);
-            restriction_map.FixupArrivingTurnRestriction(node_w, node_v, node_u, graph);
-
-            // store compressed geometry in container
-            geometry_compressor.CompressEdge(
-                forward_e1, forward_e2, node_v, node_w,
-                forward_weight1 + (has_node_penalty ? speed_profile.traffic_signal_penalty : 0),
-                forward_weight2);
-            geometry_compressor.CompressEdge(
-                reverse_e1, reverse_e2, node_v, node_u, reverse_weight1,
-                reverse_weight2 + (has_node_penalty ? speed_profile.traffic_signal_penalty : 0));
+    unsigned parallel_compressed_nodes = 0;
+    for (const auto block : osrm::irange<std::size_t>(0, number_of_blocks))
+    {
+        // removing edges changes the edge count of the graph, not thread safe
+        for (const NodeID node_v : block_compressed_nodes[block])
+        {
+            graph.DeleteEdges(node_v);
+        }
+        parallel_compressed_nodes += block_compressed_nodes[block].size();
+
+        for (const GeometryUpdate &update : block_geometry_updates[block])
+        {
+            geometry_compressor.CompressEdge(update.surviving_edge_id, update.removed_edge_id,
+                                             update.via_node_id, update.target_node_id,
+                                             update.weight1, update.weight2);
         }
+        sequential_nodes.insert(sequential_nodes.end(), block_deferred_nodes[block].begin(),
+                                block_deferred_nodes[block].end());
     }
 
+    // same order as in Compress
+    std::sort(sequential_nodes.begin(), sequential_nodes.end());
+    for (const NodeID node_v : sequential_nodes)
+    {
+        CompressNode(node_v, has_traffic_light[node_v], restriction_map, graph,
+                     geometry_compressor);
+    }
+
+    SimpleLogger().Write() << "Compressed " << parallel_compressed_nodes << " nodes of "
+                           << number_of_chains << " chains in parallel, checked "
+                           << sequential_nodes.size() << " nodes sequentially";
+
+    // no more geometries are added, move them into their final layout
+    geometry_compressor.Flatten();
+
     PrintStatistics(original_number_of_nodes, original_number_of_edges, graph);
 }
 
+template <typename FindIncomingEdgeT>
+bool GraphCompressor::GetCompressibleNode(const NodeID node_v,
+                                          const NodeBasedDynamicGraph& graph,
+                                          FindIncomingEdgeT&& find_incoming_edge,
+                                          CompressibleNode& node) const
+{
+    //    reverse_e2   forward_e2
+    // u <---------- v -----------> w
+    //    ----------> <-----------
+    //    forward_e1   reverse_e1
+    //
+    // Will be compressed to:
+    //
+    //    reverse_e1
+    // u <---------- w
+    //    ---------->
+    //    forward_e1
+    //
+    // If the edges are compatible.
+
+    const bool reverse_edge_order = graph.GetEdgeData(graph.BeginEdges(node_v)).reversed;
+    const EdgeID forward_e2 = graph.BeginEdges(node_v) + reverse_edge_order;
+    BOOST_ASSERT(SPECIAL_EDGEID != forward_e2);
+    BOOST_ASSERT(forward_e2 >= graph.BeginEdges(node_v) &&
+                 forward_e2 < graph.EndEdges(node_v));
+    const EdgeID reverse_e2 = graph.BeginEdges(node_v) + 1 - reverse_edge_order;
+    BOOST_ASSERT(SPECIAL_EDGEID != reverse_e2);
+    BOOST_ASSERT(reverse_e2 >= graph.BeginEdges(node_v) &&
+                 reverse_e2 < graph.EndEdges(node_v));
+
+    const EdgeData &fwd_edge_data2 = graph.GetEdgeData(forward_e2);
+    const EdgeData &rev_edge_data2 = graph.GetEdgeData(reverse_e2);
+
+    const NodeID node_w = graph.GetTarget(forward_e2);
+    BOOST_ASSERT(SPECIAL_NODEID != node_w);
+    BOOST_ASSERT(node_v != node_w);
+    const NodeID node_u = graph.GetTarget(reverse_e2);
+    BOOST_ASSERT(SPECIAL_NODEID != node_u);
+    BOOST_ASSERT(node_u != node_v);
+
+    const EdgeID forward_e1 = find_incoming_edge(node_u);
+    BOOST_ASSERT(SPECIAL_EDGEID != forward_e1);
+    BOOST_ASSERT(node_v == graph.GetTarget(forward_e1));
+    const EdgeID reverse_e1 = find_incoming_edge(node_w);
+    BOOST_ASSERT(SPECIAL_EDGEID != reverse_e1);
+    BOOST_ASSERT(node_v == graph.GetTarget(reverse_e1));
+
+    const EdgeData &fwd_edge_data1 = graph.GetEdgeData(forward_e1);
+    const EdgeData &rev_edge_data1 = graph.GetEdgeData(reverse_e1);
+
+    // this case can happen if two ways with different names overlap
+    if (fwd_edge_data1.name_id != rev_edge_data1.name_id ||
+        fwd_edge_data2.name_id != rev_edge_data2.name_id)
+    {
+        return false;
+    }
+
+    if (!fwd_edge_data1.IsCompatibleTo(fwd_edge_data2) ||
+        !rev_edge_data1.IsCompatibleTo(rev_edge_data2))
+    {
+        return false;
+    }
+
+    node = {node_u, node_v, node_w, forward_e1, forward_e2, reverse_e1, reverse_e2};
+    return true;
+}
+
+std::array<GraphCompressor::GeometryUpdate, 2>
+GraphCompressor::MergeEdges(const CompressibleNode& node,
+                            const bool has_node_penalty,
+                            NodeBasedDynamicGraph& graph) const
+{
+    BOOST_ASSERT(graph.GetEdgeData(node.forward_e1).name_id ==
+                 graph.GetEdgeData(node.reverse_e1).name_id);
+    BOOST_ASSERT(graph.GetEdgeData(node.forward_e2).name_id ==
+                 graph.GetEdgeData(node.reverse_e2).name_id);
+
+    // Get distances before graph is modified
+    const int forward_weight1 = graph.GetEdgeData(node.forward_e1).distance;
+    const int forward_weight2 = graph.GetEdgeData(node.forward_e2).distance;
+
+    BOOST_ASSERT(0 != forward_weight1);
+    BOOST_ASSERT(0 != forward_weight2);
+
+    const int reverse_weight1 = graph.GetEdgeData(node.reverse_e1).distance;
+    const int reverse_weight2 = graph.GetEdgeData(node.reverse_e2).distance;
+
+    BOOST_ASSERT(0 != reverse_weight1);
+    BOOST_ASSERT(0 != reverse_weight2);
+
+    const int node_penalty = has_node_penalty ? speed_profile.traffic_signal_penalty : 0;
+
+    // add weight of e2's to e1
+    graph.GetEdgeData(node.forward_e1).distance += forward_weight2 + node_penalty;
+    graph.GetEdgeData(node.reverse_e1).distance += reverse_weight2 + node_penalty;
+
+    // extend e1's to targets of e2's
+    graph.SetTarget(node.forward_e1, node.node_w);
+    graph.SetTarget(node.reverse_e1, node.node_u);
+
+    return {{{node.forward_e1, node.forward_e2, node.node_v, node.node_w,
+              forward_weight1 + node_penalty, forward_weight2},
+             {node.reverse_e1, node.reverse_e2, node.node_v, node.node_u, reverse_weight1,
+              reverse_weight2 + node_penalty}}};
+}
+
+bool GraphCompressor::CompressNode(const NodeID node_v,
+                                   const bool has_node_penalty,
+                                   RestrictionMap& restriction_map,
+                                   NodeBasedDynamicGraph& graph,
+                                   CompressedEdgeContainer& geometry_compressor) const
+{
+    CompressibleNode node;
+    const auto find_incoming_edge = [&graph, node_v](const NodeID neighbor)
+    {
+        return graph.FindEdge(neighbor, node_v);
+    };
+    if (!GetCompressibleNode(node_v, graph, find_incoming_edge, node))
+    {
+        return false;
+    }
+
+    if (graph.FindEdgeInEitherDirection(node.node_u, node.node_w) != SPECIAL_EDGEID)
+    {
+        return false;
+    }
+
+    const auto updates = MergeEdges(node, has_node_penalty, graph);
+
+    // remove e2's (if bidir, otherwise only one)
+    graph.DeleteEdge(node_v, node.forward_e2);
+    graph.DeleteEdge(node_v, node.reverse_e2);
+
+    // update any involved turn restrictions
+    restriction_map.FixupStartingTurnRestriction(node.node_u, node_v, node.node_w);
+    restriction_map.FixupArrivingTurnRestriction(node.node_u, node_v, node.node_w, graph);
+
+    restriction_map.FixupStartingTurnRestriction(node.node_w, node_v, node.node_u);
+    restriction_map.FixupArrivingTurnRestriction(node.node_w, node_v, node.node_u, graph);
+
+    // store compressed geometry in container
+    for (const GeometryUpdate &update : updates)
+    {
+        geometry_compressor.CompressEdge(update.surviving_edge_id, update.removed_edge_id,
+                                         update.via_node_id, update.target_node_id,
+                                         update.weight1, update.weight2);
+    }
+    return true;
+}
+
 void GraphCompressor::PrintStatistics(unsigned original_number_of_nodes,
                                       unsigned original_number_of_edges,
                                       const NodeBasedDynamicGraph& graph) const
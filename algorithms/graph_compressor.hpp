@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../contractor/speed_profile.hpp"
 #include "../data_structures/node_based_graph.hpp"
 
+#include <array>
 #include <memory>
 #include <unordered_set>
 
@@ -50,7 +51,60 @@ public:
                   RestrictionMap& restriction_map,
                   NodeBasedDynamicGraph& graph,
                   CompressedEdgeContainer& geometry_compressor);
+
+    // Same result as Compress, up to the numbering of the geometries. The maximal chains of
+    // degree two nodes are compressed concurrently. Chains that touch a turn restriction, loops
+    // and the node of every chain that Compress would visit last are done sequentially.
+    void CompressParallel(const std::unordered_set<NodeID>& barrier_nodes,
+                          const std::unordered_set<NodeID>& traffic_lights,
+                          RestrictionMap& restriction_map,
+                          NodeBasedDynamicGraph& graph,
+                          CompressedEdgeContainer& geometry_compressor);
 private:
+    //    reverse_e2   forward_e2
+    // u <---------- v -----------> w
+    //    ----------> <-----------
+    //    forward_e1   reverse_e1
+    struct CompressibleNode
+    {
+        NodeID node_u;
+        NodeID node_v;
+        NodeID node_w;
+        EdgeID forward_e1;
+        EdgeID forward_e2;
+        EdgeID reverse_e1;
+        EdgeID reverse_e2;
+    };
+
+    // arguments of one CompressedEdgeContainer::CompressEdge call
+    struct GeometryUpdate
+    {
+        EdgeID surviving_edge_id;
+        EdgeID removed_edge_id;
+        NodeID via_node_id;
+        NodeID target_node_id;
+        EdgeWeight weight1;
+        EdgeWeight weight2;
+    };
+
+    // find_incoming_edge(neighbor) returns the edge from the neighbor to node_v. Returns false
+    // if the edges of node_v are not compatible, does not check for an edge between u and w.
+    template <typename FindIncomingEdgeT>
+    bool GetCompressibleNode(const NodeID node_v,
+                             const NodeBasedDynamicGraph& graph,
+                             FindIncomingEdgeT&& find_incoming_edge,
+                             CompressibleNode& node) const;
+
+    // extends the e1's to the targets of the e2's, the e2's are not removed
+    std::array<GeometryUpdate, 2> MergeEdges(const CompressibleNode& node,
+                                             const bool has_node_penalty,
+                                             NodeBasedDynamicGraph& graph) const;
+
+    bool CompressNode(const NodeID node_v,
+                      const bool has_node_penalty,
+                      RestrictionMap& restriction_map,
+                      NodeBasedDynamicGraph& graph,
+                      CompressedEdgeContainer& geometry_compressor) const;
 
    void PrintStatistics(unsigned original_number_of_nodes,
                         unsigned original_number_of_edges,
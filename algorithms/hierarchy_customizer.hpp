@@ -0,0 +1,213 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef HIERARCHY_CUSTOMIZER_HPP
+#define HIERARCHY_CUSTOMIZER_HPP
+
+#include "../typedefs.h"
+#include "../util/integer_range.hpp"
+#include "../util/osrm_exception.hpp"
+
+#include <boost/assert.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Recomputes the shortcut weights of a contraction hierarchy after the weights of its original
+// edges changed. Node order and shortcuts stay as they are, so a shortcut that a witness path
+// made unnecessary during contraction is not brought back, even if the witness got slower.
+//
+// Every edge is stored at its lower node and the two halves of a shortcut are stored at its
+// middle node, which is lower than both end points. Nodes whose shortcuts only depend on lower
+// levels are updated in parallel, one level after the other.
+template <typename GraphT> class HierarchyCustomizer
+{
+    static constexpr unsigned UNVISITED = std::numeric_limits<unsigned>::max();
+    static constexpr unsigned ON_PATH = std::numeric_limits<unsigned>::max() - 1;
+
+    struct LevelStackFrame
+    {
+        explicit LevelStackFrame(NodeID node, EdgeID edge) : node(node), edge(edge), level(0) {}
+        NodeID node;
+        EdgeID edge;
+        unsigned level;
+    };
+
+  public:
+    explicit HierarchyCustomizer(GraphT &graph) : graph(graph) {}
+
+    // Returns the number of levels that were updated one after the other
+    unsigned Run()
+    {
+        const std::vector<unsigned> node_levels = ComputeLevels();
+        const unsigned number_of_levels =
+            node_levels.empty() ? 0 : *std::max_element(node_levels.begin(), node_levels.end());
+
+        // bucket the nodes by level, level 0 has no shortcuts to update
+        std::vector<unsigned> level_begin(number_of_levels + 2, 0);
+        for (const auto level : node_levels)
+        {
+            ++level_begin[level + 1];
+        }
+        std::partial_sum(level_begin.begin(), level_begin.end(), level_begin.begin());
+        std::vector<NodeID> nodes_by_level(node_levels.size());
+        {
+            std::vector<unsigned> position(level_begin.begin(), level_begin.end() - 1);
+            for (const auto node : osrm::irange<NodeID>(0, node_levels.size()))
+            {
+                nodes_by_level[position[node_levels[node]]++] = node;
+            }
+        }
+
+        for (const auto level : osrm::irange(1u, number_of_levels + 1))
+        {
+            tbb::parallel_for(
+                tbb::blocked_range<unsigned>(level_begin[level], level_begin[level + 1]),
+                [this, &nodes_by_level](const tbb::blocked_range<unsigned> &range)
+                {
+                    for (const auto position : osrm::irange(range.begin(), range.end()))
+                    {
+                        UpdateShortcuts(nodes_by_level[position]);
+                    }
+                });
+        }
+        return number_of_levels;
+    }
+
+  private:
+    // level of a node: 0 without shortcuts, otherwise one more than the levels of their middles
+    std::vector<unsigned> ComputeLevels() const
+    {
+        std::vector<unsigned> node_levels(graph.GetNumberOfNodes(), UNVISITED);
+        std::vector<LevelStackFrame> stack;
+        for (const auto root : osrm::irange(0u, graph.GetNumberOfNodes()))
+        {
+            if (UNVISITED != node_levels[root])
+            {
+                continue;
+            }
+            node_levels[root] = ON_PATH;
+            stack.emplace_back(root, graph.BeginEdges(root));
+            while (!stack.empty())
+            {
+                LevelStackFrame &frame = stack.back();
+                if (frame.edge == graph.EndEdges(frame.node))
+                {
+                    const unsigned level = frame.level;
+                    node_levels[frame.node] = level;
+                    stack.pop_back();
+                    if (!stack.empty())
+                    {
+                        stack.back().level = std::max(stack.back().level, level + 1);
+                    }
+                    continue;
+                }
+
+                const auto &data = graph.GetEdgeData(frame.edge++);
+                if (!data.shortcut)
+                {
+                    continue;
+                }
+                const NodeID middle = data.id;
+                if (ON_PATH == node_levels[middle])
+                {
+                    throw osrm::exception("shortcuts of node " + std::to_string(middle) +
+                                          " depend on each other");
+                }
+                if (UNVISITED == node_levels[middle])
+                {
+                    node_levels[middle] = ON_PATH;
+                    stack.emplace_back(middle, graph.BeginEdges(middle));
+                }
+                else
+                {
+                    frame.level = std::max(frame.level, node_levels[middle] + 1);
+                }
+            }
+        }
+        return node_levels;
+    }
+
+    void UpdateShortcuts(const NodeID node)
+    {
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            auto &data = graph.GetEdgeData(edge);
+            if (!data.shortcut)
+            {
+                continue;
+            }
+            if (data.forward && data.backward)
+            {
+                throw osrm::exception("bidirectional shortcut, the hierarchy was not prepared "
+                                      "with --customizable");
+            }
+            const NodeID middle = data.id;
+            const NodeID target = graph.GetTarget(edge);
+            // (node, target) is node -> middle -> target, the reverse one target -> middle -> node
+            const NodeID first = data.forward ? node : target;
+            const NodeID second = data.forward ? target : node;
+            data.distance = GetSmallestWeight(middle, first, false) +
+                            GetSmallestWeight(middle, second, true);
+        }
+    }
+
+    // smallest weight of middle -> neighbour if forward is set, of neighbour -> middle otherwise
+    EdgeWeight
+    GetSmallestWeight(const NodeID middle, const NodeID neighbour, const bool forward) const
+    {
+        EdgeWeight smallest_weight = INVALID_EDGE_WEIGHT;
+        for (const auto edge : graph.GetAdjacentEdgeRange(middle))
+        {
+            const auto &data = graph.GetEdgeData(edge);
+            if (graph.GetTarget(edge) == neighbour && (forward ? data.forward : data.backward))
+            {
+                smallest_weight =
+                    std::min(smallest_weight, static_cast<EdgeWeight>(data.distance));
+            }
+        }
+        if (INVALID_EDGE_WEIGHT == smallest_weight)
+        {
+            throw osrm::exception("no edge between " + std::to_string(middle) + " and " +
+                                  std::to_string(neighbour) + " for a shortcut");
+        }
+        return smallest_weight;
+    }
+
+    GraphT &graph;
+};
+
+template <typename GraphT> constexpr unsigned HierarchyCustomizer<GraphT>::UNVISITED;
+template <typename GraphT> constexpr unsigned HierarchyCustomizer<GraphT>::ON_PATH;
+
+#endif // HIERARCHY_CUSTOMIZER_HPP
@@ -0,0 +1,106 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef HIERARCHY_NODE_ORDER_HPP
+#define HIERARCHY_NODE_ORDER_HPP
+
+#include "../data_structures/query_edge.hpp"
+#include "../typedefs.h"
+#include "../util/integer_range.hpp"
+
+#include <boost/assert.hpp>
+
+#include <tbb/parallel_sort.h>
+
+#include <cstdint>
+
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+// Computes new ids for the nodes of a contraction hierarchy that keep the nodes of a query close
+// together in memory. All upward searches end in the top levels, so the nodes are numbered from
+// the highest level down, and along a space filling curve within each level.
+// Returns the new id of every node.
+inline std::vector<NodeID> ComputeHierarchyNodeOrder(const std::vector<float> &node_levels,
+                                                     const std::vector<std::uint64_t> &spatial_keys)
+{
+    BOOST_ASSERT(node_levels.size() == spatial_keys.size());
+    std::vector<NodeID> nodes(node_levels.size());
+    std::iota(nodes.begin(), nodes.end(), 0u);
+    tbb::parallel_sort(nodes.begin(), nodes.end(),
+                       [&node_levels, &spatial_keys](const NodeID lhs, const NodeID rhs)
+                       {
+                           if (node_levels[lhs] != node_levels[rhs])
+                           {
+                               return node_levels[lhs] > node_levels[rhs];
+                           }
+                           return std::tie(spatial_keys[lhs], lhs) <
+                                  std::tie(spatial_keys[rhs], rhs);
+                       });
+
+    std::vector<NodeID> new_id_from_old_id(nodes.size());
+    for (const auto new_id : osrm::irange<NodeID>(0, nodes.size()))
+    {
+        new_id_from_old_id[nodes[new_id]] = new_id;
+    }
+    return new_id_from_old_id;
+}
+
+// Renumbers end points and shortcut middle nodes, original edges keep their edge-based edge id.
+template <class EdgeContainerT>
+void RenumberHierarchyEdges(const std::vector<NodeID> &new_id_from_old_id, EdgeContainerT &edges)
+{
+    for (QueryEdge &edge : edges)
+    {
+        edge.source = new_id_from_old_id[edge.source];
+        edge.target = new_id_from_old_id[edge.target];
+        if (edge.data.shortcut)
+        {
+            edge.data.id = new_id_from_old_id[edge.data.id];
+        }
+    }
+}
+
+// Moves the entry of every node to its new id
+template <typename T>
+void RenumberNodeValues(const std::vector<NodeID> &new_id_from_old_id, std::vector<T> &values)
+{
+    if (values.empty())
+    {
+        return;
+    }
+    BOOST_ASSERT(values.size() == new_id_from_old_id.size());
+    std::vector<T> renumbered_values(values.size());
+    for (const auto old_id : osrm::irange<NodeID>(0, values.size()))
+    {
+        renumbered_values[new_id_from_old_id[old_id]] = values[old_id];
+    }
+    values.swap(renumbered_values);
+}
+
+#endif // HIERARCHY_NODE_ORDER_HPP
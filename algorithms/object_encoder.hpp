@@ -28,61 +28,146 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef OBJECT_ENCODER_HPP
 #define OBJECT_ENCODER_HPP
 
+#include "../data_structures/packed_phantom_node.hpp"
+
 #include <boost/assert.hpp>
-#include <boost/archive/iterators/base64_from_binary.hpp>
-#include <boost/archive/iterators/binary_from_base64.hpp>
-#include <boost/archive/iterators/transform_width.hpp>
 
-#include <algorithm>
-#include <iterator>
+#include <cstddef>
+#include <cstring>
 #include <string>
-#include <vector>
 
+// Encodes trivially copyable objects like the phantom nodes of the hints in url-safe base64
+// without padding. The hints of every coordinate of a request are decoded, so this works in
+// place on the bytes of the object without temporary strings.
 struct ObjectEncoder
 {
-    using base64_t = boost::archive::iterators::base64_from_binary<
-        boost::archive::iterators::transform_width<const char *, 6, 8>>;
+    template <class ObjectT> static constexpr std::size_t EncodedLength()
+    {
+        return (4 * sizeof(ObjectT) + 2) / 3;
+    }
 
-    using binary_t = boost::archive::iterators::transform_width<
-        boost::archive::iterators::binary_from_base64<std::string::const_iterator>,
-        8,
-        6>;
+    // writes EncodedLength<ObjectT>() characters to output
+    template <class ObjectT> static void EncodeToBase64(const ObjectT &object, char *output)
+    {
+        static const char alphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+        const unsigned char *data = reinterpret_cast<const unsigned char *>(&object);
+        std::size_t position = 0;
+        for (; position + 3 <= sizeof(ObjectT); position += 3)
+        {
+            const unsigned group = (data[position] << 16) | (data[position + 1] << 8) |
+                                   data[position + 2];
+            *output++ = alphabet[(group >> 18) & 0x3f];
+            *output++ = alphabet[(group >> 12) & 0x3f];
+            *output++ = alphabet[(group >> 6) & 0x3f];
+            *output++ = alphabet[group & 0x3f];
+        }
+        const std::size_t remaining = sizeof(ObjectT) - position;
+        if (remaining > 0)
+        {
+            const unsigned group =
+                (data[position] << 16) | (remaining > 1 ? data[position + 1] << 8 : 0);
+            *output++ = alphabet[(group >> 18) & 0x3f];
+            *output++ = alphabet[(group >> 12) & 0x3f];
+            if (remaining > 1)
+            {
+                *output++ = alphabet[(group >> 6) & 0x3f];
+            }
+        }
+    }
 
     template <class ObjectT> static void EncodeToBase64(const ObjectT &object, std::string &encoded)
     {
-        const char *char_ptr_to_object = reinterpret_cast<const char *>(&object);
-        std::vector<unsigned char> data(sizeof(object));
-        std::copy(char_ptr_to_object, char_ptr_to_object + sizeof(ObjectT), data.begin());
+        encoded.resize(EncodedLength<ObjectT>());
+        EncodeToBase64(object, &encoded[0]);
+    }
 
-        unsigned char number_of_padded_chars = 0; // is in {0,1,2};
-        while (data.size() % 3 != 0)
+    // Returns false and leaves the object untouched if the input is not the encoding of an
+    // ObjectT. Also accepts the '+' and '/' of the standard alphabet.
+    template <class ObjectT> static bool DecodeFromBase64(const std::string &input, ObjectT &object)
+    {
+        if (input.size() != EncodedLength<ObjectT>())
         {
-            ++number_of_padded_chars;
-            data.push_back(0x00);
+            return false;
         }
 
-        BOOST_ASSERT_MSG(0 == data.size() % 3, "base64 input data size is not a multiple of 3!");
-        encoded.resize(sizeof(ObjectT));
-        encoded.assign(base64_t(&data[0]),
-                       base64_t(&data[0] + (data.size() - number_of_padded_chars)));
-        std::replace(begin(encoded), end(encoded), '+', '-');
-        std::replace(begin(encoded), end(encoded), '/', '_');
+        const unsigned char *table = GetDecodingTable().values;
+        unsigned char data[sizeof(ObjectT)];
+        std::size_t position = 0;
+        unsigned group = 0;
+        unsigned bits = 0;
+        for (const char c : input)
+        {
+            const unsigned char value = table[static_cast<unsigned char>(c)];
+            if (value == INVALID_CHARACTER)
+            {
+                return false;
+            }
+            group = (group << 6) | value;
+            bits += 6;
+            if (bits >= 8)
+            {
+                bits -= 8;
+                data[position++] = static_cast<unsigned char>(group >> bits);
+                group &= (1u << bits) - 1;
+            }
+        }
+        BOOST_ASSERT(position == sizeof(ObjectT));
+        std::memcpy(&object, data, sizeof(ObjectT));
+        return true;
     }
 
-    template <class ObjectT> static void DecodeFromBase64(const std::string &input, ObjectT &object)
+    // Hints hold the packed form of a phantom node if it fits and the full struct otherwise,
+    // their lengths tell them apart
+    static void EncodePhantomNode(const PhantomNode &phantom_node, std::string &encoded)
     {
-        try
+        if (PackedPhantomNode::Fits(phantom_node))
         {
-            std::string encoded(input);
-            std::replace(begin(encoded), end(encoded), '-', '+');
-            std::replace(begin(encoded), end(encoded), '_', '/');
+            EncodeToBase64(PackedPhantomNode(phantom_node), encoded);
+        }
+        else
+        {
+            EncodeToBase64(phantom_node, encoded);
+        }
+    }
 
-            std::copy(binary_t(encoded.begin()), binary_t(encoded.begin() + encoded.length()),
-                      reinterpret_cast<char *>(&object));
+    static bool DecodePhantomNode(const std::string &input, PhantomNode &phantom_node)
+    {
+        PackedPhantomNode packed_phantom_node;
+        if (DecodeFromBase64(input, packed_phantom_node))
+        {
+            phantom_node = packed_phantom_node.Unpack();
+            return true;
         }
-        catch (...)
+        return DecodeFromBase64(input, phantom_node);
+    }
+
+  private:
+    static const unsigned char INVALID_CHARACTER = 0xff;
+
+    struct DecodingTable
+    {
+        DecodingTable()
         {
+            static const char alphabet[] =
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+            std::memset(values, INVALID_CHARACTER, sizeof(values));
+            for (unsigned char i = 0; i < 62; ++i)
+            {
+                values[static_cast<unsigned char>(alphabet[i])] = i;
+            }
+            values[static_cast<unsigned char>('-')] = values[static_cast<unsigned char>('+')] = 62;
+            values[static_cast<unsigned char>('_')] = values[static_cast<unsigned char>('/')] = 63;
         }
+
+        unsigned char values[256];
+    };
+
+    static const DecodingTable &GetDecodingTable()
+    {
+        static const DecodingTable table;
+        return table;
     }
 };
 
@@ -0,0 +1,150 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef PARALLEL_RADIX_SORT_HPP
+#define PARALLEL_RADIX_SORT_HPP
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+// Sorts elements by an unsigned 64 bit key with a least significant digit radix sort, equal keys
+// keep their order. Each pass counts the digits of blocks of elements in parallel and moves every
+// block to its own ranges of the output. Digits that are the same for all keys are skipped, the
+// space filling curve values of a region share their upper bits.
+template <typename T, typename KeyExtractor>
+void ParallelRadixSort(std::vector<T> &elements, const KeyExtractor &get_key)
+{
+    constexpr unsigned DIGIT_BITS = 8;
+    constexpr std::size_t RADIX = std::size_t(1) << DIGIT_BITS;
+    // counting the digits does not pay off for a few elements
+    constexpr std::size_t MIN_RADIX_SORT_SIZE = 1024;
+    constexpr std::size_t MIN_BLOCK_SIZE = 1 << 16;
+    constexpr std::size_t MAX_BLOCKS = 256;
+
+    const std::size_t size = elements.size();
+    if (size < MIN_RADIX_SORT_SIZE)
+    {
+        std::stable_sort(elements.begin(), elements.end(), [&get_key](const T &lhs, const T &rhs)
+                         {
+                             return get_key(lhs) < get_key(rhs);
+                         });
+        return;
+    }
+
+    const std::size_t number_of_blocks =
+        std::max<std::size_t>(1, std::min(size / MIN_BLOCK_SIZE, MAX_BLOCKS));
+    const auto block_begin = [size, number_of_blocks](const std::size_t block)
+    {
+        return block * size / number_of_blocks;
+    };
+
+    // the bits that differ between any two keys
+    std::vector<std::uint64_t> block_and(number_of_blocks, ~std::uint64_t(0));
+    std::vector<std::uint64_t> block_or(number_of_blocks, 0);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, number_of_blocks, 1),
+                      [&](const tbb::blocked_range<std::size_t> &range)
+                      {
+                          for (auto block = range.begin(); block != range.end(); ++block)
+                          {
+                              for (auto i = block_begin(block); i != block_begin(block + 1); ++i)
+                              {
+                                  const std::uint64_t key = get_key(elements[i]);
+                                  block_and[block] &= key;
+                                  block_or[block] |= key;
+                              }
+                          }
+                      });
+    std::uint64_t all_and = ~std::uint64_t(0), all_or = 0;
+    for (std::size_t block = 0; block < number_of_blocks; ++block)
+    {
+        all_and &= block_and[block];
+        all_or |= block_or[block];
+    }
+    const std::uint64_t varying_bits = all_and ^ all_or;
+
+    std::vector<T> buffer(size);
+    std::vector<std::array<std::size_t, RADIX>> block_offsets(number_of_blocks);
+    for (unsigned shift = 0; shift < 64; shift += DIGIT_BITS)
+    {
+        if (0 == ((varying_bits >> shift) & (RADIX - 1)))
+        {
+            continue;
+        }
+
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, number_of_blocks, 1),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+                              for (auto block = range.begin(); block != range.end(); ++block)
+                              {
+                                  auto &counts = block_offsets[block];
+                                  counts.fill(0);
+                                  for (auto i = block_begin(block); i != block_begin(block + 1);
+                                       ++i)
+                                  {
+                                      ++counts[(get_key(elements[i]) >> shift) & (RADIX - 1)];
+                                  }
+                              }
+                          });
+
+        // a digit starts after all smaller digits, and within the digit after all earlier blocks
+        std::size_t offset = 0;
+        for (std::size_t digit = 0; digit < RADIX; ++digit)
+        {
+            for (auto &counts : block_offsets)
+            {
+                const std::size_t count = counts[digit];
+                counts[digit] = offset;
+                offset += count;
+            }
+        }
+
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, number_of_blocks, 1),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+                              for (auto block = range.begin(); block != range.end(); ++block)
+                              {
+                                  auto &offsets = block_offsets[block];
+                                  for (auto i = block_begin(block); i != block_begin(block + 1);
+                                       ++i)
+                                  {
+                                      const auto digit =
+                                          (get_key(elements[i]) >> shift) & (RADIX - 1);
+                                      buffer[offsets[digit]++] = std::move(elements[i]);
+                                  }
+                              }
+                          });
+        elements.swap(buffer);
+    }
+}
+
+#endif // PARALLEL_RADIX_SORT_HPP
@@ -0,0 +1,558 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef PARALLEL_SCC_HPP
+#define PARALLEL_SCC_HPP
+
+#include "../typedefs.h"
+
+#include "../util/integer_range.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
+
+#include <boost/assert.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+// Computes the strongly connected components of a static graph on all cores. It yields the same
+// partition as TarjanSCC, the components are numbered by their smallest node id.
+//
+//  1. nodes without an incoming or outgoing edge inside the remaining graph are trimmed as
+//     singletons, a few rounds of this already remove dead ends and one-way chains
+//  2. the component of a high degree pivot is the intersection of the nodes it reaches in the
+//     graph and in the reverse graph, both are found by a level-synchronous parallel BFS.
+//     On road networks this is the giant component.
+//  3. the rest falls apart into weakly connected pieces that are handed to Tarjan in parallel
+template <typename GraphT> class ParallelSCC
+{
+    static constexpr unsigned MAX_TRIM_ROUNDS = 4;
+    static constexpr std::size_t BFS_GRAIN_SIZE = 256;
+    static constexpr std::uint8_t FORWARD_MARK = 1;
+    static constexpr std::uint8_t BACKWARD_MARK = 2;
+
+    static constexpr unsigned UNVISITED = SPECIAL_NODEID;
+    static constexpr unsigned EXCLUDED = SPECIAL_NODEID - 1;
+
+    std::vector<unsigned> components_index;
+    std::vector<NodeID> component_size_vector;
+    std::shared_ptr<const GraphT> m_graph;
+    std::size_t size_one_counter;
+
+    // component representative of each node, the renumbering happens at the very end
+    std::vector<NodeID> representative;
+    // incoming edges as compressed rows
+    std::vector<EdgeID> reverse_offsets;
+    std::vector<NodeID> reverse_sources;
+
+  public:
+    ParallelSCC(std::shared_ptr<const GraphT> graph)
+        : components_index(graph->GetNumberOfNodes(), SPECIAL_NODEID), m_graph(graph),
+          size_one_counter(0)
+    {
+        BOOST_ASSERT(m_graph->GetNumberOfNodes() > 0);
+    }
+
+    void run()
+    {
+        TIMER_START(SCC_RUN);
+        const NodeID number_of_nodes = m_graph->GetNumberOfNodes();
+        representative.assign(number_of_nodes, SPECIAL_NODEID);
+
+        BuildReverseGraph();
+        const std::size_t trimmed_nodes = TrimSingletons();
+
+        const NodeID pivot = FindPivot();
+        std::size_t pivot_component_size = 0;
+        if (SPECIAL_NODEID != pivot)
+        {
+            pivot_component_size = ExtractPivotComponent(pivot);
+        }
+
+        const std::size_t remaining_nodes = RunTarjanOnRemainder();
+        SimpleLogger().Write() << "SCC: trimmed " << trimmed_nodes << " nodes, pivot component of "
+                               << pivot_component_size << " nodes, " << remaining_nodes
+                               << " nodes left for Tarjan";
+
+        NumberComponents();
+
+        reverse_offsets.clear();
+        reverse_offsets.shrink_to_fit();
+        reverse_sources.clear();
+        reverse_sources.shrink_to_fit();
+        representative.clear();
+        representative.shrink_to_fit();
+
+        TIMER_STOP(SCC_RUN);
+        SimpleLogger().Write() << "SCC run took: " << TIMER_MSEC(SCC_RUN) / 1000. << "s";
+
+        size_one_counter = std::count_if(component_size_vector.begin(), component_size_vector.end(),
+                                         [](unsigned value)
+                                         {
+                                             return 1 == value;
+                                         });
+    }
+
+    std::size_t get_number_of_components() const { return component_size_vector.size(); }
+
+    std::size_t get_size_one_count() const { return size_one_counter; }
+
+    unsigned get_component_size(const unsigned component_id) const
+    {
+        return component_size_vector[component_id];
+    }
+
+    unsigned get_component_id(const NodeID node) const { return components_index[node]; }
+
+  private:
+    void BuildReverseGraph()
+    {
+        const NodeID number_of_nodes = m_graph->GetNumberOfNodes();
+        std::vector<std::atomic<EdgeID>> in_degree(number_of_nodes);
+        tbb::parallel_for(tbb::blocked_range<NodeID>(0, number_of_nodes),
+                          [&](const tbb::blocked_range<NodeID> &range)
+                          {
+                              for (const auto node : osrm::irange(range.begin(), range.end()))
+                              {
+                                  for (const auto edge : m_graph->GetAdjacentEdgeRange(node))
+                                  {
+                                      in_degree[m_graph->GetTarget(edge)].fetch_add(
+                                          1, std::memory_order_relaxed);
+                                  }
+                              }
+                          });
+
+        reverse_offsets.resize(number_of_nodes + 1);
+        reverse_offsets[0] = 0;
+        for (const auto node : osrm::irange(0u, number_of_nodes))
+        {
+            reverse_offsets[node + 1] = reverse_offsets[node] + in_degree[node].load();
+            // reused as fill position
+            in_degree[node].store(reverse_offsets[node], std::memory_order_relaxed);
+        }
+
+        reverse_sources.resize(reverse_offsets.back());
+        tbb::parallel_for(tbb::blocked_range<NodeID>(0, number_of_nodes),
+                          [&](const tbb::blocked_range<NodeID> &range)
+                          {
+                              for (const auto node : osrm::irange(range.begin(), range.end()))
+                              {
+                                  for (const auto edge : m_graph->GetAdjacentEdgeRange(node))
+                                  {
+                                      const auto position =
+                                          in_degree[m_graph->GetTarget(edge)].fetch_add(
+                                              1, std::memory_order_relaxed);
+                                      reverse_sources[position] = node;
+                                  }
+                              }
+                          });
+    }
+
+    bool IsUnassigned(const NodeID node) const { return SPECIAL_NODEID == representative[node]; }
+
+    bool HasActiveSuccessor(const NodeID node) const
+    {
+        for (const auto edge : m_graph->GetAdjacentEdgeRange(node))
+        {
+            const auto target = m_graph->GetTarget(edge);
+            if (target != node && IsUnassigned(target))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool HasActivePredecessor(const NodeID node) const
+    {
+        for (const auto position : osrm::irange(reverse_offsets[node], reverse_offsets[node + 1]))
+        {
+            const auto source = reverse_sources[position];
+            if (source != node && IsUnassigned(source))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // a node that cannot be left or entered is a component on its own
+    std::size_t TrimSingletons()
+    {
+        const NodeID number_of_nodes = m_graph->GetNumberOfNodes();
+        std::vector<char> is_trimmed(number_of_nodes, false);
+        std::size_t total_trimmed = 0;
+        for (unsigned round = 0; round < MAX_TRIM_ROUNDS; ++round)
+        {
+            // the flags are collected first so that a round only reads the previous state
+            std::atomic<std::size_t> trimmed_in_round{0};
+            tbb::parallel_for(tbb::blocked_range<NodeID>(0, number_of_nodes),
+                              [&](const tbb::blocked_range<NodeID> &range)
+                              {
+                                  std::size_t trimmed = 0;
+                                  for (const auto node : osrm::irange(range.begin(), range.end()))
+                                  {
+                                      if (IsUnassigned(node) && (!HasActiveSuccessor(node) ||
+                                                                 !HasActivePredecessor(node)))
+                                      {
+                                          is_trimmed[node] = true;
+                                          ++trimmed;
+                                      }
+                                  }
+                                  trimmed_in_round.fetch_add(trimmed);
+                              });
+
+            if (0 == trimmed_in_round.load())
+            {
+                break;
+            }
+            total_trimmed += trimmed_in_round.load();
+
+            tbb::parallel_for(tbb::blocked_range<NodeID>(0, number_of_nodes),
+                              [&](const tbb::blocked_range<NodeID> &range)
+                              {
+                                  for (const auto node : osrm::irange(range.begin(), range.end()))
+                                  {
+                                      if (is_trimmed[node])
+                                      {
+                                          representative[node] = node;
+                                          is_trimmed[node] = false;
+                                      }
+                                  }
+                              });
+        }
+        return total_trimmed;
+    }
+
+    // the node with the most paths through it is most likely part of the giant component
+    NodeID FindPivot() const
+    {
+        NodeID pivot = SPECIAL_NODEID;
+        std::uint64_t best_degree_product = 0;
+        for (const auto node : osrm::irange(0u, m_graph->GetNumberOfNodes()))
+        {
+            if (!IsUnassigned(node))
+            {
+                continue;
+            }
+            const std::uint64_t degree_product =
+                std::uint64_t(m_graph->EndEdges(node) - m_graph->BeginEdges(node)) *
+                (reverse_offsets[node + 1] - reverse_offsets[node]);
+            if (SPECIAL_NODEID == pivot || degree_product > best_degree_product)
+            {
+                pivot = node;
+                best_degree_product = degree_product;
+            }
+        }
+        return pivot;
+    }
+
+    template <bool forward>
+    void MarkReachable(const NodeID pivot,
+                       const std::uint8_t mark,
+                       std::vector<std::atomic<std::uint8_t>> &marks) const
+    {
+        std::vector<NodeID> frontier = {pivot};
+        marks[pivot].fetch_or(mark);
+        tbb::enumerable_thread_specific<std::vector<NodeID>> next_frontiers;
+
+        const auto visit = [&](const NodeID node, std::vector<NodeID> &next_frontier)
+        {
+            if (IsUnassigned(node) && !(marks[node].load(std::memory_order_relaxed) & mark) &&
+                !(marks[node].fetch_or(mark) & mark))
+            {
+                next_frontier.push_back(node);
+            }
+        };
+
+        while (!frontier.empty())
+        {
+            tbb::parallel_for(
+                tbb::blocked_range<std::size_t>(0, frontier.size(), BFS_GRAIN_SIZE),
+                [&](const tbb::blocked_range<std::size_t> &range)
+                {
+                    auto &next_frontier = next_frontiers.local();
+                    for (const auto i : osrm::irange(range.begin(), range.end()))
+                    {
+                        const NodeID node = frontier[i];
+                        if (forward)
+                        {
+                            for (const auto edge : m_graph->GetAdjacentEdgeRange(node))
+                            {
+                                visit(m_graph->GetTarget(edge), next_frontier);
+                            }
+                        }
+                        else
+                        {
+                            for (const auto position :
+                                 osrm::irange(reverse_offsets[node], reverse_offsets[node + 1]))
+                            {
+                                visit(reverse_sources[position], next_frontier);
+                            }
+                        }
+                    }
+                });
+
+            frontier.clear();
+            for (auto &next_frontier : next_frontiers)
+            {
+                frontier.insert(frontier.end(), next_frontier.begin(), next_frontier.end());
+                next_frontier.clear();
+            }
+        }
+    }
+
+    std::size_t ExtractPivotComponent(const NodeID pivot)
+    {
+        const NodeID number_of_nodes = m_graph->GetNumberOfNodes();
+        std::vector<std::atomic<std::uint8_t>> marks(number_of_nodes);
+        MarkReachable<true>(pivot, FORWARD_MARK, marks);
+        MarkReachable<false>(pivot, BACKWARD_MARK, marks);
+
+        std::atomic<std::size_t> component_size{0};
+        tbb::parallel_for(tbb::blocked_range<NodeID>(0, number_of_nodes),
+                          [&](const tbb::blocked_range<NodeID> &range)
+                          {
+                              std::size_t size = 0;
+                              for (const auto node : osrm::irange(range.begin(), range.end()))
+                              {
+                                  if ((FORWARD_MARK | BACKWARD_MARK) == marks[node].load())
+                                  {
+                                      representative[node] = pivot;
+                                      ++size;
+                                  }
+                              }
+                              component_size.fetch_add(size);
+                          });
+        return component_size.load();
+    }
+
+    static NodeID FindRoot(std::vector<NodeID> &parent, NodeID node)
+    {
+        while (parent[node] != node)
+        {
+            parent[node] = parent[parent[node]];
+            node = parent[node];
+        }
+        return node;
+    }
+
+    // splits the unassigned nodes into weakly connected pieces and runs Tarjan on each of them
+    std::size_t RunTarjanOnRemainder()
+    {
+        const NodeID number_of_nodes = m_graph->GetNumberOfNodes();
+
+        // union-find over the remaining edges, linear in the size of the remainder
+        std::vector<NodeID> parent(number_of_nodes);
+        std::vector<NodeID> remaining_nodes;
+        for (const auto node : osrm::irange(0u, number_of_nodes))
+        {
+            parent[node] = node;
+            if (IsUnassigned(node))
+            {
+                remaining_nodes.push_back(node);
+            }
+        }
+        if (remaining_nodes.empty())
+        {
+            return 0;
+        }
+        for (const auto node : remaining_nodes)
+        {
+            for (const auto edge : m_graph->GetAdjacentEdgeRange(node))
+            {
+                const auto target = m_graph->GetTarget(edge);
+                if (!IsUnassigned(target))
+                {
+                    continue;
+                }
+                const auto source_root = FindRoot(parent, node);
+                const auto target_root = FindRoot(parent, target);
+                if (source_root != target_root)
+                {
+                    parent[std::max(source_root, target_root)] = std::min(source_root, target_root);
+                }
+            }
+        }
+
+        // group the remaining nodes by piece, the nodes of a piece stay sorted
+        std::vector<NodeID> piece_of_root(number_of_nodes, SPECIAL_NODEID);
+        std::vector<std::size_t> piece_offsets = {0};
+        for (const auto node : remaining_nodes)
+        {
+            const auto root = FindRoot(parent, node);
+            if (SPECIAL_NODEID == piece_of_root[root])
+            {
+                piece_of_root[root] = piece_offsets.size() - 1;
+                piece_offsets.push_back(0);
+            }
+            ++piece_offsets[piece_of_root[root] + 1];
+        }
+        std::partial_sum(piece_offsets.begin(), piece_offsets.end(), piece_offsets.begin());
+        std::vector<NodeID> piece_nodes(remaining_nodes.size());
+        {
+            std::vector<std::size_t> fill_position(piece_offsets.begin(), piece_offsets.end() - 1);
+            for (const auto node : remaining_nodes)
+            {
+                piece_nodes[fill_position[piece_of_root[FindRoot(parent, node)]]++] = node;
+            }
+        }
+
+        // the pieces are disjoint, the state of a node is only touched by the task of its piece
+        std::vector<unsigned> tarjan_index(number_of_nodes, EXCLUDED);
+        std::vector<unsigned> low_link(number_of_nodes);
+        std::vector<char> on_stack(number_of_nodes, false);
+        for (const auto node : remaining_nodes)
+        {
+            tarjan_index[node] = UNVISITED;
+        }
+
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, piece_offsets.size() - 1, 1),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+                              for (const auto piece : osrm::irange(range.begin(), range.end()))
+                              {
+                                  RunTarjan(piece_nodes.begin() + piece_offsets[piece],
+                                            piece_nodes.begin() + piece_offsets[piece + 1],
+                                            tarjan_index, low_link, on_stack);
+                              }
+                          });
+        return remaining_nodes.size();
+    }
+
+    template <typename NodeIterator>
+    void RunTarjan(const NodeIterator first,
+                   const NodeIterator last,
+                   std::vector<unsigned> &tarjan_index,
+                   std::vector<unsigned> &low_link,
+                   std::vector<char> &on_stack)
+    {
+        struct StackFrame
+        {
+            NodeID node;
+            EdgeID next_edge;
+        };
+        std::vector<StackFrame> recursion_stack;
+        std::vector<NodeID> tarjan_stack;
+        unsigned index = 0;
+
+        const auto visit = [&](const NodeID node)
+        {
+            tarjan_index[node] = low_link[node] = index++;
+            tarjan_stack.push_back(node);
+            on_stack[node] = true;
+            recursion_stack.push_back({node, m_graph->BeginEdges(node)});
+        };
+
+        for (auto iter = first; iter != last; ++iter)
+        {
+            if (UNVISITED != tarjan_index[*iter])
+            {
+                continue;
+            }
+            visit(*iter);
+
+            while (!recursion_stack.empty())
+            {
+                auto &frame = recursion_stack.back();
+                const NodeID node = frame.node;
+                if (frame.next_edge < m_graph->EndEdges(node))
+                {
+                    const NodeID target = m_graph->GetTarget(frame.next_edge);
+                    ++frame.next_edge;
+                    if (UNVISITED == tarjan_index[target])
+                    {
+                        visit(target);
+                    }
+                    else if (EXCLUDED != tarjan_index[target] && on_stack[target])
+                    {
+                        low_link[node] = std::min(low_link[node], tarjan_index[target]);
+                    }
+                    continue;
+                }
+
+                recursion_stack.pop_back();
+                if (!recursion_stack.empty())
+                {
+                    const NodeID parent = recursion_stack.back().node;
+                    low_link[parent] = std::min(low_link[parent], low_link[node]);
+                }
+
+                if (low_link[node] == tarjan_index[node])
+                {
+                    NodeID member;
+                    do
+                    {
+                        member = tarjan_stack.back();
+                        tarjan_stack.pop_back();
+                        on_stack[member] = false;
+                        representative[member] = node;
+                    } while (member != node);
+                }
+            }
+        }
+    }
+
+    // components are numbered in the order of their smallest node id
+    void NumberComponents()
+    {
+        const NodeID number_of_nodes = m_graph->GetNumberOfNodes();
+        std::vector<unsigned> component_of_representative(number_of_nodes, SPECIAL_NODEID);
+        for (const auto node : osrm::irange(0u, number_of_nodes))
+        {
+            BOOST_ASSERT(!IsUnassigned(node));
+            auto &component = component_of_representative[representative[node]];
+            if (SPECIAL_NODEID == component)
+            {
+                component = component_size_vector.size();
+                component_size_vector.push_back(0);
+            }
+            components_index[node] = component;
+            ++component_size_vector[component];
+        }
+
+        for (const auto component : osrm::irange<std::size_t>(0, component_size_vector.size()))
+        {
+            if (component_size_vector[component] > 1000)
+            {
+                SimpleLogger().Write() << "large component [" << component
+                                       << "]=" << component_size_vector[component];
+            }
+        }
+    }
+};
+
+#endif /* PARALLEL_SCC_HPP */
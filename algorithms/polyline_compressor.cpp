@@ -30,63 +30,57 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/coordinate.hpp>
 
-std::string PolylineCompressor::encode_vector(std::vector<int> &numbers) const
+#include <cstddef>
+#include <string>
+
+namespace
 {
-    std::string output;
-    const auto end = numbers.size();
-    for (std::size_t i = 0; i < end; ++i)
-    {
-        numbers[i] <<= 1;
-        if (numbers[i] < 0)
-        {
-            numbers[i] = ~(numbers[i]);
-        }
-    }
-    for (const int number : numbers)
-    {
-        output += encode_number(number);
-    }
-    return output;
-}
+// a 32 bit number takes at most seven chunks of five bits
+constexpr std::size_t MAX_ENCODED_NUMBER_LENGTH = 7;
 
-std::string PolylineCompressor::encode_number(int number_to_encode) const
+// writes the number with its sign moved to the lowest bit, returns the end of the output
+inline char *encode_number(const int number, char *output)
 {
-    std::string output;
+    const unsigned shifted_number = static_cast<unsigned>(number) << 1;
+    unsigned number_to_encode = number < 0 ? ~shifted_number : shifted_number;
     while (number_to_encode >= 0x20)
     {
-        const int next_value = (0x20 | (number_to_encode & 0x1f)) + 63;
-        output += static_cast<char>(next_value);
+        *output++ = static_cast<char>((0x20 | (number_to_encode & 0x1f)) + 63);
         number_to_encode >>= 5;
     }
-
-    number_to_encode += 63;
-    output += static_cast<char>(number_to_encode);
+    *output++ = static_cast<char>(number_to_encode + 63);
     return output;
 }
+}
 
 std::string
 PolylineCompressor::get_encoded_string(const std::vector<SegmentInformation> &polyline) const
 {
-    if (polyline.empty())
-    {
-        return {};
-    }
+    std::string output;
+    encode_into(polyline, output);
+    return output;
+}
+
+void PolylineCompressor::encode_into(const std::vector<SegmentInformation> &polyline,
+                                     std::string &output) const
+{
+    // make room for the longest encoding once and cut the string down to the written part
+    const std::size_t initial_size = output.size();
+    output.resize(initial_size + polyline.size() * 2 * MAX_ENCODED_NUMBER_LENGTH);
+    char *const begin = &output[0];
+    char *end = begin + initial_size;
 
-    std::vector<int> delta_numbers;
-    delta_numbers.reserve((polyline.size() - 1) * 2);
     FixedPointCoordinate previous_coordinate = {0, 0};
     for (const auto &segment : polyline)
     {
         if (segment.necessary)
         {
-            const int lat_diff = segment.location.lat - previous_coordinate.lat;
-            const int lon_diff = segment.location.lon - previous_coordinate.lon;
-            delta_numbers.emplace_back(lat_diff);
-            delta_numbers.emplace_back(lon_diff);
+            end = encode_number(segment.location.lat - previous_coordinate.lat, end);
+            end = encode_number(segment.location.lon - previous_coordinate.lon, end);
             previous_coordinate = segment.location;
         }
     }
-    return encode_vector(delta_numbers);
+    output.resize(end - begin);
 }
 
 std::vector<FixedPointCoordinate> PolylineCompressor::decode_string(const std::string &geometry_string) const
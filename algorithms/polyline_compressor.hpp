@@ -37,14 +37,12 @@ struct SegmentInformation;
 
 class PolylineCompressor
 {
-  private:
-    std::string encode_vector(std::vector<int> &numbers) const;
-
-    std::string encode_number(const int number_to_encode) const;
-
   public:
     std::string get_encoded_string(const std::vector<SegmentInformation> &polyline) const;
-    
+
+    // appends the encoding of the necessary points of the polyline to output
+    void encode_into(const std::vector<SegmentInformation> &polyline, std::string &output) const;
+
     std::vector<FixedPointCoordinate> decode_string(const std::string &geometry_string) const;
 };
 
@@ -35,7 +35,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 osrm::json::String
 PolylineFormatter::printEncodedString(const std::vector<SegmentInformation> &polyline) const
 {
-    return osrm::json::String(PolylineCompressor().get_encoded_string(polyline));
+    // encoded right into the reply, without a copy of the string
+    osrm::json::String encoded_polyline;
+    PolylineCompressor().encode_into(polyline, encoded_polyline.value);
+    return encoded_polyline;
 }
 
 osrm::json::Array
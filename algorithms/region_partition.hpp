@@ -0,0 +1,121 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef REGION_PARTITION_HPP
+#define REGION_PARTITION_HPP
+
+#include "../typedefs.h"
+#include "../util/integer_range.hpp"
+
+#include <osrm/coordinate.hpp>
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+// Splits the nodes into regions of about equal size by cutting their bounding box in two at the
+// median of its longer side, recursively. Few roads cross such cuts. Returns the region of
+// every node.
+inline std::vector<unsigned> PartitionByLocation(const std::vector<FixedPointCoordinate> &locations,
+                                                 const unsigned number_of_regions)
+{
+    BOOST_ASSERT(number_of_regions > 0);
+    std::vector<unsigned> regions(locations.size(), 0);
+    std::vector<NodeID> nodes(locations.size());
+    std::iota(nodes.begin(), nodes.end(), 0u);
+
+    // (first node, end of the nodes, first region, number of regions)
+    std::vector<std::tuple<std::size_t, std::size_t, unsigned, unsigned>> ranges;
+    ranges.emplace_back(0, nodes.size(), 0, number_of_regions);
+    while (!ranges.empty())
+    {
+        std::size_t begin, end;
+        unsigned first_region, range_regions;
+        std::tie(begin, end, first_region, range_regions) = ranges.back();
+        ranges.pop_back();
+        if (range_regions == 1 || end - begin < 2)
+        {
+            for (const auto position : osrm::irange(begin, end))
+            {
+                regions[nodes[position]] = first_region;
+            }
+            continue;
+        }
+
+        int min_lat = std::numeric_limits<int>::max(), max_lat = std::numeric_limits<int>::min();
+        int min_lon = min_lat, max_lon = max_lat;
+        for (const auto position : osrm::irange(begin, end))
+        {
+            const FixedPointCoordinate &location = locations[nodes[position]];
+            min_lat = std::min(min_lat, location.lat);
+            max_lat = std::max(max_lat, location.lat);
+            min_lon = std::min(min_lon, location.lon);
+            max_lon = std::max(max_lon, location.lon);
+        }
+        const bool cut_latitude =
+            static_cast<long long>(max_lat) - min_lat > static_cast<long long>(max_lon) - min_lon;
+
+        // uneven region counts get cuts of matching uneven sizes
+        const unsigned left_regions = range_regions / 2;
+        const std::size_t middle = begin + (end - begin) * left_regions / range_regions;
+        std::nth_element(nodes.begin() + begin, nodes.begin() + middle, nodes.begin() + end,
+                         [&locations, cut_latitude](const NodeID lhs, const NodeID rhs)
+                         {
+                             return cut_latitude ? locations[lhs].lat < locations[rhs].lat
+                                                 : locations[lhs].lon < locations[rhs].lon;
+                         });
+        ranges.emplace_back(begin, middle, first_region, left_regions);
+        ranges.emplace_back(middle, end, first_region + left_regions,
+                            range_regions - left_regions);
+    }
+    return regions;
+}
+
+// Marks the nodes that share an edge with a node of another region
+template <class EdgeContainerT>
+std::vector<bool> FindBoundaryNodes(const std::vector<unsigned> &regions,
+                                    const EdgeContainerT &edges)
+{
+    std::vector<bool> is_boundary_node(regions.size(), false);
+    for (const auto &edge : edges)
+    {
+        BOOST_ASSERT(edge.source < regions.size() && edge.target < regions.size());
+        if (regions[edge.source] != regions[edge.target])
+        {
+            is_boundary_node[edge.source] = true;
+            is_boundary_node[edge.target] = true;
+        }
+    }
+    return is_boundary_node;
+}
+
+#endif // REGION_PARTITION_HPP
@@ -28,10 +28,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef EXTRACT_ROUTE_NAMES_H
 #define EXTRACT_ROUTE_NAMES_H
 
-#include <boost/assert.hpp>
-
 #include <algorithm>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 struct RouteNames
@@ -46,8 +45,10 @@ struct RouteNames
 template <class DataFacadeT, class SegmentT> struct ExtractRouteNames
 {
   private:
+    // the longest named segment whose name is neither blocked nor on the other route
     SegmentT PickNextLongestSegment(const std::vector<SegmentT> &segment_list,
-                                    const unsigned blocked_name_id) const
+                                    const unsigned blocked_name_id,
+                                    const std::unordered_set<unsigned> &other_route_names) const
     {
         SegmentT result_segment;
         result_segment.length = 0;
@@ -55,7 +56,7 @@ template <class DataFacadeT, class SegmentT> struct ExtractRouteNames
         for (const SegmentT &segment : segment_list)
         {
             if (segment.name_id != blocked_name_id && segment.length > result_segment.length &&
-                segment.name_id != 0)
+                segment.name_id != 0 && 0 == other_route_names.count(segment.name_id))
             {
                 result_segment = segment;
             }
@@ -63,9 +64,29 @@ template <class DataFacadeT, class SegmentT> struct ExtractRouteNames
         return result_segment;
     }
 
+    static SegmentT PickLongestSegment(const std::vector<SegmentT> &segment_list)
+    {
+        return *std::max_element(segment_list.begin(), segment_list.end(),
+                                 [](const SegmentT &a, const SegmentT &b)
+                                 {
+                                     return a.length < b.length;
+                                 });
+    }
+
+    static std::unordered_set<unsigned> GetNames(const std::vector<SegmentT> &segment_list)
+    {
+        std::unordered_set<unsigned> names(segment_list.size());
+        for (const SegmentT &segment : segment_list)
+        {
+            names.insert(segment.name_id);
+        }
+        return names;
+    }
+
   public:
-    RouteNames operator()(std::vector<SegmentT> &shortest_path_segments,
-                          std::vector<SegmentT> &alternative_path_segments,
+    // the segments are only scanned, neither copied nor sorted
+    RouteNames operator()(const std::vector<SegmentT> &shortest_path_segments,
+                          const std::vector<SegmentT> &alternative_path_segments,
                           const DataFacadeT *facade) const
     {
         RouteNames route_names;
@@ -73,67 +94,28 @@ template <class DataFacadeT, class SegmentT> struct ExtractRouteNames
         SegmentT shortest_segment_1, shortest_segment_2;
         SegmentT alternative_segment_1, alternative_segment_2;
 
-        auto length_comperator = [](const SegmentT &a, const SegmentT &b)
-        {
-            return a.length > b.length;
-        };
-        auto name_id_comperator = [](const SegmentT &a, const SegmentT &b)
-        {
-            return a.name_id < b.name_id;
-        };
-
         if (shortest_path_segments.empty())
         {
             return route_names;
         }
 
         // pick the longest segment for the shortest path.
-        std::sort(shortest_path_segments.begin(), shortest_path_segments.end(), length_comperator);
-        shortest_segment_1 = shortest_path_segments[0];
+        shortest_segment_1 = PickLongestSegment(shortest_path_segments);
         if (!alternative_path_segments.empty())
         {
-            std::sort(alternative_path_segments.begin(), alternative_path_segments.end(),
-                      length_comperator);
-
             // also pick the longest segment for the alternative path
-            alternative_segment_1 = alternative_path_segments[0];
+            alternative_segment_1 = PickLongestSegment(alternative_path_segments);
         }
 
-        // compute the set difference (for shortest path) depending on names between shortest and
-        // alternative
-        std::vector<SegmentT> shortest_path_set_difference(shortest_path_segments.size());
-        std::sort(shortest_path_segments.begin(), shortest_path_segments.end(), name_id_comperator);
-        std::sort(alternative_path_segments.begin(), alternative_path_segments.end(),
-                  name_id_comperator);
-        std::set_difference(shortest_path_segments.begin(), shortest_path_segments.end(),
-                            alternative_path_segments.begin(), alternative_path_segments.end(),
-                            shortest_path_set_difference.begin(), name_id_comperator);
-
-        std::sort(shortest_path_set_difference.begin(), shortest_path_set_difference.end(),
-                  length_comperator);
-        shortest_segment_2 =
-            PickNextLongestSegment(shortest_path_set_difference, shortest_segment_1.name_id);
-
-        // compute the set difference (for alternative path) depending on names between shortest and
-        // alternative
-        // vectors are still sorted, no need to do again
-        BOOST_ASSERT(std::is_sorted(shortest_path_segments.begin(), shortest_path_segments.end(),
-                                    name_id_comperator));
-        BOOST_ASSERT(std::is_sorted(alternative_path_segments.begin(),
-                                    alternative_path_segments.end(), name_id_comperator));
-
-        std::vector<SegmentT> alternative_path_set_difference(alternative_path_segments.size());
-        std::set_difference(alternative_path_segments.begin(), alternative_path_segments.end(),
-                            shortest_path_segments.begin(), shortest_path_segments.end(),
-                            alternative_path_set_difference.begin(), name_id_comperator);
-
-        std::sort(alternative_path_set_difference.begin(), alternative_path_set_difference.end(),
-                  length_comperator);
-
+        // the second names are the longest ones that the other path does not share
+        shortest_segment_2 = PickNextLongestSegment(shortest_path_segments,
+                                                    shortest_segment_1.name_id,
+                                                    GetNames(alternative_path_segments));
         if (!alternative_path_segments.empty())
         {
-            alternative_segment_2 = PickNextLongestSegment(alternative_path_set_difference,
-                                                           alternative_segment_1.name_id);
+            alternative_segment_2 = PickNextLongestSegment(alternative_path_segments,
+                                                           alternative_segment_1.name_id,
+                                                           GetNames(shortest_path_segments));
         }
 
         // move the segments into the order in which they occur.
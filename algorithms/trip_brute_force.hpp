@@ -30,10 +30,18 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../data_structures/search_engine.hpp"
 #include "../util/dist_table_wrapper.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/query_cancellation.hpp"
 #include "../util/simple_logger.hpp"
 
 #include <osrm/json_container.hpp>
 
+#include <boost/assert.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <atomic>
 #include <cstdlib>
 #include <algorithm>
 #include <string>
@@ -46,27 +54,122 @@ namespace osrm
 namespace trip
 {
 
-// computes the distance of a given permutation
-EdgeWeight ReturnDistance(const DistTableWrapper<EdgeWeight> &dist_table,
-                          const std::vector<NodeID> &location_order,
-                          const EdgeWeight min_route_dist,
-                          const std::size_t component_size)
+// Searches the round trips through a fixed prefix depth-first. Partial trips are cut as soon as
+// their length plus the cheapest way to leave, or to enter, every remaining location exceeds
+// the shortest trip any worker has found so far.
+class TripBranchAndBound
 {
-    EdgeWeight route_dist = 0;
-    std::size_t i = 0;
-    while (i < location_order.size() && (route_dist < min_route_dist))
+  public:
+    TripBranchAndBound(const std::vector<EdgeWeight> &distances,
+                       const std::vector<unsigned> &successors,
+                       const std::vector<EdgeWeight> &min_outgoing,
+                       const std::vector<EdgeWeight> &min_incoming,
+                       std::atomic<EdgeWeight> &best_length)
+        : size(static_cast<unsigned>(min_outgoing.size())), distances(distances),
+          successors(successors), min_outgoing(min_outgoing), min_incoming(min_incoming),
+          best_length(best_length),
+          visited(size, false), local_best_length(INVALID_EDGE_WEIGHT)
     {
-        route_dist += dist_table(location_order[i], location_order[(i + 1) % component_size]);
-        BOOST_ASSERT_MSG(dist_table(location_order[i], location_order[(i + 1) % component_size]) !=
-                             INVALID_EDGE_WEIGHT,
-                         "invalid route found");
-        ++i;
     }
 
-    return route_dist;
-}
+    // the shortest trip starting with the prefix, which is empty if no trip beats the bound
+    std::vector<unsigned> Run(const std::vector<unsigned> &prefix)
+    {
+        trip = prefix;
+        EdgeWeight length = 0;
+        EdgeWeight remaining_min_outgoing = 0;
+        EdgeWeight remaining_min_incoming = 0;
+        for (const auto location : osrm::irange(0u, size))
+        {
+            remaining_min_outgoing += min_outgoing[location];
+            remaining_min_incoming += min_incoming[location];
+        }
+        for (const auto i : osrm::irange<std::size_t>(0, prefix.size()))
+        {
+            visited[prefix[i]] = true;
+            remaining_min_outgoing -= min_outgoing[prefix[i]];
+            remaining_min_incoming -= min_incoming[prefix[i]];
+            if (i > 0)
+            {
+                length += Distance(prefix[i - 1], prefix[i]);
+            }
+        }
+        Search(length, remaining_min_outgoing, remaining_min_incoming);
+        return best_trip;
+    }
+
+    EdgeWeight GetLength() const { return local_best_length; }
+
+  private:
+    EdgeWeight Distance(const unsigned from, const unsigned to) const
+    {
+        return distances[from * size + to];
+    }
+
+    // the remaining sums are over the locations that are not part of the trip yet
+    void Search(const EdgeWeight length,
+                const EdgeWeight remaining_min_outgoing,
+                const EdgeWeight remaining_min_incoming)
+    {
+        osrm::cancellation::Poll();
+        const unsigned current = trip.back();
+        if (trip.size() == size)
+        {
+            const EdgeWeight trip_length = length + Distance(current, trip.front());
+            // trips as long as the best one are kept, so the result does not depend on timing
+            if (trip_length < local_best_length && trip_length <= best_length.load())
+            {
+                local_best_length = trip_length;
+                best_trip = trip;
+                EdgeWeight known_length = best_length.load();
+                while (trip_length < known_length &&
+                       !best_length.compare_exchange_weak(known_length, trip_length))
+                {
+                }
+            }
+            return;
+        }
+
+        // the current location has to be left and the first one entered once more
+        const EdgeWeight lower_bound =
+            length + std::max(min_outgoing[current] + remaining_min_outgoing,
+                              min_incoming[trip.front()] + remaining_min_incoming);
+        if (lower_bound > best_length.load())
+        {
+            return;
+        }
+
+        // closer locations first, they lead to short trips and a tight bound early
+        for (const auto k : osrm::irange(0u, size - 1))
+        {
+            const unsigned next = successors[current * (size - 1) + k];
+            if (visited[next])
+            {
+                continue;
+            }
+            visited[next] = true;
+            trip.push_back(next);
+            Search(length + Distance(current, next), remaining_min_outgoing - min_outgoing[next],
+                   remaining_min_incoming - min_incoming[next]);
+            trip.pop_back();
+            visited[next] = false;
+        }
+    }
+
+    const unsigned size;
+    const std::vector<EdgeWeight> &distances;
+    const std::vector<unsigned> &successors;
+    const std::vector<EdgeWeight> &min_outgoing;
+    const std::vector<EdgeWeight> &min_incoming;
+    std::atomic<EdgeWeight> &best_length;
+    std::vector<bool> visited;
+    std::vector<unsigned> trip;
+    std::vector<unsigned> best_trip;
+    EdgeWeight local_best_length;
+};
 
-// computes the route by computing all permutations and selecting the shortest
+// computes the shortest round trip exactly. The trips are split by their first three locations
+// across the worker threads, which share the length of the shortest trip found for pruning.
 template <typename NodeIDIterator>
 std::vector<NodeID> BruteForceTrip(const NodeIDIterator start,
                                    const NodeIDIterator end,
@@ -75,31 +178,112 @@ std::vector<NodeID> BruteForceTrip(const NodeIDIterator start,
 {
     (void)number_of_locations; // unused
 
-    const auto component_size = std::distance(start, end);
+    const std::vector<NodeID> locations(start, end);
+    const unsigned component_size = static_cast<unsigned>(locations.size());
 
-    std::vector<NodeID> perm(start, end);
-    std::vector<NodeID> route;
-    route.reserve(component_size);
+    BOOST_ASSERT_MSG(component_size > 0, "no permutation given");
+    BOOST_ASSERT_MSG(*(std::max_element(std::begin(locations), std::end(locations))) <
+                         number_of_locations,
+                     "invalid node id");
 
-    EdgeWeight min_route_dist = INVALID_EDGE_WEIGHT;
+    if (component_size < 3)
+    {
+        return locations;
+    }
 
-    // check length of all possible permutation of the component ids
+    // distances between the locations of the component in a dense matrix
+    std::vector<EdgeWeight> distances(component_size * component_size);
+    std::vector<unsigned> successors(component_size * (component_size - 1));
+    std::vector<EdgeWeight> min_outgoing(component_size, INVALID_EDGE_WEIGHT);
+    std::vector<EdgeWeight> min_incoming(component_size, INVALID_EDGE_WEIGHT);
+    for (const auto from : osrm::irange(0u, component_size))
+    {
+        const auto first_successor = successors.begin() + from * (component_size - 1);
+        auto successor = first_successor;
+        for (const auto to : osrm::irange(0u, component_size))
+        {
+            distances[from * component_size + to] = dist_table(locations[from], locations[to]);
+            BOOST_ASSERT_MSG(distances[from * component_size + to] != INVALID_EDGE_WEIGHT,
+                             "invalid route found");
+            if (to != from)
+            {
+                *successor++ = to;
+                min_outgoing[from] =
+                    std::min(min_outgoing[from], distances[from * component_size + to]);
+                min_incoming[to] = std::min(min_incoming[to], distances[from * component_size + to]);
+            }
+        }
+        std::stable_sort(first_successor, successor, [&](const unsigned lhs, const unsigned rhs)
+                         {
+                             return distances[from * component_size + lhs] <
+                                    distances[from * component_size + rhs];
+                         });
+    }
 
-    BOOST_ASSERT_MSG(perm.size() > 0, "no permutation given");
-    BOOST_ASSERT_MSG(*(std::max_element(std::begin(perm), std::end(perm))) < number_of_locations,
-                     "invalid node id");
-    BOOST_ASSERT_MSG(*(std::min_element(std::begin(perm), std::end(perm))) >= 0, "invalid node id");
+    // the nearest neighbour trip is the first bound
+    EdgeWeight nearest_neighbour_length = 0;
+    {
+        std::vector<bool> visited(component_size, false);
+        unsigned current = 0;
+        visited[current] = true;
+        for (unsigned i = 1; i < component_size; ++i)
+        {
+            const auto first_successor = successors.begin() + current * (component_size - 1);
+            const unsigned next = *std::find_if(first_successor,
+                                                first_successor + (component_size - 1),
+                                                [&visited](const unsigned location)
+                                                {
+                                                    return !visited[location];
+                                                });
+            nearest_neighbour_length += distances[current * component_size + next];
+            visited[next] = true;
+            current = next;
+        }
+        nearest_neighbour_length += distances[current * component_size];
+    }
+    std::atomic<EdgeWeight> best_length(nearest_neighbour_length);
 
-    do
+    // rotations of a trip are the same trip, so the first location stays in front
+    std::vector<std::vector<unsigned>> prefixes;
+    for (const auto second : osrm::irange(1u, component_size))
     {
-        const auto new_distance = ReturnDistance(dist_table, perm, min_route_dist, component_size);
-        if (new_distance <= min_route_dist)
+        for (const auto third : osrm::irange(1u, component_size))
         {
-            min_route_dist = new_distance;
-            route = perm;
+            if (third != second)
+            {
+                prefixes.push_back({0u, second, third});
+            }
         }
-    } while (std::next_permutation(std::begin(perm), std::end(perm)));
+    }
+
+    std::vector<std::vector<unsigned>> prefix_trips(prefixes.size());
+    std::vector<EdgeWeight> prefix_lengths(prefixes.size(), INVALID_EDGE_WEIGHT);
+    const auto cancellation_token = osrm::cancellation::Current();
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, prefixes.size(), 1),
+                      [&](const tbb::blocked_range<std::size_t> &range)
+                      {
+                          const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                          for (auto i = range.begin(); i != range.end(); ++i)
+                          {
+                              TripBranchAndBound search(distances, successors, min_outgoing,
+                                                        min_incoming, best_length);
+                              prefix_trips[i] = search.Run(prefixes[i]);
+                              prefix_lengths[i] = search.GetLength();
+                          }
+                      });
 
+    // the first of the shortest trips, the nearest neighbour trip is never cut off
+    const auto best_prefix =
+        std::distance(prefix_lengths.begin(),
+                      std::min_element(prefix_lengths.begin(), prefix_lengths.end()));
+    BOOST_ASSERT_MSG(prefix_lengths[best_prefix] == best_length.load(), "no trip found");
+
+    std::vector<NodeID> route;
+    route.reserve(component_size);
+    for (const auto location : prefix_trips[best_prefix])
+    {
+        route.push_back(locations[location]);
+    }
     return route;
 }
 
@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../data_structures/search_engine.hpp"
 #include "../util/dist_table_wrapper.hpp"
+#include "../util/query_cancellation.hpp"
 
 #include <osrm/json_container.hpp>
 #include <boost/assert.hpp>
@@ -63,6 +64,7 @@ GetShortestRoundTrip(const NodeID new_loc,
     // assert min 2 nodes in route
     const auto start = std::begin(route);
     const auto end = std::end(route);
+    const EdgeWeight *distances_from_new_loc = dist_table.GetRow(new_loc);
     for (auto from_node = start; from_node != end; ++from_node)
     {
         auto to_node = std::next(from_node);
@@ -72,7 +74,7 @@ GetShortestRoundTrip(const NodeID new_loc,
         }
 
         const auto dist_from = dist_table(*from_node, new_loc);
-        const auto dist_to = dist_table(new_loc, *to_node);
+        const auto dist_to = distances_from_new_loc[*to_node];
         const auto trip_dist = dist_from + dist_to - dist_table(*from_node, *to_node);
 
         BOOST_ASSERT_MSG(dist_from != INVALID_EDGE_WEIGHT, "distance has invalid edge weight");
@@ -118,6 +120,7 @@ std::vector<NodeID> FindRoute(const std::size_t &number_of_locations,
     // add all other nodes missing (two nodes are already in the initial start trip)
     for (std::size_t j = 2; j < component_size; ++j)
     {
+        osrm::cancellation::Check();
 
         auto farthest_distance = 0;
         auto next_node = -1;
@@ -0,0 +1,325 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef TRIP_LOCAL_SEARCH_HPP
+#define TRIP_LOCAL_SEARCH_HPP
+
+#include "../typedefs.h"
+#include "../util/dist_table_wrapper.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/query_cancellation.hpp"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace osrm
+{
+namespace trip
+{
+
+// number of closest locations that are tried as the new successor of a location
+constexpr unsigned LOCAL_SEARCH_NEIGHBOURS = 8;
+// longest chain of locations that an Or-opt move relocates
+constexpr unsigned OR_OPT_MAX_SEGMENT = 3;
+
+// Improves a round trip with 2-opt and Or-opt moves until none of them shortens it any more or
+// the deadline has passed. The distances of the locations of the trip are copied to a dense
+// matrix first, and every location only tries its closest locations as new successor.
+// Distances need not be symmetric, reversed parts of the trip are priced in their new direction.
+class TripLocalSearch
+{
+    using Clock = std::chrono::steady_clock;
+
+  public:
+    TripLocalSearch(const std::vector<NodeID> &route, const DistTableWrapper<EdgeWeight> &dist_table)
+        : locations(route), size(static_cast<unsigned>(route.size())), distances(size * size)
+    {
+        BOOST_ASSERT(!route.empty());
+        for (const auto from : osrm::irange(0u, size))
+        {
+            for (const auto to : osrm::irange(0u, size))
+            {
+                distances[from * size + to] = dist_table(locations[from], locations[to]);
+            }
+        }
+
+        const unsigned number_of_neighbours = std::min(LOCAL_SEARCH_NEIGHBOURS, size - 1);
+        neighbours.resize(size * number_of_neighbours);
+        std::vector<unsigned> candidates;
+        for (const auto from : osrm::irange(0u, size))
+        {
+            candidates.clear();
+            for (const auto to : osrm::irange(0u, size))
+            {
+                if (to != from)
+                {
+                    candidates.push_back(to);
+                }
+            }
+            std::partial_sort(candidates.begin(), candidates.begin() + number_of_neighbours,
+                              candidates.end(), [this, from](const unsigned lhs, const unsigned rhs)
+                              {
+                                  return Distance(from, lhs) < Distance(from, rhs);
+                              });
+            std::copy(candidates.begin(), candidates.begin() + number_of_neighbours,
+                      neighbours.begin() + from * number_of_neighbours);
+        }
+
+        // the trip is kept in indices into the matrix
+        tour.resize(size);
+        for (const auto i : osrm::irange(0u, size))
+        {
+            tour[i] = i;
+        }
+        position.resize(size);
+        forward_prefix.resize(size + 1);
+        backward_prefix.resize(size + 1);
+        Update();
+    }
+
+    // returns the improved trip, starting at the same location as the given one
+    std::vector<NodeID> Run(const Clock::time_point deadline)
+    {
+        // the moves below need at least two locations outside of the changed part
+        bool improved = size > 4;
+        while (improved && Clock::now() < deadline)
+        {
+            osrm::cancellation::Check();
+            improved = false;
+            for (unsigned i = 0; i < size && Clock::now() < deadline; ++i)
+            {
+                if (TryTwoOpt(i) || TryOrOpt(i))
+                {
+                    improved = true;
+                }
+            }
+        }
+
+        const auto first = std::find(tour.begin(), tour.end(), 0u);
+        std::rotate(tour.begin(), first, tour.end());
+        std::vector<NodeID> route(size);
+        for (const auto i : osrm::irange(0u, size))
+        {
+            route[i] = locations[tour[i]];
+        }
+        return route;
+    }
+
+    std::int64_t GetTripLength() const { return forward_prefix[size]; }
+
+  private:
+    EdgeWeight Distance(const unsigned from, const unsigned to) const
+    {
+        return distances[from * size + to];
+    }
+
+    unsigned Next(const unsigned i) const { return i + 1 == size ? 0 : i + 1; }
+    unsigned Prev(const unsigned i) const { return i == 0 ? size - 1 : i - 1; }
+
+    // number of trip locations from position first to position last, both included
+    unsigned SegmentSize(const unsigned first, const unsigned last) const
+    {
+        return (last + size - first) % size + 1;
+    }
+
+    // length of the trip from position first to position last, in either direction of travel
+    std::int64_t ForwardLength(const unsigned first, const unsigned last) const
+    {
+        return first <= last ? forward_prefix[last] - forward_prefix[first]
+                             : forward_prefix[size] - forward_prefix[first] + forward_prefix[last];
+    }
+    std::int64_t BackwardLength(const unsigned first, const unsigned last) const
+    {
+        return first <= last
+                   ? backward_prefix[last] - backward_prefix[first]
+                   : backward_prefix[size] - backward_prefix[first] + backward_prefix[last];
+    }
+
+    void Update()
+    {
+        forward_prefix[0] = 0;
+        backward_prefix[0] = 0;
+        for (const auto i : osrm::irange(0u, size))
+        {
+            position[tour[i]] = i;
+            forward_prefix[i + 1] = forward_prefix[i] + Distance(tour[i], tour[Next(i)]);
+            backward_prefix[i + 1] = backward_prefix[i] + Distance(tour[Next(i)], tour[i]);
+        }
+    }
+
+    // replaces a->b ... c->d by a->c ... b->d where c is close to a
+    bool TryTwoOpt(const unsigned i)
+    {
+        const unsigned a = tour[i];
+        const unsigned b = tour[Next(i)];
+        const unsigned number_of_neighbours = static_cast<unsigned>(neighbours.size()) / size;
+        for (const auto k : osrm::irange(0u, number_of_neighbours))
+        {
+            const unsigned c = neighbours[a * number_of_neighbours + k];
+            if (Distance(a, c) >= Distance(a, b))
+            {
+                break;
+            }
+            const unsigned first = Next(i);
+            const unsigned last = position[c];
+            // the reversed part has to leave a and d outside of it
+            if (c == b || SegmentSize(first, last) > size - 2)
+            {
+                continue;
+            }
+            const unsigned d = tour[Next(last)];
+            const std::int64_t delta = Distance(a, c) + Distance(b, d) - Distance(a, b) -
+                                       Distance(c, d) + BackwardLength(first, last) -
+                                       ForwardLength(first, last);
+            if (delta < 0)
+            {
+                Reverse(first, last);
+                Update();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // moves the chain of locations starting at position i between two other locations x->y,
+    // either as x->first ... last->y or reversed as x->last ... first->y
+    bool TryOrOpt(const unsigned i)
+    {
+        const unsigned number_of_neighbours = static_cast<unsigned>(neighbours.size()) / size;
+        for (unsigned length = 1; length <= OR_OPT_MAX_SEGMENT && length + 2 < size; ++length)
+        {
+            const unsigned last_position = (i + length - 1) % size;
+            const unsigned first = tour[i];
+            const unsigned last = tour[last_position];
+            const unsigned prev = tour[Prev(i)];
+            const unsigned next = tour[Next(last_position)];
+            const std::int64_t removal_delta =
+                Distance(prev, next) - Distance(prev, first) - Distance(last, next);
+            const std::int64_t reversal_delta =
+                BackwardLength(i, last_position) - ForwardLength(i, last_position);
+
+            for (const bool reversed : {false, true})
+            {
+                // the location that leads into y after the move
+                const unsigned exit = reversed ? first : last;
+                const unsigned entry = reversed ? last : first;
+                for (const auto k : osrm::irange(0u, number_of_neighbours))
+                {
+                    const unsigned y = neighbours[exit * number_of_neighbours + k];
+                    const unsigned x = tour[Prev(position[y])];
+                    if (IsInSegment(position[y], i, length) || IsInSegment(position[x], i, length))
+                    {
+                        continue;
+                    }
+                    const std::int64_t delta = removal_delta + Distance(x, entry) +
+                                               Distance(exit, y) - Distance(x, y) +
+                                               (reversed ? reversal_delta : 0);
+                    if (delta < 0)
+                    {
+                        Move(i, length, x, reversed);
+                        Update();
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    bool IsInSegment(const unsigned p, const unsigned first, const unsigned length) const
+    {
+        return (p + size - first) % size < length;
+    }
+
+    void Reverse(const unsigned first, const unsigned last)
+    {
+        if (first > last)
+        {
+            // rotate the reversed part to the front so it does not wrap around
+            std::rotate(tour.begin(), tour.begin() + first, tour.end());
+            std::reverse(tour.begin(), tour.begin() + SegmentSize(first, last));
+        }
+        else
+        {
+            std::reverse(tour.begin() + first, tour.begin() + last + 1);
+        }
+    }
+
+    void Move(const unsigned first, const unsigned length, const unsigned x, const bool reversed)
+    {
+        std::vector<unsigned> segment(length);
+        for (const auto k : osrm::irange(0u, length))
+        {
+            segment[k] = tour[(first + k) % size];
+        }
+        if (reversed)
+        {
+            std::reverse(segment.begin(), segment.end());
+        }
+
+        std::vector<unsigned> new_tour;
+        new_tour.reserve(size);
+        for (unsigned p = (first + length) % size; p != first; p = Next(p))
+        {
+            new_tour.push_back(tour[p]);
+            if (tour[p] == x)
+            {
+                new_tour.insert(new_tour.end(), segment.begin(), segment.end());
+            }
+        }
+        BOOST_ASSERT(new_tour.size() == size);
+        tour.swap(new_tour);
+    }
+
+    const std::vector<NodeID> locations;
+    const unsigned size;
+    std::vector<EdgeWeight> distances;
+    std::vector<unsigned> neighbours;
+    std::vector<unsigned> tour;
+    std::vector<unsigned> position;
+    std::vector<std::int64_t> forward_prefix;
+    std::vector<std::int64_t> backward_prefix;
+};
+
+// improves the given round trip until the deadline, see TripLocalSearch
+inline std::vector<NodeID>
+ImproveTrip(const std::vector<NodeID> &route,
+            const DistTableWrapper<EdgeWeight> &dist_table,
+            const std::chrono::steady_clock::time_point deadline)
+{
+    return TripLocalSearch(route, dist_table).Run(deadline);
+}
+
+} // end namespace trip
+} // end namespace osrm
+
+#endif // TRIP_LOCAL_SEARCH_HPP
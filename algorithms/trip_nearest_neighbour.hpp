@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/search_engine.hpp"
 #include "../util/simple_logger.hpp"
 #include "../util/dist_table_wrapper.hpp"
+#include "../util/query_cancellation.hpp"
 
 #include <osrm/json_container.hpp>
 
@@ -69,6 +70,7 @@ std::vector<NodeID> NearestNeighbourTrip(const NodeIDIterator &start,
     // ALWAYS START AT ANOTHER STARTING POINT
     for (auto start_node = start; start_node != end; ++start_node)
     {
+        osrm::cancellation::Check();
         NodeID curr_node = *start_node;
 
         std::vector<NodeID> curr_route;
@@ -0,0 +1,535 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "../data_structures/binary_heap.hpp"
+#include "../data_structures/d_ary_heap.hpp"
+#include "../data_structures/dynamic_graph.hpp"
+#include "../data_structures/edge_based_node.hpp"
+#include "../data_structures/query_node.hpp"
+#include "../data_structures/range_table.hpp"
+#include "../data_structures/static_graph.hpp"
+#include "../data_structures/static_rtree.hpp"
+#include "../data_structures/xor_fast_hash_storage.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/simple_logger.hpp"
+#include "../typedefs.h"
+
+#include <osrm/coordinate.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Microbenchmarks of the core data structures on synthetic data: the heap operations, graph
+// traversals, range lookups and r-tree queries. Every benchmark is repeated for at least
+// MIN_BENCHMARK_SECONDS and the best of BENCHMARK_REPETITIONS runs is reported, so that
+// changes to these structures can be compared run against run.
+
+// Choosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 13;
+constexpr double MIN_BENCHMARK_SECONDS = 0.2;
+constexpr unsigned BENCHMARK_REPETITIONS = 3;
+
+constexpr unsigned NUM_HEAP_NODES = 1u << 20;
+// side length of the grid the graphs and the r-tree are built from, a city sized network
+constexpr unsigned GRID_SIZE = 1000;
+constexpr unsigned NUM_NAMES = 1u << 20;
+constexpr unsigned NUM_LOOKUPS = 1u << 20;
+constexpr unsigned NUM_RTREE_QUERIES = 10000;
+// distance of neighboring grid nodes, in degrees (about 100m)
+constexpr double GRID_SPACING = 0.001;
+
+// results of the benchmarked operations end up here, so they can't be optimized away
+volatile std::uint64_t benchmark_sink = 0;
+
+class BenchmarkRunner
+{
+  public:
+    explicit BenchmarkRunner(std::string filter) : filter(std::move(filter)) {}
+
+    // benchmarks whose name doesn't start with the filter are skipped
+    bool Enabled(const std::string &name) const
+    {
+        return 0 == name.compare(0, filter.size(), filter);
+    }
+
+    // whether any benchmark whose name starts with the prefix is run, it saves the setup if not
+    bool EnabledGroup(const std::string &prefix) const
+    {
+        return Enabled(prefix) || 0 == filter.compare(0, prefix.size(), prefix);
+    }
+
+    void Report(const std::string &name, const double nanoseconds_per_item) const
+    {
+        std::cout << std::left << std::setw(44) << name << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(12) << nanoseconds_per_item << " ns/item "
+                  << std::setprecision(0) << std::setw(12) << 1e9 / nanoseconds_per_item
+                  << " items/s"
+                  << "\n";
+    }
+
+    // runs the operation on items_per_run items until the minimum time passed, reports the best
+    // time per item of the repetitions
+    template <typename OperationT>
+    void Run(const std::string &name, const std::uint64_t items_per_run, OperationT operation) const
+    {
+        if (!Enabled(name))
+        {
+            return;
+        }
+
+        double best_nanoseconds = std::numeric_limits<double>::max();
+        for (unsigned repetition = 0; repetition < BENCHMARK_REPETITIONS; ++repetition)
+        {
+            std::uint64_t runs = 0;
+            const auto start = std::chrono::steady_clock::now();
+            auto end = start;
+            do
+            {
+                operation();
+                ++runs;
+                end = std::chrono::steady_clock::now();
+            } while (std::chrono::duration<double>(end - start).count() < MIN_BENCHMARK_SECONDS);
+            best_nanoseconds = std::min(
+                best_nanoseconds, std::chrono::duration<double, std::nano>(end - start).count() /
+                                      (runs * items_per_run));
+        }
+        Report(name, best_nanoseconds);
+    }
+
+  private:
+    const std::string filter;
+};
+
+struct BenchHeapData
+{
+    /* explicit */ BenchHeapData(NodeID p) : parent(p) {}
+    NodeID parent;
+};
+
+// Inserts NUM_HEAP_NODES / 2 random nodes with random keys, decreases the keys of half of them
+// and deletes them all, timing the three phases separately as a search does them interleaved
+template <typename HeapT> void BenchmarkHeap(const BenchmarkRunner &runner, const std::string &name)
+{
+    const std::string insert_name = name + ": insert";
+    const std::string decrease_name = name + ": decrease-key";
+    const std::string delete_name = name + ": delete-min";
+    if (!runner.Enabled(insert_name) && !runner.Enabled(decrease_name) &&
+        !runner.Enabled(delete_name))
+    {
+        return;
+    }
+
+    std::mt19937 mt_rand(RANDOM_SEED);
+    std::vector<NodeID> nodes(NUM_HEAP_NODES);
+    std::iota(nodes.begin(), nodes.end(), 0);
+    std::shuffle(nodes.begin(), nodes.end(), mt_rand);
+    nodes.resize(NUM_HEAP_NODES / 2);
+    std::uniform_int_distribution<int> key_udist(0, 1 << 24);
+    std::vector<int> keys(nodes.size());
+    std::vector<int> decreases(nodes.size() / 2);
+    for (auto &key : keys)
+    {
+        key = key_udist(mt_rand);
+    }
+    for (const auto i : osrm::irange<std::size_t>(0, decreases.size()))
+    {
+        decreases[i] = keys[i] / 2;
+    }
+
+    HeapT heap(NUM_HEAP_NODES);
+    double best_insert = std::numeric_limits<double>::max();
+    double best_decrease = std::numeric_limits<double>::max();
+    double best_delete = std::numeric_limits<double>::max();
+    for (unsigned repetition = 0; repetition < BENCHMARK_REPETITIONS + 1; ++repetition)
+    {
+        heap.Clear();
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto i : osrm::irange<std::size_t>(0, nodes.size()))
+        {
+            heap.Insert(nodes[i], keys[i], nodes[i]);
+        }
+        const auto inserted = std::chrono::steady_clock::now();
+        for (const auto i : osrm::irange<std::size_t>(0, decreases.size()))
+        {
+            heap.DecreaseKey(nodes[i], decreases[i]);
+        }
+        const auto decreased = std::chrono::steady_clock::now();
+        std::uint64_t node_sum = 0;
+        while (!heap.Empty())
+        {
+            node_sum += heap.DeleteMin();
+        }
+        const auto deleted = std::chrono::steady_clock::now();
+        benchmark_sink = node_sum;
+
+        // the first run grows the storage of the heap, osrm-routed reuses warm heaps
+        if (0 == repetition)
+        {
+            continue;
+        }
+        const auto per_item = [](const std::chrono::steady_clock::time_point begin,
+                                 const std::chrono::steady_clock::time_point end,
+                                 const std::size_t items)
+        {
+            return std::chrono::duration<double, std::nano>(end - begin).count() / items;
+        };
+        best_insert = std::min(best_insert, per_item(start, inserted, nodes.size()));
+        best_decrease = std::min(best_decrease, per_item(inserted, decreased, decreases.size()));
+        best_delete = std::min(best_delete, per_item(decreased, deleted, nodes.size()));
+    }
+    if (runner.Enabled(insert_name))
+    {
+        runner.Report(insert_name, best_insert);
+    }
+    if (runner.Enabled(decrease_name))
+    {
+        runner.Report(decrease_name, best_decrease);
+    }
+    if (runner.Enabled(delete_name))
+    {
+        runner.Report(delete_name, best_delete);
+    }
+}
+
+void BenchmarkHeaps(const BenchmarkRunner &runner)
+{
+    using DenseStorage = ArrayStorage<NodeID, int>;
+    using HashStorage = UnorderedMapStorage<NodeID, int>;
+    using OpenAddressingStorage = XORFastHashStorage<NodeID, int, 12>;
+    BenchmarkHeap<BinaryHeap<NodeID, NodeID, int, BenchHeapData, DenseStorage>>(
+        runner, "heap binary, array");
+    BenchmarkHeap<DAryHeap<NodeID, NodeID, int, BenchHeapData, DenseStorage, 4>>(
+        runner, "heap 4-ary, array");
+    BenchmarkHeap<DAryHeap<NodeID, NodeID, int, BenchHeapData, DenseStorage, 8>>(
+        runner, "heap 8-ary, array");
+    BenchmarkHeap<BinaryHeap<NodeID, NodeID, int, BenchHeapData, OpenAddressingStorage>>(
+        runner, "heap binary, open addressing");
+    BenchmarkHeap<BinaryHeap<NodeID, NodeID, int, BenchHeapData, HashStorage>>(
+        runner, "heap binary, hash map");
+}
+
+struct BenchEdgeData
+{
+    BenchEdgeData() : distance(0), id(SPECIAL_EDGEID) {}
+    BenchEdgeData(int distance, EdgeID id) : distance(distance), id(id) {}
+    int distance;
+    EdgeID id;
+};
+
+// The nodes of a GRID_SIZE x GRID_SIZE grid numbered row by row with an edge to each neighbor,
+// sorted by source. The numbering keeps neighbors close in memory as the renumbering of the
+// contractor does.
+template <typename InputEdgeT> std::vector<InputEdgeT> GridEdges()
+{
+    std::mt19937 mt_rand(RANDOM_SEED);
+    std::uniform_int_distribution<int> distance_udist(1, 100);
+    std::vector<InputEdgeT> edges;
+    edges.reserve(4 * GRID_SIZE * GRID_SIZE);
+    for (const auto row : osrm::irange(0u, GRID_SIZE))
+    {
+        for (const auto column : osrm::irange(0u, GRID_SIZE))
+        {
+            const NodeID node = row * GRID_SIZE + column;
+            const auto add_edge = [&](const NodeID target)
+            {
+                edges.emplace_back(node, target, distance_udist(mt_rand),
+                                   static_cast<EdgeID>(edges.size()));
+            };
+            if (row > 0)
+            {
+                add_edge(node - GRID_SIZE);
+            }
+            if (column > 0)
+            {
+                add_edge(node - 1);
+            }
+            if (column + 1 < GRID_SIZE)
+            {
+                add_edge(node + 1);
+            }
+            if (row + 1 < GRID_SIZE)
+            {
+                add_edge(node + GRID_SIZE);
+            }
+        }
+    }
+    return edges;
+}
+
+std::vector<NodeID> RandomNodes(const unsigned number_of_nodes, const unsigned count)
+{
+    std::mt19937 mt_rand(RANDOM_SEED);
+    std::uniform_int_distribution<NodeID> node_udist(0, number_of_nodes - 1);
+    std::vector<NodeID> nodes(count);
+    for (auto &node : nodes)
+    {
+        node = node_udist(mt_rand);
+    }
+    return nodes;
+}
+
+// a scan over all edges, the adjacency of random nodes as a search visits them and edge lookups
+template <typename GraphT>
+void BenchmarkGraph(const BenchmarkRunner &runner, const std::string &name, const GraphT &graph)
+{
+    const unsigned number_of_nodes = graph.GetNumberOfNodes();
+    runner.Run(name + ": scan all edges", graph.GetNumberOfEdges(), [&graph, number_of_nodes]()
+               {
+                   std::uint64_t distance_sum = 0;
+                   for (const auto node : osrm::irange(0u, number_of_nodes))
+                   {
+                       for (const auto edge : graph.GetAdjacentEdgeRange(node))
+                       {
+                           distance_sum += graph.GetEdgeData(edge).distance;
+                       }
+                   }
+                   benchmark_sink = distance_sum;
+               });
+
+    const std::vector<NodeID> random_nodes = RandomNodes(number_of_nodes, NUM_LOOKUPS);
+    runner.Run(name + ": adjacency of random nodes", random_nodes.size(), [&]()
+               {
+                   std::uint64_t target_sum = 0;
+                   for (const auto node : random_nodes)
+                   {
+                       for (const auto edge : graph.GetAdjacentEdgeRange(node))
+                       {
+                           target_sum += graph.GetTarget(edge);
+                       }
+                   }
+                   benchmark_sink = target_sum;
+               });
+    runner.Run(name + ": find edge", random_nodes.size(), [&]()
+               {
+                   std::uint64_t edge_sum = 0;
+                   for (const auto node : random_nodes)
+                   {
+                       edge_sum += graph.FindEdge(node, node + 1 < number_of_nodes ? node + 1
+                                                                                   : node - 1);
+                   }
+                   benchmark_sink = edge_sum;
+               });
+}
+
+void BenchmarkGraphs(const BenchmarkRunner &runner)
+{
+    if (!runner.EnabledGroup("graph"))
+    {
+        return;
+    }
+
+    using BenchStaticGraph = StaticGraph<BenchEdgeData>;
+    using BenchDynamicGraph = DynamicGraph<BenchEdgeData>;
+    const auto static_edges = GridEdges<BenchStaticGraph::InputEdge>();
+    const BenchStaticGraph static_graph(GRID_SIZE * GRID_SIZE, static_edges);
+    BenchmarkGraph(runner, "graph static", static_graph);
+
+    const auto dynamic_edges = GridEdges<BenchDynamicGraph::InputEdge>();
+    const BenchDynamicGraph dynamic_graph(GRID_SIZE * GRID_SIZE, dynamic_edges);
+    BenchmarkGraph(runner, "graph dynamic", dynamic_graph);
+}
+
+// lengths as the ones of street names, the range table stores lengths of up to 255
+void BenchmarkRangeTable(const BenchmarkRunner &runner)
+{
+    if (!runner.EnabledGroup("range table"))
+    {
+        return;
+    }
+
+    std::mt19937 mt_rand(RANDOM_SEED);
+    std::uniform_int_distribution<unsigned> length_udist(0, 40);
+    std::vector<unsigned> lengths(NUM_NAMES);
+    for (auto &length : lengths)
+    {
+        length = length_udist(mt_rand);
+    }
+    const RangeTable<16, false> table(lengths);
+
+    runner.Run("range table: sequential lookups", NUM_NAMES, [&table]()
+               {
+                   std::uint64_t end_sum = 0;
+                   for (const auto id : osrm::irange(0u, NUM_NAMES))
+                   {
+                       end_sum += table.GetRange(id).back();
+                   }
+                   benchmark_sink = end_sum;
+               });
+    const std::vector<NodeID> random_ids = RandomNodes(NUM_NAMES, NUM_LOOKUPS);
+    runner.Run("range table: random lookups", random_ids.size(), [&]()
+               {
+                   std::uint64_t end_sum = 0;
+                   for (const auto id : random_ids)
+                   {
+                       end_sum += table.GetRange(id).back();
+                   }
+                   benchmark_sink = end_sum;
+               });
+}
+
+// An r-tree over the segments of the grid, queried around random segments. rtree-bench runs
+// the same queries against the index of a real dataset.
+void BenchmarkStaticRTree(const BenchmarkRunner &runner)
+{
+    if (!runner.EnabledGroup("r-tree"))
+    {
+        return;
+    }
+
+    using BenchStaticRTree = StaticRTree<EdgeBasedNode>;
+    // the nodes are moved off the grid a little, real roads don't line up
+    std::mt19937 mt_rand(RANDOM_SEED);
+    std::uniform_real_distribution<> jitter_udist(-0.3 * GRID_SPACING, 0.3 * GRID_SPACING);
+    std::vector<QueryNode> nodes;
+    auto coordinates = std::make_shared<std::vector<FixedPointCoordinate>>();
+    for (const auto node : osrm::irange(0u, GRID_SIZE * GRID_SIZE))
+    {
+        const int lat = static_cast<int>(
+            (52. + (node / GRID_SIZE) * GRID_SPACING + jitter_udist(mt_rand)) *
+            COORDINATE_PRECISION);
+        const int lon = static_cast<int>(
+            (13. + (node % GRID_SIZE) * GRID_SPACING + jitter_udist(mt_rand)) *
+            COORDINATE_PRECISION);
+        nodes.emplace_back(lat, lon, node);
+        coordinates->emplace_back(lat, lon);
+    }
+
+    // a segment per pair of neighbors, in both directions
+    std::vector<EdgeBasedNode> segments;
+    for (const auto &edge : GridEdges<StaticGraph<BenchEdgeData>::InputEdge>())
+    {
+        if (edge.source < edge.target)
+        {
+            EdgeBasedNode segment;
+            segment.forward_edge_based_node_id = static_cast<NodeID>(2 * segments.size());
+            segment.reverse_edge_based_node_id = static_cast<NodeID>(2 * segments.size() + 1);
+            segment.u = edge.source;
+            segment.v = edge.target;
+            segment.name_id = 0;
+            segment.forward_weight = edge.data.distance;
+            segment.reverse_weight = edge.data.distance;
+            segment.forward_offset = 0;
+            segment.reverse_offset = 0;
+            segment.packed_geometry_id = SPECIAL_EDGEID;
+            segment.component_id = 0;
+            segment.fwd_segment_position = 0;
+            segment.forward_travel_mode = TRAVEL_MODE_DEFAULT;
+            segment.backward_travel_mode = TRAVEL_MODE_DEFAULT;
+            segments.push_back(segment);
+        }
+    }
+
+    const boost::filesystem::path base_path =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    const std::string ram_path = base_path.string() + ".ramIndex";
+    const std::string file_path = base_path.string() + ".fileIndex";
+    {
+        BenchStaticRTree(segments, ram_path, file_path, nodes);
+    }
+    {
+        BenchStaticRTree rtree(ram_path, file_path, coordinates);
+        std::uniform_int_distribution<std::size_t> segment_udist(0, segments.size() - 1);
+        std::uniform_real_distribution<> ratio_udist(0., 1.);
+        std::vector<FixedPointCoordinate> queries;
+        for (unsigned i = 0; i < NUM_RTREE_QUERIES; ++i)
+        {
+            const EdgeBasedNode &segment = segments[segment_udist(mt_rand)];
+            const FixedPointCoordinate &u = coordinates->at(segment.u);
+            const FixedPointCoordinate &v = coordinates->at(segment.v);
+            const double ratio = ratio_udist(mt_rand);
+            // a little off the road, as GPS positions are
+            queries.emplace_back(static_cast<int>(u.lat + ratio * (v.lat - u.lat) + 10),
+                                 static_cast<int>(u.lon + ratio * (v.lon - u.lon) + 10));
+        }
+
+        runner.Run("r-tree: nearest phantom node", queries.size(), [&]()
+                   {
+                       std::uint64_t node_sum = 0;
+                       for (const auto &query : queries)
+                       {
+                           std::vector<PhantomNode> phantom_nodes;
+                           rtree.IncrementalFindPhantomNodeForCoordinate(query, phantom_nodes, 1);
+                           node_sum += phantom_nodes.size();
+                       }
+                       benchmark_sink = node_sum;
+                   });
+        runner.Run("r-tree: 5 nearest phantom nodes", queries.size(), [&]()
+                   {
+                       std::uint64_t node_sum = 0;
+                       for (const auto &query : queries)
+                       {
+                           std::vector<PhantomNode> phantom_nodes;
+                           rtree.IncrementalFindPhantomNodeForCoordinate(query, phantom_nodes, 5);
+                           node_sum += phantom_nodes.size();
+                       }
+                       benchmark_sink = node_sum;
+                   });
+        runner.Run("r-tree: closest end point", queries.size(), [&]()
+                   {
+                       std::uint64_t lat_sum = 0;
+                       for (const auto &query : queries)
+                       {
+                           FixedPointCoordinate result;
+                           rtree.LocateClosestEndPointForCoordinate(query, result, 18);
+                           lat_sum += result.lat;
+                       }
+                       benchmark_sink = lat_sum;
+                   });
+    }
+    boost::filesystem::remove(ram_path);
+    boost::filesystem::remove(file_path);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 2)
+    {
+        std::cout << "./datastructure-bench [filter]"
+                  << "\n"
+                  << "Only the benchmarks whose name starts with the filter are run, e.g. "
+                     "\"heap\"."
+                  << "\n";
+        return 1;
+    }
+
+    const BenchmarkRunner runner(argc > 1 ? argv[1] : "");
+    BenchmarkHeaps(runner);
+    BenchmarkGraphs(runner);
+    BenchmarkRangeTable(runner);
+    BenchmarkStaticRTree(runner);
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../data_structures/binary_heap.hpp"
+#include "../data_structures/d_ary_heap.hpp"
+#include "../data_structures/query_edge.hpp"
+#include "../data_structures/static_graph.hpp"
+#include "../data_structures/xor_fast_hash_storage.hpp"
+#include "../routing_algorithms/stalling.hpp"
+#include "../util/graph_loader.hpp"
+#include "../util/simple_logger.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Choosen by a fair W20 dice roll (this value is completely arbitrary)
+constexpr unsigned RANDOM_SEED = 13;
+constexpr unsigned NUM_QUERIES = 1000;
+
+using EdgeData = QueryEdge::EdgeData;
+using QueryGraph = StaticGraph<EdgeData>;
+
+struct BenchHeapData
+{
+    NodeID parent;
+    bool stalled;
+    /* explicit */ BenchHeapData(NodeID p) : parent(p), stalled(false) {}
+};
+
+struct HeapOperations
+{
+    uint64_t inserts = 0;
+    uint64_t decreases = 0;
+    uint64_t deletes = 0;
+    uint64_t stalls = 0;
+};
+
+// One direction of the bidirectional search of the routing algorithms, with prefetching it loads
+// the heap slots of the targets and the edges of the next node ahead as SearchEngineData does
+template <typename StallingPolicy, bool prefetch, typename HeapT>
+void RoutingStep(const QueryGraph &graph,
+                 HeapT &heap,
+                 HeapT &other_heap,
+                 const bool forward_direction,
+                 int &upper_bound,
+                 HeapOperations &operations)
+{
+    const NodeID node = heap.DeleteMin();
+    ++operations.deletes;
+    if (prefetch)
+    {
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            heap.Prefetch(graph.GetTarget(edge));
+        }
+        if (!heap.Empty())
+        {
+            graph.PrefetchEdges(heap.Min());
+        }
+    }
+    const int distance = heap.GetKey(node);
+
+    if (other_heap.WasInserted(node))
+    {
+        upper_bound = std::min(upper_bound, distance + other_heap.GetKey(node));
+    }
+    if (distance > upper_bound)
+    {
+        heap.DeleteAll();
+        return;
+    }
+
+    const bool stalled =
+        forward_direction ? StallingPolicy::template Stall<true>(graph, heap, node, distance)
+                          : StallingPolicy::template Stall<false>(graph, heap, node, distance);
+    if (stalled)
+    {
+        ++operations.stalls;
+        return;
+    }
+
+    for (const auto edge : graph.GetAdjacentEdgeRange(node))
+    {
+        const EdgeData &data = graph.GetEdgeData(edge);
+        if (forward_direction ? data.forward : data.backward)
+        {
+            const NodeID to = graph.GetTarget(edge);
+            const int to_distance = distance + data.distance;
+            if (!heap.WasInserted(to))
+            {
+                heap.Insert(to, to_distance, node);
+                ++operations.inserts;
+            }
+            else if (to_distance < heap.GetKey(to))
+            {
+                heap.GetData(to).parent = node;
+                heap.DecreaseKey(to, to_distance);
+                StallingPolicy::Unstall(heap, to);
+                ++operations.decreases;
+            }
+        }
+    }
+}
+
+template <typename StallingPolicy, bool prefetch, typename HeapT>
+int Query(const QueryGraph &graph,
+          HeapT &forward_heap,
+          HeapT &reverse_heap,
+          const NodeID source,
+          const NodeID target,
+          HeapOperations &operations)
+{
+    forward_heap.Clear();
+    reverse_heap.Clear();
+    forward_heap.Insert(source, 0, source);
+    reverse_heap.Insert(target, 0, target);
+    operations.inserts += 2;
+
+    int upper_bound = std::numeric_limits<int>::max();
+    while (!forward_heap.Empty() || !reverse_heap.Empty())
+    {
+        if (!forward_heap.Empty())
+        {
+            RoutingStep<StallingPolicy, prefetch>(graph, forward_heap, reverse_heap, true,
+                                                  upper_bound, operations);
+        }
+        if (!reverse_heap.Empty())
+        {
+            RoutingStep<StallingPolicy, prefetch>(graph, reverse_heap, forward_heap, false,
+                                                  upper_bound, operations);
+        }
+    }
+    return upper_bound;
+}
+
+// Runs all queries with one heap flavour and checks the distances against the first flavour
+template <typename HeapT, typename StallingPolicy = CHStallingPolicy, bool prefetch = false>
+void Benchmark(const std::string &name,
+               const QueryGraph &graph,
+               const std::vector<std::pair<NodeID, NodeID>> &queries,
+               std::vector<int> &distances)
+{
+    HeapT forward_heap(graph.GetNumberOfNodes());
+    HeapT reverse_heap(graph.GetNumberOfNodes());
+    HeapOperations operations;
+
+    // warm up the heaps, their storage is reused between queries as in osrm-routed
+    for (const auto &query : queries)
+    {
+        Query<StallingPolicy, prefetch>(graph, forward_heap, reverse_heap, query.first,
+                                        query.second, operations);
+    }
+
+    operations = HeapOperations();
+    std::vector<int> current_distances;
+    current_distances.reserve(queries.size());
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &query : queries)
+    {
+        current_distances.push_back(
+            Query<StallingPolicy, prefetch>(graph, forward_heap, reverse_heap, query.first,
+                                            query.second, operations));
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    if (distances.empty())
+    {
+        distances = current_distances;
+    }
+    const bool distances_agree = distances == current_distances;
+
+    const double micros = std::chrono::duration<double, std::micro>(end - start).count();
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << micros / queries.size() << "us/query, "
+              << std::setw(8) << operations.inserts / queries.size() << " inserts, "
+              << std::setw(8) << operations.decreases / queries.size() << " decreases, "
+              << std::setw(8) << operations.deletes / queries.size() << " deletes, "
+              << std::setw(8) << operations.stalls / queries.size() << " stalls per query"
+              << (distances_agree ? "" : ", DISTANCES DIFFER") << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    LogPolicy::GetInstance().Unmute();
+    if (argc < 2)
+    {
+        std::cout << "./heap-bench file.hsgr [number of queries]"
+                  << "\n";
+        return 1;
+    }
+
+    std::vector<QueryGraph::NodeArrayEntry> node_list;
+    std::vector<QueryGraph::EdgeArrayEntry> edge_list;
+    unsigned check_sum = 0;
+    const unsigned number_of_nodes =
+        readHSGRFromStream(boost::filesystem::path(argv[1]), node_list, edge_list, &check_sum);
+    const QueryGraph graph(node_list, edge_list);
+
+    const unsigned num_queries = argc > 2 ? std::max(1, std::stoi(argv[2])) : NUM_QUERIES;
+    std::mt19937 mt_rand(RANDOM_SEED);
+    std::uniform_int_distribution<NodeID> node_udist(0, number_of_nodes - 1);
+    std::vector<std::pair<NodeID, NodeID>> queries;
+    for (unsigned i = 0; i < num_queries; ++i)
+    {
+        queries.emplace_back(node_udist(mt_rand), node_udist(mt_rand));
+    }
+    std::cout << "running " << queries.size() << " random queries on " << number_of_nodes
+              << " nodes"
+              << "\n";
+
+    using HashStorage = UnorderedMapStorage<NodeID, int>;
+    using DenseStorage = ArrayStorage<NodeID, int>;
+    using OpenAddressingStorage = XORFastHashStorage<NodeID, int, 12>;
+    std::vector<int> distances;
+    Benchmark<BinaryHeap<NodeID, NodeID, int, BenchHeapData, HashStorage>>(
+        "binary, hash map", graph, queries, distances);
+    Benchmark<DAryHeap<NodeID, NodeID, int, BenchHeapData, HashStorage, 4>>(
+        "4-ary, hash map", graph, queries, distances);
+    Benchmark<DAryHeap<NodeID, NodeID, int, BenchHeapData, HashStorage, 8>>(
+        "8-ary, hash map", graph, queries, distances);
+    Benchmark<BinaryHeap<NodeID, NodeID, int, BenchHeapData, OpenAddressingStorage>>(
+        "binary, open addressing", graph, queries, distances);
+    Benchmark<DAryHeap<NodeID, NodeID, int, BenchHeapData, OpenAddressingStorage, 4>>(
+        "4-ary, open addressing", graph, queries, distances);
+    Benchmark<BinaryHeap<NodeID, NodeID, int, BenchHeapData, DenseStorage>>(
+        "binary, array", graph, queries, distances);
+    Benchmark<DAryHeap<NodeID, NodeID, int, BenchHeapData, DenseStorage, 4>>(
+        "4-ary, array", graph, queries, distances);
+    Benchmark<DAryHeap<NodeID, NodeID, int, BenchHeapData, DenseStorage, 8>>(
+        "8-ary, array", graph, queries, distances);
+
+    // the search space without stalling and with the two stalling policies
+    using DenseHeap = BinaryHeap<NodeID, NodeID, int, BenchHeapData, DenseStorage>;
+    Benchmark<DenseHeap, NoStalling>("binary, array, no stalling", graph, queries, distances);
+    Benchmark<DenseHeap, StallOnSettle>("binary, array, on settle", graph, queries, distances);
+    Benchmark<DenseHeap, StallOnDemand>("binary, array, on demand", graph, queries, distances);
+
+    // memory latency of the heap slots and adjacency arrays, hidden by prefetching
+    Benchmark<DenseHeap, CHStallingPolicy, true>("binary, array, prefetch", graph, queries,
+                                                 distances);
+    Benchmark<DAryHeap<NodeID, NodeID, int, BenchHeapData, DenseStorage, 4>, CHStallingPolicy,
+              true>("4-ary, array, prefetch", graph, queries, distances);
+    Benchmark<BinaryHeap<NodeID, NodeID, int, BenchHeapData, HashStorage>, CHStallingPolicy,
+              true>("binary, hash map, prefetch", graph, queries, distances);
+    Benchmark<BinaryHeap<NodeID, NodeID, int, BenchHeapData, OpenAddressingStorage>,
+              CHStallingPolicy, true>("binary, open addressing, prefetch", graph, queries,
+                                      distances);
+
+    return 0;
+}
@@ -0,0 +1,226 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../data_structures/search_engine_data.hpp"
+#include "../library/osrm.hpp"
+#include "../server/request_log.hpp"
+#include "../util/request_metrics.hpp"
+#include "../util/routed_options.hpp"
+#include "../util/simple_logger.hpp"
+
+#include <osrm/json_container.hpp>
+#include <osrm/libosrm_config.hpp>
+#include <osrm/route_parameters.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every allocation of this process is counted for the thread that makes it, a query is charged
+// with the ones of the thread that runs it. Worker threads of the parallel searches are not.
+namespace
+{
+thread_local std::uint64_t allocation_count = 0;
+thread_local std::uint64_t allocated_bytes = 0;
+}
+
+void *operator new(std::size_t size)
+{
+    ++allocation_count;
+    allocated_bytes += size;
+    if (void *pointer = std::malloc(0 == size ? 1 : size))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+namespace
+{
+struct ServiceStatistics
+{
+    ServiceStatistics() : failed(0), heap_insertions(0), allocations(0), bytes(0) {}
+
+    osrm::metrics::LatencyHistogram latency;
+    std::atomic<std::uint64_t> failed;
+    std::atomic<std::uint64_t> heap_insertions;
+    std::atomic<std::uint64_t> allocations;
+    std::atomic<std::uint64_t> bytes;
+};
+
+void PrintStatistics(const std::map<std::string, std::unique_ptr<ServiceStatistics>> &statistics)
+{
+    std::cout << std::setw(12) << "service" << std::setw(10) << "queries" << std::setw(8)
+              << "failed" << std::setw(10) << "mean us" << std::setw(10) << "p50 us"
+              << std::setw(10) << "p90 us" << std::setw(10) << "p99 us" << std::setw(10)
+              << "max us" << std::setw(14) << "heap nodes/q" << std::setw(10) << "allocs/q"
+              << std::setw(12) << "bytes/q"
+              << "\n";
+    for (const auto &service : statistics)
+    {
+        const auto &values = *service.second;
+        const auto count = values.latency.Count();
+        if (0 == count)
+        {
+            continue;
+        }
+        std::cout << std::setw(12) << service.first << std::setw(10) << count << std::setw(8)
+                  << values.failed.load() << std::setw(10) << std::fixed << std::setprecision(0)
+                  << values.latency.Mean() << std::setw(10) << values.latency.Quantile(0.5)
+                  << std::setw(10) << values.latency.Quantile(0.9) << std::setw(10)
+                  << values.latency.Quantile(0.99) << std::setw(10) << values.latency.Max()
+                  << std::setw(14) << values.heap_insertions.load() / count << std::setw(10)
+                  << values.allocations.load() / count << std::setw(12)
+                  << values.bytes.load() / count << "\n";
+    }
+}
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "./routing-bench <base.osrm | --shared-memory> <request log> [threads] "
+                     "[repetitions]"
+                  << "\n"
+                  << "The request log holds one request per line, either as a plain URL like "
+                     "/viaroute?loc=..&loc=.. or as a line of the access log of osrm-routed."
+                  << "\n";
+        return 1;
+    }
+
+    try
+    {
+        const std::string dataset = argv[1];
+        const unsigned number_of_threads = argc > 3 ? std::max(1, std::stoi(argv[3])) : 1;
+        const unsigned repetitions = argc > 4 ? std::max(1, std::stoi(argv[4])) : 1;
+
+        libosrm_config lib_config;
+        lib_config.use_shared_memory = "--shared-memory" == dataset;
+        if (!lib_config.use_shared_memory)
+        {
+            lib_config.server_paths["base"] = dataset;
+            populate_base_path(lib_config.server_paths);
+        }
+
+        const auto requests = osrm::LoadRequestLog(argv[2]);
+        if (requests.empty())
+        {
+            std::cout << "no requests"
+                      << "\n";
+            return 1;
+        }
+
+        OSRM routing_machine(lib_config);
+
+        std::map<std::string, std::unique_ptr<ServiceStatistics>> statistics;
+        for (const auto &request : requests)
+        {
+            auto &service_statistics = statistics[request.service];
+            if (!service_statistics)
+            {
+                service_statistics.reset(new ServiceStatistics());
+            }
+        }
+
+        const std::size_t number_of_queries = requests.size() * repetitions;
+        std::cout << "replaying " << requests.size() << " requests " << repetitions
+                  << " times on " << number_of_threads << " threads"
+                  << "\n";
+
+        std::atomic<std::size_t> next_query{0};
+        const auto replay = [&]
+        {
+            for (std::size_t query = next_query++; query < number_of_queries;
+                 query = next_query++)
+            {
+                const auto &request = requests[query % requests.size()];
+                auto &service_statistics = *statistics.find(request.service)->second;
+                RouteParameters parameters = request;
+                osrm::json::Object json_result;
+
+                const auto insertions_before = SearchEngineData::GetHeapInsertionsOfThisThread();
+                const auto allocations_before = allocation_count;
+                const auto bytes_before = allocated_bytes;
+                const auto start = std::chrono::steady_clock::now();
+                const int result_code = routing_machine.RunQuery(parameters, json_result);
+                const auto stop = std::chrono::steady_clock::now();
+
+                service_statistics.latency.Record(
+                    std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count());
+                service_statistics.heap_insertions +=
+                    SearchEngineData::GetHeapInsertionsOfThisThread() - insertions_before;
+                service_statistics.allocations += allocation_count - allocations_before;
+                service_statistics.bytes += allocated_bytes - bytes_before;
+                if (200 != result_code)
+                {
+                    ++service_statistics.failed;
+                }
+            }
+        };
+
+        const auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (unsigned thread = 0; thread < number_of_threads; ++thread)
+        {
+            threads.emplace_back(replay);
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        const auto stop = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(stop - start).count();
+
+        std::cout << "ran " << number_of_queries << " queries in " << std::setprecision(3)
+                  << seconds << "s, " << std::fixed << std::setprecision(1)
+                  << number_of_queries / seconds << " queries/s"
+                  << "\n";
+        PrintStatistics(statistics);
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "caught exception: " << e.what();
+        return 1;
+    }
+    return 0;
+}
@@ -25,26 +25,43 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
+// count the leaves every query reads
+#define OSRM_RTREE_LEAF_STATISTICS
+
 #include "../data_structures/original_edge_data.hpp"
 #include "../data_structures/query_node.hpp"
 #include "../data_structures/shared_memory_vector_wrapper.hpp"
 #include "../data_structures/static_rtree.hpp"
 #include "../data_structures/edge_based_node.hpp"
+#include "../util/integer_range.hpp"
 
 #include <osrm/coordinate.hpp>
 
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Choosen by a fair W20 dice roll (this value is completely arbitrary)
 constexpr unsigned RANDOM_SEED = 13;
-constexpr int32_t WORLD_MIN_LAT = -90 * COORDINATE_PRECISION;
-constexpr int32_t WORLD_MAX_LAT = 90 * COORDINATE_PRECISION;
-constexpr int32_t WORLD_MIN_LON = -180 * COORDINATE_PRECISION;
-constexpr int32_t WORLD_MAX_LON = 180 * COORDINATE_PRECISION;
+// spread of the synthetic queries around their road, in degrees (about 30m)
+constexpr double GPS_NOISE = 0.0003;
+constexpr unsigned NUM_SYNTHETIC_QUERIES = 10000;
 
 using RTreeLeaf = EdgeBasedNode;
 using FixedPointCoordinateListPtr = std::shared_ptr<std::vector<FixedPointCoordinate>>;
 using BenchStaticRTree = StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, false>::vector, false>;
+using SharedCoordinateList = ShM<FixedPointCoordinate, true>::vector;
+using SharedBenchStaticRTree = StaticRTree<RTreeLeaf, SharedCoordinateList, true>;
 
 FixedPointCoordinateListPtr LoadCoordinates(const boost::filesystem::path &nodes_file)
 {
@@ -65,106 +82,244 @@ FixedPointCoordinateListPtr LoadCoordinates(const boost::filesystem::path &nodes
     return coords;
 }
 
-void Benchmark(BenchStaticRTree &rtree, unsigned num_queries)
+// Reads one "lat,lon" pair in degrees per line, e.g. exported from GPS logs. Lines that do not
+// parse, like a header, are skipped.
+std::vector<FixedPointCoordinate> LoadTrace(const boost::filesystem::path &trace_file)
+{
+    boost::filesystem::ifstream trace_stream(trace_file);
+    std::vector<FixedPointCoordinate> queries;
+    std::string line;
+    while (std::getline(trace_stream, line))
+    {
+        double lat = 0, lon = 0;
+        if (2 == std::sscanf(line.c_str(), "%lf,%lf", &lat, &lon) && -90 <= lat && lat <= 90 &&
+            -180 <= lon && lon <= 180)
+        {
+            queries.emplace_back(static_cast<int>(lat * COORDINATE_PRECISION),
+                                 static_cast<int>(lon * COORDINATE_PRECISION));
+        }
+    }
+    return queries;
+}
+
+// Points close to random road segments, a stand-in for a trace. Uniformly random points would
+// mostly fall into empty areas, where the queries behave nothing like the real ones.
+std::vector<FixedPointCoordinate> SampleQueries(const std::vector<RTreeLeaf> &elements,
+                                                const std::vector<FixedPointCoordinate> &coords,
+                                                const unsigned num_queries)
 {
     std::mt19937 mt_rand(RANDOM_SEED);
-    std::uniform_int_distribution<> lat_udist(WORLD_MIN_LAT, WORLD_MAX_LAT);
-    std::uniform_int_distribution<> lon_udist(WORLD_MIN_LON, WORLD_MAX_LON);
+    std::uniform_int_distribution<std::size_t> element_udist(0, elements.size() - 1);
+    std::uniform_real_distribution<> ratio_udist(0., 1.);
+    std::normal_distribution<> noise_dist(0., GPS_NOISE * COORDINATE_PRECISION);
     std::vector<FixedPointCoordinate> queries;
-    for (unsigned i = 0; i < num_queries; i++)
+    queries.reserve(num_queries);
+    for (unsigned i = 0; i < num_queries; ++i)
     {
-        queries.emplace_back(FixedPointCoordinate(lat_udist(mt_rand), lon_udist(mt_rand)));
+        const RTreeLeaf &element = elements[element_udist(mt_rand)];
+        const FixedPointCoordinate &u = coords[element.u];
+        const FixedPointCoordinate &v = coords[element.v];
+        const double ratio = ratio_udist(mt_rand);
+        const double lat = u.lat + ratio * (v.lat - u.lat) + noise_dist(mt_rand);
+        const double lon = u.lon + ratio * (v.lon - u.lon) + noise_dist(mt_rand);
+        queries.emplace_back(
+            static_cast<int>(std::max(-90. * COORDINATE_PRECISION,
+                                      std::min(90. * COORDINATE_PRECISION, lat))),
+            static_cast<int>(std::max(-180. * COORDINATE_PRECISION,
+                                      std::min(180. * COORDINATE_PRECISION, lon))));
     }
+    return queries;
+}
+
+double Percentile(const std::vector<double> &sorted_values, const double percentile)
+{
+    const std::size_t index =
+        std::min(sorted_values.size() - 1,
+                 static_cast<std::size_t>(percentile / 100. * sorted_values.size()));
+    return sorted_values[index];
+}
 
+// Runs every query once, spread over 1, 2, 4, .. max_threads threads, and reports the throughput,
+// the latency percentiles and the leaves read per query for each thread count
+template <typename RTreeT, typename QueryT>
+void RunQueries(const std::string &name,
+                const std::vector<FixedPointCoordinate> &queries,
+                const unsigned max_threads,
+                QueryT query)
+{
+    std::cout << "#### " << name << "\n";
+    std::vector<unsigned> thread_counts;
+    for (unsigned num_threads = 1; num_threads < max_threads; num_threads *= 2)
     {
-        const unsigned num_results = 5;
-        std::cout << "#### IncrementalFindPhantomNodeForCoordinate : " << num_results
-                  << " phantom nodes"
-                  << "\n";
+        thread_counts.push_back(num_threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    for (const unsigned num_threads : thread_counts)
+    {
+        std::vector<std::vector<double>> thread_latencies(num_threads);
+        std::vector<uint64_t> thread_leaf_loads(num_threads, 0);
+        std::vector<std::thread> threads;
 
-        TIMER_START(query_phantom);
-        std::vector<PhantomNode> phantom_node_vector;
-        for (const auto &q : queries)
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto thread_id : osrm::irange(0u, num_threads))
         {
-            phantom_node_vector.clear();
-            rtree.IncrementalFindPhantomNodeForCoordinate(q, phantom_node_vector, 3, num_results);
-            phantom_node_vector.clear();
-            rtree.IncrementalFindPhantomNodeForCoordinate(q, phantom_node_vector, 17, num_results);
+            threads.emplace_back([&, thread_id]()
+                                 {
+                                     RTreeT::LeafLoadCount() = 0;
+                                     auto &latencies = thread_latencies[thread_id];
+                                     for (std::size_t i = thread_id; i < queries.size();
+                                          i += num_threads)
+                                     {
+                                         const auto query_start = std::chrono::steady_clock::now();
+                                         query(queries[i]);
+                                         const auto query_end = std::chrono::steady_clock::now();
+                                         latencies.push_back(
+                                             std::chrono::duration<double, std::micro>(
+                                                 query_end - query_start).count());
+                                     }
+                                     thread_leaf_loads[thread_id] = RTreeT::LeafLoadCount();
+                                 });
         }
-        TIMER_STOP(query_phantom);
-
-        std::cout << "Took " << TIMER_MSEC(query_phantom) << " msec for " << num_queries
-                  << " queries."
-                  << "\n";
-        std::cout << TIMER_MSEC(query_phantom) / ((double)num_queries) << " msec/query."
-                  << "\n";
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        const auto end = std::chrono::steady_clock::now();
 
-        std::cout << "#### LocateClosestEndPointForCoordinate"
+        std::vector<double> latencies;
+        latencies.reserve(queries.size());
+        for (const auto &current_latencies : thread_latencies)
+        {
+            latencies.insert(latencies.end(), current_latencies.begin(), current_latencies.end());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        uint64_t leaf_loads = 0;
+        for (const auto current_leaf_loads : thread_leaf_loads)
+        {
+            leaf_loads += current_leaf_loads;
+        }
+        const double seconds = std::chrono::duration<double>(end - start).count();
+
+        std::cout << std::fixed << std::setprecision(1) << std::setw(3) << num_threads
+                  << " threads: " << std::setw(10) << queries.size() / seconds << " queries/s, "
+                  << "p50 " << Percentile(latencies, 50) << "us, "
+                  << "p90 " << Percentile(latencies, 90) << "us, "
+                  << "p99 " << Percentile(latencies, 99) << "us, "
+                  << "max " << latencies.back() << "us, " << std::setprecision(2)
+                  << leaf_loads / static_cast<double>(queries.size()) << " leaves/query"
                   << "\n";
     }
+}
 
-    TIMER_START(query_endpoint);
-    FixedPointCoordinate result;
-    for (const auto &q : queries)
-    {
-        rtree.LocateClosestEndPointForCoordinate(q, result, 3);
-    }
-    TIMER_STOP(query_endpoint);
+template <typename RTreeT>
+void Benchmark(RTreeT &rtree,
+               const std::vector<FixedPointCoordinate> &queries,
+               const unsigned max_threads)
+{
+    RunQueries<RTreeT>("IncrementalFindPhantomNodeForCoordinate : 1 phantom node", queries,
+                       max_threads, [&rtree](const FixedPointCoordinate &q)
+                       {
+                           std::vector<PhantomNode> phantom_node_vector;
+                           rtree.IncrementalFindPhantomNodeForCoordinate(q, phantom_node_vector,
+                                                                         1);
+                       });
+    RunQueries<RTreeT>("IncrementalFindPhantomNodeForCoordinate : 5 phantom nodes", queries,
+                       max_threads, [&rtree](const FixedPointCoordinate &q)
+                       {
+                           std::vector<PhantomNode> phantom_node_vector;
+                           rtree.IncrementalFindPhantomNodeForCoordinate(q, phantom_node_vector,
+                                                                         5);
+                       });
+    RunQueries<RTreeT>("IncrementalFindPhantomNodeForCoordinateWithDistance : 50m", queries,
+                       max_threads, [&rtree](const FixedPointCoordinate &q)
+                       {
+                           std::vector<std::pair<PhantomNode, double>> phantom_node_vector;
+                           rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(
+                               q, phantom_node_vector, 50.);
+                       });
+    RunQueries<RTreeT>("LocateClosestEndPointForCoordinate", queries, max_threads,
+                       [&rtree](const FixedPointCoordinate &q)
+                       {
+                           FixedPointCoordinate result;
+                           rtree.LocateClosestEndPointForCoordinate(q, result, 18);
+                       });
+    RunQueries<RTreeT>("FindPhantomNodeForCoordinate", queries, max_threads,
+                       [&rtree](const FixedPointCoordinate &q)
+                       {
+                           PhantomNode phantom;
+                           rtree.FindPhantomNodeForCoordinate(q, phantom, 18);
+                       });
+}
 
-    std::cout << "Took " << TIMER_MSEC(query_endpoint) << " msec for " << num_queries << " queries."
-              << "\n";
-    std::cout << TIMER_MSEC(query_endpoint) / ((double)num_queries) << " msec/query."
-              << "\n";
+// Builds the segments of the loaded index into a tree of another layout and benchmarks that
+template <uint32_t BRANCHING_FACTOR, uint32_t LEAF_NODE_SIZE>
+void BenchmarkLayout(const std::vector<RTreeLeaf> &elements,
+                     const FixedPointCoordinateListPtr &coords,
+                     const std::vector<FixedPointCoordinate> &queries,
+                     const unsigned max_threads)
+{
+    using LayoutStaticRTree = StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, false>::vector,
+                                          false, BRANCHING_FACTOR, LEAF_NODE_SIZE>;
 
-    std::cout << "#### FindPhantomNodeForCoordinate"
+    std::cout << "### branching factor " << BRANCHING_FACTOR << ", leaf size " << LEAF_NODE_SIZE
+              << ", " << sizeof(typename LayoutStaticRTree::TreeNode) << " bytes per tree node"
               << "\n";
 
-    TIMER_START(query_node);
-    for (const auto &q : queries)
+    std::vector<QueryNode> nodes;
+    nodes.reserve(coords->size());
+    for (unsigned i = 0; i < coords->size(); ++i)
     {
-        PhantomNode phantom;
-        rtree.FindPhantomNodeForCoordinate(q, phantom, 3);
+        nodes.emplace_back(coords->at(i).lat, coords->at(i).lon, i);
     }
-    TIMER_STOP(query_node);
-
-    std::cout << "Took " << TIMER_MSEC(query_node) << " msec for " << num_queries << " queries."
-              << "\n";
-    std::cout << TIMER_MSEC(query_node) / ((double)num_queries) << " msec/query."
-              << "\n";
 
+    const boost::filesystem::path base_path =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    const std::string ram_path = base_path.string() + ".ramIndex";
+    const std::string file_path = base_path.string() + ".fileIndex";
     {
-        const unsigned num_results = 1;
-        std::cout << "#### IncrementalFindPhantomNodeForCoordinate : " << num_results
-                  << " phantom nodes"
-                  << "\n";
+        LayoutStaticRTree(elements, ram_path, file_path, nodes);
+    }
+    {
+        LayoutStaticRTree rtree(ram_path, file_path, coords);
+        Benchmark(rtree, queries, max_threads);
+    }
+    boost::filesystem::remove(ram_path);
+    boost::filesystem::remove(file_path);
+}
 
-        TIMER_START(query_phantom);
-        std::vector<PhantomNode> phantom_node_vector;
-        for (const auto &q : queries)
-        {
-            phantom_node_vector.clear();
-            rtree.IncrementalFindPhantomNodeForCoordinate(q, phantom_node_vector, 3, num_results);
-            phantom_node_vector.clear();
-            rtree.IncrementalFindPhantomNodeForCoordinate(q, phantom_node_vector, 17, num_results);
-        }
-        TIMER_STOP(query_phantom);
+// Same index through the shared memory flavour of the tree that osrm-routed -s uses. The blocks
+// live on the heap here, osrm-datastore places them in a shared memory region.
+void BenchmarkSharedMemory(const boost::filesystem::path &ram_path,
+                           const boost::filesystem::path &file_path,
+                           const FixedPointCoordinateListPtr &coords,
+                           const std::vector<FixedPointCoordinate> &queries,
+                           const unsigned max_threads)
+{
+    std::cout << "### shared memory r-tree"
+              << "\n";
 
-        std::cout << "Took " << TIMER_MSEC(query_phantom) << " msec for " << num_queries
-                  << " queries."
-                  << "\n";
-        std::cout << TIMER_MSEC(query_phantom) / ((double)num_queries) << " msec/query."
-                  << "\n";
+    boost::filesystem::ifstream tree_node_file(ram_path, std::ios::binary);
+    uint32_t tree_size = 0;
+    tree_node_file.read((char *)&tree_size, sizeof(uint32_t));
+    std::vector<SharedBenchStaticRTree::TreeNode> tree_nodes(tree_size);
+    tree_node_file.read((char *)tree_nodes.data(),
+                        sizeof(SharedBenchStaticRTree::TreeNode) * tree_size);
 
-        std::cout << "#### LocateClosestEndPointForCoordinate"
-                  << "\n";
-    }
+    auto shared_coords = std::make_shared<SharedCoordinateList>(coords->data(), coords->size());
+    SharedBenchStaticRTree rtree(tree_nodes.data(), tree_nodes.size(), file_path, shared_coords);
+    Benchmark(rtree, queries, max_threads);
 }
 
 int main(int argc, char **argv)
 {
     if (argc < 4)
     {
-        std::cout << "./rtree-bench file.ramIndex file.fileIndx file.nodes"
+        std::cout << "./rtree-bench file.ramIndex file.fileIndex file.nodes [max threads] "
+                     "[trace file]"
+                  << "\n"
+                  << "The trace file holds one lat,lon pair per line, without it the queries "
+                     "are sampled around random road segments."
                   << "\n";
         return 1;
     }
@@ -172,12 +327,37 @@ int main(int argc, char **argv)
     const char *ramPath = argv[1];
     const char *filePath = argv[2];
     const char *nodesPath = argv[3];
+    const unsigned max_threads =
+        argc > 4 ? std::max(1, std::stoi(argv[4]))
+                 : std::max(1u, std::thread::hardware_concurrency());
 
     auto coords = LoadCoordinates(nodesPath);
 
     BenchStaticRTree rtree(ramPath, filePath, coords);
+    const auto elements = rtree.GetElements();
+
+    const auto queries =
+        argc > 5 ? LoadTrace(argv[5]) : SampleQueries(elements, *coords, NUM_SYNTHETIC_QUERIES);
+    if (queries.empty())
+    {
+        std::cout << "no queries"
+                  << "\n";
+        return 1;
+    }
+    std::cout << "running " << queries.size() << " queries on up to " << max_threads
+              << " threads"
+              << "\n";
+
+    std::cout << "### layout of the given index, "
+              << sizeof(BenchStaticRTree::TreeNode) << " bytes per tree node"
+              << "\n";
+    Benchmark(rtree, queries, max_threads);
+
+    BenchmarkSharedMemory(ramPath, filePath, coords, queries, max_threads);
 
-    Benchmark(rtree, 10000);
+    BenchmarkLayout<64, 256>(elements, coords, queries, max_threads);
+    BenchmarkLayout<32, 128>(elements, coords, queries, max_threads);
+    BenchmarkLayout<16, 64>(elements, coords, queries, max_threads);
 
     return 0;
 }
@@ -35,9 +35,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/query_edge.hpp"
 #include "../data_structures/xor_fast_hash.hpp"
 #include "../data_structures/xor_fast_hash_storage.hpp"
+#include "../util/fingerprint.hpp"
 #include "../util/integer_range.hpp"
+#include "../util/json_renderer.hpp"
+#include "../util/osrm_exception.hpp"
 #include "../util/simple_logger.hpp"
 #include "../util/timing_util.hpp"
+#include "../util/trace.hpp"
 #include "../typedefs.h"
 
 #include <boost/assert.hpp>
@@ -49,8 +53,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <tbb/parallel_sort.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <limits>
 #include <memory>
+#include <string>
 #include <vector>
 
 class Contractor
@@ -60,8 +69,8 @@ class Contractor
     struct ContractorEdgeData
     {
         ContractorEdgeData()
-            : distance(0), id(0), originalEdges(0), shortcut(0), forward(0), backward(0),
-              is_original_via_node_ID(false)
+            : distance(0), id(0), length(0), originalEdges(0), shortcut(0), forward(0),
+              backward(0), is_original_via_node_ID(false)
         {
         }
         ContractorEdgeData(unsigned distance,
@@ -69,14 +78,17 @@ class Contractor
                            unsigned id,
                            bool shortcut,
                            bool forward,
-                           bool backward)
-            : distance(distance), id(id),
+                           bool backward,
+                           unsigned length)
+            : distance(distance), id(id), length(length),
               originalEdges(std::min((unsigned)1 << 28, original_edges)), shortcut(shortcut),
               forward(forward), backward(backward), is_original_via_node_ID(false)
         {
         }
         unsigned distance;
         unsigned id;
+        // in decimeters, shortcuts sum up the lengths of their edges
+        unsigned length;
         unsigned originalEdges : 28;
         bool shortcut : 1;
         bool forward : 1;
@@ -93,19 +105,74 @@ class Contractor
     };
 
     using ContractorGraph = DynamicGraph<ContractorEdgeData>;
-    //    using ContractorHeap = BinaryHeap<NodeID, NodeID, int, ContractorHeapData,
-    //    ArrayStorage<NodeID, NodeID>
-    //    >;
+
+    // Indexes the witness heaps either through a hash table or densely by node id. The witness
+    // searches settle few nodes, the table starts small enough for the cache and grows if needed.
+    // The dense array takes memory in the order of the graph per thread, but has no collisions.
+    // It is not cleared between searches, the heap rejects positions that do not point back to
+    // their node.
+    class WitnessHeapStorage
+    {
+      public:
+        WitnessHeapStorage(const std::size_t number_of_nodes, const bool dense)
+            : dense(dense), array_storage(dense ? number_of_nodes : 0),
+              hash_storage(number_of_nodes)
+        {
+        }
+
+        NodeID &operator[](const NodeID node)
+        {
+            return dense ? array_storage[node] : hash_storage[node];
+        }
+
+        NodeID peek_index(const NodeID node) const
+        {
+            return dense ? array_storage.peek_index(node) : hash_storage.peek_index(node);
+        }
+
+        void Clear()
+        {
+            if (!dense)
+            {
+                hash_storage.Clear();
+            }
+        }
+
+      private:
+        bool dense;
+        ArrayStorage<NodeID, NodeID> array_storage;
+        XORFastHashStorage<NodeID, NodeID, 12> hash_storage;
+    };
+
     using ContractorHeap =
-        BinaryHeap<NodeID, NodeID, int, ContractorHeapData, XORFastHashStorage<NodeID, NodeID>>;
+        BinaryHeap<NodeID, NodeID, int, ContractorHeapData, WitnessHeapStorage>;
     using ContractorEdge = ContractorGraph::InputEdge;
 
+    struct WitnessSearchStats
+    {
+        WitnessSearchStats() : searches(0), settled_nodes(0), aborted_searches(0) {}
+
+        void operator+=(const WitnessSearchStats &other)
+        {
+            searches += other.searches;
+            settled_nodes += other.settled_nodes;
+            aborted_searches += other.aborted_searches;
+        }
+
+        std::uint64_t searches;
+        std::uint64_t settled_nodes;
+        // searches that hit the settled node limit
+        std::uint64_t aborted_searches;
+    };
+
     struct ContractorThreadData
     {
         ContractorHeap heap;
         std::vector<ContractorEdge> inserted_edges;
         std::vector<NodeID> neighbours;
-        explicit ContractorThreadData(NodeID nodes) : heap(nodes) {}
+        WitnessSearchStats simulation_stats;
+        WitnessSearchStats contraction_stats;
+        ContractorThreadData(NodeID nodes, const bool dense_heap) : heap(nodes, dense_heap) {}
     };
 
     struct NodePriorityData
@@ -136,7 +203,10 @@ class Contractor
 
     struct ThreadDataContainer
     {
-        explicit ThreadDataContainer(int number_of_nodes) : number_of_nodes(number_of_nodes) {}
+        ThreadDataContainer(int number_of_nodes, const bool dense_heaps)
+            : number_of_nodes(number_of_nodes), dense_heaps(dense_heaps)
+        {
+        }
 
         inline ContractorThreadData *getThreadData()
         {
@@ -144,20 +214,58 @@ class Contractor
             auto &ref = data.local(exists);
             if (!exists)
             {
-                ref = std::make_shared<ContractorThreadData>(number_of_nodes);
+                ref = std::make_shared<ContractorThreadData>(number_of_nodes, dense_heaps);
             }
 
             return ref.get();
         }
 
+        // sums up and resets the witness search statistics of all threads
+        void CollectStats(WitnessSearchStats &simulation_stats,
+                          WitnessSearchStats &contraction_stats)
+        {
+            for (auto &thread_data : data)
+            {
+                simulation_stats += thread_data->simulation_stats;
+                contraction_stats += thread_data->contraction_stats;
+                thread_data->simulation_stats = WitnessSearchStats();
+                thread_data->contraction_stats = WitnessSearchStats();
+            }
+        }
+
         int number_of_nodes;
+        bool dense_heaps;
         using EnumerableThreadData =
             tbb::enumerable_thread_specific<std::shared_ptr<ContractorThreadData>>;
         EnumerableThreadData data;
     };
 
   public:
-    template <class ContainerT> Contractor(int nodes, ContainerT &input_edge_list)
+    struct WitnessSearchConfig
+    {
+        WitnessSearchConfig()
+            : simulation_limit(1000), contraction_limit(2000), dense_heaps(false),
+              log_statistics(false)
+        {
+        }
+
+        // Settled nodes after which a witness search gives up. Higher limits find more witnesses
+        // and thus fewer shortcuts, but take longer.
+        unsigned simulation_limit;
+        unsigned contraction_limit;
+        // index the heaps by node id instead of hashing, see WitnessHeapStorage
+        bool dense_heaps;
+        // log the witness search work of every contraction round
+        bool log_statistics;
+    };
+
+    // A customizable hierarchy keeps the two directions of every edge apart, so that osrm-customize
+    // can assign them different weights later on.
+    template <class ContainerT>
+    Contractor(int nodes, ContainerT &input_edge_list, const bool customizable = false)
+        : customizable(customizable), stream_contracted_edges(false),
+          lazy_priority_updates(false), checkpoint_interval(0), resume_from_checkpoint(false),
+          input_edges(0)
     {
         std::vector<ContractorEdge> edges;
         edges.reserve(input_edge_list.size() * 2);
@@ -180,12 +288,12 @@ class Contractor
             edges.emplace_back(diter->source, diter->target,
                                static_cast<unsigned int>(std::max(diter->weight, 1)), 1,
                                diter->edge_id, false, diter->forward ? true : false,
-                               diter->backward ? true : false);
+                               diter->backward ? true : false, diter->length);
 
             edges.emplace_back(diter->target, diter->source,
                                static_cast<unsigned int>(std::max(diter->weight, 1)), 1,
                                diter->edge_id, false, diter->backward ? true : false,
-                               diter->forward ? true : false);
+                               diter->forward ? true : false, diter->length);
         }
         // clear input vector
         input_edge_list.clear();
@@ -219,20 +327,23 @@ class Contractor
             // remove parallel edges
             while (i < edges.size() && edges[i].source == source && edges[i].target == target)
             {
-                if (edges[i].data.forward)
+                if (edges[i].data.forward && edges[i].data.distance < forward_edge.data.distance)
                 {
-                    forward_edge.data.distance =
-                        std::min(edges[i].data.distance, forward_edge.data.distance);
+                    forward_edge.data.distance = edges[i].data.distance;
+                    forward_edge.data.length = edges[i].data.length;
+                    forward_edge.data.id = edges[i].data.id;
                 }
-                if (edges[i].data.backward)
+                if (edges[i].data.backward && edges[i].data.distance < reverse_edge.data.distance)
                 {
-                    reverse_edge.data.distance =
-                        std::min(edges[i].data.distance, reverse_edge.data.distance);
+                    reverse_edge.data.distance = edges[i].data.distance;
+                    reverse_edge.data.length = edges[i].data.length;
+                    reverse_edge.data.id = edges[i].data.id;
                 }
                 ++i;
             }
             // merge edges (s,t) and (t,s) into bidirectional edge
-            if (forward_edge.data.distance == reverse_edge.data.distance)
+            if (!customizable && forward_edge.data.distance == reverse_edge.data.distance &&
+                forward_edge.data.length == reverse_edge.data.length)
             {
                 if ((int)forward_edge.data.distance != std::numeric_limits<int>::max())
                 {
@@ -256,6 +367,7 @@ class Contractor
                   << std::endl;
         edges.resize(edge);
         contractor_graph = std::make_shared<ContractorGraph>(nodes, edges);
+        input_edges = contractor_graph->GetNumberOfEdges();
         edges.clear();
         edges.shrink_to_fit();
 
@@ -298,53 +410,123 @@ class Contractor
         constexpr size_t ContractGrainSize = 1;
         constexpr size_t NeighboursGrainSize = 1;
         constexpr size_t DeleteGrainSize = 1;
+        // compact the edge list once it holds this many slots per edge
+        constexpr float MaxEdgeStorageOverhead = 1.5f;
 
         const NodeID number_of_nodes = contractor_graph->GetNumberOfNodes();
         Percent p(number_of_nodes);
+        TIMER_START(contraction);
+        osrm::json::Array report_rounds;
 
-        ThreadDataContainer thread_data_list(number_of_nodes);
+        ThreadDataContainer thread_data_list(number_of_nodes, witness_config.dense_heaps);
+        WitnessSearchStats total_simulation_stats;
+        WitnessSearchStats total_contraction_stats;
+        unsigned round = 0;
 
         NodeID number_of_contracted_nodes = 0;
         std::vector<RemainingNodeData> remaining_nodes(number_of_nodes);
         std::vector<float> node_priorities(number_of_nodes);
         std::vector<NodePriorityData> node_data(number_of_nodes);
         is_core_node.resize(number_of_nodes, false);
+        // nodes whose neighbourhood changed since their priority was evaluated
+        std::vector<char> is_stale(number_of_nodes, false);
+
+        // The levels of a previous run replace the priorities. Nodes of the same level were
+        // independent back then, so the independent sets only have to settle the few conflicts
+        // that different shortcuts cause. The core of that run is kept as well.
+        const bool use_cached_levels = !node_levels.empty();
+        BOOST_ASSERT(!use_cached_levels || node_levels.size() == number_of_nodes);
+        // cached levels do not change with the remaining graph
+        const bool lazy_updates = lazy_priority_updates && !use_cached_levels;
+        // the boundary nodes of a partition wait at the core level until the interior of all
+        // regions is contracted, see SetBoundaryNodes
+        bool defer_boundary_nodes = !is_boundary_node.empty() && !use_cached_levels;
+        BOOST_ASSERT(!defer_boundary_nodes || is_boundary_node.size() == number_of_nodes);
+        float current_level = 0;
+        bool flushed_contractor = false;
 
-        // initialize priorities in parallel
-        tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, InitGrainSize),
-                          [&remaining_nodes](const tbb::blocked_range<int> &range)
-                          {
-                              for (int x = range.begin(), end = range.end(); x != end; ++x)
+        CheckpointHeader checkpoint;
+        if (resume_from_checkpoint &&
+            ReadCheckpoint(number_of_nodes, use_cached_levels, checkpoint, remaining_nodes,
+                           node_priorities, node_data, is_stale))
+        {
+            number_of_contracted_nodes = static_cast<NodeID>(checkpoint.contracted_nodes);
+            current_level = checkpoint.current_level;
+            round = checkpoint.round;
+            flushed_contractor = checkpoint.flushed_contractor;
+            defer_boundary_nodes = checkpoint.defer_boundary_nodes;
+            total_simulation_stats = checkpoint.simulation_stats;
+            total_contraction_stats = checkpoint.contraction_stats;
+            if (use_cached_levels)
+            {
+                core_factor = 1.0;
+            }
+            // no thread data exists yet, the heaps are created for the remaining graph
+            thread_data_list.number_of_nodes = contractor_graph->GetNumberOfNodes();
+            SimpleLogger().Write() << "resuming the contraction after round " << round << " with "
+                                   << remaining_nodes.size() << " remaining nodes";
+        }
+        else
+        {
+            if (use_cached_levels)
+            {
+                node_priorities = node_levels;
+                core_factor = 1.0;
+            }
+            const float core_level = CORE_LEVEL;
+            node_levels.assign(number_of_nodes, core_level);
+            // initialize priorities in parallel
+            tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, InitGrainSize),
+                              [&remaining_nodes](const tbb::blocked_range<int> &range)
                               {
-                                  remaining_nodes[x].id = x;
-                              }
-                          });
+                                  for (int x = range.begin(), end = range.end(); x != end; ++x)
+                                  {
+                                      remaining_nodes[x].id = x;
+                                  }
+                              });
 
-        std::cout << "initializing elimination PQ ..." << std::flush;
-        tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, PQGrainSize),
-                          [this, &node_priorities, &node_data, &thread_data_list](
-                              const tbb::blocked_range<int> &range)
-                          {
-                              ContractorThreadData *data = thread_data_list.getThreadData();
-                              for (int x = range.begin(), end = range.end(); x != end; ++x)
-                              {
-                                  node_priorities[x] =
-                                      this->EvaluateNodePriority(data, &node_data[x], x);
-                              }
-                          });
-        std::cout << "ok" << std::endl
-                  << "preprocessing " << number_of_nodes << " nodes ..." << std::flush;
+            if (!use_cached_levels)
+            {
+                std::cout << "initializing elimination PQ ..." << std::flush;
+                tbb::parallel_for(tbb::blocked_range<int>(0, number_of_nodes, PQGrainSize),
+                                  [this, &node_priorities, &node_data, &thread_data_list](
+                                      const tbb::blocked_range<int> &range)
+                                  {
+                                      ContractorThreadData *data = thread_data_list.getThreadData();
+                                      for (int x = range.begin(), end = range.end(); x != end; ++x)
+                                      {
+                                          node_priorities[x] =
+                                              this->EvaluateNodePriority(data, &node_data[x], x);
+                                      }
+                                  });
+            }
+            if (defer_boundary_nodes)
+            {
+                for (const auto x : osrm::irange(0u, number_of_nodes))
+                {
+                    if (is_boundary_node[x])
+                    {
+                        node_priorities[x] = CORE_LEVEL;
+                    }
+                }
+            }
+            std::cout << "ok" << std::endl;
+            thread_data_list.CollectStats(total_simulation_stats, total_contraction_stats);
+            if (witness_config.log_statistics && !use_cached_levels)
+            {
+                LogWitnessSearchStats("initial priorities", total_simulation_stats,
+                                      WitnessSearchStats());
+            }
+        }
+        std::cout << "preprocessing " << number_of_nodes << " nodes ..." << std::flush;
 
-        bool flushed_contractor = false;
         while (number_of_nodes > 2 &&
                number_of_contracted_nodes < static_cast<NodeID>(number_of_nodes * core_factor))
         {
+            TRACE_SCOPE("contraction round");
             if (!flushed_contractor && (number_of_contracted_nodes >
                                         static_cast<NodeID>(number_of_nodes * 0.65 * core_factor)))
             {
-                DeallocatingVector<ContractorEdge> new_edge_set; // this one is not explicitely
-                                                                 // cleared since it goes out of
-                                                                 // scope anywa
                 std::cout << " [flush " << number_of_contracted_nodes << " nodes] " << std::flush;
 
                 // Delete old heap data to free memory that we need for the coming operations
@@ -352,6 +534,7 @@ class Contractor
 
                 // Create new priority array
                 std::vector<float> new_node_priority(remaining_nodes.size());
+                std::vector<char> new_is_stale(remaining_nodes.size());
                 // this map gives the old IDs from the new ones, necessary to get a consistent graph
                 // at the end of contraction
                 orig_node_id_from_new_node_id_map.resize(remaining_nodes.size());
@@ -369,6 +552,7 @@ class Contractor
                     new_node_id_from_orig_id_map[remaining_nodes[new_node_id].id] = new_node_id;
                     new_node_priority[new_node_id] =
                         node_priorities[remaining_nodes[new_node_id].id];
+                    new_is_stale[new_node_id] = is_stale[remaining_nodes[new_node_id].id];
                     remaining_nodes[new_node_id].id = new_node_id;
                 }
                 // walk over all nodes
@@ -380,29 +564,25 @@ class Contractor
                     {
                         ContractorGraph::EdgeData &data =
                             contractor_graph->GetEdgeData(current_edge);
-                        const NodeID target = contractor_graph->GetTarget(current_edge);
                         if (SPECIAL_NODEID == new_node_id_from_orig_id_map[i])
                         {
+                            const NodeID target = contractor_graph->GetTarget(current_edge);
                             external_edge_list.push_back({source, target, data});
                         }
                         else
                         {
-                            // node is not yet contracted.
-                            // add (renumbered) outgoing edges to new DynamicGraph.
-                            ContractorEdge new_edge = {new_node_id_from_orig_id_map[source],
-                                                       new_node_id_from_orig_id_map[target],
-                                                       data};
-
-                            new_edge.data.is_original_via_node_ID = true;
-                            BOOST_ASSERT_MSG(UINT_MAX != new_node_id_from_orig_id_map[source],
-                                             "new source id not resolveable");
-                            BOOST_ASSERT_MSG(UINT_MAX != new_node_id_from_orig_id_map[target],
-                                             "new target id not resolveable");
-                            new_edge_set.push_back(new_edge);
+                            // node is not yet contracted, its edges stay in the graph and are
+                            // renumbered in place below
+                            data.is_original_via_node_ID = true;
                         }
                     }
                 }
 
+                // Drops the edges of contracted nodes and compacts the remaining ones in place.
+                // This avoids holding a copy of the remaining graph next to the old one.
+                contractor_graph->RenumberNodes(new_node_id_from_orig_id_map,
+                                                remaining_nodes.size());
+
                 // Delete map from old NodeIDs to new ones.
                 new_node_id_from_orig_id_map.clear();
                 new_node_id_from_orig_id_map.shrink_to_fit();
@@ -412,15 +592,10 @@ class Contractor
                 // Delete old node_priorities vector
                 new_node_priority.clear();
                 new_node_priority.shrink_to_fit();
-                // old Graph is removed
-                contractor_graph.reset();
-
-                // create new graph
-                tbb::parallel_sort(new_edge_set.begin(), new_edge_set.end());
-                contractor_graph =
-                    std::make_shared<ContractorGraph>(remaining_nodes.size(), new_edge_set);
+                is_stale.swap(new_is_stale);
+                new_is_stale.clear();
+                new_is_stale.shrink_to_fit();
 
-                new_edge_set.clear();
                 flushed_contractor = true;
 
                 // INFO: MAKE SURE THIS IS THE LAST OPERATION OF THE FLUSH!
@@ -429,17 +604,64 @@ class Contractor
             }
 
             const int last = (int)remaining_nodes.size();
+            TIMER_START(independent_set);
+            // Lazy updates evaluate the stale nodes that precede their neighbours first, those
+            // that still do afterwards form the independent set together with the fresh ones
+            std::atomic<int> number_of_reevaluated_nodes(0);
+            if (lazy_updates)
+            {
+                tbb::parallel_for(
+                    tbb::blocked_range<int>(0, last, IndependentGrainSize),
+                    [this, &node_priorities, &remaining_nodes, &is_stale](
+                        const tbb::blocked_range<int> &range)
+                    {
+                        for (int i = range.begin(), end = range.end(); i != end; ++i)
+                        {
+                            const NodeID node = remaining_nodes[i].id;
+                            remaining_nodes[i].is_independent =
+                                is_stale[node] && CORE_LEVEL != node_priorities[node] &&
+                                this->IsNodeLocalMinimum(node_priorities, node);
+                        }
+                    });
+                tbb::parallel_for(
+                    tbb::blocked_range<int>(0, last, NeighboursGrainSize),
+                    [this, &node_priorities, &node_data, &remaining_nodes, &is_stale,
+                     &thread_data_list, &number_of_reevaluated_nodes](
+                        const tbb::blocked_range<int> &range)
+                    {
+                        ContractorThreadData *data = thread_data_list.getThreadData();
+                        for (int i = range.begin(), end = range.end(); i != end; ++i)
+                        {
+                            if (!remaining_nodes[i].is_independent)
+                            {
+                                continue;
+                            }
+                            const NodeID node = remaining_nodes[i].id;
+                            node_priorities[node] =
+                                this->EvaluateNodePriority(data, &node_data[node], node);
+                            is_stale[node] = false;
+                            ++number_of_reevaluated_nodes;
+                        }
+                    });
+            }
             tbb::parallel_for(tbb::blocked_range<int>(0, last, IndependentGrainSize),
-                              [this, &node_priorities, &remaining_nodes, &thread_data_list](
-                                  const tbb::blocked_range<int> &range)
+                              [this, &node_priorities, &remaining_nodes, &thread_data_list,
+                               &is_stale, lazy_updates](const tbb::blocked_range<int> &range)
                               {
                                   ContractorThreadData *data = thread_data_list.getThreadData();
                                   // determine independent node set
                                   for (int i = range.begin(), end = range.end(); i != end; ++i)
                                   {
                                       const NodeID node = remaining_nodes[i].id;
+                                      // the core of a cached run stays uncontracted
                                       remaining_nodes[i].is_independent =
-                                          this->IsNodeIndependent(node_priorities, data, node);
+                                          CORE_LEVEL != node_priorities[node] &&
+                                          (lazy_updates
+                                               ? !is_stale[node] &&
+                                                     this->IsNodeLocalMinimum(node_priorities,
+                                                                              node)
+                                               : this->IsNodeIndependent(node_priorities, data,
+                                                                         node));
                                   }
                               });
 
@@ -449,8 +671,57 @@ class Contractor
                                                     return !node_data.is_independent;
                                                 });
             const int first_independent_node = static_cast<int>(first - remaining_nodes.begin());
+            TIMER_STOP(independent_set);
+            // only happens if all remaining nodes belong to the core of the cached levels, or
+            // are the boundary nodes of a partition whose regions are contracted
+            if (first_independent_node == last)
+            {
+                // the re-evaluated nodes lost their place, the next round finds fresh ones
+                if (number_of_reevaluated_nodes > 0)
+                {
+                    continue;
+                }
+                if (!defer_boundary_nodes)
+                {
+                    break;
+                }
+                std::cout << " [boundary " << last << " nodes] " << std::flush;
+                defer_boundary_nodes = false;
+                tbb::parallel_for(
+                    tbb::blocked_range<int>(0, last, PQGrainSize),
+                    [this, &node_priorities, &node_data, &remaining_nodes, &thread_data_list](
+                        const tbb::blocked_range<int> &range)
+                    {
+                        ContractorThreadData *data = thread_data_list.getThreadData();
+                        for (int position = range.begin(), end = range.end(); position != end;
+                             ++position)
+                        {
+                            const NodeID x = remaining_nodes[position].id;
+                            node_priorities[x] =
+                                this->EvaluateNodePriority(data, &node_data[x], x);
+                        }
+                    });
+                continue;
+            }
+            for (const auto position : osrm::irange(first_independent_node, last))
+            {
+                const NodeID node = remaining_nodes[position].id;
+                node_levels[flushed_contractor ? orig_node_id_from_new_node_id_map[node] : node] =
+                    current_level;
+            }
+            current_level += 1;
+
+            if (lazy_updates)
+            {
+                is_contracting_node.assign(contractor_graph->GetNumberOfNodes(), false);
+                for (const auto position : osrm::irange(first_independent_node, last))
+                {
+                    is_contracting_node[remaining_nodes[position].id] = true;
+                }
+            }
 
             // contract independent nodes
+            TIMER_START(contract_nodes);
             tbb::parallel_for(
                 tbb::blocked_range<int>(first_independent_node, last, ContractGrainSize),
                 [this, &remaining_nodes, &thread_data_list](const tbb::blocked_range<int> &range)
@@ -471,19 +742,38 @@ class Contractor
                         tbb::parallel_sort(data->inserted_edges.begin(),
                                            data->inserted_edges.end());
                 });
-            tbb::parallel_for(
-                tbb::blocked_range<int>(first_independent_node, last, DeleteGrainSize),
-                [this, &remaining_nodes, &thread_data_list](const tbb::blocked_range<int> &range)
-                {
-                    ContractorThreadData *data = thread_data_list.getThreadData();
-                    for (int position = range.begin(), end = range.end(); position != end; ++position)
+            TIMER_STOP(contract_nodes);
+            TIMER_START(delete_edges);
+            if (lazy_updates)
+            {
+                // contracted nodes may share neighbours now, every neighbour drops its edges to
+                // all of them at once
+                DeleteEdgesToContractedNodes(remaining_nodes, first_independent_node, last);
+                is_contracting_node.clear();
+            }
+            else
+            {
+                tbb::parallel_for(
+                    tbb::blocked_range<int>(first_independent_node, last, DeleteGrainSize),
+                    [this, &remaining_nodes, &thread_data_list](
+                        const tbb::blocked_range<int> &range)
                     {
-                        const NodeID x = remaining_nodes[position].id;
-                        this->DeleteIncomingEdges(data, x);
-                    }
-                });
+                        ContractorThreadData *data = thread_data_list.getThreadData();
+                        for (int position = range.begin(), end = range.end(); position != end;
+                             ++position)
+                        {
+                            const NodeID x = remaining_nodes[position].id;
+                            this->DeleteIncomingEdges(data, x);
+                        }
+                    });
+            }
+
+            TIMER_STOP(delete_edges);
 
             // insert new edges
+            TIMER_START(insert_edges);
+            std::uint64_t inserted_shortcuts = 0;
+            std::uint64_t merged_shortcuts = 0;
             for (auto &data : thread_data_list.data)
             {
                 for (const ContractorEdge &edge : data->inserted_edges)
@@ -500,31 +790,116 @@ class Contractor
                         {
                             // found a duplicate edge with smaller weight, update it.
                             current_data = edge.data;
+                            ++merged_shortcuts;
                             continue;
                         }
                     }
                     contractor_graph->InsertEdge(edge.source, edge.target, edge.data);
+                    ++inserted_shortcuts;
                 }
                 data->inserted_edges.clear();
             }
+            TIMER_STOP(insert_edges);
 
-            tbb::parallel_for(
-                tbb::blocked_range<int>(first_independent_node, last, NeighboursGrainSize),
-                [this, &remaining_nodes, &node_priorities, &node_data, &thread_data_list](
-                    const tbb::blocked_range<int> &range)
+            // cached levels do not change with the remaining graph
+            TIMER_START(update_neighbours);
+            if (!use_cached_levels)
+            {
+                tbb::parallel_for(
+                    tbb::blocked_range<int>(first_independent_node, last, NeighboursGrainSize),
+                    [this, &remaining_nodes, &node_priorities, &node_data, &thread_data_list,
+                     &is_stale, lazy_updates](const tbb::blocked_range<int> &range)
+                    {
+                        ContractorThreadData *data = thread_data_list.getThreadData();
+                        for (int position = range.begin(), end = range.end(); position != end;
+                             ++position)
+                        {
+                            NodeID x = remaining_nodes[position].id;
+                            this->UpdateNodeNeighbours(node_priorities, node_data, data, x,
+                                                       lazy_updates ? &is_stale : nullptr);
+                        }
+                    });
+            }
+            TIMER_STOP(update_neighbours);
+
+            // The edges of contracted nodes are final, stream them out instead of keeping the
+            // whole hierarchy in memory
+            if (stream_contracted_edges)
+            {
+                for (const auto position : osrm::irange(first_independent_node, last))
                 {
-                    ContractorThreadData *data = thread_data_list.getThreadData();
-                    for (int position = range.begin(), end = range.end(); position != end; ++position)
+                    const NodeID x = remaining_nodes[position].id;
+                    for (auto edge : contractor_graph->GetAdjacentEdgeRange(x))
                     {
-                        NodeID x = remaining_nodes[position].id;
-                        this->UpdateNodeNeighbours(node_priorities, node_data, data, x);
+                        external_edge_list.push_back(GetOutputEdge(
+                            x, contractor_graph->GetTarget(edge), contractor_graph->GetEdgeData(edge)));
                     }
-                });
+                    contractor_graph->DeleteEdges(x);
+                }
+            }
+
+            // InsertEdge relocates full edge ranges to the end of the edge list and DeleteEdges
+            // leaves holes, both are reclaimed here
+            if (contractor_graph->GetEdgeStorageSize() >
+                MaxEdgeStorageOverhead * contractor_graph->GetNumberOfEdges())
+            {
+                contractor_graph->Compact();
+            }
+
+            WitnessSearchStats round_simulation_stats;
+            WitnessSearchStats round_contraction_stats;
+            thread_data_list.CollectStats(round_simulation_stats, round_contraction_stats);
+            total_simulation_stats += round_simulation_stats;
+            total_contraction_stats += round_contraction_stats;
+            ++round;
+            if (witness_config.log_statistics)
+            {
+                LogWitnessSearchStats("round " + std::to_string(round) + ", " +
+                                          std::to_string(last - first_independent_node) +
+                                          " nodes",
+                                      round_simulation_stats, round_contraction_stats);
+            }
 
             // remove contracted nodes from the pool
             number_of_contracted_nodes += last - first_independent_node;
             remaining_nodes.resize(first_independent_node);
             remaining_nodes.shrink_to_fit();
+
+            if (!report_path.empty())
+            {
+                std::uint64_t remaining_degree = 0;
+                for (const auto &node : remaining_nodes)
+                {
+                    remaining_degree += contractor_graph->GetOutDegree(node.id);
+                }
+                const double average_degree =
+                    remaining_nodes.empty() ? 0. : static_cast<double>(remaining_degree) /
+                                                       static_cast<double>(remaining_nodes.size());
+                using osrm::json::Number;
+                osrm::json::Object round_report;
+                round_report.values.emplace("independent_nodes",
+                                            Number(last - first_independent_node));
+                round_report.values.emplace("remaining_nodes", Number(first_independent_node));
+                round_report.values.emplace("inserted_shortcuts", Number(inserted_shortcuts));
+                round_report.values.emplace("merged_shortcuts", Number(merged_shortcuts));
+                round_report.values.emplace("simulation_settled_nodes",
+                                            Number(round_simulation_stats.settled_nodes));
+                round_report.values.emplace("contraction_settled_nodes",
+                                            Number(round_contraction_stats.settled_nodes));
+                round_report.values.emplace("average_degree", Number(average_degree));
+                round_report.values.emplace("graph_bytes",
+                                            Number(contractor_graph->GetMemoryUsage()));
+                osrm::json::Object round_timings;
+                round_timings.values.emplace("independent_set",
+                                             Number(TIMER_MSEC(independent_set)));
+                round_timings.values.emplace("contraction", Number(TIMER_MSEC(contract_nodes)));
+                round_timings.values.emplace("deletion", Number(TIMER_MSEC(delete_edges)));
+                round_timings.values.emplace("insertion", Number(TIMER_MSEC(insert_edges)));
+                round_timings.values.emplace("neighbour_update",
+                                             Number(TIMER_MSEC(update_neighbours)));
+                round_report.values.emplace("milliseconds", std::move(round_timings));
+                report_rounds.values.push_back(std::move(round_report));
+            }
             //            unsigned maxdegree = 0;
             //            unsigned avgdegree = 0;
             //            unsigned mindegree = UINT_MAX;
@@ -550,6 +925,20 @@ class Contractor
             //            << maxdegree << ", min: " << mindegree << ", avg: " << avgdegree << ",
             //            quad: " << quaddegree;
 
+            if (checkpoint_interval > 0 && round % checkpoint_interval == 0 &&
+                !remaining_nodes.empty())
+            {
+                checkpoint.contracted_nodes = number_of_contracted_nodes;
+                checkpoint.current_level = current_level;
+                checkpoint.round = round;
+                checkpoint.flushed_contractor = flushed_contractor;
+                checkpoint.defer_boundary_nodes = defer_boundary_nodes;
+                checkpoint.simulation_stats = total_simulation_stats;
+                checkpoint.contraction_stats = total_contraction_stats;
+                WriteCheckpoint(number_of_nodes, use_cached_levels, checkpoint, remaining_nodes,
+                                node_priorities, node_data, is_stale);
+            }
+
             p.printStatus(number_of_contracted_nodes);
         }
 
@@ -571,8 +960,33 @@ class Contractor
 
         SimpleLogger().Write() << "[core] " << remaining_nodes.size() << " nodes "
                                << contractor_graph->GetNumberOfEdges() << " edges." << std::endl;
+        LogWitnessSearchStats("total", total_simulation_stats, total_contraction_stats);
 
         thread_data_list.data.clear();
+
+        TIMER_STOP(contraction);
+        if (!report_path.empty())
+        {
+            using osrm::json::Number;
+            osrm::json::Object report;
+            report.values.emplace("nodes", Number(number_of_nodes));
+            report.values.emplace("core_nodes", Number(remaining_nodes.size()));
+            report.values.emplace("core_edges", Number(contractor_graph->GetNumberOfEdges()));
+            report.values.emplace("simulation_settled_nodes",
+                                  Number(total_simulation_stats.settled_nodes));
+            report.values.emplace("contraction_settled_nodes",
+                                  Number(total_contraction_stats.settled_nodes));
+            report.values.emplace("milliseconds", Number(TIMER_MSEC(contraction)));
+            report.values.emplace("rounds", std::move(report_rounds));
+            std::ofstream report_stream(report_path);
+            osrm::json::render(report_stream, report);
+            SimpleLogger().Write() << "wrote contraction report to " << report_path;
+        }
+        // a later run starts from scratch
+        if (!checkpoint_path.empty())
+        {
+            std::remove(checkpoint_path.c_str());
+        }
     }
 
     inline void GetCoreMarker(std::vector<bool> &out_is_core_node)
@@ -580,6 +994,18 @@ class Contractor
         out_is_core_node.swap(is_core_node);
     }
 
+    // Contraction round of every node, the core has CORE_LEVEL. Passing them to SetNodeLevels
+    // of a later run contracts the nodes in the same order.
+    inline void GetNodeLevels(std::vector<float> &out_node_levels)
+    {
+        out_node_levels.swap(node_levels);
+    }
+
+    inline void SetNodeLevels(std::vector<float> &&in_node_levels)
+    {
+        node_levels = std::move(in_node_levels);
+    }
+
     template <class Edge> inline void GetEdges(DeallocatingVector<Edge> &edges)
     {
         Percent p(contractor_graph->GetNumberOfNodes());
@@ -587,42 +1013,13 @@ class Contractor
         const NodeID number_of_nodes = contractor_graph->GetNumberOfNodes();
         if (contractor_graph->GetNumberOfNodes())
         {
-            Edge new_edge;
             for (const auto node : osrm::irange(0u, number_of_nodes))
             {
                 p.printStatus(node);
                 for (auto edge : contractor_graph->GetAdjacentEdgeRange(node))
                 {
-                    const NodeID target = contractor_graph->GetTarget(edge);
-                    const ContractorGraph::EdgeData &data = contractor_graph->GetEdgeData(edge);
-                    if (!orig_node_id_from_new_node_id_map.empty())
-                    {
-                        new_edge.source = orig_node_id_from_new_node_id_map[node];
-                        new_edge.target = orig_node_id_from_new_node_id_map[target];
-                    }
-                    else
-                    {
-                        new_edge.source = node;
-                        new_edge.target = target;
-                    }
-                    BOOST_ASSERT_MSG(UINT_MAX != new_edge.source, "Source id invalid");
-                    BOOST_ASSERT_MSG(UINT_MAX != new_edge.target, "Target id invalid");
-                    new_edge.data.distance = data.distance;
-                    new_edge.data.shortcut = data.shortcut;
-                    if (!data.is_original_via_node_ID && !orig_node_id_from_new_node_id_map.empty())
-                    {
-                        // tranlate the _node id_ of the shortcutted node
-                        new_edge.data.id = orig_node_id_from_new_node_id_map[data.id];
-                    }
-                    else
-                    {
-                        new_edge.data.id = data.id;
-                    }
-                    BOOST_ASSERT_MSG(new_edge.data.id != INT_MAX, // 2^31
-                                     "edge id invalid");
-                    new_edge.data.forward = data.forward;
-                    new_edge.data.backward = data.backward;
-                    edges.push_back(new_edge);
+                    edges.push_back(GetOutputEdge(node, contractor_graph->GetTarget(edge),
+                                                  contractor_graph->GetEdgeData(edge)));
                 }
             }
         }
@@ -636,18 +1033,317 @@ class Contractor
         external_edge_list.clear();
     }
 
+    // Moves the edges of contracted nodes to external memory after every round, so that only
+    // the remaining graph is held in memory.
+    void SetStreamContractedEdges(const bool stream) { stream_contracted_edges = stream; }
+
+    // Writes the statistics of every contraction round as JSON to the given file
+    void SetReportPath(const std::string &path) { report_path = path; }
+
+    // Re-evaluates the priority of a node only once it is a candidate for contraction instead
+    // of after every contraction of a neighbour. The independent sets are then formed from the
+    // nodes that precede all of their neighbours instead of their 2-hop neighbourhood, and the
+    // witness searches of a round avoid all nodes contracted in it.
+    void SetLazyPriorityUpdates(const bool lazy) { lazy_priority_updates = lazy; }
+
+    // Nodes with an edge into another region of a partition of the graph. They are contracted
+    // only after the interior nodes of all regions. No shortcut crosses a region until then, so
+    // the regions are contracted independently of each other in the same rounds, and the
+    // boundary nodes form the overlay on top, or the core if the contraction stops early.
+    inline void SetBoundaryNodes(std::vector<bool> &&in_is_boundary_node)
+    {
+        is_boundary_node = std::move(in_is_boundary_node);
+    }
+
+    // Saves the state of the contraction to the given file after every interval rounds, none are
+    // saved for an interval of 0. If resume is set, Run continues from the state in the file if
+    // there is one, the graph and the configuration have to be those of the interrupted run.
+    // The file is removed once the contraction is finished.
+    void SetCheckpoints(const std::string &path, const unsigned interval, const bool resume)
+    {
+        checkpoint_path = path;
+        checkpoint_interval = interval;
+        resume_from_checkpoint = resume;
+    }
+
+    void SetWitnessSearchConfig(const WitnessSearchConfig &config)
+    {
+        BOOST_ASSERT(config.simulation_limit > 0 && config.contraction_limit > 0);
+        witness_config = config;
+    }
+
   private:
+    static constexpr float CORE_LEVEL = std::numeric_limits<float>::max();
+    // edges that go through a buffer at a time when a checkpoint writes or reads them
+    static constexpr std::size_t CHECKPOINT_CHUNK_SIZE = 1 << 16;
+
+    // The state of Run besides its vectors and those of the contractor. number_of_nodes,
+    // input_edges and customizable identify the graph that was contracted.
+    struct CheckpointHeader
+    {
+        CheckpointHeader()
+            : number_of_nodes(0), input_edges(0), contracted_nodes(0), external_edges(0),
+              current_level(0), round(0), customizable(false), use_cached_levels(false),
+              flushed_contractor(false), defer_boundary_nodes(false)
+        {
+        }
+
+        FingerPrint fingerprint;
+        std::uint64_t number_of_nodes;
+        std::uint64_t input_edges;
+        std::uint64_t contracted_nodes;
+        std::uint64_t external_edges;
+        float current_level;
+        unsigned round;
+        bool customizable;
+        bool use_cached_levels;
+        bool flushed_contractor;
+        bool defer_boundary_nodes;
+        WitnessSearchStats simulation_stats;
+        WitnessSearchStats contraction_stats;
+    };
+
+    template <typename T>
+    static void WriteCheckpointVector(std::ostream &out, const std::vector<T> &v)
+    {
+        const std::uint64_t size = v.size();
+        out.write((const char *)&size, sizeof(size));
+        out.write((const char *)v.data(), sizeof(T) * size);
+    }
+
+    template <typename T> static void ReadCheckpointVector(std::istream &in, std::vector<T> &v)
+    {
+        std::uint64_t size = 0;
+        in.read((char *)&size, sizeof(size));
+        if (!in)
+        {
+            return;
+        }
+        v.resize(size);
+        in.read((char *)v.data(), sizeof(T) * size);
+    }
+
+    // Writes the remaining graph, the emitted edges and the state of Run to a temporary file
+    // that replaces the checkpoint once it is complete, an interruption while writing keeps the
+    // previous one. Failures are logged, the contraction goes on without the checkpoint.
+    void WriteCheckpoint(const NodeID number_of_nodes,
+                         const bool use_cached_levels,
+                         CheckpointHeader &header,
+                         const std::vector<RemainingNodeData> &remaining_nodes,
+                         const std::vector<float> &node_priorities,
+                         const std::vector<NodePriorityData> &node_data,
+                         const std::vector<char> &is_stale) const
+    {
+        TIMER_START(checkpoint);
+        header.fingerprint = FingerPrint::GetValid();
+        header.number_of_nodes = number_of_nodes;
+        header.input_edges = input_edges;
+        header.external_edges = external_edge_list.size();
+        header.customizable = customizable;
+        header.use_cached_levels = use_cached_levels;
+
+        const std::string temporary_path = checkpoint_path + ".tmp";
+        std::ofstream out(temporary_path, std::ios::binary);
+        out.write((const char *)&header, sizeof(CheckpointHeader));
+        WriteCheckpointVector(out, remaining_nodes);
+        WriteCheckpointVector(out, node_priorities);
+        WriteCheckpointVector(out, node_data);
+        WriteCheckpointVector(out, is_stale);
+        WriteCheckpointVector(out, node_levels);
+        WriteCheckpointVector(out, orig_node_id_from_new_node_id_map);
+
+        // the edges of the remaining graph, ordered by their source
+        const std::uint64_t graph_nodes = contractor_graph->GetNumberOfNodes();
+        const std::uint64_t graph_edges = contractor_graph->GetNumberOfEdges();
+        out.write((const char *)&graph_nodes, sizeof(graph_nodes));
+        out.write((const char *)&graph_edges, sizeof(graph_edges));
+        std::vector<ContractorEdge> edge_buffer;
+        edge_buffer.reserve(CHECKPOINT_CHUNK_SIZE);
+        const auto flush_edges = [&out, &edge_buffer]()
+        {
+            out.write((const char *)edge_buffer.data(),
+                      sizeof(ContractorEdge) * edge_buffer.size());
+            edge_buffer.clear();
+        };
+        for (const auto node : osrm::irange<NodeID>(0, static_cast<NodeID>(graph_nodes)))
+        {
+            for (auto edge : contractor_graph->GetAdjacentEdgeRange(node))
+            {
+                edge_buffer.emplace_back(node, contractor_graph->GetTarget(edge),
+                                         contractor_graph->GetEdgeData(edge));
+                if (edge_buffer.size() == CHECKPOINT_CHUNK_SIZE)
+                {
+                    flush_edges();
+                }
+            }
+        }
+        flush_edges();
+
+        std::vector<QueryEdge> external_buffer;
+        external_buffer.reserve(CHECKPOINT_CHUNK_SIZE);
+        for (auto iter = external_edge_list.begin(); iter != external_edge_list.end(); ++iter)
+        {
+            external_buffer.push_back(*iter);
+            if (external_buffer.size() == CHECKPOINT_CHUNK_SIZE)
+            {
+                out.write((const char *)external_buffer.data(),
+                          sizeof(QueryEdge) * external_buffer.size());
+                external_buffer.clear();
+            }
+        }
+        out.write((const char *)external_buffer.data(), sizeof(QueryEdge) * external_buffer.size());
+        out.close();
+
+        if (!out || 0 != std::rename(temporary_path.c_str(), checkpoint_path.c_str()))
+        {
+            std::remove(temporary_path.c_str());
+            SimpleLogger().Write(logWARNING) << "could not write the checkpoint " << checkpoint_path
+                                             << ", continuing without it";
+            return;
+        }
+        TIMER_STOP(checkpoint);
+        SimpleLogger().Write() << "[checkpoint] round " << header.round << ", "
+                               << remaining_nodes.size() << " remaining nodes, " << graph_edges
+                               << " edges, written in " << TIMER_SEC(checkpoint) << " sec";
+    }
+
+    // Restores the state that WriteCheckpoint saved, returns false if there is no checkpoint.
+    // Throws if it belongs to a different graph, configuration or build.
+    bool ReadCheckpoint(const NodeID number_of_nodes,
+                        const bool use_cached_levels,
+                        CheckpointHeader &header,
+                        std::vector<RemainingNodeData> &remaining_nodes,
+                        std::vector<float> &node_priorities,
+                        std::vector<NodePriorityData> &node_data,
+                        std::vector<char> &is_stale)
+    {
+        std::ifstream in(checkpoint_path, std::ios::binary);
+        if (!in)
+        {
+            SimpleLogger().Write(logWARNING) << checkpoint_path
+                                             << " not found, contracting from the start";
+            return false;
+        }
+        in.read((char *)&header, sizeof(CheckpointHeader));
+        if (!in || !header.fingerprint.TestPrepare(FingerPrint::GetValid()))
+        {
+            throw osrm::exception(checkpoint_path + " was written by a different build");
+        }
+        if (header.number_of_nodes != number_of_nodes || header.input_edges != input_edges ||
+            header.customizable != customizable || header.use_cached_levels != use_cached_levels)
+        {
+            throw osrm::exception(checkpoint_path + " belongs to a different graph or was "
+                                                    "contracted with other options");
+        }
+        ReadCheckpointVector(in, remaining_nodes);
+        ReadCheckpointVector(in, node_priorities);
+        ReadCheckpointVector(in, node_data);
+        ReadCheckpointVector(in, is_stale);
+        ReadCheckpointVector(in, node_levels);
+        ReadCheckpointVector(in, orig_node_id_from_new_node_id_map);
+
+        std::uint64_t graph_nodes = 0;
+        std::uint64_t graph_edges = 0;
+        in.read((char *)&graph_nodes, sizeof(graph_nodes));
+        in.read((char *)&graph_edges, sizeof(graph_edges));
+        if (!in)
+        {
+            throw osrm::exception(checkpoint_path + " is truncated");
+        }
+        // frees the initial graph before the remaining one is built
+        contractor_graph.reset();
+        std::vector<ContractorEdge> edges(graph_edges);
+        in.read((char *)edges.data(), sizeof(ContractorEdge) * graph_edges);
+        // the graph expects the edges ordered by target as well, equal ones keep their order
+        std::stable_sort(edges.begin(), edges.end());
+        contractor_graph =
+            std::make_shared<ContractorGraph>(static_cast<NodeID>(graph_nodes), edges);
+        edges.clear();
+        edges.shrink_to_fit();
+
+        external_edge_list.clear();
+        std::vector<QueryEdge> external_buffer;
+        for (std::uint64_t read = 0; in && read < header.external_edges;)
+        {
+            external_buffer.resize(
+                std::min<std::uint64_t>(CHECKPOINT_CHUNK_SIZE, header.external_edges - read));
+            in.read((char *)external_buffer.data(), sizeof(QueryEdge) * external_buffer.size());
+            for (const auto &edge : external_buffer)
+            {
+                external_edge_list.push_back(edge);
+            }
+            read += external_buffer.size();
+        }
+        if (!in)
+        {
+            throw osrm::exception(checkpoint_path + " is truncated");
+        }
+        return true;
+    }
+
+    // translates an edge of the (renumbered) contractor graph back to the original node ids
+    QueryEdge GetOutputEdge(const NodeID node,
+                            const NodeID target,
+                            const ContractorEdgeData &data) const
+    {
+        QueryEdge new_edge;
+        if (!orig_node_id_from_new_node_id_map.empty())
+        {
+            new_edge.source = orig_node_id_from_new_node_id_map[node];
+            new_edge.target = orig_node_id_from_new_node_id_map[target];
+        }
+        else
+        {
+            new_edge.source = node;
+            new_edge.target = target;
+        }
+        BOOST_ASSERT_MSG(UINT_MAX != new_edge.source, "Source id invalid");
+        BOOST_ASSERT_MSG(UINT_MAX != new_edge.target, "Target id invalid");
+        new_edge.data.distance = data.distance;
+        new_edge.data.length = data.length;
+        new_edge.data.shortcut = data.shortcut;
+        if (!data.is_original_via_node_ID && !orig_node_id_from_new_node_id_map.empty())
+        {
+            // tranlate the _node id_ of the shortcutted node
+            new_edge.data.id = orig_node_id_from_new_node_id_map[data.id];
+        }
+        else
+        {
+            new_edge.data.id = data.id;
+        }
+        BOOST_ASSERT_MSG(new_edge.data.id != INT_MAX, // 2^31
+                         "edge id invalid");
+        new_edge.data.forward = data.forward;
+        new_edge.data.backward = data.backward;
+        return new_edge;
+    }
+
+    static void LogWitnessSearchStats(const std::string &label,
+                                      const WitnessSearchStats &simulation_stats,
+                                      const WitnessSearchStats &contraction_stats)
+    {
+        SimpleLogger().Write() << "[witness] " << label << ": " << simulation_stats.searches
+                               << " simulated searches settled " << simulation_stats.settled_nodes
+                               << " nodes, " << simulation_stats.aborted_searches
+                               << " hit the limit; " << contraction_stats.searches
+                               << " contraction searches settled "
+                               << contraction_stats.settled_nodes << " nodes, "
+                               << contraction_stats.aborted_searches << " hit the limit";
+    }
+
     inline void Dijkstra(const int max_distance,
                          const unsigned number_of_targets,
-                         const int maxNodes,
+                         const unsigned maxNodes,
                          ContractorThreadData *const data,
+                         WitnessSearchStats &stats,
                          const NodeID middleNode)
     {
 
         ContractorHeap &heap = data->heap;
 
-        int nodes = 0;
+        unsigned nodes = 0;
         unsigned number_of_targets_found = 0;
+        ++stats.searches;
         while (!heap.Empty())
         {
             const NodeID node = heap.DeleteMin();
@@ -656,10 +1352,13 @@ class Contractor
 
             if (++nodes > maxNodes)
             {
+                ++stats.aborted_searches;
+                stats.settled_nodes += maxNodes;
                 return;
             }
             if (distance > max_distance)
             {
+                stats.settled_nodes += nodes;
                 return;
             }
 
@@ -669,6 +1368,7 @@ class Contractor
                 ++number_of_targets_found;
                 if (number_of_targets_found >= number_of_targets)
                 {
+                    stats.settled_nodes += nodes;
                     return;
                 }
             }
@@ -686,6 +1386,11 @@ class Contractor
                 {
                     continue;
                 }
+                // the nodes contracted alongside may share neighbours with middleNode
+                if (!is_contracting_node.empty() && is_contracting_node[to])
+                {
+                    continue;
+                }
                 const int to_distance = distance + data.distance;
 
                 // New Node discovered -> Add to Heap + Node Info Storage
@@ -701,6 +1406,7 @@ class Contractor
                 }
             }
         }
+        stats.settled_nodes += nodes;
     }
 
     inline float EvaluateNodePriority(ContractorThreadData *const data,
@@ -776,11 +1482,13 @@ class Contractor
 
             if (RUNSIMULATION)
             {
-                Dijkstra(max_distance, number_of_targets, 1000, data, node);
+                Dijkstra(max_distance, number_of_targets, witness_config.simulation_limit, data,
+                         data->simulation_stats, node);
             }
             else
             {
-                Dijkstra(max_distance, number_of_targets, 2000, data, node);
+                Dijkstra(max_distance, number_of_targets, witness_config.contraction_limit, data,
+                         data->contraction_stats, node);
             }
             for (auto out_edge : contractor_graph->GetAdjacentEdgeRange(node))
             {
@@ -803,13 +1511,14 @@ class Contractor
                     }
                     else
                     {
+                        const unsigned path_length = in_data.length + out_data.length;
                         inserted_edges.emplace_back(source, target, path_distance,
                                                     out_data.originalEdges + in_data.originalEdges,
-                                                    node, true, true, false);
+                                                    node, true, true, false, path_length);
 
                         inserted_edges.emplace_back(target, source, path_distance,
                                                     out_data.originalEdges + in_data.originalEdges,
-                                                    node, true, false, true);
+                                                    node, true, false, true, path_length);
                     }
                 }
             }
@@ -834,10 +1543,20 @@ class Contractor
                     {
                         continue;
                     }
+                    if (inserted_edges[other].data.length != inserted_edges[i].data.length)
+                    {
+                        continue;
+                    }
                     if (inserted_edges[other].data.shortcut != inserted_edges[i].data.shortcut)
                     {
                         continue;
                     }
+                    if (customizable &&
+                        (inserted_edges[other].data.forward != inserted_edges[i].data.forward ||
+                         inserted_edges[other].data.backward != inserted_edges[i].data.backward))
+                    {
+                        continue;
+                    }
                     inserted_edges[other].data.forward |= inserted_edges[i].data.forward;
                     inserted_edges[other].data.backward |= inserted_edges[i].data.backward;
                     found = true;
@@ -877,10 +1596,12 @@ class Contractor
         }
     }
 
+    // With is_stale the neighbours are only marked for a later evaluation
     inline bool UpdateNodeNeighbours(std::vector<float> &priorities,
                                      std::vector<NodePriorityData> &node_data,
                                      ContractorThreadData *const data,
-                                     const NodeID node)
+                                     const NodeID node,
+                                     std::vector<char> *const is_stale = nullptr)
     {
         std::vector<NodeID> &neighbours = data->neighbours;
         neighbours.clear();
@@ -900,14 +1621,114 @@ class Contractor
         std::sort(neighbours.begin(), neighbours.end());
         neighbours.resize(std::unique(neighbours.begin(), neighbours.end()) - neighbours.begin());
 
-        // re-evaluate priorities of neighboring nodes
+        // re-evaluate priorities of neighboring nodes, deferred boundary nodes keep theirs
         for (const NodeID u : neighbours)
         {
-            priorities[u] = EvaluateNodePriority(data, &(node_data)[u], u);
+            if (CORE_LEVEL == priorities[u])
+            {
+                continue;
+            }
+            if (nullptr != is_stale)
+            {
+                (*is_stale)[u] = true;
+            }
+            else
+            {
+                priorities[u] = EvaluateNodePriority(data, &(node_data)[u], u);
+            }
+        }
+        return true;
+    }
+
+    // Whether node precedes all of its neighbours in the order of the priorities, ties broken
+    // by the hashes of the ids. No two neighbours both do, so these nodes are independent.
+    inline bool IsNodeLocalMinimum(const std::vector<float> &priorities, const NodeID node) const
+    {
+        const float priority = priorities[node];
+        for (auto e : contractor_graph->GetAdjacentEdgeRange(node))
+        {
+            const NodeID target = contractor_graph->GetTarget(e);
+            if (node == target)
+            {
+                continue;
+            }
+            const float target_priority = priorities[target];
+            BOOST_ASSERT(target_priority >= 0);
+            if (priority > target_priority)
+            {
+                return false;
+            }
+            if (std::abs(priority - target_priority) < std::numeric_limits<float>::epsilon() &&
+                bias(node, target))
+            {
+                return false;
+            }
         }
         return true;
     }
 
+    // Deletes the edges of the neighbours of the contracted nodes in [first, last) of
+    // remaining_nodes into them, each neighbour on a single thread
+    void DeleteEdgesToContractedNodes(const std::vector<RemainingNodeData> &remaining_nodes,
+                                      const int first,
+                                      const int last)
+    {
+        BOOST_ASSERT(!is_contracting_node.empty());
+        tbb::enumerable_thread_specific<std::vector<NodeID>> thread_neighbours;
+        tbb::parallel_for(tbb::blocked_range<int>(first, last),
+                          [&](const tbb::blocked_range<int> &range)
+                          {
+                              std::vector<NodeID> &neighbours = thread_neighbours.local();
+                              for (int position = range.begin(), end = range.end();
+                                   position != end; ++position)
+                              {
+                                  const NodeID x = remaining_nodes[position].id;
+                                  for (auto e : contractor_graph->GetAdjacentEdgeRange(x))
+                                  {
+                                      neighbours.push_back(contractor_graph->GetTarget(e));
+                                  }
+                              }
+                          });
+        std::vector<NodeID> neighbours;
+        for (const auto &local_neighbours : thread_neighbours)
+        {
+            neighbours.insert(neighbours.end(), local_neighbours.begin(), local_neighbours.end());
+        }
+        tbb::parallel_sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, neighbours.size()),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+                              std::vector<NodeID> contracted_targets;
+                              for (auto i = range.begin(), end = range.end(); i != end; ++i)
+                              {
+                                  const NodeID u = neighbours[i];
+                                  if (is_contracting_node[u])
+                                  {
+                                      continue;
+                                  }
+                                  contracted_targets.clear();
+                                  for (auto e : contractor_graph->GetAdjacentEdgeRange(u))
+                                  {
+                                      const NodeID target = contractor_graph->GetTarget(e);
+                                      if (is_contracting_node[target])
+                                      {
+                                          contracted_targets.push_back(target);
+                                      }
+                                  }
+                                  std::sort(contracted_targets.begin(), contracted_targets.end());
+                                  contracted_targets.erase(std::unique(contracted_targets.begin(),
+                                                                       contracted_targets.end()),
+                                                           contracted_targets.end());
+                                  for (const NodeID target : contracted_targets)
+                                  {
+                                      contractor_graph->DeleteEdgesTo(u, target);
+                                  }
+                              }
+                          });
+    }
+
     inline bool IsNodeIndependent(const std::vector<float> &priorities,
                                   ContractorThreadData *const data,
                                   NodeID node) const
@@ -990,7 +1811,21 @@ class Contractor
     stxxl::vector<QueryEdge> external_edge_list;
     std::vector<NodeID> orig_node_id_from_new_node_id_map;
     std::vector<bool> is_core_node;
+    std::vector<float> node_levels;
+    std::vector<bool> is_boundary_node;
     XORFastHash fast_hash;
+    bool customizable;
+    bool stream_contracted_edges;
+    bool lazy_priority_updates;
+    // nodes contracted in the current round, only set with lazy priority updates
+    std::vector<char> is_contracting_node;
+    WitnessSearchConfig witness_config;
+    std::string report_path;
+    std::string checkpoint_path;
+    unsigned checkpoint_interval;
+    bool resume_from_checkpoint;
+    // edges of the graph before the contraction, identifies it in a checkpoint
+    std::uint64_t input_edges;
 };
 
 #endif // CONTRACTOR_HPP
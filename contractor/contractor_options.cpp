@@ -53,12 +53,108 @@ ContractorOptions::ParseArguments(int argc, char *argv[], ContractorConfig &cont
         "Restrictions file in .osrm.restrictions format")(
         "profile,p", boost::program_options::value<boost::filesystem::path>(&contractor_config.profile_path)
                          ->default_value("profile.lua"),
-        "Path to LUA routing profile")(
+        "Path to LUA routing profile or a native profile (.so)")(
         "threads,t", boost::program_options::value<unsigned int>(&contractor_config.requested_num_threads)
                          ->default_value(tbb::task_scheduler_init::default_num_threads()),
         "Number of threads to use")(
 		"core,k", boost::program_options::value<double>(&contractor_config.core_factor)
-						 ->default_value(1.0),"Percentage of the graph (in vertices) to contract [0.1]");
+						 ->default_value(1.0),"Percentage of the graph (in vertices) to contract [0.1]")(
+        "segment-grid", boost::program_options::value<bool>(&contractor_config.build_segment_grid)
+                            ->implicit_value(true)
+                            ->default_value(false),
+        "Build a grid index of the road segments for small radius queries")(
+        "locate-index", boost::program_options::value<bool>(&contractor_config.build_locate_index)
+                            ->implicit_value(true)
+                            ->default_value(false),
+        "Build a kd-tree of the road network nodes for locate queries")(
+        "generalization-levels",
+        boost::program_options::value<bool>(&contractor_config.build_generalization_levels)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Precompute the generalization of the geometries for all zoom levels")(
+        "projected-coordinates",
+        boost::program_options::value<bool>(&contractor_config.store_projected_coordinates)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Store the projected coordinates of the nodes for faster nearest neighbor queries")(
+        "landmarks", boost::program_options::value<unsigned>(&contractor_config.number_of_landmarks)
+                         ->default_value(0),
+        "Number of core landmarks for goal directed queries on the core, 0 to disable")(
+        "customizable", boost::program_options::value<bool>(&contractor_config.customizable)
+                            ->implicit_value(true)
+                            ->default_value(false),
+        "Keep a fixed hierarchy that osrm-customize can re-weight from traffic data")(
+        "level-cache", boost::program_options::value<bool>(&contractor_config.use_cached_levels)
+                           ->implicit_value(true)
+                           ->default_value(false),
+        "Contract in the node order and with the core of the .level file of a previous run")(
+        "witness-simulation-limit",
+        boost::program_options::value<unsigned>(&contractor_config.witness_simulation_limit)
+            ->default_value(1000),
+        "Settled nodes after which a witness search of the node priority simulation gives up")(
+        "witness-contraction-limit",
+        boost::program_options::value<unsigned>(&contractor_config.witness_contraction_limit)
+            ->default_value(2000),
+        "Settled nodes after which a witness search of the contraction gives up")(
+        "dense-witness-heaps",
+        boost::program_options::value<bool>(&contractor_config.dense_witness_heaps)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Index the witness search heaps by node id, faster but needs memory per thread")(
+        "witness-statistics",
+        boost::program_options::value<bool>(&contractor_config.log_witness_statistics)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Log the witness search work of every contraction round")(
+        "lazy-priorities",
+        boost::program_options::value<bool>(&contractor_config.lazy_priority_updates)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Re-evaluate node priorities only for contraction candidates, fewer witness searches")(
+        "pin-threads",
+        boost::program_options::value<bool>(&contractor_config.pin_threads)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Pin every worker thread to its own CPU, keeps the memory it touches first NUMA-local")(
+        "contraction-report",
+        boost::program_options::value<std::string>(&contractor_config.contraction_report_path),
+        "Write the statistics of every contraction round as JSON to this file")(
+        "external-memory",
+        boost::program_options::value<bool>(&contractor_config.stream_contracted_edges)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Stream the edges of contracted nodes to disk instead of keeping them in memory")(
+        "external-expansion",
+        boost::program_options::value<bool>(&contractor_config.stream_edge_based_edges)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Stream the edge-expanded edges to a temporary file instead of keeping them in memory")(
+        "image",
+        boost::program_options::value<bool>(&contractor_config.build_dataset_image)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Write a dataset image for osrm-routed --image and osrm-datastore --from-image")(
+        "renumber-nodes", boost::program_options::value<bool>(&contractor_config.renumber_nodes)
+                              ->implicit_value(true)
+                              ->default_value(false),
+        "Number the nodes by hierarchy level and location for faster queries")(
+        "parallel-compression",
+        boost::program_options::value<bool>(&contractor_config.parallel_graph_compression)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Compress the geometry of the node-based graph with multiple threads")(
+        "regions", boost::program_options::value<unsigned>(&contractor_config.number_of_regions)
+                       ->default_value(0),
+        "Contract the interior of this many geographic regions before their boundaries, "
+        "the boundaries then form the core if --core stops the contraction early")(
+        "checkpoint-interval",
+        boost::program_options::value<unsigned>(&contractor_config.checkpoint_interval)
+            ->default_value(0),
+        "Save the state of the contraction to .checkpoint every this many rounds, 0 to disable")(
+        "resume", boost::program_options::value<bool>(&contractor_config.resume_contraction)
+                      ->implicit_value(true)
+                      ->default_value(false),
+        "Continue the contraction from the .checkpoint of an interrupted run");
 
 
 
@@ -119,6 +215,20 @@ ContractorOptions::ParseArguments(int argc, char *argv[], ContractorConfig &cont
         contractor_config.restrictions_path = contractor_config.osrm_input_path.string() + ".restrictions";
     }
 
+    if (contractor_config.customizable && contractor_config.number_of_landmarks > 0)
+    {
+        SimpleLogger().Write(logWARNING) << "osrm-customize does not update landmarks, "
+                                            "use either --customizable or --landmarks";
+        return return_code::fail;
+    }
+
+    if (0 == contractor_config.witness_simulation_limit ||
+        0 == contractor_config.witness_contraction_limit)
+    {
+        SimpleLogger().Write(logWARNING) << "witness search limits must be at least 1";
+        return return_code::fail;
+    }
+
     if (!option_variables.count("input"))
     {
         SimpleLogger().Write() << "\n" << visible_options;
@@ -137,4 +247,15 @@ void ContractorOptions::GenerateOutputFilesNames(ContractorConfig &contractor_co
     contractor_config.graph_output_path = contractor_config.osrm_input_path.string() + ".hsgr";
     contractor_config.rtree_nodes_output_path = contractor_config.osrm_input_path.string() + ".ramIndex";
     contractor_config.rtree_leafs_output_path = contractor_config.osrm_input_path.string() + ".fileIndex";
+    contractor_config.segment_grid_output_path = contractor_config.osrm_input_path.string() + ".gridIndex";
+    contractor_config.locate_index_output_path = contractor_config.osrm_input_path.string() + ".locateIndex";
+    contractor_config.landmark_output_path = contractor_config.osrm_input_path.string() + ".landmarks";
+    contractor_config.edge_segment_lookup_output_path =
+        contractor_config.osrm_input_path.string() + ".edge_segment_lookup";
+    contractor_config.level_output_path = contractor_config.osrm_input_path.string() + ".level";
+    contractor_config.checkpoint_output_path =
+        contractor_config.osrm_input_path.string() + ".checkpoint";
+    contractor_config.edge_run_output_path =
+        contractor_config.osrm_input_path.string() + ".edge_run";
+    contractor_config.image_output_path = contractor_config.osrm_input_path.string() + ".image";
 }
@@ -28,25 +28,37 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef CONTRACTOR_OPTIONS_HPP
 #define CONTRACTOR_OPTIONS_HPP
 
+#include "../util/return_code.hpp"
+
 #include <boost/filesystem/path.hpp>
 
+#include <memory>
 #include <string>
 
-enum class return_code : unsigned
-{
-    ok,
-    fail,
-    exit
-};
+class NativeProfile;
 
 struct ContractorConfig
 {
-    ContractorConfig() noexcept : requested_num_threads(0) {}
+    ContractorConfig() noexcept
+        : requested_num_threads(0), build_segment_grid(false), build_locate_index(false),
+          build_generalization_levels(false),
+          store_projected_coordinates(false), number_of_landmarks(0), customizable(false), use_cached_levels(false),
+          witness_simulation_limit(1000), witness_contraction_limit(2000),
+          dense_witness_heaps(false), log_witness_statistics(false),
+          lazy_priority_updates(false), pin_threads(false),
+          stream_contracted_edges(false), stream_edge_based_edges(false),
+          build_dataset_image(false), renumber_nodes(false),
+          parallel_graph_compression(false), number_of_regions(0), checkpoint_interval(0),
+          resume_contraction(false)
+    {
+    }
 
     boost::filesystem::path config_file_path;
     boost::filesystem::path osrm_input_path;
     boost::filesystem::path restrictions_path;
     boost::filesystem::path profile_path;
+    // a profile compiled into the program, used instead of the one at profile_path if set
+    std::shared_ptr<const NativeProfile> native_profile;
 
     std::string node_output_path;
     std::string core_output_path;
@@ -55,9 +67,86 @@ struct ContractorConfig
     std::string graph_output_path;
     std::string rtree_nodes_output_path;
     std::string rtree_leafs_output_path;
+    std::string segment_grid_output_path;
+    std::string locate_index_output_path;
+    std::string landmark_output_path;
+    std::string edge_segment_lookup_output_path;
+    std::string level_output_path;
+    std::string checkpoint_output_path;
+    std::string edge_run_output_path;
+    std::string image_output_path;
 
     unsigned requested_num_threads;
 
+    // Also write a grid of the r-tree segments that answers small radius queries
+    bool build_segment_grid;
+
+    // Also write a kd-tree of the segment end points that answers /locate
+    bool build_locate_index;
+
+    // Store the zoom level at which each geometry node survives route generalization
+    bool build_generalization_levels;
+
+    // Append the mercator y of every node to the .nodes file, so that the queries of the
+    // r-tree do not project the segments they inspect. Costs 8 bytes per node.
+    bool store_projected_coordinates;
+
+    // Landmarks of the core for goal directed queries, none are selected by default
+    unsigned number_of_landmarks;
+
+    // Keep both directions of all edges apart and write the segments of the edge-based edges,
+    // so that osrm-customize can re-weight the hierarchy without contracting it again
+    bool customizable;
+
+    // Contract in the order of the .level file of a previous run instead of evaluating the
+    // node priorities, only the weights may have changed since
+    bool use_cached_levels;
+
+    // Settled nodes after which the witness searches of the priority simulation and of the actual
+    // contraction give up, see Contractor::WitnessSearchConfig
+    unsigned witness_simulation_limit;
+    unsigned witness_contraction_limit;
+    bool dense_witness_heaps;
+    bool log_witness_statistics;
+
+    // Evaluate the priority of a node only when it becomes a candidate for contraction, see
+    // Contractor::SetLazyPriorityUpdates
+    bool lazy_priority_updates;
+
+    // Pin the TBB worker threads to the allowed CPUs, see osrm::affinity::TBBThreadPinning
+    bool pin_threads;
+
+    // Write the statistics of every contraction round as JSON to this file, if it is not empty
+    std::string contraction_report_path;
+
+    // Write the edges of contracted nodes to external memory after every round, so that peak
+    // memory is bounded by the remaining graph instead of the whole hierarchy
+    bool stream_contracted_edges;
+
+    // Write the edge-expanded edges to a temporary file during the expansion and read them back
+    // block by block, so that they are not in memory together with the node-based graph
+    bool stream_edge_based_edges;
+
+    // Also write the '.image' that osrm-routed --image maps and osrm-datastore --from-image
+    // copies to shared memory, so that neither has to convert the single files
+    bool build_dataset_image;
+
+    // Number the nodes of the hierarchy by level and location for cache locality of the queries
+    bool renumber_nodes;
+
+    // Compress the chains of degree two nodes of the node-based graph concurrently
+    bool parallel_graph_compression;
+
+    // Contract the interior of this many geographic regions before the nodes on their
+    // boundaries, no partition is used below two
+    unsigned number_of_regions;
+
+    // Save the state of the contraction to '.checkpoint' after this many rounds, 0 to disable
+    unsigned checkpoint_interval;
+
+    // Continue the contraction from the '.checkpoint' of an interrupted run
+    bool resume_contraction;
+
     //A percentage of vertices that will be contracted for the hierarchy.
     //Offers a trade-off between preprocessing and query time.
     //The remaining vertices form the core of the hierarchy 
@@ -26,7 +26,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "edge_based_graph_factory.hpp"
+#include "../algorithms/coordinate_calculation.hpp"
+#include "../data_structures/edge_based_edge_run.hpp"
+#include "../data_structures/edge_segment_lookup.hpp"
 #include "../data_structures/percent.hpp"
+#include "../extractor/native_profile.hpp"
 #include "../util/compute_angle.hpp"
 #include "../util/integer_range.hpp"
 #include "../util/lua_util.hpp"
@@ -35,22 +39,27 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/assert.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <cmath>
 #include <fstream>
 #include <iomanip>
 #include <limits>
+#include <numeric>
 
 EdgeBasedGraphFactory::EdgeBasedGraphFactory(
     std::shared_ptr<NodeBasedDynamicGraph> node_based_graph,
     const CompressedEdgeContainer &compressed_edge_container,
     const std::unordered_set<NodeID> &barrier_nodes,
     const std::unordered_set<NodeID> &traffic_lights,
-    std::shared_ptr<const RestrictionMap> restriction_map,
+    std::shared_ptr<const RestrictionIndex> restriction_index,
     const std::vector<QueryNode> &node_info_list,
     SpeedProfileProperties speed_profile)
     : m_max_edge_id(0), m_node_info_list(node_info_list), m_node_based_graph(std::move(node_based_graph)),
-      m_restriction_map(std::move(restriction_map)), m_barrier_nodes(barrier_nodes),
+      m_restriction_index(std::move(restriction_index)), m_barrier_nodes(barrier_nodes),
       m_traffic_lights(traffic_lights), m_compressed_edge_container(compressed_edge_container),
-      speed_profile(std::move(speed_profile))
+      speed_profile(std::move(speed_profile)), m_native_profile(nullptr)
 {
 }
 
@@ -79,8 +88,53 @@ unsigned EdgeBasedGraphFactory::GetHighestEdgeID()
     return m_max_edge_id;
 }
 
-void EdgeBasedGraphFactory::InsertEdgeBasedNode(const NodeID node_u,
-                                                const NodeID node_v)
+unsigned EdgeBasedGraphFactory::GetEdgeLength(const NodeID u, const EdgeID edge) const
+{
+    const auto coordinate_of = [this](const NodeID node)
+    {
+        return FixedPointCoordinate(m_node_info_list[node].lat, m_node_info_list[node].lon);
+    };
+    if (!m_compressed_edge_container.HasEntryForID(edge))
+    {
+        return static_cast<unsigned>(std::round(
+            10 * coordinate_calculation::euclidean_distance(
+                     coordinate_of(u), coordinate_of(m_node_based_graph->GetTarget(edge)))));
+    }
+    double length = 0.;
+    NodeID previous = u;
+    for (const auto &compressed_node : m_compressed_edge_container.GetBucketReference(edge))
+    {
+        length += coordinate_calculation::euclidean_distance(coordinate_of(previous),
+                                                             coordinate_of(compressed_node.first));
+        previous = compressed_node.first;
+    }
+    return static_cast<unsigned>(std::round(10 * length));
+}
+
+unsigned EdgeBasedGraphFactory::GetNumberOfEdgeBasedNodes(const NodeID node_u,
+                                                          const NodeID node_v) const
+{
+    const EdgeID edge_id_1 = m_node_based_graph->FindEdge(node_u, node_v);
+    const EdgeID edge_id_2 = m_node_based_graph->FindEdge(node_v, node_u);
+    BOOST_ASSERT(edge_id_1 != SPECIAL_EDGEID);
+    BOOST_ASSERT(edge_id_2 != SPECIAL_EDGEID);
+
+    if (m_node_based_graph->GetEdgeData(edge_id_1).edge_id == SPECIAL_NODEID &&
+        m_node_based_graph->GetEdgeData(edge_id_2).edge_id == SPECIAL_NODEID)
+    {
+        return 0;
+    }
+    if (m_compressed_edge_container.HasEntryForID(edge_id_1))
+    {
+        return static_cast<unsigned>(
+            m_compressed_edge_container.GetBucketReference(edge_id_1).size());
+    }
+    return 1;
+}
+
+EdgeBasedNode *EdgeBasedGraphFactory::InsertEdgeBasedNode(const NodeID node_u,
+                                                         const NodeID node_v,
+                                                         EdgeBasedNode *output) const
 {
     // merge edges together into one EdgeBasedNode
     BOOST_ASSERT(node_u != SPECIAL_NODEID);
@@ -101,7 +155,7 @@ void EdgeBasedGraphFactory::InsertEdgeBasedNode(const NodeID node_u,
     if (forward_data.edge_id == SPECIAL_NODEID &&
         reverse_data.edge_id == SPECIAL_NODEID)
     {
-        return;
+        return output;
     }
 
     BOOST_ASSERT(m_compressed_edge_container.HasEntryForID(edge_id_1) ==
@@ -154,7 +208,7 @@ void EdgeBasedGraphFactory::InsertEdgeBasedNode(const NodeID node_u,
             BOOST_ASSERT(current_edge_target_coordinate_id != current_edge_source_coordinate_id);
 
             // build edges
-            m_edge_based_node_list.emplace_back(
+            *output = EdgeBasedNode(
                 forward_data.edge_id, reverse_data.edge_id,
                 current_edge_source_coordinate_id, current_edge_target_coordinate_id,
                 forward_data.name_id, forward_geometry[i].second,
@@ -163,17 +217,15 @@ void EdgeBasedGraphFactory::InsertEdgeBasedNode(const NodeID node_u,
                 INVALID_COMPONENTID, i, forward_data.travel_mode, reverse_data.travel_mode);
             current_edge_source_coordinate_id = current_edge_target_coordinate_id;
 
-            BOOST_ASSERT(m_edge_based_node_list.back().IsCompressed());
+            BOOST_ASSERT(output->IsCompressed());
 
-            BOOST_ASSERT(node_u != m_edge_based_node_list.back().u ||
-                         node_v != m_edge_based_node_list.back().v);
+            BOOST_ASSERT(node_u != output->u || node_v != output->v);
 
-            BOOST_ASSERT(node_u != m_edge_based_node_list.back().v ||
-                         node_v != m_edge_based_node_list.back().u);
+            BOOST_ASSERT(node_u != output->v || node_v != output->u);
+            ++output;
         }
 
         BOOST_ASSERT(current_edge_source_coordinate_id == node_v);
-        BOOST_ASSERT(m_edge_based_node_list.back().IsCompressed());
     }
     else
     {
@@ -200,12 +252,14 @@ void EdgeBasedGraphFactory::InsertEdgeBasedNode(const NodeID node_u,
         BOOST_ASSERT(forward_data.edge_id != SPECIAL_NODEID ||
                      reverse_data.edge_id != SPECIAL_NODEID);
 
-        m_edge_based_node_list.emplace_back(
+        *output = EdgeBasedNode(
             forward_data.edge_id, reverse_data.edge_id, node_u, node_v,
             forward_data.name_id, forward_data.distance, reverse_data.distance, 0, 0, SPECIAL_EDGEID,
             INVALID_COMPONENTID, 0, forward_data.travel_mode, reverse_data.travel_mode);
-        BOOST_ASSERT(!m_edge_based_node_list.back().IsCompressed());
+        BOOST_ASSERT(!output->IsCompressed());
+        ++output;
     }
+    return output;
 }
 
 void EdgeBasedGraphFactory::FlushVectorToStream(
@@ -221,7 +275,8 @@ void EdgeBasedGraphFactory::FlushVectorToStream(
 }
 
 void EdgeBasedGraphFactory::Run(const std::string &original_edge_data_filename,
-                                lua_State *lua_state)
+                                const std::string &edge_segment_lookup_filename,
+                                const LuaStateProvider &get_lua_state)
 {
     TIMER_START(renumber);
     m_max_edge_id = RenumberEdges() - 1;
@@ -232,7 +287,15 @@ void EdgeBasedGraphFactory::Run(const std::string &original_edge_data_filename,
     TIMER_STOP(generate_nodes);
 
     TIMER_START(generate_edges);
-    GenerateEdgeExpandedEdges(original_edge_data_filename, lua_state);
+    if (speed_profile.has_turn_penalty_function && speed_profile.turn_function_is_pure &&
+        nullptr == m_native_profile)
+    {
+        TabulateTurnPenalties(get_lua_state());
+    }
+    ComputeEdgeDirections();
+    GenerateEdgeExpandedEdges(original_edge_data_filename, edge_segment_lookup_filename,
+                              get_lua_state);
+    std::vector<EdgeDirections>().swap(m_edge_directions);
     TIMER_STOP(generate_edges);
 
     SimpleLogger().Write() << "Timing statistics for edge-expanded graph:";
@@ -273,43 +336,78 @@ unsigned EdgeBasedGraphFactory::RenumberEdges()
 }
 
 /// Creates the nodes in the edge expanded graph from edges in the node-based graph.
+/// The edge-based nodes of every node-based node are counted first. Their prefix sums give
+/// each node-based node its own range of the list, which is filled in parallel in the order
+/// of a sequential pass.
 void EdgeBasedGraphFactory::GenerateEdgeExpandedNodes()
 {
-    Percent progress(m_node_based_graph->GetNumberOfNodes());
+    const NodeID number_of_nodes = m_node_based_graph->GetNumberOfNodes();
 
-    // loop over all edges and generate new set of nodes
-    for (const auto node_u : osrm::irange(0u, m_node_based_graph->GetNumberOfNodes()))
+    // Every edge is stored as an outgoing and an incoming edge, only the copy at the smaller
+    // node is picked. Its edge-based nodes are made in the direction of its forward edge.
+    const auto get_edge_nodes = [this](const NodeID node_u, const EdgeID edge, NodeID &from,
+                                       NodeID &to)
     {
-        BOOST_ASSERT(node_u != SPECIAL_NODEID);
-        BOOST_ASSERT(node_u < m_node_based_graph->GetNumberOfNodes());
-        progress.printStatus(node_u);
-        for (EdgeID e1 : m_node_based_graph->GetAdjacentEdgeRange(node_u))
+        BOOST_ASSERT(edge != SPECIAL_EDGEID);
+        const NodeID node_v = m_node_based_graph->GetTarget(edge);
+        BOOST_ASSERT(SPECIAL_NODEID != node_v);
+        if (node_u > node_v)
         {
-            const EdgeData &edge_data = m_node_based_graph->GetEdgeData(e1);
-            BOOST_ASSERT(e1 != SPECIAL_EDGEID);
-            const NodeID node_v = m_node_based_graph->GetTarget(e1);
-
-            BOOST_ASSERT(SPECIAL_NODEID != node_v);
-            // pick only every other edge, since we have every edge as an outgoing
-            // and incoming egde
-            if (node_u > node_v)
-            {
-                continue;
-            }
-
-            BOOST_ASSERT(node_u < node_v);
-
-            // if we found a non-forward edge reverse and try again
-            if (edge_data.edge_id == SPECIAL_NODEID)
-            {
-                InsertEdgeBasedNode(node_v, node_u);
-            }
-            else
-            {
-                InsertEdgeBasedNode(node_u, node_v);
-            }
+            return false;
         }
-    }
+        BOOST_ASSERT(node_u < node_v);
+
+        // if we found a non-forward edge reverse and try again
+        const bool reversed =
+            m_node_based_graph->GetEdgeData(edge).edge_id == SPECIAL_NODEID;
+        from = reversed ? node_v : node_u;
+        to = reversed ? node_u : node_v;
+        return true;
+    };
+
+    std::vector<std::size_t> node_offsets(number_of_nodes + 1, 0);
+    tbb::parallel_for(tbb::blocked_range<NodeID>(0, number_of_nodes),
+                      [&](const tbb::blocked_range<NodeID> &range)
+                      {
+                          for (NodeID node_u = range.begin(); node_u != range.end(); ++node_u)
+                          {
+                              std::size_t count = 0;
+                              for (const EdgeID edge :
+                                   m_node_based_graph->GetAdjacentEdgeRange(node_u))
+                              {
+                                  NodeID from, to;
+                                  if (get_edge_nodes(node_u, edge, from, to))
+                                  {
+                                      count += GetNumberOfEdgeBasedNodes(from, to);
+                                  }
+                              }
+                              node_offsets[node_u + 1] = count;
+                          }
+                      });
+    std::partial_sum(node_offsets.begin(), node_offsets.end(), node_offsets.begin());
+
+    m_edge_based_node_list.resize(node_offsets.back());
+    tbb::parallel_for(tbb::blocked_range<NodeID>(0, number_of_nodes),
+                      [&](const tbb::blocked_range<NodeID> &range)
+                      {
+                          for (NodeID node_u = range.begin(); node_u != range.end(); ++node_u)
+                          {
+                              EdgeBasedNode *output =
+                                  m_edge_based_node_list.data() + node_offsets[node_u];
+                              for (const EdgeID edge :
+                                   m_node_based_graph->GetAdjacentEdgeRange(node_u))
+                              {
+                                  NodeID from, to;
+                                  if (get_edge_nodes(node_u, edge, from, to))
+                                  {
+                                      output = InsertEdgeBasedNode(from, to, output);
+                                  }
+                              }
+                              BOOST_ASSERT(output ==
+                                           m_edge_based_node_list.data() +
+                                               node_offsets[node_u + 1]);
+                          }
+                      });
 
     SimpleLogger().Write() << "Generated " << m_edge_based_node_list.size()
                            << " nodes in edge-expanded graph";
@@ -317,34 +415,193 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedNodes()
 
 /// Actually it also generates OriginalEdgeData and serializes them...
 void EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(
-    const std::string &original_edge_data_filename, lua_State *lua_state)
+    const std::string &original_edge_data_filename,
+    const std::string &edge_segment_lookup_filename,
+    const LuaStateProvider &get_lua_state)
 {
     SimpleLogger().Write() << "generating edge-expanded edges";
 
     unsigned node_based_edge_counter = 0;
     unsigned original_edges_counter = 0;
+    // runs of consecutive original edges with the same name, osrm-datastore sizes its name id
+    // list by them
+    unsigned name_runs_counter = 0;
+    unsigned last_name_id = 0;
 
     std::ofstream edge_data_file(original_edge_data_filename.c_str(), std::ios::binary);
 
     // writes a dummy value that is updated later
     edge_data_file.write((char *)&original_edges_counter, sizeof(unsigned));
 
-    std::vector<OriginalEdgeData> original_edge_data_vector;
-    original_edge_data_vector.reserve(1024 * 1024);
+    const bool write_edge_segment_lookup = !edge_segment_lookup_filename.empty();
+    std::ofstream edge_segment_lookup_file;
+    if (write_edge_segment_lookup)
+    {
+        edge_segment_lookup_file.open(edge_segment_lookup_filename.c_str(), std::ios::binary);
+        // number of edge-based edges, updated later as well
+        edge_segment_lookup_file.write((char *)&original_edges_counter, sizeof(unsigned));
+    }
 
-    // Loop over all turns and generate new set of edges.
-    // Three nested loop look super-linear, but we are dealing with a (kind of)
-    // linear number of turns only.
     unsigned restricted_turns_counter = 0;
     unsigned skipped_uturns_counter = 0;
     unsigned skipped_barrier_turns_counter = 0;
-    unsigned compressed = 0;
 
-    Percent progress(m_node_based_graph->GetNumberOfNodes());
+    // The turns of consecutive ranges of nodes are expanded in parallel, each into its own
+    // buffer. Merging the buffers in node order yields the same edge ids and files as a
+    // sequential expansion. Only a batch of ranges is buffered at once to bound the memory.
+    constexpr NodeID ExpansionGrainSize = 4096;
+    constexpr unsigned BuffersPerBatch = 128;
+    constexpr NodeID BatchSize = ExpansionGrainSize * BuffersPerBatch;
+
+    // the ids of streamed edges are assigned in the same order, only the list is replaced
+    std::unique_ptr<EdgeBasedEdgeRunWriter> edge_run_writer;
+    if (!m_edge_run_path.empty())
+    {
+        edge_run_writer.reset(new EdgeBasedEdgeRunWriter(m_edge_run_path));
+    }
+
+    const NodeID number_of_nodes = m_node_based_graph->GetNumberOfNodes();
+    std::vector<TurnExpansionBuffer> buffers(BuffersPerBatch);
+    Percent progress(number_of_nodes);
 
-    for (const auto node_u : osrm::irange(0u, m_node_based_graph->GetNumberOfNodes()))
+    for (NodeID batch_begin = 0; batch_begin < number_of_nodes; batch_begin += BatchSize)
+    {
+        const NodeID batch_end = std::min(number_of_nodes, batch_begin + BatchSize);
+        const unsigned number_of_buffers =
+            (batch_end - batch_begin + ExpansionGrainSize - 1) / ExpansionGrainSize;
+
+        tbb::parallel_for(tbb::blocked_range<unsigned>(0, number_of_buffers, 1),
+                          [&](const tbb::blocked_range<unsigned> &range)
+                          {
+                              lua_State *lua_state = get_lua_state();
+                              for (unsigned index = range.begin(); index != range.end(); ++index)
+                              {
+                                  const NodeID first_node =
+                                      batch_begin + index * ExpansionGrainSize;
+                                  const NodeID last_node =
+                                      std::min(batch_end, first_node + ExpansionGrainSize);
+                                  ExpandTurns(first_node, last_node, lua_state,
+                                              write_edge_segment_lookup, buffers[index]);
+                              }
+                          });
+
+        if (edge_run_writer)
+        {
+            NodeID edge_id = original_edges_counter;
+            for (const auto index : osrm::irange(0u, number_of_buffers))
+            {
+                for (EdgeBasedEdge &edge : buffers[index].edges)
+                {
+                    edge.edge_id = edge_id++;
+                    edge_run_writer->push_back(edge);
+                }
+            }
+        }
+        else
+        {
+            // the buckets of the edge list do not move, so every buffer is copied into its own
+            // range of the list in parallel once the list has grown to hold the whole batch
+            std::vector<std::size_t> buffer_offsets(number_of_buffers + 1,
+                                                    m_edge_based_edge_list.size());
+            for (const auto index : osrm::irange(0u, number_of_buffers))
+            {
+                buffer_offsets[index + 1] = buffer_offsets[index] + buffers[index].edges.size();
+            }
+            m_edge_based_edge_list.resize(buffer_offsets.back());
+            tbb::parallel_for(tbb::blocked_range<unsigned>(0, number_of_buffers, 1),
+                              [&](const tbb::blocked_range<unsigned> &range)
+                              {
+                                  for (unsigned index = range.begin(); index != range.end();
+                                       ++index)
+                                  {
+                                      std::size_t edge_id = buffer_offsets[index];
+                                      for (EdgeBasedEdge &edge : buffers[index].edges)
+                                      {
+                                          edge.edge_id = static_cast<NodeID>(edge_id);
+                                          m_edge_based_edge_list[edge_id] = edge;
+                                          ++edge_id;
+                                      }
+                                  }
+                              });
+        }
+
+        for (const auto index : osrm::irange(0u, number_of_buffers))
+        {
+            TurnExpansionBuffer &buffer = buffers[index];
+            BOOST_ASSERT(buffer.edges.size() == buffer.original_edge_data.size());
+
+            for (const OriginalEdgeData &edge_data : buffer.original_edge_data)
+            {
+                if (0 == name_runs_counter || edge_data.name_id != last_name_id)
+                {
+                    ++name_runs_counter;
+                }
+                last_name_id = edge_data.name_id;
+            }
+            original_edges_counter += buffer.edges.size();
+            FlushVectorToStream(edge_data_file, buffer.original_edge_data);
+            if (write_edge_segment_lookup && !buffer.edge_segment_lookup.empty())
+            {
+                edge_segment_lookup_file.write(buffer.edge_segment_lookup.data(),
+                                               buffer.edge_segment_lookup.size());
+            }
+
+            node_based_edge_counter += buffer.node_based_edges;
+            restricted_turns_counter += buffer.restricted_turns;
+            skipped_uturns_counter += buffer.skipped_uturns;
+            skipped_barrier_turns_counter += buffer.skipped_barrier_turns;
+            buffer = TurnExpansionBuffer();
+        }
+        progress.printStatus(batch_end - 1);
+    }
+
+    if (edge_run_writer)
+    {
+        edge_run_writer->Close();
+    }
+
+    edge_data_file.write((char *)&name_runs_counter, sizeof(unsigned));
+    edge_data_file.seekp(std::ios::beg);
+    edge_data_file.write((char *)&original_edges_counter, sizeof(unsigned));
+    edge_data_file.close();
+
+    if (write_edge_segment_lookup)
+    {
+        edge_segment_lookup_file.seekp(std::ios::beg);
+        edge_segment_lookup_file.write((char *)&original_edges_counter, sizeof(unsigned));
+        edge_segment_lookup_file.close();
+    }
+
+    SimpleLogger().Write() << "Generated " << m_edge_based_node_list.size() << " edge based nodes";
+    SimpleLogger().Write() << "Node-based graph contains " << node_based_edge_counter << " edges";
+    SimpleLogger().Write() << "Edge-expanded graph ...";
+    SimpleLogger().Write() << "  contains " << original_edges_counter << " edges";
+    SimpleLogger().Write() << "  skips " << restricted_turns_counter << " turns, "
+                                                                        "defined by "
+                           << m_restriction_index->size() << " restrictions";
+    SimpleLogger().Write() << "  skips " << skipped_uturns_counter << " U turns";
+    SimpleLogger().Write() << "  skips " << skipped_barrier_turns_counter << " turns over barriers";
+}
+
+/// Expands the turns at the targets of the edges leaving the nodes in [first_node, last_node).
+/// Only reads the shared state and may be called concurrently with distinct buffers.
+void EdgeBasedGraphFactory::ExpandTurns(const NodeID first_node,
+                                        const NodeID last_node,
+                                        lua_State *lua_state,
+                                        const bool write_edge_segment_lookup,
+                                        TurnExpansionBuffer &buffer) const
+{
+    const auto append_to_lookup = [&buffer](const void *data, const std::size_t size)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        buffer.edge_segment_lookup.insert(buffer.edge_segment_lookup.end(), bytes, bytes + size);
+    };
+
+    // Loop over all turns and generate new set of edges.
+    // Three nested loop look super-linear, but we are dealing with a (kind of)
+    // linear number of turns only.
+    for (const auto node_u : osrm::irange(first_node, last_node))
     {
-        progress.printStatus(node_u);
         for (const EdgeID e1 : m_node_based_graph->GetAdjacentEdgeRange(node_u))
         {
             if (m_node_based_graph->GetEdgeData(e1).reversed)
@@ -352,10 +609,10 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(
                 continue;
             }
 
-            ++node_based_edge_counter;
+            ++buffer.node_based_edges;
             const NodeID node_v = m_node_based_graph->GetTarget(e1);
             const NodeID only_restriction_to_node =
-                m_restriction_map->CheckForEmanatingIsOnlyTurn(node_u, node_v);
+                m_restriction_index->CheckForEmanatingIsOnlyTurn(node_u, node_v);
             const bool is_barrier_node = m_barrier_nodes.find(node_v) != m_barrier_nodes.end();
 
             for (const EdgeID e2 : m_node_based_graph->GetAdjacentEdgeRange(node_v))
@@ -370,7 +627,7 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(
                     (node_w != only_restriction_to_node))
                 {
                     // We are at an only_-restriction but not at the right turn.
-                    ++restricted_turns_counter;
+                    ++buffer.restricted_turns;
                     continue;
                 }
 
@@ -378,7 +635,7 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(
                 {
                     if (node_u != node_w)
                     {
-                        ++skipped_barrier_turns_counter;
+                        ++buffer.skipped_barrier_turns;
                         continue;
                     }
                 }
@@ -386,19 +643,19 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(
                 {
                     if ((node_u == node_w) && (m_node_based_graph->GetOutDegree(node_v) > 1))
                     {
-                        ++skipped_uturns_counter;
+                        ++buffer.skipped_uturns;
                         continue;
                     }
                 }
 
                 // only add an edge if turn is not a U-turn except when it is
                 // at the end of a dead-end street
-                if (m_restriction_map->CheckIfTurnIsRestricted(node_u, node_v, node_w) &&
+                if (m_restriction_index->CheckIfTurnIsRestricted(node_u, node_v, node_w) &&
                     (only_restriction_to_node == SPECIAL_NODEID) &&
                     (node_w != only_restriction_to_node))
                 {
                     // We are at an only_-restriction but not at the right turn.
-                    ++restricted_turns_counter;
+                    ++buffer.restricted_turns;
                     continue;
                 }
 
@@ -417,23 +674,12 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(
                     distance += speed_profile.traffic_signal_penalty;
                 }
 
-                // unpack last node of first segment if packed
-                const auto first_coordinate =
-                    m_node_info_list[(m_compressed_edge_container.HasEntryForID(e1)
-                                          ? m_compressed_edge_container.GetLastEdgeSourceID(e1)
-                                          : node_u)];
-
-                // unpack first node of second segment if packed
-                const auto third_coordinate =
-                    m_node_info_list[(m_compressed_edge_container.HasEntryForID(e2)
-                                          ? m_compressed_edge_container.GetFirstEdgeTargetID(e2)
-                                          : node_w)];
-
-                const double turn_angle = ComputeAngle::OfThreeFixedPointCoordinates(
-                    first_coordinate, m_node_info_list[node_v], third_coordinate);
+                const double turn_angle = ComputeAngle::OfDirections(
+                    m_edge_directions[e1].at_target, m_edge_directions[e2].at_source);
 
                 const int turn_penalty = GetTurnPenalty(turn_angle, lua_state);
-                TurnInstruction turn_instruction = AnalyzeTurn(node_u, node_v, node_w, turn_angle);
+                TurnInstruction turn_instruction =
+                    AnalyzeTurn(node_u, e1, node_v, e2, node_w, turn_angle);
                 if (turn_instruction == TurnInstruction::UTurn)
                 {
                     distance += speed_profile.u_turn_penalty;
@@ -442,50 +688,132 @@ void EdgeBasedGraphFactory::GenerateEdgeExpandedEdges(
 
                 const bool edge_is_compressed = m_compressed_edge_container.HasEntryForID(e1);
 
-                if (edge_is_compressed)
-                {
-                    ++compressed;
-                }
-
-                original_edge_data_vector.emplace_back(
+                buffer.original_edge_data.emplace_back(
                     (edge_is_compressed ? m_compressed_edge_container.GetPositionForID(e1) : node_v),
                     edge_data1.name_id, turn_instruction, edge_is_compressed,
                     edge_data2.travel_mode);
 
-                ++original_edges_counter;
+                BOOST_ASSERT(SPECIAL_NODEID != edge_data1.edge_id);
+                BOOST_ASSERT(SPECIAL_NODEID != edge_data2.edge_id);
 
-                if (original_edge_data_vector.size() > 1024 * 1024 * 10)
+                if (write_edge_segment_lookup)
                 {
-                    FlushVectorToStream(edge_data_file, original_edge_data_vector);
+                    const EdgeSegmentLookupHeader header = {
+                        static_cast<EdgeWeight>(distance) - edge_data1.distance, node_u,
+                        edge_is_compressed
+                            ? static_cast<unsigned>(
+                                  m_compressed_edge_container.GetBucketReference(e1).size())
+                            : 1u};
+                    append_to_lookup(&header, sizeof(header));
+                    if (edge_is_compressed)
+                    {
+                        const auto &bucket = m_compressed_edge_container.GetBucketReference(e1);
+                        append_to_lookup(bucket.data(), sizeof(EdgeSegment) * bucket.size());
+                    }
+                    else
+                    {
+                        const EdgeSegment segment(node_v, edge_data1.distance);
+                        append_to_lookup(&segment, sizeof(segment));
+                    }
                 }
 
-                BOOST_ASSERT(SPECIAL_NODEID != edge_data1.edge_id);
-                BOOST_ASSERT(SPECIAL_NODEID != edge_data2.edge_id);
-
-                m_edge_based_edge_list.emplace_back(edge_data1.edge_id, edge_data2.edge_id,
-                                  m_edge_based_edge_list.size(), distance, true, false);
+                buffer.edges.emplace_back(edge_data1.edge_id, edge_data2.edge_id, SPECIAL_EDGEID,
+                                          distance, true, false, GetEdgeLength(node_u, e1));
             }
         }
     }
-    FlushVectorToStream(edge_data_file, original_edge_data_vector);
+}
 
-    edge_data_file.seekp(std::ios::beg);
-    edge_data_file.write((char *)&original_edges_counter, sizeof(unsigned));
-    edge_data_file.close();
+void EdgeBasedGraphFactory::ComputeEdgeDirections()
+{
+    const NodeID number_of_nodes = m_node_based_graph->GetNumberOfNodes();
+    EdgeID end_of_edges = 0;
+    for (const auto node : osrm::irange(0u, number_of_nodes))
+    {
+        end_of_edges = std::max(end_of_edges, m_node_based_graph->EndEdges(node));
+    }
+    m_edge_directions.resize(end_of_edges);
 
-    SimpleLogger().Write() << "Generated " << m_edge_based_node_list.size() << " edge based nodes";
-    SimpleLogger().Write() << "Node-based graph contains " << node_based_edge_counter << " edges";
-    SimpleLogger().Write() << "Edge-expanded graph ...";
-    SimpleLogger().Write() << "  contains " << m_edge_based_edge_list.size() << " edges";
-    SimpleLogger().Write() << "  skips " << restricted_turns_counter << " turns, "
-                                                                        "defined by "
-                           << m_restriction_map->size() << " restrictions";
-    SimpleLogger().Write() << "  skips " << skipped_uturns_counter << " U turns";
-    SimpleLogger().Write() << "  skips " << skipped_barrier_turns_counter << " turns over barriers";
+    tbb::parallel_for(
+        tbb::blocked_range<NodeID>(0, number_of_nodes),
+        [&](const tbb::blocked_range<NodeID> &range)
+        {
+            for (auto node_u = range.begin(); node_u != range.end(); ++node_u)
+            {
+                for (const EdgeID edge : m_node_based_graph->GetAdjacentEdgeRange(node_u))
+                {
+                    if (m_node_based_graph->GetEdgeData(edge).reversed)
+                    {
+                        continue;
+                    }
+                    const NodeID node_v = m_node_based_graph->GetTarget(edge);
+                    const bool is_compressed = m_compressed_edge_container.HasEntryForID(edge);
+
+                    // unpack the inner nodes of the first and the last segment if packed
+                    const NodeID next_node =
+                        is_compressed ? m_compressed_edge_container.GetFirstEdgeTargetID(edge)
+                                      : node_v;
+                    const NodeID previous_node =
+                        is_compressed ? m_compressed_edge_container.GetLastEdgeSourceID(edge)
+                                      : node_u;
+
+                    m_edge_directions[edge].at_source = ComputeAngle::DirectionOf(
+                        m_node_info_list[node_u], m_node_info_list[next_node]);
+                    m_edge_directions[edge].at_target = ComputeAngle::DirectionOf(
+                        m_node_info_list[node_v], m_node_info_list[previous_node]);
+                }
+            }
+        });
+}
+
+// the turn function is sampled at this resolution and linearly interpolated in between
+constexpr unsigned TurnPenaltySamplesPerDegree = 10;
+
+void EdgeBasedGraphFactory::TabulateTurnPenalties(lua_State *lua_state)
+{
+    // the turn function takes the deviation from going straight in [-180, 180]
+    std::vector<double> table(360 * TurnPenaltySamplesPerDegree + 1);
+    try
+    {
+        for (const auto sample : osrm::irange<std::size_t>(0, table.size()))
+        {
+            const double deviation =
+                -180. + static_cast<double>(sample) / TurnPenaltySamplesPerDegree;
+            table[sample] =
+                luabind::call_function<double>(lua_state, "turn_function", deviation);
+        }
+    }
+    catch (const luabind::error &er)
+    {
+        SimpleLogger().Write(logWARNING) << er.what();
+        SimpleLogger().Write(logWARNING) << "calling the turn function for every turn";
+        return;
+    }
+    m_turn_penalty_table = std::move(table);
+    SimpleLogger().Write() << "tabulated turn function with " << m_turn_penalty_table.size()
+                           << " samples";
 }
 
 int EdgeBasedGraphFactory::GetTurnPenalty(double angle, lua_State *lua_state) const
 {
+    if (!m_turn_penalty_table.empty())
+    {
+        const double deviation = 180. - angle;
+        const double position =
+            std::min(std::max(0., (deviation + 180.) * TurnPenaltySamplesPerDegree),
+                     static_cast<double>(m_turn_penalty_table.size() - 1));
+        const std::size_t sample =
+            std::min(static_cast<std::size_t>(position), m_turn_penalty_table.size() - 2);
+        const double fraction = position - sample;
+        return static_cast<int>(m_turn_penalty_table[sample] +
+                                fraction * (m_turn_penalty_table[sample + 1] -
+                                            m_turn_penalty_table[sample]));
+    }
+
+    if (speed_profile.has_turn_penalty_function && nullptr != m_native_profile)
+    {
+        return static_cast<int>(m_native_profile->GetTurnPenalty(180. - angle));
+    }
 
     if (speed_profile.has_turn_penalty_function)
     {
@@ -504,7 +832,9 @@ int EdgeBasedGraphFactory::GetTurnPenalty(double angle, lua_State *lua_state) co
 }
 
 TurnInstruction EdgeBasedGraphFactory::AnalyzeTurn(const NodeID node_u,
+                                                   const EdgeID edge1,
                                                    const NodeID node_v,
+                                                   const EdgeID edge2,
                                                    const NodeID node_w,
                                                    const double angle) const
 {
@@ -513,9 +843,6 @@ TurnInstruction EdgeBasedGraphFactory::AnalyzeTurn(const NodeID node_u,
         return TurnInstruction::UTurn;
     }
 
-    const EdgeID edge1 = m_node_based_graph->FindEdge(node_u, node_v);
-    const EdgeID edge2 = m_node_based_graph->FindEdge(node_v, node_w);
-
     const EdgeData &data1 = m_node_based_graph->GetEdgeData(edge1);
     const EdgeData &data2 = m_node_based_graph->GetEdgeData(edge2);
 
@@ -42,6 +42,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/restriction_map.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <iosfwd>
 #include <memory>
 #include <queue>
@@ -51,6 +53,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 
 struct lua_State;
+class NativeProfile;
 
 class EdgeBasedGraphFactory
 {
@@ -62,12 +65,25 @@ class EdgeBasedGraphFactory
                                    const CompressedEdgeContainer &compressed_edge_container,
                                    const std::unordered_set<NodeID> &barrier_nodes,
                                    const std::unordered_set<NodeID> &traffic_lights,
-                                   std::shared_ptr<const RestrictionMap> restriction_map,
+                                   std::shared_ptr<const RestrictionIndex> restriction_index,
                                    const std::vector<QueryNode> &node_info_list,
                                    SpeedProfileProperties speed_profile);
 
+    // returns the lua state of the calling thread, turns are expanded concurrently
+    using LuaStateProvider = std::function<lua_State *()>;
+
+    // takes the turn penalties from a native profile instead of the lua turn_function, the
+    // lua states are then never asked for
+    void SetNativeProfile(const NativeProfile *profile) { m_native_profile = profile; }
+
+    // writes the edge-based edges to a run file instead of keeping them, see
+    // EdgeBasedEdgeRun, GetEdgeBasedEdges then returns no edges
+    void SetEdgeRunPath(const std::string &path) { m_edge_run_path = path; }
+
+    // the segments of the edge-based edges are only written if a lookup file name is given
     void Run(const std::string &original_edge_data_filename,
-             lua_State *lua_state);
+             const std::string &edge_segment_lookup_filename,
+             const LuaStateProvider &get_lua_state);
 
     void GetEdgeBasedEdges(DeallocatingVector<EdgeBasedEdge> &edges);
 
@@ -75,34 +91,87 @@ class EdgeBasedGraphFactory
 
     unsigned GetHighestEdgeID();
 
-    TurnInstruction AnalyzeTurn(const NodeID u, const NodeID v, const NodeID w, const double angle) const;
+    TurnInstruction AnalyzeTurn(const NodeID u,
+                                const EdgeID e1,
+                                const NodeID v,
+                                const EdgeID e2,
+                                const NodeID w,
+                                const double angle) const;
 
     int GetTurnPenalty(double angle, lua_State *lua_state) const;
 
   private:
     using EdgeData = NodeBasedDynamicGraph::EdgeData;
 
+    // output of the turn expansion of a range of node-based nodes
+    struct TurnExpansionBuffer
+    {
+        TurnExpansionBuffer()
+            : node_based_edges(0), restricted_turns(0), skipped_uturns(0),
+              skipped_barrier_turns(0)
+        {
+        }
+
+        // the ids of the edges are assigned when the buffers are merged
+        std::vector<EdgeBasedEdge> edges;
+        std::vector<OriginalEdgeData> original_edge_data;
+        std::vector<char> edge_segment_lookup;
+        unsigned node_based_edges;
+        unsigned restricted_turns;
+        unsigned skipped_uturns;
+        unsigned skipped_barrier_turns;
+    };
+
+    // directions at both ends of a node-based edge, see ComputeAngle::DirectionOf
+    struct EdgeDirections
+    {
+        // from the source to the next node of the geometry
+        std::uint16_t at_source;
+        // from the target back to the previous node of the geometry
+        std::uint16_t at_target;
+    };
+
     std::vector<EdgeBasedNode> m_edge_based_node_list;
     DeallocatingVector<EdgeBasedEdge> m_edge_based_edge_list;
     unsigned m_max_edge_id;
 
     const std::vector<QueryNode>& m_node_info_list;
     std::shared_ptr<NodeBasedDynamicGraph> m_node_based_graph;
-    std::shared_ptr<RestrictionMap const> m_restriction_map;
+    std::shared_ptr<const RestrictionIndex> m_restriction_index;
 
     const std::unordered_set<NodeID>& m_barrier_nodes;
     const std::unordered_set<NodeID>& m_traffic_lights;
     const CompressedEdgeContainer& m_compressed_edge_container;
 
     SpeedProfileProperties speed_profile;
+    const NativeProfile *m_native_profile;
+    std::string m_edge_run_path;
+    // samples of the turn function, empty if it is called for every turn
+    std::vector<double> m_turn_penalty_table;
+    // indexed by the edge ids of the node-based graph, only filled during the turn expansion
+    std::vector<EdgeDirections> m_edge_directions;
 
     void CompressGeometry();
+    void TabulateTurnPenalties(lua_State *lua_state);
+    void ComputeEdgeDirections();
     unsigned RenumberEdges();
     void GenerateEdgeExpandedNodes();
     void GenerateEdgeExpandedEdges(const std::string &original_edge_data_filename,
-                                   lua_State *lua_state);
-
-    void InsertEdgeBasedNode(const NodeID u, const NodeID v);
+                                   const std::string &edge_segment_lookup_filename,
+                                   const LuaStateProvider &get_lua_state);
+    void ExpandTurns(const NodeID first_node,
+                     const NodeID last_node,
+                     lua_State *lua_state,
+                     const bool write_edge_segment_lookup,
+                     TurnExpansionBuffer &buffer) const;
+
+    // number of edge-based nodes that InsertEdgeBasedNode writes for the edge from u to v
+    unsigned GetNumberOfEdgeBasedNodes(const NodeID u, const NodeID v) const;
+    // writes the edge-based nodes of the edge from u to v to output, returns their end
+    EdgeBasedNode *InsertEdgeBasedNode(const NodeID u, const NodeID v, EdgeBasedNode *output) const;
+
+    // length of the geometry of a node-based edge in decimeters
+    unsigned GetEdgeLength(const NodeID u, const EdgeID edge) const;
 
     void FlushVectorToStream(std::ofstream &edge_data_file,
                              std::vector<OriginalEdgeData> &original_edge_data_vector) const;
@@ -29,12 +29,21 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "contractor.hpp"
 #include "../algorithms/graph_compressor.hpp"
-#include "../algorithms/tarjan_scc.hpp"
+#include "../algorithms/parallel_scc.hpp"
 #include "../algorithms/crc32_processor.hpp"
+#include "../algorithms/coordinate_calculation.hpp"
+#include "../algorithms/hierarchy_node_order.hpp"
+#include "../algorithms/region_partition.hpp"
 #include "../data_structures/compressed_edge_container.hpp"
 #include "../data_structures/deallocating_vector.hpp"
+#include "../data_structures/edge_based_edge_run.hpp"
+#include "../data_structures/hilbert_value.hpp"
+#include "../data_structures/landmark_table.hpp"
 #include "../data_structures/static_rtree.hpp"
 #include "../data_structures/restriction_map.hpp"
+#include "../data_structures/static_kdtree.hpp"
+#include "../extractor/native_profile.hpp"
+#include "../server/data_structures/dataset_builder.hpp"
 
 #include "../util/graph_loader.hpp"
 #include "../util/integer_range.hpp"
@@ -48,10 +57,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/filesystem/fstream.hpp>
 #include <boost/program_options.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 #include <tbb/parallel_sort.h>
 
 #include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
@@ -65,7 +79,7 @@ int Prepare::Run()
 #else
     static_assert(sizeof(NodeBasedEdge) == 20,
                   "changing NodeBasedEdge type has influence on memory consumption!");
-    static_assert(sizeof(EdgeBasedEdge) == 16,
+    static_assert(sizeof(EdgeBasedEdge) == 20,
                   "changing EdgeBasedEdge type has influence on memory consumption!");
 #endif
 
@@ -88,14 +102,17 @@ int Prepare::Run()
 
     TIMER_STOP(expansion);
 
-    SimpleLogger().Write() << "building r-tree ...";
-    TIMER_START(rtree);
-
-    FindComponents(max_edge_id, edge_based_edge_list, node_based_edge_list);
-
-    BuildRTree(node_based_edge_list, internal_to_external_node_map);
-
-    TIMER_STOP(rtree);
+    // streamed edges are read back from the run file, which is removed once they are contracted
+    std::unique_ptr<EdgeBasedEdgeRun> edge_based_edge_run;
+    if (config.stream_edge_based_edges)
+    {
+        edge_based_edge_run.reset(new EdgeBasedEdgeRun(config.edge_run_output_path));
+        FindComponents(max_edge_id, *edge_based_edge_run, node_based_edge_list);
+    }
+    else
+    {
+        FindComponents(max_edge_id, edge_based_edge_list, node_based_edge_list);
+    }
 
     SimpleLogger().Write() << "writing node map ...";
     WriteNodeMapping(internal_to_external_node_map);
@@ -103,17 +120,71 @@ int Prepare::Run()
     // Contracting the edge-expanded graph
 
     TIMER_START(contraction);
+    std::vector<bool> is_boundary_node;
+    if (config.number_of_regions > 1)
+    {
+        SimpleLogger().Write() << "partitioning into " << config.number_of_regions
+                               << " regions ...";
+        const std::vector<unsigned> regions = PartitionByLocation(
+            ComputeNodeLocations(max_edge_id + 1, internal_to_external_node_map,
+                                 node_based_edge_list),
+            config.number_of_regions);
+        is_boundary_node = edge_based_edge_run
+                               ? FindBoundaryNodes(regions, *edge_based_edge_run)
+                               : FindBoundaryNodes(regions, edge_based_edge_list);
+        SimpleLogger().Write() << std::count(is_boundary_node.begin(), is_boundary_node.end(),
+                                             true)
+                               << " nodes are on the boundary of a region";
+    }
     std::vector<bool> is_core_node;
+    std::vector<float> node_levels;
     DeallocatingVector<QueryEdge> contracted_edge_list;
-    ContractGraph(max_edge_id, edge_based_edge_list, contracted_edge_list, is_core_node);
+    if (edge_based_edge_run)
+    {
+        ContractGraph(max_edge_id, *edge_based_edge_run, contracted_edge_list, is_core_node,
+                      node_levels, std::move(is_boundary_node));
+        edge_based_edge_run.reset();
+    }
+    else
+    {
+        ContractGraph(max_edge_id, edge_based_edge_list, contracted_edge_list, is_core_node,
+                      node_levels, std::move(is_boundary_node));
+    }
     TIMER_STOP(contraction);
 
     SimpleLogger().Write() << "Contraction took " << TIMER_SEC(contraction) << " sec";
 
+    if (config.renumber_nodes)
+    {
+        SimpleLogger().Write() << "renumbering nodes by level and location ...";
+        RenumberNodes(node_levels, internal_to_external_node_map, node_based_edge_list,
+                      contracted_edge_list, is_core_node);
+    }
+    node_levels.clear();
+    node_levels.shrink_to_fit();
+
+    // the r-tree is built after the contraction, as it stores the (renumbered) node ids
+    SimpleLogger().Write() << "building r-tree ...";
+    TIMER_START(rtree);
+    BuildRTree(node_based_edge_list, internal_to_external_node_map);
+    TIMER_STOP(rtree);
+
+    if (config.number_of_landmarks > 0)
+    {
+        SimpleLogger().Write() << "selecting " << config.number_of_landmarks << " core landmarks ...";
+        BuildLandmarks(contracted_edge_list, is_core_node);
+    }
+
     std::size_t number_of_used_edges =
         WriteContractedGraph(max_edge_id, node_based_edge_list, contracted_edge_list);
     WriteCoreNodeMarker(std::move(is_core_node));
 
+    if (config.build_dataset_image)
+    {
+        SimpleLogger().Write() << "writing dataset image ...";
+        BuildDatasetImage();
+    }
+
     TIMER_STOP(preparing);
 
     SimpleLogger().Write() << "Preprocessing : " << TIMER_SEC(preparing) << " seconds";
@@ -130,8 +201,9 @@ int Prepare::Run()
     return 0;
 }
 
+template <class EdgeContainerT>
 void Prepare::FindComponents(unsigned max_edge_id,
-                             const DeallocatingVector<EdgeBasedEdge> &input_edge_list,
+                             const EdgeContainerT &input_edge_list,
                              std::vector<EdgeBasedNode> &input_nodes) const
 {
     struct UncontractedEdgeData
@@ -188,7 +260,7 @@ void Prepare::FindComponents(unsigned max_edge_id,
 
     auto uncontractor_graph = std::make_shared<UncontractedGraph>(max_edge_id + 1, edges);
 
-    TarjanSCC<UncontractedGraph> component_search(
+    ParallelSCC<UncontractedGraph> component_search(
         std::const_pointer_cast<const UncontractedGraph>(uncontractor_graph));
     component_search.run();
 
@@ -222,6 +294,37 @@ void Prepare::WriteCoreNodeMarker(std::vector<bool> &&in_is_core_node) const
                                     sizeof(char) * unpacked_bool_flags.size());
 }
 
+// Lays out the files written by osrm-extract and by this run as osrm-datastore would, the
+// optional blocks are only included if they were built now and cannot be stale.
+void Prepare::BuildDatasetImage() const
+{
+    const std::string base = config.osrm_input_path.string();
+    ServerPaths server_paths;
+    server_paths["hsgrdata"] = config.graph_output_path;
+    server_paths["nodesdata"] = config.node_output_path;
+    server_paths["edgesdata"] = config.edge_output_path;
+    server_paths["geometry"] = config.geometry_output_path;
+    server_paths["ramindex"] = config.rtree_nodes_output_path;
+    server_paths["fileindex"] = config.rtree_leafs_output_path;
+    server_paths["core"] = config.core_output_path;
+    server_paths["namesdata"] = base + ".names";
+    server_paths["timestamp"] = base + ".timestamp";
+    if (config.build_segment_grid)
+    {
+        server_paths["gridindex"] = config.segment_grid_output_path;
+    }
+    if (config.build_locate_index)
+    {
+        server_paths["locateindex"] = config.locate_index_output_path;
+    }
+    if (config.number_of_landmarks > 0)
+    {
+        server_paths["landmarks"] = config.landmark_output_path;
+    }
+
+    WriteDatasetImage(server_paths, false, config.image_output_path);
+}
+
 std::size_t Prepare::WriteContractedGraph(unsigned max_node_id,
                                           const std::vector<EdgeBasedNode> &node_based_edge_list,
                                           const DeallocatingVector<QueryEdge> &contracted_edge_list)
@@ -234,55 +337,96 @@ std::size_t Prepare::WriteContractedGraph(unsigned max_node_id,
     SimpleLogger().Write() << "Serializing compacted graph of " << contracted_edge_count
                            << " edges";
 
-    const FingerPrint fingerprint = FingerPrint::GetValid();
-    boost::filesystem::ofstream hsgr_output_stream(config.graph_output_path, std::ios::binary);
-    hsgr_output_stream.write((char *)&fingerprint, sizeof(FingerPrint));
-    const unsigned max_used_node_id = [&contracted_edge_list]
-    {
-        unsigned tmp_max = 0;
-        for (const QueryEdge &edge : contracted_edge_list)
+    using NodeArrayEntry = StaticGraph<EdgeData>::NodeArrayEntry;
+    using EdgeArrayEntry = StaticGraph<EdgeData>::EdgeArrayEntry;
+
+    const unsigned max_used_node_id = tbb::parallel_reduce(
+        tbb::blocked_range<std::size_t>(0, contracted_edge_count), 0u,
+        [&contracted_edge_list](const tbb::blocked_range<std::size_t> &range, unsigned tmp_max)
         {
-            BOOST_ASSERT(SPECIAL_NODEID != edge.source);
-            BOOST_ASSERT(SPECIAL_NODEID != edge.target);
-            tmp_max = std::max(tmp_max, edge.source);
-            tmp_max = std::max(tmp_max, edge.target);
-        }
-        return tmp_max;
-    }();
+            for (const auto edge : osrm::irange(range.begin(), range.end()))
+            {
+                BOOST_ASSERT(SPECIAL_NODEID != contracted_edge_list[edge].source);
+                BOOST_ASSERT(SPECIAL_NODEID != contracted_edge_list[edge].target);
+                tmp_max = std::max(tmp_max, contracted_edge_list[edge].source);
+                tmp_max = std::max(tmp_max, contracted_edge_list[edge].target);
+            }
+            return tmp_max;
+        },
+        [](const unsigned lhs, const unsigned rhs)
+        {
+            return std::max(lhs, rhs);
+        });
 
     SimpleLogger().Write(logDEBUG) << "input graph has " << (max_node_id + 1) << " nodes";
     SimpleLogger().Write(logDEBUG) << "contracted graph has " << (max_used_node_id + 1) << " nodes";
 
-    std::vector<StaticGraph<EdgeData>::NodeArrayEntry> node_array;
-    // make sure we have at least one sentinel
-    node_array.resize(max_node_id + 2);
-
-    SimpleLogger().Write() << "Building node array";
-    StaticGraph<EdgeData>::EdgeIterator edge = 0;
-    StaticGraph<EdgeData>::EdgeIterator position = 0;
-    StaticGraph<EdgeData>::EdgeIterator last_edge;
-
-    // initializing 'first_edge'-field of nodes:
-    for (const auto node : osrm::irange(0u, max_used_node_id + 1))
+#ifndef NDEBUG
+    for (const auto edge : osrm::irange<std::size_t>(0, contracted_edge_count))
     {
-        last_edge = edge;
-        while ((edge < contracted_edge_count) && (contracted_edge_list[edge].source == node))
+        // no eigen loops
+        BOOST_ASSERT(contracted_edge_list[edge].source != contracted_edge_list[edge].target);
+        if (contracted_edge_list[edge].data.distance <= 0)
         {
-            ++edge;
+            SimpleLogger().Write(logWARNING) << "Edge: " << edge
+                                             << ",source: " << contracted_edge_list[edge].source
+                                             << ", target: " << contracted_edge_list[edge].target
+                                             << ", dist: "
+                                             << contracted_edge_list[edge].data.distance;
+
+            SimpleLogger().Write(logWARNING) << "Failed at adjacency list of node "
+                                             << contracted_edge_list[edge].source << "/"
+                                             << max_node_id + 1;
+            return 1;
         }
-        node_array[node].first_edge = position; //=edge
-        position += edge - last_edge;           // remove
     }
+#endif
 
-    for (const auto sentinel_counter :
-         osrm::irange<unsigned>(max_used_node_id + 1, node_array.size()))
-    {
-        // sentinel element, guarded against underflow
-        node_array[sentinel_counter].first_edge = contracted_edge_count;
-    }
+    // make sure we have at least one sentinel
+    std::vector<NodeArrayEntry> node_array(max_node_id + 2);
+
+    SimpleLogger().Write() << "Building node array";
+    // The edges are sorted by source, every position at which the source changes is the first
+    // edge of the new source and of all the nodes in between that have no edges. Nodes behind
+    // the last source, including the sentinel, point to the end of the edge array.
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, contracted_edge_count),
+        [&contracted_edge_list, &node_array](const tbb::blocked_range<std::size_t> &range)
+        {
+            for (const auto edge : osrm::irange(range.begin(), range.end()))
+            {
+                const NodeID source = contracted_edge_list[edge].source;
+                if (edge != 0 && contracted_edge_list[edge - 1].source == source)
+                {
+                    continue;
+                }
+                const NodeID first_node =
+                    edge == 0 ? 0 : contracted_edge_list[edge - 1].source + 1;
+                for (const auto node : osrm::irange<std::size_t>(first_node, source + 1))
+                {
+                    node_array[node].first_edge = static_cast<EdgeID>(edge);
+                }
+            }
+        });
+    const std::size_t first_node_without_edges =
+        contracted_edge_count == 0 ? 0 : contracted_edge_list.back().source + 1;
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(first_node_without_edges, node_array.size()),
+                      [&node_array, contracted_edge_count](
+                          const tbb::blocked_range<std::size_t> &range)
+                      {
+                          for (const auto node : osrm::irange(range.begin(), range.end()))
+                          {
+                              // sentinel element, guarded against underflow
+                              node_array[node].first_edge = contracted_edge_count;
+                          }
+                      });
 
     SimpleLogger().Write() << "Serializing node array";
 
+    const FingerPrint fingerprint = FingerPrint::GetValid();
+    boost::filesystem::ofstream hsgr_output_stream(config.graph_output_path, std::ios::binary);
+    hsgr_output_stream.write((char *)&fingerprint, sizeof(FingerPrint));
+
     const unsigned node_array_size = node_array.size();
     // serialize crc32, aka checksum
     hsgr_output_stream.write((char *)&crc32_value, sizeof(unsigned));
@@ -291,47 +435,36 @@ std::size_t Prepare::WriteContractedGraph(unsigned max_node_id,
     // serialize number of edges
     hsgr_output_stream.write((char *)&contracted_edge_count, sizeof(unsigned));
     // serialize all nodes
-    if (node_array_size > 0)
-    {
-        hsgr_output_stream.write((char *)&node_array[0],
-                                 sizeof(StaticGraph<EdgeData>::NodeArrayEntry) * node_array_size);
-    }
+    hsgr_output_stream.write((char *)node_array.data(), sizeof(NodeArrayEntry) * node_array_size);
 
-    // serialize all edges
+    // serialize all edges, the edge array is built in parallel chunks of bounded size so that
+    // each chunk goes to the file in one large write
     SimpleLogger().Write() << "Building edge array";
-    int number_of_used_edges = 0;
-
-    StaticGraph<EdgeData>::EdgeArrayEntry current_edge;
-    for (const auto edge : osrm::irange<std::size_t>(0, contracted_edge_list.size()))
+    const constexpr std::size_t EDGE_ARRAY_CHUNK_SIZE = 4 * 1024 * 1024;
+    std::vector<EdgeArrayEntry> edge_array_chunk(
+        std::min<std::size_t>(EDGE_ARRAY_CHUNK_SIZE, contracted_edge_count));
+    for (std::size_t chunk_begin = 0; chunk_begin < contracted_edge_count;
+         chunk_begin += EDGE_ARRAY_CHUNK_SIZE)
     {
-        // no eigen loops
-        BOOST_ASSERT(contracted_edge_list[edge].source != contracted_edge_list[edge].target);
-        current_edge.target = contracted_edge_list[edge].target;
-        current_edge.data = contracted_edge_list[edge].data;
-
-        // every target needs to be valid
-        BOOST_ASSERT(current_edge.target <= max_used_node_id);
-#ifndef NDEBUG
-        if (current_edge.data.distance <= 0)
-        {
-            SimpleLogger().Write(logWARNING) << "Edge: " << edge
-                                             << ",source: " << contracted_edge_list[edge].source
-                                             << ", target: " << contracted_edge_list[edge].target
-                                             << ", dist: " << current_edge.data.distance;
-
-            SimpleLogger().Write(logWARNING) << "Failed at adjacency list of node "
-                                             << contracted_edge_list[edge].source << "/"
-                                             << node_array.size() - 1;
-            return 1;
-        }
-#endif
-        hsgr_output_stream.write((char *)&current_edge,
-                                 sizeof(StaticGraph<EdgeData>::EdgeArrayEntry));
-
-        ++number_of_used_edges;
+        const std::size_t chunk_size =
+            std::min<std::size_t>(EDGE_ARRAY_CHUNK_SIZE, contracted_edge_count - chunk_begin);
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, chunk_size),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+                              for (const auto index : osrm::irange(range.begin(), range.end()))
+                              {
+                                  const QueryEdge &edge = contracted_edge_list[chunk_begin + index];
+                                  // every target needs to be valid
+                                  BOOST_ASSERT(edge.target <= max_used_node_id);
+                                  edge_array_chunk[index].target = edge.target;
+                                  edge_array_chunk[index].data = edge.data;
+                              }
+                          });
+        hsgr_output_stream.write((char *)edge_array_chunk.data(),
+                                 sizeof(EdgeArrayEntry) * chunk_size);
     }
 
-    return number_of_used_edges;
+    return contracted_edge_count;
 }
 
 unsigned Prepare::CalculateEdgeChecksum(const std::vector<EdgeBasedNode> &node_based_edge_list)
@@ -391,6 +524,14 @@ void Prepare::SetupScriptingEnvironment(lua_State *lua_state, SpeedProfileProper
 
     speed_profile.u_turn_penalty = 10 * lua_tointeger(lua_state, -1);
     speed_profile.has_turn_penalty_function = lua_function_exists(lua_state, "turn_function");
+
+    if (0 != luaL_dostring(lua_state, "return turn_function_is_pure ~= false\n"))
+    {
+        std::stringstream msg;
+        msg << lua_tostring(lua_state, -1) << " occured in scripting block";
+        throw osrm::exception(msg.str());
+    }
+    speed_profile.turn_function_is_pure = lua_toboolean(lua_state, -1);
 }
 
 /**
@@ -398,11 +539,17 @@ void Prepare::SetupScriptingEnvironment(lua_State *lua_state, SpeedProfileProper
   */
 std::shared_ptr<RestrictionMap> Prepare::LoadRestrictionMap()
 {
-    boost::filesystem::ifstream input_stream(config.restrictions_path,
-                                             std::ios::in | std::ios::binary);
-
     std::vector<TurnRestriction> restriction_list;
-    loadRestrictionsFromFile(input_stream, restriction_list);
+    if (graph_data)
+    {
+        restriction_list.swap(graph_data->restrictions);
+    }
+    else
+    {
+        boost::filesystem::ifstream input_stream(config.restrictions_path,
+                                                 std::ios::in | std::ios::binary);
+        loadRestrictionsFromFile(input_stream, restriction_list);
+    }
 
     SimpleLogger().Write() << " - " << restriction_list.size() << " restrictions.";
 
@@ -417,6 +564,11 @@ Prepare::LoadNodeBasedGraph(std::unordered_set<NodeID> &barrier_nodes,
                             std::unordered_set<NodeID> &traffic_lights,
                             std::vector<QueryNode> &internal_to_external_node_map)
 {
+    if (graph_data)
+    {
+        return TakeNodeBasedGraph(barrier_nodes, traffic_lights, internal_to_external_node_map);
+    }
+
     std::vector<NodeBasedEdge> edge_list;
 
     boost::filesystem::ifstream input_stream(config.osrm_input_path,
@@ -450,6 +602,37 @@ Prepare::LoadNodeBasedGraph(std::unordered_set<NodeID> &barrier_nodes,
     return NodeBasedDynamicGraphFromEdges(number_of_node_based_nodes, edge_list);
 }
 
+/**
+  \brief Take the node based graph handed over by the extractor
+  */
+std::shared_ptr<NodeBasedDynamicGraph>
+Prepare::TakeNodeBasedGraph(std::unordered_set<NodeID> &barrier_nodes,
+                            std::unordered_set<NodeID> &traffic_lights,
+                            std::vector<QueryNode> &internal_to_external_node_map)
+{
+    BOOST_ASSERT(graph_data);
+    std::unique_ptr<NodeBasedGraphData> data = std::move(graph_data);
+
+    SimpleLogger().Write() << "Importing n = " << data->nodes.size() << " nodes and "
+                           << data->edges.size() << " edges from memory";
+    SimpleLogger().Write() << " - " << data->barrier_nodes.size() << " bollard nodes, "
+                           << data->traffic_lights.size() << " traffic lights";
+
+    barrier_nodes.insert(data->barrier_nodes.begin(), data->barrier_nodes.end());
+    traffic_lights.insert(data->traffic_lights.begin(), data->traffic_lights.end());
+    internal_to_external_node_map.swap(data->nodes);
+
+    if (data->edges.empty())
+    {
+        SimpleLogger().Write(logWARNING) << "The input data is empty, exiting.";
+        return std::shared_ptr<NodeBasedDynamicGraph>();
+    }
+
+    const auto number_of_node_based_nodes =
+        static_cast<NodeID>(internal_to_external_node_map.size());
+    return NodeBasedDynamicGraphFromEdges(number_of_node_based_nodes, data->edges);
+}
+
 /**
  \brief Building an edge-expanded graph from node-based input and turn restrictions
 */
@@ -458,11 +641,52 @@ Prepare::BuildEdgeExpandedGraph(std::vector<QueryNode> &internal_to_external_nod
                                 std::vector<EdgeBasedNode> &node_based_edge_list,
                                 DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list)
 {
-    lua_State *lua_state = luaL_newstate();
-    luabind::open(lua_state);
+    // the turn function is evaluated concurrently, thus each thread gets its own lua state
+    tbb::enumerable_thread_specific<std::shared_ptr<lua_State>> lua_states;
+    std::mutex lua_state_mutex;
+    const auto create_lua_state = [this](SpeedProfileProperties &speed_profile)
+    {
+        std::shared_ptr<lua_State> lua_state(luaL_newstate(), lua_close);
+        luabind::open(lua_state.get());
+        SetupScriptingEnvironment(lua_state.get(), speed_profile);
+        return lua_state;
+    };
+    const auto get_lua_state = [&]() -> lua_State *
+    {
+        bool initialized = false;
+        auto &lua_state = lua_states.local(initialized);
+        if (!initialized)
+        {
+            std::lock_guard<std::mutex> lock(lua_state_mutex);
+            SpeedProfileProperties thread_speed_profile;
+            lua_state = create_lua_state(thread_speed_profile);
+        }
+        return lua_state.get();
+    };
+
+    // a native profile replaces the lua states, then none is ever created
+    std::shared_ptr<const NativeProfile> native_profile = config.native_profile;
+    if (!native_profile && IsNativeProfile(config.profile_path))
+    {
+        native_profile = LoadNativeProfile(config.profile_path);
+    }
 
     SpeedProfileProperties speed_profile;
-    SetupScriptingEnvironment(lua_state, speed_profile);
+    if (native_profile)
+    {
+        const NativeProfileProperties properties = native_profile->GetProperties();
+        speed_profile.traffic_signal_penalty = 10 * properties.traffic_signal_penalty;
+        speed_profile.u_turn_penalty = 10 * properties.u_turn_penalty;
+        speed_profile.has_turn_penalty_function = properties.has_turn_penalty_function;
+    }
+    else
+    {
+        lua_states.local() = create_lua_state(speed_profile);
+    }
+    const auto get_turn_lua_state = [&]() -> lua_State *
+    {
+        return native_profile ? nullptr : get_lua_state();
+    };
 
     std::unordered_set<NodeID> barrier_nodes;
     std::unordered_set<NodeID> traffic_lights;
@@ -473,18 +697,46 @@ Prepare::BuildEdgeExpandedGraph(std::vector<QueryNode> &internal_to_external_nod
 
     CompressedEdgeContainer compressed_edge_container;
     GraphCompressor graph_compressor(speed_profile);
-    graph_compressor.Compress(barrier_nodes, traffic_lights, *restriction_map, *node_based_graph,
-                              compressed_edge_container);
+    if (config.parallel_graph_compression)
+    {
+        graph_compressor.CompressParallel(barrier_nodes, traffic_lights, *restriction_map,
+                                          *node_based_graph, compressed_edge_container);
+    }
+    else
+    {
+        graph_compressor.Compress(barrier_nodes, traffic_lights, *restriction_map,
+                                  *node_based_graph, compressed_edge_container);
+    }
+
+    if (config.build_generalization_levels)
+    {
+        SimpleLogger().Write() << "computing generalization levels of the geometries ...";
+        compressed_edge_container.ComputeZoomLevels(*node_based_graph,
+                                                    internal_to_external_node_map);
+    }
+
+    // the restrictions do not change anymore, the expansion only looks them up
+    auto restriction_index =
+        std::make_shared<const RestrictionIndex>(restriction_map->BuildIndex());
+    restriction_map.reset();
 
     EdgeBasedGraphFactory edge_based_graph_factory(
         node_based_graph, compressed_edge_container, barrier_nodes, traffic_lights,
-        std::const_pointer_cast<RestrictionMap const>(restriction_map),
-        internal_to_external_node_map, speed_profile);
+        restriction_index, internal_to_external_node_map, speed_profile);
+
+    edge_based_graph_factory.SetNativeProfile(native_profile.get());
+    if (config.stream_edge_based_edges)
+    {
+        edge_based_graph_factory.SetEdgeRunPath(config.edge_run_output_path);
+    }
 
     compressed_edge_container.SerializeInternalVector(config.geometry_output_path);
 
-    edge_based_graph_factory.Run(config.edge_output_path, lua_state);
-    lua_close(lua_state);
+    edge_based_graph_factory.Run(config.edge_output_path,
+                                 config.customizable ? config.edge_segment_lookup_output_path
+                                                     : std::string(),
+                                 get_turn_lua_state);
+    lua_states.clear();
 
     edge_based_graph_factory.GetEdgeBasedEdges(edge_based_edge_list);
     edge_based_graph_factory.GetEdgeBasedNodes(node_based_edge_list);
@@ -497,15 +749,160 @@ Prepare::BuildEdgeExpandedGraph(std::vector<QueryNode> &internal_to_external_nod
 /**
  \brief Build contracted graph.
  */
+template <class EdgeContainerT>
 void Prepare::ContractGraph(const unsigned max_edge_id,
-                            DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list,
+                            EdgeContainerT &edge_based_edge_list,
                             DeallocatingVector<QueryEdge> &contracted_edge_list,
-                            std::vector<bool> &is_core_node)
+                            std::vector<bool> &is_core_node,
+                            std::vector<float> &node_levels,
+                            std::vector<bool> &&is_boundary_node)
 {
-    Contractor contractor(max_edge_id + 1, edge_based_edge_list);
+    Contractor contractor(max_edge_id + 1, edge_based_edge_list, config.customizable);
+    Contractor::WitnessSearchConfig witness_config;
+    witness_config.simulation_limit = config.witness_simulation_limit;
+    witness_config.contraction_limit = config.witness_contraction_limit;
+    witness_config.dense_heaps = config.dense_witness_heaps;
+    witness_config.log_statistics = config.log_witness_statistics;
+    contractor.SetWitnessSearchConfig(witness_config);
+    contractor.SetStreamContractedEdges(config.stream_contracted_edges);
+    contractor.SetLazyPriorityUpdates(config.lazy_priority_updates);
+    contractor.SetReportPath(config.contraction_report_path);
+    contractor.SetBoundaryNodes(std::move(is_boundary_node));
+    contractor.SetCheckpoints(config.checkpoint_output_path, config.checkpoint_interval,
+                              config.resume_contraction);
+    if (config.use_cached_levels)
+    {
+        std::vector<float> node_levels = ReadNodeLevels(max_edge_id + 1);
+        if (!node_levels.empty())
+        {
+            SimpleLogger().Write() << "contracting in the order of " << config.level_output_path;
+            contractor.SetNodeLevels(std::move(node_levels));
+        }
+    }
     contractor.Run(config.core_factor);
     contractor.GetEdges(contracted_edge_list);
     contractor.GetCoreMarker(is_core_node);
+
+    contractor.GetNodeLevels(node_levels);
+    WriteNodeLevels(node_levels);
+}
+
+/**
+  rief Numbers the edge-based nodes by contraction level and location
+
+  Renumbers the contracted edges, the core markers and the edge-based nodes that go into the
+  r-tree. The .level file keeps the ids of the edge expansion, a later run numbers them the same.
+ */
+void Prepare::RenumberNodes(const std::vector<float> &node_levels,
+                            const std::vector<QueryNode> &internal_to_external_node_map,
+                            std::vector<EdgeBasedNode> &node_based_edge_list,
+                            DeallocatingVector<QueryEdge> &contracted_edge_list,
+                            std::vector<bool> &is_core_node) const
+{
+    HilbertCode get_hilbert_number;
+    const std::vector<FixedPointCoordinate> locations = ComputeNodeLocations(
+        node_levels.size(), internal_to_external_node_map, node_based_edge_list);
+    std::vector<std::uint64_t> spatial_keys(locations.size());
+    for (const auto node : osrm::irange<std::size_t>(0, locations.size()))
+    {
+        spatial_keys[node] = get_hilbert_number(locations[node]);
+    }
+
+    const std::vector<NodeID> new_id_from_old_id =
+        ComputeHierarchyNodeOrder(node_levels, spatial_keys);
+    spatial_keys.clear();
+    spatial_keys.shrink_to_fit();
+
+    RenumberHierarchyEdges(new_id_from_old_id, contracted_edge_list);
+    RenumberNodeValues(new_id_from_old_id, is_core_node);
+    for (auto &node : node_based_edge_list)
+    {
+        if (SPECIAL_NODEID != node.forward_edge_based_node_id)
+        {
+            node.forward_edge_based_node_id = new_id_from_old_id[node.forward_edge_based_node_id];
+        }
+        if (SPECIAL_NODEID != node.reverse_edge_based_node_id)
+        {
+            node.reverse_edge_based_node_id = new_id_from_old_id[node.reverse_edge_based_node_id];
+        }
+    }
+}
+
+/**
+  \brief Places every edge-based node at the centroid of one of its segments
+ */
+std::vector<FixedPointCoordinate>
+Prepare::ComputeNodeLocations(const std::size_t number_of_nodes,
+                              const std::vector<QueryNode> &internal_to_external_node_map,
+                              const std::vector<EdgeBasedNode> &node_based_edge_list) const
+{
+    std::vector<FixedPointCoordinate> locations(number_of_nodes, FixedPointCoordinate(0, 0));
+    for (const auto &node : node_based_edge_list)
+    {
+        const QueryNode &u = internal_to_external_node_map[node.u];
+        const QueryNode &v = internal_to_external_node_map[node.v];
+        const FixedPointCoordinate centroid((u.lat + v.lat) / 2, (u.lon + v.lon) / 2);
+        if (SPECIAL_NODEID != node.forward_edge_based_node_id)
+        {
+            locations[node.forward_edge_based_node_id] = centroid;
+        }
+        if (SPECIAL_NODEID != node.reverse_edge_based_node_id)
+        {
+            locations[node.reverse_edge_based_node_id] = centroid;
+        }
+    }
+    return locations;
+}
+
+/**
+  \brief Reads the contraction levels of a previous run, empty if there are none
+ */
+std::vector<float> Prepare::ReadNodeLevels(const unsigned number_of_nodes) const
+{
+    std::vector<float> node_levels;
+    boost::filesystem::ifstream level_stream(config.level_output_path, std::ios::binary);
+    if (!level_stream)
+    {
+        SimpleLogger().Write(logWARNING) << config.level_output_path
+                                         << " not found, computing a new node order";
+        return node_levels;
+    }
+    unsigned size = 0;
+    level_stream.read((char *)&size, sizeof(unsigned));
+    if (size != number_of_nodes)
+    {
+        throw osrm::exception(config.level_output_path + " has " + std::to_string(size) +
+                              " levels but the graph " + std::to_string(number_of_nodes) +
+                              " nodes, it belongs to a different extract");
+    }
+    node_levels.resize(size);
+    level_stream.read((char *)node_levels.data(), sizeof(float) * size);
+    if (!level_stream)
+    {
+        throw osrm::exception(config.level_output_path + " is truncated");
+    }
+    return node_levels;
+}
+
+/**
+  \brief Writes the contraction level of every node to '.level'
+ */
+void Prepare::WriteNodeLevels(const std::vector<float> &node_levels) const
+{
+    boost::filesystem::ofstream level_stream(config.level_output_path, std::ios::binary);
+    const unsigned size = node_levels.size();
+    level_stream.write((char *)&size, sizeof(unsigned));
+    level_stream.write((char *)node_levels.data(), sizeof(float) * size);
+}
+
+/**
+  \brief Writes the distances between the core nodes and the core landmarks to '.landmarks'
+ */
+void Prepare::BuildLandmarks(const DeallocatingVector<QueryEdge> &contracted_edge_list,
+                             const std::vector<bool> &is_core_node) const
+{
+    LandmarkTable<>::Build(contracted_edge_list, is_core_node, config.number_of_landmarks,
+                           config.landmark_output_path);
 }
 
 /**
@@ -521,13 +918,28 @@ void Prepare::WriteNodeMapping(const std::vector<QueryNode> &internal_to_externa
         node_stream.write((char *)internal_to_external_node_map.data(),
                           size_of_mapping * sizeof(QueryNode));
     }
+    // optional, readers that do not know the projected latitudes stop after the nodes
+    if (config.store_projected_coordinates)
+    {
+        std::vector<double> projected_latitudes(size_of_mapping);
+        for (const auto i : osrm::irange(0u, size_of_mapping))
+        {
+            projected_latitudes[i] = coordinate_calculation::projected_latitude(
+                FixedPointCoordinate(internal_to_external_node_map[i].lat,
+                                     internal_to_external_node_map[i].lon));
+        }
+        node_stream.write((char *)&size_of_mapping, sizeof(unsigned));
+        node_stream.write((char *)projected_latitudes.data(),
+                          size_of_mapping * sizeof(double));
+    }
     node_stream.close();
 }
 
 /**
     \brief Building rtree-based nearest-neighbor data structure
 
-    Saves tree into '.ramIndex' and leaves into '.fileIndex'.
+    Saves tree into '.ramIndex' and leaves into '.fileIndex', and optionally the segment grid
+    into '.gridIndex' and the kd-tree of the segment end points into '.locateIndex'.
  */
 void Prepare::BuildRTree(const std::vector<EdgeBasedNode> &node_based_edge_list,
                          const std::vector<QueryNode> &internal_to_external_node_map)
@@ -535,4 +947,29 @@ void Prepare::BuildRTree(const std::vector<EdgeBasedNode> &node_based_edge_list,
     StaticRTree<EdgeBasedNode>(node_based_edge_list, config.rtree_nodes_output_path.c_str(),
                                config.rtree_leafs_output_path.c_str(),
                                internal_to_external_node_map);
+    if (config.build_segment_grid)
+    {
+        SegmentGrid<EdgeBasedNode>::Build(node_based_edge_list, internal_to_external_node_map,
+                                          config.segment_grid_output_path);
+    }
+    if (config.build_locate_index)
+    {
+        // the nodes that /locate can return, the end points of the segments of the r-tree
+        std::vector<bool> is_end_point(internal_to_external_node_map.size(), false);
+        for (const auto &node : node_based_edge_list)
+        {
+            is_end_point[node.u] = true;
+            is_end_point[node.v] = true;
+        }
+        std::vector<FixedPointCoordinate> end_points;
+        for (const auto node : osrm::irange<std::size_t>(0, is_end_point.size()))
+        {
+            if (is_end_point[node])
+            {
+                end_points.emplace_back(internal_to_external_node_map[node].lat,
+                                        internal_to_external_node_map[node].lon);
+            }
+        }
+        StaticKDTree<>::Build(std::move(end_points), config.locate_index_output_path);
+    }
 }
@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "contractor_options.hpp"
 #include "edge_based_graph_factory.hpp"
+#include "../data_structures/node_based_graph_data.hpp"
 #include "../data_structures/query_edge.hpp"
 #include "../data_structures/static_graph.hpp"
 
@@ -39,6 +40,7 @@ struct lua_State;
 
 #include <boost/filesystem.hpp>
 
+#include <memory>
 #include <vector>
 
 /**
@@ -52,6 +54,11 @@ class Prepare
     using StaticEdge = StaticGraph<EdgeData>::InputEdge;
 
     explicit Prepare(ContractorConfig contractor_config) : config(std::move(contractor_config)) {}
+    // takes the node-based graph from memory instead of the .osrm and .restrictions files
+    Prepare(ContractorConfig contractor_config, std::unique_ptr<NodeBasedGraphData> graph_data)
+        : config(std::move(contractor_config)), graph_data(std::move(graph_data))
+    {
+    }
     Prepare(const Prepare &) = delete;
     ~Prepare();
 
@@ -60,11 +67,28 @@ class Prepare
   protected:
     void SetupScriptingEnvironment(lua_State *myLuaState, SpeedProfileProperties &speed_profile);
     unsigned CalculateEdgeChecksum(const std::vector<EdgeBasedNode> &node_based_edge_list);
+    // the edge-based edges are either a DeallocatingVector or an EdgeBasedEdgeRun
+    template <class EdgeContainerT>
     void ContractGraph(const unsigned max_edge_id,
-                       DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list,
+                       EdgeContainerT &edge_based_edge_list,
                        DeallocatingVector<QueryEdge> &contracted_edge_list,
-                       std::vector<bool> &is_core_node);
+                       std::vector<bool> &is_core_node,
+                       std::vector<float> &node_levels,
+                       std::vector<bool> &&is_boundary_node);
+    void RenumberNodes(const std::vector<float> &node_levels,
+                       const std::vector<QueryNode> &internal_to_external_node_map,
+                       std::vector<EdgeBasedNode> &node_based_edge_list,
+                       DeallocatingVector<QueryEdge> &contracted_edge_list,
+                       std::vector<bool> &is_core_node) const;
+    std::vector<FixedPointCoordinate>
+    ComputeNodeLocations(const std::size_t number_of_nodes,
+                         const std::vector<QueryNode> &internal_to_external_node_map,
+                         const std::vector<EdgeBasedNode> &node_based_edge_list) const;
+    std::vector<float> ReadNodeLevels(const unsigned number_of_nodes) const;
+    void WriteNodeLevels(const std::vector<float> &node_levels) const;
     void WriteCoreNodeMarker(std::vector<bool> &&is_core_node) const;
+    void BuildLandmarks(const DeallocatingVector<QueryEdge> &contracted_edge_list,
+                        const std::vector<bool> &is_core_node) const;
     std::size_t WriteContractedGraph(unsigned number_of_edge_based_nodes,
                                      const std::vector<EdgeBasedNode> &node_based_edge_list,
                                      const DeallocatingVector<QueryEdge> &contracted_edge_list);
@@ -73,19 +97,26 @@ class Prepare
     LoadNodeBasedGraph(std::unordered_set<NodeID> &barrier_nodes,
                        std::unordered_set<NodeID> &traffic_lights,
                        std::vector<QueryNode> &internal_to_external_node_map);
+    std::shared_ptr<NodeBasedDynamicGraph>
+    TakeNodeBasedGraph(std::unordered_set<NodeID> &barrier_nodes,
+                       std::unordered_set<NodeID> &traffic_lights,
+                       std::vector<QueryNode> &internal_to_external_node_map);
     std::pair<std::size_t, std::size_t>
     BuildEdgeExpandedGraph(std::vector<QueryNode> &internal_to_external_node_map,
                            std::vector<EdgeBasedNode> &node_based_edge_list,
                            DeallocatingVector<EdgeBasedEdge> &edge_based_edge_list);
     void WriteNodeMapping(const std::vector<QueryNode> &internal_to_external_node_map);
+    template <class EdgeContainerT>
     void FindComponents(unsigned max_edge_id,
-                        const DeallocatingVector<EdgeBasedEdge> &edges,
+                        const EdgeContainerT &edges,
                         std::vector<EdgeBasedNode> &nodes) const;
     void BuildRTree(const std::vector<EdgeBasedNode> &node_based_edge_list,
                     const std::vector<QueryNode> &internal_to_external_node_map);
+    void BuildDatasetImage() const;
 
   private:
     ContractorConfig config;
+    std::unique_ptr<NodeBasedGraphData> graph_data;
 };
 
 #endif // PROCESSING_CHAIN_HPP
@@ -4,13 +4,17 @@
 struct SpeedProfileProperties
 {
   SpeedProfileProperties()
-    : traffic_signal_penalty(0), u_turn_penalty(0), has_turn_penalty_function(false)
+    : traffic_signal_penalty(0), u_turn_penalty(0), has_turn_penalty_function(false),
+      turn_function_is_pure(true)
   {
   }
 
   int traffic_signal_penalty;
   int u_turn_penalty;
   bool has_turn_penalty_function;
+  // a pure turn function only depends on the angle and is tabulated once,
+  // profiles opt out by setting turn_function_is_pure = false
+  bool turn_function_is_pure;
 };
 
 #endif
@@ -0,0 +1,315 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "algorithms/coordinate_calculation.hpp"
+#include "algorithms/hierarchy_customizer.hpp"
+#include "data_structures/edge_segment_lookup.hpp"
+#include "data_structures/query_edge.hpp"
+#include "data_structures/query_node.hpp"
+#include "data_structures/static_graph.hpp"
+#include "util/graph_loader.hpp"
+#include "util/integer_range.hpp"
+#include "util/osrm_exception.hpp"
+#include "util/simple_logger.hpp"
+#include "util/timing_util.hpp"
+#include "util/version.hpp"
+#include "typedefs.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/program_options.hpp>
+#include <boost/spirit/include/qi.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using QueryGraph = StaticGraph<QueryEdge::EdgeData>;
+
+// speeds in km/h of the segments between two OSM nodes, keyed by both ids
+using SegmentSpeedMap = std::unordered_map<std::uint64_t, double>;
+
+std::uint64_t segment_key(const NodeID from, const NodeID to)
+{
+    return (static_cast<std::uint64_t>(from) << 32) | to;
+}
+
+// Reads lines of the form from_osm_id,to_osm_id,speed
+SegmentSpeedMap load_segment_speeds(const boost::filesystem::path &segment_speed_path)
+{
+    boost::filesystem::ifstream segment_speed_file(segment_speed_path);
+    if (!segment_speed_file)
+    {
+        throw osrm::exception("cannot open " + segment_speed_path.string());
+    }
+
+    SegmentSpeedMap segment_speeds;
+    std::string line;
+    unsigned line_number = 0;
+    while (std::getline(segment_speed_file, line))
+    {
+        ++line_number;
+        if (line.empty())
+        {
+            continue;
+        }
+        unsigned from = 0, to = 0;
+        double speed = 0;
+        auto iter = line.cbegin();
+        const bool parsed = boost::spirit::qi::parse(
+            iter, line.cend(), boost::spirit::qi::uint_ >> ',' >> boost::spirit::qi::uint_ >>
+                                   ',' >> boost::spirit::qi::double_,
+            from, to, speed);
+        if (!parsed || iter != line.cend() || speed <= 0)
+        {
+            throw osrm::exception(segment_speed_path.string() + ":" +
+                                  std::to_string(line_number) + ": expected from,to,speed");
+        }
+        segment_speeds[segment_key(from, to)] = speed;
+    }
+    return segment_speeds;
+}
+
+std::vector<QueryNode> load_node_mapping(const boost::filesystem::path &nodes_path)
+{
+    boost::filesystem::ifstream nodes_file(nodes_path, std::ios::binary);
+    unsigned number_of_nodes = 0;
+    nodes_file.read((char *)&number_of_nodes, sizeof(unsigned));
+    std::vector<QueryNode> nodes(number_of_nodes);
+    if (number_of_nodes > 0)
+    {
+        nodes_file.read((char *)nodes.data(), number_of_nodes * sizeof(QueryNode));
+    }
+    if (!nodes_file)
+    {
+        throw osrm::exception("cannot read " + nodes_path.string());
+    }
+    return nodes;
+}
+
+// Weights of all edge-based edges with the new segment speeds, the others keep their weights
+std::vector<EdgeWeight> load_edge_weights(const boost::filesystem::path &lookup_path,
+                                          const std::vector<QueryNode> &nodes,
+                                          const SegmentSpeedMap &segment_speeds)
+{
+    boost::filesystem::ifstream lookup_file(lookup_path, std::ios::binary);
+    if (!lookup_file)
+    {
+        throw osrm::exception("cannot open " + lookup_path.string() +
+                              ", was the hierarchy prepared with --customizable?");
+    }
+
+    unsigned number_of_edges = 0;
+    lookup_file.read((char *)&number_of_edges, sizeof(unsigned));
+    std::vector<EdgeWeight> edge_weights(number_of_edges);
+    std::vector<EdgeSegment> segments;
+    std::size_t updated_segments = 0;
+    for (auto &edge_weight : edge_weights)
+    {
+        EdgeSegmentLookupHeader header;
+        lookup_file.read((char *)&header, sizeof(header));
+        segments.resize(header.number_of_segments);
+        lookup_file.read((char *)segments.data(), sizeof(EdgeSegment) * segments.size());
+        if (!lookup_file)
+        {
+            throw osrm::exception(lookup_path.string() + " is truncated");
+        }
+
+        edge_weight = header.turn_weight;
+        NodeID from = header.source;
+        for (const auto &segment : segments)
+        {
+            const NodeID to = segment.first;
+            BOOST_ASSERT(from < nodes.size() && to < nodes.size());
+            const auto speed_iter =
+                segment_speeds.find(segment_key(nodes[from].node_id, nodes[to].node_id));
+            if (speed_iter == segment_speeds.end())
+            {
+                edge_weight += segment.second;
+            }
+            else
+            {
+                // same as the extractor does for speeds in km/h, in tenth of a second
+                const double distance = coordinate_calculation::great_circle_distance(
+                    nodes[from].lat, nodes[from].lon, nodes[to].lat, nodes[to].lon);
+                const double weight = (distance * 10.) / (speed_iter->second / 3.6);
+                edge_weight += std::max(1, static_cast<int>(std::floor(weight + .5)));
+                ++updated_segments;
+            }
+            from = to;
+        }
+        edge_weight = std::max(1, edge_weight);
+    }
+    SimpleLogger().Write() << "updated " << updated_segments << " segments of "
+                           << number_of_edges << " edge-based edges";
+    return edge_weights;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        LogPolicy::GetInstance().Unmute();
+
+        boost::filesystem::path osrm_input_path;
+        boost::filesystem::path segment_speed_path;
+        unsigned requested_num_threads = 0;
+
+        boost::program_options::options_description visible_options(
+            "Usage: " + boost::filesystem::basename(argv[0]) +
+            " <input.osrm> --segment-speed-file <speeds.csv> [options]");
+        visible_options.add_options()("version,v", "Show version")("help,h",
+                                                                   "Show this help message")(
+            "segment-speed-file,s",
+            boost::program_options::value<boost::filesystem::path>(&segment_speed_path),
+            "Lines of from_osm_id,to_osm_id,speed in km/h for the segments to update")(
+            "threads,t",
+            boost::program_options::value<unsigned>(&requested_num_threads)
+                ->default_value(tbb::task_scheduler_init::default_num_threads()),
+            "Number of threads to use");
+
+        boost::program_options::options_description hidden_options("Hidden options");
+        hidden_options.add_options()(
+            "input,i", boost::program_options::value<boost::filesystem::path>(&osrm_input_path),
+            ".osrm file that was prepared with --customizable");
+
+        boost::program_options::positional_options_description positional_options;
+        positional_options.add("input", 1);
+
+        boost::program_options::options_description cmdline_options;
+        cmdline_options.add(visible_options).add(hidden_options);
+
+        boost::program_options::variables_map option_variables;
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+                                          .options(cmdline_options)
+                                          .positional(positional_options)
+                                          .run(),
+                                      option_variables);
+
+        if (option_variables.count("version"))
+        {
+            SimpleLogger().Write() << OSRM_VERSION;
+            return 0;
+        }
+
+        if (option_variables.count("help"))
+        {
+            SimpleLogger().Write() << "\n" << visible_options;
+            return 0;
+        }
+
+        boost::program_options::notify(option_variables);
+
+        if (!option_variables.count("input") || !option_variables.count("segment-speed-file"))
+        {
+            SimpleLogger().Write() << "\n" << visible_options;
+            return 1;
+        }
+
+        if (1 > requested_num_threads)
+        {
+            SimpleLogger().Write(logWARNING) << "Number of threads must be 1 or larger";
+            return 1;
+        }
+        tbb::task_scheduler_init init(requested_num_threads);
+
+        const std::string base_string = osrm_input_path.string();
+        if (boost::filesystem::exists(base_string + ".landmarks"))
+        {
+            SimpleLogger().Write(logWARNING) << base_string << ".landmarks does not match the "
+                                                               "new weights, remove it";
+        }
+
+        TIMER_START(customization);
+
+        const auto segment_speeds = load_segment_speeds(segment_speed_path);
+        SimpleLogger().Write() << "loaded " << segment_speeds.size() << " segment speeds";
+
+        const auto edge_weights =
+            load_edge_weights(base_string + ".edge_segment_lookup",
+                              load_node_mapping(base_string + ".nodes"), segment_speeds);
+
+        std::vector<QueryGraph::NodeArrayEntry> node_list;
+        std::vector<QueryGraph::EdgeArrayEntry> edge_list;
+        unsigned check_sum = 0;
+        readHSGRFromStream(base_string + ".hsgr", node_list, edge_list, &check_sum);
+
+        // original edges refer to the edge-based edge they were built from
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, edge_list.size()),
+            [&edge_list, &edge_weights](const tbb::blocked_range<std::size_t> &range)
+            {
+                for (const auto edge : osrm::irange(range.begin(), range.end()))
+                {
+                    auto &data = edge_list[edge].data;
+                    if (data.shortcut)
+                    {
+                        continue;
+                    }
+                    if ((data.forward && data.backward) || data.id >= edge_weights.size())
+                    {
+                        throw osrm::exception("the hierarchy was not prepared with "
+                                              "--customizable");
+                    }
+                    data.distance = edge_weights[data.id];
+                }
+            });
+
+        QueryGraph graph(node_list, edge_list);
+        const unsigned number_of_levels = HierarchyCustomizer<QueryGraph>(graph).Run();
+        SimpleLogger().Write() << "updated the shortcuts in " << number_of_levels << " levels";
+
+        const unsigned number_of_edges = graph.GetNumberOfEdges();
+        boost::filesystem::ofstream weights_file(base_string + ".weights", std::ios::binary);
+        weights_file.write((char *)&check_sum, sizeof(unsigned));
+        weights_file.write((char *)&number_of_edges, sizeof(unsigned));
+        for (const auto edge : osrm::irange(0u, number_of_edges))
+        {
+            const EdgeWeight weight = graph.GetEdgeData(edge).distance;
+            weights_file.write((char *)&weight, sizeof(EdgeWeight));
+        }
+        weights_file.close();
+
+        TIMER_STOP(customization);
+        SimpleLogger().Write() << "wrote " << base_string << ".weights in "
+                               << TIMER_SEC(customization) << " seconds";
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "[exception] " << e.what();
+        return 1;
+    }
+    return 0;
+}
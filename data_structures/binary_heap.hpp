@@ -28,13 +28,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef BINARY_HEAP_H
 #define BINARY_HEAP_H
 
+#include "../util/prefetch.hpp"
+
 #include <boost/assert.hpp>
 
 #include <algorithm>
+#include <cstdint>
 #include <limits>
 #include <map>
 #include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 template <typename NodeID, typename Key> class ArrayStorage
@@ -48,6 +52,8 @@ template <typename NodeID, typename Key> class ArrayStorage
 
     Key peek_index(const NodeID node) const { return positions[node]; }
 
+    void Prefetch(const NodeID node) const { osrm::prefetch(positions.data() + node); }
+
     void Clear() {}
 
   private:
@@ -61,6 +67,8 @@ template <typename NodeID, typename Key> class MapStorage
 
     Key &operator[](NodeID node) { return nodes[node]; }
 
+    void Prefetch(const NodeID) const {}
+
     void Clear() { nodes.clear(); }
 
     Key peek_index(const NodeID node) const
@@ -100,12 +108,73 @@ template <typename NodeID, typename Key> class UnorderedMapStorage
         return iter->second;
     }
 
+    // the bucket of a node is only known after hashing, nothing worth loading ahead
+    void Prefetch(const NodeID) const {}
+
     void Clear() { nodes.clear(); }
 
   private:
     std::unordered_map<NodeID, Key> nodes;
 };
 
+// Indexes the heap either densely by node id or through a hash map, chosen at construction. The
+// dense array trades memory in the order of the graph size for array lookups in the search loop.
+// It needs no clearing, stale positions are rejected by the heap as they do not point back to
+// their node.
+template <typename NodeID,
+          typename Key,
+          typename HashStorage = UnorderedMapStorage<NodeID, Key>>
+class SelectableStorage
+{
+  public:
+    explicit SelectableStorage(size_t size, const bool use_array = false)
+        : use_array(use_array), number_of_nodes(size), array_storage(use_array ? size : 0),
+          hash_storage(size)
+    {
+    }
+
+    Key &operator[](const NodeID node)
+    {
+        return use_array ? array_storage[node] : hash_storage[node];
+    }
+
+    Key peek_index(const NodeID node) const
+    {
+        return use_array ? array_storage.peek_index(node) : hash_storage.peek_index(node);
+    }
+
+    void Prefetch(const NodeID node) const
+    {
+        if (use_array)
+        {
+            array_storage.Prefetch(node);
+        }
+        else
+        {
+            hash_storage.Prefetch(node);
+        }
+    }
+
+    void Clear()
+    {
+        if (!use_array)
+        {
+            hash_storage.Clear();
+        }
+    }
+
+    // whether node ids below size can be indexed, the hash map takes any id
+    bool CanIndex(const size_t size) const { return !use_array || size <= number_of_nodes; }
+
+    bool UsesArray() const { return use_array; }
+
+  private:
+    bool use_array;
+    size_t number_of_nodes;
+    ArrayStorage<NodeID, Key> array_storage;
+    HashStorage hash_storage;
+};
+
 template <typename NodeID,
           typename Key,
           typename Weight,
@@ -121,10 +190,19 @@ class BinaryHeap
     using WeightType = Weight;
     using DataType = Data;
 
-    explicit BinaryHeap(size_t maxID) : node_index(maxID) { Clear(); }
+    template <typename... StorageArguments>
+    explicit BinaryHeap(size_t maxID, StorageArguments &&... storage_arguments)
+        : node_index(maxID, std::forward<StorageArguments>(storage_arguments)...),
+          previous_insertions(0)
+    {
+        Clear();
+    }
+
+    const IndexStorage &GetIndexStorage() const { return node_index; }
 
     void Clear()
     {
+        previous_insertions += inserted_nodes.size();
         heap.resize(1);
         inserted_nodes.clear();
         heap[0].weight = std::numeric_limits<Weight>::min();
@@ -133,6 +211,15 @@ class BinaryHeap
 
     std::size_t Size() const { return (heap.size() - 1); }
 
+    // nodes inserted since the construction of the heap, for the statistics of the benchmarks
+    std::uint64_t NumberOfInsertions() const
+    {
+        return previous_insertions + inserted_nodes.size();
+    }
+
+    // nodes the heap holds memory for, it keeps the memory of its largest search until deleted
+    std::size_t Capacity() const { return inserted_nodes.capacity(); }
+
     bool Empty() const { return 0 == Size(); }
 
     void Insert(NodeID node, Weight weight, const Data &data)
@@ -173,6 +260,9 @@ class BinaryHeap
         return inserted_nodes[index].key == 0;
     }
 
+    // loads the index slot of a node into the cache ahead of WasInserted or GetKey
+    void Prefetch(const NodeID node) const { node_index.Prefetch(node); }
+
     bool WasInserted(const NodeID node) const
     {
         const auto index = node_index.peek_index(node);
@@ -255,6 +345,7 @@ class BinaryHeap
     std::vector<HeapNode> inserted_nodes;
     std::vector<HeapElement> heap;
     IndexStorage node_index;
+    std::uint64_t previous_insertions;
 
     void Downheap(Key key)
     {
@@ -0,0 +1,158 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef BIT_VECTOR_HPP
+#define BIT_VECTOR_HPP
+
+#include "shared_memory_vector_wrapper.hpp"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+// Flags in cache lines of eight 64 bit words: the number of set bits before the line, followed
+// by seven words of flags. rank() needs one line, no matter where the index is. The layout is
+// the same in shared memory, where osrm-datastore writes it with Write().
+template <bool UseSharedMemory> class BitVector
+{
+  public:
+    using WordT = std::uint64_t;
+    static constexpr std::size_t BITS_PER_WORD = 64;
+    static constexpr std::size_t WORDS_PER_LINE = 8;
+    static constexpr std::size_t BITS_PER_LINE = (WORDS_PER_LINE - 1) * BITS_PER_WORD;
+
+    static std::size_t GetNumberOfWords(const std::size_t number_of_bits)
+    {
+        return (number_of_bits + BITS_PER_LINE - 1) / BITS_PER_LINE * WORDS_PER_LINE;
+    }
+
+    // words has to hold GetNumberOfWords(flags.size()) words
+    template <typename FlagContainerT>
+    static void Write(const FlagContainerT &flags, WordT *words)
+    {
+        const std::size_t number_of_bits = flags.size();
+        std::fill(words, words + GetNumberOfWords(number_of_bits), 0);
+
+        WordT rank = 0;
+        for (std::size_t first_bit = 0; first_bit < number_of_bits; first_bit += BITS_PER_LINE)
+        {
+            WordT *line = words + first_bit / BITS_PER_LINE * WORDS_PER_LINE;
+            line[0] = rank;
+            const std::size_t last_bit = std::min(number_of_bits, first_bit + BITS_PER_LINE);
+            for (std::size_t bit = first_bit; bit < last_bit; ++bit)
+            {
+                if (flags[bit])
+                {
+                    const std::size_t offset = bit - first_bit;
+                    line[1 + offset / BITS_PER_WORD] |= WordT(1) << (offset % BITS_PER_WORD);
+                    ++rank;
+                }
+            }
+        }
+    }
+
+    BitVector() : number_of_bits(0) {}
+
+    // internal memory
+    template <typename FlagContainerT>
+    explicit BitVector(const FlagContainerT &flags)
+        : words(GetNumberOfWords(flags.size())), number_of_bits(flags.size())
+    {
+        static_assert(!UseSharedMemory, "bit vectors in shared memory are written by Write()");
+        Write(flags, words.data());
+    }
+
+    // shared memory, the words were written by Write()
+    BitVector(WordT *words_ptr, const std::size_t number_of_bits)
+        : words(words_ptr, GetNumberOfWords(number_of_bits)), number_of_bits(number_of_bits)
+    {
+    }
+
+    void swap(BitVector &other)
+    {
+        words.swap(other.words);
+        std::swap(number_of_bits, other.number_of_bits);
+    }
+
+    std::size_t size() const { return number_of_bits; }
+
+    bool empty() const { return 0 == number_of_bits; }
+
+    bool at(const std::size_t index) const
+    {
+        BOOST_ASSERT(index < number_of_bits);
+        const std::size_t offset = index % BITS_PER_LINE;
+        const WordT word = words[index / BITS_PER_LINE * WORDS_PER_LINE + 1 + offset / BITS_PER_WORD];
+        return (word >> (offset % BITS_PER_WORD)) & 1;
+    }
+
+    bool operator[](const std::size_t index) const { return at(index); }
+
+    // number of set bits in [0, index)
+    std::size_t rank(const std::size_t index) const
+    {
+        BOOST_ASSERT(index <= number_of_bits);
+        if (index == number_of_bits && index > 0)
+        {
+            // the line behind the last bit does not exist
+            return rank(index - 1) + at(index - 1);
+        }
+        if (0 == index)
+        {
+            return 0;
+        }
+
+        const std::size_t first_word = index / BITS_PER_LINE * WORDS_PER_LINE;
+        const std::size_t offset = index % BITS_PER_LINE;
+        std::size_t result = words[first_word];
+        for (std::size_t word = 0; word < offset / BITS_PER_WORD; ++word)
+        {
+            result += std::bitset<BITS_PER_WORD>(words[first_word + 1 + word]).count();
+        }
+        const std::size_t remaining_bits = offset % BITS_PER_WORD;
+        if (remaining_bits > 0)
+        {
+            const WordT mask = (WordT(1) << remaining_bits) - 1;
+            result += std::bitset<BITS_PER_WORD>(words[first_word + 1 + offset / BITS_PER_WORD] &
+                                                 mask).count();
+        }
+        return result;
+    }
+
+  private:
+    typename ShM<WordT, UseSharedMemory>::vector words;
+    std::size_t number_of_bits;
+};
+
+template <bool UseSharedMemory> constexpr std::size_t BitVector<UseSharedMemory>::BITS_PER_WORD;
+template <bool UseSharedMemory> constexpr std::size_t BitVector<UseSharedMemory>::WORDS_PER_LINE;
+template <bool UseSharedMemory> constexpr std::size_t BitVector<UseSharedMemory>::BITS_PER_LINE;
+
+#endif // BIT_VECTOR_HPP
@@ -0,0 +1,270 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef COMPACT_QUERY_GRAPH_HPP
+#define COMPACT_QUERY_GRAPH_HPP
+
+#include "query_edge.hpp"
+#include "static_graph.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/prefetch.hpp"
+#include "../util/simple_logger.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+// Read-only query graph that stores every edge as a bit-packed record instead of a full
+// StaticGraph<QueryEdge::EdgeData>::EdgeArrayEntry. Each field only takes as many bits as its
+// largest value in the graph needs, the records are decoded in GetTarget and GetEdgeData. Thus
+// edge data is returned by value.
+class CompactQueryGraph
+{
+  public:
+    using EdgeData = QueryEdge::EdgeData;
+    using NodeIterator = NodeID;
+    using EdgeIterator = NodeID;
+    using EdgeRange = osrm::range<EdgeIterator>;
+    using NodeArrayEntry = StaticGraph<EdgeData>::NodeArrayEntry;
+    using EdgeArrayEntry = StaticGraph<EdgeData>::EdgeArrayEntry;
+    using InputEdge = StaticGraph<EdgeData>::InputEdge;
+
+    // Packs the edges of a StaticGraph with its node and edge array, both are released.
+    CompactQueryGraph(std::vector<NodeArrayEntry> &nodes, std::vector<EdgeArrayEntry> &edges)
+    {
+        BOOST_ASSERT(!nodes.empty());
+        number_of_nodes = static_cast<NodeIterator>(nodes.size() - 1);
+        number_of_edges = static_cast<EdgeIterator>(edges.size());
+
+        std::vector<EdgeIterator> first_edges(nodes.size());
+        for (const auto node : osrm::irange<std::size_t>(0, nodes.size()))
+        {
+            first_edges[node] = nodes[node].first_edge;
+        }
+        node_array.swap(first_edges);
+        nodes.clear();
+        nodes.shrink_to_fit();
+
+        std::uint32_t max_target = 0, max_id = 0, max_distance = 0, max_length = 0;
+        for (const auto &edge : edges)
+        {
+            BOOST_ASSERT(edge.data.distance >= 0);
+            max_target = std::max<std::uint32_t>(max_target, edge.target);
+            max_id = std::max<std::uint32_t>(max_id, edge.data.id);
+            max_distance = std::max<std::uint32_t>(max_distance, edge.data.distance);
+            max_length = std::max<std::uint32_t>(max_length, edge.data.length);
+        }
+        target_bits = BitsFor(max_target);
+        id_bits = BitsFor(max_id);
+        distance_bits = BitsFor(max_distance);
+        length_bits = BitsFor(max_length);
+        id_offset = target_bits;
+        distance_offset = id_offset + id_bits;
+        length_offset = distance_offset + distance_bits;
+        flags_offset = length_offset + length_bits;
+        record_bits = flags_offset + FLAG_BITS;
+
+        // one spare word, so that a field can always be read from two consecutive words
+        words.resize((static_cast<std::uint64_t>(number_of_edges) * record_bits + 63) / 64 + 1, 0);
+        for (const auto edge : osrm::irange(0u, number_of_edges))
+        {
+            const EdgeArrayEntry &entry = edges[edge];
+            const std::uint64_t offset = static_cast<std::uint64_t>(edge) * record_bits;
+            WriteBits(offset, target_bits, entry.target);
+            WriteBits(offset + id_offset, id_bits, entry.data.id);
+            WriteBits(offset + distance_offset, distance_bits,
+                      static_cast<std::uint32_t>(entry.data.distance));
+            WriteBits(offset + length_offset, length_bits, entry.data.length);
+            WriteBits(offset + flags_offset, FLAG_BITS,
+                      (entry.data.shortcut ? SHORTCUT_FLAG : 0) |
+                          (entry.data.forward ? FORWARD_FLAG : 0) |
+                          (entry.data.backward ? BACKWARD_FLAG : 0));
+        }
+        edges.clear();
+        edges.shrink_to_fit();
+
+        SimpleLogger().Write() << "packed " << number_of_edges << " edges into " << record_bits
+                               << " bits each instead of " << 8 * sizeof(EdgeArrayEntry);
+    }
+
+    unsigned GetNumberOfNodes() const { return number_of_nodes; }
+
+    unsigned GetNumberOfEdges() const { return number_of_edges; }
+
+    unsigned GetOutDegree(const NodeIterator n) const { return EndEdges(n) - BeginEdges(n); }
+
+    unsigned GetRecordBits() const { return record_bits; }
+
+    NodeIterator GetTarget(const EdgeIterator e) const
+    {
+        return ReadBits(static_cast<std::uint64_t>(e) * record_bits, target_bits);
+    }
+
+    EdgeData GetEdgeData(const EdgeIterator e) const
+    {
+        const std::uint64_t offset = static_cast<std::uint64_t>(e) * record_bits;
+        const std::uint32_t flags = ReadBits(offset + flags_offset, FLAG_BITS);
+        EdgeData data;
+        data.id = ReadBits(offset + id_offset, id_bits);
+        data.distance = ReadBits(offset + distance_offset, distance_bits);
+        data.length = ReadBits(offset + length_offset, length_bits);
+        data.shortcut = 0 != (flags & SHORTCUT_FLAG);
+        data.forward = 0 != (flags & FORWARD_FLAG);
+        data.backward = 0 != (flags & BACKWARD_FLAG);
+        return data;
+    }
+
+    EdgeIterator BeginEdges(const NodeIterator n) const { return node_array[n]; }
+
+    EdgeIterator EndEdges(const NodeIterator n) const { return node_array[n + 1]; }
+
+    // loads the word of the first edge record of a node into the cache ahead of a search
+    void PrefetchEdges(const NodeIterator n) const
+    {
+        osrm::prefetch(words.data() + static_cast<std::uint64_t>(node_array[n]) * record_bits / 64);
+    }
+
+    EdgeRange GetAdjacentEdgeRange(const NodeID node) const
+    {
+        return osrm::irange(BeginEdges(node), EndEdges(node));
+    }
+
+    // searches for a specific edge
+    EdgeIterator FindEdge(const NodeIterator from, const NodeIterator to) const
+    {
+        for (const auto i : GetAdjacentEdgeRange(from))
+        {
+            if (to == GetTarget(i))
+            {
+                return i;
+            }
+        }
+        return SPECIAL_EDGEID;
+    }
+
+    // searches for a specific edge
+    EdgeIterator FindSmallestEdge(const NodeIterator from, const NodeIterator to) const
+    {
+        EdgeIterator smallest_edge = SPECIAL_EDGEID;
+        EdgeWeight smallest_weight = INVALID_EDGE_WEIGHT;
+        for (auto edge : GetAdjacentEdgeRange(from))
+        {
+            const NodeID target = GetTarget(edge);
+            const EdgeWeight weight = GetEdgeData(edge).distance;
+            if (target == to && weight < smallest_weight)
+            {
+                smallest_edge = edge;
+                smallest_weight = weight;
+            }
+        }
+        return smallest_edge;
+    }
+
+    EdgeIterator FindEdgeInEitherDirection(const NodeIterator from, const NodeIterator to) const
+    {
+        EdgeIterator tmp = FindEdge(from, to);
+        return (SPECIAL_NODEID != tmp ? tmp : FindEdge(to, from));
+    }
+
+    EdgeIterator
+    FindEdgeIndicateIfReverse(const NodeIterator from, const NodeIterator to, bool &result) const
+    {
+        EdgeIterator current_iterator = FindEdge(from, to);
+        if (SPECIAL_NODEID == current_iterator)
+        {
+            current_iterator = FindEdge(to, from);
+            if (SPECIAL_NODEID != current_iterator)
+            {
+                result = true;
+            }
+        }
+        return current_iterator;
+    }
+
+  private:
+    static constexpr unsigned FLAG_BITS = 3;
+    static constexpr std::uint32_t SHORTCUT_FLAG = 1;
+    static constexpr std::uint32_t FORWARD_FLAG = 2;
+    static constexpr std::uint32_t BACKWARD_FLAG = 4;
+
+    static unsigned BitsFor(std::uint32_t max_value)
+    {
+        unsigned bits = 1;
+        while (max_value >>= 1)
+        {
+            ++bits;
+        }
+        return bits;
+    }
+
+    // fields are at most 32 bits wide and may span two words
+    std::uint32_t ReadBits(const std::uint64_t offset, const unsigned width) const
+    {
+        const std::uint64_t word = offset / 64;
+        const unsigned shift = offset % 64;
+        std::uint64_t value = words[word] >> shift;
+        if (shift + width > 64)
+        {
+            value |= words[word + 1] << (64 - shift);
+        }
+        return static_cast<std::uint32_t>(value & ((std::uint64_t(1) << width) - 1));
+    }
+
+    void WriteBits(const std::uint64_t offset, const unsigned width, const std::uint32_t value)
+    {
+        BOOST_ASSERT(width == 32 || value < (std::uint64_t(1) << width));
+        const std::uint64_t word = offset / 64;
+        const unsigned shift = offset % 64;
+        words[word] |= static_cast<std::uint64_t>(value) << shift;
+        if (shift + width > 64)
+        {
+            words[word + 1] |= static_cast<std::uint64_t>(value) >> (64 - shift);
+        }
+    }
+
+    NodeIterator number_of_nodes;
+    EdgeIterator number_of_edges;
+
+    unsigned target_bits;
+    unsigned id_bits;
+    unsigned distance_bits;
+    unsigned length_bits;
+    unsigned id_offset;
+    unsigned distance_offset;
+    unsigned length_offset;
+    unsigned flags_offset;
+    unsigned record_bits;
+
+    std::vector<EdgeIterator> node_array;
+    std::vector<std::uint64_t> words;
+};
+
+#endif // COMPACT_QUERY_GRAPH_HPP
@@ -26,17 +26,25 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "compressed_edge_container.hpp"
+#include "geometry_encoding.hpp"
+#include "../algorithms/douglas_peucker.hpp"
+#include "../util/integer_range.hpp"
 #include "../util/simple_logger.hpp"
 
 #include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <string>
 
 #include <iostream>
 
+constexpr unsigned CompressedEdgeContainer::CHUNK_CAPACITY;
+constexpr unsigned CompressedEdgeContainer::INVALID_INDEX;
+
 CompressedEdgeContainer::CompressedEdgeContainer()
 {
     m_free_list.reserve(100);
@@ -45,7 +53,7 @@ CompressedEdgeContainer::CompressedEdgeContainer()
 
 void CompressedEdgeContainer::IncreaseFreeList()
 {
-    m_compressed_geometries.resize(m_compressed_geometries.size() + 100);
+    m_bucket_chains.resize(m_bucket_chains.size() + 100);
     for (unsigned i = 100; i > 0; --i)
     {
         m_free_list.emplace_back(free_list_maximum);
@@ -53,61 +61,221 @@ void CompressedEdgeContainer::IncreaseFreeList()
     }
 }
 
+unsigned CompressedEdgeContainer::AllocateChunk()
+{
+    const unsigned chunk_id = static_cast<unsigned>(m_chunk_next.size());
+    BOOST_ASSERT(INVALID_INDEX != chunk_id);
+    m_chunk_nodes.resize(m_chunk_nodes.size() + CHUNK_CAPACITY);
+    m_chunk_fill.emplace_back(0);
+    m_chunk_next.emplace_back(INVALID_INDEX);
+    return chunk_id;
+}
+
+void CompressedEdgeContainer::AppendToBucket(const unsigned bucket_id,
+                                             const NodeID node_id,
+                                             const EdgeWeight weight)
+{
+    BucketChain &chain = m_bucket_chains[bucket_id];
+    if (INVALID_INDEX == chain.tail || CHUNK_CAPACITY == m_chunk_fill[chain.tail])
+    {
+        const unsigned chunk_id = AllocateChunk();
+        if (INVALID_INDEX == chain.tail)
+        {
+            chain.head = chunk_id;
+        }
+        else
+        {
+            m_chunk_next[chain.tail] = chunk_id;
+        }
+        chain.tail = chunk_id;
+    }
+    m_chunk_nodes[chain.tail * CHUNK_CAPACITY + m_chunk_fill[chain.tail]] =
+        CompressedNode(node_id, weight);
+    ++m_chunk_fill[chain.tail];
+    ++chain.size;
+}
+
+unsigned CompressedEdgeContainer::GetBucketSize(const unsigned bucket_id) const
+{
+    if (m_flattened)
+    {
+        return m_geometry_offsets[bucket_id + 1] - m_geometry_offsets[bucket_id];
+    }
+    return m_bucket_chains[bucket_id].size;
+}
+
+template <typename CallbackT>
+void CompressedEdgeContainer::ForEachNodeInBucket(const unsigned bucket_id,
+                                                  CallbackT &&callback) const
+{
+    if (m_flattened)
+    {
+        for (const auto i : osrm::irange(m_geometry_offsets[bucket_id],
+                                         m_geometry_offsets[bucket_id + 1]))
+        {
+            callback(m_geometry_nodes[i]);
+        }
+        return;
+    }
+    for (unsigned chunk_id = m_bucket_chains[bucket_id].head; INVALID_INDEX != chunk_id;
+         chunk_id = m_chunk_next[chunk_id])
+    {
+        const auto chunk_begin = m_chunk_nodes.begin() + chunk_id * CHUNK_CAPACITY;
+        std::for_each(chunk_begin, chunk_begin + m_chunk_fill[chunk_id], callback);
+    }
+}
+
+void CompressedEdgeContainer::Flatten()
+{
+    BOOST_ASSERT(!m_flattened);
+
+    // buckets are laid out by id, exactly like they end up in the geometry file
+    m_geometry_offsets.resize(m_bucket_chains.size() + 1);
+    m_geometry_offsets[0] = 0;
+    for (const auto i : osrm::irange<std::size_t>(0, m_bucket_chains.size()))
+    {
+        BOOST_ASSERT(std::numeric_limits<unsigned>::max() - m_geometry_offsets[i] >
+                     m_bucket_chains[i].size);
+        m_geometry_offsets[i + 1] = m_geometry_offsets[i] + m_bucket_chains[i].size;
+    }
+
+    m_geometry_nodes.reserve(m_geometry_offsets.back());
+    for (const auto i : osrm::irange<std::size_t>(0, m_bucket_chains.size()))
+    {
+        ForEachNodeInBucket(i, [this](const CompressedNode &node)
+                            {
+                                m_geometry_nodes.push_back(node);
+                            });
+        BOOST_ASSERT(m_geometry_nodes.size() == m_geometry_offsets[i + 1]);
+    }
+    m_flattened = true;
+
+    // release the arena
+    std::vector<BucketChain>().swap(m_bucket_chains);
+    std::vector<CompressedNode>().swap(m_chunk_nodes);
+    std::vector<std::uint8_t>().swap(m_chunk_fill);
+    std::vector<unsigned>().swap(m_chunk_next);
+}
+
 bool CompressedEdgeContainer::HasEntryForID(const EdgeID edge_id) const
 {
-    auto iter = m_edge_id_to_list_index_map.find(edge_id);
-    return iter != m_edge_id_to_list_index_map.end();
+    return edge_id < m_edge_id_to_list_index.size() &&
+           INVALID_INDEX != m_edge_id_to_list_index[edge_id];
 }
 
 unsigned CompressedEdgeContainer::GetPositionForID(const EdgeID edge_id) const
 {
-    auto map_iterator = m_edge_id_to_list_index_map.find(edge_id);
-    BOOST_ASSERT(map_iterator != m_edge_id_to_list_index_map.end());
-    BOOST_ASSERT(map_iterator->second < m_compressed_geometries.size());
-    return map_iterator->second;
+    BOOST_ASSERT(HasEntryForID(edge_id));
+    BOOST_ASSERT(m_edge_id_to_list_index[edge_id] < static_cast<unsigned>(free_list_maximum));
+    return m_edge_id_to_list_index[edge_id];
 }
 
 void CompressedEdgeContainer::SerializeInternalVector(const std::string &path) const
 {
+    BOOST_ASSERT(m_flattened);
 
     boost::filesystem::fstream geometry_out_stream(path, std::ios::binary | std::ios::out);
-    const unsigned compressed_geometries = m_compressed_geometries.size() + 1;
+    const unsigned compressed_geometries = m_geometry_offsets.size();
     BOOST_ASSERT(std::numeric_limits<unsigned>::max() != compressed_geometries);
     geometry_out_stream.write((char *)&compressed_geometries, sizeof(unsigned));
 
-    // write indices array
-    unsigned prefix_sum_of_list_indices = 0;
-    for (const auto &elem : m_compressed_geometries)
+    // write indices array, the offsets already are the prefix sums including the sentinel
+    geometry_out_stream.write((char *)m_geometry_offsets.data(),
+                              m_geometry_offsets.size() * sizeof(unsigned));
+
+    // number of geometry entries to follow, it is the (inclusive) prefix sum
+    const unsigned number_of_geometry_entries = m_geometry_offsets.back();
+    BOOST_ASSERT(m_geometry_nodes.size() == number_of_geometry_entries);
+    geometry_out_stream.write((char *)&number_of_geometry_entries, sizeof(unsigned));
+
+    // write compressed geometries, only the node ids are stored
+    std::vector<NodeID> node_id_buffer;
+    node_id_buffer.reserve(4096);
+    for (auto block_begin = m_geometry_nodes.begin(); block_begin != m_geometry_nodes.end();)
     {
-        geometry_out_stream.write((char *)&prefix_sum_of_list_indices, sizeof(unsigned));
+        const auto block_end =
+            block_begin + std::min<std::ptrdiff_t>(4096, m_geometry_nodes.end() - block_begin);
+        node_id_buffer.clear();
+        std::transform(block_begin, block_end, std::back_inserter(node_id_buffer),
+                       [](const CompressedNode &node)
+                       {
+                           return node.first;
+                       });
+        geometry_out_stream.write((char *)node_id_buffer.data(),
+                                  node_id_buffer.size() * sizeof(NodeID));
+        block_begin = block_end;
+    }
 
-        const std::vector<CompressedNode> &current_vector = elem;
-        const unsigned unpacked_size = current_vector.size();
-        BOOST_ASSERT(std::numeric_limits<unsigned>::max() != unpacked_size);
-        prefix_sum_of_list_indices += unpacked_size;
+    // zoom levels of the geometry entries, if computed
+    const unsigned number_of_zoom_levels = m_zoom_levels.size();
+    BOOST_ASSERT(0 == number_of_zoom_levels || number_of_geometry_entries == number_of_zoom_levels);
+    geometry_out_stream.write((char *)&number_of_zoom_levels, sizeof(unsigned));
+    if (number_of_zoom_levels > 0)
+    {
+        geometry_out_stream.write((char *)m_zoom_levels.data(),
+                                  number_of_zoom_levels * sizeof(std::uint8_t));
     }
-    // sentinel element
-    geometry_out_stream.write((char *)&prefix_sum_of_list_indices, sizeof(unsigned));
 
-    // number of geometry entries to follow, it is the (inclusive) prefix sum
-    geometry_out_stream.write((char *)&prefix_sum_of_list_indices, sizeof(unsigned));
+    // the geometry entries once more delta and varint encoded, the facades load these instead
+    // of the plain node ids. Files without them end after the zoom levels.
+    std::vector<unsigned> block_offsets;
+    std::vector<std::uint8_t> encoded_nodes;
+    geometry_encoding::Encode(m_geometry_offsets,
+                              [this](const unsigned i)
+                              {
+                                  return m_geometry_nodes[i].first;
+                              },
+                              block_offsets, encoded_nodes);
+    const unsigned number_of_block_offsets = block_offsets.size();
+    geometry_out_stream.write((char *)&number_of_block_offsets, sizeof(unsigned));
+    geometry_out_stream.write((char *)block_offsets.data(),
+                              number_of_block_offsets * sizeof(unsigned));
+    const unsigned number_of_encoded_bytes = encoded_nodes.size();
+    geometry_out_stream.write((char *)&number_of_encoded_bytes, sizeof(unsigned));
+    geometry_out_stream.write((char *)encoded_nodes.data(),
+                              number_of_encoded_bytes * sizeof(std::uint8_t));
+    SimpleLogger().Write() << "encoded " << number_of_geometry_entries << " geometry nodes in "
+                           << number_of_encoded_bytes << " bytes";
+    // all done, let's close the resource
+    geometry_out_stream.close();
+}
+
+void CompressedEdgeContainer::ComputeZoomLevels(
+    const NodeBasedDynamicGraph &graph, const std::vector<QueryNode> &internal_to_external_node_map)
+{
+    BOOST_ASSERT(m_flattened);
+    // geometry entries are written bucket by bucket
+    m_zoom_levels.assign(m_geometry_offsets.back(), 0);
 
-    unsigned control_sum = 0;
-    // write compressed geometries
-    for (auto &elem : m_compressed_geometries)
+    std::vector<FixedPointCoordinate> geometry;
+    std::vector<std::uint8_t> zoom_levels;
+    const auto coordinate_of = [&internal_to_external_node_map](const NodeID node)
     {
-        const std::vector<CompressedNode> &current_vector = elem;
-        const unsigned unpacked_size = current_vector.size();
-        control_sum += unpacked_size;
-        BOOST_ASSERT(std::numeric_limits<unsigned>::max() != unpacked_size);
-        for (const CompressedNode current_node : current_vector)
+        const QueryNode &query_node = internal_to_external_node_map[node];
+        return FixedPointCoordinate(query_node.lat, query_node.lon);
+    };
+    for (const auto source : osrm::irange(0u, graph.GetNumberOfNodes()))
+    {
+        for (const auto edge : graph.GetAdjacentEdgeRange(source))
         {
-            geometry_out_stream.write((char *)&(current_node.first), sizeof(NodeID));
+            if (!HasEntryForID(edge))
+            {
+                continue;
+            }
+            // the bucket does not contain the source of the edge
+            const unsigned bucket_id = GetPositionForID(edge);
+            geometry.clear();
+            geometry.push_back(coordinate_of(source));
+            for (const CompressedNode &node : GetBucketReference(edge))
+            {
+                geometry.push_back(coordinate_of(node.first));
+            }
+
+            DouglasPeucker::ComputeZoomLevels(geometry, zoom_levels);
+            std::copy(std::next(zoom_levels.begin()), zoom_levels.end(),
+                      m_zoom_levels.begin() + m_geometry_offsets[bucket_id]);
         }
     }
-    BOOST_ASSERT(control_sum == prefix_sum_of_list_indices);
-    // all done, let's close the resource
-    geometry_out_stream.close();
 }
 
 void CompressedEdgeContainer::CompressEdge(const EdgeID edge_id_1,
@@ -118,6 +286,7 @@ void CompressedEdgeContainer::CompressEdge(const EdgeID edge_id_1,
                                       const EdgeWeight weight2)
 {
     // remove super-trivial geometries
+    BOOST_ASSERT(!m_flattened);
     BOOST_ASSERT(SPECIAL_EDGEID != edge_id_1);
     BOOST_ASSERT(SPECIAL_EDGEID != edge_id_2);
     BOOST_ASSERT(SPECIAL_NODEID != via_node_id);
@@ -130,7 +299,16 @@ void CompressedEdgeContainer::CompressEdge(const EdgeID edge_id_1,
     //
     // General scheme:
     // 1. append via node id to list of edge_id_1
-    // 2. find list for edge_id_2, if yes add all elements and delete it
+    // 2. find list for edge_id_2, if yes splice its chunks and delete it
+
+    if (m_edge_id_to_list_index.size() <= std::max(edge_id_1, edge_id_2))
+    {
+        // grow geometrically, edge ids are dense
+        m_edge_id_to_list_index.resize(
+            std::max<std::size_t>(std::max(edge_id_1, edge_id_2) + 1,
+                                  2 * m_edge_id_to_list_index.size()),
+            INVALID_INDEX);
+    }
 
     // Add via node id. List is created if it does not exist
     if (!HasEntryForID(edge_id_1))
@@ -142,70 +320,65 @@ void CompressedEdgeContainer::CompressEdge(const EdgeID edge_id_1,
             IncreaseFreeList();
         }
         BOOST_ASSERT(!m_free_list.empty());
-        m_edge_id_to_list_index_map[edge_id_1] = m_free_list.back();
+        m_edge_id_to_list_index[edge_id_1] = m_free_list.back();
         m_free_list.pop_back();
     }
 
     // find bucket index
-    const auto iter = m_edge_id_to_list_index_map.find(edge_id_1);
-    BOOST_ASSERT(iter != m_edge_id_to_list_index_map.end());
-    const unsigned edge_bucket_id1 = iter->second;
-    BOOST_ASSERT(edge_bucket_id1 == GetPositionForID(edge_id_1));
-    BOOST_ASSERT(edge_bucket_id1 < m_compressed_geometries.size());
-
-    std::vector<CompressedNode> &edge_bucket_list1 = m_compressed_geometries[edge_bucket_id1];
+    const unsigned edge_bucket_id1 = GetPositionForID(edge_id_1);
+    BOOST_ASSERT(edge_bucket_id1 < m_bucket_chains.size());
 
     // note we don't save the start coordinate: it is implicitly given by edge 1
     // weight1 is the distance to the (currently) last coordinate in the bucket
-    if (edge_bucket_list1.empty())
+    if (0 == m_bucket_chains[edge_bucket_id1].size)
     {
-        edge_bucket_list1.emplace_back(via_node_id, weight1);
+        AppendToBucket(edge_bucket_id1, via_node_id, weight1);
     }
 
-    BOOST_ASSERT(0 < edge_bucket_list1.size());
-    BOOST_ASSERT(!edge_bucket_list1.empty());
+    BOOST_ASSERT(0 < m_bucket_chains[edge_bucket_id1].size);
 
     if (HasEntryForID(edge_id_2))
     {
         // second edge is not atomic anymore
         const unsigned list_to_remove_index = GetPositionForID(edge_id_2);
-        BOOST_ASSERT(list_to_remove_index < m_compressed_geometries.size());
+        BOOST_ASSERT(list_to_remove_index < m_bucket_chains.size());
 
-        std::vector<CompressedNode> &edge_bucket_list2 =
-            m_compressed_geometries[list_to_remove_index];
+        BucketChain &edge_bucket_list1 = m_bucket_chains[edge_bucket_id1];
+        BucketChain &edge_bucket_list2 = m_bucket_chains[list_to_remove_index];
+        BOOST_ASSERT(0 < edge_bucket_list2.size);
 
-        // found an existing list, append it to the list of edge_id_1
-        edge_bucket_list1.insert(edge_bucket_list1.end(), edge_bucket_list2.begin(),
-                                 edge_bucket_list2.end());
+        // found an existing list, link its chunks to the list of edge_id_1
+        m_chunk_next[edge_bucket_list1.tail] = edge_bucket_list2.head;
+        edge_bucket_list1.tail = edge_bucket_list2.tail;
+        edge_bucket_list1.size += edge_bucket_list2.size;
 
         // remove the list of edge_id_2
-        m_edge_id_to_list_index_map.erase(edge_id_2);
-        BOOST_ASSERT(m_edge_id_to_list_index_map.end() ==
-                     m_edge_id_to_list_index_map.find(edge_id_2));
-        edge_bucket_list2.clear();
-        BOOST_ASSERT(0 == edge_bucket_list2.size());
+        m_edge_id_to_list_index[edge_id_2] = INVALID_INDEX;
+        BOOST_ASSERT(!HasEntryForID(edge_id_2));
+        edge_bucket_list2 = BucketChain();
         m_free_list.emplace_back(list_to_remove_index);
         BOOST_ASSERT(list_to_remove_index == m_free_list.back());
     }
     else
     {
         // we are certain that the second edge is atomic.
-        edge_bucket_list1.emplace_back(target_node_id, weight2);
+        AppendToBucket(edge_bucket_id1, target_node_id, weight2);
     }
 }
 
 void CompressedEdgeContainer::PrintStatistics() const
 {
-    const uint64_t compressed_edges = m_compressed_geometries.size();
+    const uint64_t compressed_edges = free_list_maximum;
     BOOST_ASSERT(0 == compressed_edges % 2);
-    BOOST_ASSERT(m_compressed_geometries.size() + m_free_list.size() > 0);
+    BOOST_ASSERT(compressed_edges + m_free_list.size() > 0);
 
     uint64_t compressed_geometries = 0;
     uint64_t longest_chain_length = 0;
-    for (const std::vector<CompressedNode> &current_vector : m_compressed_geometries)
+    for (const auto i : osrm::irange(0u, static_cast<unsigned>(free_list_maximum)))
     {
-        compressed_geometries += current_vector.size();
-        longest_chain_length = std::max(longest_chain_length, (uint64_t)current_vector.size());
+        const uint64_t chain_length = GetBucketSize(i);
+        compressed_geometries += chain_length;
+        longest_chain_length = std::max(longest_chain_length, chain_length);
     }
 
     SimpleLogger().Write() << "Geometry successfully removed:"
@@ -219,22 +392,39 @@ void CompressedEdgeContainer::PrintStatistics() const
                                   std::max((uint64_t)1, compressed_edges);
 }
 
-const CompressedEdgeContainer::EdgeBucket&
+CompressedEdgeContainer::EdgeBucket
 CompressedEdgeContainer::GetBucketReference(const EdgeID edge_id) const
 {
-    const unsigned index = m_edge_id_to_list_index_map.at(edge_id);
-    return m_compressed_geometries.at(index);
+    BOOST_ASSERT(m_flattened);
+    const unsigned index = GetPositionForID(edge_id);
+    return EdgeBucket(m_geometry_nodes.data() + m_geometry_offsets[index],
+                      m_geometry_nodes.data() + m_geometry_offsets[index + 1]);
 }
 
 NodeID CompressedEdgeContainer::GetFirstEdgeTargetID(const EdgeID edge_id) const
 {
-    const auto &bucket = GetBucketReference(edge_id);
-    BOOST_ASSERT(bucket.size() >= 2);
-    return bucket.front().first;
+    const unsigned index = GetPositionForID(edge_id);
+    BOOST_ASSERT(GetBucketSize(index) >= 2);
+    if (m_flattened)
+    {
+        return m_geometry_nodes[m_geometry_offsets[index]].first;
+    }
+    return m_chunk_nodes[m_bucket_chains[index].head * CHUNK_CAPACITY].first;
 }
+
 NodeID CompressedEdgeContainer::GetLastEdgeSourceID(const EdgeID edge_id) const
 {
-    const auto &bucket = GetBucketReference(edge_id);
-    BOOST_ASSERT(bucket.size() >= 2);
-    return bucket[bucket.size() - 2].first;
+    const unsigned index = GetPositionForID(edge_id);
+    const unsigned bucket_size = GetBucketSize(index);
+    BOOST_ASSERT(bucket_size >= 2);
+    NodeID last_source = SPECIAL_NODEID;
+    unsigned position = 0;
+    ForEachNodeInBucket(index, [&](const CompressedNode &node)
+                        {
+                            if (++position == bucket_size - 1)
+                            {
+                                last_source = node.first;
+                            }
+                        });
+    return last_source;
 }
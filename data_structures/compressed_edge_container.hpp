@@ -28,18 +28,44 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef GEOMETRY_COMPRESSOR_HPP_
 #define GEOMETRY_COMPRESSOR_HPP_
 
+#include "node_based_graph.hpp"
+#include "query_node.hpp"
 #include "../typedefs.h"
 
-#include <unordered_map>
-
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 class CompressedEdgeContainer
 {
   public:
     using CompressedNode = std::pair<NodeID, EdgeWeight>;
-    using EdgeBucket = std::vector<CompressedNode>;
+
+    // view of the geometry of one compressed edge in the flattened storage
+    class EdgeBucket
+    {
+      public:
+        EdgeBucket(const CompressedNode *begin, const CompressedNode *end)
+            : m_begin(begin), m_end(end)
+        {
+        }
+
+        const CompressedNode *begin() const { return m_begin; }
+        const CompressedNode *end() const { return m_end; }
+        const CompressedNode *data() const { return m_begin; }
+        std::size_t size() const { return m_end - m_begin; }
+        bool empty() const { return m_begin == m_end; }
+        const CompressedNode &front() const { return *m_begin; }
+        const CompressedNode &back() const { return *(m_end - 1); }
+        const CompressedNode &operator[](const std::size_t index) const { return m_begin[index]; }
+
+      private:
+        const CompressedNode *m_begin;
+        const CompressedNode *m_end;
+    };
 
     CompressedEdgeContainer();
     void CompressEdge(const EdgeID surviving_edge_id,
@@ -49,21 +75,62 @@ class CompressedEdgeContainer
                       const EdgeWeight weight1,
                       const EdgeWeight weight2);
 
+    // moves the geometries from the chunk arena into the GEOMETRIES_INDEX/GEOMETRIES_LIST
+    // layout. Has to be called once all edges are compressed, before the buckets are read.
+    void Flatten();
+
     bool HasEntryForID(const EdgeID edge_id) const;
     void PrintStatistics() const;
+    // zoom level at which every geometry node shows up in a generalized route, end points of
+    // the compressed edges always do. Written after the geometries by SerializeInternalVector,
+    // which appends the geometries once more in the encoding of geometry_encoding.hpp.
+    void ComputeZoomLevels(const NodeBasedDynamicGraph &graph,
+                           const std::vector<QueryNode> &internal_to_external_node_map);
     void SerializeInternalVector(const std::string &path) const;
     unsigned GetPositionForID(const EdgeID edge_id) const;
-    const EdgeBucket& GetBucketReference(const EdgeID edge_id) const;
+    EdgeBucket GetBucketReference(const EdgeID edge_id) const;
     NodeID GetFirstEdgeTargetID(const EdgeID edge_id) const;
     NodeID GetLastEdgeSourceID(const EdgeID edge_id) const;
 
   private:
+    // while compressing, every bucket is a linked list of fixed size chunks in one arena,
+    // so appending a node or a whole bucket never reallocates the geometry of an edge
+    static constexpr unsigned CHUNK_CAPACITY = 4;
+    static constexpr unsigned INVALID_INDEX = std::numeric_limits<unsigned>::max();
+
+    struct BucketChain
+    {
+        BucketChain() : head(INVALID_INDEX), tail(INVALID_INDEX), size(0) {}
+
+        unsigned head;
+        unsigned tail;
+        unsigned size;
+    };
+
     int free_list_maximum = 0;
+    bool m_flattened = false;
 
     void IncreaseFreeList();
-    std::vector<EdgeBucket> m_compressed_geometries;
+    unsigned AllocateChunk();
+    void AppendToBucket(const unsigned bucket_id, const NodeID node_id, const EdgeWeight weight);
+    unsigned GetBucketSize(const unsigned bucket_id) const;
+    // calls the callback for every node of the bucket in order, works before and after Flatten
+    template <typename CallbackT>
+    void ForEachNodeInBucket(const unsigned bucket_id, CallbackT &&callback) const;
+
+    std::vector<BucketChain> m_bucket_chains;
+    std::vector<CompressedNode> m_chunk_nodes;
+    std::vector<std::uint8_t> m_chunk_fill;
+    std::vector<unsigned> m_chunk_next;
+
+    // flattened storage: geometry of bucket i is [m_geometry_offsets[i], m_geometry_offsets[i+1])
+    std::vector<unsigned> m_geometry_offsets;
+    std::vector<CompressedNode> m_geometry_nodes;
+
+    std::vector<std::uint8_t> m_zoom_levels;
     std::vector<unsigned> m_free_list;
-    std::unordered_map<EdgeID, unsigned> m_edge_id_to_list_index_map;
+    // bucket of every edge id, INVALID_INDEX if the edge is not compressed
+    std::vector<unsigned> m_edge_id_to_list_index;
 };
 
 #endif // GEOMETRY_COMPRESSOR_HPP_
@@ -0,0 +1,285 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef D_ARY_HEAP_HPP
+#define D_ARY_HEAP_HPP
+
+#include "binary_heap.hpp"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Drop-in replacement for BinaryHeap with Arity children per node. The tree is log2(Arity) times
+// shallower, which shortens the sifts of DecreaseKey and Insert, and the siblings compared by
+// DeleteMin sit next to each other. As in BinaryHeap, the weights are kept next to the positions
+// in the heap array, so sifting never reads the inserted nodes.
+template <typename NodeID,
+          typename Key,
+          typename Weight,
+          typename Data,
+          typename IndexStorage = ArrayStorage<NodeID, NodeID>,
+          unsigned Arity = 4>
+class DAryHeap
+{
+    static_assert(Arity >= 2, "a heap node needs at least two children");
+
+  public:
+    using WeightType = Weight;
+    using DataType = Data;
+
+    DAryHeap(const DAryHeap &) = delete;
+    DAryHeap &operator=(const DAryHeap &) = delete;
+
+    template <typename... StorageArguments>
+    explicit DAryHeap(size_t maxID, StorageArguments &&... storage_arguments)
+        : node_index(maxID, std::forward<StorageArguments>(storage_arguments)...),
+          previous_insertions(0)
+    {
+        Clear();
+    }
+
+    const IndexStorage &GetIndexStorage() const { return node_index; }
+
+    void Clear()
+    {
+        previous_insertions += inserted_nodes.size();
+        heap.clear();
+        inserted_nodes.clear();
+        node_index.Clear();
+    }
+
+    std::size_t Size() const { return heap.size(); }
+
+    // nodes inserted since the construction of the heap, for the statistics of the benchmarks
+    std::uint64_t NumberOfInsertions() const
+    {
+        return previous_insertions + inserted_nodes.size();
+    }
+
+    // nodes the heap holds memory for, it keeps the memory of its largest search until deleted
+    std::size_t Capacity() const { return inserted_nodes.capacity(); }
+
+    bool Empty() const { return heap.empty(); }
+
+    void Insert(NodeID node, Weight weight, const Data &data)
+    {
+        const Key index = static_cast<Key>(inserted_nodes.size());
+        const Key position = static_cast<Key>(heap.size());
+        heap.push_back({index, weight});
+        inserted_nodes.emplace_back(node, position, weight, data);
+        node_index[node] = index;
+        Upheap(position);
+        CheckHeap();
+    }
+
+    Data &GetData(NodeID node)
+    {
+        const Key index = node_index.peek_index(node);
+        return inserted_nodes[index].data;
+    }
+
+    Data const &GetData(NodeID node) const
+    {
+        const Key index = node_index.peek_index(node);
+        return inserted_nodes[index].data;
+    }
+
+    Weight &GetKey(NodeID node)
+    {
+        const Key index = node_index[node];
+        return inserted_nodes[index].weight;
+    }
+
+    bool WasRemoved(const NodeID node) const
+    {
+        BOOST_ASSERT(WasInserted(node));
+        const Key index = node_index.peek_index(node);
+        return inserted_nodes[index].position == REMOVED;
+    }
+
+    // loads the index slot of a node into the cache ahead of WasInserted or GetKey
+    void Prefetch(const NodeID node) const { node_index.Prefetch(node); }
+
+    bool WasInserted(const NodeID node) const
+    {
+        const auto index = node_index.peek_index(node);
+        if (index >= static_cast<decltype(index)>(inserted_nodes.size()))
+        {
+            return false;
+        }
+        return inserted_nodes[index].node == node;
+    }
+
+    NodeID Min() const
+    {
+        BOOST_ASSERT(!heap.empty());
+        return inserted_nodes[heap.front().index].node;
+    }
+
+    Weight MinKey() const
+    {
+        BOOST_ASSERT(!heap.empty());
+        return heap.front().weight;
+    }
+
+    NodeID DeleteMin()
+    {
+        BOOST_ASSERT(!heap.empty());
+        const Key removed_index = heap.front().index;
+        heap.front() = heap.back();
+        heap.pop_back();
+        if (!heap.empty())
+        {
+            Downheap(0);
+        }
+        inserted_nodes[removed_index].position = REMOVED;
+        CheckHeap();
+        return inserted_nodes[removed_index].node;
+    }
+
+    void DeleteAll()
+    {
+        for (const auto &element : heap)
+        {
+            inserted_nodes[element.index].position = REMOVED;
+        }
+        heap.clear();
+    }
+
+    void DecreaseKey(NodeID node, Weight weight)
+    {
+        BOOST_ASSERT(std::numeric_limits<NodeID>::max() != node);
+        const Key index = node_index.peek_index(node);
+        const Key position = inserted_nodes[index].position;
+        BOOST_ASSERT(REMOVED != position);
+
+        inserted_nodes[index].weight = weight;
+        heap[position].weight = weight;
+        Upheap(position);
+        CheckHeap();
+    }
+
+  private:
+    static constexpr Key REMOVED = std::numeric_limits<Key>::max();
+
+    struct HeapNode
+    {
+        HeapNode(NodeID n, Key p, Weight w, Data d)
+            : node(n), position(p), weight(w), data(std::move(d))
+        {
+        }
+
+        NodeID node;
+        // position in the heap array, REMOVED once settled
+        Key position;
+        Weight weight;
+        Data data;
+    };
+    struct HeapElement
+    {
+        Key index;
+        Weight weight;
+    };
+
+    std::vector<HeapNode> inserted_nodes;
+    // the children of position i are at Arity * i + 1 to Arity * i + Arity
+    std::vector<HeapElement> heap;
+    IndexStorage node_index;
+    std::uint64_t previous_insertions;
+
+    void Downheap(Key position)
+    {
+        const HeapElement dropping = heap[position];
+        const std::size_t heap_size = heap.size();
+        std::size_t first_child = Arity * static_cast<std::size_t>(position) + 1;
+        while (first_child < heap_size)
+        {
+            const std::size_t last_child = std::min(first_child + Arity, heap_size);
+            std::size_t min_child = first_child;
+            for (std::size_t child = first_child + 1; child < last_child; ++child)
+            {
+                if (heap[child].weight < heap[min_child].weight)
+                {
+                    min_child = child;
+                }
+            }
+            if (dropping.weight <= heap[min_child].weight)
+            {
+                break;
+            }
+            heap[position] = heap[min_child];
+            inserted_nodes[heap[position].index].position = position;
+            position = static_cast<Key>(min_child);
+            first_child = Arity * min_child + 1;
+        }
+        heap[position] = dropping;
+        inserted_nodes[dropping.index].position = position;
+    }
+
+    void Upheap(Key position)
+    {
+        const HeapElement rising = heap[position];
+        while (position > 0)
+        {
+            const Key parent = (position - 1) / Arity;
+            if (heap[parent].weight <= rising.weight)
+            {
+                break;
+            }
+            heap[position] = heap[parent];
+            inserted_nodes[heap[position].index].position = position;
+            position = parent;
+        }
+        heap[position] = rising;
+        inserted_nodes[rising.index].position = position;
+    }
+
+    void CheckHeap()
+    {
+#ifndef NDEBUG
+        for (std::size_t i = 1; i < heap.size(); ++i)
+        {
+            BOOST_ASSERT(heap[i].weight >= heap[(i - 1) / Arity].weight);
+        }
+#endif
+    }
+};
+
+template <typename NodeID,
+          typename Key,
+          typename Weight,
+          typename Data,
+          typename IndexStorage,
+          unsigned Arity>
+constexpr Key DAryHeap<NodeID, Key, Weight, Data, IndexStorage, Arity>::REMOVED;
+
+#endif // D_ARY_HEAP_HPP
@@ -32,10 +32,95 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/iterator/iterator_facade.hpp>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
 #include <limits>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+// Allocates the buckets of a DeallocatingVector on the heap.
+template <typename ElementT> struct HeapBucketAllocator
+{
+    static ElementT *Allocate(const std::size_t number_of_elements)
+    {
+        return new ElementT[number_of_elements];
+    }
+
+    static void Deallocate(ElementT *bucket, const std::size_t) { delete[] bucket; }
+};
+
+#ifdef __linux__
+// Maps every bucket on its own, aligned to and padded to whole huge pages, and asks the kernel to
+// back it by transparent huge pages. The edge lists of a continent take hundreds of millions of
+// entries, with 4k pages their TLB misses show in every pass over them. A bucket still goes back
+// to the system as soon as the deallocation iterator or the vector releases it.
+template <typename ElementT> struct HugePageBucketAllocator
+{
+    static constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    static ElementT *Allocate(const std::size_t number_of_elements)
+    {
+        const std::size_t length = MappedLength(number_of_elements);
+        // map one huge page more than needed to align the bucket, then trim both ends
+        void *mapping = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == mapping)
+        {
+            throw std::bad_alloc();
+        }
+        const auto address = reinterpret_cast<std::uintptr_t>(mapping);
+        const auto aligned_address = (address + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        if (aligned_address != address)
+        {
+            munmap(mapping, aligned_address - address);
+        }
+        munmap(reinterpret_cast<void *>(aligned_address + length),
+               HUGE_PAGE_SIZE - (aligned_address - address));
+
+        void *bucket = reinterpret_cast<void *>(aligned_address);
+#ifdef MADV_HUGEPAGE
+        // only a hint, the bucket works with small pages as well
+        madvise(bucket, length, MADV_HUGEPAGE);
+#endif
+        ElementT *elements = static_cast<ElementT *>(bucket);
+        for (const auto index : osrm::irange<std::size_t>(0, number_of_elements))
+        {
+            new (elements + index) ElementT();
+        }
+        return elements;
+    }
+
+    static void Deallocate(ElementT *bucket, const std::size_t number_of_elements)
+    {
+        if (!std::is_trivially_destructible<ElementT>::value)
+        {
+            for (const auto index : osrm::irange<std::size_t>(0, number_of_elements))
+            {
+                bucket[index].~ElementT();
+            }
+        }
+        munmap(bucket, MappedLength(number_of_elements));
+    }
+
+  private:
+    static std::size_t MappedLength(const std::size_t number_of_elements)
+    {
+        const std::size_t bytes = number_of_elements * sizeof(ElementT);
+        return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    }
+};
+
+template <typename ElementT> using DefaultBucketAllocator = HugePageBucketAllocator<ElementT>;
+#else
+template <typename ElementT> using DefaultBucketAllocator = HeapBucketAllocator<ElementT>;
+#endif
+
 template <typename ElementT> struct ConstDeallocatingVectorIteratorState
 {
     ConstDeallocatingVectorIteratorState()
@@ -186,11 +271,12 @@ class DeallocatingVectorIterator
     }
 };
 
-template <typename ElementT, std::size_t ELEMENTS_PER_BLOCK>
+template <typename ElementT, std::size_t ELEMENTS_PER_BLOCK, typename BucketAllocator>
 class DeallocatingVectorRemoveIterator
-    : public boost::iterator_facade<DeallocatingVectorRemoveIterator<ElementT, ELEMENTS_PER_BLOCK>,
-                                    ElementT,
-                                    boost::forward_traversal_tag>
+    : public boost::iterator_facade<
+          DeallocatingVectorRemoveIterator<ElementT, ELEMENTS_PER_BLOCK, BucketAllocator>,
+          ElementT,
+          boost::forward_traversal_tag>
 {
     DeallocatingVectorIteratorState<ElementT> current_state;
 
@@ -213,7 +299,8 @@ class DeallocatingVectorRemoveIterator
             // delete old bucket entry
             if (nullptr != current_state.bucket_list->at(old_bucket))
             {
-                delete[] current_state.bucket_list->at(old_bucket);
+                BucketAllocator::Deallocate(current_state.bucket_list->at(old_bucket),
+                                            ELEMENTS_PER_BLOCK);
                 current_state.bucket_list->at(old_bucket) = nullptr;
             }
         }
@@ -237,7 +324,12 @@ class DeallocatingVectorRemoveIterator
     }
 };
 
-template <typename ElementT, std::size_t ELEMENTS_PER_BLOCK = 8388608 / sizeof(ElementT)>
+// The elements live in fixed-size buckets that never move. Growing does not copy, a move or swap
+// hands over the bucket pointers, and writes to distinct indices below size() may come from
+// several threads at once, so a list can be resized once and then filled in parallel.
+template <typename ElementT,
+          std::size_t ELEMENTS_PER_BLOCK = 8388608 / sizeof(ElementT),
+          typename BucketAllocator = DefaultBucketAllocator<ElementT>>
 class DeallocatingVector
 {
     std::size_t current_size;
@@ -248,16 +340,29 @@ class DeallocatingVector
     using const_iterator = ConstDeallocatingVectorIterator<ElementT, ELEMENTS_PER_BLOCK>;
 
     // this forward-only iterator deallocates all buckets that have been visited
-    using deallocation_iterator = DeallocatingVectorRemoveIterator<ElementT, ELEMENTS_PER_BLOCK>;
+    using deallocation_iterator =
+        DeallocatingVectorRemoveIterator<ElementT, ELEMENTS_PER_BLOCK, BucketAllocator>;
 
     DeallocatingVector() : current_size(0)
     {
-        bucket_list.emplace_back(new ElementT[ELEMENTS_PER_BLOCK]);
+        bucket_list.emplace_back(BucketAllocator::Allocate(ELEMENTS_PER_BLOCK));
+    }
+
+    DeallocatingVector(const DeallocatingVector &) = delete;
+    DeallocatingVector &operator=(const DeallocatingVector &) = delete;
+
+    DeallocatingVector(DeallocatingVector &&other) : current_size(0) { swap(other); }
+
+    DeallocatingVector &operator=(DeallocatingVector &&other)
+    {
+        clear();
+        swap(other);
+        return *this;
     }
 
     ~DeallocatingVector() { clear(); }
 
-    void swap(DeallocatingVector<ElementT, ELEMENTS_PER_BLOCK> &other)
+    void swap(DeallocatingVector &other)
     {
         std::swap(current_size, other.current_size);
         bucket_list.swap(other.bucket_list);
@@ -265,13 +370,11 @@ class DeallocatingVector
 
     void clear()
     {
-        // Delete[]'ing ptr's to all Buckets
         for (auto bucket : bucket_list)
         {
             if (nullptr != bucket)
             {
-                delete[] bucket;
-                bucket = nullptr;
+                BucketAllocator::Deallocate(bucket, ELEMENTS_PER_BLOCK);
             }
         }
         bucket_list.clear();
@@ -284,7 +387,7 @@ class DeallocatingVector
         const std::size_t current_capacity = capacity();
         if (current_size == current_capacity)
         {
-            bucket_list.push_back(new ElementT[ELEMENTS_PER_BLOCK]);
+            bucket_list.push_back(BucketAllocator::Allocate(ELEMENTS_PER_BLOCK));
         }
 
         std::size_t current_index = size() % ELEMENTS_PER_BLOCK;
@@ -297,7 +400,7 @@ class DeallocatingVector
         const std::size_t current_capacity = capacity();
         if (current_size == current_capacity)
         {
-            bucket_list.push_back(new ElementT[ELEMENTS_PER_BLOCK]);
+            bucket_list.push_back(BucketAllocator::Allocate(ELEMENTS_PER_BLOCK));
         }
 
         const std::size_t current_index = size() % ELEMENTS_PER_BLOCK;
@@ -313,7 +416,7 @@ class DeallocatingVector
         {
             while (capacity() < new_size)
             {
-                bucket_list.push_back(new ElementT[ELEMENTS_PER_BLOCK]);
+                bucket_list.push_back(BucketAllocator::Allocate(ELEMENTS_PER_BLOCK));
             }
         }
         else
@@ -324,7 +427,7 @@ class DeallocatingVector
             {
                 if (nullptr != bucket_list[bucket_index])
                 {
-                    delete[] bucket_list[bucket_index];
+                    BucketAllocator::Deallocate(bucket_list[bucket_index], ELEMENTS_PER_BLOCK);
                 }
             }
             bucket_list.resize(number_of_necessary_buckets);
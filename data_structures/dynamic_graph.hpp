@@ -39,6 +39,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <algorithm>
 #include <atomic>
 #include <limits>
+#include <numeric>
 #include <tuple>
 #include <vector>
 
@@ -235,6 +236,18 @@ template <typename EdgeDataT> class DynamicGraph
         makeDummy(last);
     }
 
+    // removes all edges of source. Invalidates edge iterators for the source node
+    void DeleteEdges(const NodeIterator source)
+    {
+        Node &node = node_array[source];
+        for (const auto edge : GetAdjacentEdgeRange(source))
+        {
+            makeDummy(edge);
+        }
+        number_of_edges -= node.edges;
+        node.edges = 0;
+    }
+
     // removes all edges (source,target)
     int32_t DeleteEdgesTo(const NodeIterator source, const NodeIterator target)
     {
@@ -289,6 +302,80 @@ template <typename EdgeDataT> class DynamicGraph
         return smallest_edge;
     }
 
+    // number of edge slots including the holes left behind by InsertEdge and DeleteEdge
+    std::size_t GetEdgeStorageSize() const { return edge_list.size(); }
+
+    // bytes held by the node array and the edge slots
+    std::size_t GetMemoryUsage() const
+    {
+        return node_array.capacity() * sizeof(Node) + edge_list.size() * sizeof(Edge);
+    }
+
+    // Moves all edges in front of the edge list and releases the unused tail.
+    // Invalidates all edge iterators.
+    void Compact()
+    {
+        std::vector<NodeIterator> nodes_by_first_edge(number_of_nodes);
+        std::iota(nodes_by_first_edge.begin(), nodes_by_first_edge.end(), 0u);
+        std::sort(nodes_by_first_edge.begin(), nodes_by_first_edge.end(),
+                  [this](const NodeIterator lhs, const NodeIterator rhs)
+                  {
+                      return node_array[lhs].first_edge < node_array[rhs].first_edge;
+                  });
+
+        // ranges are disjoint, so every range is moved towards the front or stays in place
+        EdgeIterator position = 0;
+        for (const auto node : nodes_by_first_edge)
+        {
+            Node &current = node_array[node];
+            BOOST_ASSERT(0 == current.edges || position <= current.first_edge);
+            for (const auto i : osrm::irange(0u, current.edges))
+            {
+                edge_list[position + i] = edge_list[current.first_edge + i];
+            }
+            current.first_edge = position;
+            position += current.edges;
+        }
+        if (node_array.size() > number_of_nodes)
+        {
+            node_array.back().first_edge = position;
+            node_array.back().edges = 0;
+        }
+        BOOST_ASSERT(position == number_of_edges);
+        edge_list.resize(position);
+    }
+
+    // Keeps every node with a valid entry in new_id_from_old_id under its new id and removes the
+    // edges of all other nodes. Targets of the kept edges are renumbered as well, thus they must
+    // not point to a removed node. Invalidates all edge iterators.
+    void RenumberNodes(const std::vector<NodeIterator> &new_id_from_old_id,
+                       const NodeIterator new_number_of_nodes)
+    {
+        BOOST_ASSERT(new_id_from_old_id.size() == number_of_nodes);
+        std::vector<Node> new_node_array(new_number_of_nodes + 1);
+        EdgeIterator remaining_edges = 0;
+        for (const auto node : osrm::irange(0u, number_of_nodes))
+        {
+            const NodeIterator new_id = new_id_from_old_id[node];
+            if (SPECIAL_NODEID == new_id)
+            {
+                continue;
+            }
+            BOOST_ASSERT(new_id < new_number_of_nodes);
+            for (const auto edge : GetAdjacentEdgeRange(node))
+            {
+                BOOST_ASSERT(SPECIAL_NODEID != new_id_from_old_id[edge_list[edge].target]);
+                edge_list[edge].target = new_id_from_old_id[edge_list[edge].target];
+            }
+            new_node_array[new_id] = node_array[node];
+            remaining_edges += node_array[node].edges;
+        }
+        node_array.swap(new_node_array);
+        number_of_nodes = new_number_of_nodes;
+        number_of_edges = remaining_edges;
+        Compact();
+    }
+
     EdgeIterator FindEdgeInEitherDirection(const NodeIterator from, const NodeIterator to) const
     {
         EdgeIterator tmp = FindEdge(from, to);
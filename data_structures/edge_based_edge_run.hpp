@@ -0,0 +1,317 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef EDGE_BASED_EDGE_RUN_HPP
+#define EDGE_BASED_EDGE_RUN_HPP
+
+#include "graph_blocks.hpp"
+#include "import_edge.hpp"
+#include "../util/osrm_exception.hpp"
+
+#include <boost/iterator/iterator_facade.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Temporary file of edge-based edges, so that the node-based graph and the edges of the
+ * edge-expanded graph are never in memory at the same time.
+ *
+ * The file starts with the number of edges followed by the blocks of graph_blocks.hpp. The
+ * edges keep their order, so that the contraction does not depend on where they come from. The
+ * expansion yields them roughly sorted by source, the columns of a block are the delta encoded
+ * sources, the targets relative to the sources, the delta encoded edge ids, the weights, the
+ * lengths and the flags.
+ */
+namespace edge_based_edge_run
+{
+namespace detail
+{
+inline void encode_block(const std::vector<EdgeBasedEdge> &edges,
+                         std::vector<unsigned char> &columns)
+{
+    columns.clear();
+    std::int64_t previous = 0;
+    for (const auto &edge : edges)
+    {
+        graph_blocks::detail::append_varint(columns, static_cast<std::int64_t>(edge.source) -
+                                                         previous);
+        previous = edge.source;
+    }
+    for (const auto &edge : edges)
+    {
+        graph_blocks::detail::append_varint(columns, static_cast<std::int64_t>(edge.target) -
+                                                         static_cast<std::int64_t>(edge.source));
+    }
+    previous = 0;
+    for (const auto &edge : edges)
+    {
+        graph_blocks::detail::append_varint(columns, static_cast<std::int64_t>(edge.edge_id) -
+                                                         previous);
+        previous = edge.edge_id;
+    }
+    for (const auto &edge : edges)
+    {
+        graph_blocks::detail::append_varint(columns, edge.weight);
+    }
+    for (const auto &edge : edges)
+    {
+        graph_blocks::detail::append_varint(columns, edge.length);
+    }
+    for (const auto &edge : edges)
+    {
+        columns.push_back((edge.forward ? 1 : 0) | (edge.backward ? 2 : 0));
+    }
+}
+
+inline void decode_block(const std::vector<unsigned char> &columns,
+                         const unsigned number_of_edges,
+                         std::vector<EdgeBasedEdge> &edges)
+{
+    graph_blocks::detail::VarintReader reader(columns);
+    edges.resize(number_of_edges);
+    std::int64_t previous = 0;
+    for (auto &edge : edges)
+    {
+        previous += reader.next();
+        edge.source = static_cast<NodeID>(previous);
+    }
+    for (auto &edge : edges)
+    {
+        edge.target = static_cast<NodeID>(edge.source + reader.next());
+    }
+    previous = 0;
+    for (auto &edge : edges)
+    {
+        previous += reader.next();
+        edge.edge_id = static_cast<NodeID>(previous);
+    }
+    for (auto &edge : edges)
+    {
+        edge.weight = static_cast<EdgeWeight>(reader.next());
+    }
+    for (auto &edge : edges)
+    {
+        edge.length = static_cast<unsigned>(reader.next());
+    }
+    // the flags are stored as plain bytes behind the varints
+    const std::size_t flags_offset = columns.size() - number_of_edges;
+    for (const auto i : osrm::irange<std::size_t>(0, number_of_edges))
+    {
+        edges[i].forward = 0 != (columns[flags_offset + i] & 1);
+        edges[i].backward = 0 != (columns[flags_offset + i] & 2);
+    }
+}
+}
+}
+
+// Collects edges and appends them to the run file as compressed blocks
+class EdgeBasedEdgeRunWriter
+{
+  public:
+    explicit EdgeBasedEdgeRunWriter(const std::string &path)
+        : path(path), output_stream(path, std::ios::binary), number_of_edges(0)
+    {
+        if (!output_stream)
+        {
+            throw osrm::exception("could not create " + path);
+        }
+        // the number of edges is updated by Close()
+        output_stream.write(reinterpret_cast<const char *>(&number_of_edges),
+                            sizeof(number_of_edges));
+        edges.reserve(graph_blocks::GraphBlockSize);
+    }
+
+    void push_back(const EdgeBasedEdge &edge)
+    {
+        edges.push_back(edge);
+        if (edges.size() == graph_blocks::GraphBlockSize)
+        {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        if (edges.empty())
+        {
+            return;
+        }
+        edge_based_edge_run::detail::encode_block(edges, columns);
+        graph_blocks::detail::write_block(output_stream, edges.size(), columns);
+        number_of_edges += edges.size();
+        edges.clear();
+    }
+
+    void Close()
+    {
+        flush();
+        output_stream.seekp(0);
+        output_stream.write(reinterpret_cast<const char *>(&number_of_edges),
+                            sizeof(number_of_edges));
+        output_stream.close();
+        if (!output_stream)
+        {
+            throw osrm::exception("could not write " + path);
+        }
+    }
+
+    std::uint64_t size() const { return number_of_edges + edges.size(); }
+
+  private:
+    std::string path;
+    std::ofstream output_stream;
+    std::uint64_t number_of_edges;
+    std::vector<EdgeBasedEdge> edges;
+    std::vector<unsigned char> columns;
+};
+
+// Reads the edges of a run file block by block. Takes the place of the list of edge-based edges,
+// only a single block is in memory while iterating. The file is removed by clear() or when the
+// run is destroyed.
+class EdgeBasedEdgeRun
+{
+    struct ReadState
+    {
+        std::ifstream input_stream;
+        std::uint64_t remaining_edges;
+        std::vector<unsigned char> columns;
+        std::vector<EdgeBasedEdge> block;
+        std::size_t position;
+    };
+
+  public:
+    // single pass iterator, copies share the position in the file
+    class const_iterator
+        : public boost::iterator_facade<const_iterator,
+                                        const EdgeBasedEdge,
+                                        boost::single_pass_traversal_tag>
+    {
+      public:
+        const_iterator() {}
+
+        explicit const_iterator(const std::string &path, const std::uint64_t number_of_edges)
+        {
+            if (0 == number_of_edges)
+            {
+                return;
+            }
+            state = std::make_shared<ReadState>();
+            state->input_stream.open(path, std::ios::binary);
+            state->input_stream.seekg(sizeof(std::uint64_t));
+            if (!state->input_stream)
+            {
+                throw osrm::exception("could not open " + path);
+            }
+            state->remaining_edges = number_of_edges;
+            ReadBlock();
+        }
+
+      private:
+        friend class boost::iterator_core_access;
+
+        void ReadBlock()
+        {
+            const unsigned number_of_edges =
+                graph_blocks::detail::read_block(state->input_stream, state->columns);
+            if (0 == number_of_edges || number_of_edges > state->remaining_edges)
+            {
+                throw osrm::exception("corrupt block in edge-based edge run");
+            }
+            edge_based_edge_run::detail::decode_block(state->columns, number_of_edges,
+                                                      state->block);
+            state->remaining_edges -= number_of_edges;
+            state->position = 0;
+        }
+
+        void increment()
+        {
+            if (++state->position < state->block.size())
+            {
+                return;
+            }
+            if (0 == state->remaining_edges)
+            {
+                state.reset();
+                return;
+            }
+            ReadBlock();
+        }
+
+        bool equal(const const_iterator &other) const { return state == other.state; }
+
+        const EdgeBasedEdge &dereference() const { return state->block[state->position]; }
+
+        std::shared_ptr<ReadState> state;
+    };
+
+    explicit EdgeBasedEdgeRun(const std::string &path) : path(path), number_of_edges(0)
+    {
+        std::ifstream input_stream(path, std::ios::binary);
+        input_stream.read(reinterpret_cast<char *>(&number_of_edges), sizeof(number_of_edges));
+        if (!input_stream)
+        {
+            throw osrm::exception("could not read " + path);
+        }
+    }
+
+    EdgeBasedEdgeRun(const EdgeBasedEdgeRun &) = delete;
+
+    ~EdgeBasedEdgeRun() { clear(); }
+
+    std::size_t size() const { return number_of_edges; }
+
+    const_iterator begin() const { return const_iterator(path, number_of_edges); }
+
+    const_iterator end() const { return const_iterator(); }
+
+    // same as the deallocation iterators of DeallocatingVector, the blocks are freed as read
+    const_iterator dbegin() const { return begin(); }
+
+    const_iterator dend() const { return end(); }
+
+    void clear()
+    {
+        if (!path.empty())
+        {
+            std::remove(path.c_str());
+            path.clear();
+        }
+        number_of_edges = 0;
+    }
+
+  private:
+    std::string path;
+    std::uint64_t number_of_edges;
+};
+
+#endif // EDGE_BASED_EDGE_RUN_HPP
@@ -0,0 +1,51 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef EDGE_SEGMENT_LOOKUP_HPP
+#define EDGE_SEGMENT_LOOKUP_HPP
+
+#include "../typedefs.h"
+
+#include <utility>
+
+// The .edge_segment_lookup file written by osrm-prepare --customizable stores one record per
+// edge-based edge, ordered by edge id: this header, followed by the segments of the node-based
+// edge the edge-based edge starts with. The weight of the edge-based edge is the sum of the
+// segment weights plus the turn weight.
+struct EdgeSegmentLookupHeader
+{
+    // traffic signal, u-turn and turn penalties, these do not depend on the segment speeds
+    EdgeWeight turn_weight;
+    // first node-based node of the segments
+    NodeID source;
+    unsigned number_of_segments;
+};
+
+// node-based target node and weight of a segment
+using EdgeSegment = std::pair<NodeID, EdgeWeight>;
+
+#endif // EDGE_SEGMENT_LOOKUP_HPP
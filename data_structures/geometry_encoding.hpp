@@ -0,0 +1,142 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef GEOMETRY_ENCODING_HPP
+#define GEOMETRY_ENCODING_HPP
+
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Delta and varint encoding of the node ids of the compressed geometries. Consecutive nodes of a
+// geometry mostly have close ids, so the zigzag encoded differences take one or two bytes each
+// instead of four. The geometries are grouped into blocks of GEOMETRIES_PER_BLOCK. Each block
+// starts at a byte offset of its own and its differences run across the geometries of the block,
+// the first node of a block is stored as is. A geometry is decoded from the start of its block.
+//
+// The geometry offsets are those of the plain list, the encoding does not replace them since the
+// zoom levels are indexed with them as well.
+namespace geometry_encoding
+{
+static constexpr unsigned GEOMETRIES_PER_BLOCK = 8;
+
+inline unsigned GetNumberOfBlocks(const unsigned number_of_geometries)
+{
+    return (number_of_geometries + GEOMETRIES_PER_BLOCK - 1) / GEOMETRIES_PER_BLOCK;
+}
+
+// geometry_offsets has a sentinel, node_at(i) returns the i-th node of the plain list. Writes
+// the start of every block and a sentinel to block_offsets.
+template <typename NodeAccessor>
+void Encode(const std::vector<unsigned> &geometry_offsets,
+            const NodeAccessor &node_at,
+            std::vector<unsigned> &block_offsets,
+            std::vector<std::uint8_t> &encoded_nodes)
+{
+    BOOST_ASSERT(!geometry_offsets.empty());
+    const unsigned number_of_geometries = static_cast<unsigned>(geometry_offsets.size() - 1);
+    const unsigned number_of_blocks = GetNumberOfBlocks(number_of_geometries);
+    block_offsets.clear();
+    block_offsets.reserve(number_of_blocks + 1);
+    encoded_nodes.clear();
+    encoded_nodes.reserve(geometry_offsets.back() * 2);
+    for (unsigned block = 0; block < number_of_blocks; ++block)
+    {
+        BOOST_ASSERT(encoded_nodes.size() < std::numeric_limits<unsigned>::max());
+        block_offsets.push_back(static_cast<unsigned>(encoded_nodes.size()));
+        const unsigned first_geometry = block * GEOMETRIES_PER_BLOCK;
+        const unsigned last_geometry =
+            std::min(number_of_geometries, first_geometry + GEOMETRIES_PER_BLOCK);
+        std::int64_t previous_node = 0;
+        for (unsigned i = geometry_offsets[first_geometry]; i < geometry_offsets[last_geometry];
+             ++i)
+        {
+            const std::int64_t node = static_cast<NodeID>(node_at(i));
+            const std::int64_t difference = node - previous_node;
+            std::uint64_t zigzag = (static_cast<std::uint64_t>(difference) << 1) ^
+                                   static_cast<std::uint64_t>(difference >> 63);
+            while (zigzag >= 0x80)
+            {
+                encoded_nodes.push_back(static_cast<std::uint8_t>(zigzag | 0x80));
+                zigzag >>= 7;
+            }
+            encoded_nodes.push_back(static_cast<std::uint8_t>(zigzag));
+            previous_node = node;
+        }
+    }
+    block_offsets.push_back(static_cast<unsigned>(encoded_nodes.size()));
+}
+
+// Decodes the nodes of one geometry into nodes, in bulk since the nodes leading up to it in its
+// block are decoded anyway
+inline void Decode(const unsigned *geometry_offsets,
+                   const unsigned *block_offsets,
+                   const std::uint8_t *encoded_nodes,
+                   const unsigned geometry_id,
+                   std::vector<unsigned> &nodes)
+{
+    const unsigned first_geometry = geometry_id - geometry_id % GEOMETRIES_PER_BLOCK;
+    const unsigned skipped_nodes = geometry_offsets[geometry_id] - geometry_offsets[first_geometry];
+    const unsigned number_of_nodes =
+        geometry_offsets[geometry_id + 1] - geometry_offsets[geometry_id];
+    nodes.resize(number_of_nodes);
+
+    const std::uint8_t *position =
+        encoded_nodes + block_offsets[geometry_id / GEOMETRIES_PER_BLOCK];
+    const auto next_difference = [&position]()
+    {
+        std::uint64_t zigzag = 0;
+        unsigned shift = 0;
+        std::uint8_t byte;
+        do
+        {
+            byte = *position++;
+            zigzag |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1);
+    };
+    std::int64_t node = 0;
+    for (unsigned i = 0; i < skipped_nodes; ++i)
+    {
+        node += next_difference();
+    }
+    for (unsigned i = 0; i < number_of_nodes; ++i)
+    {
+        node += next_difference();
+        nodes[i] = static_cast<unsigned>(node);
+    }
+}
+}
+
+#endif // GEOMETRY_ENCODING_HPP
@@ -0,0 +1,348 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef GRAPH_BLOCKS_HPP
+#define GRAPH_BLOCKS_HPP
+
+#include "external_memory_node.hpp"
+#include "import_edge.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/osrm_exception.hpp"
+#include "../typedefs.h"
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+/**
+ * Block compressed, columnar layout of the nodes and edges of an .osrm file.
+ *
+ * In place of the element count a block compressed section starts with the
+ * marker followed by the count. Each block holds up to GraphBlockSize elements
+ * column by column: ids and coordinates are delta encoded, all values are zig-zag
+ * varints. A block is stored as its element count, its raw and its compressed size
+ * followed by the zlib compressed columns.
+ */
+namespace graph_blocks
+{
+constexpr unsigned CompressedSectionMarker = SPECIAL_NODEID;
+constexpr unsigned GraphBlockSize = 64 * 1024;
+
+namespace detail
+{
+inline std::uint64_t zigzag(const std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+inline std::int64_t unzigzag(const std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+inline void append_varint(std::vector<unsigned char> &buffer, std::int64_t signed_value)
+{
+    std::uint64_t value = zigzag(signed_value);
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<unsigned char>(value));
+}
+
+class VarintReader
+{
+  public:
+    explicit VarintReader(const std::vector<unsigned char> &buffer)
+        : position(buffer.data()), end(buffer.data() + buffer.size())
+    {
+    }
+
+    std::int64_t next()
+    {
+        std::uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            if (position == end)
+            {
+                throw osrm::exception("truncated block in .osrm file");
+            }
+            const unsigned char byte = *position++;
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if (0 == (byte & 0x80))
+            {
+                return unzigzag(value);
+            }
+        }
+        throw osrm::exception("corrupt block in .osrm file");
+    }
+
+  private:
+    const unsigned char *position;
+    const unsigned char *end;
+};
+
+inline void write_block(std::ostream &output_stream,
+                        const unsigned number_of_elements,
+                        const std::vector<unsigned char> &columns)
+{
+    uLongf compressed_size = compressBound(columns.size());
+    std::vector<unsigned char> compressed(compressed_size);
+    if (Z_OK !=
+        compress2(compressed.data(), &compressed_size, columns.data(), columns.size(), Z_BEST_SPEED))
+    {
+        throw osrm::exception("compressing a block of the .osrm file failed");
+    }
+    const std::uint32_t header[3] = {number_of_elements, static_cast<std::uint32_t>(columns.size()),
+                                     static_cast<std::uint32_t>(compressed_size)};
+    output_stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+    output_stream.write(reinterpret_cast<const char *>(compressed.data()), compressed_size);
+}
+
+// returns the number of elements in the block
+inline unsigned read_block(std::istream &input_stream, std::vector<unsigned char> &columns)
+{
+    std::uint32_t header[3];
+    input_stream.read(reinterpret_cast<char *>(header), sizeof(header));
+    std::vector<unsigned char> compressed(header[2]);
+    input_stream.read(reinterpret_cast<char *>(compressed.data()), compressed.size());
+    if (!input_stream || header[0] > GraphBlockSize)
+    {
+        throw osrm::exception("truncated block in .osrm file");
+    }
+
+    columns.resize(header[1]);
+    uLongf raw_size = columns.size();
+    if (Z_OK != uncompress(columns.data(), &raw_size, compressed.data(), compressed.size()) ||
+        raw_size != columns.size())
+    {
+        throw osrm::exception("corrupt block in .osrm file");
+    }
+    return header[0];
+}
+}
+
+// Collects nodes and writes them as compressed blocks
+class NodeBlockWriter
+{
+  public:
+    explicit NodeBlockWriter(std::ostream &output_stream) : output_stream(output_stream)
+    {
+        nodes.reserve(GraphBlockSize);
+    }
+
+    void push_back(const ExternalMemoryNode &node)
+    {
+        nodes.push_back(node);
+        if (nodes.size() == GraphBlockSize)
+        {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        if (nodes.empty())
+        {
+            return;
+        }
+        std::vector<unsigned char> columns;
+        std::int64_t previous = 0;
+        for (const auto &node : nodes)
+        {
+            detail::append_varint(columns, static_cast<std::int64_t>(node.node_id) - previous);
+            previous = node.node_id;
+        }
+        previous = 0;
+        for (const auto &node : nodes)
+        {
+            detail::append_varint(columns, static_cast<std::int64_t>(node.lat) - previous);
+            previous = node.lat;
+        }
+        previous = 0;
+        for (const auto &node : nodes)
+        {
+            detail::append_varint(columns, static_cast<std::int64_t>(node.lon) - previous);
+            previous = node.lon;
+        }
+        for (const auto &node : nodes)
+        {
+            columns.push_back((node.barrier ? 1 : 0) | (node.traffic_lights ? 2 : 0));
+        }
+        detail::write_block(output_stream, nodes.size(), columns);
+        nodes.clear();
+    }
+
+  private:
+    std::ostream &output_stream;
+    std::vector<ExternalMemoryNode> nodes;
+};
+
+// Collects edges and writes them as compressed blocks
+class EdgeBlockWriter
+{
+  public:
+    explicit EdgeBlockWriter(std::ostream &output_stream) : output_stream(output_stream)
+    {
+        edges.reserve(GraphBlockSize);
+    }
+
+    void push_back(const NodeBasedEdge &edge)
+    {
+        edges.push_back(edge);
+        if (edges.size() == GraphBlockSize)
+        {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        if (edges.empty())
+        {
+            return;
+        }
+        std::vector<unsigned char> columns;
+        std::int64_t previous = 0;
+        for (const auto &edge : edges)
+        {
+            detail::append_varint(columns, static_cast<std::int64_t>(edge.source) - previous);
+            previous = edge.source;
+        }
+        for (const auto &edge : edges)
+        {
+            detail::append_varint(columns, static_cast<std::int64_t>(edge.target) -
+                                               static_cast<std::int64_t>(edge.source));
+        }
+        previous = 0;
+        for (const auto &edge : edges)
+        {
+            detail::append_varint(columns, static_cast<std::int64_t>(edge.name_id) - previous);
+            previous = edge.name_id;
+        }
+        for (const auto &edge : edges)
+        {
+            detail::append_varint(columns, edge.weight);
+        }
+        for (const auto &edge : edges)
+        {
+            detail::append_varint(columns, (edge.forward ? 1 : 0) | (edge.backward ? 2 : 0) |
+                                               (edge.roundabout ? 4 : 0) |
+                                               (edge.access_restricted ? 8 : 0) |
+                                               (edge.is_split ? 16 : 0) |
+                                               (static_cast<unsigned>(edge.travel_mode) << 5));
+        }
+        detail::write_block(output_stream, edges.size(), columns);
+        edges.clear();
+    }
+
+  private:
+    std::ostream &output_stream;
+    std::vector<NodeBasedEdge> edges;
+};
+
+// Reads the next block of nodes
+inline void read_node_block(std::istream &input_stream, std::vector<ExternalMemoryNode> &nodes)
+{
+    std::vector<unsigned char> columns;
+    const unsigned number_of_nodes = detail::read_block(input_stream, columns);
+    detail::VarintReader reader(columns);
+
+    nodes.resize(number_of_nodes);
+    std::int64_t previous = 0;
+    for (auto &node : nodes)
+    {
+        previous += reader.next();
+        node.node_id = static_cast<NodeID>(previous);
+    }
+    previous = 0;
+    for (auto &node : nodes)
+    {
+        previous += reader.next();
+        node.lat = static_cast<int>(previous);
+    }
+    previous = 0;
+    for (auto &node : nodes)
+    {
+        previous += reader.next();
+        node.lon = static_cast<int>(previous);
+    }
+    // the flags are stored as plain bytes behind the varints
+    const std::size_t flags_offset = columns.size() - number_of_nodes;
+    for (const auto i : osrm::irange<std::size_t>(0, number_of_nodes))
+    {
+        nodes[i].barrier = 0 != (columns[flags_offset + i] & 1);
+        nodes[i].traffic_lights = 0 != (columns[flags_offset + i] & 2);
+    }
+}
+
+// Reads the next block of edges
+inline void read_edge_block(std::istream &input_stream, std::vector<NodeBasedEdge> &edges)
+{
+    std::vector<unsigned char> columns;
+    const unsigned number_of_edges = detail::read_block(input_stream, columns);
+    detail::VarintReader reader(columns);
+
+    edges.resize(number_of_edges);
+    std::int64_t previous = 0;
+    for (auto &edge : edges)
+    {
+        previous += reader.next();
+        edge.source = static_cast<NodeID>(previous);
+    }
+    for (auto &edge : edges)
+    {
+        edge.target = static_cast<NodeID>(edge.source + reader.next());
+    }
+    previous = 0;
+    for (auto &edge : edges)
+    {
+        previous += reader.next();
+        edge.name_id = static_cast<NodeID>(previous);
+    }
+    for (auto &edge : edges)
+    {
+        edge.weight = static_cast<EdgeWeight>(reader.next());
+    }
+    for (auto &edge : edges)
+    {
+        const auto flags = reader.next();
+        edge.forward = 0 != (flags & 1);
+        edge.backward = 0 != (flags & 2);
+        edge.roundabout = 0 != (flags & 4);
+        edge.access_restricted = 0 != (flags & 8);
+        edge.is_split = 0 != (flags & 16);
+        edge.travel_mode = static_cast<TravelMode>(flags >> 5);
+    }
+}
+}
+
+#endif // GRAPH_BLOCKS_HPP
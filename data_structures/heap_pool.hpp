@@ -0,0 +1,134 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef HEAP_POOL_HPP
+#define HEAP_POOL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// Idle query heaps shared by all threads. A heap is checked out for a query and checked in
+// again once the query is done, so the number of heaps follows the number of queries in flight.
+// The pool keeps at most max_idle_heaps heaps, frees heaps that grew beyond max_heap_capacity
+// nodes in a huge search instead of keeping them, and frees heaps idle for max_idle_time.
+template <typename HeapT> class HeapPool
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    HeapPool(const std::size_t max_idle_heaps,
+             const std::size_t max_heap_capacity,
+             const Clock::duration max_idle_time)
+        : max_idle_heaps(max_idle_heaps), max_heap_capacity(max_heap_capacity),
+          max_idle_time(max_idle_time)
+    {
+    }
+
+    HeapPool(const HeapPool &) = delete;
+    HeapPool &operator=(const HeapPool &) = delete;
+
+    // the heap checked in last, its memory is the most likely to be cached, or nullptr
+    std::unique_ptr<HeapT> Checkout(const Clock::time_point now = Clock::now())
+    {
+        std::deque<IdleHeap> expired_heaps;
+        std::unique_ptr<HeapT> heap;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            TakeExpiredHeaps(now, expired_heaps);
+            if (!idle_heaps.empty())
+            {
+                heap = std::move(idle_heaps.back().heap);
+                idle_heaps.pop_back();
+            }
+        }
+        return heap;
+    }
+
+    // heaps are handed back as they were left, the next user clears them
+    void Checkin(std::unique_ptr<HeapT> heap, const Clock::time_point now = Clock::now())
+    {
+        if (!heap || heap->Capacity() > max_heap_capacity)
+        {
+            return;
+        }
+        // the freed heaps are destroyed outside of the lock
+        std::deque<IdleHeap> expired_heaps;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            TakeExpiredHeaps(now, expired_heaps);
+            if (idle_heaps.size() >= max_idle_heaps)
+            {
+                return;
+            }
+            idle_heaps.push_back(IdleHeap{std::move(heap), now});
+        }
+    }
+
+    // frees the heaps that have been idle for too long
+    void Shrink(const Clock::time_point now = Clock::now())
+    {
+        std::deque<IdleHeap> expired_heaps;
+        std::lock_guard<std::mutex> lock(mutex);
+        TakeExpiredHeaps(now, expired_heaps);
+    }
+
+    std::size_t NumberOfIdleHeaps() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return idle_heaps.size();
+    }
+
+  private:
+    struct IdleHeap
+    {
+        std::unique_ptr<HeapT> heap;
+        Clock::time_point idle_since;
+    };
+
+    // the heaps are checked in and out at the back, so the front is idle the longest
+    void TakeExpiredHeaps(const Clock::time_point now, std::deque<IdleHeap> &expired_heaps)
+    {
+        while (!idle_heaps.empty() && now - idle_heaps.front().idle_since > max_idle_time)
+        {
+            expired_heaps.push_back(std::move(idle_heaps.front()));
+            idle_heaps.pop_front();
+        }
+    }
+
+    const std::size_t max_idle_heaps;
+    const std::size_t max_heap_capacity;
+    const Clock::duration max_idle_time;
+    mutable std::mutex mutex;
+    std::deque<IdleHeap> idle_heaps;
+};
+
+#endif // HEAP_POOL_HPP
@@ -28,12 +28,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef HIDDEN_MARKOV_MODEL
 #define HIDDEN_MARKOV_MODEL
 
+#include "../typedefs.h"
 #include "../util/integer_range.hpp"
 
 #include <boost/assert.hpp>
 
 #include <cmath>
 
+#include <algorithm>
+#include <functional>
 #include <limits>
 #include <vector>
 
@@ -45,6 +48,8 @@ static const double log_2_pi = std::log(2. * M_PI);
 static const double IMPOSSIBLE_LOG_PROB = -std::numeric_limits<double>::infinity();
 static const double MINIMAL_LOG_PROB = std::numeric_limits<double>::lowest();
 static const std::size_t INVALID_STATE = std::numeric_limits<std::size_t>::max();
+// beam width: only the most likely states of a timestamp are expanded to the next one
+static const std::size_t MAX_ACTIVE_STATES = 8;
 } // namespace matching
 } // namespace osrm
 
@@ -74,62 +79,107 @@ struct TransitionLogProbability
     double operator()(const double d_t) const { return -log_beta - d_t / beta; }
 };
 
+// The smallest value that still ranks among the beam_width largest of [first, last). Every
+// state can be kept if there are no more than beam_width of them.
+template <typename Iterator>
+double beam_threshold(Iterator first, Iterator last, const std::size_t beam_width)
+{
+    BOOST_ASSERT(beam_width > 0);
+    std::vector<double> values(first, last);
+    if (values.size() <= beam_width)
+    {
+        return osrm::matching::IMPOSSIBLE_LOG_PROB;
+    }
+    std::nth_element(values.begin(), values.begin() + (beam_width - 1), values.end(),
+                     std::greater<double>());
+    return values[beam_width - 1];
+}
+
+// The states of all timestamps are stored back to back, the states of timestamp t occupy
+// [offsets[t], offsets[t+1]) in each of the flat arrays.
 template <class CandidateLists> struct HiddenMarkovModel
 {
-    std::vector<std::vector<double>> viterbi;
-    std::vector<std::vector<std::pair<unsigned, unsigned>>> parents;
-    std::vector<std::vector<float>> path_lengths;
-    std::vector<std::vector<bool>> pruned;
-    std::vector<std::vector<bool>> suspicious;
+    std::vector<std::size_t> offsets;
+    std::vector<double> emissions;
+    std::vector<double> viterbi;
+    std::vector<std::pair<unsigned, unsigned>> parents;
+    std::vector<float> path_lengths;
+    // packed path of the transition from the parent
+    std::vector<std::vector<NodeID>> packed_paths;
+    std::vector<bool> pruned;
+    std::vector<bool> suspicious;
     std::vector<bool> breakage;
 
     const CandidateLists &candidates_list;
-    const EmissionLogProbability &emission_log_probability;
 
     HiddenMarkovModel(const CandidateLists &candidates_list,
                       const EmissionLogProbability &emission_log_probability)
-        : breakage(candidates_list.size()), candidates_list(candidates_list),
-          emission_log_probability(emission_log_probability)
+        : offsets(candidates_list.size() + 1, 0), breakage(candidates_list.size()),
+          candidates_list(candidates_list)
     {
-        viterbi.resize(candidates_list.size());
-        parents.resize(candidates_list.size());
-        path_lengths.resize(candidates_list.size());
-        suspicious.resize(candidates_list.size());
-        pruned.resize(candidates_list.size());
-        breakage.resize(candidates_list.size());
-        for (const auto i : osrm::irange<std::size_t>(0u, candidates_list.size()))
+        for (const auto t : osrm::irange<std::size_t>(0u, candidates_list.size()))
+        {
+            offsets[t + 1] = offsets[t] + candidates_list[t].size();
+        }
+
+        const auto num_states = offsets.back();
+        emissions.reserve(num_states);
+        for (const auto &candidates : candidates_list)
         {
-            const auto& num_candidates = candidates_list[i].size();
-            // add empty vectors
-            if (num_candidates > 0)
+            for (const auto &candidate : candidates)
             {
-                viterbi[i].resize(num_candidates);
-                parents[i].resize(num_candidates);
-                path_lengths[i].resize(num_candidates);
-                suspicious[i].resize(num_candidates);
-                pruned[i].resize(num_candidates);
+                emissions.push_back(emission_log_probability(candidate.second));
             }
         }
+        viterbi.resize(num_states);
+        parents.resize(num_states);
+        path_lengths.resize(num_states);
+        packed_paths.resize(num_states);
+        pruned.resize(num_states);
+        suspicious.resize(num_states);
 
         clear(0);
     }
 
+    std::size_t state(const std::size_t t, const std::size_t s) const
+    {
+        BOOST_ASSERT(offsets[t] + s < offsets[t + 1]);
+        return offsets[t] + s;
+    }
+
+    std::size_t num_states(const std::size_t t) const { return offsets[t + 1] - offsets[t]; }
+
     void clear(std::size_t initial_timestamp)
     {
-        BOOST_ASSERT(viterbi.size() == parents.size() && parents.size() == path_lengths.size() &&
-                     path_lengths.size() == pruned.size() && pruned.size() == breakage.size());
+        BOOST_ASSERT(offsets.size() == breakage.size() + 1);
 
-        for (const auto t : osrm::irange(initial_timestamp, viterbi.size()))
+        const auto first = offsets[initial_timestamp];
+        std::fill(viterbi.begin() + first, viterbi.end(), osrm::matching::IMPOSSIBLE_LOG_PROB);
+        std::fill(parents.begin() + first, parents.end(), std::make_pair(0u, 0u));
+        std::fill(path_lengths.begin() + first, path_lengths.end(), 0);
+        for (const auto index : osrm::irange(first, packed_paths.size()))
         {
-            std::fill(viterbi[t].begin(), viterbi[t].end(), osrm::matching::IMPOSSIBLE_LOG_PROB);
-            std::fill(parents[t].begin(), parents[t].end(), std::make_pair(0u, 0u));
-            std::fill(path_lengths[t].begin(), path_lengths[t].end(), 0);
-            std::fill(suspicious[t].begin(), suspicious[t].end(), true);
-            std::fill(pruned[t].begin(), pruned[t].end(), true);
+            packed_paths[index].clear();
         }
+        std::fill(suspicious.begin() + first, suspicious.end(), true);
+        std::fill(pruned.begin() + first, pruned.end(), true);
         std::fill(breakage.begin() + initial_timestamp, breakage.end(), true);
     }
 
+    // Prunes all but the beam_width most likely states of timestamp t
+    void prune(const std::size_t t, const std::size_t beam_width)
+    {
+        const auto threshold = beam_threshold(viterbi.begin() + offsets[t],
+                                              viterbi.begin() + offsets[t + 1], beam_width);
+        for (const auto index : osrm::irange(offsets[t], offsets[t + 1]))
+        {
+            if (viterbi[index] < threshold)
+            {
+                pruned[index] = true;
+            }
+        }
+    }
+
     std::size_t initialize(std::size_t initial_timestamp)
     {
         auto num_points = candidates_list.size();
@@ -137,17 +187,15 @@ template <class CandidateLists> struct HiddenMarkovModel
         {
             BOOST_ASSERT(initial_timestamp < num_points);
 
-            for (const auto s : osrm::irange<std::size_t>(0u, viterbi[initial_timestamp].size()))
+            for (const auto s : osrm::irange<std::size_t>(0u, num_states(initial_timestamp)))
             {
-                viterbi[initial_timestamp][s] =
-                    emission_log_probability(candidates_list[initial_timestamp][s].second);
-                parents[initial_timestamp][s] = std::make_pair(initial_timestamp, s);
-                pruned[initial_timestamp][s] =
-                    viterbi[initial_timestamp][s] < osrm::matching::MINIMAL_LOG_PROB;
-                suspicious[initial_timestamp][s] = false;
-
-                breakage[initial_timestamp] =
-                    breakage[initial_timestamp] && pruned[initial_timestamp][s];
+                const auto index = state(initial_timestamp, s);
+                viterbi[index] = emissions[index];
+                parents[index] = std::make_pair(initial_timestamp, s);
+                pruned[index] = viterbi[index] < osrm::matching::MINIMAL_LOG_PROB;
+                suspicious[index] = false;
+
+                breakage[initial_timestamp] = breakage[initial_timestamp] && pruned[index];
             }
 
             ++initial_timestamp;
@@ -162,6 +210,7 @@ template <class CandidateLists> struct HiddenMarkovModel
         --initial_timestamp;
 
         BOOST_ASSERT(breakage[initial_timestamp] == false);
+        prune(initial_timestamp, osrm::matching::MAX_ACTIVE_STATES);
 
         return initial_timestamp;
     }
@@ -29,72 +29,67 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/coordinate.hpp>
 
-uint64_t HilbertCode::operator()(const FixedPointCoordinate &current_coordinate) const
+namespace
 {
-    unsigned location[2];
-    location[0] = current_coordinate.lat + static_cast<int>(90 * COORDINATE_PRECISION);
-    location[1] = current_coordinate.lon + static_cast<int>(180 * COORDINATE_PRECISION);
-
-    TransposeCoordinate(location);
-    return BitInterleaving(location[0], location[1]);
-}
+// The curve runs through the four quadrants of a square in one of four orientations. The
+// quadrant is given by a bit of latitude and a bit of longitude, lat * 2 + lon. It determines
+// the two bits that the quadrant adds to the value and the orientation of the curve within it.
+constexpr uint8_t QUADRANT_VALUE[4][4] = {{0, 1, 3, 2}, {0, 3, 1, 2}, {2, 1, 3, 0}, {2, 3, 1, 0}};
+constexpr uint8_t NEXT_ORIENTATION[4][4] = {
+    {1, 0, 2, 0}, {0, 3, 1, 1}, {2, 2, 0, 3}, {3, 1, 3, 2}};
 
-uint64_t HilbertCode::BitInterleaving(const uint32_t latitude, const uint32_t longitude) const
+// Four levels of the curve at once: indexed by orientation and by four bits of latitude followed
+// by four bits of longitude, every entry holds the eight value bits and the next orientation.
+class HilbertTable
 {
-    uint64_t result = 0;
-    for (int8_t index = 31; index >= 0; --index)
+  public:
+    HilbertTable()
     {
-        result |= (latitude >> index) & 1;
-        result <<= 1;
-        result |= (longitude >> index) & 1;
-        if (0 != index)
+        for (unsigned orientation = 0; orientation < 4; ++orientation)
         {
-            result <<= 1;
+            for (unsigned bits = 0; bits < 256; ++bits)
+            {
+                unsigned current = orientation;
+                unsigned value = 0;
+                for (int level = 3; level >= 0; --level)
+                {
+                    const unsigned quadrant =
+                        (((bits >> (4 + level)) & 1) << 1) | ((bits >> level) & 1);
+                    value = (value << 2) | QUADRANT_VALUE[current][quadrant];
+                    current = NEXT_ORIENTATION[current][quadrant];
+                }
+                entries[orientation][bits] = static_cast<uint16_t>(value | (current << 8));
+            }
         }
     }
-    return result;
+
+    uint16_t operator()(const unsigned orientation, const unsigned bits) const
+    {
+        return entries[orientation][bits];
+    }
+
+  private:
+    uint16_t entries[4][256];
+};
+
+const HilbertTable hilbert_table;
 }
 
-void HilbertCode::TransposeCoordinate(uint32_t *X) const
+uint64_t HilbertCode::operator()(const FixedPointCoordinate &current_coordinate) const
 {
-    uint32_t M = 1u << (32 - 1), P, Q, t;
-    int i;
-    // Inverse undo
-    for (Q = M; Q > 1; Q >>= 1)
-    {
-        P = Q - 1;
-        for (i = 0; i < 2; ++i)
-        {
+    const uint32_t latitude =
+        current_coordinate.lat + static_cast<int>(90 * COORDINATE_PRECISION);
+    const uint32_t longitude =
+        current_coordinate.lon + static_cast<int>(180 * COORDINATE_PRECISION);
 
-            const bool condition = (X[i] & Q);
-            if (condition)
-            {
-                X[0] ^= P; // invert
-            }
-            else
-            {
-                t = (X[0] ^ X[i]) & P;
-                X[0] ^= t;
-                X[i] ^= t;
-            }
-        } // exchange
-    }
-    // Gray encode
-    for (i = 1; i < 2; ++i)
-    {
-        X[i] ^= X[i - 1];
-    }
-    t = 0;
-    for (Q = M; Q > 1; Q >>= 1)
-    {
-        const bool condition = (X[2 - 1] & Q);
-        if (condition)
-        {
-            t ^= Q - 1;
-        }
-    } // check if this for loop is wrong
-    for (i = 0; i < 2; ++i)
+    uint64_t result = 0;
+    unsigned orientation = 0;
+    for (int shift = 28; shift >= 0; shift -= 4)
     {
-        X[i] ^= t;
+        const unsigned bits = (((latitude >> shift) & 0xf) << 4) | ((longitude >> shift) & 0xf);
+        const uint16_t entry = hilbert_table(orientation, bits);
+        result = (result << 8) | (entry & 0xff);
+        orientation = entry >> 8;
     }
+    return result;
 }
@@ -30,7 +30,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <cstdint>
 
-// computes a 64 bit value that corresponds to the hilbert space filling curve
+// computes a 64 bit value that corresponds to the hilbert space filling curve. The curve is
+// followed from the top level down with a table that consumes four bits of each coordinate per
+// step, instead of transposing and interleaving the coordinates bit by bit.
 
 struct FixedPointCoordinate;
 
@@ -40,10 +42,6 @@ class HilbertCode
     uint64_t operator()(const FixedPointCoordinate &current_coordinate) const;
     HilbertCode() {}
     HilbertCode(const HilbertCode &) = delete;
-
-  private:
-    inline uint64_t BitInterleaving(const uint32_t a, const uint32_t b) const;
-    inline void TransposeCoordinate(uint32_t *X) const;
 };
 
 #endif /* HILBERT_VALUE_HPP */
@@ -89,14 +89,14 @@ bool EdgeBasedEdge::operator<(const EdgeBasedEdge &other) const
 
 template <class EdgeT>
 EdgeBasedEdge::EdgeBasedEdge(const EdgeT &other)
-    : source(other.source), target(other.target), edge_id(other.data.via),
+    : source(other.source), target(other.target), edge_id(other.data.via), length(0),
       weight(other.data.distance), forward(other.data.forward), backward(other.data.backward)
 {
 }
 
 /** Default constructor. target and weight are set to 0.*/
 EdgeBasedEdge::EdgeBasedEdge()
-    : source(0), target(0), edge_id(0), weight(0), forward(false), backward(false)
+    : source(0), target(0), edge_id(0), length(0), weight(0), forward(false), backward(false)
 {
 }
 
@@ -105,8 +105,9 @@ EdgeBasedEdge::EdgeBasedEdge(const NodeID source,
                              const NodeID edge_id,
                              const EdgeWeight weight,
                              const bool forward,
-                             const bool backward)
-    : source(source), target(target), edge_id(edge_id), weight(weight), forward(forward),
-      backward(backward)
+                             const bool backward,
+                             const unsigned length)
+    : source(source), target(target), edge_id(edge_id), length(length), weight(weight),
+      forward(forward), backward(backward)
 {
 }
@@ -74,10 +74,13 @@ struct EdgeBasedEdge
                            const NodeID edge_id,
                            const EdgeWeight weight,
                            const bool forward,
-                           const bool backward);
+                           const bool backward,
+                           const unsigned length = 0);
     NodeID source;
     NodeID target;
     NodeID edge_id;
+    // length of the geometry of the source node in decimeters
+    unsigned length;
     EdgeWeight weight : 30;
     bool forward : 1;
     bool backward : 1;
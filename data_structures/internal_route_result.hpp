@@ -35,13 +35,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/coordinate.hpp>
 
+#include <cstdint>
 #include <vector>
 
 struct PathData
 {
     PathData()
         : node(SPECIAL_NODEID), name_id(INVALID_EDGE_WEIGHT), segment_duration(INVALID_EDGE_WEIGHT),
-          turn_instruction(TurnInstruction::NoTurn), travel_mode(TRAVEL_MODE_INACCESSIBLE)
+          turn_instruction(TurnInstruction::NoTurn), travel_mode(TRAVEL_MODE_INACCESSIBLE),
+          zoom_level(0)
     {
     }
 
@@ -49,9 +51,10 @@ struct PathData
              unsigned name_id,
              TurnInstruction turn_instruction,
              EdgeWeight segment_duration,
-             TravelMode travel_mode)
+             TravelMode travel_mode,
+             std::uint8_t zoom_level = 0)
         : node(node), name_id(name_id), segment_duration(segment_duration),
-          turn_instruction(turn_instruction), travel_mode(travel_mode)
+          turn_instruction(turn_instruction), travel_mode(travel_mode), zoom_level(zoom_level)
     {
     }
     NodeID node;
@@ -59,6 +62,8 @@ struct PathData
     EdgeWeight segment_duration;
     TurnInstruction turn_instruction;
     TravelMode travel_mode : 4;
+    // lowest zoom level that shows the node in a generalized geometry
+    std::uint8_t zoom_level;
 };
 
 struct InternalRouteResult
@@ -70,8 +75,12 @@ struct InternalRouteResult
     std::vector<bool> target_traversed_in_reverse;
     std::vector<bool> alt_source_traversed_in_reverse;
     std::vector<bool> alt_target_traversed_in_reverse;
+    // lengths of the legs in meters, only filled in summary_only mode
+    std::vector<double> leg_lengths;
     int shortest_path_length;
     int alternative_path_length;
+    // only the lengths of the legs are computed, the unpacked paths stay empty
+    bool summary_only;
 
     bool is_via_leg(const std::size_t leg) const
     {
@@ -79,7 +88,8 @@ struct InternalRouteResult
     }
 
     InternalRouteResult()
-        : shortest_path_length(INVALID_EDGE_WEIGHT), alternative_path_length(INVALID_EDGE_WEIGHT)
+        : shortest_path_length(INVALID_EDGE_WEIGHT), alternative_path_length(INVALID_EDGE_WEIGHT),
+          summary_only(false)
     {
     }
 };
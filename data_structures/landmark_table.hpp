@@ -0,0 +1,475 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef LANDMARK_TABLE_HPP
+#define LANDMARK_TABLE_HPP
+
+#include "binary_heap.hpp"
+#include "shared_memory_vector_wrapper.hpp"
+
+#include "../util/osrm_exception.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Shortest path distances between every core node and a few landmarks of the core, used as
+// lower bounds for a goal directed (ALT) search on the uncontracted core. For each core node it
+// stores the distances from all landmarks, followed by the distances to all landmarks, with
+// INVALID_EDGE_WEIGHT for pairs that are not connected.
+template <bool UseSharedMemory = false> class LandmarkTable
+{
+  public:
+    // landmark file: header, landmark node ids, core index of every node, distances
+    struct LandmarkHeader
+    {
+        uint32_t number_of_landmarks;
+        uint32_t number_of_nodes;
+        uint32_t number_of_core_nodes;
+    };
+
+    LandmarkTable() = default;
+
+    // Selects the landmarks among the core nodes and writes their distances to a file. Edges
+    // need source, target and data with distance and forward/backward flags, like QueryEdge.
+    template <class EdgeListT>
+    static void Build(const EdgeListT &edge_list,
+                      const std::vector<bool> &is_core_node,
+                      const unsigned requested_landmarks,
+                      const std::string &landmark_filename)
+    {
+        TIMER_START(construction);
+
+        std::vector<uint32_t> core_index(is_core_node.size(), SPECIAL_NODEID);
+        std::vector<NodeID> core_nodes;
+        for (std::size_t node = 0; node < is_core_node.size(); ++node)
+        {
+            if (is_core_node[node])
+            {
+                core_index[node] = core_nodes.size();
+                core_nodes.push_back(node);
+            }
+        }
+        const uint32_t number_of_core_nodes = core_nodes.size();
+
+        // adjacency arrays of the core subgraph, by core index
+        std::vector<std::pair<uint32_t, CoreArc>> forward_arcs;
+        for (const auto &edge : edge_list)
+        {
+            if (edge.source >= core_index.size() || edge.target >= core_index.size() ||
+                SPECIAL_NODEID == core_index[edge.source] ||
+                SPECIAL_NODEID == core_index[edge.target])
+            {
+                continue;
+            }
+            if (edge.data.forward)
+            {
+                forward_arcs.push_back(
+                    {core_index[edge.source], {core_index[edge.target], edge.data.distance}});
+            }
+            if (edge.data.backward)
+            {
+                forward_arcs.push_back(
+                    {core_index[edge.target], {core_index[edge.source], edge.data.distance}});
+            }
+        }
+        std::vector<std::pair<uint32_t, CoreArc>> reverse_arcs;
+        reverse_arcs.reserve(forward_arcs.size());
+        for (const auto &arc : forward_arcs)
+        {
+            reverse_arcs.push_back({arc.second.target, {arc.first, arc.second.weight}});
+        }
+        const CoreGraph forward_graph(number_of_core_nodes, std::move(forward_arcs));
+        const CoreGraph reverse_graph(number_of_core_nodes, std::move(reverse_arcs));
+
+        // farthest selection: every landmark is the core node farthest from all previous ones
+        const uint32_t number_of_landmarks = std::min(requested_landmarks, number_of_core_nodes);
+        std::vector<NodeID> landmarks;
+        std::vector<std::vector<EdgeWeight>> from_landmark(number_of_landmarks);
+        std::vector<EdgeWeight> distance_to_landmarks(number_of_core_nodes, INVALID_EDGE_WEIGHT);
+        CoreHeap heap(number_of_core_nodes);
+        if (number_of_landmarks > 0)
+        {
+            std::vector<EdgeWeight> seed_distances;
+            forward_graph.Dijkstra(0, heap, seed_distances);
+            uint32_t next_landmark = Farthest(seed_distances);
+            for (uint32_t i = 0; i < number_of_landmarks; ++i)
+            {
+                landmarks.push_back(next_landmark);
+                forward_graph.Dijkstra(next_landmark, heap, from_landmark[i]);
+                for (uint32_t core_node = 0; core_node < number_of_core_nodes; ++core_node)
+                {
+                    distance_to_landmarks[core_node] =
+                        std::min(distance_to_landmarks[core_node], from_landmark[i][core_node]);
+                }
+                next_landmark = Farthest(distance_to_landmarks);
+            }
+        }
+
+        std::vector<std::vector<EdgeWeight>> to_landmark(number_of_landmarks);
+        tbb::parallel_for(0u, number_of_landmarks, [&](const uint32_t i)
+                          {
+                              CoreHeap thread_heap(number_of_core_nodes);
+                              reverse_graph.Dijkstra(landmarks[i], thread_heap, to_landmark[i]);
+                          });
+
+        std::vector<EdgeWeight> distances(static_cast<std::size_t>(number_of_core_nodes) * 2 *
+                                          number_of_landmarks);
+        for (uint32_t core_node = 0; core_node < number_of_core_nodes; ++core_node)
+        {
+            EdgeWeight *node_distances =
+                distances.data() + static_cast<std::size_t>(core_node) * 2 * number_of_landmarks;
+            for (uint32_t i = 0; i < number_of_landmarks; ++i)
+            {
+                node_distances[i] = from_landmark[i][core_node];
+                node_distances[number_of_landmarks + i] = to_landmark[i][core_node];
+            }
+        }
+
+        // landmarks are written as node ids of the search graph
+        std::vector<NodeID> landmark_nodes;
+        for (const auto landmark : landmarks)
+        {
+            landmark_nodes.push_back(core_nodes[landmark]);
+        }
+
+        LandmarkHeader header;
+        header.number_of_landmarks = number_of_landmarks;
+        header.number_of_nodes = core_index.size();
+        header.number_of_core_nodes = number_of_core_nodes;
+
+        boost::filesystem::ofstream landmark_file(landmark_filename, std::ios::binary);
+        landmark_file.write((char *)&header, sizeof(LandmarkHeader));
+        landmark_file.write((char *)landmark_nodes.data(), sizeof(NodeID) * landmark_nodes.size());
+        landmark_file.write((char *)core_index.data(), sizeof(uint32_t) * core_index.size());
+        landmark_file.write((char *)distances.data(), sizeof(EdgeWeight) * distances.size());
+        landmark_file.close();
+
+        TIMER_STOP(construction);
+        SimpleLogger().Write() << "finished " << number_of_landmarks << " landmarks on "
+                               << number_of_core_nodes << " core nodes in "
+                               << TIMER_SEC(construction) << " seconds";
+    }
+
+    static LandmarkHeader ReadHeader(boost::filesystem::ifstream &landmark_file)
+    {
+        LandmarkHeader header;
+        landmark_file.read((char *)&header, sizeof(LandmarkHeader));
+        if (!landmark_file)
+        {
+            throw osrm::exception("landmark file is truncated");
+        }
+        return header;
+    }
+
+    explicit LandmarkTable(const boost::filesystem::path &landmark_filename)
+    {
+        boost::filesystem::ifstream landmark_file(landmark_filename, std::ios::binary);
+        const LandmarkHeader header = ReadHeader(landmark_file);
+        landmark_nodes.resize(header.number_of_landmarks);
+        core_index.resize(header.number_of_nodes);
+        distances.resize(static_cast<std::size_t>(header.number_of_core_nodes) * 2 *
+                         header.number_of_landmarks);
+        landmark_file.read((char *)landmark_nodes.data(), sizeof(NodeID) * landmark_nodes.size());
+        landmark_file.read((char *)core_index.data(), sizeof(uint32_t) * core_index.size());
+        landmark_file.read((char *)distances.data(), sizeof(EdgeWeight) * distances.size());
+        if (!landmark_file)
+        {
+            throw osrm::exception("landmark file is truncated");
+        }
+    }
+
+    LandmarkTable(NodeID *landmark_nodes_ptr,
+                  uint32_t *core_index_ptr,
+                  EdgeWeight *distances_ptr,
+                  const uint64_t number_of_landmarks,
+                  const uint64_t number_of_nodes,
+                  const uint64_t number_of_distances)
+    {
+        typename ShM<NodeID, UseSharedMemory>::vector nodes(landmark_nodes_ptr,
+                                                            number_of_landmarks);
+        typename ShM<uint32_t, UseSharedMemory>::vector index(core_index_ptr, number_of_nodes);
+        typename ShM<EdgeWeight, UseSharedMemory>::vector weights(distances_ptr,
+                                                                  number_of_distances);
+        landmark_nodes.swap(nodes);
+        core_index.swap(index);
+        distances.swap(weights);
+    }
+
+    unsigned GetNumberOfLandmarks() const { return landmark_nodes.size(); }
+
+    // Distances from and to all landmarks, nullptr for nodes outside of the core
+    const EdgeWeight *GetDistances(const NodeID node) const
+    {
+        if (node >= core_index.size() || SPECIAL_NODEID == core_index[node])
+        {
+            return nullptr;
+        }
+        return &distances[static_cast<std::size_t>(core_index[node]) * 2 *
+                          landmark_nodes.size()];
+    }
+
+  private:
+    struct CoreArc
+    {
+        uint32_t target;
+        EdgeWeight weight;
+    };
+
+    struct CoreHeapData
+    {
+    };
+    using CoreHeap = BinaryHeap<uint32_t, uint32_t, EdgeWeight, CoreHeapData,
+                                ArrayStorage<uint32_t, uint32_t>>;
+
+    class CoreGraph
+    {
+      public:
+        CoreGraph(const uint32_t number_of_nodes, std::vector<std::pair<uint32_t, CoreArc>> arcs)
+            : first_arc(number_of_nodes + 1, 0)
+        {
+            std::sort(arcs.begin(), arcs.end(),
+                      [](const std::pair<uint32_t, CoreArc> &lhs,
+                         const std::pair<uint32_t, CoreArc> &rhs)
+                      {
+                          return lhs.first < rhs.first;
+                      });
+            targets.reserve(arcs.size());
+            for (const auto &arc : arcs)
+            {
+                ++first_arc[arc.first + 1];
+                targets.push_back(arc.second);
+            }
+            for (uint32_t node = 0; node < number_of_nodes; ++node)
+            {
+                first_arc[node + 1] += first_arc[node];
+            }
+        }
+
+        void Dijkstra(const uint32_t source,
+                      CoreHeap &heap,
+                      std::vector<EdgeWeight> &distances) const
+        {
+            distances.assign(first_arc.size() - 1, INVALID_EDGE_WEIGHT);
+            heap.Clear();
+            heap.Insert(source, 0, {});
+            while (!heap.Empty())
+            {
+                const uint32_t node = heap.DeleteMin();
+                const EdgeWeight distance = heap.GetKey(node);
+                distances[node] = distance;
+                for (uint32_t arc = first_arc[node]; arc < first_arc[node + 1]; ++arc)
+                {
+                    const uint32_t to = targets[arc].target;
+                    const EdgeWeight to_distance = distance + targets[arc].weight;
+                    if (!heap.WasInserted(to))
+                    {
+                        heap.Insert(to, to_distance, {});
+                    }
+                    else if (!heap.WasRemoved(to) && to_distance < heap.GetKey(to))
+                    {
+                        heap.DecreaseKey(to, to_distance);
+                    }
+                }
+            }
+        }
+
+      private:
+        std::vector<uint32_t> first_arc;
+        std::vector<CoreArc> targets;
+    };
+
+    // the connected node with the largest distance, unreachable nodes are ignored
+    static uint32_t Farthest(const std::vector<EdgeWeight> &distances)
+    {
+        uint32_t farthest = 0;
+        EdgeWeight farthest_distance = -1;
+        for (uint32_t node = 0; node < distances.size(); ++node)
+        {
+            if (INVALID_EDGE_WEIGHT != distances[node] && distances[node] > farthest_distance)
+            {
+                farthest = node;
+                farthest_distance = distances[node];
+            }
+        }
+        return farthest;
+    }
+
+    typename ShM<NodeID, UseSharedMemory>::vector landmark_nodes;
+    typename ShM<uint32_t, UseSharedMemory>::vector core_index;
+    typename ShM<EdgeWeight, UseSharedMemory>::vector distances;
+};
+
+// Potential of the bidirectional ALT search between sets of source and target entry points,
+// each with its initial heap key. h_t bounds the distance to the nearest target and h_s the
+// distance from the nearest source, both by the triangle inequality over every landmark. The
+// forward search uses (h_t - h_s) / 2 and the reverse search its negation, which keeps the
+// reduced edge weights of both searches non-negative.
+class LandmarkPotential
+{
+  public:
+    // distances of an entry point as returned by LandmarkTable::GetDistances and its heap key
+    using EntryPoint = std::pair<const EdgeWeight *, EdgeWeight>;
+
+    LandmarkPotential(const unsigned number_of_landmarks,
+                      const std::vector<EntryPoint> &sources,
+                      const std::vector<EntryPoint> &targets)
+        : number_of_landmarks(number_of_landmarks), bounds(number_of_landmarks)
+    {
+        for (unsigned i = 0; i < number_of_landmarks; ++i)
+        {
+            // d(v,t) >= d(v,L) - d(t,L) and d(v,t) >= d(L,t) - d(L,v)
+            for (const auto &target : targets)
+            {
+                UpdateMaximum(target.first[number_of_landmarks + i], target.second,
+                              bounds[i].to_landmark_target);
+                UpdateMinimum(target.first[i], target.second, bounds[i].from_landmark_target);
+            }
+            // d(s,v) >= d(L,v) - d(L,s) and d(s,v) >= d(s,L) - d(v,L)
+            for (const auto &source : sources)
+            {
+                UpdateMaximum(source.first[i], source.second, bounds[i].from_landmark_source);
+                UpdateMinimum(source.first[number_of_landmarks + i], source.second,
+                              bounds[i].to_landmark_source);
+            }
+        }
+    }
+
+    // potential of a core node in the forward search, the reverse search uses its negation
+    int GetForwardPotential(const EdgeWeight *node_distances) const
+    {
+        BOOST_ASSERT(nullptr != node_distances);
+        int64_t to_target = 0;
+        int64_t from_source = 0;
+        bool has_target_bound = false;
+        bool has_source_bound = false;
+        for (unsigned i = 0; i < number_of_landmarks; ++i)
+        {
+            const int64_t from_landmark = Far(node_distances[i]);
+            const int64_t to_landmark = Far(node_distances[number_of_landmarks + i]);
+            const LandmarkBounds &bound = bounds[i];
+            if (IsActive(bound.to_landmark_target))
+            {
+                UpdateBound(to_landmark - bound.to_landmark_target.value, to_target,
+                            has_target_bound);
+            }
+            if (IsActive(bound.from_landmark_target))
+            {
+                UpdateBound(bound.from_landmark_target.value - from_landmark, to_target,
+                            has_target_bound);
+            }
+            if (IsActive(bound.from_landmark_source))
+            {
+                UpdateBound(from_landmark - bound.from_landmark_source.value, from_source,
+                            has_source_bound);
+            }
+            if (IsActive(bound.to_landmark_source))
+            {
+                UpdateBound(bound.to_landmark_source.value - to_landmark, from_source,
+                            has_source_bound);
+            }
+        }
+        const int64_t difference = to_target - from_source;
+        // rounding down keeps the potential feasible for negative differences, too
+        return static_cast<int>(difference >= 0 ? difference / 2 : -((1 - difference) / 2));
+    }
+
+  private:
+    // Stands in for unconnected pairs. It exceeds any path length but leaves enough room to
+    // add heap keys in an int.
+    static constexpr int64_t UNCONNECTED_DISTANCE = int64_t(1) << 28;
+
+    struct Bound
+    {
+        int64_t value = 0;
+        bool is_valid = false;
+        bool is_disabled = false;
+    };
+
+    struct LandmarkBounds
+    {
+        Bound to_landmark_target;
+        Bound from_landmark_target;
+        Bound from_landmark_source;
+        Bound to_landmark_source;
+    };
+
+    static int64_t Far(const EdgeWeight distance)
+    {
+        return INVALID_EDGE_WEIGHT == distance ? UNCONNECTED_DISTANCE : distance;
+    }
+
+    // an entry point that is not connected to the landmark disables the bound
+    static void UpdateMaximum(const EdgeWeight distance, const EdgeWeight key, Bound &bound)
+    {
+        if (INVALID_EDGE_WEIGHT == distance)
+        {
+            bound.is_disabled = true;
+            return;
+        }
+        const int64_t value = int64_t(distance) - key;
+        bound.value = bound.is_valid ? std::max(bound.value, value) : value;
+        bound.is_valid = true;
+    }
+
+    // an entry point that is not connected to the landmark does not constrain the bound
+    static void UpdateMinimum(const EdgeWeight distance, const EdgeWeight key, Bound &bound)
+    {
+        if (INVALID_EDGE_WEIGHT == distance)
+        {
+            return;
+        }
+        const int64_t value = int64_t(distance) + key;
+        bound.value = bound.is_valid ? std::min(bound.value, value) : value;
+        bound.is_valid = true;
+    }
+
+    static bool IsActive(const Bound &bound) { return bound.is_valid && !bound.is_disabled; }
+
+    static void UpdateBound(const int64_t value, int64_t &bound, bool &has_bound)
+    {
+        bound = has_bound ? std::max(bound, value) : value;
+        has_bound = true;
+    }
+
+    unsigned number_of_landmarks;
+    std::vector<LandmarkBounds> bounds;
+};
+
+#endif // LANDMARK_TABLE_HPP
@@ -30,13 +30,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <list>
 #include <unordered_map>
+#include <utility>
 
 template <typename KeyT, typename ValueT> class LRUCache
 {
   private:
     struct CacheEntry
     {
-        CacheEntry(KeyT k, ValueT v) : key(k), value(v) {}
+        CacheEntry(KeyT k, ValueT v) : key(std::move(k)), value(std::move(v)) {}
         KeyT key;
         ValueT value;
     };
@@ -56,20 +57,17 @@ template <typename KeyT, typename ValueT> class LRUCache
         return false;
     }
 
-    void Insert(const KeyT key, ValueT &value)
+    void Insert(const KeyT key, ValueT value)
     {
-        itemsInCache.push_front(CacheEntry(key, value));
-        positionMap.insert(std::make_pair(key, itemsInCache.begin()));
-        if (itemsInCache.size() > capacity)
+        const auto position = positionMap.find(key);
+        if (position != positionMap.end())
         {
-            positionMap.erase(itemsInCache.back().key);
-            itemsInCache.pop_back();
+            // refresh an existing entry instead of keeping a second, dangling copy of it
+            position->second->value = std::move(value);
+            itemsInCache.splice(itemsInCache.begin(), itemsInCache, position->second);
+            return;
         }
-    }
-
-    void Insert(const KeyT key, ValueT value)
-    {
-        itemsInCache.push_front(CacheEntry(key, value));
+        itemsInCache.emplace_front(key, std::move(value));
         positionMap.insert(std::make_pair(key, itemsInCache.begin()));
         if (itemsInCache.size() > capacity)
         {
@@ -80,18 +78,24 @@ template <typename KeyT, typename ValueT> class LRUCache
 
     bool Fetch(const KeyT key, ValueT &result)
     {
-        if (Holds(key))
+        const auto position = positionMap.find(key);
+        if (position == positionMap.end())
         {
-            CacheEntry e = *(positionMap.find(key)->second);
-            result = e.value;
-
-            // move to front
-            itemsInCache.splice(itemsInCache.begin(), itemsInCache, positionMap.find(key)->second);
-            positionMap.find(key)->second = itemsInCache.begin();
-            return true;
+            return false;
         }
-        return false;
+        result = position->second->value;
+
+        // move to front, list iterators stay valid
+        itemsInCache.splice(itemsInCache.begin(), itemsInCache, position->second);
+        return true;
     }
+
+    void Clear()
+    {
+        positionMap.clear();
+        itemsInCache.clear();
+    }
+
     unsigned Size() const { return itemsInCache.size(); }
 };
 #endif // LRUCACHE_HPP
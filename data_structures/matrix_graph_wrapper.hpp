@@ -31,16 +31,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <cstddef>
 #include <iterator>
+#include <memory>
 
 #include "../typedefs.h"
 
 // This Wrapper provides all methods that are needed for TarjanSCC, when the graph is given in a
-// matrix representation (e.g. as output from a distance table call)
+// matrix representation (e.g. as output from a distance table call). The matrix is shared, not
+// copied.
 
 template <typename T> class MatrixGraphWrapper
 {
   public:
-    MatrixGraphWrapper(std::vector<T> table, const std::size_t number_of_nodes)
+    MatrixGraphWrapper(std::shared_ptr<const std::vector<T>> table,
+                       const std::size_t number_of_nodes)
         : table_(std::move(table)), number_of_nodes_(number_of_nodes){};
 
     std::size_t GetNumberOfNodes() const { return number_of_nodes_; }
@@ -50,9 +53,10 @@ template <typename T> class MatrixGraphWrapper
 
         std::vector<T> edges;
         // find all valid adjacent edges and move to vector `edges`
+        const T *row = table_->data() + node * number_of_nodes_;
         for (std::size_t i = 0; i < number_of_nodes_; ++i)
         {
-            if (*(std::begin(table_) + node * number_of_nodes_ + i) != INVALID_EDGE_WEIGHT)
+            if (row[i] != INVALID_EDGE_WEIGHT)
             {
                 edges.push_back(i);
             }
@@ -63,7 +67,7 @@ template <typename T> class MatrixGraphWrapper
     EdgeWeight GetTarget(const EdgeWeight edge) const { return edge; }
 
   private:
-    const std::vector<T> table_;
+    const std::shared_ptr<const std::vector<T>> table_;
     const std::size_t number_of_nodes_;
 };
 
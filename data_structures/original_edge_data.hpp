@@ -28,11 +28,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef ORIGINAL_EDGE_DATA_HPP
 #define ORIGINAL_EDGE_DATA_HPP
 
+#include "packed_vector.hpp"
 #include "travel_mode.hpp"
 #include "turn_instructions.hpp"
 #include "../typedefs.h"
+#include "../util/osrm_exception.hpp"
 
 #include <limits>
+#include <string>
 
 struct OriginalEdgeData
 {
@@ -60,4 +63,25 @@ struct OriginalEdgeData
     TravelMode travel_mode;
 };
 
+// the facades keep the travel modes and turn instructions of the original edges packed
+template <bool UseSharedMemory>
+using TravelModeVector = PackedVector<TravelMode, 4, UseSharedMemory>;
+template <bool UseSharedMemory>
+using TurnInstructionVector = PackedVector<TurnInstruction, 5, UseSharedMemory>;
+
+inline void CheckPackedFields(const OriginalEdgeData &edge_data)
+{
+    if (!TravelModeVector<false>::Fits(edge_data.travel_mode))
+    {
+        throw osrm::exception("travel mode " + std::to_string(edge_data.travel_mode) +
+                              " is out of range, at most 15 modes are supported");
+    }
+    if (!TurnInstructionVector<false>::Fits(edge_data.turn_instruction))
+    {
+        throw osrm::exception("turn instruction " +
+                              std::to_string(static_cast<int>(edge_data.turn_instruction)) +
+                              " can't be packed");
+    }
+}
+
 #endif // ORIGINAL_EDGE_DATA_HPP
@@ -0,0 +1,138 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef PACKED_PHANTOM_NODE_HPP
+#define PACKED_PHANTOM_NODE_HPP
+
+#include "phantom_node.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <cstdint>
+
+// A PhantomNode in 40 instead of 48 bytes. The ids and the location keep their full width, the
+// weights, offsets, segment position and component id are narrowed to the ranges the r-tree
+// produces. Fits() tells whether a phantom node can be packed without loss, users keep the
+// full struct for the rare ones that cannot, e.g. on the segments of day-long ferries.
+class PackedPhantomNode
+{
+  public:
+    PackedPhantomNode() : words() {}
+
+    explicit PackedPhantomNode(const PhantomNode &phantom_node)
+    {
+        BOOST_ASSERT(Fits(phantom_node));
+        words[0] = phantom_node.forward_node_id |
+                   static_cast<std::uint64_t>(phantom_node.reverse_node_id) << 32;
+        words[1] = phantom_node.name_id |
+                   static_cast<std::uint64_t>(phantom_node.packed_geometry_id) << 32;
+        words[2] = static_cast<std::uint32_t>(phantom_node.location.lat) |
+                   static_cast<std::uint64_t>(static_cast<std::uint32_t>(phantom_node.location.lon))
+                       << 32;
+        words[3] = PackWeight(phantom_node.forward_weight) |
+                   PackWeight(phantom_node.reverse_weight) << WEIGHT_BITS |
+                   static_cast<std::uint64_t>(phantom_node.fwd_segment_position)
+                       << (2 * WEIGHT_BITS) |
+                   static_cast<std::uint64_t>(phantom_node.forward_travel_mode) << 56 |
+                   static_cast<std::uint64_t>(phantom_node.backward_travel_mode) << 60;
+        words[4] = static_cast<std::uint64_t>(phantom_node.forward_offset) |
+                   static_cast<std::uint64_t>(phantom_node.reverse_offset) << OFFSET_BITS |
+                   PackComponent(phantom_node.component_id) << (2 * OFFSET_BITS);
+    }
+
+    static bool Fits(const PhantomNode &phantom_node)
+    {
+        return FitsWeight(phantom_node.forward_weight) && FitsWeight(phantom_node.reverse_weight) &&
+               0 <= phantom_node.forward_offset && phantom_node.forward_offset <= MAX_OFFSET &&
+               0 <= phantom_node.reverse_offset && phantom_node.reverse_offset <= MAX_OFFSET &&
+               phantom_node.fwd_segment_position < (1u << POSITION_BITS) &&
+               phantom_node.forward_travel_mode < 16 && phantom_node.backward_travel_mode < 16 &&
+               (phantom_node.component_id < COMPONENT_MASK ||
+                INVALID_COMPONENT == phantom_node.component_id);
+    }
+
+    PhantomNode Unpack() const
+    {
+        PhantomNode phantom_node;
+        phantom_node.forward_node_id = static_cast<NodeID>(words[0]);
+        phantom_node.reverse_node_id = static_cast<NodeID>(words[0] >> 32);
+        phantom_node.name_id = static_cast<unsigned>(words[1]);
+        phantom_node.packed_geometry_id = static_cast<unsigned>(words[1] >> 32);
+        phantom_node.location.lat = static_cast<int>(static_cast<std::uint32_t>(words[2]));
+        phantom_node.location.lon = static_cast<int>(static_cast<std::uint32_t>(words[2] >> 32));
+        phantom_node.forward_weight = UnpackWeight(words[3] & WEIGHT_MASK);
+        phantom_node.reverse_weight = UnpackWeight((words[3] >> WEIGHT_BITS) & WEIGHT_MASK);
+        phantom_node.fwd_segment_position = static_cast<unsigned short>(
+            (words[3] >> (2 * WEIGHT_BITS)) & ((1u << POSITION_BITS) - 1));
+        phantom_node.forward_travel_mode = static_cast<TravelMode>((words[3] >> 56) & 0xf);
+        phantom_node.backward_travel_mode = static_cast<TravelMode>(words[3] >> 60);
+        phantom_node.forward_offset = static_cast<int>(words[4] & MAX_OFFSET);
+        phantom_node.reverse_offset = static_cast<int>((words[4] >> OFFSET_BITS) & MAX_OFFSET);
+        const auto component_id = static_cast<unsigned>(words[4] >> (2 * OFFSET_BITS));
+        phantom_node.component_id =
+            COMPONENT_MASK == component_id ? INVALID_COMPONENT : component_id;
+        return phantom_node;
+    }
+
+  private:
+    // the all ones value of a weight is INVALID_EDGE_WEIGHT, as is UINT_MAX for components
+    static constexpr unsigned WEIGHT_BITS = 22;
+    static constexpr std::uint64_t WEIGHT_MASK = (1u << WEIGHT_BITS) - 1;
+    static constexpr unsigned POSITION_BITS = 12;
+    static constexpr unsigned OFFSET_BITS = 20;
+    static constexpr int MAX_OFFSET = (1 << OFFSET_BITS) - 1;
+    static constexpr unsigned COMPONENT_MASK = (1u << 24) - 1;
+    static constexpr unsigned INVALID_COMPONENT = ~0u;
+
+    static bool FitsWeight(const int weight)
+    {
+        return INVALID_EDGE_WEIGHT == weight || (0 <= weight && weight < int(WEIGHT_MASK));
+    }
+
+    static std::uint64_t PackWeight(const int weight)
+    {
+        return INVALID_EDGE_WEIGHT == weight ? WEIGHT_MASK : static_cast<std::uint64_t>(weight);
+    }
+
+    static int UnpackWeight(const std::uint64_t bits)
+    {
+        return WEIGHT_MASK == bits ? INVALID_EDGE_WEIGHT : static_cast<int>(bits);
+    }
+
+    static std::uint64_t PackComponent(const unsigned component_id)
+    {
+        return INVALID_COMPONENT == component_id ? COMPONENT_MASK : component_id;
+    }
+
+    std::uint64_t words[5];
+};
+
+static_assert(sizeof(PackedPhantomNode) == 40, "PackedPhantomNode has unexpected padding");
+
+#endif // PACKED_PHANTOM_NODE_HPP
@@ -0,0 +1,116 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef PACKED_VECTOR_HPP
+#define PACKED_VECTOR_HPP
+
+#include "shared_memory_vector_wrapper.hpp"
+
+#include <boost/assert.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// Values of at most BITS bits in 64 bit words, no value crosses a word boundary. Used for the
+// small per-edge enums, the layout is the same in shared memory, where osrm-datastore writes
+// the words with Set().
+template <typename T, unsigned BITS, bool UseSharedMemory> class PackedVector
+{
+    static_assert(BITS > 0 && BITS < 64, "values have to fit into a word");
+
+  public:
+    using WordT = std::uint64_t;
+    static constexpr std::size_t VALUES_PER_WORD = 64 / BITS;
+    static constexpr WordT VALUE_MASK = (WordT(1) << BITS) - 1;
+
+    static std::size_t GetNumberOfWords(const std::size_t number_of_values)
+    {
+        return (number_of_values + VALUES_PER_WORD - 1) / VALUES_PER_WORD;
+    }
+
+    static bool Fits(const T value) { return static_cast<WordT>(value) <= VALUE_MASK; }
+
+    static void Set(WordT *words, const std::size_t index, const T value)
+    {
+        BOOST_ASSERT(Fits(value));
+        const std::size_t shift = index % VALUES_PER_WORD * BITS;
+        WordT &word = words[index / VALUES_PER_WORD];
+        word = (word & ~(VALUE_MASK << shift)) | (static_cast<WordT>(value) << shift);
+    }
+
+    PackedVector() : number_of_values(0) {}
+
+    // internal memory, all values are zero
+    explicit PackedVector(const std::size_t number_of_values)
+        : words(GetNumberOfWords(number_of_values), 0), number_of_values(number_of_values)
+    {
+        static_assert(!UseSharedMemory, "packed vectors in shared memory are written by Set()");
+    }
+
+    // shared memory
+    PackedVector(WordT *words_ptr, const std::size_t number_of_values)
+        : words(words_ptr, GetNumberOfWords(number_of_values)), number_of_values(number_of_values)
+    {
+    }
+
+    void swap(PackedVector &other)
+    {
+        words.swap(other.words);
+        std::swap(number_of_values, other.number_of_values);
+    }
+
+    std::size_t size() const { return number_of_values; }
+
+    bool empty() const { return 0 == number_of_values; }
+
+    T at(const std::size_t index) const
+    {
+        BOOST_ASSERT(index < number_of_values);
+        const std::size_t shift = index % VALUES_PER_WORD * BITS;
+        return static_cast<T>((words[index / VALUES_PER_WORD] >> shift) & VALUE_MASK);
+    }
+
+    T operator[](const std::size_t index) const { return at(index); }
+
+    void set(const std::size_t index, const T value)
+    {
+        BOOST_ASSERT(index < number_of_values);
+        Set(&words[0], index, value);
+    }
+
+  private:
+    typename ShM<WordT, UseSharedMemory>::vector words;
+    std::size_t number_of_values;
+};
+
+template <typename T, unsigned BITS, bool UseSharedMemory>
+constexpr std::size_t PackedVector<T, BITS, UseSharedMemory>::VALUES_PER_WORD;
+template <typename T, unsigned BITS, bool UseSharedMemory>
+constexpr typename PackedVector<T, BITS, UseSharedMemory>::WordT
+    PackedVector<T, BITS, UseSharedMemory>::VALUE_MASK;
+
+#endif // PACKED_VECTOR_HPP
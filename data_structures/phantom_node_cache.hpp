@@ -0,0 +1,169 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef PHANTOM_NODE_CACHE_HPP
+#define PHANTOM_NODE_CACHE_HPP
+
+#include "lru_cache.hpp"
+#include "packed_phantom_node.hpp"
+#include "phantom_node.hpp"
+
+#include <osrm/coordinate.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Caches the phantom nodes found for repeated coordinates, e.g. pickup points at stations, so
+// their lookup skips the r-tree. The cache is split into independently locked shards, each
+// holding a bounded LRU list. It belongs to a single facade and is dropped with its data.
+class PhantomNodeCache
+{
+  private:
+    // the phantom nodes are kept packed unless one of them does not fit
+    struct Entry
+    {
+        unsigned number_of_results;
+        std::vector<PackedPhantomNode> packed_phantom_nodes;
+        std::vector<PhantomNode> phantom_nodes;
+    };
+    using EntryPointer = std::shared_ptr<const Entry>;
+
+    struct Shard
+    {
+        explicit Shard(const unsigned capacity) : entries(capacity) {}
+
+        std::mutex mutex;
+        LRUCache<std::uint64_t, EntryPointer> entries;
+    };
+
+  public:
+    // capacity is the total number of cached coordinates
+    explicit PhantomNodeCache(const unsigned capacity, const unsigned number_of_shards = 16)
+    {
+        const unsigned shard_count = std::max(1u, number_of_shards);
+        const unsigned shard_capacity = std::max(1u, capacity / shard_count);
+        for (unsigned i = 0; i < shard_count; ++i)
+        {
+            shards.emplace_back(new Shard(shard_capacity));
+        }
+    }
+
+    // appends the phantom nodes cached for the exact coordinate and number of results
+    bool Fetch(const FixedPointCoordinate &coordinate,
+               const unsigned number_of_results,
+               std::vector<PhantomNode> &phantom_nodes)
+    {
+        const std::uint64_t key = GetKey(coordinate);
+        EntryPointer entry;
+        {
+            Shard &shard = GetShard(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.entries.Fetch(key, entry))
+            {
+                return false;
+            }
+        }
+        if (entry->number_of_results != number_of_results)
+        {
+            return false;
+        }
+        phantom_nodes.insert(phantom_nodes.end(), entry->phantom_nodes.begin(),
+                             entry->phantom_nodes.end());
+        for (const PackedPhantomNode &packed_phantom_node : entry->packed_phantom_nodes)
+        {
+            phantom_nodes.push_back(packed_phantom_node.Unpack());
+        }
+        return true;
+    }
+
+    void Insert(const FixedPointCoordinate &coordinate,
+                const unsigned number_of_results,
+                std::vector<PhantomNode> phantom_nodes)
+    {
+        const std::uint64_t key = GetKey(coordinate);
+        auto entry = std::make_shared<Entry>();
+        entry->number_of_results = number_of_results;
+        if (std::all_of(phantom_nodes.begin(), phantom_nodes.end(), PackedPhantomNode::Fits))
+        {
+            entry->packed_phantom_nodes.reserve(phantom_nodes.size());
+            for (const PhantomNode &phantom_node : phantom_nodes)
+            {
+                entry->packed_phantom_nodes.emplace_back(phantom_node);
+            }
+        }
+        else
+        {
+            entry->phantom_nodes = std::move(phantom_nodes);
+        }
+
+        Shard &shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.Insert(key, std::move(entry));
+    }
+
+    void Clear()
+    {
+        for (auto &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->entries.Clear();
+        }
+    }
+
+    std::size_t Size() const
+    {
+        std::size_t size = 0;
+        for (const auto &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            size += shard->entries.Size();
+        }
+        return size;
+    }
+
+  private:
+    // results depend on the exact input, so the key is the fixed point coordinate itself
+    static std::uint64_t GetKey(const FixedPointCoordinate &coordinate)
+    {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(coordinate.lat)) << 32) |
+               static_cast<std::uint32_t>(coordinate.lon);
+    }
+
+    Shard &GetShard(const std::uint64_t key)
+    {
+        return *shards[std::hash<std::uint64_t>()(key ^ (key >> 32)) % shards.size()];
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+#endif // PHANTOM_NODE_CACHE_HPP
@@ -38,11 +38,15 @@ struct QueryEdge
     NodeID target;
     struct EdgeData
     {
-        EdgeData() : id(0), shortcut(false), distance(0), forward(false), backward(false) {}
+        EdgeData()
+            : id(0), shortcut(false), distance(0), forward(false), backward(false), length(0)
+        {
+        }
 
         template <class OtherT> EdgeData(const OtherT &other)
         {
             distance = other.distance;
+            length = other.length;
             shortcut = other.shortcut;
             id = other.id;
             forward = other.forward;
@@ -53,6 +57,8 @@ struct QueryEdge
         int distance : 30;
         bool forward : 1;
         bool backward : 1;
+        // in decimeters, the geometry of the source node or the sum over a shortcut's edges
+        unsigned length;
     } data;
 
     QueryEdge() : source(SPECIAL_NODEID), target(SPECIAL_NODEID) {}
@@ -72,7 +78,7 @@ struct QueryEdge
         return (source == right.source && target == right.target &&
                 data.distance == right.data.distance && data.shortcut == right.data.shortcut &&
                 data.forward == right.data.forward && data.backward == right.data.backward &&
-                data.id == right.data.id);
+                data.id == right.data.id && data.length == right.data.length);
     }
 };
 
@@ -32,10 +32,63 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "shared_memory_factory.hpp"
 #include "shared_memory_vector_wrapper.hpp"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include <fstream>
+#include <limits>
 #include <vector>
 #include <array>
 
+namespace range_table_detail
+{
+// out[i] = base + block[0] + ... + block[i] for every differential value of a block
+template <std::size_t BLOCK_SIZE>
+inline void block_prefix_sums(const std::array<unsigned char, BLOCK_SIZE> &block,
+                              const unsigned base,
+                              unsigned *out)
+{
+    unsigned sum = base;
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i)
+    {
+        sum += block[i];
+        out[i] = sum;
+    }
+}
+
+#if defined(__SSE2__)
+// The default block is one vector of bytes. They are widened to two halves of 16 bit sums, a
+// sum of 16 values of at most 255 still fits, and scanned with three shifted adds each.
+inline void
+block_prefix_sums(const std::array<unsigned char, 16> &block, const unsigned base, unsigned *out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block.data()));
+    __m128i low = _mm_unpacklo_epi8(bytes, zero);
+    __m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+    low = _mm_add_epi16(low, _mm_slli_si128(low, 2));
+    high = _mm_add_epi16(high, _mm_slli_si128(high, 2));
+    low = _mm_add_epi16(low, _mm_slli_si128(low, 4));
+    high = _mm_add_epi16(high, _mm_slli_si128(high, 4));
+    low = _mm_add_epi16(low, _mm_slli_si128(low, 8));
+    high = _mm_add_epi16(high, _mm_slli_si128(high, 8));
+
+    // carry the total of the lower half into the upper half
+    const __m128i low_total = _mm_shufflehi_epi16(low, 0xFF);
+    high = _mm_add_epi16(high, _mm_unpackhi_epi64(low_total, low_total));
+
+    const __m128i base_vector = _mm_set1_epi32(static_cast<int>(base));
+    __m128i *out_vector = reinterpret_cast<__m128i *>(out);
+    _mm_storeu_si128(out_vector, _mm_add_epi32(_mm_unpacklo_epi16(low, zero), base_vector));
+    _mm_storeu_si128(out_vector + 1, _mm_add_epi32(_mm_unpackhi_epi16(low, zero), base_vector));
+    _mm_storeu_si128(out_vector + 2, _mm_add_epi32(_mm_unpacklo_epi16(high, zero), base_vector));
+    _mm_storeu_si128(out_vector + 3, _mm_add_epi32(_mm_unpackhi_epi16(high, zero), base_vector));
+}
+#endif
+}
+
 /*
  * These pre-declarations are needed because parsing C++ is hard
  * and otherwise the compiler gets confused.
@@ -65,6 +118,8 @@ template <unsigned BLOCK_SIZE, bool USE_SHARED_MEMORY> class RangeTable
     using BlockContainerT = typename ShM<BlockT, USE_SHARED_MEMORY>::vector;
     using OffsetContainerT = typename ShM<unsigned, USE_SHARED_MEMORY>::vector;
     using RangeT = osrm::range<unsigned>;
+    // begin offsets of the BLOCK_SIZE + 1 ranges of a block followed by the end of the last one
+    using BlockOffsetsT = std::array<unsigned, BLOCK_SIZE + 2>;
 
     friend std::ostream &operator<<<>(std::ostream &out, const RangeTable &table);
     friend std::istream &operator>><>(std::istream &in, RangeTable &table);
@@ -198,6 +253,43 @@ template <unsigned BLOCK_SIZE, bool USE_SHARED_MEMORY> class RangeTable
         return osrm::irange(begin_idx, end_idx);
     }
 
+    // Decodes all offsets of a block in one pass, the ranges of the block are then
+    // [offsets[i], offsets[i + 1]) for internal index i.
+    inline void DecodeBlock(const unsigned block_idx, BlockOffsetsT &offsets) const
+    {
+        BOOST_ASSERT(block_idx < diff_blocks.size());
+        offsets[0] = block_offsets[block_idx];
+        range_table_detail::block_prefix_sums(diff_blocks[block_idx], offsets[0],
+                                              offsets.data() + 1);
+        // the last block has no successor, its trailing ranges are the empty padding
+        offsets[BLOCK_SIZE + 1] = block_idx + 1 < block_offsets.size()
+                                      ? block_offsets[block_idx + 1]
+                                      : offsets[BLOCK_SIZE];
+    }
+
+    // Looks up the ranges of many ids, every block is only decoded once for a run of ids that
+    // fall into it. Sorted ids are fastest, but any order is valid.
+    template <typename IdIterator, typename OutputIterator>
+    void GetRanges(IdIterator first, const IdIterator last, OutputIterator out) const
+    {
+        BlockOffsetsT offsets;
+        unsigned decoded_block_idx = std::numeric_limits<unsigned>::max();
+        for (; first != last; ++first)
+        {
+            const unsigned id = *first;
+            const unsigned block_idx = id / (BLOCK_SIZE + 1);
+            const unsigned internal_idx = id % (BLOCK_SIZE + 1);
+            if (block_idx != decoded_block_idx)
+            {
+                DecodeBlock(block_idx, offsets);
+                decoded_block_idx = block_idx;
+            }
+            BOOST_ASSERT(offsets[internal_idx] <= offsets[internal_idx + 1]);
+            *out = osrm::irange(offsets[internal_idx], offsets[internal_idx + 1]);
+            ++out;
+        }
+    }
+
   private:
     inline unsigned PrefixSumAtIndex(int index, const BlockT &block) const;
 
@@ -32,7 +32,132 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/coordinate.hpp>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <mutex>
+
+namespace
+{
+const char tiled_raster_magic[8] = {'O', 'S', 'R', 'M', 'R', 'S', 'T', '\0'};
+
+// Tiled rasters are mapped once per process, so all lua states of the extractor threads
+// share the same pages
+std::shared_ptr<const TiledRasterFile> OpenTiledRasterFile(const boost::filesystem::path &filepath)
+{
+    static std::mutex open_files_mutex;
+    static std::unordered_map<std::string, std::weak_ptr<const TiledRasterFile>> open_files;
+
+    const std::string key = boost::filesystem::canonical(filepath).string();
+    std::lock_guard<std::mutex> lock(open_files_mutex);
+    auto tiled_file = open_files[key].lock();
+    if (!tiled_file)
+    {
+        tiled_file = std::make_shared<const TiledRasterFile>(filepath);
+        open_files[key] = tiled_file;
+    }
+    return tiled_file;
+}
+}
+
+constexpr std::uint32_t TiledRasterFile::current_version;
+constexpr std::size_t TiledRasterFile::default_tile_size;
+
+TiledRasterFile::TiledRasterFile(const boost::filesystem::path &filepath)
+{
+    try
+    {
+        file.open(filepath.string());
+    }
+    catch (const std::exception &e)
+    {
+        throw osrm::exception(std::string("Unable to map raster file: ") + e.what());
+    }
+
+    if (file.size() < sizeof(Header))
+    {
+        throw osrm::exception("Tiled raster file is truncated.");
+    }
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(Header));
+    if (0 != std::memcmp(header.magic, tiled_raster_magic, sizeof(tiled_raster_magic)) ||
+        current_version != header.version)
+    {
+        throw osrm::exception("Unsupported tiled raster file.");
+    }
+    if (0 == header.xdim || 0 == header.ydim || 0 == header.tile_size)
+    {
+        throw osrm::exception("Tiled raster file is empty.");
+    }
+
+    xdim = header.xdim;
+    ydim = header.ydim;
+    tile_size = header.tile_size;
+    tiles_per_row = (xdim + tile_size - 1) / tile_size;
+    const std::size_t tiles_per_column = (ydim + tile_size - 1) / tile_size;
+    const std::size_t number_of_values = tiles_per_row * tiles_per_column * tile_size * tile_size;
+    if (file.size() < sizeof(Header) + number_of_values * sizeof(std::int32_t))
+    {
+        throw osrm::exception("Tiled raster file is truncated.");
+    }
+    values = reinterpret_cast<const std::int32_t *>(file.data() + sizeof(Header));
+}
+
+bool TiledRasterFile::IsTiledRaster(const boost::filesystem::path &filepath)
+{
+    boost::filesystem::ifstream stream(filepath, std::ios::binary);
+    char magic[sizeof(tiled_raster_magic)];
+    return stream.read(magic, sizeof(magic)) &&
+           0 == std::memcmp(magic, tiled_raster_magic, sizeof(tiled_raster_magic));
+}
+
+void TiledRasterFile::Write(const boost::filesystem::path &input_path,
+                            std::size_t xdim,
+                            std::size_t ydim,
+                            const boost::filesystem::path &output_path,
+                            std::size_t tile_size)
+{
+    BOOST_ASSERT(tile_size > 0);
+    const RasterGrid grid(input_path, xdim, ydim);
+
+    boost::filesystem::ofstream stream(output_path, std::ios::binary);
+    if (!stream)
+    {
+        throw osrm::exception("Unable to open tiled raster file for writing.");
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, tiled_raster_magic, sizeof(tiled_raster_magic));
+    header.version = current_version;
+    header.xdim = static_cast<std::uint32_t>(xdim);
+    header.ydim = static_cast<std::uint32_t>(ydim);
+    header.tile_size = static_cast<std::uint32_t>(tile_size);
+    stream.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+    std::vector<std::int32_t> tile(tile_size * tile_size);
+    for (std::size_t tile_y = 0; tile_y < ydim; tile_y += tile_size)
+    {
+        for (std::size_t tile_x = 0; tile_x < xdim; tile_x += tile_size)
+        {
+            std::fill(tile.begin(), tile.end(), RasterDatum::get_invalid());
+            for (std::size_t y = tile_y; y < std::min(tile_y + tile_size, ydim); ++y)
+            {
+                for (std::size_t x = tile_x; x < std::min(tile_x + tile_size, xdim); ++x)
+                {
+                    tile[(y - tile_y) * tile_size + (x - tile_x)] = grid(x, y);
+                }
+            }
+            stream.write(reinterpret_cast<const char *>(tile.data()),
+                         tile.size() * sizeof(std::int32_t));
+        }
+    }
+
+    if (!stream)
+    {
+        throw osrm::exception("Failed to write tiled raster file.");
+    }
+}
 
 RasterSource::RasterSource(RasterGrid _raster_data,
                            std::size_t _width,
@@ -42,7 +167,7 @@ RasterSource::RasterSource(RasterGrid _raster_data,
                            int _ymin,
                            int _ymax)
     : xstep(calcSize(_xmin, _xmax, _width)), ystep(calcSize(_ymin, _ymax, _height)),
-      raster_data(_raster_data), width(_width), height(_height), xmin(_xmin), xmax(_xmax),
+      raster_data(std::move(_raster_data)), width(_width), height(_height), xmin(_xmin), xmax(_xmax),
       ymin(_ymin), ymax(_ymax)
 {
     BOOST_ASSERT(xstep != 0);
@@ -97,7 +222,64 @@ RasterDatum RasterSource::getRasterInterpolate(const int lon, const int lat) con
                                       raster_data(right, bottom) * (fromLeft * fromTop))};
 }
 
-// Load raster source into memory
+// Query raster source using bilinear interpolation for a batch of coordinates. The weights are
+// computed in a separate loop without branches, thus by the vector units, before the values of
+// the corners are gathered.
+void RasterSource::getRasterInterpolateBatch(const int *lons,
+                                             const int *lats,
+                                             const std::size_t count,
+                                             RasterDatum *results) const
+{
+    constexpr std::size_t batch_size = 256;
+    float from_left[batch_size];
+    float from_top[batch_size];
+    std::size_t left[batch_size];
+    std::size_t right[batch_size];
+    std::size_t top[batch_size];
+    std::size_t bottom[batch_size];
+
+    for (std::size_t offset = 0; offset < count; offset += batch_size)
+    {
+        const std::size_t size = std::min(batch_size, count - offset);
+        const int *const batch_lons = lons + offset;
+        const int *const batch_lats = lats + offset;
+
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            const auto xthP = (batch_lons[i] - xmin) / xstep;
+            const auto ythP = (ymax - batch_lats[i]) / ystep;
+
+            // clamped on both sides, coordinates out of bounds are only discarded below
+            top[i] = static_cast<std::size_t>(fmin(fmax(floor(ythP), 0), height - 1));
+            bottom[i] = static_cast<std::size_t>(fmin(fmax(ceil(ythP), 0), height - 1));
+            left[i] = static_cast<std::size_t>(fmin(fmax(floor(xthP), 0), width - 1));
+            right[i] = static_cast<std::size_t>(fmin(fmax(ceil(xthP), 0), width - 1));
+
+            from_left[i] = (batch_lons[i] - left[i] * xstep + xmin) / xstep;
+            from_top[i] = (ymax - top[i] * ystep - batch_lats[i]) / ystep;
+        }
+
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            if (batch_lons[i] < xmin || batch_lons[i] > xmax || batch_lats[i] < ymin ||
+                batch_lats[i] > ymax)
+            {
+                results[offset + i] = {};
+                continue;
+            }
+
+            const float fromRight = 1 - from_left[i];
+            const float fromBottom = 1 - from_top[i];
+            results[offset + i] = {static_cast<std::int32_t>(
+                raster_data(left[i], top[i]) * (fromRight * fromBottom) +
+                raster_data(right[i], top[i]) * (from_left[i] * fromBottom) +
+                raster_data(left[i], bottom[i]) * (fromRight * from_top[i]) +
+                raster_data(right[i], bottom[i]) * (from_left[i] * from_top[i]))};
+        }
+    }
+}
+
+// Load raster source into memory, tiled raster sources are mapped instead
 int SourceContainer::loadRasterSource(const std::string &path_string,
                                       double xmin,
                                       double xmax,
@@ -130,7 +312,17 @@ int SourceContainer::loadRasterSource(const std::string &path_string,
         throw osrm::exception("error reading: no such path");
     }
 
-    RasterGrid rasterData{filepath, ncols, nrows};
+    // tiled rasters are mapped instead of parsed, the dimensions are part of the file
+    const bool is_tiled = TiledRasterFile::IsTiledRaster(filepath);
+    RasterGrid rasterData = is_tiled ? RasterGrid{OpenTiledRasterFile(filepath)}
+                                     : RasterGrid{filepath, ncols, nrows};
+    if (is_tiled)
+    {
+        if (rasterData.GetXDim() != ncols || rasterData.GetYDim() != nrows)
+        {
+            throw osrm::exception("Tiled raster source does not match the given dimensions.");
+        }
+    }
 
     RasterSource source{std::move(rasterData), ncols, nrows, _xmin, _xmax, _ymin, _ymax};
     TIMER_STOP(loading_source);
@@ -176,3 +368,20 @@ SourceContainer::getRasterInterpolateFromSource(unsigned int source_id, int lon,
     const auto &found = LoadedSources[source_id];
     return found.getRasterInterpolate(lon, lat);
 }
+
+// External function for interpolating a batch of coordinates from a specified source
+void SourceContainer::getRasterInterpolateBatchFromSource(unsigned int source_id,
+                                                          const std::vector<int> &lons,
+                                                          const std::vector<int> &lats,
+                                                          std::vector<RasterDatum> &results) const
+{
+    if (LoadedSources.size() < source_id + 1)
+    {
+        throw osrm::exception("error reading: no such loaded source");
+    }
+    BOOST_ASSERT(lons.size() == lats.size());
+
+    results.resize(lons.size());
+    LoadedSources[source_id].getRasterInterpolateBatch(lons.data(), lats.data(), lons.size(),
+                                                       results.data());
+}
@@ -36,9 +36,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/spirit/include/qi.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/assert.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
+#include <cstdint>
+#include <memory>
 #include <unordered_map>
 #include <iterator>
+#include <vector>
 
 /**
     \brief Small wrapper around raster source queries to optionally provide results
@@ -55,9 +59,69 @@ struct RasterDatum
     RasterDatum(std::int32_t _datum) : datum(_datum) {}
 };
 
+/**
+    \brief Binary raster of square tiles that is memory-mapped, thus pages of it are only read
+    when they are queried and all threads of the process share the same pages.
+
+    The file starts with a header, followed by the tiles in row-major order. Each tile stores
+    tile_size * tile_size values in row-major order, tiles at the borders are padded.
+*/
+class TiledRasterFile
+{
+  public:
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t xdim;
+        std::uint32_t ydim;
+        std::uint32_t tile_size;
+        // keeps the values aligned
+        std::uint32_t reserved[2];
+    };
+    static_assert(sizeof(Header) % sizeof(std::int32_t) == 0, "values need to be aligned");
+
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::size_t default_tile_size = 256;
+
+    explicit TiledRasterFile(const boost::filesystem::path &filepath);
+
+    // true if the file starts with the header of a tiled raster
+    static bool IsTiledRaster(const boost::filesystem::path &filepath);
+
+    // converts an ASCII grid of xdim columns and ydim rows to the tiled format
+    static void Write(const boost::filesystem::path &input_path,
+                      std::size_t xdim,
+                      std::size_t ydim,
+                      const boost::filesystem::path &output_path,
+                      std::size_t tile_size = default_tile_size);
+
+    std::size_t GetXDim() const { return xdim; }
+    std::size_t GetYDim() const { return ydim; }
+
+    std::int32_t operator()(std::size_t x, std::size_t y) const
+    {
+        BOOST_ASSERT(x < xdim && y < ydim);
+        const std::size_t tile = (y / tile_size) * tiles_per_row + x / tile_size;
+        return values[tile * tile_size * tile_size + (y % tile_size) * tile_size + x % tile_size];
+    }
+
+  private:
+    boost::iostreams::mapped_file_source file;
+    const std::int32_t *values;
+    std::size_t xdim, ydim, tile_size, tiles_per_row;
+};
+
 class RasterGrid
 {
   public:
+    // the mapping of a tiled raster is shared with all grids of the same file
+    explicit RasterGrid(std::shared_ptr<const TiledRasterFile> tiled_file)
+        : tiled_data(std::move(tiled_file)), xdim(tiled_data->GetXDim()),
+          ydim(tiled_data->GetYDim())
+    {
+    }
+
     RasterGrid(const boost::filesystem::path &filepath, std::size_t _xdim, std::size_t _ydim)
     {
         xdim = _xdim;
@@ -108,11 +172,21 @@ class RasterGrid
     RasterGrid(RasterGrid &&) = default;
     RasterGrid &operator=(RasterGrid &&) = default;
 
-    std::int32_t operator()(std::size_t x, std::size_t y) { return _data[y * xdim + x]; }
-    std::int32_t operator()(std::size_t x, std::size_t y) const { return _data[(y)*xdim + (x)]; }
+    std::size_t GetXDim() const { return xdim; }
+    std::size_t GetYDim() const { return ydim; }
+
+    std::int32_t operator()(std::size_t x, std::size_t y) const
+    {
+        if (tiled_data)
+        {
+            return (*tiled_data)(x, y);
+        }
+        return _data[(y)*xdim + (x)];
+    }
 
   private:
     std::vector<std::int32_t> _data;
+    std::shared_ptr<const TiledRasterFile> tiled_data;
     std::size_t xdim, ydim;
 };
 
@@ -141,6 +215,12 @@ class RasterSource
 
     RasterDatum getRasterInterpolate(const int lon, const int lat) const;
 
+    // interpolates count coordinates at once, equal to count calls of getRasterInterpolate
+    void getRasterInterpolateBatch(const int *lons,
+                                   const int *lats,
+                                   const std::size_t count,
+                                   RasterDatum *results) const;
+
     RasterSource(RasterGrid _raster_data,
                  std::size_t width,
                  std::size_t height,
@@ -167,6 +247,12 @@ class SourceContainer
 
     RasterDatum getRasterInterpolateFromSource(unsigned int source_id, int lon, int lat);
 
+    // batch version for the callers in C++, saves a call into the profile per coordinate
+    void getRasterInterpolateBatchFromSource(unsigned int source_id,
+                                             const std::vector<int> &lons,
+                                             const std::vector<int> &lats,
+                                             std::vector<RasterDatum> &results) const;
+
   private:
     std::vector<RasterSource> LoadedSources;
     std::unordered_map<std::string, int> LoadedSourcePaths;
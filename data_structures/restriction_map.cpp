@@ -27,6 +27,102 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "restriction_map.hpp"
 
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+RestrictionIndex::RestrictionIndex(
+    std::vector<std::pair<RestrictionSource, std::vector<RestrictionTarget>>> restrictions)
+    : m_count(0)
+{
+    std::sort(restrictions.begin(), restrictions.end(),
+              [](const std::pair<RestrictionSource, std::vector<RestrictionTarget>> &lhs,
+                 const std::pair<RestrictionSource, std::vector<RestrictionTarget>> &rhs)
+              {
+                  return std::tie(lhs.first.start_node, lhs.first.via_node) <
+                         std::tie(rhs.first.start_node, rhs.first.via_node);
+              });
+
+    const NodeID number_of_start_nodes =
+        restrictions.empty() ? 0 : restrictions.back().first.start_node + 1;
+    m_source_offsets.resize(number_of_start_nodes + 1, 0);
+    m_via_nodes.reserve(restrictions.size());
+    m_target_offsets.reserve(restrictions.size() + 1);
+    for (const auto &restriction : restrictions)
+    {
+        ++m_source_offsets[restriction.first.start_node + 1];
+        m_via_nodes.push_back(restriction.first.via_node);
+        m_target_offsets.push_back(static_cast<unsigned>(m_targets.size()));
+        m_targets.insert(m_targets.end(), restriction.second.begin(), restriction.second.end());
+    }
+    m_target_offsets.push_back(static_cast<unsigned>(m_targets.size()));
+    std::partial_sum(m_source_offsets.begin(), m_source_offsets.end(), m_source_offsets.begin());
+    m_count = m_targets.size();
+}
+
+RestrictionIndex::TargetRange RestrictionIndex::GetTargets(const NodeID node_u,
+                                                           const NodeID node_v) const
+{
+    if (node_u + 1 >= m_source_offsets.size())
+    {
+        return TargetRange(m_targets.end(), m_targets.end());
+    }
+
+    const auto first_via = m_via_nodes.begin() + m_source_offsets[node_u];
+    const auto last_via = m_via_nodes.begin() + m_source_offsets[node_u + 1];
+    const auto via_iter = std::lower_bound(first_via, last_via, node_v);
+    if (via_iter == last_via || *via_iter != node_v)
+    {
+        return TargetRange(m_targets.end(), m_targets.end());
+    }
+
+    const auto source = via_iter - m_via_nodes.begin();
+    return TargetRange(m_targets.begin() + m_target_offsets[source],
+                       m_targets.begin() + m_target_offsets[source + 1]);
+}
+
+NodeID RestrictionIndex::CheckForEmanatingIsOnlyTurn(const NodeID node_u,
+                                                     const NodeID node_v) const
+{
+    BOOST_ASSERT(node_u != SPECIAL_NODEID);
+    BOOST_ASSERT(node_v != SPECIAL_NODEID);
+
+    const auto targets = GetTargets(node_u, node_v);
+    for (auto target_iter = targets.first; target_iter != targets.second; ++target_iter)
+    {
+        if (target_iter->is_only)
+        {
+            return target_iter->target_node;
+        }
+    }
+    return SPECIAL_NODEID;
+}
+
+bool RestrictionIndex::CheckIfTurnIsRestricted(const NodeID node_u,
+                                               const NodeID node_v,
+                                               const NodeID node_w) const
+{
+    BOOST_ASSERT(node_u != SPECIAL_NODEID);
+    BOOST_ASSERT(node_v != SPECIAL_NODEID);
+    BOOST_ASSERT(node_w != SPECIAL_NODEID);
+
+    const auto targets = GetTargets(node_u, node_v);
+    for (auto target_iter = targets.first; target_iter != targets.second; ++target_iter)
+    {
+        if (node_w == target_iter->target_node && // target found
+            !target_iter->is_only)                // and not an only_-restr.
+        {
+            return true;
+        }
+        if (node_w != target_iter->target_node && // target not found
+            target_iter->is_only)                 // and is an only restriction
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 RestrictionMap::RestrictionMap(const std::vector<TurnRestriction> &restriction_list) : m_count(0)
 {
     // decompose restriction consisting of a start, via and end node into a
@@ -175,3 +271,15 @@ bool RestrictionMap::IsSourceNode(const NodeID node) const
     }
     return true;
 }
+
+RestrictionIndex RestrictionMap::BuildIndex() const
+{
+    std::vector<std::pair<RestrictionSource, std::vector<RestrictionTarget>>> restrictions;
+    restrictions.reserve(m_restriction_map.size());
+    for (const auto &source_and_index : m_restriction_map)
+    {
+        restrictions.emplace_back(source_and_index.first,
+                                  m_restriction_bucket_list[source_and_index.second]);
+    }
+    return RestrictionIndex(std::move(restrictions));
+}
@@ -37,6 +37,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 struct RestrictionSource
@@ -84,6 +85,44 @@ template <> struct hash<RestrictionTarget>
 };
 }
 
+/**
+    \brief Read-only index of the turn restrictions in compressed sparse row layout
+    The sources of the restrictions are grouped by start node, each source owns a
+    contiguous range of targets. Lookups of edges that start no restriction cost a
+    single offset comparison and the index can be shared by concurrent readers.
+*/
+class RestrictionIndex
+{
+  public:
+    RestrictionIndex() : m_count(0) {}
+    explicit RestrictionIndex(
+        std::vector<std::pair<RestrictionSource, std::vector<RestrictionTarget>>> restrictions);
+
+    // Check if edge (u, v) is the start of any turn restriction.
+    // If so returns id of first target node.
+    NodeID CheckForEmanatingIsOnlyTurn(const NodeID node_u, const NodeID node_v) const;
+    // Checks if turn <u,v,w> is actually a turn restriction.
+    bool
+    CheckIfTurnIsRestricted(const NodeID node_u, const NodeID node_v, const NodeID node_w) const;
+
+    std::size_t size() const { return m_count; }
+
+  private:
+    using TargetRange = std::pair<std::vector<RestrictionTarget>::const_iterator,
+                                  std::vector<RestrictionTarget>::const_iterator>;
+    // targets of the restrictions starting with edge (u, v), empty if there are none
+    TargetRange GetTargets(const NodeID node_u, const NodeID node_v) const;
+
+    std::size_t m_count;
+    //! start node -> first source, one sentinel entry at the end
+    std::vector<unsigned> m_source_offsets;
+    //! source -> via node, sorted for each start node
+    std::vector<NodeID> m_via_nodes;
+    //! source -> first target, one sentinel entry at the end
+    std::vector<unsigned> m_target_offsets;
+    std::vector<RestrictionTarget> m_targets;
+};
+
 /**
     \brief Efficent look up if an edge is the start + via node of a TurnRestriction
     EdgeBasedEdgeFactory decides by it if edges are inserted or geometry is compressed
@@ -158,10 +197,14 @@ class RestrictionMap
 
     std::size_t size() const { return m_count; }
 
-  private:
+    // Builds the read-only index of all restrictions, once the fixups are done
+    RestrictionIndex BuildIndex() const;
+
     // check of node is the start of any restriction
     bool IsSourceNode(const NodeID node) const;
 
+  private:
+
     using EmanatingRestrictionsVector = std::vector<RestrictionTarget>;
 
     std::size_t m_count;
@@ -28,6 +28,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/fusion/container/vector.hpp>
 #include <boost/fusion/sequence/intrinsic.hpp>
 #include <boost/fusion/include/at_c.hpp>
+#include <boost/optional.hpp>
 
 #include <osrm/route_parameters.hpp>
 
@@ -36,7 +37,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 RouteParameters::RouteParameters()
     : zoom_level(18), print_instructions(false), alternate_route(true), geometry(true),
       compression(true), deprecatedAPI(false), uturn_default(false), classify(false),
-      matching_beta(5), gps_precision(5), check_sum(-1), num_results(1)
+      lengths(false), hull(false), matching_beta(5), gps_precision(5), improvement_time(0),
+      max_time(0), timeout(0), max_duration(0), check_sum(-1), num_results(1)
 {
 }
 
@@ -92,6 +94,11 @@ void RouteParameters::setMatchingBeta(const double beta) { matching_beta = beta;
 
 void RouteParameters::setGPSPrecision(const double precision) { gps_precision = precision; }
 
+void RouteParameters::setImprovementTime(const unsigned milliseconds)
+{
+    improvement_time = milliseconds;
+}
+
 void RouteParameters::setOutputFormat(const std::string &format) { output_format = format; }
 
 void RouteParameters::setJSONpParameter(const std::string &parameter)
@@ -117,15 +124,51 @@ void RouteParameters::addTimestamp(const unsigned timestamp)
     }
 }
 
+void RouteParameters::addBearing(
+    const boost::fusion::vector<int, boost::optional<int>> &received_bearing)
+{
+    bearings.resize(coordinates.size(), std::make_pair(0, 180));
+    const int bearing = boost::fusion::at_c<0>(received_bearing);
+    // +/- 10 degrees unless a range is given
+    const int range = boost::fusion::at_c<1>(received_bearing).get_value_or(10);
+    if (!bearings.empty() && 0 <= bearing && bearing < 360 && 0 <= range && range <= 180)
+    {
+        bearings.back() = std::make_pair(bearing, range);
+    }
+}
+
 void RouteParameters::setLanguage(const std::string &language_string)
 {
     language = language_string;
 }
 
+void RouteParameters::setProfile(const std::string &profile_string) { profile = profile_string; }
+
+void RouteParameters::setTargetSet(const std::string &target_set_string)
+{
+    target_set = target_set_string;
+}
+
+void RouteParameters::setSession(const std::string &session_string) { session = session_string; }
+
+void RouteParameters::addSource(const unsigned index) { sources.push_back(index); }
+
+void RouteParameters::addDestination(const unsigned index) { destinations.push_back(index); }
+
 void RouteParameters::setGeometryFlag(const bool flag) { geometry = flag; }
 
 void RouteParameters::setCompressionFlag(const bool flag) { compression = flag; }
 
+void RouteParameters::setLengthsFlag(const bool flag) { lengths = flag; }
+
+void RouteParameters::setMaxTime(const unsigned seconds) { max_time = seconds; }
+
+void RouteParameters::setTimeout(const unsigned milliseconds) { timeout = milliseconds; }
+
+void RouteParameters::setMaxDuration(const unsigned seconds) { max_duration = seconds; }
+
+void RouteParameters::setHullFlag(const bool flag) { hull = flag; }
+
 void RouteParameters::addCoordinate(
     const boost::fusion::vector<double, double> &received_coordinates)
 {
@@ -0,0 +1,119 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef RUN_LENGTH_VECTOR_HPP
+#define RUN_LENGTH_VECTOR_HPP
+
+#include "bit_vector.hpp"
+#include "shared_memory_vector_wrapper.hpp"
+
+#include <boost/assert.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Values that repeat along consecutive indices, like the names of the turns off the same edge,
+// stored once per run. A flag marks the first index of every run, the rank of the flags finds
+// the run of an index within one cache line. The layout is the same in shared memory, where
+// osrm-datastore writes the runs with Append() and the flags with BitVector::Write().
+template <typename T, bool UseSharedMemory> class RunLengthVector
+{
+  public:
+    using FlagVectorT = BitVector<UseSharedMemory>;
+
+    // Appends value to the number_of_runs runs written so far, returns whether it starts a run
+    static bool Append(T *run_values, std::size_t &number_of_runs, const T value)
+    {
+        if (0 == number_of_runs || run_values[number_of_runs - 1] != value)
+        {
+            run_values[number_of_runs++] = value;
+            return true;
+        }
+        return false;
+    }
+
+    RunLengthVector() {}
+
+    // internal memory
+    template <typename ContainerT> explicit RunLengthVector(const ContainerT &values)
+    {
+        static_assert(!UseSharedMemory, "run length vectors in shared memory are written "
+                                        "by Append()");
+        std::vector<bool> start_flags(values.size());
+        std::size_t index = 0;
+        for (const T value : values)
+        {
+            if (run_values.empty() || run_values.back() != value)
+            {
+                run_values.push_back(value);
+                start_flags[index] = true;
+            }
+            ++index;
+        }
+        run_values.shrink_to_fit();
+        FlagVectorT flag_vector(start_flags);
+        run_starts.swap(flag_vector);
+    }
+
+    // shared memory, number_of_runs values were written by Append() and the flags of the
+    // number_of_values indices by BitVector::Write()
+    RunLengthVector(T *run_values_ptr,
+                    const std::size_t number_of_runs,
+                    typename FlagVectorT::WordT *run_starts_ptr,
+                    const std::size_t number_of_values)
+        : run_values(run_values_ptr, number_of_runs), run_starts(run_starts_ptr, number_of_values)
+    {
+    }
+
+    void swap(RunLengthVector &other)
+    {
+        run_values.swap(other.run_values);
+        run_starts.swap(other.run_starts);
+    }
+
+    std::size_t size() const { return run_starts.size(); }
+
+    bool empty() const { return run_starts.empty(); }
+
+    std::size_t number_of_runs() const { return run_values.size(); }
+
+    T at(const std::size_t index) const
+    {
+        BOOST_ASSERT(index < size());
+        // the run of an index is the last one that starts at or before it
+        return run_values[run_starts.rank(index + 1) - 1];
+    }
+
+    T operator[](const std::size_t index) const { return at(index); }
+
+  private:
+    typename ShM<T, UseSharedMemory>::vector run_values;
+    FlagVectorT run_starts;
+};
+
+#endif // RUN_LENGTH_VECTOR_HPP
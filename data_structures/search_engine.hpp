@@ -30,8 +30,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "search_engine_data.hpp"
 #include "../routing_algorithms/alternative_path.hpp"
+#include "../routing_algorithms/isochrone.hpp"
 #include "../routing_algorithms/many_to_many.hpp"
 #include "../routing_algorithms/map_matching.hpp"
+#include "../routing_algorithms/online_map_matching.hpp"
+#include "../routing_algorithms/rphast.hpp"
 #include "../routing_algorithms/shortest_path.hpp"
 #include "../routing_algorithms/direct_shortest_path.hpp"
 
@@ -49,6 +52,9 @@ template <class DataFacadeT> class SearchEngine
     AlternativeRouting<DataFacadeT> alternative_path;
     ManyToManyRouting<DataFacadeT> distance_table;
     MapMatching<DataFacadeT> map_matching;
+    OnlineMapMatching<DataFacadeT> online_map_matching;
+    RPHASTRouting<DataFacadeT> rphast;
+    IsochroneRouting<DataFacadeT> isochrone;
 
     explicit SearchEngine(DataFacadeT *facade)
         : facade(facade),
@@ -56,7 +62,9 @@ template <class DataFacadeT> class SearchEngine
           direct_shortest_path(facade, engine_working_data),
           alternative_path(facade, engine_working_data),
           distance_table(facade, engine_working_data),
-          map_matching(facade, engine_working_data)
+          map_matching(facade, engine_working_data),
+          online_map_matching(facade, engine_working_data), rphast(facade, engine_working_data),
+          isochrone(facade, engine_working_data)
     {
         static_assert(!std::is_pointer<DataFacadeT>::value, "don't instantiate with ptr type");
         static_assert(std::is_object<DataFacadeT>::value,
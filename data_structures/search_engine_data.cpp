@@ -29,65 +29,132 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "binary_heap.hpp"
 
-void SearchEngineData::InitializeOrClearFirstThreadLocalStorage(const unsigned number_of_nodes)
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+bool SearchEngineData::use_array_storage = false;
+bool SearchEngineData::parallel_bidirectional_search = false;
+bool SearchEngineData::parallel_leg_search = false;
+bool SearchEngineData::approximate_alternatives = false;
+bool SearchEngineData::prefetch_search_graph = false;
+
+// As many idle heaps as all threads could hold at once. Heaps that a huge query made grow
+// beyond a million nodes are freed instead, as are heaps that are not used for a minute.
+SearchEngineData::QueryHeapPool
+    SearchEngineData::heap_pool(6 * std::max(1u, std::thread::hardware_concurrency()),
+                                1u << 20,
+                                std::chrono::minutes(1));
+
+namespace
+{
+unsigned &HeapScopeDepth()
+{
+    static thread_local unsigned depth = 0;
+    return depth;
+}
+
+// the insertions of the heaps the thread has handed back, less those they had when taken
+std::uint64_t &InsertionsOfReturnedHeaps()
+{
+    static thread_local std::uint64_t insertions = 0;
+    return insertions;
+}
+
+SearchEngineData::SearchEngineHeapPtr *const thread_heaps[] = {
+    &SearchEngineData::forward_heap_1, &SearchEngineData::reverse_heap_1,
+    &SearchEngineData::forward_heap_2, &SearchEngineData::reverse_heap_2,
+    &SearchEngineData::forward_heap_3, &SearchEngineData::reverse_heap_3};
+
+void ReturnHeap(SearchEngineData::SearchEngineHeapPtr &heap)
 {
-    if (forward_heap_1.get())
+    if (heap.get())
     {
-        forward_heap_1->Clear();
+        InsertionsOfReturnedHeaps() += heap->NumberOfInsertions();
+        SearchEngineData::heap_pool.Checkin(
+            std::unique_ptr<SearchEngineData::QueryHeap>(heap.release()));
     }
-    else
+}
+
+// heaps outlive dataset reloads, a dense heap is rebuilt once the graph outgrows it
+void InitializeOrClearHeap(SearchEngineData::SearchEngineHeapPtr &heap,
+                           const unsigned number_of_nodes)
+{
+    if (!heap.get())
     {
-        forward_heap_1.reset(new QueryHeap(number_of_nodes));
+        if (auto pooled_heap = SearchEngineData::heap_pool.Checkout())
+        {
+            InsertionsOfReturnedHeaps() -= pooled_heap->NumberOfInsertions();
+            heap.reset(pooled_heap.release());
+        }
     }
-
-    if (reverse_heap_1.get())
+    if (heap.get() && heap->GetIndexStorage().CanIndex(number_of_nodes) &&
+        heap->GetIndexStorage().UsesArray() == SearchEngineData::use_array_storage)
     {
-        reverse_heap_1->Clear();
+        heap->Clear();
     }
     else
     {
-        reverse_heap_1.reset(new QueryHeap(number_of_nodes));
+        if (heap.get())
+        {
+            InsertionsOfReturnedHeaps() += heap->NumberOfInsertions();
+        }
+        heap.reset(new SearchEngineData::QueryHeap(number_of_nodes,
+                                                   SearchEngineData::use_array_storage));
     }
 }
+}
 
-void SearchEngineData::InitializeOrClearSecondThreadLocalStorage(const unsigned number_of_nodes)
+SearchEngineData::HeapScope::HeapScope() { ++HeapScopeDepth(); }
+
+SearchEngineData::HeapScope::~HeapScope()
 {
-    if (forward_heap_2.get())
-    {
-        forward_heap_2->Clear();
-    }
-    else
+    if (0 == --HeapScopeDepth())
     {
-        forward_heap_2.reset(new QueryHeap(number_of_nodes));
+        for (const auto heap : thread_heaps)
+        {
+            ReturnHeap(*heap);
+        }
     }
+}
 
-    if (reverse_heap_2.get())
-    {
-        reverse_heap_2->Clear();
-    }
-    else
-    {
-        reverse_heap_2.reset(new QueryHeap(number_of_nodes));
-    }
+void SearchEngineData::InitializeOrClearFirstThreadLocalStorage(const unsigned number_of_nodes)
+{
+    InitializeOrClearHeap(forward_heap_1, number_of_nodes);
+    InitializeOrClearHeap(reverse_heap_1, number_of_nodes);
+}
+
+void SearchEngineData::InitializeOrClearSecondThreadLocalStorage(const unsigned number_of_nodes)
+{
+    InitializeOrClearHeap(forward_heap_2, number_of_nodes);
+    InitializeOrClearHeap(reverse_heap_2, number_of_nodes);
 }
 
 void SearchEngineData::InitializeOrClearThirdThreadLocalStorage(const unsigned number_of_nodes)
 {
-    if (forward_heap_3.get())
-    {
-        forward_heap_3->Clear();
-    }
-    else
-    {
-        forward_heap_3.reset(new QueryHeap(number_of_nodes));
-    }
+    InitializeOrClearHeap(forward_heap_3, number_of_nodes);
+    InitializeOrClearHeap(reverse_heap_3, number_of_nodes);
+}
 
-    if (reverse_heap_3.get())
+SearchEngineData::UnpackingData &SearchEngineData::GetUnpackingThreadLocalStorage()
+{
+    if (!unpacking_data.get())
     {
-        reverse_heap_3->Clear();
+        unpacking_data.reset(new UnpackingData());
     }
-    else
+    return *unpacking_data;
+}
+
+std::uint64_t SearchEngineData::GetHeapInsertionsOfThisThread()
+{
+    std::uint64_t insertions = InsertionsOfReturnedHeaps();
+    for (const auto heap : thread_heaps)
     {
-        reverse_heap_3.reset(new QueryHeap(number_of_nodes));
+        if (heap->get())
+        {
+            insertions += (*heap)->NumberOfInsertions();
+        }
     }
+    return insertions;
 }
@@ -32,17 +32,75 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../typedefs.h"
 #include "binary_heap.hpp"
+#include "d_ary_heap.hpp"
+#include "heap_pool.hpp"
+#include "shortcut_cache.hpp"
+#include "xor_fast_hash_storage.hpp"
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Children per node of the query heaps, set by the QUERY_HEAP_ARITY cmake option. Wider heaps
+// are shallower, benchmarks/query_heap.cpp compares them on the searches of a real graph.
+#ifndef OSRM_QUERY_HEAP_ARITY
+#define OSRM_QUERY_HEAP_ARITY 2
+#endif
+
+// Heaps that are not indexed densely use std::unordered_map, or the open addressing table of
+// xor_fast_hash_storage.hpp if the QUERY_HEAP_OPEN_ADDRESSING cmake option is set.
+#ifdef OSRM_QUERY_HEAP_OPEN_ADDRESSING
+template <typename NodeID, typename Key>
+using QueryHeapHashStorage = XORFastHashStorage<NodeID, Key, 12>;
+#else
+template <typename NodeID, typename Key>
+using QueryHeapHashStorage = UnorderedMapStorage<NodeID, Key>;
+#endif
 
 struct HeapData
 {
     NodeID parent;
-    /* explicit */ HeapData(NodeID p) : parent(p) {}
+    // set by the stall-on-demand of the searches, see routing_algorithms/stalling.hpp
+    bool stalled;
+    // decimeters along the path from the root, only kept by the tables that compute lengths
+    int length;
+    /* explicit */ HeapData(NodeID p) : parent(p), stalled(false), length(0) {}
 };
 
 struct SearchEngineData
 {
-    using QueryHeap = BinaryHeap<NodeID, NodeID, int, HeapData, UnorderedMapStorage<NodeID, int>>;
+    using QueryHeapStorage = SelectableStorage<NodeID, int, QueryHeapHashStorage<NodeID, int>>;
+    using QueryHeap = typename std::conditional<
+        2 == OSRM_QUERY_HEAP_ARITY,
+        BinaryHeap<NodeID, NodeID, int, HeapData, QueryHeapStorage>,
+        DAryHeap<NodeID, NodeID, int, HeapData, QueryHeapStorage, OSRM_QUERY_HEAP_ARITY>>::type;
     using SearchEngineHeapPtr = boost::thread_specific_ptr<QueryHeap>;
+    using QueryHeapPool = HeapPool<QueryHeap>;
+
+    // Hands the query heaps of the calling thread back to the pool when the outermost scope of
+    // the thread ends. The queries and the tasks of their parallel sections open a scope, so
+    // that the threads share the heaps. Threads that never open a scope keep their heaps.
+    class HeapScope
+    {
+      public:
+        HeapScope();
+        HeapScope(const HeapScope &) = delete;
+        ~HeapScope();
+    };
+
+    // Scratch space of the path retrieval and unpacking. It lives as long as its thread and is
+    // only ever cleared, so that the buffers keep their capacity from one query to the next.
+    struct UnpackingData
+    {
+        std::vector<std::pair<NodeID, NodeID>> recursion_stack;
+        std::vector<ShortcutCache::UnpackedEdge> unpacked_edges;
+        std::vector<NodeID> packed_leg1;
+        std::vector<NodeID> packed_leg2;
+        std::vector<std::vector<NodeID>> packed_legs1;
+        std::vector<std::vector<NodeID>> packed_legs2;
+    };
+    using UnpackingDataPtr = boost::thread_specific_ptr<UnpackingData>;
 
     static SearchEngineHeapPtr forward_heap_1;
     static SearchEngineHeapPtr reverse_heap_1;
@@ -50,12 +108,32 @@ struct SearchEngineData
     static SearchEngineHeapPtr reverse_heap_2;
     static SearchEngineHeapPtr forward_heap_3;
     static SearchEngineHeapPtr reverse_heap_3;
+    static UnpackingDataPtr unpacking_data;
+    // idle heaps of all threads, the heaps of a thread are cleared or taken from here
+    static QueryHeapPool heap_pool;
+
+    // index the query heaps by an array of the graph size instead of a hash map, set at startup
+    static bool use_array_storage;
+    // run both directions of the point to point searches on their own thread, set at startup
+    static bool parallel_bidirectional_search;
+    // search the legs of a route on worker threads, set at startup
+    static bool parallel_leg_search;
+    // pick alternative routes from the first search only, without verifying searches
+    static bool approximate_alternatives;
+    // prefetch heap slots and adjacent edges ahead of their use in the searches, set at startup
+    static bool prefetch_search_graph;
 
     void InitializeOrClearFirstThreadLocalStorage(const unsigned number_of_nodes);
 
     void InitializeOrClearSecondThreadLocalStorage(const unsigned number_of_nodes);
 
     void InitializeOrClearThirdThreadLocalStorage(const unsigned number_of_nodes);
+
+    // buffers are handed out as they were left, users clear what they use
+    static UnpackingData &GetUnpackingThreadLocalStorage();
+
+    // nodes inserted into the query heaps of the calling thread so far
+    static std::uint64_t GetHeapInsertionsOfThisThread();
 };
 
 #endif // SEARCH_ENGINE_DATA_HPP
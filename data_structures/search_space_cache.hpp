@@ -0,0 +1,167 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef SEARCH_SPACE_CACHE_HPP
+#define SEARCH_SPACE_CACHE_HPP
+
+#include "lru_cache.hpp"
+#include "phantom_node.hpp"
+#include "../typedefs.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// The nodes settled by a search with their distances, sorted by node
+struct SearchSpace
+{
+    std::vector<NodeID> nodes;
+    std::vector<EdgeWeight> distances;
+};
+
+// Caches the forward and backward search spaces of phantom nodes, so that distance tables of
+// recurring locations, e.g. the stops of a trip that is planned again with a few changes, only
+// search from the new ones. The spaces of a pair of locations are joined to their distance.
+// Like the PhantomNodeCache the cache is split into independently locked shards.
+class SearchSpaceCache
+{
+  public:
+    struct Entry
+    {
+        PhantomNode phantom_node;
+        unsigned check_sum;
+        SearchSpace forward_search_space;
+        SearchSpace backward_search_space;
+    };
+    using EntryPointer = std::shared_ptr<const Entry>;
+
+  private:
+    struct Shard
+    {
+        explicit Shard(const unsigned capacity) : entries(capacity) {}
+
+        std::mutex mutex;
+        LRUCache<std::uint64_t, EntryPointer> entries;
+    };
+
+  public:
+    // capacity is the total number of cached phantom nodes
+    explicit SearchSpaceCache(const unsigned capacity, const unsigned number_of_shards = 16)
+    {
+        const unsigned shard_count = std::max(1u, number_of_shards);
+        const unsigned shard_capacity = std::max(1u, capacity / shard_count);
+        for (unsigned i = 0; i < shard_count; ++i)
+        {
+            shards.emplace_back(new Shard(shard_capacity));
+        }
+    }
+
+    // the search spaces of the phantom node on the data with the given checksum
+    bool Fetch(const PhantomNode &phantom_node, const unsigned check_sum, EntryPointer &entry)
+    {
+        const std::uint64_t key = GetKey(phantom_node, check_sum);
+        EntryPointer cached_entry;
+        {
+            Shard &shard = GetShard(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.entries.Fetch(key, cached_entry))
+            {
+                return false;
+            }
+        }
+        // the key is a hash, the distances only depend on the entry points of the searches
+        if (cached_entry->check_sum != check_sum ||
+            !HasSameEntryPoints(cached_entry->phantom_node, phantom_node))
+        {
+            return false;
+        }
+        entry = std::move(cached_entry);
+        return true;
+    }
+
+    void Insert(EntryPointer entry)
+    {
+        const std::uint64_t key = GetKey(entry->phantom_node, entry->check_sum);
+        Shard &shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.Insert(key, std::move(entry));
+    }
+
+    void Clear()
+    {
+        for (auto &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->entries.Clear();
+        }
+    }
+
+    std::size_t Size() const
+    {
+        std::size_t size = 0;
+        for (const auto &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            size += shard->entries.Size();
+        }
+        return size;
+    }
+
+  private:
+    static bool HasSameEntryPoints(const PhantomNode &lhs, const PhantomNode &rhs)
+    {
+        return lhs.forward_node_id == rhs.forward_node_id &&
+               lhs.reverse_node_id == rhs.reverse_node_id &&
+               lhs.GetForwardWeightPlusOffset() == rhs.GetForwardWeightPlusOffset() &&
+               lhs.GetReverseWeightPlusOffset() == rhs.GetReverseWeightPlusOffset();
+    }
+
+    static std::uint64_t GetKey(const PhantomNode &phantom_node, const unsigned check_sum)
+    {
+        const std::uint64_t nodes =
+            (static_cast<std::uint64_t>(phantom_node.forward_node_id) << 32) |
+            phantom_node.reverse_node_id;
+        const std::uint64_t weights =
+            (static_cast<std::uint64_t>(
+                 static_cast<std::uint32_t>(phantom_node.GetForwardWeightPlusOffset()))
+             << 32) |
+            static_cast<std::uint32_t>(phantom_node.GetReverseWeightPlusOffset());
+        return nodes ^ (weights * 0x9e3779b97f4a7c15ull) ^ check_sum;
+    }
+
+    Shard &GetShard(const std::uint64_t key)
+    {
+        return *shards[std::hash<std::uint64_t>()(key ^ (key >> 32)) % shards.size()];
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+#endif // SEARCH_SPACE_CACHE_HPP
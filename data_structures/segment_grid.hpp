@@ -0,0 +1,263 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef SEGMENT_GRID_HPP
+#define SEGMENT_GRID_HPP
+
+#include "query_node.hpp"
+#include "shared_memory_vector_wrapper.hpp"
+
+#include "../util/osrm_exception.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
+
+#include <osrm/coordinate.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <tbb/parallel_sort.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Flat index of the segments of a StaticRTree in a uniform grid of CELL_SIZE fixed point units.
+// Only non-empty cells are stored, sorted by cell id, each followed by the segments whose
+// bounding box overlaps it. A radius query of a few metres, as issued by /match, reads the
+// segments of a handful of contiguous cells instead of walking the tree.
+template <class EdgeDataT, bool UseSharedMemory = false> class SegmentGrid
+{
+  public:
+    // 0.001 degrees, about 110m of latitude
+    static constexpr int32_t CELL_SIZE = 1000;
+    // larger queries are left to the r-tree
+    static constexpr uint32_t MAX_CELLS_PER_AXIS = 3;
+
+    // the grid file starts with the header, followed by the arrays of the same names
+    struct GridHeader
+    {
+        uint32_t cell_size;
+        uint32_t segment_bytes;
+        uint64_t number_of_cells;
+        uint64_t number_of_segments;
+    };
+
+    SegmentGrid() = default;
+
+    // Writes the grid of the segments to a file
+    static void Build(const std::vector<EdgeDataT> &input_data_vector,
+                      const std::vector<QueryNode> &coordinate_list,
+                      const std::string &grid_filename)
+    {
+        TIMER_START(construction);
+
+        // one entry for every cell a segment overlaps
+        std::vector<std::pair<uint64_t, uint32_t>> cell_entries;
+        cell_entries.reserve(input_data_vector.size());
+        for (uint32_t i = 0; i < input_data_vector.size(); ++i)
+        {
+            const QueryNode &u = coordinate_list[input_data_vector[i].u];
+            const QueryNode &v = coordinate_list[input_data_vector[i].v];
+            const uint32_t min_x = GetCellX(std::min(u.lon, v.lon));
+            const uint32_t max_x = GetCellX(std::max(u.lon, v.lon));
+            const uint32_t min_y = GetCellY(std::min(u.lat, v.lat));
+            const uint32_t max_y = GetCellY(std::max(u.lat, v.lat));
+            for (uint32_t y = min_y; y <= max_y; ++y)
+            {
+                for (uint32_t x = min_x; x <= max_x; ++x)
+                {
+                    cell_entries.emplace_back(GetCellID(x, y), i);
+                }
+            }
+        }
+        tbb::parallel_sort(cell_entries.begin(), cell_entries.end());
+
+        std::vector<uint64_t> cell_ids;
+        std::vector<uint32_t> cell_offsets;
+        for (uint32_t i = 0; i < cell_entries.size(); ++i)
+        {
+            if (cell_ids.empty() || cell_ids.back() != cell_entries[i].first)
+            {
+                cell_ids.push_back(cell_entries[i].first);
+                cell_offsets.push_back(i);
+            }
+        }
+        cell_offsets.push_back(cell_entries.size());
+
+        GridHeader header;
+        header.cell_size = CELL_SIZE;
+        header.segment_bytes = sizeof(EdgeDataT);
+        header.number_of_cells = cell_ids.size();
+        header.number_of_segments = cell_entries.size();
+
+        boost::filesystem::ofstream grid_file(grid_filename, std::ios::binary);
+        grid_file.write((char *)&header, sizeof(GridHeader));
+        grid_file.write((char *)cell_ids.data(), sizeof(uint64_t) * cell_ids.size());
+        grid_file.write((char *)cell_offsets.data(), sizeof(uint32_t) * cell_offsets.size());
+        std::vector<EdgeDataT> cell_segments;
+        cell_segments.reserve(cell_entries.size());
+        for (const auto &entry : cell_entries)
+        {
+            cell_segments.push_back(input_data_vector[entry.second]);
+        }
+        grid_file.write((char *)cell_segments.data(), sizeof(EdgeDataT) * cell_segments.size());
+        grid_file.close();
+
+        TIMER_STOP(construction);
+        SimpleLogger().Write() << "finished segment grid of " << cell_ids.size() << " cells and "
+                               << cell_entries.size() << " entries in " << TIMER_SEC(construction)
+                               << " seconds";
+    }
+
+    // throws if the file was written for another cell or segment size
+    static GridHeader ReadHeader(boost::filesystem::ifstream &grid_file)
+    {
+        GridHeader header;
+        grid_file.read((char *)&header, sizeof(GridHeader));
+        if (!grid_file || header.cell_size != CELL_SIZE ||
+            header.segment_bytes != sizeof(EdgeDataT))
+        {
+            throw osrm::exception("segment grid file was built with a different layout");
+        }
+        return header;
+    }
+
+    explicit SegmentGrid(const boost::filesystem::path &grid_filename)
+    {
+        boost::filesystem::ifstream grid_file(grid_filename, std::ios::binary);
+        const GridHeader header = ReadHeader(grid_file);
+        cell_ids.resize(header.number_of_cells);
+        cell_offsets.resize(header.number_of_cells + 1);
+        cell_segments.resize(header.number_of_segments);
+        grid_file.read((char *)cell_ids.data(), sizeof(uint64_t) * cell_ids.size());
+        grid_file.read((char *)cell_offsets.data(), sizeof(uint32_t) * cell_offsets.size());
+        grid_file.read((char *)cell_segments.data(), sizeof(EdgeDataT) * cell_segments.size());
+        if (!grid_file)
+        {
+            throw osrm::exception("segment grid file is truncated");
+        }
+    }
+
+    SegmentGrid(uint64_t *cell_ids_ptr,
+                uint32_t *cell_offsets_ptr,
+                EdgeDataT *cell_segments_ptr,
+                const uint64_t number_of_cells,
+                const uint64_t number_of_segments)
+    {
+        typename ShM<uint64_t, UseSharedMemory>::vector ids(cell_ids_ptr, number_of_cells);
+        typename ShM<uint32_t, UseSharedMemory>::vector offsets(cell_offsets_ptr,
+                                                                number_of_cells + 1);
+        typename ShM<EdgeDataT, UseSharedMemory>::vector segments(cell_segments_ptr,
+                                                                  number_of_segments);
+        cell_ids.swap(ids);
+        cell_offsets.swap(offsets);
+        cell_segments.swap(segments);
+    }
+
+    // Calls callback once for every segment whose bounding box overlaps the box, given in fixed
+    // point coordinates.
+    template <class CoordinateListT, class CallbackT>
+    void ForEachSegmentInBox(const CoordinateListT &coordinate_list,
+                             const int min_lat,
+                             const int max_lat,
+                             const int min_lon,
+                             const int max_lon,
+                             CallbackT &&callback) const
+    {
+        const uint32_t min_x = GetCellX(min_lon);
+        const uint32_t max_x = GetCellX(max_lon);
+        const uint32_t min_y = GetCellY(min_lat);
+        const uint32_t max_y = GetCellY(max_lat);
+        if (cell_ids.empty())
+        {
+            return;
+        }
+        const uint64_t *ids_begin = &cell_ids[0];
+        const uint64_t *ids_end = ids_begin + cell_ids.size();
+        for (uint32_t y = min_y; y <= max_y; ++y)
+        {
+            for (uint32_t x = min_x; x <= max_x; ++x)
+            {
+                const uint64_t *cell = std::lower_bound(ids_begin, ids_end, GetCellID(x, y));
+                if (cell == ids_end || *cell != GetCellID(x, y))
+                {
+                    continue;
+                }
+                const std::size_t cell_index = cell - ids_begin;
+                for (uint32_t i = cell_offsets[cell_index]; i < cell_offsets[cell_index + 1]; ++i)
+                {
+                    const EdgeDataT &segment = cell_segments[i];
+                    const FixedPointCoordinate &u = coordinate_list[segment.u];
+                    const FixedPointCoordinate &v = coordinate_list[segment.v];
+                    // a segment is stored in every cell it overlaps, report it in the first
+                    // one that overlaps the box as well
+                    if (x != std::max(min_x, GetCellX(std::min(u.lon, v.lon))) ||
+                        y != std::max(min_y, GetCellY(std::min(u.lat, v.lat))))
+                    {
+                        continue;
+                    }
+                    callback(segment);
+                }
+            }
+        }
+    }
+
+    // true if a box of the given extent spans at most MAX_CELLS_PER_AXIS cells per axis
+    static bool CoversExtent(const int lat_extent, const int lon_extent)
+    {
+        const int max_extent = (MAX_CELLS_PER_AXIS - 1) * CELL_SIZE;
+        return lat_extent < max_extent && lon_extent < max_extent;
+    }
+
+  private:
+    static uint32_t GetCellX(const int lon)
+    {
+        const int max_lon = 180 * static_cast<int>(COORDINATE_PRECISION);
+        return static_cast<uint32_t>(std::max(0, std::min(lon, max_lon) + max_lon) / CELL_SIZE);
+    }
+
+    static uint32_t GetCellY(const int lat)
+    {
+        const int max_lat = 90 * static_cast<int>(COORDINATE_PRECISION);
+        return static_cast<uint32_t>(std::max(0, std::min(lat, max_lat) + max_lat) / CELL_SIZE);
+    }
+
+    static uint64_t GetCellID(const uint32_t x, const uint32_t y)
+    {
+        return (static_cast<uint64_t>(y) << 32) | x;
+    }
+
+    typename ShM<uint64_t, UseSharedMemory>::vector cell_ids;
+    typename ShM<uint32_t, UseSharedMemory>::vector cell_offsets;
+    typename ShM<EdgeDataT, UseSharedMemory>::vector cell_segments;
+};
+
+#endif // SEGMENT_GRID_HPP
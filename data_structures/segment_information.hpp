@@ -34,20 +34,24 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../typedefs.h"
 
 #include <osrm/coordinate.hpp>
+
+#include <cstdint>
 #include <utility>
 
-// Struct fits everything in one cache line
+// One per coordinate of a route, the flags share a byte so that a segment takes 24 bytes. The
+// length and duration of a coordinate are summed up into the segment that starts an instruction.
 struct SegmentInformation
 {
     FixedPointCoordinate location;
     NodeID name_id;
     EdgeWeight duration;
     float length;
-    short bearing; // more than enough [0..3600] fits into 12 bits
     TurnInstruction turn_instruction;
     TravelMode travel_mode;
-    bool necessary;
-    bool is_via_location;
+    bool necessary : 1;
+    bool is_via_location : 1;
+    // lowest zoom level that shows the segment, 0 if it was not precomputed
+    std::uint8_t zoom_level;
 
     explicit SegmentInformation(FixedPointCoordinate location,
                                 const NodeID name_id,
@@ -58,8 +62,8 @@ struct SegmentInformation
                                 const bool is_via_location,
                                 const TravelMode travel_mode)
         : location(std::move(location)), name_id(name_id), duration(duration), length(length),
-          bearing(0), turn_instruction(turn_instruction), travel_mode(travel_mode),
-          necessary(necessary), is_via_location(is_via_location)
+          turn_instruction(turn_instruction), travel_mode(travel_mode),
+          necessary(necessary), is_via_location(is_via_location), zoom_level(0)
     {
     }
 
@@ -68,12 +72,19 @@ struct SegmentInformation
                                 const EdgeWeight duration,
                                 const float length,
                                 const TurnInstruction turn_instruction,
-                                const TravelMode travel_mode)
+                                const TravelMode travel_mode,
+                                const std::uint8_t zoom_level = 0)
         : location(std::move(location)), name_id(name_id), duration(duration), length(length),
-          bearing(0), turn_instruction(turn_instruction), travel_mode(travel_mode),
-          necessary(turn_instruction != TurnInstruction::NoTurn), is_via_location(false)
+          turn_instruction(turn_instruction), travel_mode(travel_mode),
+          necessary(turn_instruction != TurnInstruction::NoTurn), is_via_location(false),
+          zoom_level(zoom_level)
     {
     }
 };
 
+#ifndef _WIN32
+static_assert(sizeof(SegmentInformation) == 24,
+              "changing SegmentInformation has influence on the memory of every route");
+#endif
+
 #endif /* SEGMENT_INFORMATION_HPP */
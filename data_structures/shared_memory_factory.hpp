@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../util/osrm_exception.hpp"
 #include "../util/simple_logger.hpp"
 
+#include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/interprocess/mapped_region.hpp>
@@ -41,15 +42,25 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 #ifdef __linux__
+#include <linux/mempolicy.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SHM_HUGE_SHIFT
+#define SHM_HUGE_SHIFT 26
+#endif
 #endif
 
-// #include <cstring>
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
 
 #include <algorithm>
 #include <exception>
+#include <string>
+#include <vector>
 
 struct OSRMLockFile
 {
@@ -61,6 +72,16 @@ struct OSRMLockFile
     }
 };
 
+// Placement of the pages of a writeable region. Only honored on Linux, other platforms
+// silently use regular pages.
+struct SharedMemoryPlacement
+{
+    // size of the huge pages backing the region in bytes, 0 for regular pages
+    uint64_t huge_page_size = 0;
+    // spread the pages of the region round-robin over all NUMA nodes
+    bool interleave_numa_nodes = false;
+};
+
 #ifndef WIN32
 class SharedMemory
 {
@@ -105,7 +126,8 @@ class SharedMemory
                  const IdentifierT id,
                  const uint64_t size = 0,
                  bool read_write = false,
-                 bool remove_prev = true)
+                 bool remove_prev = true,
+                 const SharedMemoryPlacement &placement = SharedMemoryPlacement())
         : key(lock_file.string().c_str(), id)
     {
         if (0 == size)
@@ -123,8 +145,22 @@ class SharedMemory
             {
                 Remove(key);
             }
-            shm = boost::interprocess::xsi_shared_memory(boost::interprocess::open_or_create, key,
-                                                         size);
+            bool created = false;
+#ifdef __linux__
+            if (0 != placement.huge_page_size)
+            {
+                created = CreateHugePageSegment(key, size, placement.huge_page_size);
+            }
+#endif
+            if (created)
+            {
+                shm = boost::interprocess::xsi_shared_memory(boost::interprocess::open_only, key);
+            }
+            else
+            {
+                shm = boost::interprocess::xsi_shared_memory(boost::interprocess::open_or_create,
+                                                             key, size);
+            }
 #ifdef __linux__
             if (-1 == shmctl(shm.get_shmid(), SHM_LOCK, nullptr))
             {
@@ -135,6 +171,12 @@ class SharedMemory
             }
 #endif
             region = boost::interprocess::mapped_region(shm, boost::interprocess::read_write);
+#ifdef __linux__
+            if (placement.interleave_numa_nodes)
+            {
+                InterleaveNumaNodes(region.get_address(), region.get_size());
+            }
+#endif
 
             remover.SetID(shm.get_shmid());
             SimpleLogger().Write(logDEBUG) << "writeable memory allocated " << size << " bytes";
@@ -165,6 +207,74 @@ class SharedMemory
     }
 
   private:
+#ifdef __linux__
+    // Creates the segment with SHM_HUGETLB so that random accesses into tens of GB of graph
+    // data don't thrash the TLB. Returns false if the kernel has no huge pages to spare or
+    // we lack the permission to use them, the caller falls back to regular pages then.
+    static bool CreateHugePageSegment(const boost::interprocess::xsi_key &key,
+                                      const uint64_t size,
+                                      const uint64_t page_size)
+    {
+        BOOST_ASSERT(0 == (page_size & (page_size - 1)));
+        int page_size_log2 = 0;
+        while ((uint64_t(1) << page_size_log2) < page_size)
+        {
+            ++page_size_log2;
+        }
+        // hugetlb segments must be a multiple of the page size
+        const uint64_t rounded_size = (size + page_size - 1) / page_size * page_size;
+        const int flags = IPC_CREAT | 0644 | SHM_HUGETLB | (page_size_log2 << SHM_HUGE_SHIFT);
+        if (-1 == shmget(key.get_key(), rounded_size, flags))
+        {
+            SimpleLogger().Write(logWARNING) << "could not allocate " << rounded_size
+                                             << " bytes of huge pages: " << std::strerror(errno)
+                                             << ", falling back to regular pages";
+            return false;
+        }
+        SimpleLogger().Write(logDEBUG) << "huge page backed memory allocated " << rounded_size
+                                       << " bytes";
+        return true;
+    }
+
+    // Sets an interleave policy on the segment itself, so the pages are spread over all
+    // nodes no matter which process faults them in. Pages already faulted in (e.g. by
+    // mlockall) are migrated.
+    static void InterleaveNumaNodes(void *address, const uint64_t size)
+    {
+        std::vector<unsigned long> node_mask;
+        const std::size_t bits_per_word = 8 * sizeof(unsigned long);
+        unsigned number_of_nodes = 0;
+        boost::system::error_code error;
+        for (boost::filesystem::directory_iterator entry("/sys/devices/system/node", error), end;
+             !error && entry != end; ++entry)
+        {
+            const std::string name = entry->path().filename().string();
+            if (name.size() <= 4 || 0 != name.compare(0, 4, "node") ||
+                std::string::npos != name.find_first_not_of("0123456789", 4))
+            {
+                continue;
+            }
+            const unsigned long node = std::stoul(name.substr(4));
+            node_mask.resize(std::max(node_mask.size(), node / bits_per_word + 1), 0);
+            node_mask[node / bits_per_word] |= 1UL << (node % bits_per_word);
+            ++number_of_nodes;
+        }
+        if (number_of_nodes < 2)
+        {
+            SimpleLogger().Write(logDEBUG) << "single NUMA node, not interleaving";
+            return;
+        }
+        // the kernel treats maxnode as one past the highest bit it looks at
+        if (-1 == syscall(SYS_mbind, address, size, MPOL_INTERLEAVE, node_mask.data(),
+                          node_mask.size() * bits_per_word + 1, MPOL_MF_MOVE))
+        {
+            SimpleLogger().Write(logWARNING) << "could not interleave shared memory over "
+                                             << number_of_nodes
+                                             << " NUMA nodes: " << std::strerror(errno);
+        }
+    }
+#endif
+
     static bool RegionExists(const boost::interprocess::xsi_key &key)
     {
         bool result = true;
@@ -245,7 +355,8 @@ class SharedMemory
                  const int id,
                  const uint64_t size = 0,
                  bool read_write = false,
-                 bool remove_prev = true)
+                 bool remove_prev = true,
+                 const SharedMemoryPlacement & = SharedMemoryPlacement())
     {
         sprintf(key, "%s.%d", "osrm.lock", id);
         if (0 == size)
@@ -346,7 +457,8 @@ template <class LockFileT = OSRMLockFile> class SharedMemoryFactory_tmpl
     static SharedMemory *Get(const IdentifierT &id,
                              const uint64_t size = 0,
                              bool read_write = false,
-                             bool remove_prev = true)
+                             bool remove_prev = true,
+                             const SharedMemoryPlacement &placement = SharedMemoryPlacement())
     {
         try
         {
@@ -363,7 +475,7 @@ template <class LockFileT = OSRMLockFile> class SharedMemoryFactory_tmpl
                     ofs.close();
                 }
             }
-            return new SharedMemory(lock_file(), id, size, read_write, remove_prev);
+            return new SharedMemory(lock_file(), id, size, read_write, remove_prev, placement);
         }
         catch (const boost::interprocess::interprocess_exception &e)
         {
@@ -85,6 +85,8 @@ template <typename DataT> class SharedMemoryWrapper
 
     const DataT &at(const std::size_t index) const { return m_ptr[index]; }
 
+    const DataT *data() const { return m_ptr; }
+
     ShMemIterator<DataT> begin() const { return ShMemIterator<DataT>(m_ptr); }
 
     ShMemIterator<DataT> end() const { return ShMemIterator<DataT>(m_ptr + m_size); }
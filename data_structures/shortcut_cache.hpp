@@ -0,0 +1,145 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef SHORTCUT_CACHE_HPP
+#define SHORTCUT_CACHE_HPP
+
+#include "lru_cache.hpp"
+
+#include "../typedefs.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Caches the original edges that shortcuts of the packed paths unpack to. Long routes share
+// most of their top level shortcuts, with the cache their unpacking is a copy of the edge list
+// instead of a walk down the hierarchy. Like the PhantomNodeCache it is split into
+// independently locked LRU shards and belongs to a single facade.
+class ShortcutCache
+{
+  public:
+    // an original edge of the search graph and the node it leaves
+    struct UnpackedEdge
+    {
+        NodeID from;
+        EdgeID edge;
+    };
+
+  private:
+    using EntryPointer = std::shared_ptr<const std::vector<UnpackedEdge>>;
+
+    struct Shard
+    {
+        explicit Shard(const unsigned capacity) : entries(capacity) {}
+
+        std::mutex mutex;
+        LRUCache<std::uint64_t, EntryPointer> entries;
+    };
+
+  public:
+    // capacity is the total number of cached shortcuts
+    explicit ShortcutCache(const unsigned capacity, const unsigned number_of_shards = 16)
+    {
+        const unsigned shard_count = std::max(1u, number_of_shards);
+        const unsigned shard_capacity = std::max(1u, capacity / shard_count);
+        for (unsigned i = 0; i < shard_count; ++i)
+        {
+            shards.emplace_back(new Shard(shard_capacity));
+        }
+    }
+
+    // Appends the unpacked edges of the shortcut if it is cached. A shortcut with both
+    // direction flags unpacks to different edges when it is traversed against its direction.
+    bool Fetch(const EdgeID shortcut,
+               const bool traversed_in_reverse,
+               std::vector<UnpackedEdge> &unpacked_edges)
+    {
+        const std::uint64_t key = GetKey(shortcut, traversed_in_reverse);
+        EntryPointer entry;
+        {
+            Shard &shard = GetShard(key);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (!shard.entries.Fetch(key, entry))
+            {
+                return false;
+            }
+        }
+        unpacked_edges.insert(unpacked_edges.end(), entry->begin(), entry->end());
+        return true;
+    }
+
+    void Insert(const EdgeID shortcut,
+                const bool traversed_in_reverse,
+                std::vector<UnpackedEdge> unpacked_edges)
+    {
+        const std::uint64_t key = GetKey(shortcut, traversed_in_reverse);
+        auto entry = std::make_shared<const std::vector<UnpackedEdge>>(std::move(unpacked_edges));
+
+        Shard &shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries.Insert(key, std::move(entry));
+    }
+
+    void Clear()
+    {
+        for (auto &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->entries.Clear();
+        }
+    }
+
+    std::size_t Size() const
+    {
+        std::size_t size = 0;
+        for (const auto &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            size += shard->entries.Size();
+        }
+        return size;
+    }
+
+  private:
+    static std::uint64_t GetKey(const EdgeID shortcut, const bool traversed_in_reverse)
+    {
+        return (static_cast<std::uint64_t>(shortcut) << 1) | (traversed_in_reverse ? 1 : 0);
+    }
+
+    Shard &GetShard(const std::uint64_t key)
+    {
+        return *shards[std::hash<std::uint64_t>()(key >> 1) % shards.size()];
+    }
+
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+#endif // SHORTCUT_CACHE_HPP
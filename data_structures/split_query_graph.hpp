@@ -0,0 +1,219 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef SPLIT_QUERY_GRAPH_HPP
+#define SPLIT_QUERY_GRAPH_HPP
+
+#include "query_edge.hpp"
+#include "shared_memory_vector_wrapper.hpp"
+#include "static_graph.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/prefetch.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <vector>
+
+// Read-only query graph that keeps the edges of a StaticGraph<QueryEdge::EdgeData> in two
+// parallel arrays. The hot array holds what a search reads to relax an edge, target, weight and
+// direction flags in eight bytes. The cold array holds the middle node or original edge id and
+// the length that only the unpacking of a path reads. A cache line thus holds twice the edges.
+// The facades are final, so a relaxation that inlines GetEdgeData never loads the cold half.
+template <bool UseSharedMemory = false> class SplitQueryGraph
+{
+  public:
+    using EdgeData = QueryEdge::EdgeData;
+    using NodeIterator = NodeID;
+    using EdgeIterator = NodeID;
+    using EdgeRange = osrm::range<EdgeIterator>;
+    using NodeArrayEntry = typename StaticGraph<EdgeData, UseSharedMemory>::NodeArrayEntry;
+    using EdgeArrayEntry = typename StaticGraph<EdgeData, UseSharedMemory>::EdgeArrayEntry;
+    using InputEdge = typename StaticGraph<EdgeData, UseSharedMemory>::InputEdge;
+
+    struct HotEdgeEntry
+    {
+        NodeID target;
+        struct SearchData
+        {
+            int distance : 30;
+            bool forward : 1;
+            bool backward : 1;
+        } data;
+    };
+
+    struct ColdEdgeEntry
+    {
+        NodeID id : 31;
+        bool shortcut : 1;
+        unsigned length;
+    };
+    static_assert(sizeof(HotEdgeEntry) == 8, "hot edges have to stay eight bytes");
+
+    static void Split(const EdgeArrayEntry &edge, HotEdgeEntry &hot, ColdEdgeEntry &cold)
+    {
+        hot.target = edge.target;
+        hot.data.distance = edge.data.distance;
+        hot.data.forward = edge.data.forward;
+        hot.data.backward = edge.data.backward;
+        cold.id = edge.data.id;
+        cold.shortcut = edge.data.shortcut;
+        cold.length = edge.data.length;
+    }
+
+    // Splits the edges of a StaticGraph with its node and edge array, the edge array is released.
+    SplitQueryGraph(typename ShM<NodeArrayEntry, UseSharedMemory>::vector &nodes,
+                    std::vector<EdgeArrayEntry> &edges)
+    {
+        BOOST_ASSERT(!nodes.empty());
+        number_of_nodes = static_cast<NodeIterator>(nodes.size() - 1);
+        number_of_edges = static_cast<EdgeIterator>(edges.size());
+        node_array.swap(nodes);
+
+        hot_edge_array.resize(number_of_edges);
+        cold_edge_array.resize(number_of_edges);
+        for (const auto edge : osrm::irange(0u, number_of_edges))
+        {
+            Split(edges[edge], hot_edge_array[edge], cold_edge_array[edge]);
+        }
+        edges.clear();
+        edges.shrink_to_fit();
+    }
+
+    // takes arrays that were split before, e.g. the blocks of a shared memory dataset
+    SplitQueryGraph(typename ShM<NodeArrayEntry, UseSharedMemory>::vector &nodes,
+                    typename ShM<HotEdgeEntry, UseSharedMemory>::vector &hot_edges,
+                    typename ShM<ColdEdgeEntry, UseSharedMemory>::vector &cold_edges)
+    {
+        BOOST_ASSERT(!nodes.empty());
+        BOOST_ASSERT(hot_edges.size() == cold_edges.size());
+        number_of_nodes = static_cast<NodeIterator>(nodes.size() - 1);
+        number_of_edges = static_cast<EdgeIterator>(hot_edges.size());
+
+        node_array.swap(nodes);
+        hot_edge_array.swap(hot_edges);
+        cold_edge_array.swap(cold_edges);
+    }
+
+    unsigned GetNumberOfNodes() const { return number_of_nodes; }
+
+    unsigned GetNumberOfEdges() const { return number_of_edges; }
+
+    unsigned GetOutDegree(const NodeIterator n) const { return EndEdges(n) - BeginEdges(n); }
+
+    NodeIterator GetTarget(const EdgeIterator e) const { return hot_edge_array[e].target; }
+
+    EdgeData GetEdgeData(const EdgeIterator e) const
+    {
+        const HotEdgeEntry &hot = hot_edge_array[e];
+        const ColdEdgeEntry &cold = cold_edge_array[e];
+        EdgeData data;
+        data.id = cold.id;
+        data.shortcut = cold.shortcut;
+        data.distance = hot.data.distance;
+        data.forward = hot.data.forward;
+        data.backward = hot.data.backward;
+        data.length = cold.length;
+        return data;
+    }
+
+    EdgeIterator BeginEdges(const NodeIterator n) const { return node_array[n].first_edge; }
+
+    EdgeIterator EndEdges(const NodeIterator n) const { return node_array[n + 1].first_edge; }
+
+    // only the hot edges, the cold ones are read long after a search settled the node
+    void PrefetchEdges(const NodeIterator n) const
+    {
+        osrm::prefetch(hot_edge_array.data() + node_array[n].first_edge);
+    }
+
+    EdgeRange GetAdjacentEdgeRange(const NodeID node) const
+    {
+        return osrm::irange(BeginEdges(node), EndEdges(node));
+    }
+
+    // searches for a specific edge
+    EdgeIterator FindEdge(const NodeIterator from, const NodeIterator to) const
+    {
+        for (const auto i : GetAdjacentEdgeRange(from))
+        {
+            if (to == hot_edge_array[i].target)
+            {
+                return i;
+            }
+        }
+        return SPECIAL_EDGEID;
+    }
+
+    // searches for a specific edge
+    EdgeIterator FindSmallestEdge(const NodeIterator from, const NodeIterator to) const
+    {
+        EdgeIterator smallest_edge = SPECIAL_EDGEID;
+        EdgeWeight smallest_weight = INVALID_EDGE_WEIGHT;
+        for (auto edge : GetAdjacentEdgeRange(from))
+        {
+            const HotEdgeEntry &hot = hot_edge_array[edge];
+            if (hot.target == to && hot.data.distance < smallest_weight)
+            {
+                smallest_edge = edge;
+                smallest_weight = hot.data.distance;
+            }
+        }
+        return smallest_edge;
+    }
+
+    EdgeIterator FindEdgeInEitherDirection(const NodeIterator from, const NodeIterator to) const
+    {
+        EdgeIterator tmp = FindEdge(from, to);
+        return (SPECIAL_NODEID != tmp ? tmp : FindEdge(to, from));
+    }
+
+    EdgeIterator
+    FindEdgeIndicateIfReverse(const NodeIterator from, const NodeIterator to, bool &result) const
+    {
+        EdgeIterator current_iterator = FindEdge(from, to);
+        if (SPECIAL_NODEID == current_iterator)
+        {
+            current_iterator = FindEdge(to, from);
+            if (SPECIAL_NODEID != current_iterator)
+            {
+                result = true;
+            }
+        }
+        return current_iterator;
+    }
+
+  private:
+    NodeIterator number_of_nodes;
+    EdgeIterator number_of_edges;
+
+    typename ShM<NodeArrayEntry, UseSharedMemory>::vector node_array;
+    typename ShM<HotEdgeEntry, UseSharedMemory>::vector hot_edge_array;
+    typename ShM<ColdEdgeEntry, UseSharedMemory>::vector cold_edge_array;
+};
+
+#endif // SPLIT_QUERY_GRAPH_HPP
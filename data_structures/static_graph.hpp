@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "percent.hpp"
 #include "shared_memory_vector_wrapper.hpp"
 #include "../util/integer_range.hpp"
+#include "../util/prefetch.hpp"
 #include "../typedefs.h"
 
 #include <boost/assert.hpp>
@@ -156,6 +157,12 @@ template <typename EdgeDataT, bool UseSharedMemory = false> class StaticGraph
         return EdgeIterator(node_array.at(n + 1).first_edge);
     }
 
+    // loads the first edges of a node into the cache ahead of iterating them in a search
+    void PrefetchEdges(const NodeIterator n) const
+    {
+        osrm::prefetch(edge_array.data() + node_array[n].first_edge);
+    }
+
     // searches for a specific edge
     EdgeIterator FindEdge(const NodeIterator from, const NodeIterator to) const
     {
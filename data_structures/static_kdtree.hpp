@@ -30,231 +30,253 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef STATICKDTREE_HPP
 #define STATICKDTREE_HPP
 
+#include "shared_memory_vector_wrapper.hpp"
+
+#include "../algorithms/coordinate_calculation.hpp"
+#include "../util/osrm_exception.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
+
+#include <osrm/coordinate.hpp>
+
 #include <boost/assert.hpp>
-#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
 #include <algorithm>
-#include <stack>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <limits>
+#include <stack>
+#include <string>
+#include <utility>
+#include <vector>
 
-namespace KDTree
+// Implicit 2-d tree of the coordinates of the nodes. The points are stored in the order of a
+// recursive median split that alternates between latitude and longitude, so the tree itself
+// needs no memory. It answers the nearest node queries of /locate without visiting segments.
+template <bool UseSharedMemory = false> class StaticKDTree
 {
+  public:
+    // ranges of fewer points are scanned
+    static constexpr uint32_t LEAF_SIZE = 8;
 
-#define KDTREE_BASESIZE (8)
+    // the file starts with the header, followed by the points in tree order
+    struct KDTreeHeader
+    {
+        uint32_t leaf_size;
+        uint32_t point_bytes;
+        uint64_t number_of_points;
+    };
 
-template <unsigned k, typename T> class BoundingBox
-{
-  public:
-    BoundingBox()
+    StaticKDTree() = default;
+
+    // Writes the tree of the points to a file
+    static void Build(std::vector<FixedPointCoordinate> points, const std::string &tree_filename)
     {
-        for (unsigned dim = 0; dim < k; ++dim)
+        TIMER_START(construction);
+
+        std::stack<Range> ranges;
+        ranges.emplace(0, points.size(), 0);
+        while (!ranges.empty())
         {
-            min[dim] = std::numeric_limits<T>::min();
-            max[dim] = std::numeric_limits<T>::max();
+            const Range range = ranges.top();
+            ranges.pop();
+            if (range.end - range.begin < LEAF_SIZE)
+            {
+                continue;
+            }
+
+            const uint64_t middle = range.begin + (range.end - range.begin) / 2;
+            const uint32_t dimension = range.dimension;
+            std::nth_element(points.begin() + range.begin, points.begin() + middle,
+                             points.begin() + range.end,
+                             [dimension](const FixedPointCoordinate &lhs,
+                                         const FixedPointCoordinate &rhs)
+                             {
+                                 return GetValue(lhs, dimension) < GetValue(rhs, dimension);
+                             });
+            ranges.emplace(range.begin, middle, 1 - dimension);
+            ranges.emplace(middle + 1, range.end, 1 - dimension);
         }
-    }
 
-    T min[k];
-    T max[k];
-};
+        KDTreeHeader header;
+        header.leaf_size = LEAF_SIZE;
+        header.point_bytes = sizeof(FixedPointCoordinate);
+        header.number_of_points = points.size();
 
-struct NoData
-{
-};
+        boost::filesystem::ofstream tree_file(tree_filename, std::ios::binary);
+        tree_file.write((char *)&header, sizeof(KDTreeHeader));
+        tree_file.write((char *)points.data(), sizeof(FixedPointCoordinate) * points.size());
+        tree_file.close();
 
-template <unsigned k, typename T> class EuclidianMetric
-{
-  public:
-    double operator()(const T left[k], const T right[k])
-    {
-        double result = 0;
-        for (unsigned i = 0; i < k; ++i)
-        {
-            double temp = (double)left[i] - (double)right[i];
-            result += temp * temp;
-        }
-        return result;
+        TIMER_STOP(construction);
+        SimpleLogger().Write() << "finished kd-tree of " << points.size() << " nodes in "
+                               << TIMER_SEC(construction) << " seconds";
     }
 
-    double operator()(const BoundingBox<k, T> &box, const T point[k])
+    // throws if the file was written for another leaf or point size
+    static KDTreeHeader ReadHeader(boost::filesystem::ifstream &tree_file)
     {
-        T nearest[k];
-        for (unsigned dim = 0; dim < k; ++dim)
+        KDTreeHeader header;
+        tree_file.read((char *)&header, sizeof(KDTreeHeader));
+        if (!tree_file || header.leaf_size != LEAF_SIZE ||
+            header.point_bytes != sizeof(FixedPointCoordinate))
         {
-            if (point[dim] < box.min[dim])
-                nearest[dim] = box.min[dim];
-            else if (point[dim] > box.max[dim])
-                nearest[dim] = box.max[dim];
-            else
-                nearest[dim] = point[dim];
+            throw osrm::exception("kd-tree file was built with a different layout");
         }
-        return operator()(point, nearest);
+        return header;
     }
-};
 
-template <unsigned k, typename T, typename Data = NoData, typename Metric = EuclidianMetric<k, T>>
-class StaticKDTree
-{
-  public:
-    struct InputPoint
+    explicit StaticKDTree(const boost::filesystem::path &tree_filename)
     {
-        T coordinates[k];
-        Data data;
-        bool operator==(const InputPoint &right)
+        boost::filesystem::ifstream tree_file(tree_filename, std::ios::binary);
+        const KDTreeHeader header = ReadHeader(tree_file);
+        points.resize(header.number_of_points);
+        tree_file.read((char *)points.data(), sizeof(FixedPointCoordinate) * points.size());
+        if (!tree_file)
         {
-            for (int i = 0; i < k; i++)
-            {
-                if (coordinates[i] != right.coordinates[i])
-                    return false;
-            }
-            return true;
+            throw osrm::exception("kd-tree file is truncated");
         }
-    };
+    }
 
-    explicit StaticKDTree(std::vector<InputPoint> *points)
+    StaticKDTree(FixedPointCoordinate *points_ptr, const uint64_t number_of_points)
     {
-        BOOST_ASSERT(k > 0);
-        BOOST_ASSERT(points->size() > 0);
-        size = points->size();
-        kdtree = new InputPoint[size];
-        for (Iterator i = 0; i != size; ++i)
-        {
-            kdtree[i] = points->at(i);
-            for (unsigned dim = 0; dim < k; ++dim)
-            {
-                if (kdtree[i].coordinates[dim] < boundingBox.min[dim])
-                    boundingBox.min[dim] = kdtree[i].coordinates[dim];
-                if (kdtree[i].coordinates[dim] > boundingBox.max[dim])
-                    boundingBox.max[dim] = kdtree[i].coordinates[dim];
-            }
-        }
-        std::stack<Tree> s;
-        s.push(Tree(0, size, 0));
-        while (!s.empty())
-        {
-            Tree tree = s.top();
-            s.pop();
-
-            if (tree.right - tree.left < KDTREE_BASESIZE)
-                continue;
-
-            Iterator middle = tree.left + (tree.right - tree.left) / 2;
-            std::nth_element(kdtree + tree.left, kdtree + middle, kdtree + tree.right,
-                             Less(tree.dimension));
-            s.push(Tree(tree.left, middle, (tree.dimension + 1) % k));
-            s.push(Tree(middle + 1, tree.right, (tree.dimension + 1) % k));
-        }
+        typename ShM<FixedPointCoordinate, UseSharedMemory>::vector tree_points(
+            points_ptr, number_of_points);
+        points.swap(tree_points);
     }
 
-    ~StaticKDTree() { delete[] kdtree; }
-
-    bool NearestNeighbor(InputPoint *result, const InputPoint &point)
+    // The point that is closest to the query by coordinate_calculation::euclidean_distance
+    bool NearestNeighbor(const FixedPointCoordinate &query, FixedPointCoordinate &result) const
     {
-        Metric distance;
+        float nearest_distance = std::numeric_limits<float>::max();
         bool found = false;
-        double nearestDistance = std::numeric_limits<T>::max();
-        std::stack<NNTree> s;
-        s.push(NNTree(0, size, 0, boundingBox));
-        while (!s.empty())
+        const auto inspect = [&](const uint64_t index)
         {
-            NNTree tree = s.top();
-            s.pop();
+            const FixedPointCoordinate &point = points[index];
+            const float distance = coordinate_calculation::euclidean_distance(query, point);
+            if (distance < nearest_distance)
+            {
+                nearest_distance = distance;
+                result = point;
+                found = true;
+            }
+        };
 
-            if (distance(tree.box, point.coordinates) >= nearestDistance)
+        std::stack<SearchRange> ranges;
+        ranges.emplace(Range(0, points.size(), 0), Box());
+        while (!ranges.empty())
+        {
+            const SearchRange current = ranges.top();
+            ranges.pop();
+            const Range &range = current.first;
+            if (range.begin >= range.end ||
+                GetLowerBound(current.second, query) >= nearest_distance)
+            {
                 continue;
+            }
 
-            if (tree.right - tree.left < KDTREE_BASESIZE)
+            if (range.end - range.begin < LEAF_SIZE)
             {
-                for (unsigned i = tree.left; i < tree.right; i++)
+                for (uint64_t i = range.begin; i < range.end; ++i)
                 {
-                    double newDistance = distance(kdtree[i].coordinates, point.coordinates);
-                    if (newDistance < nearestDistance)
-                    {
-                        nearestDistance = newDistance;
-                        *result = kdtree[i];
-                        found = true;
-                    }
+                    inspect(i);
                 }
                 continue;
             }
 
-            Iterator middle = tree.left + (tree.right - tree.left) / 2;
+            const uint64_t middle = range.begin + (range.end - range.begin) / 2;
+            inspect(middle);
 
-            double newDistance = distance(kdtree[middle].coordinates, point.coordinates);
-            if (newDistance < nearestDistance)
+            // the half of the query is searched first, the other one only if it is close enough
+            const int split = GetValue(points[middle], range.dimension);
+            SearchRange lower(Range(range.begin, middle, 1 - range.dimension), current.second);
+            SearchRange upper(Range(middle + 1, range.end, 1 - range.dimension), current.second);
+            lower.second.max[range.dimension] = split;
+            upper.second.min[range.dimension] = split;
+            if (GetValue(query, range.dimension) < split)
             {
-                nearestDistance = newDistance;
-                *result = kdtree[middle];
-                found = true;
-            }
-
-            Less comperator(tree.dimension);
-            if (!comperator(point, kdtree[middle]))
-            {
-                NNTree first(middle + 1, tree.right, (tree.dimension + 1) % k, tree.box);
-                NNTree second(tree.left, middle, (tree.dimension + 1) % k, tree.box);
-                first.box.min[tree.dimension] = kdtree[middle].coordinates[tree.dimension];
-                second.box.max[tree.dimension] = kdtree[middle].coordinates[tree.dimension];
-                s.push(second);
-                s.push(first);
+                ranges.push(upper);
+                ranges.push(lower);
             }
             else
             {
-                NNTree first(middle + 1, tree.right, (tree.dimension + 1) % k, tree.box);
-                NNTree second(tree.left, middle, (tree.dimension + 1) % k, tree.box);
-                first.box.min[tree.dimension] = kdtree[middle].coordinates[tree.dimension];
-                second.box.max[tree.dimension] = kdtree[middle].coordinates[tree.dimension];
-                s.push(first);
-                s.push(second);
+                ranges.push(lower);
+                ranges.push(upper);
             }
         }
         return found;
     }
 
+    uint64_t GetNumberOfPoints() const { return points.size(); }
+
   private:
-    using Iterator = unsigned;
-    struct Tree
+    // dimension 0 is the latitude, 1 the longitude
+    static int GetValue(const FixedPointCoordinate &coordinate, const uint32_t dimension)
     {
-        Iterator left;
-        Iterator right;
-        unsigned dimension;
-        Tree() {}
-        Tree(Iterator l, Iterator r, unsigned d) : left(l), right(r), dimension(d) {}
-    };
-    struct NNTree
+        return dimension == 0 ? coordinate.lat : coordinate.lon;
+    }
+
+    struct Range
     {
-        Iterator left;
-        Iterator right;
-        unsigned dimension;
-        BoundingBox<k, T> box;
-        NNTree() {}
-        NNTree(Iterator l, Iterator r, unsigned d, const BoundingBox<k, T> &b)
-            : left(l), right(r), dimension(d), box(b)
+        Range(const uint64_t begin, const uint64_t end, const uint32_t dimension)
+            : begin(begin), end(end), dimension(dimension)
         {
         }
+
+        uint64_t begin;
+        uint64_t end;
+        uint32_t dimension;
     };
-    class Less
+
+    // bounds of the points of a range, in fixed point latitude and longitude
+    struct Box
     {
-      public:
-        explicit Less(unsigned d)
+        Box()
+            : min{{-90 * static_cast<int>(COORDINATE_PRECISION),
+                   -180 * static_cast<int>(COORDINATE_PRECISION)}},
+              max{{90 * static_cast<int>(COORDINATE_PRECISION),
+                   180 * static_cast<int>(COORDINATE_PRECISION)}}
         {
-            dimension = d;
-            BOOST_ASSERT(dimension < k);
         }
 
-        bool operator()(const InputPoint &left, const InputPoint &right)
+        std::array<int, 2> min;
+        std::array<int, 2> max;
+    };
+
+    using SearchRange = std::pair<Range, Box>;
+
+    // Lower bound of the euclidean_distance() between the query and any point in the box. The
+    // longitude difference is scaled by the smallest cosine of a mean latitude in the box.
+    static float GetLowerBound(const Box &box, const FixedPointCoordinate &query)
+    {
+        const auto gap = [](const int value, const int min, const int max)
+        {
+            return value < min ? double(min) - value : (value > max ? double(value) - max : 0.);
+        };
+        const double lat_gap = gap(query.lat, box.min[0], box.max[0]);
+        const double lon_gap = gap(query.lon, box.min[1], box.max[1]);
+        if (lat_gap == 0. && lon_gap == 0.)
         {
-            BOOST_ASSERT(dimension < k);
-            return left.coordinates[dimension] < right.coordinates[dimension];
+            return 0.f;
         }
 
-      private:
-        unsigned dimension;
-    };
+        // as in coordinate_calculation
+        const double earth_radius = 6372797.560856;
+        const double to_radians = M_PI / 180. / COORDINATE_PRECISION;
+        const double min_cosine =
+            std::min(std::cos((double(query.lat) + box.min[0]) / 2. * to_radians),
+                     std::cos((double(query.lat) + box.max[0]) / 2. * to_radians));
+        // euclidean_distance() rounds the coordinates to single precision radians, which is off
+        // by up to a few metres
+        const double distance =
+            std::hypot(lon_gap * min_cosine, lat_gap) * to_radians * earth_radius;
+        return static_cast<float>(std::max(0., distance * 0.999 - 5.));
+    }
 
-    BoundingBox<k, T> boundingBox;
-    InputPoint *kdtree;
-    Iterator size;
+    typename ShM<FixedPointCoordinate, UseSharedMemory>::vector points;
 };
-}
 
 #endif // STATICKDTREE_HPP
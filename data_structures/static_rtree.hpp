@@ -33,12 +33,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "phantom_node.hpp"
 #include "query_node.hpp"
 #include "rectangle.hpp"
+#include "segment_grid.hpp"
 #include "shared_memory_factory.hpp"
 #include "shared_memory_vector_wrapper.hpp"
 #include "upper_bound.hpp"
 
+#include "../algorithms/parallel_radix_sort.hpp"
+#include "../util/bearing.hpp"
 #include "../util/floating_point.hpp"
 #include "../util/integer_range.hpp"
+#include "../util/make_unique.hpp"
 #include "../util/mercator.hpp"
 #include "../util/osrm_exception.hpp"
 #include "../util/simple_logger.hpp"
@@ -50,30 +54,48 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <boost/range/irange.hpp>
 
 #include <tbb/parallel_for.h>
-#include <tbb/parallel_sort.h>
+#include <tbb/parallel_reduce.h>
 
 #include <variant/variant.hpp>
 
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <queue>
 #include <string>
 #include <vector>
 
+// The node layout is fixed at build time by the RTREE_BRANCHING_FACTOR and RTREE_LEAF_NODE_SIZE
+// cmake options, smaller nodes keep more of the search tree in cache. All tools of a build agree.
+#ifndef OSRM_RTREE_BRANCHING_FACTOR
+#define OSRM_RTREE_BRANCHING_FACTOR 64
+#endif
+#ifndef OSRM_RTREE_LEAF_NODE_SIZE
+#define OSRM_RTREE_LEAF_NODE_SIZE 1024
+#endif
+
 // Implements a static, i.e. packed, R-tree
 template <class EdgeDataT,
           class CoordinateListT = std::vector<FixedPointCoordinate>,
           bool UseSharedMemory = false,
-          uint32_t BRANCHING_FACTOR = 64,
-          uint32_t LEAF_NODE_SIZE = 1024>
+          uint32_t BRANCHING_FACTOR = OSRM_RTREE_BRANCHING_FACTOR,
+          uint32_t LEAF_NODE_SIZE = OSRM_RTREE_LEAF_NODE_SIZE>
 class StaticRTree
 {
   public:
+    using SegmentGridT = SegmentGrid<EdgeDataT, UseSharedMemory>;
+    using ProjectedLatitudeListT = typename ShM<double, UseSharedMemory>::vector;
+
     struct RectangleInt2D
     {
         RectangleInt2D() : min_lon(INT_MAX), max_lon(INT_MIN), min_lat(INT_MAX), max_lat(INT_MIN) {}
@@ -290,13 +312,42 @@ class StaticRTree
         }
     };
 
-    struct LeafNode
+    // The part of an element the search looks at. The element itself is only read for the
+    // segments that make it into a result, the leaves stay a fraction of the size.
+    struct LeafEntry
+    {
+        NodeID u;
+        NodeID v;
+        // position of the element in the element array of the leaf file
+        uint32_t element_id;
+        uint32_t is_tiny_component : 1;
+        uint32_t has_forward_direction : 1;
+        uint32_t has_reverse_direction : 1;
+
+        bool is_in_tiny_cc() const { return is_tiny_component; }
+    };
+
+    // leaves start on a cache line, so a scan touches no line shared with another leaf
+    struct alignas(64) LeafNode
     {
         LeafNode() : object_count(0), objects() {}
         uint32_t object_count;
-        std::array<EdgeDataT, LEAF_NODE_SIZE> objects;
+        std::array<LeafEntry, LEAF_NODE_SIZE> objects;
     };
 
+    // The leaf file starts with a page holding the element count and the layout it was written
+    // with. The leaves follow page aligned, then the elements in the order of the leaves.
+    struct LeafFileHeader
+    {
+        uint64_t element_count;
+        uint32_t leaf_node_size;
+        uint32_t leaf_node_bytes;
+        uint32_t element_bytes;
+    };
+    static constexpr std::size_t LEAF_FILE_HEADER_SIZE = 4096;
+    // leaves are written to the leaf file in chunks of about this many bytes
+    static constexpr std::size_t LEAF_BUFFER_SIZE = 64 * 1024 * 1024;
+
     struct QueryCandidate
     {
         explicit QueryCandidate(const float dist, const uint32_t n_id)
@@ -313,7 +364,7 @@ class StaticRTree
         }
     };
 
-    using IncrementalQueryNodeType = mapbox::util::variant<TreeNode, EdgeDataT>;
+    using IncrementalQueryNodeType = mapbox::util::variant<TreeNode, LeafEntry>;
     struct IncrementalQueryCandidate
     {
         explicit IncrementalQueryCandidate(const float dist, IncrementalQueryNodeType node)
@@ -337,7 +388,12 @@ class StaticRTree
     uint64_t m_element_count;
     const std::string m_leaf_node_filename;
     std::shared_ptr<CoordinateListT> m_coordinate_list;
-    boost::filesystem::ifstream leaves_stream;
+    // the leaves are mapped read-only, so all threads can query the same tree concurrently
+    std::unique_ptr<boost::interprocess::mapped_region> m_leaves_region;
+    const LeafNode *m_leaves;
+    const EdgeDataT *m_elements;
+    std::unique_ptr<SegmentGridT> m_segment_grid;
+    std::shared_ptr<ProjectedLatitudeListT> m_projected_latitudes;
 
   public:
     StaticRTree() = delete;
@@ -389,81 +445,134 @@ class StaticRTree
 
         // open leaf file
         boost::filesystem::ofstream leaf_node_file(leaf_node_filename, std::ios::binary);
-        leaf_node_file.write((char *)&m_element_count, sizeof(uint64_t));
+        LeafFileHeader leaf_file_header;
+        leaf_file_header.element_count = m_element_count;
+        leaf_file_header.leaf_node_size = LEAF_NODE_SIZE;
+        leaf_file_header.leaf_node_bytes = sizeof(LeafNode);
+        leaf_file_header.element_bytes = sizeof(EdgeDataT);
+        leaf_node_file.write((char *)&leaf_file_header, sizeof(LeafFileHeader));
+        const std::vector<char> header_padding(LEAF_FILE_HEADER_SIZE - sizeof(LeafFileHeader), 0);
+        leaf_node_file.write(header_padding.data(), header_padding.size());
 
         // sort the hilbert-value representatives
-        tbb::parallel_sort(input_wrapper_vector.begin(), input_wrapper_vector.end());
-        std::vector<TreeNode> tree_nodes_in_level;
+        ParallelRadixSort(input_wrapper_vector, [](const WrappedInputElement &element)
+                          {
+                              return element.m_hilbert_value;
+                          });
 
-        // pack M elements into leaf node and write to leaf file
-        uint64_t processed_objects_count = 0;
-        while (processed_objects_count < m_element_count)
+        // pack M elements into leaf nodes. The leaves are built in parallel into a buffer of
+        // consecutive leaves that is written to the leaf file with a single write.
+        const uint64_t number_of_leaves = (m_element_count + LEAF_NODE_SIZE - 1) / LEAF_NODE_SIZE;
+        const uint64_t leaves_per_buffer =
+            std::max<uint64_t>(1, LEAF_BUFFER_SIZE / sizeof(LeafNode));
+        std::vector<TreeNode> tree_nodes_in_level(number_of_leaves);
+        std::vector<char> leaf_buffer;
+        for (uint64_t first_leaf = 0; first_leaf < number_of_leaves;
+             first_leaf += leaves_per_buffer)
         {
-
-            LeafNode current_leaf;
-            TreeNode current_node;
-            // SimpleLogger().Write() << "reading " << tree_size << " tree nodes in " <<
-            // (sizeof(TreeNode)*tree_size) << " bytes";
-            for (uint32_t current_element_index = 0; LEAF_NODE_SIZE > current_element_index;
-                 ++current_element_index)
-            {
-                if (m_element_count > (processed_objects_count + current_element_index))
+            const uint64_t last_leaf = std::min(first_leaf + leaves_per_buffer, number_of_leaves);
+            leaf_buffer.resize((last_leaf - first_leaf) * sizeof(LeafNode));
+            tbb::parallel_for(
+                tbb::blocked_range<uint64_t>(first_leaf, last_leaf),
+                [&](const tbb::blocked_range<uint64_t> &range)
                 {
-                    uint32_t index_of_next_object =
-                        input_wrapper_vector[processed_objects_count + current_element_index]
-                            .m_array_index;
-                    current_leaf.objects[current_element_index] =
-                        input_data_vector[index_of_next_object];
-                    ++current_leaf.object_count;
-                }
-            }
+                    for (uint64_t leaf_id = range.begin(), end = range.end(); leaf_id != end;
+                         ++leaf_id)
+                    {
+                        // zero the padding as well, so the file only depends on the input
+                        LeafNode current_leaf;
+                        std::memset(&current_leaf, 0, sizeof(LeafNode));
+                        const uint64_t first_element = leaf_id * LEAF_NODE_SIZE;
+                        const uint64_t last_element =
+                            std::min<uint64_t>(first_element + LEAF_NODE_SIZE, m_element_count);
+                        for (uint64_t i = first_element; i < last_element; ++i)
+                        {
+                            const EdgeDataT &current_element =
+                                input_data_vector[input_wrapper_vector[i].m_array_index];
+                            LeafEntry &current_entry =
+                                current_leaf.objects[current_leaf.object_count++];
+                            current_entry.u = current_element.u;
+                            current_entry.v = current_element.v;
+                            current_entry.element_id = static_cast<uint32_t>(i);
+                            current_entry.is_tiny_component = current_element.is_in_tiny_cc();
+                            current_entry.has_forward_direction =
+                                SPECIAL_NODEID != current_element.forward_edge_based_node_id;
+                            current_entry.has_reverse_direction =
+                                SPECIAL_NODEID != current_element.reverse_edge_based_node_id;
+                        }
 
-            // generate tree node that resemble the objects in leaf and store it for next level
-            InitializeMBRectangle(current_node.minimum_bounding_rectangle, current_leaf.objects,
-                                  current_leaf.object_count, coordinate_list);
-            current_node.child_is_on_disk = true;
-            current_node.children[0] = tree_nodes_in_level.size();
-            tree_nodes_in_level.emplace_back(current_node);
+                        // generate tree node that resemble the objects in leaf and store it
+                        // for next level
+                        TreeNode &current_node = tree_nodes_in_level[leaf_id];
+                        InitializeMBRectangle(current_node.minimum_bounding_rectangle,
+                                              current_leaf.objects, current_leaf.object_count,
+                                              coordinate_list);
+                        current_node.child_is_on_disk = true;
+                        current_node.children[0] = leaf_id;
+
+                        std::memcpy(&leaf_buffer[(leaf_id - first_leaf) * sizeof(LeafNode)],
+                                    &current_leaf, sizeof(LeafNode));
+                    }
+                });
+            leaf_node_file.write(leaf_buffer.data(), leaf_buffer.size());
+        }
 
-            // write leaf_node to leaf node file
-            leaf_node_file.write((char *)&current_leaf, sizeof(current_leaf));
-            processed_objects_count += current_leaf.object_count;
+        // append the elements in leaf order, the results of a query mostly come from one leaf
+        const uint64_t elements_per_buffer =
+            std::max<uint64_t>(1, LEAF_BUFFER_SIZE / sizeof(EdgeDataT));
+        std::vector<EdgeDataT> element_buffer;
+        for (uint64_t first_element = 0; first_element < m_element_count;
+             first_element += elements_per_buffer)
+        {
+            const uint64_t last_element =
+                std::min(first_element + elements_per_buffer, m_element_count);
+            element_buffer.clear();
+            for (uint64_t i = first_element; i < last_element; ++i)
+            {
+                element_buffer.push_back(input_data_vector[input_wrapper_vector[i].m_array_index]);
+            }
+            leaf_node_file.write((char *)element_buffer.data(),
+                                 sizeof(EdgeDataT) * element_buffer.size());
         }
 
         // close leaf file
         leaf_node_file.close();
+        MapLeaves();
 
-        uint32_t processing_level = 0;
+        // pack BRANCHING_FACTOR tree nodes into parents, level by level. The nodes of a level
+        // are stored consecutively, so the id of each child is known up front.
         while (1 < tree_nodes_in_level.size())
         {
-            std::vector<TreeNode> tree_nodes_in_next_level;
-            uint32_t processed_tree_nodes_in_level = 0;
-            while (processed_tree_nodes_in_level < tree_nodes_in_level.size())
-            {
-                TreeNode parent_node;
-                // pack BRANCHING_FACTOR elements into tree_nodes each
-                for (uint32_t current_child_node_index = 0;
-                     BRANCHING_FACTOR > current_child_node_index; ++current_child_node_index)
+            const uint32_t level_offset = m_search_tree.size();
+            m_search_tree.insert(m_search_tree.end(), tree_nodes_in_level.begin(),
+                                 tree_nodes_in_level.end());
+
+            std::vector<TreeNode> tree_nodes_in_next_level(
+                (tree_nodes_in_level.size() + BRANCHING_FACTOR - 1) / BRANCHING_FACTOR);
+            tbb::parallel_for(
+                tbb::blocked_range<std::size_t>(0, tree_nodes_in_next_level.size()),
+                [&](const tbb::blocked_range<std::size_t> &range)
                 {
-                    if (processed_tree_nodes_in_level < tree_nodes_in_level.size())
+                    for (std::size_t parent_id = range.begin(), end = range.end();
+                         parent_id != end; ++parent_id)
                     {
-                        TreeNode &current_child_node =
-                            tree_nodes_in_level[processed_tree_nodes_in_level];
-                        // add tree node to parent entry
-                        parent_node.children[current_child_node_index] = m_search_tree.size();
-                        m_search_tree.emplace_back(current_child_node);
-                        // merge MBRs
-                        parent_node.minimum_bounding_rectangle.MergeBoundingBoxes(
-                            current_child_node.minimum_bounding_rectangle);
-                        // increase counters
-                        ++parent_node.child_count;
-                        ++processed_tree_nodes_in_level;
+                        TreeNode &parent_node = tree_nodes_in_next_level[parent_id];
+                        const std::size_t first_child = parent_id * BRANCHING_FACTOR;
+                        const std::size_t last_child = std::min<std::size_t>(
+                            first_child + BRANCHING_FACTOR, tree_nodes_in_level.size());
+                        for (std::size_t child_id = first_child; child_id < last_child;
+                             ++child_id)
+                        {
+                            // add tree node to parent entry and merge MBRs
+                            parent_node.children[parent_node.child_count] =
+                                level_offset + child_id;
+                            parent_node.minimum_bounding_rectangle.MergeBoundingBoxes(
+                                tree_nodes_in_level[child_id].minimum_bounding_rectangle);
+                            ++parent_node.child_count;
+                        }
                     }
-                }
-                tree_nodes_in_next_level.emplace_back(parent_node);
-            }
+                });
             tree_nodes_in_level.swap(tree_nodes_in_next_level);
-            ++processing_level;
         }
         BOOST_ASSERT_MSG(1 == tree_nodes_in_level.size(), "tree broken, more than one root node");
         // last remaining entry is the root node, store it
@@ -524,6 +633,11 @@ class StaticRTree
 
         uint32_t tree_size = 0;
         tree_node_file.read((char *)&tree_size, sizeof(uint32_t));
+        if (boost::filesystem::file_size(node_file) !=
+            sizeof(uint32_t) + uint64_t(tree_size) * sizeof(TreeNode))
+        {
+            throw osrm::exception("ram index file was built with a different r-tree layout");
+        }
 
         m_search_tree.resize(tree_size);
         if (tree_size > 0)
@@ -531,7 +645,7 @@ class StaticRTree
             tree_node_file.read((char *)&m_search_tree[0], sizeof(TreeNode) * tree_size);
         }
         tree_node_file.close();
-        // open leaf node file and store thread specific pointer
+        // map the leaf node file, all threads share it
         if (!boost::filesystem::exists(leaf_file))
         {
             throw osrm::exception("mem index file does not exist");
@@ -541,8 +655,7 @@ class StaticRTree
             throw osrm::exception("mem index file is empty");
         }
 
-        leaves_stream.open(leaf_file, std::ios::binary);
-        leaves_stream.read((char *)&m_element_count, sizeof(uint64_t));
+        MapLeaves();
 
         // SimpleLogger().Write() << tree_size << " nodes in search tree";
         // SimpleLogger().Write() << m_element_count << " elements in leafs";
@@ -555,7 +668,7 @@ class StaticRTree
         : m_search_tree(tree_node_ptr, number_of_nodes), m_leaf_node_filename(leaf_file.string()),
           m_coordinate_list(std::move(coordinate_list))
     {
-        // open leaf node file and store thread specific pointer
+        // map the leaf node file, all threads share it
         if (!boost::filesystem::exists(leaf_file))
         {
             throw osrm::exception("mem index file does not exist");
@@ -565,12 +678,114 @@ class StaticRTree
             throw osrm::exception("mem index file is empty");
         }
 
-        leaves_stream.open(leaf_file, std::ios::binary);
-        leaves_stream.read((char *)&m_element_count, sizeof(uint64_t));
+        MapLeaves();
 
         // SimpleLogger().Write() << tree_size << " nodes in search tree";
         // SimpleLogger().Write() << m_element_count << " elements in leafs";
     }
+
+    // all indexed segments in leaf order, e.g. to build them into a tree of another layout
+    std::vector<EdgeDataT> GetElements() const
+    {
+        return std::vector<EdgeDataT>(m_elements, m_elements + m_element_count);
+    }
+
+    // the indexed segments in leaf order without a copy, they stay mapped from the leaf file
+    const EdgeDataT *GetElementsBegin() const { return m_elements; }
+    const EdgeDataT *GetElementsEnd() const { return m_elements + m_element_count; }
+
+    // Checks that the tree nodes and the leaves reference each other consistently, i.e. that
+    // every child and element id is in range and the leaves hold each element once. Throws on
+    // the first inconsistency found.
+    void CheckConsistency() const
+    {
+        const uint32_t tree_size = m_search_tree.size();
+        if (0 == tree_size)
+        {
+            throw osrm::exception("search tree is empty");
+        }
+        const uint64_t number_of_leaves = (m_element_count + LEAF_NODE_SIZE - 1) / LEAF_NODE_SIZE;
+        const auto node_error = [](const uint32_t node_id, const std::string &message)
+        {
+            return osrm::exception("tree node " + std::to_string(node_id) + ": " + message);
+        };
+
+        // the children of a node are numbered after it, the tree can't contain a cycle
+        const uint64_t referenced_leaves = tbb::parallel_reduce(
+            tbb::blocked_range<uint32_t>(0, tree_size), uint64_t(0),
+            [&](const tbb::blocked_range<uint32_t> &range, uint64_t leaves)
+            {
+                for (uint32_t node_id = range.begin(), end = range.end(); node_id != end;
+                     ++node_id)
+                {
+                    const TreeNode &node = m_search_tree[node_id];
+                    if (node.child_is_on_disk)
+                    {
+                        if (node.children[0] >= number_of_leaves)
+                        {
+                            throw node_error(node_id, "leaf id out of range");
+                        }
+                        ++leaves;
+                        continue;
+                    }
+                    if (0 == node.child_count || node.child_count > BRANCHING_FACTOR)
+                    {
+                        throw node_error(node_id, "invalid number of children");
+                    }
+                    for (uint32_t i = 0; i < node.child_count; ++i)
+                    {
+                        if (node.children[i] <= node_id || node.children[i] >= tree_size)
+                        {
+                            throw node_error(node_id, "child id out of range");
+                        }
+                    }
+                }
+                return leaves;
+            },
+            std::plus<uint64_t>());
+        if (referenced_leaves != number_of_leaves)
+        {
+            throw osrm::exception("tree references " + std::to_string(referenced_leaves) +
+                                  " of " + std::to_string(number_of_leaves) + " leaves");
+        }
+
+        // the leaves are filled in the order of the elements
+        tbb::parallel_for(
+            tbb::blocked_range<uint64_t>(0, number_of_leaves),
+            [&](const tbb::blocked_range<uint64_t> &range)
+            {
+                for (uint64_t leaf_id = range.begin(), end = range.end(); leaf_id != end;
+                     ++leaf_id)
+                {
+                    const LeafNode &leaf = m_leaves[leaf_id];
+                    const uint64_t first_element = leaf_id * LEAF_NODE_SIZE;
+                    const uint64_t expected_count =
+                        std::min<uint64_t>(LEAF_NODE_SIZE, m_element_count - first_element);
+                    if (leaf.object_count != expected_count)
+                    {
+                        throw osrm::exception("leaf " + std::to_string(leaf_id) +
+                                              " has an invalid number of elements");
+                    }
+                    for (uint32_t i = 0; i < leaf.object_count; ++i)
+                    {
+                        const LeafEntry &entry = leaf.objects[i];
+                        const EdgeDataT &element = m_elements[first_element + i];
+                        if (entry.element_id != first_element + i || entry.u != element.u ||
+                            entry.v != element.v ||
+                            entry.has_forward_direction !=
+                                (SPECIAL_NODEID != element.forward_edge_based_node_id) ||
+                            entry.has_reverse_direction !=
+                                (SPECIAL_NODEID != element.reverse_edge_based_node_id))
+                        {
+                            throw osrm::exception("leaf " + std::to_string(leaf_id) +
+                                                  " doesn't match element " +
+                                                  std::to_string(first_element + i));
+                        }
+                    }
+                }
+            });
+    }
+
     // Read-only operation for queries
 
     bool LocateClosestEndPointForCoordinate(const FixedPointCoordinate &input_coordinate,
@@ -598,12 +813,11 @@ class StaticRTree
                 TreeNode &current_tree_node = m_search_tree[current_query_node.node_id];
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
+                    const LeafNode &current_leaf_node = GetLeaf(current_tree_node.children[0]);
                     for (uint32_t i = 0; i < current_leaf_node.object_count; ++i)
                     {
-                        EdgeDataT const &current_edge = current_leaf_node.objects[i];
-                        if (ignore_tiny_components && current_edge.component_id != 0)
+                        const LeafEntry &current_edge = current_leaf_node.objects[i];
+                        if (ignore_tiny_components && current_edge.is_in_tiny_cc())
                         {
                             continue;
                         }
@@ -642,10 +856,14 @@ class StaticRTree
         return result_coordinate.is_valid();
     }
 
+    // Only segments that can be travelled within filter_bearing_range degrees of filter_bearing
+    // become candidates, the directions outside of the range are removed from their phantom nodes
     bool IncrementalFindPhantomNodeForCoordinate(
         const FixedPointCoordinate &input_coordinate,
         std::vector<PhantomNode> &result_phantom_node_vector,
         const unsigned max_number_of_phantom_nodes,
+        const int filter_bearing = 0,
+        const int filter_bearing_range = 180,
         const float max_distance = 1100,
         const unsigned max_checked_elements = 4 * LEAF_NODE_SIZE)
     {
@@ -677,17 +895,26 @@ class StaticRTree
                     current_query_node.node.template get<TreeNode>();
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
+                    const LeafNode &current_leaf_node = GetLeaf(current_tree_node.children[0]);
 
                     // current object represents a block on disk
                     for (const auto i : osrm::irange(0u, current_leaf_node.object_count))
                     {
                         const auto &current_edge = current_leaf_node.objects[i];
+                        if (filter_bearing_range < 180)
+                        {
+                            const auto directions = GetDirectionsInBearingRange(
+                                current_edge, filter_bearing, filter_bearing_range);
+                            if (!directions.first && !directions.second)
+                            {
+                                continue;
+                            }
+                        }
                         const float current_perpendicular_distance = coordinate_calculation::
-                            perpendicular_distance_from_projected_coordinate(
+                            perpendicular_distance_from_projected_coordinates(
                                 m_coordinate_list->at(current_edge.u),
-                                m_coordinate_list->at(current_edge.v), input_coordinate,
+                                m_coordinate_list->at(current_edge.v),
+                                GetProjectedLatitudes(current_edge), input_coordinate,
                                 projected_coordinate);
                         // distance must be non-negative
                         BOOST_ASSERT(0.f <= current_perpendicular_distance);
@@ -716,8 +943,9 @@ class StaticRTree
             { // current object is a leaf node
                 ++inspected_elements;
                 // inspecting an actual road segment
-                const EdgeDataT &current_segment =
-                    current_query_node.node.template get<EdgeDataT>();
+                const LeafEntry &current_entry =
+                    current_query_node.node.template get<LeafEntry>();
+                const EdgeDataT &current_segment = GetElement(current_entry);
 
                 // continue searching for the first segment from a big component
                 if (number_of_elements_from_big_cc == 0 &&
@@ -732,9 +960,10 @@ class StaticRTree
                 FixedPointCoordinate foot_point_coordinate_on_segment;
 
                 // const float current_perpendicular_distance =
-                coordinate_calculation::perpendicular_distance_from_projected_coordinate(
+                coordinate_calculation::perpendicular_distance_from_projected_coordinates(
                     m_coordinate_list->at(current_segment.u),
-                    m_coordinate_list->at(current_segment.v), input_coordinate,
+                    m_coordinate_list->at(current_segment.v),
+                    GetProjectedLatitudes(current_segment), input_coordinate,
                     projected_coordinate, foot_point_coordinate_on_segment, current_ratio);
 
                 // store phantom node in result vector
@@ -748,6 +977,20 @@ class StaticRTree
                 SetForwardAndReverseWeightsOnPhantomNode(current_segment,
                                                          result_phantom_node_vector.back());
 
+                if (filter_bearing_range < 180)
+                {
+                    const auto directions = GetDirectionsInBearingRange(
+                        current_entry, filter_bearing, filter_bearing_range);
+                    if (!directions.first)
+                    {
+                        result_phantom_node_vector.back().forward_node_id = SPECIAL_NODEID;
+                    }
+                    if (!directions.second)
+                    {
+                        result_phantom_node_vector.back().reverse_node_id = SPECIAL_NODEID;
+                    }
+                }
+
                 // update counts on what we found from which result class
                 if (current_segment.is_in_tiny_cc())
                 { // found an element in tiny component
@@ -790,6 +1033,12 @@ class StaticRTree
         const double max_distance,
         const unsigned max_checked_elements = 4 * LEAF_NODE_SIZE)
     {
+        if (FindPhantomNodesInSegmentGrid(input_coordinate, result_phantom_node_vector,
+                                          max_distance, max_checked_elements))
+        {
+            return !result_phantom_node_vector.empty();
+        }
+
         unsigned inspected_elements = 0;
 
         std::pair<double, double> projected_coordinate = {
@@ -817,17 +1066,24 @@ class StaticRTree
                     current_query_node.node.template get<TreeNode>();
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
+                    const LeafNode &current_leaf_node = GetLeaf(current_tree_node.children[0]);
+                    const SegmentDistanceBound distance_bound(
+                        input_coordinate, current_tree_node.minimum_bounding_rectangle,
+                        max_distance);
 
                     // current object represents a block on disk
                     for (const auto i : osrm::irange(0u, current_leaf_node.object_count))
                     {
                         const auto &current_edge = current_leaf_node.objects[i];
+                        const FixedPointCoordinate &u = (*m_coordinate_list)[current_edge.u];
+                        const FixedPointCoordinate &v = (*m_coordinate_list)[current_edge.v];
+                        if (distance_bound.IsOutOfReach(u, v))
+                        {
+                            continue;
+                        }
                         const float current_perpendicular_distance = coordinate_calculation::
-                            perpendicular_distance_from_projected_coordinate(
-                                m_coordinate_list->at(current_edge.u),
-                                m_coordinate_list->at(current_edge.v), input_coordinate,
+                            perpendicular_distance_from_projected_coordinates(
+                                u, v, GetProjectedLatitudes(current_edge), input_coordinate,
                                 projected_coordinate);
                         // distance must be non-negative
                         BOOST_ASSERT(0.f <= current_perpendicular_distance);
@@ -862,17 +1118,19 @@ class StaticRTree
             { // current object is a leaf node
                 ++inspected_elements;
                 // inspecting an actual road segment
-                const EdgeDataT &current_segment =
-                    current_query_node.node.template get<EdgeDataT>();
+                const LeafEntry &current_entry =
+                    current_query_node.node.template get<LeafEntry>();
+                const EdgeDataT &current_segment = GetElement(current_entry);
 
                 // check if it is smaller than what we had before
                 float current_ratio = 0.f;
                 FixedPointCoordinate foot_point_coordinate_on_segment;
 
                 const float current_perpendicular_distance =
-                    coordinate_calculation::perpendicular_distance_from_projected_coordinate(
+                    coordinate_calculation::perpendicular_distance_from_projected_coordinates(
                         m_coordinate_list->at(current_segment.u),
-                        m_coordinate_list->at(current_segment.v), input_coordinate,
+                        m_coordinate_list->at(current_segment.v),
+                        GetProjectedLatitudes(current_segment), input_coordinate,
                         projected_coordinate, foot_point_coordinate_on_segment, current_ratio);
 
                 if (current_perpendicular_distance >= max_distance)
@@ -882,23 +1140,9 @@ class StaticRTree
                 }
 
                 // store phantom node in result vector
-                result_phantom_node_vector.emplace_back(
-                    PhantomNode(
-                        current_segment.forward_edge_based_node_id,
-                        current_segment.reverse_edge_based_node_id, current_segment.name_id,
-                        current_segment.forward_weight, current_segment.reverse_weight,
-                        current_segment.forward_offset, current_segment.reverse_offset,
-                        current_segment.packed_geometry_id, current_segment.component_id,
-                        foot_point_coordinate_on_segment, current_segment.fwd_segment_position,
-                        current_segment.forward_travel_mode, current_segment.backward_travel_mode),
-                    current_perpendicular_distance);
-
-                // Hack to fix rounding errors and wandering via nodes.
-                FixUpRoundingIssue(input_coordinate, result_phantom_node_vector.back().first);
-
-                // set forward and reverse weights on the phantom node
-                SetForwardAndReverseWeightsOnPhantomNode(current_segment,
-                                                         result_phantom_node_vector.back().first);
+                AppendPhantomNode(input_coordinate, current_segment,
+                                  foot_point_coordinate_on_segment, current_perpendicular_distance,
+                                  result_phantom_node_vector);
             }
 
             // stop the search by flushing the queue
@@ -911,12 +1155,170 @@ class StaticRTree
         return !result_phantom_node_vector.empty();
     }
 
+    // Same as IncrementalFindPhantomNodeForCoordinateWithDistance for every coordinate. The
+    // queries are grouped along the Hilbert curve, every group walks the tree once and scans
+    // each leaf a single time for all of its queries that can reach it, so neighbouring
+    // points of a trace share traversal and leaf loads.
+    void IncrementalFindPhantomNodesForCoordinatesWithDistance(
+        const std::vector<FixedPointCoordinate> &input_coordinates,
+        std::vector<std::vector<std::pair<PhantomNode, double>>> &result_phantom_node_vectors,
+        const double max_distance,
+        const unsigned max_checked_elements = 4 * LEAF_NODE_SIZE)
+    {
+        const std::size_t BATCH_SIZE = 16;
+
+        result_phantom_node_vectors.clear();
+        result_phantom_node_vectors.resize(input_coordinates.size());
+        if (input_coordinates.empty() || m_search_tree.empty())
+        {
+            return;
+        }
+
+        HilbertCode get_hilbert_number;
+        std::vector<std::pair<uint64_t, unsigned>> query_order;
+        query_order.reserve(input_coordinates.size());
+        for (const auto i : osrm::irange<std::size_t>(0, input_coordinates.size()))
+        {
+            if (FindPhantomNodesInSegmentGrid(input_coordinates[i], result_phantom_node_vectors[i],
+                                              max_distance, max_checked_elements))
+            {
+                continue;
+            }
+            query_order.emplace_back(get_hilbert_number(input_coordinates[i]),
+                                     static_cast<unsigned>(i));
+        }
+        // stable, queries with the same value stay in input order
+        ParallelRadixSort(query_order, [](const std::pair<uint64_t, unsigned> &query)
+                          {
+                              return query.first;
+                          });
+
+        for (std::size_t batch_begin = 0; batch_begin < query_order.size();
+             batch_begin += BATCH_SIZE)
+        {
+            const std::size_t batch_end = std::min(batch_begin + BATCH_SIZE, query_order.size());
+            std::vector<unsigned> batch;
+            std::vector<std::pair<double, double>> projected_coordinates;
+            for (const auto i : osrm::irange(batch_begin, batch_end))
+            {
+                const FixedPointCoordinate &input_coordinate =
+                    input_coordinates[query_order[i].second];
+                batch.push_back(query_order[i].second);
+                projected_coordinates.emplace_back(
+                    mercator::lat2y(input_coordinate.lat / COORDINATE_PRECISION),
+                    input_coordinate.lon / COORDINATE_PRECISION);
+            }
+
+            // segments in range of each query of the batch, indexed by position in the batch
+            std::vector<std::vector<std::pair<float, const LeafEntry *>>> candidates(batch.size());
+            // tree nodes still to visit, with the queries whose radius reaches them
+            std::vector<std::pair<uint32_t, std::vector<unsigned>>> traversal_stack;
+            traversal_stack.emplace_back(0, std::vector<unsigned>(batch.size()));
+            std::iota(traversal_stack.back().second.begin(), traversal_stack.back().second.end(),
+                      0);
+
+            while (!traversal_stack.empty())
+            {
+                const std::pair<uint32_t, std::vector<unsigned>> current =
+                    std::move(traversal_stack.back());
+                traversal_stack.pop_back();
+
+                const TreeNode &current_tree_node = m_search_tree[current.first];
+                if (current_tree_node.child_is_on_disk)
+                {
+                    const LeafNode &current_leaf_node = GetLeaf(current_tree_node.children[0]);
+                    for (const auto query : current.second)
+                    {
+                        const SegmentDistanceBound distance_bound(
+                            input_coordinates[batch[query]],
+                            current_tree_node.minimum_bounding_rectangle, max_distance);
+                        for (const auto i : osrm::irange(0u, current_leaf_node.object_count))
+                        {
+                            const auto &current_edge = current_leaf_node.objects[i];
+                            const FixedPointCoordinate &u = (*m_coordinate_list)[current_edge.u];
+                            const FixedPointCoordinate &v = (*m_coordinate_list)[current_edge.v];
+                            if (distance_bound.IsOutOfReach(u, v))
+                            {
+                                continue;
+                            }
+                            const float current_perpendicular_distance = coordinate_calculation::
+                                perpendicular_distance_from_projected_coordinates(
+                                    u, v, GetProjectedLatitudes(current_edge),
+                                    input_coordinates[batch[query]], projected_coordinates[query]);
+                            if (current_perpendicular_distance < max_distance)
+                            {
+                                candidates[query].emplace_back(current_perpendicular_distance,
+                                                               &current_edge);
+                            }
+                        }
+                    }
+                    continue;
+                }
+
+                for (const auto i : osrm::irange(0u, current_tree_node.child_count))
+                {
+                    const int32_t child_id = current_tree_node.children[i];
+                    const RectangleT &child_rectangle =
+                        m_search_tree[child_id].minimum_bounding_rectangle;
+                    std::vector<unsigned> reaching_queries;
+                    for (const auto query : current.second)
+                    {
+                        if (child_rectangle.GetMinDist(input_coordinates[batch[query]]) <=
+                            max_distance)
+                        {
+                            reaching_queries.push_back(query);
+                        }
+                    }
+                    if (!reaching_queries.empty())
+                    {
+                        traversal_stack.emplace_back(child_id, std::move(reaching_queries));
+                    }
+                }
+            }
+
+            for (const auto query : osrm::irange<std::size_t>(0, batch.size()))
+            {
+                auto &query_candidates = candidates[query];
+                const auto number_of_results =
+                    std::min<std::size_t>(query_candidates.size(), max_checked_elements);
+                std::partial_sort(query_candidates.begin(),
+                                  query_candidates.begin() + number_of_results,
+                                  query_candidates.end(),
+                                  [](const std::pair<float, const LeafEntry *> &lhs,
+                                     const std::pair<float, const LeafEntry *> &rhs)
+                                  {
+                                      return lhs.first < rhs.first;
+                                  });
+
+                const FixedPointCoordinate &input_coordinate = input_coordinates[batch[query]];
+                auto &result_phantom_node_vector = result_phantom_node_vectors[batch[query]];
+                for (const auto i : osrm::irange<std::size_t>(0, number_of_results))
+                {
+                    const EdgeDataT &current_segment = GetElement(*query_candidates[i].second);
+                    float current_ratio = 0.f;
+                    FixedPointCoordinate foot_point_coordinate_on_segment;
+                    const float current_perpendicular_distance =
+                        coordinate_calculation::perpendicular_distance_from_projected_coordinates(
+                            m_coordinate_list->at(current_segment.u),
+                            m_coordinate_list->at(current_segment.v),
+                            GetProjectedLatitudes(current_segment), input_coordinate,
+                            projected_coordinates[query], foot_point_coordinate_on_segment,
+                            current_ratio);
+                    AppendPhantomNode(input_coordinate, current_segment,
+                                      foot_point_coordinate_on_segment,
+                                      current_perpendicular_distance, result_phantom_node_vector);
+                }
+            }
+        }
+    }
+
     bool FindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
                                       PhantomNode &result_phantom_node,
                                       const unsigned zoom_level)
     {
         const bool ignore_tiny_components = (zoom_level <= 14);
-        EdgeDataT nearest_edge;
+        const LeafEntry *nearest_entry = nullptr;
+        FixedPointCoordinate nearest_location;
 
         float min_dist = std::numeric_limits<float>::max();
         float min_max_dist = std::numeric_limits<float>::max();
@@ -936,12 +1338,11 @@ class StaticRTree
                 const TreeNode &current_tree_node = m_search_tree[current_query_node.node_id];
                 if (current_tree_node.child_is_on_disk)
                 {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
+                    const LeafNode &current_leaf_node = GetLeaf(current_tree_node.children[0]);
                     for (uint32_t i = 0; i < current_leaf_node.object_count; ++i)
                     {
-                        const EdgeDataT &current_edge = current_leaf_node.objects[i];
-                        if (ignore_tiny_components && current_edge.component_id != 0)
+                        const LeafEntry &current_edge = current_leaf_node.objects[i];
+                        if (ignore_tiny_components && current_edge.is_in_tiny_cc())
                         {
                             continue;
                         }
@@ -960,20 +1361,8 @@ class StaticRTree
                             !osrm::epsilon_compare(current_perpendicular_distance, min_dist))
                         { // found a new minimum
                             min_dist = current_perpendicular_distance;
-                            result_phantom_node = {current_edge.forward_edge_based_node_id,
-                                                   current_edge.reverse_edge_based_node_id,
-                                                   current_edge.name_id,
-                                                   current_edge.forward_weight,
-                                                   current_edge.reverse_weight,
-                                                   current_edge.forward_offset,
-                                                   current_edge.reverse_offset,
-                                                   current_edge.packed_geometry_id,
-                                                   current_edge.component_id,
-                                                   nearest,
-                                                   current_edge.fwd_segment_position,
-                                                   current_edge.forward_travel_mode,
-                                                   current_edge.backward_travel_mode};
-                            nearest_edge = current_edge;
+                            nearest_entry = &current_edge;
+                            nearest_location = nearest;
                         }
                     }
                 }
@@ -985,18 +1374,235 @@ class StaticRTree
             }
         }
 
+        if (nullptr != nearest_entry)
+        {
+            const EdgeDataT &nearest_edge = GetElement(*nearest_entry);
+            result_phantom_node = {nearest_edge.forward_edge_based_node_id,
+                                   nearest_edge.reverse_edge_based_node_id,
+                                   nearest_edge.name_id,
+                                   nearest_edge.forward_weight,
+                                   nearest_edge.reverse_weight,
+                                   nearest_edge.forward_offset,
+                                   nearest_edge.reverse_offset,
+                                   nearest_edge.packed_geometry_id,
+                                   nearest_edge.component_id,
+                                   nearest_location,
+                                   nearest_edge.fwd_segment_position,
+                                   nearest_edge.forward_travel_mode,
+                                   nearest_edge.backward_travel_mode};
+        }
         if (result_phantom_node.location.is_valid())
         {
             // Hack to fix rounding errors and wandering via nodes.
             FixUpRoundingIssue(input_coordinate, result_phantom_node);
 
             // set forward and reverse weights on the phantom node
-            SetForwardAndReverseWeightsOnPhantomNode(nearest_edge, result_phantom_node);
+            SetForwardAndReverseWeightsOnPhantomNode(GetElement(*nearest_entry),
+                                                     result_phantom_node);
         }
         return result_phantom_node.location.is_valid();
     }
 
+#ifdef OSRM_RTREE_LEAF_STATISTICS
+    // number of leaves the queries of the calling thread have read, used by rtree-bench
+    static uint64_t &LeafLoadCount()
+    {
+        static thread_local uint64_t leaf_load_count = 0;
+        return leaf_load_count;
+    }
+
+    // if set, the ids of the leaves the queries of the calling thread read are appended to it,
+    // osrm-io-benchmark replays them against the leaf file
+    static std::vector<uint32_t> *&LeafTrace()
+    {
+        static thread_local std::vector<uint32_t> *leaf_trace = nullptr;
+        return leaf_trace;
+    }
+
+    static constexpr std::size_t LeafFileOffset(const uint32_t leaf_id)
+    {
+        return LEAF_FILE_HEADER_SIZE + leaf_id * sizeof(LeafNode);
+    }
+
+    static constexpr std::size_t LeafBytes() { return sizeof(LeafNode); }
+#endif
+
+    // Radius queries small enough for the grid read their segments from it instead of walking
+    // the tree. The grid has to index the same segments as the tree.
+    void SetSegmentGrid(std::unique_ptr<SegmentGridT> segment_grid)
+    {
+        m_segment_grid = std::move(segment_grid);
+    }
+
+    // The mercator y of every coordinate, see coordinate_calculation::projected_latitude.
+    // Queries project the segment ends themselves if the dataset does not store them.
+    void SetProjectedLatitudes(std::shared_ptr<ProjectedLatitudeListT> projected_latitudes)
+    {
+        BOOST_ASSERT(projected_latitudes->size() == m_coordinate_list->size());
+        m_projected_latitudes = std::move(projected_latitudes);
+    }
+
   private:
+    template <typename SegmentT>
+    std::pair<double, double> GetProjectedLatitudes(const SegmentT &segment) const
+    {
+        if (m_projected_latitudes)
+        {
+            return {(*m_projected_latitudes)[segment.u], (*m_projected_latitudes)[segment.v]};
+        }
+        return {coordinate_calculation::projected_latitude((*m_coordinate_list)[segment.u]),
+                coordinate_calculation::projected_latitude((*m_coordinate_list)[segment.v])};
+    }
+
+    // Whether the forward and the reverse direction of the segment exist and head within
+    // filter_bearing_range degrees of filter_bearing
+    std::pair<bool, bool> GetDirectionsInBearingRange(const LeafEntry &segment,
+                                                      const int filter_bearing,
+                                                      const int filter_bearing_range) const
+    {
+        const FixedPointCoordinate &u = (*m_coordinate_list)[segment.u];
+        const FixedPointCoordinate &v = (*m_coordinate_list)[segment.v];
+        const bool forward_in_range =
+            segment.has_forward_direction &&
+            bearing::CheckInBounds(coordinate_calculation::bearing(u, v), filter_bearing,
+                                   filter_bearing_range);
+        const bool reverse_in_range =
+            segment.has_reverse_direction &&
+            bearing::CheckInBounds(coordinate_calculation::bearing(v, u), filter_bearing,
+                                   filter_bearing_range);
+        return std::make_pair(forward_in_range, reverse_in_range);
+    }
+
+    // Latitude difference in fixed point units beyond which a segment is farther away than
+    // max_distance from the query
+    static double GetReach(const double max_distance)
+    {
+        static const double meters_per_unit =
+            coordinate_calculation::euclidean_distance(0, 0, static_cast<int>(COORDINATE_PRECISION),
+                                                       0) /
+            COORDINATE_PRECISION;
+        // slack for the rounding of the foot point and the float math of the exact distance
+        return (max_distance * 1.001 + 2.) / meters_per_unit;
+    }
+
+    // Answers a radius query from the segment grid with the same phantom nodes the tree walk
+    // finds, nearest first. Returns false if there is no grid or the radius is too large for it.
+    bool FindPhantomNodesInSegmentGrid(
+        const FixedPointCoordinate &input_coordinate,
+        std::vector<std::pair<PhantomNode, double>> &result_phantom_node_vector,
+        const double max_distance,
+        const unsigned max_checked_elements)
+    {
+        if (!m_segment_grid)
+        {
+            return false;
+        }
+
+        // every segment within max_distance overlaps this box, cf. SegmentDistanceBound
+        const double lat_reach = GetReach(max_distance);
+        const double max_latitude =
+            (std::abs(input_coordinate.lat) + lat_reach) / COORDINATE_PRECISION;
+        if (max_latitude >= 89.)
+        {
+            return false;
+        }
+        const double lon_reach = lat_reach / std::cos(max_latitude * M_PI / 180.);
+        const int lat_extent = static_cast<int>(std::ceil(lat_reach));
+        const int lon_extent = static_cast<int>(std::ceil(lon_reach));
+        if (!SegmentGridT::CoversExtent(2 * lat_extent, 2 * lon_extent))
+        {
+            return false;
+        }
+
+        const std::pair<double, double> projected_coordinate = {
+            mercator::lat2y(input_coordinate.lat / COORDINATE_PRECISION),
+            input_coordinate.lon / COORDINATE_PRECISION};
+        std::vector<std::pair<float, const EdgeDataT *>> candidates;
+        m_segment_grid->ForEachSegmentInBox(
+            *m_coordinate_list, input_coordinate.lat - lat_extent,
+            input_coordinate.lat + lat_extent, input_coordinate.lon - lon_extent,
+            input_coordinate.lon + lon_extent, [&](const EdgeDataT &segment)
+            {
+                const float current_perpendicular_distance =
+                    coordinate_calculation::perpendicular_distance_from_projected_coordinates(
+                        (*m_coordinate_list)[segment.u], (*m_coordinate_list)[segment.v],
+                        GetProjectedLatitudes(segment), input_coordinate, projected_coordinate);
+                if (current_perpendicular_distance < max_distance)
+                {
+                    candidates.emplace_back(current_perpendicular_distance, &segment);
+                }
+            });
+
+        const auto by_distance = [](const std::pair<float, const EdgeDataT *> &lhs,
+                                    const std::pair<float, const EdgeDataT *> &rhs)
+        {
+            return lhs.first < rhs.first;
+        };
+        std::sort(candidates.begin(), candidates.end(), by_distance);
+        if (candidates.size() > max_checked_elements)
+        {
+            candidates.resize(max_checked_elements);
+        }
+        for (const auto &candidate : candidates)
+        {
+            const EdgeDataT &current_segment = *candidate.second;
+            float current_ratio = 0.f;
+            FixedPointCoordinate foot_point_coordinate_on_segment;
+            const float current_perpendicular_distance =
+                coordinate_calculation::perpendicular_distance_from_projected_coordinates(
+                    (*m_coordinate_list)[current_segment.u],
+                    (*m_coordinate_list)[current_segment.v],
+                    GetProjectedLatitudes(current_segment), input_coordinate,
+                    projected_coordinate, foot_point_coordinate_on_segment, current_ratio);
+            AppendPhantomNode(input_coordinate, current_segment, foot_point_coordinate_on_segment,
+                              current_perpendicular_distance, result_phantom_node_vector);
+        }
+        return true;
+    }
+
+    // Lower bound of the distance that perpendicular_distance_from_projected_coordinate()
+    // reports between a query and any segment in a rectangle. It only needs the integer gap
+    // between the query and the bounding box of a segment, no trigonometry or projection, so
+    // the radius queries use it to skip the exact distance of the segments out of reach.
+    class SegmentDistanceBound
+    {
+      public:
+        SegmentDistanceBound(const FixedPointCoordinate &input_coordinate,
+                             const RectangleT &rectangle,
+                             const double max_distance)
+            : input_coordinate(input_coordinate)
+        {
+            // the distance is measured at the mean latitude of the query and the foot point,
+            // the latitude farthest from the equator has the smallest degree of longitude
+            const double max_latitude =
+                std::max({std::abs(input_coordinate.lat), std::abs(rectangle.min_lat),
+                          std::abs(rectangle.max_lat)}) /
+                COORDINATE_PRECISION;
+            lon_factor = std::cos(std::min(max_latitude, 90.) * M_PI / 180.);
+            const double reach = GetReach(max_distance);
+            squared_reach = reach * reach;
+        }
+
+        inline bool IsOutOfReach(const FixedPointCoordinate &u,
+                                 const FixedPointCoordinate &v) const
+        {
+            const double lat_gap = Gap(input_coordinate.lat, u.lat, v.lat);
+            const double lon_gap = Gap(input_coordinate.lon, u.lon, v.lon) * lon_factor;
+            return lat_gap * lat_gap + lon_gap * lon_gap > squared_reach;
+        }
+
+      private:
+        static inline int64_t Gap(const int64_t value, const int64_t first, const int64_t second)
+        {
+            return std::max({int64_t(0), std::min(first, second) - value,
+                             value - std::max(first, second)});
+        }
+
+        const FixedPointCoordinate input_coordinate;
+        double lon_factor;
+        double squared_reach;
+    };
+
     inline void SetForwardAndReverseWeightsOnPhantomNode(const EdgeDataT &nearest_edge,
                                                          PhantomNode &result_phantom_node) const
     {
@@ -1069,22 +1675,83 @@ class StaticRTree
         return new_min_max_dist;
     }
 
-    inline void LoadLeafFromDisk(const uint32_t leaf_id, LeafNode &result_node)
+    inline void
+    AppendPhantomNode(const FixedPointCoordinate &input_coordinate,
+                      const EdgeDataT &current_segment,
+                      FixedPointCoordinate &foot_point_coordinate_on_segment,
+                      const float current_perpendicular_distance,
+                      std::vector<std::pair<PhantomNode, double>> &result_phantom_node_vector)
+    {
+        result_phantom_node_vector.emplace_back(
+            PhantomNode(current_segment.forward_edge_based_node_id,
+                        current_segment.reverse_edge_based_node_id, current_segment.name_id,
+                        current_segment.forward_weight, current_segment.reverse_weight,
+                        current_segment.forward_offset, current_segment.reverse_offset,
+                        current_segment.packed_geometry_id, current_segment.component_id,
+                        foot_point_coordinate_on_segment, current_segment.fwd_segment_position,
+                        current_segment.forward_travel_mode, current_segment.backward_travel_mode),
+            current_perpendicular_distance);
+
+        // Hack to fix rounding errors and wandering via nodes.
+        FixUpRoundingIssue(input_coordinate, result_phantom_node_vector.back().first);
+
+        // set forward and reverse weights on the phantom node
+        SetForwardAndReverseWeightsOnPhantomNode(current_segment,
+                                                 result_phantom_node_vector.back().first);
+    }
+
+    void MapLeaves()
     {
-        if (!leaves_stream.is_open())
+        static_assert(LEAF_FILE_HEADER_SIZE % alignof(LeafNode) == 0,
+                      "leaves would be misaligned");
+        const boost::interprocess::file_mapping leaf_file(m_leaf_node_filename.c_str(),
+                                                          boost::interprocess::read_only);
+        m_leaves_region = osrm::make_unique<boost::interprocess::mapped_region>(
+            leaf_file, boost::interprocess::read_only);
+        const char *leaf_data = static_cast<const char *>(m_leaves_region->get_address());
+        LeafFileHeader leaf_file_header;
+        if (m_leaves_region->get_size() < LEAF_FILE_HEADER_SIZE)
         {
-            leaves_stream.open(m_leaf_node_filename, std::ios::in | std::ios::binary);
+            throw osrm::exception("mem index file is truncated");
         }
-        if (!leaves_stream.good())
+        std::copy(leaf_data, leaf_data + sizeof(LeafFileHeader), (char *)&leaf_file_header);
+        if (leaf_file_header.leaf_node_size != LEAF_NODE_SIZE ||
+            leaf_file_header.leaf_node_bytes != sizeof(LeafNode) ||
+            leaf_file_header.element_bytes != sizeof(EdgeDataT))
         {
-            leaves_stream.clear(std::ios::goodbit);
-            SimpleLogger().Write(logDEBUG) << "Resetting stale filestream";
+            throw osrm::exception("mem index file was built with a different r-tree layout");
         }
-        const uint64_t seek_pos = sizeof(uint64_t) + leaf_id * sizeof(LeafNode);
-        leaves_stream.seekg(seek_pos);
-        BOOST_ASSERT_MSG(leaves_stream.good(), "Seeking to position in leaf file failed.");
-        leaves_stream.read((char *)&result_node, sizeof(LeafNode));
-        BOOST_ASSERT_MSG(leaves_stream.good(), "Reading from leaf file failed.");
+        m_element_count = leaf_file_header.element_count;
+        const uint64_t number_of_leaves = (m_element_count + LEAF_NODE_SIZE - 1) / LEAF_NODE_SIZE;
+        const uint64_t elements_offset =
+            LEAF_FILE_HEADER_SIZE + number_of_leaves * sizeof(LeafNode);
+        if (m_leaves_region->get_size() < elements_offset + m_element_count * sizeof(EdgeDataT))
+        {
+            throw osrm::exception("mem index file is truncated");
+        }
+        m_leaves = reinterpret_cast<const LeafNode *>(leaf_data + LEAF_FILE_HEADER_SIZE);
+        m_elements = reinterpret_cast<const EdgeDataT *>(leaf_data + elements_offset);
+    }
+
+    inline const EdgeDataT &GetElement(const LeafEntry &entry) const
+    {
+        BOOST_ASSERT_MSG(entry.element_id < m_element_count, "element id out of bounds");
+        return m_elements[entry.element_id];
+    }
+
+    inline const LeafNode &GetLeaf(const uint32_t leaf_id) const
+    {
+        BOOST_ASSERT_MSG(LEAF_FILE_HEADER_SIZE + (leaf_id + 1) * sizeof(LeafNode) <=
+                             m_leaves_region->get_size(),
+                         "leaf id out of bounds");
+#ifdef OSRM_RTREE_LEAF_STATISTICS
+        ++LeafLoadCount();
+        if (nullptr != LeafTrace())
+        {
+            LeafTrace()->push_back(leaf_id);
+        }
+#endif
+        return m_leaves[leaf_id];
     }
 
     inline bool EdgesAreEquivalent(const FixedPointCoordinate &a,
@@ -1096,7 +1763,7 @@ class StaticRTree
     }
 
     inline void InitializeMBRectangle(RectangleT &rectangle,
-                                      const std::array<EdgeDataT, LEAF_NODE_SIZE> &objects,
+                                      const std::array<LeafEntry, LEAF_NODE_SIZE> &objects,
                                       const uint32_t element_count,
                                       const std::vector<QueryNode> &coordinate_list)
     {
@@ -28,74 +28,131 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef XOR_FAST_HASH_STORAGE_HPP
 #define XOR_FAST_HASH_STORAGE_HPP
 
-#include "xor_fast_hash.hpp"
+#include "../util/prefetch.hpp"
 
+#include <boost/assert.hpp>
+
+#include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <vector>
 
-template <typename NodeID, typename Key> class XORFastHashStorage
+// Open addressing hash table with linear probing that indexes the heaps by node id. The table
+// has 2^LOG_INITIAL_CAPACITY cells to begin with and doubles whenever it gets half full, so the
+// probe sequences stay short for searches of any size. Cells are stamped with the generation of
+// the search that wrote them, clearing only starts a new generation and keeps the capacity.
+template <typename NodeID, typename Key, unsigned LOG_INITIAL_CAPACITY = 16>
+class XORFastHashStorage
 {
+    static_assert(LOG_INITIAL_CAPACITY > 0 && LOG_INITIAL_CAPACITY < 32,
+                  "capacity has to be a power of two that fits the hash");
+
   public:
     struct HashCell
     {
-        unsigned time;
-        NodeID id;
-        Key key;
-        HashCell()
-            : time(std::numeric_limits<unsigned>::max()), id(std::numeric_limits<unsigned>::max()),
-              key(std::numeric_limits<unsigned>::max())
-        {
-        }
-
-        HashCell(const HashCell &other) : time(other.key), id(other.id), key(other.time) {}
-
-        operator Key() const { return key; }
+        HashCell() : generation(0), node(0), key(0) {}
 
-        void operator=(const Key key_to_insert) { key = key_to_insert; }
+        unsigned generation;
+        NodeID node;
+        Key key;
     };
 
     XORFastHashStorage() = delete;
 
-    explicit XORFastHashStorage(size_t) : positions(2 << 16), current_timestamp(0) {}
+    explicit XORFastHashStorage(size_t)
+        : cells(std::size_t(1) << LOG_INITIAL_CAPACITY), mask(cells.size() - 1),
+          number_of_entries(0), current_generation(1)
+    {
+    }
 
-    HashCell &operator[](const NodeID node)
+    Key &operator[](const NodeID node)
     {
-        unsigned short position = fast_hasher(node);
-        while ((positions[position].time == current_timestamp) && (positions[position].id != node))
+        std::size_t position = FindPosition(node);
+        if (cells[position].generation != current_generation)
         {
-            ++position %= (2 << 16);
+            if (2 * (number_of_entries + 1) > cells.size())
+            {
+                Grow();
+                position = FindPosition(node);
+            }
+            cells[position].generation = current_generation;
+            cells[position].node = node;
+            cells[position].key = Key();
+            ++number_of_entries;
         }
-
-        positions[position].time = current_timestamp;
-        positions[position].id = node;
-        return positions[position];
+        return cells[position].key;
     }
 
     // peek into table, get key for node, think of it as a read-only operator[]
     Key peek_index(const NodeID node) const
     {
-        unsigned short position = fast_hasher(node);
-        while ((positions[position].time == current_timestamp) && (positions[position].id != node))
+        const std::size_t position = FindPosition(node);
+        if (cells[position].generation != current_generation)
         {
-            ++position %= (2 << 16);
+            return std::numeric_limits<Key>::max();
         }
-        return positions[position].key;
+        return cells[position].key;
     }
 
+    void Prefetch(const NodeID node) const { osrm::prefetch(cells.data() + Hash(node)); }
+
     void Clear()
     {
-        ++current_timestamp;
-        if (std::numeric_limits<unsigned>::max() == current_timestamp)
+        number_of_entries = 0;
+        ++current_generation;
+        if (std::numeric_limits<unsigned>::max() == current_generation)
         {
-            positions.clear();
-            positions.resize(2 << 16);
+            for (auto &cell : cells)
+            {
+                cell.generation = 0;
+            }
+            current_generation = 1;
         }
     }
 
+    std::size_t Capacity() const { return cells.size(); }
+
   private:
-    std::vector<HashCell> positions;
-    XORFastHash fast_hasher;
-    unsigned current_timestamp;
+    // xor-shift-multiply mixing of the id, the low bits select the cell
+    std::size_t Hash(const NodeID node) const
+    {
+        std::uint32_t hash = static_cast<std::uint32_t>(node);
+        hash = (hash ^ (hash >> 16)) * 0x45d9f3bu;
+        hash = (hash ^ (hash >> 16)) * 0x45d9f3bu;
+        hash = hash ^ (hash >> 16);
+        return hash & mask;
+    }
+
+    // cell of the node or the empty cell that ends its probe sequence
+    std::size_t FindPosition(const NodeID node) const
+    {
+        std::size_t position = Hash(node);
+        while (cells[position].generation == current_generation && cells[position].node != node)
+        {
+            position = (position + 1) & mask;
+        }
+        return position;
+    }
+
+    void Grow()
+    {
+        std::vector<HashCell> old_cells(cells.size() * 2);
+        old_cells.swap(cells);
+        mask = cells.size() - 1;
+        for (const auto &cell : old_cells)
+        {
+            if (cell.generation == current_generation)
+            {
+                cells[FindPosition(cell.node)] = cell;
+            }
+        }
+        BOOST_ASSERT(2 * number_of_entries <= cells.size());
+    }
+
+    std::vector<HashCell> cells;
+    std::size_t mask;
+    std::size_t number_of_entries;
+    unsigned current_generation;
 };
 
 #endif // XOR_FAST_HASH_STORAGE_HPP
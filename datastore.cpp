@@ -25,42 +25,28 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
-#include "data_structures/original_edge_data.hpp"
-#include "data_structures/range_table.hpp"
-#include "data_structures/query_edge.hpp"
-#include "data_structures/query_node.hpp"
 #include "data_structures/shared_memory_factory.hpp"
-#include "data_structures/shared_memory_vector_wrapper.hpp"
-#include "data_structures/static_graph.hpp"
-#include "data_structures/static_rtree.hpp"
-#include "data_structures/travel_mode.hpp"
-#include "data_structures/turn_instructions.hpp"
-#include "server/data_structures/datafacade_base.hpp"
+#include "server/data_structures/dataset_builder.hpp"
 #include "server/data_structures/shared_datatype.hpp"
 #include "server/data_structures/shared_barriers.hpp"
 #include "util/datastore_options.hpp"
 #include "util/simple_logger.hpp"
+#include "util/timing_util.hpp"
 #include "util/osrm_exception.hpp"
-#include "util/fingerprint.hpp"
-#include "typedefs.h"
+#include "util/make_unique.hpp"
 
-#include <osrm/coordinate.hpp>
 #include <osrm/server_paths.hpp>
 
-using RTreeLeaf = BaseDataFacade<QueryEdge::EdgeData>::RTreeLeaf;
-using RTreeNode = StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true>::TreeNode;
-using QueryGraph = StaticGraph<QueryEdge::EdgeData>;
-
 #ifdef __linux__
 #include <sys/mman.h>
 #endif
 
 #include <boost/filesystem/fstream.hpp>
-#include <boost/iostreams/seek.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
 
 #include <cstdint>
 
-#include <fstream>
+#include <memory>
 #include <string>
 
 // delete a shared memory region. report warning if it could not be deleted
@@ -84,6 +70,12 @@ void delete_region(const SharedDataType region)
                 return "DATA_2";
             case LAYOUT_NONE:
                 return "LAYOUT_NONE";
+            case STATIC_1:
+                return "STATIC_1";
+            case STATIC_2:
+                return "STATIC_2";
+            case STATIC_NONE:
+                return "STATIC_NONE";
             default: // DATA_NONE:
                 return "DATA_NONE";
             }
@@ -130,82 +122,27 @@ int main(const int argc, const char *argv[])
         SimpleLogger().Write(logDEBUG) << "Checking input parameters";
 
         ServerPaths server_paths;
-        if (!GenerateDataStoreOptions(argc, argv, server_paths))
+        SharedMemoryPlacement placement;
+        bool split_query_graph = false;
+        if (!GenerateDataStoreOptions(argc, argv, server_paths, placement, split_query_graph))
         {
             return 0;
         }
 
-        if (server_paths.find("hsgrdata") == server_paths.end())
-        {
-            throw osrm::exception("no hsgr file found");
-        }
-        if (server_paths.find("ramindex") == server_paths.end())
-        {
-            throw osrm::exception("no ram index file found");
-        }
-        if (server_paths.find("fileindex") == server_paths.end())
-        {
-            throw osrm::exception("no leaf index file found");
-        }
-        if (server_paths.find("nodesdata") == server_paths.end())
-        {
-            throw osrm::exception("no nodes file found");
-        }
-        if (server_paths.find("edgesdata") == server_paths.end())
-        {
-            throw osrm::exception("no edges file found");
-        }
-        if (server_paths.find("namesdata") == server_paths.end())
-        {
-            throw osrm::exception("no names file found");
-        }
-        if (server_paths.find("geometry") == server_paths.end())
+        // write an image file for osrm-routed --image instead of publishing to shared memory
+        ServerPaths::const_iterator paths_iterator = server_paths.find("image");
+        const boost::filesystem::path image_path =
+            server_paths.end() != paths_iterator ? paths_iterator->second : "";
+        if (!image_path.empty())
         {
-            throw osrm::exception("no geometry file found");
-        }
-        if (server_paths.find("core") == server_paths.end())
-        {
-            throw osrm::exception("no core file found");
+            WriteDatasetImage(server_paths, split_query_graph, image_path);
+            return 0;
         }
-
-        ServerPaths::const_iterator paths_iterator = server_paths.find("hsgrdata");
-        BOOST_ASSERT(server_paths.end() != paths_iterator);
-        BOOST_ASSERT(!paths_iterator->second.empty());
-        const boost::filesystem::path &hsgr_path = paths_iterator->second;
-        paths_iterator = server_paths.find("timestamp");
-        BOOST_ASSERT(server_paths.end() != paths_iterator);
-        BOOST_ASSERT(!paths_iterator->second.empty());
-        const boost::filesystem::path &timestamp_path = paths_iterator->second;
-        paths_iterator = server_paths.find("ramindex");
-        BOOST_ASSERT(server_paths.end() != paths_iterator);
-        BOOST_ASSERT(!paths_iterator->second.empty());
-        const boost::filesystem::path &ram_index_path = paths_iterator->second;
-        paths_iterator = server_paths.find("fileindex");
-        BOOST_ASSERT(server_paths.end() != paths_iterator);
-        BOOST_ASSERT(!paths_iterator->second.empty());
-        const boost::filesystem::path index_file_path_absolute =
-            boost::filesystem::canonical(paths_iterator->second);
-        const std::string &file_index_path = index_file_path_absolute.string();
-        paths_iterator = server_paths.find("nodesdata");
-        BOOST_ASSERT(server_paths.end() != paths_iterator);
-        BOOST_ASSERT(!paths_iterator->second.empty());
-        const boost::filesystem::path &nodes_data_path = paths_iterator->second;
-        paths_iterator = server_paths.find("edgesdata");
-        BOOST_ASSERT(server_paths.end() != paths_iterator);
-        BOOST_ASSERT(!paths_iterator->second.empty());
-        const boost::filesystem::path &edges_data_path = paths_iterator->second;
-        paths_iterator = server_paths.find("namesdata");
-        BOOST_ASSERT(server_paths.end() != paths_iterator);
-        BOOST_ASSERT(!paths_iterator->second.empty());
-        const boost::filesystem::path &names_data_path = paths_iterator->second;
-        paths_iterator = server_paths.find("geometry");
-        BOOST_ASSERT(server_paths.end() != paths_iterator);
-        BOOST_ASSERT(!paths_iterator->second.empty());
-        const boost::filesystem::path &geometries_data_path = paths_iterator->second;
-        paths_iterator = server_paths.find("core");
-        BOOST_ASSERT(server_paths.end() != paths_iterator);
-        BOOST_ASSERT(!paths_iterator->second.empty());
-        const boost::filesystem::path &core_marker_path = paths_iterator->second;
+        // or copy the blocks of an image to shared memory instead of converting the single files
+        paths_iterator = server_paths.find("fromimage");
+        const boost::filesystem::path from_image_path =
+            server_paths.end() != paths_iterator ? paths_iterator->second : "";
+        const bool from_image = !from_image_path.empty();
 
         // determine segment to use
         bool segment2_in_use = SharedMemory::RegionExists(LAYOUT_2);
@@ -226,353 +163,110 @@ int main(const int argc, const char *argv[])
             return segment2_in_use ? DATA_2 : DATA_1;
         }();
 
+        // the static blocks of the published dataset can be kept if their inputs did not change
+        SharedDataType previous_static_region = STATIC_NONE;
+        uint64_t previous_static_fingerprint = 0;
+        if (SharedMemory::RegionExists(CURRENT_REGIONS))
+        {
+            const SharedDataTimestamp *current_regions = static_cast<SharedDataTimestamp *>(
+                SharedMemoryFactory::Get(CURRENT_REGIONS)->Ptr());
+            if (SharedMemory::RegionExists(current_regions->layout) &&
+                SharedMemory::RegionExists(current_regions->static_data))
+            {
+                const std::unique_ptr<SharedMemory> previous_layout_memory(
+                    SharedMemoryFactory::Get(current_regions->layout));
+                previous_static_region = current_regions->static_data;
+                previous_static_fingerprint =
+                    static_cast<SharedDataLayout *>(previous_layout_memory->Ptr())
+                        ->static_blocks_fingerprint;
+            }
+        }
+
         // Allocate a memory layout in shared memory, deallocate previous
         SharedMemory *layout_memory =
             SharedMemoryFactory::Get(layout_region, sizeof(SharedDataLayout));
         SharedDataLayout *shared_layout_ptr = new (layout_memory->Ptr()) SharedDataLayout();
 
-        shared_layout_ptr->SetBlockSize<char>(SharedDataLayout::FILE_INDEX_PATH,
-                                              file_index_path.length() + 1);
-
-        // collect number of elements to store in shared memory object
-        SimpleLogger().Write() << "load names from: " << names_data_path;
-        // number of entries in name index
-        boost::filesystem::ifstream name_stream(names_data_path, std::ios::binary);
-        unsigned name_blocks = 0;
-        name_stream.read((char *)&name_blocks, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::NAME_OFFSETS, name_blocks);
-        shared_layout_ptr->SetBlockSize<typename RangeTable<16, true>::BlockT>(
-            SharedDataLayout::NAME_BLOCKS, name_blocks);
-        SimpleLogger().Write() << "name offsets size: " << name_blocks;
-        BOOST_ASSERT_MSG(0 != name_blocks, "name file broken");
-
-        unsigned number_of_chars = 0;
-        name_stream.read((char *)&number_of_chars, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<char>(SharedDataLayout::NAME_CHAR_LIST, number_of_chars);
-
-        // Loading information for original edges
-        boost::filesystem::ifstream edges_input_stream(edges_data_path, std::ios::binary);
-        unsigned number_of_original_edges = 0;
-        edges_input_stream.read((char *)&number_of_original_edges, sizeof(unsigned));
-
-        // note: settings this all to the same size is correct, we extract them from the same struct
-        shared_layout_ptr->SetBlockSize<NodeID>(SharedDataLayout::VIA_NODE_LIST,
-                                                number_of_original_edges);
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::NAME_ID_LIST,
-                                                  number_of_original_edges);
-        shared_layout_ptr->SetBlockSize<TravelMode>(SharedDataLayout::TRAVEL_MODE,
-                                                    number_of_original_edges);
-        shared_layout_ptr->SetBlockSize<TurnInstruction>(SharedDataLayout::TURN_INSTRUCTION,
-                                                         number_of_original_edges);
-        // note: there are 32 geometry indicators in one unsigned block
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_INDICATORS,
-                                                  number_of_original_edges);
-
-        boost::filesystem::ifstream hsgr_input_stream(hsgr_path, std::ios::binary);
-
-        FingerPrint fingerprint_valid = FingerPrint::GetValid();
-        FingerPrint fingerprint_loaded;
-        hsgr_input_stream.read((char *)&fingerprint_loaded, sizeof(FingerPrint));
-        if (fingerprint_loaded.TestGraphUtil(fingerprint_valid))
-        {
-            SimpleLogger().Write(logDEBUG) << "Fingerprint checked out ok";
+        // an image stores the layout in front of its blocks, the single files are sized instead
+        boost::filesystem::ifstream image_stream;
+        std::unique_ptr<DatasetBuilder> builder;
+        if (from_image)
+        {
+            SimpleLogger().Write() << "load dataset image from: " << from_image_path.string();
+            image_stream.open(from_image_path, std::ios::binary);
+            image_stream.read(reinterpret_cast<char *>(shared_layout_ptr),
+                              sizeof(SharedDataLayout));
+            if (!image_stream ||
+                boost::filesystem::file_size(from_image_path) !=
+                    SharedDataImage::Size(*shared_layout_ptr))
+            {
+                throw osrm::exception("image file " + from_image_path.string() +
+                                      " is truncated");
+            }
         }
         else
         {
-            SimpleLogger().Write(logWARNING) << ".hsgr was prepared with different build. "
-                                                "Reprocess to get rid of this warning.";
+            builder = osrm::make_unique<DatasetBuilder>(server_paths, split_query_graph,
+                                                        *shared_layout_ptr);
         }
 
-        // load checksum
-        unsigned checksum = 0;
-        hsgr_input_stream.read((char *)&checksum, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::HSGR_CHECKSUM, 1);
-        // load graph node size
-        unsigned number_of_graph_nodes = 0;
-        hsgr_input_stream.read((char *)&number_of_graph_nodes, sizeof(unsigned));
-
-        BOOST_ASSERT_MSG((0 != number_of_graph_nodes), "number of nodes is zero");
-        shared_layout_ptr->SetBlockSize<QueryGraph::NodeArrayEntry>(
-            SharedDataLayout::GRAPH_NODE_LIST, number_of_graph_nodes);
-
-        // load graph edge size
-        unsigned number_of_graph_edges = 0;
-        hsgr_input_stream.read((char *)&number_of_graph_edges, sizeof(unsigned));
-        // BOOST_ASSERT_MSG(0 != number_of_graph_edges, "number of graph edges is zero");
-        shared_layout_ptr->SetBlockSize<QueryGraph::EdgeArrayEntry>(
-            SharedDataLayout::GRAPH_EDGE_LIST, number_of_graph_edges);
-
-        // load rsearch tree size
-        boost::filesystem::ifstream tree_node_file(ram_index_path, std::ios::binary);
-
-        uint32_t tree_size = 0;
-        tree_node_file.read((char *)&tree_size, sizeof(uint32_t));
-        shared_layout_ptr->SetBlockSize<RTreeNode>(SharedDataLayout::R_SEARCH_TREE, tree_size);
-
-        // load timestamp size
-        std::string m_timestamp;
-        if (boost::filesystem::exists(timestamp_path))
+        const bool reuse_static_blocks =
+            STATIC_NONE != previous_static_region &&
+            previous_static_fingerprint == shared_layout_ptr->static_blocks_fingerprint;
+        const SharedDataType static_region = [&]
         {
-            boost::filesystem::ifstream timestamp_stream(timestamp_path);
-            if (!timestamp_stream)
+            if (reuse_static_blocks)
             {
-                SimpleLogger().Write(logWARNING) << timestamp_path
-                                                 << " not found. setting to default";
+                return previous_static_region;
             }
-            else
-            {
-                getline(timestamp_stream, m_timestamp);
-                timestamp_stream.close();
-            }
-        }
-        if (m_timestamp.empty())
-        {
-            m_timestamp = "n/a";
-        }
-        if (25 < m_timestamp.length())
-        {
-            m_timestamp.resize(25);
-        }
-        shared_layout_ptr->SetBlockSize<char>(SharedDataLayout::TIMESTAMP, m_timestamp.length());
-
-        // load core marker size
-        boost::filesystem::ifstream core_marker_file(core_marker_path, std::ios::binary);
-
-        uint32_t number_of_core_markers = 0;
-        core_marker_file.read((char *)&number_of_core_markers, sizeof(uint32_t));
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::CORE_MARKER, number_of_core_markers);
-
-        // load coordinate size
-        boost::filesystem::ifstream nodes_input_stream(nodes_data_path, std::ios::binary);
-        unsigned coordinate_list_size = 0;
-        nodes_input_stream.read((char *)&coordinate_list_size, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<FixedPointCoordinate>(SharedDataLayout::COORDINATE_LIST,
-                                                              coordinate_list_size);
-
-        // load geometries sizes
-        std::ifstream geometry_input_stream(geometries_data_path.string().c_str(),
-                                            std::ios::binary);
-        unsigned number_of_geometries_indices = 0;
-        unsigned number_of_compressed_geometries = 0;
+            return STATIC_1 == previous_static_region ? STATIC_2 : STATIC_1;
+        }();
 
-        geometry_input_stream.read((char *)&number_of_geometries_indices, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_INDEX,
-                                                  number_of_geometries_indices);
-        boost::iostreams::seek(geometry_input_stream,
-                               number_of_geometries_indices * sizeof(unsigned), BOOST_IOS::cur);
-        geometry_input_stream.read((char *)&number_of_compressed_geometries, sizeof(unsigned));
-        shared_layout_ptr->SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_LIST,
-                                                  number_of_compressed_geometries);
         // allocate shared memory block
         SimpleLogger().Write() << "allocating shared memory of "
-                               << shared_layout_ptr->GetSizeOfLayout() << " bytes";
-        SharedMemory *shared_memory =
-            SharedMemoryFactory::Get(data_region, shared_layout_ptr->GetSizeOfLayout());
+                               << shared_layout_ptr->GetSizeOfLayout(true) << " bytes";
+        SharedMemory *shared_memory = SharedMemoryFactory::Get(
+            data_region, shared_layout_ptr->GetSizeOfLayout(true), false, true, placement);
         char *shared_memory_ptr = static_cast<char *>(shared_memory->Ptr());
 
-        // read actual data into shared memory object //
-
-        // hsgr checksum
-        unsigned *checksum_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::HSGR_CHECKSUM);
-        *checksum_ptr = checksum;
-
-        // ram index file name
-        char *file_index_path_ptr = shared_layout_ptr->GetBlockPtr<char, true>(
-            shared_memory_ptr, SharedDataLayout::FILE_INDEX_PATH);
-        // make sure we have 0 ending
-        std::fill(file_index_path_ptr,
-                  file_index_path_ptr +
-                      shared_layout_ptr->GetBlockSize(SharedDataLayout::FILE_INDEX_PATH),
-                  0);
-        std::copy(file_index_path.begin(), file_index_path.end(), file_index_path_ptr);
-
-        // Loading street names
-        unsigned *name_offsets_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::NAME_OFFSETS);
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_OFFSETS) > 0)
-        {
-            name_stream.read((char *)name_offsets_ptr,
-                             shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_OFFSETS));
-        }
-
-        unsigned *name_blocks_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::NAME_BLOCKS);
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_BLOCKS) > 0)
+        char *static_memory_ptr = nullptr;
+        if (reuse_static_blocks)
         {
-            name_stream.read((char *)name_blocks_ptr,
-                             shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_BLOCKS));
+            SimpleLogger().Write() << "inputs of the static blocks are unchanged, reusing them";
         }
-
-        char *name_char_ptr = shared_layout_ptr->GetBlockPtr<char, true>(
-            shared_memory_ptr, SharedDataLayout::NAME_CHAR_LIST);
-        unsigned temp_length;
-        name_stream.read((char *)&temp_length, sizeof(unsigned));
-
-        BOOST_ASSERT_MSG(temp_length ==
-                             shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_CHAR_LIST),
-                         "Name file corrupted!");
-
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_CHAR_LIST) > 0)
+        else
         {
-            name_stream.read(name_char_ptr,
-                             shared_layout_ptr->GetBlockSize(SharedDataLayout::NAME_CHAR_LIST));
+            SimpleLogger().Write() << "allocating shared memory of "
+                                   << shared_layout_ptr->GetSizeOfLayout(false) << " bytes";
+            SharedMemory *static_memory =
+                SharedMemoryFactory::Get(static_region, shared_layout_ptr->GetSizeOfLayout(false),
+                                         false, true, placement);
+            static_memory_ptr = static_cast<char *>(static_memory->Ptr());
         }
 
-        name_stream.close();
-
-        // load original edge information
-        NodeID *via_node_ptr = shared_layout_ptr->GetBlockPtr<NodeID, true>(
-            shared_memory_ptr, SharedDataLayout::VIA_NODE_LIST);
-
-        unsigned *name_id_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::NAME_ID_LIST);
-
-        TravelMode *travel_mode_ptr = shared_layout_ptr->GetBlockPtr<TravelMode, true>(
-            shared_memory_ptr, SharedDataLayout::TRAVEL_MODE);
-
-        TurnInstruction *turn_instructions_ptr =
-            shared_layout_ptr->GetBlockPtr<TurnInstruction, true>(
-                shared_memory_ptr, SharedDataLayout::TURN_INSTRUCTION);
-
-        unsigned *geometries_indicator_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::GEOMETRIES_INDICATORS);
-
-        OriginalEdgeData current_edge_data;
-        for (unsigned i = 0; i < number_of_original_edges; ++i)
+        // read actual data into shared memory object //
+        TIMER_START(load_data);
+        if (from_image)
         {
-            edges_input_stream.read((char *)&(current_edge_data), sizeof(OriginalEdgeData));
-            via_node_ptr[i] = current_edge_data.via_node;
-            name_id_ptr[i] = current_edge_data.name_id;
-            travel_mode_ptr[i] = current_edge_data.travel_mode;
-            turn_instructions_ptr[i] = current_edge_data.turn_instruction;
-
-            const unsigned bucket = i / 32;
-            const unsigned offset = i % 32;
-            const unsigned value = [&]
-            {
-                unsigned return_value = 0;
-                if (0 != offset)
-                {
-                    return_value = geometries_indicator_ptr[bucket];
-                }
-                return return_value;
-            }();
-            if (current_edge_data.compressed_geometry)
+            // the regions are laid out as in the image, each is filled by one sequential read
+            image_stream.seekg(SharedDataImage::DataOffset());
+            image_stream.read(shared_memory_ptr, shared_layout_ptr->GetSizeOfLayout(true));
+            if (nullptr != static_memory_ptr)
             {
-                geometries_indicator_ptr[bucket] = (value | (1 << offset));
+                image_stream.seekg(SharedDataImage::StaticOffset(*shared_layout_ptr));
+                image_stream.read(static_memory_ptr, shared_layout_ptr->GetSizeOfLayout(false));
             }
-        }
-        edges_input_stream.close();
-
-        // load compressed geometry
-        unsigned temporary_value;
-        unsigned *geometries_index_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::GEOMETRIES_INDEX);
-        geometry_input_stream.seekg(0, geometry_input_stream.beg);
-        geometry_input_stream.read((char *)&temporary_value, sizeof(unsigned));
-        BOOST_ASSERT(temporary_value ==
-                     shared_layout_ptr->num_entries[SharedDataLayout::GEOMETRIES_INDEX]);
-
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::GEOMETRIES_INDEX) > 0)
-        {
-            geometry_input_stream.read(
-                (char *)geometries_index_ptr,
-                shared_layout_ptr->GetBlockSize(SharedDataLayout::GEOMETRIES_INDEX));
-        }
-        unsigned *geometries_list_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::GEOMETRIES_LIST);
-
-        geometry_input_stream.read((char *)&temporary_value, sizeof(unsigned));
-        BOOST_ASSERT(temporary_value ==
-                     shared_layout_ptr->num_entries[SharedDataLayout::GEOMETRIES_LIST]);
-
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::GEOMETRIES_LIST) > 0)
-        {
-            geometry_input_stream.read(
-                (char *)geometries_list_ptr,
-                shared_layout_ptr->GetBlockSize(SharedDataLayout::GEOMETRIES_LIST));
-        }
-
-        // Loading list of coordinates
-        FixedPointCoordinate *coordinates_ptr =
-            shared_layout_ptr->GetBlockPtr<FixedPointCoordinate, true>(
-                shared_memory_ptr, SharedDataLayout::COORDINATE_LIST);
-
-        QueryNode current_node;
-        for (unsigned i = 0; i < coordinate_list_size; ++i)
-        {
-            nodes_input_stream.read((char *)&current_node, sizeof(QueryNode));
-            coordinates_ptr[i] = FixedPointCoordinate(current_node.lat, current_node.lon);
-        }
-        nodes_input_stream.close();
-
-        // store timestamp
-        char *timestamp_ptr = shared_layout_ptr->GetBlockPtr<char, true>(
-            shared_memory_ptr, SharedDataLayout::TIMESTAMP);
-        std::copy(m_timestamp.c_str(), m_timestamp.c_str() + m_timestamp.length(), timestamp_ptr);
-
-        // store search tree portion of rtree
-        char *rtree_ptr = shared_layout_ptr->GetBlockPtr<char, true>(
-            shared_memory_ptr, SharedDataLayout::R_SEARCH_TREE);
-
-        if (tree_size > 0)
-        {
-            tree_node_file.read(rtree_ptr, sizeof(RTreeNode) * tree_size);
-        }
-        tree_node_file.close();
-
-        // load core markers
-        std::vector<char> unpacked_core_markers(number_of_core_markers);
-        core_marker_file.read((char *)unpacked_core_markers.data(), sizeof(char)*number_of_core_markers);
-
-        unsigned *core_marker_ptr = shared_layout_ptr->GetBlockPtr<unsigned, true>(
-            shared_memory_ptr, SharedDataLayout::CORE_MARKER);
-
-        for (auto i = 0u; i < number_of_core_markers; ++i)
-        {
-            BOOST_ASSERT(unpacked_core_markers[i] == 0 || unpacked_core_markers[i] == 1);
-
-            if (unpacked_core_markers[i] == 1)
+            if (!image_stream)
             {
-                const unsigned bucket = i / 32;
-                const unsigned offset = i % 32;
-                const unsigned value = [&]
-                {
-                    unsigned return_value = 0;
-                    if (0 != offset)
-                    {
-                        return_value = core_marker_ptr[bucket];
-                    }
-                    return return_value;
-                }();
-
-                core_marker_ptr[bucket] = (value | (1 << offset));
+                throw osrm::exception("could not read image file " + from_image_path.string());
             }
         }
-
-        // load the nodes of the search graph
-        QueryGraph::NodeArrayEntry *graph_node_list_ptr =
-            shared_layout_ptr->GetBlockPtr<QueryGraph::NodeArrayEntry, true>(
-                shared_memory_ptr, SharedDataLayout::GRAPH_NODE_LIST);
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_NODE_LIST) > 0)
-        {
-            hsgr_input_stream.read(
-                (char *)graph_node_list_ptr,
-                shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_NODE_LIST));
-        }
-
-        // load the edges of the search graph
-        QueryGraph::EdgeArrayEntry *graph_edge_list_ptr =
-            shared_layout_ptr->GetBlockPtr<QueryGraph::EdgeArrayEntry, true>(
-                shared_memory_ptr, SharedDataLayout::GRAPH_EDGE_LIST);
-        if (shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_EDGE_LIST) > 0)
+        else
         {
-            hsgr_input_stream.read(
-                (char *)graph_edge_list_ptr,
-                shared_layout_ptr->GetBlockSize(SharedDataLayout::GRAPH_EDGE_LIST));
+            builder->Load(shared_memory_ptr, static_memory_ptr);
         }
-        hsgr_input_stream.close();
+        TIMER_STOP(load_data);
+        SimpleLogger().Write() << "filled the data blocks in " << TIMER_SEC(load_data) << "s";
 
         // acquire lock
         SharedMemory *data_type_memory =
@@ -580,20 +274,21 @@ int main(const int argc, const char *argv[])
         SharedDataTimestamp *data_timestamp_ptr =
             static_cast<SharedDataTimestamp *>(data_type_memory->Ptr());
 
+        // Readers attached to the previous regions keep them alive until they detach, removing
+        // them only has to be serialized against osrm-routed attaching a published dataset.
         boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
             barrier.query_mutex);
 
-        // notify all processes that were waiting for this condition
-        if (0 < barrier.number_of_queries)
-        {
-            barrier.no_running_queries_condition.wait(query_lock);
-        }
-
         data_timestamp_ptr->layout = layout_region;
         data_timestamp_ptr->data = data_region;
+        data_timestamp_ptr->static_data = static_region;
         data_timestamp_ptr->timestamp += 1;
         delete_region(previous_data_region);
         delete_region(previous_layout_region);
+        if (!reuse_static_blocks && STATIC_NONE != previous_static_region)
+        {
+            delete_region(previous_static_region);
+        }
         SimpleLogger().Write() << "all data loaded";
 
         shared_layout_ptr->PrintInformation();
@@ -39,6 +39,17 @@ DescriptionFactory::DescriptionFactory() : entire_length(0) { via_indices.push_b
 
 std::vector<unsigned> const &DescriptionFactory::GetViaIndices() const { return via_indices; }
 
+void DescriptionFactory::Reserve(const std::vector<std::vector<PathData>> &unpacked_path_segments)
+{
+    // one segment per path entry, the end of every leg and the start of the route
+    std::size_t number_of_segments = path_description.size() + unpacked_path_segments.size() + 1;
+    for (const auto &path : unpacked_path_segments)
+    {
+        number_of_segments += path.size();
+    }
+    path_description.reserve(number_of_segments);
+}
+
 void DescriptionFactory::SetStartSegment(const PhantomNode &source, const bool traversed_in_reverse)
 {
     start_phantom = source;
@@ -95,7 +106,7 @@ void DescriptionFactory::AppendSegment(const FixedPointCoordinate &coordinate,
     }();
 
     path_description.emplace_back(coordinate, path_point.name_id, path_point.segment_duration, 0.f,
-                                  turn, path_point.travel_mode);
+                                  turn, path_point.travel_mode, path_point.zoom_level);
 }
 
 osrm::json::Value DescriptionFactory::AppendGeometryString(const bool return_encoded)
@@ -107,6 +118,20 @@ osrm::json::Value DescriptionFactory::AppendGeometryString(const bool return_enc
     return PolylineFormatter().printUnencodedString(path_description);
 }
 
+double DescriptionFactory::GetBearing(const std::size_t position) const
+{
+    BOOST_ASSERT(position < path_description.size());
+    const SegmentInformation &segment = path_description[position];
+    if (!segment.necessary || position + 1 == path_description.size())
+    {
+        return 0.;
+    }
+    const double angle = coordinate_calculation::bearing(segment.location,
+                                                         path_description[position + 1].location);
+    // in steps of a tenth of a degree
+    return static_cast<short>(angle * 10) / 10.;
+}
+
 void DescriptionFactory::BuildRouteSummary(const double distance, const unsigned time)
 {
     summary.source_name_id = start_phantom.name_id;
@@ -114,23 +139,13 @@ void DescriptionFactory::BuildRouteSummary(const double distance, const unsigned
     summary.BuildDurationAndLengthStrings(distance, time);
 }
 
-void DescriptionFactory::Run(const unsigned zoom_level)
+void DescriptionFactory::Run(const unsigned zoom_level, const bool use_precomputed_zoom_levels)
 {
     if (path_description.empty())
     {
         return;
     }
 
-    /** starts at index 1 */
-    path_description[0].length = 0.f;
-    for (const auto i : osrm::irange<std::size_t>(1, path_description.size()))
-    {
-        // move down names by one, q&d hack
-        path_description[i - 1].name_id = path_description[i].name_id;
-        path_description[i].length = coordinate_calculation::euclidean_distance(
-            path_description[i - 1].location, path_description[i].location);
-    }
-
     /*Simplify turn instructions
     Input :
     10. Turn left on B 36 for 20 km
@@ -175,14 +190,24 @@ void DescriptionFactory::Run(const unsigned zoom_level)
     //    }
     //
 
+    // A single pass moves down the names, computes the length of every segment and sums up the
+    // lengths and durations into the segment that starts the instruction
     float segment_length = 0.;
     EdgeWeight segment_duration = 0;
     std::size_t segment_start_index = 0;
+    path_description[0].length = 0.f;
 
     for (const auto i : osrm::irange<std::size_t>(1, path_description.size()))
     {
-        entire_length += path_description[i].length;
-        segment_length += path_description[i].length;
+        // move down names by one, q&d hack
+        path_description[i - 1].name_id = path_description[i].name_id;
+
+        const float length = coordinate_calculation::euclidean_distance(
+            path_description[i - 1].location, path_description[i].location);
+        path_description[i].length = length;
+
+        entire_length += length;
+        segment_length += length;
         segment_duration += path_description[i].duration;
         path_description[segment_start_index].length = segment_length;
         path_description[segment_start_index].duration = segment_duration;
@@ -218,12 +243,23 @@ void DescriptionFactory::Run(const unsigned zoom_level)
     }
 
     // Generalize poly line
-    polyline_generalizer.Run(path_description.begin(), path_description.end(), zoom_level);
+    if (use_precomputed_zoom_levels)
+    {
+        // every segment knows the zoom level from which on it is shown
+        for (auto &segment : path_description)
+        {
+            segment.necessary = segment.necessary || segment.zoom_level <= zoom_level;
+        }
+    }
+    else
+    {
+        polyline_generalizer.Run(path_description.begin(), path_description.end(), zoom_level);
+    }
 
     // fix what needs to be fixed else
     unsigned necessary_segments = 0; // a running index that counts the necessary pieces
     osrm::for_each_pair(
-        path_description, [&](SegmentInformation &first, const SegmentInformation &second)
+        path_description, [&](SegmentInformation &first, const SegmentInformation &)
         {
             if (!first.necessary)
             {
@@ -236,9 +272,6 @@ void DescriptionFactory::Run(const unsigned zoom_level)
             { // mark the end of a leg (of several segments)
                 via_indices.push_back(necessary_segments);
             }
-
-            const double angle = coordinate_calculation::bearing(first.location, second.location);
-            first.bearing = static_cast<short>(angle * 10);
         });
 
     via_indices.push_back(necessary_segments + 1);
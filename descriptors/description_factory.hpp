@@ -79,6 +79,8 @@ class DescriptionFactory
     // I know, declaring this public is considered bad. I'm lazy
     std::vector<SegmentInformation> path_description;
     DescriptionFactory();
+    // room for the segments of a route with the given unpacked paths of its legs
+    void Reserve(const std::vector<std::vector<PathData>> &unpacked_path_segments);
     void AppendSegment(const FixedPointCoordinate &coordinate, const PathData &data);
     void BuildRouteSummary(const double distance, const unsigned time);
     void SetStartSegment(const PhantomNode &start_phantom, const bool traversed_in_reverse);
@@ -90,7 +92,12 @@ class DescriptionFactory
 
     double get_entire_length() const { return entire_length; }
 
-    void Run(const unsigned zoom_level);
+    // Bearing in degrees from a necessary segment to the next one, 0 for all others. Only the
+    // segments that become instructions need it, so it is not computed by Run.
+    double GetBearing(const std::size_t position) const;
+
+    // generalizes with the zoom levels of the segments if they were precomputed
+    void Run(const unsigned zoom_level, const bool use_precomputed_zoom_levels = false);
 };
 
 #endif /* DESCRIPTION_FACTORY_HPP */
@@ -38,6 +38,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../util/cast.hpp"
 #include "../util/integer_range.hpp"
 #include "../util/json_renderer.hpp"
+#include "../util/memory_budget.hpp"
 #include "../util/simple_logger.hpp"
 #include "../util/string_util.hpp"
 #include "../util/timing_util.hpp"
@@ -108,10 +109,17 @@ template <class DataFacadeT> class JSONDescriptor final : public BaseDescriptor<
             return;
         }
 
+        if (raw_route.summary_only)
+        {
+            RunSummaryOnly(raw_route, json_result);
+            return;
+        }
+
         // check if first segment is non-zero
         BOOST_ASSERT(raw_route.unpacked_path_segments.size() ==
                      raw_route.segment_end_coordinates.size());
 
+        description_factory.Reserve(raw_route.unpacked_path_segments);
         description_factory.SetStartSegment(
             raw_route.segment_end_coordinates.front().source_phantom,
             raw_route.source_traversed_in_reverse.front());
@@ -129,7 +137,9 @@ template <class DataFacadeT> class JSONDescriptor final : public BaseDescriptor<
                             raw_route.target_traversed_in_reverse[i], raw_route.is_via_leg(i));
             BOOST_ASSERT(0 < added_segments);
         }
-        description_factory.Run(config.zoom_level);
+        description_factory.Run(config.zoom_level, facade->HasGeometryZoomLevels());
+        osrm::memory::Charge(description_factory.path_description.size() *
+                             sizeof(SegmentInformation));
 
         if (config.geometry)
         {
@@ -155,26 +165,7 @@ template <class DataFacadeT> class JSONDescriptor final : public BaseDescriptor<
 
         BOOST_ASSERT(!raw_route.segment_end_coordinates.empty());
 
-        osrm::json::Array json_via_points_array;
-        osrm::json::Array json_first_coordinate;
-        json_first_coordinate.values.push_back(
-            raw_route.segment_end_coordinates.front().source_phantom.location.lat /
-            COORDINATE_PRECISION);
-        json_first_coordinate.values.push_back(
-            raw_route.segment_end_coordinates.front().source_phantom.location.lon /
-            COORDINATE_PRECISION);
-        json_via_points_array.values.push_back(json_first_coordinate);
-        for (const PhantomNodes &nodes : raw_route.segment_end_coordinates)
-        {
-            std::string tmp;
-            osrm::json::Array json_coordinate;
-            json_coordinate.values.push_back(nodes.target_phantom.location.lat /
-                                             COORDINATE_PRECISION);
-            json_coordinate.values.push_back(nodes.target_phantom.location.lon /
-                                             COORDINATE_PRECISION);
-            json_via_points_array.values.push_back(json_coordinate);
-        }
-        json_result.values["via_points"] = json_via_points_array;
+        json_result.values["via_points"] = BuildViaPoints(raw_route);
 
         osrm::json::Array json_via_indices_array;
 
@@ -201,7 +192,7 @@ template <class DataFacadeT> class JSONDescriptor final : public BaseDescriptor<
             alternate_description_factory.SetEndSegment(
                 raw_route.segment_end_coordinates.back().target_phantom,
                 raw_route.alt_source_traversed_in_reverse.back());
-            alternate_description_factory.Run(config.zoom_level);
+            alternate_description_factory.Run(config.zoom_level, facade->HasGeometryZoomLevels());
 
             if (config.geometry)
             {
@@ -250,9 +241,13 @@ template <class DataFacadeT> class JSONDescriptor final : public BaseDescriptor<
             json_result.values["found_alternative"] = osrm::json::False();
         }
 
-        // Get Names for both routes
-        RouteNames route_names =
-            GenerateRouteNames(shortest_path_segments, alternative_path_segments, facade);
+        // Get Names for both routes, they are picked from the instructions
+        RouteNames route_names;
+        if (config.instructions)
+        {
+            route_names =
+                GenerateRouteNames(shortest_path_segments, alternative_path_segments, facade);
+        }
         osrm::json::Array json_route_names;
         json_route_names.values.push_back(route_names.shortest_path_name_1);
         json_route_names.values.push_back(route_names.shortest_path_name_2);
@@ -271,6 +266,56 @@ template <class DataFacadeT> class JSONDescriptor final : public BaseDescriptor<
         json_result.values["hint_data"] = BuildHintData(raw_route);
     }
 
+    inline osrm::json::Array BuildViaPoints(const InternalRouteResult &raw_route) const
+    {
+        osrm::json::Array json_via_points_array;
+        osrm::json::Array json_first_coordinate;
+        json_first_coordinate.values.push_back(
+            raw_route.segment_end_coordinates.front().source_phantom.location.lat /
+            COORDINATE_PRECISION);
+        json_first_coordinate.values.push_back(
+            raw_route.segment_end_coordinates.front().source_phantom.location.lon /
+            COORDINATE_PRECISION);
+        json_via_points_array.values.push_back(json_first_coordinate);
+        for (const PhantomNodes &nodes : raw_route.segment_end_coordinates)
+        {
+            osrm::json::Array json_coordinate;
+            json_coordinate.values.push_back(nodes.target_phantom.location.lat /
+                                             COORDINATE_PRECISION);
+            json_coordinate.values.push_back(nodes.target_phantom.location.lon /
+                                             COORDINATE_PRECISION);
+            json_via_points_array.values.push_back(json_coordinate);
+        }
+        return json_via_points_array;
+    }
+
+    // Route summary from the leg lengths of the search, without geometry and instructions
+    void RunSummaryOnly(const InternalRouteResult &raw_route, osrm::json::Object &json_result)
+    {
+        BOOST_ASSERT(raw_route.leg_lengths.size() == raw_route.segment_end_coordinates.size());
+        json_result.values["status"] = 0;
+        json_result.values["status_message"] = "Found route between points";
+
+        double route_length = 0.;
+        for (const double leg_length : raw_route.leg_lengths)
+        {
+            route_length += leg_length;
+        }
+        description_factory.summary.BuildDurationAndLengthStrings(route_length,
+                                                                  raw_route.shortest_path_length);
+        osrm::json::Object json_route_summary;
+        json_route_summary.values["total_distance"] = description_factory.summary.distance;
+        json_route_summary.values["total_time"] = description_factory.summary.duration;
+        json_route_summary.values["start_point"] = facade->get_name_for_id(
+            raw_route.segment_end_coordinates.front().source_phantom.name_id);
+        json_route_summary.values["end_point"] = facade->get_name_for_id(
+            raw_route.segment_end_coordinates.back().target_phantom.name_id);
+        json_result.values["route_summary"] = json_route_summary;
+        json_result.values["via_points"] = BuildViaPoints(raw_route);
+        json_result.values["found_alternative"] = osrm::json::False();
+        json_result.values["hint_data"] = BuildHintData(raw_route);
+    }
+
     inline osrm::json::Object BuildHintData(const InternalRouteResult& raw_route) const
     {
         osrm::json::Object json_hint_object;
@@ -279,12 +324,12 @@ template <class DataFacadeT> class JSONDescriptor final : public BaseDescriptor<
         std::string hint;
         for (const auto i : osrm::irange<std::size_t>(0, raw_route.segment_end_coordinates.size()))
         {
-            ObjectEncoder::EncodeToBase64(raw_route.segment_end_coordinates[i].source_phantom,
-                                          hint);
+            ObjectEncoder::EncodePhantomNode(raw_route.segment_end_coordinates[i].source_phantom,
+                                             hint);
             json_location_hint_array.values.push_back(hint);
         }
-        ObjectEncoder::EncodeToBase64(raw_route.segment_end_coordinates.back().target_phantom,
-                                      hint);
+        ObjectEncoder::EncodePhantomNode(raw_route.segment_end_coordinates.back().target_phantom,
+                                         hint);
         json_location_hint_array.values.push_back(hint);
         json_hint_object.values["locations"] = json_location_hint_array;
 
@@ -312,8 +357,10 @@ template <class DataFacadeT> class JSONDescriptor final : public BaseDescriptor<
         std::string temp_dist, temp_length, temp_duration, temp_bearing, temp_instruction;
 
         // Fetch data from Factory and generate a string from it.
-        for (const SegmentInformation &segment : description_factory.path_description)
+        for (const auto position :
+             osrm::irange<std::size_t>(0, description_factory.path_description.size()))
         {
+            const SegmentInformation &segment = description_factory.path_description[position];
             osrm::json::Array json_instruction_row;
             TurnInstruction current_instruction = segment.turn_instruction;
             if (TurnInstructionsClass::TurnIsNecessary(current_instruction))
@@ -350,7 +397,7 @@ template <class DataFacadeT> class JSONDescriptor final : public BaseDescriptor<
                     json_instruction_row.values.push_back(std::round(segment.duration / 10.));
                     json_instruction_row.values.push_back(
                         std::to_string(static_cast<unsigned>(segment.length)) + "m");
-                    const double bearing_value = (segment.bearing / 10.);
+                    const double bearing_value = description_factory.GetBearing(position);
                     json_instruction_row.values.push_back(bearing::get(bearing_value));
                     json_instruction_row.values.push_back(
                         static_cast<unsigned>(round(bearing_value)));
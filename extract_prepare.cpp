@@ -0,0 +1,123 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "contractor/contractor_options.hpp"
+#include "contractor/processing_chain.hpp"
+#include "data_structures/node_based_graph_data.hpp"
+#include "extractor/extractor.hpp"
+#include "extractor/extractor_options.hpp"
+#include "util/make_unique.hpp"
+#include "util/simple_logger.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <tbb/task_scheduler_init.h>
+
+#include <exception>
+#include <string>
+#include <vector>
+
+// Runs osrm-extract and osrm-prepare in one process. The node-based graph is handed over in
+// memory, thus the .osrm and .restrictions files are neither written nor read. The contraction
+// is configured by contractor.ini if it exists, otherwise the defaults of osrm-prepare apply.
+int main(int argc, char *argv[])
+{
+    try
+    {
+        LogPolicy::GetInstance().Unmute();
+        ExtractorConfig extractor_config;
+
+        const return_code result = ExtractorOptions::ParseArguments(argc, argv, extractor_config);
+
+        if (return_code::fail == result)
+        {
+            return 1;
+        }
+
+        if (return_code::exit == result)
+        {
+            return 0;
+        }
+
+        ExtractorOptions::GenerateOutputFilesNames(extractor_config);
+
+        if (1 > extractor_config.requested_num_threads)
+        {
+            SimpleLogger().Write(logWARNING) << "Number of threads must be 1 or larger";
+            return 1;
+        }
+
+        if (!boost::filesystem::is_regular_file(extractor_config.input_path))
+        {
+            SimpleLogger().Write(logWARNING)
+                << "Input file " << extractor_config.input_path.string() << " not found!";
+            return 1;
+        }
+
+        if (!boost::filesystem::is_regular_file(extractor_config.profile_path))
+        {
+            SimpleLogger().Write(logWARNING) << "Profile " << extractor_config.profile_path.string()
+                                             << " not found!";
+            return 1;
+        }
+
+        // the contractor options are parsed as if osrm-prepare was called on the .osrm file
+        std::vector<std::string> contractor_arguments = {
+            argv[0], extractor_config.output_file_name, "--profile",
+            extractor_config.profile_path.string(), "--threads",
+            std::to_string(extractor_config.requested_num_threads)};
+        std::vector<char *> contractor_argv;
+        for (auto &argument : contractor_arguments)
+        {
+            contractor_argv.push_back(&argument[0]);
+        }
+
+        ContractorConfig contractor_config;
+        if (return_code::ok != ContractorOptions::ParseArguments(
+                                   static_cast<int>(contractor_argv.size()),
+                                   contractor_argv.data(), contractor_config))
+        {
+            return 1;
+        }
+        ContractorOptions::GenerateOutputFilesNames(contractor_config);
+
+        auto graph_data = osrm::make_unique<NodeBasedGraphData>();
+        if (0 != extractor(extractor_config).run(graph_data.get()))
+        {
+            return 1;
+        }
+
+        tbb::task_scheduler_init init(contractor_config.requested_num_threads);
+
+        return Prepare(contractor_config, std::move(graph_data)).Run();
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "[exception] " << e.what();
+        return 1;
+    }
+}
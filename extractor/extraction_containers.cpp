@@ -29,8 +29,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "extraction_way.hpp"
 
 #include "../algorithms/coordinate_calculation.hpp"
+#include "../data_structures/graph_blocks.hpp"
 #include "../data_structures/node_id.hpp"
 #include "../data_structures/range_table.hpp"
+#include "../data_structures/raster_source.hpp"
 
 #include "../util/osrm_exception.hpp"
 #include "../util/simple_logger.hpp"
@@ -47,10 +49,58 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stxxl/sort>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+// Edges whose segment raster values are interpolated at once
+constexpr std::size_t SegmentBatchSize = 1024;
+// Edges whose endpoints are resolved in memory at once
+constexpr std::size_t EdgeChunkSize = 1 << 20;
+
+// Returns the sources of the profile if it sets segment_raster_source to the id of a loaded
+// raster, the values of that raster at both ends of a segment are passed to segment_function
+const SourceContainer *GetSegmentRasterSource(lua_State *segment_state, unsigned &source_id)
+{
+    luabind::object globals_table = luabind::globals(segment_state);
+    luabind::object source_id_object = globals_table["segment_raster_source"];
+    luabind::object sources_object = globals_table["sources"];
+    if (!source_id_object || luabind::type(source_id_object) != LUA_TNUMBER || !sources_object)
+    {
+        return nullptr;
+    }
+    source_id = luabind::object_cast<unsigned>(source_id_object);
+    return luabind::object_cast<SourceContainer *>(sources_object);
+}
+
+// Sorts the container in memory using all threads if its elements fit into the memory budget
+// of the external sort. Otherwise falls back to the external merge sort of stxxl.
+template <typename ContainerT, typename CompareT>
+void SortContainer(ContainerT &container, const CompareT &compare, const std::size_t memory)
+{
+    using ValueT = typename ContainerT::value_type;
+    if (container.size() * sizeof(ValueT) <= memory)
+    {
+        std::vector<ValueT> elements(container.begin(), container.end());
+        tbb::parallel_sort(elements.begin(), elements.end(), compare);
+        std::copy(elements.begin(), elements.end(), container.begin());
+        return;
+    }
+    stxxl::sort(container.begin(), container.end(), compare, memory);
+}
+}
 
 ExtractionContainers::ExtractionContainers()
+    : compress_graph(false), max_internal_node_id(0), used_node_ids_prepared(false)
 {
     // Check if stxxl can be instantiated
     stxxl::vector<unsigned> dummy_vector;
@@ -75,30 +125,47 @@ ExtractionContainers::~ExtractionContainers()
  * - map start-end nodes of ways to ways used int restrictions to compute compressed
  *   trippe representation
  * - filter nodes list to nodes that are referenced by ways
- * - merge edges with nodes to include location of start/end points and serialize
+ * - look up the locations of the start/end points of the edges and serialize
  *
+ * If graph data is given, the nodes, edges and restrictions are moved there instead of
+ * being written to the .osrm and .restrictions files.
  */
 void ExtractionContainers::PrepareData(const std::string &output_file_name,
                                        const std::string &restrictions_file_name,
                                        const std::string &name_file_name,
-                                       lua_State *segment_state)
+                                       lua_State *segment_state,
+                                       const bool compress_output,
+                                       NodeBasedGraphData *graph_data)
 {
     try
     {
-        std::ofstream file_out_stream;
-        file_out_stream.open(output_file_name.c_str(), std::ios::binary);
-        const FingerPrint fingerprint = FingerPrint::GetValid();
-        file_out_stream.write((char *)&fingerprint, sizeof(FingerPrint));
+        if (nullptr != graph_data)
+        {
+            PrepareNodes();
+            CollectNodes(*graph_data);
+            PrepareEdges(segment_state);
+            CollectEdges(*graph_data);
+            PrepareRestrictions();
+            CollectRestrictions(*graph_data);
+        }
+        else
+        {
+            compress_graph = compress_output;
+            std::ofstream file_out_stream;
+            file_out_stream.open(output_file_name.c_str(), std::ios::binary);
+            const FingerPrint fingerprint = FingerPrint::GetValid();
+            file_out_stream.write((char *)&fingerprint, sizeof(FingerPrint));
 
-        PrepareNodes();
-        WriteNodes(file_out_stream);
-        PrepareEdges(segment_state);
-        WriteEdges(file_out_stream);
+            PrepareNodes();
+            WriteNodes(file_out_stream);
+            PrepareEdges(segment_state);
+            WriteEdges(file_out_stream);
 
-        file_out_stream.close();
+            file_out_stream.close();
 
-        PrepareRestrictions();
-        WriteRestrictions(restrictions_file_name);
+            PrepareRestrictions();
+            WriteRestrictions(restrictions_file_name);
+        }
 
         WriteNames(name_file_name);
     }
@@ -142,11 +209,33 @@ void ExtractionContainers::WriteNames(const std::string& names_file_name) const
     std::cout << "ok, after " << TIMER_SEC(write_name_index) << "s" << std::endl;
 }
 
-void ExtractionContainers::PrepareNodes()
+std::vector<bool> ExtractionContainers::GetUsedNodes()
 {
+    PrepareUsedNodeIDs();
+
+    std::vector<bool> used_nodes;
+    if (!used_node_id_list.empty())
+    {
+        used_nodes.resize(static_cast<std::size_t>(used_node_id_list.back()) + 1, false);
+    }
+    for (const NodeID node_id : used_node_id_list)
+    {
+        used_nodes[node_id] = true;
+    }
+    return used_nodes;
+}
+
+void ExtractionContainers::PrepareUsedNodeIDs()
+{
+    if (used_node_ids_prepared)
+    {
+        return;
+    }
+    used_node_ids_prepared = true;
+
     std::cout << "[extractor] Sorting used nodes        ... " << std::flush;
     TIMER_START(sorting_used_nodes);
-    stxxl::sort(used_node_id_list.begin(), used_node_id_list.end(), Cmp(), stxxl_memory);
+    SortContainer(used_node_id_list, Cmp(), stxxl_memory);
     TIMER_STOP(sorting_used_nodes);
     std::cout << "ok, after " << TIMER_SEC(sorting_used_nodes) << "s" << std::endl;
 
@@ -156,17 +245,22 @@ void ExtractionContainers::PrepareNodes()
     used_node_id_list.resize(new_end - used_node_id_list.begin());
     TIMER_STOP(erasing_dups);
     std::cout << "ok, after " << TIMER_SEC(erasing_dups) << "s" << std::endl;
+}
+
+void ExtractionContainers::PrepareNodes()
+{
+    PrepareUsedNodeIDs();
 
     std::cout << "[extractor] Sorting all nodes         ... " << std::flush;
     TIMER_START(sorting_nodes);
-    stxxl::sort(all_nodes_list.begin(), all_nodes_list.end(), ExternalMemoryNodeSTXXLCompare(),
-                stxxl_memory);
+    SortContainer(all_nodes_list, ExternalMemoryNodeSTXXLCompare(), stxxl_memory);
     TIMER_STOP(sorting_nodes);
     std::cout << "ok, after " << TIMER_SEC(sorting_nodes) << "s" << std::endl;
 
     std::cout << "[extractor] Building node id map      ... " << std::flush;
     TIMER_START(id_map);
     external_to_internal_node_id_map.reserve(used_node_id_list.size());
+    internal_node_locations.reserve(used_node_id_list.size());
     auto node_iter = all_nodes_list.begin();
     auto ref_iter = used_node_id_list.begin();
     const auto all_nodes_list_end = all_nodes_list.end();
@@ -188,6 +282,7 @@ void ExtractionContainers::PrepareNodes()
         }
         BOOST_ASSERT(node_iter->node_id == *ref_iter);
         external_to_internal_node_id_map[*ref_iter] = internal_id++;
+        internal_node_locations.emplace_back(node_iter->lat, node_iter->lon);
         node_iter++;
         ref_iter++;
     }
@@ -199,115 +294,80 @@ void ExtractionContainers::PrepareNodes()
 
 void ExtractionContainers::PrepareEdges(lua_State *segment_state)
 {
-    // Sort edges by start.
-    std::cout << "[extractor] Sorting edges by start    ... " << std::flush;
-    TIMER_START(sort_edges_by_start);
-    stxxl::sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByStartID(), stxxl_memory);
-    TIMER_STOP(sort_edges_by_start);
-    std::cout << "ok, after " << TIMER_SEC(sort_edges_by_start) << "s" << std::endl;
-
-    std::cout << "[extractor] Setting start coords      ... " << std::flush;
-    TIMER_START(set_start_coords);
-    // Traverse list of edges and nodes in parallel and set start coord
-    auto node_iterator = all_nodes_list.begin();
-    auto edge_iterator = all_edges_list.begin();
-
-    const auto all_edges_list_end = all_edges_list.end();
-    const auto all_nodes_list_end = all_nodes_list.end();
-
-    while (edge_iterator != all_edges_list_end && node_iterator != all_nodes_list_end)
-    {
-        if (edge_iterator->result.source < node_iterator->node_id)
-        {
-            SimpleLogger().Write(LogLevel::logWARNING) << "Found invalid node reference " << edge_iterator->result.source;
-            edge_iterator->result.source = SPECIAL_NODEID;
-            ++edge_iterator;
-            continue;
-        }
-        if (edge_iterator->result.source > node_iterator->node_id)
-        {
-            node_iterator++;
-            continue;
-        }
-
-        // remove loops
-        if (edge_iterator->result.source == edge_iterator->result.target)
-        {
-            edge_iterator->result.source = SPECIAL_NODEID;
-            edge_iterator->result.target = SPECIAL_NODEID;
-            ++edge_iterator;
-            continue;
-        }
-
-        BOOST_ASSERT(edge_iterator->result.source == node_iterator->node_id);
-
-        // assign new node id
-        auto id_iter = external_to_internal_node_id_map.find(node_iterator->node_id);
-        BOOST_ASSERT(id_iter != external_to_internal_node_id_map.end());
-        edge_iterator->result.source = id_iter->second;
-
-        edge_iterator->source_coordinate.lat = node_iterator->lat;
-        edge_iterator->source_coordinate.lon = node_iterator->lon;
-        ++edge_iterator;
-    }
-    TIMER_STOP(set_start_coords);
-    std::cout << "ok, after " << TIMER_SEC(set_start_coords) << "s" << std::endl;
-
-    // Sort Edges by target
-    std::cout << "[extractor] Sorting edges by target   ... " << std::flush;
-    TIMER_START(sort_edges_by_target);
-    stxxl::sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByTargetID(),
-                stxxl_memory);
-    TIMER_STOP(sort_edges_by_target);
-    std::cout << "ok, after " << TIMER_SEC(sort_edges_by_target) << "s" << std::endl;
-
-    // Compute edge weights
+    // The endpoints of the edges are looked up in the locations of the used nodes instead of
+    // merging the edges sorted by start and by target with the sorted nodes. Chunks of edges
+    // are resolved in memory, in parallel unless the segment function has to be called.
     std::cout << "[extractor] Computing edge weights    ... " << std::flush;
     TIMER_START(compute_weights);
-    node_iterator = all_nodes_list.begin();
-    edge_iterator = all_edges_list.begin();
-    const auto all_edges_list_end_ = all_edges_list.end();
-    const auto all_nodes_list_end_ = all_nodes_list.end();
-
-    while (edge_iterator != all_edges_list_end_ && node_iterator != all_nodes_list_end_)
+    // native profiles come without a lua state and have no segment function
+    const bool has_segment_function =
+        nullptr != segment_state && lua_function_exists(segment_state, "segment_function");
+    unsigned segment_source_id = 0;
+    const SourceContainer *segment_sources =
+        has_segment_function ? GetSegmentRasterSource(segment_state, segment_source_id) : nullptr;
+
+    const auto resolve_endpoints = [this](InternalExtractorEdge &internal_edge)
     {
-        // skip all invalid edges
-        if (edge_iterator->result.source == SPECIAL_NODEID)
+        auto &edge = internal_edge.result;
+        // remove loops
+        if (edge.source == edge.target)
         {
-            ++edge_iterator;
-            continue;
+            edge.source = SPECIAL_NODEID;
+            edge.target = SPECIAL_NODEID;
+            return false;
         }
 
-        if (edge_iterator->result.target < node_iterator->node_id)
-        {
-            SimpleLogger().Write(LogLevel::logWARNING) << "Found invalid node reference " << edge_iterator->result.target;
-            edge_iterator->result.target = SPECIAL_NODEID;
-            ++edge_iterator;
-            continue;
-        }
-        if (edge_iterator->result.target > node_iterator->node_id)
+        const auto source_iter = external_to_internal_node_id_map.find(edge.source);
+        const auto target_iter = external_to_internal_node_id_map.find(edge.target);
+        const bool is_valid = source_iter != external_to_internal_node_id_map.end() &&
+                              target_iter != external_to_internal_node_id_map.end();
+        // assign new node ids
+        edge.source =
+            source_iter != external_to_internal_node_id_map.end() ? source_iter->second
+                                                                   : SPECIAL_NODEID;
+        edge.target =
+            target_iter != external_to_internal_node_id_map.end() ? target_iter->second
+                                                                   : SPECIAL_NODEID;
+        if (SPECIAL_NODEID != edge.source)
         {
-            ++node_iterator;
-            continue;
+            internal_edge.source_coordinate = internal_node_locations[edge.source];
         }
+        return is_valid;
+    };
 
-        BOOST_ASSERT(edge_iterator->result.target == node_iterator->node_id);
-        BOOST_ASSERT(edge_iterator->weight_data.speed >= 0);
-        BOOST_ASSERT(edge_iterator->source_coordinate.lat != std::numeric_limits<int>::min());
-        BOOST_ASSERT(edge_iterator->source_coordinate.lon != std::numeric_limits<int>::min());
-
+    const auto compute_weight = [&](InternalExtractorEdge &internal_edge,
+                                    const RasterDatum *segment_data)
+    {
+        auto &edge = internal_edge.result;
+        const FixedPointCoordinate &target_coordinate = internal_node_locations[edge.target];
         const double distance = coordinate_calculation::euclidean_distance(
-            edge_iterator->source_coordinate.lat, edge_iterator->source_coordinate.lon,
-            node_iterator->lat, node_iterator->lon);
+            internal_edge.source_coordinate.lat, internal_edge.source_coordinate.lon,
+            target_coordinate.lat, target_coordinate.lon);
 
-        if (lua_function_exists(segment_state, "segment_function"))
+        if (has_segment_function)
         {
-            luabind::call_function<void>(
-                segment_state, "segment_function",
-                boost::cref(edge_iterator->source_coordinate),
-                boost::cref(*node_iterator),
-                distance,
-                boost::ref(edge_iterator->weight_data));
+            const ExternalMemoryNode target_node(target_coordinate.lat, target_coordinate.lon,
+                                                 edge.target, false, false);
+            if (nullptr != segment_data)
+            {
+                luabind::call_function<void>(
+                    segment_state, "segment_function",
+                    boost::cref(internal_edge.source_coordinate),
+                    boost::cref(target_node),
+                    distance,
+                    boost::ref(internal_edge.weight_data),
+                    segment_data[0],
+                    segment_data[1]);
+            }
+            else
+            {
+                luabind::call_function<void>(
+                    segment_state, "segment_function",
+                    boost::cref(internal_edge.source_coordinate),
+                    boost::cref(target_node),
+                    distance,
+                    boost::ref(internal_edge.weight_data));
+            }
         }
 
         const double weight = [distance](const InternalExtractorEdge::WeightData& data) {
@@ -324,16 +384,10 @@ void ExtractionContainers::PrepareEdges(lua_State *segment_state)
                     osrm::exception("invalid weight type");
             }
             return -1.0;
-        }(edge_iterator->weight_data);
+        }(internal_edge.weight_data);
 
-        auto& edge = edge_iterator->result;
         edge.weight = std::max(1, static_cast<int>(std::floor(weight + .5)));
 
-        // assign new node id
-        auto id_iter = external_to_internal_node_id_map.find(node_iterator->node_id);
-        BOOST_ASSERT(id_iter != external_to_internal_node_id_map.end());
-        edge.target = id_iter->second;
-
         // orient edges consistently: source id < target id
         // important for multi-edge removal
         if (edge.source > edge.target)
@@ -345,15 +399,108 @@ void ExtractionContainers::PrepareEdges(lua_State *segment_state)
             edge.forward = edge.backward;
             edge.backward = temp;
         }
-        ++edge_iterator;
+    };
+
+    // the raster values at both ends of the segments are interpolated for a batch of edges
+    // at once, instead of calling back from the segment function for every coordinate
+    std::vector<InternalExtractorEdge *> batch_edges;
+    std::vector<int> batch_lons, batch_lats;
+    std::vector<RasterDatum> batch_data;
+    const auto flush_batch = [&]()
+    {
+        batch_lons.clear();
+        batch_lats.clear();
+        for (const auto batch_edge : batch_edges)
+        {
+            batch_lons.push_back(batch_edge->source_coordinate.lon);
+            batch_lats.push_back(batch_edge->source_coordinate.lat);
+        }
+        for (const auto batch_edge : batch_edges)
+        {
+            const FixedPointCoordinate &target_coordinate =
+                internal_node_locations[batch_edge->result.target];
+            batch_lons.push_back(target_coordinate.lon);
+            batch_lats.push_back(target_coordinate.lat);
+        }
+        segment_sources->getRasterInterpolateBatchFromSource(segment_source_id, batch_lons,
+                                                             batch_lats, batch_data);
+
+        const std::size_t size = batch_edges.size();
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            const RasterDatum segment_data[2] = {batch_data[i], batch_data[size + i]};
+            compute_weight(*batch_edges[i], segment_data);
+        }
+        batch_edges.clear();
+    };
+
+    std::atomic<std::size_t> number_of_invalid_edges{0};
+    std::vector<InternalExtractorEdge> chunk;
+    const std::size_t number_of_edges = all_edges_list.size();
+    for (std::size_t chunk_begin = 0; chunk_begin < number_of_edges;
+         chunk_begin += EdgeChunkSize)
+    {
+        const std::size_t chunk_end = std::min(number_of_edges, chunk_begin + EdgeChunkSize);
+        chunk.assign(all_edges_list.begin() + chunk_begin, all_edges_list.begin() + chunk_end);
+
+        // the lua state of a segment function is only used by this thread, further below
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, chunk.size()),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+                              std::size_t invalid_edges = 0;
+                              for (auto index = range.begin(); index != range.end(); ++index)
+                              {
+                                  if (!resolve_endpoints(chunk[index]))
+                                  {
+                                      ++invalid_edges;
+                                  }
+                                  else if (!has_segment_function)
+                                  {
+                                      compute_weight(chunk[index], nullptr);
+                                  }
+                              }
+                              number_of_invalid_edges += invalid_edges;
+                          });
+
+        for (auto &internal_edge : chunk)
+        {
+            if (!has_segment_function || SPECIAL_NODEID == internal_edge.result.source ||
+                SPECIAL_NODEID == internal_edge.result.target)
+            {
+                continue;
+            }
+            BOOST_ASSERT(internal_edge.weight_data.speed >= 0);
+            if (nullptr != segment_sources)
+            {
+                batch_edges.push_back(&internal_edge);
+                if (batch_edges.size() == SegmentBatchSize)
+                {
+                    flush_batch();
+                }
+            }
+            else
+            {
+                compute_weight(internal_edge, nullptr);
+            }
+        }
+        if (!batch_edges.empty())
+        {
+            flush_batch();
+        }
+
+        std::copy(chunk.begin(), chunk.end(), all_edges_list.begin() + chunk_begin);
     }
     TIMER_STOP(compute_weights);
     std::cout << "ok, after " << TIMER_SEC(compute_weights) << "s" << std::endl;
-
+    if (0 != number_of_invalid_edges)
+    {
+        SimpleLogger().Write(LogLevel::logWARNING)
+            << "Found " << number_of_invalid_edges.load() << " edges with invalid node references";
+    }
     // Sort edges by start.
     std::cout << "[extractor] Sorting edges by renumbered start ... " << std::flush;
     TIMER_START(sort_edges_by_renumbered_start);
-    stxxl::sort(all_edges_list.begin(), all_edges_list.end(), CmpEdgeByStartThenTargetID(), stxxl_memory);
+    SortContainer(all_edges_list, CmpEdgeByStartThenTargetID(), stxxl_memory);
     TIMER_STOP(sort_edges_by_renumbered_start);
     std::cout << "ok, after " << TIMER_SEC(sort_edges_by_renumbered_start) << "s" << std::endl;
 
@@ -450,8 +597,14 @@ void ExtractionContainers::WriteEdges(std::ofstream& file_out_stream) const
     unsigned number_of_used_edges = 0;
 
     auto start_position = file_out_stream.tellp();
+    if (compress_graph)
+    {
+        file_out_stream.write((char *)&graph_blocks::CompressedSectionMarker, sizeof(unsigned));
+        start_position = file_out_stream.tellp();
+    }
     file_out_stream.write((char *)&number_of_used_edges, sizeof(unsigned));
 
+    graph_blocks::EdgeBlockWriter block_writer(file_out_stream);
     for (const auto& edge : all_edges_list)
     {
         if (edge.result.source == SPECIAL_NODEID || edge.result.target == SPECIAL_NODEID)
@@ -459,9 +612,17 @@ void ExtractionContainers::WriteEdges(std::ofstream& file_out_stream) const
             continue;
         }
 
-        file_out_stream.write((char*) &edge.result, sizeof(NodeBasedEdge));
+        if (compress_graph)
+        {
+            block_writer.push_back(edge.result);
+        }
+        else
+        {
+            file_out_stream.write((char*) &edge.result, sizeof(NodeBasedEdge));
+        }
         number_of_used_edges++;
     }
+    block_writer.flush();
     TIMER_STOP(write_edges);
     std::cout << "ok, after " << TIMER_SEC(write_edges) << "s" << std::endl;
 
@@ -473,15 +634,9 @@ void ExtractionContainers::WriteEdges(std::ofstream& file_out_stream) const
     SimpleLogger().Write() << "Processed " << number_of_used_edges << " edges";
 }
 
-void ExtractionContainers::WriteNodes(std::ofstream& file_out_stream) const
+template <typename CallbackT>
+void ExtractionContainers::ForEachUsedNode(CallbackT &&callback) const
 {
-    // write dummy value, will be overwritten later
-    std::cout << "[extractor] setting number of nodes   ... " << std::flush;
-    file_out_stream.write((char *)&max_internal_node_id, sizeof(unsigned));
-    std::cout << "ok" << std::endl;
-
-    std::cout << "[extractor] Confirming/Writing used nodes     ... " << std::flush;
-    TIMER_START(write_nodes);
     // identify all used nodes by a merging step of two sorted lists
     auto node_iterator = all_nodes_list.begin();
     auto node_id_iterator = used_node_id_list.begin();
@@ -502,11 +657,95 @@ void ExtractionContainers::WriteNodes(std::ofstream& file_out_stream) const
         }
         BOOST_ASSERT(*node_id_iterator == node_iterator->node_id);
 
-        file_out_stream.write((char *)&(*node_iterator), sizeof(ExternalMemoryNode));
+        callback(*node_iterator);
 
         ++node_id_iterator;
         ++node_iterator;
     }
+}
+
+void ExtractionContainers::CollectNodes(NodeBasedGraphData &graph_data) const
+{
+    std::cout << "[extractor] Confirming/Collecting used nodes  ... " << std::flush;
+    TIMER_START(collect_nodes);
+    graph_data.nodes.reserve(max_internal_node_id);
+    ForEachUsedNode([&](const ExternalMemoryNode &node)
+                    {
+                        const NodeID internal_id = static_cast<NodeID>(graph_data.nodes.size());
+                        graph_data.nodes.emplace_back(node.lat, node.lon, node.node_id);
+                        if (node.barrier)
+                        {
+                            graph_data.barrier_nodes.push_back(internal_id);
+                        }
+                        if (node.traffic_lights)
+                        {
+                            graph_data.traffic_lights.push_back(internal_id);
+                        }
+                    });
+    TIMER_STOP(collect_nodes);
+    std::cout << "ok, after " << TIMER_SEC(collect_nodes) << "s" << std::endl;
+
+    SimpleLogger().Write() << "Processed " << graph_data.nodes.size() << " nodes";
+}
+
+void ExtractionContainers::CollectEdges(NodeBasedGraphData &graph_data) const
+{
+    std::cout << "[extractor] Collecting used egdes     ... " << std::flush;
+    TIMER_START(collect_edges);
+    for (const auto &edge : all_edges_list)
+    {
+        if (edge.result.source == SPECIAL_NODEID || edge.result.target == SPECIAL_NODEID)
+        {
+            continue;
+        }
+        graph_data.edges.push_back(edge.result);
+    }
+    TIMER_STOP(collect_edges);
+    std::cout << "ok, after " << TIMER_SEC(collect_edges) << "s" << std::endl;
+
+    SimpleLogger().Write() << "Processed " << graph_data.edges.size() << " edges";
+}
+
+void ExtractionContainers::CollectRestrictions(NodeBasedGraphData &graph_data) const
+{
+    for (const auto &restriction_container : restrictions_list)
+    {
+        if (SPECIAL_NODEID != restriction_container.restriction.from.node &&
+            SPECIAL_NODEID != restriction_container.restriction.via.node &&
+            SPECIAL_NODEID != restriction_container.restriction.to.node)
+        {
+            graph_data.restrictions.push_back(restriction_container.restriction);
+        }
+    }
+    SimpleLogger().Write() << "usable restrictions: " << graph_data.restrictions.size();
+}
+
+void ExtractionContainers::WriteNodes(std::ofstream& file_out_stream) const
+{
+    // write dummy value, will be overwritten later
+    std::cout << "[extractor] setting number of nodes   ... " << std::flush;
+    if (compress_graph)
+    {
+        file_out_stream.write((char *)&graph_blocks::CompressedSectionMarker, sizeof(unsigned));
+    }
+    file_out_stream.write((char *)&max_internal_node_id, sizeof(unsigned));
+    std::cout << "ok" << std::endl;
+
+    std::cout << "[extractor] Confirming/Writing used nodes     ... " << std::flush;
+    TIMER_START(write_nodes);
+    graph_blocks::NodeBlockWriter block_writer(file_out_stream);
+    ForEachUsedNode([&](const ExternalMemoryNode &node)
+                    {
+                        if (compress_graph)
+                        {
+                            block_writer.push_back(node);
+                        }
+                        else
+                        {
+                            file_out_stream.write((char *)&node, sizeof(ExternalMemoryNode));
+                        }
+                    });
+    block_writer.flush();
     TIMER_STOP(write_nodes);
     std::cout << "ok, after " << TIMER_SEC(write_nodes) << "s" << std::endl;
 
@@ -544,18 +783,22 @@ void ExtractionContainers::WriteRestrictions(const std::string& path) const
 
 void ExtractionContainers::PrepareRestrictions()
 {
+    if (restrictions_list.size() * sizeof(InputRestrictionContainer) <= stxxl_memory)
+    {
+        ResolveRestrictionsInMemory();
+        return;
+    }
+
     std::cout << "[extractor] Sorting used ways         ... " << std::flush;
     TIMER_START(sort_ways);
-    stxxl::sort(way_start_end_id_list.begin(), way_start_end_id_list.end(),
-                FirstAndLastSegmentOfWayStxxlCompare(), stxxl_memory);
+    SortContainer(way_start_end_id_list, FirstAndLastSegmentOfWayStxxlCompare(), stxxl_memory);
     TIMER_STOP(sort_ways);
     std::cout << "ok, after " << TIMER_SEC(sort_ways) << "s" << std::endl;
 
     std::cout << "[extractor] Sorting " << restrictions_list.size()
               << " restriction. by from... " << std::flush;
     TIMER_START(sort_restrictions);
-    stxxl::sort(restrictions_list.begin(), restrictions_list.end(),
-                CmpRestrictionContainerByFrom(), stxxl_memory);
+    SortContainer(restrictions_list, CmpRestrictionContainerByFrom(), stxxl_memory);
     TIMER_STOP(sort_restrictions);
     std::cout << "ok, after " << TIMER_SEC(sort_restrictions) << "s" << std::endl;
 
@@ -622,8 +865,7 @@ void ExtractionContainers::PrepareRestrictions()
 
     std::cout << "[extractor] Sorting restrictions. by to  ... " << std::flush;
     TIMER_START(sort_restrictions_to);
-    stxxl::sort(restrictions_list.begin(), restrictions_list.end(),
-                CmpRestrictionContainerByTo(), stxxl_memory);
+    SortContainer(restrictions_list, CmpRestrictionContainerByTo(), stxxl_memory);
     TIMER_STOP(sort_restrictions_to);
     std::cout << "ok, after " << TIMER_SEC(sort_restrictions_to) << "s" << std::endl;
 
@@ -683,3 +925,101 @@ void ExtractionContainers::PrepareRestrictions()
     TIMER_STOP(fix_restriction_ends);
     std::cout << "ok, after " << TIMER_SEC(fix_restriction_ends) << "s" << std::endl;
 }
+
+void ExtractionContainers::ResolveRestrictionsInMemory()
+{
+    std::cout << "[extractor] Indexing restricted ways  ... " << std::flush;
+    TIMER_START(index_restricted_ways);
+    std::vector<InputRestrictionContainer> restrictions(restrictions_list.begin(),
+                                                        restrictions_list.end());
+
+    // only the ways that restrictions start or end on are looked up, so their endpoints are
+    // collected in one pass over all ways instead of sorting both lists
+    const std::size_t unindexed_way = std::numeric_limits<std::size_t>::max();
+    std::unordered_map<EdgeID, std::size_t> way_positions;
+    way_positions.reserve(2 * restrictions.size());
+    for (const auto &restriction_container : restrictions)
+    {
+        way_positions.emplace(restriction_container.restriction.from.way, unindexed_way);
+        way_positions.emplace(restriction_container.restriction.to.way, unindexed_way);
+    }
+    std::vector<FirstAndLastSegmentOfWay> way_endpoints;
+    way_endpoints.reserve(way_positions.size());
+    for (const auto &way : way_start_end_id_list)
+    {
+        auto position_iter = way_positions.find(way.way_id);
+        if (position_iter != way_positions.end() && position_iter->second == unindexed_way)
+        {
+            position_iter->second = way_endpoints.size();
+            way_endpoints.push_back(way);
+        }
+    }
+    TIMER_STOP(index_restricted_ways);
+    std::cout << "ok, after " << TIMER_SEC(index_restricted_ways) << "s" << std::endl;
+
+    std::cout << "[extractor] Resolving restrictions    ... " << std::flush;
+    TIMER_START(resolve_restrictions);
+    const auto find_way = [&](const EdgeID way_id) -> const FirstAndLastSegmentOfWay *
+    {
+        const auto position_iter = way_positions.find(way_id);
+        if (position_iter == way_positions.end() || position_iter->second == unindexed_way)
+        {
+            return nullptr;
+        }
+        return &way_endpoints[position_iter->second];
+    };
+    const auto internal_node_id = [&](const NodeID node_id)
+    {
+        const auto id_iter = external_to_internal_node_id_map.find(node_id);
+        return id_iter == external_to_internal_node_id_map.end() ? SPECIAL_NODEID
+                                                                 : id_iter->second;
+    };
+    // the node next to the via node on a way that starts or ends there
+    const auto node_next_to_via = [&](const FirstAndLastSegmentOfWay *way, const NodeID via)
+    {
+        if (nullptr == way)
+        {
+            return SPECIAL_NODEID;
+        }
+        if (way->first_segment_source_id == via)
+        {
+            return internal_node_id(way->first_segment_target_id);
+        }
+        if (way->last_segment_target_id == via)
+        {
+            return internal_node_id(way->last_segment_source_id);
+        }
+        return SPECIAL_NODEID;
+    };
+
+    // the lookups only read the index and the node id map, each restriction is resolved alone
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, restrictions.size()),
+                      [&](const tbb::blocked_range<std::size_t> &range)
+                      {
+                          for (auto index = range.begin(); index != range.end(); ++index)
+                          {
+                              TurnRestriction &restriction = restrictions[index].restriction;
+                              const NodeID via_node_id = restriction.via.node;
+                              const auto from_way = find_way(restriction.from.way);
+                              const auto to_way = find_way(restriction.to.way);
+                              restriction.via.node = internal_node_id(via_node_id);
+                              restriction.from.node = node_next_to_via(from_way, via_node_id);
+                              restriction.to.node = node_next_to_via(to_way, via_node_id);
+                          }
+                      });
+
+    std::copy(restrictions.begin(), restrictions.end(), restrictions_list.begin());
+    TIMER_STOP(resolve_restrictions);
+    std::cout << "ok, after " << TIMER_SEC(resolve_restrictions) << "s" << std::endl;
+
+    const auto number_of_invalid_restrictions =
+        std::count_if(restrictions.begin(), restrictions.end(),
+                      [](const InputRestrictionContainer &restriction_container)
+                      {
+                          return SPECIAL_NODEID == restriction_container.restriction.from.node ||
+                                 SPECIAL_NODEID == restriction_container.restriction.via.node ||
+                                 SPECIAL_NODEID == restriction_container.restriction.to.node;
+                      });
+    SimpleLogger().Write(LogLevel::logDEBUG) << number_of_invalid_restrictions
+                                             << " restrictions reference invalid ways or nodes";
+}
@@ -32,10 +32,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "first_and_last_segment_of_way.hpp"
 #include "scripting_environment.hpp"
 #include "../data_structures/external_memory_node.hpp"
+#include "../data_structures/node_based_graph_data.hpp"
 #include "../data_structures/restriction.hpp"
 
+#include <osrm/coordinate.hpp>
+
 #include <stxxl/vector>
 #include <unordered_map>
+#include <vector>
 
 /**
  * Uses external memory containers from stxxl to store all the data that
@@ -52,14 +56,27 @@ class ExtractionContainers
 #else
     const static unsigned stxxl_memory = ((sizeof(std::size_t) == 4) ? INT_MAX : UINT_MAX);
 #endif
+    void PrepareUsedNodeIDs();
     void PrepareNodes();
     void PrepareRestrictions();
+    // joins the restrictions with the endpoints of their ways in memory, used if they fit into
+    // the memory budget of the external sort
+    void ResolveRestrictionsInMemory();
     void PrepareEdges(lua_State *segment_state);
 
     void WriteNodes(std::ofstream& file_out_stream) const;
     void WriteRestrictions(const std::string& restrictions_file_name) const;
     void WriteEdges(std::ofstream& file_out_stream) const;
     void WriteNames(const std::string& names_file_name) const;
+
+    template <typename CallbackT> void ForEachUsedNode(CallbackT &&callback) const;
+    void CollectNodes(NodeBasedGraphData &graph_data) const;
+    void CollectEdges(NodeBasedGraphData &graph_data) const;
+    void CollectRestrictions(NodeBasedGraphData &graph_data) const;
+
+    // nodes and edges are written as compressed blocks
+    bool compress_graph;
+
   public:
     using STXXLNodeIDVector = stxxl::vector<NodeID>;
     using STXXLNodeVector = stxxl::vector<ExternalMemoryNode>;
@@ -75,16 +92,25 @@ class ExtractionContainers
     STXXLRestrictionsVector restrictions_list;
     STXXLWayIDStartEndVector way_start_end_id_list;
     std::unordered_map<NodeID, NodeID> external_to_internal_node_id_map;
+    // locations of the used nodes by their internal id, filled by PrepareNodes
+    std::vector<FixedPointCoordinate> internal_node_locations;
     unsigned max_internal_node_id;
+    bool used_node_ids_prepared;
 
     ExtractionContainers();
 
+    // Marks the nodes used by the ways collected so far, indexed by their OSM id.
+    // No more ways may be added afterwards.
+    std::vector<bool> GetUsedNodes();
+
     ~ExtractionContainers();
 
     void PrepareData(const std::string &output_file_name,
                      const std::string &restrictions_file_name,
                      const std::string &names_file_name,
-                     lua_State *segment_state);
+                     lua_State *segment_state,
+                     const bool compress_output,
+                     NodeBasedGraphData *graph_data = nullptr);
 };
 
 #endif /* EXTRACTION_CONTAINERS_HPP */
@@ -28,93 +28,34 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef EXTRACTION_HELPER_FUNCTIONS_HPP
 #define EXTRACTION_HELPER_FUNCTIONS_HPP
 
-#include "../util/cast.hpp"
-#include "../util/iso_8601_duration_parser.hpp"
-
-#include <boost/algorithm/string.hpp>
-#include <boost/algorithm/string_regex.hpp>
-#include <boost/spirit/include/qi.hpp>
-#include <boost/regex.hpp>
+#include "../util/tag_value_parser.hpp"
 
+#include <cstring>
 #include <limits>
-#include <string>
-
-bool simple_duration_is_valid(const std::string &s)
-{
-    boost::regex simple_format(
-        "((\\d|\\d\\d):(\\d|\\d\\d):(\\d|\\d\\d))|((\\d|\\d\\d):(\\d|\\d\\d))|(\\d|\\d\\d)",
-        boost::regex_constants::icase | boost::regex_constants::perl);
-
-    const bool simple_matched = regex_match(s, simple_format);
-
-    if (simple_matched)
-    {
-        return true;
-    }
-    return false;
-}
-
-bool iso_8601_duration_is_valid(const std::string &s)
-{
-    iso_8601_grammar<std::string::const_iterator> iso_parser;
-    const bool result = qi::parse(s.begin(), s.end(), iso_parser);
 
-    // check if the was an error with the request
-    if (result && (0 != iso_parser.get_duration()))
-    {
-        return true;
-    }
-    return false;
-}
+// The functions below are bound into the profiles. They take plain C strings so that Lua
+// hands its string data over without a copy.
 
-bool durationIsValid(const std::string &s)
+inline bool durationIsValid(const char *s)
 {
-    return simple_duration_is_valid(s) || iso_8601_duration_is_valid(s);
+    unsigned duration;
+    return tag_value::parse_duration(s, s + std::strlen(s), duration);
 }
 
-unsigned parseDuration(const std::string &s)
+inline unsigned parseDuration(const char *s)
 {
-    if (simple_duration_is_valid(s))
-    {
-        unsigned hours = 0;
-        unsigned minutes = 0;
-        unsigned seconds = 0;
-        boost::regex e(
-            "((\\d|\\d\\d):(\\d|\\d\\d):(\\d|\\d\\d))|((\\d|\\d\\d):(\\d|\\d\\d))|(\\d|\\d\\d)",
-            boost::regex_constants::icase | boost::regex_constants::perl);
-
-        std::vector<std::string> result;
-        boost::algorithm::split_regex(result, s, boost::regex(":"));
-        const bool matched = regex_match(s, e);
-        if (matched)
-        {
-            if (1 == result.size())
-            {
-                minutes = std::stoul(result[0]);
-            }
-            if (2 == result.size())
-            {
-                minutes = std::stoul(result[1]);
-                hours = std::stoul(result[0]);
-            }
-            if (3 == result.size())
-            {
-                seconds = std::stoul(result[2]);
-                minutes = std::stoul(result[1]);
-                hours = std::stoul(result[0]);
-            }
-            return (3600 * hours + 60 * minutes + seconds);
-        }
-    }
-    else if (iso_8601_duration_is_valid(s))
+    unsigned duration;
+    if (tag_value::parse_duration(s, s + std::strlen(s), duration))
     {
-        iso_8601_grammar<std::string::const_iterator> iso_parser;
-        qi::parse(s.begin(), s.end(), iso_parser);
-
-        return iso_parser.get_duration();
+        return duration;
     }
-
     return std::numeric_limits<unsigned>::max();
 }
 
+// km/h, 0 if the value does not start with a number
+inline double parseMaxspeed(const char *s) { return tag_value::parse_speed(s, s + std::strlen(s)); }
+
+// meters, 0 if the value does not start with a number
+inline double parseLength(const char *s) { return tag_value::parse_length(s, s + std::strlen(s)); }
+
 #endif // EXTRACTION_HELPER_FUNCTIONS_HPP
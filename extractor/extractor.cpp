@@ -31,8 +31,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "extraction_node.hpp"
 #include "extraction_way.hpp"
 #include "extractor_callbacks.hpp"
+#include "lua_tag_list.hpp"
+#include "native_profile.hpp"
 #include "restriction_parser.hpp"
 #include "scripting_environment.hpp"
+#include "way_result_cache.hpp"
 
 #include "../data_structures/raster_source.hpp"
 #include "../util/make_unique.hpp"
@@ -50,7 +53,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osmium/io/any_input.hpp>
 
+#include <tbb/concurrent_vector.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
 #include <tbb/task_scheduler_init.h>
 
 #include <cstdlib>
@@ -60,10 +66,151 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+namespace
+{
+// An input buffer travelling through the parsing pipeline. The profile and the callbacks
+// process consecutive chunks of its entities in parallel, each into its own result buffer.
+struct ParsedBuffer
+{
+    explicit ParsedBuffer(osmium::memory::Buffer input_buffer) : buffer(std::move(input_buffer))
+    {
+        for (auto iter = std::begin(buffer), end = std::end(buffer); iter != end; ++iter)
+        {
+            osm_elements.push_back(iter);
+        }
+    }
+
+    osmium::memory::Buffer buffer;
+    std::vector<osmium::memory::Buffer::const_iterator> osm_elements;
+    std::vector<ExtractorCallbacks::Buffer> results;
+    // profile results of the ways by element, only kept if a way cache is used
+    std::vector<ExtractionWay> way_results;
+    // whether the way result of an element was taken from the way cache
+    std::vector<char> cached_ways;
+};
+
+// number of entities of an input buffer that are processed as one chunk
+constexpr std::size_t ParsingChunkSize = 512;
+
+// Reads the keys a profile declares as relevant to one of its functions from the global table
+// of the given name. Returns false if the profile declares none.
+bool GetProfileKeys(lua_State *lua_state,
+                    const char *table_name,
+                    std::vector<std::string> &function_keys)
+{
+    const luabind::object keys = luabind::globals(lua_state)[table_name];
+    if (luabind::type(keys) != LUA_TTABLE)
+    {
+        return false;
+    }
+    for (luabind::iterator key(keys), end; key != end; ++key)
+    {
+        function_keys.push_back(luabind::object_cast<std::string>(*key));
+    }
+    return true;
+}
+
+// Results of the way_function by the values of the keys the profile declares in
+// way_function_keys. A profile may only declare them if its way_function reads nothing but the
+// tags of these keys, then ways with the same values get the same result. Every thread keeps
+// its own cache, it starts over once it holds MaxEntries results.
+class WayFunctionCache
+{
+  public:
+    static constexpr std::size_t MaxEntries = 1 << 18;
+
+    // the presence and value of every relevant key, separated by zero bytes
+    static void BuildKey(const osmium::Way &way,
+                         const std::vector<std::string> &way_function_keys,
+                         std::string &cache_key)
+    {
+        cache_key.clear();
+        for (const auto &key : way_function_keys)
+        {
+            const char *value = way.tags().get_value_by_key(key.c_str());
+            if (nullptr != value)
+            {
+                cache_key += '=';
+                cache_key += value;
+            }
+            cache_key += '\0';
+        }
+    }
+
+    const ExtractionWay *Find(const std::string &cache_key) const
+    {
+        const auto iter = results.find(cache_key);
+        return iter == results.end() ? nullptr : &iter->second;
+    }
+
+    void Insert(const std::string &cache_key, const ExtractionWay &result)
+    {
+        if (results.size() >= MaxEntries)
+        {
+            results.clear();
+        }
+        results.emplace(cache_key, result);
+    }
+
+  private:
+    std::unordered_map<std::string, ExtractionWay> results;
+};
+
+// Reads the results of the unchanged ways of the buffer from the cache. The buffers arrive in
+// input order, so the ways are looked up in ascending id order.
+void LookUpCachedWays(WayResultCacheReader &way_cache_reader, ParsedBuffer &parsed)
+{
+    parsed.way_results.resize(parsed.osm_elements.size());
+    parsed.cached_ways.resize(parsed.osm_elements.size(), false);
+    for (std::size_t x = 0; x < parsed.osm_elements.size(); ++x)
+    {
+        const auto entity = parsed.osm_elements[x];
+        if (entity->type() == osmium::item_type::way)
+        {
+            const auto &way = static_cast<const osmium::Way &>(*entity);
+            parsed.cached_ways[x] = way.version() > 0 &&
+                                    way_cache_reader.Find(way.id(), way.version(),
+                                                          parsed.way_results[x]);
+        }
+    }
+}
+
+void WriteCachedWays(const ParsedBuffer &parsed, WayResultCacheWriter &way_cache_writer)
+{
+    for (std::size_t x = 0; x < parsed.osm_elements.size(); ++x)
+    {
+        const auto entity = parsed.osm_elements[x];
+        if (entity->type() == osmium::item_type::way)
+        {
+            const auto &way = static_cast<const osmium::Way &>(*entity);
+            if (way.version() > 0)
+            {
+                way_cache_writer.Write(way.id(), way.version(), parsed.way_results[x]);
+            }
+        }
+    }
+}
+
+bool HasAnyKey(const osmium::Node &node, const std::vector<std::string> &keys)
+{
+    for (const osmium::Tag &tag : node.tags())
+    {
+        if (std::find(keys.begin(), keys.end(), tag.key()) != keys.end())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+}
+
 /**
  * TODO: Refactor this function into smaller functions for better readability.
  *
@@ -82,7 +229,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *  .restrictions : Turn restrictions that are used my osrm-prepare to construct the edge-expanded graph
  *
  */
-int extractor::run()
+int extractor::run(NodeBasedGraphData *graph_data)
 {
     try
     {
@@ -98,6 +245,15 @@ int extractor::run()
         SimpleLogger().Write() << "Profile: " << config.profile_path.filename().string();
         SimpleLogger().Write() << "Threads: " << number_of_threads;
 
+        // a native profile replaces the lua states, then none is ever created
+        std::shared_ptr<const NativeProfile> native_profile = config.native_profile;
+        if (!native_profile && IsNativeProfile(config.profile_path))
+        {
+            native_profile = LoadNativeProfile(config.profile_path);
+        }
+        const NativeProfileProperties native_properties =
+            native_profile ? native_profile->GetProperties() : NativeProfileProperties();
+
         // setup scripting environment
         ScriptingEnvironment scripting_environment(config.profile_path.string().c_str());
 
@@ -105,7 +261,12 @@ int extractor::run()
         auto extractor_callbacks = osrm::make_unique<ExtractorCallbacks>(extraction_containers);
 
         const osmium::io::File input_file(config.input_path.string());
-        osmium::io::Reader reader(input_file);
+        // a two-pass run reads the nodes only after all ways are known
+        osmium::io::Reader reader(input_file,
+                                  config.two_pass
+                                      ? (osmium::osm_entity_bits::way |
+                                         osmium::osm_entity_bits::relation)
+                                      : osmium::osm_entity_bits::all);
         const osmium::io::Header header = reader.header();
 
         std::atomic<unsigned> number_of_nodes{0};
@@ -116,9 +277,10 @@ int extractor::run()
         SimpleLogger().Write() << "Parsing in progress..";
         TIMER_START(parsing);
 
-        lua_State *segment_state = scripting_environment.get_lua_state();
+        lua_State *segment_state =
+            native_profile ? nullptr : scripting_environment.get_lua_state();
 
-        if (lua_function_exists(segment_state, "source_function"))
+        if (nullptr != segment_state && lua_function_exists(segment_state, "source_function"))
         {
             // bind a single instance of SourceContainer class to relevant lua state
             SourceContainer sources;
@@ -146,89 +308,249 @@ int extractor::run()
         timestamp_out.write(timestamp.c_str(), timestamp.length());
         timestamp_out.close();
 
-        // initialize vectors holding parsed objects
-        tbb::concurrent_vector<std::pair<std::size_t, ExtractionNode>> resulting_nodes;
-        tbb::concurrent_vector<std::pair<std::size_t, ExtractionWay>> resulting_ways;
-        tbb::concurrent_vector<boost::optional<InputRestrictionContainer>> resulting_restrictions;
-
         // setup restriction parser
-        const RestrictionParser restriction_parser(scripting_environment.get_lua_state());
+        const RestrictionParser restriction_parser =
+            native_profile ? RestrictionParser(native_properties.use_turn_restrictions,
+                                               native_properties.restriction_exceptions)
+                           : RestrictionParser(segment_state);
+
+        std::vector<std::string> node_function_keys = native_properties.node_function_keys;
+        const bool filter_nodes =
+            native_profile ? !node_function_keys.empty()
+                           : GetProfileKeys(segment_state, "node_function_keys",
+                                            node_function_keys);
+        if (filter_nodes)
+        {
+            SimpleLogger().Write() << "passing only nodes with " << node_function_keys.size()
+                                   << " keys to the node function";
+        }
+        std::atomic<unsigned> number_of_filtered_nodes{0};
+
+        // ways that agree on all keys the way_function reads share its result
+        std::vector<std::string> way_function_keys;
+        const bool memoize_ways =
+            !native_profile &&
+            GetProfileKeys(segment_state, "way_function_keys", way_function_keys);
+        if (memoize_ways)
+        {
+            SimpleLogger().Write() << "reusing the way function results of ways that agree on "
+                                   << way_function_keys.size() << " keys";
+        }
+        tbb::enumerable_thread_specific<WayFunctionCache> way_function_caches;
+        std::atomic<unsigned> number_of_memoized_ways{0};
+
+        // ways whose id and version did not change keep the profile result of the last run,
+        // inputs without versions are always passed to the profile
+        const bool use_way_cache = !config.way_cache_path.empty();
+        std::unique_ptr<WayResultCacheReader> way_cache_reader;
+        std::unique_ptr<WayResultCacheWriter> way_cache_writer;
+        if (use_way_cache)
+        {
+            const uint64_t profile_hash = HashProfile(config.profile_path);
+            way_cache_reader =
+                osrm::make_unique<WayResultCacheReader>(config.way_cache_path, profile_hash);
+            way_cache_writer =
+                osrm::make_unique<WayResultCacheWriter>(config.way_cache_path, profile_hash);
+        }
+        std::atomic<unsigned> number_of_cached_ways{0};
 
-        while (const osmium::memory::Buffer buffer = reader.read())
+        // in the second pass of a two-pass run only the nodes used by ways are kept
+        const std::vector<bool> *used_nodes = nullptr;
+        std::atomic<unsigned> number_of_unused_nodes{0};
+
+        // runs the profile and the callbacks on a chunk of the entities of a buffer
+        const auto process_chunk = [&](ParsedBuffer &parsed, const std::size_t chunk)
         {
-            // create a vector of iterators into the buffer
-            std::vector<osmium::memory::Buffer::const_iterator> osm_elements;
-            for (auto iter = std::begin(buffer), end = std::end(buffer); iter != end; ++iter)
+            ExtractionNode result_node;
+            ExtractionWay result_way;
+            lua_State *local_state =
+                native_profile ? nullptr : scripting_environment.get_lua_state();
+            LuaTagList *tag_list = native_profile ? nullptr : &scripting_environment.get_tag_list();
+            WayFunctionCache &way_function_cache = way_function_caches.local();
+            std::string way_cache_key;
+
+            auto &results = parsed.results[chunk];
+            const auto &osm_elements = parsed.osm_elements;
+            const auto chunk_end = std::min(osm_elements.size(), (chunk + 1) * ParsingChunkSize);
+            for (auto x = chunk * ParsingChunkSize; x != chunk_end; ++x)
             {
-                osm_elements.push_back(iter);
-            }
+                const auto entity = osm_elements[x];
 
-            // clear resulting vectors
-            resulting_nodes.clear();
-            resulting_ways.clear();
-            resulting_restrictions.clear();
-
-            // parse OSM entities in parallel, store in resulting vectors
-            tbb::parallel_for(
-                tbb::blocked_range<std::size_t>(0, osm_elements.size()),
-                [&](const tbb::blocked_range<std::size_t> &range)
+                switch (entity->type())
                 {
-                    ExtractionNode result_node;
-                    ExtractionWay result_way;
-                    lua_State *local_state = scripting_environment.get_lua_state();
-
-                    for (auto x = range.begin(), end = range.end(); x != end; ++x)
+                case osmium::item_type::node:
+                {
+                    const auto &node = static_cast<const osmium::Node &>(*entity);
+                    ++number_of_nodes;
+                    if (nullptr != used_nodes)
                     {
-                        const auto entity = osm_elements[x];
-
-                        switch (entity->type())
+                        const auto node_id = static_cast<NodeID>(node.id());
+                        if (node_id >= used_nodes->size() || !(*used_nodes)[node_id])
                         {
-                        case osmium::item_type::node:
-                            result_node.clear();
-                            ++number_of_nodes;
-                            luabind::call_function<void>(
-                                local_state, "node_function",
-                                boost::cref(static_cast<const osmium::Node &>(*entity)),
-                                boost::ref(result_node));
-                            resulting_nodes.push_back(std::make_pair(x, result_node));
-                            break;
-                        case osmium::item_type::way:
-                            result_way.clear();
-                            ++number_of_ways;
-                            luabind::call_function<void>(
-                                local_state, "way_function",
-                                boost::cref(static_cast<const osmium::Way &>(*entity)),
-                                boost::ref(result_way));
-                            resulting_ways.push_back(std::make_pair(x, result_way));
-                            break;
-                        case osmium::item_type::relation:
-                            ++number_of_relations;
-                            resulting_restrictions.push_back(restriction_parser.TryParse(
-                                static_cast<const osmium::Relation &>(*entity)));
-                            break;
-                        default:
-                            ++number_of_others;
+                            ++number_of_unused_nodes;
                             break;
                         }
                     }
-                });
-
-            // put parsed objects thru extractor callbacks
-            for (const auto &result : resulting_nodes)
-            {
-                extractor_callbacks->ProcessNode(
-                    static_cast<const osmium::Node &>(*(osm_elements[result.first])),
-                    result.second);
-            }
-            for (const auto &result : resulting_ways)
-            {
-                extractor_callbacks->ProcessWay(
-                    static_cast<const osmium::Way &>(*(osm_elements[result.first])), result.second);
-            }
-            for (const auto &result : resulting_restrictions)
-            {
-                extractor_callbacks->ProcessRestriction(result);
+                    result_node.clear();
+                    if (filter_nodes && !HasAnyKey(node, node_function_keys))
+                    {
+                        // the profile would not change the result
+                        ++number_of_filtered_nodes;
+                    }
+                    else if (native_profile)
+                    {
+                        native_profile->ProcessNode(node, result_node);
+                    }
+                    else
+                    {
+                        tag_list->Set(node.tags());
+                        luabind::call_function<void>(local_state, "node_function",
+                                                     boost::cref(node), boost::ref(result_node),
+                                                     tag_list->Get());
+                        tag_list->Reset();
+                    }
+                    extractor_callbacks->ProcessNode(node, result_node, results);
+                    break;
+                }
+                case osmium::item_type::way:
+                {
+                    const auto &way = static_cast<const osmium::Way &>(*entity);
+                    ++number_of_ways;
+                    ExtractionWay &current_way =
+                        use_way_cache ? parsed.way_results[x] : result_way;
+                    if (use_way_cache && parsed.cached_ways[x])
+                    {
+                        ++number_of_cached_ways;
+                    }
+                    else
+                    {
+                        const ExtractionWay *memoized_way = nullptr;
+                        if (memoize_ways)
+                        {
+                            WayFunctionCache::BuildKey(way, way_function_keys, way_cache_key);
+                            memoized_way = way_function_cache.Find(way_cache_key);
+                        }
+                        if (nullptr != memoized_way)
+                        {
+                            ++number_of_memoized_ways;
+                            current_way = *memoized_way;
+                        }
+                        else if (native_profile)
+                        {
+                            current_way.clear();
+                            native_profile->ProcessWay(way, current_way);
+                        }
+                        else
+                        {
+                            current_way.clear();
+                            tag_list->Set(way.tags());
+                            luabind::call_function<void>(local_state, "way_function",
+                                                         boost::cref(way),
+                                                         boost::ref(current_way), tag_list->Get());
+                            tag_list->Reset();
+                            if (memoize_ways)
+                            {
+                                way_function_cache.Insert(way_cache_key, current_way);
+                            }
+                        }
+                    }
+                    extractor_callbacks->ProcessWay(way, current_way, results);
+                    break;
+                }
+                case osmium::item_type::relation:
+                    ++number_of_relations;
+                    extractor_callbacks->ProcessRestriction(
+                        restriction_parser.TryParse(static_cast<const osmium::Relation &>(*entity)),
+                        results);
+                    break;
+                default:
+                    ++number_of_others;
+                    break;
+                }
             }
+        };
+
+        // Reading the input, running the profile and feeding the callbacks overlap in a
+        // pipeline. The number of buffers in flight bounds the memory held by the stages.
+        const unsigned max_buffers_in_flight = 2 * number_of_threads;
+        const auto parse_input = [&](osmium::io::Reader &input_reader)
+        {
+            tbb::parallel_pipeline(
+                max_buffers_in_flight,
+                tbb::make_filter<void, ParsedBuffer *>(
+                    tbb::filter::serial_in_order,
+                    [&](tbb::flow_control &flow_control) -> ParsedBuffer *
+                    {
+                        osmium::memory::Buffer buffer = input_reader.read();
+                        if (!buffer)
+                        {
+                            flow_control.stop();
+                            return nullptr;
+                        }
+                        auto parsed = new ParsedBuffer(std::move(buffer));
+                        if (use_way_cache)
+                        {
+                            LookUpCachedWays(*way_cache_reader, *parsed);
+                        }
+                        return parsed;
+                    }) &
+                    // parse OSM entities in parallel, store in the result buffers of the chunks
+                    tbb::make_filter<ParsedBuffer *, ParsedBuffer *>(
+                        tbb::filter::parallel,
+                        [&](ParsedBuffer *parsed) -> ParsedBuffer *
+                        {
+                            parsed->results.resize(
+                                (parsed->osm_elements.size() + ParsingChunkSize - 1) /
+                                ParsingChunkSize);
+                            tbb::parallel_for(
+                                tbb::blocked_range<std::size_t>(0, parsed->results.size(), 1),
+                                [&](const tbb::blocked_range<std::size_t> &range)
+                                {
+                                    for (auto chunk = range.begin(); chunk != range.end(); ++chunk)
+                                    {
+                                        process_chunk(*parsed, chunk);
+                                    }
+                                });
+                            return parsed;
+                        }) &
+                    // append the results to the external memory containers, in input order
+                    tbb::make_filter<ParsedBuffer *, void>(
+                        tbb::filter::serial_in_order,
+                        [&](ParsedBuffer *parsed)
+                        {
+                            const std::unique_ptr<ParsedBuffer> owned_buffer(parsed);
+                            for (auto &results : parsed->results)
+                            {
+                                extractor_callbacks->FlushBuffer(results);
+                            }
+                            if (use_way_cache)
+                            {
+                                WriteCachedWays(*parsed, *way_cache_writer);
+                            }
+                        }));
+        };
+
+        parse_input(reader);
+        reader.close();
+
+        if (config.two_pass)
+        {
+            // the ways are known, read the nodes again and drop those no way references
+            SimpleLogger().Write() << "Reading the nodes used by ways ..";
+            const std::vector<bool> used_node_bitmap = extraction_containers.GetUsedNodes();
+            used_nodes = &used_node_bitmap;
+            osmium::io::Reader node_reader(input_file, osmium::osm_entity_bits::node);
+            parse_input(node_reader);
+            node_reader.close();
+            used_nodes = nullptr;
+        }
+        extractor_callbacks->FlushNames();
+        if (use_way_cache)
+        {
+            way_cache_writer->Commit();
+            SimpleLogger().Write() << number_of_cached_ways.load() << " of "
+                                   << number_of_ways.load()
+                                   << " ways kept the profile result of the way cache";
         }
         TIMER_STOP(parsing);
         SimpleLogger().Write() << "Parsing finished after " << TIMER_SEC(parsing) << " seconds";
@@ -237,6 +559,21 @@ int extractor::run()
                                << number_of_ways.load() << " ways, and "
                                << number_of_relations.load() << " relations, and "
                                << number_of_others.load() << " unknown entities";
+        if (config.two_pass)
+        {
+            SimpleLogger().Write() << number_of_unused_nodes.load()
+                                   << " nodes were dropped since no way uses them";
+        }
+        if (filter_nodes)
+        {
+            SimpleLogger().Write() << number_of_filtered_nodes.load()
+                                   << " nodes were not passed to the node function";
+        }
+        if (memoize_ways)
+        {
+            SimpleLogger().Write() << number_of_memoized_ways.load()
+                                   << " ways reused the way function result of an earlier way";
+        }
 
         extractor_callbacks.reset();
 
@@ -249,13 +586,18 @@ int extractor::run()
         extraction_containers.PrepareData(config.output_file_name,
                                           config.restriction_file_name,
                                           config.names_file_name,
-                                          segment_state);
+                                          segment_state,
+                                          config.compress_graph,
+                                          graph_data);
 
         TIMER_STOP(extracting);
         SimpleLogger().Write() << "extraction finished after " << TIMER_SEC(extracting) << "s";
-        SimpleLogger().Write() << "To prepare the data for routing, run: "
-                               << "./osrm-prepare " << config.output_file_name
-                               << std::endl;
+        if (nullptr == graph_data)
+        {
+            SimpleLogger().Write() << "To prepare the data for routing, run: "
+                                   << "./osrm-prepare " << config.output_file_name
+                                   << std::endl;
+        }
     }
     catch (std::exception &e)
     {
@@ -30,11 +30,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "extractor_options.hpp"
 
+struct NodeBasedGraphData;
+
 class extractor
 {
 public:
   extractor(ExtractorConfig extractor_config) : config(std::move(extractor_config)) {}
-    int run();
+    // the node-based graph is moved to graph_data instead of the .osrm and .restrictions files
+    int run(NodeBasedGraphData *graph_data = nullptr);
 private:
    ExtractorConfig config;
 };
@@ -41,6 +41,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/coordinate.hpp>
 
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <string>
 #include <vector>
@@ -48,19 +50,67 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ExtractorCallbacks::ExtractorCallbacks(ExtractionContainers &extraction_containers)
     : external_memory(extraction_containers)
 {
-    string_map[""] = 0;
+    // the containers hold the empty name with id 0 already
+    string_map.insert(std::make_pair(std::string(), 0u));
+    names.push_back(std::string());
+}
+
+unsigned ExtractorCallbacks::GetNameID(const std::string &name)
+{
+    // most names are known already and only need a read lock
+    {
+        tbb::concurrent_hash_map<std::string, unsigned>::const_accessor accessor;
+        if (string_map.find(accessor, name))
+        {
+            return accessor->second;
+        }
+    }
+    tbb::concurrent_hash_map<std::string, unsigned>::accessor accessor;
+    if (string_map.insert(accessor, name))
+    {
+        // the id of the name is its position in the list of names
+        accessor->second =
+            static_cast<unsigned>(std::distance(names.begin(), names.push_back(name)));
+    }
+    return accessor->second;
 }
 
 /**
- * Takes the node position from osmium and the filtered properties from the lua
- * profile and saves them to external memory.
+ * Appends the buffered results to the external memory containers and clears the buffer.
  *
  * warning: caller needs to take care of synchronization!
  */
+void ExtractorCallbacks::FlushBuffer(Buffer &buffer)
+{
+    std::copy(buffer.nodes.begin(), buffer.nodes.end(),
+              std::back_inserter(external_memory.all_nodes_list));
+    std::copy(buffer.used_node_ids.begin(), buffer.used_node_ids.end(),
+              std::back_inserter(external_memory.used_node_id_list));
+    std::copy(buffer.edges.begin(), buffer.edges.end(),
+              std::back_inserter(external_memory.all_edges_list));
+    std::copy(buffer.way_start_end_ids.begin(), buffer.way_start_end_ids.end(),
+              std::back_inserter(external_memory.way_start_end_id_list));
+    std::copy(buffer.restrictions.begin(), buffer.restrictions.end(),
+              std::back_inserter(external_memory.restrictions_list));
+    buffer = Buffer();
+}
+
+void ExtractorCallbacks::FlushNames()
+{
+    BOOST_ASSERT(external_memory.name_list.size() == 1);
+    std::copy(names.begin() + 1, names.end(), std::back_inserter(external_memory.name_list));
+    names.clear();
+}
+
+/**
+ * Takes the node position from osmium and the filtered properties from the lua
+ * profile and saves them to the buffer.
+ */
 void ExtractorCallbacks::ProcessNode(const osmium::Node &input_node,
-                                     const ExtractionNode &result_node)
+                                     const ExtractionNode &result_node,
+                                     Buffer &buffer) const
 {
-    external_memory.all_nodes_list.push_back(
+    buffer.nodes.push_back(
         {static_cast<int>(input_node.location().lat() * COORDINATE_PRECISION),
          static_cast<int>(input_node.location().lon() * COORDINATE_PRECISION),
          static_cast<NodeID>(input_node.id()),
@@ -69,11 +119,11 @@ void ExtractorCallbacks::ProcessNode(const osmium::Node &input_node,
 }
 
 void ExtractorCallbacks::ProcessRestriction(
-    const boost::optional<InputRestrictionContainer> &restriction)
+    const boost::optional<InputRestrictionContainer> &restriction, Buffer &buffer) const
 {
     if (restriction)
     {
-        external_memory.restrictions_list.push_back(restriction.get());
+        buffer.restrictions.push_back(restriction.get());
         // SimpleLogger().Write() << "from: " << restriction.get().restriction.from.node <<
         //                           ",via: " << restriction.get().restriction.via.node <<
         //                           ", to: " << restriction.get().restriction.to.node <<
@@ -87,10 +137,10 @@ void ExtractorCallbacks::ProcessRestriction(
  *
  * Depending on the forward/backwards weights the edges are split into forward
  * and backward edges.
- *
- * warning: caller needs to take care of synchronization!
  */
-void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const ExtractionWay &parsed_way)
+void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way,
+                                    const ExtractionWay &parsed_way,
+                                    Buffer &buffer)
 {
     if (((0 >= parsed_way.forward_speed) ||
          (TRAVEL_MODE_INACCESSIBLE == parsed_way.forward_travel_mode)) &&
@@ -152,17 +202,7 @@ void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const Extracti
     }
 
     // Get the unique identifier for the street name
-    const auto &string_map_iterator = string_map.find(parsed_way.name);
-    unsigned name_id = external_memory.name_list.size();
-    if (string_map.end() == string_map_iterator)
-    {
-        external_memory.name_list.push_back(parsed_way.name);
-        string_map.insert(std::make_pair(parsed_way.name, name_id));
-    }
-    else
-    {
-        name_id = string_map_iterator->second;
-    }
+    const unsigned name_id = GetNameID(parsed_way.name);
 
     const bool split_edge = (parsed_way.forward_speed > 0) &&
                             (TRAVEL_MODE_INACCESSIBLE != parsed_way.forward_travel_mode) &&
@@ -172,7 +212,7 @@ void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const Extracti
                              (parsed_way.forward_travel_mode != parsed_way.backward_travel_mode));
 
     std::transform(input_way.nodes().begin(), input_way.nodes().end(),
-                   std::back_inserter(external_memory.used_node_id_list),
+                   std::back_inserter(buffer.used_node_ids),
                    [](const osmium::NodeRef &ref)
                    {
                        return ref.ref();
@@ -188,14 +228,14 @@ void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const Extracti
         osrm::for_each_pair(input_way.nodes().crbegin(), input_way.nodes().crend(),
                             [&](const osmium::NodeRef &first_node, const osmium::NodeRef &last_node)
                             {
-                                external_memory.all_edges_list.push_back(InternalExtractorEdge(
+                                buffer.edges.push_back(InternalExtractorEdge(
                                     first_node.ref(), last_node.ref(), name_id,
                                     backward_weight_data, true, false, parsed_way.roundabout,
                                     parsed_way.is_access_restricted,
                                     parsed_way.backward_travel_mode, false));
                             });
 
-        external_memory.way_start_end_id_list.push_back(
+        buffer.way_start_end_ids.push_back(
             {static_cast<EdgeID>(input_way.id()),
              static_cast<NodeID>(input_way.nodes().back().ref()),
              static_cast<NodeID>(input_way.nodes()[input_way.nodes().size() - 2].ref()),
@@ -209,7 +249,7 @@ void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const Extracti
         osrm::for_each_pair(input_way.nodes().cbegin(), input_way.nodes().cend(),
                             [&](const osmium::NodeRef &first_node, const osmium::NodeRef &last_node)
                             {
-                                external_memory.all_edges_list.push_back(InternalExtractorEdge(
+                                buffer.edges.push_back(InternalExtractorEdge(
                                     first_node.ref(), last_node.ref(), name_id, forward_weight_data,
                                     true, !forward_only, parsed_way.roundabout,
                                     parsed_way.is_access_restricted, parsed_way.forward_travel_mode,
@@ -222,14 +262,14 @@ void ExtractorCallbacks::ProcessWay(const osmium::Way &input_way, const Extracti
                 input_way.nodes().cbegin(), input_way.nodes().cend(),
                 [&](const osmium::NodeRef &first_node, const osmium::NodeRef &last_node)
                 {
-                    external_memory.all_edges_list.push_back(InternalExtractorEdge(
+                    buffer.edges.push_back(InternalExtractorEdge(
                         first_node.ref(), last_node.ref(), name_id, backward_weight_data, false,
                         true, parsed_way.roundabout, parsed_way.is_access_restricted,
                         parsed_way.backward_travel_mode, true));
                 });
         }
 
-        external_memory.way_start_end_id_list.push_back(
+        buffer.way_start_end_ids.push_back(
             {static_cast<EdgeID>(input_way.id()),
              static_cast<NodeID>(input_way.nodes().back().ref()),
              static_cast<NodeID>(input_way.nodes()[input_way.nodes().size() - 2].ref()),
@@ -28,15 +28,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef EXTRACTOR_CALLBACKS_HPP
 #define EXTRACTOR_CALLBACKS_HPP
 
+#include "first_and_last_segment_of_way.hpp"
+#include "internal_extractor_edge.hpp"
+#include "../data_structures/external_memory_node.hpp"
+#include "../data_structures/restriction.hpp"
 #include "../typedefs.h"
 #include <boost/optional/optional_fwd.hpp>
 
+#include <tbb/concurrent_hash_map.h>
+#include <tbb/concurrent_vector.h>
+
 #include <string>
-#include <unordered_map>
+#include <vector>
 
-struct ExternalMemoryNode;
 class ExtractionContainers;
-struct InputRestrictionContainer;
 struct ExtractionNode;
 struct ExtractionWay;
 namespace osmium
@@ -50,28 +55,50 @@ class Way;
  * osmium based parsing and the customization through the lua profile.
  *
  * It mediates between the multi-threaded extraction process and the external memory containers.
- * Thus the synchronization is handled inside of the extractor.
+ * The Process* functions may be called concurrently, each thread collects its results in its
+ * own buffer. The buffers are then flushed to the external memory containers one at a time.
  */
 class ExtractorCallbacks
 {
+  public:
+    // results of the callbacks, waiting to be appended to the external memory containers
+    struct Buffer
+    {
+        std::vector<ExternalMemoryNode> nodes;
+        std::vector<NodeID> used_node_ids;
+        std::vector<InternalExtractorEdge> edges;
+        std::vector<FirstAndLastSegmentOfWay> way_start_end_ids;
+        std::vector<InputRestrictionContainer> restrictions;
+    };
+
   private:
     // used to deduplicate street names: actually maps to name ids
-    std::unordered_map<std::string, NodeID> string_map;
+    tbb::concurrent_hash_map<std::string, unsigned> string_map;
+    // names by their id, appended to the external memory by FlushNames
+    tbb::concurrent_vector<std::string> names;
     ExtractionContainers &external_memory;
 
+    unsigned GetNameID(const std::string &name);
+
   public:
     ExtractorCallbacks() = delete;
     ExtractorCallbacks(const ExtractorCallbacks &) = delete;
     explicit ExtractorCallbacks(ExtractionContainers &extraction_containers);
 
-    // warning: caller needs to take care of synchronization!
-    void ProcessNode(const osmium::Node &current_node, const ExtractionNode &result_node);
+    void ProcessNode(const osmium::Node &current_node,
+                     const ExtractionNode &result_node,
+                     Buffer &buffer) const;
 
-    // warning: caller needs to take care of synchronization!
-    void ProcessRestriction(const boost::optional<InputRestrictionContainer> &restriction);
+    void ProcessRestriction(const boost::optional<InputRestrictionContainer> &restriction,
+                            Buffer &buffer) const;
+
+    void ProcessWay(const osmium::Way &current_way, const ExtractionWay &result_way, Buffer &buffer);
 
     // warning: caller needs to take care of synchronization!
-    void ProcessWay(const osmium::Way &current_way, const ExtractionWay &result_way);
+    void FlushBuffer(Buffer &buffer);
+
+    // warning: must only be called once all ways are processed
+    void FlushNames();
 };
 
 #endif /* EXTRACTOR_CALLBACKS_HPP */
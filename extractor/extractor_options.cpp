@@ -51,11 +51,25 @@ ExtractorOptions::ParseArguments(int argc, char *argv[], ExtractorConfig &extrac
     config_options.add_options()("profile,p",
                                  boost::program_options::value<boost::filesystem::path>(
                                      &extractor_config.profile_path)->default_value("profile.lua"),
-                                 "Path to LUA routing profile")(
+                                 "Path to LUA routing profile or a native profile (.so)")(
         "threads,t",
         boost::program_options::value<unsigned int>(&extractor_config.requested_num_threads)
             ->default_value(tbb::task_scheduler_init::default_num_threads()),
-        "Number of threads to use");
+        "Number of threads to use")(
+        "two-pass",
+        boost::program_options::value<bool>(&extractor_config.two_pass)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Read the ways first and keep only the nodes they use")(
+        "compress-graph",
+        boost::program_options::value<bool>(&extractor_config.compress_graph)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Write the nodes and edges of the .osrm file as compressed blocks")(
+        "way-cache", boost::program_options::value<boost::filesystem::path>(
+                         &extractor_config.way_cache_path),
+        "Reuse the profile results of the ways that did not change since the run that wrote "
+        "this file, and update it");
 
     // hidden options, will be allowed both on command line and in config file, but will not be
     // shown to the user
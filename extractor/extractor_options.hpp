@@ -28,30 +28,38 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef EXTRACTOR_OPTIONS_HPP
 #define EXTRACTOR_OPTIONS_HPP
 
+#include "../util/return_code.hpp"
+
 #include <boost/filesystem/path.hpp>
 
+#include <memory>
 #include <string>
 
-enum class return_code : unsigned
-{
-    ok,
-    fail,
-    exit
-};
+class NativeProfile;
 
 struct ExtractorConfig
 {
-    ExtractorConfig() noexcept : requested_num_threads(0) {}
+    ExtractorConfig() noexcept : requested_num_threads(0), two_pass(false), compress_graph(false)
+    {
+    }
     boost::filesystem::path config_file_path;
     boost::filesystem::path input_path;
     boost::filesystem::path profile_path;
+    // a profile compiled into the program, used instead of the one at profile_path if set
+    std::shared_ptr<const NativeProfile> native_profile;
 
     std::string output_file_name;
     std::string restriction_file_name;
     std::string names_file_name;
     std::string timestamp_file_name;
+    // reuse the profile results of the unchanged ways from this file and update it, if set
+    boost::filesystem::path way_cache_path;
 
     unsigned requested_num_threads;
+    // read the ways first and then only the nodes they reference
+    bool two_pass;
+    // write the graph of the .osrm file as compressed blocks
+    bool compress_graph;
 };
 
 struct ExtractorOptions
@@ -0,0 +1,70 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "lua_tag_list.hpp"
+
+#include "../util/lua_util.hpp"
+
+#include <osmium/osm.hpp>
+
+namespace
+{
+const char *const tag_list_metatable = "osrm.TagList";
+
+int tag_list_index(lua_State *lua_state)
+{
+    const auto tags =
+        static_cast<const osmium::TagList **>(luaL_checkudata(lua_state, 1, tag_list_metatable));
+    const char *key = luaL_checkstring(lua_state, 2);
+    if (nullptr == *tags)
+    {
+        return luaL_error(lua_state, "tags are only valid during node_function and way_function");
+    }
+    lua_pushstring(lua_state, (*tags)->get_value_by_key(key, ""));
+    return 1;
+}
+}
+
+LuaTagList::LuaTagList(lua_State *lua_state)
+{
+    tags = static_cast<const osmium::TagList **>(
+        lua_newuserdata(lua_state, sizeof(const osmium::TagList *)));
+    *tags = nullptr;
+
+    luaL_newmetatable(lua_state, tag_list_metatable);
+    lua_pushcfunction(lua_state, tag_list_index);
+    lua_setfield(lua_state, -2, "__index");
+    lua_setmetatable(lua_state, -2);
+
+    // the reference keeps the userdata alive as long as this object
+    tag_list_object = luabind::object(luabind::from_stack(lua_state, -1));
+    lua_pop(lua_state, 1);
+}
+
+void LuaTagList::Set(const osmium::TagList &tag_list) { *tags = &tag_list; }
+
+void LuaTagList::Reset() { *tags = nullptr; }
@@ -0,0 +1,64 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef LUA_TAG_LIST_HPP
+#define LUA_TAG_LIST_HPP
+
+#include <luabind/luabind.hpp>
+
+struct lua_State;
+
+namespace osmium
+{
+class TagList;
+}
+
+/**
+ * Passes the tags of the node or way that is processed to the profile as a userdata,
+ * so that tags["highway"] is a single metamethod call through the Lua C API instead of
+ * a method call dispatched by luabind. Keys are looked up as the Lua strings they are and
+ * missing keys yield "", like get_value_by_key does.
+ *
+ * There is one instance per lua state, the tags are only valid between Set and Reset.
+ */
+class LuaTagList
+{
+  public:
+    explicit LuaTagList(lua_State *lua_state);
+    LuaTagList(const LuaTagList &) = delete;
+
+    void Set(const osmium::TagList &tags);
+    void Reset();
+
+    const luabind::object &Get() const { return tag_list_object; }
+
+  private:
+    const osmium::TagList **tags;
+    luabind::object tag_list_object;
+};
+
+#endif /* LUA_TAG_LIST_HPP */
@@ -0,0 +1,150 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef NATIVE_PROFILE_HPP
+#define NATIVE_PROFILE_HPP
+
+#include "../util/osrm_exception.hpp"
+
+#include <boost/filesystem/path.hpp>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ExtractionNode;
+struct ExtractionWay;
+namespace osmium
+{
+class Node;
+class Way;
+}
+
+// The settings the lua profiles declare as globals, in the same units.
+struct NativeProfileProperties
+{
+    NativeProfileProperties()
+        : traffic_signal_penalty(0), u_turn_penalty(0), use_turn_restrictions(true),
+          has_turn_penalty_function(false)
+    {
+    }
+
+    // seconds
+    int traffic_signal_penalty;
+    int u_turn_penalty;
+    bool use_turn_restrictions;
+    // values of the except tag that make a restriction not apply, see get_exceptions
+    std::vector<std::string> restriction_exceptions;
+    // only nodes with one of these keys are passed to the node function, all if empty
+    std::vector<std::string> node_function_keys;
+    bool has_turn_penalty_function;
+};
+
+/**
+ * A routing profile written in C++. It replaces the node_function, way_function and
+ * turn_function of a lua profile, the extractor and osrm-prepare call it directly instead of
+ * going through a lua state per thread. The functions are called concurrently and must not
+ * modify the profile. There is no counterpart of the source_function and segment_function.
+ *
+ * A profile is either compiled into a program that passes it in the ExtractorConfig and
+ * ContractorConfig, or built as a shared object that is given as --profile. Such a shared
+ * object exports the function named by NATIVE_PROFILE_ENTRY_POINT:
+ *
+ *   extern "C" NativeProfile *osrm_create_native_profile() { return new CarProfile(); }
+ */
+class NativeProfile
+{
+  public:
+    virtual ~NativeProfile() {}
+
+    virtual NativeProfileProperties GetProperties() const = 0;
+
+    virtual void ProcessNode(const osmium::Node &node, ExtractionNode &result) const = 0;
+
+    virtual void ProcessWay(const osmium::Way &way, ExtractionWay &result) const = 0;
+
+    // penalty of a turn that deviates by deviation degrees in [-180, 180] from going straight,
+    // in deciseconds like the result of turn_function
+    virtual double GetTurnPenalty(const double deviation) const
+    {
+        (void)deviation;
+        return 0.;
+    }
+};
+
+constexpr const char *NATIVE_PROFILE_ENTRY_POINT = "osrm_create_native_profile";
+using NativeProfileFactory = NativeProfile *(*)();
+
+// profiles given as shared objects are recognized by their extension, all others are lua
+inline bool IsNativeProfile(const boost::filesystem::path &profile_path)
+{
+    const std::string extension = profile_path.extension().string();
+    return ".so" == extension || ".dylib" == extension;
+}
+
+// The shared object stays loaded as long as the profile it created lives.
+inline std::shared_ptr<const NativeProfile>
+LoadNativeProfile(const boost::filesystem::path &profile_path)
+{
+#ifdef _WIN32
+    throw osrm::exception("native profiles are not supported on this platform: " +
+                          profile_path.string());
+#else
+    void *library = dlopen(profile_path.string().c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (nullptr == library)
+    {
+        throw osrm::exception("could not load native profile " + profile_path.string() + ": " +
+                              dlerror());
+    }
+    const auto factory =
+        reinterpret_cast<NativeProfileFactory>(dlsym(library, NATIVE_PROFILE_ENTRY_POINT));
+    if (nullptr == factory)
+    {
+        dlclose(library);
+        throw osrm::exception(profile_path.string() + " does not export " +
+                              NATIVE_PROFILE_ENTRY_POINT);
+    }
+    const NativeProfile *profile = factory();
+    if (nullptr == profile)
+    {
+        dlclose(library);
+        throw osrm::exception(profile_path.string() + " did not create a profile");
+    }
+    return std::shared_ptr<const NativeProfile>(profile, [library](const NativeProfile *p)
+                                                {
+                                                    delete p;
+                                                    dlclose(library);
+                                                });
+#endif
+}
+
+#endif // NATIVE_PROFILE_HPP
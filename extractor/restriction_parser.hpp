@@ -63,6 +63,9 @@ class RestrictionParser
 {
   public:
     RestrictionParser(lua_State *lua_state);
+    // the settings of a native profile
+    RestrictionParser(const bool use_turn_restrictions,
+                      std::vector<std::string> restriction_exceptions);
     boost::optional<InputRestrictionContainer> TryParse(const osmium::Relation &relation) const;
 
   private:
@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "extraction_node.hpp"
 #include "extraction_way.hpp"
 #include "internal_extractor_edge.hpp"
+#include "lua_tag_list.hpp"
 #include "../data_structures/external_memory_node.hpp"
 #include "../data_structures/raster_source.hpp"
 #include "../util/lua_util.hpp"
@@ -83,6 +84,8 @@ void ScriptingEnvironment::init_lua_state(lua_State *lua_state)
         luabind::def("print", LUA_print<std::string>),
         luabind::def("durationIsValid", durationIsValid),
         luabind::def("parseDuration", parseDuration),
+        luabind::def("parseMaxspeed", parseMaxspeed),
+        luabind::def("parseLength", parseLength),
         luabind::class_<SourceContainer>("sources")
             .def(luabind::constructor<>())
             .def("load", &SourceContainer::loadRasterSource)
@@ -172,3 +175,15 @@ lua_State *ScriptingEnvironment::get_lua_state()
 
     return ref.get();
 }
+
+LuaTagList &ScriptingEnvironment::get_tag_list()
+{
+    lua_State *lua_state = get_lua_state();
+    bool initialized = false;
+    auto &ref = tag_lists.local(initialized);
+    if (!initialized)
+    {
+        ref = std::make_shared<LuaTagList>(lua_state);
+    }
+    return *ref;
+}
@@ -34,6 +34,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <tbb/enumerable_thread_specific.h>
 
 struct lua_State;
+class LuaTagList;
 
 /**
  * Creates a lua context and binds osmium way, node and relation objects and
@@ -50,11 +51,16 @@ class ScriptingEnvironment
 
     lua_State *get_lua_state();
 
+    // tags of the processed object for the lua state of the calling thread
+    LuaTagList &get_tag_list();
+
   private:
     void init_lua_state(lua_State *lua_state);
     std::mutex init_mutex;
     std::string file_name;
     tbb::enumerable_thread_specific<std::shared_ptr<lua_State>> script_contexts;
+    // declared after the states, thus released before them
+    tbb::enumerable_thread_specific<std::shared_ptr<LuaTagList>> tag_lists;
 };
 
 #endif /* SCRIPTING_ENVIRONMENT_HPP */
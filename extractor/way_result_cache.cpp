@@ -0,0 +1,171 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "way_result_cache.hpp"
+
+#include "../util/osrm_exception.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <iterator>
+#include <string>
+
+namespace
+{
+// "OSRMWAYC", followed by the format version and the profile hash
+constexpr uint64_t WAY_RESULT_CACHE_MAGIC = 0x4f53524d57415943ull;
+constexpr uint32_t WAY_RESULT_CACHE_VERSION = 1;
+
+template <typename T> void WriteValue(std::ostream &stream, const T &value)
+{
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T> bool ReadValue(std::istream &stream, T &value)
+{
+    return static_cast<bool>(stream.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+}
+
+WayResultCacheReader::WayResultCacheReader(const boost::filesystem::path &cache_path,
+                                           const uint64_t profile_hash)
+    : has_entry(false), entry_id(0), entry_version(0)
+{
+    if (!boost::filesystem::exists(cache_path))
+    {
+        return;
+    }
+    cache_stream.open(cache_path, std::ios::binary);
+    uint64_t magic = 0, cache_profile_hash = 0;
+    uint32_t version = 0;
+    if (!ReadValue(cache_stream, magic) || !ReadValue(cache_stream, version) ||
+        !ReadValue(cache_stream, cache_profile_hash) || WAY_RESULT_CACHE_MAGIC != magic ||
+        WAY_RESULT_CACHE_VERSION != version || profile_hash != cache_profile_hash)
+    {
+        cache_stream.close();
+        return;
+    }
+    has_entry = ReadEntry();
+}
+
+bool WayResultCacheReader::ReadEntry()
+{
+    uint32_t name_length = 0;
+    uint8_t flags = 0, forward_mode = 0, backward_mode = 0;
+    if (!cache_stream.is_open() || !ReadValue(cache_stream, entry_id) ||
+        !ReadValue(cache_stream, entry_version) ||
+        !ReadValue(cache_stream, entry_result.forward_speed) ||
+        !ReadValue(cache_stream, entry_result.backward_speed) ||
+        !ReadValue(cache_stream, entry_result.duration) || !ReadValue(cache_stream, flags) ||
+        !ReadValue(cache_stream, forward_mode) || !ReadValue(cache_stream, backward_mode) ||
+        !ReadValue(cache_stream, name_length))
+    {
+        return false;
+    }
+    entry_result.name.resize(name_length);
+    if (name_length > 0 && !cache_stream.read(&entry_result.name[0], name_length))
+    {
+        return false;
+    }
+    entry_result.roundabout = 0 != (flags & 1);
+    entry_result.is_access_restricted = 0 != (flags & 2);
+    entry_result.forward_travel_mode = forward_mode;
+    entry_result.backward_travel_mode = backward_mode;
+    return true;
+}
+
+bool WayResultCacheReader::Find(const int64_t way_id,
+                                const uint32_t version,
+                                ExtractionWay &result)
+{
+    while (has_entry && entry_id < way_id)
+    {
+        has_entry = ReadEntry();
+    }
+    if (!has_entry || entry_id != way_id || entry_version != version)
+    {
+        return false;
+    }
+    result = entry_result;
+    return true;
+}
+
+WayResultCacheWriter::WayResultCacheWriter(const boost::filesystem::path &cache_path,
+                                           const uint64_t profile_hash)
+    : cache_path(cache_path), temporary_path(cache_path.string() + ".tmp"),
+      cache_stream(temporary_path, std::ios::binary)
+{
+    if (!cache_stream)
+    {
+        throw osrm::exception("Could not write way cache " + temporary_path.string());
+    }
+    WriteValue(cache_stream, WAY_RESULT_CACHE_MAGIC);
+    WriteValue(cache_stream, WAY_RESULT_CACHE_VERSION);
+    WriteValue(cache_stream, profile_hash);
+}
+
+void WayResultCacheWriter::Write(const int64_t way_id,
+                                 const uint32_t version,
+                                 const ExtractionWay &result)
+{
+    const uint8_t flags = (result.roundabout ? 1 : 0) | (result.is_access_restricted ? 2 : 0);
+    const uint8_t forward_mode = result.forward_travel_mode;
+    const uint8_t backward_mode = result.backward_travel_mode;
+    const uint32_t name_length = static_cast<uint32_t>(result.name.size());
+    WriteValue(cache_stream, way_id);
+    WriteValue(cache_stream, version);
+    WriteValue(cache_stream, result.forward_speed);
+    WriteValue(cache_stream, result.backward_speed);
+    WriteValue(cache_stream, result.duration);
+    WriteValue(cache_stream, flags);
+    WriteValue(cache_stream, forward_mode);
+    WriteValue(cache_stream, backward_mode);
+    WriteValue(cache_stream, name_length);
+    cache_stream.write(result.name.data(), name_length);
+}
+
+void WayResultCacheWriter::Commit()
+{
+    cache_stream.close();
+    if (!cache_stream)
+    {
+        throw osrm::exception("Could not write way cache " + temporary_path.string());
+    }
+    boost::filesystem::rename(temporary_path, cache_path);
+}
+
+uint64_t HashProfile(const boost::filesystem::path &profile_path)
+{
+    boost::filesystem::ifstream profile_stream(profile_path, std::ios::binary);
+    uint64_t hash = 14695981039346656037ull;
+    for (std::istreambuf_iterator<char> iter(profile_stream), end; iter != end; ++iter)
+    {
+        hash = (hash ^ static_cast<unsigned char>(*iter)) * 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,87 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef WAY_RESULT_CACHE_HPP
+#define WAY_RESULT_CACHE_HPP
+
+#include "extraction_way.hpp"
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <cstdint>
+
+/**
+ * Stores the results of the ```way_function``` of a run of the extractor, so the next run on
+ * an updated extract only calls the profile for the ways that changed.
+ *
+ * A way is unchanged if its OSM id and version are the same. The results are only valid for
+ * the profile they were computed with, a cache written with another profile is ignored. Only
+ * the profile file itself is compared, remove the cache after changing a file it includes.
+ * The entries are sorted by way id, the input files are, so both are read in one sweep.
+ */
+class WayResultCacheReader
+{
+  public:
+    // an empty reader if the file does not exist or belongs to another profile
+    WayResultCacheReader(const boost::filesystem::path &cache_path, const uint64_t profile_hash);
+
+    // the way ids of consecutive calls have to be ascending
+    bool Find(const int64_t way_id, const uint32_t version, ExtractionWay &result);
+
+  private:
+    bool ReadEntry();
+
+    boost::filesystem::ifstream cache_stream;
+    bool has_entry;
+    int64_t entry_id;
+    uint32_t entry_version;
+    ExtractionWay entry_result;
+};
+
+class WayResultCacheWriter
+{
+  public:
+    // the cache is written next to the given path and replaces it on Commit()
+    WayResultCacheWriter(const boost::filesystem::path &cache_path, const uint64_t profile_hash);
+
+    // the way ids of consecutive calls have to be ascending
+    void Write(const int64_t way_id, const uint32_t version, const ExtractionWay &result);
+
+    void Commit();
+
+  private:
+    boost::filesystem::path cache_path;
+    boost::filesystem::path temporary_path;
+    boost::filesystem::ofstream cache_stream;
+};
+
+// FNV-1a hash of the profile, identifies the profile a cache was written with
+uint64_t HashProfile(const boost::filesystem::path &profile_path);
+
+#endif /* WAY_RESULT_CACHE_HPP */
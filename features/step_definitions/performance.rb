@@ -0,0 +1,58 @@
+Given /^a generated grid of (\d+) x (\d+) nodes$/ do |cols,rows|
+  build_grid_network cols.to_i, rows.to_i
+end
+
+When /^I preprocess the data$/ do
+  # always run the binaries, cached data files would not tell anything about their speed
+  write_input_data
+  extract_data
+  prepare_data
+  log_preprocess_done
+  ['osrm-extract','osrm-prepare'].each do |bin|
+    record_performance "#{bin} time", preprocess_stats[bin][:time].round(3), 's'
+    memory = preprocess_stats[bin][:memory]
+    record_performance "#{bin} memory", memory/(1024*1024), 'MB' if memory
+  end
+end
+
+When /^I send (\d+) (\w+) requests(?: with (\d+) coordinates)?(?: from (\d+) clients)?$/ do |n,plugin,count,clients|
+  reprocess
+  OSRMLoader.load(self,"#{prepared_file}.osrm") do
+    # warm up the page cache and the query heaps before timing
+    benchmark_plugin plugin, [n.to_i/10,1].max, 1, (count || 2).to_i
+    benchmark_plugin plugin, n.to_i, (clients || 1).to_i, (count || 2).to_i
+  end
+  record_performance "#{plugin} p50", (latency_percentile(50)*1000).round(3), 'ms'
+  record_performance "#{plugin} p95", (latency_percentile(95)*1000).round(3), 'ms'
+  record_performance "#{plugin} max", (latency_percentile(100)*1000).round(3), 'ms'
+  record_performance "#{plugin} throughput", @benchmark[:throughput].round(1), 'requests/s'
+end
+
+Then /^all requests should succeed$/ do
+  expect(@benchmark[:failures]).to eq(0)
+end
+
+Then /^the p(\d+) latency should be below (\d+(?:\.\d+)?) ms$/ do |p,budget|
+  expect(latency_percentile(p.to_i)*1000).to be < performance_budget(budget)
+end
+
+Then /^the throughput should be above (\d+(?:\.\d+)?) requests per second$/ do |budget|
+  expect(@benchmark[:throughput]).to be > budget.to_f/PERFORMANCE_FACTOR
+end
+
+Then /^"([^"]*)" should take less than (\d+(?:\.\d+)?) seconds$/ do |bin,budget|
+  stats = preprocess_stats[bin]
+  raise "*** #{bin} was not run" unless stats
+  expect(stats[:time]).to be < performance_budget(budget)
+end
+
+Then /^"([^"]*)" should use less than (\d+) MB of memory$/ do |bin,budget|
+  stats = preprocess_stats[bin]
+  raise "*** #{bin} was not run" unless stats
+  # peak memory is only known where /proc is available
+  if stats[:memory]
+    expect(stats[:memory]).to be < performance_budget(budget)*1024*1024
+  else
+    puts "*** peak memory of #{bin} is unknown, skipping the budget"
+  end
+end
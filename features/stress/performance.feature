@@ -0,0 +1,64 @@
+@stress @performance
+Feature: Performance budgets
+# Results are appended to test/performance.csv, budgets are scaled by OSRM_PERFORMANCE_FACTOR
+
+    Background:
+        Given the profile "testbot"
+        Given a grid size of 100 meters
+
+    Scenario: Performance - preprocess a 200x200 grid
+        Given a generated grid of 200 x 200 nodes
+        When I preprocess the data
+        Then "osrm-extract" should take less than 30 seconds
+        And "osrm-extract" should use less than 500 MB of memory
+        And "osrm-prepare" should take less than 60 seconds
+        And "osrm-prepare" should use less than 500 MB of memory
+
+    Scenario: Performance - viaroute on a 100x100 grid
+        Given a generated grid of 100 x 100 nodes
+        When I send 500 viaroute requests
+        Then all requests should succeed
+        And the p95 latency should be below 20 ms
+        And the throughput should be above 100 requests per second
+
+    Scenario: Performance - concurrent viaroute on a 100x100 grid
+        Given a generated grid of 100 x 100 nodes
+        When I send 1000 viaroute requests from 4 clients
+        Then all requests should succeed
+        And the p95 latency should be below 40 ms
+        And the throughput should be above 200 requests per second
+
+    Scenario: Performance - table on a 100x100 grid
+        Given a generated grid of 100 x 100 nodes
+        When I send 100 table requests with 25 coordinates
+        Then all requests should succeed
+        And the p95 latency should be below 100 ms
+        And the throughput should be above 20 requests per second
+
+    Scenario: Performance - nearest on a 100x100 grid
+        Given a generated grid of 100 x 100 nodes
+        When I send 1000 nearest requests
+        Then all requests should succeed
+        And the p95 latency should be below 5 ms
+        And the throughput should be above 500 requests per second
+
+    Scenario: Performance - locate on a 100x100 grid
+        Given a generated grid of 100 x 100 nodes
+        When I send 1000 locate requests
+        Then all requests should succeed
+        And the p95 latency should be below 5 ms
+        And the throughput should be above 500 requests per second
+
+    Scenario: Performance - match on a 100x100 grid
+        Given a generated grid of 100 x 100 nodes
+        When I send 200 match requests with 20 coordinates
+        Then all requests should succeed
+        And the p95 latency should be below 50 ms
+        And the throughput should be above 40 requests per second
+
+    Scenario: Performance - trip on a 100x100 grid
+        Given a generated grid of 100 x 100 nodes
+        When I send 100 trip requests with 10 coordinates
+        Then all requests should succeed
+        And the p95 latency should be below 100 ms
+        And the throughput should be above 20 requests per second
@@ -0,0 +1,151 @@
+require 'csv'
+
+# performance measurements, appended to a csv file in the test folder so the results of
+# consecutive runs can be compared. budgets are multiplied by OSRM_PERFORMANCE_FACTOR to
+# compensate for slower machines.
+
+PERFORMANCE_LOG_FILE = ENV['OSRM_PERFORMANCE_LOG'] || 'performance.csv'
+PERFORMANCE_FACTOR = (ENV['OSRM_PERFORMANCE_FACTOR'] || 1).to_f
+PERFORMANCE_SEED = 42
+MEMORY_POLL_INTERVAL = 0.02  #seconds
+
+# runs a preprocessing binary with its output appended to the preprocessing log, and
+# remembers its wall time and peak memory. returns true if the binary succeeded.
+def run_preprocess_bin bin, *args
+  start = Process.clock_gettime Process::CLOCK_MONOTONIC
+  pid = Process.spawn "#{BIN_PATH}/#{bin}#{EXE}", *args, [:out, :err] => [PREPROCESS_LOG_FILE, 'a']
+  peak_memory = nil
+  status_file = "/proc/#{pid}/status"
+  status = nil
+  loop do
+    # VmHWM is the peak resident set size, the last value read before the exit is kept
+    if File.readable? status_file
+      hwm = File.read(status_file)[/^VmHWM:\s*(\d+) kB/,1] rescue nil
+      peak_memory = hwm.to_i*1024 if hwm
+    end
+    _, status = Process.wait2 pid, Process::WNOHANG
+    break if status
+    sleep MEMORY_POLL_INTERVAL
+  end
+  preprocess_stats[bin] = {
+    :time => Process.clock_gettime(Process::CLOCK_MONOTONIC) - start,
+    :memory => peak_memory
+  }
+  status.success?
+end
+
+def preprocess_stats
+  @preprocess_stats ||= {}
+end
+
+# lays out a grid of cols x rows nodes, connected by one way per row and per column,
+# spaced by the grid size
+def build_grid_network cols, rows, highway='primary'
+  grid = Array.new(rows) do |ri|
+    Array.new(cols) do |ci|
+      node = OSM::Node.new make_osm_id, OSM_USER, OSM_TIMESTAMP, *table_coord_to_lonlat(ci,ri)
+      node.uid = OSM_UID
+      osm_db << node
+      node
+    end
+  end
+  lines = grid + grid.transpose
+  lines.each_with_index do |nodes,i|
+    way = OSM::Way.new make_osm_id, OSM_USER, OSM_TIMESTAMP
+    way.uid = OSM_UID
+    nodes.each { |node| way << node }
+    way << { 'highway' => highway, 'name' => "g#{i}" }
+    osm_db << way
+  end
+  @grid_size = [cols,rows]
+end
+
+def random_grid_location random
+  raise "*** no generated grid" unless @grid_size
+  ci = random.rand(@grid_size[0]-1) + random.rand
+  ri = random.rand(@grid_size[1]-1) + random.rand
+  Location.new *table_coord_to_lonlat(ci,ri)
+end
+
+# waypoints along a row of the grid, in order, for the matching plugin
+def random_grid_trace random, count
+  ri = random.rand(@grid_size[1])
+  first = random.rand([@grid_size[0]-count,1].max)
+  (0...count).map { |i| Location.new *table_coord_to_lonlat(first+i,ri) }
+end
+
+def request_plugin plugin, random, count
+  case plugin
+  when 'viaroute'
+    request_route Array.new(count) { random_grid_location random }
+  when 'table'
+    request_table Array.new(count) { random_grid_location random }
+  when 'trip'
+    request_trip Array.new(count) { random_grid_location random }
+  when 'match'
+    trace = random_grid_trace random, count
+    request_matching trace, (0...trace.size).map { |i| i*10 }
+  when 'nearest'
+    request_nearest random_grid_location(random)
+  when 'locate'
+    request_locate random_grid_location(random)
+  else
+    raise "*** unknown plugin '#{plugin}'"
+  end
+end
+
+# sends n requests to a plugin from a number of concurrent clients, and keeps the latency
+# of every request plus the total wall time
+def benchmark_plugin plugin, n, clients=1, count=2
+  latencies = []
+  failures = 0
+  mutex = Mutex.new
+  start = Process.clock_gettime Process::CLOCK_MONOTONIC
+  threads = (0...clients).map do |c|
+    Thread.new do
+      random = Random.new PERFORMANCE_SEED+c
+      (n/clients + (c < n%clients ? 1 : 0)).times do
+        before = Process.clock_gettime Process::CLOCK_MONOTONIC
+        response = request_plugin plugin, random, count
+        latency = Process.clock_gettime(Process::CLOCK_MONOTONIC) - before
+        ok = response.code == "200" && (JSON.parse(response.body)['status'] || 0) == 0
+        mutex.synchronize do
+          latencies << latency
+          failures += 1 unless ok
+        end
+      end
+    end
+  end
+  threads.each(&:join)
+  total = Process.clock_gettime(Process::CLOCK_MONOTONIC) - start
+  @benchmark = {
+    :plugin => plugin,
+    :latencies => latencies.sort,
+    :failures => failures,
+    :throughput => latencies.size/total
+  }
+end
+
+def latency_percentile p
+  latencies = @benchmark[:latencies]
+  raise "*** no requests were timed" if latencies.empty?
+  latencies[[(latencies.size*p/100.0).ceil-1,0].max]
+end
+
+def performance_revision
+  $performance_revision ||= `git -C #{ROOT_FOLDER} rev-parse --short HEAD 2>/dev/null`.strip
+end
+
+def record_performance metric, value, unit
+  Dir.chdir TEST_FOLDER do
+    new_file = !File.exist?(PERFORMANCE_LOG_FILE)
+    CSV.open(PERFORMANCE_LOG_FILE, 'a') do |csv|
+      csv << ['time','revision','feature','scenario','metric','value','unit'] if new_file
+      csv << [@scenario_time, performance_revision, @feature_name, @scenario_title, metric, value, unit]
+    end
+  end
+end
+
+def performance_budget value
+  value.to_f*PERFORMANCE_FACTOR
+end
@@ -30,12 +30,22 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/server_paths.hpp>
 
+#include <string>
+#include <unordered_map>
+
 struct libosrm_config
 {
     libosrm_config(const libosrm_config &) = delete;
     libosrm_config()
         : max_locations_distance_table(100), max_locations_map_matching(-1),
-          use_shared_memory(true)
+          max_locations_target_set(5000), max_batch_routes(10000), max_isochrone_time(3600),
+          max_matching_sessions(0), matching_session_ttl(300), phantom_node_cache_size(0),
+          shortcut_cache_size(0), trip_cache_size(0), parallel_snapping_threshold(128),
+          max_request_memory(0), max_total_request_memory(0), async_query_threads(0),
+          dense_query_heaps(false), compact_query_graph(false), split_query_graph(false),
+          parallel_bidirectional_search(false), parallel_leg_search(false),
+          approximate_alternatives(false), prefetch_search_graph(false), verify_image(false),
+          warm_up_dataset(false), use_shared_memory(true)
     {
     }
 
@@ -44,13 +54,77 @@ struct libosrm_config
                    const int max_table,
                    const int max_matching)
         : server_paths(std::move(paths)), max_locations_distance_table(max_table),
-          max_locations_map_matching(max_matching), use_shared_memory(sharedmemory_flag)
+          max_locations_map_matching(max_matching), max_locations_target_set(5000),
+          max_batch_routes(10000), max_isochrone_time(3600), max_matching_sessions(0),
+          matching_session_ttl(300), phantom_node_cache_size(0),
+          shortcut_cache_size(0), trip_cache_size(0), parallel_snapping_threshold(128),
+          max_request_memory(0), max_total_request_memory(0), async_query_threads(0),
+          dense_query_heaps(false), compact_query_graph(false), split_query_graph(false),
+          parallel_bidirectional_search(false), parallel_leg_search(false),
+          approximate_alternatives(false), prefetch_search_graph(false), verify_image(false),
+          warm_up_dataset(false), use_shared_memory(sharedmemory_flag)
     {
     }
 
     ServerPaths server_paths;
+    // additional datasets loaded from files, selected per request with profile=<name>
+    std::unordered_map<std::string, ServerPaths> datasets;
     int max_locations_distance_table;
     int max_locations_map_matching;
+    // targets of a set registered with the targets service
+    int max_locations_target_set;
+    // origin-destination pairs of a single request to the batch service
+    int max_batch_routes;
+    // seconds of travel that bound the area of an isochrone request
+    int max_isochrone_time;
+    // online matching sessions kept per dataset, 0 disables them
+    int max_matching_sessions;
+    // seconds after which an idle matching session starts over
+    int matching_session_ttl;
+    // coordinates whose phantom nodes are cached per dataset, 0 disables the cache
+    int phantom_node_cache_size;
+    // shortcuts whose unpacked edges are cached per dataset, 0 disables the cache
+    int shortcut_cache_size;
+    // trip stops whose search spaces are cached per dataset, 0 disables the cache
+    int trip_cache_size;
+    // coordinates of a request from which their phantom nodes are snapped on worker threads,
+    // 0 always snaps them on the request thread
+    int parallel_snapping_threshold;
+    // megabytes that a single query may allocate for its search spaces, results and documents,
+    // 0 for no limit. A query over the limit fails with 413.
+    int max_request_memory;
+    // megabytes that all queries in flight may allocate together, 0 for no limit. A query over
+    // the limit fails with 503.
+    int max_total_request_memory;
+    // threads of the pool that runs the queries of RunQueryAsync, 0 uses one per core
+    int async_query_threads;
+    // index the query heaps of all threads by array instead of hash map, needs memory per node
+    bool dense_query_heaps;
+    // bit-pack the edges of the query graph when loading from files, fewer cache misses at the
+    // cost of decoding every edge
+    bool compact_query_graph;
+    // keep the ids of the query graph edges in an array apart from their targets and weights
+    // when loading from files
+    bool split_query_graph;
+    // run the forward and reverse search of a route on two threads
+    bool parallel_bidirectional_search;
+    // search the legs of a route with via points on worker threads
+    bool parallel_leg_search;
+    // select alternative routes from the first search only, faster but not locally optimal
+    bool approximate_alternatives;
+    // prefetch the heap slots of the edge targets and the edges of the next node in the searches
+    bool prefetch_search_graph;
+    // check the block checksums of a dataset image when mapping it
+    bool verify_image;
+    // blocks of a dataset image that are kept in RAM, separated by commas, "graph" stands for
+    // the blocks of the search graph. The other blocks are paged in from the file on demand.
+    std::string locked_image_blocks;
+    // read all pages of every new dataset generation and allocate the query heaps before it
+    // answers queries
+    bool warm_up_dataset;
+    // requests replayed on every new dataset generation before it answers queries, one per
+    // line as in the access log, implies warm_up_dataset
+    std::string warm_up_queries;
     bool use_shared_memory;
 };
 
@@ -0,0 +1,87 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef QUERY_RESULTS_HPP
+#define QUERY_RESULTS_HPP
+
+#include <osrm/coordinate.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace osrm
+{
+
+// Results of OSRM::RunTableQuery and OSRM::RunRouteQuery as plain data. The plugins fill them
+// without building a JSON document, the JSON responses are rendered from the same results.
+
+struct TableResult
+{
+    TableResult() : number_of_rows(0), number_of_columns(0), first_column(0) {}
+
+    // travel time in deciseconds from source row to destination column
+    int duration(const std::size_t row, const std::size_t column) const
+    {
+        return durations[row * number_of_columns + column];
+    }
+
+    // length in decimeters of the fastest path, only if RouteParameters::lengths was set
+    int length(const std::size_t row, const std::size_t column) const
+    {
+        return lengths[row * number_of_columns + column];
+    }
+
+    unsigned number_of_rows;
+    unsigned number_of_columns;
+    // destination of the first column, only a tile of a tiled table starts at another one
+    unsigned first_column;
+    // row-major, unreachable entries are std::numeric_limits<int>::max()
+    std::vector<int> durations;
+    std::vector<int> lengths;
+};
+
+// receives the tiles of OSRM::RunTiledTableQuery one after the other
+using TableTileCallback = std::function<void(TableResult &tile)>;
+
+struct RouteResult
+{
+    RouteResult() : found(false), duration(0.), distance(0.) {}
+
+    bool found;
+    // seconds and meters of the whole route
+    double duration;
+    double distance;
+    // meters of the legs between consecutive via points
+    std::vector<double> leg_distances;
+    // points of the route, only if RouteParameters::geometry was set
+    std::vector<FixedPointCoordinate> geometry;
+};
+}
+
+#endif // QUERY_RESULTS_HPP
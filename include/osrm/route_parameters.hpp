@@ -31,8 +31,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <osrm/coordinate.hpp>
 
 #include <boost/fusion/container/vector/vector_fwd.hpp>
+#include <boost/optional/optional_fwd.hpp>
 
 #include <string>
+#include <utility>
 #include <vector>
 
 struct RouteParameters
@@ -55,6 +57,8 @@ struct RouteParameters
 
     void setGPSPrecision(const double precision);
 
+    void setImprovementTime(const unsigned milliseconds);
+
     void setDeprecatedAPIFlag(const std::string &);
 
     void setChecksum(const unsigned check_sum);
@@ -71,12 +75,34 @@ struct RouteParameters
 
     void addTimestamp(const unsigned timestamp);
 
+    void addBearing(const boost::fusion::vector<int, boost::optional<int>> &received_bearing);
+
     void setLanguage(const std::string &language);
 
+    void setProfile(const std::string &profile);
+
+    void setTargetSet(const std::string &target_set);
+
+    void setSession(const std::string &session);
+
+    void addSource(const unsigned index);
+
+    void addDestination(const unsigned index);
+
     void setGeometryFlag(const bool flag);
 
     void setCompressionFlag(const bool flag);
 
+    void setLengthsFlag(const bool flag);
+
+    void setMaxTime(const unsigned seconds);
+
+    void setTimeout(const unsigned milliseconds);
+
+    void setMaxDuration(const unsigned seconds);
+
+    void setHullFlag(const bool flag);
+
     void addCoordinate(const boost::fusion::vector<double, double> &received_coordinates);
 
     void getCoordinatesFromGeometry(const std::string &geometry_string);
@@ -89,17 +115,41 @@ struct RouteParameters
     bool deprecatedAPI;
     bool uturn_default;
     bool classify;
+    // add the lengths of the shortest paths to a distance table
+    bool lengths;
+    // return the outline of an isochrone instead of its reached points
+    bool hull;
     double matching_beta;
     double gps_precision;
+    // milliseconds a trip may spend improving its tours by local search, 0 disables it
+    unsigned improvement_time;
+    // seconds of travel that bound an isochrone
+    unsigned max_time;
+    // milliseconds after which the searches of the query give up, 0 for no limit
+    unsigned timeout;
+    // seconds of travel beyond which a distance table has no entries, 0 for no limit
+    unsigned max_duration;
     unsigned check_sum;
     short num_results;
     std::string service;
     std::string output_format;
     std::string jsonp_parameter;
     std::string language;
+    // name of the dataset to query, empty for the default one
+    std::string profile;
+    // handle of a registered target set to query, empty to register the coordinates as one
+    std::string target_set;
+    // id of an online matching session that the coordinates are added to, empty for none
+    std::string session;
     std::vector<std::string> hints;
     std::vector<unsigned> timestamps;
+    // bearing and allowed deviation in degrees, a deviation of 180 accepts every segment
+    std::vector<std::pair<int, int>> bearings;
     std::vector<bool> uturns;
+    // indices of the coordinates that are the rows and columns of a distance table, all
+    // coordinates if empty
+    std::vector<unsigned> sources;
+    std::vector<unsigned> destinations;
     std::vector<FixedPointCoordinate> coordinates;
 };
 
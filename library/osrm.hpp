@@ -30,6 +30,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/libosrm_config.hpp>
 
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iosfwd>
 #include <memory>
 
 class OSRM_impl;
@@ -41,6 +45,9 @@ namespace json
 {
 struct Object;
 }
+struct RouteResult;
+struct TableResult;
+using TableTileCallback = std::function<void(TableResult &tile)>;
 }
 
 class OSRM
@@ -52,6 +59,40 @@ class OSRM
     explicit OSRM(libosrm_config &lib_config);
     ~OSRM();
     int RunQuery(RouteParameters &route_parameters, osrm::json::Object &json_result);
+    // The results of a table or a route as plain data, see <osrm/query_results.hpp>. They are
+    // filled without building a JSON document and are meant for embedding applications.
+    int RunTableQuery(RouteParameters &route_parameters, osrm::TableResult &table);
+    int RunRouteQuery(RouteParameters &route_parameters, osrm::RouteResult &route);
+    // Computes a table of any size in tiles of at most columns_per_tile destinations, with all
+    // sources each. Only one tile is kept in memory at a time and tile_callback receives them in
+    // the order of their columns, max_locations_distance_table does not apply. Meant for offline
+    // jobs, the query holds on to one generation of the data until it is done.
+    int RunTiledTableQuery(RouteParameters &route_parameters,
+                           const unsigned columns_per_tile,
+                           const osrm::TableTileCallback &tile_callback);
+    // called with the status code and the result of a query, a failed query has status 500
+    using QueryCallback = std::function<void(int status, osrm::json::Object &json_result)>;
+    // Queues the query on an internal pool of worker threads and returns right away. The
+    // callback runs on one of the workers. Destroying the OSRM object waits for all queued
+    // queries, so it must not happen inside a callback.
+    void RunQueryAsync(const RouteParameters &route_parameters, QueryCallback callback);
+    // as above, json_result has to stay alive until the returned status is ready
+    std::future<int> RunQueryAsync(const RouteParameters &route_parameters,
+                                   osrm::json::Object &json_result);
+    // Matches the traces of input against the dataset of route_parameters.profile on all
+    // cores. Every line of input is a trace of blank separated points, each of them given as
+    // lat,lon or lat,lon,timestamp. Writes the /match response of each trace as one line of
+    // output in input order and returns the number of traces.
+    unsigned MatchTraces(std::istream &input,
+                         std::ostream &output,
+                         const RouteParameters &route_parameters);
+    // changes whenever the served dataset is replaced
+    std::uint64_t GetDataVersion() const;
+    // Loads the files or the image of the default dataset again while the queries keep
+    // running on the previous one, which is released once the last of them finished. Returns
+    // false if loading failed and the previous dataset stays, or if a reload is running
+    // already. Datasets in shared memory are replaced by osrm-datastore instead.
+    bool ReloadDataset();
 };
 
 #endif // OSRM_HPP
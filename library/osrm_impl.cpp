@@ -36,140 +36,680 @@ class named_mutex;
 #include "osrm_impl.hpp"
 #include "osrm.hpp"
 
+#include "../plugins/batch_route.hpp"
 #include "../plugins/distance_table.hpp"
 #include "../plugins/hello_world.hpp"
+#include "../plugins/isochrone.hpp"
 #include "../plugins/locate.hpp"
+#include "../plugins/metrics.hpp"
 #include "../plugins/nearest.hpp"
 #include "../plugins/timestamp.hpp"
+#include "../plugins/target_set.hpp"
 #include "../plugins/trip.hpp"
 #include "../plugins/viaroute.hpp"
 #include "../plugins/match.hpp"
+#include "../data_structures/compact_query_graph.hpp"
+#include "../data_structures/split_query_graph.hpp"
+#include "../data_structures/search_engine_data.hpp"
 #include "../server/data_structures/datafacade_base.hpp"
 #include "../server/data_structures/internal_datafacade.hpp"
+#include "../server/data_structures/query_epochs.hpp"
 #include "../server/data_structures/shared_barriers.hpp"
 #include "../server/data_structures/shared_datafacade.hpp"
+#include "../server/data_structures/shared_datatype.hpp"
+#include "../server/request_log.hpp"
+#include "../util/json_renderer.hpp"
 #include "../util/make_unique.hpp"
+#include "../util/memory_budget.hpp"
+#include "../util/osrm_exception.hpp"
+#include "../util/query_cancellation.hpp"
 #include "../util/routed_options.hpp"
 #include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
 
 #include <boost/assert.hpp>
-#include <boost/interprocess/sync/named_condition.hpp>
+#include <boost/interprocess/sync/named_mutex.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include <osrm/route_parameters.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
+#include <istream>
+#include <ostream>
 #include <utility>
 #include <vector>
 
+namespace
+{
+// number of traces that MatchTraces keeps in memory at once
+constexpr std::size_t MATCHING_BATCH_SIZE = 4096;
+
+// Parses the comma separated names of the image blocks to keep in RAM, "graph" adds the
+// blocks of the search graph
+std::vector<SharedDataLayout::BlockID> ParseLockedImageBlocks(const std::string &names)
+{
+    std::vector<SharedDataLayout::BlockID> blocks;
+    std::string::size_type begin = 0;
+    while (begin < names.size())
+    {
+        const auto end = std::min(names.find(',', begin), names.size());
+        const std::string name = names.substr(begin, end - begin);
+        begin = end + 1;
+        if ("graph" == name)
+        {
+            for (auto i = 0; i < SharedDataLayout::NUM_BLOCKS; ++i)
+            {
+                if (SharedDataLayout::IsGraphBlock(static_cast<SharedDataLayout::BlockID>(i)))
+                {
+                    blocks.push_back(static_cast<SharedDataLayout::BlockID>(i));
+                }
+            }
+            continue;
+        }
+        const auto bid = SharedDataLayout::FindBlock(name);
+        if (SharedDataLayout::NUM_BLOCKS == bid)
+        {
+            throw osrm::exception("unknown block of the image: " + name);
+        }
+        blocks.push_back(bid);
+    }
+    return blocks;
+}
+
+bool IsBlank(const char character)
+{
+    return ' ' == character || '\t' == character || '\r' == character;
+}
+
+// Parses a line of blank separated lat,lon[,timestamp] points into route_parameters
+bool ParseTrace(const std::string &line, RouteParameters &route_parameters)
+{
+    const char *position = line.c_str();
+    char *end = nullptr;
+    while (true)
+    {
+        while (IsBlank(*position))
+        {
+            ++position;
+        }
+        if ('\0' == *position)
+        {
+            return true;
+        }
+
+        const double lat = std::strtod(position, &end);
+        if (position == end || ',' != *end)
+        {
+            return false;
+        }
+        position = end + 1;
+        const double lon = std::strtod(position, &end);
+        if (position == end)
+        {
+            return false;
+        }
+        position = end;
+        if (',' == *position)
+        {
+            ++position;
+            const auto timestamp = std::strtoul(position, &end, 10);
+            if (position == end)
+            {
+                return false;
+            }
+            position = end;
+            route_parameters.timestamps.push_back(static_cast<unsigned>(timestamp));
+        }
+        if ('\0' != *position && !IsBlank(*position))
+        {
+            return false;
+        }
+        route_parameters.coordinates.emplace_back(static_cast<int>(COORDINATE_PRECISION * lat),
+                                                  static_cast<int>(COORDINATE_PRECISION * lon));
+    }
+}
+}
+
 OSRM_impl::OSRM_impl(libosrm_config &lib_config)
+    : max_locations_distance_table(lib_config.max_locations_distance_table),
+      max_locations_map_matching(lib_config.max_locations_map_matching),
+      max_locations_target_set(lib_config.max_locations_target_set),
+      max_batch_routes(lib_config.max_batch_routes),
+      max_isochrone_time(lib_config.max_isochrone_time),
+      max_matching_sessions(lib_config.max_matching_sessions),
+      matching_session_ttl(lib_config.matching_session_ttl),
+      phantom_node_cache_size(lib_config.phantom_node_cache_size),
+      shortcut_cache_size(lib_config.shortcut_cache_size),
+      trip_cache_size(lib_config.trip_cache_size),
+      parallel_snapping_threshold(lib_config.parallel_snapping_threshold),
+      max_request_memory(static_cast<std::size_t>(lib_config.max_request_memory) << 20),
+      warm_up_dataset(lib_config.warm_up_dataset || !lib_config.warm_up_queries.empty()),
+      published_data(nullptr), loaded_timestamp(0),
+      query_arena(0 < lib_config.async_query_threads ? lib_config.async_query_threads
+                                                     : tbb::task_arena::automatic,
+                  0),
+      pending_async_queries(0)
 {
+    // the query heaps are shared by all datasets of the process
+    SearchEngineData::use_array_storage = lib_config.dense_query_heaps;
+    SearchEngineData::parallel_bidirectional_search = lib_config.parallel_bidirectional_search;
+    SearchEngineData::parallel_leg_search = lib_config.parallel_leg_search;
+    SearchEngineData::approximate_alternatives = lib_config.approximate_alternatives;
+    SearchEngineData::prefetch_search_graph = lib_config.prefetch_search_graph;
+    osrm::memory::Global().limit = static_cast<std::size_t>(lib_config.max_total_request_memory)
+                                   << 20;
+    if (!lib_config.warm_up_queries.empty())
+    {
+        warm_up_requests = osrm::LoadRequestLog(lib_config.warm_up_queries);
+    }
+
+    const bool compact_query_graph = lib_config.compact_query_graph;
+    const bool split_query_graph = lib_config.split_query_graph;
+    const auto load_internal_dataset = [this, compact_query_graph, split_query_graph](
+        const ServerPaths &paths) -> std::unique_ptr<Dataset>
+    {
+        if (compact_query_graph)
+        {
+            return LoadDataset(
+                new InternalDataFacade<QueryEdge::EdgeData, CompactQueryGraph>(paths));
+        }
+        if (split_query_graph)
+        {
+            return LoadDataset(
+                new InternalDataFacade<QueryEdge::EdgeData, SplitQueryGraph<>>(paths));
+        }
+        return LoadDataset(new InternalDataFacade<QueryEdge::EdgeData>(paths));
+    };
+
     if (lib_config.use_shared_memory)
     {
         barrier = osrm::make_unique<SharedBarriers>();
-        query_data_facade = new SharedDataFacade<QueryEdge::EdgeData>();
+        published_data = static_cast<SharedDataTimestamp *>(
+            SharedMemoryFactory::Get(CURRENT_REGIONS, sizeof(SharedDataTimestamp), false, false)
+                ->Ptr());
+        auto shared_facade = new SharedDataFacade<QueryEdge::EdgeData>();
+        loaded_timestamp = shared_facade->GetLoadedTimestamp();
+        current_dataset = LoadDataset(shared_facade).release();
+    }
+    else if (lib_config.server_paths.end() != lib_config.server_paths.find("image") &&
+             !lib_config.server_paths.find("image")->second.empty())
+    {
+        const boost::filesystem::path image_path = lib_config.server_paths.find("image")->second;
+        const bool verify_image = lib_config.verify_image;
+        const auto locked_blocks = ParseLockedImageBlocks(lib_config.locked_image_blocks);
+        load_default_dataset = [this, image_path, verify_image, locked_blocks]()
+        {
+            return LoadDataset(
+                new SharedDataFacade<QueryEdge::EdgeData>(image_path, verify_image, locked_blocks));
+        };
+        current_dataset = load_default_dataset().release();
     }
     else
     {
         // populate base path
         populate_base_path(lib_config.server_paths);
-        query_data_facade = new InternalDataFacade<QueryEdge::EdgeData>(lib_config.server_paths);
+        const ServerPaths paths = lib_config.server_paths;
+        load_default_dataset = [load_internal_dataset, paths]()
+        {
+            return load_internal_dataset(paths);
+        };
+        current_dataset = load_default_dataset().release();
     }
+    data_checksum = current_dataset.load()->facade->GetCheckSum();
+    WarmUpDataset(*current_dataset.load());
 
-    // The following plugins handle all requests.
-    RegisterPlugin(new DistanceTablePlugin<BaseDataFacade<QueryEdge::EdgeData>>(
-        query_data_facade, lib_config.max_locations_distance_table));
-    RegisterPlugin(new HelloWorldPlugin());
-    RegisterPlugin(new LocatePlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
-    RegisterPlugin(new NearestPlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
-    RegisterPlugin(new MapMatchingPlugin<BaseDataFacade<QueryEdge::EdgeData>>(
-        query_data_facade, lib_config.max_locations_map_matching));
-    RegisterPlugin(new TimestampPlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
-    RegisterPlugin(new ViaRoutePlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
-    RegisterPlugin(new RoundTripPlugin<BaseDataFacade<QueryEdge::EdgeData>>(query_data_facade));
+    // further datasets share the server threads and the per-thread search heaps
+    for (auto &dataset : lib_config.datasets)
+    {
+        SimpleLogger().Write() << "loading dataset: " << dataset.first;
+        populate_base_path(dataset.second);
+        datasets.emplace(dataset.first, load_internal_dataset(dataset.second));
+    }
 }
 
-OSRM_impl::~OSRM_impl()
+OSRM_impl::Dataset::~Dataset()
 {
-    delete query_data_facade;
-    for (PluginMap::value_type &plugin_pointer : plugin_map)
+    for (PluginMap::value_type &plugin_pointer : plugins)
     {
         delete plugin_pointer.second;
     }
 }
 
-void OSRM_impl::RegisterPlugin(BasePlugin *plugin)
+OSRM_impl::~OSRM_impl()
+{
+    {
+        std::unique_lock<std::mutex> lock(async_query_mutex);
+        async_queries_done.wait(lock, [this]
+                                {
+                                    return 0 == pending_async_queries;
+                                });
+    }
+    // retired generations are released by query_epochs
+    delete current_dataset.load();
+}
+
+template <typename DataFacadeT>
+std::unique_ptr<OSRM_impl::Dataset> OSRM_impl::LoadDataset(DataFacadeT *facade) const
+{
+    std::unique_ptr<Dataset> dataset(new Dataset());
+    dataset->facade.reset(facade);
+    // a new generation starts with an empty cache
+    if (0 < phantom_node_cache_size)
+    {
+        facade->EnablePhantomNodeCache(static_cast<unsigned>(phantom_node_cache_size));
+    }
+    if (0 < shortcut_cache_size)
+    {
+        facade->EnableShortcutCache(static_cast<unsigned>(shortcut_cache_size));
+    }
+
+    // The following plugins handle all requests.
+    PluginMap &plugins = dataset->plugins;
+    const auto snapping_threshold = static_cast<unsigned>(parallel_snapping_threshold);
+    RegisterPlugin(plugins, new BatchRoutePlugin<DataFacadeT>(facade, max_batch_routes,
+                                                              snapping_threshold));
+    RegisterPlugin(plugins, new DistanceTablePlugin<DataFacadeT>(
+                                facade, max_locations_distance_table, snapping_threshold));
+    RegisterPlugin(plugins, new HelloWorldPlugin());
+    RegisterPlugin(plugins, new IsochronePlugin<DataFacadeT>(facade, max_isochrone_time));
+    RegisterPlugin(plugins, new LocatePlugin<DataFacadeT>(facade));
+    RegisterPlugin(plugins, new MetricsPlugin());
+    RegisterPlugin(plugins, new NearestPlugin<DataFacadeT>(facade));
+    RegisterPlugin(plugins, new MapMatchingPlugin<DataFacadeT>(
+                                facade, max_locations_map_matching, max_matching_sessions,
+                                matching_session_ttl, snapping_threshold));
+    RegisterPlugin(plugins, new TimestampPlugin<DataFacadeT>(facade));
+    RegisterPlugin(plugins, new ViaRoutePlugin<DataFacadeT>(facade, snapping_threshold));
+    RegisterPlugin(plugins, new RoundTripPlugin<DataFacadeT>(
+                                facade, static_cast<unsigned>(std::max(0, trip_cache_size)),
+                                snapping_threshold));
+    RegisterPlugin(plugins, new TargetSetPlugin<DataFacadeT>(facade, max_locations_target_set,
+                                                             max_locations_distance_table,
+                                                             snapping_threshold));
+    return dataset;
+}
+
+void OSRM_impl::RegisterPlugin(PluginMap &plugins, BasePlugin *plugin) const
 {
     SimpleLogger().Write() << "loaded plugin: " << plugin->GetDescriptor();
-    if (plugin_map.find(plugin->GetDescriptor()) != plugin_map.end())
+    if (plugins.find(plugin->GetDescriptor()) != plugins.end())
     {
-        delete plugin_map.find(plugin->GetDescriptor())->second;
+        delete plugins.find(plugin->GetDescriptor())->second;
     }
-    plugin_map.emplace(plugin->GetDescriptor(), plugin);
+    plugins.emplace(plugin->GetDescriptor(), plugin);
 }
 
-int OSRM_impl::RunQuery(RouteParameters &route_parameters, osrm::json::Object &json_result)
+const OSRM_impl::Dataset *OSRM_impl::SelectDataset(const std::string &profile,
+                                                   QueryEpochs::Guard &pinned_data)
 {
-    const auto &plugin_iterator = plugin_map.find(route_parameters.service);
+    if (profile.empty())
+    {
+        if (barrier)
+        {
+            ReloadOutdatedDataset();
+        }
+        // pin before loading the pointer, the generation is not released while pinned
+        pinned_data = query_epochs.Pin();
+        return current_dataset.load();
+    }
 
-    if (plugin_map.end() == plugin_iterator)
+    const auto dataset_iterator = datasets.find(profile);
+    if (datasets.end() == dataset_iterator)
+    {
+        return nullptr;
+    }
+    return dataset_iterator->second.get();
+}
+
+int OSRM_impl::RunOnPlugin(const RouteParameters &route_parameters,
+                           const std::string &service,
+                           const std::function<int(BasePlugin &)> &handler)
+{
+    QueryEpochs::Guard pinned_data;
+    const Dataset *dataset = SelectDataset(route_parameters.profile, pinned_data);
+    if (nullptr == dataset)
     {
         return 400;
     }
 
-    increase_concurrent_query_count();
-    plugin_iterator->second->HandleRequest(route_parameters, json_result);
-    decrease_concurrent_query_count();
-    return 200;
+    const auto &plugin_iterator = dataset->plugins.find(service);
+    if (dataset->plugins.end() == plugin_iterator)
+    {
+        return 400;
+    }
+
+    // the timeout of the query tightens the deadline the server may have set for the request
+    osrm::CancellationToken query_token;
+    osrm::CancellationToken *token = osrm::cancellation::Current();
+    if (route_parameters.timeout > 0)
+    {
+        token = (nullptr == token ? &query_token : token);
+        token->SetTimeout(std::chrono::milliseconds(route_parameters.timeout));
+    }
+    const osrm::cancellation::Scope cancellation_scope(token);
+    // the allocations that grow with the size of the query are charged against its own budget
+    // and the one that all queries share
+    osrm::MemoryBudget memory_budget(max_request_memory);
+    const osrm::memory::Scope memory_scope(&memory_budget);
+    // the heaps of the query go back to the pool that all threads take theirs from
+    const SearchEngineData::HeapScope heap_scope;
+
+    int status = 504;
+    try
+    {
+        status = handler(*plugin_iterator->second);
+    }
+    catch (const std::exception &)
+    {
+        // a cancellation or an exceeded budget on a worker thread may arrive as a copy of
+        // another type
+        if (memory_budget.Exceeded())
+        {
+            status = memory_budget.ExceededGlobally() ? 503 : 413;
+        }
+        else if (nullptr == token || !token->IsCancelled())
+        {
+            throw;
+        }
+    }
+    osrm::metrics::Registry::get().RecordMemoryPeak(service, memory_budget.Peak());
+
+    pinned_data.Release();
+    if (query_epochs.HasRetired())
+    {
+        query_epochs.Collect();
+    }
+    return status;
 }
 
-// decrease number of concurrent queries
-void OSRM_impl::decrease_concurrent_query_count()
+int OSRM_impl::RunQuery(RouteParameters &route_parameters, osrm::json::Object &json_result)
+{
+    // errors of the plugins are reported in the json result
+    return RunOnPlugin(route_parameters, route_parameters.service,
+                       [&route_parameters, &json_result](BasePlugin &plugin)
+                       {
+                           plugin.HandleRequest(route_parameters, json_result);
+                           return 200;
+                       });
+}
+
+int OSRM_impl::RunTableQuery(RouteParameters &route_parameters, osrm::TableResult &table)
+{
+    return RunOnPlugin(route_parameters, "table", [&route_parameters, &table](BasePlugin &plugin)
+                       {
+                           return plugin.HandleTableRequest(route_parameters, table);
+                       });
+}
+
+int OSRM_impl::RunRouteQuery(RouteParameters &route_parameters, osrm::RouteResult &route)
+{
+    return RunOnPlugin(route_parameters, "viaroute",
+                       [&route_parameters, &route](BasePlugin &plugin)
+                       {
+                           return plugin.HandleRouteRequest(route_parameters, route);
+                       });
+}
+
+int OSRM_impl::RunTiledTableQuery(RouteParameters &route_parameters,
+                                  const unsigned columns_per_tile,
+                                  const osrm::TableTileCallback &tile_callback)
+{
+    return RunOnPlugin(route_parameters, "table",
+                       [&route_parameters, columns_per_tile, &tile_callback](BasePlugin &plugin)
+                       {
+                           return plugin.HandleTiledTableRequest(route_parameters,
+                                                                 columns_per_tile, tile_callback);
+                       });
+}
+
+// The queries are enqueued on the task arena, so a fixed set of threads serves any number of
+// queries in flight. The workers take their query heaps from the pool like any other thread.
+void OSRM_impl::RunQueryAsync(const RouteParameters &route_parameters,
+                              std::function<void(int, osrm::json::Object &)> callback)
 {
-    if (!barrier)
     {
-        return;
+        std::lock_guard<std::mutex> lock(async_query_mutex);
+        ++pending_async_queries;
     }
-    // lock query
-    boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
-        barrier->query_mutex);
+    const auto parameters = std::make_shared<RouteParameters>(route_parameters);
+    query_arena.enqueue([this, parameters, callback]
+                        {
+                            osrm::json::Object json_result;
+                            int status = 500;
+                            try
+                            {
+                                status = RunQuery(*parameters, json_result);
+                            }
+                            catch (const std::exception &e)
+                            {
+                                SimpleLogger().Write(logWARNING) << "query failed: " << e.what();
+                                json_result.values.clear();
+                            }
+                            try
+                            {
+                                callback(status, json_result);
+                            }
+                            catch (const std::exception &e)
+                            {
+                                SimpleLogger().Write(logWARNING) << "query callback failed: "
+                                                                 << e.what();
+                            }
 
-    // decrement query count
-    --(barrier->number_of_queries);
-    BOOST_ASSERT_MSG(0 <= barrier->number_of_queries, "invalid number of queries");
+                            std::lock_guard<std::mutex> lock(async_query_mutex);
+                            if (0 == --pending_async_queries)
+                            {
+                                async_queries_done.notify_all();
+                            }
+                        });
+}
+
+// The traces are matched in batches, each of them is spread over the TBB workers which take
+// query heaps from the pool. A batch is matched on one generation of the data.
+unsigned OSRM_impl::MatchTraces(std::istream &input,
+                                std::ostream &output,
+                                const RouteParameters &route_parameters)
+{
+    RouteParameters trace_defaults(route_parameters);
+    trace_defaults.service = "match";
+    trace_defaults.coordinates.clear();
+    trace_defaults.timestamps.clear();
 
-    // notify all processes that were waiting for this condition
-    if (0 == barrier->number_of_queries)
+    unsigned number_of_traces = 0;
+    std::vector<std::string> traces;
+    std::vector<std::vector<char>> responses;
+    std::string line;
+    while (true)
     {
-        barrier->no_running_queries_condition.notify_all();
+        traces.clear();
+        while (traces.size() < MATCHING_BATCH_SIZE && std::getline(input, line))
+        {
+            traces.push_back(std::move(line));
+        }
+        if (traces.empty())
+        {
+            break;
+        }
+
+        QueryEpochs::Guard pinned_data;
+        const Dataset *dataset = SelectDataset(route_parameters.profile, pinned_data);
+        if (nullptr == dataset)
+        {
+            throw osrm::exception("unknown profile: " + route_parameters.profile);
+        }
+        BasePlugin *match_plugin = dataset->plugins.find("match")->second;
+
+        responses.resize(traces.size());
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, traces.size(), 1),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+                              const SearchEngineData::HeapScope heap_scope;
+                              for (auto trace = range.begin(); trace != range.end(); ++trace)
+                              {
+                                  RouteParameters trace_parameters(trace_defaults);
+                                  osrm::json::Object json_result;
+                                  if (ParseTrace(traces[trace], trace_parameters))
+                                  {
+                                      match_plugin->HandleRequest(trace_parameters, json_result);
+                                  }
+                                  else
+                                  {
+                                      json_result.values["status"] = "Invalid trace.";
+                                  }
+                                  responses[trace].clear();
+                                  osrm::json::render(responses[trace], json_result);
+                              }
+                          });
+
+        pinned_data.Release();
+        if (query_epochs.HasRetired())
+        {
+            query_epochs.Collect();
+        }
+
+        for (const auto &response : responses)
+        {
+            output.write(response.data(), response.size());
+            output.put('\n');
+        }
+        number_of_traces += static_cast<unsigned>(traces.size());
     }
+    output.flush();
+    return number_of_traces;
 }
 
-// increase number of concurrent queries
-void OSRM_impl::increase_concurrent_query_count()
+std::uint64_t OSRM_impl::GetDataVersion() const
 {
     if (!barrier)
+    {
+        return data_checksum.load();
+    }
+    // osrm-datastore bumps the published timestamp with every data swap, the current dataset
+    // catches up with it on the next query
+    return (static_cast<std::uint64_t>(published_data->timestamp) << 32) | data_checksum.load();
+}
+
+// loads the dataset osrm-datastore published last, queries keep running on the previous one
+void OSRM_impl::ReloadOutdatedDataset()
+{
+    if (published_data->timestamp == loaded_timestamp.load())
     {
         return;
     }
+    // some other thread is loading the new generation already
+    std::unique_lock<std::mutex> reload_lock(reload_mutex, std::try_to_lock);
+    if (!reload_lock.owns_lock() || published_data->timestamp == loaded_timestamp.load())
+    {
+        return;
+    }
+
+    std::unique_ptr<Dataset> loaded_dataset;
+    {
+        // keeps osrm-datastore from removing regions while they are attached
+        boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
+            barrier->query_mutex);
+        auto shared_facade = new SharedDataFacade<QueryEdge::EdgeData>();
+        loaded_timestamp = shared_facade->GetLoadedTimestamp();
+        loaded_dataset = LoadDataset(shared_facade);
+    }
+    // queries keep running on the previous generation meanwhile
+    WarmUpDataset(*loaded_dataset);
+    data_checksum = loaded_dataset->facade->GetCheckSum();
+
+    Dataset *previous_dataset = current_dataset.exchange(loaded_dataset.release());
+    query_epochs.Retire([previous_dataset]()
+                        {
+                            delete previous_dataset;
+                        });
+}
+
+bool OSRM_impl::ReloadDataset()
+{
+    if (!load_default_dataset)
+    {
+        SimpleLogger().Write(logWARNING) << "the dataset is reloaded by osrm-datastore";
+        return false;
+    }
+    std::unique_lock<std::mutex> reload_lock(reload_mutex, std::try_to_lock);
+    if (!reload_lock.owns_lock())
+    {
+        SimpleLogger().Write(logWARNING) << "the dataset is being reloaded already";
+        return false;
+    }
 
-    // lock update pending
-    boost::interprocess::scoped_lock<boost::interprocess::named_mutex> pending_lock(
-        barrier->pending_update_mutex);
+    SimpleLogger().Write() << "reloading the dataset";
+    std::unique_ptr<Dataset> loaded_dataset;
+    try
+    {
+        loaded_dataset = load_default_dataset();
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "could not reload the dataset: " << e.what();
+        return false;
+    }
+    // queries keep running on the previous generation meanwhile
+    WarmUpDataset(*loaded_dataset);
+    data_checksum = loaded_dataset->facade->GetCheckSum();
 
-    // lock query
-    boost::interprocess::scoped_lock<boost::interprocess::named_mutex> query_lock(
-        barrier->query_mutex);
+    Dataset *previous_dataset = current_dataset.exchange(loaded_dataset.release());
+    query_epochs.Retire([previous_dataset]()
+                        {
+                            delete previous_dataset;
+                        });
+    query_epochs.Collect();
+    SimpleLogger().Write() << "reloaded the dataset";
+    return true;
+}
 
-    // unlock update pending
-    pending_lock.unlock();
+void OSRM_impl::WarmUpDataset(const Dataset &dataset) const
+{
+    if (!warm_up_dataset)
+    {
+        return;
+    }
+    TIMER_START(warm_up);
+    dataset.facade->Prefault();
 
-    // increment query count
-    ++(barrier->number_of_queries);
+    // the warmed up heaps are pooled for the first queries of all threads, they outlive swaps
+    const SearchEngineData::HeapScope heap_scope;
+    SearchEngineData engine_working_data;
+    const unsigned number_of_nodes = dataset.facade->GetNumberOfNodes();
+    engine_working_data.InitializeOrClearFirstThreadLocalStorage(number_of_nodes);
+    engine_working_data.InitializeOrClearSecondThreadLocalStorage(number_of_nodes);
+    engine_working_data.InitializeOrClearThirdThreadLocalStorage(number_of_nodes);
 
-    (static_cast<SharedDataFacade<QueryEdge::EdgeData> *>(query_data_facade))
-        ->CheckAndReloadFacade();
+    unsigned failed_requests = 0;
+    for (const auto &request : warm_up_requests)
+    {
+        const auto plugin_iterator = dataset.plugins.find(request.service);
+        if (dataset.plugins.end() == plugin_iterator || !request.profile.empty())
+        {
+            ++failed_requests;
+            continue;
+        }
+        try
+        {
+            osrm::json::Object json_result;
+            plugin_iterator->second->HandleRequest(request, json_result);
+        }
+        catch (const std::exception &)
+        {
+            ++failed_requests;
+        }
+    }
+    TIMER_STOP(warm_up);
+    SimpleLogger().Write() << "warmed up the dataset with " << warm_up_requests.size()
+                           << " queries in " << TIMER_SEC(warm_up) << "s";
+    if (0 < failed_requests)
+    {
+        SimpleLogger().Write(logWARNING) << failed_requests << " warm-up queries failed";
+    }
 }
 
 // proxy code for compilation firewall
@@ -181,3 +721,50 @@ int OSRM::RunQuery(RouteParameters &route_parameters, osrm::json::Object &json_r
 {
     return OSRM_pimpl_->RunQuery(route_parameters, json_result);
 }
+
+int OSRM::RunTableQuery(RouteParameters &route_parameters, osrm::TableResult &table)
+{
+    return OSRM_pimpl_->RunTableQuery(route_parameters, table);
+}
+
+int OSRM::RunRouteQuery(RouteParameters &route_parameters, osrm::RouteResult &route)
+{
+    return OSRM_pimpl_->RunRouteQuery(route_parameters, route);
+}
+
+int OSRM::RunTiledTableQuery(RouteParameters &route_parameters,
+                             const unsigned columns_per_tile,
+                             const osrm::TableTileCallback &tile_callback)
+{
+    return OSRM_pimpl_->RunTiledTableQuery(route_parameters, columns_per_tile, tile_callback);
+}
+
+void OSRM::RunQueryAsync(const RouteParameters &route_parameters, QueryCallback callback)
+{
+    OSRM_pimpl_->RunQueryAsync(route_parameters, std::move(callback));
+}
+
+std::future<int> OSRM::RunQueryAsync(const RouteParameters &route_parameters,
+                                     osrm::json::Object &json_result)
+{
+    const auto status = std::make_shared<std::promise<int>>();
+    auto future_status = status->get_future();
+    OSRM_pimpl_->RunQueryAsync(route_parameters,
+                               [status, &json_result](int code, osrm::json::Object &result)
+                               {
+                                   json_result = std::move(result);
+                                   status->set_value(code);
+                               });
+    return future_status;
+}
+
+unsigned OSRM::MatchTraces(std::istream &input,
+                           std::ostream &output,
+                           const RouteParameters &route_parameters)
+{
+    return OSRM_pimpl_->MatchTraces(input, output, route_parameters);
+}
+
+std::uint64_t OSRM::GetDataVersion() const { return OSRM_pimpl_->GetDataVersion(); }
+
+bool OSRM::ReloadDataset() { return OSRM_pimpl_->ReloadDataset(); }
@@ -29,18 +29,30 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define OSRM_IMPL_HPP
 
 class BasePlugin;
-struct RouteParameters;
 
 #include "../data_structures/query_edge.hpp"
+#include "../server/data_structures/query_epochs.hpp"
 
 #include <osrm/json_container.hpp>
 #include <osrm/libosrm_config.hpp>
+#include <osrm/query_results.hpp>
+#include <osrm/route_parameters.hpp>
 
+#include <tbb/task_arena.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 struct SharedBarriers;
+struct SharedDataTimestamp;
 template <class EdgeDataT> class BaseDataFacade;
 
 class OSRM_impl
@@ -53,19 +65,87 @@ class OSRM_impl
     OSRM_impl(const OSRM_impl &) = delete;
     virtual ~OSRM_impl();
     int RunQuery(RouteParameters &route_parameters, osrm::json::Object &json_result);
+    int RunTableQuery(RouteParameters &route_parameters, osrm::TableResult &table);
+    int RunRouteQuery(RouteParameters &route_parameters, osrm::RouteResult &route);
+    int RunTiledTableQuery(RouteParameters &route_parameters,
+                           const unsigned columns_per_tile,
+                           const osrm::TableTileCallback &tile_callback);
+    void RunQueryAsync(const RouteParameters &route_parameters,
+                       std::function<void(int, osrm::json::Object &)> callback);
+    unsigned MatchTraces(std::istream &input,
+                         std::ostream &output,
+                         const RouteParameters &route_parameters);
+    std::uint64_t GetDataVersion() const;
+    bool ReloadDataset();
 
   private:
-    void RegisterPlugin(BasePlugin *plugin);
-    PluginMap plugin_map;
+    // a data facade together with the plugins answering queries on it
+    struct Dataset
+    {
+        Dataset() = default;
+        Dataset(const Dataset &) = delete;
+        ~Dataset();
+
+        std::unique_ptr<BaseDataFacade<QueryEdge::EdgeData>> facade;
+        PluginMap plugins;
+    };
+
+    // the plugins are instantiated for the concrete facade, so the searches call into the
+    // final facade classes directly instead of through BaseDataFacade's vtable
+    template <typename DataFacadeT>
+    std::unique_ptr<Dataset> LoadDataset(DataFacadeT *facade) const;
+    void RegisterPlugin(PluginMap &plugins, BasePlugin *plugin) const;
+    // runs handler on the plugin of the service with the data of the requested profile pinned,
+    // 400 if there is no such plugin or profile
+    int RunOnPlugin(const RouteParameters &route_parameters,
+                    const std::string &service,
+                    const std::function<int(BasePlugin &)> &handler);
+    // nullptr for an unknown profile, the default dataset stays pinned until pinned_data is
+    // released
+    const Dataset *SelectDataset(const std::string &profile, QueryEpochs::Guard &pinned_data);
+    void ReloadOutdatedDataset();
+    // faults in the data, allocates the query heaps of this thread and replays the warm-up
+    // queries on a dataset before it is published
+    void WarmUpDataset(const Dataset &dataset) const;
+
+    int max_locations_distance_table;
+    int max_locations_map_matching;
+    int max_locations_target_set;
+    int max_batch_routes;
+    int max_isochrone_time;
+    int max_matching_sessions;
+    int matching_session_ttl;
+    int phantom_node_cache_size;
+    int shortcut_cache_size;
+    int trip_cache_size;
+    int parallel_snapping_threshold;
+    // bytes that a single query may allocate, 0 for no limit
+    std::size_t max_request_memory;
+    bool warm_up_dataset;
+    std::vector<RouteParameters> warm_up_requests;
+    // the default dataset. With shared memory every generation published by osrm-datastore
+    // gets a dataset of its own, otherwise every reload does. A replaced one lives on until
+    // its last query finished.
+    std::atomic<Dataset *> current_dataset;
+    // loads the default dataset from its files or image again, empty with shared memory
+    std::function<std::unique_ptr<Dataset>()> load_default_dataset;
+    // datasets selected with profile=<name>
+    std::unordered_map<std::string, std::unique_ptr<Dataset>> datasets;
     // will only be initialized if shared memory is used
     std::unique_ptr<SharedBarriers> barrier;
-    // base class pointer to the objects
-    BaseDataFacade<QueryEdge::EdgeData> *query_data_facade;
-
-    // decrease number of concurrent queries
-    void decrease_concurrent_query_count();
-    // increase number of concurrent queries
-    void increase_concurrent_query_count();
+    SharedDataTimestamp *published_data;
+    std::mutex reload_mutex;
+    // checksum of the current dataset, readable without pinning it
+    std::atomic<unsigned> data_checksum;
+    // timestamp of the current dataset loaded from shared memory
+    std::atomic<unsigned> loaded_timestamp;
+    // queries pin the generation they run on instead of taking the interprocess query lock
+    QueryEpochs query_epochs;
+    // workers of RunQueryAsync, the destructor waits until the queued queries are done
+    tbb::task_arena query_arena;
+    std::mutex async_query_mutex;
+    std::condition_variable async_queries_done;
+    std::size_t pending_async_queries;
 };
 
 #endif // OSRM_IMPL_HPP
@@ -0,0 +1,256 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef BATCH_ROUTE_HPP
+#define BATCH_ROUTE_HPP
+
+#include "plugin_base.hpp"
+#include "parallel_snapping.hpp"
+
+#include "../algorithms/object_encoder.hpp"
+#include "../data_structures/search_engine.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/make_unique.hpp"
+#include "../util/query_cancellation.hpp"
+#include "../util/request_metrics.hpp"
+
+#include <osrm/json_container.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Many independent routes in one request. The coordinates are read as origin-destination
+ * pairs, loc=o1&loc=d1&loc=o2&loc=d2..., and every pair is answered with the distance and
+ * duration of its route. The pairs are searched on worker threads without unpacking their
+ * paths, the routes are returned in the order of the pairs.
+ */
+template <class DataFacadeT> class BatchRoutePlugin final : public BasePlugin
+{
+  private:
+    using SearchEnginePtr = std::unique_ptr<SearchEngine<DataFacadeT>>;
+
+  public:
+    BatchRoutePlugin(DataFacadeT *facade,
+                     const int max_batch_routes,
+                     const unsigned parallel_snapping_threshold = 0)
+        : max_batch_routes(max_batch_routes),
+          parallel_snapping_threshold(parallel_snapping_threshold), descriptor_string("batch"),
+          facade(facade)
+    {
+    }
+
+    virtual ~BatchRoutePlugin() {}
+
+    const std::string GetDescriptor() const override final { return descriptor_string; }
+
+    int HandleRequest(const RouteParameters &route_parameters,
+                      osrm::json::Object &json_result) override final
+    {
+        if (!check_all_coordinates(route_parameters.coordinates) ||
+            0 != route_parameters.coordinates.size() % 2)
+        {
+            json_result.values["status"] = "Coordinates must be origin-destination pairs.";
+            return 400;
+        }
+        const std::size_t number_of_routes = route_parameters.coordinates.size() / 2;
+        if (number_of_routes > static_cast<std::size_t>(max_batch_routes))
+        {
+            json_result.values["status"] = "Too many routes.";
+            return 400;
+        }
+
+        const std::vector<phantom_node_pair> phantom_node_pairs = GetPhantomNodes(route_parameters);
+
+        osrm::metrics::PhaseTimer search_timer(osrm::metrics::Phase::search);
+        std::vector<InternalRouteResult> raw_routes(number_of_routes);
+        const auto cancellation_token = osrm::cancellation::Current();
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, number_of_routes),
+                          [&](const tbb::blocked_range<std::size_t> &range)
+                          {
+                              const osrm::cancellation::Scope cancellation_scope(
+                                  cancellation_token);
+                              const SearchEngineData::HeapScope heap_scope;
+                              SearchEnginePtr &search_engine = search_engines.local();
+                              if (!search_engine)
+                              {
+                                  search_engine =
+                                      osrm::make_unique<SearchEngine<DataFacadeT>>(facade);
+                              }
+                              for (auto route = range.begin(); route != range.end(); ++route)
+                              {
+                                  SearchRoute(*search_engine, phantom_node_pairs[2 * route],
+                                              phantom_node_pairs[2 * route + 1],
+                                              raw_routes[route]);
+                              }
+                          });
+        search_timer.Stop();
+
+        osrm::metrics::PhaseTimer unpack_timer(osrm::metrics::Phase::unpack);
+        osrm::json::Array json_routes;
+        json_routes.values.reserve(number_of_routes);
+        for (const InternalRouteResult &raw_route : raw_routes)
+        {
+            osrm::json::Object json_route;
+            if (INVALID_EDGE_WEIGHT == raw_route.shortest_path_length)
+            {
+                json_route.values["status"] = 207;
+            }
+            else
+            {
+                json_route.values["status"] = 0;
+                json_route.values["total_distance"] =
+                    static_cast<unsigned>(std::round(raw_route.leg_lengths.front()));
+                json_route.values["total_time"] =
+                    static_cast<EdgeWeight>(std::round(raw_route.shortest_path_length / 10.));
+            }
+            json_routes.values.push_back(std::move(json_route));
+        }
+        json_result.values["status"] = 0;
+        json_result.values["routes"] = std::move(json_routes);
+        return 200;
+    }
+
+  private:
+    // Looks every distinct coordinate up once, batches of trips tend to share their origins. A
+    // pair's second phantom node is a candidate from the big component, see ViaRoutePlugin.
+    std::vector<phantom_node_pair> GetPhantomNodes(const RouteParameters &route_parameters) const
+    {
+        osrm::metrics::PhaseTimer phantom_timer(osrm::metrics::Phase::phantom_lookup);
+        const auto &coordinates = route_parameters.coordinates;
+        const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
+        std::vector<phantom_node_pair> phantom_node_pairs(coordinates.size());
+
+        std::vector<std::size_t> lookup_order;
+        lookup_order.reserve(coordinates.size());
+        for (const auto i : osrm::irange<std::size_t>(0, coordinates.size()))
+        {
+            if (checksum_OK && i < route_parameters.hints.size() &&
+                !route_parameters.hints[i].empty())
+            {
+                if (ObjectEncoder::DecodePhantomNode(route_parameters.hints[i],
+                                                    phantom_node_pairs[i].first) &&
+                    phantom_node_pairs[i].first.is_valid(facade->GetNumberOfNodes()))
+                {
+                    continue;
+                }
+            }
+            lookup_order.push_back(i);
+        }
+        const auto coordinate_order = [&coordinates](const std::size_t lhs, const std::size_t rhs)
+        {
+            return std::make_pair(coordinates[lhs].lat, coordinates[lhs].lon) <
+                   std::make_pair(coordinates[rhs].lat, coordinates[rhs].lon);
+        };
+        std::sort(lookup_order.begin(), lookup_order.end(), coordinate_order);
+
+        // the first of each run of equal coordinates is snapped, the others copy its result
+        std::vector<std::size_t> distinct_lookups;
+        for (const auto position : osrm::irange<std::size_t>(0, lookup_order.size()))
+        {
+            if (0 == position ||
+                !(coordinates[lookup_order[position - 1]] == coordinates[lookup_order[position]]))
+            {
+                distinct_lookups.push_back(lookup_order[position]);
+            }
+        }
+        SnapCoordinates(distinct_lookups.size(), parallel_snapping_threshold,
+                        [&](const std::size_t position)
+                        {
+                            const std::size_t i = distinct_lookups[position];
+                            std::vector<PhantomNode> phantom_node_vector;
+                            if (facade->IncrementalFindPhantomNodeForCoordinate(
+                                    coordinates[i], phantom_node_vector, 1))
+                            {
+                                BOOST_ASSERT(!phantom_node_vector.empty());
+                                phantom_node_pairs[i].first = phantom_node_vector.front();
+                                if (phantom_node_vector.size() > 1)
+                                {
+                                    phantom_node_pairs[i].second = phantom_node_vector.back();
+                                }
+                            }
+                        });
+        for (const auto position : osrm::irange<std::size_t>(1, lookup_order.size()))
+        {
+            const std::size_t i = lookup_order[position];
+            if (coordinates[lookup_order[position - 1]] == coordinates[i])
+            {
+                phantom_node_pairs[i] = phantom_node_pairs[lookup_order[position - 1]];
+            }
+        }
+        return phantom_node_pairs;
+    }
+
+    void SearchRoute(const SearchEngine<DataFacadeT> &search_engine,
+                     const phantom_node_pair &origin,
+                     const phantom_node_pair &destination,
+                     InternalRouteResult &raw_route) const
+    {
+        PhantomNodes end_points{origin.first, destination.first};
+        // unless both lie in the same tiny component, route between the big component
+        const bool both_in_same_tiny_component =
+            origin.first.is_in_tiny_component() &&
+            origin.first.component_id == destination.first.component_id;
+        if (!both_in_same_tiny_component)
+        {
+            if (0 != origin.first.component_id && 0 == origin.second.component_id)
+            {
+                end_points.source_phantom = origin.second;
+            }
+            if (0 != destination.first.component_id && 0 == destination.second.component_id)
+            {
+                end_points.target_phantom = destination.second;
+            }
+        }
+        if (!end_points.source_phantom.is_valid() || !end_points.target_phantom.is_valid())
+        {
+            return;
+        }
+
+        raw_route.summary_only = true;
+        raw_route.segment_end_coordinates.push_back(end_points);
+        search_engine.direct_shortest_path(raw_route.segment_end_coordinates, {}, raw_route);
+    }
+
+    tbb::enumerable_thread_specific<SearchEnginePtr> search_engines;
+    int max_batch_routes;
+    unsigned parallel_snapping_threshold;
+    std::string descriptor_string;
+    DataFacadeT *facade;
+};
+
+#endif // BATCH_ROUTE_HPP
@@ -29,22 +29,28 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define DISTANCE_TABLE_HPP
 
 #include "plugin_base.hpp"
+#include "parallel_snapping.hpp"
 
 #include "../algorithms/object_encoder.hpp"
 #include "../data_structures/query_edge.hpp"
 #include "../data_structures/search_engine.hpp"
 #include "../descriptors/descriptor_base.hpp"
 #include "../util/json_renderer.hpp"
+#include "../util/matrix_renderer.hpp"
 #include "../util/make_unique.hpp"
+#include "../util/memory_budget.hpp"
+#include "../util/request_metrics.hpp"
 #include "../util/string_util.hpp"
 #include "../util/timing_util.hpp"
 
 #include <osrm/json_container.hpp>
+#include <osrm/query_results.hpp>
 
 #include <cstdlib>
 
 #include <algorithm>
 #include <memory>
+#include <numeric>
 #include <unordered_map>
 #include <string>
 #include <vector>
@@ -54,10 +60,14 @@ template <class DataFacadeT> class DistanceTablePlugin final : public BasePlugin
   private:
     std::unique_ptr<SearchEngine<DataFacadeT>> search_engine_ptr;
     int max_locations_distance_table;
+    unsigned parallel_snapping_threshold;
 
   public:
-    explicit DistanceTablePlugin(DataFacadeT *facade, const int max_locations_distance_table)
-        : max_locations_distance_table(max_locations_distance_table), descriptor_string("table"),
+    explicit DistanceTablePlugin(DataFacadeT *facade,
+                                 const int max_locations_distance_table,
+                                 const unsigned parallel_snapping_threshold = 0)
+        : max_locations_distance_table(max_locations_distance_table),
+          parallel_snapping_threshold(parallel_snapping_threshold), descriptor_string("table"),
           facade(facade)
     {
         search_engine_ptr = osrm::make_unique<SearchEngine<DataFacadeT>>(facade);
@@ -70,62 +80,334 @@ template <class DataFacadeT> class DistanceTablePlugin final : public BasePlugin
     int HandleRequest(const RouteParameters &route_parameters,
                       osrm::json::Object &json_result) override final
     {
-        if (!check_all_coordinates(route_parameters.coordinates))
+        osrm::TableResult table;
+        std::string status_message;
+        const int status = ComputeTable(route_parameters, table, status_message);
+        if (!status_message.empty())
         {
-            return 400;
+            json_result.values["status"] = status_message;
+        }
+        if (200 != status)
+        {
+            return status;
         }
 
-        const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
-        unsigned max_locations =
-            std::min(static_cast<unsigned>(max_locations_distance_table),
-                     static_cast<unsigned>(route_parameters.coordinates.size()));
-
-        PhantomNodeArray phantom_node_vector(max_locations);
-        for (const auto i : osrm::irange(0u, max_locations))
+        osrm::metrics::PhaseTimer unpack_timer(osrm::metrics::Phase::unpack);
+        // the raw table is written out by the request handler, see util/matrix_renderer.hpp. The
+        // lengths follow the durations as a second matrix.
+        if ("matrix" == route_parameters.output_format)
         {
-            if (checksum_OK && i < route_parameters.hints.size() &&
-                !route_parameters.hints[i].empty())
+            std::string matrix;
+            osrm::json::matrix_render(matrix, table.number_of_rows, table.number_of_columns,
+                                      table.durations);
+            if (route_parameters.lengths)
             {
-                PhantomNode current_phantom_node;
-                ObjectEncoder::DecodeFromBase64(route_parameters.hints[i], current_phantom_node);
-                if (current_phantom_node.is_valid(facade->GetNumberOfNodes()))
-                {
-                    phantom_node_vector[i].emplace_back(std::move(current_phantom_node));
-                    continue;
-                }
+                osrm::json::matrix_render(matrix, table.number_of_rows, table.number_of_columns,
+                                          table.lengths);
             }
-            facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates[i],
-                                                            phantom_node_vector[i], 1);
+            json_result.values["matrix"] = osrm::json::String(std::move(matrix));
+            return 200;
+        }
+        // a bounded table lists its reachable entries only
+        if (0 != route_parameters.max_duration)
+        {
+            json_result.values["sparse_table"] = RenderSparseTable(table, route_parameters.lengths);
+            return 200;
+        }
+        json_result.values["distance_table"] =
+            RenderTable(table.durations, table.number_of_rows, table.number_of_columns);
+        if (route_parameters.lengths)
+        {
+            json_result.values["length_table"] =
+                RenderTable(table.lengths, table.number_of_rows, table.number_of_columns);
+        }
+        return 200;
+    }
+
+    int HandleTableRequest(const RouteParameters &route_parameters,
+                           osrm::TableResult &table) override final
+    {
+        std::string status_message;
+        return ComputeTable(route_parameters, table, status_message);
+    }
+
+    // Tables of any size, max_locations_distance_table does not apply. Only one tile of at most
+    // columns_per_tile destinations is kept in memory at a time.
+    int HandleTiledTableRequest(const RouteParameters &route_parameters,
+                                const unsigned columns_per_tile,
+                                const osrm::TableTileCallback &tile_callback) override final
+    {
+        if (0 == columns_per_tile)
+        {
+            return 400;
+        }
+        std::string status_message;
+        PhantomNodeArray row_phantom_nodes;
+        PhantomNodeArray column_phantom_nodes;
+        const int status = SnapLocations(route_parameters, false, row_phantom_nodes,
+                                         column_phantom_nodes, status_message);
+        if (200 != status)
+        {
+            return status;
+        }
+
+        osrm::metrics::PhaseTimer search_timer(osrm::metrics::Phase::search);
+        osrm::TableResult tile;
+        tile.number_of_rows = static_cast<unsigned>(row_phantom_nodes.size());
+        const auto emit_tile = [&tile, &tile_callback](const unsigned first_column,
+                                                       const unsigned number_of_columns,
+                                                       std::vector<EdgeWeight> &durations,
+                                                       std::vector<EdgeWeight> &lengths)
+        {
+            tile.first_column = first_column;
+            tile.number_of_columns = number_of_columns;
+            tile.durations.swap(durations);
+            tile.lengths.swap(lengths);
+            tile_callback(tile);
+        };
+        const EdgeWeight max_distance = GetMaxDistance(route_parameters);
+        if (route_parameters.lengths)
+        {
+            search_engine_ptr->distance_table.template ComputeTiledTable<true>(
+                row_phantom_nodes, column_phantom_nodes, columns_per_tile, emit_tile,
+                max_distance);
+        }
+        else
+        {
+            search_engine_ptr->distance_table.template ComputeTiledTable<false>(
+                row_phantom_nodes, column_phantom_nodes, columns_per_tile, emit_tile,
+                max_distance);
+        }
+        return 200;
+    }
 
-            BOOST_ASSERT(phantom_node_vector[i].front().is_valid(facade->GetNumberOfNodes()));
+  private:
+    int ComputeTable(const RouteParameters &route_parameters,
+                     osrm::TableResult &table,
+                     std::string &status_message)
+    {
+        PhantomNodeArray row_phantom_nodes;
+        PhantomNodeArray column_phantom_nodes;
+        const int status = SnapLocations(route_parameters, true, row_phantom_nodes,
+                                         column_phantom_nodes, status_message);
+        if (200 != status)
+        {
+            return status;
         }
 
+        osrm::metrics::PhaseTimer search_timer(osrm::metrics::Phase::search);
         // TIMER_START(distance_table);
+        std::vector<EdgeWeight> lengths;
+        const EdgeWeight max_distance = GetMaxDistance(route_parameters);
         std::shared_ptr<std::vector<EdgeWeight>> result_table =
-            search_engine_ptr->distance_table(phantom_node_vector);
+            route_parameters.lengths
+                ? search_engine_ptr->distance_table(row_phantom_nodes, column_phantom_nodes,
+                                                    lengths, max_distance)
+                : search_engine_ptr->distance_table(row_phantom_nodes, column_phantom_nodes,
+                                                    max_distance);
         // TIMER_STOP(distance_table);
+        search_timer.Stop();
 
         if (!result_table)
         {
             return 400;
         }
 
+        table.number_of_rows = static_cast<unsigned>(row_phantom_nodes.size());
+        table.number_of_columns = static_cast<unsigned>(column_phantom_nodes.size());
+        table.durations = std::move(*result_table);
+        table.lengths = std::move(lengths);
+        return 200;
+    }
+
+    // The phantom nodes of the sources and of the destinations of the table. Without
+    // limit_table_size the table may be of any size and a square table covers all coordinates.
+    int SnapLocations(const RouteParameters &route_parameters,
+                      const bool limit_table_size,
+                      PhantomNodeArray &row_phantom_nodes,
+                      PhantomNodeArray &column_phantom_nodes,
+                      std::string &status_message) const
+    {
+        if (!check_all_coordinates(route_parameters.coordinates))
+        {
+            return 400;
+        }
+
+        const auto number_of_coordinates =
+            static_cast<unsigned>(route_parameters.coordinates.size());
+        const auto index_is_invalid = [number_of_coordinates](const unsigned index)
+        {
+            return index >= number_of_coordinates;
+        };
+        if (std::any_of(route_parameters.sources.begin(), route_parameters.sources.end(),
+                        index_is_invalid) ||
+            std::any_of(route_parameters.destinations.begin(),
+                        route_parameters.destinations.end(), index_is_invalid))
+        {
+            status_message = "Invalid source or destination index.";
+            return 400;
+        }
+
+        const bool is_square_table =
+            route_parameters.sources.empty() && route_parameters.destinations.empty();
+        const unsigned max_locations =
+            limit_table_size
+                ? std::min(static_cast<unsigned>(max_locations_distance_table),
+                           number_of_coordinates)
+                : number_of_coordinates;
+
+        // a square table only covers the first max_locations coordinates, the others are ignored
+        std::vector<unsigned> sources = route_parameters.sources;
+        std::vector<unsigned> destinations = route_parameters.destinations;
+        const auto all_locations = [](const unsigned number_of_locations)
+        {
+            std::vector<unsigned> indices(number_of_locations);
+            std::iota(indices.begin(), indices.end(), 0u);
+            return indices;
+        };
+        if (sources.empty())
+        {
+            sources = all_locations(is_square_table ? max_locations : number_of_coordinates);
+        }
+        if (destinations.empty())
+        {
+            destinations = all_locations(is_square_table ? max_locations : number_of_coordinates);
+        }
+        // a table of sources and destinations is as large as the largest square table
+        if (limit_table_size &&
+            sources.size() * destinations.size() >
+                static_cast<std::size_t>(max_locations_distance_table) *
+                    max_locations_distance_table)
+        {
+            status_message = "Too many table entries.";
+            return 400;
+        }
+
+        osrm::metrics::PhaseTimer phantom_timer(osrm::metrics::Phase::phantom_lookup);
+        const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
+        // coordinates that are both a source and a destination are looked up once
+        std::vector<unsigned> locations;
+        std::vector<bool> is_location(number_of_coordinates, false);
+        const auto add_locations = [&](const std::vector<unsigned> &indices)
+        {
+            for (const unsigned i : indices)
+            {
+                if (!is_location[i])
+                {
+                    is_location[i] = true;
+                    locations.push_back(i);
+                }
+            }
+        };
+        add_locations(sources);
+        add_locations(destinations);
+        PhantomNodeArray phantom_node_vector(number_of_coordinates);
+        SnapCoordinates(locations.size(), parallel_snapping_threshold,
+                        [&](const std::size_t position)
+                        {
+                            const unsigned i = locations[position];
+                            GetPhantomNodes(route_parameters, checksum_OK, i,
+                                            phantom_node_vector[i]);
+                        });
+        if (!is_square_table)
+        {
+            for (const unsigned source : sources)
+            {
+                row_phantom_nodes.push_back(phantom_node_vector[source]);
+            }
+            for (const unsigned destination : destinations)
+            {
+                column_phantom_nodes.push_back(phantom_node_vector[destination]);
+            }
+        }
+        else
+        {
+            phantom_node_vector.resize(max_locations);
+            column_phantom_nodes = phantom_node_vector;
+            row_phantom_nodes = std::move(phantom_node_vector);
+        }
+        return 200;
+    }
+
+    // max_duration in deciseconds, the searches stop there
+    static EdgeWeight GetMaxDistance(const RouteParameters &route_parameters)
+    {
+        if (0 == route_parameters.max_duration ||
+            route_parameters.max_duration > static_cast<unsigned>(INVALID_EDGE_WEIGHT / 10))
+        {
+            return INVALID_EDGE_WEIGHT;
+        }
+        return static_cast<EdgeWeight>(10 * route_parameters.max_duration);
+    }
+
+    // [source, destination, duration(, length)] of every reachable entry
+    static osrm::json::Array RenderSparseTable(const osrm::TableResult &table,
+                                               const bool with_lengths)
+    {
+        osrm::json::Array json_array;
+        for (const auto row : osrm::irange(0u, table.number_of_rows))
+        {
+            for (const auto column : osrm::irange(0u, table.number_of_columns))
+            {
+                const EdgeWeight duration = table.duration(row, column);
+                if (INVALID_EDGE_WEIGHT == duration)
+                {
+                    continue;
+                }
+                osrm::json::Array json_entry;
+                json_entry.values.push_back(row);
+                json_entry.values.push_back(column);
+                json_entry.values.push_back(duration);
+                if (with_lengths)
+                {
+                    json_entry.values.push_back(table.length(row, column));
+                }
+                json_array.values.push_back(std::move(json_entry));
+            }
+        }
+        return json_array;
+    }
+
+    static osrm::json::Array RenderTable(const std::vector<EdgeWeight> &table,
+                                         const unsigned number_of_rows,
+                                         const unsigned number_of_columns)
+    {
+        // the document is kept until it is rendered
+        osrm::memory::Charge(table.size() * sizeof(osrm::json::Value));
         osrm::json::Array json_array;
-        const auto number_of_locations = phantom_node_vector.size();
-        for (const auto row : osrm::irange<std::size_t>(0, number_of_locations))
+        for (const auto row : osrm::irange<std::size_t>(0, number_of_rows))
         {
             osrm::json::Array json_row;
-            auto row_begin_iterator = result_table->begin() + (row * number_of_locations);
-            auto row_end_iterator = result_table->begin() + ((row + 1) * number_of_locations);
+            auto row_begin_iterator = table.begin() + (row * number_of_columns);
+            auto row_end_iterator = table.begin() + ((row + 1) * number_of_columns);
             json_row.values.insert(json_row.values.end(), row_begin_iterator, row_end_iterator);
             json_array.values.push_back(json_row);
         }
-        json_result.values["distance_table"] = json_array;
-        // osrm::json::render(reply.content, json_object);
-        return 200;
+        return json_array;
+    }
+
+    void GetPhantomNodes(const RouteParameters &route_parameters,
+                         const bool checksum_OK,
+                         const unsigned i,
+                         std::vector<PhantomNode> &phantom_nodes) const
+    {
+        if (checksum_OK && i < route_parameters.hints.size() && !route_parameters.hints[i].empty())
+        {
+            PhantomNode current_phantom_node;
+            if (ObjectEncoder::DecodePhantomNode(route_parameters.hints[i],
+                                                current_phantom_node) &&
+                current_phantom_node.is_valid(facade->GetNumberOfNodes()))
+            {
+                phantom_nodes.emplace_back(std::move(current_phantom_node));
+                return;
+            }
+        }
+        facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates[i],
+                                                        phantom_nodes, 1);
+
+        BOOST_ASSERT(phantom_nodes.front().is_valid(facade->GetNumberOfNodes()));
     }
 
-  private:
     std::string descriptor_string;
     DataFacadeT *facade;
 };
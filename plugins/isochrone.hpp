@@ -0,0 +1,250 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ISOCHRONE_PLUGIN_HPP
+#define ISOCHRONE_PLUGIN_HPP
+
+#include "plugin_base.hpp"
+
+#include "../algorithms/coordinate_calculation.hpp"
+#include "../algorithms/object_encoder.hpp"
+#include "../data_structures/search_engine.hpp"
+#include "../routing_algorithms/isochrone.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/make_unique.hpp"
+#include "../util/request_metrics.hpp"
+
+#include <osrm/json_container.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Everything reachable from a coordinate within max_time seconds. The reply lists the reached
+ * intersections with their travel times, with hull=true the outline of the area instead. The
+ * search runs over the whole graph once, the sweep order it needs is built by the first request.
+ */
+template <class DataFacadeT> class IsochronePlugin final : public BasePlugin
+{
+  private:
+    // the outline keeps the farthest reached point in each sector around the source
+    static constexpr unsigned NUMBER_OF_HULL_SECTORS = 72;
+
+    using SweepOrderPtr = std::shared_ptr<const IsochroneSweepOrder>;
+
+  public:
+    IsochronePlugin(DataFacadeT *facade, const int max_isochrone_time)
+        : max_isochrone_time(max_isochrone_time), sweep_order_built(false),
+          descriptor_string("isochrone"), facade(facade)
+    {
+        search_engine_ptr = osrm::make_unique<SearchEngine<DataFacadeT>>(facade);
+    }
+
+    virtual ~IsochronePlugin() {}
+
+    const std::string GetDescriptor() const override final { return descriptor_string; }
+
+    int HandleRequest(const RouteParameters &route_parameters,
+                      osrm::json::Object &json_result) override final
+    {
+        if (1 != route_parameters.coordinates.size() ||
+            !route_parameters.coordinates.front().is_valid())
+        {
+            json_result.values["status"] = "Exactly one coordinate needed.";
+            return 400;
+        }
+        if (0 == route_parameters.max_time ||
+            route_parameters.max_time > static_cast<unsigned>(max_isochrone_time))
+        {
+            json_result.values["status"] = "Invalid max_time.";
+            return 400;
+        }
+        const SweepOrderPtr sweep_order = GetSweepOrder();
+        if (!sweep_order)
+        {
+            json_result.values["status"] = "Isochrones need a fully contracted graph.";
+            return 400;
+        }
+
+        osrm::metrics::PhaseTimer phantom_timer(osrm::metrics::Phase::phantom_lookup);
+        std::vector<PhantomNode> phantom_node_vector;
+        const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
+        PhantomNode hinted_phantom_node;
+        if (checksum_OK && !route_parameters.hints.empty() &&
+            !route_parameters.hints.front().empty())
+        {
+            ObjectEncoder::DecodePhantomNode(route_parameters.hints.front(),
+                                             hinted_phantom_node);
+        }
+        if (hinted_phantom_node.is_valid(facade->GetNumberOfNodes()))
+        {
+            phantom_node_vector.push_back(hinted_phantom_node);
+        }
+        else
+        {
+            facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates.front(),
+                                                            phantom_node_vector, 1);
+        }
+        phantom_timer.Stop();
+        if (phantom_node_vector.empty())
+        {
+            json_result.values["status"] = 207;
+            return 200;
+        }
+        // only the closest segment is a source, not the candidates from the big component
+        phantom_node_vector.resize(1);
+        const PhantomNode &source = phantom_node_vector.front();
+
+        osrm::metrics::PhaseTimer search_timer(osrm::metrics::Phase::search);
+        std::vector<std::pair<NodeID, EdgeWeight>> reached_nodes;
+        search_engine_ptr->isochrone(phantom_node_vector, *sweep_order,
+                                     static_cast<EdgeWeight>(10 * route_parameters.max_time),
+                                     reached_nodes);
+        search_timer.Stop();
+
+        // the segments that start at the same intersection are reached there at the same time
+        std::vector<std::pair<unsigned, EdgeWeight>> reached_points;
+        reached_points.reserve(reached_nodes.size());
+        for (const auto &reached_node : reached_nodes)
+        {
+            const unsigned coordinate = sweep_order->start_coordinates[reached_node.first];
+            if (SPECIAL_NODEID != coordinate)
+            {
+                reached_points.emplace_back(coordinate, reached_node.second);
+            }
+        }
+        std::sort(reached_points.begin(), reached_points.end());
+        reached_points.erase(std::unique(reached_points.begin(), reached_points.end(),
+                                         [](const std::pair<unsigned, EdgeWeight> &lhs,
+                                            const std::pair<unsigned, EdgeWeight> &rhs)
+                                         {
+                                             return lhs.first == rhs.first;
+                                         }),
+                             reached_points.end());
+
+        osrm::metrics::PhaseTimer unpack_timer(osrm::metrics::Phase::unpack);
+        json_result.values["status"] = 0;
+        if (route_parameters.hull)
+        {
+            json_result.values["hull"] = BuildHull(source.location, reached_points);
+        }
+        else
+        {
+            osrm::json::Array json_points;
+            json_points.values.reserve(reached_points.size());
+            for (const auto &reached_point : reached_points)
+            {
+                const FixedPointCoordinate location =
+                    facade->GetCoordinateOfNode(reached_point.first);
+                osrm::json::Array json_point;
+                json_point.values.push_back(location.lat / COORDINATE_PRECISION);
+                json_point.values.push_back(location.lon / COORDINATE_PRECISION);
+                json_point.values.push_back(reached_point.second / 10.);
+                json_points.values.push_back(std::move(json_point));
+            }
+            json_result.values["reachable"] = std::move(json_points);
+        }
+        return 200;
+    }
+
+  private:
+    SweepOrderPtr GetSweepOrder()
+    {
+        std::lock_guard<std::mutex> lock(sweep_order_mutex);
+        if (!sweep_order_built)
+        {
+            sweep_order = search_engine_ptr->isochrone.BuildSweepOrder();
+            sweep_order_built = true;
+        }
+        return sweep_order;
+    }
+
+    // A star shaped outline around the source through the farthest reached point of every
+    // sector. It follows the concave parts of the area as far as the sectors resolve them.
+    osrm::json::Array BuildHull(const FixedPointCoordinate &center,
+                                const std::vector<std::pair<unsigned, EdgeWeight>> &reached_points)
+        const
+    {
+        std::vector<std::pair<double, FixedPointCoordinate>> farthest_points(
+            NUMBER_OF_HULL_SECTORS, std::make_pair(-1., FixedPointCoordinate()));
+        std::vector<FixedPointCoordinate> locations;
+        locations.reserve(reached_points.size());
+        for (const auto &reached_point : reached_points)
+        {
+            locations.push_back(facade->GetCoordinateOfNode(reached_point.first));
+        }
+        std::vector<double> distances(locations.size());
+        std::vector<float> bearings(locations.size());
+        coordinate_calculation::great_circle_distances(center, locations.data(), locations.size(),
+                                                       distances.data());
+        coordinate_calculation::bearings(center, locations.data(), locations.size(),
+                                         bearings.data());
+        for (const auto i : osrm::irange<std::size_t>(0, locations.size()))
+        {
+            const unsigned sector = std::min(
+                NUMBER_OF_HULL_SECTORS - 1,
+                static_cast<unsigned>(bearings[i] / 360.f * NUMBER_OF_HULL_SECTORS));
+            if (distances[i] > farthest_points[sector].first)
+            {
+                farthest_points[sector] = std::make_pair(distances[i], locations[i]);
+            }
+        }
+
+        osrm::json::Array json_hull;
+        for (const auto &farthest_point : farthest_points)
+        {
+            if (0. > farthest_point.first)
+            {
+                continue;
+            }
+            osrm::json::Array json_point;
+            json_point.values.push_back(farthest_point.second.lat / COORDINATE_PRECISION);
+            json_point.values.push_back(farthest_point.second.lon / COORDINATE_PRECISION);
+            json_hull.values.push_back(std::move(json_point));
+        }
+        // a closed ring
+        if (!json_hull.values.empty())
+        {
+            json_hull.values.push_back(json_hull.values.front());
+        }
+        return json_hull;
+    }
+
+    std::unique_ptr<SearchEngine<DataFacadeT>> search_engine_ptr;
+    int max_isochrone_time;
+    std::mutex sweep_order_mutex;
+    SweepOrderPtr sweep_order;
+    bool sweep_order_built;
+    std::string descriptor_string;
+    DataFacadeT *facade;
+};
+
+#endif // ISOCHRONE_PLUGIN_HPP
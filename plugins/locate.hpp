@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "plugin_base.hpp"
 
 #include "../util/json_renderer.hpp"
+#include "../util/request_metrics.hpp"
 #include "../util/string_util.hpp"
 
 #include <osrm/json_container.hpp>
@@ -54,9 +55,12 @@ template <class DataFacadeT> class LocatePlugin final : public BasePlugin
             return 400;
         }
 
+        osrm::metrics::PhaseTimer phantom_timer(osrm::metrics::Phase::phantom_lookup);
         FixedPointCoordinate result;
-        if (!facade->LocateClosestEndPointForCoordinate(route_parameters.coordinates.front(),
-                                                        result))
+        const bool found =
+            facade->LocateClosestEndPointForCoordinate(route_parameters.coordinates.front(), result);
+        phantom_timer.Stop();
+        if (!found)
         {
             json_result.values["status"] = 207;
         }
@@ -29,39 +29,63 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MATCH_HPP
 
 #include "plugin_base.hpp"
+#include "parallel_snapping.hpp"
 
 #include "../algorithms/bayes_classifier.hpp"
+#include "../algorithms/coordinate_calculation.hpp"
 #include "../algorithms/object_encoder.hpp"
+#include "../data_structures/lru_cache.hpp"
 #include "../data_structures/search_engine.hpp"
 #include "../descriptors/descriptor_base.hpp"
 #include "../descriptors/json_descriptor.hpp"
 #include "../routing_algorithms/map_matching.hpp"
+#include "../routing_algorithms/online_map_matching.hpp"
+#include "../util/bearing.hpp"
 #include "../util/compute_angle.hpp"
 #include "../util/integer_range.hpp"
 #include "../util/json_logger.hpp"
 #include "../util/json_util.hpp"
+#include "../util/request_metrics.hpp"
 #include "../util/string_util.hpp"
 
 #include <cstdlib>
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
 {
     constexpr static const unsigned max_number_of_candidates = 10;
+    // candidates this many gps_precisions farther away than the nearest one have a negligible
+    // emission probability next to it
+    constexpr static const double emission_pruning_sigmas = 5.;
+    // the direction of a bidirectional candidate is dropped if it deviates this much from a
+    // reliable heading of the trace
+    constexpr static const double opposing_heading_angle = 135.;
 
     std::shared_ptr<SearchEngine<DataFacadeT>> search_engine_ptr;
 
     using ClassifierT = BayesClassifier<LaplaceDistribution, LaplaceDistribution, double>;
     using TraceClassification = ClassifierT::ClassificationT;
+    using SessionPtr = std::shared_ptr<osrm::matching::MatchingSession>;
 
   public:
-    MapMatchingPlugin(DataFacadeT *facade, const int max_locations_map_matching)
+    MapMatchingPlugin(DataFacadeT *facade,
+                      const int max_locations_map_matching,
+                      const int max_matching_sessions,
+                      const int matching_session_ttl,
+                      const unsigned parallel_snapping_threshold = 0)
         : descriptor_string("match"), facade(facade),
           max_locations_map_matching(max_locations_map_matching),
+          max_matching_sessions(max_matching_sessions),
+          matching_session_ttl(std::chrono::seconds(matching_session_ttl)),
+          sessions(static_cast<unsigned>(std::max(1, max_matching_sessions))),
+          parallel_snapping_threshold(parallel_snapping_threshold),
           // the values where derived from fitting a laplace distribution
           // to the values of manually classified traces
           classifier(LaplaceDistribution(0.005986, 0.016646),
@@ -99,83 +123,173 @@ template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
                       osrm::matching::CandidateLists &candidates_lists)
     {
         double query_radius = 10 * gps_precision;
-        double last_distance = coordinate_calculation::great_circle_distance(input_coords[0], input_coords[1]);
 
-        sub_trace_lengths.resize(input_coords.size());
-        sub_trace_lengths[0] = 0;
+        osrm::matching::CandidateLists trace_candidates;
+        FindCandidates(input_coords, trace_candidates, query_radius);
+
+        // the distances between consecutive samples, summed up below
+        sub_trace_lengths.assign(input_coords.size(), 0.);
+        coordinate_calculation::great_circle_distances(input_coords.data(), input_coords.size(),
+                                                       sub_trace_lengths.data() + 1);
         for (const auto current_coordinate : osrm::irange<std::size_t>(0, input_coords.size()))
         {
             bool allow_uturn = false;
+            double heading = -1.;
             if (0 < current_coordinate)
             {
-                last_distance = coordinate_calculation::great_circle_distance(input_coords[current_coordinate - 1], input_coords[current_coordinate]);
-
-                sub_trace_lengths[current_coordinate] +=
-                    sub_trace_lengths[current_coordinate - 1] + last_distance;
+                sub_trace_lengths[current_coordinate] += sub_trace_lengths[current_coordinate - 1];
             }
 
             if (input_coords.size() - 1 > current_coordinate && 0 < current_coordinate)
             {
-                double turn_angle = ComputeAngle::OfThreeFixedPointCoordinates(
-                    input_coords[current_coordinate - 1], input_coords[current_coordinate],
-                    input_coords[current_coordinate + 1]);
+                const auto &previous = input_coords[current_coordinate - 1];
+                const auto &current = input_coords[current_coordinate];
+                const auto &next = input_coords[current_coordinate + 1];
+                double turn_angle =
+                    ComputeAngle::OfThreeFixedPointCoordinates(previous, current, next);
 
                 // sharp turns indicate a possible uturn
                 if (turn_angle <= 90.0 || turn_angle >= 270.0)
                 {
                     allow_uturn = true;
                 }
+                // The heading is trusted if the trace moves well beyond the gps precision and
+                // both of its legs at the point agree on the direction
+                else if (coordinate_calculation::great_circle_distance(previous, next) >
+                             4 * gps_precision &&
+                         bearing::CheckInBounds(
+                             coordinate_calculation::bearing(previous, current),
+                             static_cast<int>(
+                                 std::round(coordinate_calculation::bearing(current, next))),
+                             45))
+                {
+                    heading = coordinate_calculation::bearing(previous, next);
+                }
             }
 
-            std::vector<std::pair<PhantomNode, double>> candidates;
-            facade->IncrementalFindPhantomNodeForCoordinateWithMaxDistance(
-                    input_coords[current_coordinate], candidates, query_radius);
-
-            // sort by foward id, then by reverse id and then by distance
-            std::sort(candidates.begin(), candidates.end(),
-                [](const std::pair<PhantomNode, double>& lhs, const std::pair<PhantomNode, double>& rhs) {
-                    return lhs.first.forward_node_id < rhs.first.forward_node_id ||
-                            (lhs.first.forward_node_id == rhs.first.forward_node_id &&
-                             (lhs.first.reverse_node_id < rhs.first.reverse_node_id ||
-                              (lhs.first.reverse_node_id == rhs.first.reverse_node_id &&
-                               lhs.second < rhs.second)));
-                });
-
-            auto new_end = std::unique(candidates.begin(), candidates.end(),
-                [](const std::pair<PhantomNode, double>& lhs, const std::pair<PhantomNode, double>& rhs) {
-                    return lhs.first.forward_node_id == rhs.first.forward_node_id &&
-                           lhs.first.reverse_node_id == rhs.first.reverse_node_id;
-                });
-            candidates.resize(new_end - candidates.begin());
-
-            if (!allow_uturn)
+            auto &candidates = trace_candidates[current_coordinate];
+            normalizeCandidates(allow_uturn, candidates, heading);
+            pruneCandidates(gps_precision, candidates);
+            candidates_lists.push_back(std::move(candidates));
+        }
+
+        return true;
+    }
+
+    // drops duplicates, splits bidirectional candidates unless a u-turn is allowed and sorts the
+    // nearest ones first. With a heading in degrees, the split direction that runs against it
+    // is dominated by the other one and dropped.
+    void normalizeCandidates(const bool allow_uturn,
+                             osrm::matching::CandidateList &candidates,
+                             const double heading = -1.) const
+    {
+        // sort by foward id, then by reverse id and then by distance
+        std::sort(candidates.begin(), candidates.end(),
+            [](const std::pair<PhantomNode, double>& lhs, const std::pair<PhantomNode, double>& rhs) {
+                return lhs.first.forward_node_id < rhs.first.forward_node_id ||
+                        (lhs.first.forward_node_id == rhs.first.forward_node_id &&
+                         (lhs.first.reverse_node_id < rhs.first.reverse_node_id ||
+                          (lhs.first.reverse_node_id == rhs.first.reverse_node_id &&
+                           lhs.second < rhs.second)));
+            });
+
+        auto new_end = std::unique(candidates.begin(), candidates.end(),
+            [](const std::pair<PhantomNode, double>& lhs, const std::pair<PhantomNode, double>& rhs) {
+                return lhs.first.forward_node_id == rhs.first.forward_node_id &&
+                       lhs.first.reverse_node_id == rhs.first.reverse_node_id;
+            });
+        candidates.resize(new_end - candidates.begin());
+
+        if (!allow_uturn)
+        {
+            const auto compact_size = candidates.size();
+            for (const auto i : osrm::irange<std::size_t>(0, compact_size))
             {
-                const auto compact_size = candidates.size();
-                for (const auto i : osrm::irange<std::size_t>(0, compact_size))
+                // Split edge if it is bidirectional and append reverse direction to end of list
+                if (candidates[i].first.forward_node_id != SPECIAL_NODEID &&
+                    candidates[i].first.reverse_node_id != SPECIAL_NODEID)
                 {
-                    // Split edge if it is bidirectional and append reverse direction to end of list
-                    if (candidates[i].first.forward_node_id != SPECIAL_NODEID &&
-                        candidates[i].first.reverse_node_id != SPECIAL_NODEID)
+                    double forward_bearing = 0.;
+                    if (0. <= heading && GetSegmentBearing(candidates[i].first, forward_bearing))
                     {
-                        PhantomNode reverse_node(candidates[i].first);
-                        reverse_node.forward_node_id = SPECIAL_NODEID;
-                        candidates.push_back(std::make_pair(reverse_node, candidates[i].second));
-
-                        candidates[i].first.reverse_node_id = SPECIAL_NODEID;
+                        if (!bearing::CheckInBounds(
+                                heading, static_cast<int>(std::round(forward_bearing)),
+                                static_cast<int>(opposing_heading_angle)))
+                        {
+                            candidates[i].first.forward_node_id = SPECIAL_NODEID;
+                            continue;
+                        }
+                        const double reverse_bearing = std::fmod(forward_bearing + 180., 360.);
+                        if (!bearing::CheckInBounds(
+                                heading, static_cast<int>(std::round(reverse_bearing)),
+                                static_cast<int>(opposing_heading_angle)))
+                        {
+                            candidates[i].first.reverse_node_id = SPECIAL_NODEID;
+                            continue;
+                        }
                     }
+                    PhantomNode reverse_node(candidates[i].first);
+                    reverse_node.forward_node_id = SPECIAL_NODEID;
+                    candidates.push_back(std::make_pair(reverse_node, candidates[i].second));
+
+                    candidates[i].first.reverse_node_id = SPECIAL_NODEID;
                 }
             }
+        }
 
-            // sort by distance to make pruning effective
-            std::sort(candidates.begin(), candidates.end(),
-                [](const std::pair<PhantomNode, double>& lhs, const std::pair<PhantomNode, double>& rhs) {
-                    return lhs.second < rhs.second;
-                });
+        // sort by distance to make pruning effective
+        std::sort(candidates.begin(), candidates.end(),
+            [](const std::pair<PhantomNode, double>& lhs, const std::pair<PhantomNode, double>& rhs) {
+                return lhs.second < rhs.second;
+            });
+    }
 
-            candidates_lists.push_back(std::move(candidates));
+    // Shrinks the candidates of a point, sorted by distance, to those that may matter. The
+    // radius shrinks to where the emission probability is still comparable to that of the
+    // nearest candidate, so dense roads around a precise point leave few candidates. Of these,
+    // the nearest max_number_of_candidates remain.
+    void pruneCandidates(const double gps_precision,
+                         osrm::matching::CandidateList &candidates) const
+    {
+        if (candidates.empty())
+        {
+            return;
         }
+        const double nearest_distance = candidates.front().second;
+        const double pruning_distance = emission_pruning_sigmas * gps_precision;
+        const double max_distance =
+            std::sqrt(nearest_distance * nearest_distance + pruning_distance * pruning_distance);
+        const auto new_end =
+            std::find_if(candidates.begin(), candidates.end(),
+                         [max_distance](const std::pair<PhantomNode, double> &candidate)
+                         {
+                             return candidate.second > max_distance;
+                         });
+        candidates.resize(std::min<std::size_t>(max_number_of_candidates,
+                                                new_end - candidates.begin()));
+    }
 
-        return true;
+    // Bearing of the segment of a candidate in forward direction, from its foot point to the
+    // end of its segment. False if the candidate lies on an edge without geometry or at the very
+    // end of it.
+    bool GetSegmentBearing(const PhantomNode &phantom_node, double &segment_bearing) const
+    {
+        if (SPECIAL_EDGEID == phantom_node.packed_geometry_id)
+        {
+            return false;
+        }
+        const auto geometry = facade->GetUncompressedGeometryRange(phantom_node.packed_geometry_id);
+        for (std::size_t position = phantom_node.fwd_segment_position; position < geometry.size();
+             ++position)
+        {
+            const FixedPointCoordinate end = facade->GetCoordinateOfNode(geometry[position]);
+            if (!(end == phantom_node.location))
+            {
+                segment_bearing = coordinate_calculation::bearing(phantom_node.location, end);
+                return true;
+            }
+        }
+        return false;
     }
 
     osrm::json::Object submatchingToJSON(const osrm::matching::SubMatching &sub,
@@ -198,6 +312,7 @@ template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
         {
             DescriptionFactory factory;
             FixedPointCoordinate current_coordinate;
+            factory.Reserve(raw_route.unpacked_path_segments);
             factory.SetStartSegment(raw_route.segment_end_coordinates.front().source_phantom,
                                     raw_route.source_traversed_in_reverse.front());
             for (const auto i :
@@ -256,6 +371,42 @@ template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
         return subtrace;
     }
 
+    osrm::json::Object routeSubmatching(const osrm::matching::SubMatching &sub,
+                                        const RouteParameters &route_parameters)
+    {
+        BOOST_ASSERT(sub.nodes.size() > 1);
+
+        InternalRouteResult raw_route;
+        // the transitions found while matching are unpacked directly
+        const bool has_packed_paths =
+            sub.packed_paths.size() + 1 == sub.nodes.size() &&
+            std::none_of(sub.packed_paths.begin(), sub.packed_paths.end(),
+                         [](const std::vector<NodeID> &packed_path)
+                         {
+                             return packed_path.empty();
+                         });
+        if (has_packed_paths)
+        {
+            search_engine_ptr->map_matching.UnpackSubMatching(sub, raw_route);
+            return submatchingToJSON(sub, route_parameters, raw_route);
+        }
+
+        PhantomNodes current_phantom_node_pair;
+        for (unsigned i = 0; i < sub.nodes.size() - 1; ++i)
+        {
+            current_phantom_node_pair.source_phantom = sub.nodes[i];
+            current_phantom_node_pair.target_phantom = sub.nodes[i + 1];
+            raw_route.segment_end_coordinates.emplace_back(current_phantom_node_pair);
+        }
+        search_engine_ptr->shortest_path(
+            raw_route.segment_end_coordinates,
+            std::vector<bool>(raw_route.segment_end_coordinates.size(), true), raw_route);
+
+        BOOST_ASSERT(raw_route.shortest_path_length != INVALID_EDGE_WEIGHT);
+
+        return submatchingToJSON(sub, route_parameters, raw_route);
+    }
+
     int HandleRequest(const RouteParameters &route_parameters,
                       osrm::json::Object &json_result) final override
     {
@@ -265,6 +416,10 @@ template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
             json_result.values["status"] = "Invalid coordinates.";
             return 400;
         }
+        if (!route_parameters.session.empty())
+        {
+            return HandleSessionRequest(route_parameters, json_result);
+        }
 
         std::vector<double> sub_trace_lengths;
         osrm::matching::CandidateLists candidates_lists;
@@ -291,8 +446,10 @@ template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
             return 400;
         }
 
+        osrm::metrics::PhaseTimer phantom_timer(osrm::metrics::Phase::phantom_lookup);
         const bool found_candidates =
             getCandiates(input_coords, route_parameters.gps_precision, sub_trace_lengths, candidates_lists);
+        phantom_timer.Stop();
         if (!found_candidates)
         {
             json_result.values["status"] = "No suitable matching candidates found.";
@@ -304,10 +461,12 @@ template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
             osrm::json::Logger::get()->initialize("matching");
 
         // call the actual map matching
+        osrm::metrics::PhaseTimer search_timer(osrm::metrics::Phase::search);
         osrm::matching::SubMatchingList sub_matchings;
         search_engine_ptr->map_matching(candidates_lists, input_coords, input_timestamps,
                                         route_parameters.matching_beta,
                                         route_parameters.gps_precision, sub_matchings);
+        search_timer.Stop();
 
         if (sub_matchings.empty())
         {
@@ -315,6 +474,7 @@ template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
             return 400;
         }
 
+        osrm::metrics::PhaseTimer unpack_timer(osrm::metrics::Phase::unpack);
         osrm::json::Array matchings;
         for (auto &sub : sub_matchings)
         {
@@ -336,25 +496,7 @@ template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
                 }
             }
 
-            BOOST_ASSERT(sub.nodes.size() > 1);
-
-            // FIXME we only run this to obtain the geometry
-            // The clean way would be to get this directly from the map matching plugin
-            InternalRouteResult raw_route;
-            PhantomNodes current_phantom_node_pair;
-            for (unsigned i = 0; i < sub.nodes.size() - 1; ++i)
-            {
-                current_phantom_node_pair.source_phantom = sub.nodes[i];
-                current_phantom_node_pair.target_phantom = sub.nodes[i + 1];
-                raw_route.segment_end_coordinates.emplace_back(current_phantom_node_pair);
-            }
-            search_engine_ptr->shortest_path(
-                raw_route.segment_end_coordinates,
-                std::vector<bool>(raw_route.segment_end_coordinates.size(), true), raw_route);
-
-            BOOST_ASSERT(raw_route.shortest_path_length != INVALID_EDGE_WEIGHT);
-
-            matchings.values.emplace_back(submatchingToJSON(sub, route_parameters, raw_route));
+            matchings.values.emplace_back(routeSubmatching(sub, route_parameters));
         }
 
         if (osrm::json::Logger::get())
@@ -365,9 +507,124 @@ template <class DataFacadeT> class MapMatchingPlugin : public BasePlugin
     }
 
   private:
+    // Long traces are snapped in consecutive pieces on the worker threads, the points of a piece
+    // still share the r-tree queries of the facade
+    void FindCandidates(const std::vector<FixedPointCoordinate> &input_coords,
+                        osrm::matching::CandidateLists &trace_candidates,
+                        const double max_distance)
+    {
+        const std::size_t PIECE_SIZE = 64;
+
+        trace_candidates.resize(input_coords.size());
+        SnapCoordinateRanges(
+            input_coords.size(), parallel_snapping_threshold, PIECE_SIZE,
+            [&](const std::size_t begin, const std::size_t end)
+            {
+                if (0 == begin && input_coords.size() == end)
+                {
+                    facade->IncrementalFindPhantomNodesForCoordinatesWithMaxDistance(
+                        input_coords, trace_candidates, max_distance);
+                    return;
+                }
+                const std::vector<FixedPointCoordinate> piece(input_coords.begin() + begin,
+                                                              input_coords.begin() + end);
+                osrm::matching::CandidateLists piece_candidates;
+                facade->IncrementalFindPhantomNodesForCoordinatesWithMaxDistance(
+                    piece, piece_candidates, max_distance);
+                std::move(piece_candidates.begin(), piece_candidates.end(),
+                          trace_candidates.begin() + begin);
+            });
+    }
+
+    // Adds the coordinates to an online matching session and returns the matchings of the
+    // points that got confirmed by them, see online_map_matching.hpp
+    int HandleSessionRequest(const RouteParameters &route_parameters,
+                             osrm::json::Object &json_result)
+    {
+        if (0 == max_matching_sessions)
+        {
+            json_result.values["status"] = "Matching sessions are disabled.";
+            return 400;
+        }
+        const auto &input_coords = route_parameters.coordinates;
+        const auto &input_timestamps = route_parameters.timestamps;
+        if (input_coords.empty())
+        {
+            json_result.values["status"] = "At least one coordinate needed.";
+            return 400;
+        }
+        if (input_timestamps.size() > 0 && input_coords.size() != input_timestamps.size())
+        {
+            json_result.values["status"] = "Number of timestamps does not match number of coordinates .";
+            return 400;
+        }
+
+        osrm::metrics::PhaseTimer phantom_timer(osrm::metrics::Phase::phantom_lookup);
+        std::vector<osrm::matching::CandidateList> trace_candidates;
+        FindCandidates(input_coords, trace_candidates, 10 * route_parameters.gps_precision);
+        for (auto &candidates : trace_candidates)
+        {
+            // the next point is not known yet, so u-turns can not be detected
+            normalizeCandidates(false, candidates);
+            pruneCandidates(route_parameters.gps_precision, candidates);
+        }
+        phantom_timer.Stop();
+
+        const SessionPtr session = getSession(route_parameters.session);
+        std::lock_guard<std::mutex> session_lock(session->mutex);
+        if (session->check_sum != facade->GetCheckSum())
+        {
+            // the candidates belong to a dataset that was replaced
+            session->points.clear();
+            session->broken_points = 0;
+            session->check_sum = facade->GetCheckSum();
+        }
+
+        osrm::metrics::PhaseTimer search_timer(osrm::metrics::Phase::search);
+        osrm::matching::SubMatchingList sub_matchings;
+        for (const auto i : osrm::irange<std::size_t>(0, input_coords.size()))
+        {
+            search_engine_ptr->online_map_matching(
+                *session, trace_candidates[i], input_coords[i],
+                input_timestamps.empty() ? 0 : input_timestamps[i],
+                route_parameters.matching_beta, route_parameters.gps_precision, sub_matchings);
+        }
+        search_timer.Stop();
+
+        osrm::metrics::PhaseTimer unpack_timer(osrm::metrics::Phase::unpack);
+        osrm::json::Array matchings;
+        for (const auto &sub : sub_matchings)
+        {
+            matchings.values.emplace_back(routeSubmatching(sub, route_parameters));
+        }
+        json_result.values["matchings"] = matchings;
+        json_result.values["pending_points"] = static_cast<unsigned>(session->points.size());
+        return 200;
+    }
+
+    // an idle session is replaced by a new one once its TTL passed
+    SessionPtr getSession(const std::string &id)
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        SessionPtr session;
+        if (!sessions.Fetch(id, session) || now - session->last_use > matching_session_ttl)
+        {
+            session = std::make_shared<osrm::matching::MatchingSession>();
+            sessions.Insert(id, session);
+        }
+        session->last_use = now;
+        return session;
+    }
+
     std::string descriptor_string;
     DataFacadeT *facade;
     int max_locations_map_matching;
+    int max_matching_sessions;
+    std::chrono::steady_clock::duration matching_session_ttl;
+    LRUCache<std::string, SessionPtr> sessions;
+    std::mutex sessions_mutex;
+    unsigned parallel_snapping_threshold;
     ClassifierT classifier;
 };
 
@@ -0,0 +1,74 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef METRICS_PLUGIN_HPP
+#define METRICS_PLUGIN_HPP
+
+#include "plugin_base.hpp"
+
+#include "../util/memory_budget.hpp"
+#include "../util/request_metrics.hpp"
+
+#include <osrm/json_container.hpp>
+
+#include <string>
+
+// Reports per service latency histograms broken down by request phase, the memory peaks of the
+// requests and the memory charged by all requests in flight
+class MetricsPlugin final : public BasePlugin
+{
+  public:
+    MetricsPlugin() : descriptor_string("metrics") {}
+    const std::string GetDescriptor() const override final { return descriptor_string; }
+    int HandleRequest(const RouteParameters &route_parameters,
+                      osrm::json::Object &json_result) override final
+    {
+        (void)route_parameters; // unused
+
+        json_result.values["status"] = 0;
+        osrm::json::Object services;
+        osrm::metrics::Registry::get().Render(services);
+        json_result.values["services"] = std::move(services);
+
+        const auto &memory = osrm::memory::Global();
+        osrm::json::Object request_memory;
+        request_memory.values["in_use_bytes"] =
+            osrm::json::Number(memory.in_use.load(std::memory_order_relaxed));
+        request_memory.values["peak_bytes"] =
+            osrm::json::Number(memory.peak.load(std::memory_order_relaxed));
+        request_memory.values["limit_bytes"] = osrm::json::Number(memory.limit);
+        request_memory.values["rejected"] =
+            osrm::json::Number(memory.rejected.load(std::memory_order_relaxed));
+        json_result.values["request_memory"] = std::move(request_memory);
+        return 200;
+    }
+
+  private:
+    std::string descriptor_string;
+};
+
+#endif // METRICS_PLUGIN_HPP
@@ -33,10 +33,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../data_structures/phantom_node.hpp"
 #include "../util/integer_range.hpp"
 #include "../util/json_renderer.hpp"
+#include "../util/request_metrics.hpp"
 
 #include <osrm/json_container.hpp>
 
 #include <string>
+#include <utility>
 
 /*
  * This Plugin locates the nearest point on a street in the road network for a given coordinate.
@@ -59,10 +61,16 @@ template <class DataFacadeT> class NearestPlugin final : public BasePlugin
             return 400;
         }
         auto number_of_results = static_cast<std::size_t>(route_parameters.num_results);
+        osrm::metrics::PhaseTimer phantom_timer(osrm::metrics::Phase::phantom_lookup);
         std::vector<PhantomNode> phantom_node_vector;
+        const auto bearing = route_parameters.bearings.empty()
+                                 ? std::make_pair(0, 180)
+                                 : route_parameters.bearings.front();
         facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates.front(),
                                                         phantom_node_vector,
-                                                        static_cast<int>(number_of_results));
+                                                        static_cast<int>(number_of_results),
+                                                        bearing.first, bearing.second);
+        phantom_timer.Stop();
 
         if (phantom_node_vector.empty() || !phantom_node_vector.front().is_valid())
         {
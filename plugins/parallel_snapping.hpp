@@ -0,0 +1,82 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef PARALLEL_SNAPPING_HPP
+#define PARALLEL_SNAPPING_HPP
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+
+#include <cstddef>
+
+// Calls snap_range(begin, end) for consecutive ranges covering the coordinates
+// [0, number_of_coordinates) of a request. From parallel_threshold coordinates on the ranges hold
+// about range_size coordinates and are snapped on the worker threads, below it or with a
+// threshold of 0 the whole request is a single range snapped on the calling thread. The r-tree of
+// the facades only reads its nodes and the mapped leaves and the phantom node cache locks its
+// shards, so snap_range may query the facade concurrently as long as it only writes the results
+// of its own range.
+template <typename SnapRangeFunctionT>
+void SnapCoordinateRanges(const std::size_t number_of_coordinates,
+                          const unsigned parallel_threshold,
+                          const std::size_t range_size,
+                          const SnapRangeFunctionT &snap_range)
+{
+    if (0 == parallel_threshold || number_of_coordinates < parallel_threshold)
+    {
+        snap_range(std::size_t(0), number_of_coordinates);
+        return;
+    }
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, number_of_coordinates, range_size),
+                      [&snap_range](const tbb::blocked_range<std::size_t> &range)
+                      {
+                          snap_range(range.begin(), range.end());
+                      },
+                      tbb::simple_partitioner());
+}
+
+// Calls snap(i) for every coordinate of a request, see SnapCoordinateRanges
+template <typename SnapFunctionT>
+void SnapCoordinates(const std::size_t number_of_coordinates,
+                     const unsigned parallel_threshold,
+                     const SnapFunctionT &snap)
+{
+    // a single r-tree query is cheap, smaller ranges are not worth the scheduling
+    const std::size_t RANGE_SIZE = 16;
+
+    SnapCoordinateRanges(number_of_coordinates, parallel_threshold, RANGE_SIZE,
+                         [&snap](const std::size_t begin, const std::size_t end)
+                         {
+                             for (std::size_t i = begin; i < end; ++i)
+                             {
+                                 snap(i);
+                             }
+                         });
+}
+
+#endif // PARALLEL_SNAPPING_HPP
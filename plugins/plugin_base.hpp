@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/coordinate.hpp>
 #include <osrm/json_container.hpp>
+#include <osrm/query_results.hpp>
 #include <osrm/route_parameters.hpp>
 
 #include <algorithm>
@@ -44,6 +45,15 @@ class BasePlugin
     virtual ~BasePlugin() {}
     virtual const std::string GetDescriptor() const = 0;
     virtual int HandleRequest(const RouteParameters &, osrm::json::Object &) = 0;
+    // typed results without a JSON document, a plugin without them answers 400
+    virtual int HandleTableRequest(const RouteParameters &, osrm::TableResult &) { return 400; }
+    virtual int HandleTiledTableRequest(const RouteParameters &,
+                                        const unsigned,
+                                        const osrm::TableTileCallback &)
+    {
+        return 400;
+    }
+    virtual int HandleRouteRequest(const RouteParameters &, osrm::RouteResult &) { return 400; }
     virtual bool
     check_all_coordinates(const std::vector<FixedPointCoordinate> &coordinates) const final
     {
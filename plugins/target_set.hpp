@@ -0,0 +1,212 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef TARGET_SET_HPP
+#define TARGET_SET_HPP
+
+#include "plugin_base.hpp"
+#include "parallel_snapping.hpp"
+
+#include "../algorithms/object_encoder.hpp"
+#include "../data_structures/lru_cache.hpp"
+#include "../data_structures/search_engine.hpp"
+#include "../routing_algorithms/rphast.hpp"
+#include "../util/integer_range.hpp"
+#include "../util/make_unique.hpp"
+#include "../util/request_metrics.hpp"
+
+#include <osrm/json_container.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/*
+ * Distance tables against a fixed set of targets, e.g. depots that many vehicles are matched
+ * against. A request without target_set registers its coordinates as a new target set and
+ * returns its handle; a request with target_set=<handle> returns the distances of its
+ * coordinates to all targets of the set.
+ */
+template <class DataFacadeT> class TargetSetPlugin final : public BasePlugin
+{
+  private:
+    // registered sets beyond this are dropped, least recently used first
+    static constexpr unsigned MAX_TARGET_SETS = 16;
+
+    using TargetSetPtr = std::shared_ptr<const RPHASTTargetSet>;
+
+  public:
+    TargetSetPlugin(DataFacadeT *facade,
+                    const int max_locations_target_set,
+                    const int max_locations_distance_table,
+                    const unsigned parallel_snapping_threshold = 0)
+        : max_locations_target_set(max_locations_target_set),
+          max_locations_distance_table(max_locations_distance_table),
+          parallel_snapping_threshold(parallel_snapping_threshold), target_sets(MAX_TARGET_SETS),
+          next_handle(0), descriptor_string("targets"), facade(facade)
+    {
+        search_engine_ptr = osrm::make_unique<SearchEngine<DataFacadeT>>(facade);
+    }
+
+    virtual ~TargetSetPlugin() {}
+
+    const std::string GetDescriptor() const override final { return descriptor_string; }
+
+    int HandleRequest(const RouteParameters &route_parameters,
+                      osrm::json::Object &json_result) override final
+    {
+        if (route_parameters.coordinates.empty() ||
+            std::any_of(route_parameters.coordinates.begin(), route_parameters.coordinates.end(),
+                        [](const FixedPointCoordinate &coordinate)
+                        {
+                            return !coordinate.is_valid();
+                        }))
+        {
+            json_result.values["status"] = "Invalid coordinates.";
+            return 400;
+        }
+        if (route_parameters.target_set.empty())
+        {
+            return RegisterTargetSet(route_parameters, json_result);
+        }
+        return QueryTargetSet(route_parameters, json_result);
+    }
+
+  private:
+    int RegisterTargetSet(const RouteParameters &route_parameters, osrm::json::Object &json_result)
+    {
+        if (route_parameters.coordinates.size() > static_cast<unsigned>(max_locations_target_set))
+        {
+            json_result.values["status"] = "Too many targets.";
+            return 400;
+        }
+
+        const PhantomNodeArray targets = GetPhantomNodes(route_parameters);
+
+        osrm::metrics::PhaseTimer search_timer(osrm::metrics::Phase::search);
+        TargetSetPtr target_set = search_engine_ptr->rphast.SelectTargets(targets);
+        search_timer.Stop();
+        if (!target_set)
+        {
+            json_result.values["status"] = "Target sets need a fully contracted graph.";
+            return 400;
+        }
+
+        std::string handle;
+        {
+            std::lock_guard<std::mutex> lock(target_sets_mutex);
+            handle = std::to_string(next_handle++);
+            target_sets.Insert(handle, target_set);
+        }
+        json_result.values["target_set"] = handle;
+        json_result.values["number_of_targets"] = target_set->GetNumberOfTargets();
+        json_result.values["number_of_nodes"] = static_cast<unsigned>(target_set->nodes.size());
+        return 200;
+    }
+
+    int QueryTargetSet(const RouteParameters &route_parameters, osrm::json::Object &json_result)
+    {
+        TargetSetPtr target_set;
+        {
+            std::lock_guard<std::mutex> lock(target_sets_mutex);
+            target_sets.Fetch(route_parameters.target_set, target_set);
+        }
+        // a reloaded dataset invalidates the node ids of the sets selected before
+        if (!target_set || target_set->check_sum != facade->GetCheckSum())
+        {
+            json_result.values["status"] = "Unknown target set.";
+            return 400;
+        }
+        if (route_parameters.coordinates.size() >
+            static_cast<unsigned>(max_locations_distance_table))
+        {
+            json_result.values["status"] = "Too many coordinates.";
+            return 400;
+        }
+
+        const PhantomNodeArray sources = GetPhantomNodes(route_parameters);
+
+        osrm::metrics::PhaseTimer search_timer(osrm::metrics::Phase::search);
+        std::shared_ptr<std::vector<EdgeWeight>> result_table =
+            search_engine_ptr->rphast(sources, *target_set);
+        search_timer.Stop();
+
+        osrm::metrics::PhaseTimer unpack_timer(osrm::metrics::Phase::unpack);
+        osrm::json::Array json_array;
+        const auto number_of_targets = target_set->GetNumberOfTargets();
+        for (const auto row : osrm::irange<std::size_t>(0, sources.size()))
+        {
+            osrm::json::Array json_row;
+            auto row_begin_iterator = result_table->begin() + (row * number_of_targets);
+            auto row_end_iterator = result_table->begin() + ((row + 1) * number_of_targets);
+            json_row.values.insert(json_row.values.end(), row_begin_iterator, row_end_iterator);
+            json_array.values.push_back(json_row);
+        }
+        json_result.values["distance_table"] = json_array;
+        return 200;
+    }
+
+    PhantomNodeArray GetPhantomNodes(const RouteParameters &route_parameters) const
+    {
+        osrm::metrics::PhaseTimer phantom_timer(osrm::metrics::Phase::phantom_lookup);
+        const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
+        PhantomNodeArray phantom_node_vector(route_parameters.coordinates.size());
+        SnapCoordinates(
+            route_parameters.coordinates.size(), parallel_snapping_threshold,
+            [&](const std::size_t i)
+            {
+                if (checksum_OK && i < route_parameters.hints.size() &&
+                    !route_parameters.hints[i].empty())
+                {
+                    PhantomNode current_phantom_node;
+                    if (ObjectEncoder::DecodePhantomNode(route_parameters.hints[i],
+                                                        current_phantom_node) &&
+                        current_phantom_node.is_valid(facade->GetNumberOfNodes()))
+                    {
+                        phantom_node_vector[i].emplace_back(std::move(current_phantom_node));
+                        return;
+                    }
+                }
+                facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates[i],
+                                                                phantom_node_vector[i], 1);
+            });
+        return phantom_node_vector;
+    }
+
+    std::unique_ptr<SearchEngine<DataFacadeT>> search_engine_ptr;
+    int max_locations_target_set;
+    int max_locations_distance_table;
+    unsigned parallel_snapping_threshold;
+    std::mutex target_sets_mutex;
+    LRUCache<std::string, TargetSetPtr> target_sets;
+    unsigned next_handle;
+    std::string descriptor_string;
+    DataFacadeT *facade;
+};
+
+#endif // TARGET_SET_HPP
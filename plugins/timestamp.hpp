@@ -52,6 +52,8 @@ template <class DataFacadeT> class TimestampPlugin final : public BasePlugin
         json_result.values["status"] = 0;
         const std::string timestamp = facade->GetTimestamp();
         json_result.values["timestamp"] = timestamp;
+        // instances that report the same checksum can be combined, see tools/table_coordinator
+        json_result.values["check_sum"] = static_cast<double>(facade->GetCheckSum());
         return 200;
     }
 
@@ -29,18 +29,24 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define TRIP_HPP
 
 #include "plugin_base.hpp"
+#include "parallel_snapping.hpp"
 
 #include "../algorithms/object_encoder.hpp"
 #include "../algorithms/tarjan_scc.hpp"
 #include "../algorithms/trip_nearest_neighbour.hpp"
 #include "../algorithms/trip_farthest_insertion.hpp"
 #include "../algorithms/trip_brute_force.hpp"
+#include "../algorithms/trip_local_search.hpp"
 #include "../data_structures/search_engine.hpp"
+#include "../data_structures/search_space_cache.hpp"
 #include "../data_structures/matrix_graph_wrapper.hpp" // wrapper to use tarjan
                                                        // scc on dist table
 #include "../descriptors/descriptor_base.hpp"          // to make json output
 #include "../descriptors/json_descriptor.hpp"          // to make json output
+#include "../util/integer_range.hpp"
 #include "../util/make_unique.hpp"
+#include "../util/query_cancellation.hpp"
+#include "../util/request_metrics.hpp"
 #include "../util/timing_util.hpp"        // to time runtime
 #include "../util/simple_logger.hpp"      // for logging output
 #include "../util/dist_table_wrapper.hpp" // to access the dist
@@ -49,6 +55,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <osrm/json_container.hpp>
 #include <boost/assert.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <chrono>
 #include <cstdlib>
 #include <algorithm>
 #include <memory>
@@ -63,11 +73,21 @@ template <class DataFacadeT> class RoundTripPlugin final : public BasePlugin
     std::string descriptor_string;
     DataFacadeT *facade;
     std::unique_ptr<SearchEngine<DataFacadeT>> search_engine_ptr;
+    std::unique_ptr<SearchSpaceCache> search_space_cache;
+    unsigned parallel_snapping_threshold;
 
   public:
-    explicit RoundTripPlugin(DataFacadeT *facade) : descriptor_string("trip"), facade(facade)
+    explicit RoundTripPlugin(DataFacadeT *facade,
+                             const unsigned trip_cache_size = 0,
+                             const unsigned parallel_snapping_threshold = 0)
+        : descriptor_string("trip"), facade(facade),
+          parallel_snapping_threshold(parallel_snapping_threshold)
     {
         search_engine_ptr = osrm::make_unique<SearchEngine<DataFacadeT>>(facade);
+        if (trip_cache_size > 0)
+        {
+            search_space_cache = osrm::make_unique<SearchSpaceCache>(trip_cache_size);
+        }
     }
 
     const std::string GetDescriptor() const override final { return descriptor_string; }
@@ -78,28 +98,31 @@ template <class DataFacadeT> class RoundTripPlugin final : public BasePlugin
         const bool checksum_OK = (route_parameters.check_sum == facade->GetCheckSum());
 
         // find phantom nodes for all input coords
-        for (const auto i : osrm::irange<std::size_t>(0, route_parameters.coordinates.size()))
-        {
-            // if client hints are helpful, encode hints
-            if (checksum_OK && i < route_parameters.hints.size() &&
-                !route_parameters.hints[i].empty())
+        SnapCoordinates(
+            route_parameters.coordinates.size(), parallel_snapping_threshold,
+            [&](const std::size_t i)
             {
-                PhantomNode current_phantom_node;
-                ObjectEncoder::DecodeFromBase64(route_parameters.hints[i], current_phantom_node);
-                if (current_phantom_node.is_valid(facade->GetNumberOfNodes()))
+                // if client hints are helpful, encode hints
+                if (checksum_OK && i < route_parameters.hints.size() &&
+                    !route_parameters.hints[i].empty())
                 {
-                    phantom_node_vector[i].emplace_back(std::move(current_phantom_node));
-                    continue;
+                    PhantomNode current_phantom_node;
+                    if (ObjectEncoder::DecodePhantomNode(route_parameters.hints[i],
+                                                        current_phantom_node) &&
+                        current_phantom_node.is_valid(facade->GetNumberOfNodes()))
+                    {
+                        phantom_node_vector[i].emplace_back(std::move(current_phantom_node));
+                        return;
+                    }
                 }
-            }
-            facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates[i],
-                                                            phantom_node_vector[i], 1);
-            if (phantom_node_vector[i].size() > 1)
-            {
-                phantom_node_vector[i].erase(std::begin(phantom_node_vector[i]));
-            }
-            BOOST_ASSERT(phantom_node_vector[i].front().is_valid(facade->GetNumberOfNodes()));
-        }
+                facade->IncrementalFindPhantomNodeForCoordinate(route_parameters.coordinates[i],
+                                                                phantom_node_vector[i], 1);
+                if (phantom_node_vector[i].size() > 1)
+                {
+                    phantom_node_vector[i].erase(std::begin(phantom_node_vector[i]));
+                }
+                BOOST_ASSERT(phantom_node_vector[i].front().is_valid(facade->GetNumberOfNodes()));
+            });
     }
 
     // Object to hold all strongly connected components (scc) of a graph
@@ -146,12 +169,13 @@ template <class DataFacadeT> class RoundTripPlugin final : public BasePlugin
         std::vector<std::size_t> range;
     };
 
-    // takes the number of locations and its distance matrix,
+    // takes the phantom nodes of the locations and their distance matrix,
     // identifies and splits the graph in its strongly connected components (scc)
     // and returns an SCC_Component
-    SCC_Component SplitUnaccessibleLocations(const std::size_t number_of_locations,
+    SCC_Component SplitUnaccessibleLocations(const PhantomNodeArray &phantom_node_vector,
                                              const DistTableWrapper<EdgeWeight> &result_table)
     {
+        const std::size_t number_of_locations = phantom_node_vector.size();
 
         if (std::find(std::begin(result_table), std::end(result_table), INVALID_EDGE_WEIGHT) ==
             std::end(result_table))
@@ -162,7 +186,22 @@ template <class DataFacadeT> class RoundTripPlugin final : public BasePlugin
             return SCC_Component(std::move(location_ids));
         }
 
-        // Run TarjanSCC
+        const bool any_tiny_component =
+            std::any_of(phantom_node_vector.begin(), phantom_node_vector.end(),
+                        [](const std::vector<PhantomNode> &phantom_nodes)
+                        {
+                            return phantom_nodes.front().is_in_tiny_component();
+                        });
+
+        // All locations are in big components, of which there are only a few, like islands
+        // without a ferry. Reachability is transitive, so a location belongs to the component
+        // of the first location that it can reach and that can reach it.
+        if (!any_tiny_component)
+        {
+            return GroupByMutualReachability(number_of_locations, result_table);
+        }
+
+        // Run TarjanSCC, locations in tiny components may all be in components of their own
         auto wrapper = std::make_shared<MatrixGraphWrapper<EdgeWeight>>(result_table.GetTable(),
                                                                         number_of_locations);
         auto scc = TarjanSCC<MatrixGraphWrapper<EdgeWeight>>(wrapper);
@@ -194,6 +233,43 @@ template <class DataFacadeT> class RoundTripPlugin final : public BasePlugin
         return SCC_Component(std::move(components), std::move(range));
     }
 
+    SCC_Component GroupByMutualReachability(const std::size_t number_of_locations,
+                                            const DistTableWrapper<EdgeWeight> &result_table)
+    {
+        std::vector<NodeID> representatives;
+        std::vector<std::vector<NodeID>> members;
+        for (const auto location : osrm::irange<NodeID>(0, number_of_locations))
+        {
+            const auto representative =
+                std::find_if(representatives.begin(), representatives.end(),
+                             [&](const NodeID other)
+                             {
+                                 return result_table(location, other) != INVALID_EDGE_WEIGHT &&
+                                        result_table(other, location) != INVALID_EDGE_WEIGHT;
+                             });
+            if (representative == representatives.end())
+            {
+                representatives.push_back(location);
+                members.emplace_back(1, location);
+            }
+            else
+            {
+                members[representative - representatives.begin()].push_back(location);
+            }
+        }
+
+        std::vector<NodeID> components;
+        std::vector<std::size_t> range;
+        components.reserve(number_of_locations);
+        range.reserve(members.size());
+        for (const auto &component : members)
+        {
+            range.push_back(components.size());
+            components.insert(components.end(), component.begin(), component.end());
+        }
+        return SCC_Component(std::move(components), std::move(range));
+    }
+
     void SetLocPermutationOutput(const std::vector<NodeID> &permutation,
                                  osrm::json::Object &json_result)
     {
@@ -203,6 +279,53 @@ template <class DataFacadeT> class RoundTripPlugin final : public BasePlugin
         json_result.values["permutation"] = json_permutation;
     }
 
+    // Like the distance table of the search engine, but only the locations whose search spaces
+    // are not cached yet are searched from, the rest of the table is joined from the cache
+    std::shared_ptr<std::vector<EdgeWeight>>
+    ComputeCachedDistanceTable(const PhantomNodeArray &phantom_node_vector)
+    {
+        const unsigned check_sum = facade->GetCheckSum();
+        std::vector<SearchSpaceCache::EntryPointer> entries(phantom_node_vector.size());
+        PhantomNodeArray missing_phantom_nodes;
+        std::vector<std::size_t> missing_locations;
+        for (const auto i : osrm::irange<std::size_t>(0, phantom_node_vector.size()))
+        {
+            if (!search_space_cache->Fetch(phantom_node_vector[i].front(), check_sum, entries[i]))
+            {
+                missing_phantom_nodes.push_back({phantom_node_vector[i].front()});
+                missing_locations.push_back(i);
+            }
+        }
+
+        if (!missing_locations.empty())
+        {
+            std::vector<SearchSpace> forward_search_spaces;
+            std::vector<SearchSpace> backward_search_spaces;
+            search_engine_ptr->distance_table.ComputeSearchSpaces(
+                missing_phantom_nodes, forward_search_spaces, backward_search_spaces);
+            for (const auto i : osrm::irange<std::size_t>(0, missing_locations.size()))
+            {
+                auto entry = std::make_shared<SearchSpaceCache::Entry>();
+                entry->phantom_node = missing_phantom_nodes[i].front();
+                entry->check_sum = check_sum;
+                entry->forward_search_space = std::move(forward_search_spaces[i]);
+                entry->backward_search_space = std::move(backward_search_spaces[i]);
+                entries[missing_locations[i]] = entry;
+                search_space_cache->Insert(std::move(entry));
+            }
+        }
+
+        std::vector<const SearchSpace *> forward_search_spaces;
+        std::vector<const SearchSpace *> backward_search_spaces;
+        for (const auto &entry : entries)
+        {
+            forward_search_spaces.push_back(&entry->forward_search_space);
+            backward_search_spaces.push_back(&entry->backward_search_space);
+        }
+        return search_engine_ptr->distance_table.JoinSearchSpaces(forward_search_spaces,
+                                                                  backward_search_spaces);
+    }
+
     InternalRouteResult ComputeRoute(const PhantomNodeArray &phantom_node_vector,
                                      const RouteParameters &route_parameters,
                                      const std::vector<NodeID> &trip)
@@ -240,74 +363,100 @@ template <class DataFacadeT> class RoundTripPlugin final : public BasePlugin
         }
 
         // get phantom nodes
+        osrm::metrics::PhaseTimer phantom_timer(osrm::metrics::Phase::phantom_lookup);
         PhantomNodeArray phantom_node_vector(route_parameters.coordinates.size());
         GetPhantomNodes(route_parameters, phantom_node_vector);
+        phantom_timer.Stop();
         const auto number_of_locations = phantom_node_vector.size();
 
         // compute the distance table of all phantom nodes
+        osrm::metrics::PhaseTimer search_timer(osrm::metrics::Phase::search);
         const auto result_table = DistTableWrapper<EdgeWeight>(
-            *search_engine_ptr->distance_table(phantom_node_vector), number_of_locations);
+            search_space_cache ? ComputeCachedDistanceTable(phantom_node_vector)
+                               : search_engine_ptr->distance_table(phantom_node_vector),
+            number_of_locations);
 
         if (result_table.size() == 0)
         {
             return 400;
         }
 
-        const constexpr std::size_t BF_MAX_FEASABLE = 10;
+        // components below this size are solved exactly by branch and bound
+        const constexpr std::size_t BF_MAX_FEASABLE = 14;
+        // upper bound of the improvement time a request may ask for, in milliseconds
+        const constexpr unsigned MAX_IMPROVEMENT_TIME = 1000;
         BOOST_ASSERT_MSG(result_table.size() == number_of_locations * number_of_locations,
                          "Distance Table has wrong size.");
 
         // get scc components
-        SCC_Component scc = SplitUnaccessibleLocations(number_of_locations, result_table);
+        SCC_Component scc = SplitUnaccessibleLocations(phantom_node_vector, result_table);
 
         using NodeIDIterator = typename std::vector<NodeID>::const_iterator;
 
-        std::vector<std::vector<NodeID>> route_result;
-        route_result.reserve(scc.GetNumberOfComponents());
-        TIMER_START(TRIP_TIMER);
-        // run Trip computation for every SCC
-        for (std::size_t k = 0; k < scc.GetNumberOfComponents(); ++k)
-        {
-            const auto component_size = scc.range[k + 1] - scc.range[k];
-
-            BOOST_ASSERT_MSG(component_size >= 0, "invalid component size");
+        // all components share the time budget of the local search
+        const auto improvement_deadline =
+            std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(
+                std::min(route_parameters.improvement_time, MAX_IMPROVEMENT_TIME));
 
-            if (component_size > 1)
+        std::vector<std::vector<NodeID>> route_result(scc.GetNumberOfComponents());
+        TIMER_START(TRIP_TIMER);
+        // run Trip computation for every SCC, the components are independent of each other
+        const auto cancellation_token = osrm::cancellation::Current();
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, scc.GetNumberOfComponents(), 1),
+            [&](const tbb::blocked_range<std::size_t> &range)
             {
-                std::vector<NodeID> scc_route;
-                NodeIDIterator start = std::begin(scc.component) + scc.range[k];
-                NodeIDIterator end = std::begin(scc.component) + scc.range[k + 1];
-
-                if (component_size < BF_MAX_FEASABLE)
-                {
-                    scc_route =
-                        osrm::trip::BruteForceTrip(start, end, number_of_locations, result_table);
-                }
-                else
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                const SearchEngineData::HeapScope heap_scope;
+                for (auto k = range.begin(); k != range.end(); ++k)
                 {
-                    scc_route = osrm::trip::FarthestInsertionTrip(start, end, number_of_locations,
-                                                                  result_table);
+                    const auto component_size = scc.range[k + 1] - scc.range[k];
+
+                    BOOST_ASSERT_MSG(component_size >= 0, "invalid component size");
+
+                    if (component_size > 1)
+                    {
+                        std::vector<NodeID> scc_route;
+                        NodeIDIterator start = std::begin(scc.component) + scc.range[k];
+                        NodeIDIterator end = std::begin(scc.component) + scc.range[k + 1];
+
+                        if (component_size < BF_MAX_FEASABLE)
+                        {
+                            scc_route = osrm::trip::BruteForceTrip(start, end, number_of_locations,
+                                                                   result_table);
+                        }
+                        else
+                        {
+                            scc_route = osrm::trip::FarthestInsertionTrip(
+                                start, end, number_of_locations, result_table);
+                            if (route_parameters.improvement_time > 0)
+                            {
+                                scc_route = osrm::trip::ImproveTrip(scc_route, result_table,
+                                                                    improvement_deadline);
+                            }
+                        }
+
+                        // use this output if debugging of route is needed:
+                        // SimpleLogger().Write() << "Route #" << k << ": " << [&scc_route]()
+                        // {
+                        //     std::string s = "";
+                        //     for (auto x : scc_route)
+                        //     {
+                        //         s += std::to_string(x) + " ";
+                        //     }
+                        //     return s;
+                        // }();
+
+                        route_result[k] = std::move(scc_route);
+                    }
+                    else
+                    {
+                        // if component only consists of one node, add it to the result routes
+                        route_result[k] = {scc.component[scc.range[k]]};
+                    }
                 }
-
-                // use this output if debugging of route is needed:
-                // SimpleLogger().Write() << "Route #" << k << ": " << [&scc_route]()
-                // {
-                //     std::string s = "";
-                //     for (auto x : scc_route)
-                //     {
-                //         s += std::to_string(x) + " ";
-                //     }
-                //     return s;
-                // }();
-
-                route_result.push_back(std::move(scc_route));
-            }
-            else
-            {
-                // if component only consists of one node, add it to the result routes
-                route_result.emplace_back(scc.component[scc.range[k]]);
-            }
-        }
+            });
 
         // compute all round trip routes
         std::vector<InternalRouteResult> comp_route;
@@ -319,11 +468,13 @@ template <class DataFacadeT> class RoundTripPlugin final : public BasePlugin
         }
 
         TIMER_STOP(TRIP_TIMER);
+        search_timer.Stop();
 
         SimpleLogger().Write() << "Trip calculation took: " << TIMER_MSEC(TRIP_TIMER) / 1000.
                                << "s";
 
         // prepare JSON output
+        osrm::metrics::PhaseTimer unpack_timer(osrm::metrics::Phase::unpack);
         // create a json object for every trip
         osrm::json::Array trip;
         for (std::size_t i = 0; i < route_result.size(); ++i)
@@ -28,12 +28,14 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "contractor/processing_chain.hpp"
 #include "contractor/contractor_options.hpp"
 #include "util/simple_logger.hpp"
+#include "util/thread_affinity.hpp"
 
 #include <boost/program_options/errors.hpp>
 
 #include <tbb/task_scheduler_init.h>
 
 #include <exception>
+#include <memory>
 #include <ostream>
 
 int main(int argc, char *argv[])
@@ -92,6 +94,11 @@ int main(int argc, char *argv[])
         SimpleLogger().Write() << "Threads: " << contractor_config.requested_num_threads;
 
         tbb::task_scheduler_init init(contractor_config.requested_num_threads);
+        std::unique_ptr<osrm::affinity::TBBThreadPinning> thread_pinning;
+        if (contractor_config.pin_threads)
+        {
+            thread_pinning.reset(new osrm::affinity::TBBThreadPinning());
+        }
 
         return Prepare(contractor_config).Run();
     }
@@ -9,6 +9,8 @@ access_tag_whitelist = { ["yes"] = true, ["permissive"] = true, ["designated"] =
 access_tag_blacklist = { ["no"] = true, ["private"] = true, ["agricultural"] = true, ["forestry"] = true }
 access_tag_restricted = { ["destination"] = true, ["delivery"] = true }
 access_tags_hierachy = { "bicycle", "vehicle", "access" }
+-- nodes without any of these keys are not passed to node_function
+node_function_keys = { "barrier", "highway", "bicycle", "vehicle", "access" }
 cycleway_tags = {["track"]=true,["lane"]=true,["opposite"]=true,["opposite_lane"]=true,["opposite_track"]=true,["share_busway"]=true,["sharrow"]=true,["shared"]=true }
 service_tag_restricted = { ["parking_aisle"] = true }
 restriction_exception_tags = { "bicycle", "vehicle", "access" }
@@ -115,14 +117,7 @@ local function parse_maxspeed(source)
     if not source then
         return 0
     end
-    local n = tonumber(source:match("%d*"))
-    if not n then
-        n = 0
-    end
-    if string.match(source, "mph") or string.match(source, "mp/h") then
-        n = (n*1609)/1000
-    end
-    return n
+    return parseMaxspeed(source)
 end
 
 function get_exceptions(vector)
@@ -131,9 +126,9 @@ function get_exceptions(vector)
   end
 end
 
-function node_function (node, result)
+function node_function (node, result, tags)
   -- parse access and barrier tags
-  local highway = node:get_value_by_key("highway")
+  local highway = tags["highway"]
   local is_crossing = highway and highway == "crossing"
 
   local access = find_access_tag(node, access_tags_hierachy)
@@ -144,7 +139,7 @@ function node_function (node, result)
       result.barrier = true
     end
   else
-    local barrier = node:get_value_by_key("barrier")
+    local barrier = tags["barrier"]
     if barrier and "" ~= barrier then
       if not barrier_whitelist[barrier] then
         result.barrier = true
@@ -153,21 +148,21 @@ function node_function (node, result)
   end
 
   -- check if node is a traffic light
-  local tag = node:get_value_by_key("highway")
+  local tag = tags["highway"]
   if tag and "traffic_signals" == tag then
     result.traffic_lights = true
   end
 end
 
-function way_function (way, result)
+function way_function (way, result, tags)
   -- initial routability check, filters out buildings, boundaries, etc
-  local highway = way:get_value_by_key("highway")
-  local route = way:get_value_by_key("route")
-  local man_made = way:get_value_by_key("man_made")
-  local railway = way:get_value_by_key("railway")
-  local amenity = way:get_value_by_key("amenity")
-  local public_transport = way:get_value_by_key("public_transport")
-  local bridge = way:get_value_by_key("bridge")
+  local highway = tags["highway"]
+  local route = tags["route"]
+  local man_made = tags["man_made"]
+  local railway = tags["railway"]
+  local amenity = tags["amenity"]
+  local public_transport = tags["public_transport"]
+  local bridge = tags["bridge"]
   if (not highway or highway == '') and
   (not use_public_transport or not route or route == '') and
   (not use_public_transport or not railway or railway=='') and
@@ -191,24 +186,24 @@ function way_function (way, result)
   end
 
   -- other tags
-  local name = way:get_value_by_key("name")
-  local ref = way:get_value_by_key("ref")
-  local junction = way:get_value_by_key("junction")
-  local maxspeed = parse_maxspeed(way:get_value_by_key ( "maxspeed") )
-  local maxspeed_forward = parse_maxspeed(way:get_value_by_key( "maxspeed:forward"))
-  local maxspeed_backward = parse_maxspeed(way:get_value_by_key( "maxspeed:backward"))
-  local barrier = way:get_value_by_key("barrier")
-  local oneway = way:get_value_by_key("oneway")
-  local onewayClass = way:get_value_by_key("oneway:bicycle")
-  local cycleway = way:get_value_by_key("cycleway")
-  local cycleway_left = way:get_value_by_key("cycleway:left")
-  local cycleway_right = way:get_value_by_key("cycleway:right")
-  local duration = way:get_value_by_key("duration")
-  local service = way:get_value_by_key("service")
-  local area = way:get_value_by_key("area")
-  local foot = way:get_value_by_key("foot")
-  local surface = way:get_value_by_key("surface")
-  local bicycle = way:get_value_by_key("bicycle")
+  local name = tags["name"]
+  local ref = tags["ref"]
+  local junction = tags["junction"]
+  local maxspeed = parse_maxspeed(tags["maxspeed"] )
+  local maxspeed_forward = parse_maxspeed(tags["maxspeed:forward"])
+  local maxspeed_backward = parse_maxspeed(tags["maxspeed:backward"])
+  local barrier = tags["barrier"]
+  local oneway = tags["oneway"]
+  local onewayClass = tags["oneway:bicycle"]
+  local cycleway = tags["cycleway"]
+  local cycleway_left = tags["cycleway:left"]
+  local cycleway_right = tags["cycleway:right"]
+  local duration = tags["duration"]
+  local service = tags["service"]
+  local area = tags["area"]
+  local foot = tags["foot"]
+  local surface = tags["surface"]
+  local bicycle = tags["bicycle"]
 
   -- name
   if ref and "" ~= ref and name and "" ~= name then
@@ -9,6 +9,10 @@ access_tag_blacklist = { ["no"] = true, ["private"] = true, ["agricultural"] = t
 access_tag_restricted = { ["destination"] = true, ["delivery"] = true }
 access_tags = { "motorcar", "motor_vehicle", "vehicle" }
 access_tags_hierachy = { "motorcar", "motor_vehicle", "vehicle", "access" }
+-- nodes without any of these keys are not passed to node_function
+node_function_keys = { "barrier", "bollard", "highway", "motorcar", "motor_vehicle", "vehicle", "access" }
+-- way_function reads no other tags, ways that agree on all of them share its result
+way_function_keys = { "highway", "route", "bridge", "area", "oneway", "impassable", "status", "motorcar", "motor_vehicle", "vehicle", "access", "duration", "capacity:car", "maxspeed", "maxspeed:forward", "maxspeed:backward", "surface", "tracktype", "smoothness", "name", "ref", "junction", "service", "width", "lanes" }
 service_tag_restricted = { ["parking_aisle"] = true }
 restriction_exception_tags = { "motorcar", "motor_vehicle", "vehicle" }
 
@@ -161,12 +165,8 @@ local function parse_maxspeed(source)
   if not source then
     return 0
   end
-  local n = tonumber(source:match("%d*"))
-  if n then
-    if string.match(source, "mph") or string.match(source, "mp/h") then
-      n = (n*1609)/1000
-    end
-  else
+  local n = parseMaxspeed(source)
+  if n == 0 then
     -- parse maxspeed like FR:urban
     source = string.lower(source)
     n = maxspeed_table[source]
@@ -190,7 +190,7 @@ end
 --   return penalty
 -- end
 
-function node_function (node, result)
+function node_function (node, result, tags)
   -- parse access and barrier tags
   local access = find_access_tag(node, access_tags_hierachy)
   if access and access ~= "" then
@@ -198,10 +198,10 @@ function node_function (node, result)
       result.barrier = true
     end
   else
-    local barrier = node:get_value_by_key("barrier")
+    local barrier = tags["barrier"]
     if barrier and "" ~= barrier then
       --  make an exception for rising bollard barriers
-      local bollard = node:get_value_by_key("bollard")
+      local bollard = tags["bollard"]
       local rising_bollard = bollard and "rising" == bollard
 
       if not barrier_whitelist[barrier] and not rising_bollard then
@@ -211,39 +211,39 @@ function node_function (node, result)
   end
 
   -- check if node is a traffic light
-  local tag = node:get_value_by_key("highway")
+  local tag = tags["highway"]
   if tag and "traffic_signals" == tag then
     result.traffic_lights = true
   end
 end
 
-function way_function (way, result)
-  local highway = way:get_value_by_key("highway")
-  local route = way:get_value_by_key("route")
-  local bridge = way:get_value_by_key("bridge")
+function way_function (way, result, tags)
+  local highway = tags["highway"]
+  local route = tags["route"]
+  local bridge = tags["bridge"]
 
   if not ((highway and highway ~= "") or (route and route ~= "") or (bridge and bridge ~= "")) then
     return
   end
 
   -- we dont route over areas
-  local area = way:get_value_by_key("area")
+  local area = tags["area"]
   if ignore_areas and area and "yes" == area then
     return
   end
 
   -- check if oneway tag is unsupported
-  local oneway = way:get_value_by_key("oneway")
+  local oneway = tags["oneway"]
   if oneway and "reversible" == oneway then
     return
   end
 
-  local impassable = way:get_value_by_key("impassable")
+  local impassable = tags["impassable"]
   if impassable and "yes" == impassable then
     return
   end
 
-  local status = way:get_value_by_key("status")
+  local status = tags["status"]
   if status and "impassable" == status then
     return
   end
@@ -258,7 +258,7 @@ function way_function (way, result)
   local route_speed = speed_profile[route]
   if (route_speed and route_speed > 0) then
     highway = route
-    local duration  = way:get_value_by_key("duration")
+    local duration  = tags["duration"]
     if duration and durationIsValid(duration) then
       result.duration = max( parseDuration(duration), 1 )
     end
@@ -270,10 +270,10 @@ function way_function (way, result)
 
   -- handling movable bridges
   local bridge_speed = speed_profile[bridge]
-  local capacity_car = way:get_value_by_key("capacity:car")
+  local capacity_car = tags["capacity:car"]
   if (bridge_speed and bridge_speed > 0) and (capacity_car ~= 0) then
     highway = bridge
-    local duration  = way:get_value_by_key("duration")
+    local duration  = tags["duration"]
     if duration and durationIsValid(duration) then
       result.duration = max( parseDuration(duration), 1 )
     end
@@ -290,7 +290,7 @@ function way_function (way, result)
 
   if result.forward_speed == -1 then
     local highway_speed = speed_profile[highway]
-    local max_speed = parse_maxspeed( way:get_value_by_key("maxspeed") )
+    local max_speed = parse_maxspeed( tags["maxspeed"] )
     -- Set the avg speed on the way if it is accessible by road class
     if highway_speed then
       if max_speed and max_speed > highway_speed then
@@ -320,9 +320,9 @@ function way_function (way, result)
   end
 
   -- reduce speed on bad surfaces
-  local surface = way:get_value_by_key("surface")
-  local tracktype = way:get_value_by_key("tracktype")
-  local smoothness = way:get_value_by_key("smoothness")
+  local surface = tags["surface"]
+  local tracktype = tags["tracktype"]
+  local smoothness = tags["smoothness"]
 
   if surface and surface_speeds[surface] then
     result.forward_speed = math.min(surface_speeds[surface], result.forward_speed)
@@ -338,12 +338,12 @@ function way_function (way, result)
   end
 
   -- parse the remaining tags
-  local name = way:get_value_by_key("name")
-  local ref = way:get_value_by_key("ref")
-  local junction = way:get_value_by_key("junction")
+  local name = tags["name"]
+  local ref = tags["ref"]
+  local junction = tags["junction"]
   -- local barrier = way:get_value_by_key("barrier", "")
   -- local cycleway = way:get_value_by_key("cycleway", "")
-  local service = way:get_value_by_key("service")
+  local service = tags["service"]
 
   -- Set the name that will be used for instructions
   local has_ref = ref and "" ~= ref
@@ -388,8 +388,8 @@ function way_function (way, result)
   end
 
   -- Override speed settings if explicit forward/backward maxspeeds are given
-  local maxspeed_forward = parse_maxspeed(way:get_value_by_key( "maxspeed:forward"))
-  local maxspeed_backward = parse_maxspeed(way:get_value_by_key( "maxspeed:backward"))
+  local maxspeed_forward = parse_maxspeed(tags["maxspeed:forward"])
+  local maxspeed_backward = parse_maxspeed(tags["maxspeed:backward"])
   if maxspeed_forward and maxspeed_forward > 0 then
     if 0 ~= result.forward_mode and 0 ~= result.backward_mode then
       result.backward_speed = result.forward_speed
@@ -403,12 +403,12 @@ function way_function (way, result)
   local width = math.huge
   local lanes = math.huge
   if result.forward_speed > 0 or result.backward_speed > 0 then
-    local width_string = way:get_value_by_key("width")
-    if width_string and tonumber(width_string:match("%d*")) then
-      width = tonumber(width_string:match("%d*"))
+    local width_string = tags["width"]
+    if width_string and parseLength(width_string) > 0 then
+      width = parseLength(width_string)
     end
 
-    local lanes_string = way:get_value_by_key("lanes")
+    local lanes_string = tags["lanes"]
     if lanes_string and tonumber(lanes_string:match("%d*")) then
       lanes = tonumber(lanes_string:match("%d*"))
     end
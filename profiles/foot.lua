@@ -8,6 +8,8 @@ access_tag_whitelist = { ["yes"] = true, ["foot"] = true, ["permissive"] = true,
 access_tag_blacklist = { ["no"] = true, ["private"] = true, ["agricultural"] = true, ["forestry"] = true }
 access_tag_restricted = { ["destination"] = true, ["delivery"] = true }
 access_tags_hierachy = { "foot", "access" }
+-- nodes without any of these keys are not passed to node_function
+node_function_keys = { "barrier", "highway", "foot", "access" }
 service_tag_restricted = { ["parking_aisle"] = true }
 ignore_in_grid = { ["ferry"] = true }
 restriction_exception_tags = { "foot" }
@@ -79,10 +81,10 @@ function get_exceptions(vector)
   end
 end
 
-function node_function (node, result)
-  local barrier = node:get_value_by_key("barrier")
+function node_function (node, result, tags)
+  local barrier = tags["barrier"]
   local access = find_access_tag(node, access_tags_hierachy)
-  local traffic_signal = node:get_value_by_key("highway")
+  local traffic_signal = tags["highway"]
 
   -- flag node if it carries a traffic light
   if traffic_signal and traffic_signal == "traffic_signals" then
@@ -107,15 +109,15 @@ function node_function (node, result)
   return 1
 end
 
-function way_function (way, result)
+function way_function (way, result, tags)
   -- initial routability check, filters out buildings, boundaries, etc
-  local highway = way:get_value_by_key("highway")
-  local leisure = way:get_value_by_key("leisure")
-  local route = way:get_value_by_key("route")
-  local man_made = way:get_value_by_key("man_made")
-  local railway = way:get_value_by_key("railway")
-  local amenity = way:get_value_by_key("amenity")
-  local public_transport = way:get_value_by_key("public_transport")
+  local highway = tags["highway"]
+  local leisure = tags["leisure"]
+  local route = tags["route"]
+  local man_made = tags["man_made"]
+  local railway = tags["railway"]
+  local amenity = tags["amenity"]
+  local public_transport = tags["public_transport"]
   if (not highway or highway == '') and
     (not leisure or leisure == '') and
     (not route or route == '') and
@@ -138,15 +140,15 @@ function way_function (way, result)
     return
   end
 
-  local name = way:get_value_by_key("name")
-  local ref = way:get_value_by_key("ref")
-  local junction = way:get_value_by_key("junction")
-  local onewayClass = way:get_value_by_key("oneway:foot")
-  local duration  = way:get_value_by_key("duration")
-  local service  = way:get_value_by_key("service")
-  local area = way:get_value_by_key("area")
-  local foot = way:get_value_by_key("foot")
-  local surface = way:get_value_by_key("surface")
+  local name = tags["name"]
+  local ref = tags["ref"]
+  local junction = tags["junction"]
+  local onewayClass = tags["oneway:foot"]
+  local duration  = tags["duration"]
+  local service  = tags["service"]
+  local area = tags["area"]
+  local foot = tags["foot"]
+  local surface = tags["surface"]
 
    -- name
   if ref and "" ~= ref and name and "" ~= name then
@@ -27,11 +27,11 @@ function source_function ()
     5,    -- nrows
     4     -- ncols
   )
+  -- interpolate the raster at both ends of every segment in batches before segment_function
+  segment_raster_source = raster_source
 end
 
-function segment_function (source, target, distance, weight)
-  local sourceData = sources:interpolate(raster_source, source.lon, source.lat)
-  local targetData = sources:interpolate(raster_source, target.lon, target.lat)
+function segment_function (source, target, distance, weight, sourceData, targetData)
   print ("evaluating segment: " .. sourceData.datum .. " " .. targetData.datum)
   local invalid = sourceData.invalid_data()
 
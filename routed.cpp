@@ -26,6 +26,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "library/osrm.hpp"
+#include "server/access_log.hpp"
+#include "server/http/compression.hpp"
 #include "server/server.hpp"
 #include "util/version.hpp"
 #include "util/routed_options.hpp"
@@ -40,9 +42,43 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <signal.h>
 
 #include <chrono>
+#include <fstream>
 #include <future>
+#include <iterator>
 #include <iostream>
+#include <string>
 #include <thread>
+#include <vector>
+
+// parses <service>=<running>:<queued>
+bool ParseServiceLimit(const std::string &input,
+                       std::string &service,
+                       AdmissionControl::Limits &limits)
+{
+    const auto equal_sign = input.find('=');
+    const auto colon = input.find(':', equal_sign);
+    if (equal_sign == std::string::npos || equal_sign == 0 || colon == std::string::npos)
+    {
+        return false;
+    }
+    service = input.substr(0, equal_sign);
+    try
+    {
+        const int running = std::stoi(input.substr(equal_sign + 1, colon - equal_sign - 1));
+        const int queued = std::stoi(input.substr(colon + 1));
+        if (running < 1 || queued < 0)
+        {
+            return false;
+        }
+        limits.max_running = static_cast<unsigned>(running);
+        limits.max_queued = static_cast<unsigned>(queued);
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+    return true;
+}
 
 #ifdef _WIN32
 boost::function0<void> console_ctrl_function;
@@ -70,17 +106,41 @@ int main(int argc, const char *argv[])
         LogPolicy::GetInstance().Unmute();
 
         bool trial_run = false;
-        std::string ip_address;
-        int ip_port, requested_thread_num;
+        bool io_service_per_thread = false;
+        bool pin_threads = false;
+        std::string ip_address, unix_socket_path;
+        int ip_port, http2_port, requested_thread_num, keepalive_timeout, keepalive_max_requests,
+            request_timeout, access_log_sampling, response_cache_size;
+        std::vector<std::string> service_limits;
+        http::compression_settings compression;
+        std::string compression_dictionary;
 
         libosrm_config lib_config;
         // make the behaviour of routed backward compatible
         lib_config.use_shared_memory = false;
 
         const unsigned init_result = GenerateServerProgramOptions(
-            argc, argv, lib_config.server_paths, ip_address, ip_port, requested_thread_num,
+            argc, argv, lib_config.server_paths, ip_address, ip_port, http2_port,
+            unix_socket_path,
+            requested_thread_num,
             lib_config.use_shared_memory, trial_run, lib_config.max_locations_distance_table,
-            lib_config.max_locations_map_matching);
+            lib_config.max_locations_map_matching, lib_config.max_locations_target_set,
+            lib_config.max_batch_routes, lib_config.max_isochrone_time,
+            lib_config.max_matching_sessions,
+            lib_config.matching_session_ttl, keepalive_timeout, keepalive_max_requests,
+            request_timeout, io_service_per_thread, pin_threads, access_log_sampling,
+            service_limits, response_cache_size, compression.gzip_level,
+            compression.brotli_quality, compression.zstd_level, compression_dictionary,
+            lib_config.phantom_node_cache_size, lib_config.shortcut_cache_size,
+            lib_config.trip_cache_size, lib_config.parallel_snapping_threshold,
+            lib_config.max_request_memory, lib_config.max_total_request_memory,
+            lib_config.dense_query_heaps, lib_config.compact_query_graph,
+            lib_config.split_query_graph,
+            lib_config.parallel_bidirectional_search, lib_config.parallel_leg_search,
+            lib_config.approximate_alternatives, lib_config.prefetch_search_graph,
+            lib_config.verify_image, lib_config.locked_image_blocks,
+            lib_config.warm_up_dataset, lib_config.warm_up_queries,
+            lib_config.datasets);
         if (init_result == INIT_OK_DO_NOT_START_ENGINE)
         {
             return 0;
@@ -91,8 +151,12 @@ int main(int argc, const char *argv[])
         }
 
 #ifdef __linux__
+        // locking would read a mapped image in full before serving the first request
+        const auto image_iterator = lib_config.server_paths.find("image");
+        const bool maps_image =
+            lib_config.server_paths.end() != image_iterator && !image_iterator->second.empty();
         const int lock_flags = MCL_CURRENT | MCL_FUTURE;
-        if (-1 == mlockall(lock_flags))
+        if (!maps_image && -1 == mlockall(lock_flags))
         {
             SimpleLogger().Write(logWARNING) << argv[0] << " could not be locked to RAM";
         }
@@ -107,6 +171,19 @@ int main(int argc, const char *argv[])
         SimpleLogger().Write(logDEBUG) << "Threads:\t" << requested_thread_num;
         SimpleLogger().Write(logDEBUG) << "IP address:\t" << ip_address;
         SimpleLogger().Write(logDEBUG) << "IP port:\t" << ip_port;
+        if (0 < http2_port)
+        {
+            SimpleLogger().Write(logDEBUG) << "HTTP/2 port:\t" << http2_port;
+        }
+        if (!unix_socket_path.empty())
+        {
+            SimpleLogger().Write(logDEBUG) << "Unix socket:\t" << unix_socket_path;
+        }
+        SimpleLogger().Write(logDEBUG) << "Keep-alive:\t" << keepalive_timeout << "s, "
+                                       << keepalive_max_requests << " requests";
+        SimpleLogger().Write(logDEBUG) << "io_service per thread:\t"
+                                       << (io_service_per_thread ? "yes" : "no");
+        SimpleLogger().Write(logDEBUG) << "pinned threads:\t" << (pin_threads ? "yes" : "no");
 #ifndef _WIN32
         int sig = 0;
         sigset_t new_mask;
@@ -115,10 +192,47 @@ int main(int argc, const char *argv[])
         pthread_sigmask(SIG_BLOCK, &new_mask, &old_mask);
 #endif
 
+        AccessLog::GetInstance().SetSampling(static_cast<unsigned>(access_log_sampling));
+
+        if (!compression_dictionary.empty())
+        {
+            std::ifstream dictionary_stream(compression_dictionary, std::ios::binary);
+            if (!dictionary_stream)
+            {
+                throw osrm::exception("could not open " + compression_dictionary);
+            }
+            compression.dictionary.assign(std::istreambuf_iterator<char>(dictionary_stream),
+                                          std::istreambuf_iterator<char>());
+            SimpleLogger().Write() << "compression dictionary of " << compression.dictionary.size()
+                                   << " bytes";
+        }
+        http::configure_compression(std::move(compression));
+
         OSRM osrm_lib(lib_config);
-        auto routing_server = Server::CreateServer(ip_address, ip_port, requested_thread_num);
+        auto routing_server =
+            Server::CreateServer(ip_address, ip_port, unix_socket_path, requested_thread_num,
+                                 keepalive_timeout, keepalive_max_requests,
+                                 io_service_per_thread, response_cache_size);
 
-        routing_server->GetRequestHandlerPtr().RegisterRoutingMachine(&osrm_lib);
+        routing_server->RegisterRoutingMachine(&osrm_lib);
+        routing_server->SetRequestTimeout(static_cast<unsigned>(request_timeout));
+        routing_server->SetThreadAffinity(pin_threads);
+        if (0 < http2_port)
+        {
+            routing_server->ListenHttp2(ip_address, http2_port);
+        }
+        for (const auto &service_limit : service_limits)
+        {
+            std::string service;
+            AdmissionControl::Limits limits;
+            if (!ParseServiceLimit(service_limit, service, limits))
+            {
+                throw osrm::exception("malformed service limit: " + service_limit);
+            }
+            SimpleLogger().Write() << "limiting " << service << " to " << limits.max_running
+                                   << " running and " << limits.max_queued << " queued queries";
+            routing_server->SetServiceLimits(service, limits);
+        }
 
         if (trial_run)
         {
@@ -141,9 +255,15 @@ int main(int argc, const char *argv[])
             sigaddset(&wait_mask, SIGINT);
             sigaddset(&wait_mask, SIGQUIT);
             sigaddset(&wait_mask, SIGTERM);
+            sigaddset(&wait_mask, SIGHUP);
             pthread_sigmask(SIG_BLOCK, &wait_mask, nullptr);
             SimpleLogger().Write() << "running and waiting for requests";
-            sigwait(&wait_mask, &sig);
+            // SIGHUP reloads the dataset files while the server threads keep answering
+            // requests on the previous data
+            while (0 == sigwait(&wait_mask, &sig) && SIGHUP == sig)
+            {
+                osrm_lib.ReloadDataset();
+            }
 #else
             // Set console control handler to allow server to be stopped.
             console_ctrl_function = std::bind(&Server::Stop, routing_server);
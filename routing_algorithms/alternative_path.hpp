@@ -35,6 +35,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/assert.hpp>
 
+#include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -55,20 +56,45 @@ class AlternativeRouting final
 
     struct RankedCandidateNode
     {
-        RankedCandidateNode(const NodeID node, const int length, const int sharing)
-            : node(node), length(length), sharing(sharing)
+        RankedCandidateNode(const NodeID node,
+                            const int length,
+                            const int sharing,
+                            const std::size_t via_path_index = 0)
+            : node(node), length(length), sharing(sharing), via_path_index(via_path_index)
         {
         }
 
         NodeID node;
         int length;
         int sharing;
+        std::size_t via_path_index;
 
         bool operator<(const RankedCandidateNode &other) const
         {
             return (2 * length + sharing) < (2 * other.length + other.sharing);
         }
     };
+
+    // The path <s,..,v,..,t> through a via node as found by the searches from v against the
+    // forward and the reverse search of the shortest path. It is kept from the ranking of the
+    // candidates for the T-Test and the unpacking of the selected one.
+    struct ViaPath
+    {
+        ViaPath()
+            : length(INVALID_EDGE_WEIGHT), s_v_middle(SPECIAL_NODEID), v_t_middle(SPECIAL_NODEID)
+        {
+        }
+
+        int length;
+        NodeID s_v_middle;
+        NodeID v_t_middle;
+        std::vector<NodeID> packed_s_v_path;
+        std::vector<NodeID> packed_v_t_path;
+    };
+
+    // unpacked nodes of the packed edges compared during one query, by source and target
+    using UnpackedEdgeCache = std::unordered_map<std::uint64_t, std::vector<NodeID>>;
+
     DataFacadeT *facade;
     SearchEngineData &engine_working_data;
 
@@ -97,8 +123,6 @@ class AlternativeRouting final
 
         QueryHeap &forward_heap1 = *(engine_working_data.forward_heap_1);
         QueryHeap &reverse_heap1 = *(engine_working_data.reverse_heap_1);
-        QueryHeap &forward_heap2 = *(engine_working_data.forward_heap_2);
-        QueryHeap &reverse_heap2 = *(engine_working_data.reverse_heap_2);
 
         int upper_bound_to_shortest_path_distance = INVALID_EDGE_WEIGHT;
         NodeID middle_node = SPECIAL_NODEID;
@@ -239,6 +263,7 @@ class AlternativeRouting final
         // nodes";
 
         std::vector<NodeID> preselected_node_list;
+        std::vector<RankedCandidateNode> approximated_candidates_list;
         for (const NodeID node : via_node_candidate_list)
         {
             const auto fwd_iterator = approximated_forward_sharing.find(node);
@@ -263,6 +288,8 @@ class AlternativeRouting final
             if (length_passes && sharing_passes && stretch_passes)
             {
                 preselected_node_list.emplace_back(node);
+                approximated_candidates_list.emplace_back(node, approximated_length,
+                                                          approximated_sharing);
             }
         }
 
@@ -271,37 +298,62 @@ class AlternativeRouting final
         packed_shortest_path.emplace_back(middle_node);
         packed_shortest_path.insert(packed_shortest_path.end(), packed_reverse_path.begin(),
                                     packed_reverse_path.end());
-        std::vector<RankedCandidateNode> ranked_candidates_list;
-
-        // prioritizing via nodes for deep inspection
-        for (const NodeID node : preselected_node_list)
-        {
-            int length_of_via_path = 0, sharing_of_via_path = 0;
-            ComputeLengthAndSharingOfViaPath(node, &length_of_via_path, &sharing_of_via_path,
-                                             packed_shortest_path, min_edge_offset);
-            const int maximum_allowed_sharing =
-                static_cast<int>(upper_bound_to_shortest_path_distance * VIAPATH_GAMMA);
-            if (sharing_of_via_path <= maximum_allowed_sharing &&
-                length_of_via_path <= upper_bound_to_shortest_path_distance * (1 + VIAPATH_EPSILON))
+
+        NodeID selected_via_node = SPECIAL_NODEID;
+        ViaPath selected_via_path;
+        if (SearchEngineData::approximate_alternatives)
+        {
+            // no further searches, the approximations of the first search decide
+            std::sort(approximated_candidates_list.begin(), approximated_candidates_list.end());
+            for (const RankedCandidateNode &candidate : approximated_candidates_list)
             {
-                ranked_candidates_list.emplace_back(node, length_of_via_path, sharing_of_via_path);
+                if (RetrieveApproximatedViaPath(forward_heap1, reverse_heap1, nodes_in_path,
+                                                candidate, selected_via_path))
+                {
+                    selected_via_node = candidate.node;
+                    break;
+                }
             }
         }
-        std::sort(ranked_candidates_list.begin(), ranked_candidates_list.end());
+        else
+        {
+            std::vector<RankedCandidateNode> ranked_candidates_list;
+            std::vector<ViaPath> via_paths;
+            UnpackedEdgeCache unpacked_edge_cache;
 
-        NodeID selected_via_node = SPECIAL_NODEID;
-        int length_of_via_path = INVALID_EDGE_WEIGHT;
-        NodeID s_v_middle = SPECIAL_NODEID, v_t_middle = SPECIAL_NODEID;
-        for (const RankedCandidateNode &candidate : ranked_candidates_list)
-        {
-            if (ViaNodeCandidatePassesTTest(
-                    forward_heap1, reverse_heap1, forward_heap2, reverse_heap2, candidate,
-                    upper_bound_to_shortest_path_distance, &length_of_via_path, &s_v_middle,
-                    &v_t_middle, min_edge_offset))
+            // prioritizing via nodes for deep inspection
+            for (const NodeID node : preselected_node_list)
             {
-                // select first admissable
-                selected_via_node = candidate.node;
-                break;
+                ViaPath via_path;
+                int sharing_of_via_path = 0;
+                ComputeLengthAndSharingOfViaPath(node, via_path, &sharing_of_via_path,
+                                                 packed_shortest_path, min_edge_offset,
+                                                 unpacked_edge_cache);
+                const int maximum_allowed_sharing =
+                    static_cast<int>(upper_bound_to_shortest_path_distance * VIAPATH_GAMMA);
+                if (INVALID_EDGE_WEIGHT != via_path.length &&
+                    sharing_of_via_path <= maximum_allowed_sharing &&
+                    via_path.length <=
+                        upper_bound_to_shortest_path_distance * (1 + VIAPATH_EPSILON))
+                {
+                    ranked_candidates_list.emplace_back(node, via_path.length,
+                                                        sharing_of_via_path, via_paths.size());
+                    via_paths.push_back(std::move(via_path));
+                }
+            }
+            std::sort(ranked_candidates_list.begin(), ranked_candidates_list.end());
+
+            for (const RankedCandidateNode &candidate : ranked_candidates_list)
+            {
+                if (ViaNodeCandidatePassesTTest(via_paths[candidate.via_path_index],
+                                                upper_bound_to_shortest_path_distance,
+                                                min_edge_offset))
+                {
+                    // select first admissable
+                    selected_via_node = candidate.node;
+                    selected_via_path = std::move(via_paths[candidate.via_path_index]);
+                    break;
+                }
             }
         }
 
@@ -329,8 +381,7 @@ class AlternativeRouting final
         {
             std::vector<NodeID> packed_alternate_path;
             // retrieve alternate path
-            RetrievePackedAlternatePath(forward_heap1, reverse_heap1, forward_heap2, reverse_heap2,
-                                        s_v_middle, v_t_middle, packed_alternate_path);
+            RetrievePackedAlternatePath(selected_via_path, packed_alternate_path);
 
             raw_route_data.alt_source_traversed_in_reverse.push_back((
                 packed_alternate_path.front() != phantom_node_pair.source_phantom.forward_node_id));
@@ -341,7 +392,7 @@ class AlternativeRouting final
             super::UnpackPath(packed_alternate_path, phantom_node_pair,
                               raw_route_data.unpacked_alternative);
 
-            raw_route_data.alternative_path_length = length_of_via_path;
+            raw_route_data.alternative_path_length = selected_via_path.length;
         }
         else
         {
@@ -350,25 +401,72 @@ class AlternativeRouting final
     }
 
   private:
-    // unpack alternate <s,..,v,..,t> by exploring search spaces from v
-    void RetrievePackedAlternatePath(const QueryHeap &forward_heap1,
-                                     const QueryHeap &reverse_heap1,
-                                     const QueryHeap &forward_heap2,
-                                     const QueryHeap &reverse_heap2,
-                                     const NodeID s_v_middle,
-                                     const NodeID v_t_middle,
+    // packed alternate <s,..,v,..,t> from the two halves of the via path
+    void RetrievePackedAlternatePath(const ViaPath &via_path,
                                      std::vector<NodeID> &packed_path) const
     {
-        // fetch packed path [s,v)
-        std::vector<NodeID> packed_v_t_path;
-        super::RetrievePackedPathFromHeap(forward_heap1, reverse_heap2, s_v_middle, packed_path);
-        packed_path.pop_back(); // remove middle node. It's in both half-paths
+        // packed path [s,v)
+        packed_path = via_path.packed_s_v_path;
+        packed_path.pop_back(); // remove via node. It's in both half-paths
 
-        // fetch patched path [v,t]
-        super::RetrievePackedPathFromHeap(forward_heap2, reverse_heap1, v_t_middle,
-                                          packed_v_t_path);
+        // packed path [v,t]
+        packed_path.insert(packed_path.end(), via_path.packed_v_t_path.begin(),
+                           via_path.packed_v_t_path.end());
+    }
 
-        packed_path.insert(packed_path.end(), packed_v_t_path.begin(), packed_v_t_path.end());
+    // The path through the via node along the trees of the first search, which is as long as the
+    // approximated length of the candidate. It is rejected if both halves meet more than once.
+    bool RetrieveApproximatedViaPath(const QueryHeap &forward_heap1,
+                                     const QueryHeap &reverse_heap1,
+                                     const std::unordered_set<NodeID> &nodes_in_path,
+                                     const RankedCandidateNode &candidate,
+                                     ViaPath &via_path) const
+    {
+        if (candidate.length < 0 || nodes_in_path.count(candidate.node) > 0)
+        {
+            return false;
+        }
+
+        via_path.packed_s_v_path.clear();
+        super::RetrievePackedPathFromSingleHeap(forward_heap1, candidate.node,
+                                                via_path.packed_s_v_path);
+        std::reverse(via_path.packed_s_v_path.begin(), via_path.packed_s_v_path.end());
+        via_path.packed_s_v_path.emplace_back(candidate.node);
+
+        via_path.packed_v_t_path.clear();
+        via_path.packed_v_t_path.emplace_back(candidate.node);
+        super::RetrievePackedPathFromSingleHeap(reverse_heap1, candidate.node,
+                                                via_path.packed_v_t_path);
+
+        std::unordered_set<NodeID> nodes_of_s_v_path(via_path.packed_s_v_path.begin(),
+                                                     via_path.packed_s_v_path.end());
+        for (const auto i : osrm::irange<std::size_t>(1, via_path.packed_v_t_path.size()))
+        {
+            if (nodes_of_s_v_path.count(via_path.packed_v_t_path[i]) > 0)
+            {
+                return false;
+            }
+        }
+        via_path.length = candidate.length;
+        return true;
+    }
+
+    // appends the unpacked path of the packed edge s->t, which is unpacked once per query
+    void UnpackEdgeCached(const NodeID s,
+                          const NodeID t,
+                          UnpackedEdgeCache &unpacked_edge_cache,
+                          std::vector<NodeID> &unpacked_path) const
+    {
+        const std::uint64_t key = (static_cast<std::uint64_t>(s) << 32) | t;
+        auto cached_edge = unpacked_edge_cache.find(key);
+        if (cached_edge == unpacked_edge_cache.end())
+        {
+            std::vector<NodeID> unpacked_edge;
+            super::UnpackEdge(s, t, unpacked_edge);
+            cached_edge = unpacked_edge_cache.emplace(key, std::move(unpacked_edge)).first;
+        }
+        unpacked_path.insert(unpacked_path.end(), cached_edge->second.begin(),
+                             cached_edge->second.end());
     }
 
     // TODO: reorder parameters
@@ -376,10 +474,11 @@ class AlternativeRouting final
     // from v and intersecting against queues. only half-searches have to be
     // done at this stage
     void ComputeLengthAndSharingOfViaPath(const NodeID via_node,
-                                          int *real_length_of_via_path,
+                                          ViaPath &via_path,
                                           int *sharing_of_via_path,
                                           const std::vector<NodeID> &packed_shortest_path,
-                                          const EdgeWeight min_edge_offset)
+                                          const EdgeWeight min_edge_offset,
+                                          UnpackedEdgeCache &unpacked_edge_cache)
     {
         engine_working_data.InitializeOrClearSecondThreadLocalStorage(
             super::facade->GetNumberOfNodes());
@@ -389,36 +488,32 @@ class AlternativeRouting final
         QueryHeap &new_forward_heap = *engine_working_data.forward_heap_2;
         QueryHeap &new_reverse_heap = *engine_working_data.reverse_heap_2;
 
-        std::vector<NodeID> packed_s_v_path;
-        std::vector<NodeID> packed_v_t_path;
+        std::vector<NodeID> &packed_s_v_path = via_path.packed_s_v_path;
+        std::vector<NodeID> &packed_v_t_path = via_path.packed_v_t_path;
 
         std::vector<NodeID> partially_unpacked_shortest_path;
         std::vector<NodeID> partially_unpacked_via_path;
 
-        NodeID s_v_middle = SPECIAL_NODEID;
+        NodeID &s_v_middle = via_path.s_v_middle;
         int upper_bound_s_v_path_length = INVALID_EDGE_WEIGHT;
         new_reverse_heap.Insert(via_node, 0, via_node);
         // compute path <s,..,v> by reusing forward search from s
-        while (!new_reverse_heap.Empty())
-        {
-            super::RoutingStep(new_reverse_heap, existing_forward_heap, &s_v_middle,
-                               &upper_bound_s_v_path_length, min_edge_offset, false);
-        }
+        super::template UnidirectionalSearch<false>(new_reverse_heap, existing_forward_heap,
+                                                    &s_v_middle, &upper_bound_s_v_path_length,
+                                                    min_edge_offset);
         // compute path <v,..,t> by reusing backward search from node t
-        NodeID v_t_middle = SPECIAL_NODEID;
+        NodeID &v_t_middle = via_path.v_t_middle;
         int upper_bound_of_v_t_path_length = INVALID_EDGE_WEIGHT;
         new_forward_heap.Insert(via_node, 0, via_node);
-        while (!new_forward_heap.Empty())
-        {
-            super::RoutingStep(new_forward_heap, existing_reverse_heap, &v_t_middle,
-                               &upper_bound_of_v_t_path_length, min_edge_offset, true);
-        }
-        *real_length_of_via_path = upper_bound_s_v_path_length + upper_bound_of_v_t_path_length;
+        super::template UnidirectionalSearch<true>(new_forward_heap, existing_reverse_heap,
+                                                   &v_t_middle, &upper_bound_of_v_t_path_length,
+                                                   min_edge_offset);
 
         if (SPECIAL_NODEID == s_v_middle || SPECIAL_NODEID == v_t_middle)
         {
             return;
         }
+        via_path.length = upper_bound_s_v_path_length + upper_bound_of_v_t_path_length;
 
         // retrieve packed paths
         super::RetrievePackedPathFromHeap(existing_forward_heap, new_reverse_heap, s_v_middle,
@@ -443,12 +538,12 @@ class AlternativeRouting final
             {
                 if (packed_s_v_path[current_node] == packed_shortest_path[current_node])
                 {
-                    super::UnpackEdge(packed_s_v_path[current_node],
-                                      packed_s_v_path[current_node + 1],
-                                      partially_unpacked_via_path);
-                    super::UnpackEdge(packed_shortest_path[current_node],
-                                      packed_shortest_path[current_node + 1],
-                                      partially_unpacked_shortest_path);
+                    UnpackEdgeCached(packed_s_v_path[current_node],
+                                     packed_s_v_path[current_node + 1], unpacked_edge_cache,
+                                     partially_unpacked_via_path);
+                    UnpackEdgeCached(packed_shortest_path[current_node],
+                                     packed_shortest_path[current_node + 1], unpacked_edge_cache,
+                                     partially_unpacked_shortest_path);
                     break;
                 }
             }
@@ -488,11 +583,12 @@ class AlternativeRouting final
             {
                 if (packed_v_t_path[via_path_index] == packed_shortest_path[shortest_path_index])
                 {
-                    super::UnpackEdge(packed_v_t_path[via_path_index - 1],
-                                      packed_v_t_path[via_path_index], partially_unpacked_via_path);
-                    super::UnpackEdge(packed_shortest_path[shortest_path_index - 1],
-                                      packed_shortest_path[shortest_path_index],
-                                      partially_unpacked_shortest_path);
+                    UnpackEdgeCached(packed_v_t_path[via_path_index - 1],
+                                     packed_v_t_path[via_path_index], unpacked_edge_cache,
+                                     partially_unpacked_via_path);
+                    UnpackEdgeCached(packed_shortest_path[shortest_path_index - 1],
+                                     packed_shortest_path[shortest_path_index],
+                                     unpacked_edge_cache, partially_unpacked_shortest_path);
                     break;
                 }
             }
@@ -580,8 +676,10 @@ class AlternativeRouting final
         QueryHeap &forward_heap = (is_forward_directed ? heap1 : heap2);
         QueryHeap &reverse_heap = (is_forward_directed ? heap2 : heap1);
 
+        osrm::cancellation::Poll();
         const NodeID node = forward_heap.DeleteMin();
         const int distance = forward_heap.GetKey(node);
+        super::SearchStatistics::Settle();
         // const NodeID parentnode = forward_heap.GetData(node).parent;
         // SimpleLogger().Write() << (is_forward_directed ? "[fwd] " : "[rev] ") << "settled edge ("
         // << parentnode << "," << node << "), dist: " << distance;
@@ -623,7 +721,7 @@ class AlternativeRouting final
                 (is_forward_directed ? data.forward : data.backward);
             if (edge_is_forward_directed)
             {
-
+                super::SearchStatistics::Relax();
                 const NodeID to = facade->GetTarget(edge);
                 const int edge_weight = data.distance;
 
@@ -634,6 +732,7 @@ class AlternativeRouting final
                 if (!forward_heap.WasInserted(to))
                 {
                     forward_heap.Insert(to, to_distance, node);
+                    super::SearchStatistics::Push();
                 }
                 // Found a shorter Path -> Update distance
                 else if (to_distance < forward_heap.GetKey(to))
@@ -647,63 +746,15 @@ class AlternativeRouting final
         }
     }
 
-    // conduct T-Test
-    bool ViaNodeCandidatePassesTTest(QueryHeap &existing_forward_heap,
-                                     QueryHeap &existing_reverse_heap,
-                                     QueryHeap &new_forward_heap,
-                                     QueryHeap &new_reverse_heap,
-                                     const RankedCandidateNode &candidate,
+    // conduct T-Test on the via path found while ranking the candidate
+    bool ViaNodeCandidatePassesTTest(const ViaPath &via_path,
                                      const int length_of_shortest_path,
-                                     int *length_of_via_path,
-                                     NodeID *s_v_middle,
-                                     NodeID *v_t_middle,
                                      const EdgeWeight min_edge_offset) const
     {
-        new_forward_heap.Clear();
-        new_reverse_heap.Clear();
-        std::vector<NodeID> packed_s_v_path;
-        std::vector<NodeID> packed_v_t_path;
+        const std::vector<NodeID> &packed_s_v_path = via_path.packed_s_v_path;
+        const std::vector<NodeID> &packed_v_t_path = via_path.packed_v_t_path;
 
-        *s_v_middle = SPECIAL_NODEID;
-        int upper_bound_s_v_path_length = INVALID_EDGE_WEIGHT;
-        // compute path <s,..,v> by reusing forward search from s
-        new_reverse_heap.Insert(candidate.node, 0, candidate.node);
-        while (new_reverse_heap.Size() > 0)
-        {
-            super::RoutingStep(new_reverse_heap, existing_forward_heap, s_v_middle,
-                               &upper_bound_s_v_path_length, min_edge_offset, false);
-        }
-
-        if (INVALID_EDGE_WEIGHT == upper_bound_s_v_path_length)
-        {
-            return false;
-        }
-
-        // compute path <v,..,t> by reusing backward search from t
-        *v_t_middle = SPECIAL_NODEID;
-        int upper_bound_of_v_t_path_length = INVALID_EDGE_WEIGHT;
-        new_forward_heap.Insert(candidate.node, 0, candidate.node);
-        while (new_forward_heap.Size() > 0)
-        {
-            super::RoutingStep(new_forward_heap, existing_reverse_heap, v_t_middle,
-                               &upper_bound_of_v_t_path_length, min_edge_offset, true);
-        }
-
-        if (INVALID_EDGE_WEIGHT == upper_bound_of_v_t_path_length)
-        {
-            return false;
-        }
-
-        *length_of_via_path = upper_bound_s_v_path_length + upper_bound_of_v_t_path_length;
-
-        // retrieve packed paths
-        super::RetrievePackedPathFromHeap(existing_forward_heap, new_reverse_heap, *s_v_middle,
-                                          packed_s_v_path);
-
-        super::RetrievePackedPathFromHeap(new_forward_heap, existing_reverse_heap, *v_t_middle,
-                                          packed_v_t_path);
-
-        NodeID s_P = *s_v_middle, t_P = *v_t_middle;
+        NodeID s_P = via_path.s_v_middle, t_P = via_path.v_t_middle;
         if (SPECIAL_NODEID == s_P)
         {
             return false;
@@ -849,19 +900,8 @@ class AlternativeRouting final
         forward_heap3.Insert(s_P, 0, s_P);
         reverse_heap3.Insert(t_P, 0, t_P);
         // exploration from s and t until deletemin/(1+epsilon) > _lengt_oO_sShortest_path
-        while ((forward_heap3.Size() + reverse_heap3.Size()) > 0)
-        {
-            if (!forward_heap3.Empty())
-            {
-                super::RoutingStep(forward_heap3, reverse_heap3, &middle, &upper_bound,
-                                   min_edge_offset, true);
-            }
-            if (!reverse_heap3.Empty())
-            {
-                super::RoutingStep(reverse_heap3, forward_heap3, &middle, &upper_bound,
-                                   min_edge_offset, false);
-            }
-        }
+        super::BidirectionalSearch(forward_heap3, reverse_heap3, &middle, &upper_bound,
+                                   min_edge_offset);
         return (upper_bound <= t_test_path_length);
     }
 };
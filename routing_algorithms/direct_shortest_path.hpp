@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/assert.hpp>
 
 #include "routing_base.hpp"
+#include "../data_structures/landmark_table.hpp"
 #include "../data_structures/search_engine_data.hpp"
 #include "../util/integer_range.hpp"
 #include "../util/timing_util.hpp"
@@ -48,6 +49,7 @@ class DirectShortestPathRouting final
 {
     using super = BasicRoutingInterface<DataFacadeT, DirectShortestPathRouting<DataFacadeT>>;
     using QueryHeap = SearchEngineData::QueryHeap;
+    using EdgeData = typename DataFacadeT::EdgeData;
     SearchEngineData &engine_working_data;
 
   public:
@@ -125,36 +127,15 @@ class DirectShortestPathRouting final
         std::vector<std::pair<NodeID, EdgeWeight>> reverse_entry_points;
 
         // run two-Target Dijkstra routing step.
-        while (0 < (forward_heap.Size() + reverse_heap.Size()) )
+        if (super::facade->HasCore())
         {
-            if (!forward_heap.Empty())
-            {
-                if (super::facade->IsCoreNode(forward_heap.Min()))
-                {
-                    const NodeID node = forward_heap.DeleteMin();
-                    const int key = forward_heap.GetKey(node);
-                    forward_entry_points.emplace_back(node, key);
-                }
-                else
-                {
-                    super::RoutingStep(forward_heap, reverse_heap, &middle, &distance,
-                                       min_edge_offset, true);
-                }
-            }
-            if (!reverse_heap.Empty())
-            {
-                if (super::facade->IsCoreNode(reverse_heap.Min()))
-                {
-                    const NodeID node = reverse_heap.DeleteMin();
-                    const int key = reverse_heap.GetKey(node);
-                    reverse_entry_points.emplace_back(node, key);
-                }
-                else
-                {
-                    super::RoutingStep(reverse_heap, forward_heap, &middle, &distance,
-                                       min_edge_offset, false);
-                }
-            }
+            SearchToCore<true>(forward_heap, reverse_heap, &middle, &distance, min_edge_offset,
+                               forward_entry_points, reverse_entry_points);
+        }
+        else
+        {
+            SearchToCore<false>(forward_heap, reverse_heap, &middle, &distance, min_edge_offset,
+                                forward_entry_points, reverse_entry_points);
         }
 
         // TODO check if unordered_set might be faster
@@ -166,40 +147,40 @@ class DirectShortestPathRouting final
         std::sort(forward_entry_points.begin(), forward_entry_points.end(), entry_point_comparator);
         std::sort(reverse_entry_points.begin(), reverse_entry_points.end(), entry_point_comparator);
 
-        NodeID last_id = SPECIAL_NODEID;
-        for (const auto p : forward_entry_points)
+        if (!CoreSearchWithLandmarks(forward_entry_points, reverse_entry_points, forward_core_heap,
+                                     reverse_core_heap, &middle, &distance, min_edge_offset))
         {
-            if (p.first == last_id)
+            NodeID last_id = SPECIAL_NODEID;
+            for (const auto p : forward_entry_points)
             {
-                continue;
+                if (p.first == last_id)
+                {
+                    continue;
+                }
+                forward_core_heap.Insert(p.first, p.second, p.first);
+                last_id = p.first;
             }
-            forward_core_heap.Insert(p.first, p.second, p.first);
-            last_id = p.first;
-        }
-        last_id = SPECIAL_NODEID;
-        for (const auto p : reverse_entry_points)
-        {
-            if (p.first == last_id)
+            last_id = SPECIAL_NODEID;
+            for (const auto p : reverse_entry_points)
             {
-                continue;
+                if (p.first == last_id)
+                {
+                    continue;
+                }
+                reverse_core_heap.Insert(p.first, p.second, p.first);
+                last_id = p.first;
             }
-            reverse_core_heap.Insert(p.first, p.second, p.first);
-            last_id = p.first;
-        }
 
-        // run two-target Dijkstra routing step on core with termination criterion
-        while (0 < (forward_core_heap.Size() + reverse_core_heap.Size()) &&
-               distance > (forward_core_heap.MinKey() + reverse_core_heap.MinKey()))
-        {
-            if (!forward_core_heap.Empty())
+            // run two-target Dijkstra routing step on core with termination criterion
+            if (SearchEngineData::prefetch_search_graph)
             {
-                super::RoutingStep(forward_core_heap, reverse_core_heap, &middle, &distance,
-                                   min_edge_offset, true);
+                CoreSearch<true>(forward_core_heap, reverse_core_heap, &middle, &distance,
+                                 min_edge_offset);
             }
-            if (!reverse_core_heap.Empty())
+            else
             {
-                super::RoutingStep(reverse_core_heap, forward_core_heap, &middle, &distance,
-                                   min_edge_offset, false);
+                CoreSearch<false>(forward_core_heap, reverse_core_heap, &middle, &distance,
+                                  min_edge_offset);
             }
         }
 
@@ -215,11 +196,15 @@ class DirectShortestPathRouting final
         BOOST_ASSERT_MSG((SPECIAL_NODEID == middle || INVALID_EDGE_WEIGHT != distance),
                          "no path found");
 
-        std::vector<NodeID> packed_leg;
+        SearchEngineData::UnpackingData &unpacking_data =
+            SearchEngineData::GetUnpackingThreadLocalStorage();
+        std::vector<NodeID> &packed_leg = unpacking_data.packed_leg1;
+        packed_leg.clear();
         // we need to unpack sub path from core heaps
         if(super::facade->IsCoreNode(middle))
         {
-            std::vector<NodeID> packed_core_leg;
+            std::vector<NodeID> &packed_core_leg = unpacking_data.packed_leg2;
+            packed_core_leg.clear();
             super::RetrievePackedPathFromHeap(forward_core_heap, reverse_core_heap, middle, packed_core_leg);
             BOOST_ASSERT(packed_core_leg.size() > 0);
             super::RetrievePackedPathFromSingleHeap(forward_heap, packed_core_leg.front(), packed_leg);
@@ -241,10 +226,277 @@ class DirectShortestPathRouting final
         raw_route_data.target_traversed_in_reverse.push_back(
             (packed_leg.back() != phantom_node_pair.target_phantom.forward_node_id));
 
-        super::UnpackPath(packed_leg, phantom_node_pair, raw_route_data.unpacked_path_segments.front());
+        if (raw_route_data.summary_only)
+        {
+            raw_route_data.leg_lengths.push_back(
+                super::ComputePackedPathLength(packed_leg, phantom_node_pair));
+        }
+        else
+        {
+            super::UnpackPath(packed_leg, phantom_node_pair,
+                              raw_route_data.unpacked_path_segments.front());
+        }
 
         raw_route_data.shortest_path_length = distance;
     }
+
+  private:
+    // Searches the contracted part of the graph, the nodes of the core are collected as entry
+    // points instead of being settled. Without a core the test for core nodes is compiled out.
+    template <bool has_core>
+    void SearchToCore(QueryHeap &forward_heap,
+                      QueryHeap &reverse_heap,
+                      NodeID *middle,
+                      int *distance,
+                      const EdgeWeight min_edge_offset,
+                      std::vector<std::pair<NodeID, EdgeWeight>> &forward_entry_points,
+                      std::vector<std::pair<NodeID, EdgeWeight>> &reverse_entry_points) const
+    {
+        if (SearchEngineData::prefetch_search_graph)
+        {
+            SearchToCore<has_core, true>(forward_heap, reverse_heap, middle, distance,
+                                         min_edge_offset, forward_entry_points,
+                                         reverse_entry_points);
+        }
+        else
+        {
+            SearchToCore<has_core, false>(forward_heap, reverse_heap, middle, distance,
+                                          min_edge_offset, forward_entry_points,
+                                          reverse_entry_points);
+        }
+    }
+
+    template <bool has_core, bool prefetch>
+    void SearchToCore(QueryHeap &forward_heap,
+                      QueryHeap &reverse_heap,
+                      NodeID *middle,
+                      int *distance,
+                      const EdgeWeight min_edge_offset,
+                      std::vector<std::pair<NodeID, EdgeWeight>> &forward_entry_points,
+                      std::vector<std::pair<NodeID, EdgeWeight>> &reverse_entry_points) const
+    {
+        while (0 < (forward_heap.Size() + reverse_heap.Size()))
+        {
+            if (!forward_heap.Empty())
+            {
+                if (has_core && super::facade->IsCoreNode(forward_heap.Min()))
+                {
+                    const NodeID node = forward_heap.DeleteMin();
+                    const int key = forward_heap.GetKey(node);
+                    forward_entry_points.emplace_back(node, key);
+                    super::SearchStatistics::EnterCore();
+                }
+                else
+                {
+                    super::template RoutingStep<true, prefetch>(forward_heap, reverse_heap, middle,
+                                                                distance, min_edge_offset);
+                }
+            }
+            if (!reverse_heap.Empty())
+            {
+                if (has_core && super::facade->IsCoreNode(reverse_heap.Min()))
+                {
+                    const NodeID node = reverse_heap.DeleteMin();
+                    const int key = reverse_heap.GetKey(node);
+                    reverse_entry_points.emplace_back(node, key);
+                    super::SearchStatistics::EnterCore();
+                }
+                else
+                {
+                    super::template RoutingStep<false, prefetch>(reverse_heap, forward_heap,
+                                                                 middle, distance,
+                                                                 min_edge_offset);
+                }
+            }
+        }
+    }
+
+    template <bool prefetch>
+    void CoreSearch(QueryHeap &forward_core_heap,
+                    QueryHeap &reverse_core_heap,
+                    NodeID *middle,
+                    int *distance,
+                    const EdgeWeight min_edge_offset) const
+    {
+        while (0 < (forward_core_heap.Size() + reverse_core_heap.Size()) &&
+               *distance > (forward_core_heap.MinKey() + reverse_core_heap.MinKey()))
+        {
+            if (!forward_core_heap.Empty())
+            {
+                super::template RoutingStep<true, prefetch>(forward_core_heap, reverse_core_heap,
+                                                            middle, distance, min_edge_offset);
+            }
+            if (!reverse_core_heap.Empty())
+            {
+                super::template RoutingStep<false, prefetch>(reverse_core_heap, forward_core_heap,
+                                                             middle, distance, min_edge_offset);
+            }
+        }
+    }
+
+    // Bidirectional A* search on the core, guided by the potentials of the core landmarks. The
+    // keys of both heaps are distances plus the potential of their direction. As the potentials
+    // of both directions add up to zero, the keys of a node still add up to the length of the
+    // path through it and the termination criterion of the plain search applies unchanged.
+    // Returns false without touching the heaps if no landmarks are loaded.
+    bool CoreSearchWithLandmarks(
+        const std::vector<std::pair<NodeID, EdgeWeight>> &forward_entry_points,
+        const std::vector<std::pair<NodeID, EdgeWeight>> &reverse_entry_points,
+        QueryHeap &forward_core_heap,
+        QueryHeap &reverse_core_heap,
+        NodeID *middle,
+        int *distance,
+        const EdgeWeight min_edge_offset) const
+    {
+        const unsigned number_of_landmarks = super::facade->GetNumberOfLandmarks();
+        if (0 == number_of_landmarks)
+        {
+            return false;
+        }
+
+        // the entry points are sorted by id and key, only the first one of every node counts
+        const auto collect_entry_points =
+            [this](const std::vector<std::pair<NodeID, EdgeWeight>> &entry_points,
+                   std::vector<std::pair<NodeID, EdgeWeight>> &unique_entry_points,
+                   std::vector<LandmarkPotential::EntryPoint> &potential_entry_points)
+        {
+            for (const auto &entry_point : entry_points)
+            {
+                if (!unique_entry_points.empty() &&
+                    unique_entry_points.back().first == entry_point.first)
+                {
+                    continue;
+                }
+                const EdgeWeight *landmark_distances =
+                    super::facade->GetLandmarkDistances(entry_point.first);
+                if (nullptr == landmark_distances)
+                {
+                    return false;
+                }
+                unique_entry_points.push_back(entry_point);
+                potential_entry_points.emplace_back(landmark_distances, entry_point.second);
+            }
+            return true;
+        };
+        std::vector<std::pair<NodeID, EdgeWeight>> sources, targets;
+        std::vector<LandmarkPotential::EntryPoint> potential_sources, potential_targets;
+        // landmarks of a different core, fall back to the plain search
+        if (!collect_entry_points(forward_entry_points, sources, potential_sources) ||
+            !collect_entry_points(reverse_entry_points, targets, potential_targets))
+        {
+            return false;
+        }
+        // no path leads through the core
+        if (sources.empty() || targets.empty())
+        {
+            return true;
+        }
+
+        const LandmarkPotential potential(number_of_landmarks, potential_sources,
+                                          potential_targets);
+        for (const auto &source : sources)
+        {
+            forward_core_heap.Insert(source.first,
+                                     source.second + GetPotential(potential, source.first, true),
+                                     source.first);
+        }
+        for (const auto &target : targets)
+        {
+            reverse_core_heap.Insert(target.first,
+                                     target.second + GetPotential(potential, target.first, false),
+                                     target.first);
+        }
+
+        while (0 < (forward_core_heap.Size() + reverse_core_heap.Size()))
+        {
+            if (!forward_core_heap.Empty() && !reverse_core_heap.Empty() &&
+                *distance <= forward_core_heap.MinKey() + reverse_core_heap.MinKey())
+            {
+                break;
+            }
+            if (!forward_core_heap.Empty())
+            {
+                CoreRoutingStep<true>(forward_core_heap, reverse_core_heap, potential, middle,
+                                      distance, min_edge_offset);
+            }
+            if (!reverse_core_heap.Empty())
+            {
+                CoreRoutingStep<false>(reverse_core_heap, forward_core_heap, potential, middle,
+                                       distance, min_edge_offset);
+            }
+        }
+        return true;
+    }
+
+    int GetPotential(const LandmarkPotential &potential,
+                     const NodeID node,
+                     const bool forward_direction) const
+    {
+        const EdgeWeight *landmark_distances = super::facade->GetLandmarkDistances(node);
+        BOOST_ASSERT_MSG(nullptr != landmark_distances, "core node without landmark distances");
+        const int forward_potential = potential.GetForwardPotential(landmark_distances);
+        return forward_direction ? forward_potential : -forward_potential;
+    }
+
+    // Like RoutingStep, but on keys that include the potential of the node. The core is not
+    // contracted, so there is nothing to stall.
+    template <bool forward_direction>
+    void CoreRoutingStep(QueryHeap &forward_heap,
+                         QueryHeap &reverse_heap,
+                         const LandmarkPotential &potential,
+                         NodeID *middle_node_id,
+                         int *upper_bound,
+                         const int min_edge_offset) const
+    {
+        osrm::cancellation::Poll();
+        const NodeID node = forward_heap.DeleteMin();
+        const int key = forward_heap.GetKey(node);
+        super::SearchStatistics::Settle();
+
+        if (reverse_heap.WasInserted(node))
+        {
+            // the potentials of both directions cancel out
+            const int new_distance = reverse_heap.GetKey(node) + key;
+            if (new_distance < *upper_bound && new_distance >= 0)
+            {
+                *middle_node_id = node;
+                *upper_bound = new_distance;
+            }
+        }
+
+        const int distance = key - GetPotential(potential, node, forward_direction);
+        // keys are not ordered by distance, so only this node can be pruned
+        if (distance + min_edge_offset > *upper_bound)
+        {
+            return;
+        }
+
+        for (const auto edge : super::facade->GetAdjacentEdgeRange(node))
+        {
+            const EdgeData &data = super::facade->GetEdgeData(edge);
+            if (forward_direction ? data.forward : data.backward)
+            {
+                super::SearchStatistics::Relax();
+                const NodeID to = super::facade->GetTarget(edge);
+                const int edge_weight = data.distance;
+
+                BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
+                const int to_key =
+                    distance + edge_weight + GetPotential(potential, to, forward_direction);
+
+                if (!forward_heap.WasInserted(to))
+                {
+                    forward_heap.Insert(to, to_key, node);
+                    super::SearchStatistics::Push();
+                }
+                else if (to_key < forward_heap.GetKey(to))
+                {
+                    forward_heap.GetData(to).parent = node;
+                    forward_heap.DecreaseKey(to, to_key);
+                }
+            }
+        }
+    }
 };
 
 #endif /* DIRECT_SHORTEST_PATH_HPP */
@@ -0,0 +1,276 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ISOCHRONE_HPP
+#define ISOCHRONE_HPP
+
+#include "routing_base.hpp"
+#include "../data_structures/search_engine_data.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// All nodes of the search graph in sweep order, each node after all nodes that have a downward
+// edge into it, see RPHASTTargetSet. A one-to-all search is an upward search followed by a
+// linear sweep over this order.
+struct IsochroneSweepOrder
+{
+    std::vector<NodeID> nodes;
+    // position of every node in nodes
+    std::vector<unsigned> node_indices;
+    // the coordinate where the segment of a node starts, SPECIAL_NODEID if no original edge
+    // leads into the node
+    std::vector<unsigned> start_coordinates;
+    // the graph the order was built for
+    unsigned check_sum;
+};
+
+// PHAST: the distances of a source to every node of the graph within a bound. The upward search
+// stops at the bound, the downward edges are pulled in the sweep order.
+template <class DataFacadeT>
+class IsochroneRouting final
+    : public BasicRoutingInterface<DataFacadeT, IsochroneRouting<DataFacadeT>>
+{
+    using super = BasicRoutingInterface<DataFacadeT, IsochroneRouting<DataFacadeT>>;
+    using QueryHeap = SearchEngineData::QueryHeap;
+    SearchEngineData &engine_working_data;
+
+  public:
+    IsochroneRouting(DataFacadeT *facade, SearchEngineData &engine_working_data)
+        : super(facade), engine_working_data(engine_working_data)
+    {
+    }
+
+    ~IsochroneRouting() {}
+
+    // Returns nullptr if the hierarchy has an uncontracted core, it has no order for the sweep
+    std::shared_ptr<const IsochroneSweepOrder> BuildSweepOrder() const
+    {
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        auto sweep_order = std::make_shared<IsochroneSweepOrder>();
+        sweep_order->check_sum = super::facade->GetCheckSum();
+        sweep_order->nodes.reserve(number_of_nodes);
+
+        // iterative depth first search along the backward edges, the post order puts every node
+        // after the higher nodes it reaches
+        const unsigned UNVISITED = std::numeric_limits<unsigned>::max();
+        const unsigned VISITING = UNVISITED - 1;
+        sweep_order->node_indices.resize(number_of_nodes, UNVISITED);
+        std::vector<std::pair<NodeID, EdgeID>> dfs_stack;
+        for (NodeID root = 0; root < number_of_nodes; ++root)
+        {
+            if (super::facade->IsCoreNode(root))
+            {
+                return nullptr;
+            }
+            if (UNVISITED != sweep_order->node_indices[root])
+            {
+                continue;
+            }
+            sweep_order->node_indices[root] = VISITING;
+            dfs_stack.emplace_back(root, super::facade->BeginEdges(root));
+            while (!dfs_stack.empty())
+            {
+                const NodeID node = dfs_stack.back().first;
+                EdgeID &edge = dfs_stack.back().second;
+                if (edge == super::facade->EndEdges(node))
+                {
+                    sweep_order->node_indices[node] =
+                        static_cast<unsigned>(sweep_order->nodes.size());
+                    sweep_order->nodes.push_back(node);
+                    dfs_stack.pop_back();
+                    continue;
+                }
+                const EdgeID current_edge = edge++;
+                if (super::facade->GetEdgeData(current_edge).backward)
+                {
+                    const NodeID to = super::facade->GetTarget(current_edge);
+                    if (UNVISITED == sweep_order->node_indices[to])
+                    {
+                        sweep_order->node_indices[to] = VISITING;
+                        dfs_stack.emplace_back(to, super::facade->BeginEdges(to));
+                    }
+                }
+            }
+        }
+
+        // An original edge u->v starts the segment of v where the segment of u ends. Edges of
+        // both directions carry the id of one of them, they only fill in nodes without another.
+        sweep_order->start_coordinates.resize(number_of_nodes, SPECIAL_NODEID);
+        for (const bool use_bidirectional_edges : {false, true})
+        {
+            for (NodeID node = 0; node < number_of_nodes; ++node)
+            {
+                for (const auto edge : super::facade->GetAdjacentEdgeRange(node))
+                {
+                    const auto &data = super::facade->GetEdgeData(edge);
+                    if (data.shortcut || use_bidirectional_edges != (data.forward && data.backward))
+                    {
+                        continue;
+                    }
+                    const auto enter = [&](const NodeID entered_node)
+                    {
+                        unsigned &start_coordinate = sweep_order->start_coordinates[entered_node];
+                        if (SPECIAL_NODEID == start_coordinate)
+                        {
+                            start_coordinate = GetEndCoordinate(data.id);
+                        }
+                    };
+                    if (data.forward)
+                    {
+                        enter(super::facade->GetTarget(edge));
+                    }
+                    if (data.backward)
+                    {
+                        enter(node);
+                    }
+                }
+            }
+        }
+        return sweep_order;
+    }
+
+    // Appends every node that is reached within max_distance with its distance, in sweep order.
+    // The distance of a node is the one to the start of its segment.
+    void operator()(const std::vector<PhantomNode> &source_phantom_nodes,
+                    const IsochroneSweepOrder &sweep_order,
+                    const EdgeWeight max_distance,
+                    std::vector<std::pair<NodeID, EdgeWeight>> &reached_nodes) const
+    {
+        BOOST_ASSERT(sweep_order.check_sum == super::facade->GetCheckSum());
+        engine_working_data.InitializeOrClearFirstThreadLocalStorage(
+            super::facade->GetNumberOfNodes());
+        QueryHeap &query_heap = *(engine_working_data.forward_heap_1);
+        query_heap.Clear();
+        for (const PhantomNode &phantom_node : source_phantom_nodes)
+        {
+            if (SPECIAL_NODEID != phantom_node.forward_node_id)
+            {
+                query_heap.Insert(phantom_node.forward_node_id,
+                                  -phantom_node.GetForwardWeightPlusOffset(),
+                                  phantom_node.forward_node_id);
+            }
+            if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+            {
+                query_heap.Insert(phantom_node.reverse_node_id,
+                                  -phantom_node.GetReverseWeightPlusOffset(),
+                                  phantom_node.reverse_node_id);
+            }
+        }
+        while (!query_heap.Empty())
+        {
+            UpwardRoutingStep(query_heap, max_distance);
+        }
+
+        // higher nodes come first, the distance of every source of a downward edge is final
+        std::vector<EdgeWeight> distances(sweep_order.nodes.size(), INVALID_EDGE_WEIGHT);
+        for (unsigned i = 0; i < sweep_order.nodes.size(); ++i)
+        {
+            const NodeID node = sweep_order.nodes[i];
+            EdgeWeight distance =
+                query_heap.WasInserted(node) ? query_heap.GetKey(node) : INVALID_EDGE_WEIGHT;
+            for (const auto edge : super::facade->GetAdjacentEdgeRange(node))
+            {
+                const auto &data = super::facade->GetEdgeData(edge);
+                if (!data.backward)
+                {
+                    continue;
+                }
+                const unsigned source_index =
+                    sweep_order.node_indices[super::facade->GetTarget(edge)];
+                BOOST_ASSERT(source_index < i);
+                if (INVALID_EDGE_WEIGHT != distances[source_index])
+                {
+                    distance = std::min(distance, distances[source_index] + data.distance);
+                }
+            }
+            distances[i] = distance;
+            if (0 <= distance && distance <= max_distance)
+            {
+                reached_nodes.emplace_back(node, distance);
+            }
+        }
+    }
+
+  private:
+    // the coordinate at which the segment that an edge-based edge leaves ends
+    unsigned GetEndCoordinate(const unsigned edge_id) const
+    {
+        const unsigned geometry_index = super::facade->GetGeometryIndexForEdgeID(edge_id);
+        if (!super::facade->EdgeIsCompressed(edge_id))
+        {
+            return geometry_index;
+        }
+        const auto geometry = super::facade->GetUncompressedGeometryRange(geometry_index);
+        return geometry.empty() ? SPECIAL_NODEID : geometry.back();
+    }
+
+    // nodes beyond max_distance are not expanded, every path down from them is even longer
+    void UpwardRoutingStep(QueryHeap &query_heap, const EdgeWeight max_distance) const
+    {
+        osrm::cancellation::Poll();
+        const NodeID node = query_heap.DeleteMin();
+        const int distance = query_heap.GetKey(node);
+        if (distance > max_distance)
+        {
+            return;
+        }
+        // stalled nodes keep their key, the sweep replaces it by the shorter distance
+        if (CHStallingPolicy::Stall<true>(*super::facade, query_heap, node, distance))
+        {
+            return;
+        }
+        for (const auto edge : super::facade->GetAdjacentEdgeRange(node))
+        {
+            const auto &data = super::facade->GetEdgeData(edge);
+            if (data.forward)
+            {
+                const NodeID to = super::facade->GetTarget(edge);
+                BOOST_ASSERT_MSG(data.distance > 0, "edge_weight invalid");
+                const int to_distance = distance + data.distance;
+                if (!query_heap.WasInserted(to))
+                {
+                    query_heap.Insert(to, to_distance, node);
+                }
+                else if (to_distance < query_heap.GetKey(to))
+                {
+                    query_heap.GetData(to).parent = node;
+                    query_heap.DecreaseKey(to, to_distance);
+                    CHStallingPolicy::Unstall(query_heap, to);
+                }
+            }
+        }
+    }
+};
+
+#endif // ISOCHRONE_HPP
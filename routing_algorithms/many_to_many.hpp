@@ -30,13 +30,23 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "routing_base.hpp"
 #include "../data_structures/search_engine_data.hpp"
+#include "../data_structures/search_space_cache.hpp"
 #include "../typedefs.h"
+#include "../util/integer_range.hpp"
+#include "../util/memory_budget.hpp"
 
 #include <boost/assert.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iterator>
 #include <limits>
 #include <memory>
-#include <unordered_map>
+#include <tuple>
 #include <vector>
 
 template <class DataFacadeT>
@@ -51,14 +61,47 @@ class ManyToManyRouting final
     {
         unsigned target_id; // essentially a row in the distance matrix
         EdgeWeight distance;
-        NodeBucket(const unsigned target_id, const EdgeWeight distance)
-            : target_id(target_id), distance(distance)
+        NodeID parent; // of the node in the search of the target, leads down to the target
+        int length;    // decimeters to the target, only set if the buckets were built with lengths
+        NodeBucket(const unsigned target_id,
+                   const EdgeWeight distance,
+                   const NodeID parent,
+                   const int length)
+            : target_id(target_id), distance(distance), parent(parent), length(length)
         {
         }
     };
-    using SearchSpaceWithBuckets = std::unordered_map<NodeID, std::vector<NodeBucket>>;
+
+    struct SearchSpaceEntry
+    {
+        NodeID node;
+        EdgeWeight distance;
+        NodeID parent;
+        int length;
+    };
 
   public:
+    // The buckets of all nodes in one array, sorted by node. The forward searches look up every
+    // settled node, so the sorted node ids are kept apart from the buckets to keep the binary
+    // search in few cache lines. The buckets of bucket_nodes[i] are buckets[offsets[i]] up to
+    // buckets[offsets[i + 1]].
+    //
+    // On a partially contracted hierarchy the backward searches stop at the core nodes, whose
+    // buckets hold the distances from where the targets entered the core. The forward searches
+    // continue through the core from their own entry nodes, see CoreForwardSearch.
+    struct SearchSpaceWithBuckets
+    {
+        std::vector<NodeID> bucket_nodes;
+        std::vector<unsigned> offsets;
+        std::vector<NodeBucket> buckets;
+        // of every target, only set if the buckets were built with lengths
+        std::vector<FixedPointCoordinate> target_locations;
+        unsigned number_of_targets = 0;
+        // smallest distance of a bucket at a core node, INVALID_EDGE_WEIGHT if no target
+        // reached the core
+        EdgeWeight min_core_distance = INVALID_EDGE_WEIGHT;
+    };
+
     ManyToManyRouting(DataFacadeT *facade, SearchEngineData &engine_working_data)
         : super(facade), engine_working_data(engine_working_data)
     {
@@ -69,143 +112,845 @@ class ManyToManyRouting final
     std::shared_ptr<std::vector<EdgeWeight>>
     operator()(const PhantomNodeArray &phantom_nodes_array) const
     {
-        const auto number_of_locations = phantom_nodes_array.size();
-        std::shared_ptr<std::vector<EdgeWeight>> result_table =
-            std::make_shared<std::vector<EdgeWeight>>(number_of_locations * number_of_locations,
-                                                      std::numeric_limits<EdgeWeight>::max());
+        return (*this)(phantom_nodes_array, phantom_nodes_array);
+    }
 
-        engine_working_data.InitializeOrClearFirstThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
+    // The table from every source to every target with a row per source. Only the sources are
+    // searched forward and only the targets backward, so a few sources against many targets
+    // cost a search per location instead of the square table over all of them. Entries above
+    // max_distance are left unreachable, the searches stop as soon as they cannot get below it.
+    std::shared_ptr<std::vector<EdgeWeight>>
+    operator()(const PhantomNodeArray &source_phantom_nodes,
+               const PhantomNodeArray &target_phantom_nodes,
+               const EdgeWeight max_distance = INVALID_EDGE_WEIGHT) const
+    {
+        return ComputeTable<false>(source_phantom_nodes, target_phantom_nodes, nullptr,
+                                   max_distance);
+    }
 
-        QueryHeap &query_heap = *(engine_working_data.forward_heap_1);
+    // Same as above, lengths receives the length in meters of every shortest path in the layout
+    // of the table. The lengths of the packed edges are summed up along the searches, the
+    // partially traversed end nodes are converted with the length per weight of their adjacent
+    // packed edge.
+    std::shared_ptr<std::vector<EdgeWeight>>
+    operator()(const PhantomNodeArray &source_phantom_nodes,
+               const PhantomNodeArray &target_phantom_nodes,
+               std::vector<EdgeWeight> &lengths,
+               const EdgeWeight max_distance = INVALID_EDGE_WEIGHT) const
+    {
+        return ComputeTable<true>(source_phantom_nodes, target_phantom_nodes, &lengths,
+                                  max_distance);
+    }
 
-        SearchSpaceWithBuckets search_space_with_buckets;
+    // receives the first target of a tile, the number of its targets and its part of the table
+    // with a row per source. The lengths are empty unless the tiles are computed with lengths.
+    using TileCallback = std::function<void(const unsigned first_target,
+                                            const unsigned number_of_targets,
+                                            std::vector<EdgeWeight> &durations,
+                                            std::vector<EdgeWeight> &lengths)>;
+
+    // The table in tiles of at most targets_per_tile targets each, for tables that do not fit
+    // into memory as a whole. Only the buckets and the part of the table of one tile are kept at
+    // a time, the forward searches of the sources are repeated for every tile. The tiles are
+    // handed to tile_callback in the order of their targets.
+    template <bool with_lengths = false>
+    void ComputeTiledTable(const PhantomNodeArray &source_phantom_nodes,
+                           const PhantomNodeArray &target_phantom_nodes,
+                           const unsigned targets_per_tile,
+                           const TileCallback &tile_callback,
+                           const EdgeWeight max_distance = INVALID_EDGE_WEIGHT) const
+    {
+        BOOST_ASSERT(0 < targets_per_tile);
+        const unsigned number_of_targets = static_cast<unsigned>(target_phantom_nodes.size());
+        std::vector<EdgeWeight> lengths;
+        for (unsigned first_target = 0; first_target < number_of_targets;
+             first_target += targets_per_tile)
+        {
+            const unsigned last_target =
+                std::min(number_of_targets, first_target + targets_per_tile);
+            const PhantomNodeArray tile_phantom_nodes(
+                target_phantom_nodes.begin() + first_target,
+                target_phantom_nodes.begin() + last_target);
+            const auto durations =
+                ComputeTable<with_lengths>(source_phantom_nodes, tile_phantom_nodes,
+                                           with_lengths ? &lengths : nullptr, max_distance);
+            tile_callback(first_target, last_target - first_target, *durations, lengths);
+            osrm::memory::Release(GetTableBytes<with_lengths>(source_phantom_nodes.size(),
+                                                              last_target - first_target));
+        }
+    }
 
-        unsigned target_id = 0;
-        for (const std::vector<PhantomNode> &phantom_node_vector : phantom_nodes_array)
+    // Runs the backward searches of all targets and collects their search spaces in buckets.
+    // The searches are independent of each other and are spread over the worker threads, each of
+    // which uses its own thread local heap. They settle no node farther than max_distance.
+    template <bool with_lengths = false>
+    SearchSpaceWithBuckets
+    BuildTargetBuckets(const PhantomNodeArray &phantom_nodes_array,
+                       const EdgeWeight max_distance = INVALID_EDGE_WEIGHT) const
+    {
+        const unsigned number_of_targets = static_cast<unsigned>(phantom_nodes_array.size());
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        std::vector<std::vector<SearchSpaceEntry>> target_search_spaces(number_of_targets);
+        osrm::memory::Reservation search_space_reservation;
+        const auto cancellation_token = osrm::cancellation::Current();
+        tbb::parallel_for(
+            tbb::blocked_range<unsigned>(0, number_of_targets),
+            [&](const tbb::blocked_range<unsigned> &range)
+            {
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                const SearchEngineData::HeapScope heap_scope;
+                engine_working_data.InitializeOrClearFirstThreadLocalStorage(number_of_nodes);
+                QueryHeap &query_heap = *(engine_working_data.forward_heap_1);
+                for (unsigned target_id = range.begin(); target_id != range.end(); ++target_id)
+                {
+                    query_heap.Clear();
+                    // insert target(s) at distance 0
+                    for (const PhantomNode &phantom_node : phantom_nodes_array[target_id])
+                    {
+                        if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                        {
+                            query_heap.Insert(phantom_node.forward_node_id,
+                                              phantom_node.GetForwardWeightPlusOffset(),
+                                              phantom_node.forward_node_id);
+                        }
+                        if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                        {
+                            query_heap.Insert(phantom_node.reverse_node_id,
+                                              phantom_node.GetReverseWeightPlusOffset(),
+                                              phantom_node.reverse_node_id);
+                        }
+                    }
+
+                    // explore search space
+                    while (!query_heap.Empty() && query_heap.MinKey() <= max_distance)
+                    {
+                        SearchSpaceRoutingStep<false, with_lengths>(
+                            query_heap, target_search_spaces[target_id]);
+                    }
+                    search_space_reservation.Add(target_search_spaces[target_id].size() *
+                                                 sizeof(SearchSpaceEntry));
+                }
+            });
+        SearchSpaceWithBuckets search_space_with_buckets = BuildBuckets(target_search_spaces);
+        search_space_with_buckets.number_of_targets = number_of_targets;
+        for (const auto index :
+             osrm::irange<std::size_t>(0, search_space_with_buckets.bucket_nodes.size()))
+        {
+            if (!super::facade->IsCoreNode(search_space_with_buckets.bucket_nodes[index]))
+            {
+                continue;
+            }
+            for (unsigned i = search_space_with_buckets.offsets[index];
+                 i < search_space_with_buckets.offsets[index + 1]; ++i)
+            {
+                search_space_with_buckets.min_core_distance =
+                    std::min(search_space_with_buckets.min_core_distance,
+                             search_space_with_buckets.buckets[i].distance);
+            }
+        }
+        if (with_lengths)
         {
-            query_heap.Clear();
-            // insert target(s) at distance 0
+            for (const auto &phantom_nodes : phantom_nodes_array)
+            {
+                search_space_with_buckets.target_locations.push_back(
+                    phantom_nodes.empty() ? FixedPointCoordinate() : phantom_nodes.front().location);
+            }
+        }
+        return search_space_with_buckets;
+    }
 
-            for (const PhantomNode &phantom_node : phantom_node_vector)
+    // Runs the forward and the backward search of every location to the end and keeps their
+    // settled nodes, so that tables of these locations can be joined without searching again.
+    // On a partially contracted hierarchy the search spaces hold all of the core that the
+    // location reaches, the core is searched with a plain dijkstra.
+    void ComputeSearchSpaces(const PhantomNodeArray &phantom_nodes_array,
+                             std::vector<SearchSpace> &forward_search_spaces,
+                             std::vector<SearchSpace> &backward_search_spaces) const
+    {
+        const unsigned number_of_locations = static_cast<unsigned>(phantom_nodes_array.size());
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        forward_search_spaces.resize(number_of_locations);
+        backward_search_spaces.resize(number_of_locations);
+        const auto cancellation_token = osrm::cancellation::Current();
+        tbb::parallel_for(
+            tbb::blocked_range<unsigned>(0, 2 * number_of_locations),
+            [&](const tbb::blocked_range<unsigned> &range)
             {
-                if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                const SearchEngineData::HeapScope heap_scope;
+                engine_working_data.InitializeOrClearFirstThreadLocalStorage(number_of_nodes);
+                QueryHeap &query_heap = *(engine_working_data.forward_heap_1);
+                std::vector<SearchSpaceEntry> settled_nodes;
+                std::vector<SearchSpaceEntry> core_entries;
+                for (unsigned index = range.begin(); index != range.end(); ++index)
                 {
-                    query_heap.Insert(phantom_node.forward_node_id,
-                                      phantom_node.GetForwardWeightPlusOffset(),
-                                      phantom_node.forward_node_id);
+                    // sources insert their offsets negated, like in ForwardSearch
+                    const bool forward_direction = index < number_of_locations;
+                    const unsigned location = index % number_of_locations;
+                    const int sign = forward_direction ? -1 : 1;
+                    query_heap.Clear();
+                    for (const PhantomNode &phantom_node : phantom_nodes_array[location])
+                    {
+                        if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                        {
+                            query_heap.Insert(phantom_node.forward_node_id,
+                                              sign * phantom_node.GetForwardWeightPlusOffset(),
+                                              phantom_node.forward_node_id);
+                        }
+                        if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                        {
+                            query_heap.Insert(phantom_node.reverse_node_id,
+                                              sign * phantom_node.GetReverseWeightPlusOffset(),
+                                              phantom_node.reverse_node_id);
+                        }
+                    }
+
+                    settled_nodes.clear();
+                    while (!query_heap.Empty())
+                    {
+                        if (forward_direction)
+                        {
+                            SearchSpaceRoutingStep<true>(query_heap, settled_nodes);
+                        }
+                        else
+                        {
+                            SearchSpaceRoutingStep<false>(query_heap, settled_nodes);
+                        }
+                    }
+
+                    // the core nodes are settled again by the search on the core
+                    const auto core_begin =
+                        std::partition(settled_nodes.begin(), settled_nodes.end(),
+                                       [this](const SearchSpaceEntry &entry)
+                                       {
+                                           return !super::facade->IsCoreNode(entry.node);
+                                       });
+                    if (core_begin != settled_nodes.end())
+                    {
+                        core_entries.assign(core_begin, settled_nodes.end());
+                        settled_nodes.erase(core_begin, settled_nodes.end());
+                        engine_working_data.InitializeOrClearSecondThreadLocalStorage(
+                            number_of_nodes);
+                        QueryHeap &core_heap = *(engine_working_data.forward_heap_2);
+                        InsertCoreEntries(core_entries, core_heap);
+                        while (!core_heap.Empty())
+                        {
+                            if (forward_direction)
+                            {
+                                CoreSearchSpaceRoutingStep<true>(core_heap, settled_nodes);
+                            }
+                            else
+                            {
+                                CoreSearchSpaceRoutingStep<false>(core_heap, settled_nodes);
+                            }
+                        }
+                    }
+                    std::sort(settled_nodes.begin(), settled_nodes.end(),
+                              [](const SearchSpaceEntry &lhs, const SearchSpaceEntry &rhs)
+                              {
+                                  return lhs.node < rhs.node;
+                              });
+
+                    SearchSpace &search_space = forward_direction
+                                                    ? forward_search_spaces[location]
+                                                    : backward_search_spaces[location];
+                    search_space.nodes.resize(settled_nodes.size());
+                    search_space.distances.resize(settled_nodes.size());
+                    for (const auto i : osrm::irange<std::size_t>(0, settled_nodes.size()))
+                    {
+                        search_space.nodes[i] = settled_nodes[i].node;
+                        search_space.distances[i] = settled_nodes[i].distance;
+                    }
                 }
-                if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+            });
+    }
+
+    // The table of the forward search spaces of the sources to the backward search spaces of
+    // the targets, each entry is the shortest distance over the nodes both spaces settled
+    std::shared_ptr<std::vector<EdgeWeight>>
+    JoinSearchSpaces(const std::vector<const SearchSpace *> &forward_search_spaces,
+                     const std::vector<const SearchSpace *> &backward_search_spaces) const
+    {
+        const std::size_t number_of_sources = forward_search_spaces.size();
+        const std::size_t number_of_targets = backward_search_spaces.size();
+        std::shared_ptr<std::vector<EdgeWeight>> result_table =
+            std::make_shared<std::vector<EdgeWeight>>(number_of_sources * number_of_targets);
+        const auto cancellation_token = osrm::cancellation::Current();
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, number_of_sources),
+            [&](const tbb::blocked_range<std::size_t> &range)
+            {
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                for (auto source_id = range.begin(); source_id != range.end(); ++source_id)
                 {
-                    query_heap.Insert(phantom_node.reverse_node_id,
-                                      phantom_node.GetReverseWeightPlusOffset(),
-                                      phantom_node.reverse_node_id);
+                    osrm::cancellation::Check();
+                    for (const auto target_id : osrm::irange<std::size_t>(0, number_of_targets))
+                    {
+                        (*result_table)[source_id * number_of_targets + target_id] =
+                            GetJoinedDistance(*forward_search_spaces[source_id],
+                                              *backward_search_spaces[target_id]);
+                    }
                 }
+            });
+        return result_table;
+    }
+
+    // Searches from one source and keeps the shortest distance to every target in distances.
+    // If middle_nodes is given, it receives the node at which each of these paths meets the
+    // search of its target, the query heap then holds the forward part of the paths. With
+    // lengths, the buckets need to be built with lengths and lengths receives the decimeters
+    // along the paths. The search stops at max_distance, the distances of the buckets are never
+    // negative. Paths through the core are only known to RetrievePackedPathToTarget until the
+    // next search on the same thread.
+    template <bool with_lengths = false>
+    void ForwardSearch(const std::vector<PhantomNode> &source_phantom_nodes,
+                       QueryHeap &query_heap,
+                       const SearchSpaceWithBuckets &search_space_with_buckets,
+                       EdgeWeight *distances,
+                       NodeID *middle_nodes,
+                       EdgeWeight *lengths = nullptr,
+                       const EdgeWeight max_distance = INVALID_EDGE_WEIGHT) const
+    {
+        query_heap.Clear();
+        for (const PhantomNode &phantom_node : source_phantom_nodes)
+        {
+            // insert sources at distance 0
+            if (SPECIAL_NODEID != phantom_node.forward_node_id)
+            {
+                query_heap.Insert(phantom_node.forward_node_id,
+                                  -phantom_node.GetForwardWeightPlusOffset(),
+                                  phantom_node.forward_node_id);
+            }
+            if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+            {
+                query_heap.Insert(phantom_node.reverse_node_id,
+                                  -phantom_node.GetReverseWeightPlusOffset(),
+                                  phantom_node.reverse_node_id);
             }
+        }
+
+        const FixedPointCoordinate source_location =
+            source_phantom_nodes.empty() ? FixedPointCoordinate()
+                                         : source_phantom_nodes.front().location;
+        // explore search space
+        std::vector<SearchSpaceEntry> core_entries;
+        while (!query_heap.Empty() && query_heap.MinKey() <= max_distance)
+        {
+            ForwardRoutingStep<with_lengths>(query_heap, search_space_with_buckets, distances,
+                                             middle_nodes, lengths, source_location,
+                                             core_entries);
+        }
+
+        // no path can lead through the core unless a target reached it as well
+        if (!core_entries.empty() &&
+            INVALID_EDGE_WEIGHT != search_space_with_buckets.min_core_distance)
+        {
+            CoreForwardSearch<with_lengths>(core_entries, search_space_with_buckets, distances,
+                                            middle_nodes, lengths, source_location,
+                                            max_distance);
+        }
+    }
 
-            // explore search space
-            while (!query_heap.Empty())
+    // The packed path from the source of the last forward search over middle_node to a target
+    void RetrievePackedPathToTarget(const QueryHeap &forward_heap,
+                                    const SearchSpaceWithBuckets &search_space_with_buckets,
+                                    const NodeID middle_node,
+                                    const unsigned target_id,
+                                    std::vector<NodeID> &packed_path) const
+    {
+        // a path that meets its target in the core leads back over the core heap to the node
+        // it entered the core at, the rest of it is in the forward heap
+        NodeID entry_node = middle_node;
+        if (super::facade->IsCoreNode(middle_node))
+        {
+            const QueryHeap &core_heap = *(engine_working_data.forward_heap_2);
+            while (core_heap.GetData(entry_node).parent != entry_node &&
+                   super::facade->IsCoreNode(core_heap.GetData(entry_node).parent))
             {
-                BackwardRoutingStep(target_id, query_heap, search_space_with_buckets);
+                entry_node = core_heap.GetData(entry_node).parent;
+                packed_path.emplace_back(entry_node);
             }
-            ++target_id;
         }
+        super::RetrievePackedPathFromSingleHeap(forward_heap, entry_node, packed_path);
+        std::reverse(packed_path.begin(), packed_path.end());
+        packed_path.emplace_back(middle_node);
 
-        // for each source do forward search
-        unsigned source_id = 0;
-        for (const std::vector<PhantomNode> &phantom_node_vector : phantom_nodes_array)
+        NodeID current_node = middle_node;
+        for (;;)
         {
-            query_heap.Clear();
-            for (const PhantomNode &phantom_node : phantom_node_vector)
+            const NodeBucket *bucket =
+                FindBucket(search_space_with_buckets, current_node, target_id);
+            BOOST_ASSERT(nullptr != bucket);
+            if (bucket->parent == current_node)
             {
-                // insert sources at distance 0
-                if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                break;
+            }
+            current_node = bucket->parent;
+            packed_path.emplace_back(current_node);
+        }
+    }
+
+  private:
+    template <bool with_lengths>
+    static std::size_t GetTableBytes(const std::size_t number_of_sources,
+                                     const std::size_t number_of_targets)
+    {
+        return number_of_sources * number_of_targets * sizeof(EdgeWeight) * (with_lengths ? 2 : 1);
+    }
+
+    template <bool with_lengths>
+    std::shared_ptr<std::vector<EdgeWeight>>
+    ComputeTable(const PhantomNodeArray &source_phantom_nodes,
+                 const PhantomNodeArray &target_phantom_nodes,
+                 std::vector<EdgeWeight> *lengths,
+                 const EdgeWeight max_distance) const
+    {
+        const unsigned number_of_sources = static_cast<unsigned>(source_phantom_nodes.size());
+        const unsigned number_of_targets = static_cast<unsigned>(target_phantom_nodes.size());
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        // the table is kept until the request is done, see ComputeTiledTable for tiles
+        osrm::memory::Charge(GetTableBytes<with_lengths>(number_of_sources, number_of_targets));
+        std::shared_ptr<std::vector<EdgeWeight>> result_table =
+            std::make_shared<std::vector<EdgeWeight>>(number_of_sources * number_of_targets,
+                                                      std::numeric_limits<EdgeWeight>::max());
+        if (with_lengths)
+        {
+            lengths->assign(number_of_sources * number_of_targets, INVALID_EDGE_WEIGHT);
+        }
+
+        // The sources start their searches at their negated offsets, a path may thus be shorter
+        // than the part the backward search found of it by the largest offset of a source
+        EdgeWeight backward_max_distance = max_distance;
+        if (INVALID_EDGE_WEIGHT != max_distance)
+        {
+            EdgeWeight max_source_offset = 0;
+            for (const auto &phantom_nodes : source_phantom_nodes)
+            {
+                for (const PhantomNode &phantom_node : phantom_nodes)
                 {
-                    query_heap.Insert(phantom_node.forward_node_id,
-                                      -phantom_node.GetForwardWeightPlusOffset(),
-                                      phantom_node.forward_node_id);
+                    if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                    {
+                        max_source_offset = std::max(max_source_offset,
+                                                     phantom_node.GetForwardWeightPlusOffset());
+                    }
+                    if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                    {
+                        max_source_offset = std::max(max_source_offset,
+                                                     phantom_node.GetReverseWeightPlusOffset());
+                    }
                 }
-                if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+            }
+            backward_max_distance = max_distance > INVALID_EDGE_WEIGHT - max_source_offset
+                                        ? INVALID_EDGE_WEIGHT
+                                        : max_distance + max_source_offset;
+        }
+        const SearchSpaceWithBuckets search_space_with_buckets =
+            BuildTargetBuckets<with_lengths>(target_phantom_nodes, backward_max_distance);
+        const osrm::memory::Reservation bucket_reservation(
+            search_space_with_buckets.buckets.size() * sizeof(NodeBucket) +
+            search_space_with_buckets.bucket_nodes.size() * (sizeof(NodeID) + sizeof(unsigned)));
+
+        // for each source do forward search, every source writes its own row of the table
+        const auto cancellation_token = osrm::cancellation::Current();
+        tbb::parallel_for(
+            tbb::blocked_range<unsigned>(0, number_of_sources),
+            [&](const tbb::blocked_range<unsigned> &range)
+            {
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                const SearchEngineData::HeapScope heap_scope;
+                engine_working_data.InitializeOrClearFirstThreadLocalStorage(number_of_nodes);
+                QueryHeap &query_heap = *(engine_working_data.forward_heap_1);
+                for (unsigned source_id = range.begin(); source_id != range.end(); ++source_id)
                 {
-                    query_heap.Insert(phantom_node.reverse_node_id,
-                                      -phantom_node.GetReverseWeightPlusOffset(),
-                                      phantom_node.reverse_node_id);
+                    const unsigned row_begin = source_id * number_of_targets;
+                    EdgeWeight *row_lengths = with_lengths ? &(*lengths)[row_begin] : nullptr;
+                    ForwardSearch<with_lengths>(source_phantom_nodes[source_id], query_heap,
+                                                search_space_with_buckets,
+                                                &(*result_table)[row_begin], nullptr,
+                                                row_lengths, max_distance);
+                    for (unsigned target_id = 0;
+                         INVALID_EDGE_WEIGHT != max_distance && target_id < number_of_targets;
+                         ++target_id)
+                    {
+                        // joins of the last settled nodes may exceed the bound
+                        EdgeWeight &distance = (*result_table)[row_begin + target_id];
+                        if (INVALID_EDGE_WEIGHT != distance && distance > max_distance)
+                        {
+                            distance = INVALID_EDGE_WEIGHT;
+                            if (with_lengths)
+                            {
+                                row_lengths[target_id] = INVALID_EDGE_WEIGHT;
+                            }
+                        }
+                    }
+                    for (unsigned target_id = 0; with_lengths && target_id < number_of_targets;
+                         ++target_id)
+                    {
+                        // decimeters to meters
+                        if (INVALID_EDGE_WEIGHT != row_lengths[target_id])
+                        {
+                            row_lengths[target_id] = static_cast<EdgeWeight>(
+                                std::round(std::max(0, row_lengths[target_id]) / 10.));
+                        }
+                    }
                 }
-            }
+            });
+        return result_table;
+    }
 
-            // explore search space
-            while (!query_heap.Empty())
+    // Length per weight of the packed edge from s to t, in decimeters
+    double GetLengthPerWeight(const NodeID s, const NodeID t) const
+    {
+        bool traversed_in_reverse = false;
+        const EdgeID edge_id = super::FindSmallestEdge(s, t, traversed_in_reverse);
+        BOOST_ASSERT(SPECIAL_EDGEID != edge_id);
+        const auto &data = super::facade->GetEdgeData(edge_id);
+        return data.distance > 0 ? static_cast<double>(data.length) / data.distance : 0.;
+    }
+
+    // Length of the path that the forward search and the bucket join at node. An end node of the
+    // path whose search did not leave it yet has not been converted, this is done here with the
+    // packed edge that the other search reached it over.
+    int GetJoinedLength(QueryHeap &query_heap,
+                        const NodeID node,
+                        const NodeBucket &bucket,
+                        const FixedPointCoordinate &source_location,
+                        const FixedPointCoordinate &target_location) const
+    {
+        const HeapData &data = query_heap.GetData(node);
+        const bool source_is_root = data.parent == node;
+        const bool target_is_root = bucket.parent == node;
+        if (source_is_root && target_is_root)
+        {
+            // source and target lie on the same node
+            return static_cast<int>(std::round(
+                10 * coordinate_calculation::great_circle_distance(source_location,
+                                                                   target_location)));
+        }
+        if (source_is_root)
+        {
+            return bucket.length + static_cast<int>(std::round(
+                                       query_heap.GetKey(node) *
+                                       GetLengthPerWeight(node, bucket.parent)));
+        }
+        if (target_is_root)
+        {
+            return data.length + static_cast<int>(std::round(
+                                     bucket.distance * GetLengthPerWeight(data.parent, node)));
+        }
+        return data.length + bucket.length;
+    }
+
+    static EdgeWeight GetJoinedDistance(const SearchSpace &forward_search_space,
+                                        const SearchSpace &backward_search_space)
+    {
+        EdgeWeight distance = INVALID_EDGE_WEIGHT;
+        std::size_t forward_index = 0;
+        std::size_t backward_index = 0;
+        while (forward_index < forward_search_space.nodes.size() &&
+               backward_index < backward_search_space.nodes.size())
+        {
+            const NodeID forward_node = forward_search_space.nodes[forward_index];
+            const NodeID backward_node = backward_search_space.nodes[backward_index];
+            if (forward_node < backward_node)
             {
-                ForwardRoutingStep(source_id, number_of_locations, query_heap,
-                                   search_space_with_buckets, result_table);
+                ++forward_index;
+            }
+            else if (backward_node < forward_node)
+            {
+                ++backward_index;
+            }
+            else
+            {
+                const EdgeWeight new_distance = forward_search_space.distances[forward_index] +
+                                                backward_search_space.distances[backward_index];
+                if (new_distance >= 0 && new_distance < distance)
+                {
+                    distance = new_distance;
+                }
+                ++forward_index;
+                ++backward_index;
             }
-
-            ++source_id;
         }
-        BOOST_ASSERT(source_id == target_id);
-        return result_table;
+        return distance;
     }
 
-    void ForwardRoutingStep(const unsigned source_id,
-                            const unsigned number_of_locations,
-                            QueryHeap &query_heap,
-                            const SearchSpaceWithBuckets &search_space_with_buckets,
-                            std::shared_ptr<std::vector<EdgeWeight>> result_table) const
+    const NodeBucket *FindBucket(const SearchSpaceWithBuckets &search_space_with_buckets,
+                                 const NodeID node,
+                                 const unsigned target_id) const
     {
-        const NodeID node = query_heap.DeleteMin();
-        const int source_distance = query_heap.GetKey(node);
+        const auto &bucket_nodes = search_space_with_buckets.bucket_nodes;
+        const auto node_iterator = std::lower_bound(bucket_nodes.begin(), bucket_nodes.end(), node);
+        if (node_iterator == bucket_nodes.end() || *node_iterator != node)
+        {
+            return nullptr;
+        }
+        const auto bucket_index = std::distance(bucket_nodes.begin(), node_iterator);
+        const auto begin = search_space_with_buckets.buckets.begin() +
+                           search_space_with_buckets.offsets[bucket_index];
+        const auto end = search_space_with_buckets.buckets.begin() +
+                         search_space_with_buckets.offsets[bucket_index + 1];
+        // the buckets of a node are sorted by target
+        const auto bucket = std::lower_bound(begin, end, target_id,
+                                             [](const NodeBucket &bucket, const unsigned target_id)
+                                             {
+                                                 return bucket.target_id < target_id;
+                                             });
+        if (bucket == end || bucket->target_id != target_id)
+        {
+            return nullptr;
+        }
+        return &*bucket;
+    }
 
+    // Joins the path of the forward search to node with the buckets at node, returns whether
+    // the distance of any target improved
+    template <bool with_lengths>
+    bool JoinBuckets(QueryHeap &query_heap,
+                     const NodeID node,
+                     const int source_distance,
+                     const SearchSpaceWithBuckets &search_space_with_buckets,
+                     EdgeWeight *distances,
+                     NodeID *middle_nodes,
+                     EdgeWeight *lengths,
+                     const FixedPointCoordinate &source_location) const
+    {
+        bool improved = false;
         // check if each encountered node has an entry
-        const auto bucket_iterator = search_space_with_buckets.find(node);
+        const auto &bucket_nodes = search_space_with_buckets.bucket_nodes;
+        const auto node_iterator = std::lower_bound(bucket_nodes.begin(), bucket_nodes.end(), node);
         // iterate bucket if there exists one
-        if (bucket_iterator != search_space_with_buckets.end())
+        if (node_iterator != bucket_nodes.end() && *node_iterator == node)
         {
-            const std::vector<NodeBucket> &bucket_list = bucket_iterator->second;
-            for (const NodeBucket &current_bucket : bucket_list)
+            const auto bucket_index = std::distance(bucket_nodes.begin(), node_iterator);
+            const unsigned buckets_end = search_space_with_buckets.offsets[bucket_index + 1];
+            for (unsigned i = search_space_with_buckets.offsets[bucket_index]; i < buckets_end;
+                 ++i)
             {
+                const NodeBucket &current_bucket = search_space_with_buckets.buckets[i];
                 // get target id from bucket entry
                 const unsigned target_id = current_bucket.target_id;
                 const int target_distance = current_bucket.distance;
-                const EdgeWeight current_distance =
-                    (*result_table)[source_id * number_of_locations + target_id];
                 // check if new distance is better
                 const EdgeWeight new_distance = source_distance + target_distance;
-                if (new_distance >= 0 && new_distance < current_distance)
+                if (new_distance >= 0 && new_distance < distances[target_id])
                 {
-                    (*result_table)[source_id * number_of_locations + target_id] =
-                        (source_distance + target_distance);
+                    improved = true;
+                    distances[target_id] = new_distance;
+                    if (nullptr != middle_nodes)
+                    {
+                        middle_nodes[target_id] = node;
+                    }
+                    if (with_lengths)
+                    {
+                        lengths[target_id] = GetJoinedLength(
+                            query_heap, node, current_bucket, source_location,
+                            search_space_with_buckets.target_locations[target_id]);
+                    }
                 }
             }
         }
-        if (StallAtNode<true>(node, source_distance, query_heap))
+        return improved;
+    }
+
+    // The core nodes are only joined with their buckets and handed on as entries of the core.
+    template <bool with_lengths>
+    void ForwardRoutingStep(QueryHeap &query_heap,
+                            const SearchSpaceWithBuckets &search_space_with_buckets,
+                            EdgeWeight *distances,
+                            NodeID *middle_nodes,
+                            EdgeWeight *lengths,
+                            const FixedPointCoordinate &source_location,
+                            std::vector<SearchSpaceEntry> &core_entries) const
+    {
+        osrm::cancellation::Poll();
+        const NodeID node = query_heap.DeleteMin();
+        if (SearchEngineData::prefetch_search_graph)
+        {
+            super::PrefetchSearchStep(query_heap, node);
+        }
+        const int source_distance = query_heap.GetKey(node);
+
+        JoinBuckets<with_lengths>(query_heap, node, source_distance, search_space_with_buckets,
+                                  distances, middle_nodes, lengths, source_location);
+        if (super::facade->IsCoreNode(node))
+        {
+            const HeapData &data = query_heap.GetData(node);
+            core_entries.push_back({node, source_distance, data.parent, data.length});
+            return;
+        }
+        if (CHStallingPolicy::Stall<true>(*super::facade, query_heap, node, source_distance))
         {
             return;
         }
-        RelaxOutgoingEdges<true>(node, source_distance, query_heap);
+        RelaxOutgoingEdges<true, with_lengths>(node, source_distance, query_heap);
     }
 
-    void BackwardRoutingStep(const unsigned target_id,
-                             QueryHeap &query_heap,
-                             SearchSpaceWithBuckets &search_space_with_buckets) const
+    // The entries keep their parents in the contracted graph, RetrievePackedPathToTarget leaves
+    // the core heap at them
+    void InsertCoreEntries(const std::vector<SearchSpaceEntry> &core_entries,
+                           QueryHeap &core_heap) const
     {
+        for (const SearchSpaceEntry &entry : core_entries)
+        {
+            if (!core_heap.WasInserted(entry.node))
+            {
+                core_heap.Insert(entry.node, entry.distance, entry.parent);
+                core_heap.GetData(entry.node).length = entry.length;
+            }
+        }
+    }
+
+    // Continues a forward search with a plain dijkstra on the core from the core nodes of its
+    // search on the contracted graph, on the second heap of the thread. Every path that is yet
+    // to be joined with a bucket at a core node is longer than the smallest key of the core
+    // heap plus the smallest distance of such a bucket, the search stops once that exceeds the
+    // distances of all targets.
+    template <bool with_lengths>
+    void CoreForwardSearch(const std::vector<SearchSpaceEntry> &core_entries,
+                           const SearchSpaceWithBuckets &search_space_with_buckets,
+                           EdgeWeight *distances,
+                           NodeID *middle_nodes,
+                           EdgeWeight *lengths,
+                           const FixedPointCoordinate &source_location,
+                           const EdgeWeight max_distance) const
+    {
+        BOOST_ASSERT(0 < search_space_with_buckets.number_of_targets);
+        engine_working_data.InitializeOrClearSecondThreadLocalStorage(
+            super::facade->GetNumberOfNodes());
+        QueryHeap &core_heap = *(engine_working_data.forward_heap_2);
+        InsertCoreEntries(core_entries, core_heap);
+
+        const auto largest_distance = [&]()
+        {
+            return *std::max_element(distances,
+                                     distances + search_space_with_buckets.number_of_targets);
+        };
+        EdgeWeight upper_bound = largest_distance();
+        while (!core_heap.Empty() && core_heap.MinKey() <= max_distance &&
+               core_heap.MinKey() + search_space_with_buckets.min_core_distance < upper_bound)
+        {
+            osrm::cancellation::Poll();
+            const NodeID node = core_heap.DeleteMin();
+            const int source_distance = core_heap.GetKey(node);
+            if (JoinBuckets<with_lengths>(core_heap, node, source_distance,
+                                          search_space_with_buckets, distances, middle_nodes,
+                                          lengths, source_location))
+            {
+                upper_bound = largest_distance();
+            }
+            RelaxOutgoingEdges<true, with_lengths>(node, source_distance, core_heap);
+        }
+    }
+
+    // sorts the settled nodes of all backward searches by node, ties by target
+    SearchSpaceWithBuckets
+    BuildBuckets(const std::vector<std::vector<SearchSpaceEntry>> &target_search_spaces) const
+    {
+        struct SettledNode
+        {
+            NodeID node;
+            unsigned target_id;
+            EdgeWeight distance;
+            NodeID parent;
+            int length;
+        };
+        std::size_t number_of_settled_nodes = 0;
+        for (const auto &search_space : target_search_spaces)
+        {
+            number_of_settled_nodes += search_space.size();
+        }
+        const osrm::memory::Reservation settled_nodes_reservation(number_of_settled_nodes *
+                                                                  sizeof(SettledNode));
+        std::vector<SettledNode> settled_nodes;
+        settled_nodes.reserve(number_of_settled_nodes);
+        for (unsigned target_id = 0; target_id < target_search_spaces.size(); ++target_id)
+        {
+            for (const SearchSpaceEntry &entry : target_search_spaces[target_id])
+            {
+                settled_nodes.push_back(
+                    {entry.node, target_id, entry.distance, entry.parent, entry.length});
+            }
+        }
+        std::sort(settled_nodes.begin(), settled_nodes.end(),
+                  [](const SettledNode &lhs, const SettledNode &rhs)
+                  {
+                      return std::tie(lhs.node, lhs.target_id) < std::tie(rhs.node, rhs.target_id);
+                  });
+
+        SearchSpaceWithBuckets search_space_with_buckets;
+        search_space_with_buckets.buckets.reserve(settled_nodes.size());
+        for (const SettledNode &settled_node : settled_nodes)
+        {
+            if (search_space_with_buckets.bucket_nodes.empty() ||
+                search_space_with_buckets.bucket_nodes.back() != settled_node.node)
+            {
+                search_space_with_buckets.bucket_nodes.push_back(settled_node.node);
+                search_space_with_buckets.offsets.push_back(
+                    static_cast<unsigned>(search_space_with_buckets.buckets.size()));
+            }
+            search_space_with_buckets.buckets.emplace_back(
+                settled_node.target_id, settled_node.distance, settled_node.parent,
+                settled_node.length);
+        }
+        search_space_with_buckets.offsets.push_back(
+            static_cast<unsigned>(search_space_with_buckets.buckets.size()));
+        return search_space_with_buckets;
+    }
+
+    template <bool forward_direction, bool with_lengths = false>
+    void SearchSpaceRoutingStep(QueryHeap &query_heap,
+                                std::vector<SearchSpaceEntry> &search_space) const
+    {
+        osrm::cancellation::Poll();
         const NodeID node = query_heap.DeleteMin();
-        const int target_distance = query_heap.GetKey(node);
+        if (SearchEngineData::prefetch_search_graph)
+        {
+            super::PrefetchSearchStep(query_heap, node);
+        }
+        const int distance = query_heap.GetKey(node);
 
-        // store settled nodes in search space bucket
-        search_space_with_buckets[node].emplace_back(target_id, target_distance);
+        // store settled nodes in the search space of the location
+        const HeapData &data = query_heap.GetData(node);
+        search_space.push_back({node, distance, data.parent, data.length});
 
-        if (StallAtNode<false>(node, target_distance, query_heap))
+        // the core is not contracted, the search ends where it enters the core
+        if (super::facade->IsCoreNode(node))
+        {
+            return;
+        }
+        if (CHStallingPolicy::Stall<forward_direction>(*super::facade, query_heap, node,
+                                                       distance))
         {
             return;
         }
 
-        RelaxOutgoingEdges<false>(node, target_distance, query_heap);
+        RelaxOutgoingEdges<forward_direction, with_lengths>(node, distance, query_heap);
     }
 
+    // the core search does not stall, it is a plain dijkstra
     template <bool forward_direction>
+    void CoreSearchSpaceRoutingStep(QueryHeap &core_heap,
+                                    std::vector<SearchSpaceEntry> &search_space) const
+    {
+        osrm::cancellation::Poll();
+        const NodeID node = core_heap.DeleteMin();
+        const int distance = core_heap.GetKey(node);
+        const HeapData &data = core_heap.GetData(node);
+        search_space.push_back({node, distance, data.parent, data.length});
+        RelaxOutgoingEdges<forward_direction>(node, distance, core_heap);
+    }
+
+    // With lengths, the heap data of every reached node holds the decimeters along its path. The
+    // edges that leave a root convert the part of the root node that the phantom node cuts off
+    // with their length per weight, distance is the weight of that part.
+    template <bool forward_direction, bool with_lengths = false>
     inline void
     RelaxOutgoingEdges(const NodeID node, const EdgeWeight distance, QueryHeap &query_heap) const
     {
+        const HeapData &node_data = query_heap.GetData(node);
+        const bool is_root = node_data.parent == node;
+        const int node_length = node_data.length;
         for (auto edge : super::facade->GetAdjacentEdgeRange(node))
         {
             const auto &data = super::facade->GetEdgeData(edge);
@@ -218,46 +963,34 @@ class ManyToManyRouting final
                 BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
                 const int to_distance = distance + edge_weight;
 
+                int to_length = 0;
+                if (with_lengths)
+                {
+                    to_length = node_length + static_cast<int>(data.length);
+                    if (is_root)
+                    {
+                        to_length += static_cast<int>(
+                            std::round(distance * static_cast<double>(data.length) / edge_weight));
+                    }
+                }
+
                 // New Node discovered -> Add to Heap + Node Info Storage
                 if (!query_heap.WasInserted(to))
                 {
                     query_heap.Insert(to, to_distance, node);
+                    query_heap.GetData(to).length = to_length;
                 }
                 // Found a shorter Path -> Update distance
                 else if (to_distance < query_heap.GetKey(to))
                 {
                     // new parent
                     query_heap.GetData(to).parent = node;
+                    query_heap.GetData(to).length = to_length;
                     query_heap.DecreaseKey(to, to_distance);
+                    CHStallingPolicy::Unstall(query_heap, to);
                 }
             }
         }
     }
-
-    // Stalling
-    template <bool forward_direction>
-    inline bool
-    StallAtNode(const NodeID node, const EdgeWeight distance, QueryHeap &query_heap) const
-    {
-        for (auto edge : super::facade->GetAdjacentEdgeRange(node))
-        {
-            const auto &data = super::facade->GetEdgeData(edge);
-            const bool reverse_flag = ((!forward_direction) ? data.forward : data.backward);
-            if (reverse_flag)
-            {
-                const NodeID to = super::facade->GetTarget(edge);
-                const int edge_weight = data.distance;
-                BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
-                if (query_heap.WasInserted(to))
-                {
-                    if (query_heap.GetKey(to) + edge_weight < distance)
-                    {
-                        return true;
-                    }
-                }
-            }
-        }
-        return false;
-    }
 };
 #endif
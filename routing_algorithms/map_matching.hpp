@@ -29,17 +29,24 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define MAP_MATCHING_HPP
 
 #include "routing_base.hpp"
+#include "many_to_many.hpp"
 
 #include "../algorithms/coordinate_calculation.hpp"
 #include "../data_structures/hidden_markov_model.hpp"
+#include "../data_structures/internal_route_result.hpp"
 #include "../util/json_logger.hpp"
 #include "../util/matching_debug_info.hpp"
+#include "../util/query_cancellation.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 #include <cstddef>
 
 #include <algorithm>
 #include <deque>
 #include <iomanip>
+#include <iterator>
 #include <numeric>
 #include <utility>
 #include <vector>
@@ -53,6 +60,8 @@ struct SubMatching
 {
     std::vector<PhantomNode> nodes;
     std::vector<unsigned> indices;
+    // packed paths of the transitions between consecutive nodes, empty if not known
+    std::vector<std::vector<NodeID>> packed_paths;
     double length;
     double confidence;
 };
@@ -66,6 +75,9 @@ constexpr static const unsigned MAX_BROKEN_STATES = 10;
 
 constexpr static const double MAX_SPEED = 180 / 3.6; // 180km -> m/s
 constexpr static const unsigned SUSPICIOUS_DISTANCE_DELTA = 100;
+// lowest average speed of a transition, bounds the searches for transitions that would be
+// pruned for their length anyway. Profiles for walking have to pass this as well.
+constexpr static const double MIN_TRANSITION_SPEED = 1.; // m/s
 }
 }
 
@@ -98,6 +110,36 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
     {
     }
 
+    // Unpacks the transitions a matching was found with into one leg per pair of consecutive
+    // nodes, without searching them again
+    void UnpackSubMatching(const osrm::matching::SubMatching &sub,
+                           InternalRouteResult &raw_route) const
+    {
+        BOOST_ASSERT(sub.packed_paths.size() + 1 == sub.nodes.size());
+
+        raw_route.unpacked_path_segments.resize(sub.packed_paths.size());
+        raw_route.shortest_path_length = 0;
+        for (const auto i : osrm::irange<std::size_t>(0u, sub.packed_paths.size()))
+        {
+            const auto &packed_path = sub.packed_paths[i];
+            BOOST_ASSERT(!packed_path.empty());
+
+            PhantomNodes phantom_node_pair;
+            phantom_node_pair.source_phantom = sub.nodes[i];
+            phantom_node_pair.target_phantom = sub.nodes[i + 1];
+            raw_route.segment_end_coordinates.push_back(phantom_node_pair);
+            super::UnpackPath(packed_path, phantom_node_pair, raw_route.unpacked_path_segments[i]);
+            raw_route.source_traversed_in_reverse.push_back(
+                packed_path.front() != phantom_node_pair.source_phantom.forward_node_id);
+            raw_route.target_traversed_in_reverse.push_back(
+                packed_path.back() != phantom_node_pair.target_phantom.forward_node_id);
+            for (const auto &path_data : raw_route.unpacked_path_segments[i])
+            {
+                raw_route.shortest_path_length += path_data.segment_duration;
+            }
+        }
+    }
+
     void operator()(const osrm::matching::CandidateLists &candidates_list,
                     const std::vector<FixedPointCoordinate> &trace_coordinates,
                     const std::vector<unsigned> &trace_timestamps,
@@ -106,6 +148,8 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
                     osrm::matching::SubMatchingList &sub_matchings) const
     {
         BOOST_ASSERT(candidates_list.size() == trace_coordinates.size());
+        BOOST_ASSERT(trace_timestamps.empty() ||
+                     candidates_list.size() == trace_timestamps.size());
 
         const auto median_sample_time = [&]() {
             if (trace_timestamps.size() > 1)
@@ -117,6 +161,107 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
                 return 0u;
             }
         }();
+
+        const auto segment_begins =
+            SplitTrace(candidates_list, trace_timestamps, median_sample_time);
+        // the debug info is collected in the json logger of the calling thread only
+        if (segment_begins.size() < 2 || osrm::json::Logger::get())
+        {
+            MatchTrace(candidates_list, trace_coordinates, trace_timestamps, median_sample_time,
+                       matching_beta, gps_precision, sub_matchings);
+            return;
+        }
+
+        // the segments can not share a matching, they are matched on their own and their
+        // matchings are concatenated in the order of the trace
+        std::vector<osrm::matching::SubMatchingList> segment_matchings(segment_begins.size());
+        const auto cancellation_token = osrm::cancellation::Current();
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, segment_begins.size(), 1),
+            [&](const tbb::blocked_range<std::size_t> &range)
+            {
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                const SearchEngineData::HeapScope heap_scope;
+                for (auto segment = range.begin(); segment != range.end(); ++segment)
+                {
+                    const std::size_t begin = segment_begins[segment];
+                    const std::size_t end = segment + 1 < segment_begins.size()
+                                                ? segment_begins[segment + 1]
+                                                : candidates_list.size();
+                    const osrm::matching::CandidateLists segment_candidates(
+                        candidates_list.begin() + begin, candidates_list.begin() + end);
+                    const std::vector<FixedPointCoordinate> segment_coordinates(
+                        trace_coordinates.begin() + begin, trace_coordinates.begin() + end);
+                    std::vector<unsigned> segment_timestamps;
+                    if (!trace_timestamps.empty())
+                    {
+                        segment_timestamps.assign(trace_timestamps.begin() + begin,
+                                                  trace_timestamps.begin() + end);
+                    }
+
+                    // the heaps of the searches are the thread local ones of the worker
+                    MatchTrace(segment_candidates, segment_coordinates, segment_timestamps,
+                               median_sample_time, matching_beta, gps_precision,
+                               segment_matchings[segment]);
+                    for (auto &matching : segment_matchings[segment])
+                    {
+                        for (auto &index : matching.indices)
+                        {
+                            index += begin;
+                        }
+                    }
+                }
+            });
+
+        for (auto &matchings : segment_matchings)
+        {
+            std::move(matchings.begin(), matchings.end(), std::back_inserter(sub_matchings));
+        }
+    }
+
+  private:
+    // Returns the first index of each segment of the trace that no matching can span: the
+    // points with candidates on both sides of a split are further apart in time than a broken
+    // matching is kept alive, or in samples if there are no timestamps.
+    std::vector<std::size_t> SplitTrace(const osrm::matching::CandidateLists &candidates_list,
+                                        const std::vector<unsigned> &trace_timestamps,
+                                        const unsigned median_sample_time) const
+    {
+        const auto max_broken_time = median_sample_time * osrm::matching::MAX_BROKEN_STATES;
+
+        std::vector<std::size_t> segment_begins(1, 0);
+        std::size_t last_located = osrm::matching::INVALID_STATE;
+        for (const auto t : osrm::irange<std::size_t>(0u, candidates_list.size()))
+        {
+            if (candidates_list[t].empty())
+            {
+                continue;
+            }
+            if (last_located != osrm::matching::INVALID_STATE)
+            {
+                const bool split =
+                    trace_timestamps.empty()
+                        ? t - last_located > osrm::matching::MAX_BROKEN_STATES
+                        : trace_timestamps[t] - trace_timestamps[last_located] > max_broken_time;
+                if (split)
+                {
+                    segment_begins.push_back(t);
+                }
+            }
+            last_located = t;
+        }
+        return segment_begins;
+    }
+
+    // sequential viterbi over the whole trace, it is split wherever the matching breaks
+    void MatchTrace(const osrm::matching::CandidateLists &candidates_list,
+                    const std::vector<FixedPointCoordinate> &trace_coordinates,
+                    const std::vector<unsigned> &trace_timestamps,
+                    const unsigned median_sample_time,
+                    const double matching_beta,
+                    const double gps_precision,
+                    osrm::matching::SubMatchingList &sub_matchings) const
+    {
         const auto max_broken_time = median_sample_time * osrm::matching::MAX_BROKEN_STATES;
         const auto max_distance_delta = [&]() {
             if (trace_timestamps.size() > 1)
@@ -144,11 +289,13 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
         MatchingDebugInfo matching_debug(osrm::json::Logger::get());
         matching_debug.initialize(candidates_list);
 
-        engine_working_data.InitializeOrClearFirstThreadLocalStorage(
-            super::facade->GetNumberOfNodes());
-
-        QueryHeap &forward_heap = *(engine_working_data.forward_heap_1);
-        QueryHeap &reverse_heap = *(engine_working_data.reverse_heap_1);
+        // the transitions of a step are searched one-to-many, from every candidate of the
+        // previous step against buckets of all candidates of the current one
+        const ManyToManyRouting<DataFacadeT> many_to_many(super::facade, engine_working_data);
+        PhantomNodeArray target_phantom_nodes;
+        std::vector<EdgeWeight> transition_weights;
+        std::vector<NodeID> middle_nodes;
+        std::vector<NodeID> packed_leg;
 
         std::size_t breakage_begin = osrm::matching::INVALID_STATE;
         std::vector<std::size_t> split_points;
@@ -157,6 +304,7 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
         prev_unbroken_timestamps.push_back(initial_timestamp);
         for (auto t = initial_timestamp + 1; t < candidates_list.size(); ++t)
         {
+            osrm::cancellation::Check();
             // breakage recover has removed all previous good points
             bool trace_split = prev_unbroken_timestamps.empty();
 
@@ -204,48 +352,99 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
             BOOST_ASSERT(!prev_unbroken_timestamps.empty());
             const std::size_t prev_unbroken_timestamp = prev_unbroken_timestamps.back();
 
-            const auto &prev_viterbi = model.viterbi[prev_unbroken_timestamp];
-            const auto &prev_pruned = model.pruned[prev_unbroken_timestamp];
+            const auto prev_offset = model.offsets[prev_unbroken_timestamp];
             const auto &prev_unbroken_timestamps_list = candidates_list[prev_unbroken_timestamp];
             const auto &prev_coordinate = trace_coordinates[prev_unbroken_timestamp];
 
-            auto &current_viterbi = model.viterbi[t];
-            auto &current_pruned = model.pruned[t];
-            auto &current_suspicious = model.suspicious[t];
-            auto &current_parents = model.parents[t];
-            auto &current_lengths = model.path_lengths[t];
+            const auto current_offset = model.offsets[t];
             const auto &current_timestamps_list = candidates_list[t];
             const auto &current_coordinate = trace_coordinates[t];
 
             const auto great_circle_distance = coordinate_calculation::great_circle_distance(prev_coordinate, current_coordinate);
 
+            // a transition is pruned if its length exceeds the great circle distance by
+            // max_distance_delta, its weight is bounded by covering that at the lowest speed
+            const double max_transition_weight =
+                (great_circle_distance + max_distance_delta) /
+                osrm::matching::MIN_TRANSITION_SPEED * 10.;
+            const EdgeWeight max_weight = max_transition_weight < INVALID_EDGE_WEIGHT
+                                              ? static_cast<EdgeWeight>(max_transition_weight)
+                                              : INVALID_EDGE_WEIGHT;
+
+            target_phantom_nodes.resize(current_timestamps_list.size());
+            for (const auto s_prime : osrm::irange<std::size_t>(0u, current_timestamps_list.size()))
+            {
+                target_phantom_nodes[s_prime].assign(1, current_timestamps_list[s_prime].first);
+            }
+            // the sources start at their negated offsets, see ManyToManyRouting::ComputeTable
+            EdgeWeight backward_max_weight = max_weight;
+            if (INVALID_EDGE_WEIGHT != max_weight)
+            {
+                EdgeWeight max_source_offset = 0;
+                for (const auto &candidate : prev_unbroken_timestamps_list)
+                {
+                    const PhantomNode &phantom_node = candidate.first;
+                    if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                    {
+                        max_source_offset = std::max(max_source_offset,
+                                                     phantom_node.GetForwardWeightPlusOffset());
+                    }
+                    if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                    {
+                        max_source_offset = std::max(max_source_offset,
+                                                     phantom_node.GetReverseWeightPlusOffset());
+                    }
+                }
+                backward_max_weight = max_weight > INVALID_EDGE_WEIGHT - max_source_offset
+                                          ? INVALID_EDGE_WEIGHT
+                                          : max_weight + max_source_offset;
+            }
+            const auto target_buckets =
+                many_to_many.BuildTargetBuckets(target_phantom_nodes, backward_max_weight);
+            engine_working_data.InitializeOrClearFirstThreadLocalStorage(
+                super::facade->GetNumberOfNodes());
+            QueryHeap &forward_heap = *(engine_working_data.forward_heap_1);
+
             // compute d_t for this timestamp and the next one
-            for (const auto s : osrm::irange<std::size_t>(0u, prev_viterbi.size()))
+            for (const auto s : osrm::irange<std::size_t>(0u, prev_unbroken_timestamps_list.size()))
             {
-                if (prev_pruned[s])
+                if (model.pruned[prev_offset + s])
                 {
                     continue;
                 }
+                const double prev_viterbi = model.viterbi[prev_offset + s];
 
-                for (const auto s_prime : osrm::irange<std::size_t>(0u, current_viterbi.size()))
+                transition_weights.assign(current_timestamps_list.size(), INVALID_EDGE_WEIGHT);
+                middle_nodes.assign(current_timestamps_list.size(), SPECIAL_NODEID);
+                many_to_many.ForwardSearch(std::vector<PhantomNode>(
+                                               1, prev_unbroken_timestamps_list[s].first),
+                                           forward_heap, target_buckets,
+                                           transition_weights.data(), middle_nodes.data(),
+                                           nullptr, max_weight);
+
+                for (const auto s_prime : osrm::irange<std::size_t>(0u, current_timestamps_list.size()))
                 {
+                    const auto current_state = current_offset + s_prime;
                     // how likely is candidate s_prime at time t to be emitted?
-                    // FIXME this can be pre-computed
-                    const double emission_pr =
-                        emission_log_probability(candidates_list[t][s_prime].second);
-                    double new_value = prev_viterbi[s] + emission_pr;
-                    if (current_viterbi[s_prime] > new_value)
+                    const double emission_pr = model.emissions[current_state];
+                    double new_value = prev_viterbi + emission_pr;
+                    if (model.viterbi[current_state] > new_value)
                     {
                         continue;
                     }
 
-                    forward_heap.Clear();
-                    reverse_heap.Clear();
-
                     // get distance diff between loc1/2 and locs/s_prime
-                    const auto network_distance = super::get_network_distance(
-                        forward_heap, reverse_heap, prev_unbroken_timestamps_list[s].first,
-                        current_timestamps_list[s_prime].first);
+                    auto network_distance = std::numeric_limits<double>::max();
+                    if (INVALID_EDGE_WEIGHT != transition_weights[s_prime])
+                    {
+                        packed_leg.clear();
+                        many_to_many.RetrievePackedPathToTarget(forward_heap, target_buckets,
+                                                                middle_nodes[s_prime],
+                                                                s_prime, packed_leg);
+                        network_distance = super::GetPathLength(
+                            packed_leg, prev_unbroken_timestamps_list[s].first,
+                            current_timestamps_list[s_prime].first);
+                    }
 
                     const auto d_t = std::abs(network_distance - great_circle_distance);
 
@@ -259,16 +458,18 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
                     new_value += transition_pr;
 
                     matching_debug.add_transition_info(prev_unbroken_timestamp, t, s, s_prime,
-                                                       prev_viterbi[s], emission_pr, transition_pr,
+                                                       prev_viterbi, emission_pr, transition_pr,
                                                        network_distance, great_circle_distance);
 
-                    if (new_value > current_viterbi[s_prime])
+                    if (new_value > model.viterbi[current_state])
                     {
-                        current_viterbi[s_prime] = new_value;
-                        current_parents[s_prime] = std::make_pair(prev_unbroken_timestamp, s);
-                        current_lengths[s_prime] = network_distance;
-                        current_pruned[s_prime] = false;
-                        current_suspicious[s_prime] = d_t > osrm::matching::SUSPICIOUS_DISTANCE_DELTA;
+                        model.viterbi[current_state] = new_value;
+                        model.parents[current_state] = std::make_pair(prev_unbroken_timestamp, s);
+                        model.path_lengths[current_state] = network_distance;
+                        model.packed_paths[current_state] = packed_leg;
+                        model.pruned[current_state] = false;
+                        model.suspicious[current_state] =
+                            d_t > osrm::matching::SUSPICIOUS_DISTANCE_DELTA;
                         model.breakage[t] = false;
                     }
                 }
@@ -288,11 +489,12 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
             }
             else
             {
+                model.prune(t, osrm::matching::MAX_ACTIVE_STATES);
                 prev_unbroken_timestamps.push_back(t);
             }
         }
 
-        matching_debug.set_viterbi(model.viterbi, model.pruned, model.suspicious);
+        matching_debug.set_viterbi(model);
 
         if (!prev_unbroken_timestamps.empty())
         {
@@ -324,12 +526,11 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
             }
 
             // loop through the columns, and only compare the last entry
-            const auto max_element_iter =
-                std::max_element(model.viterbi[parent_timestamp_index].begin(),
-                                 model.viterbi[parent_timestamp_index].end());
+            const auto column_begin = model.viterbi.begin() + model.offsets[parent_timestamp_index];
+            const auto max_element_iter = std::max_element(
+                column_begin, model.viterbi.begin() + model.offsets[parent_timestamp_index + 1]);
 
-            std::size_t parent_candidate_index =
-                std::distance(model.viterbi[parent_timestamp_index].begin(), max_element_iter);
+            std::size_t parent_candidate_index = std::distance(column_begin, max_element_iter);
 
             std::deque<std::pair<std::size_t, std::size_t>> reconstructed_indices;
             while (parent_timestamp_index > sub_matching_begin)
@@ -340,7 +541,8 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
                 }
 
                 reconstructed_indices.emplace_front(parent_timestamp_index, parent_candidate_index);
-                const auto &next = model.parents[parent_timestamp_index][parent_candidate_index];
+                const auto &next =
+                    model.parents[model.state(parent_timestamp_index, parent_candidate_index)];
                 // make sure we can never get stuck in this loop
                 if (parent_timestamp_index == next.first)
                 {
@@ -359,6 +561,7 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
             matching.length = 0.0f;
             matching.nodes.resize(reconstructed_indices.size());
             matching.indices.resize(reconstructed_indices.size());
+            matching.packed_paths.resize(reconstructed_indices.size() - 1);
             for (const auto i : osrm::irange<std::size_t>(0u, reconstructed_indices.size()))
             {
                 const auto timestamp_index = reconstructed_indices[i].first;
@@ -366,7 +569,12 @@ class MapMatching final : public BasicRoutingInterface<DataFacadeT, MapMatching<
 
                 matching.indices[i] = timestamp_index;
                 matching.nodes[i] = candidates_list[timestamp_index][location_index].first;
-                matching.length += model.path_lengths[timestamp_index][location_index];
+                const auto state = model.state(timestamp_index, location_index);
+                matching.length += model.path_lengths[state];
+                if (i > 0)
+                {
+                    matching.packed_paths[i - 1] = std::move(model.packed_paths[state]);
+                }
 
                 matching_debug.add_chosen(timestamp_index, location_index);
             }
@@ -0,0 +1,391 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ONLINE_MAP_MATCHING_HPP
+#define ONLINE_MAP_MATCHING_HPP
+
+#include "many_to_many.hpp"
+#include "map_matching.hpp"
+#include "routing_base.hpp"
+#include "../algorithms/coordinate_calculation.hpp"
+#include "../data_structures/hidden_markov_model.hpp"
+#include "../data_structures/search_engine_data.hpp"
+#include "../util/integer_range.hpp"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace osrm
+{
+namespace matching
+{
+// points that are kept unconfirmed before the best state is confirmed without consensus
+constexpr static const unsigned MAX_PENDING_POINTS = 32;
+
+// The state of a trace that is matched point by point. It keeps the Viterbi frontier and all
+// points whose match is not confirmed yet, a point is confirmed once the paths of all states
+// of the last point run through the same candidate of it.
+struct MatchingSession
+{
+    struct Point
+    {
+        CandidateList candidates;
+        FixedPointCoordinate coordinate;
+        unsigned timestamp;
+        // position in the trace of the session, counting dropped points
+        unsigned index;
+        // IMPOSSIBLE_LOG_PROB for pruned states
+        std::vector<double> viterbi;
+        // candidate of the previous point on the best path to each state
+        std::vector<unsigned> parents;
+        // length and packed path of the transition from the parent
+        std::vector<float> path_lengths;
+        std::vector<std::vector<NodeID>> packed_paths;
+    };
+
+    MatchingSession() : next_index(0), broken_points(0), check_sum(0) {}
+
+    // the first point is the last confirmed one, or the first of the trace
+    std::deque<Point> points;
+    unsigned next_index;
+    // consecutive points that could not be reached from the frontier and were dropped
+    unsigned broken_points;
+    // of the dataset the candidates belong to
+    unsigned check_sum;
+    std::chrono::steady_clock::time_point last_use;
+    // requests of one session are matched one after the other
+    std::mutex mutex;
+};
+}
+}
+
+// Online version of the hidden markov model map matching, see map_matching.hpp. Every point is
+// added to the Viterbi frontier of its session with one one-to-many search per candidate of the
+// previous point, independent of the length of the trace.
+template <class DataFacadeT>
+class OnlineMapMatching final
+    : public BasicRoutingInterface<DataFacadeT, OnlineMapMatching<DataFacadeT>>
+{
+    using super = BasicRoutingInterface<DataFacadeT, OnlineMapMatching<DataFacadeT>>;
+    using QueryHeap = SearchEngineData::QueryHeap;
+    using Session = osrm::matching::MatchingSession;
+    SearchEngineData &engine_working_data;
+
+  public:
+    OnlineMapMatching(DataFacadeT *facade, SearchEngineData &engine_working_data)
+        : super(facade), engine_working_data(engine_working_data)
+    {
+    }
+
+    // Adds a point to the session and appends the points that got confirmed by it. Consecutive
+    // matchings share their boundary point, so that each of them can be routed on its own. A
+    // timestamp of 0 means the trace has none.
+    void operator()(Session &session,
+                    const osrm::matching::CandidateList &candidates,
+                    const FixedPointCoordinate &coordinate,
+                    const unsigned timestamp,
+                    const double matching_beta,
+                    const double gps_precision,
+                    osrm::matching::SubMatchingList &sub_matchings) const
+    {
+        const EmissionLogProbability emission_log_probability(gps_precision);
+        const TransitionLogProbability transition_log_probability(matching_beta);
+
+        Session::Point point;
+        point.candidates = candidates;
+        point.coordinate = coordinate;
+        point.timestamp = timestamp;
+        point.index = session.next_index++;
+        point.parents.resize(candidates.size(), 0);
+        point.path_lengths.resize(candidates.size(), 0);
+        point.packed_paths.resize(candidates.size());
+        std::vector<double> emissions;
+        emissions.reserve(candidates.size());
+        for (const auto &candidate : candidates)
+        {
+            emissions.push_back(emission_log_probability(candidate.second));
+        }
+        point.viterbi = emissions;
+        PruneStates(point);
+
+        if (session.points.empty())
+        {
+            if (HasState(point))
+            {
+                session.points.push_back(std::move(point));
+            }
+            return;
+        }
+
+        ComputeTransitions(session.points.back(), point, emissions, transition_log_probability);
+        PruneStates(point);
+        if (!HasState(point))
+        {
+            if (++session.broken_points <= osrm::matching::MAX_BROKEN_STATES)
+            {
+                return;
+            }
+            // the vehicle left the frontier behind, finish the pending points and start over
+            ConfirmBestPath(session, session.points.size() - 1, sub_matchings);
+            session.points.clear();
+            session.broken_points = 0;
+            point.viterbi = emissions;
+            PruneStates(point);
+            if (HasState(point))
+            {
+                session.points.push_back(std::move(point));
+            }
+            return;
+        }
+        session.broken_points = 0;
+        session.points.push_back(std::move(point));
+
+        unsigned converged_state = 0;
+        const std::size_t converged_point = FindConvergedPoint(session, converged_state);
+        if (0 < converged_point)
+        {
+            ConfirmFirstPoints(session, converged_point, converged_state, sub_matchings);
+        }
+        else if (session.points.size() > osrm::matching::MAX_PENDING_POINTS)
+        {
+            ConfirmBestPath(session, session.points.size() - osrm::matching::MAX_PENDING_POINTS,
+                            sub_matchings);
+        }
+    }
+
+  private:
+    static bool HasState(const Session::Point &point)
+    {
+        return std::any_of(point.viterbi.begin(), point.viterbi.end(), [](const double value)
+                           {
+                               return value > osrm::matching::IMPOSSIBLE_LOG_PROB;
+                           });
+    }
+
+    // Prunes all but the most likely states of point
+    static void PruneStates(Session::Point &point)
+    {
+        const auto threshold = beam_threshold(point.viterbi.begin(), point.viterbi.end(),
+                                              osrm::matching::MAX_ACTIVE_STATES);
+        for (auto &value : point.viterbi)
+        {
+            if (value < threshold)
+            {
+                value = osrm::matching::IMPOSSIBLE_LOG_PROB;
+            }
+        }
+    }
+
+    // Extends the emissions of point by the best transition from previous
+    void ComputeTransitions(const Session::Point &previous,
+                            Session::Point &point,
+                            const std::vector<double> &emissions,
+                            const TransitionLogProbability &transition_log_probability) const
+    {
+        const auto great_circle_distance =
+            coordinate_calculation::great_circle_distance(previous.coordinate, point.coordinate);
+        auto max_distance_delta = std::numeric_limits<double>::max();
+        if (0 != point.timestamp && point.timestamp > previous.timestamp)
+        {
+            max_distance_delta =
+                (point.timestamp - previous.timestamp) * osrm::matching::MAX_SPEED;
+        }
+
+        const ManyToManyRouting<DataFacadeT> many_to_many(super::facade, engine_working_data);
+        PhantomNodeArray target_phantom_nodes(point.candidates.size());
+        for (const auto s_prime : osrm::irange<std::size_t>(0u, point.candidates.size()))
+        {
+            target_phantom_nodes[s_prime].assign(1, point.candidates[s_prime].first);
+        }
+        const auto target_buckets = many_to_many.BuildTargetBuckets(target_phantom_nodes);
+        engine_working_data.InitializeOrClearFirstThreadLocalStorage(
+            super::facade->GetNumberOfNodes());
+        QueryHeap &forward_heap = *(engine_working_data.forward_heap_1);
+
+        std::fill(point.viterbi.begin(), point.viterbi.end(),
+                  osrm::matching::IMPOSSIBLE_LOG_PROB);
+        std::vector<EdgeWeight> transition_weights;
+        std::vector<NodeID> middle_nodes;
+        std::vector<NodeID> packed_leg;
+        for (const auto s : osrm::irange<std::size_t>(0u, previous.candidates.size()))
+        {
+            if (previous.viterbi[s] == osrm::matching::IMPOSSIBLE_LOG_PROB)
+            {
+                continue;
+            }
+
+            transition_weights.assign(point.candidates.size(), INVALID_EDGE_WEIGHT);
+            middle_nodes.assign(point.candidates.size(), SPECIAL_NODEID);
+            many_to_many.ForwardSearch(std::vector<PhantomNode>(1, previous.candidates[s].first),
+                                       forward_heap, target_buckets, transition_weights.data(),
+                                       middle_nodes.data());
+
+            for (const auto s_prime : osrm::irange<std::size_t>(0u, point.candidates.size()))
+            {
+                double new_value = previous.viterbi[s] + emissions[s_prime];
+                if (INVALID_EDGE_WEIGHT == transition_weights[s_prime] ||
+                    point.viterbi[s_prime] > new_value)
+                {
+                    continue;
+                }
+
+                packed_leg.clear();
+                many_to_many.RetrievePackedPathToTarget(forward_heap, target_buckets,
+                                                        middle_nodes[s_prime], s_prime,
+                                                        packed_leg);
+                const auto network_distance = super::GetPathLength(
+                    packed_leg, previous.candidates[s].first, point.candidates[s_prime].first);
+                const auto d_t = std::abs(network_distance - great_circle_distance);
+                if (d_t >= max_distance_delta)
+                {
+                    continue;
+                }
+
+                new_value += transition_log_probability(d_t);
+                if (new_value > point.viterbi[s_prime])
+                {
+                    point.viterbi[s_prime] = new_value;
+                    point.parents[s_prime] = static_cast<unsigned>(s);
+                    point.path_lengths[s_prime] = static_cast<float>(network_distance);
+                    point.packed_paths[s_prime] = packed_leg;
+                }
+            }
+        }
+    }
+
+    // The last point whose candidate is shared by the paths of all states of the last point
+    static std::size_t FindConvergedPoint(const Session &session, unsigned &converged_state)
+    {
+        const Session::Point &last_point = session.points.back();
+        std::vector<unsigned> states;
+        for (const auto s : osrm::irange<std::size_t>(0u, last_point.viterbi.size()))
+        {
+            if (last_point.viterbi[s] > osrm::matching::IMPOSSIBLE_LOG_PROB)
+            {
+                states.push_back(static_cast<unsigned>(s));
+            }
+        }
+
+        std::size_t position = session.points.size() - 1;
+        while (states.size() > 1 && position > 0)
+        {
+            for (auto &state : states)
+            {
+                state = session.points[position].parents[state];
+            }
+            std::sort(states.begin(), states.end());
+            states.erase(std::unique(states.begin(), states.end()), states.end());
+            --position;
+        }
+        if (states.size() != 1)
+        {
+            return 0;
+        }
+        converged_state = states.front();
+        return position;
+    }
+
+    // Confirms the best state of the last point up to the given point and drops every state
+    // whose path does not run through it
+    static void ConfirmBestPath(Session &session,
+                                const std::size_t position,
+                                osrm::matching::SubMatchingList &sub_matchings)
+    {
+        const auto &last_viterbi = session.points.back().viterbi;
+        unsigned state = static_cast<unsigned>(std::distance(
+            last_viterbi.begin(), std::max_element(last_viterbi.begin(), last_viterbi.end())));
+        for (std::size_t i = session.points.size() - 1; i > position; --i)
+        {
+            state = session.points[i].parents[state];
+        }
+        ConfirmFirstPoints(session, position, state, sub_matchings);
+        for (const auto i : osrm::irange<std::size_t>(1, session.points.size()))
+        {
+            const Session::Point &previous = session.points[i - 1];
+            Session::Point &point = session.points[i];
+            for (const auto s : osrm::irange<std::size_t>(0u, point.viterbi.size()))
+            {
+                if (previous.viterbi[point.parents[s]] == osrm::matching::IMPOSSIBLE_LOG_PROB)
+                {
+                    point.viterbi[s] = osrm::matching::IMPOSSIBLE_LOG_PROB;
+                }
+            }
+        }
+    }
+
+    // Emits the points up to the given one, whose state all paths of the frontier run through,
+    // and keeps it as the first point of the session
+    static void ConfirmFirstPoints(Session &session,
+                                   const std::size_t position,
+                                   const unsigned confirmed_state,
+                                   osrm::matching::SubMatchingList &sub_matchings)
+    {
+        BOOST_ASSERT(position < session.points.size());
+        unsigned state = confirmed_state;
+        if (position > 0)
+        {
+            osrm::matching::SubMatching matching;
+            matching.length = 0;
+            matching.confidence = 0;
+            matching.nodes.resize(position + 1);
+            matching.indices.resize(position + 1);
+            matching.packed_paths.resize(position);
+            for (std::size_t i = position + 1; i > 0; --i)
+            {
+                Session::Point &point = session.points[i - 1];
+                matching.nodes[i - 1] = point.candidates[state].first;
+                matching.indices[i - 1] = point.index;
+                if (i > 1)
+                {
+                    matching.length += point.path_lengths[state];
+                    matching.packed_paths[i - 2] = std::move(point.packed_paths[state]);
+                    state = point.parents[state];
+                }
+            }
+            sub_matchings.push_back(std::move(matching));
+        }
+
+        session.points.erase(session.points.begin(), session.points.begin() + position);
+        auto &first_viterbi = session.points.front().viterbi;
+        for (const auto s : osrm::irange<std::size_t>(0u, first_viterbi.size()))
+        {
+            if (s != confirmed_state)
+            {
+                first_viterbi[s] = osrm::matching::IMPOSSIBLE_LOG_PROB;
+            }
+        }
+    }
+};
+
+#endif // ONLINE_MAP_MATCHING_HPP
@@ -28,14 +28,20 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef ROUTING_BASE_HPP
 #define ROUTING_BASE_HPP
 
+#include "stalling.hpp"
 #include "../algorithms/coordinate_calculation.hpp"
 #include "../data_structures/internal_route_result.hpp"
 #include "../data_structures/search_engine_data.hpp"
+#include "../data_structures/shortcut_cache.hpp"
 #include "../data_structures/turn_instructions.hpp"
+#include "../util/memory_budget.hpp"
+#include "../util/query_cancellation.hpp"
+#include "../util/search_statistics.hpp"
 // #include "../util/simple_logger.hpp"
 
 #include <boost/assert.hpp>
 
+#include <algorithm>
 #include <stack>
 
 SearchEngineData::SearchEngineHeapPtr SearchEngineData::forward_heap_1;
@@ -44,6 +50,7 @@ SearchEngineData::SearchEngineHeapPtr SearchEngineData::forward_heap_2;
 SearchEngineData::SearchEngineHeapPtr SearchEngineData::reverse_heap_2;
 SearchEngineData::SearchEngineHeapPtr SearchEngineData::forward_heap_3;
 SearchEngineData::SearchEngineHeapPtr SearchEngineData::reverse_heap_3;
+SearchEngineData::UnpackingDataPtr SearchEngineData::unpacking_data;
 
 template <class DataFacadeT, class Derived> class BasicRoutingInterface
 {
@@ -51,6 +58,9 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
     using EdgeData = typename DataFacadeT::EdgeData;
 
   protected:
+    // counts the work of the searches for the debug output, a no-op in release builds
+    using SearchStatistics = osrm::search_statistics::Policy;
+
     DataFacadeT *facade;
 
   public:
@@ -59,74 +69,143 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
     explicit BasicRoutingInterface(DataFacadeT *facade) : facade(facade) {}
     ~BasicRoutingInterface() {}
 
+    // Interleaves the forward and the reverse search until both heaps are empty. The kernel is
+    // picked once per search, so that the steps themselves test no runtime flags.
+    void BidirectionalSearch(SearchEngineData::QueryHeap &forward_heap,
+                             SearchEngineData::QueryHeap &reverse_heap,
+                             NodeID *middle_node_id,
+                             int *upper_bound,
+                             const int min_edge_offset) const
+    {
+        if (SearchEngineData::prefetch_search_graph)
+        {
+            BidirectionalSearch<true>(forward_heap, reverse_heap, middle_node_id, upper_bound,
+                                      min_edge_offset);
+        }
+        else
+        {
+            BidirectionalSearch<false>(forward_heap, reverse_heap, middle_node_id, upper_bound,
+                                       min_edge_offset);
+        }
+    }
+
+    template <bool prefetch>
+    void BidirectionalSearch(SearchEngineData::QueryHeap &forward_heap,
+                             SearchEngineData::QueryHeap &reverse_heap,
+                             NodeID *middle_node_id,
+                             int *upper_bound,
+                             const int min_edge_offset) const
+    {
+        while (0 < (forward_heap.Size() + reverse_heap.Size()))
+        {
+            if (!forward_heap.Empty())
+            {
+                RoutingStep<true, prefetch>(forward_heap, reverse_heap, middle_node_id,
+                                            upper_bound, min_edge_offset);
+            }
+            if (!reverse_heap.Empty())
+            {
+                RoutingStep<false, prefetch>(reverse_heap, forward_heap, middle_node_id,
+                                             upper_bound, min_edge_offset);
+            }
+        }
+    }
+
+    // Runs one direction until its heap is empty, meeting the settled nodes of the other heap
+    template <bool forward_direction>
+    void UnidirectionalSearch(SearchEngineData::QueryHeap &heap,
+                              SearchEngineData::QueryHeap &other_heap,
+                              NodeID *middle_node_id,
+                              int *upper_bound,
+                              const int min_edge_offset) const
+    {
+        if (SearchEngineData::prefetch_search_graph)
+        {
+            while (!heap.Empty())
+            {
+                RoutingStep<forward_direction, true>(heap, other_heap, middle_node_id,
+                                                     upper_bound, min_edge_offset);
+            }
+        }
+        else
+        {
+            while (!heap.Empty())
+            {
+                RoutingStep<forward_direction, false>(heap, other_heap, middle_node_id,
+                                                      upper_bound, min_edge_offset);
+            }
+        }
+    }
+
+    // The direction and the prefetching are template parameters. Searches dispatch to the
+    // instantiation once, see BidirectionalSearch.
+    template <bool forward_direction, bool prefetch>
     void RoutingStep(SearchEngineData::QueryHeap &forward_heap,
                      SearchEngineData::QueryHeap &reverse_heap,
                      NodeID *middle_node_id,
                      int *upper_bound,
-                     const int min_edge_offset,
-                     const bool forward_direction) const
+                     const int min_edge_offset) const
     {
+        osrm::cancellation::Poll();
         const NodeID node = forward_heap.DeleteMin();
+        SearchStatistics::Settle();
+        if (prefetch)
+        {
+            PrefetchSearchStep(forward_heap, node);
+        }
         const int distance = forward_heap.GetKey(node);
 
-        // const NodeID parentnode = forward_heap.GetData(node).parent;
-        // SimpleLogger().Write() << (forward_direction ? "[fwd] " : "[rev] ") << "settled edge ("
-        // << parentnode << "," << node << "), dist: " << distance;
-
         if (reverse_heap.WasInserted(node))
         {
             const int new_distance = reverse_heap.GetKey(node) + distance;
-            if (new_distance < *upper_bound)
+            if (new_distance < *upper_bound && new_distance >= 0)
             {
-                if (new_distance >= 0)
-                {
-                    *middle_node_id = node;
-                    *upper_bound = new_distance;
-                    //     SimpleLogger().Write() << "accepted middle node " << node << " at
-                    //     distance " << new_distance;
-                    // } else {
-                    //     SimpleLogger().Write() << "discared middle node " << node << " at
-                    //     distance " << new_distance;
-                }
+                *middle_node_id = node;
+                *upper_bound = new_distance;
             }
         }
 
         if (distance + min_edge_offset > *upper_bound)
         {
-            // SimpleLogger().Write() << "min_edge_offset: " << min_edge_offset;
             forward_heap.DeleteAll();
             return;
         }
 
-        // Stalling
-        for (const auto edge : facade->GetAdjacentEdgeRange(node))
+        if (CHStallingPolicy::Stall<forward_direction>(*facade, forward_heap, node, distance))
         {
-            const EdgeData &data = facade->GetEdgeData(edge);
-            const bool reverse_flag = ((!forward_direction) ? data.forward : data.backward);
-            if (reverse_flag)
-            {
-                const NodeID to = facade->GetTarget(edge);
-                const int edge_weight = data.distance;
+            SearchStatistics::Stall();
+            return;
+        }
 
-                BOOST_ASSERT_MSG(edge_weight > 0, "edge_weight invalid");
+        RelaxOutgoingEdges<forward_direction>(forward_heap, node, distance);
+    }
 
-                if (forward_heap.WasInserted(to))
-                {
-                    if (forward_heap.GetKey(to) + edge_weight < distance)
-                    {
-                        return;
-                    }
-                }
-            }
+    // Issues the loads of the step that settles node ahead of their use: the heap slots of its
+    // targets, read by the stalling and the relaxation, and the edges of the node that is likely
+    // settled next. The edges of node itself were prefetched by the previous step.
+    void PrefetchSearchStep(const SearchEngineData::QueryHeap &heap, const NodeID node) const
+    {
+        for (const auto edge : facade->GetAdjacentEdgeRange(node))
+        {
+            heap.Prefetch(facade->GetTarget(edge));
+        }
+        if (!heap.Empty())
+        {
+            facade->PrefetchAdjacentEdges(heap.Min());
         }
+    }
 
+    template <bool forward_direction>
+    void RelaxOutgoingEdges(SearchEngineData::QueryHeap &forward_heap,
+                            const NodeID node,
+                            const int distance) const
+    {
         for (const auto edge : facade->GetAdjacentEdgeRange(node))
         {
             const EdgeData &data = facade->GetEdgeData(edge);
-            bool forward_directionFlag = (forward_direction ? data.forward : data.backward);
-            if (forward_directionFlag)
+            if (forward_direction ? data.forward : data.backward)
             {
-
+                SearchStatistics::Relax();
                 const NodeID to = facade->GetTarget(edge);
                 const int edge_weight = data.distance;
 
@@ -137,6 +216,7 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
                 if (!forward_heap.WasInserted(to))
                 {
                     forward_heap.Insert(to, to_distance, node);
+                    SearchStatistics::Push();
                 }
                 // Found a shorter Path -> Update distance
                 else if (to_distance < forward_heap.GetKey(to))
@@ -144,6 +224,7 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
                     // new parent
                     forward_heap.GetData(to).parent = node;
                     forward_heap.DecreaseKey(to, to_distance);
+                    CHStallingPolicy::Unstall(forward_heap, to);
                 }
             }
         }
@@ -158,118 +239,79 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
         const bool target_traversed_in_reverse =
             (packed_path.back() != phantom_node_pair.target_phantom.forward_node_id);
 
-        const unsigned packed_path_size = static_cast<unsigned>(packed_path.size());
-        std::stack<std::pair<NodeID, NodeID>> recursion_stack;
-
-        // We have to push the path in reverse order onto the stack because it's LIFO.
-        for (unsigned i = packed_path_size - 1; i > 0; --i)
+        auto &unpacked_edges = SearchEngineData::GetUnpackingThreadLocalStorage().unpacked_edges;
+        unpacked_edges.clear();
+        for (std::size_t i = 1; i < packed_path.size(); ++i)
         {
-            recursion_stack.emplace(packed_path[i - 1], packed_path[i]);
+            UnpackToOriginalEdges(packed_path[i - 1], packed_path[i], unpacked_edges);
         }
+        const std::size_t initial_size = unpacked_path.size();
+        unpacked_path.reserve(unpacked_path.size() + unpacked_edges.size());
 
-        std::pair<NodeID, NodeID> edge;
-        while (!recursion_stack.empty())
+        for (const auto &unpacked_edge : unpacked_edges)
         {
-            /*
-            Graphical representation of variables:
-
-            edge.first         edge.second
-                *------------------>*
-                       edge_id
-            */
-            edge = recursion_stack.top();
-            recursion_stack.pop();
-
-            // facade->FindEdge does not suffice here in case of shortcuts.
-            // The above explanation unclear? Think!
-            EdgeID smaller_edge_id = SPECIAL_EDGEID;
-            int edge_weight = std::numeric_limits<EdgeWeight>::max();
-            for (const auto edge_id : facade->GetAdjacentEdgeRange(edge.first))
-            {
-                const int weight = facade->GetEdgeData(edge_id).distance;
-                if ((facade->GetTarget(edge_id) == edge.second) && (weight < edge_weight) &&
-                    facade->GetEdgeData(edge_id).forward)
-                {
-                    smaller_edge_id = edge_id;
-                    edge_weight = weight;
-                }
-            }
-
-            /*
-                Graphical representation of variables:
+            const EdgeData &ed = facade->GetEdgeData(unpacked_edge.edge);
+            BOOST_ASSERT_MSG(!ed.shortcut, "original edge flagged as shortcut");
+            unsigned name_index = facade->GetNameIndexFromEdgeID(ed.id);
+            const TurnInstruction turn_instruction = facade->GetTurnInstructionForEdgeID(ed.id);
+            const TravelMode travel_mode = facade->GetTravelModeForEdgeID(ed.id);
 
-                edge.first         edge.second
-                    *<------------------*
-                           edge_id
-            */
-            if (SPECIAL_EDGEID == smaller_edge_id)
+            if (!facade->EdgeIsCompressed(ed.id))
             {
-                for (const auto edge_id : facade->GetAdjacentEdgeRange(edge.second))
-                {
-                    const int weight = facade->GetEdgeData(edge_id).distance;
-                    if ((facade->GetTarget(edge_id) == edge.first) && (weight < edge_weight) &&
-                        facade->GetEdgeData(edge_id).backward)
-                    {
-                        smaller_edge_id = edge_id;
-                        edge_weight = weight;
-                    }
-                }
-            }
-            BOOST_ASSERT_MSG(edge_weight != INVALID_EDGE_WEIGHT, "edge id invalid");
-
-            const EdgeData &ed = facade->GetEdgeData(smaller_edge_id);
-            if (ed.shortcut)
-            { // unpack
-                const NodeID middle_node_id = ed.id;
-                // again, we need to this in reversed order
-                recursion_stack.emplace(middle_node_id, edge.second);
-                recursion_stack.emplace(edge.first, middle_node_id);
+                BOOST_ASSERT(!facade->EdgeIsCompressed(ed.id));
+                unpacked_path.emplace_back(facade->GetGeometryIndexForEdgeID(ed.id), name_index,
+                                           turn_instruction, ed.distance, travel_mode);
             }
             else
             {
-                BOOST_ASSERT_MSG(!ed.shortcut, "original edge flagged as shortcut");
-                unsigned name_index = facade->GetNameIndexFromEdgeID(ed.id);
-                const TurnInstruction turn_instruction = facade->GetTurnInstructionForEdgeID(ed.id);
-                const TravelMode travel_mode = facade->GetTravelModeForEdgeID(ed.id);
-
-                if (!facade->EdgeIsCompressed(ed.id))
+                // read in place, this runs for every compressed edge on the path
+                const unsigned geometry_index = facade->GetGeometryIndexForEdgeID(ed.id);
+                const auto id_vector = facade->GetUncompressedGeometryRange(geometry_index);
+                const std::uint8_t *zoom_levels =
+                    facade->GetUncompressedGeometryZoomLevels(geometry_index);
+
+                const std::size_t start_index =
+                    (unpacked_path.empty()
+                         ? ((start_traversed_in_reverse)
+                                ? id_vector.size() -
+                                      phantom_node_pair.source_phantom.fwd_segment_position - 1
+                                : phantom_node_pair.source_phantom.fwd_segment_position)
+                         : 0);
+                const std::size_t end_index = id_vector.size();
+
+                BOOST_ASSERT(start_index >= 0);
+                BOOST_ASSERT(start_index <= end_index);
+                for (std::size_t i = start_index; i < end_index; ++i)
                 {
-                    BOOST_ASSERT(!facade->EdgeIsCompressed(ed.id));
-                    unpacked_path.emplace_back(facade->GetGeometryIndexForEdgeID(ed.id), name_index,
-                                               turn_instruction, ed.distance, travel_mode);
-                }
-                else
-                {
-                    std::vector<unsigned> id_vector;
-                    facade->GetUncompressedGeometry(facade->GetGeometryIndexForEdgeID(ed.id),
-                                                    id_vector);
-
-                    const std::size_t start_index =
-                        (unpacked_path.empty()
-                             ? ((start_traversed_in_reverse)
-                                    ? id_vector.size() -
-                                          phantom_node_pair.source_phantom.fwd_segment_position - 1
-                                    : phantom_node_pair.source_phantom.fwd_segment_position)
-                             : 0);
-                    const std::size_t end_index = id_vector.size();
-
-                    BOOST_ASSERT(start_index >= 0);
-                    BOOST_ASSERT(start_index <= end_index);
-                    for (std::size_t i = start_index; i < end_index; ++i)
-                    {
-                        unpacked_path.emplace_back(id_vector[i], name_index,
-                                                   TurnInstruction::NoTurn, 0, travel_mode);
-                    }
-                    unpacked_path.back().turn_instruction = turn_instruction;
-                    unpacked_path.back().segment_duration = ed.distance;
+                    unpacked_path.emplace_back(id_vector[i], name_index, TurnInstruction::NoTurn,
+                                               0, travel_mode,
+                                               nullptr == zoom_levels ? 0 : zoom_levels[i]);
                 }
+                unpacked_path.back().turn_instruction = turn_instruction;
+                unpacked_path.back().segment_duration = ed.distance;
             }
         }
         if (SPECIAL_EDGEID != phantom_node_pair.target_phantom.packed_geometry_id)
         {
-            std::vector<unsigned> id_vector;
-            facade->GetUncompressedGeometry(phantom_node_pair.target_phantom.packed_geometry_id,
-                                            id_vector);
+            // read in place, a reversed traversal reads the geometry back to front
+            const auto geometry = facade->GetUncompressedGeometryRange(
+                phantom_node_pair.target_phantom.packed_geometry_id);
+            const std::uint8_t *zoom_levels = facade->GetUncompressedGeometryZoomLevels(
+                phantom_node_pair.target_phantom.packed_geometry_id);
+            const std::size_t geometry_size = geometry.size();
+            const auto id_at = [&](const std::size_t i)
+            {
+                return target_traversed_in_reverse ? geometry[geometry_size - 1 - i] : geometry[i];
+            };
+            const auto zoom_level_at = [&](const std::size_t i) -> std::uint8_t
+            {
+                if (nullptr == zoom_levels)
+                {
+                    return 0;
+                }
+                return target_traversed_in_reverse ? zoom_levels[geometry_size - 1 - i]
+                                                   : zoom_levels[i];
+            };
             const bool is_local_path = (phantom_node_pair.source_phantom.packed_geometry_id ==
                                         phantom_node_pair.target_phantom.packed_geometry_id) &&
                                        unpacked_path.empty();
@@ -281,33 +323,32 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
                 if (target_traversed_in_reverse)
                 {
                     start_index =
-                        id_vector.size() - phantom_node_pair.source_phantom.fwd_segment_position;
+                        geometry_size - phantom_node_pair.source_phantom.fwd_segment_position;
                 }
             }
 
             std::size_t end_index = phantom_node_pair.target_phantom.fwd_segment_position;
             if (target_traversed_in_reverse)
             {
-                std::reverse(id_vector.begin(), id_vector.end());
-                end_index =
-                    id_vector.size() - phantom_node_pair.target_phantom.fwd_segment_position;
+                end_index = geometry_size - phantom_node_pair.target_phantom.fwd_segment_position;
             }
 
             if (start_index > end_index)
             {
-                start_index = std::min(start_index, id_vector.size() - 1);
+                start_index = std::min(start_index, geometry_size - 1);
             }
 
             for (std::size_t i = start_index; i != end_index; (start_index < end_index ? ++i : --i))
             {
-                BOOST_ASSERT(i < id_vector.size());
+                BOOST_ASSERT(i < geometry_size);
                 BOOST_ASSERT(phantom_node_pair.target_phantom.forward_travel_mode > 0);
                 unpacked_path.emplace_back(
-                    PathData{id_vector[i],
+                    PathData{id_at(i),
                              phantom_node_pair.target_phantom.name_id,
                              TurnInstruction::NoTurn,
                              0,
-                             phantom_node_pair.target_phantom.forward_travel_mode});
+                             phantom_node_pair.target_phantom.forward_travel_mode,
+                             zoom_level_at(i)});
             }
         }
 
@@ -330,63 +371,173 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
             }
             BOOST_ASSERT(!unpacked_path.empty());
         }
+        // the path is kept until the route is described
+        if (unpacked_path.size() > initial_size)
+        {
+            osrm::memory::Charge((unpacked_path.size() - initial_size) * sizeof(PathData));
+        }
     }
 
-    void UnpackEdge(const NodeID s, const NodeID t, std::vector<NodeID> &unpacked_path) const
+    // Length of a packed path in meters, summed from the lengths stored with the packed edges
+    // instead of unpacking the path. The partially traversed end nodes of the path are converted
+    // with the length per weight of their adjacent packed edge.
+    double ComputePackedPathLength(const std::vector<NodeID> &packed_path,
+                                   const PhantomNodes &phantom_node_pair) const
     {
-        std::stack<std::pair<NodeID, NodeID>> recursion_stack;
-        recursion_stack.emplace(s, t);
+        BOOST_ASSERT(!packed_path.empty());
+        if (packed_path.size() == 1)
+        {
+            return coordinate_calculation::great_circle_distance(
+                phantom_node_pair.source_phantom.location,
+                phantom_node_pair.target_phantom.location);
+        }
 
-        std::pair<NodeID, NodeID> edge;
-        while (!recursion_stack.empty())
+        const bool start_traversed_in_reverse =
+            (packed_path.front() != phantom_node_pair.source_phantom.forward_node_id);
+        const bool target_traversed_in_reverse =
+            (packed_path.back() != phantom_node_pair.target_phantom.forward_node_id);
+        const int source_weight =
+            start_traversed_in_reverse
+                ? phantom_node_pair.source_phantom.GetReverseWeightPlusOffset()
+                : phantom_node_pair.source_phantom.GetForwardWeightPlusOffset();
+        const int target_weight =
+            target_traversed_in_reverse
+                ? phantom_node_pair.target_phantom.GetReverseWeightPlusOffset()
+                : phantom_node_pair.target_phantom.GetForwardWeightPlusOffset();
+
+        // lengths are stored in decimeters
+        const auto length_per_weight = [](const EdgeData &data)
         {
-            edge = recursion_stack.top();
-            recursion_stack.pop();
+            return data.distance > 0 ? data.length / (10. * data.distance) : 0.;
+        };
 
-            EdgeID smaller_edge_id = SPECIAL_EDGEID;
-            int edge_weight = std::numeric_limits<EdgeWeight>::max();
-            for (const auto edge_id : facade->GetAdjacentEdgeRange(edge.first))
+        double length = 0.;
+        for (std::size_t i = 1; i < packed_path.size(); ++i)
+        {
+            bool traversed_in_reverse = false;
+            const EdgeID edge_id =
+                FindSmallestEdge(packed_path[i - 1], packed_path[i], traversed_in_reverse);
+            BOOST_ASSERT(SPECIAL_EDGEID != edge_id);
+            const EdgeData &data = facade->GetEdgeData(edge_id);
+            length += data.length / 10.;
+            if (1 == i)
             {
-                const int weight = facade->GetEdgeData(edge_id).distance;
-                if ((facade->GetTarget(edge_id) == edge.second) && (weight < edge_weight) &&
-                    facade->GetEdgeData(edge_id).forward)
-                {
-                    smaller_edge_id = edge_id;
-                    edge_weight = weight;
-                }
+                length -= source_weight * length_per_weight(data);
             }
-
-            if (SPECIAL_EDGEID == smaller_edge_id)
+            if (packed_path.size() - 1 == i)
             {
-                for (const auto edge_id : facade->GetAdjacentEdgeRange(edge.second))
-                {
-                    const int weight = facade->GetEdgeData(edge_id).distance;
-                    if ((facade->GetTarget(edge_id) == edge.first) && (weight < edge_weight) &&
-                        facade->GetEdgeData(edge_id).backward)
-                    {
-                        smaller_edge_id = edge_id;
-                        edge_weight = weight;
-                    }
-                }
+                length += target_weight * length_per_weight(data);
             }
-            BOOST_ASSERT_MSG(edge_weight != std::numeric_limits<EdgeWeight>::max(),
-                             "edge weight invalid");
+        }
+        return std::max(0., length);
+    }
+
+    void UnpackEdge(const NodeID s, const NodeID t, std::vector<NodeID> &unpacked_path) const
+    {
+        auto &unpacked_edges = SearchEngineData::GetUnpackingThreadLocalStorage().unpacked_edges;
+        unpacked_edges.clear();
+        UnpackToOriginalEdges(s, t, unpacked_edges);
+        for (const auto &unpacked_edge : unpacked_edges)
+        {
+            unpacked_path.emplace_back(unpacked_edge.from);
+        }
+        unpacked_path.emplace_back(t);
+    }
+
+    // Appends the original edges of the packed edge from s to t in path order. Shortcuts are
+    // looked up in the facade's shortcut cache first, and added to it once unpacked.
+    void UnpackToOriginalEdges(const NodeID s,
+                               const NodeID t,
+                               std::vector<ShortcutCache::UnpackedEdge> &unpacked_edges) const
+    {
+        bool traversed_in_reverse = false;
+        const EdgeID packed_edge_id = FindSmallestEdge(s, t, traversed_in_reverse);
+        if (!facade->GetEdgeData(packed_edge_id).shortcut)
+        {
+            unpacked_edges.push_back({s, packed_edge_id});
+            return;
+        }
+
+        ShortcutCache *shortcut_cache = facade->GetShortcutCache();
+        if (nullptr != shortcut_cache &&
+            shortcut_cache->Fetch(packed_edge_id, traversed_in_reverse, unpacked_edges))
+        {
+            return;
+        }
+
+        const std::size_t first_unpacked_edge = unpacked_edges.size();
+        auto &recursion_stack =
+            SearchEngineData::GetUnpackingThreadLocalStorage().recursion_stack;
+        recursion_stack.clear();
+        recursion_stack.emplace_back(s, t);
 
+        std::pair<NodeID, NodeID> edge;
+        while (!recursion_stack.empty())
+        {
+            edge = recursion_stack.back();
+            recursion_stack.pop_back();
+
+            bool is_reverse = false;
+            const EdgeID smaller_edge_id = FindSmallestEdge(edge.first, edge.second, is_reverse);
             const EdgeData &ed = facade->GetEdgeData(smaller_edge_id);
             if (ed.shortcut)
             { // unpack
+                SearchStatistics::UnpackShortcut();
                 const NodeID middle_node_id = ed.id;
                 // again, we need to this in reversed order
-                recursion_stack.emplace(middle_node_id, edge.second);
-                recursion_stack.emplace(edge.first, middle_node_id);
+                recursion_stack.emplace_back(middle_node_id, edge.second);
+                recursion_stack.emplace_back(edge.first, middle_node_id);
             }
             else
             {
-                BOOST_ASSERT_MSG(!ed.shortcut, "edge must be shortcut");
-                unpacked_path.emplace_back(edge.first);
+                unpacked_edges.push_back({edge.first, smaller_edge_id});
             }
         }
-        unpacked_path.emplace_back(t);
+
+        if (nullptr != shortcut_cache)
+        {
+            shortcut_cache->Insert(packed_edge_id, traversed_in_reverse,
+                                   std::vector<ShortcutCache::UnpackedEdge>(
+                                       unpacked_edges.begin() + first_unpacked_edge,
+                                       unpacked_edges.end()));
+        }
+    }
+
+    // The search graph edge of the smallest weight from s to t. It is either stored at s with
+    // the forward flag or, with traversed_in_reverse set, at t with the backward flag.
+    EdgeID FindSmallestEdge(const NodeID s, const NodeID t, bool &traversed_in_reverse) const
+    {
+        // facade->FindEdge does not suffice here in case of shortcuts.
+        EdgeID smaller_edge_id = SPECIAL_EDGEID;
+        int edge_weight = std::numeric_limits<EdgeWeight>::max();
+        for (const auto edge_id : facade->GetAdjacentEdgeRange(s))
+        {
+            const int weight = facade->GetEdgeData(edge_id).distance;
+            if ((facade->GetTarget(edge_id) == t) && (weight < edge_weight) &&
+                facade->GetEdgeData(edge_id).forward)
+            {
+                smaller_edge_id = edge_id;
+                edge_weight = weight;
+            }
+        }
+
+        traversed_in_reverse = SPECIAL_EDGEID == smaller_edge_id;
+        if (traversed_in_reverse)
+        {
+            for (const auto edge_id : facade->GetAdjacentEdgeRange(t))
+            {
+                const int weight = facade->GetEdgeData(edge_id).distance;
+                if ((facade->GetTarget(edge_id) == s) && (weight < edge_weight) &&
+                    facade->GetEdgeData(edge_id).backward)
+                {
+                    smaller_edge_id = edge_id;
+                    edge_weight = weight;
+                }
+            }
+        }
+        BOOST_ASSERT_MSG(edge_weight != std::numeric_limits<EdgeWeight>::max(),
+                         "edge weight invalid");
+        return smaller_edge_id;
     }
 
     void RetrievePackedPathFromHeap(const SearchEngineData::QueryHeap &forward_heap,
@@ -449,44 +600,41 @@ template <class DataFacadeT, class Derived> class BasicRoutingInterface
         }
 
         // search from s and t till new_min/(1+epsilon) > length_of_shortest_path
-        while (0 < (forward_heap.Size() + reverse_heap.Size()))
-        {
-            if (0 < forward_heap.Size())
-            {
-                RoutingStep(forward_heap, reverse_heap, &middle_node, &upper_bound, edge_offset,
-                            true);
-            }
-            if (0 < reverse_heap.Size())
-            {
-                RoutingStep(reverse_heap, forward_heap, &middle_node, &upper_bound, edge_offset,
-                            false);
-            }
-        }
+        BidirectionalSearch(forward_heap, reverse_heap, &middle_node, &upper_bound, edge_offset);
 
         double distance = std::numeric_limits<double>::max();
         if (upper_bound != INVALID_EDGE_WEIGHT)
         {
             std::vector<NodeID> packed_leg;
             RetrievePackedPathFromHeap(forward_heap, reverse_heap, middle_node, packed_leg);
-            std::vector<PathData> unpacked_path;
-            PhantomNodes nodes;
-            nodes.source_phantom = source_phantom;
-            nodes.target_phantom = target_phantom;
-            UnpackPath(packed_leg, nodes, unpacked_path);
-
-            FixedPointCoordinate previous_coordinate = source_phantom.location;
-            FixedPointCoordinate current_coordinate;
-            distance = 0;
-            for (const auto &p : unpacked_path)
-            {
-                current_coordinate = facade->GetCoordinateOfNode(p.node);
-                distance += coordinate_calculation::great_circle_distance(previous_coordinate,
-                                                                          current_coordinate);
-                previous_coordinate = current_coordinate;
-            }
+            distance = GetPathLength(packed_leg, source_phantom, target_phantom);
+        }
+        return distance;
+    }
+
+    // geometric length of a packed path between two phantom nodes
+    double GetPathLength(const std::vector<NodeID> &packed_leg,
+                         const PhantomNode &source_phantom,
+                         const PhantomNode &target_phantom) const
+    {
+        std::vector<PathData> unpacked_path;
+        PhantomNodes nodes;
+        nodes.source_phantom = source_phantom;
+        nodes.target_phantom = target_phantom;
+        UnpackPath(packed_leg, nodes, unpacked_path);
+
+        FixedPointCoordinate previous_coordinate = source_phantom.location;
+        FixedPointCoordinate current_coordinate;
+        double distance = 0;
+        for (const auto &p : unpacked_path)
+        {
+            current_coordinate = facade->GetCoordinateOfNode(p.node);
             distance += coordinate_calculation::great_circle_distance(previous_coordinate,
-                                                                      target_phantom.location);
+                                                                      current_coordinate);
+            previous_coordinate = current_coordinate;
         }
+        distance += coordinate_calculation::great_circle_distance(previous_coordinate,
+                                                                  target_phantom.location);
         return distance;
     }
 };
@@ -0,0 +1,337 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef RPHAST_HPP
+#define RPHAST_HPP
+
+#include "routing_base.hpp"
+#include "../data_structures/search_engine_data.hpp"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The part of the search graph that the backward searches of a fixed set of targets explore,
+// i.e. every node with a downward path to one of the targets. The nodes are stored in sweep
+// order, each node after all nodes that have a downward edge into it.
+struct RPHASTTargetSet
+{
+    struct DownwardEdge
+    {
+        // index of the higher node into nodes
+        unsigned source_index;
+        EdgeWeight weight;
+    };
+    struct TargetEntry
+    {
+        unsigned node_index;
+        EdgeWeight offset;
+    };
+
+    unsigned GetNumberOfTargets() const
+    {
+        return static_cast<unsigned>(first_target_entry.size() - 1);
+    }
+
+    std::vector<NodeID> nodes;
+    // the downward edges into nodes[i] are edges[first_edge[i]] up to edges[first_edge[i + 1]]
+    std::vector<unsigned> first_edge;
+    std::vector<DownwardEdge> edges;
+    // the phantom nodes of target j are target_entries[first_target_entry[j]] up to
+    // target_entries[first_target_entry[j + 1]]
+    std::vector<unsigned> first_target_entry;
+    std::vector<TargetEntry> target_entries;
+    // the graph the set was selected on
+    unsigned check_sum;
+};
+
+// Restricted PHAST: distance tables for many sources against a fixed set of targets. Selecting
+// the target set runs once, afterwards every source is one upward search followed by a linear
+// sweep over the restricted graph, instead of the bucket scans of ManyToManyRouting that need
+// all backward searches again on every request.
+template <class DataFacadeT>
+class RPHASTRouting final : public BasicRoutingInterface<DataFacadeT, RPHASTRouting<DataFacadeT>>
+{
+    using super = BasicRoutingInterface<DataFacadeT, RPHASTRouting<DataFacadeT>>;
+    using QueryHeap = SearchEngineData::QueryHeap;
+    SearchEngineData &engine_working_data;
+
+  public:
+    RPHASTRouting(DataFacadeT *facade, SearchEngineData &engine_working_data)
+        : super(facade), engine_working_data(engine_working_data)
+    {
+    }
+
+    ~RPHASTRouting() {}
+
+    // Returns nullptr if the hierarchy has an uncontracted core. The core is no DAG, so there is
+    // no order for the sweep.
+    std::shared_ptr<const RPHASTTargetSet> SelectTargets(const PhantomNodeArray &targets) const
+    {
+        auto target_set = std::make_shared<RPHASTTargetSet>();
+        target_set->check_sum = super::facade->GetCheckSum();
+
+        // iterative depth first search along the backward edges, the post order puts every node
+        // after the higher nodes it reaches
+        std::unordered_map<NodeID, unsigned> node_indices;
+        std::vector<std::pair<NodeID, EdgeID>> dfs_stack;
+        const unsigned VISITING = std::numeric_limits<unsigned>::max();
+        const auto visit = [&](const NodeID root)
+        {
+            if (!node_indices.emplace(root, VISITING).second)
+            {
+                return;
+            }
+            dfs_stack.emplace_back(root, super::facade->BeginEdges(root));
+            while (!dfs_stack.empty())
+            {
+                const NodeID node = dfs_stack.back().first;
+                EdgeID &edge = dfs_stack.back().second;
+                if (edge == super::facade->EndEdges(node))
+                {
+                    node_indices[node] = static_cast<unsigned>(target_set->nodes.size());
+                    target_set->nodes.push_back(node);
+                    dfs_stack.pop_back();
+                    continue;
+                }
+                const EdgeID current_edge = edge++;
+                if (super::facade->GetEdgeData(current_edge).backward)
+                {
+                    const NodeID to = super::facade->GetTarget(current_edge);
+                    if (node_indices.emplace(to, VISITING).second)
+                    {
+                        dfs_stack.emplace_back(to, super::facade->BeginEdges(to));
+                    }
+                }
+            }
+        };
+
+        for (const std::vector<PhantomNode> &phantom_node_vector : targets)
+        {
+            for (const PhantomNode &phantom_node : phantom_node_vector)
+            {
+                if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                {
+                    visit(phantom_node.forward_node_id);
+                }
+                if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                {
+                    visit(phantom_node.reverse_node_id);
+                }
+            }
+        }
+
+        target_set->first_edge.reserve(target_set->nodes.size() + 1);
+        for (const NodeID node : target_set->nodes)
+        {
+            if (super::facade->IsCoreNode(node))
+            {
+                return nullptr;
+            }
+            target_set->first_edge.push_back(static_cast<unsigned>(target_set->edges.size()));
+            for (const auto edge : super::facade->GetAdjacentEdgeRange(node))
+            {
+                const auto &data = super::facade->GetEdgeData(edge);
+                if (data.backward)
+                {
+                    const unsigned source_index = node_indices[super::facade->GetTarget(edge)];
+                    BOOST_ASSERT(source_index < target_set->first_edge.size() - 1);
+                    target_set->edges.push_back({source_index, data.distance});
+                }
+            }
+        }
+        target_set->first_edge.push_back(static_cast<unsigned>(target_set->edges.size()));
+
+        target_set->first_target_entry.reserve(targets.size() + 1);
+        for (const std::vector<PhantomNode> &phantom_node_vector : targets)
+        {
+            target_set->first_target_entry.push_back(
+                static_cast<unsigned>(target_set->target_entries.size()));
+            for (const PhantomNode &phantom_node : phantom_node_vector)
+            {
+                if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                {
+                    target_set->target_entries.push_back(
+                        {node_indices[phantom_node.forward_node_id],
+                         phantom_node.GetForwardWeightPlusOffset()});
+                }
+                if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                {
+                    target_set->target_entries.push_back(
+                        {node_indices[phantom_node.reverse_node_id],
+                         phantom_node.GetReverseWeightPlusOffset()});
+                }
+            }
+        }
+        target_set->first_target_entry.push_back(
+            static_cast<unsigned>(target_set->target_entries.size()));
+        return target_set;
+    }
+
+    // one row per source with the distances to all targets of the set
+    std::shared_ptr<std::vector<EdgeWeight>> operator()(const PhantomNodeArray &sources,
+                                                        const RPHASTTargetSet &target_set) const
+    {
+        BOOST_ASSERT(target_set.check_sum == super::facade->GetCheckSum());
+        const unsigned number_of_sources = static_cast<unsigned>(sources.size());
+        const unsigned number_of_targets = target_set.GetNumberOfTargets();
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        std::shared_ptr<std::vector<EdgeWeight>> result_table =
+            std::make_shared<std::vector<EdgeWeight>>(number_of_sources * number_of_targets,
+                                                      INVALID_EDGE_WEIGHT);
+
+        const auto cancellation_token = osrm::cancellation::Current();
+
+        tbb::parallel_for(
+            tbb::blocked_range<unsigned>(0, number_of_sources),
+            [&](const tbb::blocked_range<unsigned> &range)
+            {
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                const SearchEngineData::HeapScope heap_scope;
+                engine_working_data.InitializeOrClearFirstThreadLocalStorage(number_of_nodes);
+                QueryHeap &query_heap = *(engine_working_data.forward_heap_1);
+                std::vector<EdgeWeight> distances(target_set.nodes.size());
+                for (unsigned source_id = range.begin(); source_id != range.end(); ++source_id)
+                {
+                    query_heap.Clear();
+                    for (const PhantomNode &phantom_node : sources[source_id])
+                    {
+                        // insert sources at distance 0
+                        if (SPECIAL_NODEID != phantom_node.forward_node_id)
+                        {
+                            query_heap.Insert(phantom_node.forward_node_id,
+                                              -phantom_node.GetForwardWeightPlusOffset(),
+                                              phantom_node.forward_node_id);
+                        }
+                        if (SPECIAL_NODEID != phantom_node.reverse_node_id)
+                        {
+                            query_heap.Insert(phantom_node.reverse_node_id,
+                                              -phantom_node.GetReverseWeightPlusOffset(),
+                                              phantom_node.reverse_node_id);
+                        }
+                    }
+                    // the complete upward search space, there is no target to stop at
+                    while (!query_heap.Empty())
+                    {
+                        UpwardRoutingStep(query_heap);
+                    }
+
+                    Sweep(query_heap, target_set, distances);
+
+                    for (unsigned target_id = 0; target_id < number_of_targets; ++target_id)
+                    {
+                        EdgeWeight &result =
+                            (*result_table)[source_id * number_of_targets + target_id];
+                        for (unsigned i = target_set.first_target_entry[target_id];
+                             i < target_set.first_target_entry[target_id + 1]; ++i)
+                        {
+                            const auto &entry = target_set.target_entries[i];
+                            if (INVALID_EDGE_WEIGHT == distances[entry.node_index])
+                            {
+                                continue;
+                            }
+                            const EdgeWeight new_distance =
+                                distances[entry.node_index] + entry.offset;
+                            if (new_distance >= 0 && new_distance < result)
+                            {
+                                result = new_distance;
+                            }
+                        }
+                    }
+                }
+            });
+        return result_table;
+    }
+
+  private:
+    void UpwardRoutingStep(QueryHeap &query_heap) const
+    {
+        osrm::cancellation::Poll();
+        const NodeID node = query_heap.DeleteMin();
+        const int distance = query_heap.GetKey(node);
+        // stalled nodes keep their key, the sweep replaces it by the shorter distance
+        if (CHStallingPolicy::Stall<true>(*super::facade, query_heap, node, distance))
+        {
+            return;
+        }
+        for (const auto edge : super::facade->GetAdjacentEdgeRange(node))
+        {
+            const auto &data = super::facade->GetEdgeData(edge);
+            if (data.forward)
+            {
+                const NodeID to = super::facade->GetTarget(edge);
+                BOOST_ASSERT_MSG(data.distance > 0, "edge_weight invalid");
+                const int to_distance = distance + data.distance;
+                if (!query_heap.WasInserted(to))
+                {
+                    query_heap.Insert(to, to_distance, node);
+                }
+                else if (to_distance < query_heap.GetKey(to))
+                {
+                    query_heap.GetData(to).parent = node;
+                    query_heap.DecreaseKey(to, to_distance);
+                    CHStallingPolicy::Unstall(query_heap, to);
+                }
+            }
+        }
+    }
+
+    // Pulls the distances of the upward search down to the targets. Higher nodes come first, so
+    // the distance of every source node of a downward edge is final when it is read.
+    void Sweep(QueryHeap &query_heap,
+               const RPHASTTargetSet &target_set,
+               std::vector<EdgeWeight> &distances) const
+    {
+        for (unsigned i = 0; i < target_set.nodes.size(); ++i)
+        {
+            const NodeID node = target_set.nodes[i];
+            EdgeWeight distance =
+                query_heap.WasInserted(node) ? query_heap.GetKey(node) : INVALID_EDGE_WEIGHT;
+            for (unsigned e = target_set.first_edge[i]; e < target_set.first_edge[i + 1]; ++e)
+            {
+                const auto &edge = target_set.edges[e];
+                BOOST_ASSERT(edge.source_index < i);
+                if (INVALID_EDGE_WEIGHT != distances[edge.source_index])
+                {
+                    distance = std::min(distance, distances[edge.source_index] + edge.weight);
+                }
+            }
+            distances[i] = distance;
+        }
+    }
+};
+
+#endif // RPHAST_HPP
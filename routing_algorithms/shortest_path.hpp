@@ -35,6 +35,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../util/integer_range.hpp"
 #include "../typedefs.h"
 
+#include <tbb/blocked_range.h>
+#include <tbb/concurrent_unordered_map.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
 template <class DataFacadeT>
 class ShortestPathRouting final
     : public BasicRoutingInterface<DataFacadeT, ShortestPathRouting<DataFacadeT>>
@@ -55,14 +65,30 @@ class ShortestPathRouting final
                     const std::vector<bool> &uturn_indicators,
                     InternalRouteResult &raw_route_data) const
     {
+        if (SearchEngineData::parallel_leg_search && phantom_nodes_vector.size() > 1)
+        {
+            ParallelLegSearch(phantom_nodes_vector, uturn_indicators, raw_route_data);
+            return;
+        }
+
         int distance1 = 0;
         int distance2 = 0;
         bool search_from_1st_node = true;
         bool search_from_2nd_node = true;
         NodeID middle1 = SPECIAL_NODEID;
         NodeID middle2 = SPECIAL_NODEID;
-        std::vector<std::vector<NodeID>> packed_legs1(phantom_nodes_vector.size());
-        std::vector<std::vector<NodeID>> packed_legs2(phantom_nodes_vector.size());
+        // the packed legs are kept per thread, clearing them keeps their capacity
+        SearchEngineData::UnpackingData &unpacking_data =
+            SearchEngineData::GetUnpackingThreadLocalStorage();
+        std::vector<std::vector<NodeID>> &packed_legs1 = unpacking_data.packed_legs1;
+        std::vector<std::vector<NodeID>> &packed_legs2 = unpacking_data.packed_legs2;
+        packed_legs1.resize(phantom_nodes_vector.size());
+        packed_legs2.resize(phantom_nodes_vector.size());
+        for (const std::size_t index : osrm::irange<std::size_t>(0, packed_legs1.size()))
+        {
+            packed_legs1[index].clear();
+            packed_legs2[index].clear();
+        }
 
         engine_working_data.InitializeOrClearFirstThreadLocalStorage(
             super::facade->GetNumberOfNodes());
@@ -150,35 +176,12 @@ class ShortestPathRouting final
             }
 
             // run two-Target Dijkstra routing step.
-            while (0 < (forward_heap1.Size() + reverse_heap1.Size()))
-            {
-                if (!forward_heap1.Empty())
-                {
-                    super::RoutingStep(forward_heap1, reverse_heap1, &middle1, &local_upper_bound1,
-                                       min_edge_offset, true);
-                }
-                if (!reverse_heap1.Empty())
-                {
-                    super::RoutingStep(reverse_heap1, forward_heap1, &middle1, &local_upper_bound1,
-                                       min_edge_offset, false);
-                }
-            }
+            Search(forward_heap1, reverse_heap1, &middle1, &local_upper_bound1, min_edge_offset);
 
             if (!reverse_heap2.Empty())
             {
-                while (0 < (forward_heap2.Size() + reverse_heap2.Size()))
-                {
-                    if (!forward_heap2.Empty())
-                    {
-                        super::RoutingStep(forward_heap2, reverse_heap2, &middle2,
-                                           &local_upper_bound2, min_edge_offset, true);
-                    }
-                    if (!reverse_heap2.Empty())
-                    {
-                        super::RoutingStep(reverse_heap2, forward_heap2, &middle2,
-                                           &local_upper_bound2, min_edge_offset, false);
-                    }
-                }
+                Search(forward_heap2, reverse_heap2, &middle2, &local_upper_bound2,
+                       min_edge_offset);
             }
 
             // No path found for both target nodes?
@@ -206,8 +209,10 @@ class ShortestPathRouting final
                              "no path found");
 
             // Unpack paths if they exist
-            std::vector<NodeID> temporary_packed_leg1;
-            std::vector<NodeID> temporary_packed_leg2;
+            std::vector<NodeID> &temporary_packed_leg1 = unpacking_data.packed_leg1;
+            std::vector<NodeID> &temporary_packed_leg2 = unpacking_data.packed_leg2;
+            temporary_packed_leg1.clear();
+            temporary_packed_leg2.clear();
 
             BOOST_ASSERT(current_leg < packed_legs1.size());
             BOOST_ASSERT(current_leg < packed_legs2.size());
@@ -323,13 +328,21 @@ class ShortestPathRouting final
             BOOST_ASSERT(packed_legs1.size() == raw_route_data.unpacked_path_segments.size());
 
             PhantomNodes unpack_phantom_node_pair = phantom_nodes_vector[index];
-            super::UnpackPath(
-                // -- packed input
-                packed_legs1[index],
-                // -- start and end of (sub-)route
-                unpack_phantom_node_pair,
-                // -- unpacked output
-                raw_route_data.unpacked_path_segments[index]);
+            if (raw_route_data.summary_only)
+            {
+                raw_route_data.leg_lengths.push_back(super::ComputePackedPathLength(
+                    packed_legs1[index], unpack_phantom_node_pair));
+            }
+            else
+            {
+                super::UnpackPath(
+                    // -- packed input
+                    packed_legs1[index],
+                    // -- start and end of (sub-)route
+                    unpack_phantom_node_pair,
+                    // -- unpacked output
+                    raw_route_data.unpacked_path_segments[index]);
+            }
 
             raw_route_data.source_traversed_in_reverse.push_back(
                 (packed_legs1[index].front() !=
@@ -340,6 +353,299 @@ class ShortestPathRouting final
         }
         raw_route_data.shortest_path_length = std::min(distance1, distance2);
     }
+
+  private:
+    void Search(QueryHeap &forward_heap,
+                QueryHeap &reverse_heap,
+                NodeID *middle,
+                int *upper_bound,
+                const int min_edge_offset) const
+    {
+        if (SearchEngineData::parallel_bidirectional_search)
+        {
+            ParallelSearch(forward_heap, reverse_heap, middle, upper_bound, min_edge_offset);
+            return;
+        }
+        InterleavedSearch(forward_heap, reverse_heap, middle, upper_bound, min_edge_offset);
+    }
+
+    void InterleavedSearch(QueryHeap &forward_heap,
+                           QueryHeap &reverse_heap,
+                           NodeID *middle,
+                           int *upper_bound,
+                           const int min_edge_offset) const
+    {
+        super::BidirectionalSearch(forward_heap, reverse_heap, middle, upper_bound,
+                                   min_edge_offset);
+    }
+
+    // a phantom node is entered in its forward or in its reverse direction
+    static NodeID GetDirectionNode(const PhantomNode &phantom, const std::size_t direction)
+    {
+        return 0 == direction ? phantom.forward_node_id : phantom.reverse_node_id;
+    }
+
+    static EdgeWeight GetDirectionWeight(const PhantomNode &phantom, const std::size_t direction)
+    {
+        return 0 == direction ? phantom.GetForwardWeightPlusOffset()
+                              : phantom.GetReverseWeightPlusOffset();
+    }
+
+    // Searches the legs independently on the TBB workers, from both directions of the source to
+    // both directions of the target. Stitching them picks the directions at the via points, a
+    // leg continues in the direction the previous one arrived in unless a u-turn is allowed.
+    void ParallelLegSearch(const std::vector<PhantomNodes> &phantom_nodes_vector,
+                           const std::vector<bool> &uturn_indicators,
+                           InternalRouteResult &raw_route_data) const
+    {
+        const std::size_t number_of_legs = phantom_nodes_vector.size();
+        // indexed by leg, source direction and target direction
+        std::vector<std::array<EdgeWeight, 4>> leg_weights(number_of_legs);
+        std::vector<std::array<std::vector<NodeID>, 4>> packed_legs(number_of_legs);
+
+        const unsigned number_of_nodes = super::facade->GetNumberOfNodes();
+        const auto cancellation_token = osrm::cancellation::Current();
+        tbb::parallel_for(
+            tbb::blocked_range<std::size_t>(0, 4 * number_of_legs, 1),
+            [&](const tbb::blocked_range<std::size_t> &range)
+            {
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                const SearchEngineData::HeapScope heap_scope;
+                // the heaps of the worker, the searches below must not spawn tasks themselves
+                engine_working_data.InitializeOrClearFirstThreadLocalStorage(number_of_nodes);
+                QueryHeap &forward_heap = *(engine_working_data.forward_heap_1);
+                QueryHeap &reverse_heap = *(engine_working_data.reverse_heap_1);
+                for (auto index = range.begin(); index != range.end(); ++index)
+                {
+                    const PhantomNodes &phantom_node_pair = phantom_nodes_vector[index / 4];
+                    const std::size_t source_direction = (index % 4) / 2;
+                    const std::size_t target_direction = index % 2;
+                    EdgeWeight &weight = leg_weights[index / 4][index % 4];
+                    std::vector<NodeID> &packed_leg = packed_legs[index / 4][index % 4];
+                    weight = INVALID_EDGE_WEIGHT;
+
+                    const NodeID source_node =
+                        GetDirectionNode(phantom_node_pair.source_phantom, source_direction);
+                    const NodeID target_node =
+                        GetDirectionNode(phantom_node_pair.target_phantom, target_direction);
+                    if (SPECIAL_NODEID == source_node || SPECIAL_NODEID == target_node)
+                    {
+                        continue;
+                    }
+
+                    forward_heap.Clear();
+                    reverse_heap.Clear();
+                    const EdgeWeight source_weight =
+                        -GetDirectionWeight(phantom_node_pair.source_phantom, source_direction);
+                    forward_heap.Insert(source_node, source_weight, source_node);
+                    reverse_heap.Insert(
+                        target_node,
+                        GetDirectionWeight(phantom_node_pair.target_phantom, target_direction),
+                        target_node);
+
+                    NodeID middle = SPECIAL_NODEID;
+                    InterleavedSearch(forward_heap, reverse_heap, &middle, &weight,
+                                      source_weight);
+                    if (INVALID_EDGE_WEIGHT != weight)
+                    {
+                        super::RetrievePackedPathFromHeap(forward_heap, reverse_heap, middle,
+                                                          packed_leg);
+                    }
+                }
+            });
+
+        // weight of the best route up to the target of a leg and the directions it took, per
+        // direction the target is reached in
+        std::vector<std::array<EdgeWeight, 2>> route_weights(number_of_legs);
+        std::vector<std::array<std::size_t, 2>> source_directions(number_of_legs);
+        std::vector<std::array<std::size_t, 2>> previous_directions(number_of_legs);
+        const auto extend_route = [&](const std::size_t leg, const bool allow_u_turn)
+        {
+            const PhantomNodes &phantom_node_pair = phantom_nodes_vector[leg];
+            for (const std::size_t target_direction : {0u, 1u})
+            {
+                route_weights[leg][target_direction] = INVALID_EDGE_WEIGHT;
+                for (const std::size_t source_direction : {0u, 1u})
+                {
+                    const EdgeWeight weight =
+                        leg_weights[leg][2 * source_direction + target_direction];
+                    if (INVALID_EDGE_WEIGHT == weight)
+                    {
+                        continue;
+                    }
+                    for (const std::size_t previous_direction : {0u, 1u})
+                    {
+                        EdgeWeight previous_weight = 0;
+                        if (leg > 0)
+                        {
+                            previous_weight = route_weights[leg - 1][previous_direction];
+                            const NodeID arrival_node = GetDirectionNode(
+                                phantom_nodes_vector[leg - 1].target_phantom, previous_direction);
+                            const NodeID departure_node =
+                                GetDirectionNode(phantom_node_pair.source_phantom, source_direction);
+                            if (INVALID_EDGE_WEIGHT == previous_weight ||
+                                (!allow_u_turn && arrival_node != departure_node))
+                            {
+                                continue;
+                            }
+                        }
+                        if (previous_weight + weight < route_weights[leg][target_direction])
+                        {
+                            route_weights[leg][target_direction] = previous_weight + weight;
+                            source_directions[leg][target_direction] = source_direction;
+                            previous_directions[leg][target_direction] = previous_direction;
+                        }
+                    }
+                }
+            }
+            return INVALID_EDGE_WEIGHT != route_weights[leg][0] ||
+                   INVALID_EDGE_WEIGHT != route_weights[leg][1];
+        };
+
+        for (const std::size_t leg : osrm::irange<std::size_t>(0, number_of_legs))
+        {
+            const bool allow_u_turn =
+                leg > 0 && uturn_indicators.size() > leg && uturn_indicators[leg - 1];
+            // a via point that can not be passed straight is turned at
+            if (!extend_route(leg, allow_u_turn) && (allow_u_turn || !extend_route(leg, true)))
+            {
+                raw_route_data.shortest_path_length = INVALID_EDGE_WEIGHT;
+                raw_route_data.alternative_path_length = INVALID_EDGE_WEIGHT;
+                return;
+            }
+        }
+
+        const auto &last_weights = route_weights.back();
+        std::size_t target_direction = last_weights[0] <= last_weights[1] ? 0 : 1;
+        raw_route_data.shortest_path_length = last_weights[target_direction];
+        std::vector<std::size_t> leg_paths(number_of_legs);
+        for (std::size_t leg = number_of_legs; leg > 0; --leg)
+        {
+            const std::size_t source_direction = source_directions[leg - 1][target_direction];
+            leg_paths[leg - 1] = 2 * source_direction + target_direction;
+            target_direction = previous_directions[leg - 1][target_direction];
+        }
+
+        raw_route_data.unpacked_path_segments.resize(number_of_legs);
+        for (const std::size_t leg : osrm::irange<std::size_t>(0, number_of_legs))
+        {
+            const std::vector<NodeID> &packed_leg = packed_legs[leg][leg_paths[leg]];
+            BOOST_ASSERT(!packed_leg.empty());
+            if (raw_route_data.summary_only)
+            {
+                raw_route_data.leg_lengths.push_back(
+                    super::ComputePackedPathLength(packed_leg, phantom_nodes_vector[leg]));
+            }
+            else
+            {
+                super::UnpackPath(packed_leg, phantom_nodes_vector[leg],
+                                  raw_route_data.unpacked_path_segments[leg]);
+            }
+            raw_route_data.source_traversed_in_reverse.push_back(
+                packed_leg.front() != phantom_nodes_vector[leg].source_phantom.forward_node_id);
+            raw_route_data.target_traversed_in_reverse.push_back(
+                packed_leg.back() != phantom_nodes_vector[leg].target_phantom.forward_node_id);
+        }
+    }
+
+    // Nodes settled by one direction, with their final distance. The other direction only
+    // reads these, a heap can not be read while its own thread modifies it.
+    using SettledNodes = tbb::concurrent_unordered_map<NodeID, int>;
+
+    // distance and middle node of the shortest path found so far, packed so that both are
+    // replaced at once. Distances of middle nodes are never negative.
+    static std::uint64_t PackPath(const int distance, const NodeID middle)
+    {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(distance)) << 32) | middle;
+    }
+
+    static int UnpackDistance(const std::uint64_t path)
+    {
+        return static_cast<int>(path >> 32);
+    }
+
+    // Runs the forward and the reverse search on two threads. Both settle the top node of the
+    // shortest path, the one that settles it last finds it in the other's settled nodes. Each
+    // direction stops once its smallest key exceeds the shared upper bound.
+    void ParallelSearch(QueryHeap &forward_heap,
+                        QueryHeap &reverse_heap,
+                        NodeID *middle,
+                        int *upper_bound,
+                        const int min_edge_offset) const
+    {
+        SettledNodes forward_settled;
+        SettledNodes reverse_settled;
+        std::atomic<std::uint64_t> shortest_path(PackPath(*upper_bound, *middle));
+
+        const auto cancellation_token = osrm::cancellation::Current();
+        tbb::parallel_invoke(
+            [&]
+            {
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                while (!forward_heap.Empty())
+                {
+                    ParallelRoutingStep<true>(forward_heap, forward_settled, reverse_settled,
+                                              shortest_path, min_edge_offset);
+                }
+            },
+            [&]
+            {
+                const osrm::cancellation::Scope cancellation_scope(cancellation_token);
+                while (!reverse_heap.Empty())
+                {
+                    ParallelRoutingStep<false>(reverse_heap, reverse_settled, forward_settled,
+                                               shortest_path, min_edge_offset);
+                }
+            });
+
+        const std::uint64_t path = shortest_path.load();
+        *upper_bound = UnpackDistance(path);
+        *middle = static_cast<NodeID>(path & 0xffffffff);
+    }
+
+    template <bool forward_direction>
+    void ParallelRoutingStep(QueryHeap &heap,
+                             SettledNodes &settled,
+                             const SettledNodes &other_settled,
+                             std::atomic<std::uint64_t> &shortest_path,
+                             const int min_edge_offset) const
+    {
+        osrm::cancellation::Poll();
+        const NodeID node = heap.DeleteMin();
+        const int distance = heap.GetKey(node);
+
+        settled.emplace(node, distance);
+        // orders the insert before the lookup, so that the two threads can not both miss a node
+        // that they settle at the same time
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto other = other_settled.find(node);
+        if (other != other_settled.end())
+        {
+            const int new_distance = distance + other->second;
+            if (new_distance >= 0)
+            {
+                const std::uint64_t new_path = PackPath(new_distance, node);
+                std::uint64_t current_path = shortest_path.load();
+                while (new_path < current_path &&
+                       !shortest_path.compare_exchange_weak(current_path, new_path))
+                {
+                }
+            }
+        }
+
+        if (distance + min_edge_offset > UnpackDistance(shortest_path.load()))
+        {
+            heap.DeleteAll();
+            return;
+        }
+
+        if (CHStallingPolicy::Stall<forward_direction>(*super::facade, heap, node, distance))
+        {
+            return;
+        }
+
+        super::template RelaxOutgoingEdges<forward_direction>(heap, node, distance);
+    }
 };
 
 #endif /* SHORTEST_PATH_HPP */
@@ -0,0 +1,163 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef STALLING_HPP
+#define STALLING_HPP
+
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+// Pruning of the searches on the contracted graph. A node is stalled when a higher node reaches
+// it on a shorter path than the one it was found through. Its key is not its distance then, so
+// it can not be on the upward part of a shortest path and its edges need not be relaxed.
+//
+// A search asks Stall<forward_direction>(graph, heap, node, distance) before it relaxes the
+// edges of a settled node and calls Unstall(heap, node) whenever it decreases the key of a node.
+// The graph is either a data facade or the query graph itself, the heap data needs a stalled
+// flag.
+
+// Relaxes every settled node, for measuring what stalling saves
+struct NoStalling
+{
+    template <bool forward_direction, typename GraphT, typename HeapT>
+    static bool Stall(const GraphT &, HeapT &, const NodeID, const int)
+    {
+        return false;
+    }
+
+    template <typename HeapT> static void Unstall(HeapT &, const NodeID) {}
+};
+
+// Looks at the incoming edges of the settled node only
+struct StallOnSettle
+{
+    template <bool forward_direction, typename GraphT, typename HeapT>
+    static bool Stall(const GraphT &graph, HeapT &heap, const NodeID node, const int distance)
+    {
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            const auto &data = graph.GetEdgeData(edge);
+            if (forward_direction ? data.backward : data.forward)
+            {
+                const NodeID to = graph.GetTarget(edge);
+                BOOST_ASSERT_MSG(data.distance > 0, "edge_weight invalid");
+                if (heap.WasInserted(to) && heap.GetKey(to) + data.distance < distance)
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    template <typename HeapT> static void Unstall(HeapT &, const NodeID) {}
+};
+
+// Stall-on-demand: a stalled node also passes its shorter distance on along its outgoing edges.
+// Every node in the heap whose key is beaten by that distance is stalled before it is settled.
+// A node is unstalled when its key decreases, it may have been reached on an upward path then.
+struct StallOnDemand
+{
+    template <bool forward_direction, typename GraphT, typename HeapT>
+    static bool Stall(const GraphT &graph, HeapT &heap, const NodeID node, const int distance)
+    {
+        if (heap.GetData(node).stalled)
+        {
+            return true;
+        }
+
+        int stall_distance = distance;
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            const auto &data = graph.GetEdgeData(edge);
+            if (forward_direction ? data.backward : data.forward)
+            {
+                const NodeID to = graph.GetTarget(edge);
+                BOOST_ASSERT_MSG(data.distance > 0, "edge_weight invalid");
+                if (heap.WasInserted(to))
+                {
+                    stall_distance = std::min(stall_distance, heap.GetKey(to) + data.distance);
+                }
+            }
+        }
+        if (stall_distance >= distance)
+        {
+            return false;
+        }
+
+        heap.GetData(node).stalled = true;
+        Propagate<forward_direction>(graph, heap, node, stall_distance);
+        return true;
+    }
+
+    template <typename HeapT> static void Unstall(HeapT &heap, const NodeID node)
+    {
+        heap.GetData(node).stalled = false;
+    }
+
+  private:
+    template <bool forward_direction, typename GraphT, typename HeapT>
+    static void
+    Propagate(const GraphT &graph, HeapT &heap, const NodeID node, const int stall_distance)
+    {
+        // kept per thread, so that its capacity carries over from one query to the next
+        static thread_local std::vector<std::pair<NodeID, int>> stack;
+        stack.clear();
+        stack.emplace_back(node, stall_distance);
+        while (!stack.empty())
+        {
+            const NodeID current = stack.back().first;
+            const int current_distance = stack.back().second;
+            stack.pop_back();
+            for (const auto edge : graph.GetAdjacentEdgeRange(current))
+            {
+                const auto &data = graph.GetEdgeData(edge);
+                if (forward_direction ? data.forward : data.backward)
+                {
+                    const NodeID to = graph.GetTarget(edge);
+                    const int to_distance = current_distance + data.distance;
+                    if (heap.WasInserted(to) && !heap.WasRemoved(to) &&
+                        !heap.GetData(to).stalled && to_distance < heap.GetKey(to))
+                    {
+                        heap.GetData(to).stalled = true;
+                        stack.emplace_back(to, to_distance);
+                    }
+                }
+            }
+        }
+    }
+};
+
+// The policy of all searches on the contracted graph, the core search does not stall
+using CHStallingPolicy = StallOnDemand;
+
+#endif // STALLING_HPP
@@ -0,0 +1,145 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "access_log.hpp"
+
+#include "../util/simple_logger.hpp"
+
+#include <boost/thread/tss.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+constexpr std::size_t AccessLog::MAX_ENTRY_LENGTH;
+constexpr std::size_t AccessLog::RING_BUFFER_SIZE;
+
+AccessLog &AccessLog::GetInstance()
+{
+    static AccessLog instance;
+    return instance;
+}
+
+AccessLog::AccessLog() : sampling(1), dropped_entries(0), running(true)
+{
+    drain_thread = std::thread(&AccessLog::DrainLoop, this);
+}
+
+AccessLog::~AccessLog()
+{
+    running = false;
+    wakeup.notify_one();
+    drain_thread.join();
+}
+
+void AccessLog::SetSampling(const unsigned every_nth_request) { sampling = every_nth_request; }
+
+AccessLog::RingBuffer &AccessLog::LocalBuffer()
+{
+    // buffers are owned by the AccessLog, threads only keep a reference
+    static boost::thread_specific_ptr<RingBuffer> local_buffer([](RingBuffer *)
+                                                               {
+                                                               });
+    if (!local_buffer.get())
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffers.emplace_back(new RingBuffer());
+        local_buffer.reset(buffers.back().get());
+    }
+    return *local_buffer;
+}
+
+bool AccessLog::Sample()
+{
+    const unsigned every_nth_request = sampling.load(std::memory_order_relaxed);
+    if (0 == every_nth_request)
+    {
+        return false;
+    }
+    auto &buffer = LocalBuffer();
+    return 0 == (buffer.sample_counter++ % every_nth_request);
+}
+
+void AccessLog::Write(const char *line, const std::size_t length)
+{
+    auto &buffer = LocalBuffer();
+    const auto head = buffer.head.load(std::memory_order_relaxed);
+    const auto tail = buffer.tail.load(std::memory_order_acquire);
+    if (head - tail >= RING_BUFFER_SIZE)
+    {
+        ++dropped_entries;
+        return;
+    }
+
+    auto &entry = buffer.entries[head % RING_BUFFER_SIZE];
+    entry.length = std::min(length, MAX_ENTRY_LENGTH);
+    std::memcpy(entry.data, line, entry.length);
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void AccessLog::Drain(std::string &output)
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (auto &buffer : buffers)
+    {
+        const auto head = buffer->head.load(std::memory_order_acquire);
+        auto tail = buffer->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail)
+        {
+            const auto &entry = buffer->entries[tail % RING_BUFFER_SIZE];
+            output.append(entry.data, entry.length);
+            output.push_back('\n');
+        }
+        buffer->tail.store(tail, std::memory_order_release);
+    }
+}
+
+void AccessLog::Flush()
+{
+    std::string output;
+    Drain(output);
+    if (!output.empty() && !LogPolicy::GetInstance().IsMute())
+    {
+        std::cout.write(output.data(), output.size());
+        std::cout.flush();
+    }
+}
+
+void AccessLog::DrainLoop()
+{
+    while (running)
+    {
+        {
+            std::unique_lock<std::mutex> lock(wakeup_mutex);
+            wakeup.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        Flush();
+    }
+    // write out what is left over on shutdown
+    Flush();
+}
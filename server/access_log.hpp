@@ -0,0 +1,107 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ACCESS_LOG_HPP
+#define ACCESS_LOG_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Asynchronous request log. Every worker thread appends to its own single-producer ring
+// buffer without taking a lock, a background thread drains all buffers to stdout. Entries
+// are dropped (and counted) instead of blocking when a ring buffer is full.
+class AccessLog
+{
+  public:
+    static constexpr std::size_t MAX_ENTRY_LENGTH = 480;
+    static constexpr std::size_t RING_BUFFER_SIZE = 1024;
+
+    static AccessLog &GetInstance();
+
+    AccessLog(const AccessLog &) = delete;
+    ~AccessLog();
+
+    // Log every n-th request of each thread, 0 disables the access log
+    void SetSampling(const unsigned every_nth_request);
+
+    // Cheap check whether the calling thread should log its current request.
+    bool Sample();
+
+    // Lines longer than MAX_ENTRY_LENGTH are truncated
+    void Write(const char *line, const std::size_t length);
+    void Write(const std::string &line) { Write(line.data(), line.size()); }
+
+    // Writes all pending entries, blocks until done
+    void Flush();
+
+    std::uint64_t DroppedEntries() const { return dropped_entries.load(); }
+
+  private:
+    struct Entry
+    {
+        std::size_t length;
+        char data[MAX_ENTRY_LENGTH];
+    };
+
+    struct RingBuffer
+    {
+        RingBuffer() : entries(RING_BUFFER_SIZE), head(0), tail(0), sample_counter(0) {}
+
+        std::vector<Entry> entries;
+        // written by the producer only
+        std::atomic<std::size_t> head;
+        // written by the drain thread only
+        std::atomic<std::size_t> tail;
+        unsigned sample_counter;
+    };
+
+    AccessLog();
+
+    RingBuffer &LocalBuffer();
+    void DrainLoop();
+    void Drain(std::string &output);
+
+    std::atomic<unsigned> sampling;
+    std::atomic<std::uint64_t> dropped_entries;
+    std::atomic<bool> running;
+
+    // guards the list of buffers, only taken when a thread logs for the first time
+    std::mutex buffers_mutex;
+    std::vector<std::unique_ptr<RingBuffer>> buffers;
+
+    std::mutex wakeup_mutex;
+    std::condition_variable wakeup;
+    std::thread drain_thread;
+};
+
+#endif // ACCESS_LOG_HPP
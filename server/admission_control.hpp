@@ -0,0 +1,135 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef ADMISSION_CONTROL_HPP
+#define ADMISSION_CONTROL_HPP
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Limits the number of concurrently running queries per service. Requests beyond the worker
+// budget wait in a bounded queue, requests beyond the queue are rejected right away so that
+// expensive services cannot occupy all server threads.
+class AdmissionControl
+{
+  public:
+    struct Limits
+    {
+        unsigned max_running;
+        unsigned max_queued;
+    };
+
+  private:
+    struct Slot
+    {
+        explicit Slot(const Limits limits) : limits(limits), running(0), queued(0) {}
+
+        const Limits limits;
+        std::mutex mutex;
+        std::condition_variable slot_freed;
+        unsigned running;
+        unsigned queued;
+    };
+
+  public:
+    // Holds a running slot of a service until released or destroyed
+    class Ticket
+    {
+      public:
+        Ticket(Ticket &&other) : slot(other.slot), admitted(other.admitted)
+        {
+            other.slot = nullptr;
+        }
+        Ticket(const Ticket &) = delete;
+        ~Ticket() { Release(); }
+
+        bool Admitted() const { return admitted; }
+
+        void Release()
+        {
+            if (nullptr == slot)
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(slot->mutex);
+                --slot->running;
+            }
+            slot->slot_freed.notify_one();
+            slot = nullptr;
+        }
+
+      private:
+        friend class AdmissionControl;
+        Ticket(Slot *slot, const bool admitted) : slot(slot), admitted(admitted) {}
+
+        Slot *slot;
+        bool admitted;
+    };
+
+    // Has to be called before the server handles requests
+    void SetLimits(const std::string &service, const Limits limits)
+    {
+        slots[service].reset(new Slot(limits));
+    }
+
+    // Blocks while the service is at its worker budget. The returned ticket is not admitted
+    // if the wait queue of the service is full. Services without limits are always admitted.
+    Ticket Acquire(const std::string &service) const
+    {
+        const auto iter = slots.find(service);
+        if (slots.end() == iter)
+        {
+            return Ticket(nullptr, true);
+        }
+        auto &slot = *iter->second;
+        std::unique_lock<std::mutex> lock(slot.mutex);
+        if (slot.running >= slot.limits.max_running)
+        {
+            if (slot.queued >= slot.limits.max_queued)
+            {
+                return Ticket(nullptr, false);
+            }
+            ++slot.queued;
+            slot.slot_freed.wait(lock, [&slot]
+                                 {
+                                     return slot.running < slot.limits.max_running;
+                                 });
+            --slot.queued;
+        }
+        ++slot.running;
+        return Ticket(&slot, true);
+    }
+
+  private:
+    std::unordered_map<std::string, std::unique_ptr<Slot>> slots;
+};
+
+#endif // ADMISSION_CONTROL_HPP
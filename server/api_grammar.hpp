@@ -42,7 +42,9 @@ template <typename Iterator, class HandlerT> struct APIGrammar : qi::grammar<Ite
                    *(query) >> -(uturns);
         query = ('?') >> (+(zoom | output | jsonp | checksum | location | hint | timestamp | u | cmp |
                             language | instruction | geometry | alt_route | old_API | num_results |
-                            matching_beta | gps_precision | classify | locs));
+                            matching_beta | gps_precision | improvement_time | classify | locs |
+                            profile | bearing | target_set | session | source | destination |
+                            lengths | max_time | hull | timeout | max_duration));
 
         zoom = (-qi::lit('&')) >> qi::lit('z') >> '=' >>
                qi::short_[boost::bind(&HandlerT::setZoomLevel, handler, ::_1)];
@@ -65,6 +67,9 @@ template <typename Iterator, class HandlerT> struct APIGrammar : qi::grammar<Ite
                stringwithDot[boost::bind(&HandlerT::addHint, handler, ::_1)];
         timestamp = (-qi::lit('&')) >> qi::lit("t") >> '=' >>
                qi::uint_[boost::bind(&HandlerT::addTimestamp, handler, ::_1)];
+        bearing = (-qi::lit('&')) >> qi::lit("b") >> '=' >>
+                  (qi::int_ >> -(qi::lit(',') >> qi::int_))[boost::bind(&HandlerT::addBearing,
+                                                                        handler, ::_1)];
         u = (-qi::lit('&')) >> qi::lit("u") >> '=' >>
             qi::bool_[boost::bind(&HandlerT::setUTurn, handler, ::_1)];
         uturns = (-qi::lit('&')) >> qi::lit("uturns") >> '=' >>
@@ -81,8 +86,30 @@ template <typename Iterator, class HandlerT> struct APIGrammar : qi::grammar<Ite
                qi::float_[boost::bind(&HandlerT::setMatchingBeta, handler, ::_1)];
         gps_precision = (-qi::lit('&')) >> qi::lit("gps_precision") >> '=' >>
                qi::float_[boost::bind(&HandlerT::setGPSPrecision, handler, ::_1)];
+        improvement_time = (-qi::lit('&')) >> qi::lit("improvement_time") >> '=' >>
+               qi::uint_[boost::bind(&HandlerT::setImprovementTime, handler, ::_1)];
         classify = (-qi::lit('&')) >> qi::lit("classify") >> '=' >>
             qi::bool_[boost::bind(&HandlerT::setClassify, handler, ::_1)];
+        profile = (-qi::lit('&')) >> qi::lit("profile") >> '=' >>
+                  stringwithDot[boost::bind(&HandlerT::setProfile, handler, ::_1)];
+        target_set = (-qi::lit('&')) >> qi::lit("target_set") >> '=' >>
+                     stringwithDot[boost::bind(&HandlerT::setTargetSet, handler, ::_1)];
+        session = (-qi::lit('&')) >> qi::lit("session") >> '=' >>
+                  stringwithDot[boost::bind(&HandlerT::setSession, handler, ::_1)];
+        lengths = (-qi::lit('&')) >> qi::lit("lengths") >> '=' >>
+                  qi::bool_[boost::bind(&HandlerT::setLengthsFlag, handler, ::_1)];
+        max_time = (-qi::lit('&')) >> qi::lit("max_time") >> '=' >>
+                   qi::uint_[boost::bind(&HandlerT::setMaxTime, handler, ::_1)];
+        hull = (-qi::lit('&')) >> qi::lit("hull") >> '=' >>
+               qi::bool_[boost::bind(&HandlerT::setHullFlag, handler, ::_1)];
+        timeout = (-qi::lit('&')) >> qi::lit("timeout") >> '=' >>
+                  qi::uint_[boost::bind(&HandlerT::setTimeout, handler, ::_1)];
+        max_duration = (-qi::lit('&')) >> qi::lit("max_duration") >> '=' >>
+                       qi::uint_[boost::bind(&HandlerT::setMaxDuration, handler, ::_1)];
+        source = (-qi::lit('&')) >> qi::lit("src") >> '=' >>
+                 qi::uint_[boost::bind(&HandlerT::addSource, handler, ::_1)];
+        destination = (-qi::lit('&')) >> qi::lit("dst") >> '=' >>
+                      qi::uint_[boost::bind(&HandlerT::addDestination, handler, ::_1)];
         locs = (-qi::lit('&')) >> qi::lit("locs") >> '=' >>
             stringforPolyline[boost::bind(&HandlerT::getCoordinatesFromGeometry, handler, ::_1)];
 
@@ -96,7 +123,9 @@ template <typename Iterator, class HandlerT> struct APIGrammar : qi::grammar<Ite
     qi::rule<Iterator> api_call, query;
     qi::rule<Iterator, std::string()> service, zoom, output, string, jsonp, checksum, location,
         hint, timestamp, stringwithDot, stringwithPercent, language, instruction, geometry, cmp, alt_route, u,
-        uturns, old_API, num_results, matching_beta, gps_precision, classify, locs, stringforPolyline;
+        uturns, old_API, num_results, matching_beta, gps_precision, improvement_time, classify,
+        locs, profile, stringforPolyline, bearing, target_set, session, source, destination,
+        lengths, max_time, hull, timeout, max_duration;
 
     HandlerT *handler;
 };
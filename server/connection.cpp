@@ -31,26 +31,81 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/assert.hpp>
 #include <boost/bind.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
 
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <cerrno>
+#endif
+
+#include <cstring>
 #include <string>
 #include <vector>
 
 namespace http
 {
 
-Connection::Connection(boost::asio::io_service &io_service, RequestHandler &handler)
-    : strand(io_service), TCP_socket(io_service), request_handler(handler)
+Connection::Connection(boost::asio::io_service &io_service,
+                       RequestHandler &handler,
+                       const unsigned keepalive_timeout,
+                       const unsigned keepalive_max_requests)
+    : strand(io_service), stream_socket(io_service), timer(io_service), request_handler(handler),
+      unparsed_begin(nullptr), unparsed_end(nullptr), keepalive_timeout(keepalive_timeout),
+      keepalive_max_requests(keepalive_max_requests), processed_requests(0)
 {
+    current_request.uri.reserve(512);
 }
 
-boost::asio::ip::tcp::socket &Connection::socket() { return TCP_socket; }
+boost::asio::generic::stream_protocol::socket &Connection::socket() { return stream_socket; }
 
 /// Start the first asynchronous operation for the connection.
 void Connection::start()
 {
-    TCP_socket.async_read_some(
+    // only TCP clients have an address, it stays unspecified for Unix domain sockets
+    boost::system::error_code error;
+    const auto endpoint = stream_socket.remote_endpoint(error);
+    const auto family = endpoint.protocol().family();
+    if (!error && (boost::asio::ip::tcp::v4().family() == family ||
+                   boost::asio::ip::tcp::v6().family() == family))
+    {
+        boost::asio::ip::tcp::endpoint tcp_endpoint;
+        std::memcpy(tcp_endpoint.data(), endpoint.data(), endpoint.size());
+        tcp_endpoint.resize(endpoint.size());
+        remote_address = tcp_endpoint.address();
+    }
+    async_read_more();
+}
+
+void Connection::recycle()
+{
+    boost::system::error_code ignore_error;
+    stream_socket.close(ignore_error);
+    timer.expires_at(boost::posix_time::pos_infin);
+    request_parser.reset();
+    current_request.clear();
+    current_request.client_gone = nullptr;
+    current_reply.clear();
+    // a single huge reply should not pin its memory for all requests that follow
+    if (current_reply.content.capacity() > MAX_RECYCLED_CONTENT_CAPACITY)
+    {
+        std::vector<char>().swap(current_reply.content);
+    }
+    remote_address = boost::asio::ip::address();
+    unparsed_begin = nullptr;
+    unparsed_end = nullptr;
+    processed_requests = 0;
+}
+
+void Connection::async_read_more()
+{
+    if (processed_requests > 0)
+    {
+        // an idle persistent connection gets closed after the timeout
+        timer.expires_from_now(boost::posix_time::seconds(keepalive_timeout));
+        timer.async_wait(strand.wrap(boost::bind(&Connection::handle_timeout,
+                                                 this->shared_from_this(),
+                                                 boost::asio::placeholders::error)));
+    }
+    stream_socket.async_read_some(
         boost::asio::buffer(incoming_data_buffer),
         strand.wrap(boost::bind(&Connection::handle_read, this->shared_from_this(),
                                 boost::asio::placeholders::error,
@@ -63,108 +118,138 @@ void Connection::handle_read(const boost::system::error_code &error, std::size_t
     {
         return;
     }
+    // disarm the idle timer, see handle_timeout
+    timer.expires_at(boost::posix_time::pos_infin);
+
+    process_data(incoming_data_buffer.data(), incoming_data_buffer.data() + bytes_transferred);
+}
 
+void Connection::process_data(char *begin, char *end)
+{
     // no error detected, let's parse the request
     compression_type compression_type(no_compression);
     osrm::tribool result;
-    std::tie(result, compression_type) =
-        request_parser.parse(current_request, incoming_data_buffer.data(),
-                             incoming_data_buffer.data() + bytes_transferred);
+    std::tie(result, compression_type, unparsed_begin) =
+        request_parser.parse(current_request, begin, end);
+    unparsed_end = end;
 
     // the request has been parsed
     if (result == osrm::tribool::yes)
     {
-        current_request.endpoint = TCP_socket.remote_endpoint().address();
+        ++processed_requests;
+        current_request.endpoint = remote_address;
+        current_request.compression = compression_type;
+        // the request is handled synchronously, so this connection outlives the checks
+        current_request.client_gone = [this]
+        {
+            return client_gone();
+        };
         request_handler.handle_request(current_request, current_reply);
 
-        // Header compression_header;
-        std::vector<boost::asio::const_buffer> output_buffer;
-
-        // compress the result w/ gzip/deflate if requested
-        switch (compression_type)
+        if (keep_connection_alive())
+        {
+            current_reply.headers.emplace_back("Connection", "keep-alive");
+            current_reply.headers.emplace_back(
+                "Keep-Alive", "timeout=" + std::to_string(keepalive_timeout) + ", max=" +
+                                  std::to_string(keepalive_max_requests - processed_requests));
+        }
+        else
         {
-        case deflate_rfc1951:
-            // use deflate for compression
-            current_reply.headers.insert(current_reply.headers.begin(),
-                                         {"Content-Encoding", "deflate"});
-            compressed_output = compress_buffers(current_reply.content, compression_type);
-            current_reply.set_size(static_cast<unsigned>(compressed_output.size()));
-            output_buffer = current_reply.headers_to_buffers();
-            output_buffer.push_back(boost::asio::buffer(compressed_output));
-            break;
-        case gzip_rfc1952:
-            // use gzip for compression
-            current_reply.headers.insert(current_reply.headers.begin(),
-                                         {"Content-Encoding", "gzip"});
-            compressed_output = compress_buffers(current_reply.content, compression_type);
-            current_reply.set_size(static_cast<unsigned>(compressed_output.size()));
-            output_buffer = current_reply.headers_to_buffers();
-            output_buffer.push_back(boost::asio::buffer(compressed_output));
-            break;
-        case no_compression:
-            // don't use any compression
-            current_reply.set_uncompressed_size();
-            output_buffer = current_reply.to_buffers();
-            break;
+            current_reply.headers.emplace_back("Connection", "close");
         }
+
+        // the request handler already compressed the content if requested
+        current_reply.set_uncompressed_size();
+        std::vector<boost::asio::const_buffer> output_buffer = current_reply.to_buffers();
         // write result to stream
         boost::asio::async_write(
-            TCP_socket, output_buffer,
+            stream_socket, output_buffer,
             strand.wrap(boost::bind(&Connection::handle_write, this->shared_from_this(),
                                     boost::asio::placeholders::error)));
     }
     else if (result == osrm::tribool::no)
     { // request is not parseable
-        current_reply = reply::stock_reply(reply::bad_request);
+        current_reply.set_stock_reply(reply::bad_request);
+        // the parser state is undefined, so there is no way to find the next request
+        current_request.keep_alive = false;
 
         boost::asio::async_write(
-            TCP_socket, current_reply.to_buffers(),
+            stream_socket, current_reply.to_buffers(),
             strand.wrap(boost::bind(&Connection::handle_write, this->shared_from_this(),
                                     boost::asio::placeholders::error)));
     }
     else
     {
         // we don't have a result yet, so continue reading
-        TCP_socket.async_read_some(
-            boost::asio::buffer(incoming_data_buffer),
-            strand.wrap(boost::bind(&Connection::handle_read, this->shared_from_this(),
-                                    boost::asio::placeholders::error,
-                                    boost::asio::placeholders::bytes_transferred)));
+        async_read_more();
     }
 }
 
+// An orderly shutdown reads as zero bytes, a reset as an error. Pipelined requests that are
+// still unread don't count as gone.
+bool Connection::client_gone()
+{
+#ifdef _WIN32
+    return false;
+#else
+    char next_byte;
+    const auto received =
+        ::recv(stream_socket.native_handle(), &next_byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return 0 == received ||
+           (received < 0 && EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno);
+#endif
+}
+
+bool Connection::keep_connection_alive() const
+{
+    return current_request.keep_alive && keepalive_timeout > 0 &&
+           processed_requests < keepalive_max_requests;
+}
+
 /// Handle completion of a write operation.
 void Connection::handle_write(const boost::system::error_code &error)
 {
-    if (!error)
+    if (error)
+    {
+        return;
+    }
+
+    if (!keep_connection_alive())
     {
         // Initiate graceful connection closure.
         boost::system::error_code ignore_error;
-        TCP_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignore_error);
+        stream_socket.shutdown(boost::asio::socket_base::shutdown_both, ignore_error);
+        return;
     }
-}
 
-std::vector<char> Connection::compress_buffers(const std::vector<char> &uncompressed_data,
-                                               const compression_type compression_type)
-{
-    boost::iostreams::gzip_params compression_parameters;
+    // reset state for the next request on this connection, buffers are reused
+    request_parser.reset();
+    current_request.clear();
+    current_reply.clear();
 
-    // there's a trade-off between speed and size. speed wins
-    compression_parameters.level = boost::iostreams::zlib::best_speed;
-    // check which compression flavor is used
-    if (deflate_rfc1951 == compression_type)
+    if (unparsed_begin != unparsed_end)
+    {
+        // a pipelined request is already buffered, no need to wait for the socket
+        process_data(unparsed_begin, unparsed_end);
+    }
+    else
     {
-        compression_parameters.noheader = true;
+        async_read_more();
     }
+}
 
-    std::vector<char> compressed_data;
-    // plug data into boost's compression stream
-    boost::iostreams::filtering_ostream gzip_stream;
-    gzip_stream.push(boost::iostreams::gzip_compressor(compression_parameters));
-    gzip_stream.push(boost::iostreams::back_inserter(compressed_data));
-    gzip_stream.write(&uncompressed_data[0], uncompressed_data.size());
-    boost::iostreams::close(gzip_stream);
+void Connection::handle_timeout(const boost::system::error_code &error)
+{
+    // the timer might have been re-armed or disarmed while this handler was queued
+    if (error == boost::asio::error::operation_aborted ||
+        timer.expires_at() > boost::asio::deadline_timer::traits_type::now())
+    {
+        return;
+    }
 
-    return compressed_data;
+    // idle timeout expired, close the connection which cancels the pending read
+    boost::system::error_code ignore_error;
+    stream_socket.shutdown(boost::asio::socket_base::shutdown_both, ignore_error);
+    stream_socket.close(ignore_error);
 }
 }
@@ -58,36 +58,63 @@ class RequestHandler;
 namespace http
 {
 
-/// Represents a single connection from a client.
+/// Represents a single connection from a client, over TCP or a Unix domain socket.
 class Connection : public std::enable_shared_from_this<Connection>
 {
   public:
-    explicit Connection(boost::asio::io_service &io_service, RequestHandler &handler);
+    explicit Connection(boost::asio::io_service &io_service,
+                        RequestHandler &handler,
+                        const unsigned keepalive_timeout,
+                        const unsigned keepalive_max_requests);
     Connection(const Connection &) = delete;
     Connection() = delete;
 
-    boost::asio::ip::tcp::socket &socket();
+    boost::asio::generic::stream_protocol::socket &socket();
 
     /// Start the first asynchronous operation for the connection.
     void start();
 
+    /// Close the socket and reset the state, so that the connection can be accepted again.
+    /// The buffers keep their capacity, see ConnectionPool.
+    void recycle();
+
   private:
     void handle_read(const boost::system::error_code &e, std::size_t bytes_transferred);
 
+    /// Parses the buffered data in [begin, end) and answers the next complete request.
+    void process_data(char *begin, char *end);
+
     /// Handle completion of a write operation.
     void handle_write(const boost::system::error_code &e);
 
-    std::vector<char> compress_buffers(const std::vector<char> &uncompressed_data,
-                                       const compression_type compression_type);
+    /// Handle expiry of the idle timer of a persistent connection.
+    void handle_timeout(const boost::system::error_code &e);
+
+    void async_read_more();
+
+    /// Keep the connection open after the current reply?
+    bool keep_connection_alive() const;
+
+    /// Did the client close the connection? Peeks at the socket without blocking.
+    bool client_gone();
+
+    static constexpr std::size_t MAX_RECYCLED_CONTENT_CAPACITY = 1024 * 1024;
 
     boost::asio::io_service::strand strand;
-    boost::asio::ip::tcp::socket TCP_socket;
+    boost::asio::generic::stream_protocol::socket stream_socket;
+    boost::asio::ip::address remote_address;
+    boost::asio::deadline_timer timer;
     RequestHandler &request_handler;
     RequestParser request_parser;
     boost::array<char, 8192> incoming_data_buffer;
+    // pipelined data that was received along with the current request
+    char *unparsed_begin;
+    char *unparsed_end;
+    const unsigned keepalive_timeout;
+    const unsigned keepalive_max_requests;
+    unsigned processed_requests;
     request current_request;
     reply current_reply;
-    std::vector<char> compressed_output;
 };
 
 } // namespace http
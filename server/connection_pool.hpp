@@ -0,0 +1,119 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef CONNECTION_POOL_HPP
+#define CONNECTION_POOL_HPP
+
+#include "connection.hpp"
+
+#include <boost/asio.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class RequestHandler;
+
+namespace http
+{
+
+// Hands out the connections of one reactor. A connection that is done goes back to the pool
+// instead of being freed, and the next accept reuses it along with its receive buffer, parser
+// and reply buffers. Steady-state serving thus does not allocate per connection. At most
+// max_idle_connections are kept. Connections that outlive the pool are simply freed.
+class ConnectionPool final : public std::enable_shared_from_this<ConnectionPool>
+{
+  public:
+    ConnectionPool(boost::asio::io_service &io_service,
+                   RequestHandler &request_handler,
+                   const unsigned keepalive_timeout,
+                   const unsigned keepalive_max_requests,
+                   const std::size_t max_idle_connections)
+        : io_service(io_service), request_handler(request_handler),
+          keepalive_timeout(keepalive_timeout), keepalive_max_requests(keepalive_max_requests),
+          max_idle_connections(max_idle_connections)
+    {
+    }
+
+    std::shared_ptr<Connection> Acquire()
+    {
+        std::unique_ptr<Connection> connection;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!idle_connections.empty())
+            {
+                connection = std::move(idle_connections.back());
+                idle_connections.pop_back();
+            }
+        }
+        if (!connection)
+        {
+            connection.reset(new Connection(io_service, request_handler, keepalive_timeout,
+                                            keepalive_max_requests));
+        }
+        // a strong reference would never let go of the pool, the idle connections keep the
+        // control blocks of their last owners alive
+        const std::weak_ptr<ConnectionPool> weak_pool = shared_from_this();
+        return std::shared_ptr<Connection>(connection.release(), [weak_pool](Connection *released)
+                                           {
+                                               const auto pool = weak_pool.lock();
+                                               if (pool)
+                                               {
+                                                   pool->Release(released);
+                                               }
+                                               else
+                                               {
+                                                   delete released;
+                                               }
+                                           });
+    }
+
+  private:
+    // called by the last owner of a connection, from any thread of the reactor
+    void Release(Connection *released)
+    {
+        std::unique_ptr<Connection> connection(released);
+        connection->recycle();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (idle_connections.size() < max_idle_connections)
+        {
+            idle_connections.push_back(std::move(connection));
+        }
+    }
+
+    boost::asio::io_service &io_service;
+    RequestHandler &request_handler;
+    const unsigned keepalive_timeout;
+    const unsigned keepalive_max_requests;
+    const std::size_t max_idle_connections;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Connection>> idle_connections;
+};
+}
+
+#endif // CONNECTION_POOL_HPP
@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../data_structures/edge_based_node.hpp"
 #include "../../data_structures/external_memory_node.hpp"
 #include "../../data_structures/phantom_node.hpp"
+#include "../../data_structures/shortcut_cache.hpp"
 #include "../../data_structures/turn_instructions.hpp"
 #include "../../util/integer_range.hpp"
 #include "../../util/osrm_exception.hpp"
@@ -41,6 +42,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/coordinate.hpp>
 
+#include <boost/range/iterator_range.hpp>
+#include <boost/utility/string_ref.hpp>
+
+#include <cstdint>
 #include <string>
 
 using EdgeRange = osrm::range<EdgeID>;
@@ -50,6 +55,7 @@ template <class EdgeDataT> class BaseDataFacade
   public:
     using RTreeLeaf = EdgeBasedNode;
     using EdgeData = EdgeDataT;
+    using GeometryRange = boost::iterator_range<const unsigned *>;
     BaseDataFacade() {}
     virtual ~BaseDataFacade() {}
 
@@ -62,7 +68,8 @@ template <class EdgeDataT> class BaseDataFacade
 
     virtual NodeID GetTarget(const EdgeID e) const = 0;
 
-    virtual const EdgeDataT &GetEdgeData(const EdgeID e) const = 0;
+    // by value, so that a graph may decode packed edges
+    virtual EdgeDataT GetEdgeData(const EdgeID e) const = 0;
 
     virtual EdgeID BeginEdges(const NodeID n) const = 0;
 
@@ -70,6 +77,9 @@ template <class EdgeDataT> class BaseDataFacade
 
     virtual EdgeRange GetAdjacentEdgeRange(const NodeID node) const = 0;
 
+    // loads the first edges of a node into the cache, a search calls it for the node it settles next
+    virtual void PrefetchAdjacentEdges(const NodeID node) const = 0;
+
     // searches for a specific edge
     virtual EdgeID FindEdge(const NodeID from, const NodeID to) const = 0;
 
@@ -85,8 +95,21 @@ template <class EdgeDataT> class BaseDataFacade
 
     virtual unsigned GetGeometryIndexForEdgeID(const unsigned id) const = 0;
 
-    virtual void GetUncompressedGeometry(const unsigned id,
-                                         std::vector<unsigned> &result_nodes) const = 0;
+    // the nodes of a compressed geometry in place, valid as long as the facade. Encoded
+    // geometries are decoded into a buffer of the calling thread, valid until its next call.
+    virtual GeometryRange GetUncompressedGeometryRange(const unsigned id) const = 0;
+
+    void GetUncompressedGeometry(const unsigned id, std::vector<unsigned> &result_nodes) const
+    {
+        const GeometryRange geometry = GetUncompressedGeometryRange(id);
+        result_nodes.assign(geometry.begin(), geometry.end());
+    }
+
+    // the generalization levels of a compressed geometry in the order of its nodes,
+    // nullptr if osrm-prepare did not compute them
+    virtual const std::uint8_t *GetUncompressedGeometryZoomLevels(const unsigned id) const = 0;
+
+    virtual bool HasGeometryZoomLevels() const = 0;
 
     virtual TurnInstruction GetTurnInstructionForEdgeID(const unsigned id) const = 0;
 
@@ -96,10 +119,13 @@ template <class EdgeDataT> class BaseDataFacade
                                                     FixedPointCoordinate &result,
                                                     const unsigned zoom_level = 18) = 0;
 
+    // bearing_range of 180 or more disables the bearing filter
     virtual bool
     IncrementalFindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
                                             std::vector<PhantomNode> &resulting_phantom_node_vector,
-                                            const unsigned number_of_results) = 0;
+                                            const unsigned number_of_results,
+                                            const int bearing = 0,
+                                            const int bearing_range = 180) = 0;
 
     virtual bool
     IncrementalFindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
@@ -109,13 +135,42 @@ template <class EdgeDataT> class BaseDataFacade
         std::vector<std::pair<PhantomNode, double>> &resulting_phantom_node_vector,
         const double max_distance) = 0;
 
+    // one candidate list per coordinate, nearby coordinates share their tree traversal
+    virtual void IncrementalFindPhantomNodesForCoordinatesWithMaxDistance(
+        const std::vector<FixedPointCoordinate> &input_coordinates,
+        std::vector<std::vector<std::pair<PhantomNode, double>>> &resulting_phantom_node_vectors,
+        const double max_distance) = 0;
+
     virtual unsigned GetCheckSum() const = 0;
 
+    // nullptr unless the facade caches the unpacked shortcuts of its graph
+    virtual ShortcutCache *GetShortcutCache() const = 0;
+
+    // Faults in the pages of the data, so that the first queries do not wait for them. Facades
+    // that read the data into the heap have it resident already.
+    virtual void Prefault() const {}
+
     virtual bool IsCoreNode(const NodeID id) const = 0;
 
+    // false if the graph is contracted completely, no node is a core node then
+    virtual bool HasCore() const = 0;
+
+    // 0 if no landmarks were loaded
+    virtual unsigned GetNumberOfLandmarks() const = 0;
+
+    // distances from and to every landmark, nullptr for nodes outside of the core
+    virtual const EdgeWeight *GetLandmarkDistances(const NodeID id) const = 0;
+
     virtual unsigned GetNameIndexFromEdgeID(const unsigned id) const = 0;
 
-    virtual std::string get_name_for_id(const unsigned name_id) const = 0;
+    // the view points into the facade's name block and stays valid as long as the facade
+    virtual boost::string_ref get_name_ref_for_id(const unsigned name_id) const = 0;
+
+    std::string get_name_for_id(const unsigned name_id) const
+    {
+        const boost::string_ref name = get_name_ref_for_id(name_id);
+        return std::string(name.begin(), name.end());
+    }
 
     virtual std::string GetTimestamp() const = 0;
 };
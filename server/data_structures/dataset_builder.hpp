@@ -0,0 +1,1028 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef DATASET_BUILDER_HPP
+#define DATASET_BUILDER_HPP
+
+#include "datafacade_base.hpp"
+#include "shared_datatype.hpp"
+#include "../../data_structures/geometry_encoding.hpp"
+#include "../../data_structures/landmark_table.hpp"
+#include "../../data_structures/original_edge_data.hpp"
+#include "../../data_structures/query_edge.hpp"
+#include "../../data_structures/query_node.hpp"
+#include "../../data_structures/range_table.hpp"
+#include "../../data_structures/segment_grid.hpp"
+#include "../../data_structures/shared_memory_vector_wrapper.hpp"
+#include "../../data_structures/split_query_graph.hpp"
+#include "../../data_structures/static_graph.hpp"
+#include "../../data_structures/static_kdtree.hpp"
+#include "../../data_structures/static_rtree.hpp"
+#include "../../data_structures/travel_mode.hpp"
+#include "../../data_structures/turn_instructions.hpp"
+#include "../../util/fingerprint.hpp"
+#include "../../util/graph_loader.hpp"
+#include "../../util/integer_range.hpp"
+#include "../../util/make_unique.hpp"
+#include "../../util/osrm_exception.hpp"
+#include "../../util/simple_logger.hpp"
+#include "../../typedefs.h"
+
+#include <osrm/coordinate.hpp>
+#include <osrm/server_paths.hpp>
+
+#include <boost/assert.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iostreams/seek.hpp>
+
+#include <tbb/task_group.h>
+
+#include <cstdint>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reshapes the files of osrm-extract and osrm-prepare into the blocks of a SharedDataLayout.
+// osrm-datastore fills shared memory with it, osrm-prepare --image and osrm-datastore --image
+// write it to a dataset image that needs no conversion anymore.
+class DatasetBuilder
+{
+    using RTreeLeaf = BaseDataFacade<QueryEdge::EdgeData>::RTreeLeaf;
+    using RTreeNode =
+        StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true>::TreeNode;
+    using QueryGraph = StaticGraph<QueryEdge::EdgeData>;
+    using SplitGraph = SplitQueryGraph<true>;
+    using SegmentGridT = SegmentGrid<RTreeLeaf, true>;
+    using LandmarkTableT = LandmarkTable<true>;
+
+    // records of the per-record files that are converted through a buffer of this size
+    static const unsigned READ_BUFFER_RECORDS = 1u << 16;
+
+  public:
+    // Opens the input files and sizes the blocks of the layout. Throws if a required file is
+    // not among the paths.
+    DatasetBuilder(const ServerPaths &server_paths,
+                   const bool split_query_graph,
+                   SharedDataLayout &layout)
+        : split_query_graph(split_query_graph), layout(layout)
+    {
+        if (server_paths.find("hsgrdata") == server_paths.end())
+        {
+            throw osrm::exception("no hsgr file found");
+        }
+        if (server_paths.find("ramindex") == server_paths.end())
+        {
+            throw osrm::exception("no ram index file found");
+        }
+        if (server_paths.find("fileindex") == server_paths.end())
+        {
+            throw osrm::exception("no leaf index file found");
+        }
+        if (server_paths.find("nodesdata") == server_paths.end())
+        {
+            throw osrm::exception("no nodes file found");
+        }
+        if (server_paths.find("edgesdata") == server_paths.end())
+        {
+            throw osrm::exception("no edges file found");
+        }
+        if (server_paths.find("namesdata") == server_paths.end())
+        {
+            throw osrm::exception("no names file found");
+        }
+        if (server_paths.find("geometry") == server_paths.end())
+        {
+            throw osrm::exception("no geometry file found");
+        }
+        if (server_paths.find("core") == server_paths.end())
+        {
+            throw osrm::exception("no core file found");
+        }
+
+        ServerPaths::const_iterator paths_iterator = server_paths.find("hsgrdata");
+        BOOST_ASSERT(server_paths.end() != paths_iterator);
+        BOOST_ASSERT(!paths_iterator->second.empty());
+        hsgr_path = paths_iterator->second;
+        paths_iterator = server_paths.find("timestamp");
+        BOOST_ASSERT(server_paths.end() != paths_iterator);
+        BOOST_ASSERT(!paths_iterator->second.empty());
+        timestamp_path = paths_iterator->second;
+        paths_iterator = server_paths.find("ramindex");
+        BOOST_ASSERT(server_paths.end() != paths_iterator);
+        BOOST_ASSERT(!paths_iterator->second.empty());
+        ram_index_path = paths_iterator->second;
+        paths_iterator = server_paths.find("fileindex");
+        BOOST_ASSERT(server_paths.end() != paths_iterator);
+        BOOST_ASSERT(!paths_iterator->second.empty());
+        file_index_path = boost::filesystem::canonical(paths_iterator->second).string();
+        paths_iterator = server_paths.find("nodesdata");
+        BOOST_ASSERT(server_paths.end() != paths_iterator);
+        BOOST_ASSERT(!paths_iterator->second.empty());
+        nodes_data_path = paths_iterator->second;
+        paths_iterator = server_paths.find("edgesdata");
+        BOOST_ASSERT(server_paths.end() != paths_iterator);
+        BOOST_ASSERT(!paths_iterator->second.empty());
+        edges_data_path = paths_iterator->second;
+        paths_iterator = server_paths.find("namesdata");
+        BOOST_ASSERT(server_paths.end() != paths_iterator);
+        BOOST_ASSERT(!paths_iterator->second.empty());
+        names_data_path = paths_iterator->second;
+        paths_iterator = server_paths.find("geometry");
+        BOOST_ASSERT(server_paths.end() != paths_iterator);
+        BOOST_ASSERT(!paths_iterator->second.empty());
+        geometries_data_path = paths_iterator->second;
+        paths_iterator = server_paths.find("core");
+        BOOST_ASSERT(server_paths.end() != paths_iterator);
+        BOOST_ASSERT(!paths_iterator->second.empty());
+        core_marker_path = paths_iterator->second;
+        // the segment grid is optional
+        paths_iterator = server_paths.find("gridindex");
+        if (server_paths.end() != paths_iterator &&
+            boost::filesystem::exists(paths_iterator->second))
+        {
+            grid_index_path = paths_iterator->second;
+        }
+        // so is the kd-tree of /locate
+        paths_iterator = server_paths.find("locateindex");
+        if (server_paths.end() != paths_iterator &&
+            boost::filesystem::exists(paths_iterator->second))
+        {
+            locate_index_path = paths_iterator->second;
+        }
+        // and the core landmarks
+        paths_iterator = server_paths.find("landmarks");
+        if (server_paths.end() != paths_iterator &&
+            boost::filesystem::exists(paths_iterator->second))
+        {
+            landmark_path = paths_iterator->second;
+        }
+        // and the edge weights of osrm-customize, which replace the ones of the .hsgr
+        paths_iterator = server_paths.find("weights");
+        if (server_paths.end() != paths_iterator &&
+            boost::filesystem::exists(paths_iterator->second))
+        {
+            weights_path = paths_iterator->second;
+        }
+
+        layout.SetBlockSize<char>(SharedDataLayout::FILE_INDEX_PATH, file_index_path.length() + 1);
+
+        // collect number of elements to store in shared memory object
+        SimpleLogger().Write() << "load names from: " << names_data_path;
+        // number of entries in name index
+        name_stream.open(names_data_path, std::ios::binary);
+        unsigned name_blocks = 0;
+        name_stream.read((char *)&name_blocks, sizeof(unsigned));
+        layout.SetBlockSize<unsigned>(SharedDataLayout::NAME_OFFSETS, name_blocks);
+        layout.SetBlockSize<typename RangeTable<16, true>::BlockT>(
+            SharedDataLayout::NAME_BLOCKS, name_blocks);
+        SimpleLogger().Write() << "name offsets size: " << name_blocks;
+        BOOST_ASSERT_MSG(0 != name_blocks, "name file broken");
+
+        unsigned number_of_chars = 0;
+        name_stream.read((char *)&number_of_chars, sizeof(unsigned));
+        layout.SetBlockSize<char>(SharedDataLayout::NAME_CHAR_LIST, number_of_chars);
+
+        // Loading information for original edges
+        edges_input_stream.open(edges_data_path, std::ios::binary);
+        edges_input_stream.read((char *)&number_of_original_edges, sizeof(unsigned));
+
+        // note: settings this all to the same size is correct, we extract them from the same struct
+        layout.SetBlockSize<NodeID>(SharedDataLayout::VIA_NODE_LIST, number_of_original_edges);
+        // the name ids are stored once per run of edges with the same name
+        layout.SetBlockSize<unsigned>(
+            SharedDataLayout::NAME_ID_LIST,
+            ReadNumberOfNameRuns(edges_input_stream, number_of_original_edges));
+        layout.SetBlockSize<uint64_t>(SharedDataLayout::NAME_ID_RUN_STARTS,
+                                      number_of_original_edges);
+        // note: the travel modes, turn instructions and geometry indicators are packed into words
+        layout.SetBlockSize<uint64_t>(SharedDataLayout::TRAVEL_MODE, number_of_original_edges);
+        layout.SetBlockSize<uint64_t>(SharedDataLayout::TURN_INSTRUCTION, number_of_original_edges);
+        layout.SetBlockSize<uint64_t>(SharedDataLayout::GEOMETRIES_INDICATORS,
+                                      number_of_original_edges);
+
+        hsgr_input_stream.open(hsgr_path, std::ios::binary);
+
+        FingerPrint fingerprint_valid = FingerPrint::GetValid();
+        FingerPrint fingerprint_loaded;
+        hsgr_input_stream.read((char *)&fingerprint_loaded, sizeof(FingerPrint));
+        if (fingerprint_loaded.TestGraphUtil(fingerprint_valid))
+        {
+            SimpleLogger().Write(logDEBUG) << "Fingerprint checked out ok";
+        }
+        else
+        {
+            SimpleLogger().Write(logWARNING) << ".hsgr was prepared with different build. "
+                                                "Reprocess to get rid of this warning.";
+        }
+
+        // load checksum
+        hsgr_input_stream.read((char *)&checksum, sizeof(unsigned));
+        layout.SetBlockSize<unsigned>(SharedDataLayout::HSGR_CHECKSUM, 1);
+        // load graph node size
+        unsigned number_of_graph_nodes = 0;
+        hsgr_input_stream.read((char *)&number_of_graph_nodes, sizeof(unsigned));
+
+        BOOST_ASSERT_MSG((0 != number_of_graph_nodes), "number of nodes is zero");
+        layout.SetBlockSize<QueryGraph::NodeArrayEntry>(
+            SharedDataLayout::GRAPH_NODE_LIST, number_of_graph_nodes);
+
+        // load graph edge size
+        hsgr_input_stream.read((char *)&number_of_graph_edges, sizeof(unsigned));
+        // BOOST_ASSERT_MSG(0 != number_of_graph_edges, "number of graph edges is zero");
+        if (split_query_graph)
+        {
+            layout.SetBlockSize<SplitGraph::HotEdgeEntry>(
+                SharedDataLayout::GRAPH_EDGE_LIST, number_of_graph_edges);
+            layout.SetBlockSize<SplitGraph::ColdEdgeEntry>(
+                SharedDataLayout::GRAPH_EDGE_IDS, number_of_graph_edges);
+        }
+        else
+        {
+            layout.SetBlockSize<QueryGraph::EdgeArrayEntry>(
+                SharedDataLayout::GRAPH_EDGE_LIST, number_of_graph_edges);
+        }
+
+        // load rsearch tree size
+        tree_node_file.open(ram_index_path, std::ios::binary);
+
+        tree_node_file.read((char *)&tree_size, sizeof(uint32_t));
+        if (boost::filesystem::file_size(ram_index_path) !=
+            sizeof(uint32_t) + uint64_t(tree_size) * sizeof(RTreeNode))
+        {
+            throw osrm::exception("ram index file was built with a different r-tree layout");
+        }
+        layout.SetBlockSize<RTreeNode>(SharedDataLayout::R_SEARCH_TREE, tree_size);
+
+        // load timestamp size
+        if (boost::filesystem::exists(timestamp_path))
+        {
+            boost::filesystem::ifstream timestamp_stream(timestamp_path);
+            if (!timestamp_stream)
+            {
+                SimpleLogger().Write(logWARNING) << timestamp_path
+                                                 << " not found. setting to default";
+            }
+            else
+            {
+                getline(timestamp_stream, m_timestamp);
+                timestamp_stream.close();
+            }
+        }
+        if (m_timestamp.empty())
+        {
+            m_timestamp = "n/a";
+        }
+        if (25 < m_timestamp.length())
+        {
+            m_timestamp.resize(25);
+        }
+        layout.SetBlockSize<char>(SharedDataLayout::TIMESTAMP, m_timestamp.length());
+
+        // load core marker size
+        core_marker_file.open(core_marker_path, std::ios::binary);
+
+        core_marker_file.read((char *)&number_of_core_markers, sizeof(uint32_t));
+        layout.SetBlockSize<uint64_t>(SharedDataLayout::CORE_MARKER, number_of_core_markers);
+
+        // load segment grid size
+        if (!grid_index_path.empty())
+        {
+            grid_index_file.open(grid_index_path, std::ios::binary);
+            const SegmentGridT::GridHeader grid_header = SegmentGridT::ReadHeader(grid_index_file);
+            layout.SetBlockSize<uint64_t>(SharedDataLayout::GRID_CELL_IDS,
+                                          grid_header.number_of_cells);
+            layout.SetBlockSize<uint32_t>(SharedDataLayout::GRID_CELL_OFFSETS,
+                                          grid_header.number_of_cells + 1);
+            layout.SetBlockSize<RTreeLeaf>(SharedDataLayout::GRID_SEGMENTS,
+                                           grid_header.number_of_segments);
+        }
+
+        // load kd-tree size
+        if (!locate_index_path.empty())
+        {
+            locate_index_file.open(locate_index_path, std::ios::binary);
+            const StaticKDTree<true>::KDTreeHeader locate_index_header =
+                StaticKDTree<true>::ReadHeader(locate_index_file);
+            layout.SetBlockSize<FixedPointCoordinate>(
+                SharedDataLayout::LOCATE_INDEX, locate_index_header.number_of_points);
+        }
+
+        // load landmark sizes
+        if (!landmark_path.empty())
+        {
+            landmark_file.open(landmark_path, std::ios::binary);
+            const LandmarkTableT::LandmarkHeader landmark_header =
+                LandmarkTableT::ReadHeader(landmark_file);
+            layout.SetBlockSize<NodeID>(SharedDataLayout::LANDMARK_NODES,
+                                        landmark_header.number_of_landmarks);
+            layout.SetBlockSize<uint32_t>(SharedDataLayout::LANDMARK_CORE_INDEX,
+                                          landmark_header.number_of_nodes);
+            layout.SetBlockSize<EdgeWeight>(
+                SharedDataLayout::LANDMARK_DISTANCES,
+                uint64_t(landmark_header.number_of_core_nodes) * 2 *
+                    landmark_header.number_of_landmarks);
+        }
+
+        // load coordinate size
+        nodes_input_stream.open(nodes_data_path, std::ios::binary);
+        nodes_input_stream.read((char *)&coordinate_list_size, sizeof(unsigned));
+        layout.SetBlockSize<FixedPointCoordinate>(SharedDataLayout::COORDINATE_LIST,
+                                                  coordinate_list_size);
+        // the projected latitudes are optional and follow the nodes
+        nodes_input_stream.seekg(sizeof(unsigned) +
+                                 uint64_t(coordinate_list_size) * sizeof(QueryNode));
+        unsigned projected_latitude_list_size = 0;
+        if (!nodes_input_stream.read((char *)&projected_latitude_list_size, sizeof(unsigned)) ||
+            projected_latitude_list_size != coordinate_list_size)
+        {
+            projected_latitude_list_size = 0;
+        }
+        nodes_input_stream.clear();
+        nodes_input_stream.seekg(sizeof(unsigned));
+        layout.SetBlockSize<double>(SharedDataLayout::PROJECTED_LATITUDE_LIST,
+                                    projected_latitude_list_size);
+
+        // load geometries sizes
+        geometry_input_stream.open(geometries_data_path.string().c_str(), std::ios::binary);
+        unsigned number_of_geometries_indices = 0;
+        unsigned number_of_compressed_geometries = 0;
+
+        geometry_input_stream.read((char *)&number_of_geometries_indices, sizeof(unsigned));
+        layout.SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_INDEX,
+                                      number_of_geometries_indices);
+        boost::iostreams::seek(geometry_input_stream,
+                               number_of_geometries_indices * sizeof(unsigned), BOOST_IOS::cur);
+        geometry_input_stream.read((char *)&number_of_compressed_geometries, sizeof(unsigned));
+        layout.SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_LIST,
+                                      number_of_compressed_geometries);
+        // the generalization levels are optional, files without them end after the geometries
+        boost::iostreams::seek(geometry_input_stream,
+                               number_of_compressed_geometries * sizeof(unsigned), BOOST_IOS::cur);
+        unsigned number_of_zoom_levels = 0;
+        if (!geometry_input_stream.read((char *)&number_of_zoom_levels, sizeof(unsigned)))
+        {
+            number_of_zoom_levels = 0;
+            geometry_input_stream.clear();
+        }
+        layout.SetBlockSize<std::uint8_t>(SharedDataLayout::GEOMETRIES_ZOOM_LEVELS,
+                                          number_of_zoom_levels);
+        // the encoded geometries follow the zoom levels, they replace the plain node ids
+        unsigned number_of_block_offsets = 0;
+        unsigned number_of_encoded_bytes = 0;
+        boost::iostreams::seek(geometry_input_stream,
+                               number_of_zoom_levels * sizeof(std::uint8_t), BOOST_IOS::cur);
+        if (number_of_geometries_indices > 0 &&
+            geometry_input_stream.read((char *)&number_of_block_offsets, sizeof(unsigned)) &&
+            geometry_encoding::GetNumberOfBlocks(number_of_geometries_indices - 1) + 1 ==
+                number_of_block_offsets)
+        {
+            boost::iostreams::seek(geometry_input_stream,
+                                   number_of_block_offsets * sizeof(unsigned), BOOST_IOS::cur);
+            if (!geometry_input_stream.read((char *)&number_of_encoded_bytes, sizeof(unsigned)))
+            {
+                number_of_encoded_bytes = 0;
+            }
+        }
+        geometry_input_stream.clear();
+        if (0 == number_of_encoded_bytes)
+        {
+            number_of_block_offsets = 0;
+        }
+        else
+        {
+            layout.SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_LIST, 0);
+        }
+        layout.SetBlockSize<unsigned>(SharedDataLayout::GEOMETRIES_BLOCK_OFFSETS,
+                                      number_of_block_offsets);
+        layout.SetBlockSize<std::uint8_t>(SharedDataLayout::GEOMETRIES_ENCODED_LIST,
+                                          number_of_encoded_bytes);
+        std::vector<boost::filesystem::path> static_block_paths = {
+            names_data_path, edges_data_path, geometries_data_path,
+            nodes_data_path, ram_index_path,  core_marker_path};
+        if (!grid_index_path.empty())
+        {
+            static_block_paths.push_back(grid_index_path);
+        }
+        if (!locate_index_path.empty())
+        {
+            static_block_paths.push_back(locate_index_path);
+        }
+        layout.static_blocks_fingerprint =
+            fingerprint_files(static_block_paths, file_index_path + m_timestamp);
+    }
+
+    // Fills the blocks of the layout. The static blocks are left alone if static_memory is null,
+    // so a previously published copy of them can be kept.
+    void Load(char *data_memory, char *static_memory)
+    {
+        // hsgr checksum
+        unsigned *checksum_ptr = layout.GetBlockPtr<unsigned, true>(
+            data_memory, SharedDataLayout::HSGR_CHECKSUM);
+        *checksum_ptr = checksum;
+
+        // Every file is read by its own task straight into its blocks. The blocks are disjoint,
+        // so the reads run concurrently and the tasks fault in the shared pages they write.
+        tbb::task_group loaders;
+        if (nullptr != static_memory)
+        {
+            // ram index file name
+            char *file_index_path_ptr = layout.GetBlockPtr<char, true>(
+                static_memory, SharedDataLayout::FILE_INDEX_PATH);
+            // make sure we have 0 ending
+            std::fill(file_index_path_ptr,
+                      file_index_path_ptr +
+                          layout.GetBlockSize(SharedDataLayout::FILE_INDEX_PATH),
+                      0);
+            std::copy(file_index_path.begin(), file_index_path.end(), file_index_path_ptr);
+
+            // store timestamp
+            char *timestamp_ptr = layout.GetBlockPtr<char, true>(
+                static_memory, SharedDataLayout::TIMESTAMP);
+            std::copy(m_timestamp.c_str(), m_timestamp.c_str() + m_timestamp.length(),
+                      timestamp_ptr);
+
+            // Loading street names
+            loaders.run([&, static_memory]
+                        {
+                            LoadStreetNames(name_stream, layout, static_memory);
+                        });
+
+            // load original edge information
+            loaders.run([&, static_memory]
+                        {
+                            LoadOriginalEdges(edges_input_stream, number_of_original_edges,
+                                              layout, static_memory);
+                        });
+
+            // load compressed geometry
+            loaders.run([&, static_memory]
+                        {
+                            LoadGeometries(geometry_input_stream, layout,
+                                           static_memory);
+                        });
+
+            // Loading list of coordinates
+            loaders.run([&, static_memory]
+                        {
+                            LoadCoordinates(nodes_input_stream, coordinate_list_size,
+                                            layout, static_memory);
+                        });
+
+            // store search tree portion of rtree
+            loaders.run([&, static_memory]
+                        {
+                            char *rtree_ptr = layout.GetBlockPtr<char, true>(
+                                static_memory, SharedDataLayout::R_SEARCH_TREE);
+                            if (tree_size > 0)
+                            {
+                                tree_node_file.read(rtree_ptr, sizeof(RTreeNode) * tree_size);
+                            }
+                            tree_node_file.close();
+                        });
+
+            // load core markers, the segment grid and the kd-tree
+            loaders.run([&, static_memory]
+                        {
+                            LoadCoreMarkers(core_marker_file, number_of_core_markers,
+                                            layout, static_memory);
+                            LoadSegmentGrid(grid_index_file, !grid_index_path.empty(),
+                                            layout, static_memory);
+                            LoadLocateIndex(locate_index_file, !locate_index_path.empty(),
+                                            layout, static_memory);
+                        });
+        }
+
+        // load the search graph
+        loaders.run([&]
+                    {
+                        LoadGraph(hsgr_input_stream, layout, data_memory);
+                        if (!weights_path.empty() && split_query_graph)
+                        {
+                            readHSGRWeightsFromStream(
+                                weights_path, checksum,
+                                layout.GetBlockPtr<SplitGraph::HotEdgeEntry, true>(
+                                    data_memory, SharedDataLayout::GRAPH_EDGE_LIST),
+                                number_of_graph_edges);
+                        }
+                        else if (!weights_path.empty())
+                        {
+                            readHSGRWeightsFromStream(
+                                weights_path, checksum,
+                                layout.GetBlockPtr<QueryGraph::EdgeArrayEntry, true>(
+                                    data_memory, SharedDataLayout::GRAPH_EDGE_LIST),
+                                number_of_graph_edges);
+                        }
+                    });
+
+        // load the core landmarks
+        loaders.run([&]
+                    {
+                        LoadLandmarks(landmark_file, !landmark_path.empty(), layout,
+                                      data_memory);
+                    });
+        loaders.wait();
+    }
+
+  private:
+    const bool split_query_graph;
+    SharedDataLayout &layout;
+
+    boost::filesystem::path hsgr_path;
+    boost::filesystem::path timestamp_path;
+    boost::filesystem::path ram_index_path;
+    std::string file_index_path;
+    boost::filesystem::path nodes_data_path;
+    boost::filesystem::path edges_data_path;
+    boost::filesystem::path names_data_path;
+    boost::filesystem::path geometries_data_path;
+    boost::filesystem::path core_marker_path;
+    boost::filesystem::path grid_index_path;
+    boost::filesystem::path locate_index_path;
+    boost::filesystem::path landmark_path;
+    boost::filesystem::path weights_path;
+
+    boost::filesystem::ifstream name_stream;
+    boost::filesystem::ifstream edges_input_stream;
+    boost::filesystem::ifstream hsgr_input_stream;
+    boost::filesystem::ifstream tree_node_file;
+    boost::filesystem::ifstream core_marker_file;
+    boost::filesystem::ifstream grid_index_file;
+    boost::filesystem::ifstream locate_index_file;
+    boost::filesystem::ifstream landmark_file;
+    boost::filesystem::ifstream nodes_input_stream;
+    std::ifstream geometry_input_stream;
+
+    unsigned number_of_original_edges = 0;
+    unsigned checksum = 0;
+    unsigned number_of_graph_edges = 0;
+    uint32_t tree_size = 0;
+    std::string m_timestamp;
+    uint32_t number_of_core_markers = 0;
+    unsigned coordinate_list_size = 0;
+
+    // Content hash of the given files. Their blocks are only reloaded if it changed.
+    static uint64_t fingerprint_files(const std::vector<boost::filesystem::path> &paths,
+                                      const std::string &salt)
+    {
+        // FNV-1a, 64 bit
+        const uint64_t prime = 1099511628211ULL;
+        uint64_t hash = 14695981039346656037ULL;
+        const auto add_bytes = [&](const char *bytes, const std::size_t length)
+        {
+            for (std::size_t i = 0; i < length; ++i)
+            {
+                hash = (hash ^ static_cast<unsigned char>(bytes[i])) * prime;
+            }
+        };
+
+        add_bytes(salt.data(), salt.size());
+        std::vector<char> buffer(1 << 20);
+        for (const auto &path : paths)
+        {
+            boost::filesystem::ifstream input_stream(path, std::ios::binary);
+            while (input_stream)
+            {
+                input_stream.read(buffer.data(), buffer.size());
+                const std::size_t length = static_cast<std::size_t>(input_stream.gcount());
+                // whole words at once, the byte loop would dominate the load time otherwise
+                const std::size_t words = length / sizeof(uint64_t);
+                for (std::size_t i = 0; i < words; ++i)
+                {
+                    uint64_t word;
+                    std::copy(buffer.data() + i * sizeof(uint64_t),
+                              buffer.data() + (i + 1) * sizeof(uint64_t), (char *)&word);
+                    hash = (hash ^ word) * prime;
+                }
+                add_bytes(buffer.data() + words * sizeof(uint64_t), length % sizeof(uint64_t));
+            }
+        }
+        return hash;
+    }
+
+
+    static void
+    LoadStreetNames(std::istream &name_stream, SharedDataLayout &layout, char *memory_ptr)
+    {
+        unsigned *name_offsets_ptr =
+            layout.GetBlockPtr<unsigned, true>(memory_ptr, SharedDataLayout::NAME_OFFSETS);
+        if (layout.GetBlockSize(SharedDataLayout::NAME_OFFSETS) > 0)
+        {
+            name_stream.read((char *)name_offsets_ptr,
+                             layout.GetBlockSize(SharedDataLayout::NAME_OFFSETS));
+        }
+
+        unsigned *name_blocks_ptr =
+            layout.GetBlockPtr<unsigned, true>(memory_ptr, SharedDataLayout::NAME_BLOCKS);
+        if (layout.GetBlockSize(SharedDataLayout::NAME_BLOCKS) > 0)
+        {
+            name_stream.read((char *)name_blocks_ptr,
+                             layout.GetBlockSize(SharedDataLayout::NAME_BLOCKS));
+        }
+
+        char *name_char_ptr =
+            layout.GetBlockPtr<char, true>(memory_ptr, SharedDataLayout::NAME_CHAR_LIST);
+        unsigned temp_length;
+        name_stream.read((char *)&temp_length, sizeof(unsigned));
+
+        BOOST_ASSERT_MSG(temp_length == layout.GetBlockSize(SharedDataLayout::NAME_CHAR_LIST),
+                         "Name file corrupted!");
+
+        if (layout.GetBlockSize(SharedDataLayout::NAME_CHAR_LIST) > 0)
+        {
+            name_stream.read(name_char_ptr, layout.GetBlockSize(SharedDataLayout::NAME_CHAR_LIST));
+        }
+    }
+
+    // The number of runs of name ids follows the edges, it is counted for files written without
+    // it. Leaves the stream at the first edge.
+    static unsigned ReadNumberOfNameRuns(std::istream &edges_input_stream,
+                                         const unsigned number_of_original_edges)
+    {
+        const auto edges_begin = edges_input_stream.tellg();
+        edges_input_stream.seekg(static_cast<std::streamoff>(number_of_original_edges) *
+                                     sizeof(OriginalEdgeData),
+                                 std::ios::cur);
+        unsigned number_of_name_runs = 0;
+        unsigned last_name_id = 0;
+        if (!edges_input_stream.read((char *)&number_of_name_runs, sizeof(unsigned)))
+        {
+            edges_input_stream.clear();
+            edges_input_stream.seekg(edges_begin);
+            std::vector<OriginalEdgeData> edge_buffer(number_of_original_edges < READ_BUFFER_RECORDS
+                                                          ? number_of_original_edges
+                                                          : READ_BUFFER_RECORDS);
+            for (unsigned first = 0; first < number_of_original_edges; first += edge_buffer.size())
+            {
+                const unsigned count =
+                    std::min<unsigned>(edge_buffer.size(), number_of_original_edges - first);
+                edges_input_stream.read((char *)edge_buffer.data(),
+                                        count * sizeof(OriginalEdgeData));
+                for (unsigned i = 0; i < count; ++i)
+                {
+                    if (first + i == 0 || edge_buffer[i].name_id != last_name_id)
+                    {
+                        ++number_of_name_runs;
+                    }
+                    last_name_id = edge_buffer[i].name_id;
+                }
+            }
+        }
+        edges_input_stream.seekg(edges_begin);
+        return number_of_name_runs;
+    }
+
+    static void LoadOriginalEdges(std::istream &edges_input_stream,
+                                  const unsigned number_of_original_edges,
+                                  SharedDataLayout &layout,
+                                  char *memory_ptr)
+    {
+        NodeID *via_node_ptr =
+            layout.GetBlockPtr<NodeID, true>(memory_ptr, SharedDataLayout::VIA_NODE_LIST);
+        unsigned *name_id_ptr =
+            layout.GetBlockPtr<unsigned, true>(memory_ptr, SharedDataLayout::NAME_ID_LIST);
+        uint64_t *name_id_run_starts_ptr =
+            layout.GetBlockPtr<uint64_t, true>(memory_ptr, SharedDataLayout::NAME_ID_RUN_STARTS);
+        uint64_t *travel_mode_ptr =
+            layout.GetBlockPtr<uint64_t, true>(memory_ptr, SharedDataLayout::TRAVEL_MODE);
+        uint64_t *turn_instructions_ptr =
+            layout.GetBlockPtr<uint64_t, true>(memory_ptr, SharedDataLayout::TURN_INSTRUCTION);
+        uint64_t *geometries_indicator_ptr =
+            layout.GetBlockPtr<uint64_t, true>(memory_ptr, SharedDataLayout::GEOMETRIES_INDICATORS);
+
+        std::vector<bool> geometries_indicators(number_of_original_edges);
+        std::vector<bool> name_id_run_starts(number_of_original_edges);
+        std::size_t number_of_name_runs = 0;
+        std::vector<OriginalEdgeData> edge_buffer(number_of_original_edges < READ_BUFFER_RECORDS
+                                                      ? number_of_original_edges
+                                                      : READ_BUFFER_RECORDS);
+        for (unsigned first = 0; first < number_of_original_edges; first += edge_buffer.size())
+        {
+            const unsigned count =
+                std::min<unsigned>(edge_buffer.size(), number_of_original_edges - first);
+            edges_input_stream.read((char *)edge_buffer.data(), count * sizeof(OriginalEdgeData));
+            for (unsigned i = 0; i < count; ++i)
+            {
+                const OriginalEdgeData &current_edge_data = edge_buffer[i];
+                CheckPackedFields(current_edge_data);
+                via_node_ptr[first + i] = current_edge_data.via_node;
+                name_id_run_starts[first + i] = SharedDataLayout::NameIDVector::Append(
+                    name_id_ptr, number_of_name_runs, current_edge_data.name_id);
+                SharedDataLayout::TravelModeVector::Set(travel_mode_ptr, first + i,
+                                                        current_edge_data.travel_mode);
+                SharedDataLayout::TurnInstructionVector::Set(turn_instructions_ptr, first + i,
+                                                             current_edge_data.turn_instruction);
+                geometries_indicators[first + i] = current_edge_data.compressed_geometry;
+            }
+        }
+        BOOST_ASSERT(number_of_name_runs == layout.num_entries[SharedDataLayout::NAME_ID_LIST]);
+        SharedDataLayout::FlagVector::Write(geometries_indicators, geometries_indicator_ptr);
+        SharedDataLayout::FlagVector::Write(name_id_run_starts, name_id_run_starts_ptr);
+    }
+
+    static void LoadGeometries(std::istream &geometry_input_stream,
+                               SharedDataLayout &layout,
+                               char *memory_ptr)
+    {
+        unsigned temporary_value;
+        unsigned *geometries_index_ptr =
+            layout.GetBlockPtr<unsigned, true>(memory_ptr, SharedDataLayout::GEOMETRIES_INDEX);
+        geometry_input_stream.seekg(0, geometry_input_stream.beg);
+        geometry_input_stream.read((char *)&temporary_value, sizeof(unsigned));
+        BOOST_ASSERT(temporary_value == layout.num_entries[SharedDataLayout::GEOMETRIES_INDEX]);
+
+        if (layout.GetBlockSize(SharedDataLayout::GEOMETRIES_INDEX) > 0)
+        {
+            geometry_input_stream.read((char *)geometries_index_ptr,
+                                       layout.GetBlockSize(SharedDataLayout::GEOMETRIES_INDEX));
+        }
+        unsigned *geometries_list_ptr =
+            layout.GetBlockPtr<unsigned, true>(memory_ptr, SharedDataLayout::GEOMETRIES_LIST);
+
+        geometry_input_stream.read((char *)&temporary_value, sizeof(unsigned));
+        // the plain node ids are skipped if the encoded ones are loaded
+        if (layout.GetBlockSize(SharedDataLayout::GEOMETRIES_LIST) > 0)
+        {
+            BOOST_ASSERT(temporary_value == layout.num_entries[SharedDataLayout::GEOMETRIES_LIST]);
+            geometry_input_stream.read((char *)geometries_list_ptr,
+                                       layout.GetBlockSize(SharedDataLayout::GEOMETRIES_LIST));
+        }
+        else
+        {
+            geometry_input_stream.seekg(uint64_t(temporary_value) * sizeof(unsigned),
+                                        std::ios::cur);
+        }
+
+        const bool has_encoded_geometries =
+            layout.GetBlockSize(SharedDataLayout::GEOMETRIES_ENCODED_LIST) > 0;
+        if (layout.GetBlockSize(SharedDataLayout::GEOMETRIES_ZOOM_LEVELS) > 0 ||
+            has_encoded_geometries)
+        {
+            std::uint8_t *geometries_zoom_levels_ptr = layout.GetBlockPtr<std::uint8_t, true>(
+                memory_ptr, SharedDataLayout::GEOMETRIES_ZOOM_LEVELS);
+            geometry_input_stream.read((char *)&temporary_value, sizeof(unsigned));
+            BOOST_ASSERT(temporary_value ==
+                         layout.num_entries[SharedDataLayout::GEOMETRIES_ZOOM_LEVELS]);
+            geometry_input_stream.read(
+                (char *)geometries_zoom_levels_ptr,
+                layout.GetBlockSize(SharedDataLayout::GEOMETRIES_ZOOM_LEVELS));
+        }
+
+        if (has_encoded_geometries)
+        {
+            unsigned *geometries_block_offsets_ptr = layout.GetBlockPtr<unsigned, true>(
+                memory_ptr, SharedDataLayout::GEOMETRIES_BLOCK_OFFSETS);
+            geometry_input_stream.read((char *)&temporary_value, sizeof(unsigned));
+            BOOST_ASSERT(temporary_value ==
+                         layout.num_entries[SharedDataLayout::GEOMETRIES_BLOCK_OFFSETS]);
+            geometry_input_stream.read(
+                (char *)geometries_block_offsets_ptr,
+                layout.GetBlockSize(SharedDataLayout::GEOMETRIES_BLOCK_OFFSETS));
+
+            std::uint8_t *geometries_encoded_ptr = layout.GetBlockPtr<std::uint8_t, true>(
+                memory_ptr, SharedDataLayout::GEOMETRIES_ENCODED_LIST);
+            geometry_input_stream.read((char *)&temporary_value, sizeof(unsigned));
+            BOOST_ASSERT(temporary_value ==
+                         layout.num_entries[SharedDataLayout::GEOMETRIES_ENCODED_LIST]);
+            geometry_input_stream.read(
+                (char *)geometries_encoded_ptr,
+                layout.GetBlockSize(SharedDataLayout::GEOMETRIES_ENCODED_LIST));
+        }
+    }
+
+    static void LoadCoordinates(std::istream &nodes_input_stream,
+                                const unsigned coordinate_list_size,
+                                SharedDataLayout &layout,
+                                char *memory_ptr)
+    {
+        FixedPointCoordinate *coordinates_ptr = layout.GetBlockPtr<FixedPointCoordinate, true>(
+            memory_ptr, SharedDataLayout::COORDINATE_LIST);
+
+        std::vector<QueryNode> node_buffer(coordinate_list_size < READ_BUFFER_RECORDS
+                                               ? coordinate_list_size
+                                               : READ_BUFFER_RECORDS);
+        for (unsigned first = 0; first < coordinate_list_size; first += node_buffer.size())
+        {
+            const unsigned count =
+                std::min<unsigned>(node_buffer.size(), coordinate_list_size - first);
+            nodes_input_stream.read((char *)node_buffer.data(), count * sizeof(QueryNode));
+            for (unsigned i = 0; i < count; ++i)
+            {
+                coordinates_ptr[first + i] =
+                    FixedPointCoordinate(node_buffer[i].lat, node_buffer[i].lon);
+            }
+        }
+
+        // the canary of the projected latitudes is written even if the file has none
+        double *projected_latitudes_ptr = layout.GetBlockPtr<double, true>(
+            memory_ptr, SharedDataLayout::PROJECTED_LATITUDE_LIST);
+        if (layout.num_entries[SharedDataLayout::PROJECTED_LATITUDE_LIST] > 0)
+        {
+            unsigned number_of_projected_latitudes = 0;
+            nodes_input_stream.read((char *)&number_of_projected_latitudes, sizeof(unsigned));
+            BOOST_ASSERT(number_of_projected_latitudes == coordinate_list_size);
+            nodes_input_stream.read((char *)projected_latitudes_ptr,
+                                    layout.GetBlockSize(SharedDataLayout::PROJECTED_LATITUDE_LIST));
+        }
+    }
+
+    static void LoadCoreMarkers(std::istream &core_marker_file,
+                                const unsigned number_of_core_markers,
+                                SharedDataLayout &layout,
+                                char *memory_ptr)
+    {
+        std::vector<char> unpacked_core_markers(number_of_core_markers);
+        core_marker_file.read((char *)unpacked_core_markers.data(),
+                              sizeof(char) * number_of_core_markers);
+
+        uint64_t *core_marker_ptr =
+            layout.GetBlockPtr<uint64_t, true>(memory_ptr, SharedDataLayout::CORE_MARKER);
+        SharedDataLayout::FlagVector::Write(unpacked_core_markers, core_marker_ptr);
+    }
+
+    // the canaries of the blocks are written even if there is no segment grid
+    static void LoadSegmentGrid(std::istream &grid_index_file,
+                                const bool has_grid,
+                                SharedDataLayout &layout,
+                                char *memory_ptr)
+    {
+        for (const auto block : {SharedDataLayout::GRID_CELL_IDS,
+                                 SharedDataLayout::GRID_CELL_OFFSETS,
+                                 SharedDataLayout::GRID_SEGMENTS})
+        {
+            char *block_ptr = layout.GetBlockPtr<char, true>(memory_ptr, block);
+            if (has_grid)
+            {
+                grid_index_file.read(block_ptr, layout.GetBlockSize(block));
+            }
+        }
+        if (has_grid && !grid_index_file)
+        {
+            throw osrm::exception("segment grid file is truncated");
+        }
+    }
+
+    // the canary of the block is written even if there is no kd-tree
+    static void LoadLocateIndex(std::istream &locate_index_file,
+                                const bool has_locate_index,
+                                SharedDataLayout &layout,
+                                char *memory_ptr)
+    {
+        char *block_ptr =
+            layout.GetBlockPtr<char, true>(memory_ptr, SharedDataLayout::LOCATE_INDEX);
+        if (has_locate_index)
+        {
+            locate_index_file.read(block_ptr, layout.GetBlockSize(SharedDataLayout::LOCATE_INDEX));
+            if (!locate_index_file)
+            {
+                throw osrm::exception("kd-tree file is truncated");
+            }
+        }
+    }
+
+    static void LoadSplitGraphEdges(std::istream &hsgr_input_stream,
+                                    SharedDataLayout &layout,
+                                    char *memory_ptr)
+    {
+        SplitGraph::HotEdgeEntry *hot_edge_ptr = layout.GetBlockPtr<SplitGraph::HotEdgeEntry, true>(
+            memory_ptr, SharedDataLayout::GRAPH_EDGE_LIST);
+        SplitGraph::ColdEdgeEntry *cold_edge_ptr =
+            layout.GetBlockPtr<SplitGraph::ColdEdgeEntry, true>(memory_ptr,
+                                                                SharedDataLayout::GRAPH_EDGE_IDS);
+
+        const uint64_t number_of_edges = layout.num_entries[SharedDataLayout::GRAPH_EDGE_LIST];
+        std::vector<SplitGraph::EdgeArrayEntry> buffer(
+            std::min<uint64_t>(number_of_edges, 1u << 16));
+        for (uint64_t first_edge = 0; first_edge < number_of_edges; first_edge += buffer.size())
+        {
+            const uint64_t chunk = std::min<uint64_t>(buffer.size(), number_of_edges - first_edge);
+            hsgr_input_stream.read((char *)buffer.data(),
+                                   chunk * sizeof(SplitGraph::EdgeArrayEntry));
+            if (!hsgr_input_stream)
+            {
+                throw osrm::exception("hsgr file is truncated");
+            }
+            for (const auto i : osrm::irange<uint64_t>(0, chunk))
+            {
+                SplitGraph::Split(buffer[i], hot_edge_ptr[first_edge + i],
+                                  cold_edge_ptr[first_edge + i]);
+            }
+        }
+    }
+
+    static void
+    LoadGraph(std::istream &hsgr_input_stream, SharedDataLayout &layout, char *memory_ptr)
+    {
+        // load the nodes of the search graph
+        QueryGraph::NodeArrayEntry *graph_node_list_ptr =
+            layout.GetBlockPtr<QueryGraph::NodeArrayEntry, true>(memory_ptr,
+                                                                 SharedDataLayout::GRAPH_NODE_LIST);
+        if (layout.GetBlockSize(SharedDataLayout::GRAPH_NODE_LIST) > 0)
+        {
+            hsgr_input_stream.read((char *)graph_node_list_ptr,
+                                   layout.GetBlockSize(SharedDataLayout::GRAPH_NODE_LIST));
+        }
+
+        // the edges of a split graph are read in chunks and written to the hot and the cold block
+        if (layout.HasSplitGraph())
+        {
+            LoadSplitGraphEdges(hsgr_input_stream, layout, memory_ptr);
+            return;
+        }
+
+        // load the edges of the search graph
+        QueryGraph::EdgeArrayEntry *graph_edge_list_ptr =
+            layout.GetBlockPtr<QueryGraph::EdgeArrayEntry, true>(memory_ptr,
+                                                                 SharedDataLayout::GRAPH_EDGE_LIST);
+        if (layout.GetBlockSize(SharedDataLayout::GRAPH_EDGE_LIST) > 0)
+        {
+            hsgr_input_stream.read((char *)graph_edge_list_ptr,
+                                   layout.GetBlockSize(SharedDataLayout::GRAPH_EDGE_LIST));
+        }
+    }
+
+    // the canaries of the blocks are written even if there are no landmarks
+    static void LoadLandmarks(std::istream &landmark_file,
+                              const bool has_landmarks,
+                              SharedDataLayout &layout,
+                              char *memory_ptr)
+    {
+        for (const auto block : {SharedDataLayout::LANDMARK_NODES,
+                                 SharedDataLayout::LANDMARK_CORE_INDEX,
+                                 SharedDataLayout::LANDMARK_DISTANCES})
+        {
+            char *block_ptr = layout.GetBlockPtr<char, true>(memory_ptr, block);
+            if (has_landmarks)
+            {
+                landmark_file.read(block_ptr, layout.GetBlockSize(block));
+            }
+        }
+        if (has_landmarks && !landmark_file)
+        {
+            throw osrm::exception("landmark file is truncated");
+        }
+    }
+};
+
+// Writes the dataset to an image file that osrm-routed --image maps and osrm-datastore
+// --from-image copies to shared memory. The layout is stored in front of the blocks.
+inline void WriteDatasetImage(const ServerPaths &server_paths,
+                              const bool split_query_graph,
+                              const boost::filesystem::path &image_path)
+{
+    const std::unique_ptr<SharedDataLayout> layout_ptr = osrm::make_unique<SharedDataLayout>();
+    SharedDataLayout &layout = *layout_ptr;
+    DatasetBuilder builder(server_paths, split_query_graph, layout);
+
+    const uint64_t image_size = SharedDataImage::Size(layout);
+    SimpleLogger().Write() << "writing image of " << image_size << " bytes to "
+                           << image_path.string();
+    boost::filesystem::ofstream(image_path, std::ios::binary | std::ios::trunc).close();
+    boost::filesystem::resize_file(image_path, image_size);
+    const boost::interprocess::file_mapping image_file(image_path.string().c_str(),
+                                                       boost::interprocess::read_write);
+    boost::interprocess::mapped_region image_region(image_file, boost::interprocess::read_write);
+    char *image = static_cast<char *>(image_region.get_address());
+
+    builder.Load(image + SharedDataImage::DataOffset(),
+                 image + SharedDataImage::StaticOffset(layout));
+
+    layout.SetBlockChecksums(image + SharedDataImage::DataOffset(),
+                             image + SharedDataImage::StaticOffset(layout));
+    *reinterpret_cast<SharedDataLayout *>(image) = layout;
+    image_region.flush();
+    SimpleLogger().Write() << "all data written to " << image_path.string();
+    layout.PrintInformation();
+}
+
+#endif // DATASET_BUILDER_HPP
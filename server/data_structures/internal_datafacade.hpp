@@ -32,53 +32,83 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "datafacade_base.hpp"
 
+#include "../../data_structures/bit_vector.hpp"
+#include "../../data_structures/geometry_encoding.hpp"
+#include "../../data_structures/landmark_table.hpp"
 #include "../../data_structures/original_edge_data.hpp"
+#include "../../data_structures/phantom_node_cache.hpp"
 #include "../../data_structures/query_node.hpp"
 #include "../../data_structures/query_edge.hpp"
 #include "../../data_structures/shared_memory_vector_wrapper.hpp"
 #include "../../data_structures/static_graph.hpp"
+#include "../../data_structures/static_kdtree.hpp"
 #include "../../data_structures/static_rtree.hpp"
 #include "../../data_structures/range_table.hpp"
+#include "../../data_structures/run_length_vector.hpp"
 #include "../../util/graph_loader.hpp"
+#include "../../util/make_unique.hpp"
 #include "../../util/simple_logger.hpp"
+#include "../../util/timing_util.hpp"
 
 #include <osrm/coordinate.hpp>
 #include <osrm/server_paths.hpp>
 
+#include <tbb/parallel_invoke.h>
+
+#include <algorithm>
 #include <limits>
+#include <memory>
+#include <vector>
 
-template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacade<EdgeDataT>
+// QueryGraphT is either a StaticGraph, a CompactQueryGraph that packs the edges or a
+// SplitQueryGraph that keeps their ids apart
+template <class EdgeDataT, class QueryGraphT = StaticGraph<EdgeDataT>>
+class InternalDataFacade final : public BaseDataFacade<EdgeDataT>
 {
 
   private:
     using super = BaseDataFacade<EdgeDataT>;
-    using QueryGraph = StaticGraph<typename super::EdgeData>;
+    using QueryGraph = QueryGraphT;
     using InputEdge = typename QueryGraph::InputEdge;
     using RTreeLeaf = typename super::RTreeLeaf;
 
     InternalDataFacade() {}
 
+    // records of the node and edge files that are read with a single call
+    static const unsigned READ_BUFFER_RECORDS = 1u << 16;
+
     unsigned m_check_sum;
     unsigned m_number_of_nodes;
     QueryGraph *m_query_graph;
     std::string m_timestamp;
 
     std::shared_ptr<ShM<FixedPointCoordinate, false>::vector> m_coordinate_list;
+    std::shared_ptr<ShM<double, false>::vector> m_projected_latitude_list;
     ShM<NodeID, false>::vector m_via_node_list;
-    ShM<unsigned, false>::vector m_name_ID_list;
-    ShM<TurnInstruction, false>::vector m_turn_instruction_list;
-    ShM<TravelMode, false>::vector m_travel_mode_list;
+    RunLengthVector<unsigned, false> m_name_ID_list;
+    TurnInstructionVector<false> m_turn_instruction_list;
+    TravelModeVector<false> m_travel_mode_list;
     ShM<char, false>::vector m_names_char_list;
-    ShM<bool, false>::vector m_edge_is_compressed;
+    BitVector<false> m_edge_is_compressed;
     ShM<unsigned, false>::vector m_geometry_indices;
     ShM<unsigned, false>::vector m_geometry_list;
-    ShM<bool, false>::vector m_is_core_node;
-
-    boost::thread_specific_ptr<
-        StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, false>::vector, false>> m_static_rtree;
+    // the geometries in the encoding of geometry_encoding.hpp, instead of m_geometry_list
+    ShM<unsigned, false>::vector m_geometry_block_offsets;
+    ShM<std::uint8_t, false>::vector m_encoded_geometries;
+    ShM<std::uint8_t, false>::vector m_geometry_zoom_levels;
+    BitVector<false> m_is_core_node;
+    LandmarkTable<false> m_landmark_table;
+
+    std::unique_ptr<StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, false>::vector, false>>
+        m_static_rtree;
+    std::unique_ptr<StaticKDTree<false>> m_locate_index;
     boost::filesystem::path ram_index_path;
     boost::filesystem::path file_index_path;
+    boost::filesystem::path grid_index_path;
+    boost::filesystem::path locate_index_path;
     RangeTable<16, false> m_name_table;
+    std::unique_ptr<PhantomNodeCache> m_phantom_node_cache;
+    std::unique_ptr<ShortcutCache> m_shortcut_cache;
 
     void LoadTimestamp(const boost::filesystem::path &timestamp_path)
     {
@@ -103,7 +133,8 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         }
     }
 
-    void LoadGraph(const boost::filesystem::path &hsgr_path)
+    void LoadGraph(const boost::filesystem::path &hsgr_path,
+                   const boost::filesystem::path &weights_path)
     {
         typename ShM<typename QueryGraph::NodeArrayEntry, false>::vector node_list;
         typename ShM<typename QueryGraph::EdgeArrayEntry, false>::vector edge_list;
@@ -111,6 +142,10 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         SimpleLogger().Write() << "loading graph from " << hsgr_path.string();
 
         m_number_of_nodes = readHSGRFromStream(hsgr_path, node_list, edge_list, &m_check_sum);
+        if (!weights_path.empty())
+        {
+            readHSGRWeightsFromStream(weights_path, m_check_sum, edge_list.data(), edge_list.size());
+        }
 
         BOOST_ASSERT_MSG(0 != node_list.size(), "node list empty");
         // BOOST_ASSERT_MSG(0 != edge_list.size(), "edge list empty");
@@ -128,17 +163,36 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
     {
         boost::filesystem::ifstream nodes_input_stream(nodes_file, std::ios::binary);
 
-        QueryNode current_node;
         unsigned number_of_coordinates = 0;
         nodes_input_stream.read((char *)&number_of_coordinates, sizeof(unsigned));
         m_coordinate_list =
             std::make_shared<std::vector<FixedPointCoordinate>>(number_of_coordinates);
-        for (unsigned i = 0; i < number_of_coordinates; ++i)
+        std::vector<QueryNode> node_buffer(number_of_coordinates < READ_BUFFER_RECORDS
+                                               ? number_of_coordinates
+                                               : READ_BUFFER_RECORDS);
+        for (unsigned first = 0; first < number_of_coordinates; first += node_buffer.size())
         {
-            nodes_input_stream.read((char *)&current_node, sizeof(QueryNode));
-            m_coordinate_list->at(i) = FixedPointCoordinate(current_node.lat, current_node.lon);
-            BOOST_ASSERT((std::abs(m_coordinate_list->at(i).lat) >> 30) == 0);
-            BOOST_ASSERT((std::abs(m_coordinate_list->at(i).lon) >> 30) == 0);
+            const unsigned count =
+                std::min<unsigned>(node_buffer.size(), number_of_coordinates - first);
+            nodes_input_stream.read((char *)node_buffer.data(), count * sizeof(QueryNode));
+            for (unsigned i = 0; i < count; ++i)
+            {
+                const QueryNode &current_node = node_buffer[i];
+                (*m_coordinate_list)[first + i] =
+                    FixedPointCoordinate(current_node.lat, current_node.lon);
+                BOOST_ASSERT((std::abs(current_node.lat) >> 30) == 0);
+                BOOST_ASSERT((std::abs(current_node.lon) >> 30) == 0);
+            }
+        }
+        // the projected latitudes are optional, older files end after the nodes
+        unsigned number_of_projected_latitudes = 0;
+        if (nodes_input_stream.read((char *)&number_of_projected_latitudes, sizeof(unsigned)) &&
+            number_of_projected_latitudes == number_of_coordinates)
+        {
+            m_projected_latitude_list =
+                std::make_shared<std::vector<double>>(number_of_projected_latitudes);
+            nodes_input_stream.read((char *)m_projected_latitude_list->data(),
+                                    number_of_projected_latitudes * sizeof(double));
         }
         nodes_input_stream.close();
 
@@ -146,29 +200,37 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         unsigned number_of_edges = 0;
         edges_input_stream.read((char *)&number_of_edges, sizeof(unsigned));
         m_via_node_list.resize(number_of_edges);
-        m_name_ID_list.resize(number_of_edges);
-        m_turn_instruction_list.resize(number_of_edges);
-        m_travel_mode_list.resize(number_of_edges);
-        m_edge_is_compressed.resize(number_of_edges);
-
-        unsigned compressed = 0;
-
-        OriginalEdgeData current_edge_data;
-        for (unsigned i = 0; i < number_of_edges; ++i)
-        {
-            edges_input_stream.read((char *)&(current_edge_data), sizeof(OriginalEdgeData));
-            m_via_node_list[i] = current_edge_data.via_node;
-            m_name_ID_list[i] = current_edge_data.name_id;
-            m_turn_instruction_list[i] = current_edge_data.turn_instruction;
-            m_travel_mode_list[i] = current_edge_data.travel_mode;
-            m_edge_is_compressed[i] = current_edge_data.compressed_geometry;
-            if (m_edge_is_compressed[i])
+        std::vector<unsigned> name_id_list(number_of_edges);
+        TurnInstructionVector<false> turn_instruction_list(number_of_edges);
+        TravelModeVector<false> travel_mode_list(number_of_edges);
+        std::vector<bool> edge_is_compressed(number_of_edges);
+
+        std::vector<OriginalEdgeData> edge_buffer(
+            number_of_edges < READ_BUFFER_RECORDS ? number_of_edges : READ_BUFFER_RECORDS);
+        for (unsigned first = 0; first < number_of_edges; first += edge_buffer.size())
+        {
+            const unsigned count = std::min<unsigned>(edge_buffer.size(), number_of_edges - first);
+            edges_input_stream.read((char *)edge_buffer.data(), count * sizeof(OriginalEdgeData));
+            for (unsigned i = 0; i < count; ++i)
             {
-                ++compressed;
+                const OriginalEdgeData &current_edge_data = edge_buffer[i];
+                CheckPackedFields(current_edge_data);
+                m_via_node_list[first + i] = current_edge_data.via_node;
+                name_id_list[first + i] = current_edge_data.name_id;
+                turn_instruction_list.set(first + i, current_edge_data.turn_instruction);
+                travel_mode_list.set(first + i, current_edge_data.travel_mode);
+                edge_is_compressed[first + i] = current_edge_data.compressed_geometry;
             }
         }
 
         edges_input_stream.close();
+
+        RunLengthVector<unsigned, false> name_id_runs(name_id_list);
+        m_name_ID_list.swap(name_id_runs);
+        m_turn_instruction_list.swap(turn_instruction_list);
+        m_travel_mode_list.swap(travel_mode_list);
+        BitVector<false> edge_is_compressed_flags(edge_is_compressed);
+        m_edge_is_compressed.swap(edge_is_compressed_flags);
     }
 
     void LoadCoreInformation(const boost::filesystem::path &core_data_file)
@@ -186,12 +248,19 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
             return;
         }
 
-        m_is_core_node.resize(number_of_markers);
-        for (auto i = 0u; i < number_of_markers; ++i)
-        {
-            BOOST_ASSERT(unpacked_core_markers[i] == 0 || unpacked_core_markers[i] == 1);
-            m_is_core_node[i] = unpacked_core_markers[i] == 1;
-        }
+        BOOST_ASSERT(std::all_of(unpacked_core_markers.begin(), unpacked_core_markers.end(),
+                                 [](const char marker)
+                                 {
+                                     return marker == 0 || marker == 1;
+                                 }));
+        BitVector<false> is_core_node(unpacked_core_markers);
+        m_is_core_node.swap(is_core_node);
+    }
+
+    void LoadLandmarks(const boost::filesystem::path &landmark_file)
+    {
+        LandmarkTable<false> landmark_table(landmark_file);
+        m_landmark_table = std::move(landmark_table);
     }
 
     void LoadGeometries(const boost::filesystem::path &geometry_file)
@@ -212,10 +281,51 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         geometry_stream.read((char *)&number_of_compressed_geometries, sizeof(unsigned));
 
         BOOST_ASSERT(m_geometry_indices.back() == number_of_compressed_geometries);
-        m_geometry_list.resize(number_of_compressed_geometries);
+        // the plain node ids are only read if the file has no encoded ones
+        const auto geometry_list_position = geometry_stream.tellg();
+        geometry_stream.seekg(number_of_compressed_geometries * sizeof(unsigned),
+                              std::ios::cur);
+
+        // the generalization levels are optional, files without them end after the geometries
+        unsigned number_of_zoom_levels = 0;
+        if (!geometry_stream.read((char *)&number_of_zoom_levels, sizeof(unsigned)))
+        {
+            number_of_zoom_levels = 0;
+        }
+        BOOST_ASSERT(0 == number_of_zoom_levels ||
+                     number_of_compressed_geometries == number_of_zoom_levels);
+        m_geometry_zoom_levels.resize(number_of_zoom_levels);
+        if (number_of_zoom_levels > 0)
+        {
+            geometry_stream.read((char *)&(m_geometry_zoom_levels[0]),
+                                 number_of_zoom_levels * sizeof(std::uint8_t));
+        }
 
-        if (number_of_compressed_geometries > 0)
+        // as are the encoded geometries behind them
+        unsigned number_of_block_offsets = 0;
+        unsigned number_of_encoded_bytes = 0;
+        if (number_of_indices > 0 &&
+            geometry_stream.read((char *)&number_of_block_offsets, sizeof(unsigned)) &&
+            geometry_encoding::GetNumberOfBlocks(number_of_indices - 1) + 1 ==
+                number_of_block_offsets)
+        {
+            m_geometry_block_offsets.resize(number_of_block_offsets);
+            geometry_stream.read((char *)&(m_geometry_block_offsets[0]),
+                                 number_of_block_offsets * sizeof(unsigned));
+            geometry_stream.read((char *)&number_of_encoded_bytes, sizeof(unsigned));
+        }
+        if (number_of_encoded_bytes > 0)
+        {
+            m_encoded_geometries.resize(number_of_encoded_bytes);
+            geometry_stream.read((char *)&(m_encoded_geometries[0]),
+                                 number_of_encoded_bytes * sizeof(std::uint8_t));
+        }
+        else if (number_of_compressed_geometries > 0)
         {
+            m_geometry_block_offsets.clear();
+            geometry_stream.clear();
+            geometry_stream.seekg(geometry_list_position);
+            m_geometry_list.resize(number_of_compressed_geometries);
             geometry_stream.read((char *)&(m_geometry_list[0]),
                                  number_of_compressed_geometries * sizeof(unsigned));
         }
@@ -228,6 +338,19 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
 
         m_static_rtree.reset(
             new StaticRTree<RTreeLeaf>(ram_index_path, file_index_path, m_coordinate_list));
+        if (!grid_index_path.empty())
+        {
+            m_static_rtree->SetSegmentGrid(
+                osrm::make_unique<SegmentGrid<RTreeLeaf>>(grid_index_path));
+        }
+        if (m_projected_latitude_list)
+        {
+            m_static_rtree->SetProjectedLatitudes(m_projected_latitude_list);
+        }
+        if (!locate_index_path.empty())
+        {
+            m_locate_index = osrm::make_unique<StaticKDTree<false>>(locate_index_path);
+        }
     }
 
     void LoadStreetNames(const boost::filesystem::path &names_file)
@@ -252,7 +375,6 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
     virtual ~InternalDataFacade()
     {
         delete m_query_graph;
-        m_static_rtree.reset();
     }
 
     explicit InternalDataFacade(const ServerPaths &server_paths)
@@ -270,29 +392,96 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
 
         ram_index_path = file_for("ramindex");
         file_index_path = file_for("fileindex");
+        const auto grid_index_it = server_paths.find("gridindex");
+        if (grid_index_it != end_it && boost::filesystem::is_regular_file(grid_index_it->second))
+        {
+            grid_index_path = grid_index_it->second;
+        }
+        const auto locate_index_it = server_paths.find("locateindex");
+        if (locate_index_it != end_it &&
+            boost::filesystem::is_regular_file(locate_index_it->second))
+        {
+            locate_index_path = locate_index_it->second;
+        }
 
-        SimpleLogger().Write() << "loading graph data";
-        LoadGraph(file_for("hsgrdata"));
-
-        SimpleLogger().Write() << "loading edge information";
-        LoadNodeAndEdgeInformation(file_for("nodesdata"), file_for("edgesdata"));
-
-        SimpleLogger().Write() << "loading core information";
-        LoadCoreInformation(file_for("coredata"));
+        // the edge weights of a customized hierarchy are optional
+        boost::filesystem::path weights_path;
+        const auto weights_it = server_paths.find("weights");
+        if (weights_it != end_it && boost::filesystem::is_regular_file(weights_it->second))
+        {
+            weights_path = weights_it->second;
+        }
 
-        SimpleLogger().Write() << "loading geometries";
-        LoadGeometries(file_for("geometries"));
+        const auto hsgr_path = file_for("hsgrdata");
+        const auto nodes_path = file_for("nodesdata");
+        const auto edges_path = file_for("edgesdata");
+        const auto core_path = file_for("coredata");
+        const auto geometries_path = file_for("geometries");
+        const auto timestamp_path = file_for("timestamp");
+        const auto names_path = file_for("namesdata");
+        boost::filesystem::path landmarks_path;
+        const auto landmarks_it = server_paths.find("landmarks");
+        if (landmarks_it != end_it && boost::filesystem::is_regular_file(landmarks_it->second))
+        {
+            landmarks_path = landmarks_it->second;
+        }
 
-        SimpleLogger().Write() << "loading r-tree";
-        // XXX(daniel-j-h): it says this ^ but doesn't load the rtree here
+        // the files are independent apart from the r-tree that needs the coordinates, so the
+        // startup takes as long as the largest file instead of the sum of all of them
+        TIMER_START(load_data);
+        tbb::parallel_invoke(
+            [&]
+            {
+                SimpleLogger().Write() << "loading graph data";
+                LoadGraph(hsgr_path, weights_path);
+            },
+            [&]
+            {
+                SimpleLogger().Write() << "loading edge information";
+                LoadNodeAndEdgeInformation(nodes_path, edges_path);
+                SimpleLogger().Write() << "loading r-tree";
+                LoadRTree();
+            },
+            [&]
+            {
+                SimpleLogger().Write() << "loading core information";
+                LoadCoreInformation(core_path);
+                if (!landmarks_path.empty())
+                {
+                    SimpleLogger().Write() << "loading core landmarks";
+                    LoadLandmarks(landmarks_path);
+                }
+            },
+            [&]
+            {
+                SimpleLogger().Write() << "loading geometries";
+                LoadGeometries(geometries_path);
+            },
+            [&]
+            {
+                SimpleLogger().Write() << "loading timestamp";
+                LoadTimestamp(timestamp_path);
+                SimpleLogger().Write() << "loading street names";
+                LoadStreetNames(names_path);
+            });
+        TIMER_STOP(load_data);
+        SimpleLogger().Write() << "loaded data in " << TIMER_SEC(load_data) << "s";
+    }
 
-        SimpleLogger().Write() << "loading timestamp";
-        LoadTimestamp(file_for("timestamp"));
+    // caches the phantom nodes of up to capacity recently queried coordinates
+    void EnablePhantomNodeCache(const unsigned capacity)
+    {
+        m_phantom_node_cache = osrm::make_unique<PhantomNodeCache>(capacity);
+    }
 
-        SimpleLogger().Write() << "loading street names";
-        LoadStreetNames(file_for("namesdata"));
+    // caches the unpacked edges of up to capacity recently unpacked shortcuts
+    void EnableShortcutCache(const unsigned capacity)
+    {
+        m_shortcut_cache = osrm::make_unique<ShortcutCache>(capacity);
     }
 
+    ShortcutCache *GetShortcutCache() const override final { return m_shortcut_cache.get(); }
+
     // search graph access
     unsigned GetNumberOfNodes() const override final { return m_query_graph->GetNumberOfNodes(); }
 
@@ -305,7 +494,7 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
 
     NodeID GetTarget(const EdgeID e) const override final { return m_query_graph->GetTarget(e); }
 
-    EdgeDataT &GetEdgeData(const EdgeID e) const override final
+    EdgeDataT GetEdgeData(const EdgeID e) const override final
     {
         return m_query_graph->GetEdgeData(e);
     }
@@ -319,6 +508,11 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         return m_query_graph->GetAdjacentEdgeRange(node);
     };
 
+    void PrefetchAdjacentEdges(const NodeID node) const override final
+    {
+        m_query_graph->PrefetchEdges(node);
+    }
+
     // searches for a specific edge
     EdgeID FindEdge(const NodeID from, const NodeID to) const override final
     {
@@ -361,11 +555,11 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
                                             FixedPointCoordinate &result,
                                             const unsigned zoom_level = 18) override final
     {
-        if (!m_static_rtree.get())
+        // the kd-tree has no component information, tiny ones are only skipped up to zoom 14
+        if (m_locate_index && zoom_level > 14)
         {
-            LoadRTree();
+            return m_locate_index->NearestNeighbor(input_coordinate, result);
         }
-
         return m_static_rtree->LocateClosestEndPointForCoordinate(input_coordinate, result,
                                                                   zoom_level);
     }
@@ -388,15 +582,30 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
     bool
     IncrementalFindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
                                             std::vector<PhantomNode> &resulting_phantom_node_vector,
-                                            const unsigned number_of_results) override final
+                                            const unsigned number_of_results,
+                                            const int bearing = 0,
+                                            const int bearing_range = 180) override final
     {
-        if (!m_static_rtree.get())
+        // the cache only holds unfiltered results
+        const bool use_cache = m_phantom_node_cache && bearing_range >= 180;
+        if (use_cache &&
+            m_phantom_node_cache->Fetch(input_coordinate, number_of_results,
+                                        resulting_phantom_node_vector))
         {
-            LoadRTree();
+            return !resulting_phantom_node_vector.empty();
         }
-
-        return m_static_rtree->IncrementalFindPhantomNodeForCoordinate(
-            input_coordinate, resulting_phantom_node_vector, number_of_results);
+        const auto previous_size = resulting_phantom_node_vector.size();
+        const bool result = m_static_rtree->IncrementalFindPhantomNodeForCoordinate(
+            input_coordinate, resulting_phantom_node_vector, number_of_results, bearing,
+            bearing_range);
+        if (use_cache)
+        {
+            m_phantom_node_cache->Insert(
+                input_coordinate, number_of_results,
+                std::vector<PhantomNode>(resulting_phantom_node_vector.begin() + previous_size,
+                                         resulting_phantom_node_vector.end()));
+        }
+        return result;
     }
 
     bool IncrementalFindPhantomNodeForCoordinateWithMaxDistance(
@@ -404,15 +613,19 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         std::vector<std::pair<PhantomNode, double>> &resulting_phantom_node_vector,
         const double max_distance) override final
     {
-        if (!m_static_rtree.get())
-        {
-            LoadRTree();
-        }
-
         return m_static_rtree->IncrementalFindPhantomNodeForCoordinateWithDistance(
             input_coordinate, resulting_phantom_node_vector, max_distance);
     }
 
+    void IncrementalFindPhantomNodesForCoordinatesWithMaxDistance(
+        const std::vector<FixedPointCoordinate> &input_coordinates,
+        std::vector<std::vector<std::pair<PhantomNode, double>>> &resulting_phantom_node_vectors,
+        const double max_distance) override final
+    {
+        m_static_rtree->IncrementalFindPhantomNodesForCoordinatesWithDistance(
+            input_coordinates, resulting_phantom_node_vectors, max_distance);
+    }
+
     unsigned GetCheckSum() const override final { return m_check_sum; }
 
     unsigned GetNameIndexFromEdgeID(const unsigned id) const override final
@@ -420,23 +633,19 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         return m_name_ID_list.at(id);
     }
 
-    std::string get_name_for_id(const unsigned name_id) const override final
+    boost::string_ref get_name_ref_for_id(const unsigned name_id) const override final
     {
         if (std::numeric_limits<unsigned>::max() == name_id)
         {
-            return "";
+            return boost::string_ref();
         }
         auto range = m_name_table.GetRange(name_id);
-
-        std::string result;
-        result.reserve(range.size());
-        if (range.begin() != range.end())
+        if (0 == range.size())
         {
-            result.resize(range.back() - range.front() + 1);
-            std::copy(m_names_char_list.begin() + range.front(),
-                      m_names_char_list.begin() + range.back() + 1, result.begin());
+            return boost::string_ref();
         }
-        return result;
+        return boost::string_ref(&m_names_char_list[range.front()],
+                                 range.back() - range.front() + 1);
     }
 
     virtual unsigned GetGeometryIndexForEdgeID(const unsigned id) const override final
@@ -456,17 +665,52 @@ template <class EdgeDataT> class InternalDataFacade final : public BaseDataFacad
         }
     }
 
-    virtual void GetUncompressedGeometry(const unsigned id,
-                                         std::vector<unsigned> &result_nodes) const override final
+    virtual bool HasCore() const override final { return m_is_core_node.size() > 0; }
+
+    unsigned GetNumberOfLandmarks() const override final
+    {
+        return m_landmark_table.GetNumberOfLandmarks();
+    }
+
+    const EdgeWeight *GetLandmarkDistances(const NodeID id) const override final
+    {
+        return m_landmark_table.GetDistances(id);
+    }
+
+    typename super::GeometryRange
+    GetUncompressedGeometryRange(const unsigned id) const override final
     {
         const unsigned begin = m_geometry_indices.at(id);
         const unsigned end = m_geometry_indices.at(id + 1);
+        if (begin == end)
+        {
+            return typename super::GeometryRange();
+        }
+        if (!m_encoded_geometries.empty())
+        {
+            // decoded into a buffer of the calling thread, valid until its next call
+            static thread_local std::vector<unsigned> decoded_geometry;
+            geometry_encoding::Decode(&m_geometry_indices[0], &m_geometry_block_offsets[0],
+                                      &m_encoded_geometries[0], id, decoded_geometry);
+            return typename super::GeometryRange(decoded_geometry.data(),
+                                                 decoded_geometry.data() +
+                                                     decoded_geometry.size());
+        }
+        const unsigned *geometry = &m_geometry_list[begin];
+        return typename super::GeometryRange(geometry, geometry + (end - begin));
+    }
 
-        result_nodes.clear();
-        result_nodes.insert(result_nodes.begin(), m_geometry_list.begin() + begin,
-                            m_geometry_list.begin() + end);
+    const std::uint8_t *GetUncompressedGeometryZoomLevels(const unsigned id) const override final
+    {
+        if (m_geometry_zoom_levels.empty())
+        {
+            return nullptr;
+        }
+        return &m_geometry_zoom_levels[m_geometry_indices.at(id)];
     }
 
+    bool HasGeometryZoomLevels() const override final { return !m_geometry_zoom_levels.empty(); }
+
     std::string GetTimestamp() const override final { return m_timestamp; }
 };
 
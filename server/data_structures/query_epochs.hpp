@@ -0,0 +1,208 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef QUERY_EPOCHS_HPP
+#define QUERY_EPOCHS_HPP
+
+#include <boost/assert.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Epoch based reclamation of replaced datasets. Every query thread pins the current epoch in
+// a slot of its own before it loads the dataset pointer, so readers never contend on a shared
+// counter. A replaced dataset is retired with the epoch it was replaced in and released once
+// no query pinned an epoch up to that one, i.e. updates never wait for running queries.
+class QueryEpochs
+{
+  private:
+    static constexpr unsigned UNPINNED = 0;
+
+    struct Slot
+    {
+        Slot() : pinned(UNPINNED) {}
+        std::atomic<unsigned> pinned;
+    };
+
+    struct RetiredObject
+    {
+        unsigned epoch;
+        std::function<void()> release;
+    };
+
+  public:
+    // Keeps the epoch pinned until released or destroyed
+    class Guard
+    {
+      public:
+        Guard() : slot(nullptr) {}
+        Guard(Guard &&other) : slot(other.slot) { other.slot = nullptr; }
+        Guard(const Guard &) = delete;
+        Guard &operator=(Guard &&other)
+        {
+            Release();
+            slot = other.slot;
+            other.slot = nullptr;
+            return *this;
+        }
+        ~Guard() { Release(); }
+
+        void Release()
+        {
+            if (nullptr != slot)
+            {
+                slot->pinned.store(UNPINNED, std::memory_order_release);
+                slot = nullptr;
+            }
+        }
+
+      private:
+        friend class QueryEpochs;
+        explicit Guard(Slot *slot) : slot(slot) {}
+
+        Slot *slot;
+    };
+
+    QueryEpochs() : local_slot([](Slot *)
+                               {
+                               }),
+                    epoch(1), number_of_retired(0)
+    {
+    }
+    QueryEpochs(const QueryEpochs &) = delete;
+    // no query can run anymore, everything retired is released
+    ~QueryEpochs()
+    {
+        for (auto &retired_object : retired)
+        {
+            retired_object.release();
+        }
+    }
+
+    // A thread can pin a single epoch at a time
+    Guard Pin()
+    {
+        Slot &slot = LocalSlot();
+        BOOST_ASSERT(UNPINNED == slot.pinned.load());
+        // sequentially consistent, so that a reader that still loads a replaced pointer
+        // announced an epoch no later than the one that pointer is retired with
+        slot.pinned.store(epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        return Guard(&slot);
+    }
+
+    // Has to be called after the object got unreachable for new queries. release is run once
+    // all queries that might still see the object are done.
+    void Retire(std::function<void()> release)
+    {
+        {
+            std::lock_guard<std::mutex> lock(retired_mutex);
+            retired.push_back({epoch.fetch_add(1, std::memory_order_seq_cst), std::move(release)});
+            ++number_of_retired;
+        }
+        Collect();
+    }
+
+    // Cheap check whether Collect() might release something
+    bool HasRetired() const { return 0 != number_of_retired.load(std::memory_order_relaxed); }
+
+    // Releases all retired objects that no query can see anymore
+    void Collect()
+    {
+        std::vector<std::function<void()>> releasable;
+        {
+            std::lock_guard<std::mutex> lock(retired_mutex);
+            const unsigned oldest_pinned = OldestPinnedEpoch();
+            const auto still_visible =
+                std::partition(retired.begin(), retired.end(),
+                               [oldest_pinned](const RetiredObject &retired_object)
+                               {
+                                   return retired_object.epoch < oldest_pinned;
+                               });
+            for (auto iter = retired.begin(); iter != still_visible; ++iter)
+            {
+                releasable.push_back(std::move(iter->release));
+            }
+            retired.erase(retired.begin(), still_visible);
+            number_of_retired = static_cast<unsigned>(retired.size());
+        }
+        for (auto &release : releasable)
+        {
+            release();
+        }
+    }
+
+    unsigned Epoch() const { return epoch.load(); }
+
+  private:
+    Slot &LocalSlot()
+    {
+        Slot *slot = local_slot.get();
+        if (nullptr == slot)
+        {
+            std::lock_guard<std::mutex> lock(slots_mutex);
+            slots.emplace_back(new Slot());
+            slot = slots.back().get();
+            local_slot.reset(slot);
+        }
+        return *slot;
+    }
+
+    unsigned OldestPinnedEpoch()
+    {
+        std::lock_guard<std::mutex> lock(slots_mutex);
+        unsigned oldest = std::numeric_limits<unsigned>::max();
+        for (const auto &slot : slots)
+        {
+            const unsigned pinned = slot->pinned.load(std::memory_order_seq_cst);
+            if (UNPINNED != pinned)
+            {
+                oldest = std::min(oldest, pinned);
+            }
+        }
+        return oldest;
+    }
+
+    // slots are owned here, the thread local pointer only refers to them
+    boost::thread_specific_ptr<Slot> local_slot;
+    std::mutex slots_mutex;
+    std::vector<std::unique_ptr<Slot>> slots;
+
+    std::atomic<unsigned> epoch;
+    std::mutex retired_mutex;
+    std::vector<RetiredObject> retired;
+    std::atomic<unsigned> number_of_retired;
+};
+
+#endif // QUERY_EPOCHS_HPP
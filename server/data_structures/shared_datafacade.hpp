@@ -33,74 +33,113 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "datafacade_base.hpp"
 #include "shared_datatype.hpp"
 
+#include "../../data_structures/geometry_encoding.hpp"
+#include "../../data_structures/landmark_table.hpp"
+#include "../../data_structures/phantom_node_cache.hpp"
 #include "../../data_structures/range_table.hpp"
+#include "../../data_structures/split_query_graph.hpp"
 #include "../../data_structures/static_graph.hpp"
+#include "../../data_structures/static_kdtree.hpp"
 #include "../../data_structures/static_rtree.hpp"
 #include "../../util/make_unique.hpp"
 #include "../../util/simple_logger.hpp"
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <limits>
 #include <memory>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<EdgeDataT>
 {
+  public:
+    // the routing templates are also instantiated for the facade itself
+    using EdgeData = EdgeDataT;
 
   private:
-    using EdgeData = EdgeDataT;
     using super = BaseDataFacade<EdgeData>;
     using QueryGraph = StaticGraph<EdgeData, true>;
+    using SplitGraph = SplitQueryGraph<true>;
     using GraphNode = typename StaticGraph<EdgeData, true>::NodeArrayEntry;
     using GraphEdge = typename StaticGraph<EdgeData, true>::EdgeArrayEntry;
     using NameIndexBlock = typename RangeTable<16, true>::BlockT;
     using InputEdge = typename QueryGraph::InputEdge;
     using RTreeLeaf = typename super::RTreeLeaf;
     using SharedRTree = StaticRTree<RTreeLeaf, ShM<FixedPointCoordinate, true>::vector, true>;
-    using TimeStampedRTreePair = std::pair<unsigned, std::shared_ptr<SharedRTree>>;
     using RTreeNode = typename SharedRTree::TreeNode;
 
     SharedDataLayout *data_layout;
     char *shared_memory;
+    char *static_memory;
     SharedDataTimestamp *data_timestamp_ptr;
 
     SharedDataType CURRENT_LAYOUT;
     SharedDataType CURRENT_DATA;
+    SharedDataType CURRENT_STATIC;
     unsigned CURRENT_TIMESTAMP;
 
     unsigned m_check_sum;
+    // exactly one of them is set, depending on the layout osrm-datastore chose
     std::unique_ptr<QueryGraph> m_query_graph;
+    std::unique_ptr<SplitGraph> m_split_query_graph;
     std::unique_ptr<SharedMemory> m_layout_memory;
     std::unique_ptr<SharedMemory> m_large_memory;
+    std::unique_ptr<SharedMemory> m_static_memory;
+    std::unique_ptr<boost::interprocess::mapped_region> m_image_region;
     std::string m_timestamp;
 
     std::shared_ptr<ShM<FixedPointCoordinate, true>::vector> m_coordinate_list;
     ShM<NodeID, true>::vector m_via_node_list;
-    ShM<unsigned, true>::vector m_name_ID_list;
-    ShM<TurnInstruction, true>::vector m_turn_instruction_list;
-    ShM<TravelMode, true>::vector m_travel_mode_list;
+    SharedDataLayout::NameIDVector m_name_ID_list;
+    SharedDataLayout::TurnInstructionVector m_turn_instruction_list;
+    SharedDataLayout::TravelModeVector m_travel_mode_list;
     ShM<char, true>::vector m_names_char_list;
     ShM<unsigned, true>::vector m_name_begin_indices;
-    ShM<bool, true>::vector m_edge_is_compressed;
+    SharedDataLayout::FlagVector m_edge_is_compressed;
     ShM<unsigned, true>::vector m_geometry_indices;
     ShM<unsigned, true>::vector m_geometry_list;
-    ShM<bool, true>::vector m_is_core_node;
-
-    boost::thread_specific_ptr<std::pair<unsigned, std::shared_ptr<SharedRTree>>> m_static_rtree;
+    // the geometries in the encoding of geometry_encoding.hpp, instead of m_geometry_list
+    ShM<unsigned, true>::vector m_geometry_block_offsets;
+    ShM<std::uint8_t, true>::vector m_encoded_geometries;
+    ShM<std::uint8_t, true>::vector m_geometry_zoom_levels;
+    SharedDataLayout::FlagVector m_is_core_node;
+    LandmarkTable<true> m_landmark_table;
+
+    std::unique_ptr<SharedRTree> m_static_rtree;
+    std::unique_ptr<StaticKDTree<true>> m_locate_index;
     boost::filesystem::path file_index_path;
 
     std::shared_ptr<RangeTable<16, true>> m_name_table;
+    std::unique_ptr<PhantomNodeCache> m_phantom_node_cache;
+    std::unique_ptr<ShortcutCache> m_shortcut_cache;
+
+    // the graph blocks live in the DATA region, all others in the STATIC one
+    template <typename T> T *GetBlockPtr(const SharedDataLayout::BlockID bid) const
+    {
+        char *region = SharedDataLayout::IsGraphBlock(bid) ? shared_memory : static_memory;
+        return data_layout->GetBlockPtr<T>(region, bid);
+    }
 
     void LoadChecksum()
     {
-        m_check_sum =
-            *data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::HSGR_CHECKSUM);
+        m_check_sum = *GetBlockPtr<unsigned>(SharedDataLayout::HSGR_CHECKSUM);
         SimpleLogger().Write() << "set checksum: " << m_check_sum;
     }
 
     void LoadTimestamp()
     {
-        char *timestamp_ptr =
-            data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::TIMESTAMP);
+        char *timestamp_ptr = GetBlockPtr<char>(SharedDataLayout::TIMESTAMP);
         m_timestamp.resize(data_layout->GetBlockSize(SharedDataLayout::TIMESTAMP));
         std::copy(timestamp_ptr,
                   timestamp_ptr + data_layout->GetBlockSize(SharedDataLayout::TIMESTAMP),
@@ -111,62 +150,98 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
     {
         BOOST_ASSERT_MSG(!m_coordinate_list->empty(), "coordinates must be loaded before r-tree");
 
-        RTreeNode *tree_ptr =
-            data_layout->GetBlockPtr<RTreeNode>(shared_memory, SharedDataLayout::R_SEARCH_TREE);
-        m_static_rtree.reset(new TimeStampedRTreePair(
-            CURRENT_TIMESTAMP,
-            osrm::make_unique<SharedRTree>(
-                tree_ptr, data_layout->num_entries[SharedDataLayout::R_SEARCH_TREE],
-                file_index_path, m_coordinate_list)));
+        RTreeNode *tree_ptr = GetBlockPtr<RTreeNode>(SharedDataLayout::R_SEARCH_TREE);
+        m_static_rtree = osrm::make_unique<SharedRTree>(
+            tree_ptr, data_layout->num_entries[SharedDataLayout::R_SEARCH_TREE], file_index_path,
+            m_coordinate_list);
+
+        if (data_layout->num_entries[SharedDataLayout::GRID_CELL_IDS] > 0)
+        {
+            m_static_rtree->SetSegmentGrid(osrm::make_unique<typename SharedRTree::SegmentGridT>(
+                GetBlockPtr<uint64_t>(SharedDataLayout::GRID_CELL_IDS),
+                GetBlockPtr<uint32_t>(SharedDataLayout::GRID_CELL_OFFSETS),
+                GetBlockPtr<RTreeLeaf>(SharedDataLayout::GRID_SEGMENTS),
+                data_layout->num_entries[SharedDataLayout::GRID_CELL_IDS],
+                data_layout->num_entries[SharedDataLayout::GRID_SEGMENTS]));
+        }
+
+        if (data_layout->num_entries[SharedDataLayout::PROJECTED_LATITUDE_LIST] > 0)
+        {
+            m_static_rtree->SetProjectedLatitudes(
+                std::make_shared<typename SharedRTree::ProjectedLatitudeListT>(
+                    GetBlockPtr<double>(SharedDataLayout::PROJECTED_LATITUDE_LIST),
+                    data_layout->num_entries[SharedDataLayout::PROJECTED_LATITUDE_LIST]));
+        }
+
+        if (data_layout->num_entries[SharedDataLayout::LOCATE_INDEX] > 0)
+        {
+            m_locate_index = osrm::make_unique<StaticKDTree<true>>(
+                GetBlockPtr<FixedPointCoordinate>(SharedDataLayout::LOCATE_INDEX),
+                data_layout->num_entries[SharedDataLayout::LOCATE_INDEX]);
+        }
     }
 
     void LoadGraph()
     {
-        GraphNode *graph_nodes_ptr =
-            data_layout->GetBlockPtr<GraphNode>(shared_memory, SharedDataLayout::GRAPH_NODE_LIST);
-
-        GraphEdge *graph_edges_ptr =
-            data_layout->GetBlockPtr<GraphEdge>(shared_memory, SharedDataLayout::GRAPH_EDGE_LIST);
+        GraphNode *graph_nodes_ptr = GetBlockPtr<GraphNode>(SharedDataLayout::GRAPH_NODE_LIST);
 
         typename ShM<GraphNode, true>::vector node_list(
             graph_nodes_ptr, data_layout->num_entries[SharedDataLayout::GRAPH_NODE_LIST]);
+
+        if (data_layout->HasSplitGraph())
+        {
+            using HotEdge = typename SplitGraph::HotEdgeEntry;
+            using ColdEdge = typename SplitGraph::ColdEdgeEntry;
+            typename ShM<HotEdge, true>::vector hot_edge_list(
+                GetBlockPtr<HotEdge>(SharedDataLayout::GRAPH_EDGE_LIST),
+                data_layout->num_entries[SharedDataLayout::GRAPH_EDGE_LIST]);
+            typename ShM<ColdEdge, true>::vector cold_edge_list(
+                GetBlockPtr<ColdEdge>(SharedDataLayout::GRAPH_EDGE_IDS),
+                data_layout->num_entries[SharedDataLayout::GRAPH_EDGE_IDS]);
+            m_query_graph.reset();
+            m_split_query_graph.reset(new SplitGraph(node_list, hot_edge_list, cold_edge_list));
+            return;
+        }
+
+        GraphEdge *graph_edges_ptr = GetBlockPtr<GraphEdge>(SharedDataLayout::GRAPH_EDGE_LIST);
         typename ShM<GraphEdge, true>::vector edge_list(
             graph_edges_ptr, data_layout->num_entries[SharedDataLayout::GRAPH_EDGE_LIST]);
+        m_split_query_graph.reset();
         m_query_graph.reset(new QueryGraph(node_list, edge_list));
     }
 
     void LoadNodeAndEdgeInformation()
     {
 
-        FixedPointCoordinate *coordinate_list_ptr = data_layout->GetBlockPtr<FixedPointCoordinate>(
-            shared_memory, SharedDataLayout::COORDINATE_LIST);
+        FixedPointCoordinate *coordinate_list_ptr =
+            GetBlockPtr<FixedPointCoordinate>(SharedDataLayout::COORDINATE_LIST);
         m_coordinate_list = osrm::make_unique<ShM<FixedPointCoordinate, true>::vector>(
             coordinate_list_ptr, data_layout->num_entries[SharedDataLayout::COORDINATE_LIST]);
 
-        TravelMode *travel_mode_list_ptr =
-            data_layout->GetBlockPtr<TravelMode>(shared_memory, SharedDataLayout::TRAVEL_MODE);
-        typename ShM<TravelMode, true>::vector travel_mode_list(
+        uint64_t *travel_mode_list_ptr = GetBlockPtr<uint64_t>(SharedDataLayout::TRAVEL_MODE);
+        SharedDataLayout::TravelModeVector travel_mode_list(
             travel_mode_list_ptr, data_layout->num_entries[SharedDataLayout::TRAVEL_MODE]);
         m_travel_mode_list.swap(travel_mode_list);
 
-        TurnInstruction *turn_instruction_list_ptr = data_layout->GetBlockPtr<TurnInstruction>(
-            shared_memory, SharedDataLayout::TURN_INSTRUCTION);
-        typename ShM<TurnInstruction, true>::vector turn_instruction_list(
+        uint64_t *turn_instruction_list_ptr =
+            GetBlockPtr<uint64_t>(SharedDataLayout::TURN_INSTRUCTION);
+        SharedDataLayout::TurnInstructionVector turn_instruction_list(
             turn_instruction_list_ptr,
             data_layout->num_entries[SharedDataLayout::TURN_INSTRUCTION]);
         m_turn_instruction_list.swap(turn_instruction_list);
 
-        unsigned *name_id_list_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::NAME_ID_LIST);
-        typename ShM<unsigned, true>::vector name_id_list(
-            name_id_list_ptr, data_layout->num_entries[SharedDataLayout::NAME_ID_LIST]);
+        unsigned *name_id_list_ptr = GetBlockPtr<unsigned>(SharedDataLayout::NAME_ID_LIST);
+        uint64_t *name_id_run_starts_ptr =
+            GetBlockPtr<uint64_t>(SharedDataLayout::NAME_ID_RUN_STARTS);
+        SharedDataLayout::NameIDVector name_id_list(
+            name_id_list_ptr, data_layout->num_entries[SharedDataLayout::NAME_ID_LIST],
+            name_id_run_starts_ptr, data_layout->num_entries[SharedDataLayout::NAME_ID_RUN_STARTS]);
         m_name_ID_list.swap(name_id_list);
     }
 
     void LoadViaNodeList()
     {
-        NodeID *via_node_list_ptr =
-            data_layout->GetBlockPtr<NodeID>(shared_memory, SharedDataLayout::VIA_NODE_LIST);
+        NodeID *via_node_list_ptr = GetBlockPtr<NodeID>(SharedDataLayout::VIA_NODE_LIST);
         typename ShM<NodeID, true>::vector via_node_list(
             via_node_list_ptr, data_layout->num_entries[SharedDataLayout::VIA_NODE_LIST]);
         m_via_node_list.swap(via_node_list);
@@ -174,17 +249,14 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
 
     void LoadNames()
     {
-        unsigned *offsets_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::NAME_OFFSETS);
-        NameIndexBlock *blocks_ptr =
-            data_layout->GetBlockPtr<NameIndexBlock>(shared_memory, SharedDataLayout::NAME_BLOCKS);
+        unsigned *offsets_ptr = GetBlockPtr<unsigned>(SharedDataLayout::NAME_OFFSETS);
+        NameIndexBlock *blocks_ptr = GetBlockPtr<NameIndexBlock>(SharedDataLayout::NAME_BLOCKS);
         typename ShM<unsigned, true>::vector name_offsets(
             offsets_ptr, data_layout->num_entries[SharedDataLayout::NAME_OFFSETS]);
         typename ShM<NameIndexBlock, true>::vector name_blocks(
             blocks_ptr, data_layout->num_entries[SharedDataLayout::NAME_BLOCKS]);
 
-        char *names_list_ptr =
-            data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::NAME_CHAR_LIST);
+        char *names_list_ptr = GetBlockPtr<char>(SharedDataLayout::NAME_CHAR_LIST);
         typename ShM<char, true>::vector names_char_list(
             names_list_ptr, data_layout->num_entries[SharedDataLayout::NAME_CHAR_LIST]);
         m_name_table = osrm::make_unique<RangeTable<16, true>>(
@@ -200,34 +272,161 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
             return;
         }
 
-        unsigned *core_marker_ptr = data_layout->GetBlockPtr<unsigned>(
-            shared_memory, SharedDataLayout::CORE_MARKER);
-        typename ShM<bool, true>::vector is_core_node(
+        uint64_t *core_marker_ptr = GetBlockPtr<uint64_t>(SharedDataLayout::CORE_MARKER);
+        SharedDataLayout::FlagVector is_core_node(
             core_marker_ptr,
             data_layout->num_entries[SharedDataLayout::CORE_MARKER]);
         m_is_core_node.swap(is_core_node);
     }
 
+    void LoadLandmarks()
+    {
+        LandmarkTable<true> landmark_table(
+            GetBlockPtr<NodeID>(SharedDataLayout::LANDMARK_NODES),
+            GetBlockPtr<uint32_t>(SharedDataLayout::LANDMARK_CORE_INDEX),
+            GetBlockPtr<EdgeWeight>(SharedDataLayout::LANDMARK_DISTANCES),
+            data_layout->num_entries[SharedDataLayout::LANDMARK_NODES],
+            data_layout->num_entries[SharedDataLayout::LANDMARK_CORE_INDEX],
+            data_layout->num_entries[SharedDataLayout::LANDMARK_DISTANCES]);
+        m_landmark_table = std::move(landmark_table);
+    }
+
     void LoadGeometries()
     {
-        unsigned *geometries_compressed_ptr = data_layout->GetBlockPtr<unsigned>(
-            shared_memory, SharedDataLayout::GEOMETRIES_INDICATORS);
-        typename ShM<bool, true>::vector edge_is_compressed(
+        uint64_t *geometries_compressed_ptr =
+            GetBlockPtr<uint64_t>(SharedDataLayout::GEOMETRIES_INDICATORS);
+        SharedDataLayout::FlagVector edge_is_compressed(
             geometries_compressed_ptr,
             data_layout->num_entries[SharedDataLayout::GEOMETRIES_INDICATORS]);
         m_edge_is_compressed.swap(edge_is_compressed);
 
-        unsigned *geometries_index_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::GEOMETRIES_INDEX);
+        unsigned *geometries_index_ptr = GetBlockPtr<unsigned>(SharedDataLayout::GEOMETRIES_INDEX);
         typename ShM<unsigned, true>::vector geometry_begin_indices(
             geometries_index_ptr, data_layout->num_entries[SharedDataLayout::GEOMETRIES_INDEX]);
         m_geometry_indices.swap(geometry_begin_indices);
 
-        unsigned *geometries_list_ptr =
-            data_layout->GetBlockPtr<unsigned>(shared_memory, SharedDataLayout::GEOMETRIES_LIST);
+        unsigned *geometries_list_ptr = GetBlockPtr<unsigned>(SharedDataLayout::GEOMETRIES_LIST);
         typename ShM<unsigned, true>::vector geometry_list(
             geometries_list_ptr, data_layout->num_entries[SharedDataLayout::GEOMETRIES_LIST]);
         m_geometry_list.swap(geometry_list);
+
+        unsigned *geometries_block_offsets_ptr =
+            GetBlockPtr<unsigned>(SharedDataLayout::GEOMETRIES_BLOCK_OFFSETS);
+        typename ShM<unsigned, true>::vector geometry_block_offsets(
+            geometries_block_offsets_ptr,
+            data_layout->num_entries[SharedDataLayout::GEOMETRIES_BLOCK_OFFSETS]);
+        m_geometry_block_offsets.swap(geometry_block_offsets);
+
+        std::uint8_t *geometries_encoded_ptr =
+            GetBlockPtr<std::uint8_t>(SharedDataLayout::GEOMETRIES_ENCODED_LIST);
+        typename ShM<std::uint8_t, true>::vector encoded_geometries(
+            geometries_encoded_ptr,
+            data_layout->num_entries[SharedDataLayout::GEOMETRIES_ENCODED_LIST]);
+        m_encoded_geometries.swap(encoded_geometries);
+
+        std::uint8_t *geometries_zoom_levels_ptr =
+            GetBlockPtr<std::uint8_t>(SharedDataLayout::GEOMETRIES_ZOOM_LEVELS);
+        typename ShM<std::uint8_t, true>::vector geometry_zoom_levels(
+            geometries_zoom_levels_ptr,
+            data_layout->num_entries[SharedDataLayout::GEOMETRIES_ZOOM_LEVELS]);
+        m_geometry_zoom_levels.swap(geometry_zoom_levels);
+    }
+
+    // reads a byte of every page, the pages of a region are faulted in concurrently
+    static void PrefaultRegion(const char *region, const std::uint64_t size)
+    {
+        const std::uint64_t PAGE_SIZE = 4096;
+        std::atomic<unsigned> sink(0);
+        tbb::parallel_for(tbb::blocked_range<std::uint64_t>(0, size, 1024 * PAGE_SIZE),
+                          [region, &sink, PAGE_SIZE](const tbb::blocked_range<std::uint64_t> &range)
+                          {
+                              unsigned checksum = 0;
+                              for (auto offset = range.begin(); offset < range.end();
+                                   offset += PAGE_SIZE)
+                              {
+                                  checksum += static_cast<unsigned char>(region[offset]);
+                              }
+                              sink.fetch_add(checksum, std::memory_order_relaxed);
+                          });
+    }
+
+    // The blocks that are not locked are read in random order, reading ahead of them would
+    // only evict locked or other useful pages. The locked blocks are read in full right away.
+    void LockImageBlocks(const std::vector<SharedDataLayout::BlockID> &locked_blocks) const
+    {
+#ifdef __linux__
+        if (locked_blocks.empty())
+        {
+            return;
+        }
+        char *image = static_cast<char *>(m_image_region->get_address());
+        const std::uint64_t image_size = m_image_region->get_size();
+        if (-1 == madvise(image, image_size, MADV_RANDOM))
+        {
+            SimpleLogger().Write(logWARNING) << "could not advise the kernel of the image usage";
+        }
+        std::uint64_t locked_size = 0;
+        for (const auto bid : locked_blocks)
+        {
+            const std::uint64_t block_offset = SharedDataImage::BlockOffset(*data_layout, bid);
+            const std::uint64_t begin = block_offset / 4096 * 4096;
+            const std::uint64_t end =
+                SharedDataImage::Align(block_offset + data_layout->GetBlockSize(bid));
+            if (begin == end)
+            {
+                continue;
+            }
+            madvise(image + begin, end - begin, MADV_WILLNEED);
+            if (-1 == mlock(image + begin, end - begin))
+            {
+                SimpleLogger().Write(logWARNING) << "block " << SharedDataLayout::GetBlockName(bid)
+                                                 << " of the image could not be locked to RAM";
+                continue;
+            }
+            locked_size += end - begin;
+        }
+        SimpleLogger().Write() << "locked " << locked_size << " of " << image_size
+                               << " bytes of the image to RAM";
+#else
+        if (!locked_blocks.empty())
+        {
+            SimpleLogger().Write(logWARNING) << "locking blocks of an image is not supported";
+        }
+#endif
+    }
+
+    void LoadData()
+    {
+        const char *file_index_ptr = GetBlockPtr<char>(SharedDataLayout::FILE_INDEX_PATH);
+        file_index_path = boost::filesystem::path(file_index_ptr);
+        if (!boost::filesystem::exists(file_index_path))
+        {
+            SimpleLogger().Write(logDEBUG) << "Leaf file name " << file_index_path.string();
+            throw osrm::exception("Could not load leaf index file. "
+                                  "Is any data loaded into shared memory?");
+        }
+
+        LoadGraph();
+        LoadChecksum();
+        LoadNodeAndEdgeInformation();
+        LoadGeometries();
+        LoadTimestamp();
+        LoadViaNodeList();
+        LoadNames();
+        LoadCoreInformation();
+        LoadLandmarks();
+        LoadRTree();
+
+        data_layout->PrintInformation();
+
+        SimpleLogger().Write() << "number of geometries: " << m_coordinate_list->size();
+        for (unsigned i = 0; i < m_coordinate_list->size(); ++i)
+        {
+            if (!GetCoordinateOfNode(i).is_valid())
+            {
+                SimpleLogger().Write() << "coordinate " << i << " not valid";
+            }
+        }
     }
 
   public:
@@ -239,24 +438,98 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
                                  CURRENT_REGIONS, sizeof(SharedDataTimestamp), false, false)->Ptr();
         CURRENT_LAYOUT = LAYOUT_NONE;
         CURRENT_DATA = DATA_NONE;
+        CURRENT_STATIC = STATIC_NONE;
         CURRENT_TIMESTAMP = 0;
 
         // load data
         CheckAndReloadFacade();
     }
 
+    // Maps an image written by osrm-datastore --image. Nothing is copied, so startup does
+    // not depend on the size of the dataset, and all processes mapping the same file share
+    // its page cache. Verifying the checksums of the blocks reads the whole image once.
+    // The locked blocks are read at startup and kept in RAM, the others are paged in from the
+    // file as the queries touch them.
+    explicit SharedDataFacade(const boost::filesystem::path &image_path,
+                              const bool verify_checksums = false,
+                              const std::vector<SharedDataLayout::BlockID> &locked_blocks = {})
+        : data_timestamp_ptr(nullptr)
+    {
+        if (!boost::filesystem::is_regular_file(image_path))
+        {
+            throw osrm::exception("image file " + image_path.string() + " not found");
+        }
+        SimpleLogger().Write() << "mapping image " << image_path.string();
+        const boost::interprocess::file_mapping image_file(image_path.string().c_str(),
+                                                           boost::interprocess::read_only);
+        m_image_region = osrm::make_unique<boost::interprocess::mapped_region>(
+            image_file, boost::interprocess::read_only);
+
+        char *image = static_cast<char *>(m_image_region->get_address());
+        data_layout = reinterpret_cast<SharedDataLayout *>(image);
+        if (m_image_region->get_size() < SharedDataImage::DataOffset() ||
+            m_image_region->get_size() != SharedDataImage::Size(*data_layout))
+        {
+            throw osrm::exception("image file " + image_path.string() + " is truncated");
+        }
+        shared_memory = image + SharedDataImage::DataOffset();
+        static_memory = image + SharedDataImage::StaticOffset(*data_layout);
+        LockImageBlocks(locked_blocks);
+        if (verify_checksums)
+        {
+            SimpleLogger().Write() << "verifying the checksums of the image";
+            data_layout->CheckBlockChecksums(shared_memory, static_memory);
+        }
+
+        CURRENT_LAYOUT = LAYOUT_NONE;
+        CURRENT_DATA = DATA_NONE;
+        CURRENT_STATIC = STATIC_NONE;
+        CURRENT_TIMESTAMP = 0;
+
+        LoadData();
+    }
+
+    unsigned GetLoadedTimestamp() const { return CURRENT_TIMESTAMP; }
+
+    // caches the phantom nodes of up to capacity recently queried coordinates
+    void EnablePhantomNodeCache(const unsigned capacity)
+    {
+        m_phantom_node_cache = osrm::make_unique<PhantomNodeCache>(capacity);
+    }
+
+    // caches the unpacked edges of up to capacity recently unpacked shortcuts
+    void EnableShortcutCache(const unsigned capacity)
+    {
+        m_shortcut_cache = osrm::make_unique<ShortcutCache>(capacity);
+    }
+
+    ShortcutCache *GetShortcutCache() const override final { return m_shortcut_cache.get(); }
+
+    void Prefault() const override final
+    {
+        PrefaultRegion(shared_memory, data_layout->GetSizeOfLayout(true));
+        PrefaultRegion(static_memory, data_layout->GetSizeOfLayout(false));
+    }
+
     void CheckAndReloadFacade()
     {
+        // images are immutable
+        if (nullptr == data_timestamp_ptr)
+        {
+            return;
+        }
         if (CURRENT_LAYOUT != data_timestamp_ptr->layout ||
             CURRENT_DATA != data_timestamp_ptr->data ||
+            CURRENT_STATIC != data_timestamp_ptr->static_data ||
             CURRENT_TIMESTAMP != data_timestamp_ptr->timestamp)
         {
-            // release the previous shared memory segments
+            // release the previous shared memory segments, the static one might be reused
             SharedMemory::Remove(CURRENT_LAYOUT);
             SharedMemory::Remove(CURRENT_DATA);
 
             CURRENT_LAYOUT = data_timestamp_ptr->layout;
             CURRENT_DATA = data_timestamp_ptr->data;
+            CURRENT_STATIC = data_timestamp_ptr->static_data;
             CURRENT_TIMESTAMP = data_timestamp_ptr->timestamp;
 
             m_layout_memory.reset(SharedMemoryFactory::Get(CURRENT_LAYOUT));
@@ -266,79 +539,103 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
             m_large_memory.reset(SharedMemoryFactory::Get(CURRENT_DATA));
             shared_memory = (char *)(m_large_memory->Ptr());
 
-            const char *file_index_ptr =
-                data_layout->GetBlockPtr<char>(shared_memory, SharedDataLayout::FILE_INDEX_PATH);
-            file_index_path = boost::filesystem::path(file_index_ptr);
-            if (!boost::filesystem::exists(file_index_path))
+            m_static_memory.reset(SharedMemoryFactory::Get(CURRENT_STATIC));
+            static_memory = (char *)(m_static_memory->Ptr());
+
+            LoadData();
+            if (m_phantom_node_cache)
             {
-                SimpleLogger().Write(logDEBUG) << "Leaf file name " << file_index_path.string();
-                throw osrm::exception("Could not load leaf index file. "
-                                      "Is any data loaded into shared memory?");
+                m_phantom_node_cache->Clear();
             }
-
-            LoadGraph();
-            LoadChecksum();
-            LoadNodeAndEdgeInformation();
-            LoadGeometries();
-            LoadTimestamp();
-            LoadViaNodeList();
-            LoadNames();
-            LoadCoreInformation();
-
-            data_layout->PrintInformation();
-
-            SimpleLogger().Write() << "number of geometries: " << m_coordinate_list->size();
-            for (unsigned i = 0; i < m_coordinate_list->size(); ++i)
+            if (m_shortcut_cache)
             {
-                if (!GetCoordinateOfNode(i).is_valid())
-                {
-                    SimpleLogger().Write() << "coordinate " << i << " not valid";
-                }
+                m_shortcut_cache->Clear();
             }
         }
     }
 
     // search graph access
-    unsigned GetNumberOfNodes() const override final { return m_query_graph->GetNumberOfNodes(); }
+    // the branch on the layout is taken the same way for every call of a dataset
+    unsigned GetNumberOfNodes() const override final
+    {
+        return m_split_query_graph ? m_split_query_graph->GetNumberOfNodes()
+                                   : m_query_graph->GetNumberOfNodes();
+    }
 
-    unsigned GetNumberOfEdges() const override final { return m_query_graph->GetNumberOfEdges(); }
+    unsigned GetNumberOfEdges() const override final
+    {
+        return m_split_query_graph ? m_split_query_graph->GetNumberOfEdges()
+                                   : m_query_graph->GetNumberOfEdges();
+    }
 
     unsigned GetOutDegree(const NodeID n) const override final
     {
-        return m_query_graph->GetOutDegree(n);
+        return m_split_query_graph ? m_split_query_graph->GetOutDegree(n)
+                                   : m_query_graph->GetOutDegree(n);
     }
 
-    NodeID GetTarget(const EdgeID e) const override final { return m_query_graph->GetTarget(e); }
+    NodeID GetTarget(const EdgeID e) const override final
+    {
+        return m_split_query_graph ? m_split_query_graph->GetTarget(e)
+                                   : m_query_graph->GetTarget(e);
+    }
 
-    EdgeDataT &GetEdgeData(const EdgeID e) const override final
+    EdgeDataT GetEdgeData(const EdgeID e) const override final
     {
+        if (m_split_query_graph)
+        {
+            return m_split_query_graph->GetEdgeData(e);
+        }
         return m_query_graph->GetEdgeData(e);
     }
 
-    EdgeID BeginEdges(const NodeID n) const override final { return m_query_graph->BeginEdges(n); }
+    EdgeID BeginEdges(const NodeID n) const override final
+    {
+        return m_split_query_graph ? m_split_query_graph->BeginEdges(n)
+                                   : m_query_graph->BeginEdges(n);
+    }
 
-    EdgeID EndEdges(const NodeID n) const override final { return m_query_graph->EndEdges(n); }
+    EdgeID EndEdges(const NodeID n) const override final
+    {
+        return m_split_query_graph ? m_split_query_graph->EndEdges(n)
+                                   : m_query_graph->EndEdges(n);
+    }
 
     EdgeRange GetAdjacentEdgeRange(const NodeID node) const override final
     {
-        return m_query_graph->GetAdjacentEdgeRange(node);
+        return m_split_query_graph ? m_split_query_graph->GetAdjacentEdgeRange(node)
+                                   : m_query_graph->GetAdjacentEdgeRange(node);
     };
 
+    void PrefetchAdjacentEdges(const NodeID node) const override final
+    {
+        if (m_split_query_graph)
+        {
+            m_split_query_graph->PrefetchEdges(node);
+            return;
+        }
+        m_query_graph->PrefetchEdges(node);
+    }
+
     // searches for a specific edge
     EdgeID FindEdge(const NodeID from, const NodeID to) const override final
     {
-        return m_query_graph->FindEdge(from, to);
+        return m_split_query_graph ? m_split_query_graph->FindEdge(from, to)
+                                   : m_query_graph->FindEdge(from, to);
     }
 
     EdgeID FindEdgeInEitherDirection(const NodeID from, const NodeID to) const override final
     {
-        return m_query_graph->FindEdgeInEitherDirection(from, to);
+        return m_split_query_graph ? m_split_query_graph->FindEdgeInEitherDirection(from, to)
+                                   : m_query_graph->FindEdgeInEitherDirection(from, to);
     }
 
     EdgeID
     FindEdgeIndicateIfReverse(const NodeID from, const NodeID to, bool &result) const override final
     {
-        return m_query_graph->FindEdgeIndicateIfReverse(from, to, result);
+        return m_split_query_graph
+                   ? m_split_query_graph->FindEdgeIndicateIfReverse(from, to, result)
+                   : m_query_graph->FindEdgeIndicateIfReverse(from, to, result);
     }
 
     // node and edge information access
@@ -352,17 +649,40 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
         return m_edge_is_compressed.at(id);
     }
 
-    virtual void GetUncompressedGeometry(const unsigned id,
-                                         std::vector<unsigned> &result_nodes) const override final
+    typename super::GeometryRange
+    GetUncompressedGeometryRange(const unsigned id) const override final
     {
         const unsigned begin = m_geometry_indices.at(id);
         const unsigned end = m_geometry_indices.at(id + 1);
+        if (begin == end)
+        {
+            return typename super::GeometryRange();
+        }
+        if (!m_encoded_geometries.empty())
+        {
+            // decoded into a buffer of the calling thread, valid until its next call
+            static thread_local std::vector<unsigned> decoded_geometry;
+            geometry_encoding::Decode(&m_geometry_indices[0], &m_geometry_block_offsets[0],
+                                      &m_encoded_geometries[0], id, decoded_geometry);
+            return typename super::GeometryRange(decoded_geometry.data(),
+                                                 decoded_geometry.data() +
+                                                     decoded_geometry.size());
+        }
+        const unsigned *geometry = &m_geometry_list[begin];
+        return typename super::GeometryRange(geometry, geometry + (end - begin));
+    }
 
-        result_nodes.clear();
-        result_nodes.insert(result_nodes.begin(), m_geometry_list.begin() + begin,
-                            m_geometry_list.begin() + end);
+    const std::uint8_t *GetUncompressedGeometryZoomLevels(const unsigned id) const override final
+    {
+        if (m_geometry_zoom_levels.empty())
+        {
+            return nullptr;
+        }
+        return &m_geometry_zoom_levels[m_geometry_indices.at(id)];
     }
 
+    bool HasGeometryZoomLevels() const override final { return !m_geometry_zoom_levels.empty(); }
+
     virtual unsigned GetGeometryIndexForEdgeID(const unsigned id) const override final
     {
         return m_via_node_list.at(id);
@@ -382,13 +702,13 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
                                             FixedPointCoordinate &result,
                                             const unsigned zoom_level = 18) override final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
+        // the kd-tree has no component information, tiny ones are only skipped up to zoom 14
+        if (m_locate_index && zoom_level > 14)
         {
-            LoadRTree();
+            return m_locate_index->NearestNeighbor(input_coordinate, result);
         }
-
-        return m_static_rtree->second->LocateClosestEndPointForCoordinate(input_coordinate, result,
-                                                                          zoom_level);
+        return m_static_rtree->LocateClosestEndPointForCoordinate(input_coordinate, result,
+                                                                  zoom_level);
     }
 
     bool IncrementalFindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
@@ -409,15 +729,30 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
     bool
     IncrementalFindPhantomNodeForCoordinate(const FixedPointCoordinate &input_coordinate,
                                             std::vector<PhantomNode> &resulting_phantom_node_vector,
-                                            const unsigned number_of_results) override final
+                                            const unsigned number_of_results,
+                                            const int bearing = 0,
+                                            const int bearing_range = 180) override final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
+        // the cache only holds unfiltered results
+        const bool use_cache = m_phantom_node_cache && bearing_range >= 180;
+        if (use_cache &&
+            m_phantom_node_cache->Fetch(input_coordinate, number_of_results,
+                                        resulting_phantom_node_vector))
         {
-            LoadRTree();
+            return !resulting_phantom_node_vector.empty();
         }
-
-        return m_static_rtree->second->IncrementalFindPhantomNodeForCoordinate(
-            input_coordinate, resulting_phantom_node_vector, number_of_results);
+        const auto previous_size = resulting_phantom_node_vector.size();
+        const bool result = m_static_rtree->IncrementalFindPhantomNodeForCoordinate(
+            input_coordinate, resulting_phantom_node_vector, number_of_results, bearing,
+            bearing_range);
+        if (use_cache)
+        {
+            m_phantom_node_cache->Insert(
+                input_coordinate, number_of_results,
+                std::vector<PhantomNode>(resulting_phantom_node_vector.begin() + previous_size,
+                                         resulting_phantom_node_vector.end()));
+        }
+        return result;
     }
 
     bool IncrementalFindPhantomNodeForCoordinateWithMaxDistance(
@@ -425,15 +760,19 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
         std::vector<std::pair<PhantomNode, double>> &resulting_phantom_node_vector,
         const double max_distance) override final
     {
-        if (!m_static_rtree.get() || CURRENT_TIMESTAMP != m_static_rtree->first)
-        {
-            LoadRTree();
-        }
-
-        return m_static_rtree->second->IncrementalFindPhantomNodeForCoordinateWithDistance(
+        return m_static_rtree->IncrementalFindPhantomNodeForCoordinateWithDistance(
             input_coordinate, resulting_phantom_node_vector, max_distance);
     }
 
+    void IncrementalFindPhantomNodesForCoordinatesWithMaxDistance(
+        const std::vector<FixedPointCoordinate> &input_coordinates,
+        std::vector<std::vector<std::pair<PhantomNode, double>>> &resulting_phantom_node_vectors,
+        const double max_distance) override final
+    {
+        m_static_rtree->IncrementalFindPhantomNodesForCoordinatesWithDistance(
+            input_coordinates, resulting_phantom_node_vectors, max_distance);
+    }
+
     unsigned GetCheckSum() const override final { return m_check_sum; }
 
     unsigned GetNameIndexFromEdgeID(const unsigned id) const override final
@@ -441,23 +780,19 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
         return m_name_ID_list.at(id);
     };
 
-    std::string get_name_for_id(const unsigned name_id) const override final
+    boost::string_ref get_name_ref_for_id(const unsigned name_id) const override final
     {
         if (std::numeric_limits<unsigned>::max() == name_id)
         {
-            return "";
+            return boost::string_ref();
         }
         auto range = m_name_table->GetRange(name_id);
-
-        std::string result;
-        result.reserve(range.size());
-        if (range.begin() != range.end())
+        if (0 == range.size())
         {
-            result.resize(range.back() - range.front() + 1);
-            std::copy(m_names_char_list.begin() + range.front(),
-                      m_names_char_list.begin() + range.back() + 1, result.begin());
+            return boost::string_ref();
         }
-        return result;
+        return boost::string_ref(&m_names_char_list[range.front()],
+                                 range.back() - range.front() + 1);
     }
 
     bool IsCoreNode(const NodeID id) const override final
@@ -470,6 +805,18 @@ template <class EdgeDataT> class SharedDataFacade final : public BaseDataFacade<
         return false;
     }
 
+    bool HasCore() const override final { return m_is_core_node.size() > 0; }
+
+    unsigned GetNumberOfLandmarks() const override final
+    {
+        return m_landmark_table.GetNumberOfLandmarks();
+    }
+
+    const EdgeWeight *GetLandmarkDistances(const NodeID id) const override final
+    {
+        return m_landmark_table.GetDistances(id);
+    }
+
     std::string GetTimestamp() const override final { return m_timestamp; }
 };
 
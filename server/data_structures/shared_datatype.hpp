@@ -28,12 +28,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef SHARED_DATA_TYPE_HPP
 #define SHARED_DATA_TYPE_HPP
 
+#include "../../algorithms/crc32_processor.hpp"
+#include "../../data_structures/bit_vector.hpp"
+#include "../../data_structures/original_edge_data.hpp"
+#include "../../data_structures/run_length_vector.hpp"
 #include "../../util/osrm_exception.hpp"
 #include "../../util/simple_logger.hpp"
 
 #include <cstdint>
 
 #include <array>
+#include <string>
 
 namespace
 {
@@ -58,57 +63,103 @@ struct SharedDataLayout
         R_SEARCH_TREE,
         GEOMETRIES_INDEX,
         GEOMETRIES_LIST,
+        GEOMETRIES_ZOOM_LEVELS,
         GEOMETRIES_INDICATORS,
         HSGR_CHECKSUM,
         TIMESTAMP,
         FILE_INDEX_PATH,
         CORE_MARKER,
+        GRID_CELL_IDS,
+        GRID_CELL_OFFSETS,
+        GRID_SEGMENTS,
+        LANDMARK_NODES,
+        LANDMARK_CORE_INDEX,
+        LANDMARK_DISTANCES,
+        PROJECTED_LATITUDE_LIST,
+        LOCATE_INDEX,
+        GRAPH_EDGE_IDS,
+        GEOMETRIES_BLOCK_OFFSETS,
+        GEOMETRIES_ENCODED_LIST,
+        NAME_ID_RUN_STARTS,
         NUM_BLOCKS
     };
 
+    // CORE_MARKER, GEOMETRIES_INDICATORS and NAME_ID_RUN_STARTS are bit vectors, TRAVEL_MODE
+    // and TURN_INSTRUCTION are packed. num_entries is the number of flags or values for these
+    // blocks. NAME_ID_LIST holds one name id per run of edges, see RunLengthVector.
+    using FlagVector = BitVector<true>;
+    using NameIDVector = RunLengthVector<unsigned, true>;
+    using TravelModeVector = ::TravelModeVector<true>;
+    using TurnInstructionVector = ::TurnInstructionVector<true>;
+
+    // every block starts on a cache line, so the word based blocks can be read in place
+    static constexpr uint64_t BLOCK_ALIGNMENT = 64;
+
     std::array<uint64_t, NUM_BLOCKS> num_entries;
     std::array<uint64_t, NUM_BLOCKS> entry_size;
+    // content hash of the inputs of all static blocks
+    uint64_t static_blocks_fingerprint;
+    // CRC32C of the contents of every block, only set for images
+    std::array<uint32_t, NUM_BLOCKS> block_checksums;
 
-    SharedDataLayout() : num_entries(), entry_size() {}
+    SharedDataLayout()
+        : num_entries(), entry_size(), static_blocks_fingerprint(0), block_checksums()
+    {
+    }
+
+    // Blocks that change with every contraction live in the DATA region. All other blocks only
+    // change with a new extract, they live in a STATIC region that osrm-datastore reuses as long
+    // as the fingerprint of their inputs did not change.
+    static uint64_t AlignBlock(const uint64_t offset)
+    {
+        return (offset + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+    }
+
+    static bool IsGraphBlock(const BlockID bid)
+    {
+        return GRAPH_NODE_LIST == bid || GRAPH_EDGE_LIST == bid || GRAPH_EDGE_IDS == bid ||
+               HSGR_CHECKSUM == bid || LANDMARK_NODES == bid || LANDMARK_CORE_INDEX == bid ||
+               LANDMARK_DISTANCES == bid;
+    }
+
+    // With a split search graph, GRAPH_EDGE_LIST holds the hot edges of a SplitQueryGraph and
+    // GRAPH_EDGE_IDS the cold ones. Otherwise GRAPH_EDGE_IDS has no entry size.
+    bool HasSplitGraph() const { return entry_size[GRAPH_EDGE_IDS] > 0; }
+
+    static const char *GetBlockName(const BlockID bid)
+    {
+        static const char *const names[NUM_BLOCKS] = {
+            "NAME_OFFSETS", "NAME_BLOCKS", "NAME_CHAR_LIST", "NAME_ID_LIST", "VIA_NODE_LIST",
+            "GRAPH_NODE_LIST", "GRAPH_EDGE_LIST", "COORDINATE_LIST", "TURN_INSTRUCTION",
+            "TRAVEL_MODE", "R_SEARCH_TREE", "GEOMETRIES_INDEX", "GEOMETRIES_LIST",
+            "GEOMETRIES_ZOOM_LEVELS", "GEOMETRIES_INDICATORS", "HSGR_CHECKSUM", "TIMESTAMP",
+            "FILE_INDEX_PATH", "CORE_MARKER", "GRID_CELL_IDS", "GRID_CELL_OFFSETS", "GRID_SEGMENTS",
+            "LANDMARK_NODES", "LANDMARK_CORE_INDEX", "LANDMARK_DISTANCES",
+            "PROJECTED_LATITUDE_LIST", "LOCATE_INDEX", "GRAPH_EDGE_IDS", "GEOMETRIES_BLOCK_OFFSETS",
+            "GEOMETRIES_ENCODED_LIST", "NAME_ID_RUN_STARTS"};
+        return names[bid];
+    }
+
+    // the block of the given name, NUM_BLOCKS if there is none
+    static BlockID FindBlock(const std::string &name)
+    {
+        for (auto i = 0; i < NUM_BLOCKS; i++)
+        {
+            if (name == GetBlockName((BlockID)i))
+            {
+                return (BlockID)i;
+            }
+        }
+        return NUM_BLOCKS;
+    }
 
     void PrintInformation() const
     {
-        SimpleLogger().Write(logDEBUG) << "NAME_OFFSETS         "
-                                       << ": " << GetBlockSize(NAME_OFFSETS);
-        SimpleLogger().Write(logDEBUG) << "NAME_BLOCKS          "
-                                       << ": " << GetBlockSize(NAME_BLOCKS);
-        SimpleLogger().Write(logDEBUG) << "NAME_CHAR_LIST       "
-                                       << ": " << GetBlockSize(NAME_CHAR_LIST);
-        SimpleLogger().Write(logDEBUG) << "NAME_ID_LIST         "
-                                       << ": " << GetBlockSize(NAME_ID_LIST);
-        SimpleLogger().Write(logDEBUG) << "VIA_NODE_LIST        "
-                                       << ": " << GetBlockSize(VIA_NODE_LIST);
-        SimpleLogger().Write(logDEBUG) << "GRAPH_NODE_LIST      "
-                                       << ": " << GetBlockSize(GRAPH_NODE_LIST);
-        SimpleLogger().Write(logDEBUG) << "GRAPH_EDGE_LIST      "
-                                       << ": " << GetBlockSize(GRAPH_EDGE_LIST);
-        SimpleLogger().Write(logDEBUG) << "COORDINATE_LIST      "
-                                       << ": " << GetBlockSize(COORDINATE_LIST);
-        SimpleLogger().Write(logDEBUG) << "TURN_INSTRUCTION     "
-                                       << ": " << GetBlockSize(TURN_INSTRUCTION);
-        SimpleLogger().Write(logDEBUG) << "TRAVEL_MODE          "
-                                       << ": " << GetBlockSize(TRAVEL_MODE);
-        SimpleLogger().Write(logDEBUG) << "R_SEARCH_TREE        "
-                                       << ": " << GetBlockSize(R_SEARCH_TREE);
-        SimpleLogger().Write(logDEBUG) << "GEOMETRIES_INDEX     "
-                                       << ": " << GetBlockSize(GEOMETRIES_INDEX);
-        SimpleLogger().Write(logDEBUG) << "GEOMETRIES_LIST      "
-                                       << ": " << GetBlockSize(GEOMETRIES_LIST);
-        SimpleLogger().Write(logDEBUG) << "GEOMETRIES_INDICATORS"
-                                       << ": " << GetBlockSize(GEOMETRIES_INDICATORS);
-        SimpleLogger().Write(logDEBUG) << "HSGR_CHECKSUM        "
-                                       << ": " << GetBlockSize(HSGR_CHECKSUM);
-        SimpleLogger().Write(logDEBUG) << "TIMESTAMP            "
-                                       << ": " << GetBlockSize(TIMESTAMP);
-        SimpleLogger().Write(logDEBUG) << "FILE_INDEX_PATH      "
-                                       << ": " << GetBlockSize(FILE_INDEX_PATH);
-        SimpleLogger().Write(logDEBUG) << "CORE_MARKER          "
-                                       << ": " << GetBlockSize(CORE_MARKER);
+        for (auto i = 0; i < NUM_BLOCKS; i++)
+        {
+            SimpleLogger().Write(logDEBUG) << GetBlockName((BlockID)i) << ": "
+                                           << GetBlockSize((BlockID)i);
+        }
     }
 
     template <typename T> inline void SetBlockSize(BlockID bid, uint64_t entries)
@@ -120,28 +171,82 @@ struct SharedDataLayout
     inline uint64_t GetBlockSize(BlockID bid) const
     {
         // special bit encoding
-        if (bid == GEOMETRIES_INDICATORS || bid == CORE_MARKER)
+        if (bid == GEOMETRIES_INDICATORS || bid == CORE_MARKER || bid == NAME_ID_RUN_STARTS)
+        {
+            return FlagVector::GetNumberOfWords(num_entries[bid]) * sizeof(FlagVector::WordT);
+        }
+        if (bid == TRAVEL_MODE)
         {
-            return (num_entries[bid] / 32 + 1) *
-                   entry_size[bid];
+            return TravelModeVector::GetNumberOfWords(num_entries[bid]) *
+                   sizeof(TravelModeVector::WordT);
+        }
+        if (bid == TURN_INSTRUCTION)
+        {
+            return TurnInstructionVector::GetNumberOfWords(num_entries[bid]) *
+                   sizeof(TurnInstructionVector::WordT);
         }
 
         return num_entries[bid] * entry_size[bid];
     }
 
-    inline uint64_t GetSizeOfLayout() const
+    // size of the region holding either the graph or the static blocks
+    inline uint64_t GetSizeOfLayout(const bool graph_blocks) const
     {
-        return GetBlockOffset(NUM_BLOCKS) + NUM_BLOCKS * 2 * sizeof(CANARY);
+        uint64_t result = 0;
+        for (auto i = 0; i < NUM_BLOCKS; i++)
+        {
+            if (IsGraphBlock((BlockID)i) == graph_blocks)
+            {
+                result = AlignBlock(result + sizeof(CANARY)) + GetBlockSize((BlockID)i) +
+                         sizeof(CANARY);
+            }
+        }
+        return result;
     }
 
+    // offset relative to the start of the region the block lives in
     inline uint64_t GetBlockOffset(BlockID bid) const
     {
-        uint64_t result = sizeof(CANARY);
+        uint64_t result = 0;
         for (auto i = 0; i < bid; i++)
         {
-            result += GetBlockSize((BlockID)i) + 2 * sizeof(CANARY);
+            if (IsGraphBlock((BlockID)i) == IsGraphBlock(bid))
+            {
+                result = AlignBlock(result + sizeof(CANARY)) + GetBlockSize((BlockID)i) +
+                         sizeof(CANARY);
+            }
+        }
+        return AlignBlock(result + sizeof(CANARY));
+    }
+
+    // region is the start of the region the block lives in
+    uint32_t ComputeBlockChecksum(const char *region, BlockID bid) const
+    {
+        const IteratorbasedCRC32 crc32;
+        return crc32.checksum(region + GetBlockOffset(bid), GetBlockSize(bid));
+    }
+
+    void SetBlockChecksums(const char *data_region, const char *static_region)
+    {
+        for (auto i = 0; i < NUM_BLOCKS; i++)
+        {
+            block_checksums[i] = ComputeBlockChecksum(
+                IsGraphBlock((BlockID)i) ? data_region : static_region, (BlockID)i);
+        }
+    }
+
+    void CheckBlockChecksums(const char *data_region, const char *static_region) const
+    {
+        for (auto i = 0; i < NUM_BLOCKS; i++)
+        {
+            if (block_checksums[i] !=
+                ComputeBlockChecksum(IsGraphBlock((BlockID)i) ? data_region : static_region,
+                                     (BlockID)i))
+            {
+                throw osrm::exception("Checksum of block " + std::to_string(i) +
+                                      " does not match, the data is corrupted.");
+            }
         }
-        return result;
     }
 
     template <typename T, bool WRITE_CANARY = false>
@@ -175,6 +280,36 @@ struct SharedDataLayout
     }
 };
 
+// On-disk image of a dataset: the layout followed by the DATA and the STATIC region, both
+// starting on a page boundary. osrm-datastore --image writes it, osrm-routed maps it in place.
+struct SharedDataImage
+{
+    static uint64_t Align(const uint64_t offset)
+    {
+        const uint64_t page_size = 4096;
+        return (offset + page_size - 1) / page_size * page_size;
+    }
+
+    static uint64_t DataOffset() { return Align(sizeof(SharedDataLayout)); }
+
+    static uint64_t StaticOffset(const SharedDataLayout &layout)
+    {
+        return Align(DataOffset() + layout.GetSizeOfLayout(true));
+    }
+
+    static uint64_t Size(const SharedDataLayout &layout)
+    {
+        return StaticOffset(layout) + layout.GetSizeOfLayout(false);
+    }
+
+    // offset of a block from the start of the image
+    static uint64_t BlockOffset(const SharedDataLayout &layout, const SharedDataLayout::BlockID bid)
+    {
+        return (SharedDataLayout::IsGraphBlock(bid) ? DataOffset() : StaticOffset(layout)) +
+               layout.GetBlockOffset(bid);
+    }
+};
+
 enum SharedDataType
 {
     CURRENT_REGIONS,
@@ -183,7 +318,10 @@ enum SharedDataType
     LAYOUT_2,
     DATA_2,
     LAYOUT_NONE,
-    DATA_NONE
+    DATA_NONE,
+    STATIC_1,
+    STATIC_2,
+    STATIC_NONE
 };
 
 struct SharedDataTimestamp
@@ -191,6 +329,7 @@ struct SharedDataTimestamp
     SharedDataType layout;
     SharedDataType data;
     unsigned timestamp;
+    SharedDataType static_data;
 };
 
 #endif /* SHARED_DATA_TYPE_HPP */
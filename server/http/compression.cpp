@@ -0,0 +1,511 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "compression.hpp"
+
+#include "../../algorithms/object_encoder.hpp"
+#include "../../util/osrm_exception.hpp"
+#include "../../util/sha256.hpp"
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/iostreams/concepts.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/operations.hpp>
+#include <boost/thread/tss.hpp>
+
+#ifdef OSRM_HAS_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#ifdef OSRM_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace http
+{
+
+namespace
+{
+
+// size of the buffers between the stream and the compressors, and of their output chunks
+const std::size_t COMPRESSION_CHUNK_SIZE = 16 * 1024;
+
+#ifdef OSRM_HAS_ZSTD
+struct zstd_dictionary_deleter
+{
+    void operator()(ZSTD_CDict *dictionary) const { ZSTD_freeCDict(dictionary); }
+};
+#endif
+
+struct compression_configuration
+{
+    compression_settings settings;
+    osrm::sha256_digest dictionary_hash;
+#ifdef OSRM_HAS_ZSTD
+    std::unique_ptr<ZSTD_CDict, zstd_dictionary_deleter> dictionary;
+#endif
+};
+
+compression_configuration configuration;
+
+#ifdef OSRM_HAS_ZSTD
+// the magic number and the hash of the dictionary at the start of every dcz reply
+const std::uint8_t DICTIONARY_ZSTD_MAGIC[] = {0x5e, 0x2a, 0x4d, 0x18, 0x20, 0x00, 0x00, 0x00};
+
+void free_zstd_context(ZSTD_CCtx *context) { ZSTD_freeCCtx(context); }
+
+// the context keeps its tables between the frames, a reply only resets its session
+boost::thread_specific_ptr<ZSTD_CCtx> zstd_context(free_zstd_context);
+
+void check_zstd(const std::size_t result)
+{
+    if (ZSTD_isError(result))
+    {
+        throw osrm::exception(std::string("zstd compression failed: ") +
+                              ZSTD_getErrorName(result));
+    }
+}
+
+class zstd_compressor : public boost::iostreams::multichar_output_filter
+{
+  public:
+    explicit zstd_compressor(const bool with_dictionary)
+        : with_dictionary(with_dictionary), header_written(false)
+    {
+        if (!zstd_context.get())
+        {
+            zstd_context.reset(ZSTD_createCCtx());
+            if (!zstd_context.get())
+            {
+                throw osrm::exception("could not create a zstd context");
+            }
+        }
+        context = zstd_context.get();
+        check_zstd(ZSTD_CCtx_reset(context, ZSTD_reset_session_only));
+        check_zstd(ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel,
+                                          configuration.settings.zstd_level));
+        check_zstd(ZSTD_CCtx_refCDict(
+            context, with_dictionary ? configuration.dictionary.get() : nullptr));
+    }
+
+    template <typename Sink>
+    std::streamsize write(Sink &sink, const char *data, const std::streamsize size)
+    {
+        Compress(sink, ZSTD_e_continue, data, static_cast<std::size_t>(size));
+        return size;
+    }
+
+    template <typename Sink> void close(Sink &sink) { Compress(sink, ZSTD_e_end, nullptr, 0); }
+
+  private:
+    template <typename Sink>
+    void Compress(Sink &sink, const ZSTD_EndDirective directive, const char *data,
+                  const std::size_t size)
+    {
+        if (with_dictionary && !header_written)
+        {
+            boost::iostreams::write(sink, reinterpret_cast<const char *>(DICTIONARY_ZSTD_MAGIC),
+                                    sizeof(DICTIONARY_ZSTD_MAGIC));
+            boost::iostreams::write(
+                sink, reinterpret_cast<const char *>(configuration.dictionary_hash.data()),
+                configuration.dictionary_hash.size());
+            header_written = true;
+        }
+
+        char buffer[COMPRESSION_CHUNK_SIZE];
+        ZSTD_inBuffer input = {data, size, 0};
+        std::size_t remaining = 0;
+        do
+        {
+            ZSTD_outBuffer output = {buffer, sizeof(buffer), 0};
+            remaining = ZSTD_compressStream2(context, &output, &input, directive);
+            check_zstd(remaining);
+            if (output.pos > 0)
+            {
+                boost::iostreams::write(sink, buffer, output.pos);
+            }
+        } while (input.pos < input.size || (ZSTD_e_end == directive && remaining > 0));
+    }
+
+    ZSTD_CCtx *context;
+    bool with_dictionary;
+    bool header_written;
+};
+#endif
+
+#ifdef OSRM_HAS_BROTLI
+// Brotli encoders can't be reset, but those of equal quality allocate blocks of the same sizes.
+// The blocks that the encoders of a thread released are kept for the next ones.
+class brotli_block_cache
+{
+  public:
+    ~brotli_block_cache()
+    {
+        for (block_header *block : blocks)
+        {
+            std::free(block);
+        }
+    }
+
+    static void *allocate(void *opaque, const std::size_t size)
+    {
+        auto &cache = *static_cast<brotli_block_cache *>(opaque);
+        for (auto iter = cache.blocks.begin(); iter != cache.blocks.end(); ++iter)
+        {
+            if ((*iter)->size == size)
+            {
+                block_header *block = *iter;
+                *iter = cache.blocks.back();
+                cache.blocks.pop_back();
+                return block + 1;
+            }
+        }
+        auto *block = static_cast<block_header *>(std::malloc(sizeof(block_header) + size));
+        if (block == nullptr)
+        {
+            return nullptr;
+        }
+        block->size = size;
+        return block + 1;
+    }
+
+    static void release(void *opaque, void *address)
+    {
+        if (address == nullptr)
+        {
+            return;
+        }
+        auto &cache = *static_cast<brotli_block_cache *>(opaque);
+        block_header *block = static_cast<block_header *>(address) - 1;
+        if (cache.blocks.size() < MAX_CACHED_BLOCKS)
+        {
+            cache.blocks.push_back(block);
+        }
+        else
+        {
+            std::free(block);
+        }
+    }
+
+  private:
+    // keeps the blocks aligned like those of malloc
+    union block_header
+    {
+        std::size_t size;
+        std::max_align_t alignment;
+    };
+
+    static const std::size_t MAX_CACHED_BLOCKS = 64;
+    std::vector<block_header *> blocks;
+};
+
+boost::thread_specific_ptr<brotli_block_cache> brotli_blocks;
+
+class brotli_compressor : public boost::iostreams::multichar_output_filter
+{
+  public:
+    explicit brotli_compressor(const int quality)
+    {
+        if (!brotli_blocks.get())
+        {
+            brotli_blocks.reset(new brotli_block_cache());
+        }
+        // the filter is copied when it is pushed, the copies share the encoder
+        encoder.reset(BrotliEncoderCreateInstance(&brotli_block_cache::allocate,
+                                                  &brotli_block_cache::release,
+                                                  brotli_blocks.get()),
+                      BrotliEncoderDestroyInstance);
+        if (!encoder)
+        {
+            throw osrm::exception("could not create a brotli encoder");
+        }
+        BrotliEncoderSetParameter(encoder.get(), BROTLI_PARAM_QUALITY,
+                                  static_cast<std::uint32_t>(quality));
+    }
+
+    template <typename Sink>
+    std::streamsize write(Sink &sink, const char *data, const std::streamsize size)
+    {
+        Compress(sink, BROTLI_OPERATION_PROCESS, data, static_cast<std::size_t>(size));
+        return size;
+    }
+
+    template <typename Sink> void close(Sink &sink)
+    {
+        Compress(sink, BROTLI_OPERATION_FINISH, nullptr, 0);
+    }
+
+  private:
+    template <typename Sink>
+    void Compress(Sink &sink, const BrotliEncoderOperation operation, const char *data,
+                  std::size_t size)
+    {
+        const std::uint8_t *next_in = reinterpret_cast<const std::uint8_t *>(data);
+        std::uint8_t buffer[COMPRESSION_CHUNK_SIZE];
+        do
+        {
+            std::uint8_t *next_out = buffer;
+            std::size_t available_out = sizeof(buffer);
+            if (!BrotliEncoderCompressStream(encoder.get(), operation, &size, &next_in,
+                                             &available_out, &next_out, nullptr))
+            {
+                throw osrm::exception("brotli compression failed");
+            }
+            if (available_out < sizeof(buffer))
+            {
+                boost::iostreams::write(sink, reinterpret_cast<const char *>(buffer),
+                                        sizeof(buffer) - available_out);
+            }
+        } while (size > 0 || BrotliEncoderHasMoreOutput(encoder.get()) ||
+                 (BROTLI_OPERATION_FINISH == operation &&
+                  !BrotliEncoderIsFinished(encoder.get())));
+    }
+
+    std::shared_ptr<BrotliEncoderState> encoder;
+};
+#endif
+
+bool has_dictionary()
+{
+#ifdef OSRM_HAS_ZSTD
+    return static_cast<bool>(configuration.dictionary);
+#else
+    return false;
+#endif
+}
+
+// Available-Dictionary is a byte sequence of structured fields, RFC 8941: the hash in standard
+// base64 between colons
+bool matches_dictionary(const std::string &available_dictionary)
+{
+    std::string value = boost::algorithm::trim_copy(available_dictionary);
+    if (value.size() < 2 || ':' != value.front() || ':' != value.back())
+    {
+        return false;
+    }
+    value = value.substr(1, value.size() - 2);
+    while (!value.empty() && '=' == value.back())
+    {
+        value.pop_back();
+    }
+    osrm::sha256_digest hash;
+    return ObjectEncoder::DecodeFromBase64(value, hash) && hash == configuration.dictionary_hash;
+}
+}
+
+void configure_compression(compression_settings settings)
+{
+    if (settings.gzip_level < 1 || settings.gzip_level > 9)
+    {
+        throw osrm::exception("gzip level must be between 1 and 9");
+    }
+    if (settings.brotli_quality < 0 || settings.brotli_quality > 11)
+    {
+        throw osrm::exception("brotli quality must be between 0 and 11");
+    }
+    // higher levels have windows larger than those that the clients of dictionaries support
+    if (settings.zstd_level < 1 || settings.zstd_level > 19)
+    {
+        throw osrm::exception("zstd level must be between 1 and 19");
+    }
+
+#ifdef OSRM_HAS_ZSTD
+    configuration.dictionary.reset();
+#endif
+    if (!settings.dictionary.empty())
+    {
+#ifdef OSRM_HAS_ZSTD
+        const std::string &dictionary = settings.dictionary;
+        const auto byte = [&dictionary](const std::size_t i)
+        {
+            return static_cast<std::uint32_t>(static_cast<unsigned char>(dictionary[i]));
+        };
+        if (dictionary.size() >= 4 &&
+            ZSTD_MAGIC_DICTIONARY ==
+                (byte(0) | (byte(1) << 8) | (byte(2) << 16) | (byte(3) << 24)))
+        {
+            throw osrm::exception("the compression dictionary is in the format of zstd --train, "
+                                  "clients expect raw content");
+        }
+        // without the magic number zstd takes the dictionary as raw content
+        configuration.dictionary.reset(
+            ZSTD_createCDict(dictionary.data(), dictionary.size(), settings.zstd_level));
+        if (!configuration.dictionary)
+        {
+            throw osrm::exception("could not load the compression dictionary");
+        }
+        configuration.dictionary_hash = osrm::sha256(dictionary.data(), dictionary.size());
+#else
+        throw osrm::exception("compression dictionaries need zstd support, which isn't built in");
+#endif
+    }
+    configuration.settings = std::move(settings);
+}
+
+compression_type select_compression(const std::string &accept_encoding,
+                                    const std::string &available_dictionary)
+{
+    struct coding
+    {
+        const char *name;
+        compression_type type;
+        bool available;
+    };
+    // in the order of preference for equal quality values
+    const coding codings[] = {
+#ifdef OSRM_HAS_ZSTD
+        {"dcz", dictionary_zstd, has_dictionary() && matches_dictionary(available_dictionary)},
+        {"zstd", zstd_rfc8878, true},
+#endif
+#ifdef OSRM_HAS_BROTLI
+        {"br", brotli_rfc7932, true},
+#endif
+        {"gzip", gzip_rfc1952, true},
+        {"deflate", deflate_rfc1951, true}};
+    const std::size_t number_of_codings = sizeof(codings) / sizeof(codings[0]);
+
+    // quality values of the codings, negative if the client didn't list them
+    std::vector<double> qualities(number_of_codings, -1.);
+    double wildcard_quality = -1.;
+
+    std::size_t begin = 0;
+    while (begin < accept_encoding.size())
+    {
+        std::size_t end = accept_encoding.find(',', begin);
+        if (std::string::npos == end)
+        {
+            end = accept_encoding.size();
+        }
+        const std::string element =
+            boost::algorithm::to_lower_copy(accept_encoding.substr(begin, end - begin));
+        begin = end + 1;
+
+        const std::size_t parameters = element.find(';');
+        const std::string name = boost::algorithm::trim_copy(element.substr(0, parameters));
+        double quality = 1.;
+        if (std::string::npos != parameters)
+        {
+            const std::size_t quality_position = element.find("q=", parameters);
+            if (std::string::npos != quality_position)
+            {
+                quality = std::strtod(element.c_str() + quality_position + 2, nullptr);
+            }
+        }
+
+        if ("*" == name)
+        {
+            wildcard_quality = quality;
+            continue;
+        }
+        for (std::size_t i = 0; i < number_of_codings; ++i)
+        {
+            if (name == codings[i].name ||
+                (gzip_rfc1952 == codings[i].type && "x-gzip" == name))
+            {
+                qualities[i] = quality;
+            }
+        }
+    }
+
+    compression_type selected = no_compression;
+    double selected_quality = 0.;
+    for (std::size_t i = 0; i < number_of_codings; ++i)
+    {
+        const double quality = qualities[i] < 0. ? wildcard_quality : qualities[i];
+        if (codings[i].available && quality > selected_quality)
+        {
+            selected = codings[i].type;
+            selected_quality = quality;
+        }
+    }
+    return selected;
+}
+
+const char *content_encoding(const compression_type compression)
+{
+    switch (compression)
+    {
+    case gzip_rfc1952:
+        return "gzip";
+    case deflate_rfc1951:
+        return "deflate";
+    case brotli_rfc7932:
+        return "br";
+    case zstd_rfc8878:
+        return "zstd";
+    case dictionary_zstd:
+        return "dcz";
+    default:
+        return "identity";
+    }
+}
+
+const char *compression_vary()
+{
+    return has_dictionary() ? "Accept-Encoding, Available-Dictionary" : "Accept-Encoding";
+}
+
+void push_compressor(boost::iostreams::filtering_ostream &stream,
+                     const compression_type compression)
+{
+    switch (compression)
+    {
+    case gzip_rfc1952:
+    case deflate_rfc1951:
+    {
+        boost::iostreams::gzip_params compression_parameters;
+        compression_parameters.level = configuration.settings.gzip_level;
+        // deflate is a zlib stream without its header, as before
+        compression_parameters.noheader = (deflate_rfc1951 == compression);
+        stream.push(boost::iostreams::gzip_compressor(compression_parameters));
+        break;
+    }
+#ifdef OSRM_HAS_BROTLI
+    case brotli_rfc7932:
+        stream.push(brotli_compressor(configuration.settings.brotli_quality),
+                    COMPRESSION_CHUNK_SIZE);
+        break;
+#endif
+#ifdef OSRM_HAS_ZSTD
+    case zstd_rfc8878:
+    case dictionary_zstd:
+        stream.push(zstd_compressor(dictionary_zstd == compression), COMPRESSION_CHUNK_SIZE);
+        break;
+#endif
+    default:
+        throw osrm::exception("unsupported compression of the reply");
+    }
+}
+}
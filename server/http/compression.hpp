@@ -0,0 +1,75 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include "compression_type.hpp"
+
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <string>
+
+namespace http
+{
+
+struct compression_settings
+{
+    compression_settings() : gzip_level(1), brotli_quality(4), zstd_level(3) {}
+
+    // there's a trade-off between speed and size, the defaults favour speed
+    int gzip_level;
+    int brotli_quality;
+    int zstd_level;
+    // Raw content that clients may keep as a shared dictionary, see RFC 9842. Clients that
+    // announce its hash with Available-Dictionary get replies compressed with it as dcz.
+    std::string dictionary;
+};
+
+// Applies to all replies that are compressed afterwards, to be called before the server starts.
+// Throws if a level is out of range or if there is a dictionary but no zstd support.
+void configure_compression(compression_settings settings);
+
+// The encoding of the reply to a request with these headers, the one with the highest quality
+// value of those the client accepts. Ties go to the one that compresses better.
+compression_type select_compression(const std::string &accept_encoding,
+                                    const std::string &available_dictionary);
+
+// value of the Content-Encoding header of a compressed reply
+const char *content_encoding(const compression_type compression);
+
+// value of the Vary header, the encoding depends on the dictionary of the client as well
+const char *compression_vary();
+
+// Pushes the compressor of the encoding onto the stream, the caller pushes the sink. The zstd
+// contexts and the memory of the brotli encoders are reused by the replies of a thread.
+void push_compressor(boost::iostreams::filtering_ostream &stream,
+                     const compression_type compression);
+}
+
+#endif // COMPRESSION_HPP
@@ -35,7 +35,11 @@ enum compression_type
 {
     no_compression,
     gzip_rfc1952,
-    deflate_rfc1951
+    deflate_rfc1951,
+    brotli_rfc7932,
+    zstd_rfc8878,
+    // zstd with a dictionary that the client has, 'dcz' of RFC 9842
+    dictionary_zstd
 };
 }
 
@@ -34,13 +34,22 @@ namespace http
 
 const char ok_html[] = "";
 const char bad_request_html[] = "{\"status\": 400,\"status_message\":\"Bad Request\"}";
+const char request_entity_too_large_html[] =
+    "{\"status\": 413,\"status_message\":\"Request Entity Too Large\"}";
 const char internal_server_error_html[] =
     "{\"status\": 500,\"status_message\":\"Internal Server Error\"}";
+const char service_unavailable_html[] =
+    "{\"status\": 503,\"status_message\":\"Service Unavailable\"}";
+const char gateway_timeout_html[] = "{\"status\": 504,\"status_message\":\"Gateway Timeout\"}";
 const char seperators[] = {':', ' '};
 const char crlf[] = {'\r', '\n'};
 const std::string http_ok_string = "HTTP/1.0 200 OK\r\n";
 const std::string http_bad_request_string = "HTTP/1.0 400 Bad Request\r\n";
+const std::string http_request_entity_too_large_string =
+    "HTTP/1.0 413 Request Entity Too Large\r\n";
 const std::string http_internal_server_error_string = "HTTP/1.0 500 Internal Server Error\r\n";
+const std::string http_service_unavailable_string = "HTTP/1.0 503 Service Unavailable\r\n";
+const std::string http_gateway_timeout_string = "HTTP/1.0 504 Gateway Timeout\r\n";
 
 void reply::set_size(const std::size_t size)
 {
@@ -89,17 +98,22 @@ std::vector<boost::asio::const_buffer> reply::headers_to_buffers()
 reply reply::stock_reply(const reply::status_type status)
 {
     reply reply;
-    reply.status = status;
-    reply.content.clear();
-
-    const std::string status_string = reply.status_to_string(status);
-    reply.content.insert(reply.content.end(), status_string.begin(), status_string.end());
-    reply.headers.emplace_back("Access-Control-Allow-Origin", "*");
-    reply.headers.emplace_back("Content-Length", std::to_string(reply.content.size()));
-    reply.headers.emplace_back("Content-Type", "text/html");
+    reply.set_stock_reply(status);
     return reply;
 }
 
+void reply::set_stock_reply(const reply::status_type status)
+{
+    clear();
+    this->status = status;
+
+    const std::string status_string = status_to_string(status);
+    content.insert(content.end(), status_string.begin(), status_string.end());
+    headers.emplace_back("Access-Control-Allow-Origin", "*");
+    headers.emplace_back("Content-Length", std::to_string(content.size()));
+    headers.emplace_back("Content-Type", "text/html");
+}
+
 std::string reply::status_to_string(const reply::status_type status)
 {
     if (reply::ok == status)
@@ -110,6 +124,18 @@ std::string reply::status_to_string(const reply::status_type status)
     {
         return bad_request_html;
     }
+    if (reply::request_entity_too_large == status)
+    {
+        return request_entity_too_large_html;
+    }
+    if (reply::service_unavailable == status)
+    {
+        return service_unavailable_html;
+    }
+    if (reply::gateway_timeout == status)
+    {
+        return gateway_timeout_html;
+    }
     return internal_server_error_html;
 }
 
@@ -123,8 +149,27 @@ boost::asio::const_buffer reply::status_to_buffer(const reply::status_type statu
     {
         return boost::asio::buffer(http_internal_server_error_string);
     }
+    if (reply::request_entity_too_large == status)
+    {
+        return boost::asio::buffer(http_request_entity_too_large_string);
+    }
+    if (reply::service_unavailable == status)
+    {
+        return boost::asio::buffer(http_service_unavailable_string);
+    }
+    if (reply::gateway_timeout == status)
+    {
+        return boost::asio::buffer(http_gateway_timeout_string);
+    }
     return boost::asio::buffer(http_bad_request_string);
 }
 
+void reply::clear()
+{
+    status = ok;
+    headers.clear();
+    content.clear();
+}
+
 reply::reply() : status(ok) {}
 }
@@ -43,7 +43,10 @@ class reply
     {
         ok = 200,
         bad_request = 400,
-        internal_server_error = 500
+        request_entity_too_large = 413,
+        internal_server_error = 500,
+        service_unavailable = 503,
+        gateway_timeout = 504
     } status;
 
     std::vector<header> headers;
@@ -51,8 +54,12 @@ class reply
     std::vector<boost::asio::const_buffer> headers_to_buffers();
     std::vector<char> content;
     static reply stock_reply(const status_type status);
+    // turns this reply into the stock reply in place, so that its buffers are reused
+    void set_stock_reply(const status_type status);
     void set_size(const std::size_t size);
     void set_uncompressed_size();
+    // resets the reply but keeps the content buffer for reuse
+    void clear();
 
     reply();
 
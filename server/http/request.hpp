@@ -28,19 +28,55 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef REQUEST_HPP
 #define REQUEST_HPP
 
+#include "compression_type.hpp"
+
 #include <boost/asio.hpp>
 
+#include <functional>
 #include <string>
 
 namespace http
 {
 
+// coordinates can be posted as the raw body instead of the query string
+enum class body_encoding : unsigned char
+{
+    none,       // no body, or a form body that is part of the uri
+    polyline,   // application/x-polyline, an encoded polyline of the coordinates
+    coordinates // application/octet-stream, see util/coordinate_decoder.hpp
+};
+
 struct request
 {
+    request() : compression(no_compression), encoding(body_encoding::none), keep_alive(false) {}
+
+    // resets the request but keeps the allocated string buffers for reuse
+    void clear()
+    {
+        uri.clear();
+        referrer.clear();
+        agent.clear();
+        body.clear();
+        endpoint = boost::asio::ip::address();
+        compression = no_compression;
+        encoding = body_encoding::none;
+        keep_alive = false;
+    }
+
     std::string uri;
     std::string referrer;
     std::string agent;
+    // raw body of a POST request that is not form encoded
+    std::string body;
     boost::asio::ip::address endpoint;
+    // encoding the reply body is compressed with while rendering
+    compression_type compression;
+    body_encoding encoding;
+    // HTTP/1.1 default or explicitly requested by 'Connection: keep-alive'
+    bool keep_alive;
+    // tells whether the client closed the connection, callable from any thread while the
+    // request is handled
+    std::function<bool()> client_gone;
 };
 
 } // namespace http
@@ -0,0 +1,519 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifdef OSRM_HAS_NGHTTP2
+
+#include "http2_connection.hpp"
+#include "request_handler.hpp"
+
+#include "http/compression.hpp"
+#include "http/reply.hpp"
+#include "http/request.hpp"
+
+#include "../util/simple_logger.hpp"
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/bind.hpp>
+
+#include <nghttp2/nghttp2.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace http
+{
+
+struct Http2Connection::Stream
+{
+    explicit Stream(const std::int32_t id)
+        : id(id), content_offset(0), closed(false), dispatched(false), is_post(false)
+    {
+    }
+
+    const std::int32_t id;
+    request current_request;
+    reply current_reply;
+    std::string content_type;
+    std::string accept_encoding;
+    std::string available_dictionary;
+    // bytes of the content that the session took for its data frames
+    std::size_t content_offset;
+    // set on the strand once the stream is closed or reset, read by the request handler
+    std::atomic<bool> closed;
+    bool dispatched;
+    bool is_post;
+};
+
+// The callbacks of the session, they run on the strand while the session receives or sends
+struct Http2SessionCallbacks
+{
+    using Stream = Http2Connection::Stream;
+
+    static std::shared_ptr<Stream> find(Http2Connection &connection, const std::int32_t id)
+    {
+        const auto iter = connection.streams.find(id);
+        return connection.streams.end() == iter ? nullptr : iter->second;
+    }
+
+    static int on_begin_headers(nghttp2_session *, const nghttp2_frame *frame, void *user_data)
+    {
+        if (NGHTTP2_HEADERS != frame->hd.type || NGHTTP2_HCAT_REQUEST != frame->headers.cat)
+        {
+            return 0;
+        }
+        auto &connection = *static_cast<Http2Connection *>(user_data);
+        auto stream = std::make_shared<Stream>(frame->hd.stream_id);
+        stream->current_request.endpoint = connection.remote_address;
+        stream->current_request.keep_alive = true;
+        // the stream outlives its request, see Http2Connection::dispatch
+        Stream *raw_stream = stream.get();
+        stream->current_request.client_gone = [raw_stream]
+        {
+            return raw_stream->closed.load();
+        };
+        connection.streams.emplace(frame->hd.stream_id, std::move(stream));
+        connection.update_idle_timer();
+        return 0;
+    }
+
+    static int on_header(nghttp2_session *,
+                         const nghttp2_frame *frame,
+                         const std::uint8_t *name,
+                         const std::size_t name_length,
+                         const std::uint8_t *value,
+                         const std::size_t value_length,
+                         const std::uint8_t,
+                         void *user_data)
+    {
+        auto &connection = *static_cast<Http2Connection *>(user_data);
+        const auto stream = find(connection, frame->hd.stream_id);
+        if (!stream)
+        {
+            return 0;
+        }
+        // names are lower case in HTTP/2, the session rejects the others
+        const std::string header_name(reinterpret_cast<const char *>(name), name_length);
+        const char *header_value = reinterpret_cast<const char *>(value);
+        auto &current_request = stream->current_request;
+        if (":path" == header_name)
+        {
+            current_request.uri.assign(header_value, value_length);
+        }
+        else if (":method" == header_name)
+        {
+            stream->is_post = 4 == value_length && 0 == std::memcmp(header_value, "POST", 4);
+        }
+        else if ("content-type" == header_name)
+        {
+            stream->content_type.assign(header_value, value_length);
+        }
+        else if ("accept-encoding" == header_name)
+        {
+            stream->accept_encoding.assign(header_value, value_length);
+        }
+        else if ("available-dictionary" == header_name)
+        {
+            stream->available_dictionary.assign(header_value, value_length);
+        }
+        else if ("referer" == header_name)
+        {
+            current_request.referrer.assign(header_value, value_length);
+        }
+        else if ("user-agent" == header_name)
+        {
+            current_request.agent.assign(header_value, value_length);
+        }
+        return 0;
+    }
+
+    static int on_data_chunk_recv(nghttp2_session *,
+                                  const std::uint8_t,
+                                  const std::int32_t stream_id,
+                                  const std::uint8_t *data,
+                                  const std::size_t length,
+                                  void *user_data)
+    {
+        auto &connection = *static_cast<Http2Connection *>(user_data);
+        const auto stream = find(connection, stream_id);
+        if (stream)
+        {
+            stream->current_request.body.append(reinterpret_cast<const char *>(data), length);
+        }
+        return 0;
+    }
+
+    static int on_frame_recv(nghttp2_session *, const nghttp2_frame *frame, void *user_data)
+    {
+        if ((NGHTTP2_HEADERS != frame->hd.type && NGHTTP2_DATA != frame->hd.type) ||
+            0 == (frame->hd.flags & NGHTTP2_FLAG_END_STREAM))
+        {
+            return 0;
+        }
+        auto &connection = *static_cast<Http2Connection *>(user_data);
+        const auto stream = find(connection, frame->hd.stream_id);
+        if (stream && !stream->dispatched)
+        {
+            connection.dispatch(stream);
+        }
+        return 0;
+    }
+
+    static int on_stream_close(nghttp2_session *,
+                               const std::int32_t stream_id,
+                               const std::uint32_t,
+                               void *user_data)
+    {
+        auto &connection = *static_cast<Http2Connection *>(user_data);
+        const auto iter = connection.streams.find(stream_id);
+        if (connection.streams.end() != iter)
+        {
+            iter->second->closed = true;
+            connection.streams.erase(iter);
+            connection.update_idle_timer();
+        }
+        return 0;
+    }
+
+    static ssize_t read_content(nghttp2_session *,
+                                const std::int32_t,
+                                std::uint8_t *buffer,
+                                const std::size_t length,
+                                std::uint32_t *data_flags,
+                                nghttp2_data_source *source,
+                                void *)
+    {
+        auto &stream = *static_cast<Stream *>(source->ptr);
+        const auto &content = stream.current_reply.content;
+        const std::size_t size = std::min(length, content.size() - stream.content_offset);
+        if (size > 0)
+        {
+            std::memcpy(buffer, content.data() + stream.content_offset, size);
+        }
+        stream.content_offset += size;
+        if (content.size() == stream.content_offset)
+        {
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        }
+        return static_cast<ssize_t>(size);
+    }
+};
+
+Http2Connection::Http2Connection(boost::asio::io_service &io_service,
+                                 RequestHandler &handler,
+                                 const unsigned idle_timeout)
+    : io_service(io_service), strand(io_service), tcp_socket(io_service), timer(io_service),
+      request_handler(handler), idle_timeout(idle_timeout), session(nullptr), writing(false),
+      closed(false)
+{
+}
+
+Http2Connection::~Http2Connection()
+{
+    if (nullptr != session)
+    {
+        nghttp2_session_del(session);
+    }
+}
+
+boost::asio::ip::tcp::socket &Http2Connection::socket() { return tcp_socket; }
+
+void Http2Connection::start()
+{
+    boost::system::error_code error;
+    const auto endpoint = tcp_socket.remote_endpoint(error);
+    if (!error)
+    {
+        remote_address = endpoint.address();
+    }
+    // the replies are written as soon as they are submitted, there's nothing to wait for
+    tcp_socket.set_option(boost::asio::ip::tcp::no_delay(true), error);
+
+    nghttp2_session_callbacks *callbacks;
+    if (0 != nghttp2_session_callbacks_new(&callbacks))
+    {
+        close();
+        return;
+    }
+    nghttp2_session_callbacks_set_on_begin_headers_callback(
+        callbacks, Http2SessionCallbacks::on_begin_headers);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, Http2SessionCallbacks::on_header);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+        callbacks, Http2SessionCallbacks::on_data_chunk_recv);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks,
+                                                         Http2SessionCallbacks::on_frame_recv);
+    nghttp2_session_callbacks_set_on_stream_close_callback(
+        callbacks, Http2SessionCallbacks::on_stream_close);
+    const int result = nghttp2_session_server_new(&session, callbacks, this);
+    nghttp2_session_callbacks_del(callbacks);
+    if (0 != result)
+    {
+        session = nullptr;
+        close();
+        return;
+    }
+
+    const nghttp2_settings_entry settings[] = {
+        {NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, MAX_CONCURRENT_STREAMS}};
+    nghttp2_submit_settings(session, NGHTTP2_FLAG_NONE, settings,
+                            sizeof(settings) / sizeof(settings[0]));
+    send();
+    update_idle_timer();
+    async_read_more();
+}
+
+void Http2Connection::async_read_more()
+{
+    tcp_socket.async_read_some(
+        boost::asio::buffer(incoming_data_buffer),
+        strand.wrap(boost::bind(&Http2Connection::handle_read, this->shared_from_this(),
+                                boost::asio::placeholders::error,
+                                boost::asio::placeholders::bytes_transferred)));
+}
+
+void Http2Connection::handle_read(const boost::system::error_code &error,
+                                  std::size_t bytes_transferred)
+{
+    if (error || closed)
+    {
+        close();
+        return;
+    }
+    const auto result = nghttp2_session_mem_recv(
+        session, reinterpret_cast<const std::uint8_t *>(incoming_data_buffer.data()),
+        bytes_transferred);
+    if (result < 0)
+    {
+        SimpleLogger().Write(logDEBUG) << "[http/2] " << nghttp2_strerror(static_cast<int>(result));
+        close();
+        return;
+    }
+    // the session may answer with settings acknowledgements, pings or a goaway
+    send();
+    if (!closed && nghttp2_session_want_read(session))
+    {
+        async_read_more();
+    }
+}
+
+void Http2Connection::send()
+{
+    if (writing || closed)
+    {
+        return;
+    }
+    while (outgoing_data_buffer.size() < MAX_WRITE_SIZE)
+    {
+        const std::uint8_t *data = nullptr;
+        const auto length = nghttp2_session_mem_send(session, &data);
+        if (length < 0)
+        {
+            close();
+            return;
+        }
+        if (0 == length)
+        {
+            break;
+        }
+        outgoing_data_buffer.insert(outgoing_data_buffer.end(), data, data + length);
+    }
+    if (outgoing_data_buffer.empty())
+    {
+        if (!nghttp2_session_want_read(session) && !nghttp2_session_want_write(session))
+        {
+            close();
+        }
+        return;
+    }
+    writing = true;
+    boost::asio::async_write(
+        tcp_socket, boost::asio::buffer(outgoing_data_buffer),
+        strand.wrap(boost::bind(&Http2Connection::handle_write, this->shared_from_this(),
+                                boost::asio::placeholders::error)));
+}
+
+void Http2Connection::handle_write(const boost::system::error_code &error)
+{
+    writing = false;
+    outgoing_data_buffer.clear();
+    if (error)
+    {
+        close();
+        return;
+    }
+    send();
+}
+
+void Http2Connection::update_idle_timer()
+{
+    if (closed || 0 == idle_timeout || !streams.empty())
+    {
+        timer.expires_at(boost::posix_time::pos_infin);
+        return;
+    }
+    timer.expires_from_now(boost::posix_time::seconds(idle_timeout));
+    timer.async_wait(strand.wrap(boost::bind(&Http2Connection::handle_timeout,
+                                             this->shared_from_this(),
+                                             boost::asio::placeholders::error)));
+}
+
+void Http2Connection::handle_timeout(const boost::system::error_code &error)
+{
+    // the timer might have been re-armed or disarmed while this handler was queued
+    if (error == boost::asio::error::operation_aborted || closed ||
+        timer.expires_at() > boost::asio::deadline_timer::traits_type::now())
+    {
+        return;
+    }
+    // sends a goaway, the connection is closed once it is written
+    nghttp2_session_terminate_session(session, NGHTTP2_NO_ERROR);
+    send();
+}
+
+void Http2Connection::dispatch(const std::shared_ptr<Stream> &stream)
+{
+    stream->dispatched = true;
+    auto &current_request = stream->current_request;
+    current_request.compression =
+        select_compression(stream->accept_encoding, stream->available_dictionary);
+    if (stream->is_post)
+    {
+        // the same bodies as those of HTTP/1, see RequestParser
+        if (boost::icontains(stream->content_type, "application/x-polyline"))
+        {
+            current_request.encoding = body_encoding::polyline;
+        }
+        else if (boost::icontains(stream->content_type, "application/octet-stream"))
+        {
+            current_request.encoding = body_encoding::coordinates;
+        }
+        else if (stream->content_type.empty() ||
+                 boost::icontains(stream->content_type, "application/x-www-form-urlencoded"))
+        {
+            if (!current_request.body.empty())
+            {
+                current_request.uri.push_back('?');
+                current_request.uri.append(current_request.body);
+                current_request.body.clear();
+            }
+        }
+        else
+        {
+            stream->current_reply.set_stock_reply(reply::bad_request);
+            submit_reply(stream);
+            return;
+        }
+    }
+
+    // runs on any thread of the io_service, the stream is kept until the reply is submitted
+    auto self = this->shared_from_this();
+    io_service.post([self, stream]
+                    {
+                        self->request_handler.handle_request(stream->current_request,
+                                                             stream->current_reply);
+                        // the request handler already compressed the content if requested
+                        stream->current_reply.set_uncompressed_size();
+                        self->strand.post([self, stream]
+                                          {
+                                              self->submit_reply(stream);
+                                          });
+                    });
+}
+
+void Http2Connection::submit_reply(const std::shared_ptr<Stream> &stream)
+{
+    // the client may have reset the stream while its request was handled
+    if (closed || stream->closed)
+    {
+        return;
+    }
+
+    const auto &current_reply = stream->current_reply;
+    const std::string status = std::to_string(static_cast<int>(current_reply.status));
+    std::vector<std::string> names;
+    names.reserve(current_reply.headers.size());
+    std::vector<nghttp2_nv> header_block;
+    header_block.reserve(current_reply.headers.size() + 1);
+    const auto add_header = [&header_block](const std::string &name, const std::string &value)
+    {
+        header_block.push_back({reinterpret_cast<std::uint8_t *>(const_cast<char *>(name.data())),
+                                reinterpret_cast<std::uint8_t *>(const_cast<char *>(value.data())),
+                                name.size(), value.size(), NGHTTP2_NV_FLAG_NONE});
+    };
+    static const std::string status_name = ":status";
+    add_header(status_name, status);
+    for (const auto &current_header : current_reply.headers)
+    {
+        names.push_back(boost::algorithm::to_lower_copy(current_header.name));
+        // HTTP/2 has no connection-specific headers
+        if ("connection" == names.back() || "keep-alive" == names.back() ||
+            "transfer-encoding" == names.back())
+        {
+            continue;
+        }
+        add_header(names.back(), current_header.value);
+    }
+
+    nghttp2_data_provider content_provider;
+    content_provider.source.ptr = stream.get();
+    content_provider.read_callback = Http2SessionCallbacks::read_content;
+    // the session copies the header block, the content is read from the stream
+    if (0 != nghttp2_submit_response(session, stream->id, header_block.data(),
+                                     header_block.size(),
+                                     current_reply.content.empty() ? nullptr
+                                                                   : &content_provider))
+    {
+        nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, stream->id, NGHTTP2_INTERNAL_ERROR);
+    }
+    send();
+}
+
+void Http2Connection::close()
+{
+    if (closed)
+    {
+        return;
+    }
+    closed = true;
+    for (auto &stream : streams)
+    {
+        stream.second->closed = true;
+    }
+    streams.clear();
+    timer.expires_at(boost::posix_time::pos_infin);
+    boost::system::error_code ignore_error;
+    tcp_socket.shutdown(boost::asio::socket_base::shutdown_both, ignore_error);
+    tcp_socket.close(ignore_error);
+}
+
+} // namespace http
+
+#endif // OSRM_HAS_NGHTTP2
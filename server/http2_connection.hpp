@@ -0,0 +1,112 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef HTTP2_CONNECTION_HPP
+#define HTTP2_CONNECTION_HPP
+
+#include <boost/array.hpp>
+#include <boost/asio.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+struct nghttp2_session;
+class RequestHandler;
+
+namespace http
+{
+
+struct Http2SessionCallbacks;
+
+/// An HTTP/2 connection over TCP whose client starts right away with the connection preface,
+/// i.e. h2c with prior knowledge. Each stream carries one request, which goes to the request
+/// handler on any thread of the io_service. The requests of a connection thus run concurrently
+/// and a slow one does not hold up the others, unless the io_service has a single thread.
+/// nghttp2 does the framing, flow control and HPACK, its session is only used on the strand.
+class Http2Connection : public std::enable_shared_from_this<Http2Connection>
+{
+  public:
+    explicit Http2Connection(boost::asio::io_service &io_service,
+                             RequestHandler &handler,
+                             const unsigned idle_timeout);
+    Http2Connection(const Http2Connection &) = delete;
+    Http2Connection() = delete;
+    ~Http2Connection();
+
+    boost::asio::ip::tcp::socket &socket();
+
+    /// Sends the settings and starts reading the frames of the client.
+    void start();
+
+  private:
+    friend struct Http2SessionCallbacks;
+    struct Stream;
+
+    void async_read_more();
+    void handle_read(const boost::system::error_code &error, std::size_t bytes_transferred);
+
+    /// Writes what the session has to send, unless a write is still in flight.
+    void send();
+    void handle_write(const boost::system::error_code &error);
+
+    /// Arms the idle timer if no stream is open and disarms it otherwise.
+    void update_idle_timer();
+    void handle_timeout(const boost::system::error_code &error);
+
+    /// Hands a stream whose request is complete to the request handler.
+    void dispatch(const std::shared_ptr<Stream> &stream);
+    void submit_reply(const std::shared_ptr<Stream> &stream);
+
+    void close();
+
+    // streams a client may open at once, each of them can keep a thread busy
+    static constexpr std::uint32_t MAX_CONCURRENT_STREAMS = 100;
+    // frames are collected up to this size before they are written
+    static constexpr std::size_t MAX_WRITE_SIZE = 64 * 1024;
+
+    boost::asio::io_service &io_service;
+    boost::asio::io_service::strand strand;
+    boost::asio::ip::tcp::socket tcp_socket;
+    boost::asio::ip::address remote_address;
+    boost::asio::deadline_timer timer;
+    RequestHandler &request_handler;
+    const unsigned idle_timeout;
+    nghttp2_session *session;
+    boost::array<char, 8192> incoming_data_buffer;
+    std::vector<std::uint8_t> outgoing_data_buffer;
+    bool writing;
+    bool closed;
+    // the open streams by their ids
+    std::map<std::int32_t, std::shared_ptr<Stream>> streams;
+};
+
+} // namespace http
+
+#endif // HTTP2_CONNECTION_HPP
@@ -27,12 +27,21 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "request_handler.hpp"
 
+#include "access_log.hpp"
+#include "admission_control.hpp"
 #include "api_grammar.hpp"
+#include "response_cache.hpp"
+#include "http/compression.hpp"
 #include "http/reply.hpp"
 #include "http/request.hpp"
 
+#include "../algorithms/polyline_compressor.hpp"
 #include "../library/osrm.hpp"
+#include "../util/coordinate_decoder.hpp"
 #include "../util/json_renderer.hpp"
+#include "../util/msgpack_renderer.hpp"
+#include "../util/query_cancellation.hpp"
+#include "../util/request_metrics.hpp"
 #include "../util/simple_logger.hpp"
 #include "../util/string_util.hpp"
 #include "../util/xml_renderer.hpp"
@@ -41,13 +50,97 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <osrm/route_parameters.hpp>
 #include <osrm/json_container.hpp>
 
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <chrono>
 #include <ctime>
 
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <vector>
 
-RequestHandler::RequestHandler() : routing_machine(nullptr) {}
+namespace
+{
+// decoded query string, kept per thread so its buffer is reused across requests
+boost::thread_specific_ptr<std::string> decode_buffer;
+
+std::string &DecodeBuffer()
+{
+    if (!decode_buffer.get())
+    {
+        decode_buffer.reset(new std::string());
+        decode_buffer->reserve(1024);
+    }
+    return *decode_buffer;
+}
+
+// Takes the coordinates of a request from its body. The query string must not have any, as
+// their hints and timestamps could not be told apart from those of the body.
+bool DecodeBody(const http::request &current_request, RouteParameters &route_parameters)
+{
+    switch (current_request.encoding)
+    {
+    case http::body_encoding::polyline:
+    {
+        if (!route_parameters.coordinates.empty())
+        {
+            return false;
+        }
+        PolylineCompressor polyline_compressor;
+        route_parameters.coordinates = polyline_compressor.decode_string(current_request.body);
+        return true;
+    }
+    case http::body_encoding::coordinates:
+        if (!route_parameters.coordinates.empty())
+        {
+            return false;
+        }
+        return osrm::coordinate_decode(current_request.body, route_parameters.coordinates,
+                                       route_parameters.timestamps, route_parameters.hints);
+    default:
+        return true;
+    }
+}
+
+// dd-mm-yyyy hh:mm:ss <ip> <referrer> <agent> <request>
+void LogRequest(const http::request &current_request, const std::string &request_string)
+{
+    const std::time_t now = std::time(nullptr);
+    std::tm time_stamp;
+#ifdef _WIN32
+    localtime_s(&time_stamp, &now);
+#else
+    localtime_r(&now, &time_stamp);
+#endif
+    char time_string[32];
+    const auto time_length =
+        std::strftime(time_string, sizeof(time_string), "%d-%m-%Y %H:%M:%S", &time_stamp);
+
+    std::string line;
+    line.reserve(64 + current_request.referrer.size() + current_request.agent.size() +
+                 request_string.size());
+    line.append("[info] ");
+    line.append(time_string, time_length);
+    line.push_back(' ');
+    line.append(current_request.endpoint.to_string());
+    line.push_back(' ');
+    line.append(current_request.referrer.empty() ? "-" : current_request.referrer);
+    line.push_back(' ');
+    line.append(current_request.agent.empty() ? "-" : current_request.agent);
+    line.push_back(' ');
+    line.append(request_string);
+    AccessLog::GetInstance().Write(line);
+}
+}
+
+RequestHandler::RequestHandler()
+    : routing_machine(nullptr), admission_control(nullptr), response_cache(nullptr),
+      request_timeout(0)
+{
+}
 
 void RequestHandler::handle_request(const http::request &current_request,
                                     http::reply &current_reply)
@@ -55,36 +148,27 @@ void RequestHandler::handle_request(const http::request &current_request,
     // parse command
     try
     {
-        std::string request_string;
+        osrm::metrics::Registry::get().CurrentTimings().Reset();
+        osrm::metrics::PhaseTimer total_timer(osrm::metrics::Phase::total);
+
+        // the searches give up once the deadline passed or the client went away, the time in
+        // the queue of the admission control counts as well
+        osrm::CancellationToken cancellation_token;
+        if (request_timeout > 0)
+        {
+            cancellation_token.SetTimeout(std::chrono::milliseconds(request_timeout));
+        }
+        cancellation_token.SetAbandonedCheck(current_request.client_gone);
+        const osrm::cancellation::Scope cancellation_scope(&cancellation_token);
+
+        osrm::metrics::PhaseTimer parse_timer(osrm::metrics::Phase::parse);
+        std::string &request_string = DecodeBuffer();
         URIDecode(current_request.uri, request_string);
 
-        // deactivated as GCC apparently does not implement that, not even in 4.9
-        // std::time_t t = std::time(nullptr);
-        // SimpleLogger().Write() << std::put_time(std::localtime(&t), "%m-%d-%Y %H:%M:%S") <<
-        //     " " << current_request.endpoint.to_string() << " " <<
-        //     current_request.referrer << ( 0 == current_request.referrer.length() ? "- " :" ") <<
-        //     current_request.agent << ( 0 == current_request.agent.length() ? "- " :" ") <<
-        //     request;
-
-        time_t ltime;
-        struct tm *time_stamp;
-
-        ltime = time(nullptr);
-        time_stamp = localtime(&ltime);
-
-        // log timestamp
-        SimpleLogger().Write() << (time_stamp->tm_mday < 10 ? "0" : "") << time_stamp->tm_mday
-                               << "-" << (time_stamp->tm_mon + 1 < 10 ? "0" : "")
-                               << (time_stamp->tm_mon + 1) << "-" << 1900 + time_stamp->tm_year
-                               << " " << (time_stamp->tm_hour < 10 ? "0" : "")
-                               << time_stamp->tm_hour << ":" << (time_stamp->tm_min < 10 ? "0" : "")
-                               << time_stamp->tm_min << ":" << (time_stamp->tm_sec < 10 ? "0" : "")
-                               << time_stamp->tm_sec << " " << current_request.endpoint.to_string()
-                               << " " << current_request.referrer
-                               << (0 == current_request.referrer.length() ? "- " : " ")
-                               << current_request.agent
-                               << (0 == current_request.agent.length() ? "- " : " ")
-                               << request_string;
+        if (AccessLog::GetInstance().Sample())
+        {
+            LogRequest(current_request, request_string);
+        }
 
         RouteParameters route_parameters;
         APIGrammarParser api_parser(&route_parameters);
@@ -92,12 +176,15 @@ void RequestHandler::handle_request(const http::request &current_request,
         auto api_iterator = request_string.begin();
         const bool result =
             boost::spirit::qi::parse(api_iterator, request_string.end(), api_parser);
+        // posted coordinates go straight into the parameters, without a detour over a string
+        const bool body_result = DecodeBody(current_request, route_parameters);
+        parse_timer.Stop();
 
         osrm::json::Object json_result;
         // check if the was an error with the request
         if (!result || (api_iterator != request_string.end()))
         {
-            current_reply = http::reply::stock_reply(http::reply::bad_request);
+            current_reply.set_stock_reply(http::reply::bad_request);
             current_reply.content.clear();
             const auto position = std::distance(request_string.begin(), api_iterator);
 
@@ -108,19 +195,87 @@ void RequestHandler::handle_request(const http::request &current_request,
             osrm::json::render(current_reply.content, json_result);
             return;
         }
+        if (!body_result)
+        {
+            current_reply.set_stock_reply(http::reply::bad_request);
+            current_reply.content.clear();
+            json_result.values["status"] = 400;
+            std::string message = "Request body malformed";
+            json_result.values["status_message"] = message;
+            osrm::json::render(current_reply.content, json_result);
+            return;
+        }
 
         // parsing done, lets call the right plugin to handle the request
         BOOST_ASSERT_MSG(routing_machine != nullptr, "pointer not init'ed");
 
-        if (!route_parameters.jsonp_parameter.empty())
-        { // prepend response with jsonp parameter
-            const std::string json_p = (route_parameters.jsonp_parameter + "(");
-            current_reply.content.insert(current_reply.content.end(), json_p.begin(), json_p.end());
+        // identical queries against the same dataset share a single computation
+        ResponseCache::Lease cache_lease;
+        if (nullptr != response_cache && "metrics" != route_parameters.service)
+        {
+            const auto data_version = routing_machine->GetDataVersion();
+            std::string cache_key = std::to_string(data_version);
+            cache_key.push_back(' ');
+            cache_key.push_back(static_cast<char>('0' + current_request.compression));
+            cache_key.append(request_string);
+            if (http::body_encoding::none != current_request.encoding)
+            {
+                cache_key.push_back(static_cast<char>(current_request.encoding));
+                cache_key.append(current_request.body);
+            }
+            const auto cached_entry = response_cache->Fetch(cache_key, data_version, cache_lease);
+            if (cached_entry)
+            {
+                current_reply.headers = cached_entry->headers;
+                current_reply.content = cached_entry->content;
+                total_timer.Stop();
+                osrm::metrics::Registry::get().Commit(route_parameters.service);
+                return;
+            }
+        }
+
+        // wait for a free worker slot of the service, fail fast if its queue is full
+        static const AdmissionControl unlimited;
+        osrm::metrics::PhaseTimer queue_timer(osrm::metrics::Phase::queue_wait);
+        auto ticket = (admission_control ? *admission_control : unlimited)
+                          .Acquire(route_parameters.service);
+        queue_timer.Stop();
+        if (!ticket.Admitted())
+        {
+            current_reply.set_stock_reply(http::reply::service_unavailable);
+            current_reply.headers.emplace_back("Retry-After", "1");
+            osrm::metrics::Registry::get().Commit(route_parameters.service);
+            return;
+        }
+        // doomed work is dropped before it starts
+        const auto return_code = cancellation_token.IsCancelled()
+                                     ? 504
+                                     : routing_machine->RunQuery(route_parameters, json_result);
+        ticket.Release();
+        if (504 == return_code)
+        {
+            current_reply.set_stock_reply(http::reply::gateway_timeout);
+            osrm::metrics::Registry::get().Commit(route_parameters.service);
+            return;
+        }
+        // over its own memory budget the request would fail again, over the shared one it may
+        // succeed once other requests are done
+        if (413 == return_code)
+        {
+            current_reply.set_stock_reply(http::reply::request_entity_too_large);
+            osrm::metrics::Registry::get().Commit(route_parameters.service);
+            return;
+        }
+        if (503 == return_code)
+        {
+            current_reply.set_stock_reply(http::reply::service_unavailable);
+            current_reply.headers.emplace_back("Retry-After", "1");
+            osrm::metrics::Registry::get().Commit(route_parameters.service);
+            return;
         }
-        const auto return_code = routing_machine->RunQuery(route_parameters, json_result);
         if (200 != return_code)
         {
-            current_reply = http::reply::stock_reply(http::reply::bad_request);
+            current_reply.set_stock_reply(http::reply::bad_request);
             current_reply.content.clear();
             json_result.values["status"] = 400;
             std::string message = "Bad Request";
@@ -133,40 +288,135 @@ void RequestHandler::handle_request(const http::request &current_request,
         current_reply.headers.emplace_back("Access-Control-Allow-Methods", "GET");
         current_reply.headers.emplace_back("Access-Control-Allow-Headers",
                                            "X-Requested-With, Content-Type");
+        // caches have to keep the encodings apart
+        current_reply.headers.emplace_back("Vary", http::compression_vary());
 
         // set headers
         current_reply.headers.emplace_back("Content-Length",
                                            std::to_string(current_reply.content.size()));
-        if ("gpx" == route_parameters.output_format)
+
+        osrm::metrics::PhaseTimer render_timer(osrm::metrics::Phase::render);
+        // a requested compression is applied while rendering, so the uncompressed document
+        // is never held in memory in addition to the compressed one
+        const bool compress = http::no_compression != current_request.compression;
+        boost::iostreams::filtering_ostream compressed_stream;
+        if (compress)
+        {
+            current_reply.headers.emplace_back("Content-Encoding",
+                                               http::content_encoding(current_request.compression));
+            http::push_compressor(compressed_stream, current_request.compression);
+            compressed_stream.push(boost::iostreams::back_inserter(current_reply.content));
+        }
+        const auto append_text = [&](const std::string &text)
+        {
+            if (compress)
+            {
+                compressed_stream << text;
+            }
+            else
+            {
+                current_reply.content.insert(current_reply.content.end(), text.begin(),
+                                             text.end());
+            }
+        };
+        const auto append_json = [&](const osrm::json::Object &object)
+        {
+            if (compress)
+            {
+                osrm::json::render(compressed_stream, object);
+            }
+            else
+            {
+                osrm::json::render(current_reply.content, object);
+            }
+        };
+
+        if ("gpx" == route_parameters.output_format &&
+            json_result.values["route"].is<osrm::json::String>())
+        { // gpx file, already rendered by the descriptor
+            append_text(json_result.values["route"].get<osrm::json::String>().value);
+            current_reply.headers.emplace_back("Content-Type",
+                                               "application/gpx+xml; charset=UTF-8");
+            current_reply.headers.emplace_back("Content-Disposition",
+                                               "attachment; filename=\"route.gpx\"");
+        }
+        else if ("gpx" == route_parameters.output_format)
         { // gpx file
-            osrm::json::gpx_render(current_reply.content, json_result.values["route"]);
+            if (compress)
+            {
+                std::vector<char> gpx_output;
+                osrm::json::gpx_render(gpx_output, json_result.values["route"]);
+                compressed_stream.write(gpx_output.data(), gpx_output.size());
+            }
+            else
+            {
+                osrm::json::gpx_render(current_reply.content, json_result.values["route"]);
+            }
             current_reply.headers.emplace_back("Content-Type",
                                                "application/gpx+xml; charset=UTF-8");
             current_reply.headers.emplace_back("Content-Disposition",
                                                "attachment; filename=\"route.gpx\"");
         }
+        else if ("binary" == route_parameters.output_format)
+        { // MessagePack encoded document
+            if (compress)
+            {
+                std::vector<char> binary_output;
+                osrm::json::msgpack_render(binary_output, json_result);
+                compressed_stream.write(binary_output.data(), binary_output.size());
+            }
+            else
+            {
+                osrm::json::msgpack_render(current_reply.content, json_result);
+            }
+            current_reply.headers.emplace_back("Content-Type", "application/x-msgpack");
+            current_reply.headers.emplace_back("Content-Disposition",
+                                               "inline; filename=\"response.msgpack\"");
+        }
+        else if ("matrix" == route_parameters.output_format &&
+                 json_result.values.count("matrix") > 0 &&
+                 json_result.values["matrix"].is<osrm::json::String>())
+        { // distance table as raw little-endian int32s
+            append_text(json_result.values["matrix"].get<osrm::json::String>().value);
+            current_reply.headers.emplace_back("Content-Type", "application/octet-stream");
+            current_reply.headers.emplace_back("Content-Disposition",
+                                               "inline; filename=\"table.bin\"");
+        }
         else if (route_parameters.jsonp_parameter.empty())
         { // json file
-            osrm::json::render(current_reply.content, json_result);
+            append_json(json_result);
             current_reply.headers.emplace_back("Content-Type", "application/json; charset=UTF-8");
             current_reply.headers.emplace_back("Content-Disposition",
                                                "inline; filename=\"response.json\"");
         }
         else
         { // jsonp
-            osrm::json::render(current_reply.content, json_result);
+            append_text(route_parameters.jsonp_parameter + "(");
+            append_json(json_result);
+            append_text(")");
             current_reply.headers.emplace_back("Content-Type", "text/javascript; charset=UTF-8");
             current_reply.headers.emplace_back("Content-Disposition",
                                                "inline; filename=\"response.js\"");
         }
-        if (!route_parameters.jsonp_parameter.empty())
-        { // append brace to jsonp response
-            current_reply.content.push_back(')');
+        if (compress)
+        {
+            // flushes the compressor into the reply
+            boost::iostreams::close(compressed_stream);
+        }
+        render_timer.Stop();
+        if (cache_lease.Leader())
+        {
+            auto cache_entry = std::make_shared<ResponseCache::Entry>();
+            cache_entry->headers = current_reply.headers;
+            cache_entry->content = current_reply.content;
+            cache_lease.Publish(std::move(cache_entry));
         }
+        total_timer.Stop();
+        osrm::metrics::Registry::get().Commit(route_parameters.service);
     }
     catch (const std::exception &e)
     {
-        current_reply = http::reply::stock_reply(http::reply::internal_server_error);
+        current_reply.set_stock_reply(http::reply::internal_server_error);
         SimpleLogger().Write(logWARNING) << "[server error] code: " << e.what()
                                          << ", uri: " << current_request.uri;
         return;
@@ -174,3 +424,18 @@ void RequestHandler::handle_request(const http::request &current_request,
 }
 
 void RequestHandler::RegisterRoutingMachine(OSRM *osrm) { routing_machine = osrm; }
+
+void RequestHandler::RegisterAdmissionControl(const AdmissionControl *admission_control_)
+{
+    admission_control = admission_control_;
+}
+
+void RequestHandler::RegisterResponseCache(ResponseCache *response_cache_)
+{
+    response_cache = response_cache_;
+}
+
+void RequestHandler::SetRequestTimeout(const unsigned milliseconds)
+{
+    request_timeout = milliseconds;
+}
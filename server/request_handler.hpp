@@ -31,6 +31,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 
 template <typename Iterator, class HandlerT> struct APIGrammar;
+class AdmissionControl;
+class ResponseCache;
 struct RouteParameters;
 class OSRM;
 
@@ -51,9 +53,16 @@ class RequestHandler
 
     void handle_request(const http::request &current_request, http::reply &current_reply);
     void RegisterRoutingMachine(OSRM *osrm);
+    void RegisterAdmissionControl(const AdmissionControl *admission_control);
+    void RegisterResponseCache(ResponseCache *response_cache);
+    // the deadline of every request, counted from its arrival, 0 for none
+    void SetRequestTimeout(const unsigned milliseconds);
 
   private:
     OSRM *routing_machine;
+    const AdmissionControl *admission_control;
+    ResponseCache *response_cache;
+    unsigned request_timeout;
 };
 
 #endif // REQUEST_HANDLER_HPP
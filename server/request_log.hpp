@@ -0,0 +1,90 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef REQUEST_LOG_HPP
+#define REQUEST_LOG_HPP
+
+#include "api_grammar.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/string_util.hpp"
+
+#include <osrm/route_parameters.hpp>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <string>
+#include <vector>
+
+namespace osrm
+{
+
+// Takes either a bare request like /viaroute?loc=..&loc=.. or a line of the access log of
+// osrm-routed that ends with the request. The service of the request is set as well.
+inline bool ParseRequestLine(const std::string &line, RouteParameters &request)
+{
+    const auto start = (!line.empty() && '/' == line[0]) ? 0 : line.rfind(" /");
+    if (std::string::npos == start)
+    {
+        return false;
+    }
+    std::string request_string;
+    URIDecode(line.substr(0 == start ? 0 : start + 1), request_string);
+
+    APIGrammar<std::string::iterator, RouteParameters> api_parser(&request);
+    auto api_iterator = request_string.begin();
+    const bool result = boost::spirit::qi::parse(api_iterator, request_string.end(), api_parser);
+    return result && api_iterator == request_string.end();
+}
+
+// the requests of a file with one request per line, malformed lines are skipped
+inline std::vector<RouteParameters> LoadRequestLog(const boost::filesystem::path &log_path)
+{
+    boost::filesystem::ifstream log_stream(log_path);
+    std::vector<RouteParameters> requests;
+    std::string line;
+    unsigned skipped = 0;
+    while (std::getline(log_stream, line))
+    {
+        requests.emplace_back();
+        if (!ParseRequestLine(line, requests.back()))
+        {
+            requests.pop_back();
+            ++skipped;
+        }
+    }
+    if (skipped > 0)
+    {
+        SimpleLogger().Write(logWARNING) << "skipped " << skipped << " malformed requests of "
+                                         << log_path.string();
+    }
+    return requests;
+}
+}
+
+#endif // REQUEST_LOG_HPP
@@ -27,6 +27,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "request_parser.hpp"
 
+#include "http/compression.hpp"
 #include "http/compression_type.hpp"
 #include "http/header.hpp"
 #include "http/request.hpp"
@@ -35,6 +36,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <algorithm>
+#include <cstddef>
 #include <string>
 
 namespace http
@@ -43,19 +46,50 @@ namespace http
 RequestParser::RequestParser()
     : state(internal_state::method_start), current_header({"", ""}),
       selected_compression(no_compression), is_post_header(false),
-      content_length(0)
+      content_length(0), http_version_major(0), http_version_minor(0)
 {
+    current_header.name.reserve(32);
+    current_header.value.reserve(256);
 }
 
-std::tuple<osrm::tribool, compression_type>
+void RequestParser::reset()
+{
+    state = internal_state::method_start;
+    current_header.clear();
+    selected_compression = no_compression;
+    accept_encoding.clear();
+    available_dictionary.clear();
+    is_post_header = false;
+    content_length = 0;
+    http_version_major = 0;
+    http_version_minor = 0;
+}
+
+std::tuple<osrm::tribool, compression_type, char *>
 RequestParser::parse(request &current_request, char *begin, char *end)
 {
     while (begin != end)
     {
+        if (internal_state::post_request == state)
+        {
+            // the body is taken over in bulk, it can hold thousands of coordinates
+            const auto length =
+                static_cast<int>(std::min<std::ptrdiff_t>(end - begin, content_length));
+            auto &target = body_encoding::none == current_request.encoding ? current_request.uri
+                                                                            : current_request.body;
+            target.append(begin, length);
+            begin += length;
+            content_length -= length;
+            if (content_length <= 0)
+            {
+                return std::make_tuple(osrm::tribool::yes, selected_compression, begin);
+            }
+            continue;
+        }
         osrm::tribool result = consume(current_request, *begin++);
         if (result != osrm::tribool::indeterminate)
         {
-            return std::make_tuple(result, selected_compression);
+            return std::make_tuple(result, selected_compression, begin);
         }
     }
     osrm::tribool result = osrm::tribool::indeterminate;
@@ -64,7 +98,7 @@ RequestParser::parse(request &current_request, char *begin, char *end)
     {
         result = osrm::tribool::yes;
     }
-    return std::make_tuple(result, selected_compression);
+    return std::make_tuple(result, selected_compression, begin);
 }
 
 osrm::tribool RequestParser::consume(request &current_request, const char input)
@@ -108,6 +142,11 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
     case internal_state::post_request:
         current_request.uri.push_back(input);
         --content_length;
+        // stop at the end of the body, anything beyond belongs to the next request
+        if (content_length <= 0)
+        {
+            return osrm::tribool::yes;
+        }
         return osrm::tribool::indeterminate;
     case internal_state::method:
         if (input == ' ')
@@ -178,6 +217,7 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
     case internal_state::http_version_major_start:
         if (is_digit(input))
         {
+            http_version_major = input - '0';
             state = internal_state::http_version_major;
             return osrm::tribool::indeterminate;
         }
@@ -190,12 +230,14 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
         }
         if (is_digit(input))
         {
+            http_version_major = http_version_major * 10 + (input - '0');
             return osrm::tribool::indeterminate;
         }
         return osrm::tribool::no;
     case internal_state::http_version_minor_start:
         if (is_digit(input))
         {
+            http_version_minor = input - '0';
             state = internal_state::http_version_minor;
             return osrm::tribool::indeterminate;
         }
@@ -203,11 +245,15 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
     case internal_state::http_version_minor:
         if (input == '\r')
         {
+            // persistent connections are the default since HTTP/1.1
+            current_request.keep_alive =
+                http_version_major > 1 || (http_version_major == 1 && http_version_minor >= 1);
             state = internal_state::expecting_newline_1;
             return osrm::tribool::indeterminate;
         }
         if (is_digit(input))
         {
+            http_version_minor = http_version_minor * 10 + (input - '0');
             return osrm::tribool::indeterminate;
         }
         return osrm::tribool::no;
@@ -219,17 +265,14 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
         }
         return osrm::tribool::no;
     case internal_state::header_line_start:
+        // the encoding is selected once all headers are known
         if (boost::iequals(current_header.name, "Accept-Encoding"))
         {
-            /* giving gzip precedence over deflate */
-            if (boost::icontains(current_header.value, "deflate"))
-            {
-                selected_compression = deflate_rfc1951;
-            }
-            if (boost::icontains(current_header.value, "gzip"))
-            {
-                selected_compression = gzip_rfc1952;
-            }
+            accept_encoding = current_header.value;
+        }
+        if (boost::iequals(current_header.name, "Available-Dictionary"))
+        {
+            available_dictionary = current_header.value;
         }
 
         if (boost::iequals(current_header.name, "Referer"))
@@ -241,6 +284,17 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
         {
             current_request.agent = current_header.value;
         }
+        if (boost::iequals(current_header.name, "Connection"))
+        {
+            if (boost::icontains(current_header.value, "close"))
+            {
+                current_request.keep_alive = false;
+            }
+            else if (boost::icontains(current_header.value, "keep-alive"))
+            {
+                current_request.keep_alive = true;
+            }
+        }
         if (boost::iequals(current_header.name, "Content-Length"))
         {
             try 
@@ -254,7 +308,16 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
         }
         if (boost::iequals(current_header.name, "Content-Type"))
         {
-            if (!boost::icontains(current_header.value, "application/x-www-form-urlencoded"))
+            if (boost::icontains(current_header.value, "application/x-polyline"))
+            {
+                current_request.encoding = body_encoding::polyline;
+            }
+            else if (boost::icontains(current_header.value, "application/octet-stream"))
+            {
+                current_request.encoding = body_encoding::coordinates;
+            }
+            else if (!boost::icontains(current_header.value,
+                                       "application/x-www-form-urlencoded"))
             {
                 return osrm::tribool::no;
             }
@@ -330,12 +393,17 @@ osrm::tribool RequestParser::consume(request &current_request, const char input)
     case internal_state::expecting_newline_3:
         if (input == '\n')
         {
+            selected_compression = select_compression(accept_encoding, available_dictionary);
             if (is_post_header)
             {
-		if (content_length > 0)
-		{
-		    current_request.uri.push_back('?');
-		}
+                if (content_length <= 0)
+                {
+                    return osrm::tribool::yes;
+                }
+                if (body_encoding::none == current_request.encoding)
+                {
+                    current_request.uri.push_back('?');
+                }
                 state = internal_state::post_request;
                 return osrm::tribool::indeterminate;
             }
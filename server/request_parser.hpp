@@ -44,7 +44,13 @@ class RequestParser
   public:
     RequestParser();
 
-    std::tuple<osrm::tribool, compression_type>
+    // Prepares the parser for the next request on a persistent connection. Buffers keep their
+    // capacity, so parsing a follow-up request does not allocate.
+    void reset();
+
+    // Consumes input until a request is complete or invalid. The returned pointer marks the
+    // first byte that was not consumed, i.e. the start of a pipelined follow-up request.
+    std::tuple<osrm::tribool, compression_type, char *>
     parse(request &current_request, char *begin, char *end);
 
   private:
@@ -89,8 +95,12 @@ class RequestParser
 
     header current_header;
     compression_type selected_compression;
+    std::string accept_encoding;
+    std::string available_dictionary;
     bool is_post_header;
     int content_length;
+    unsigned http_version_major;
+    unsigned http_version_minor;
 };
 
 } // namespace http
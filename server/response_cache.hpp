@@ -0,0 +1,214 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef RESPONSE_CACHE_HPP
+#define RESPONSE_CACHE_HPP
+
+#include "http/header.hpp"
+
+#include "../data_structures/lru_cache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Caches rendered replies of identical queries. The cache is split into independently locked
+// shards, each holding a bounded LRU list of entries. Concurrent requests for an uncached key
+// are coalesced: the first one computes the reply while the others wait for its result.
+class ResponseCache
+{
+  public:
+    struct Entry
+    {
+        std::vector<http::header> headers;
+        std::vector<char> content;
+    };
+    using EntryPointer = std::shared_ptr<const Entry>;
+
+  private:
+    struct Flight
+    {
+        Flight() : landed(false) {}
+        bool landed;
+        EntryPointer result;
+    };
+
+    struct Shard
+    {
+        explicit Shard(const unsigned capacity) : entries(capacity) {}
+
+        std::mutex mutex;
+        std::condition_variable flight_landed;
+        LRUCache<std::string, EntryPointer> entries;
+        std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+    };
+
+  public:
+    // Obliges its holder to compute the reply of a key. Waiting requests are woken up by
+    // Publish(), a lease that is dropped unpublished lets them compute the reply on their own.
+    class Lease
+    {
+      public:
+        Lease() : shard(nullptr) {}
+        Lease(Lease &&other)
+            : shard(other.shard), key(std::move(other.key)), flight(std::move(other.flight))
+        {
+            other.shard = nullptr;
+        }
+        Lease(const Lease &) = delete;
+        Lease &operator=(Lease &&other)
+        {
+            Publish(nullptr);
+            shard = other.shard;
+            key = std::move(other.key);
+            flight = std::move(other.flight);
+            other.shard = nullptr;
+            return *this;
+        }
+        ~Lease() { Publish(nullptr); }
+
+        bool Leader() const { return nullptr != shard; }
+
+        // stores the entry (unless it is null) and hands it to all waiting requests
+        void Publish(EntryPointer entry)
+        {
+            if (nullptr == shard)
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(shard->mutex);
+                if (entry)
+                {
+                    shard->entries.Insert(key, entry);
+                }
+                flight->landed = true;
+                flight->result = std::move(entry);
+                shard->flights.erase(key);
+            }
+            shard->flight_landed.notify_all();
+            shard = nullptr;
+        }
+
+      private:
+        friend class ResponseCache;
+        Lease(Shard *shard, std::string key, std::shared_ptr<Flight> flight)
+            : shard(shard), key(std::move(key)), flight(std::move(flight))
+        {
+        }
+
+        Shard *shard;
+        std::string key;
+        std::shared_ptr<Flight> flight;
+    };
+
+    // capacity is the total number of cached replies
+    explicit ResponseCache(const unsigned capacity, const unsigned number_of_shards = 16)
+        : data_version(0)
+    {
+        const unsigned shard_count = std::max(1u, number_of_shards);
+        const unsigned shard_capacity = std::max(1u, capacity / shard_count);
+        for (unsigned i = 0; i < shard_count; ++i)
+        {
+            shards.emplace_back(new Shard(shard_capacity));
+        }
+    }
+
+    // Returns the cached reply of key, possibly after waiting for an identical request that is
+    // being computed. A null result means the caller has to compute the reply itself; if the
+    // lease is the leader it should Publish() the result for others. All entries are dropped
+    // once a different data version is seen, keys have to contain the version as well so that
+    // requests racing with a data swap never see replies of the other dataset.
+    EntryPointer Fetch(const std::string &key, const std::uint64_t current_data_version,
+                       Lease &lease)
+    {
+        std::uint64_t known_version = data_version.load(std::memory_order_relaxed);
+        if (known_version != current_data_version &&
+            data_version.compare_exchange_strong(known_version, current_data_version))
+        {
+            Clear();
+        }
+
+        Shard &shard = *shards[std::hash<std::string>()(key) % shards.size()];
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        EntryPointer entry;
+        if (shard.entries.Fetch(key, entry))
+        {
+            return entry;
+        }
+
+        const auto flight_iterator = shard.flights.find(key);
+        if (flight_iterator == shard.flights.end())
+        {
+            auto flight = std::make_shared<Flight>();
+            shard.flights.emplace(key, flight);
+            lease = Lease(&shard, key, std::move(flight));
+            return nullptr;
+        }
+
+        const auto flight = flight_iterator->second;
+        shard.flight_landed.wait(lock, [&flight]
+                                 {
+                                     return flight->landed;
+                                 });
+        return flight->result;
+    }
+
+    void Clear()
+    {
+        for (auto &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->entries.Clear();
+        }
+    }
+
+    std::size_t Size() const
+    {
+        std::size_t size = 0;
+        for (const auto &shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            size += shard->entries.Size();
+        }
+        return size;
+    }
+
+  private:
+    std::atomic<std::uint64_t> data_version;
+    std::vector<std::unique_ptr<Shard>> shards;
+};
+
+#endif // RESPONSE_CACHE_HPP
@@ -28,17 +28,28 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
+#include "admission_control.hpp"
 #include "connection.hpp"
+#include "connection_pool.hpp"
+#include "http2_connection.hpp"
 #include "request_handler.hpp"
+#include "response_cache.hpp"
 
 #include "../util/integer_range.hpp"
+#include "../util/osrm_exception.hpp"
 #include "../util/simple_logger.hpp"
+#include "../util/thread_affinity.hpp"
 
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
 
 #include <zlib.h>
 
+#ifdef OSRM_HAS_NGHTTP2
+#include <nghttp2/nghttp2.h>
+#endif
+
 #include <functional>
 #include <memory>
 #include <thread>
@@ -50,40 +61,110 @@ class Server
   public:
     // Note: returns a shared instead of a unique ptr as it is captured in a lambda somewhere else
     static std::shared_ptr<Server>
-    CreateServer(std::string &ip_address, int ip_port, unsigned requested_num_threads)
+    CreateServer(std::string &ip_address,
+                 int ip_port,
+                 const std::string &unix_socket_path,
+                 unsigned requested_num_threads,
+                 unsigned keepalive_timeout,
+                 unsigned keepalive_max_requests,
+                 bool io_service_per_thread,
+                 unsigned response_cache_size)
     {
         SimpleLogger().Write() << "http 1.1 compression handled by zlib version " << zlibVersion();
+#ifdef OSRM_HAS_NGHTTP2
+        SimpleLogger().Write() << "http/2 handled by nghttp2 version "
+                               << nghttp2_version(0)->version_str;
+#endif
         const unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
         const unsigned real_num_threads = std::min(hardware_threads, requested_num_threads);
-        return std::make_shared<Server>(ip_address, ip_port, real_num_threads);
+        return std::make_shared<Server>(ip_address, ip_port, unix_socket_path, real_num_threads,
+                                        keepalive_timeout, keepalive_max_requests,
+                                        io_service_per_thread, response_cache_size);
     }
 
-    explicit Server(const std::string &address, const int port, const unsigned thread_pool_size)
-        : thread_pool_size(thread_pool_size), acceptor(io_service),
-          new_connection(std::make_shared<http::Connection>(io_service, request_handler))
+    // With io_service_per_thread each thread runs its own reactor and accepted sockets are
+    // handed out round-robin. Otherwise all threads share a single io_service. A response cache
+    // is only set up for a positive response_cache_size. With a non-empty unix_socket_path the
+    // server additionally listens on a Unix domain socket at that path, which spares local
+    // clients the TCP loopback.
+    explicit Server(const std::string &address,
+                    const int port,
+                    const std::string &unix_socket_path,
+                    const unsigned thread_pool_size,
+                    const unsigned keepalive_timeout,
+                    const unsigned keepalive_max_requests,
+                    const bool io_service_per_thread,
+                    const unsigned response_cache_size)
+        : thread_pool_size(thread_pool_size), keepalive_timeout(keepalive_timeout),
+          keepalive_max_requests(keepalive_max_requests), next_io_service(0), pin_threads(false)
     {
+        if (0 < response_cache_size)
+        {
+            response_cache.reset(new ResponseCache(response_cache_size));
+        }
+        const unsigned num_io_services = io_service_per_thread ? thread_pool_size : 1;
+        for (unsigned i = 0; i < num_io_services; ++i)
+        {
+            io_services.emplace_back(new boost::asio::io_service());
+            // keeps run() from returning while a reactor has no connection to serve
+            io_service_work.emplace_back(new boost::asio::io_service::work(*io_services.back()));
+            request_handlers.emplace_back(new RequestHandler());
+            request_handlers.back()->RegisterAdmissionControl(&admission_control);
+            request_handlers.back()->RegisterResponseCache(response_cache.get());
+            connection_pools.push_back(std::make_shared<http::ConnectionPool>(
+                *io_services.back(), *request_handlers.back(), keepalive_timeout,
+                keepalive_max_requests, MAX_IDLE_CONNECTIONS));
+        }
+        acceptor.reset(new boost::asio::ip::tcp::acceptor(*io_services.front()));
+
         const auto port_string = std::to_string(port);
 
-        boost::asio::ip::tcp::resolver resolver(io_service);
+        boost::asio::ip::tcp::resolver resolver(*io_services.front());
         boost::asio::ip::tcp::resolver::query query(address, port_string);
         boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve(query);
 
-        acceptor.open(endpoint.protocol());
-        acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
-        acceptor.bind(endpoint);
-        acceptor.listen();
-        acceptor.async_accept(
-            new_connection->socket(),
-            boost::bind(&Server::HandleAccept, this, boost::asio::placeholders::error));
+        acceptor->open(endpoint.protocol());
+        acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor->bind(endpoint);
+        acceptor->listen();
+        StartAccept();
+
+        if (!unix_socket_path.empty())
+        {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            // a stale socket file of a previous run would make the bind fail
+            boost::filesystem::remove(unix_socket_path);
+            local_acceptor.reset(new boost::asio::local::stream_protocol::acceptor(
+                *io_services.front(), boost::asio::local::stream_protocol::endpoint(
+                                          unix_socket_path)));
+            StartLocalAccept();
+#else
+            throw osrm::exception("Unix domain sockets are not supported on this platform");
+#endif
+        }
     }
 
     void Run()
     {
+        const auto cpus = pin_threads ? osrm::affinity::AllowedCPUs() : std::vector<unsigned>();
+        if (pin_threads && cpus.empty())
+        {
+            SimpleLogger().Write(logWARNING) << "threads can not be pinned on this platform";
+        }
         std::vector<std::shared_ptr<std::thread>> threads;
         for (unsigned i = 0; i < thread_pool_size; ++i)
         {
+            auto &io_service = *io_services[i % io_services.size()];
             std::shared_ptr<std::thread> thread = std::make_shared<std::thread>(
-                boost::bind(&boost::asio::io_service::run, &io_service));
+                [&io_service, &cpus, i]
+                {
+                    // the query heaps are allocated by the thread that uses them, on its node
+                    if (!cpus.empty())
+                    {
+                        osrm::affinity::PinCurrentThread(cpus[i % cpus.size()]);
+                    }
+                    io_service.run();
+                });
             threads.push_back(thread);
         }
         for (auto thread : threads)
@@ -92,28 +173,153 @@ class Server
         }
     }
 
-    void Stop() { io_service.stop(); }
+    void Stop()
+    {
+        for (auto &io_service : io_services)
+        {
+            io_service->stop();
+        }
+    }
+
+    void RegisterRoutingMachine(OSRM *osrm)
+    {
+        for (auto &request_handler : request_handlers)
+        {
+            request_handler->RegisterRoutingMachine(osrm);
+        }
+    }
 
-    RequestHandler &GetRequestHandlerPtr() { return request_handler; }
+    // Has to be called before Run()
+    void SetServiceLimits(const std::string &service, const AdmissionControl::Limits limits)
+    {
+        admission_control.SetLimits(service, limits);
+    }
+
+    // Pins the worker threads to the allowed CPUs, one each, so that a thread and the query
+    // heaps it allocated stay on the same core. Has to be called before Run()
+    void SetThreadAffinity(const bool pin) { pin_threads = pin; }
+
+    // Additionally accepts HTTP/2 connections with prior knowledge (h2c) on another port. Their
+    // requests are multiplexed and handled concurrently, see http::Http2Connection. An idle
+    // connection is closed after the keep-alive timeout. Has to be called before Run()
+    void ListenHttp2(const std::string &address, const int port)
+    {
+#ifdef OSRM_HAS_NGHTTP2
+        boost::asio::ip::tcp::resolver resolver(*io_services.front());
+        boost::asio::ip::tcp::resolver::query query(address, std::to_string(port));
+        boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve(query);
+
+        http2_acceptor.reset(new boost::asio::ip::tcp::acceptor(*io_services.front()));
+        http2_acceptor->open(endpoint.protocol());
+        http2_acceptor->set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+        http2_acceptor->bind(endpoint);
+        http2_acceptor->listen();
+        StartHttp2Accept();
+#else
+        (void)address;
+        (void)port;
+        throw osrm::exception("HTTP/2 needs nghttp2, which is not built in");
+#endif
+    }
+
+    // milliseconds after which the searches of a request give up, 0 for no limit
+    void SetRequestTimeout(const unsigned milliseconds)
+    {
+        for (auto &request_handler : request_handlers)
+        {
+            request_handler->SetRequestTimeout(milliseconds);
+        }
+    }
 
   private:
+    // closed connections kept per reactor for reuse
+    static constexpr std::size_t MAX_IDLE_CONNECTIONS = 256;
+
+    void StartAccept()
+    {
+        // the connection and its request handler live on the reactor that serves it
+        const auto index = next_io_service;
+        next_io_service = (next_io_service + 1) % io_services.size();
+        new_connection = connection_pools[index]->Acquire();
+        acceptor->async_accept(
+            new_connection->socket(),
+            boost::bind(&Server::HandleAccept, this, boost::asio::placeholders::error));
+    }
+
     void HandleAccept(const boost::system::error_code &e)
     {
         if (!e)
         {
             new_connection->start();
-            new_connection = std::make_shared<http::Connection>(io_service, request_handler);
-            acceptor.async_accept(
-                new_connection->socket(),
-                boost::bind(&Server::HandleAccept, this, boost::asio::placeholders::error));
+            StartAccept();
+        }
+    }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    void StartLocalAccept()
+    {
+        const auto index = next_io_service;
+        next_io_service = (next_io_service + 1) % io_services.size();
+        new_local_connection = connection_pools[index]->Acquire();
+        local_acceptor->async_accept(
+            new_local_connection->socket(),
+            boost::bind(&Server::HandleLocalAccept, this, boost::asio::placeholders::error));
+    }
+
+    void HandleLocalAccept(const boost::system::error_code &e)
+    {
+        if (!e)
+        {
+            new_local_connection->start();
+            StartLocalAccept();
+        }
+    }
+#endif
+
+#ifdef OSRM_HAS_NGHTTP2
+    void StartHttp2Accept()
+    {
+        // multiplexed connections are few and long-lived, they aren't pooled
+        const auto index = next_io_service;
+        next_io_service = (next_io_service + 1) % io_services.size();
+        new_http2_connection = std::make_shared<http::Http2Connection>(
+            *io_services[index], *request_handlers[index], keepalive_timeout);
+        http2_acceptor->async_accept(
+            new_http2_connection->socket(),
+            boost::bind(&Server::HandleHttp2Accept, this, boost::asio::placeholders::error));
+    }
+
+    void HandleHttp2Accept(const boost::system::error_code &e)
+    {
+        if (!e)
+        {
+            new_http2_connection->start();
+            StartHttp2Accept();
         }
     }
+#endif
 
     unsigned thread_pool_size;
-    boost::asio::io_service io_service;
-    boost::asio::ip::tcp::acceptor acceptor;
+    unsigned keepalive_timeout;
+    unsigned keepalive_max_requests;
+    std::size_t next_io_service;
+    bool pin_threads;
+    AdmissionControl admission_control;
+    std::unique_ptr<ResponseCache> response_cache;
+    std::vector<std::unique_ptr<boost::asio::io_service>> io_services;
+    std::vector<std::unique_ptr<boost::asio::io_service::work>> io_service_work;
+    std::vector<std::unique_ptr<RequestHandler>> request_handlers;
+    std::vector<std::shared_ptr<http::ConnectionPool>> connection_pools;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> acceptor;
     std::shared_ptr<http::Connection> new_connection;
-    RequestHandler request_handler;
+#ifdef OSRM_HAS_NGHTTP2
+    std::unique_ptr<boost::asio::ip::tcp::acceptor> http2_acceptor;
+    std::shared_ptr<http::Http2Connection> new_http2_connection;
+#endif
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    std::unique_ptr<boost::asio::local::stream_protocol::acceptor> local_acceptor;
+    std::shared_ptr<http::Connection> new_local_connection;
+#endif
 };
 
 #endif // SERVER_HPP
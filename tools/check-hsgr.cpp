@@ -24,89 +24,700 @@ ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
-#include "../data_structures/percent.hpp"
+#include "../algorithms/crc32_processor.hpp"
+#include "../data_structures/edge_based_node.hpp"
+#include "../data_structures/original_edge_data.hpp"
 #include "../data_structures/query_edge.hpp"
+#include "../data_structures/query_node.hpp"
+#include "../data_structures/range_table.hpp"
 #include "../data_structures/static_graph.hpp"
-#include "../util/integer_range.hpp"
+#include "../data_structures/static_rtree.hpp"
+#include "../util/fingerprint.hpp"
 #include "../util/graph_loader.hpp"
-#include "../util/simple_logger.hpp"
+#include "../util/integer_range.hpp"
 #include "../util/osrm_exception.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
 
-#include <boost/assert.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/combinable.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_group.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
 #include <vector>
 
+// Validates a dataset before it is published: the layout of each file and the ids by which the
+// files reference each other. The files are checked concurrently, the per-record files are
+// streamed through a buffer that is checked in parallel. The checksums of the files are written
+// to a list, or compared with the list an earlier run wrote.
+
+namespace
+{
+
 using EdgeData = QueryEdge::EdgeData;
 using QueryGraph = StaticGraph<EdgeData>;
+using RTreeLeaf = EdgeBasedNode;
+using RTree = StaticRTree<RTreeLeaf>;
+using NameTable = RangeTable<16, false>;
 
-int main(int argc, char *argv[])
+// records of the per-record files are checked in buffers of this many records
+const std::uint64_t STREAM_BUFFER_RECORDS = 1u << 20;
+// files are checksummed through a buffer of this many bytes
+const std::size_t CHECKSUM_BUFFER_SIZE = 16 * 1024 * 1024;
+// at most this many problems are logged per file, the others are only counted
+const std::size_t MAX_LOGGED_PROBLEMS = 10;
+
+// the problems the checks of all threads found
+class ProblemLog
 {
-    LogPolicy::GetInstance().Unmute();
-    try
+  public:
+    void Report(const boost::filesystem::path &file, const std::string &message)
     {
-        if (argc != 2)
+        std::lock_guard<std::mutex> lock(mutex);
+        const std::string file_name = file.filename().string();
+        if (++problems[file_name] <= MAX_LOGGED_PROBLEMS)
         {
-            SimpleLogger().Write(logWARNING) << "usage: " << argv[0] << " <file.hsgr>";
-            return 1;
+            SimpleLogger().Write(logWARNING) << file_name << ": " << message;
+        }
+    }
+
+    // logs the number of problems of each file
+    std::size_t Summarize() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::size_t number_of_problems = 0;
+        for (const auto &file_problems : problems)
+        {
+            SimpleLogger().Write(logWARNING) << file_problems.first << ": "
+                                             << file_problems.second << " problems";
+            number_of_problems += file_problems.second;
+        }
+        return number_of_problems;
+    }
+
+  private:
+    mutable std::mutex mutex;
+    std::map<std::string, std::size_t> problems;
+};
+
+struct DatasetFiles
+{
+    explicit DatasetFiles(const std::string &base)
+        : hsgr(base + ".hsgr"), nodes(base + ".nodes"), edges(base + ".edges"),
+          geometries(base + ".geometry"), ram_index(base + ".ramIndex"),
+          file_index(base + ".fileIndex"), names(base + ".names"), weights(base + ".weights")
+    {
+    }
+
+    // the files that are checksummed, the weights are optional
+    std::vector<boost::filesystem::path> All() const
+    {
+        std::vector<boost::filesystem::path> files = {hsgr,      nodes,      edges, geometries,
+                                                      ram_index, file_index, names};
+        if (boost::filesystem::exists(weights))
+        {
+            files.push_back(weights);
+        }
+        return files;
+    }
+
+    boost::filesystem::path hsgr;
+    boost::filesystem::path nodes;
+    boost::filesystem::path edges;
+    boost::filesystem::path geometries;
+    boost::filesystem::path ram_index;
+    boost::filesystem::path file_index;
+    boost::filesystem::path names;
+    boost::filesystem::path weights;
+};
+
+// numbers of the objects the files reference each other by, read from the headers
+struct DatasetSizes
+{
+    unsigned number_of_coordinates;
+    unsigned number_of_graph_nodes;
+    unsigned number_of_graph_edges;
+    unsigned graph_checksum;
+    unsigned number_of_original_edges;
+    unsigned number_of_geometries;
+    // an upper bound, the names file only stores the number of blocks of names
+    std::uint64_t number_of_names;
+};
+
+void OpenFile(const boost::filesystem::path &file, boost::filesystem::ifstream &stream)
+{
+    if (!boost::filesystem::is_regular_file(file))
+    {
+        throw osrm::exception(file.string() + " not found");
+    }
+    stream.open(file, std::ios::binary);
+}
+
+unsigned ReadUnsigned(std::istream &stream, const boost::filesystem::path &file)
+{
+    unsigned value = 0;
+    if (!stream.read((char *)&value, sizeof(unsigned)))
+    {
+        throw osrm::exception(file.string() + " is truncated");
+    }
+    return value;
+}
+
+DatasetSizes ReadSizes(const DatasetFiles &files)
+{
+    DatasetSizes sizes;
+    boost::filesystem::ifstream nodes_stream;
+    OpenFile(files.nodes, nodes_stream);
+    sizes.number_of_coordinates = ReadUnsigned(nodes_stream, files.nodes);
+
+    // the node array of the graph ends with a sentinel
+    boost::filesystem::ifstream hsgr_stream;
+    OpenFile(files.hsgr, hsgr_stream);
+    hsgr_stream.seekg(sizeof(FingerPrint));
+    sizes.graph_checksum = ReadUnsigned(hsgr_stream, files.hsgr);
+    sizes.number_of_graph_nodes = std::max(1u, ReadUnsigned(hsgr_stream, files.hsgr)) - 1;
+    sizes.number_of_graph_edges = ReadUnsigned(hsgr_stream, files.hsgr);
+
+    boost::filesystem::ifstream edges_stream;
+    OpenFile(files.edges, edges_stream);
+    sizes.number_of_original_edges = ReadUnsigned(edges_stream, files.edges);
+
+    // the geometry offsets end with a sentinel as well
+    boost::filesystem::ifstream geometry_stream;
+    OpenFile(files.geometries, geometry_stream);
+    sizes.number_of_geometries = std::max(1u, ReadUnsigned(geometry_stream, files.geometries)) - 1;
+
+    boost::filesystem::ifstream names_stream;
+    OpenFile(files.names, names_stream);
+    const unsigned number_of_name_blocks = ReadUnsigned(names_stream, files.names);
+    sizes.number_of_names =
+        std::uint64_t(number_of_name_blocks) * (std::tuple_size<NameTable::BlockT>::value + 1);
+    return sizes;
+}
+
+// Checks number_of_records records of the stream buffer by buffer. The check of a buffer is run
+// in parallel, it is passed the index of a record, the record and the record before it, if any.
+template <typename RecordT, typename CheckT>
+void StreamRecords(std::istream &stream,
+                   const boost::filesystem::path &file,
+                   const std::uint64_t number_of_records,
+                   const CheckT &check)
+{
+    std::vector<RecordT> buffer(std::min(number_of_records, STREAM_BUFFER_RECORDS) + 1);
+    for (std::uint64_t first = 0; first < number_of_records; first += STREAM_BUFFER_RECORDS)
+    {
+        const std::uint64_t count = std::min(STREAM_BUFFER_RECORDS, number_of_records - first);
+        // the last record of the previous buffer stays in front
+        if (first > 0)
+        {
+            buffer[0] = buffer[STREAM_BUFFER_RECORDS];
+        }
+        if (!stream.read((char *)(buffer.data() + 1), count * sizeof(RecordT)))
+        {
+            throw osrm::exception(file.string() + " is truncated");
+        }
+        tbb::parallel_for(tbb::blocked_range<std::uint64_t>(0, count),
+                          [&](const tbb::blocked_range<std::uint64_t> &range)
+                          {
+                              for (const auto i : osrm::irange(range.begin(), range.end()))
+                              {
+                                  const RecordT *previous =
+                                      (0 == first + i) ? nullptr : &buffer[i];
+                                  check(first + i, buffer[i + 1], previous);
+                              }
+                          });
+    }
+}
+
+std::string InRecord(const std::string &record, const std::uint64_t index)
+{
+    return " in " + record + " " + std::to_string(index);
+}
+
+void CheckGraph(const DatasetFiles &files, const DatasetSizes &sizes, ProblemLog &log)
+{
+    std::vector<QueryGraph::NodeArrayEntry> node_list;
+    std::vector<QueryGraph::EdgeArrayEntry> edge_list;
+    unsigned checksum = 0;
+    readHSGRFromStream(files.hsgr, node_list, edge_list, &checksum);
+    if (node_list.empty())
+    {
+        throw osrm::exception("the graph has no nodes");
+    }
+    if (boost::filesystem::file_size(files.hsgr) !=
+        sizeof(FingerPrint) + 3 * sizeof(unsigned) +
+            node_list.size() * sizeof(QueryGraph::NodeArrayEntry) +
+            edge_list.size() * sizeof(QueryGraph::EdgeArrayEntry))
+    {
+        throw osrm::exception("file size doesn't match the number of nodes and edges");
+    }
+    if (boost::filesystem::exists(files.weights))
+    {
+        boost::filesystem::ifstream weights_stream;
+        OpenFile(files.weights, weights_stream);
+        const unsigned weights_checksum = ReadUnsigned(weights_stream, files.weights);
+        const unsigned number_of_weights = ReadUnsigned(weights_stream, files.weights);
+        if (weights_checksum != checksum || number_of_weights != edge_list.size())
+        {
+            log.Report(files.weights, "was not customized for this graph");
         }
+    }
+
+    // the edges of a node follow the ones of the node before it, the graph can only be traversed
+    // if they do
+    if (0 != node_list.front().first_edge || edge_list.size() != node_list.back().first_edge)
+    {
+        throw osrm::exception("the node array doesn't cover the edge array");
+    }
+    std::atomic<bool> has_unordered_nodes(false);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(1, node_list.size()),
+                      [&](const tbb::blocked_range<std::size_t> &range)
+                      {
+                          for (const auto node : osrm::irange(range.begin(), range.end()))
+                          {
+                              if (node_list[node - 1].first_edge > node_list[node].first_edge)
+                              {
+                                  has_unordered_nodes = true;
+                                  log.Report(files.hsgr, "edges out of order" +
+                                                             InRecord("node", node - 1));
+                              }
+                          }
+                      });
+    if (has_unordered_nodes)
+    {
+        return;
+    }
+
+    const QueryGraph graph(node_list, edge_list);
+    const unsigned number_of_nodes = graph.GetNumberOfNodes();
+    tbb::parallel_for(
+        tbb::blocked_range<unsigned>(0, number_of_nodes),
+        [&](const tbb::blocked_range<unsigned> &range)
+        {
+            for (const auto node_u : osrm::irange(range.begin(), range.end()))
+            {
+                for (const auto eid : graph.GetAdjacentEdgeRange(node_u))
+                {
+                    const EdgeData &data = graph.GetEdgeData(eid);
+                    const NodeID node_v = graph.GetTarget(eid);
+                    if (node_v >= number_of_nodes)
+                    {
+                        log.Report(files.hsgr, "target out of range" + InRecord("edge", eid));
+                        continue;
+                    }
+                    if (!data.forward && !data.backward)
+                    {
+                        log.Report(files.hsgr, "no direction" + InRecord("edge", eid));
+                    }
+                    if (!data.shortcut)
+                    {
+                        if (data.id >= sizes.number_of_original_edges)
+                        {
+                            log.Report(files.hsgr,
+                                       "original edge out of range" + InRecord("edge", eid));
+                        }
+                        continue;
+                    }
+                    if (data.id >= number_of_nodes)
+                    {
+                        log.Report(files.hsgr, "middle node out of range" + InRecord("edge", eid));
+                        continue;
+                    }
+                    if (SPECIAL_EDGEID == graph.FindEdgeInEitherDirection(node_u, data.id))
+                    {
+                        log.Report(files.hsgr, "first segment not found" + InRecord("edge", eid));
+                    }
+                    if (SPECIAL_EDGEID == graph.FindEdgeInEitherDirection(data.id, node_v))
+                    {
+                        log.Report(files.hsgr, "second segment not found" + InRecord("edge", eid));
+                    }
+                }
+            }
+        });
+}
+
+void CheckCoordinates(const DatasetFiles &files, const DatasetSizes &sizes, ProblemLog &log)
+{
+    boost::filesystem::ifstream nodes_stream;
+    OpenFile(files.nodes, nodes_stream);
+    ReadUnsigned(nodes_stream, files.nodes);
+    StreamRecords<QueryNode>(nodes_stream, files.nodes, sizes.number_of_coordinates,
+                             [&](const std::uint64_t node, const QueryNode &query_node,
+                                 const QueryNode *)
+                             {
+                                 if (!FixedPointCoordinate(query_node.lat, query_node.lon)
+                                          .is_valid())
+                                 {
+                                     log.Report(files.nodes,
+                                                "invalid coordinate" + InRecord("node", node));
+                                 }
+                             });
+}
+
+void CheckOriginalEdges(const DatasetFiles &files, const DatasetSizes &sizes, ProblemLog &log)
+{
+    boost::filesystem::ifstream edges_stream;
+    OpenFile(files.edges, edges_stream);
+    ReadUnsigned(edges_stream, files.edges);
+    tbb::combinable<std::uint64_t> name_runs([]
+                                             {
+                                                 return 0;
+                                             });
+    StreamRecords<OriginalEdgeData>(
+        edges_stream, files.edges, sizes.number_of_original_edges,
+        [&](const std::uint64_t edge, const OriginalEdgeData &data,
+            const OriginalEdgeData *previous)
+        {
+            // the via node of a compressed edge is the id of its geometry
+            if (data.compressed_geometry ? data.via_node >= sizes.number_of_geometries
+                                         : data.via_node >= sizes.number_of_coordinates)
+            {
+                log.Report(files.edges, "via node out of range" + InRecord("edge", edge));
+            }
+            if (INVALID_NAMEID != data.name_id && data.name_id >= sizes.number_of_names)
+            {
+                log.Report(files.edges, "name out of range" + InRecord("edge", edge));
+            }
+            if (!TravelModeVector<false>::Fits(data.travel_mode) ||
+                !TurnInstructionVector<false>::Fits(data.turn_instruction))
+            {
+                log.Report(files.edges, "mode or turn can't be packed" + InRecord("edge", edge));
+            }
+            if (nullptr == previous || previous->name_id != data.name_id)
+            {
+                ++name_runs.local();
+            }
+        });
+
+    // the facades size the name ids by the number of runs that follows the edges, older files
+    // end without it
+    unsigned number_of_name_runs = 0;
+    if (edges_stream.read((char *)&number_of_name_runs, sizeof(unsigned)) &&
+        number_of_name_runs != name_runs.combine(std::plus<std::uint64_t>()))
+    {
+        log.Report(files.edges, "number of name runs doesn't match the edges");
+    }
+}
+
+void CheckGeometries(const DatasetFiles &files, const DatasetSizes &sizes, ProblemLog &log)
+{
+    boost::filesystem::ifstream geometry_stream;
+    OpenFile(files.geometries, geometry_stream);
+    const unsigned number_of_offsets = ReadUnsigned(geometry_stream, files.geometries);
+    unsigned last_offset = 0;
+    StreamRecords<unsigned>(geometry_stream, files.geometries, number_of_offsets,
+                            [&](const std::uint64_t geometry, const unsigned &offset,
+                                const unsigned *previous)
+                            {
+                                if (nullptr == previous ? 0 != offset : offset < *previous)
+                                {
+                                    log.Report(files.geometries,
+                                               "offset out of order" +
+                                                   InRecord("geometry", geometry));
+                                }
+                                if (geometry + 1 == number_of_offsets)
+                                {
+                                    last_offset = offset;
+                                }
+                            });
+
+    const unsigned number_of_geometry_nodes = ReadUnsigned(geometry_stream, files.geometries);
+    if (last_offset != number_of_geometry_nodes)
+    {
+        log.Report(files.geometries, "offsets don't cover the geometry nodes");
+    }
+    StreamRecords<NodeID>(geometry_stream, files.geometries, number_of_geometry_nodes,
+                          [&](const std::uint64_t index, const NodeID &node, const NodeID *)
+                          {
+                              if (node >= sizes.number_of_coordinates)
+                              {
+                                  log.Report(files.geometries, "node out of range" +
+                                                                   InRecord("entry", index));
+                              }
+                          });
+
+    // the generalization levels are optional, there is one per geometry node
+    unsigned number_of_zoom_levels = 0;
+    if (geometry_stream.read((char *)&number_of_zoom_levels, sizeof(unsigned)) &&
+        0 != number_of_zoom_levels && number_of_zoom_levels != number_of_geometry_nodes)
+    {
+        log.Report(files.geometries, "number of zoom levels doesn't match the geometry nodes");
+    }
+}
 
-        boost::filesystem::path hsgr_path(argv[1]);
+void CheckNames(const DatasetFiles &files, ProblemLog &log)
+{
+    boost::filesystem::ifstream names_stream;
+    OpenFile(files.names, names_stream);
+    const unsigned number_of_blocks = ReadUnsigned(names_stream, files.names);
+    const unsigned sum_lengths = ReadUnsigned(names_stream, files.names);
 
-        std::vector<QueryGraph::NodeArrayEntry> node_list;
-        std::vector<QueryGraph::EdgeArrayEntry> edge_list;
-        SimpleLogger().Write() << "loading graph from " << hsgr_path.string();
+    // the offsets are the begin of the first name of each block
+    std::vector<unsigned> block_offsets(number_of_blocks);
+    if (!names_stream.read((char *)block_offsets.data(), number_of_blocks * sizeof(unsigned)))
+    {
+        throw osrm::exception(files.names.string() + " is truncated");
+    }
+    for (const auto block : osrm::irange(0u, number_of_blocks))
+    {
+        if ((0 == block ? 0 != block_offsets[block]
+                        : block_offsets[block] < block_offsets[block - 1]) ||
+            block_offsets[block] > sum_lengths)
+        {
+            log.Report(files.names, "offset out of order" + InRecord("block", block));
+        }
+    }
 
-        unsigned m_check_sum = 0;
-        unsigned m_number_of_nodes =
-            readHSGRFromStream(hsgr_path, node_list, edge_list, &m_check_sum);
-        SimpleLogger().Write() << "expecting " << m_number_of_nodes
-                               << " nodes, checksum: " << m_check_sum;
-        BOOST_ASSERT_MSG(0 != node_list.size(), "node list empty");
-        SimpleLogger().Write() << "loaded " << node_list.size() << " nodes and " << edge_list.size()
-                               << " edges";
-        auto m_query_graph = std::make_shared<QueryGraph>(node_list, edge_list);
+    names_stream.seekg(number_of_blocks * sizeof(NameTable::BlockT), std::ios::cur);
+    const unsigned number_of_chars = ReadUnsigned(names_stream, files.names);
+    if (number_of_chars != sum_lengths)
+    {
+        log.Report(files.names, "length of the names doesn't match the characters");
+    }
+    if (boost::filesystem::file_size(files.names) !=
+        3 * sizeof(unsigned) +
+            std::uint64_t(number_of_blocks) * (sizeof(unsigned) + sizeof(NameTable::BlockT)) +
+            number_of_chars)
+    {
+        log.Report(files.names, "file size doesn't match the number of names");
+    }
+}
 
-        BOOST_ASSERT_MSG(0 == node_list.size(), "node list not flushed");
-        BOOST_ASSERT_MSG(0 == edge_list.size(), "edge list not flushed");
+void CheckIndex(const DatasetFiles &files, const DatasetSizes &sizes, ProblemLog &log)
+{
+    // the coordinates are only needed by queries
+    const RTree rtree(files.ram_index, files.file_index,
+                      std::make_shared<std::vector<FixedPointCoordinate>>());
+    rtree.CheckConsistency();
 
-        Percent progress(m_query_graph->GetNumberOfNodes());
-        for (const auto node_u : osrm::irange(0u, m_query_graph->GetNumberOfNodes()))
+    const RTreeLeaf *elements = rtree.GetElementsBegin();
+    const std::uint64_t number_of_elements = rtree.GetElementsEnd() - elements;
+    const auto is_valid_node = [&sizes](const NodeID node)
+    {
+        return SPECIAL_NODEID == node || node < sizes.number_of_graph_nodes;
+    };
+    tbb::parallel_for(
+        tbb::blocked_range<std::uint64_t>(0, number_of_elements),
+        [&](const tbb::blocked_range<std::uint64_t> &range)
         {
-            for (const auto eid : m_query_graph->GetAdjacentEdgeRange(node_u))
+            for (const auto index : osrm::irange(range.begin(), range.end()))
             {
-                const EdgeData &data = m_query_graph->GetEdgeData(eid);
-                if (!data.shortcut)
+                const RTreeLeaf &element = elements[index];
+                if (element.u >= sizes.number_of_coordinates ||
+                    element.v >= sizes.number_of_coordinates)
                 {
-                    continue;
+                    log.Report(files.file_index,
+                               "coordinate out of range" + InRecord("segment", index));
                 }
-                const unsigned node_v = m_query_graph->GetTarget(eid);
-                const EdgeID edge_id_1 = m_query_graph->FindEdgeInEitherDirection(node_u, data.id);
-                if (SPECIAL_EDGEID == edge_id_1)
+                if (!is_valid_node(element.forward_edge_based_node_id) ||
+                    !is_valid_node(element.reverse_edge_based_node_id) ||
+                    (SPECIAL_NODEID == element.forward_edge_based_node_id &&
+                     SPECIAL_NODEID == element.reverse_edge_based_node_id))
                 {
-                    throw osrm::exception("cannot find first segment of edge (" +
-                                          std::to_string(node_u) + "," + std::to_string(data.id) +
-                                          "," + std::to_string(node_v) + "), eid: " +
-                                          std::to_string(eid));
+                    log.Report(files.file_index,
+                               "graph node out of range" + InRecord("segment", index));
                 }
-                const EdgeID edge_id_2 = m_query_graph->FindEdgeInEitherDirection(data.id, node_v);
-                if (SPECIAL_EDGEID == edge_id_2)
+                if (INVALID_NAMEID != element.name_id && element.name_id >= sizes.number_of_names)
                 {
-                    throw osrm::exception("cannot find second segment of edge (" +
-                                          std::to_string(node_u) + "," + std::to_string(data.id) +
-                                          "," + std::to_string(node_v) + "), eid: " +
-                                          std::to_string(eid));
+                    log.Report(files.file_index, "name out of range" + InRecord("segment", index));
+                }
+                if (element.IsCompressed() &&
+                    element.packed_geometry_id >= sizes.number_of_geometries)
+                {
+                    log.Report(files.file_index,
+                               "geometry out of range" + InRecord("segment", index));
                 }
             }
-            progress.printStatus(node_u);
+        });
+}
+
+// the checksum of the whole file, it is read buffer by buffer
+unsigned ChecksumFile(const boost::filesystem::path &file)
+{
+    boost::filesystem::ifstream stream;
+    OpenFile(file, stream);
+    const IteratorbasedCRC32 crc32;
+    std::vector<char> buffer(CHECKSUM_BUFFER_SIZE);
+    unsigned checksum = 0;
+    while (stream)
+    {
+        stream.read(buffer.data(), buffer.size());
+        const std::size_t length = static_cast<std::size_t>(stream.gcount());
+        checksum = IteratorbasedCRC32::combine(checksum, crc32.checksum(buffer.data(), length),
+                                               length);
+    }
+    return checksum;
+}
+
+// Writes the checksums of the files to the list if it doesn't exist yet, a line per file with
+// its checksum in hex and its name. Otherwise every file has to match its line in the list.
+void CheckChecksums(const std::vector<boost::filesystem::path> &files,
+                    const std::vector<unsigned> &checksums,
+                    const boost::filesystem::path &checksum_list,
+                    ProblemLog &log)
+{
+    if (!boost::filesystem::exists(checksum_list))
+    {
+        boost::filesystem::ofstream list_stream(checksum_list);
+        for (const auto i : osrm::irange<std::size_t>(0, files.size()))
+        {
+            list_stream << std::hex << std::setw(8) << std::setfill('0') << checksums[i] << " "
+                        << files[i].filename().string() << "\n";
+        }
+        SimpleLogger().Write() << "wrote checksums to " << checksum_list.string();
+        return;
+    }
+
+    std::map<std::string, unsigned> listed_checksums;
+    boost::filesystem::ifstream list_stream(checksum_list);
+    std::string line;
+    while (std::getline(list_stream, line))
+    {
+        std::istringstream line_stream(line);
+        unsigned checksum = 0;
+        std::string file_name;
+        if (line_stream >> std::hex >> checksum >> file_name)
+        {
+            listed_checksums[file_name] = checksum;
+        }
+    }
+    for (const auto i : osrm::irange<std::size_t>(0, files.size()))
+    {
+        const auto listed = listed_checksums.find(files[i].filename().string());
+        if (listed == listed_checksums.end())
+        {
+            log.Report(files[i], "not in " + checksum_list.string());
+        }
+        else if (listed->second != checksums[i])
+        {
+            log.Report(files[i], "checksum doesn't match " + checksum_list.string());
+        }
+    }
+}
+}
+
+int main(int argc, char *argv[])
+{
+    LogPolicy::GetInstance().Unmute();
+    try
+    {
+        if (argc < 2 || argc > 3)
+        {
+            SimpleLogger().Write(logWARNING) << "usage: " << argv[0]
+                                             << " <file.osrm> [<checksum list>]";
+            return 1;
+        }
+
+        // the .hsgr is accepted as well, the other files are found next to it
+        boost::filesystem::path base_path(argv[1]);
+        if (".hsgr" == base_path.extension())
+        {
+            base_path.replace_extension();
+        }
+        SimpleLogger().Write() << "checking dataset " << base_path.string();
+
+        TIMER_START(validation);
+        const DatasetFiles files(base_path.string());
+        const DatasetSizes sizes = ReadSizes(files);
+        SimpleLogger().Write() << sizes.number_of_graph_nodes << " graph nodes, "
+                               << sizes.number_of_graph_edges << " graph edges, "
+                               << sizes.number_of_original_edges << " original edges, "
+                               << sizes.number_of_coordinates << " coordinates, "
+                               << sizes.number_of_geometries << " geometries";
+
+        ProblemLog log;
+        const std::vector<boost::filesystem::path> all_files = files.All();
+        std::vector<unsigned> checksums(all_files.size(), 0);
+        tbb::task_group checks;
+        const auto run_check = [&checks, &log](const boost::filesystem::path &file,
+                                               const std::function<void()> &check)
+        {
+            checks.run([&log, file, check]
+                       {
+                           try
+                           {
+                               check();
+                           }
+                           catch (const std::exception &e)
+                           {
+                               log.Report(file, e.what());
+                           }
+                       });
+        };
+        run_check(files.hsgr, [&]
+                  {
+                      CheckGraph(files, sizes, log);
+                  });
+        run_check(files.nodes, [&]
+                  {
+                      CheckCoordinates(files, sizes, log);
+                  });
+        run_check(files.edges, [&]
+                  {
+                      CheckOriginalEdges(files, sizes, log);
+                  });
+        run_check(files.geometries, [&]
+                  {
+                      CheckGeometries(files, sizes, log);
+                  });
+        run_check(files.names, [&]
+                  {
+                      CheckNames(files, log);
+                  });
+        run_check(files.file_index, [&]
+                  {
+                      CheckIndex(files, sizes, log);
+                  });
+        for (const auto i : osrm::irange<std::size_t>(0, all_files.size()))
+        {
+            run_check(all_files[i], [&, i]
+                      {
+                          checksums[i] = ChecksumFile(all_files[i]);
+                      });
+        }
+        checks.wait();
+
+        for (const auto i : osrm::irange<std::size_t>(0, all_files.size()))
+        {
+            std::ostringstream checksum;
+            checksum << std::hex << std::setw(8) << std::setfill('0') << checksums[i];
+            SimpleLogger().Write() << "checksum of " << all_files[i].filename().string() << ": "
+                                   << checksum.str();
+        }
+        if (3 == argc)
+        {
+            CheckChecksums(all_files, checksums, argv[2], log);
+        }
+
+        TIMER_STOP(validation);
+        const std::size_t number_of_problems = log.Summarize();
+        if (0 != number_of_problems)
+        {
+            SimpleLogger().Write(logWARNING) << "dataset " << base_path.string() << " has "
+                                             << number_of_problems << " problems";
+            return 1;
         }
-        m_query_graph.reset();
-        SimpleLogger().Write() << "Data file " << argv[0] << " appears to be OK";
+        SimpleLogger().Write() << "dataset " << base_path.string()
+                               << " appears to be OK, checked in " << TIMER_SEC(validation)
+                               << " seconds";
     }
     catch (const std::exception &e)
     {
         SimpleLogger().Write(logWARNING) << "[exception] " << e.what();
+        return 1;
     }
     return 0;
 }
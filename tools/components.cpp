@@ -26,7 +26,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "../typedefs.h"
-#include "../algorithms/tarjan_scc.hpp"
+#include "../algorithms/parallel_scc.hpp"
 #include "../algorithms/coordinate_calculation.hpp"
 #include "../data_structures/dynamic_graph.hpp"
 #include "../data_structures/static_graph.hpp"
@@ -148,7 +148,7 @@ int main(int argc, char *argv[])
 
         SimpleLogger().Write() << "Starting SCC graph traversal";
 
-        auto tarjan = osrm::make_unique<TarjanSCC<TarjanGraph>>(graph);
+        auto tarjan = osrm::make_unique<ParallelSCC<TarjanGraph>>(graph);
         tarjan->run();
         SimpleLogger().Write() << "identified: " << tarjan->get_number_of_components()
                                << " many components";
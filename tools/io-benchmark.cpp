@@ -25,26 +25,42 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 */
 
+// record the leaves the r-tree queries read
+#define OSRM_RTREE_LEAF_STATISTICS
+
+#include "../data_structures/edge_based_node.hpp"
+#include "../data_structures/query_node.hpp"
+#include "../data_structures/shared_memory_vector_wrapper.hpp"
+#include "../data_structures/static_rtree.hpp"
+#include "../util/integer_range.hpp"
 #include "../util/version.hpp"
 #include "../util/osrm_exception.hpp"
 #include "../util/simple_logger.hpp"
 #include "../util/timing_util.hpp"
 
+#include <osrm/coordinate.hpp>
+
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <fcntl.h>
 #ifdef __linux__
 #include <malloc.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <iomanip>
 #include <numeric>
 #include <random>
+#include <string>
+#include <thread>
 #include <vector>
 
 const unsigned number_of_elements = 268435456;
@@ -68,6 +84,310 @@ void RunStatistics(std::vector<double> &timings_vector, Statistics &stats)
     stats.dev = std::sqrt(primary_sq_sum / timings_vector.size() - (stats.mean * stats.mean));
 }
 
+#ifdef __linux__
+namespace
+{
+using BenchStaticRTree =
+    StaticRTree<EdgeBasedNode, ShM<FixedPointCoordinate, false>::vector, false>;
+
+// leaves every query of the sample read, in the order they were read
+using LeafTraces = std::vector<std::vector<uint32_t>>;
+
+enum class ReadMethod
+{
+    PRead,
+    MMap
+};
+
+double Percentile(const std::vector<double> &sorted_values, const double percentile)
+{
+    const std::size_t index =
+        std::min(sorted_values.size() - 1,
+                 static_cast<std::size_t>(percentile / 100. * sorted_values.size()));
+    return sorted_values[index];
+}
+
+std::vector<unsigned> ThreadCounts(const unsigned max_threads)
+{
+    std::vector<unsigned> thread_counts;
+    for (unsigned num_threads = 1; num_threads < max_threads; num_threads *= 2)
+    {
+        thread_counts.push_back(num_threads);
+    }
+    thread_counts.push_back(max_threads);
+    return thread_counts;
+}
+
+// Drops the cached pages of the file, so the next run reads from the device. Pages that another
+// process has mapped stay resident, stop osrm-routed before benchmarking its files.
+void EvictFromPageCache(const boost::filesystem::path &path)
+{
+    const int file_desc = open(path.string().c_str(), O_RDONLY);
+    if (-1 == file_desc)
+    {
+        throw osrm::exception("could not open " + path.string());
+    }
+    fdatasync(file_desc);
+    posix_fadvise(file_desc, 0, 0, POSIX_FADV_DONTNEED);
+    close(file_desc);
+}
+
+std::vector<FixedPointCoordinate> LoadCoordinates(const boost::filesystem::path &nodes_file)
+{
+    boost::filesystem::ifstream nodes_input_stream(nodes_file, std::ios::binary);
+    unsigned coordinate_count = 0;
+    nodes_input_stream.read((char *)&coordinate_count, sizeof(unsigned));
+    std::vector<FixedPointCoordinate> coordinates(coordinate_count);
+    QueryNode current_node;
+    for (auto &coordinate : coordinates)
+    {
+        nodes_input_stream.read((char *)&current_node, sizeof(QueryNode));
+        coordinate = FixedPointCoordinate(current_node.lat, current_node.lon);
+    }
+    if (!nodes_input_stream)
+    {
+        throw osrm::exception(nodes_file.string() + " is truncated");
+    }
+    return coordinates;
+}
+
+// Reads one "lat,lon" pair in degrees per line, lines that do not parse are skipped
+std::vector<FixedPointCoordinate> LoadCoordinateSample(const boost::filesystem::path &sample_file)
+{
+    boost::filesystem::ifstream sample_stream(sample_file);
+    if (!sample_stream)
+    {
+        throw osrm::exception("could not open " + sample_file.string());
+    }
+    std::vector<FixedPointCoordinate> sample;
+    std::string line;
+    while (std::getline(sample_stream, line))
+    {
+        double lat = 0, lon = 0;
+        if (2 == std::sscanf(line.c_str(), "%lf,%lf", &lat, &lon) && -90 <= lat && lat <= 90 &&
+            -180 <= lon && lon <= 180)
+        {
+            sample.emplace_back(static_cast<int>(lat * COORDINATE_PRECISION),
+                                static_cast<int>(lon * COORDINATE_PRECISION));
+        }
+    }
+    return sample;
+}
+
+// Runs the nearest neighbour query of the route requests for every coordinate and records the
+// leaves each of them reads
+LeafTraces TraceLeafReads(const std::string &base_path,
+                          const std::vector<FixedPointCoordinate> &sample)
+{
+    auto coordinates = std::make_shared<std::vector<FixedPointCoordinate>>(
+        LoadCoordinates(base_path + ".nodes"));
+    BenchStaticRTree rtree(base_path + ".ramIndex", base_path + ".fileIndex", coordinates);
+
+    LeafTraces traces(sample.size());
+    for (const auto i : osrm::irange<std::size_t>(0, sample.size()))
+    {
+        BenchStaticRTree::LeafTrace() = &traces[i];
+        std::vector<PhantomNode> phantom_nodes;
+        rtree.IncrementalFindPhantomNodeForCoordinate(sample[i], phantom_nodes, 1);
+    }
+    BenchStaticRTree::LeafTrace() = nullptr;
+    return traces;
+}
+
+// Reads the leaves of every traced query, spread over num_threads threads, and returns the time
+// each query spent reading in microseconds
+std::vector<double> ReplayLeafReads(const boost::filesystem::path &leaf_path,
+                                    const LeafTraces &traces,
+                                    const ReadMethod method,
+                                    const unsigned num_threads)
+{
+    const int file_desc = open(leaf_path.string().c_str(), O_RDONLY);
+    if (-1 == file_desc)
+    {
+        throw osrm::exception("could not open " + leaf_path.string());
+    }
+    const std::size_t file_size = boost::filesystem::file_size(leaf_path);
+    const char *mapped_file = nullptr;
+    if (ReadMethod::MMap == method)
+    {
+        void *address = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, file_desc, 0);
+        if (MAP_FAILED == address)
+        {
+            close(file_desc);
+            throw osrm::exception("could not map " + leaf_path.string());
+        }
+        // the queries hit random leaves, read ahead would only pollute the cache
+        madvise(address, file_size, MADV_RANDOM);
+        mapped_file = static_cast<const char *>(address);
+    }
+
+    const std::size_t leaf_bytes = BenchStaticRTree::LeafBytes();
+    std::vector<std::vector<double>> thread_latencies(num_threads);
+    std::atomic<bool> read_failed(false);
+    std::vector<std::thread> threads;
+    for (const auto thread_id : osrm::irange(0u, num_threads))
+    {
+        threads.emplace_back([&, thread_id]()
+                             {
+                                 std::vector<char> leaf(leaf_bytes);
+                                 auto &latencies = thread_latencies[thread_id];
+                                 for (std::size_t i = thread_id; i < traces.size();
+                                      i += num_threads)
+                                 {
+                                     const auto start = std::chrono::steady_clock::now();
+                                     for (const auto leaf_id : traces[i])
+                                     {
+                                         const auto offset =
+                                             BenchStaticRTree::LeafFileOffset(leaf_id);
+                                         if (ReadMethod::MMap == method)
+                                         {
+                                             std::memcpy(leaf.data(), mapped_file + offset,
+                                                         leaf_bytes);
+                                         }
+                                         else if (static_cast<ssize_t>(leaf_bytes) !=
+                                                  pread(file_desc, leaf.data(), leaf_bytes,
+                                                        offset))
+                                         {
+                                             read_failed = true;
+                                         }
+                                     }
+                                     const auto end = std::chrono::steady_clock::now();
+                                     latencies.push_back(
+                                         std::chrono::duration<double, std::micro>(end - start)
+                                             .count());
+                                 }
+                             });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    if (nullptr != mapped_file)
+    {
+        munmap(const_cast<char *>(mapped_file), file_size);
+    }
+    close(file_desc);
+    if (read_failed)
+    {
+        throw osrm::exception("could not read the leaves of " + leaf_path.string());
+    }
+
+    std::vector<double> latencies;
+    for (const auto &current_latencies : thread_latencies)
+    {
+        latencies.insert(latencies.end(), current_latencies.begin(), current_latencies.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+void BenchmarkLeafReads(const std::string &base_path,
+                        const boost::filesystem::path &sample_path,
+                        const unsigned max_threads)
+{
+    const auto sample = LoadCoordinateSample(sample_path);
+    if (sample.empty())
+    {
+        throw osrm::exception("coordinate sample " + sample_path.string() + " is empty");
+    }
+    const auto traces = TraceLeafReads(base_path, sample);
+    std::size_t leaf_reads = 0;
+    for (const auto &trace : traces)
+    {
+        leaf_reads += trace.size();
+    }
+    SimpleLogger().Write() << "replaying " << leaf_reads << " leaf reads of " << traces.size()
+                           << " queries, " << std::setprecision(2) << std::fixed
+                           << leaf_reads / static_cast<double>(traces.size()) << " leaves/query";
+
+    const boost::filesystem::path leaf_path(base_path + ".fileIndex");
+    for (const auto method : {ReadMethod::PRead, ReadMethod::MMap})
+    {
+        for (const unsigned num_threads : ThreadCounts(max_threads))
+        {
+            // cold: every leaf comes from the device, warm: the same reads from the page cache
+            for (const bool cold : {true, false})
+            {
+                if (cold)
+                {
+                    EvictFromPageCache(leaf_path);
+                }
+                TIMER_START(replay);
+                const auto latencies = ReplayLeafReads(leaf_path, traces, method, num_threads);
+                TIMER_STOP(replay);
+                SimpleLogger().Write()
+                    << (ReadMethod::PRead == method ? "pread" : "mmap ") << " "
+                    << (cold ? "cold" : "warm") << ", " << std::setw(3) << num_threads
+                    << " threads: " << std::setprecision(1) << std::fixed << std::setw(10)
+                    << traces.size() / TIMER_SEC(replay) << " queries/s, "
+                    << "p50 " << Percentile(latencies, 50) << "us, "
+                    << "p90 " << Percentile(latencies, 90) << "us, "
+                    << "p99 " << Percentile(latencies, 99) << "us, "
+                    << "max " << latencies.back() << "us";
+            }
+        }
+    }
+}
+
+// Reads the files osrm-datastore loads front to back in blocks of the given sizes, the way the
+// loaders fill the shared memory blocks
+void BenchmarkDatastoreLoads(const std::string &base_path)
+{
+    const std::vector<std::size_t> block_sizes = {64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    for (const std::string suffix : {".hsgr", ".nodes", ".edges", ".geometry", ".fileIndex"})
+    {
+        const boost::filesystem::path path(base_path + suffix);
+        if (!boost::filesystem::exists(path))
+        {
+            SimpleLogger().Write(logWARNING) << path.string() << " not found, skipping";
+            continue;
+        }
+        const std::size_t file_size = boost::filesystem::file_size(path);
+        for (const std::size_t block_size : block_sizes)
+        {
+            EvictFromPageCache(path);
+            const int file_desc = open(path.string().c_str(), O_RDONLY);
+            if (-1 == file_desc)
+            {
+                throw osrm::exception("could not open " + path.string());
+            }
+            posix_fadvise(file_desc, 0, 0, POSIX_FADV_SEQUENTIAL);
+            std::vector<char> block(block_size);
+            std::vector<double> latencies;
+            std::size_t offset = 0;
+            TIMER_START(load);
+            while (offset < file_size)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                const ssize_t bytes_read = pread(file_desc, block.data(), block_size, offset);
+                const auto end = std::chrono::steady_clock::now();
+                if (0 >= bytes_read)
+                {
+                    close(file_desc);
+                    throw osrm::exception("could not read " + path.string());
+                }
+                latencies.push_back(
+                    std::chrono::duration<double, std::milli>(end - start).count());
+                offset += bytes_read;
+            }
+            TIMER_STOP(load);
+            close(file_desc);
+            std::sort(latencies.begin(), latencies.end());
+
+            SimpleLogger().Write() << path.filename().string() << ", " << std::setw(5)
+                                   << block_size / 1024 << "KB blocks: " << std::setprecision(1)
+                                   << std::fixed << std::setw(8)
+                                   << file_size / (1024. * 1024.) / TIMER_SEC(load) << "MB/sec, "
+                                   << std::setprecision(3) << "p50 " << Percentile(latencies, 50)
+                                   << "ms, p99 " << Percentile(latencies, 99) << "ms, max "
+                                   << latencies.back() << "ms per block";
+        }
+    }
+}
+}
+#endif
+
 int main(int argc, char *argv[])
 {
 
@@ -89,9 +409,35 @@ int main(int argc, char *argv[])
         if (1 == argc)
         {
             SimpleLogger().Write(logWARNING) << "usage: " << argv[0] << " /path/on/device";
+            SimpleLogger().Write(logWARNING) << "       " << argv[0]
+                                             << " --dataset file.osrm coordinates.csv [threads]";
             return -1;
         }
 
+        // benchmark the reads of a prepared dataset instead of a synthetic file
+        if (std::string("--dataset") == argv[1])
+        {
+#ifdef __linux__
+            if (argc < 4)
+            {
+                SimpleLogger().Write(logWARNING)
+                    << "usage: " << argv[0] << " --dataset file.osrm coordinates.csv [threads]";
+                SimpleLogger().Write(logWARNING)
+                    << "the coordinate sample holds one lat,lon pair per line";
+                return -1;
+            }
+            const std::string base_path = argv[2];
+            const unsigned max_threads =
+                argc > 4 ? std::max(1, std::stoi(argv[4]))
+                         : std::max(1u, std::thread::hardware_concurrency());
+            BenchmarkLeafReads(base_path, argv[3], max_threads);
+            BenchmarkDatastoreLoads(base_path);
+#else
+            SimpleLogger().Write(logWARNING) << "dataset benchmarks are only supported on Linux";
+#endif
+            return 0;
+        }
+
         test_path = boost::filesystem::path(argv[1]);
         test_path /= "osrm.tst";
         SimpleLogger().Write(logDEBUG) << "temporary file: " << test_path.string();
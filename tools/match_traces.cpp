@@ -0,0 +1,169 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../library/osrm.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
+#include "../util/version.hpp"
+
+#include <osrm/libosrm_config.hpp>
+#include <osrm/route_parameters.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/program_options.hpp>
+
+#include <tbb/task_scheduler_init.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+// Matches a file of traces offline, one trace per line, see OSRM::MatchTraces
+int main(int argc, char *argv[])
+{
+    LogPolicy::GetInstance().Unmute();
+    try
+    {
+        boost::filesystem::path base_path, input_path, output_path;
+        unsigned requested_num_threads = 0;
+        libosrm_config lib_config;
+        RouteParameters route_parameters;
+
+        boost::program_options::options_description generic_options("Options");
+        generic_options.add_options()("version,v", "Show version")("help,h", "Show this help message");
+
+        boost::program_options::options_description config_options("Configuration");
+        config_options.add_options()(
+            "input,i", boost::program_options::value<boost::filesystem::path>(&input_path),
+            "Traces to match, one per line of blank separated lat,lon[,timestamp] points")(
+            "output,o", boost::program_options::value<boost::filesystem::path>(&output_path),
+            "Matchings, one /match response per line of input")(
+            "sharedmemory,s",
+            boost::program_options::value<bool>(&lib_config.use_shared_memory)
+                ->implicit_value(true)
+                ->default_value(false),
+            "Load data from shared memory")(
+            "threads,t",
+            boost::program_options::value<unsigned>(&requested_num_threads)
+                ->default_value(tbb::task_scheduler_init::default_num_threads()),
+            "Number of threads to use")(
+            "geometry",
+            boost::program_options::value<bool>(&route_parameters.geometry)
+                ->implicit_value(true)
+                ->default_value(false),
+            "Add the geometry of the matchings")(
+            "classify",
+            boost::program_options::value<bool>(&route_parameters.classify)
+                ->implicit_value(true)
+                ->default_value(false),
+            "Add the confidence of the matchings")(
+            "gps-precision",
+            boost::program_options::value<double>(&route_parameters.gps_precision)
+                ->default_value(route_parameters.gps_precision),
+            "Standard deviation of the GPS positions in meters")(
+            "matching-beta",
+            boost::program_options::value<double>(&route_parameters.matching_beta)
+                ->default_value(route_parameters.matching_beta),
+            "Scale of the transition probabilities");
+
+        boost::program_options::options_description hidden_options("Hidden options");
+        hidden_options.add_options()(
+            "base,b", boost::program_options::value<boost::filesystem::path>(&base_path),
+            "base path to .osrm file");
+
+        boost::program_options::positional_options_description positional_options;
+        positional_options.add("base", 1);
+
+        boost::program_options::options_description cmdline_options;
+        cmdline_options.add(generic_options).add(config_options).add(hidden_options);
+
+        boost::program_options::options_description visible_options(
+            boost::filesystem::basename(argv[0]) + " <base.osrm> -i <traces> -o <matchings> [options]");
+        visible_options.add(generic_options).add(config_options);
+
+        boost::program_options::variables_map option_variables;
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+                                          .options(cmdline_options)
+                                          .positional(positional_options)
+                                          .run(),
+                                      option_variables);
+        boost::program_options::notify(option_variables);
+
+        if (option_variables.count("version"))
+        {
+            SimpleLogger().Write() << OSRM_VERSION;
+            return 0;
+        }
+        if (option_variables.count("help") || !option_variables.count("input") ||
+            !option_variables.count("output") ||
+            (!lib_config.use_shared_memory && !option_variables.count("base")))
+        {
+            SimpleLogger().Write() << "\n" << visible_options;
+            return option_variables.count("help") ? 0 : 1;
+        }
+        if (!lib_config.use_shared_memory)
+        {
+            lib_config.server_paths["base"] = base_path;
+        }
+
+        boost::filesystem::ifstream input(input_path);
+        if (!input)
+        {
+            SimpleLogger().Write(logWARNING) << "cannot open " << input_path.string();
+            return 1;
+        }
+        boost::filesystem::ofstream output(output_path);
+        if (!output)
+        {
+            SimpleLogger().Write(logWARNING) << "cannot open " << output_path.string();
+            return 1;
+        }
+
+        const unsigned number_of_threads =
+            std::max(1u, std::min(requested_num_threads,
+                                  static_cast<unsigned>(
+                                      tbb::task_scheduler_init::default_num_threads())));
+        tbb::task_scheduler_init init(number_of_threads);
+        SimpleLogger().Write() << "starting up engines, " << OSRM_VERSION << ", threads: "
+                               << number_of_threads;
+        OSRM routing_machine(lib_config);
+
+        TIMER_START(matching);
+        const unsigned number_of_traces =
+            routing_machine.MatchTraces(input, output, route_parameters);
+        TIMER_STOP(matching);
+        SimpleLogger().Write() << "matched " << number_of_traces << " traces in "
+                               << TIMER_SEC(matching) << "s";
+    }
+    catch (std::exception &current_exception)
+    {
+        SimpleLogger().Write(logWARNING) << "caught exception: " << current_exception.what();
+        return 1;
+    }
+    return 0;
+}
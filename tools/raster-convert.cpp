@@ -0,0 +1,81 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+#include "../data_structures/percent.hpp"
+#include "../data_structures/raster_source.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/osrm_exception.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <exception>
+#include <string>
+
+// Converts an ASCII grid raster into the tiled format that the profiles map instead of parsing
+int main(int argc, char *argv[])
+{
+    LogPolicy::GetInstance().Unmute();
+    try
+    {
+        if (argc != 5 && argc != 6)
+        {
+            SimpleLogger().Write(logWARNING)
+                << "usage: " << argv[0] << " <input.asc> <ncols> <nrows> <output> [tile size]";
+            return 1;
+        }
+
+        const boost::filesystem::path input_path(argv[1]);
+        const auto ncols = boost::lexical_cast<std::size_t>(argv[2]);
+        const auto nrows = boost::lexical_cast<std::size_t>(argv[3]);
+        const boost::filesystem::path output_path(argv[4]);
+        const auto tile_size = argc == 6 ? boost::lexical_cast<std::size_t>(argv[5])
+                                         : TiledRasterFile::default_tile_size;
+
+        if (!boost::filesystem::is_regular_file(input_path))
+        {
+            SimpleLogger().Write(logWARNING) << "Input file " << input_path.string()
+                                             << " not found!";
+            return 1;
+        }
+        if (0 == ncols || 0 == nrows || 0 == tile_size)
+        {
+            SimpleLogger().Write(logWARNING) << "dimensions and tile size must be positive";
+            return 1;
+        }
+
+        SimpleLogger().Write() << "converting " << input_path.string() << " with " << ncols
+                               << "x" << nrows << " values in tiles of " << tile_size;
+        TiledRasterFile::Write(input_path, ncols, nrows, output_path, tile_size);
+        SimpleLogger().Write() << "written " << output_path.string();
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "[exception] " << e.what();
+        return 1;
+    }
+    return 0;
+}
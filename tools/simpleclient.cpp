@@ -36,20 +36,45 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <osrm/route_parameters.hpp>
 
 #include <string>
+#include <vector>
 
 int main(int argc, const char *argv[])
 {
     LogPolicy::GetInstance().Unmute();
     try
     {
-        std::string ip_address;
-        int ip_port, requested_thread_num, max_locations_map_matching;
+        std::string ip_address, unix_socket_path;
+        int ip_port, http2_port, requested_thread_num, max_locations_map_matching,
+            keepalive_timeout, keepalive_max_requests, request_timeout, access_log_sampling,
+            response_cache_size, gzip_level, brotli_quality, zstd_level;
+        std::string compression_dictionary;
+        std::vector<std::string> service_limits;
         bool trial_run = false;
+        bool io_service_per_thread = false;
+        bool pin_threads = false;
         libosrm_config lib_config;
         const unsigned init_result = GenerateServerProgramOptions(
-            argc, argv, lib_config.server_paths, ip_address, ip_port, requested_thread_num,
+            argc, argv, lib_config.server_paths, ip_address, ip_port, http2_port,
+            unix_socket_path,
+            requested_thread_num,
             lib_config.use_shared_memory, trial_run, lib_config.max_locations_distance_table,
-            max_locations_map_matching);
+            max_locations_map_matching, lib_config.max_locations_target_set,
+            lib_config.max_batch_routes, lib_config.max_isochrone_time,
+            lib_config.max_matching_sessions,
+            lib_config.matching_session_ttl, keepalive_timeout, keepalive_max_requests,
+            request_timeout, io_service_per_thread, pin_threads, access_log_sampling,
+            service_limits,
+            response_cache_size, gzip_level, brotli_quality, zstd_level, compression_dictionary,
+            lib_config.phantom_node_cache_size, lib_config.shortcut_cache_size,
+            lib_config.trip_cache_size, lib_config.parallel_snapping_threshold,
+            lib_config.max_request_memory, lib_config.max_total_request_memory,
+            lib_config.dense_query_heaps, lib_config.compact_query_graph,
+            lib_config.split_query_graph,
+            lib_config.parallel_bidirectional_search, lib_config.parallel_leg_search,
+            lib_config.approximate_alternatives, lib_config.prefetch_search_graph,
+            lib_config.verify_image, lib_config.locked_image_blocks,
+            lib_config.warm_up_dataset, lib_config.warm_up_queries,
+            lib_config.datasets);
 
         if (init_result == INIT_OK_DO_NOT_START_ENGINE)
         {
@@ -52,6 +52,12 @@ void delete_region(const SharedDataType region)
                 return "DATA_2";
             case LAYOUT_NONE:
                 return "LAYOUT_NONE";
+            case STATIC_1:
+                return "STATIC_1";
+            case STATIC_2:
+                return "STATIC_2";
+            case STATIC_NONE:
+                return "STATIC_NONE";
             default: // DATA_NONE:
                 return "DATA_NONE";
             }
@@ -69,6 +75,8 @@ void springclean()
     delete_region(LAYOUT_1);
     delete_region(DATA_2);
     delete_region(LAYOUT_2);
+    delete_region(STATIC_1);
+    delete_region(STATIC_2);
     delete_region(CURRENT_REGIONS);
 }
 
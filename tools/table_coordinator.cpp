@@ -0,0 +1,683 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../util/osrm_exception.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/table_tiles.hpp"
+#include "../util/timing_util.hpp"
+#include "../util/version.hpp"
+
+#include <boost/asio.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Serves large /table requests with a set of osrm-routed backends of the same dataset. A table
+// is split into tiles of sources and destinations, the backends compute the tiles in parallel
+// and the tiles are merged into the reply. Failed tiles are retried on another backend. All
+// other requests, and tables that fit into a single tile, go to one of the backends unchanged.
+namespace
+{
+
+struct CoordinatorOptions
+{
+    unsigned tile_size;
+    unsigned connections_per_backend;
+    unsigned retries;
+    unsigned timeout;
+};
+
+// an osrm-routed instance, with a limit on the tile requests that it gets at once
+class Backend
+{
+  public:
+    Backend(std::string host, std::string port, const unsigned connections)
+        : host(std::move(host)), port(std::move(port)), free_connections(connections)
+    {
+    }
+
+    void Acquire()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [this]
+                      {
+                          return free_connections > 0;
+                      });
+        --free_connections;
+    }
+
+    void Release()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++free_connections;
+        }
+        released.notify_one();
+    }
+
+    std::string Name() const { return host + ":" + port; }
+
+    const std::string host;
+    const std::string port;
+
+  private:
+    unsigned free_connections;
+    std::mutex mutex;
+    std::condition_variable released;
+};
+
+struct HttpReply
+{
+    int status;
+    // the raw reply as it is forwarded to clients
+    std::string message;
+    std::size_t body_offset;
+
+    std::string Body() const { return message.substr(body_offset); }
+};
+
+// Posts a request to a backend and reads the reply until the backend closes the connection.
+// Throws if the backend can't be reached, the reply is malformed or takes longer than timeout.
+HttpReply Exchange(const Backend &backend,
+                   const std::string &target,
+                   const std::string &content_type,
+                   const std::string &body,
+                   const unsigned timeout)
+{
+    boost::asio::io_service io_service;
+    boost::asio::ip::tcp::resolver resolver(io_service);
+    boost::asio::ip::tcp::socket socket(io_service);
+    boost::asio::ip::tcp::resolver::query query(backend.host, backend.port);
+    const boost::asio::ip::tcp::resolver::iterator endpoints = resolver.resolve(query);
+
+    const std::string head = "POST " + target + " HTTP/1.0\r\nHost: " + backend.host +
+                             "\r\nContent-Type: " + content_type + "\r\nContent-Length: " +
+                             std::to_string(body.size()) + "\r\n\r\n";
+    const std::vector<boost::asio::const_buffer> request = {boost::asio::buffer(head),
+                                                            boost::asio::buffer(body)};
+    boost::asio::streambuf response;
+
+    // the synchronous calls can't time out, the timer closes the socket instead
+    bool timed_out = false;
+    boost::system::error_code result;
+    boost::asio::deadline_timer timer(io_service, boost::posix_time::seconds(timeout));
+    timer.async_wait([&](const boost::system::error_code &error)
+                     {
+                         if (!error)
+                         {
+                             timed_out = true;
+                             boost::system::error_code ignore_error;
+                             socket.close(ignore_error);
+                         }
+                     });
+    const auto finish = [&](const boost::system::error_code &error)
+    {
+        result = error;
+        timer.cancel();
+    };
+    boost::asio::async_connect(
+        socket, endpoints,
+        [&](const boost::system::error_code &error, boost::asio::ip::tcp::resolver::iterator)
+        {
+            if (error)
+            {
+                return finish(error);
+            }
+            boost::asio::async_write(
+                socket, request, [&](const boost::system::error_code &error, std::size_t)
+                {
+                    if (error)
+                    {
+                        return finish(error);
+                    }
+                    boost::asio::async_read(socket, response,
+                                            [&](const boost::system::error_code &error,
+                                                std::size_t)
+                                            {
+                                                finish(error);
+                                            });
+                });
+        });
+    io_service.run();
+
+    if (timed_out)
+    {
+        throw osrm::exception(backend.Name() + " timed out");
+    }
+    if (boost::asio::error::eof != result)
+    {
+        throw osrm::exception(backend.Name() + ": " + result.message());
+    }
+    HttpReply reply;
+    reply.message.assign(boost::asio::buffers_begin(response.data()),
+                         boost::asio::buffers_end(response.data()));
+    const std::size_t head_end = reply.message.find("\r\n\r\n");
+    if (0 != reply.message.compare(0, 5, "HTTP/") || std::string::npos == head_end ||
+        std::string::npos == reply.message.find(' '))
+    {
+        throw osrm::exception(backend.Name() + " sent a malformed reply");
+    }
+    reply.status = std::atoi(reply.message.c_str() + reply.message.find(' ') + 1);
+    reply.body_offset = head_end + 4;
+    return reply;
+}
+
+std::string MakeReply(const int status,
+                      const std::string &status_text,
+                      const std::string &content_type,
+                      const std::string &content)
+{
+    return "HTTP/1.0 " + std::to_string(status) + " " + status_text + "\r\nContent-Type: " +
+           content_type + "\r\nContent-Length: " + std::to_string(content.size()) +
+           "\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n" + content;
+}
+
+std::string MakeErrorReply(const int status, const std::string &status_text)
+{
+    return MakeReply(status, status_text, "application/json; charset=UTF-8",
+                     "{\"status\": " + std::to_string(status) + ",\"status_message\":\"" +
+                         status_text + "\"}");
+}
+
+class Coordinator
+{
+  public:
+    Coordinator(std::vector<std::unique_ptr<Backend>> backends, const CoordinatorOptions options)
+        : backends(std::move(backends)), options(options), next_backend(0)
+    {
+    }
+
+    // the backends have to serve the same dataset, or the tiles wouldn't fit together
+    void CheckDatasets() const
+    {
+        std::string first_check_sum;
+        for (const auto &backend : backends)
+        {
+            const auto reply = Exchange(*backend, "/timestamp", "application/x-www-form-urlencoded",
+                                        "", options.timeout);
+            const std::string body = reply.Body();
+            const std::string key = "\"check_sum\":";
+            const std::size_t position = body.find(key);
+            if (200 != reply.status || std::string::npos == position)
+            {
+                throw osrm::exception(backend->Name() + " does not report its dataset checksum");
+            }
+            const std::string check_sum =
+                std::to_string(std::strtoul(body.c_str() + position + key.size(), nullptr, 10));
+            SimpleLogger().Write() << "backend " << backend->Name() << ", dataset checksum "
+                                   << check_sum;
+            if (first_check_sum.empty())
+            {
+                first_check_sum = check_sum;
+            }
+            else if (first_check_sum != check_sum)
+            {
+                throw osrm::exception(backend->Name() + " serves another dataset");
+            }
+        }
+    }
+
+    // the whole reply to a request of a client
+    std::string Handle(const std::string &method,
+                       const std::string &target,
+                       const std::string &content_type,
+                       const std::string &body)
+    {
+        const std::size_t query_begin = target.find('?');
+        const std::string path = target.substr(0, query_begin);
+        const bool is_form = content_type.empty() ||
+                             std::string::npos != content_type.find("x-www-form-urlencoded");
+        // coordinates in the body of a post are left to the backends
+        if ("POST" == method && !is_form)
+        {
+            return Forward(target, content_type, body);
+        }
+        std::string query =
+            std::string::npos == query_begin ? std::string() : target.substr(query_begin + 1);
+        if ("POST" == method && !body.empty())
+        {
+            query += (query.empty() ? "" : "&") + body;
+        }
+
+        osrm::table_tiles::TableQuery table_query;
+        if ("/table" == path && osrm::table_tiles::ParseTableQuery(query, table_query) &&
+            (table_query.sources.size() > options.tile_size ||
+             table_query.destinations.size() > options.tile_size))
+        {
+            return ComputeTable(table_query);
+        }
+        return Forward(path, "application/x-www-form-urlencoded", query);
+    }
+
+  private:
+    struct PendingTile
+    {
+        std::size_t index;
+        unsigned attempts;
+        // the backend that failed last, the tile is retried on another one
+        std::size_t failed_backend;
+    };
+
+    // the state of the tiles of one table, shared by the threads that request them
+    struct TableJob
+    {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<PendingTile> pending_tiles;
+        std::size_t unfinished_tiles;
+        // the reply to the client if a tile failed for good
+        std::string failure;
+    };
+
+    Backend &PickBackend() { return *backends[next_backend++ % backends.size()]; }
+
+    // a request that isn't split up, retried on the next backend if it fails
+    std::string Forward(const std::string &target,
+                        const std::string &content_type,
+                        const std::string &body)
+    {
+        for (unsigned attempt = 0; attempt <= options.retries; ++attempt)
+        {
+            Backend &backend = PickBackend();
+            try
+            {
+                const auto reply = Exchange(backend, target, content_type, body, options.timeout);
+                if (reply.status < 500 || attempt == options.retries)
+                {
+                    return reply.message;
+                }
+                SimpleLogger().Write(logWARNING) << backend.Name() << " failed with status "
+                                                 << reply.status;
+            }
+            catch (const std::exception &e)
+            {
+                SimpleLogger().Write(logWARNING) << e.what();
+            }
+        }
+        return MakeErrorReply(502, "Bad Gateway");
+    }
+
+    std::string ComputeTable(const osrm::table_tiles::TableQuery &table_query)
+    {
+        TIMER_START(table);
+        const auto number_of_rows = static_cast<unsigned>(table_query.sources.size());
+        const auto number_of_columns = static_cast<unsigned>(table_query.destinations.size());
+        const auto tiles =
+            osrm::table_tiles::MakeTiles(number_of_rows, number_of_columns, options.tile_size);
+        std::vector<EdgeWeight> durations(std::size_t(number_of_rows) * number_of_columns);
+        std::vector<EdgeWeight> lengths(table_query.lengths ? durations.size() : 0);
+
+        TableJob job;
+        job.unfinished_tiles = tiles.size();
+        for (std::size_t i = 0; i < tiles.size(); ++i)
+        {
+            job.pending_tiles.push_back({i, 0, backends.size()});
+        }
+
+        // the tiles are written into disjoint parts of the tables
+        const auto request_tiles = [&](const std::size_t backend_index)
+        {
+            Backend &backend = *backends[backend_index];
+            std::unique_lock<std::mutex> lock(job.mutex);
+            for (;;)
+            {
+                auto tile_iter = job.pending_tiles.end();
+                job.changed.wait(lock, [&]
+                                 {
+                                     tile_iter = std::find_if(
+                                         job.pending_tiles.begin(), job.pending_tiles.end(),
+                                         [&](const PendingTile &tile)
+                                         {
+                                             return backends.size() == 1 ||
+                                                    tile.failed_backend != backend_index;
+                                         });
+                                     return !job.failure.empty() || 0 == job.unfinished_tiles ||
+                                            job.pending_tiles.end() != tile_iter;
+                                 });
+                if (!job.failure.empty() || 0 == job.unfinished_tiles)
+                {
+                    return;
+                }
+                PendingTile pending_tile = *tile_iter;
+                job.pending_tiles.erase(tile_iter);
+                lock.unlock();
+
+                const auto &tile = tiles[pending_tile.index];
+                std::string error;
+                std::string rejection;
+                backend.Acquire();
+                try
+                {
+                    const auto reply =
+                        Exchange(backend, "/table", "application/x-www-form-urlencoded",
+                                 osrm::table_tiles::TileQuery(table_query, tile), options.timeout);
+                    const std::string body = reply.Body();
+                    std::size_t offset = 0;
+                    if (400 == reply.status)
+                    {
+                        // the same query would fail on every backend
+                        rejection = reply.message;
+                    }
+                    else if (200 != reply.status)
+                    {
+                        error = "status " + std::to_string(reply.status);
+                    }
+                    else if (!osrm::table_tiles::ReadTile(body, offset, tile, number_of_columns,
+                                                          durations) ||
+                             (table_query.lengths &&
+                              !osrm::table_tiles::ReadTile(body, offset, tile,
+                                                           number_of_columns, lengths)))
+                    {
+                        error = "a malformed tile";
+                    }
+                }
+                catch (const std::exception &e)
+                {
+                    error = e.what();
+                }
+                backend.Release();
+
+                lock.lock();
+                if (!rejection.empty())
+                {
+                    job.failure = rejection;
+                }
+                else if (error.empty())
+                {
+                    --job.unfinished_tiles;
+                }
+                else if (++pending_tile.attempts > options.retries)
+                {
+                    SimpleLogger().Write(logWARNING) << "giving up a tile after " << error;
+                    job.failure = MakeErrorReply(502, "Bad Gateway");
+                }
+                else
+                {
+                    SimpleLogger().Write(logWARNING) << backend.Name() << " failed a tile with "
+                                                     << error << ", retrying";
+                    pending_tile.failed_backend = backend_index;
+                    job.pending_tiles.push_back(pending_tile);
+                }
+                job.changed.notify_all();
+            }
+        };
+
+        // every backend gets a thread, so that each tile can be retried elsewhere
+        const std::size_t threads_per_backend = std::max<std::size_t>(
+            1, std::min<std::size_t>(options.connections_per_backend,
+                                     (tiles.size() + backends.size() - 1) / backends.size()));
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < threads_per_backend * backends.size(); ++i)
+        {
+            threads.emplace_back(request_tiles, i % backends.size());
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+        if (!job.failure.empty())
+        {
+            return job.failure;
+        }
+
+        std::string content;
+        std::string content_type;
+        if (table_query.matrix_output)
+        {
+            osrm::json::matrix_render(content, number_of_rows, number_of_columns, durations);
+            if (table_query.lengths)
+            {
+                osrm::json::matrix_render(content, number_of_rows, number_of_columns, lengths);
+            }
+            content_type = "application/octet-stream";
+        }
+        else
+        {
+            content = "{\"distance_table\":";
+            osrm::table_tiles::RenderTable(content, durations, number_of_rows, number_of_columns);
+            if (table_query.lengths)
+            {
+                content += ",\"length_table\":";
+                osrm::table_tiles::RenderTable(content, lengths, number_of_rows,
+                                               number_of_columns);
+            }
+            content.push_back('}');
+            content_type = "application/json; charset=UTF-8";
+        }
+        TIMER_STOP(table);
+        SimpleLogger().Write() << "table of " << number_of_rows << "x" << number_of_columns
+                               << " in " << tiles.size() << " tiles, " << TIMER_MSEC(table)
+                               << "ms";
+        return MakeReply(200, "OK", content_type, content);
+    }
+
+    const std::vector<std::unique_ptr<Backend>> backends;
+    const CoordinatorOptions options;
+    std::atomic<std::size_t> next_backend;
+};
+
+// reads a request of a client, headers and body, returns false if it is malformed
+bool ReadRequest(boost::asio::ip::tcp::socket &socket,
+                 std::string &method,
+                 std::string &target,
+                 std::string &content_type,
+                 std::string &body)
+{
+    boost::asio::streambuf buffer;
+    const std::size_t head_size = boost::asio::read_until(socket, buffer, "\r\n\r\n");
+    const std::string data(boost::asio::buffers_begin(buffer.data()),
+                           boost::asio::buffers_end(buffer.data()));
+    const std::string head = data.substr(0, head_size);
+
+    const std::size_t method_end = head.find(' ');
+    const std::size_t target_end = head.find(' ', method_end + 1);
+    if (std::string::npos == method_end || std::string::npos == target_end)
+    {
+        return false;
+    }
+    method = head.substr(0, method_end);
+    target = head.substr(method_end + 1, target_end - method_end - 1);
+
+    std::size_t content_length = 0;
+    std::size_t line_begin = head.find("\r\n") + 2;
+    while (line_begin < head.size())
+    {
+        const std::size_t line_end = head.find("\r\n", line_begin);
+        const std::string line = head.substr(line_begin, line_end - line_begin);
+        line_begin = line_end + 2;
+        const std::size_t colon = line.find(':');
+        if (std::string::npos == colon)
+        {
+            continue;
+        }
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        const std::size_t value_begin = line.find_first_not_of(' ', colon + 1);
+        const std::string value =
+            std::string::npos == value_begin ? std::string() : line.substr(value_begin);
+        if ("content-length" == name)
+        {
+            content_length = std::strtoul(value.c_str(), nullptr, 10);
+        }
+        else if ("content-type" == name)
+        {
+            content_type = value;
+        }
+    }
+
+    body = data.substr(head_size);
+    if (body.size() < content_length)
+    {
+        std::vector<char> rest(content_length - body.size());
+        boost::asio::read(socket, boost::asio::buffer(rest));
+        body.append(rest.begin(), rest.end());
+    }
+    body.resize(content_length);
+    return true;
+}
+
+void ServeClient(Coordinator &coordinator, boost::asio::ip::tcp::socket &socket)
+{
+    try
+    {
+        std::string method, target, content_type, body;
+        const std::string reply = ReadRequest(socket, method, target, content_type, body)
+                                      ? coordinator.Handle(method, target, content_type, body)
+                                      : MakeErrorReply(400, "Bad Request");
+        boost::asio::write(socket, boost::asio::buffer(reply));
+        boost::system::error_code ignore_error;
+        socket.shutdown(boost::asio::socket_base::shutdown_both, ignore_error);
+    }
+    catch (const std::exception &e)
+    {
+        SimpleLogger().Write(logWARNING) << "client: " << e.what();
+    }
+}
+}
+
+int main(int argc, char *argv[])
+{
+    LogPolicy::GetInstance().Unmute();
+    try
+    {
+        std::string ip_address;
+        int ip_port = 0;
+        std::vector<std::string> backend_addresses;
+        CoordinatorOptions options;
+
+        boost::program_options::options_description generic_options("Options");
+        generic_options.add_options()("version,v", "Show version")("help,h", "Show this help message");
+
+        boost::program_options::options_description config_options("Configuration");
+        config_options.add_options()(
+            "ip,i",
+            boost::program_options::value<std::string>(&ip_address)->default_value("0.0.0.0"),
+            "IP address")(
+            "port,p", boost::program_options::value<int>(&ip_port)->default_value(5100),
+            "TCP/IP port")(
+            "backend",
+            boost::program_options::value<std::vector<std::string>>(&backend_addresses)
+                ->composing(),
+            "osrm-routed instance as <host>:<port>, all of them with the same dataset")(
+            "tile-size",
+            boost::program_options::value<unsigned>(&options.tile_size)->default_value(100),
+            "Number of sources and destinations of a tile, at most the --max-table-size of the "
+            "backends")(
+            "connections",
+            boost::program_options::value<unsigned>(&options.connections_per_backend)
+                ->default_value(4),
+            "Number of tiles a backend computes at once, up to its number of threads")(
+            "retries", boost::program_options::value<unsigned>(&options.retries)->default_value(3),
+            "Number of times a failed tile is retried on another backend")(
+            "timeout", boost::program_options::value<unsigned>(&options.timeout)->default_value(60),
+            "Seconds a backend may take for a tile");
+
+        boost::program_options::options_description visible_options(
+            boost::filesystem::basename(argv[0]) + " --backend <host>:<port> ... [options]");
+        visible_options.add(generic_options).add(config_options);
+
+        boost::program_options::variables_map option_variables;
+        boost::program_options::store(
+            boost::program_options::command_line_parser(argc, argv).options(visible_options).run(),
+            option_variables);
+        boost::program_options::notify(option_variables);
+
+        if (option_variables.count("version"))
+        {
+            SimpleLogger().Write() << OSRM_VERSION;
+            return 0;
+        }
+        if (option_variables.count("help") || backend_addresses.empty())
+        {
+            SimpleLogger().Write() << "\n" << visible_options;
+            return option_variables.count("help") ? 0 : 1;
+        }
+        if (0 == options.tile_size || 0 == options.connections_per_backend ||
+            0 == options.timeout)
+        {
+            SimpleLogger().Write(logWARNING)
+                << "tile-size, connections and timeout must be positive";
+            return 1;
+        }
+
+        std::vector<std::unique_ptr<Backend>> backends;
+        for (const auto &address : backend_addresses)
+        {
+            const std::size_t colon = address.rfind(':');
+            if (std::string::npos == colon || 0 == colon || address.size() == colon + 1)
+            {
+                SimpleLogger().Write(logWARNING) << "invalid backend " << address;
+                return 1;
+            }
+            backends.emplace_back(new Backend(address.substr(0, colon),
+                                              address.substr(colon + 1),
+                                              options.connections_per_backend));
+        }
+        Coordinator coordinator(std::move(backends), options);
+        coordinator.CheckDatasets();
+
+        boost::asio::io_service io_service;
+        boost::asio::ip::tcp::resolver resolver(io_service);
+        boost::asio::ip::tcp::resolver::query query(ip_address, std::to_string(ip_port));
+        const boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve(query);
+        boost::asio::ip::tcp::acceptor acceptor(io_service);
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+        acceptor.bind(endpoint);
+        acceptor.listen();
+        SimpleLogger().Write() << "coordinating " << backend_addresses.size()
+                               << " backends on " << ip_address << ":" << ip_port << ", "
+                               << OSRM_VERSION;
+
+        // clients are few gateways with large tables, each connection gets its own thread
+        for (;;)
+        {
+            auto socket = std::make_shared<boost::asio::ip::tcp::socket>(io_service);
+            acceptor.accept(*socket);
+            std::thread([&coordinator, socket]
+                        {
+                            ServeClient(coordinator, *socket);
+                        }).detach();
+        }
+    }
+    catch (const std::exception &current_exception)
+    {
+        SimpleLogger().Write(logWARNING) << "caught exception: " << current_exception.what();
+        return 1;
+    }
+}
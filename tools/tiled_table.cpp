@@ -0,0 +1,221 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../library/osrm.hpp"
+#include "../util/matrix_renderer.hpp"
+#include "../util/simple_logger.hpp"
+#include "../util/timing_util.hpp"
+#include "../util/version.hpp"
+
+#include <osrm/coordinate.hpp>
+#include <osrm/libosrm_config.hpp>
+#include <osrm/query_results.hpp>
+#include <osrm/route_parameters.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/program_options.hpp>
+
+#include <tbb/task_scheduler_init.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Computes the table between all locations of a file offline in tiles of columns, see
+// OSRM::RunTiledTableQuery. Every tile is written as a matrix of all rows and the columns of
+// the tile, see util/matrix_renderer.hpp, with the matrix of its lengths behind it if these
+// are asked for. The tiles follow each other in the order of their columns.
+int main(int argc, char *argv[])
+{
+    LogPolicy::GetInstance().Unmute();
+    try
+    {
+        boost::filesystem::path base_path, input_path, output_path;
+        unsigned requested_num_threads = 0;
+        unsigned columns_per_tile = 0;
+        libosrm_config lib_config;
+        RouteParameters route_parameters;
+
+        boost::program_options::options_description generic_options("Options");
+        generic_options.add_options()("version,v", "Show version")("help,h", "Show this help message");
+
+        boost::program_options::options_description config_options("Configuration");
+        config_options.add_options()(
+            "input,i", boost::program_options::value<boost::filesystem::path>(&input_path),
+            "Locations of the table, one lat,lon per line")(
+            "output,o", boost::program_options::value<boost::filesystem::path>(&output_path),
+            "Tiles of the table")(
+            "tile-size",
+            boost::program_options::value<unsigned>(&columns_per_tile)->default_value(1000),
+            "Number of columns of a tile")(
+            "sharedmemory,s",
+            boost::program_options::value<bool>(&lib_config.use_shared_memory)
+                ->implicit_value(true)
+                ->default_value(false),
+            "Load data from shared memory")(
+            "threads,t",
+            boost::program_options::value<unsigned>(&requested_num_threads)
+                ->default_value(tbb::task_scheduler_init::default_num_threads()),
+            "Number of threads to use")(
+            "lengths",
+            boost::program_options::value<bool>(&route_parameters.lengths)
+                ->implicit_value(true)
+                ->default_value(false),
+            "Add the lengths of the fastest paths");
+
+        boost::program_options::options_description hidden_options("Hidden options");
+        hidden_options.add_options()(
+            "base,b", boost::program_options::value<boost::filesystem::path>(&base_path),
+            "base path to .osrm file");
+
+        boost::program_options::positional_options_description positional_options;
+        positional_options.add("base", 1);
+
+        boost::program_options::options_description cmdline_options;
+        cmdline_options.add(generic_options).add(config_options).add(hidden_options);
+
+        boost::program_options::options_description visible_options(
+            boost::filesystem::basename(argv[0]) + " <base.osrm> -i <locations> -o <tiles> [options]");
+        visible_options.add(generic_options).add(config_options);
+
+        boost::program_options::variables_map option_variables;
+        boost::program_options::store(boost::program_options::command_line_parser(argc, argv)
+                                          .options(cmdline_options)
+                                          .positional(positional_options)
+                                          .run(),
+                                      option_variables);
+        boost::program_options::notify(option_variables);
+
+        if (option_variables.count("version"))
+        {
+            SimpleLogger().Write() << OSRM_VERSION;
+            return 0;
+        }
+        if (option_variables.count("help") || !option_variables.count("input") ||
+            !option_variables.count("output") ||
+            (!lib_config.use_shared_memory && !option_variables.count("base")))
+        {
+            SimpleLogger().Write() << "\n" << visible_options;
+            return option_variables.count("help") ? 0 : 1;
+        }
+        if (0 == columns_per_tile)
+        {
+            SimpleLogger().Write(logWARNING) << "tile-size must be positive";
+            return 1;
+        }
+        if (!lib_config.use_shared_memory)
+        {
+            lib_config.server_paths["base"] = base_path;
+        }
+
+        boost::filesystem::ifstream input(input_path);
+        if (!input)
+        {
+            SimpleLogger().Write(logWARNING) << "cannot open " << input_path.string();
+            return 1;
+        }
+        route_parameters.service = "table";
+        std::string line;
+        unsigned line_number = 0;
+        while (std::getline(input, line))
+        {
+            ++line_number;
+            const char *position = line.c_str();
+            char *end = nullptr;
+            const double lat = std::strtod(position, &end);
+            if (position == end || ',' != *end)
+            {
+                SimpleLogger().Write(logWARNING) << "invalid location in line " << line_number;
+                return 1;
+            }
+            position = end + 1;
+            const double lon = std::strtod(position, &end);
+            if (position == end)
+            {
+                SimpleLogger().Write(logWARNING) << "invalid location in line " << line_number;
+                return 1;
+            }
+            route_parameters.coordinates.emplace_back(static_cast<int>(COORDINATE_PRECISION * lat),
+                                                      static_cast<int>(COORDINATE_PRECISION * lon));
+        }
+
+        boost::filesystem::ofstream output(output_path, std::ios::binary);
+        if (!output)
+        {
+            SimpleLogger().Write(logWARNING) << "cannot open " << output_path.string();
+            return 1;
+        }
+
+        const unsigned number_of_threads =
+            std::max(1u, std::min(requested_num_threads,
+                                  static_cast<unsigned>(
+                                      tbb::task_scheduler_init::default_num_threads())));
+        tbb::task_scheduler_init init(number_of_threads);
+        SimpleLogger().Write() << "starting up engines, " << OSRM_VERSION << ", threads: "
+                               << number_of_threads;
+        OSRM routing_machine(lib_config);
+
+        TIMER_START(table);
+        unsigned number_of_tiles = 0;
+        std::string rendered_tile;
+        const int status = routing_machine.RunTiledTableQuery(
+            route_parameters, columns_per_tile, [&](osrm::TableResult &tile)
+            {
+                rendered_tile.clear();
+                osrm::json::matrix_render(rendered_tile, tile.number_of_rows,
+                                          tile.number_of_columns, tile.durations);
+                if (route_parameters.lengths)
+                {
+                    osrm::json::matrix_render(rendered_tile, tile.number_of_rows,
+                                              tile.number_of_columns, tile.lengths);
+                }
+                output.write(rendered_tile.data(), rendered_tile.size());
+                ++number_of_tiles;
+                SimpleLogger().Write() << "tile " << number_of_tiles << " up to column "
+                                       << tile.first_column + tile.number_of_columns;
+            });
+        TIMER_STOP(table);
+        if (200 != status)
+        {
+            SimpleLogger().Write(logWARNING) << "table query failed with status " << status;
+            return 1;
+        }
+        output.flush();
+        SimpleLogger().Write() << "computed " << number_of_tiles << " tiles of "
+                               << route_parameters.coordinates.size() << " locations in "
+                               << TIMER_SEC(table) << "s";
+    }
+    catch (std::exception &current_exception)
+    {
+        SimpleLogger().Write(logWARNING) << "caught exception: " << current_exception.what();
+        return 1;
+    }
+    return 0;
+}
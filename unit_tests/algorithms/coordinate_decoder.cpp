@@ -0,0 +1,140 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../util/coordinate_decoder.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <osrm/coordinate.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(coordinate_decoder)
+
+namespace
+{
+void append_little_endian(std::string &out, const std::uint32_t value)
+{
+    out.push_back(static_cast<char>(value & 0xff));
+    out.push_back(static_cast<char>((value >> 8) & 0xff));
+    out.push_back(static_cast<char>((value >> 16) & 0xff));
+    out.push_back(static_cast<char>((value >> 24) & 0xff));
+}
+
+std::string encode_header(const std::uint32_t number_of_coordinates, const std::uint32_t flags)
+{
+    std::string body = "OCRD";
+    append_little_endian(body, osrm::CoordinateDecoder::VERSION);
+    append_little_endian(body, number_of_coordinates);
+    append_little_endian(body, flags);
+    return body;
+}
+}
+
+BOOST_AUTO_TEST_CASE(decode_coordinates_timestamps_and_hints)
+{
+    std::string body = encode_header(
+        2, osrm::CoordinateDecoder::HAS_TIMESTAMPS | osrm::CoordinateDecoder::HAS_HINTS);
+    append_little_endian(body, 52520008);
+    append_little_endian(body, 13404954);
+    append_little_endian(body, static_cast<std::uint32_t>(-33868820));
+    append_little_endian(body, static_cast<std::uint32_t>(-151209296));
+    append_little_endian(body, 1000);
+    append_little_endian(body, 1015);
+    append_little_endian(body, 3);
+    body.append("abc");
+    append_little_endian(body, 0);
+
+    std::vector<FixedPointCoordinate> coordinates;
+    std::vector<unsigned> timestamps;
+    std::vector<std::string> hints;
+    BOOST_REQUIRE(osrm::coordinate_decode(body, coordinates, timestamps, hints));
+
+    BOOST_REQUIRE_EQUAL(coordinates.size(), 2u);
+    BOOST_CHECK_EQUAL(coordinates[0].lat, 52520008);
+    BOOST_CHECK_EQUAL(coordinates[0].lon, 13404954);
+    BOOST_CHECK_EQUAL(coordinates[1].lat, -33868820);
+    BOOST_CHECK_EQUAL(coordinates[1].lon, -151209296);
+    BOOST_REQUIRE_EQUAL(timestamps.size(), 2u);
+    BOOST_CHECK_EQUAL(timestamps[0], 1000u);
+    BOOST_CHECK_EQUAL(timestamps[1], 1015u);
+    BOOST_REQUIRE_EQUAL(hints.size(), 2u);
+    BOOST_CHECK_EQUAL(hints[0], "abc");
+    BOOST_CHECK(hints[1].empty());
+}
+
+BOOST_AUTO_TEST_CASE(coordinates_only)
+{
+    std::string body = encode_header(1, 0);
+    append_little_endian(body, 1);
+    append_little_endian(body, 2);
+
+    std::vector<FixedPointCoordinate> coordinates;
+    std::vector<unsigned> timestamps;
+    std::vector<std::string> hints;
+    BOOST_REQUIRE(osrm::coordinate_decode(body, coordinates, timestamps, hints));
+    BOOST_CHECK_EQUAL(coordinates.size(), 1u);
+    BOOST_CHECK(timestamps.empty());
+    BOOST_CHECK(hints.empty());
+}
+
+BOOST_AUTO_TEST_CASE(reject_malformed_bodies)
+{
+    std::vector<FixedPointCoordinate> coordinates;
+    std::vector<unsigned> timestamps;
+    std::vector<std::string> hints;
+
+    std::string complete = encode_header(2, osrm::CoordinateDecoder::HAS_HINTS);
+    for (const std::uint32_t value : {1u, 2u, 3u, 4u, 1u})
+    {
+        append_little_endian(complete, value);
+    }
+    complete.push_back('x');
+    append_little_endian(complete, 0);
+    BOOST_CHECK(osrm::coordinate_decode(complete, coordinates, timestamps, hints));
+
+    // every truncation of a valid body is malformed, and so are trailing bytes
+    for (std::size_t length = 0; length < complete.size(); ++length)
+    {
+        BOOST_CHECK(!osrm::coordinate_decode(complete.substr(0, length), coordinates,
+                                             timestamps, hints));
+    }
+    BOOST_CHECK(!osrm::coordinate_decode(complete + "y", coordinates, timestamps, hints));
+
+    std::string wrong_magic = complete;
+    wrong_magic[0] = 'X';
+    BOOST_CHECK(!osrm::coordinate_decode(wrong_magic, coordinates, timestamps, hints));
+
+    // unknown flags and counts beyond the body size
+    BOOST_CHECK(!osrm::coordinate_decode(encode_header(0, 4), coordinates, timestamps, hints));
+    BOOST_CHECK(
+        !osrm::coordinate_decode(encode_header(0x7fffffff, 0), coordinates, timestamps, hints));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
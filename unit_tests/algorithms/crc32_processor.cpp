@@ -0,0 +1,109 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../algorithms/crc32_processor.hpp"
+
+#include <boost/crc.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <list>
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(crc32_processor)
+
+// CRC32C without inversions, the parameters of the hardware instruction
+using ReferenceCRC32 = boost::crc_optimal<32, 0x1EDC6F41, 0x0, 0x0, true, true>;
+
+BOOST_AUTO_TEST_CASE(matches_reference_at_all_lengths)
+{
+    std::mt19937 generator(5);
+    // lengths around the interleaved lanes and the parallel chunks
+    std::vector<char> data((3 << 20) + 17);
+    for (auto &byte : data)
+    {
+        byte = static_cast<char>(generator());
+    }
+
+    const IteratorbasedCRC32 crc32;
+    for (const std::size_t length :
+         {0ul, 1ul, 7ul, 8ul, 9ul, 12287ul, 12288ul, 12289ul, (2ul << 20) - 1, 2ul << 20,
+          static_cast<unsigned long>(data.size())})
+    {
+        ReferenceCRC32 reference;
+        reference.process_bytes(data.data(), length);
+        BOOST_CHECK_EQUAL(crc32.checksum(data.data(), length), reference.checksum());
+
+        // non-contiguous ranges are checksummed element by element
+        const std::list<char> list(data.begin(), data.begin() + length);
+        BOOST_CHECK_EQUAL(crc32(list.begin(), list.end()), reference.checksum());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(combined_checksums)
+{
+    std::mt19937 generator(7);
+    std::vector<char> data(100000);
+    for (auto &byte : data)
+    {
+        byte = static_cast<char>(generator());
+    }
+
+    const IteratorbasedCRC32 crc32;
+    const unsigned whole = crc32.checksum(data.data(), data.size());
+    for (const std::size_t split : {0ul, 1ul, 4096ul, 99999ul, 100000ul})
+    {
+        const unsigned first = crc32.checksum(data.data(), split);
+        const unsigned second = crc32.checksum(data.data() + split, data.size() - split);
+        BOOST_CHECK_EQUAL(IteratorbasedCRC32::combine(first, second, data.size() - split), whole);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ranges_of_records)
+{
+    struct Record
+    {
+        std::uint32_t id;
+        std::uint16_t weight;
+        std::uint16_t flags;
+    };
+    std::vector<Record> records(1000);
+    for (unsigned i = 0; i < records.size(); ++i)
+    {
+        records[i] = {i, static_cast<std::uint16_t>(i * 7), static_cast<std::uint16_t>(i % 3)};
+    }
+
+    ReferenceCRC32 reference;
+    reference.process_bytes(records.data(), records.size() * sizeof(Record));
+    RangebasedCRC32 crc32;
+    BOOST_CHECK_EQUAL(crc32(records), reference.checksum());
+    const std::list<Record> list(records.begin(), records.end());
+    BOOST_CHECK_EQUAL(crc32(list), reference.checksum());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -27,12 +27,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../../algorithms/douglas_peucker.hpp"
 #include "../../data_structures/segment_information.hpp"
+#include "../../util/integer_range.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/test_case_template.hpp>
 
 #include <osrm/coordinate.hpp>
 
+#include <cstdint>
+#include <random>
 #include <vector>
 
 BOOST_AUTO_TEST_SUITE(douglas_peucker)
@@ -101,4 +104,43 @@ BOOST_AUTO_TEST_CASE(remove_second_node_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(zoom_levels_match_run_test)
+{
+    std::mt19937 generator(23);
+    // steps of about 1m to 1km, so that every zoom level drops some points
+    std::uniform_int_distribution<int> step_distribution(-10000, 10000);
+    DouglasPeucker dp;
+    for (unsigned round = 0; round < 20; ++round)
+    {
+        std::vector<FixedPointCoordinate> geometry;
+        FixedPointCoordinate current(52 * COORDINATE_PRECISION, 13 * COORDINATE_PRECISION);
+        for (unsigned i = 0; i < 200; ++i)
+        {
+            current.lat += step_distribution(generator);
+            current.lon += step_distribution(generator);
+            geometry.push_back(current);
+        }
+
+        std::vector<std::uint8_t> zoom_levels;
+        DouglasPeucker::ComputeZoomLevels(geometry, zoom_levels);
+        BOOST_REQUIRE_EQUAL(zoom_levels.size(), geometry.size());
+        BOOST_CHECK_EQUAL(zoom_levels.front(), 0);
+        BOOST_CHECK_EQUAL(zoom_levels.back(), 0);
+
+        for (unsigned z = 0; z < DOUGLAS_PEUCKER_THRESHOLDS.size(); z++)
+        {
+            std::vector<SegmentInformation> info;
+            for (const auto &coordinate : geometry)
+            {
+                info.push_back(getTestInfo(coordinate.lat, coordinate.lon, false));
+            }
+            dp.Run(info, z);
+            for (const auto i : osrm::irange<std::size_t>(0, info.size()))
+            {
+                BOOST_CHECK_EQUAL(info[i].necessary, zoom_levels[i] <= z);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
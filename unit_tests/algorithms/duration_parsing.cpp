@@ -61,4 +61,23 @@ BOOST_AUTO_TEST_CASE(iso_8601_durations_case_insensitive)
     BOOST_CHECK_EQUAL(parseDuration("PT1h15m"), 4500);
 }
 
+BOOST_AUTO_TEST_CASE(malformed_durations_are_rejected)
+{
+    BOOST_CHECK_EQUAL(durationIsValid(""), false);
+    BOOST_CHECK_EQUAL(durationIsValid("123"), false);
+    BOOST_CHECK_EQUAL(durationIsValid("01:"), false);
+    BOOST_CHECK_EQUAL(durationIsValid("01:02:03:04"), false);
+    BOOST_CHECK_EQUAL(durationIsValid("PT"), false);
+    BOOST_CHECK_EQUAL(durationIsValid("pt15M"), false);
+    BOOST_CHECK_EQUAL(parseDuration("1 hour"), std::numeric_limits<unsigned>::max());
+}
+
+BOOST_AUTO_TEST_CASE(iso_8601_durations_keep_grammar_semantics)
+{
+    // out of range components are dropped, later ones out of order end the duration
+    BOOST_CHECK_EQUAL(parseDuration("PT25H10M"), 600);
+    BOOST_CHECK_EQUAL(parseDuration("PT5M3H"), 300);
+    BOOST_CHECK_EQUAL(parseDuration("PT0S"), std::numeric_limits<unsigned>::max());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
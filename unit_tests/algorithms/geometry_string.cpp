@@ -30,10 +30,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "../../algorithms/polyline_compressor.hpp"
 #include "../../algorithms/coordinate_calculation.hpp"
+#include "../../data_structures/segment_information.hpp"
 
 #include <osrm/coordinate.hpp>
 
 #include <cmath>
+#include <string>
 #include <vector>
 
 BOOST_AUTO_TEST_CASE(geometry_string)
@@ -72,3 +74,35 @@ BOOST_AUTO_TEST_CASE(geometry_string)
         BOOST_CHECK_CLOSE(cmp1_lon, cmp2_lon, 0.0001);
     }
 }
+
+BOOST_AUTO_TEST_CASE(encode_into_buffer)
+{
+    std::vector<SegmentInformation> polyline;
+    const FixedPointCoordinate coordinates[] = {
+        {10000000, 10000000}, {10010000, 10100000}, {-10020000, 10200000}, {-10020000, -179999999}};
+    for (const auto &coordinate : coordinates)
+    {
+        polyline.emplace_back(coordinate, 0, 0, 0, TurnInstruction::HeadOn, true, false, 0);
+    }
+    // points that are not necessary are left out
+    polyline.emplace(polyline.begin() + 1, FixedPointCoordinate(5, 5), 0, 0, 0,
+                     TurnInstruction::HeadOn, false, false, 0);
+
+    PolylineCompressor pc;
+    const std::string encoded_polyline = pc.get_encoded_string(polyline);
+    const auto decoded_coordinates = pc.decode_string(encoded_polyline);
+    BOOST_REQUIRE_EQUAL(decoded_coordinates.size(), 4);
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        BOOST_CHECK_EQUAL(decoded_coordinates[i].lat, coordinates[i].lat);
+        BOOST_CHECK_EQUAL(decoded_coordinates[i].lon, coordinates[i].lon);
+    }
+
+    // the encoding is appended to what the buffer already holds
+    std::string buffer = "prefix";
+    pc.encode_into(polyline, buffer);
+    BOOST_CHECK_EQUAL(buffer, "prefix" + encoded_polyline);
+
+    pc.encode_into({}, buffer);
+    BOOST_CHECK_EQUAL(buffer, "prefix" + encoded_polyline);
+}
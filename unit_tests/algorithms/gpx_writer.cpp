@@ -0,0 +1,89 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../algorithms/coordinate_calculation.hpp"
+#include "../../util/xml_renderer.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <osrm/coordinate.hpp>
+#include <osrm/json_container.hpp>
+
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(gpx_writer)
+
+BOOST_AUTO_TEST_CASE(matches_document_tree)
+{
+    const std::vector<FixedPointCoordinate> coordinates = {
+        {52520008, 13404954}, {-33868820, -151209296}, {0, 5}};
+
+    std::string streamed;
+    osrm::json::GPXRouteWriter writer(streamed, coordinates.size());
+    for (const auto &coordinate : coordinates)
+    {
+        writer.AddRoutePoint(coordinate);
+    }
+    writer.Finish();
+
+    // the document tree the descriptor used to build
+    osrm::json::Array json_route;
+    for (const auto &coordinate : coordinates)
+    {
+        osrm::json::Object json_lat, json_lon, entry;
+        osrm::json::Array json_row;
+        std::string text;
+        coordinate_calculation::lat_or_lon_to_string(coordinate.lat, text);
+        json_lat.values.emplace("_lat", osrm::json::String(text));
+        coordinate_calculation::lat_or_lon_to_string(coordinate.lon, text);
+        json_lon.values.emplace("_lon", osrm::json::String(text));
+        json_row.values.push_back(json_lat);
+        json_row.values.push_back(json_lon);
+        entry.values.emplace("rtept", json_row);
+        json_route.values.push_back(entry);
+    }
+    std::vector<char> rendered;
+    osrm::json::gpx_render(rendered, json_route);
+
+    BOOST_CHECK_EQUAL(streamed, std::string(rendered.begin(), rendered.end()));
+    BOOST_CHECK(streamed.find("<rtept lat=\"-33.868820\" lon=\"-151.209296\"/>") !=
+                std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(empty_route)
+{
+    std::string streamed;
+    osrm::json::GPXRouteWriter writer(streamed);
+    writer.Finish();
+
+    std::vector<char> rendered;
+    osrm::json::gpx_render(rendered, osrm::json::Array());
+    BOOST_CHECK_EQUAL(streamed, std::string(rendered.begin(), rendered.end()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
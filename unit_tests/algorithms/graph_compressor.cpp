@@ -4,11 +4,16 @@
 #include "../../data_structures/node_based_graph.hpp"
 #include "../../contractor/speed_profile.hpp"
 #include "../../typedefs.h"
+#include "../../util/integer_range.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/test_case_template.hpp>
 
+#include <algorithm>
 #include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
 
 BOOST_AUTO_TEST_SUITE(graph_compressor)
 
@@ -210,4 +215,127 @@ BOOST_AUTO_TEST_CASE(direction_changes)
     BOOST_CHECK(graph.FindEdge(1, 2) != SPECIAL_EDGEID);
 }
 
+BOOST_AUTO_TEST_CASE(parallel_compression)
+{
+    // hubs connected by chains of random length, some of them in parallel or next to a
+    // direct edge between their hubs, plus an isolated loop
+    std::mt19937 generator(42);
+    const auto random = [&generator](const unsigned limit)
+    {
+        return std::uniform_int_distribution<unsigned>(0, limit - 1)(generator);
+    };
+
+    const unsigned number_of_hubs = 8;
+    unsigned number_of_nodes = number_of_hubs;
+    std::vector<std::vector<NodeID>> paths;
+    for (const auto i : osrm::irange(0u, 60u))
+    {
+        (void)i;
+        const NodeID first_hub = random(number_of_hubs);
+        const NodeID last_hub = (first_hub + 1 + random(number_of_hubs - 1)) % number_of_hubs;
+        std::vector<NodeID> path(1, first_hub);
+        for (unsigned length = random(7); length > 0; --length)
+        {
+            path.push_back(number_of_nodes++);
+        }
+        path.push_back(last_hub);
+        paths.push_back(path);
+    }
+    std::vector<NodeID> loop(1, number_of_nodes);
+    for (const auto i : osrm::irange(1u, 6u))
+    {
+        loop.push_back(number_of_nodes + i);
+    }
+    number_of_nodes += 6;
+    loop.push_back(loop.front());
+    paths.push_back(loop);
+
+    // shuffle the ids, Compress visits the nodes by id
+    std::vector<NodeID> permutation(number_of_nodes);
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::shuffle(permutation.begin(), permutation.end(), generator);
+
+    using InputEdge = NodeBasedDynamicGraph::InputEdge;
+    std::vector<InputEdge> edges;
+    std::set<std::pair<NodeID, NodeID>> segments;
+    for (const auto &path : paths)
+    {
+        for (const auto i : osrm::irange<std::size_t>(1, path.size()))
+        {
+            const NodeID source = permutation[path[i - 1]];
+            const NodeID target = permutation[path[i]];
+            if (!segments.emplace(std::min(source, target), std::max(source, target)).second)
+            {
+                continue;
+            }
+            const int distance = 1 + random(10);
+            const unsigned name_id = random(10) == 0;
+            const bool is_oneway = random(10) == 0;
+            edges.emplace_back(source, target, distance, SPECIAL_EDGEID, name_id, false, false,
+                               false, TRAVEL_MODE_DEFAULT);
+            edges.emplace_back(target, source, distance, SPECIAL_EDGEID, name_id, false,
+                               is_oneway, false, TRAVEL_MODE_DEFAULT);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    std::unordered_set<NodeID> barrier_nodes;
+    std::unordered_set<NodeID> traffic_lights;
+    for (const auto node : osrm::irange(number_of_hubs, number_of_nodes))
+    {
+        if (random(20) == 0)
+        {
+            barrier_nodes.insert(permutation[node]);
+        }
+        else if (random(10) == 0)
+        {
+            traffic_lights.insert(permutation[node]);
+        }
+    }
+
+    SpeedProfileProperties speed_profile;
+    speed_profile.traffic_signal_penalty = 20;
+    GraphCompressor compressor(speed_profile);
+
+    RestrictionMap sequential_map;
+    CompressedEdgeContainer sequential_container;
+    NodeBasedDynamicGraph sequential_graph(number_of_nodes, edges);
+    compressor.Compress(barrier_nodes, traffic_lights, sequential_map, sequential_graph,
+                        sequential_container);
+
+    RestrictionMap parallel_map;
+    CompressedEdgeContainer parallel_container;
+    NodeBasedDynamicGraph parallel_graph(number_of_nodes, edges);
+    compressor.CompressParallel(barrier_nodes, traffic_lights, parallel_map, parallel_graph,
+                                parallel_container);
+
+    BOOST_CHECK_EQUAL(sequential_graph.GetNumberOfEdges(), parallel_graph.GetNumberOfEdges());
+    BOOST_CHECK_LT(sequential_graph.GetNumberOfEdges(), edges.size());
+    for (const auto node : osrm::irange(0u, number_of_nodes))
+    {
+        BOOST_REQUIRE_EQUAL(sequential_graph.GetOutDegree(node),
+                            parallel_graph.GetOutDegree(node));
+        for (const auto edge : sequential_graph.GetAdjacentEdgeRange(node))
+        {
+            BOOST_CHECK_EQUAL(sequential_graph.GetTarget(edge), parallel_graph.GetTarget(edge));
+            BOOST_CHECK_EQUAL(sequential_graph.GetEdgeData(edge).distance,
+                              parallel_graph.GetEdgeData(edge).distance);
+            BOOST_REQUIRE_EQUAL(sequential_container.HasEntryForID(edge),
+                                parallel_container.HasEntryForID(edge));
+            if (!sequential_container.HasEntryForID(edge))
+            {
+                continue;
+            }
+
+            const auto sequential_bucket = sequential_container.GetBucketReference(edge);
+            const auto parallel_bucket = parallel_container.GetBucketReference(edge);
+            BOOST_REQUIRE_EQUAL(sequential_bucket.size(), parallel_bucket.size());
+            for (const auto i : osrm::irange<std::size_t>(0, sequential_bucket.size()))
+            {
+                BOOST_CHECK_EQUAL(sequential_bucket[i].first, parallel_bucket[i].first);
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
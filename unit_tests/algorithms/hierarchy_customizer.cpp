@@ -0,0 +1,240 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../algorithms/hierarchy_customizer.hpp"
+#include "../../data_structures/query_edge.hpp"
+#include "../../data_structures/static_graph.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(hierarchy_customizer)
+
+using QueryGraph = StaticGraph<QueryEdge::EdgeData>;
+
+constexpr unsigned NUM_NODES = 40;
+
+struct Arc
+{
+    NodeID source;
+    NodeID target;
+    EdgeWeight weight;
+};
+
+// Contracts the nodes in the order of their ids without witness searches. Every shortcut
+// a -> b via m is kept, so the hierarchy answers all queries exactly for any weights.
+std::vector<QueryEdge> ContractInIdOrder(const std::vector<Arc> &arcs)
+{
+    std::vector<QueryEdge> edges;
+    const auto add_edge = [&edges](const NodeID from, const NodeID to, const EdgeWeight weight,
+                                   const NodeID id, const bool shortcut)
+    {
+        QueryEdge edge;
+        edge.source = std::min(from, to);
+        edge.target = std::max(from, to);
+        edge.data.distance = weight;
+        edge.data.id = id;
+        edge.data.shortcut = shortcut;
+        edge.data.forward = from < to;
+        edge.data.backward = from > to;
+        edges.push_back(edge);
+    };
+
+    // (from, to) pairs of the remaining graph
+    std::set<std::pair<NodeID, NodeID>> remaining_arcs;
+    for (const auto arc_id : osrm::irange<NodeID>(0, arcs.size()))
+    {
+        add_edge(arcs[arc_id].source, arcs[arc_id].target, arcs[arc_id].weight, arc_id, false);
+        remaining_arcs.emplace(arcs[arc_id].source, arcs[arc_id].target);
+    }
+    for (const auto node : osrm::irange(0u, NUM_NODES))
+    {
+        std::vector<NodeID> in_nodes, out_nodes;
+        for (const auto &arc : remaining_arcs)
+        {
+            if (arc.second == node && arc.first > node)
+            {
+                in_nodes.push_back(arc.first);
+            }
+            if (arc.first == node && arc.second > node)
+            {
+                out_nodes.push_back(arc.second);
+            }
+        }
+        for (const auto from : in_nodes)
+        {
+            for (const auto to : out_nodes)
+            {
+                if (from != to)
+                {
+                    // the weight is only set by the customization
+                    add_edge(from, to, 0, node, true);
+                    remaining_arcs.emplace(from, to);
+                }
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    return edges;
+}
+
+std::vector<EdgeWeight> BellmanFord(const std::vector<Arc> &arcs, const NodeID source)
+{
+    std::vector<EdgeWeight> distances(NUM_NODES, INVALID_EDGE_WEIGHT);
+    distances[source] = 0;
+    for (unsigned round = 0; round < NUM_NODES; ++round)
+    {
+        for (const auto &arc : arcs)
+        {
+            if (INVALID_EDGE_WEIGHT != distances[arc.source] &&
+                distances[arc.source] + arc.weight < distances[arc.target])
+            {
+                distances[arc.target] = distances[arc.source] + arc.weight;
+            }
+        }
+    }
+    return distances;
+}
+
+// distances of the upward search from source, forward or backward
+std::vector<EdgeWeight>
+UpwardDistances(const QueryGraph &graph, const NodeID source, const bool forward)
+{
+    std::vector<EdgeWeight> distances(NUM_NODES, INVALID_EDGE_WEIGHT);
+    distances[source] = 0;
+    // edges point to higher ids, so the ids are a topological order of the upward graph
+    for (const auto node : osrm::irange(source, NUM_NODES))
+    {
+        if (INVALID_EDGE_WEIGHT == distances[node])
+        {
+            continue;
+        }
+        for (const auto edge : graph.GetAdjacentEdgeRange(node))
+        {
+            const auto &data = graph.GetEdgeData(edge);
+            const NodeID target = graph.GetTarget(edge);
+            if ((forward ? data.forward : data.backward) &&
+                distances[node] + data.distance < distances[target])
+            {
+                distances[target] = distances[node] + data.distance;
+            }
+        }
+    }
+    return distances;
+}
+
+BOOST_AUTO_TEST_CASE(queries_match_dijkstra_after_reweighting)
+{
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<unsigned> node_distribution(0, NUM_NODES - 1);
+    std::uniform_int_distribution<int> weight_distribution(1, 100);
+
+    std::vector<Arc> arcs;
+    std::set<std::pair<NodeID, NodeID>> seen;
+    while (arcs.size() < 3 * NUM_NODES)
+    {
+        const NodeID source = node_distribution(generator);
+        const NodeID target = node_distribution(generator);
+        if (source != target && seen.emplace(source, target).second)
+        {
+            arcs.push_back({source, target, weight_distribution(generator)});
+        }
+    }
+
+    std::vector<QueryEdge> edges = ContractInIdOrder(arcs);
+    QueryGraph graph(NUM_NODES, edges);
+
+    for (unsigned customization = 0; customization < 3; ++customization)
+    {
+        for (auto &arc : arcs)
+        {
+            arc.weight = weight_distribution(generator);
+        }
+        for (const auto edge : osrm::irange(0u, graph.GetNumberOfEdges()))
+        {
+            auto &data = graph.GetEdgeData(edge);
+            if (!data.shortcut)
+            {
+                data.distance = arcs[data.id].weight;
+            }
+        }
+
+        HierarchyCustomizer<QueryGraph> customizer(graph);
+        BOOST_CHECK_GT(customizer.Run(), 0u);
+
+        for (const auto source : osrm::irange(0u, NUM_NODES))
+        {
+            const auto expected = BellmanFord(arcs, source);
+            const auto forward = UpwardDistances(graph, source, true);
+            for (const auto target : osrm::irange(0u, NUM_NODES))
+            {
+                const auto backward = UpwardDistances(graph, target, false);
+                EdgeWeight distance = INVALID_EDGE_WEIGHT;
+                for (const auto node : osrm::irange(0u, NUM_NODES))
+                {
+                    if (INVALID_EDGE_WEIGHT != forward[node] &&
+                        INVALID_EDGE_WEIGHT != backward[node])
+                    {
+                        distance = std::min(distance, forward[node] + backward[node]);
+                    }
+                }
+                BOOST_CHECK_EQUAL(distance, expected[target]);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bidirectional_shortcuts_are_rejected)
+{
+    // 1 <-> 0 <-> 2, contracting 0 adds the shortcut 1 <-> 2 in both directions at once
+    std::vector<QueryEdge> edges(3);
+    edges[0].source = 0;
+    edges[0].target = 1;
+    edges[1].source = 0;
+    edges[1].target = 2;
+    edges[2].source = 1;
+    edges[2].target = 2;
+    for (auto &edge : edges)
+    {
+        edge.data.distance = 1;
+        edge.data.forward = edge.data.backward = true;
+    }
+    edges[2].data.shortcut = true;
+    edges[2].data.id = 0;
+    QueryGraph graph(3, edges);
+
+    HierarchyCustomizer<QueryGraph> customizer(graph);
+    BOOST_CHECK_THROW(customizer.Run(), osrm::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
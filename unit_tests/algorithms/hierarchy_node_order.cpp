@@ -0,0 +1,87 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../algorithms/hierarchy_node_order.hpp"
+#include "../../data_structures/query_edge.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(hierarchy_node_order)
+
+BOOST_AUTO_TEST_CASE(orders_by_level_and_key)
+{
+    const std::vector<float> node_levels = {0, 2, 1, 2, 0, std::numeric_limits<float>::max()};
+    const std::vector<std::uint64_t> spatial_keys = {5, 7, 1, 3, 5, 9};
+    const std::vector<NodeID> new_id_from_old_id =
+        ComputeHierarchyNodeOrder(node_levels, spatial_keys);
+
+    // the core comes first, then the levels from the top down, ties go by key and old id
+    const std::vector<NodeID> expected = {4, 2, 3, 1, 5, 0};
+    BOOST_CHECK_EQUAL_COLLECTIONS(new_id_from_old_id.begin(), new_id_from_old_id.end(),
+                                  expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(renumbers_edges_and_values)
+{
+    const std::vector<NodeID> new_id_from_old_id = {2, 0, 1};
+
+    std::vector<QueryEdge> edges(2);
+    edges[0].source = 0;
+    edges[0].target = 2;
+    edges[0].data.shortcut = true;
+    edges[0].data.id = 1;
+    edges[1].source = 1;
+    edges[1].target = 2;
+    edges[1].data.shortcut = false;
+    edges[1].data.id = 42;
+    RenumberHierarchyEdges(new_id_from_old_id, edges);
+
+    BOOST_CHECK_EQUAL(edges[0].source, 2);
+    BOOST_CHECK_EQUAL(edges[0].target, 1);
+    BOOST_CHECK_EQUAL(edges[0].data.id, 0);
+    BOOST_CHECK_EQUAL(edges[1].source, 0);
+    BOOST_CHECK_EQUAL(edges[1].target, 1);
+    // original edges refer to edge-based edges, not to nodes
+    BOOST_CHECK_EQUAL(edges[1].data.id, 42);
+
+    std::vector<bool> is_core_node = {true, false, false};
+    RenumberNodeValues(new_id_from_old_id, is_core_node);
+    BOOST_CHECK(!is_core_node[0]);
+    BOOST_CHECK(!is_core_node[1]);
+    BOOST_CHECK(is_core_node[2]);
+
+    std::vector<bool> no_core;
+    RenumberNodeValues(new_id_from_old_id, no_core);
+    BOOST_CHECK(no_core.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
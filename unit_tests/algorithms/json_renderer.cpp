@@ -0,0 +1,80 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../util/json_renderer.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(json_renderer)
+
+BOOST_AUTO_TEST_CASE(number_formatting)
+{
+    const std::vector<double> values = {0.,        -0.,     1.,          -1.,    100.,
+                                        1234567.,  0.5,     -0.5,        3.14159265,
+                                        1e-7,      -1e-7,   123456.7891, 1e20,   -4.25e14};
+    for (const auto value : values)
+    {
+        char buffer[64];
+        const auto length = osrm::json::detail::format_number(value, buffer);
+        BOOST_CHECK_EQUAL(std::string(buffer, length), cast::to_string_with_precision(value));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stream_and_array_renderers_agree)
+{
+    osrm::json::Object object;
+    object.values.emplace("name", osrm::json::String("Aleja \"Solidarnosci\"/\n"));
+    object.values.emplace("number", osrm::json::Number(4.5));
+    osrm::json::Array array;
+    array.values.push_back(osrm::json::Number(1));
+    array.values.push_back(osrm::json::True());
+    array.values.push_back(osrm::json::False());
+    array.values.push_back(osrm::json::Null());
+    object.values.emplace("array", array);
+
+    std::vector<char> array_output;
+    osrm::json::render(array_output, object);
+
+    std::stringstream stream_output;
+    osrm::json::render(stream_output, object);
+
+    BOOST_CHECK_EQUAL(std::string(array_output.begin(), array_output.end()),
+                      stream_output.str());
+
+    osrm::json::Object single;
+    single.values.emplace("array", array);
+    array_output.clear();
+    osrm::json::render(array_output, single);
+    BOOST_CHECK_EQUAL(std::string(array_output.begin(), array_output.end()),
+                      "{\"array\":[1,true,false,null]}");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../util/matrix_renderer.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(matrix_renderer)
+
+BOOST_AUTO_TEST_CASE(encode_header_and_entries)
+{
+    const std::vector<EdgeWeight> table = {0, 1, 300, -2, INVALID_EDGE_WEIGHT, 70000};
+
+    std::string output;
+    osrm::json::matrix_render(output, 2, 3, table);
+
+    BOOST_REQUIRE_EQUAL(output.size(), 16u + 6u * 4u);
+    BOOST_CHECK_EQUAL(output.substr(0, 4), "OTBL");
+
+    const std::vector<unsigned char> expected_header = {1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0};
+    for (std::size_t i = 0; i < expected_header.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(static_cast<unsigned char>(output[4 + i]), expected_header[i]);
+    }
+
+    const std::vector<unsigned char> expected_entries = {
+        0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x2c, 0x01, 0x00, 0x00,
+        0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f, 0x70, 0x11, 0x01, 0x00};
+    for (std::size_t i = 0; i < expected_entries.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(static_cast<unsigned char>(output[16 + i]), expected_entries[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(entries_copy_out_at_once)
+{
+    std::vector<EdgeWeight> table(50);
+    for (std::size_t i = 0; i < table.size(); ++i)
+    {
+        table[i] = static_cast<EdgeWeight>(i * i) - 100;
+    }
+
+    std::string output;
+    osrm::json::matrix_render(output, 5, 10, table);
+
+    // what a reader on a little-endian machine does, big-endian ones need to swap the bytes
+    std::uint32_t header[4];
+    std::memcpy(header, output.data(), sizeof(header));
+    if (header[0] != osrm::json::MatrixRenderer::MAGIC)
+    {
+        return;
+    }
+    BOOST_CHECK_EQUAL(header[2] * header[3], table.size());
+    std::vector<EdgeWeight> decoded(table.size());
+    std::memcpy(decoded.data(), output.data() + sizeof(header),
+                decoded.size() * sizeof(EdgeWeight));
+    BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), table.begin(), table.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
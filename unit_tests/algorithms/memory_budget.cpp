@@ -0,0 +1,117 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../util/memory_budget.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(memory_budget)
+
+BOOST_AUTO_TEST_CASE(request_limit)
+{
+    auto &global = osrm::memory::Global();
+    const auto global_in_use = global.in_use.load();
+    {
+        osrm::MemoryBudget budget(1000);
+        budget.Charge(600);
+        budget.Charge(400);
+        BOOST_CHECK_EQUAL(budget.InUse(), 1000);
+        BOOST_CHECK_EQUAL(global.in_use.load(), global_in_use + 1000);
+
+        try
+        {
+            budget.Charge(1);
+            BOOST_ERROR("charge over the limit did not throw");
+        }
+        catch (const osrm::memory_budget_exceeded &e)
+        {
+            BOOST_CHECK(!e.global);
+        }
+        // the rejected charge is not kept
+        BOOST_CHECK_EQUAL(budget.InUse(), 1000);
+        BOOST_CHECK(budget.Exceeded());
+        BOOST_CHECK(!budget.ExceededGlobally());
+
+        budget.Release(500);
+        budget.Charge(100);
+        BOOST_CHECK_EQUAL(budget.InUse(), 600);
+        BOOST_CHECK_EQUAL(budget.Peak(), 1000);
+    }
+    // whatever is still charged is returned with the budget
+    BOOST_CHECK_EQUAL(global.in_use.load(), global_in_use);
+}
+
+BOOST_AUTO_TEST_CASE(global_limit)
+{
+    auto &global = osrm::memory::Global();
+    const auto global_in_use = global.in_use.load();
+    const auto rejected = global.rejected.load();
+    global.limit = global_in_use + 1000;
+    {
+        osrm::MemoryBudget first(0), second(0);
+        first.Charge(800);
+        BOOST_CHECK_THROW(second.Charge(300), osrm::memory_budget_exceeded);
+        BOOST_CHECK(second.ExceededGlobally());
+        BOOST_CHECK_EQUAL(second.InUse(), 0);
+        BOOST_CHECK_EQUAL(global.rejected.load(), rejected + 1);
+        first.Release(800);
+        second.Charge(300);
+    }
+    global.limit = 0;
+    BOOST_CHECK_EQUAL(global.in_use.load(), global_in_use);
+}
+
+BOOST_AUTO_TEST_CASE(scope_and_reservation)
+{
+    BOOST_CHECK(nullptr == osrm::memory::Current());
+    // without a budget the charges are no-ops
+    osrm::memory::Charge(1 << 30);
+    {
+        const osrm::memory::Reservation reservation(1 << 30);
+    }
+
+    osrm::MemoryBudget budget(100);
+    {
+        const osrm::memory::Scope scope(&budget);
+        BOOST_CHECK(&budget == osrm::memory::Current());
+        osrm::memory::Charge(10);
+        {
+            osrm::memory::Reservation reservation(20);
+            reservation.Add(30);
+            BOOST_CHECK_EQUAL(budget.InUse(), 60);
+            BOOST_CHECK_THROW(reservation.Add(50), osrm::memory_budget_exceeded);
+        }
+        BOOST_CHECK_EQUAL(budget.InUse(), 10);
+        osrm::memory::Release(10);
+    }
+    BOOST_CHECK(nullptr == osrm::memory::Current());
+    BOOST_CHECK_EQUAL(budget.InUse(), 0);
+    BOOST_CHECK_EQUAL(budget.Peak(), 60);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
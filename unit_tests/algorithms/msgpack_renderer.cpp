@@ -0,0 +1,84 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../util/msgpack_renderer.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(msgpack_renderer)
+
+BOOST_AUTO_TEST_CASE(encode_scalars)
+{
+    osrm::json::Object object;
+    osrm::json::Array array;
+    array.values.push_back(osrm::json::Number(1));
+    array.values.push_back(osrm::json::Number(-1));
+    array.values.push_back(osrm::json::Number(300));
+    array.values.push_back(osrm::json::Number(-200));
+    array.values.push_back(osrm::json::True());
+    array.values.push_back(osrm::json::Null());
+    array.values.push_back(osrm::json::String("ab"));
+    array.values.push_back(osrm::json::Number(0.5));
+    object.values.emplace("a", array);
+
+    std::vector<char> output;
+    osrm::json::msgpack_render(output, object);
+
+    const std::vector<unsigned char> expected = {
+        0x81, 0xa1, 'a',  0x98, 0x01, 0xff, 0xcd, 0x01, 0x2c, 0xd1, 0xff, 0x38, 0xc3,
+        0xc0, 0xa2, 'a',  'b',  0xcb, 0x3f, 0xe0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    BOOST_REQUIRE_EQUAL(output.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(static_cast<unsigned char>(output[i]), expected[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(encode_large_containers)
+{
+    osrm::json::Object object;
+    osrm::json::Array array;
+    for (unsigned i = 0; i < 20; ++i)
+    {
+        array.values.push_back(osrm::json::Number(i));
+    }
+    object.values.emplace("b", array);
+
+    std::vector<char> output;
+    osrm::json::msgpack_render(output, object);
+
+    // fixmap, fixstr key, array16 header with 20 elements
+    BOOST_REQUIRE_EQUAL(output.size(), 3u + 3u + 20u);
+    BOOST_CHECK_EQUAL(static_cast<unsigned char>(output[3]), 0xdc);
+    BOOST_CHECK_EQUAL(static_cast<unsigned char>(output[4]), 0x00);
+    BOOST_CHECK_EQUAL(static_cast<unsigned char>(output[5]), 20);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
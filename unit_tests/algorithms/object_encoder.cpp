@@ -0,0 +1,116 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../algorithms/object_encoder.hpp"
+#include "../../data_structures/phantom_node.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <array>
+#include <string>
+
+BOOST_AUTO_TEST_SUITE(object_encoder)
+
+BOOST_AUTO_TEST_CASE(url_safe_alphabet)
+{
+    const std::array<unsigned char, 5> bytes = {{0xfb, 0xff, 0xbf, 0x00, 0x10}};
+    std::string encoded;
+    ObjectEncoder::EncodeToBase64(bytes, encoded);
+    BOOST_CHECK_EQUAL(encoded, "-_-_ABA");
+
+    std::array<unsigned char, 5> decoded = {};
+    BOOST_CHECK(ObjectEncoder::DecodeFromBase64(encoded, decoded));
+    BOOST_CHECK(decoded == bytes);
+    decoded = {};
+    BOOST_CHECK(ObjectEncoder::DecodeFromBase64(std::string("+/+/ABA"), decoded));
+    BOOST_CHECK(decoded == bytes);
+}
+
+BOOST_AUTO_TEST_CASE(phantom_node_round_trip)
+{
+    FixedPointCoordinate location(52500000, 13400000);
+    PhantomNode phantom_node(1, 2, 3, 4, 5, 6, 7, 8, 9, location, 10, TRAVEL_MODE_DEFAULT,
+                             TRAVEL_MODE_DEFAULT);
+    std::string encoded;
+    ObjectEncoder::EncodeToBase64(phantom_node, encoded);
+    BOOST_CHECK_EQUAL(encoded.size(), ObjectEncoder::EncodedLength<PhantomNode>());
+
+    PhantomNode decoded;
+    BOOST_CHECK(ObjectEncoder::DecodeFromBase64(encoded, decoded));
+    BOOST_CHECK_EQUAL(decoded, phantom_node);
+}
+
+BOOST_AUTO_TEST_CASE(phantom_node_hints)
+{
+    FixedPointCoordinate location(-33868820, 151209296);
+    PhantomNode phantom_node(1000000, SPECIAL_NODEID, 3, 12345, INVALID_EDGE_WEIGHT, 67890, 0,
+                             SPECIAL_EDGEID, 0, location, 4095, TRAVEL_MODE_DEFAULT, 15);
+    BOOST_REQUIRE(PackedPhantomNode::Fits(phantom_node));
+    std::string hint;
+    ObjectEncoder::EncodePhantomNode(phantom_node, hint);
+    BOOST_CHECK_EQUAL(hint.size(), ObjectEncoder::EncodedLength<PackedPhantomNode>());
+
+    PhantomNode decoded;
+    BOOST_CHECK(ObjectEncoder::DecodePhantomNode(hint, decoded));
+    BOOST_CHECK_EQUAL(decoded.forward_node_id, phantom_node.forward_node_id);
+    BOOST_CHECK_EQUAL(decoded.reverse_node_id, SPECIAL_NODEID);
+    BOOST_CHECK_EQUAL(decoded.name_id, 3);
+    BOOST_CHECK_EQUAL(decoded.forward_weight, 12345);
+    BOOST_CHECK_EQUAL(decoded.reverse_weight, INVALID_EDGE_WEIGHT);
+    BOOST_CHECK_EQUAL(decoded.forward_offset, 67890);
+    BOOST_CHECK_EQUAL(decoded.packed_geometry_id, SPECIAL_EDGEID);
+    BOOST_CHECK_EQUAL(decoded.component_id, 0);
+    BOOST_CHECK_EQUAL(decoded.location, location);
+    BOOST_CHECK_EQUAL(decoded.fwd_segment_position, 4095);
+    BOOST_CHECK_EQUAL(decoded.backward_travel_mode, 15);
+
+    // the defaults fit as well, the offset of a day-long ferry does not
+    BOOST_CHECK(PackedPhantomNode::Fits(PhantomNode()));
+    BOOST_CHECK_EQUAL(PackedPhantomNode(PhantomNode()).Unpack().component_id,
+                      PhantomNode().component_id);
+    phantom_node.reverse_offset = 24 * 36000 * 2;
+    BOOST_CHECK(!PackedPhantomNode::Fits(phantom_node));
+    ObjectEncoder::EncodePhantomNode(phantom_node, hint);
+    BOOST_CHECK_EQUAL(hint.size(), ObjectEncoder::EncodedLength<PhantomNode>());
+    BOOST_CHECK(ObjectEncoder::DecodePhantomNode(hint, decoded));
+    BOOST_CHECK_EQUAL(decoded.reverse_offset, phantom_node.reverse_offset);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_input)
+{
+    std::array<unsigned char, 5> decoded = {{1, 2, 3, 4, 5}};
+    const std::array<unsigned char, 5> unchanged = decoded;
+    // wrong length, padding and characters outside of the alphabet are rejected
+    BOOST_CHECK(!ObjectEncoder::DecodeFromBase64(std::string("-_-_AB"), decoded));
+    BOOST_CHECK(!ObjectEncoder::DecodeFromBase64(std::string("-_-_ABA="), decoded));
+    BOOST_CHECK(!ObjectEncoder::DecodeFromBase64(std::string("-_-_A.A"), decoded));
+    BOOST_CHECK(!ObjectEncoder::DecodeFromBase64(std::string(), decoded));
+    BOOST_CHECK(decoded == unchanged);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,84 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../algorithms/parallel_radix_sort.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(parallel_radix_sort)
+
+using Element = std::pair<std::uint64_t, unsigned>;
+
+// the input order is the tie breaker, so a stable sort gives the same order
+void CheckAgainstStableSort(std::vector<Element> elements)
+{
+    std::vector<Element> expected = elements;
+    std::stable_sort(expected.begin(), expected.end(), [](const Element &lhs, const Element &rhs)
+                     {
+                         return lhs.first < rhs.first;
+                     });
+    ParallelRadixSort(elements, [](const Element &element)
+                      {
+                          return element.first;
+                      });
+    BOOST_REQUIRE(expected == elements);
+}
+
+BOOST_AUTO_TEST_CASE(sorts_random_keys)
+{
+    std::mt19937_64 generator(23);
+    for (const unsigned size : {0u, 1u, 17u, 1000u, 5000u, 300000u})
+    {
+        std::vector<Element> elements;
+        for (unsigned i = 0; i < size; ++i)
+        {
+            elements.emplace_back(generator(), i);
+        }
+        CheckAgainstStableSort(elements);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(keeps_order_of_equal_keys)
+{
+    // few distinct keys that share their upper and lower bits, most digits are skipped
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<std::uint64_t> distribution(0, 40);
+    std::vector<Element> elements;
+    for (unsigned i = 0; i < 200000; ++i)
+    {
+        elements.emplace_back((std::uint64_t(0xabcd) << 48) | (distribution(generator) << 12), i);
+    }
+    CheckAgainstStableSort(elements);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,143 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../algorithms/parallel_scc.hpp"
+#include "../../algorithms/tarjan_scc.hpp"
+#include "../../data_structures/static_graph.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(parallel_scc)
+
+struct EdgeData
+{
+};
+using Graph = StaticGraph<EdgeData>;
+using InputEdge = Graph::InputEdge;
+
+std::shared_ptr<const Graph> MakeGraph(const unsigned number_of_nodes,
+                                       std::vector<InputEdge> edges)
+{
+    std::sort(edges.begin(), edges.end());
+    return std::make_shared<const Graph>(number_of_nodes, edges);
+}
+
+// both algorithms have to agree on the partition, the ids may differ
+void CheckAgainstTarjan(const std::shared_ptr<const Graph> &graph)
+{
+    TarjanSCC<Graph> tarjan(graph);
+    tarjan.run();
+    ParallelSCC<Graph> parallel(graph);
+    parallel.run();
+
+    BOOST_REQUIRE_EQUAL(tarjan.get_number_of_components(), parallel.get_number_of_components());
+    BOOST_CHECK_EQUAL(tarjan.get_size_one_count(), parallel.get_size_one_count());
+
+    std::vector<unsigned> tarjan_to_parallel(tarjan.get_number_of_components(), SPECIAL_NODEID);
+    for (const auto node : osrm::irange(0u, graph->GetNumberOfNodes()))
+    {
+        const auto tarjan_id = tarjan.get_component_id(node);
+        const auto parallel_id = parallel.get_component_id(node);
+        if (SPECIAL_NODEID == tarjan_to_parallel[tarjan_id])
+        {
+            tarjan_to_parallel[tarjan_id] = parallel_id;
+        }
+        BOOST_REQUIRE_EQUAL(tarjan_to_parallel[tarjan_id], parallel_id);
+        BOOST_CHECK_EQUAL(tarjan.get_component_size(tarjan_id),
+                          parallel.get_component_size(parallel_id));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(chain_and_cycles)
+{
+    // 0 -> 1 -> 2 -> 0 and 3 <-> 4, connected by 2 -> 3, plus a dead end 5
+    std::vector<InputEdge> edges = {{0, 1}, {1, 2}, {2, 0}, {2, 3}, {3, 4}, {4, 3}, {4, 5}};
+    const auto graph = MakeGraph(6, edges);
+    ParallelSCC<Graph> scc(graph);
+    scc.run();
+
+    BOOST_CHECK_EQUAL(scc.get_number_of_components(), 3);
+    BOOST_CHECK_EQUAL(scc.get_size_one_count(), 1);
+    // numbered by smallest node id
+    BOOST_CHECK_EQUAL(scc.get_component_id(0), 0);
+    BOOST_CHECK_EQUAL(scc.get_component_id(1), 0);
+    BOOST_CHECK_EQUAL(scc.get_component_id(2), 0);
+    BOOST_CHECK_EQUAL(scc.get_component_id(3), 1);
+    BOOST_CHECK_EQUAL(scc.get_component_id(4), 1);
+    BOOST_CHECK_EQUAL(scc.get_component_id(5), 2);
+    BOOST_CHECK_EQUAL(scc.get_component_size(0), 3);
+    BOOST_CHECK_EQUAL(scc.get_component_size(1), 2);
+    CheckAgainstTarjan(graph);
+}
+
+BOOST_AUTO_TEST_CASE(random_graphs)
+{
+    std::mt19937 generator(13);
+    for (const unsigned number_of_nodes : {1u, 2u, 50u, 1000u, 20000u})
+    {
+        // from mostly trivial components to one giant component and a few satellites
+        for (const double edges_per_node : {0.5, 1.0, 1.5, 3.0})
+        {
+            std::uniform_int_distribution<unsigned> node_distribution(0, number_of_nodes - 1);
+            std::vector<InputEdge> edges;
+            for (unsigned i = 0; i < number_of_nodes * edges_per_node; ++i)
+            {
+                edges.emplace_back(node_distribution(generator), node_distribution(generator));
+            }
+            CheckAgainstTarjan(MakeGraph(number_of_nodes, edges));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(long_cycle_with_chords)
+{
+    // deep enough to need an explicit stack in Tarjan and many BFS levels
+    const unsigned number_of_nodes = 100000;
+    std::vector<InputEdge> edges;
+    for (const auto node : osrm::irange(0u, number_of_nodes))
+    {
+        // two cycles, 0..49999 and 50000..99999, joined in one direction only
+        const unsigned half = number_of_nodes / 2;
+        const unsigned next = node + 1 == half ? 0 : (node + 1 == number_of_nodes ? half : node + 1);
+        edges.emplace_back(node, next);
+    }
+    edges.emplace_back(10, 60000);
+    const auto graph = MakeGraph(number_of_nodes, edges);
+    ParallelSCC<Graph> scc(graph);
+    scc.run();
+    BOOST_CHECK_EQUAL(scc.get_number_of_components(), 2);
+    BOOST_CHECK_EQUAL(scc.get_component_size(0), number_of_nodes / 2);
+    CheckAgainstTarjan(graph);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
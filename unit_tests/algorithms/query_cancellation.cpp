@@ -0,0 +1,115 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../util/query_cancellation.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+
+BOOST_AUTO_TEST_SUITE(query_cancellation)
+
+BOOST_AUTO_TEST_CASE(deadline)
+{
+    osrm::CancellationToken token;
+    BOOST_CHECK(!token.IsCancelled());
+
+    // the earlier deadline wins
+    token.SetTimeout(std::chrono::milliseconds(0));
+    token.SetTimeout(std::chrono::hours(1));
+    const auto start = osrm::CancellationToken::Clock::now();
+    while (osrm::CancellationToken::Clock::now() == start)
+    {
+    }
+    BOOST_CHECK(token.IsCancelled());
+
+    try
+    {
+        token.ThrowIfCancelled();
+        BOOST_ERROR("cancelled token did not throw");
+    }
+    catch (const osrm::query_cancelled &e)
+    {
+        BOOST_CHECK(e.deadline_passed);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(abandoned_check)
+{
+    bool gone = false;
+    osrm::CancellationToken token;
+    token.SetAbandonedCheck([&gone]
+                            {
+                                return gone;
+                            });
+    BOOST_CHECK(!token.IsCancelled());
+    gone = true;
+    BOOST_CHECK(token.IsCancelled());
+    // stays cancelled once the check fired
+    gone = false;
+    BOOST_CHECK(token.IsCancelled());
+}
+
+BOOST_AUTO_TEST_CASE(scope_and_poll)
+{
+    BOOST_CHECK(nullptr == osrm::cancellation::Current());
+    // without a token the checks are no-ops
+    osrm::cancellation::Check();
+
+    osrm::CancellationToken outer, inner;
+    {
+        const osrm::cancellation::Scope outer_scope(&outer);
+        {
+            const osrm::cancellation::Scope inner_scope(&inner);
+            BOOST_CHECK(&inner == osrm::cancellation::Current());
+        }
+        BOOST_CHECK(&outer == osrm::cancellation::Current());
+
+        outer.Cancel();
+        BOOST_CHECK_THROW(osrm::cancellation::Check(), osrm::query_cancelled);
+
+        // polling throws within one interval
+        unsigned polls = 0;
+        try
+        {
+            while (polls <= osrm::cancellation::POLL_INTERVAL)
+            {
+                ++polls;
+                osrm::cancellation::Poll();
+            }
+        }
+        catch (const osrm::query_cancelled &e)
+        {
+            BOOST_CHECK(!e.deadline_passed);
+        }
+        BOOST_CHECK_LE(polls, osrm::cancellation::POLL_INTERVAL);
+    }
+    BOOST_CHECK(nullptr == osrm::cancellation::Current());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
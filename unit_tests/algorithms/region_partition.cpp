@@ -0,0 +1,88 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../algorithms/region_partition.hpp"
+
+#include <osrm/coordinate.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(region_partition)
+
+namespace
+{
+struct TestEdge
+{
+    NodeID source;
+    NodeID target;
+};
+}
+
+BOOST_AUTO_TEST_CASE(cuts_the_longer_side)
+{
+    // two rows of four nodes, as wide as high, the first cut goes across the rows
+    std::vector<FixedPointCoordinate> locations;
+    for (const int lat : {0, 10})
+    {
+        for (const int lon : {0, 100, 200, 300})
+        {
+            locations.emplace_back(lat, lon);
+        }
+    }
+    const std::vector<unsigned> regions = PartitionByLocation(locations, 2);
+    const std::vector<unsigned> expected = {0, 0, 1, 1, 0, 0, 1, 1};
+    BOOST_CHECK_EQUAL_COLLECTIONS(regions.begin(), regions.end(), expected.begin(),
+                                  expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(balances_uneven_region_counts)
+{
+    std::vector<FixedPointCoordinate> locations;
+    for (const int lon : {50, 10, 30, 0, 40, 20})
+    {
+        locations.emplace_back(0, lon);
+    }
+    const std::vector<unsigned> regions = PartitionByLocation(locations, 3);
+    const std::vector<unsigned> expected = {2, 0, 1, 0, 2, 1};
+    BOOST_CHECK_EQUAL_COLLECTIONS(regions.begin(), regions.end(), expected.begin(),
+                                  expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(marks_both_ends_of_crossing_edges)
+{
+    const std::vector<unsigned> regions = {0, 0, 1, 1, 0};
+    const std::vector<TestEdge> edges = {{0, 1}, {1, 2}, {2, 3}, {4, 0}};
+    const std::vector<bool> is_boundary_node = FindBoundaryNodes(regions, edges);
+    const std::vector<bool> expected = {false, true, true, false, false};
+    BOOST_CHECK_EQUAL_COLLECTIONS(is_boundary_node.begin(), is_boundary_node.end(),
+                                  expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
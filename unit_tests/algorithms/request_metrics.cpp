@@ -0,0 +1,76 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../util/request_metrics.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(request_metrics)
+
+BOOST_AUTO_TEST_CASE(histogram_quantiles)
+{
+    osrm::metrics::LatencyHistogram histogram;
+    BOOST_CHECK_EQUAL(histogram.Count(), 0u);
+    BOOST_CHECK_EQUAL(histogram.Quantile(0.5), 0u);
+
+    for (std::uint64_t value = 1; value <= 1000; ++value)
+    {
+        histogram.Record(value);
+    }
+    BOOST_CHECK_EQUAL(histogram.Count(), 1000u);
+    BOOST_CHECK_EQUAL(histogram.Max(), 1000u);
+    BOOST_CHECK_CLOSE(histogram.Mean(), 500.5, 0.001);
+
+    // buckets have a relative error of at most 12.5%
+    const auto median = histogram.Quantile(0.5);
+    BOOST_CHECK_LE(median, 500u);
+    BOOST_CHECK_GE(median, 500u * 7 / 8);
+    const auto p99 = histogram.Quantile(0.99);
+    BOOST_CHECK_LE(p99, 990u);
+    BOOST_CHECK_GE(p99, 990u * 7 / 8);
+
+    // exact for small values
+    osrm::metrics::LatencyHistogram small;
+    small.Record(3);
+    BOOST_CHECK_EQUAL(small.Quantile(0.99), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(commit_request_phases)
+{
+    auto &registry = osrm::metrics::Registry::get();
+    registry.CurrentTimings().Reset();
+    registry.AddPhase(osrm::metrics::Phase::search, 40);
+    registry.AddPhase(osrm::metrics::Phase::search, 2);
+    registry.Commit("viaroute");
+
+    osrm::json::Object json_result;
+    registry.Render(json_result);
+    BOOST_CHECK(json_result.values.find("viaroute") != json_result.values.end());
+    BOOST_CHECK(json_result.values.find("table") != json_result.values.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,259 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../server/http/compression.hpp"
+#include "../../util/osrm_exception.hpp"
+#include "../../util/sha256.hpp"
+
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/test/unit_test.hpp>
+
+#ifdef OSRM_HAS_BROTLI
+#include <brotli/decode.h>
+#endif
+
+#ifdef OSRM_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(response_compression)
+
+namespace
+{
+std::string to_hex(const osrm::sha256_digest &digest)
+{
+    std::string hex;
+    for (const auto byte : digest)
+    {
+        char digits[3];
+        std::snprintf(digits, sizeof(digits), "%02x", byte);
+        hex += digits;
+    }
+    return hex;
+}
+
+// a reply that repeats itself like the json of the plugins
+std::string make_document()
+{
+    std::string document = "{\"status\":0,\"route_summary\":[";
+    for (int i = 0; i < 5000; ++i)
+    {
+        document += "{\"total_distance\":" + std::to_string(i * 37) + ",\"total_time\":" +
+                    std::to_string(i * 11) + "},";
+    }
+    document += "{}]}";
+    return document;
+}
+
+std::vector<char> compress(const std::string &document, const http::compression_type compression)
+{
+    std::vector<char> compressed;
+    boost::iostreams::filtering_ostream stream;
+    http::push_compressor(stream, compression);
+    stream.push(boost::iostreams::back_inserter(compressed));
+    // in pieces, as the renderers write
+    for (std::size_t i = 0; i < document.size(); i += 1000)
+    {
+        stream.write(document.data() + i, std::min<std::size_t>(1000, document.size() - i));
+    }
+    boost::iostreams::close(stream);
+    return compressed;
+}
+}
+
+BOOST_AUTO_TEST_CASE(sha256_test_vectors)
+{
+    const auto hash = [](const std::string &message)
+    {
+        return to_hex(osrm::sha256(message.data(), message.size()));
+    };
+    BOOST_CHECK_EQUAL(hash(""),
+                      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    BOOST_CHECK_EQUAL(hash("abc"),
+                      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    BOOST_CHECK_EQUAL(hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+                      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    BOOST_CHECK_EQUAL(hash(std::string(1000000, 'a')),
+                      "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+BOOST_AUTO_TEST_CASE(negotiation)
+{
+    http::configure_compression(http::compression_settings());
+
+    BOOST_CHECK_EQUAL(http::select_compression("", ""), http::no_compression);
+    BOOST_CHECK_EQUAL(http::select_compression("identity", ""), http::no_compression);
+    BOOST_CHECK_EQUAL(http::select_compression("deflate", ""), http::deflate_rfc1951);
+    BOOST_CHECK_EQUAL(http::select_compression("gzip, deflate", ""), http::gzip_rfc1952);
+    BOOST_CHECK_EQUAL(http::select_compression("X-GZIP", ""), http::gzip_rfc1952);
+    BOOST_CHECK_EQUAL(http::select_compression("gzip;q=0, deflate", ""), http::deflate_rfc1951);
+    BOOST_CHECK_EQUAL(http::select_compression("gzip;q=0.5, deflate;q=0.8", ""),
+                      http::deflate_rfc1951);
+    BOOST_CHECK_EQUAL(http::select_compression("*;q=0", ""), http::no_compression);
+
+#ifdef OSRM_HAS_BROTLI
+    BOOST_CHECK_EQUAL(http::select_compression("gzip, deflate, br", ""), http::brotli_rfc7932);
+    BOOST_CHECK_EQUAL(http::select_compression("gzip, br;q=0.9", ""), http::gzip_rfc1952);
+#endif
+#ifdef OSRM_HAS_ZSTD
+    BOOST_CHECK_EQUAL(http::select_compression("gzip, br, zstd", ""), http::zstd_rfc8878);
+    BOOST_CHECK_EQUAL(http::select_compression("*", ""), http::zstd_rfc8878);
+    // there's no dictionary on the server
+    BOOST_CHECK_EQUAL(http::select_compression("dcz, gzip", ":AAAA:"), http::gzip_rfc1952);
+#else
+    BOOST_CHECK_EQUAL(http::select_compression("zstd, br, gzip", ""), http::gzip_rfc1952);
+#endif
+    BOOST_CHECK_EQUAL(std::string(http::compression_vary()), "Accept-Encoding");
+}
+
+BOOST_AUTO_TEST_CASE(invalid_settings)
+{
+    http::compression_settings settings;
+    settings.gzip_level = 0;
+    BOOST_CHECK_THROW(http::configure_compression(settings), osrm::exception);
+    settings = http::compression_settings();
+    settings.brotli_quality = 12;
+    BOOST_CHECK_THROW(http::configure_compression(settings), osrm::exception);
+    settings = http::compression_settings();
+    settings.zstd_level = 20;
+    BOOST_CHECK_THROW(http::configure_compression(settings), osrm::exception);
+    http::configure_compression(http::compression_settings());
+}
+
+BOOST_AUTO_TEST_CASE(gzip_round_trip)
+{
+    http::configure_compression(http::compression_settings());
+    const std::string document = make_document();
+    const auto compressed = compress(document, http::gzip_rfc1952);
+    BOOST_CHECK_LT(compressed.size(), document.size() / 4);
+
+    boost::iostreams::filtering_istream decompressor;
+    decompressor.push(boost::iostreams::gzip_decompressor());
+    decompressor.push(boost::iostreams::array_source(compressed.data(), compressed.size()));
+    std::ostringstream decompressed;
+    boost::iostreams::copy(decompressor, decompressed);
+    BOOST_CHECK(decompressed.str() == document);
+}
+
+#ifdef OSRM_HAS_BROTLI
+BOOST_AUTO_TEST_CASE(brotli_round_trip)
+{
+    http::configure_compression(http::compression_settings());
+    const std::string document = make_document();
+    // the second reply of the thread reuses the memory of the first
+    for (int reply = 0; reply < 2; ++reply)
+    {
+        const auto compressed = compress(document, http::brotli_rfc7932);
+        std::string decompressed(document.size(), '\0');
+        std::size_t decompressed_size = decompressed.size();
+        BOOST_REQUIRE_EQUAL(BrotliDecoderDecompress(
+                                compressed.size(),
+                                reinterpret_cast<const std::uint8_t *>(compressed.data()),
+                                &decompressed_size,
+                                reinterpret_cast<std::uint8_t *>(&decompressed[0])),
+                            BROTLI_DECODER_RESULT_SUCCESS);
+        BOOST_CHECK_EQUAL(decompressed_size, document.size());
+        BOOST_CHECK(decompressed == document);
+    }
+}
+#endif
+
+#ifdef OSRM_HAS_ZSTD
+BOOST_AUTO_TEST_CASE(zstd_round_trip)
+{
+    http::configure_compression(http::compression_settings());
+    const std::string document = make_document();
+    for (int reply = 0; reply < 2; ++reply)
+    {
+        const auto compressed = compress(document, http::zstd_rfc8878);
+        std::string decompressed(document.size(), '\0');
+        const std::size_t decompressed_size = ZSTD_decompress(
+            &decompressed[0], decompressed.size(), compressed.data(), compressed.size());
+        BOOST_REQUIRE(!ZSTD_isError(decompressed_size));
+        BOOST_CHECK_EQUAL(decompressed_size, document.size());
+        BOOST_CHECK(decompressed == document);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dictionary_zstd_round_trip)
+{
+    const std::string document = make_document();
+    http::compression_settings settings;
+    settings.dictionary = document.substr(0, 2000);
+    http::configure_compression(settings);
+
+    // the standard base64 of the hash of the dictionary
+    const std::string digest = "NCn6CF7d/Kg56aqeeZ8glgbnAldzDkVf/UvdFnhFss0=";
+    BOOST_CHECK_EQUAL(http::select_compression("gzip, br, zstd, dcz", ":" + digest + ":"),
+                      http::dictionary_zstd);
+    BOOST_CHECK_EQUAL(http::select_compression("gzip, br, zstd, dcz", ":AAAA:"),
+                      http::zstd_rfc8878);
+    BOOST_CHECK_EQUAL(http::select_compression("gzip, br, zstd", ":" + digest + ":"),
+                      http::zstd_rfc8878);
+    BOOST_CHECK_EQUAL(std::string(http::compression_vary()),
+                      "Accept-Encoding, Available-Dictionary");
+
+    const auto compressed = compress(document, http::dictionary_zstd);
+    const auto hash = osrm::sha256(settings.dictionary.data(), settings.dictionary.size());
+    const unsigned char magic[] = {0x5e, 0x2a, 0x4d, 0x18, 0x20, 0x00, 0x00, 0x00};
+    BOOST_REQUIRE_GT(compressed.size(), 40u);
+    BOOST_CHECK(std::equal(magic, magic + 8, compressed.begin(),
+                           [](unsigned char a, char b)
+                           {
+                               return a == static_cast<unsigned char>(b);
+                           }));
+    BOOST_CHECK(std::equal(hash.begin(), hash.end(), compressed.begin() + 8,
+                           [](unsigned char a, char b)
+                           {
+                               return a == static_cast<unsigned char>(b);
+                           }));
+
+    std::string decompressed(document.size(), '\0');
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+    const std::size_t decompressed_size = ZSTD_decompress_usingDict(
+        context, &decompressed[0], decompressed.size(), compressed.data() + 40,
+        compressed.size() - 40, settings.dictionary.data(), settings.dictionary.size());
+    ZSTD_freeDCtx(context);
+    BOOST_REQUIRE(!ZSTD_isError(decompressed_size));
+    BOOST_CHECK(decompressed == document);
+
+    http::configure_compression(http::compression_settings());
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
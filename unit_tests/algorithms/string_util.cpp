@@ -62,4 +62,13 @@ BOOST_AUTO_TEST_CASE(print_int)
     BOOST_CHECK_EQUAL(output, "-3.14158976");
 }
 
+BOOST_AUTO_TEST_CASE(print_coordinate)
+{
+    char buffer[COORDINATE_STRING_LENGTH + 1];
+    BOOST_CHECK_EQUAL(std::string(printCoordinate(buffer, 52520008)), "52.520008");
+    BOOST_CHECK_EQUAL(std::string(printCoordinate(buffer, -180000000)), "-180.000000");
+    BOOST_CHECK_EQUAL(std::string(printCoordinate(buffer, -5)), "-0.000005");
+    BOOST_CHECK_EQUAL(std::string(printCoordinate(buffer, 0)), "0.000000");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
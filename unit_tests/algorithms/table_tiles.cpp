@@ -0,0 +1,124 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../util/table_tiles.hpp"
+#include "../../util/matrix_renderer.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(table_tiles)
+
+using namespace osrm::table_tiles;
+
+BOOST_AUTO_TEST_CASE(parse_query)
+{
+    TableQuery query;
+    BOOST_REQUIRE(ParseTableQuery(
+        "loc=1,1&hint=abc&loc=2,2&b=90&t=5&loc=3,3&checksum=7&lengths=true&src=2&src=0", query));
+    BOOST_REQUIRE_EQUAL(query.locations.size(), 3u);
+    BOOST_CHECK_EQUAL(query.locations[0], "loc=1,1&hint=abc");
+    BOOST_CHECK_EQUAL(query.locations[1], "loc=2,2&b=90&t=5");
+    BOOST_CHECK_EQUAL(query.locations[2], "loc=3,3");
+    BOOST_CHECK_EQUAL(query.shared_parameters, "checksum=7&lengths=true");
+    BOOST_CHECK(query.lengths);
+    BOOST_CHECK(!query.matrix_output);
+    BOOST_CHECK((query.sources == std::vector<unsigned>{2, 0}));
+    // all locations are destinations
+    BOOST_CHECK((query.destinations == std::vector<unsigned>{0, 1, 2}));
+
+    BOOST_CHECK(ParseTableQuery("loc=1,1&output=matrix", query));
+    BOOST_CHECK(query.matrix_output);
+
+    // left to a single backend
+    BOOST_CHECK(!ParseTableQuery("locs=_p~iF~ps|U", query));
+    BOOST_CHECK(!ParseTableQuery("loc=1,1&jsonp=f", query));
+    BOOST_CHECK(!ParseTableQuery("loc=1,1&max_duration=60", query));
+    BOOST_CHECK(!ParseTableQuery("loc=1,1&output=binary", query));
+    BOOST_CHECK(!ParseTableQuery("loc=1,1&dst=1", query));
+    BOOST_CHECK(!ParseTableQuery("", query));
+}
+
+BOOST_AUTO_TEST_CASE(tiles_cover_the_table)
+{
+    const auto tiles = MakeTiles(5, 3, 2);
+    BOOST_REQUIRE_EQUAL(tiles.size(), 6u);
+    unsigned entries = 0;
+    for (const auto &tile : tiles)
+    {
+        entries += tile.number_of_rows * tile.number_of_columns;
+    }
+    BOOST_CHECK_EQUAL(entries, 15u);
+    BOOST_CHECK_EQUAL(tiles.back().first_row, 4u);
+    BOOST_CHECK_EQUAL(tiles.back().number_of_rows, 1u);
+    BOOST_CHECK_EQUAL(tiles.back().first_column, 2u);
+    BOOST_CHECK_EQUAL(tiles.back().number_of_columns, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(tile_query)
+{
+    TableQuery query;
+    BOOST_REQUIRE(ParseTableQuery(
+        "loc=0,0&loc=1,1&hint=h&loc=2,2&loc=3,3&z=18&src=3&src=1&dst=1&dst=0&dst=2", query));
+    // the second source and the last two destinations
+    const Tile tile{1, 1, 1, 2};
+    BOOST_CHECK_EQUAL(TileQuery(query, tile),
+                      "z=18&loc=0,0&loc=1,1&hint=h&loc=2,2&src=1&dst=0&dst=2&output=matrix");
+}
+
+BOOST_AUTO_TEST_CASE(merge_tiles)
+{
+    const unsigned number_of_columns = 3;
+    std::vector<EdgeWeight> table(2 * number_of_columns, -1);
+    const Tile tile{1, 1, 1, 2};
+
+    std::string reply;
+    osrm::json::matrix_render(reply, 1, 2, {7, INVALID_EDGE_WEIGHT});
+    osrm::json::matrix_render(reply, 1, 2, {70, 80});
+    std::size_t offset = 0;
+    BOOST_REQUIRE(ReadTile(reply, offset, tile, number_of_columns, table));
+    BOOST_CHECK((table == std::vector<EdgeWeight>{-1, -1, -1, -1, 7, INVALID_EDGE_WEIGHT}));
+    // the lengths follow the durations
+    std::vector<EdgeWeight> lengths(table.size(), 0);
+    BOOST_REQUIRE(ReadTile(reply, offset, tile, number_of_columns, lengths));
+    BOOST_CHECK_EQUAL(lengths[5], 80);
+    BOOST_CHECK_EQUAL(offset, reply.size());
+    // there's nothing behind the lengths
+    BOOST_CHECK(!ReadTile(reply, offset, tile, number_of_columns, lengths));
+    // a matrix of another size
+    offset = 0;
+    BOOST_CHECK(!ReadTile(reply, offset, Tile{0, 2, 0, 1}, number_of_columns, table));
+
+    std::string json;
+    RenderTable(json, table, 2, number_of_columns);
+    BOOST_CHECK_EQUAL(json, "[[-1,-1,-1],[-1,7,2147483647]]");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
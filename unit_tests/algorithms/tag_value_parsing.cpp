@@ -0,0 +1,66 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../extractor/extraction_helper_functions.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_case_template.hpp>
+
+BOOST_AUTO_TEST_SUITE(tag_value_parsing)
+
+BOOST_AUTO_TEST_CASE(speeds_with_units)
+{
+    BOOST_CHECK_EQUAL(parseMaxspeed("50"), 50.);
+    BOOST_CHECK_EQUAL(parseMaxspeed("50 km/h"), 50.);
+    BOOST_CHECK_EQUAL(parseMaxspeed("50;30"), 50.);
+    BOOST_CHECK_CLOSE(parseMaxspeed("30mph"), 48.27, 0.001);
+    BOOST_CHECK_CLOSE(parseMaxspeed("30 mph"), 48.27, 0.001);
+    BOOST_CHECK_CLOSE(parseMaxspeed("30 mp/h"), 48.27, 0.001);
+    BOOST_CHECK_CLOSE(parseMaxspeed("10 knots"), 18.52, 0.001);
+    BOOST_CHECK_CLOSE(parseMaxspeed("7.5"), 7.5, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(speeds_without_number)
+{
+    BOOST_CHECK_EQUAL(parseMaxspeed(""), 0.);
+    BOOST_CHECK_EQUAL(parseMaxspeed("FR:urban"), 0.);
+    BOOST_CHECK_EQUAL(parseMaxspeed("none"), 0.);
+}
+
+BOOST_AUTO_TEST_CASE(lengths_with_units)
+{
+    BOOST_CHECK_EQUAL(parseLength("3"), 3.);
+    BOOST_CHECK_CLOSE(parseLength("2.5 m"), 2.5, 0.001);
+    BOOST_CHECK_CLOSE(parseLength("10 ft"), 3.048, 0.001);
+    BOOST_CHECK_CLOSE(parseLength("7'6\""), 2.286, 0.001);
+    BOOST_CHECK_CLOSE(parseLength("80 in"), 2.032, 0.001);
+    BOOST_CHECK_CLOSE(parseLength("250 cm"), 2.5, 0.001);
+    BOOST_CHECK_EQUAL(parseLength("narrow"), 0.);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,140 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../algorithms/trip_brute_force.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(trip_brute_force)
+
+namespace
+{
+// random asymmetric distances that are shortest paths among each other, like a distance table
+DistTableWrapper<EdgeWeight> MakeDistanceTable(const unsigned number_of_locations,
+                                               const unsigned seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distance(1, 1000);
+    std::vector<EdgeWeight> table(number_of_locations * number_of_locations, 0);
+    for (unsigned from = 0; from < number_of_locations; ++from)
+    {
+        for (unsigned to = 0; to < number_of_locations; ++to)
+        {
+            if (from != to)
+            {
+                table[from * number_of_locations + to] = distance(generator);
+            }
+        }
+    }
+    for (unsigned via = 0; via < number_of_locations; ++via)
+    {
+        for (unsigned from = 0; from < number_of_locations; ++from)
+        {
+            for (unsigned to = 0; to < number_of_locations; ++to)
+            {
+                table[from * number_of_locations + to] =
+                    std::min(table[from * number_of_locations + to],
+                             table[from * number_of_locations + via] +
+                                 table[via * number_of_locations + to]);
+            }
+        }
+    }
+    return DistTableWrapper<EdgeWeight>(std::move(table), number_of_locations);
+}
+
+EdgeWeight GetTripLength(const std::vector<NodeID> &route,
+                         const DistTableWrapper<EdgeWeight> &dist_table)
+{
+    EdgeWeight length = 0;
+    for (std::size_t i = 0; i < route.size(); ++i)
+    {
+        length += dist_table(route[i], route[(i + 1) % route.size()]);
+    }
+    return length;
+}
+}
+
+BOOST_AUTO_TEST_CASE(finds_shortest_trip)
+{
+    for (unsigned number_of_locations = 1; number_of_locations <= 8; ++number_of_locations)
+    {
+        for (unsigned seed = 0; seed < 10; ++seed)
+        {
+            const auto dist_table = MakeDistanceTable(number_of_locations, seed);
+            std::vector<NodeID> locations(number_of_locations);
+            for (NodeID i = 0; i < number_of_locations; ++i)
+            {
+                locations[i] = i;
+            }
+
+            EdgeWeight shortest_length = INVALID_EDGE_WEIGHT;
+            auto permutation = locations;
+            do
+            {
+                shortest_length =
+                    std::min(shortest_length, GetTripLength(permutation, dist_table));
+            } while (std::next_permutation(permutation.begin(), permutation.end()));
+
+            const auto route = osrm::trip::BruteForceTrip(locations.begin(), locations.end(),
+                                                          number_of_locations, dist_table);
+            BOOST_CHECK_EQUAL(GetTripLength(route, dist_table), shortest_length);
+            auto visited = route;
+            std::sort(visited.begin(), visited.end());
+            BOOST_CHECK(visited == locations);
+
+            // ties between equally short trips are broken the same way every time
+            const auto repeated_route = osrm::trip::BruteForceTrip(
+                locations.begin(), locations.end(), number_of_locations, dist_table);
+            BOOST_CHECK(repeated_route == route);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(component_of_table)
+{
+    const auto dist_table = MakeDistanceTable(12, 5);
+    const std::vector<NodeID> component = {11, 3, 7, 0, 5, 9};
+    const auto route =
+        osrm::trip::BruteForceTrip(component.begin(), component.end(), 12, dist_table);
+
+    auto permutation = component;
+    std::sort(permutation.begin(), permutation.end());
+    EdgeWeight shortest_length = INVALID_EDGE_WEIGHT;
+    do
+    {
+        shortest_length = std::min(shortest_length, GetTripLength(permutation, dist_table));
+    } while (std::next_permutation(permutation.begin(), permutation.end()));
+
+    BOOST_CHECK_EQUAL(route.front(), component.front());
+    BOOST_CHECK_EQUAL(GetTripLength(route, dist_table), shortest_length);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
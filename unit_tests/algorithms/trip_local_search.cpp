@@ -0,0 +1,147 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../algorithms/trip_local_search.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(trip_local_search)
+
+namespace
+{
+// road-like distances: euclidean with a random detour in each direction
+DistTableWrapper<EdgeWeight> MakeDistanceTable(const unsigned number_of_locations,
+                                               const unsigned seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> position(0, 1000);
+    std::uniform_int_distribution<int> detour(0, 100);
+    std::vector<std::pair<int, int>> locations(number_of_locations);
+    for (auto &location : locations)
+    {
+        location = std::make_pair(position(generator), position(generator));
+    }
+
+    std::vector<EdgeWeight> table(number_of_locations * number_of_locations, 0);
+    for (unsigned from = 0; from < number_of_locations; ++from)
+    {
+        for (unsigned to = 0; to < number_of_locations; ++to)
+        {
+            if (from != to)
+            {
+                const double dx = locations[from].first - locations[to].first;
+                const double dy = locations[from].second - locations[to].second;
+                table[from * number_of_locations + to] =
+                    static_cast<EdgeWeight>(std::sqrt(dx * dx + dy * dy)) + detour(generator);
+            }
+        }
+    }
+    return DistTableWrapper<EdgeWeight>(std::move(table), number_of_locations);
+}
+
+EdgeWeight GetTripLength(const std::vector<NodeID> &route,
+                         const DistTableWrapper<EdgeWeight> &dist_table)
+{
+    EdgeWeight length = 0;
+    for (std::size_t i = 0; i < route.size(); ++i)
+    {
+        length += dist_table(route[i], route[(i + 1) % route.size()]);
+    }
+    return length;
+}
+}
+
+BOOST_AUTO_TEST_CASE(improves_random_trips)
+{
+    const unsigned number_of_locations = 60;
+    for (unsigned seed = 0; seed < 20; ++seed)
+    {
+        const auto dist_table = MakeDistanceTable(number_of_locations, seed);
+        std::vector<NodeID> route(number_of_locations);
+        for (NodeID i = 0; i < number_of_locations; ++i)
+        {
+            route[i] = i;
+        }
+        std::shuffle(route.begin(), route.end(), std::mt19937(seed));
+
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        osrm::trip::TripLocalSearch local_search(route, dist_table);
+        const auto improved_route = local_search.Run(deadline);
+
+        // the same locations are visited starting at the same one
+        BOOST_REQUIRE_EQUAL(improved_route.size(), route.size());
+        BOOST_CHECK_EQUAL(improved_route.front(), route.front());
+        auto visited = improved_route;
+        std::sort(visited.begin(), visited.end());
+        for (NodeID i = 0; i < number_of_locations; ++i)
+        {
+            BOOST_CHECK_EQUAL(visited[i], i);
+        }
+
+        BOOST_CHECK_EQUAL(local_search.GetTripLength(), GetTripLength(improved_route, dist_table));
+        BOOST_CHECK_LT(GetTripLength(improved_route, dist_table),
+                       GetTripLength(route, dist_table));
+        // a converged trip is not improved any further
+        BOOST_CHECK_EQUAL(GetTripLength(osrm::trip::ImproveTrip(improved_route, dist_table,
+                                                                deadline),
+                                        dist_table),
+                          GetTripLength(improved_route, dist_table));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(respects_deadline)
+{
+    const auto dist_table = MakeDistanceTable(80, 1);
+    std::vector<NodeID> route(80);
+    for (NodeID i = 0; i < 80; ++i)
+    {
+        route[i] = (i * 7) % 80;
+    }
+    // a deadline in the past keeps the trip as it is
+    const auto improved_route =
+        osrm::trip::ImproveTrip(route, dist_table, std::chrono::steady_clock::now());
+    BOOST_CHECK_EQUAL_COLLECTIONS(improved_route.begin(), improved_route.end(), route.begin(),
+                                  route.end());
+}
+
+BOOST_AUTO_TEST_CASE(small_trips)
+{
+    const auto dist_table = MakeDistanceTable(4, 3);
+    const std::vector<NodeID> route = {2, 0, 3, 1};
+    const auto improved_route = osrm::trip::ImproveTrip(
+        route, dist_table, std::chrono::steady_clock::now() + std::chrono::seconds(1));
+    BOOST_CHECK_EQUAL_COLLECTIONS(improved_route.begin(), improved_route.end(), route.begin(),
+                                  route.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
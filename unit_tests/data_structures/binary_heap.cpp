@@ -26,6 +26,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "../../data_structures/binary_heap.hpp"
+#include "../../data_structures/xor_fast_hash_storage.hpp"
 #include "../../typedefs.h"
 
 #include <boost/test/unit_test.hpp>
@@ -49,7 +50,14 @@ typedef int TestKey;
 typedef int TestWeight;
 typedef boost::mpl::list<ArrayStorage<TestNodeID, TestKey>,
                          MapStorage<TestNodeID, TestKey>,
-                         UnorderedMapStorage<TestNodeID, TestKey>> storage_types;
+                         UnorderedMapStorage<TestNodeID, TestKey>,
+                         SelectableStorage<TestNodeID, TestKey>,
+                         XORFastHashStorage<TestNodeID, TestKey>,
+                         XORFastHashStorage<TestNodeID, TestKey, 2>,
+                         SelectableStorage<TestNodeID,
+                                           TestKey,
+                                           XORFastHashStorage<TestNodeID, TestKey, 4>>>
+    storage_types;
 
 template <unsigned NUM_ELEM> struct RandomDataFixture
 {
@@ -180,4 +188,73 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(decrease_key_test, T, storage_types, RandomData
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(selectable_storage_clear_test, RandomDataFixture<NUM_NODES>)
+{
+    for (const bool use_array : {false, true})
+    {
+        BinaryHeap<TestNodeID, TestKey, TestWeight, TestData, SelectableStorage<TestNodeID, TestKey>>
+            heap(NUM_NODES, use_array);
+        BOOST_CHECK_EQUAL(heap.GetIndexStorage().UsesArray(), use_array);
+        BOOST_CHECK(heap.GetIndexStorage().CanIndex(NUM_NODES));
+        BOOST_CHECK_EQUAL(heap.GetIndexStorage().CanIndex(NUM_NODES + 1), !use_array);
+
+        for (unsigned idx : order)
+        {
+            heap.Insert(ids[idx], weights[idx], data[idx]);
+        }
+        heap.Clear();
+
+        // the array keeps stale positions, none of them may resolve to an inserted node
+        for (auto id : ids)
+        {
+            BOOST_CHECK(!heap.WasInserted(id));
+        }
+
+        for (unsigned idx : order)
+        {
+            if (0 == idx % 3)
+            {
+                heap.Insert(ids[idx], weights[idx], data[idx]);
+            }
+        }
+        for (auto id : ids)
+        {
+            BOOST_CHECK_EQUAL(heap.WasInserted(id), 0 == id % 3);
+        }
+        BOOST_CHECK_EQUAL(heap.Min(), 0);
+        BOOST_CHECK_EQUAL(heap.GetKey(3), weights[3]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(open_addressing_storage_growth_test)
+{
+    // starts with four cells and has to grow several times
+    XORFastHashStorage<TestNodeID, TestKey, 2> storage(0);
+    BOOST_CHECK_EQUAL(storage.Capacity(), 4);
+
+    for (const unsigned round : {0, 1, 2})
+    {
+        const unsigned number_of_ids = 1000 * (round + 1);
+        for (unsigned id = 0; id < number_of_ids; ++id)
+        {
+            storage[id * 7919] = id + round;
+        }
+        BOOST_CHECK_GE(storage.Capacity(), 2 * number_of_ids);
+        for (unsigned id = 0; id < number_of_ids; ++id)
+        {
+            BOOST_CHECK_EQUAL(storage.peek_index(id * 7919), id + round);
+        }
+        BOOST_CHECK_EQUAL(storage.peek_index(7918), std::numeric_limits<TestKey>::max());
+
+        // a new generation forgets all keys but keeps the capacity
+        const auto capacity = storage.Capacity();
+        storage.Clear();
+        BOOST_CHECK_EQUAL(storage.Capacity(), capacity);
+        for (unsigned id = 0; id < number_of_ids; ++id)
+        {
+            BOOST_CHECK_EQUAL(storage.peek_index(id * 7919), std::numeric_limits<TestKey>::max());
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,142 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/bit_vector.hpp"
+#include "../../data_structures/packed_vector.hpp"
+#include "../../data_structures/run_length_vector.hpp"
+#include "../../data_structures/turn_instructions.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(bit_vector)
+
+BOOST_AUTO_TEST_CASE(access_and_rank)
+{
+    std::mt19937 generator(7);
+    std::bernoulli_distribution distribution(0.3);
+
+    // sizes around the cache lines of 448 flags
+    for (const std::size_t number_of_bits : {0u, 1u, 63u, 64u, 447u, 448u, 449u, 896u, 2000u})
+    {
+        std::vector<bool> flags(number_of_bits);
+        for (std::size_t i = 0; i < number_of_bits; ++i)
+        {
+            flags[i] = distribution(generator);
+        }
+
+        BitVector<false> internal(flags);
+        std::vector<std::uint64_t> block(BitVector<true>::GetNumberOfWords(number_of_bits));
+        BitVector<true>::Write(flags, block.data());
+        BitVector<true> shared(block.data(), number_of_bits);
+
+        BOOST_REQUIRE_EQUAL(internal.size(), number_of_bits);
+        BOOST_REQUIRE_EQUAL(shared.size(), number_of_bits);
+        std::size_t rank = 0;
+        for (std::size_t i = 0; i < number_of_bits; ++i)
+        {
+            BOOST_CHECK_EQUAL(internal.rank(i), rank);
+            BOOST_CHECK_EQUAL(shared.rank(i), rank);
+            BOOST_CHECK_EQUAL(internal[i], flags[i]);
+            BOOST_CHECK_EQUAL(shared.at(i), flags[i]);
+            rank += flags[i];
+        }
+        BOOST_CHECK_EQUAL(internal.rank(number_of_bits), rank);
+        BOOST_CHECK_EQUAL(shared.rank(number_of_bits), rank);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(packed_values)
+{
+    using TurnVector = PackedVector<TurnInstruction, 5, false>;
+    BOOST_CHECK(TurnVector::Fits(TurnInstruction::LeaveAgainstAllowedDirection));
+    BOOST_CHECK(!TurnVector::Fits(TurnInstruction::AccessRestrictionFlag));
+
+    const std::size_t number_of_values = 100;
+    TurnVector internal(number_of_values);
+    std::vector<std::uint64_t> block(PackedVector<unsigned char, 4, true>::GetNumberOfWords(
+                                         number_of_values),
+                                     ~std::uint64_t(0));
+    for (std::size_t i = 0; i < number_of_values; ++i)
+    {
+        internal.set(i, static_cast<TurnInstruction>(i % 18));
+        PackedVector<unsigned char, 4, true>::Set(block.data(), i, i % 16);
+    }
+    // overwriting keeps the neighbors
+    internal.set(50, TurnInstruction::UTurn);
+
+    PackedVector<unsigned char, 4, true> shared(block.data(), number_of_values);
+    for (std::size_t i = 0; i < number_of_values; ++i)
+    {
+        const auto expected = 50 == i ? TurnInstruction::UTurn : static_cast<TurnInstruction>(i % 18);
+        BOOST_CHECK(internal[i] == expected);
+        BOOST_CHECK_EQUAL(shared.at(i), i % 16);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(run_length_values)
+{
+    std::mt19937 generator(11);
+    std::geometric_distribution<unsigned> run_length(0.2);
+    std::uniform_int_distribution<unsigned> value(0, 3);
+
+    std::vector<unsigned> values;
+    while (values.size() < 1000)
+    {
+        values.insert(values.end(), 1 + run_length(generator), value(generator));
+    }
+
+    RunLengthVector<unsigned, false> internal(values);
+
+    std::vector<unsigned> run_values(values.size());
+    std::vector<bool> run_starts(values.size());
+    std::size_t number_of_runs = 0;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        run_starts[i] =
+            RunLengthVector<unsigned, true>::Append(run_values.data(), number_of_runs, values[i]);
+    }
+    std::vector<std::uint64_t> block(BitVector<true>::GetNumberOfWords(values.size()));
+    BitVector<true>::Write(run_starts, block.data());
+    RunLengthVector<unsigned, true> shared(run_values.data(), number_of_runs, block.data(),
+                                           values.size());
+
+    BOOST_CHECK_EQUAL(internal.number_of_runs(), number_of_runs);
+    BOOST_CHECK_LT(number_of_runs, values.size() / 2);
+    BOOST_REQUIRE_EQUAL(internal.size(), values.size());
+    BOOST_REQUIRE_EQUAL(shared.size(), values.size());
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(internal.at(i), values[i]);
+        BOOST_CHECK_EQUAL(shared[i], values[i]);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,5 +1,6 @@
 #include "../../data_structures/compressed_edge_container.hpp"
 #include "../../typedefs.h"
+#include "../../util/integer_range.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/test_case_template.hpp>
@@ -38,6 +39,21 @@ BOOST_AUTO_TEST_CASE(long_road_test)
     BOOST_CHECK(!container.HasEntryForID(3));
     BOOST_CHECK_EQUAL(container.GetFirstEdgeTargetID(0), 1);
     BOOST_CHECK_EQUAL(container.GetLastEdgeSourceID(0), 3);
+
+    container.Flatten();
+    BOOST_CHECK(container.HasEntryForID(0));
+    BOOST_CHECK(!container.HasEntryForID(2));
+    BOOST_CHECK_EQUAL(container.GetFirstEdgeTargetID(0), 1);
+    BOOST_CHECK_EQUAL(container.GetLastEdgeSourceID(0), 3);
+
+    const auto bucket = container.GetBucketReference(0);
+    BOOST_REQUIRE_EQUAL(bucket.size(), 4);
+    const NodeID expected_nodes[] = {1, 2, 3, 4};
+    for (const auto i : osrm::irange<std::size_t>(0, bucket.size()))
+    {
+        BOOST_CHECK_EQUAL(bucket[i].first, expected_nodes[i]);
+        BOOST_CHECK_EQUAL(bucket[i].second, 1);
+    }
 }
 
 BOOST_AUTO_TEST_CASE(t_crossing)
@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <osrm/coordinate.hpp>
 
 #include <cmath>
+#include <vector>
 
 // Regression test for bug captured in #1347
 BOOST_AUTO_TEST_CASE(regression_test_1347)
@@ -48,3 +49,46 @@ BOOST_AUTO_TEST_CASE(regression_test_1347)
 
     BOOST_CHECK_LE(std::abs(d1 - d2), 0.01f);
 }
+
+BOOST_AUTO_TEST_CASE(batch_distances_and_bearings)
+{
+    const auto make_coordinate = [](const double lat, const double lon)
+    {
+        return FixedPointCoordinate(static_cast<int>(lat * COORDINATE_PRECISION),
+                                    static_cast<int>(lon * COORDINATE_PRECISION));
+    };
+    // includes a repeated coordinate and a pair across the antimeridian
+    const std::vector<FixedPointCoordinate> coordinates = {
+        make_coordinate(52.5, 13.4), make_coordinate(52.51, 13.38), make_coordinate(-33.9, 151.2),
+        make_coordinate(-33.9, 151.2), make_coordinate(-33.8, -179.9),
+        make_coordinate(-33.8, 179.9)};
+    const std::size_t count = coordinates.size();
+
+    std::vector<double> great_circle(count - 1);
+    std::vector<float> euclidean(count - 1);
+    coordinate_calculation::great_circle_distances(coordinates.data(), count, great_circle.data());
+    coordinate_calculation::euclidean_distances(coordinates.data(), count, euclidean.data());
+    for (std::size_t i = 0; i + 1 < count; ++i)
+    {
+        BOOST_CHECK_CLOSE(great_circle[i], coordinate_calculation::great_circle_distance(
+                                               coordinates[i], coordinates[i + 1]),
+                          1e-4);
+        BOOST_CHECK_CLOSE(euclidean[i], coordinate_calculation::euclidean_distance(
+                                            coordinates[i], coordinates[i + 1]),
+                          1e-4);
+    }
+
+    std::vector<double> from_origin(count);
+    std::vector<float> bearings(count);
+    coordinate_calculation::great_circle_distances(coordinates[0], coordinates.data(), count,
+                                                   from_origin.data());
+    coordinate_calculation::bearings(coordinates[0], coordinates.data(), count, bearings.data());
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        BOOST_CHECK_CLOSE(from_origin[i], coordinate_calculation::great_circle_distance(
+                                              coordinates[0], coordinates[i]),
+                          1e-4);
+        BOOST_CHECK_CLOSE(bearings[i],
+                          coordinate_calculation::bearing(coordinates[0], coordinates[i]), 1e-4);
+    }
+}
@@ -0,0 +1,136 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/binary_heap.hpp"
+#include "../../data_structures/d_ary_heap.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/mpl/list.hpp>
+
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(d_ary_heap)
+
+struct TestData
+{
+    unsigned value;
+};
+
+typedef NodeID TestNodeID;
+typedef int TestKey;
+typedef int TestWeight;
+typedef BinaryHeap<TestNodeID, TestKey, TestWeight, TestData> ReferenceHeap;
+typedef boost::mpl::list<
+    DAryHeap<TestNodeID, TestKey, TestWeight, TestData, ArrayStorage<TestNodeID, TestKey>, 2>,
+    DAryHeap<TestNodeID, TestKey, TestWeight, TestData, ArrayStorage<TestNodeID, TestKey>, 4>,
+    DAryHeap<TestNodeID, TestKey, TestWeight, TestData, UnorderedMapStorage<TestNodeID, TestKey>,
+             8>> heap_types;
+
+constexpr unsigned NUM_NODES = 500;
+
+// replays the operations of a label setting search on both heaps, settled weights must agree
+BOOST_AUTO_TEST_CASE_TEMPLATE(matches_binary_heap_test, HeapT, heap_types)
+{
+    std::mt19937 generator(23);
+    std::uniform_int_distribution<TestNodeID> node_distribution(0, NUM_NODES - 1);
+    std::uniform_int_distribution<TestWeight> weight_distribution(0, 1000);
+
+    HeapT heap(NUM_NODES);
+    ReferenceHeap reference(NUM_NODES);
+    for (unsigned round = 0; round < 3; ++round)
+    {
+        heap.Clear();
+        reference.Clear();
+        for (unsigned step = 0; step < 4 * NUM_NODES; ++step)
+        {
+            const TestNodeID node = node_distribution(generator);
+            const TestWeight weight = weight_distribution(generator);
+            BOOST_REQUIRE_EQUAL(heap.WasInserted(node), reference.WasInserted(node));
+            if (!heap.WasInserted(node))
+            {
+                heap.Insert(node, weight, {node});
+                reference.Insert(node, weight, {node});
+            }
+            else if (!heap.WasRemoved(node) && weight < heap.GetKey(node))
+            {
+                heap.DecreaseKey(node, weight);
+                reference.DecreaseKey(node, weight);
+            }
+            BOOST_REQUIRE_EQUAL(heap.Size(), reference.Size());
+            if (heap.Empty())
+            {
+                continue;
+            }
+            BOOST_REQUIRE_EQUAL(heap.MinKey(), reference.MinKey());
+
+            if (0 == step % 3)
+            {
+                const TestWeight min_weight = heap.MinKey();
+                const TestNodeID removed = heap.DeleteMin();
+                BOOST_CHECK_EQUAL(heap.GetKey(removed), min_weight);
+                BOOST_CHECK_EQUAL(heap.GetData(removed).value, removed);
+                BOOST_CHECK(heap.WasRemoved(removed));
+                const TestNodeID reference_removed = reference.DeleteMin();
+                BOOST_CHECK_EQUAL(reference.GetKey(reference_removed), min_weight);
+            }
+        }
+
+        TestWeight last_weight = 0;
+        while (!heap.Empty())
+        {
+            BOOST_REQUIRE_EQUAL(heap.MinKey(), reference.MinKey());
+            BOOST_CHECK_LE(last_weight, heap.MinKey());
+            last_weight = heap.MinKey();
+            heap.DeleteMin();
+            reference.DeleteMin();
+        }
+        BOOST_CHECK(reference.Empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(delete_all_test, HeapT, heap_types)
+{
+    HeapT heap(NUM_NODES);
+    for (TestNodeID node = 0; node < 10; ++node)
+    {
+        heap.Insert(node, 10 - node, {node});
+    }
+    BOOST_CHECK_EQUAL(heap.Min(), 9);
+    heap.DeleteAll();
+
+    BOOST_CHECK(heap.Empty());
+    for (TestNodeID node = 0; node < 10; ++node)
+    {
+        BOOST_CHECK(heap.WasInserted(node));
+        BOOST_CHECK(heap.WasRemoved(node));
+    }
+    BOOST_CHECK(!heap.WasInserted(10));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
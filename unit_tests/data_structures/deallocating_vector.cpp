@@ -0,0 +1,141 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/deallocating_vector.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_case_template.hpp>
+#include <boost/mpl/list.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(deallocating_vector)
+
+struct TestElement
+{
+    TestElement() : value(42) {}
+    TestElement(unsigned value) : value(value) {}
+    unsigned value;
+};
+
+// small buckets to cross many bucket boundaries
+constexpr std::size_t ELEMENTS_PER_BLOCK = 1000;
+
+typedef boost::mpl::list<
+    DeallocatingVector<TestElement, ELEMENTS_PER_BLOCK, HeapBucketAllocator<TestElement>>,
+    DeallocatingVector<TestElement, ELEMENTS_PER_BLOCK, DefaultBucketAllocator<TestElement>>>
+    vector_types;
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(push_back_and_deallocate_test, VectorT, vector_types)
+{
+    VectorT vector;
+    for (unsigned i = 0; i < 10 * ELEMENTS_PER_BLOCK + 17; ++i)
+    {
+        vector.push_back(TestElement(i));
+    }
+    BOOST_CHECK_EQUAL(vector.size(), 10 * ELEMENTS_PER_BLOCK + 17);
+    BOOST_CHECK_EQUAL(vector.capacity(), 11 * ELEMENTS_PER_BLOCK);
+    BOOST_CHECK(std::is_sorted(vector.begin(), vector.end(),
+                               [](const TestElement &lhs, const TestElement &rhs)
+                               {
+                                   return lhs.value < rhs.value;
+                               }));
+
+    unsigned expected = 0;
+    for (auto iter = vector.dbegin(); iter != vector.dend(); ++iter)
+    {
+        BOOST_CHECK_EQUAL(iter->value, expected);
+        ++expected;
+    }
+    BOOST_CHECK_EQUAL(expected, vector.size());
+    vector.clear();
+    BOOST_CHECK_EQUAL(vector.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(resize_test, VectorT, vector_types)
+{
+    VectorT vector;
+    vector.resize(3 * ELEMENTS_PER_BLOCK + 1);
+    // new elements are default constructed
+    BOOST_CHECK_EQUAL(vector[0].value, 42);
+    BOOST_CHECK_EQUAL(vector[3 * ELEMENTS_PER_BLOCK].value, 42);
+
+    vector.resize(ELEMENTS_PER_BLOCK / 2);
+    BOOST_CHECK_EQUAL(vector.size(), ELEMENTS_PER_BLOCK / 2);
+    BOOST_CHECK_EQUAL(vector.capacity(), ELEMENTS_PER_BLOCK);
+    vector.push_back(TestElement(7));
+    BOOST_CHECK_EQUAL(vector[ELEMENTS_PER_BLOCK / 2].value, 7);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(move_test, VectorT, vector_types)
+{
+    VectorT vector;
+    for (unsigned i = 0; i < 2 * ELEMENTS_PER_BLOCK; ++i)
+    {
+        vector.push_back(TestElement(i));
+    }
+    const TestElement *first_element = &vector[0];
+
+    // moving hands over the buckets without copying the elements
+    VectorT moved_vector(std::move(vector));
+    BOOST_CHECK_EQUAL(moved_vector.size(), 2 * ELEMENTS_PER_BLOCK);
+    BOOST_CHECK_EQUAL(&moved_vector[0], first_element);
+    BOOST_CHECK_EQUAL(vector.size(), 0);
+
+    VectorT assigned_vector;
+    assigned_vector.push_back(TestElement(3));
+    assigned_vector = std::move(moved_vector);
+    BOOST_CHECK_EQUAL(assigned_vector.size(), 2 * ELEMENTS_PER_BLOCK);
+    BOOST_CHECK_EQUAL(&assigned_vector[0], first_element);
+    BOOST_CHECK_EQUAL(assigned_vector[2 * ELEMENTS_PER_BLOCK - 1].value,
+                      2 * ELEMENTS_PER_BLOCK - 1);
+}
+
+BOOST_AUTO_TEST_CASE_TEMPLATE(parallel_fill_test, VectorT, vector_types)
+{
+    constexpr unsigned NUM_ELEMENTS = 25 * ELEMENTS_PER_BLOCK + 3;
+    VectorT vector;
+    vector.resize(NUM_ELEMENTS);
+    tbb::parallel_for(tbb::blocked_range<unsigned>(0, NUM_ELEMENTS, 100),
+                      [&vector](const tbb::blocked_range<unsigned> &range)
+                      {
+                          for (unsigned i = range.begin(); i != range.end(); ++i)
+                          {
+                              vector[i] = TestElement(3 * i);
+                          }
+                      });
+    for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+    {
+        BOOST_CHECK_EQUAL(vector[i].value, 3 * i);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -90,4 +90,57 @@ BOOST_AUTO_TEST_CASE(find_test)
     BOOST_CHECK_EQUAL(simple_graph.GetEdgeData(eit).id, 2);
 }
 
+BOOST_AUTO_TEST_CASE(compact_test)
+{
+    std::vector<TestInputEdge> input_edges = {
+        TestInputEdge{0, 1, TestData{1}},
+        TestInputEdge{1, 2, TestData{2}},
+        TestInputEdge{2, 0, TestData{3}},
+        TestInputEdge{3, 0, TestData{4}}
+    };
+    TestDynamicGraph graph(4, input_edges);
+
+    // relocates the edges of node 1 and 0 to the end of the edge list
+    graph.InsertEdge(1, 3, TestData{5});
+    graph.InsertEdge(1, 0, TestData{6});
+    graph.InsertEdge(0, 2, TestData{7});
+    graph.DeleteEdge(2, graph.FindEdge(2, 0));
+    BOOST_CHECK_GT(graph.GetEdgeStorageSize(), graph.GetNumberOfEdges());
+
+    graph.Compact();
+    BOOST_CHECK_EQUAL(graph.GetEdgeStorageSize(), graph.GetNumberOfEdges());
+    BOOST_CHECK_EQUAL(graph.GetNumberOfEdges(), 6);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(0), 2);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(1), 3);
+    BOOST_CHECK_EQUAL(graph.GetOutDegree(2), 0);
+    BOOST_CHECK_EQUAL(graph.GetEdgeData(graph.FindEdge(0, 2)).id, 7);
+    BOOST_CHECK_EQUAL(graph.GetEdgeData(graph.FindEdge(1, 0)).id, 6);
+    BOOST_CHECK_EQUAL(graph.GetEdgeData(graph.FindEdge(3, 0)).id, 4);
+    BOOST_CHECK_EQUAL(graph.FindEdge(2, 0), SPECIAL_EDGEID);
+
+    // the compacted graph can still grow
+    graph.InsertEdge(2, 3, TestData{8});
+    BOOST_CHECK_EQUAL(graph.GetEdgeData(graph.FindEdge(2, 3)).id, 8);
+    BOOST_CHECK_EQUAL(graph.GetEdgeData(graph.FindEdge(1, 2)).id, 2);
+}
+
+BOOST_AUTO_TEST_CASE(renumber_test)
+{
+    std::vector<TestInputEdge> input_edges = {
+        TestInputEdge{0, 1, TestData{1}},
+        TestInputEdge{1, 3, TestData{2}},
+        TestInputEdge{2, 0, TestData{3}},
+        TestInputEdge{3, 1, TestData{4}}
+    };
+    TestDynamicGraph graph(4, input_edges);
+
+    // drops node 0 and 2, swaps 1 and 3
+    graph.RenumberNodes({SPECIAL_NODEID, 1, SPECIAL_NODEID, 0}, 2);
+    BOOST_CHECK_EQUAL(graph.GetNumberOfNodes(), 2);
+    BOOST_CHECK_EQUAL(graph.GetNumberOfEdges(), 2);
+    BOOST_CHECK_EQUAL(graph.GetEdgeStorageSize(), 2);
+    BOOST_CHECK_EQUAL(graph.GetEdgeData(graph.FindEdge(1, 0)).id, 2);
+    BOOST_CHECK_EQUAL(graph.GetEdgeData(graph.FindEdge(0, 1)).id, 4);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/edge_based_edge_run.hpp"
+#include "../../typedefs.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <iterator>
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(edge_based_edge_run_test)
+
+// more than one block and a partial last one
+constexpr unsigned NUM_EDGES = 2 * graph_blocks::GraphBlockSize + 123;
+
+BOOST_AUTO_TEST_CASE(round_trip_test)
+{
+    const boost::filesystem::path path =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<NodeID> node_distribution(0, 1000000);
+    std::uniform_int_distribution<int> weight_distribution(1, 100000);
+    std::uniform_int_distribution<unsigned> length_distribution(0, 50000);
+    std::bernoulli_distribution flag_distribution(0.5);
+
+    std::vector<EdgeBasedEdge> edges;
+    EdgeBasedEdgeRunWriter writer(path.string());
+    for (const auto edge_id : osrm::irange<NodeID>(0, NUM_EDGES))
+    {
+        const bool forward = flag_distribution(generator);
+        edges.emplace_back(node_distribution(generator), node_distribution(generator), edge_id,
+                           weight_distribution(generator), forward,
+                           !forward || flag_distribution(generator),
+                           length_distribution(generator));
+        writer.push_back(edges.back());
+    }
+    BOOST_CHECK_EQUAL(writer.size(), NUM_EDGES);
+    writer.Close();
+
+    std::vector<EdgeBasedEdge> read_edges;
+    {
+        EdgeBasedEdgeRun run(path.string());
+        BOOST_CHECK_EQUAL(run.size(), NUM_EDGES);
+        for (const auto &edge : run)
+        {
+            read_edges.push_back(edge);
+        }
+        // a second pass reads the file again
+        BOOST_CHECK_EQUAL(std::distance(run.begin(), run.end()), NUM_EDGES);
+    }
+    BOOST_CHECK(!boost::filesystem::exists(path));
+
+    BOOST_REQUIRE_EQUAL(read_edges.size(), edges.size());
+    for (const auto i : osrm::irange<std::size_t>(0, edges.size()))
+    {
+        BOOST_CHECK_EQUAL(read_edges[i].source, edges[i].source);
+        BOOST_CHECK_EQUAL(read_edges[i].target, edges[i].target);
+        BOOST_CHECK_EQUAL(read_edges[i].edge_id, edges[i].edge_id);
+        BOOST_CHECK_EQUAL(read_edges[i].weight, edges[i].weight);
+        BOOST_CHECK_EQUAL(read_edges[i].length, edges[i].length);
+        BOOST_CHECK_EQUAL(read_edges[i].forward, edges[i].forward);
+        BOOST_CHECK_EQUAL(read_edges[i].backward, edges[i].backward);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(empty_run_test)
+{
+    const boost::filesystem::path path =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    EdgeBasedEdgeRunWriter writer(path.string());
+    writer.Close();
+
+    EdgeBasedEdgeRun run(path.string());
+    BOOST_CHECK_EQUAL(run.size(), 0);
+    BOOST_CHECK(run.begin() == run.end());
+    run.clear();
+    BOOST_CHECK(!boost::filesystem::exists(path));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,89 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/geometry_encoding.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <limits>
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(geometry_encoding_test)
+
+BOOST_AUTO_TEST_CASE(round_trip)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<unsigned> length_distribution(0, 6);
+    std::uniform_int_distribution<int> step_distribution(-300, 300);
+
+    // mostly close ids, with a few far jumps and the extremes of the id range
+    std::vector<unsigned> geometry_offsets(1, 0);
+    std::vector<unsigned> nodes;
+    unsigned node = 1000000;
+    for (unsigned geometry = 0; geometry < 101; ++geometry)
+    {
+        const unsigned length = length_distribution(generator);
+        for (unsigned i = 0; i < length; ++i)
+        {
+            node += step_distribution(generator);
+            nodes.push_back(node);
+        }
+        geometry_offsets.push_back(static_cast<unsigned>(nodes.size()));
+    }
+    nodes.push_back(0);
+    nodes.push_back(std::numeric_limits<unsigned>::max() - 1);
+    nodes.push_back(7);
+    geometry_offsets.push_back(static_cast<unsigned>(nodes.size()));
+
+    std::vector<unsigned> block_offsets;
+    std::vector<std::uint8_t> encoded_nodes;
+    geometry_encoding::Encode(geometry_offsets,
+                              [&nodes](const unsigned i)
+                              {
+                                  return nodes[i];
+                              },
+                              block_offsets, encoded_nodes);
+    BOOST_CHECK_EQUAL(block_offsets.size(),
+                      geometry_encoding::GetNumberOfBlocks(geometry_offsets.size() - 1) + 1);
+    BOOST_CHECK_EQUAL(block_offsets.back(), encoded_nodes.size());
+    BOOST_CHECK_LT(encoded_nodes.size(), nodes.size() * sizeof(unsigned));
+
+    std::vector<unsigned> decoded;
+    for (unsigned geometry = 0; geometry + 1 < geometry_offsets.size(); ++geometry)
+    {
+        geometry_encoding::Decode(geometry_offsets.data(), block_offsets.data(),
+                                  encoded_nodes.data(), geometry, decoded);
+        const std::vector<unsigned> expected(nodes.begin() + geometry_offsets[geometry],
+                                             nodes.begin() + geometry_offsets[geometry + 1]);
+        BOOST_CHECK_EQUAL_COLLECTIONS(decoded.begin(), decoded.end(), expected.begin(),
+                                      expected.end());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,151 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/graph_blocks.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <sstream>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(graph_blocks_test)
+
+// more than one block and a partial last one
+constexpr unsigned NUM_ELEMENTS = 2 * graph_blocks::GraphBlockSize + 123;
+
+BOOST_AUTO_TEST_CASE(node_round_trip_test)
+{
+    std::mt19937 generator(23);
+    std::uniform_int_distribution<int> coordinate_distribution(-180000000, 180000000);
+    std::uniform_int_distribution<unsigned> id_distribution(1, 1000);
+    std::bernoulli_distribution flag_distribution(0.1);
+
+    std::vector<ExternalMemoryNode> nodes;
+    NodeID node_id = 0;
+    for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+    {
+        node_id += id_distribution(generator);
+        nodes.emplace_back(coordinate_distribution(generator), coordinate_distribution(generator),
+                           node_id, flag_distribution(generator), flag_distribution(generator));
+    }
+
+    std::stringstream stream;
+    graph_blocks::NodeBlockWriter writer(stream);
+    for (const auto &node : nodes)
+    {
+        writer.push_back(node);
+    }
+    writer.flush();
+
+    std::vector<ExternalMemoryNode> read_nodes, block;
+    while (read_nodes.size() < nodes.size())
+    {
+        graph_blocks::read_node_block(stream, block);
+        BOOST_REQUIRE(!block.empty());
+        read_nodes.insert(read_nodes.end(), block.begin(), block.end());
+    }
+
+    BOOST_REQUIRE_EQUAL(read_nodes.size(), nodes.size());
+    for (unsigned i = 0; i < nodes.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(read_nodes[i].node_id, nodes[i].node_id);
+        BOOST_CHECK_EQUAL(read_nodes[i].lat, nodes[i].lat);
+        BOOST_CHECK_EQUAL(read_nodes[i].lon, nodes[i].lon);
+        BOOST_CHECK_EQUAL(read_nodes[i].barrier, nodes[i].barrier);
+        BOOST_CHECK_EQUAL(read_nodes[i].traffic_lights, nodes[i].traffic_lights);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(edge_round_trip_test)
+{
+    std::mt19937 generator(29);
+    std::uniform_int_distribution<NodeID> node_distribution(0, 100000);
+    std::uniform_int_distribution<EdgeWeight> weight_distribution(1, 100000);
+    std::uniform_int_distribution<unsigned> mode_distribution(0, 15);
+    std::bernoulli_distribution flag_distribution(0.5);
+
+    std::vector<NodeBasedEdge> edges;
+    for (unsigned i = 0; i < NUM_ELEMENTS; ++i)
+    {
+        edges.emplace_back(node_distribution(generator), node_distribution(generator),
+                           node_distribution(generator), weight_distribution(generator),
+                           flag_distribution(generator), flag_distribution(generator),
+                           flag_distribution(generator), flag_distribution(generator),
+                           static_cast<TravelMode>(mode_distribution(generator)),
+                           flag_distribution(generator));
+    }
+
+    std::stringstream stream;
+    graph_blocks::EdgeBlockWriter writer(stream);
+    for (const auto &edge : edges)
+    {
+        writer.push_back(edge);
+    }
+    writer.flush();
+
+    std::vector<NodeBasedEdge> read_edges, block;
+    while (read_edges.size() < edges.size())
+    {
+        graph_blocks::read_edge_block(stream, block);
+        BOOST_REQUIRE(!block.empty());
+        read_edges.insert(read_edges.end(), block.begin(), block.end());
+    }
+
+    BOOST_REQUIRE_EQUAL(read_edges.size(), edges.size());
+    for (unsigned i = 0; i < edges.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(read_edges[i].source, edges[i].source);
+        BOOST_CHECK_EQUAL(read_edges[i].target, edges[i].target);
+        BOOST_CHECK_EQUAL(read_edges[i].name_id, edges[i].name_id);
+        BOOST_CHECK_EQUAL(read_edges[i].weight, edges[i].weight);
+        BOOST_CHECK_EQUAL(read_edges[i].forward, edges[i].forward);
+        BOOST_CHECK_EQUAL(read_edges[i].backward, edges[i].backward);
+        BOOST_CHECK_EQUAL(read_edges[i].roundabout, edges[i].roundabout);
+        BOOST_CHECK_EQUAL(read_edges[i].access_restricted, edges[i].access_restricted);
+        BOOST_CHECK_EQUAL(read_edges[i].is_split, edges[i].is_split);
+        BOOST_CHECK_EQUAL(static_cast<unsigned>(read_edges[i].travel_mode),
+                          static_cast<unsigned>(edges[i].travel_mode));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(truncated_block_test)
+{
+    std::stringstream stream;
+    graph_blocks::NodeBlockWriter writer(stream);
+    writer.push_back(ExternalMemoryNode(1, 2, 3, false, true));
+    writer.flush();
+
+    std::string data = stream.str();
+    data.resize(data.size() - 1);
+    std::stringstream truncated_stream(data);
+    std::vector<ExternalMemoryNode> block;
+    BOOST_CHECK_THROW(graph_blocks::read_node_block(truncated_stream, block), osrm::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/heap_pool.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <memory>
+
+namespace
+{
+struct TestHeap
+{
+    explicit TestHeap(std::size_t capacity) : capacity(capacity) {}
+    std::size_t Capacity() const { return capacity; }
+    std::size_t capacity;
+};
+using TestPool = HeapPool<TestHeap>;
+}
+
+BOOST_AUTO_TEST_SUITE(heap_pool)
+
+BOOST_AUTO_TEST_CASE(heaps_are_reused_last_in_first_out)
+{
+    TestPool pool(2, 100, std::chrono::minutes(1));
+    const auto now = TestPool::Clock::now();
+    BOOST_CHECK(!pool.Checkout(now));
+
+    pool.Checkin(std::unique_ptr<TestHeap>(new TestHeap(1)), now);
+    pool.Checkin(std::unique_ptr<TestHeap>(new TestHeap(2)), now);
+    // the pool is full
+    pool.Checkin(std::unique_ptr<TestHeap>(new TestHeap(3)), now);
+    BOOST_CHECK_EQUAL(pool.NumberOfIdleHeaps(), 2);
+
+    BOOST_CHECK_EQUAL(pool.Checkout(now)->Capacity(), 2);
+    BOOST_CHECK_EQUAL(pool.Checkout(now)->Capacity(), 1);
+    BOOST_CHECK(!pool.Checkout(now));
+}
+
+BOOST_AUTO_TEST_CASE(grown_heaps_are_not_pooled)
+{
+    TestPool pool(4, 100, std::chrono::minutes(1));
+    pool.Checkin(std::unique_ptr<TestHeap>(new TestHeap(100)));
+    pool.Checkin(std::unique_ptr<TestHeap>(new TestHeap(101)));
+    pool.Checkin(std::unique_ptr<TestHeap>());
+    BOOST_CHECK_EQUAL(pool.NumberOfIdleHeaps(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(idle_heaps_are_freed)
+{
+    TestPool pool(4, 100, std::chrono::seconds(10));
+    const auto start = TestPool::Clock::now();
+    pool.Checkin(std::unique_ptr<TestHeap>(new TestHeap(1)), start);
+    pool.Checkin(std::unique_ptr<TestHeap>(new TestHeap(2)), start + std::chrono::seconds(5));
+
+    pool.Shrink(start + std::chrono::seconds(10));
+    BOOST_CHECK_EQUAL(pool.NumberOfIdleHeaps(), 2);
+    pool.Shrink(start + std::chrono::seconds(11));
+    BOOST_CHECK_EQUAL(pool.NumberOfIdleHeaps(), 1);
+    // checking out frees expired heaps as well
+    BOOST_CHECK(!pool.Checkout(start + std::chrono::seconds(16)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
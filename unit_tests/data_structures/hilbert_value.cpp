@@ -0,0 +1,76 @@
+/*
+
+Copyright (c) 2014, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/hilbert_value.hpp"
+
+#include <osrm/coordinate.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(hilbert_value)
+
+// The values of the cells of a 16 x 16 grid in the corner of the coordinate range are the first
+// 256 values of the curve, and consecutive values belong to neighbouring cells.
+BOOST_AUTO_TEST_CASE(walks_neighbouring_cells)
+{
+    const int lat_origin = -static_cast<int>(90 * COORDINATE_PRECISION);
+    const int lon_origin = -static_cast<int>(180 * COORDINATE_PRECISION);
+    HilbertCode get_hilbert_number;
+
+    std::vector<std::pair<uint64_t, std::pair<int, int>>> cells;
+    for (int lat = 0; lat < 16; ++lat)
+    {
+        for (int lon = 0; lon < 16; ++lon)
+        {
+            const uint64_t value =
+                get_hilbert_number(FixedPointCoordinate(lat_origin + lat, lon_origin + lon));
+            cells.emplace_back(value, std::make_pair(lat, lon));
+        }
+    }
+    std::sort(cells.begin(), cells.end());
+
+    for (unsigned i = 0; i < cells.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(cells[i].first, i);
+        if (i > 0)
+        {
+            const auto &previous = cells[i - 1].second;
+            const auto &current = cells[i].second;
+            BOOST_CHECK_EQUAL(std::abs(previous.first - current.first) +
+                                  std::abs(previous.second - current.second),
+                              1);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
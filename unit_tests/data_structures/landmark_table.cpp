@@ -0,0 +1,231 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/landmark_table.hpp"
+#include "../../data_structures/query_edge.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(landmark_table)
+
+constexpr unsigned NUM_NODES = 120;
+// the last nodes form a second component
+constexpr unsigned FIRST_ISOLATED_NODE = 110;
+constexpr unsigned NUM_LANDMARKS = 4;
+
+struct CoreArc
+{
+    NodeID source;
+    NodeID target;
+    EdgeWeight weight;
+};
+
+struct TestGraph
+{
+    TestGraph()
+    {
+        std::mt19937 generator(37);
+        std::uniform_int_distribution<unsigned> first_component(0, FIRST_ISOLATED_NODE - 1);
+        std::uniform_int_distribution<unsigned> second_component(FIRST_ISOLATED_NODE,
+                                                                 NUM_NODES - 1);
+        std::uniform_int_distribution<int> weight(1, 100);
+        std::uniform_int_distribution<int> direction(0, 2);
+
+        const auto add_edge = [&](const NodeID source, const NodeID target)
+        {
+            if (source == target)
+            {
+                return;
+            }
+            QueryEdge edge;
+            edge.source = source;
+            edge.target = target;
+            edge.data.distance = weight(generator);
+            edge.data.id = 0;
+            edge.data.shortcut = false;
+            const int flags = direction(generator);
+            edge.data.forward = flags != 1;
+            edge.data.backward = flags != 0;
+            edges.push_back(edge);
+        };
+        for (unsigned i = 0; i < 4 * FIRST_ISOLATED_NODE; ++i)
+        {
+            add_edge(first_component(generator), first_component(generator));
+        }
+        for (unsigned i = 0; i < 20; ++i)
+        {
+            add_edge(second_component(generator), second_component(generator));
+        }
+
+        // every fifth node was contracted
+        is_core_node.resize(NUM_NODES);
+        for (NodeID node = 0; node < NUM_NODES; ++node)
+        {
+            is_core_node[node] = node % 5 != 0;
+        }
+
+        for (const auto &edge : edges)
+        {
+            if (!is_core_node[edge.source] || !is_core_node[edge.target])
+            {
+                continue;
+            }
+            if (edge.data.forward)
+            {
+                arcs.push_back({edge.source, edge.target, edge.data.distance});
+            }
+            if (edge.data.backward)
+            {
+                arcs.push_back({edge.target, edge.source, edge.data.distance});
+            }
+        }
+    }
+
+    // Bellman-Ford on the core arcs
+    std::vector<EdgeWeight> Distances(const NodeID from, const bool reverse) const
+    {
+        std::vector<EdgeWeight> distances(NUM_NODES, INVALID_EDGE_WEIGHT);
+        distances[from] = 0;
+        for (unsigned round = 0; round < NUM_NODES; ++round)
+        {
+            for (const auto &arc : arcs)
+            {
+                const NodeID u = reverse ? arc.target : arc.source;
+                const NodeID v = reverse ? arc.source : arc.target;
+                if (INVALID_EDGE_WEIGHT != distances[u] && distances[u] + arc.weight < distances[v])
+                {
+                    distances[v] = distances[u] + arc.weight;
+                }
+            }
+        }
+        return distances;
+    }
+
+    std::vector<QueryEdge> edges;
+    std::vector<bool> is_core_node;
+    std::vector<CoreArc> arcs;
+};
+
+BOOST_AUTO_TEST_CASE(distances_match_core_search)
+{
+    const TestGraph graph;
+    const std::string landmark_path = "test_landmarks.landmarks";
+    LandmarkTable<>::Build(graph.edges, graph.is_core_node, NUM_LANDMARKS, landmark_path);
+    const LandmarkTable<> table(landmark_path);
+
+    BOOST_CHECK_EQUAL(table.GetNumberOfLandmarks(), NUM_LANDMARKS);
+    BOOST_CHECK(nullptr == table.GetDistances(0));
+    BOOST_CHECK(nullptr == table.GetDistances(NUM_NODES));
+
+    // the distance of a landmark to itself is 0 in both directions
+    std::vector<NodeID> landmarks;
+    for (NodeID node = 0; node < NUM_NODES; ++node)
+    {
+        const EdgeWeight *distances = table.GetDistances(node);
+        BOOST_CHECK_EQUAL(nullptr != distances, graph.is_core_node[node]);
+        for (unsigned i = 0; nullptr != distances && i < NUM_LANDMARKS; ++i)
+        {
+            if (0 == distances[i])
+            {
+                BOOST_CHECK_EQUAL(distances[NUM_LANDMARKS + i], 0);
+                landmarks.push_back(node);
+            }
+        }
+    }
+    BOOST_REQUIRE_EQUAL(landmarks.size(), NUM_LANDMARKS);
+
+    for (unsigned i = 0; i < NUM_LANDMARKS; ++i)
+    {
+        NodeID landmark = SPECIAL_NODEID;
+        for (const auto node : landmarks)
+        {
+            if (0 == table.GetDistances(node)[i])
+            {
+                landmark = node;
+            }
+        }
+        BOOST_REQUIRE(SPECIAL_NODEID != landmark);
+        const auto from_landmark = graph.Distances(landmark, false);
+        const auto to_landmark = graph.Distances(landmark, true);
+        for (NodeID node = 0; node < NUM_NODES; ++node)
+        {
+            const EdgeWeight *distances = table.GetDistances(node);
+            if (nullptr == distances)
+            {
+                continue;
+            }
+            BOOST_CHECK_EQUAL(distances[i], from_landmark[node]);
+            BOOST_CHECK_EQUAL(distances[NUM_LANDMARKS + i], to_landmark[node]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(potential_is_feasible)
+{
+    const TestGraph graph;
+    const std::string landmark_path = "test_landmarks.landmarks";
+    LandmarkTable<>::Build(graph.edges, graph.is_core_node, NUM_LANDMARKS, landmark_path);
+    const LandmarkTable<> table(landmark_path);
+
+    std::mt19937 generator(11);
+    std::uniform_int_distribution<unsigned> node_distribution(0, NUM_NODES - 1);
+    std::uniform_int_distribution<int> key_distribution(-50, 200);
+    const auto random_entry_points = [&](const unsigned count)
+    {
+        std::vector<LandmarkPotential::EntryPoint> entry_points;
+        while (entry_points.size() < count)
+        {
+            const EdgeWeight *distances = table.GetDistances(node_distribution(generator));
+            if (nullptr != distances)
+            {
+                entry_points.emplace_back(distances, key_distribution(generator));
+            }
+        }
+        return entry_points;
+    };
+
+    for (unsigned query = 0; query < 50; ++query)
+    {
+        const LandmarkPotential potential(NUM_LANDMARKS, random_entry_points(1 + query % 3),
+                                          random_entry_points(1 + query % 4));
+        // reduced weights of both searches are non-negative iff p(u) - p(v) <= w(u,v)
+        for (const auto &arc : graph.arcs)
+        {
+            const int source_potential =
+                potential.GetForwardPotential(table.GetDistances(arc.source));
+            const int target_potential =
+                potential.GetForwardPotential(table.GetDistances(arc.target));
+            BOOST_CHECK_LE(source_potential - target_potential, arc.weight);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
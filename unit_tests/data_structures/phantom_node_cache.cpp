@@ -0,0 +1,137 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../data_structures/phantom_node_cache.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <osrm/coordinate.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(phantom_node_cache)
+
+namespace
+{
+std::vector<PhantomNode> MakePhantomNodes(const unsigned first_node_id, const unsigned count)
+{
+    std::vector<PhantomNode> phantom_nodes(count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        phantom_nodes[i].forward_node_id = first_node_id + i;
+    }
+    return phantom_nodes;
+}
+}
+
+BOOST_AUTO_TEST_CASE(miss_insert_hit)
+{
+    PhantomNodeCache cache(64, 4);
+    const FixedPointCoordinate coordinate(52517037, 13388860);
+
+    std::vector<PhantomNode> result;
+    BOOST_CHECK(!cache.Fetch(coordinate, 2, result));
+    cache.Insert(coordinate, 2, MakePhantomNodes(10, 2));
+
+    // hits are appended like the results of the r-tree
+    result = MakePhantomNodes(0, 1);
+    BOOST_CHECK(cache.Fetch(coordinate, 2, result));
+    BOOST_REQUIRE_EQUAL(result.size(), 3);
+    BOOST_CHECK_EQUAL(result[1].forward_node_id, 10);
+    BOOST_CHECK_EQUAL(result[2].forward_node_id, 11);
+
+    // a different number of results or a neighbouring coordinate is a miss
+    result.clear();
+    BOOST_CHECK(!cache.Fetch(coordinate, 1, result));
+    BOOST_CHECK(!cache.Fetch(FixedPointCoordinate(52517037, 13388861), 2, result));
+    BOOST_CHECK(!cache.Fetch(FixedPointCoordinate(-52517037, -13388860), 2, result));
+    BOOST_CHECK(result.empty());
+
+    // empty results are cached as well
+    cache.Insert(FixedPointCoordinate(0, 0), 1, {});
+    BOOST_CHECK(cache.Fetch(FixedPointCoordinate(0, 0), 1, result));
+    BOOST_CHECK(result.empty());
+    BOOST_CHECK_EQUAL(cache.Size(), 2);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+    BOOST_CHECK(!cache.Fetch(coordinate, 2, result));
+}
+
+BOOST_AUTO_TEST_CASE(bounded_size)
+{
+    PhantomNodeCache cache(8, 2);
+    for (int i = 0; i < 100; ++i)
+    {
+        cache.Insert(FixedPointCoordinate(i, i), 1, MakePhantomNodes(i, 1));
+    }
+    BOOST_CHECK_LE(cache.Size(), 8);
+
+    std::vector<PhantomNode> result;
+    BOOST_CHECK(cache.Fetch(FixedPointCoordinate(99, 99), 1, result));
+    BOOST_CHECK(!cache.Fetch(FixedPointCoordinate(0, 0), 1, result));
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_access)
+{
+    PhantomNodeCache cache(256, 4);
+    // Boost.Test assertions are not thread-safe, the threads only count wrong hits
+    std::atomic<unsigned> wrong_hits(0);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&cache, &wrong_hits]
+                             {
+                                 for (int i = 0; i < 1000; ++i)
+                                 {
+                                     const FixedPointCoordinate coordinate(i % 64, i % 64);
+                                     std::vector<PhantomNode> result;
+                                     if (!cache.Fetch(coordinate, 1, result))
+                                     {
+                                         cache.Insert(coordinate, 1, MakePhantomNodes(i % 64, 1));
+                                     }
+                                     else if (result.size() != 1 ||
+                                              result.front().forward_node_id !=
+                                                  static_cast<unsigned>(i % 64))
+                                     {
+                                         ++wrong_hits;
+                                     }
+                                 }
+                             });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(wrong_hits, 0);
+    BOOST_CHECK_EQUAL(cache.Size(), 64);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,151 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../server/data_structures/query_epochs.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(query_epochs)
+
+BOOST_AUTO_TEST_CASE(retire_without_readers)
+{
+    QueryEpochs epochs;
+    bool released = false;
+    epochs.Retire([&]()
+                  {
+                      released = true;
+                  });
+    BOOST_CHECK(released);
+    BOOST_CHECK(!epochs.HasRetired());
+    BOOST_CHECK_EQUAL(epochs.Epoch(), 2);
+}
+
+BOOST_AUTO_TEST_CASE(retired_object_outlives_pinned_reader)
+{
+    QueryEpochs epochs;
+    bool released = false;
+
+    auto guard = epochs.Pin();
+    epochs.Retire([&]()
+                  {
+                      released = true;
+                  });
+    BOOST_CHECK(!released);
+    BOOST_CHECK(epochs.HasRetired());
+
+    guard.Release();
+    epochs.Collect();
+    BOOST_CHECK(released);
+    BOOST_CHECK(!epochs.HasRetired());
+}
+
+BOOST_AUTO_TEST_CASE(later_readers_do_not_hold_back_release)
+{
+    QueryEpochs epochs;
+    std::atomic<bool> reader_pinned(false);
+    std::atomic<bool> stop_reader(false);
+    bool released = false;
+
+    // pinned after the retirement, it can not see the retired object
+    epochs.Retire([]()
+                  {
+                  });
+    std::thread reader([&]()
+                       {
+                           const auto guard = epochs.Pin();
+                           reader_pinned = true;
+                           while (!stop_reader)
+                           {
+                               std::this_thread::yield();
+                           }
+                       });
+    while (!reader_pinned)
+    {
+        std::this_thread::yield();
+    }
+    epochs.Retire([&]()
+                  {
+                      released = true;
+                  });
+    BOOST_CHECK(!released);
+
+    stop_reader = true;
+    reader.join();
+    epochs.Collect();
+    BOOST_CHECK(released);
+}
+
+BOOST_AUTO_TEST_CASE(readers_never_see_released_objects)
+{
+    QueryEpochs epochs;
+    std::atomic<int *> current(new int(0));
+    std::atomic<bool> stop(false);
+    std::atomic<bool> saw_released(false);
+
+    std::vector<std::thread> readers;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        readers.emplace_back([&]()
+                             {
+                                 while (!stop)
+                                 {
+                                     const auto guard = epochs.Pin();
+                                     const int *value = current.load();
+                                     if (*value < 0)
+                                     {
+                                         saw_released = true;
+                                     }
+                                 }
+                             });
+    }
+    for (int i = 1; i <= 200; ++i)
+    {
+        int *previous = current.exchange(new int(i));
+        epochs.Retire([previous]()
+                      {
+                          // poison before freeing, a reader still using it would notice
+                          *previous = -1;
+                          delete previous;
+                      });
+    }
+    stop = true;
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+    epochs.Collect();
+    BOOST_CHECK(!saw_released);
+    BOOST_CHECK(!epochs.HasRetired());
+    delete current.load();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
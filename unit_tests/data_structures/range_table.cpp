@@ -31,7 +31,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/test/unit_test.hpp>
 #include <boost/test/test_case_template.hpp>
 
+#include <algorithm>
+#include <iterator>
 #include <numeric>
+#include <random>
+#include <vector>
 
 constexpr unsigned BLOCK_SIZE = 16;
 typedef RangeTable<BLOCK_SIZE, false> TestRangeTable;
@@ -129,4 +133,50 @@ BOOST_AUTO_TEST_CASE(construction_test)
     ConstructionTest(multiple_lengths, multiple_offsets);
 }
 
+template <typename TableT> void BatchLookupTest(const unsigned num_ranges)
+{
+    // Choosen by a fair W20 dice roll
+    std::mt19937 g(7);
+    std::uniform_int_distribution<unsigned> length_dist(0, 255);
+    std::vector<unsigned> lengths(num_ranges);
+    std::vector<unsigned> offsets(num_ranges + 1, 0);
+    for (unsigned i = 0; i < num_ranges; ++i)
+    {
+        lengths[i] = length_dist(g);
+        offsets[i + 1] = offsets[i] + lengths[i];
+    }
+    TableT table(lengths);
+
+    std::vector<unsigned> ids(num_ranges);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::vector<unsigned> shuffled_ids = ids;
+    std::shuffle(shuffled_ids.begin(), shuffled_ids.end(), g);
+
+    for (const auto &id_list : {ids, shuffled_ids})
+    {
+        std::vector<typename TableT::RangeT> ranges;
+        table.GetRanges(id_list.begin(), id_list.end(), std::back_inserter(ranges));
+        BOOST_REQUIRE_EQUAL(ranges.size(), id_list.size());
+        for (unsigned i = 0; i < id_list.size(); ++i)
+        {
+            const unsigned id = id_list[i];
+            const auto range = table.GetRange(id);
+            BOOST_CHECK_EQUAL(ranges[i].front(), offsets[id]);
+            BOOST_CHECK_EQUAL(ranges[i].size(), lengths[id]);
+            BOOST_CHECK_EQUAL(ranges[i].front(), range.front());
+            BOOST_CHECK_EQUAL(ranges[i].size(), range.size());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(batch_lookup_test)
+{
+    // the vectorized default block and the generic prefix sums
+    BatchLookupTest<TestRangeTable>(1);
+    BatchLookupTest<TestRangeTable>(BLOCK_SIZE + 1);
+    BatchLookupTest<TestRangeTable>((BLOCK_SIZE + 1) * 20 + 5);
+    BatchLookupTest<RangeTable<7, false>>(8);
+    BatchLookupTest<RangeTable<7, false>>(8 * 20 + 3);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
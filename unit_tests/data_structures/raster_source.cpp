@@ -34,6 +34,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <vector>
+
 BOOST_AUTO_TEST_SUITE(raster_source)
 
 int normalize(double coord) { return static_cast<int>(coord * COORDINATE_PRECISION); }
@@ -107,4 +109,66 @@ BOOST_AUTO_TEST_CASE(raster_test)
         osrm::exception);
 }
 
+BOOST_AUTO_TEST_CASE(batch_interpolate_test)
+{
+    SourceContainer sources;
+    int source_id = sources.loadRasterSource("../unit_tests/fixtures/raster_data.asc", 0, 0.09, 0,
+                                             0.09, 10, 10);
+
+    std::vector<int> lons, lats;
+    for (int lon = -1000; lon <= 10000; lon += 37)
+    {
+        for (int lat = -1000; lat <= 10000; lat += 41)
+        {
+            lons.push_back(lon * 10);
+            lats.push_back(lat * 10);
+        }
+    }
+
+    std::vector<RasterDatum> results;
+    sources.getRasterInterpolateBatchFromSource(source_id, lons, lats, results);
+    BOOST_REQUIRE_EQUAL(results.size(), lons.size());
+    for (std::size_t i = 0; i < lons.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(results[i].datum,
+                          sources.getRasterInterpolateFromSource(source_id, lons[i], lats[i]).datum);
+    }
+
+    BOOST_CHECK_THROW(sources.getRasterInterpolateBatchFromSource(1, lons, lats, results),
+                      osrm::exception);
+}
+
+BOOST_AUTO_TEST_CASE(tiled_raster_test)
+{
+    const auto tiled_path =
+        boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    // the tiles do not divide the raster to cover the padding at the borders
+    TiledRasterFile::Write("../unit_tests/fixtures/raster_data.asc", 10, 10, tiled_path, 4);
+    BOOST_CHECK(TiledRasterFile::IsTiledRaster(tiled_path));
+    BOOST_CHECK(!TiledRasterFile::IsTiledRaster("../unit_tests/fixtures/raster_data.asc"));
+
+    SourceContainer sources;
+    BOOST_CHECK_EQUAL(sources.loadRasterSource("../unit_tests/fixtures/raster_data.asc", 0, 0.09,
+                                               0, 0.09, 10, 10),
+                      0);
+    BOOST_CHECK_EQUAL(sources.loadRasterSource(tiled_path.string(), 0, 0.09, 0, 0.09, 10, 10), 1);
+
+    for (int lon = -100; lon <= 1000; lon += 7)
+    {
+        for (int lat = -100; lat <= 1000; lat += 7)
+        {
+            BOOST_CHECK_EQUAL(sources.getRasterDataFromSource(0, lon * 100, lat * 100).datum,
+                              sources.getRasterDataFromSource(1, lon * 100, lat * 100).datum);
+            BOOST_CHECK_EQUAL(sources.getRasterInterpolateFromSource(0, lon * 100, lat * 100).datum,
+                              sources.getRasterInterpolateFromSource(1, lon * 100, lat * 100).datum);
+        }
+    }
+
+    SourceContainer other_sources;
+    BOOST_CHECK_THROW(other_sources.loadRasterSource(tiled_path.string(), 0, 0.09, 0, 0.09, 7, 7),
+                      osrm::exception);
+
+    boost::filesystem::remove(tiled_path);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
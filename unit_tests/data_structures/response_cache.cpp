@@ -0,0 +1,158 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../server/response_cache.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(response_cache)
+
+namespace
+{
+ResponseCache::EntryPointer MakeEntry(const std::string &body)
+{
+    auto entry = std::make_shared<ResponseCache::Entry>();
+    entry->headers.emplace_back("Content-Type", "application/json; charset=UTF-8");
+    entry->content.assign(body.begin(), body.end());
+    return entry;
+}
+}
+
+BOOST_AUTO_TEST_CASE(lru_eviction_and_refresh)
+{
+    LRUCache<int, int> cache(2);
+    cache.Insert(1, 10);
+    cache.Insert(2, 20);
+    cache.Insert(1, 11);
+    BOOST_CHECK_EQUAL(cache.Size(), 2);
+
+    // 2 is the least recently used entry now
+    cache.Insert(3, 30);
+    int value = 0;
+    BOOST_CHECK(!cache.Fetch(2, value));
+    BOOST_CHECK(cache.Fetch(1, value));
+    BOOST_CHECK_EQUAL(value, 11);
+    BOOST_CHECK(cache.Fetch(3, value));
+    BOOST_CHECK_EQUAL(value, 30);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+    BOOST_CHECK(!cache.Holds(1));
+}
+
+BOOST_AUTO_TEST_CASE(miss_publish_hit)
+{
+    ResponseCache cache(64, 4);
+    {
+        ResponseCache::Lease lease;
+        BOOST_CHECK(!cache.Fetch("1 0/viaroute?loc=1,2&loc=3,4", 1, lease));
+        BOOST_CHECK(lease.Leader());
+        lease.Publish(MakeEntry("{}"));
+        BOOST_CHECK(!lease.Leader());
+    }
+
+    ResponseCache::Lease lease;
+    const auto entry = cache.Fetch("1 0/viaroute?loc=1,2&loc=3,4", 1, lease);
+    BOOST_REQUIRE(entry);
+    BOOST_CHECK(!lease.Leader());
+    BOOST_CHECK_EQUAL(std::string(entry->content.begin(), entry->content.end()), "{}");
+    BOOST_CHECK_EQUAL(entry->headers.size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(unpublished_lease_is_not_cached)
+{
+    ResponseCache cache(64, 4);
+    {
+        ResponseCache::Lease lease;
+        BOOST_CHECK(!cache.Fetch("key", 1, lease));
+        BOOST_CHECK(lease.Leader());
+    }
+    ResponseCache::Lease lease;
+    BOOST_CHECK(!cache.Fetch("key", 1, lease));
+    BOOST_CHECK(lease.Leader());
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(new_data_version_drops_entries)
+{
+    ResponseCache cache(64, 4);
+    {
+        ResponseCache::Lease lease;
+        cache.Fetch("1 key", 1, lease);
+        lease.Publish(MakeEntry("old"));
+    }
+    BOOST_CHECK_EQUAL(cache.Size(), 1);
+
+    ResponseCache::Lease lease;
+    BOOST_CHECK(!cache.Fetch("2 key", 2, lease));
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_requests_are_coalesced)
+{
+    ResponseCache cache(64, 4);
+    ResponseCache::Lease leader;
+    BOOST_REQUIRE(!cache.Fetch("key", 1, leader));
+    BOOST_REQUIRE(leader.Leader());
+
+    std::atomic<unsigned> hits(0);
+    std::atomic<unsigned> leaders(0);
+    std::vector<std::thread> followers;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        followers.emplace_back([&]()
+                               {
+                                   ResponseCache::Lease lease;
+                                   if (cache.Fetch("key", 1, lease))
+                                   {
+                                       ++hits;
+                                   }
+                                   if (lease.Leader())
+                                   {
+                                       ++leaders;
+                                   }
+                               });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    leader.Publish(MakeEntry("shared"));
+    for (auto &follower : followers)
+    {
+        follower.join();
+    }
+    BOOST_CHECK_EQUAL(hits, 4);
+    BOOST_CHECK_EQUAL(leaders, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,84 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/restriction_map.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(restriction_map)
+
+constexpr unsigned NUM_NODES = 30;
+
+BOOST_AUTO_TEST_CASE(empty_index_test)
+{
+    const RestrictionIndex index = RestrictionMap().BuildIndex();
+    BOOST_CHECK_EQUAL(index.size(), 0);
+    BOOST_CHECK_EQUAL(index.CheckForEmanatingIsOnlyTurn(0, 1), SPECIAL_NODEID);
+    BOOST_CHECK(!index.CheckIfTurnIsRestricted(0, 1, 2));
+}
+
+BOOST_AUTO_TEST_CASE(index_matches_map_test)
+{
+    std::mt19937 generator(17);
+    std::uniform_int_distribution<unsigned> node_distribution(0, NUM_NODES - 1);
+    std::bernoulli_distribution only_distribution(0.2);
+
+    std::vector<TurnRestriction> restriction_list;
+    for (unsigned i = 0; i < 150; ++i)
+    {
+        TurnRestriction restriction(only_distribution(generator));
+        restriction.from.node = node_distribution(generator);
+        restriction.via.node = node_distribution(generator);
+        restriction.to.node = node_distribution(generator);
+        restriction_list.push_back(restriction);
+    }
+
+    const RestrictionMap map(restriction_list);
+    const RestrictionIndex index = map.BuildIndex();
+    BOOST_CHECK_EQUAL(index.size(), map.size());
+
+    // nodes past the largest start node of a restriction are looked up as well
+    for (NodeID u = 0; u < NUM_NODES + 2; ++u)
+    {
+        for (NodeID v = 0; v < NUM_NODES + 2; ++v)
+        {
+            BOOST_CHECK_EQUAL(index.CheckForEmanatingIsOnlyTurn(u, v),
+                              map.CheckForEmanatingIsOnlyTurn(u, v));
+            for (NodeID w = 0; w < NUM_NODES + 2; ++w)
+            {
+                BOOST_CHECK_EQUAL(index.CheckIfTurnIsRestricted(u, v, w),
+                                  map.CheckIfTurnIsRestricted(u, v, w));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
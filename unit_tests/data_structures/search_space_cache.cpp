@@ -0,0 +1,94 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/search_space_cache.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(search_space_cache)
+
+namespace
+{
+SearchSpaceCache::EntryPointer MakeEntry(const NodeID node, const unsigned check_sum)
+{
+    auto entry = std::make_shared<SearchSpaceCache::Entry>();
+    entry->phantom_node.forward_node_id = node;
+    entry->phantom_node.reverse_node_id = node + 1;
+    entry->phantom_node.forward_weight = 10;
+    entry->phantom_node.reverse_weight = 20;
+    entry->phantom_node.forward_offset = 0;
+    entry->phantom_node.reverse_offset = 0;
+    entry->check_sum = check_sum;
+    entry->forward_search_space.nodes = {node};
+    entry->forward_search_space.distances = {-10};
+    entry->backward_search_space.nodes = {node + 1};
+    entry->backward_search_space.distances = {20};
+    return entry;
+}
+}
+
+BOOST_AUTO_TEST_CASE(miss_insert_hit)
+{
+    SearchSpaceCache cache(64, 4);
+    const auto entry = MakeEntry(10, 3);
+
+    SearchSpaceCache::EntryPointer result;
+    BOOST_CHECK(!cache.Fetch(entry->phantom_node, 3, result));
+    cache.Insert(entry);
+    BOOST_CHECK(cache.Fetch(entry->phantom_node, 3, result));
+    BOOST_CHECK(result == entry);
+
+    // other data or another position on the same edge is a miss
+    BOOST_CHECK(!cache.Fetch(entry->phantom_node, 4, result));
+    PhantomNode moved_phantom_node = entry->phantom_node;
+    moved_phantom_node.forward_weight = 11;
+    BOOST_CHECK(!cache.Fetch(moved_phantom_node, 3, result));
+    BOOST_CHECK_EQUAL(cache.Size(), 1);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+    BOOST_CHECK(!cache.Fetch(entry->phantom_node, 3, result));
+}
+
+BOOST_AUTO_TEST_CASE(bounded_size)
+{
+    SearchSpaceCache cache(8, 2);
+    for (NodeID node = 0; node < 200; node += 2)
+    {
+        cache.Insert(MakeEntry(node, 1));
+    }
+    BOOST_CHECK_LE(cache.Size(), 8);
+
+    SearchSpaceCache::EntryPointer result;
+    BOOST_CHECK(cache.Fetch(MakeEntry(198, 1)->phantom_node, 1, result));
+    BOOST_CHECK(!cache.Fetch(MakeEntry(0, 1)->phantom_node, 1, result));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
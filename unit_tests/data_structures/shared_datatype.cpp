@@ -0,0 +1,159 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../server/data_structures/shared_datatype.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(shared_datatype)
+
+BOOST_AUTO_TEST_CASE(graph_and_static_blocks_are_laid_out_separately)
+{
+    SharedDataLayout layout;
+    layout.SetBlockSize<unsigned>(SharedDataLayout::NAME_OFFSETS, 10);
+    layout.SetBlockSize<unsigned>(SharedDataLayout::GRAPH_NODE_LIST, 20);
+    layout.SetBlockSize<unsigned>(SharedDataLayout::GRAPH_EDGE_LIST, 30);
+    layout.SetBlockSize<unsigned>(SharedDataLayout::COORDINATE_LIST, 40);
+    layout.SetBlockSize<unsigned>(SharedDataLayout::HSGR_CHECKSUM, 1);
+
+    // the first block of each region starts on the first cache line behind the leading canary
+    const uint64_t alignment = SharedDataLayout::BLOCK_ALIGNMENT;
+    BOOST_CHECK_EQUAL(layout.GetBlockOffset(SharedDataLayout::NAME_OFFSETS), alignment);
+    BOOST_CHECK_EQUAL(layout.GetBlockOffset(SharedDataLayout::GRAPH_NODE_LIST), alignment);
+    BOOST_CHECK_EQUAL(layout.GetBlockOffset(SharedDataLayout::GRAPH_EDGE_LIST),
+                      SharedDataLayout::AlignBlock(alignment + 20 * sizeof(unsigned) +
+                                                   2 * sizeof(CANARY)));
+    for (auto i = 0; i < SharedDataLayout::NUM_BLOCKS; ++i)
+    {
+        const auto bid = static_cast<SharedDataLayout::BlockID>(i);
+        BOOST_CHECK_EQUAL(layout.GetBlockOffset(bid) % alignment, 0);
+    }
+
+    std::vector<char> graph_region(layout.GetSizeOfLayout(true));
+    std::vector<char> static_region(layout.GetSizeOfLayout(false));
+    for (auto i = 0; i < SharedDataLayout::NUM_BLOCKS; ++i)
+    {
+        const auto bid = static_cast<SharedDataLayout::BlockID>(i);
+        auto &region = SharedDataLayout::IsGraphBlock(bid) ? graph_region : static_region;
+        unsigned *block = layout.GetBlockPtr<unsigned, true>(region.data(), bid);
+        std::fill(block, block + layout.num_entries[bid], i);
+    }
+    // writing all blocks must not have clobbered any canary
+    for (auto i = 0; i < SharedDataLayout::NUM_BLOCKS; ++i)
+    {
+        const auto bid = static_cast<SharedDataLayout::BlockID>(i);
+        auto &region = SharedDataLayout::IsGraphBlock(bid) ? graph_region : static_region;
+        BOOST_CHECK_NO_THROW(layout.GetBlockPtr<unsigned>(region.data(), bid));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(packed_blocks_are_sized_in_words)
+{
+    SharedDataLayout layout;
+    layout.SetBlockSize<uint64_t>(SharedDataLayout::CORE_MARKER, 449);
+    layout.SetBlockSize<uint64_t>(SharedDataLayout::TRAVEL_MODE, 17);
+    layout.SetBlockSize<uint64_t>(SharedDataLayout::TURN_INSTRUCTION, 12);
+    layout.SetBlockSize<uint64_t>(SharedDataLayout::NAME_ID_RUN_STARTS, 449);
+
+    // two cache lines of flags, two words of 4 bit and one word of 5 bit values
+    BOOST_CHECK_EQUAL(layout.GetBlockSize(SharedDataLayout::CORE_MARKER), 16 * sizeof(uint64_t));
+    BOOST_CHECK_EQUAL(layout.GetBlockSize(SharedDataLayout::TRAVEL_MODE), 2 * sizeof(uint64_t));
+    BOOST_CHECK_EQUAL(layout.GetBlockSize(SharedDataLayout::TURN_INSTRUCTION),
+                      sizeof(uint64_t));
+    BOOST_CHECK_EQUAL(layout.GetBlockSize(SharedDataLayout::NAME_ID_RUN_STARTS),
+                      16 * sizeof(uint64_t));
+}
+
+BOOST_AUTO_TEST_CASE(image_regions_are_page_aligned_and_disjoint)
+{
+    SharedDataLayout layout;
+    layout.SetBlockSize<unsigned>(SharedDataLayout::GRAPH_NODE_LIST, 1000);
+    layout.SetBlockSize<char>(SharedDataLayout::NAME_CHAR_LIST, 3);
+
+    BOOST_CHECK_EQUAL(SharedDataImage::DataOffset() % 4096, 0);
+    BOOST_CHECK_GE(SharedDataImage::DataOffset(), sizeof(SharedDataLayout));
+    BOOST_CHECK_EQUAL(SharedDataImage::StaticOffset(layout) % 4096, 0);
+    BOOST_CHECK_GE(SharedDataImage::StaticOffset(layout),
+                   SharedDataImage::DataOffset() + layout.GetSizeOfLayout(true));
+    BOOST_CHECK_EQUAL(SharedDataImage::Size(layout),
+                      SharedDataImage::StaticOffset(layout) + layout.GetSizeOfLayout(false));
+}
+
+BOOST_AUTO_TEST_CASE(blocks_are_found_by_name)
+{
+    for (auto i = 0; i < SharedDataLayout::NUM_BLOCKS; ++i)
+    {
+        const auto bid = static_cast<SharedDataLayout::BlockID>(i);
+        BOOST_CHECK_EQUAL(SharedDataLayout::FindBlock(SharedDataLayout::GetBlockName(bid)), bid);
+    }
+    BOOST_CHECK_EQUAL(SharedDataLayout::FindBlock("GRAPH_EDGE_LIST"),
+                      SharedDataLayout::GRAPH_EDGE_LIST);
+    BOOST_CHECK_EQUAL(SharedDataLayout::FindBlock("graph"), SharedDataLayout::NUM_BLOCKS);
+
+    SharedDataLayout layout;
+    layout.SetBlockSize<unsigned>(SharedDataLayout::GRAPH_NODE_LIST, 1000);
+    layout.SetBlockSize<char>(SharedDataLayout::NAME_CHAR_LIST, 3);
+    BOOST_CHECK_EQUAL(SharedDataImage::BlockOffset(layout, SharedDataLayout::GRAPH_NODE_LIST),
+                      SharedDataImage::DataOffset() +
+                          layout.GetBlockOffset(SharedDataLayout::GRAPH_NODE_LIST));
+    BOOST_CHECK_EQUAL(SharedDataImage::BlockOffset(layout, SharedDataLayout::NAME_CHAR_LIST),
+                      SharedDataImage::StaticOffset(layout) +
+                          layout.GetBlockOffset(SharedDataLayout::NAME_CHAR_LIST));
+}
+
+BOOST_AUTO_TEST_CASE(block_checksums_detect_corruption)
+{
+    SharedDataLayout layout;
+    layout.SetBlockSize<unsigned>(SharedDataLayout::GRAPH_EDGE_LIST, 100);
+    layout.SetBlockSize<char>(SharedDataLayout::NAME_CHAR_LIST, 7);
+
+    std::vector<char> graph_region(layout.GetSizeOfLayout(true));
+    std::vector<char> static_region(layout.GetSizeOfLayout(false));
+    unsigned *edges =
+        layout.GetBlockPtr<unsigned, true>(graph_region.data(), SharedDataLayout::GRAPH_EDGE_LIST);
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        edges[i] = i * i;
+    }
+    layout.GetBlockPtr<char, true>(static_region.data(), SharedDataLayout::NAME_CHAR_LIST)[3] = 'x';
+
+    layout.SetBlockChecksums(graph_region.data(), static_region.data());
+    BOOST_CHECK_NO_THROW(layout.CheckBlockChecksums(graph_region.data(), static_region.data()));
+
+    edges[42] ^= 1;
+    BOOST_CHECK_THROW(layout.CheckBlockChecksums(graph_region.data(), static_region.data()),
+                      osrm::exception);
+    edges[42] ^= 1;
+    layout.GetBlockPtr<char>(static_region.data(), SharedDataLayout::NAME_CHAR_LIST)[6] = 'y';
+    BOOST_CHECK_THROW(layout.CheckBlockChecksums(graph_region.data(), static_region.data()),
+                      osrm::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
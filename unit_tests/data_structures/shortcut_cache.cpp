@@ -0,0 +1,78 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/shortcut_cache.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(shortcut_cache)
+
+BOOST_AUTO_TEST_CASE(directions_are_cached_separately)
+{
+    ShortcutCache cache(64, 4);
+
+    std::vector<ShortcutCache::UnpackedEdge> result;
+    BOOST_CHECK(!cache.Fetch(7, false, result));
+    cache.Insert(7, false, {{1, 10}, {2, 11}, {3, 12}});
+    cache.Insert(7, true, {{3, 20}, {2, 21}});
+
+    // hits are appended to the edges unpacked so far
+    result.push_back({0, 9});
+    BOOST_CHECK(cache.Fetch(7, false, result));
+    BOOST_REQUIRE_EQUAL(result.size(), 4);
+    BOOST_CHECK_EQUAL(result[1].from, 1);
+    BOOST_CHECK_EQUAL(result[3].edge, 12);
+
+    result.clear();
+    BOOST_CHECK(cache.Fetch(7, true, result));
+    BOOST_REQUIRE_EQUAL(result.size(), 2);
+    BOOST_CHECK_EQUAL(result[0].edge, 20);
+    BOOST_CHECK(!cache.Fetch(8, false, result));
+    BOOST_CHECK_EQUAL(cache.Size(), 2);
+
+    cache.Clear();
+    BOOST_CHECK_EQUAL(cache.Size(), 0);
+    BOOST_CHECK(!cache.Fetch(7, false, result));
+}
+
+BOOST_AUTO_TEST_CASE(bounded_size)
+{
+    ShortcutCache cache(8, 2);
+    for (EdgeID shortcut = 0; shortcut < 100; ++shortcut)
+    {
+        cache.Insert(shortcut, false, {{shortcut, shortcut}});
+    }
+    BOOST_CHECK_LE(cache.Size(), 8);
+
+    std::vector<ShortcutCache::UnpackedEdge> result;
+    BOOST_CHECK(cache.Fetch(99, false, result));
+    BOOST_CHECK(!cache.Fetch(0, false, result));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
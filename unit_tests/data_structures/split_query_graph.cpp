@@ -0,0 +1,158 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#include "../../data_structures/split_query_graph.hpp"
+#include "../../data_structures/query_edge.hpp"
+#include "../../data_structures/shared_memory_vector_wrapper.hpp"
+#include "../../data_structures/static_graph.hpp"
+#include "../../typedefs.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(split_query_graph)
+
+using QueryGraph = StaticGraph<QueryEdge::EdgeData>;
+
+constexpr unsigned TEST_NUM_NODES = 300;
+constexpr unsigned TEST_MAX_DEGREE = 6;
+
+void RandomArrays(std::vector<QueryGraph::NodeArrayEntry> &nodes,
+                  std::vector<QueryGraph::EdgeArrayEntry> &edges)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<unsigned> degree(0, TEST_MAX_DEGREE);
+    std::uniform_int_distribution<unsigned> node(0, TEST_NUM_NODES - 1);
+    std::uniform_int_distribution<unsigned> id(0, (1u << 31) - 1);
+    std::uniform_int_distribution<int> distance(1, (1 << 29) - 1);
+    std::uniform_int_distribution<unsigned> length(0, 5000000);
+    std::uniform_int_distribution<int> flags(0, 7);
+
+    nodes.clear();
+    edges.clear();
+    for (unsigned i = 0; i < TEST_NUM_NODES; ++i)
+    {
+        QueryGraph::NodeArrayEntry entry;
+        entry.first_edge = static_cast<EdgeID>(edges.size());
+        nodes.push_back(entry);
+        for (unsigned j = degree(generator); j > 0; --j)
+        {
+            QueryGraph::EdgeArrayEntry edge;
+            edge.target = node(generator);
+            edge.data.id = id(generator);
+            edge.data.distance = distance(generator);
+            edge.data.length = length(generator);
+            const int edge_flags = flags(generator);
+            edge.data.shortcut = 0 != (edge_flags & 1);
+            edge.data.forward = 0 != (edge_flags & 2);
+            edge.data.backward = 0 != (edge_flags & 4);
+            edges.push_back(edge);
+        }
+    }
+    QueryGraph::NodeArrayEntry sentinel;
+    sentinel.first_edge = static_cast<EdgeID>(edges.size());
+    nodes.push_back(sentinel);
+}
+
+template <typename GraphT> void CheckEqual(const QueryGraph &static_graph, const GraphT &graph)
+{
+    BOOST_REQUIRE_EQUAL(graph.GetNumberOfNodes(), static_graph.GetNumberOfNodes());
+    BOOST_REQUIRE_EQUAL(graph.GetNumberOfEdges(), static_graph.GetNumberOfEdges());
+    for (NodeID node = 0; node < TEST_NUM_NODES; ++node)
+    {
+        BOOST_REQUIRE_EQUAL(graph.BeginEdges(node), static_graph.BeginEdges(node));
+        BOOST_REQUIRE_EQUAL(graph.EndEdges(node), static_graph.EndEdges(node));
+        for (const auto edge : static_graph.GetAdjacentEdgeRange(node))
+        {
+            const QueryEdge::EdgeData &expected = static_graph.GetEdgeData(edge);
+            const QueryEdge::EdgeData data = graph.GetEdgeData(edge);
+            const NodeID target = static_graph.GetTarget(edge);
+            BOOST_CHECK_EQUAL(graph.GetTarget(edge), target);
+            BOOST_CHECK_EQUAL(data.id, expected.id);
+            BOOST_CHECK_EQUAL(data.distance, expected.distance);
+            BOOST_CHECK_EQUAL(data.length, expected.length);
+            BOOST_CHECK_EQUAL(data.shortcut, expected.shortcut);
+            BOOST_CHECK_EQUAL(data.forward, expected.forward);
+            BOOST_CHECK_EQUAL(data.backward, expected.backward);
+            BOOST_CHECK_EQUAL(graph.FindEdge(node, target), static_graph.FindEdge(node, target));
+            BOOST_CHECK_EQUAL(graph.FindSmallestEdge(node, target),
+                              static_graph.FindSmallestEdge(node, target));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(matches_static_graph)
+{
+    std::vector<QueryGraph::NodeArrayEntry> nodes;
+    std::vector<QueryGraph::EdgeArrayEntry> edges;
+    RandomArrays(nodes, edges);
+    QueryGraph static_graph(nodes, edges);
+    RandomArrays(nodes, edges);
+    const SplitQueryGraph<> split_graph(nodes, edges);
+    BOOST_CHECK(nodes.empty());
+    BOOST_CHECK(edges.empty());
+
+    CheckEqual(static_graph, split_graph);
+}
+
+// the layout osrm-datastore writes to the GRAPH_EDGE_LIST and GRAPH_EDGE_IDS blocks
+BOOST_AUTO_TEST_CASE(shared_memory_blocks)
+{
+    using SharedGraph = SplitQueryGraph<true>;
+    std::vector<QueryGraph::NodeArrayEntry> nodes;
+    std::vector<QueryGraph::EdgeArrayEntry> edges;
+    RandomArrays(nodes, edges);
+    QueryGraph static_graph(nodes, edges);
+    RandomArrays(nodes, edges);
+
+    std::vector<SharedGraph::NodeArrayEntry> node_block(nodes.size());
+    for (const auto node : osrm::irange<std::size_t>(0, nodes.size()))
+    {
+        node_block[node].first_edge = nodes[node].first_edge;
+    }
+    std::vector<SharedGraph::HotEdgeEntry> hot_block(edges.size());
+    std::vector<SharedGraph::ColdEdgeEntry> cold_block(edges.size());
+    for (const auto edge : osrm::irange<std::size_t>(0, edges.size()))
+    {
+        SharedGraph::EdgeArrayEntry entry;
+        entry.target = edges[edge].target;
+        entry.data = edges[edge].data;
+        SharedGraph::Split(entry, hot_block[edge], cold_block[edge]);
+    }
+
+    ShM<SharedGraph::NodeArrayEntry, true>::vector node_list(node_block.data(),
+                                                             node_block.size());
+    ShM<SharedGraph::HotEdgeEntry, true>::vector hot_list(hot_block.data(), hot_block.size());
+    ShM<SharedGraph::ColdEdgeEntry, true>::vector cold_list(cold_block.data(), cold_block.size());
+    const SharedGraph split_graph(node_list, hot_list, cold_list);
+
+    CheckEqual(static_graph, split_graph);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
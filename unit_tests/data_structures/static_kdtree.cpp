@@ -0,0 +1,116 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#include "../../algorithms/coordinate_calculation.hpp"
+#include "../../data_structures/static_kdtree.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <osrm/coordinate.hpp>
+
+#include <limits>
+#include <random>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(static_kdtree)
+
+namespace
+{
+void CheckNearestNeighbors(const std::vector<FixedPointCoordinate> &points,
+                           const int min_lat,
+                           const int max_lat,
+                           const int min_lon,
+                           const int max_lon)
+{
+    StaticKDTree<>::Build(points, "test_kdtree.locateIndex");
+    const StaticKDTree<> tree("test_kdtree.locateIndex");
+    BOOST_CHECK_EQUAL(tree.GetNumberOfPoints(), points.size());
+
+    std::mt19937 g(7);
+    std::uniform_int_distribution<> lat_udist(min_lat, max_lat);
+    std::uniform_int_distribution<> lon_udist(min_lon, max_lon);
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        const FixedPointCoordinate query(lat_udist(g), lon_udist(g));
+        float nearest_distance = std::numeric_limits<float>::max();
+        for (const auto &point : points)
+        {
+            nearest_distance = std::min(
+                nearest_distance, coordinate_calculation::euclidean_distance(query, point));
+        }
+
+        FixedPointCoordinate result;
+        BOOST_CHECK(tree.NearestNeighbor(query, result));
+        BOOST_CHECK_EQUAL(coordinate_calculation::euclidean_distance(query, result),
+                          nearest_distance);
+    }
+}
+}
+
+BOOST_AUTO_TEST_CASE(city_test)
+{
+    std::mt19937 g(42);
+    std::uniform_int_distribution<> lat_udist(52480000, 52520000);
+    std::uniform_int_distribution<> lon_udist(13380000, 13420000);
+    std::vector<FixedPointCoordinate> points;
+    for (unsigned i = 0; i < 5000; ++i)
+    {
+        points.emplace_back(lat_udist(g), lon_udist(g));
+    }
+    // duplicates of a single coordinate
+    points.insert(points.end(), 20, points.front());
+    CheckNearestNeighbors(points, 52470000, 52530000, 13370000, 13430000);
+}
+
+BOOST_AUTO_TEST_CASE(world_test)
+{
+    std::mt19937 g(42);
+    std::uniform_int_distribution<> lat_udist(-85000000, 85000000);
+    std::uniform_int_distribution<> lon_udist(-180000000, 180000000);
+    std::vector<FixedPointCoordinate> points;
+    for (unsigned i = 0; i < 5000; ++i)
+    {
+        points.emplace_back(lat_udist(g), lon_udist(g));
+    }
+    CheckNearestNeighbors(points, -85000000, 85000000, -180000000, 180000000);
+}
+
+BOOST_AUTO_TEST_CASE(small_test)
+{
+    StaticKDTree<>::Build({FixedPointCoordinate(52500000, 13400000)}, "test_kdtree.locateIndex");
+    const StaticKDTree<> tree("test_kdtree.locateIndex");
+    FixedPointCoordinate result;
+    BOOST_CHECK(tree.NearestNeighbor(FixedPointCoordinate(10000000, 10000000), result));
+    BOOST_CHECK_EQUAL(result, FixedPointCoordinate(52500000, 13400000));
+
+    StaticKDTree<>::Build({}, "test_kdtree.locateIndex");
+    const StaticKDTree<> empty_tree("test_kdtree.locateIndex");
+    BOOST_CHECK(!empty_tree.NearestNeighbor(FixedPointCoordinate(10000000, 10000000), result));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -29,7 +29,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../../data_structures/static_rtree.hpp"
 #include "../../data_structures/query_node.hpp"
 #include "../../data_structures/edge_based_node.hpp"
+#include "../../data_structures/segment_grid.hpp"
 #include "../../util/floating_point.hpp"
+#include "../../util/make_unique.hpp"
+#include "../../util/mercator.hpp"
+#include "../../util/osrm_exception.hpp"
 #include "../../typedefs.h"
 
 #include <boost/functional/hash.hpp>
@@ -45,6 +49,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <memory>
 #include <random>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <unordered_set>
 #include <vector>
@@ -389,6 +395,282 @@ BOOST_FIXTURE_TEST_CASE(construct_multiple_levels_test, TestRandomGraphFixture_M
     construction_test("test_5", this);
 }
 
+// the leaves are mapped once and read in place, so one tree can serve all threads
+BOOST_FIXTURE_TEST_CASE(concurrent_queries_test, TestRandomGraphFixture_MultipleLevels)
+{
+    std::string leaves_path;
+    std::string nodes_path;
+    build_rtree("test_concurrent", this, leaves_path, nodes_path);
+    TestStaticRTree rtree(nodes_path, leaves_path, coords);
+
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> lat_udist(WORLD_MIN_LAT, WORLD_MAX_LAT);
+    std::uniform_int_distribution<> lon_udist(WORLD_MIN_LON, WORLD_MAX_LON);
+    std::vector<FixedPointCoordinate> queries;
+    for (unsigned i = 0; i < 100; i++)
+    {
+        queries.emplace_back(FixedPointCoordinate(lat_udist(g), lon_udist(g)));
+    }
+
+    const auto locate_all = [&rtree, &queries](std::vector<PhantomNode> &results)
+    {
+        for (const auto &q : queries)
+        {
+            PhantomNode phantom;
+            rtree.FindPhantomNodeForCoordinate(q, phantom, 1);
+            results.push_back(phantom);
+        }
+    };
+    std::vector<PhantomNode> expected;
+    locate_all(expected);
+
+    std::vector<std::vector<PhantomNode>> results(4);
+    std::vector<std::thread> threads;
+    for (auto &thread_results : results)
+    {
+        threads.emplace_back(locate_all, std::ref(thread_results));
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    for (const auto &thread_results : results)
+    {
+        BOOST_CHECK(thread_results == expected);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(batched_queries_test, TestRandomGraphFixture_MultipleLevels)
+{
+    std::string leaves_path;
+    std::string nodes_path;
+    build_rtree("test_batched", this, leaves_path, nodes_path);
+    TestStaticRTree rtree(nodes_path, leaves_path, coords);
+
+    // a random walk, like a GPS trace, plus a few points far away
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> step_udist(-COORDINATE_PRECISION, COORDINATE_PRECISION);
+    std::uniform_int_distribution<> lat_udist(WORLD_MIN_LAT, WORLD_MAX_LAT);
+    std::uniform_int_distribution<> lon_udist(WORLD_MIN_LON, WORLD_MAX_LON);
+    std::vector<FixedPointCoordinate> queries;
+    FixedPointCoordinate current = coords->front();
+    for (unsigned i = 0; i < 50; i++)
+    {
+        current.lat =
+            std::max(WORLD_MIN_LAT, std::min(WORLD_MAX_LAT, current.lat + step_udist(g)));
+        current.lon =
+            std::max(WORLD_MIN_LON, std::min(WORLD_MAX_LON, current.lon + step_udist(g)));
+        queries.push_back(current);
+    }
+    for (unsigned i = 0; i < 10; i++)
+    {
+        queries.emplace_back(FixedPointCoordinate(lat_udist(g), lon_udist(g)));
+    }
+
+    const double max_distance = 1000000;
+    std::vector<std::vector<std::pair<PhantomNode, double>>> batched_results;
+    rtree.IncrementalFindPhantomNodesForCoordinatesWithDistance(queries, batched_results,
+                                                                max_distance);
+    BOOST_REQUIRE_EQUAL(batched_results.size(), queries.size());
+    BOOST_CHECK(!batched_results.front().empty());
+
+    const auto by_distance = [](const std::pair<PhantomNode, double> &lhs,
+                                const std::pair<PhantomNode, double> &rhs)
+    {
+        return std::tie(lhs.second, lhs.first.forward_node_id, lhs.first.reverse_node_id) <
+               std::tie(rhs.second, rhs.first.forward_node_id, rhs.first.reverse_node_id);
+    };
+    for (const auto i : osrm::irange<std::size_t>(0, queries.size()))
+    {
+        std::vector<std::pair<PhantomNode, double>> results;
+        rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(queries[i], results,
+                                                                  max_distance);
+        std::sort(results.begin(), results.end(), by_distance);
+        std::sort(batched_results[i].begin(), batched_results[i].end(), by_distance);
+        BOOST_CHECK(results == batched_results[i]);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(radius_queries_test, TestRandomGraphFixture_MultipleLevels)
+{
+    std::string leaves_path;
+    std::string nodes_path;
+    build_rtree("test_radius", this, leaves_path, nodes_path);
+    TestStaticRTree rtree(nodes_path, leaves_path, coords);
+
+    // every segment in range has to be found, including those skipped by the leaf prefilter
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> lat_udist(WORLD_MIN_LAT, WORLD_MAX_LAT);
+    std::uniform_int_distribution<> lon_udist(WORLD_MIN_LON, WORLD_MAX_LON);
+    for (const double max_distance : {100000., 1000000., 5000000.})
+    {
+        for (unsigned i = 0; i < 20; i++)
+        {
+            FixedPointCoordinate query(lat_udist(g), lon_udist(g));
+            const std::pair<double, double> projected_query{
+                mercator::lat2y(query.lat / COORDINATE_PRECISION),
+                query.lon / COORDINATE_PRECISION};
+
+            unsigned expected_count = 0;
+            for (const TestData &e : edges)
+            {
+                const float distance =
+                    coordinate_calculation::perpendicular_distance_from_projected_coordinate(
+                        coords->at(e.u), coords->at(e.v), query, projected_query);
+                if (distance < max_distance)
+                {
+                    expected_count++;
+                }
+            }
+
+            std::vector<std::pair<PhantomNode, double>> results;
+            rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(query, results, max_distance,
+                                                                      edges.size());
+            BOOST_CHECK_EQUAL(results.size(), expected_count);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(segment_grid_test)
+{
+    // short segments within a few kilometres, like the roads of a city
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_real_distribution<> lat_udist(52.48, 52.52);
+    std::uniform_real_distribution<> lon_udist(13.38, 13.42);
+    std::uniform_real_distribution<> offset_udist(-0.002, 0.002);
+    std::vector<std::pair<float, float>> input_coords;
+    std::vector<std::pair<unsigned, unsigned>> input_edges;
+    for (unsigned i = 0; i < TEST_LEAF_NODE_SIZE * TEST_BRANCHING_FACTOR; i++)
+    {
+        const double lat = lat_udist(g);
+        const double lon = lon_udist(g);
+        input_coords.emplace_back(lat, lon);
+        input_coords.emplace_back(lat + offset_udist(g), lon + offset_udist(g));
+        input_edges.emplace_back(2 * i, 2 * i + 1);
+    }
+    GraphFixture fixture(input_coords, input_edges);
+
+    std::string leaves_path;
+    std::string nodes_path;
+    build_rtree("test_grid", &fixture, leaves_path, nodes_path);
+    SegmentGrid<TestData>::Build(fixture.edges, fixture.nodes, "test_grid.gridIndex");
+    TestStaticRTree rtree(nodes_path, leaves_path, fixture.coords);
+    TestStaticRTree grid_rtree(nodes_path, leaves_path, fixture.coords);
+    grid_rtree.SetSegmentGrid(osrm::make_unique<SegmentGrid<TestData>>("test_grid.gridIndex"));
+
+    const auto sorted_results = [](const std::vector<std::pair<PhantomNode, double>> &results)
+    {
+        std::vector<std::tuple<double, int, int>> sorted;
+        for (const auto &result : results)
+        {
+            sorted.emplace_back(result.second, result.first.location.lat,
+                                result.first.location.lon);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    };
+
+    // the grid answers the small radii, the larger ones fall back to the tree
+    std::size_t number_of_results = 0;
+    for (const double max_distance : {5., 20., 50., 80.})
+    {
+        for (unsigned i = 0; i < 100; i++)
+        {
+            FixedPointCoordinate query(lat_udist(g) * COORDINATE_PRECISION,
+                                       lon_udist(g) * COORDINATE_PRECISION);
+            std::vector<std::pair<PhantomNode, double>> results;
+            rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(
+                query, results, max_distance, fixture.edges.size());
+            std::vector<std::pair<PhantomNode, double>> grid_results;
+            grid_rtree.IncrementalFindPhantomNodeForCoordinateWithDistance(
+                query, grid_results, max_distance, fixture.edges.size());
+            BOOST_CHECK(sorted_results(results) == sorted_results(grid_results));
+            number_of_results += grid_results.size();
+        }
+    }
+    BOOST_CHECK(number_of_results > 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(layout_test, TestRandomGraphFixture_MultipleLevels)
+{
+    std::string leaves_path;
+    std::string nodes_path;
+    build_rtree("test_layout", this, leaves_path, nodes_path);
+    TestStaticRTree rtree(nodes_path, leaves_path, coords);
+    BOOST_CHECK_EQUAL(rtree.GetElements().size(), edges.size());
+
+    // files of another layout are rejected instead of being misread
+    typedef StaticRTree<TestData, std::vector<FixedPointCoordinate>, false, TEST_BRANCHING_FACTOR,
+                        TEST_LEAF_NODE_SIZE / 2> SmallLeavesStaticRTree;
+    typedef StaticRTree<TestData, std::vector<FixedPointCoordinate>, false,
+                        TEST_BRANCHING_FACTOR / 2, TEST_LEAF_NODE_SIZE> SmallNodesStaticRTree;
+    BOOST_CHECK_THROW(SmallLeavesStaticRTree(nodes_path, leaves_path, coords), osrm::exception);
+    BOOST_CHECK_THROW(SmallNodesStaticRTree(nodes_path, leaves_path, coords), osrm::exception);
+
+    // the elements rebuilt into another layout answer the same queries
+    SmallLeavesStaticRTree(rtree.GetElements(), "test_layout_small.ramIndex",
+                           "test_layout_small.fileIndex", nodes);
+    SmallLeavesStaticRTree small_rtree("test_layout_small.ramIndex", "test_layout_small.fileIndex",
+                                       coords);
+    LinearSearchNN lsnn(coords, edges);
+    sampling_verify_rtree(small_rtree, lsnn, 100);
+}
+
+BOOST_FIXTURE_TEST_CASE(consistency_test, TestRandomGraphFixture_MultipleLevels)
+{
+    std::string leaves_path;
+    std::string nodes_path;
+    build_rtree("test_consistency", this, leaves_path, nodes_path);
+    {
+        TestStaticRTree rtree(nodes_path, leaves_path, coords);
+        BOOST_CHECK_NO_THROW(rtree.CheckConsistency());
+        BOOST_CHECK_EQUAL(
+            static_cast<std::size_t>(rtree.GetElementsEnd() - rtree.GetElementsBegin()),
+            edges.size());
+    }
+
+    // the first leaf follows the header page, it starts with its number of elements
+    {
+        std::fstream leaf_stream(leaves_path, std::ios::binary | std::ios::in | std::ios::out);
+        leaf_stream.seekp(4096);
+        const uint32_t object_count = 1;
+        leaf_stream.write((const char *)&object_count, sizeof(object_count));
+    }
+    TestStaticRTree rtree(nodes_path, leaves_path, coords);
+    BOOST_CHECK_THROW(rtree.CheckConsistency(), osrm::exception);
+}
+
+BOOST_FIXTURE_TEST_CASE(projected_latitudes_test, TestRandomGraphFixture_MultipleLevels)
+{
+    std::string leaves_path;
+    std::string nodes_path;
+    build_rtree("test_projected", this, leaves_path, nodes_path);
+    TestStaticRTree rtree(nodes_path, leaves_path, coords);
+    TestStaticRTree projected_rtree(nodes_path, leaves_path, coords);
+    auto projected_latitudes = std::make_shared<std::vector<double>>();
+    for (const auto &coordinate : *coords)
+    {
+        projected_latitudes->push_back(coordinate_calculation::projected_latitude(coordinate));
+    }
+    projected_rtree.SetProjectedLatitudes(projected_latitudes);
+
+    // the stored projection gives the same results as projecting the segments per query
+    std::mt19937 g(RANDOM_SEED);
+    std::uniform_int_distribution<> lat_udist(WORLD_MIN_LAT, WORLD_MAX_LAT);
+    std::uniform_int_distribution<> lon_udist(WORLD_MIN_LON, WORLD_MAX_LON);
+    for (unsigned i = 0; i < 100; i++)
+    {
+        const FixedPointCoordinate query(lat_udist(g), lon_udist(g));
+        std::vector<PhantomNode> results;
+        rtree.IncrementalFindPhantomNodeForCoordinate(query, results, 3, 0, 180, 1e9);
+        std::vector<PhantomNode> projected_results;
+        projected_rtree.IncrementalFindPhantomNodeForCoordinate(query, projected_results, 3, 0,
+                                                                180, 1e9);
+        BOOST_CHECK(!results.empty());
+        BOOST_CHECK(results == projected_results);
+    }
+}
+
 /*
  * Bug: If you querry a point that lies between two BBs that have a gap,
  * one BB will be pruned, even if it could contain a nearer match.
@@ -436,6 +718,57 @@ BOOST_AUTO_TEST_CASE(regression_test)
     // BOOST_CHECK_EQUAL(result_ln, result);
 }
 
+BOOST_AUTO_TEST_CASE(bearing_filter_test)
+{
+    typedef std::pair<float, float> Coord;
+    typedef std::pair<unsigned, unsigned> Edge;
+    // a oneway heading north and a road heading east
+    GraphFixture fixture({Coord(0.0, 0.0), Coord(0.01, 0.0), Coord(0.0, 0.002), Coord(0.0, 0.012)},
+                         {Edge(0, 1), Edge(2, 3)});
+    fixture.edges[0].forward_edge_based_node_id = 0;
+    fixture.edges[1].forward_edge_based_node_id = 1;
+    fixture.edges[1].reverse_edge_based_node_id = 2;
+    for (auto &edge : fixture.edges)
+    {
+        edge.component_id = 0;
+    }
+
+    std::string leaves_path;
+    std::string nodes_path;
+    build_rtree("test_bearing", &fixture, leaves_path, nodes_path);
+    TestStaticRTree rtree(nodes_path, leaves_path, fixture.coords);
+
+    // closest to the oneway
+    FixedPointCoordinate input(0.005 * COORDINATE_PRECISION, 0.0005 * COORDINATE_PRECISION);
+    std::vector<PhantomNode> results;
+    rtree.IncrementalFindPhantomNodeForCoordinate(input, results, 1);
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    BOOST_CHECK_EQUAL(results.front().forward_node_id, 0);
+
+    results.clear();
+    rtree.IncrementalFindPhantomNodeForCoordinate(input, results, 1, 0, 10);
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    BOOST_CHECK_EQUAL(results.front().forward_node_id, 0);
+
+    // only the directions of the road within the range are left
+    results.clear();
+    rtree.IncrementalFindPhantomNodeForCoordinate(input, results, 1, 85, 10);
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    BOOST_CHECK_EQUAL(results.front().forward_node_id, 1);
+    BOOST_CHECK_EQUAL(results.front().reverse_node_id, SPECIAL_NODEID);
+
+    results.clear();
+    rtree.IncrementalFindPhantomNodeForCoordinate(input, results, 1, 275, 10);
+    BOOST_REQUIRE_EQUAL(results.size(), 1);
+    BOOST_CHECK_EQUAL(results.front().forward_node_id, SPECIAL_NODEID);
+    BOOST_CHECK_EQUAL(results.front().reverse_node_id, 2);
+
+    // the oneway can not be travelled south
+    results.clear();
+    rtree.IncrementalFindPhantomNodeForCoordinate(input, results, 1, 180, 10);
+    BOOST_CHECK(results.empty());
+}
+
 void TestRectangle(double width, double height, double center_lat, double center_lon)
 {
     FixedPointCoordinate center(center_lat * COORDINATE_PRECISION,
@@ -29,6 +29,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define BEARING_HPP
 
 #include <boost/assert.hpp>
+
+#include <algorithm>
+#include <cmath>
 #include <string>
 
 namespace bearing
@@ -72,6 +75,13 @@ inline std::string get(const double heading)
     }
     return "N";
 }
+
+// true if heading differs by at most range degrees from the bearing, both in [0, 360)
+inline bool CheckInBounds(const double heading, const int bearing, const int range)
+{
+    const double difference = std::fmod(std::abs(heading - bearing), 360.);
+    return std::min(difference, 360. - difference) <= range;
+}
 }
 
 #endif // BEARING_HPP
@@ -52,3 +52,13 @@ double ComputeAngle::OfThreeFixedPointCoordinates(const FixedPointCoordinate &fi
     }
     return angle;
 }
+
+std::uint16_t ComputeAngle::DirectionOf(const FixedPointCoordinate &origin,
+                                        const FixedPointCoordinate &target) noexcept
+{
+    const double x = (target.lon - origin.lon) / COORDINATE_PRECISION;
+    const double y = mercator::lat2y(target.lat / COORDINATE_PRECISION) -
+                     mercator::lat2y(origin.lat / COORDINATE_PRECISION);
+    const long units = std::lround(atan2_lookup(y, x) * (32768. / M_PI));
+    return static_cast<std::uint16_t>(units & 0xFFFF);
+}
@@ -28,6 +28,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef COMPUTE_ANGLE_HPP
 #define COMPUTE_ANGLE_HPP
 
+#include <cstdint>
+
 struct FixedPointCoordinate;
 
 struct ComputeAngle
@@ -37,6 +39,18 @@ struct ComputeAngle
     static double OfThreeFixedPointCoordinates(const FixedPointCoordinate &first,
                                                const FixedPointCoordinate &second,
                                                const FixedPointCoordinate &third) noexcept;
+
+    // Direction of the segment from origin to target in 1/65536 of a full turn, so that the
+    // difference of two directions wraps around like an angle
+    static std::uint16_t DirectionOf(const FixedPointCoordinate &origin,
+                                     const FixedPointCoordinate &target) noexcept;
+
+    // Angle of the turn (A,C)->(C,B) in [0, 360) from the directions C->A and C->B
+    static double OfDirections(const std::uint16_t second_to_first,
+                               const std::uint16_t second_to_third) noexcept
+    {
+        return static_cast<std::uint16_t>(second_to_third - second_to_first) * (360. / 65536.);
+    }
 };
 
 #endif // COMPUTE_ANGLE_HPP
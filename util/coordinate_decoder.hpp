@@ -0,0 +1,147 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef COORDINATE_DECODER_HPP
+#define COORDINATE_DECODER_HPP
+
+#include <osrm/coordinate.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace osrm
+{
+
+// Decodes the binary coordinate body of a POST request, the counterpart of the matrix output.
+// A header of four little-endian uint32s, the magic number "OCRD", the format version, the
+// number of coordinates n and the flags, is followed by n pairs of little-endian int32s, the
+// latitude and longitude in units of 1/COORDINATE_PRECISION degrees. With HAS_TIMESTAMPS set n
+// uint32 timestamps follow, with HAS_HINTS n hints, each an uint32 length and its bytes.
+struct CoordinateDecoder
+{
+    static constexpr std::uint32_t MAGIC = 0x4452434f; // "OCRD" in little-endian order
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::uint32_t HAS_TIMESTAMPS = 1;
+    static constexpr std::uint32_t HAS_HINTS = 2;
+
+    explicit CoordinateDecoder(const std::string &_in) : in(_in), position(0) {}
+
+    // Appends the decoded values to the vectors, returns false for a malformed body. Timestamps
+    // and hints are left alone if the body has none.
+    bool operator()(std::vector<FixedPointCoordinate> &coordinates,
+                    std::vector<unsigned> &timestamps,
+                    std::vector<std::string> &hints)
+    {
+        std::uint32_t magic, version, number_of_coordinates, flags;
+        if (!read_little_endian(magic) || MAGIC != magic || !read_little_endian(version) ||
+            VERSION != version || !read_little_endian(number_of_coordinates) ||
+            !read_little_endian(flags) || 0 != (flags & ~(HAS_TIMESTAMPS | HAS_HINTS)))
+        {
+            return false;
+        }
+        // guards the reservations below against a bogus count
+        if (number_of_coordinates > (in.size() - position) / (2 * sizeof(std::int32_t)))
+        {
+            return false;
+        }
+
+        coordinates.reserve(coordinates.size() + number_of_coordinates);
+        for (std::uint32_t i = 0; i < number_of_coordinates; ++i)
+        {
+            std::uint32_t latitude, longitude;
+            if (!read_little_endian(latitude) || !read_little_endian(longitude))
+            {
+                return false;
+            }
+            coordinates.emplace_back(static_cast<int>(static_cast<std::int32_t>(latitude)),
+                                     static_cast<int>(static_cast<std::int32_t>(longitude)));
+        }
+
+        if (0 != (flags & HAS_TIMESTAMPS))
+        {
+            timestamps.reserve(timestamps.size() + number_of_coordinates);
+            for (std::uint32_t i = 0; i < number_of_coordinates; ++i)
+            {
+                std::uint32_t timestamp;
+                if (!read_little_endian(timestamp))
+                {
+                    return false;
+                }
+                timestamps.push_back(timestamp);
+            }
+        }
+
+        if (0 != (flags & HAS_HINTS))
+        {
+            hints.reserve(hints.size() + number_of_coordinates);
+            for (std::uint32_t i = 0; i < number_of_coordinates; ++i)
+            {
+                std::uint32_t length;
+                if (!read_little_endian(length) || length > in.size() - position)
+                {
+                    return false;
+                }
+                hints.emplace_back(in, position, length);
+                position += length;
+            }
+        }
+
+        // trailing bytes point to a client that disagrees about the layout
+        return position == in.size();
+    }
+
+  private:
+    bool read_little_endian(std::uint32_t &value)
+    {
+        if (in.size() - position < sizeof(std::uint32_t))
+        {
+            return false;
+        }
+        value = static_cast<std::uint32_t>(static_cast<unsigned char>(in[position])) |
+                static_cast<std::uint32_t>(static_cast<unsigned char>(in[position + 1])) << 8 |
+                static_cast<std::uint32_t>(static_cast<unsigned char>(in[position + 2])) << 16 |
+                static_cast<std::uint32_t>(static_cast<unsigned char>(in[position + 3])) << 24;
+        position += sizeof(std::uint32_t);
+        return true;
+    }
+
+    const std::string &in;
+    std::size_t position;
+};
+
+inline bool coordinate_decode(const std::string &in,
+                              std::vector<FixedPointCoordinate> &coordinates,
+                              std::vector<unsigned> &timestamps,
+                              std::vector<std::string> &hints)
+{
+    CoordinateDecoder decoder(in);
+    return decoder(coordinates, timestamps, hints);
+}
+
+} // namespace osrm
+#endif // COORDINATE_DECODER_HPP
@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "version.hpp"
 #include "ini_file.hpp"
+#include "../data_structures/shared_memory_factory.hpp"
 #include "osrm_exception.hpp"
 #include "simple_logger.hpp"
 
@@ -42,8 +43,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 
 // generate boost::program_options object for the routing part
-bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerPaths &paths)
+bool GenerateDataStoreOptions(const int argc,
+                              const char *argv[],
+                              ServerPaths &paths,
+                              SharedMemoryPlacement &placement,
+                              bool &split_query_graph)
 {
+    unsigned huge_page_size_mb = 0;
     // declare a group of options that will be allowed only on command line
     boost::program_options::options_description generic_options("Options");
     generic_options.add_options()("version,v", "Show version")("help,h", "Show this help message")(
@@ -67,13 +73,42 @@ bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerPaths &p
         "ramindex", boost::program_options::value<boost::filesystem::path>(&paths["ramindex"]),
         ".ramIndex file")(
         "fileindex", boost::program_options::value<boost::filesystem::path>(&paths["fileindex"]),
-        ".fileIndex file")("core",
+        ".fileIndex file")(
+        "gridindex", boost::program_options::value<boost::filesystem::path>(&paths["gridindex"]),
+        ".gridIndex file, optional")(
+        "locateindex",
+        boost::program_options::value<boost::filesystem::path>(&paths["locateindex"]),
+        ".locateIndex file, optional")(
+        "landmarks", boost::program_options::value<boost::filesystem::path>(&paths["landmarks"]),
+        ".landmarks file, optional")(
+        "weights", boost::program_options::value<boost::filesystem::path>(&paths["weights"]),
+        ".weights file of osrm-customize, optional")("core",
                            boost::program_options::value<boost::filesystem::path>(&paths["core"]),
                            ".core file")(
         "namesdata", boost::program_options::value<boost::filesystem::path>(&paths["namesdata"]),
         ".names file")("timestamp",
                        boost::program_options::value<boost::filesystem::path>(&paths["timestamp"]),
-                       ".timestamp file");
+                       ".timestamp file")(
+        "hugepage-size",
+        boost::program_options::value<unsigned>(&huge_page_size_mb)->default_value(0),
+        "Back the dataset with huge pages of this size in MB (2 or 1024), 0 for regular pages")(
+        "numa-interleave",
+        boost::program_options::value<bool>(&placement.interleave_numa_nodes)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Interleave the dataset over all NUMA nodes")(
+        "split-graph",
+        boost::program_options::value<bool>(&split_query_graph)
+            ->implicit_value(true)
+            ->default_value(false),
+        "Store the ids of the search graph edges in a block apart from their targets and "
+        "weights")(
+        "image", boost::program_options::value<boost::filesystem::path>(&paths["image"]),
+        "Write the dataset to this file for osrm-routed --image instead of shared memory")(
+        "from-image",
+        boost::program_options::value<boost::filesystem::path>(&paths["fromimage"]),
+        "Load a dataset image of osrm-prepare --image or osrm-datastore --image to shared "
+        "memory instead of the single files");
 
     // hidden options, will be allowed both on command line and in config
     // file, but will not be shown to the user
@@ -202,6 +237,30 @@ bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerPaths &p
             path_iterator->second = base_string + ".fileIndex";
         }
 
+        path_iterator = paths.find("gridindex");
+        if (path_iterator != paths.end())
+        {
+            path_iterator->second = base_string + ".gridIndex";
+        }
+
+        path_iterator = paths.find("locateindex");
+        if (path_iterator != paths.end())
+        {
+            path_iterator->second = base_string + ".locateIndex";
+        }
+
+        path_iterator = paths.find("landmarks");
+        if (path_iterator != paths.end())
+        {
+            path_iterator->second = base_string + ".landmarks";
+        }
+
+        path_iterator = paths.find("weights");
+        if (path_iterator != paths.end())
+        {
+            path_iterator->second = base_string + ".weights";
+        }
+
         path_iterator = paths.find("core");
         if (path_iterator != paths.end())
         {
@@ -221,6 +280,23 @@ bool GenerateDataStoreOptions(const int argc, const char *argv[], ServerPaths &p
         }
     }
 
+    if (0 != huge_page_size_mb && 2 != huge_page_size_mb && 1024 != huge_page_size_mb)
+    {
+        throw osrm::exception("huge page size must be 2 or 1024 MB");
+    }
+    placement.huge_page_size = uint64_t(huge_page_size_mb) * 1024 * 1024;
+
+    // an image already contains every block, the single files are not needed then
+    path_iterator = paths.find("fromimage");
+    if (path_iterator != paths.end() && !path_iterator->second.string().empty())
+    {
+        if (!boost::filesystem::is_regular_file(path_iterator->second))
+        {
+            throw osrm::exception("valid dataset image must be specified");
+        }
+        return true;
+    }
+
     path_iterator = paths.find("hsgrdata");
     if (path_iterator == paths.end() || path_iterator->second.string().empty() ||
         !boost::filesystem::is_regular_file(path_iterator->second))
@@ -28,30 +28,38 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef DIST_TABLE_WRAPPER_H
 #define DIST_TABLE_WRAPPER_H
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <utility>
 #include <boost/assert.hpp>
 #include <cstddef>
 
-// This Wrapper provides an easier access to a distance table that is given as an linear vector
+// This Wrapper provides an easier access to a distance table that is given as an linear vector in
+// row-major order. It shares the result buffer of the many-to-many search instead of copying it.
 
 template <typename T> class DistTableWrapper
 {
   public:
-    using Iterator = typename std::vector<T>::iterator;
     using ConstIterator = typename std::vector<T>::const_iterator;
 
-    DistTableWrapper(std::vector<T> table, std::size_t number_of_nodes)
+    DistTableWrapper(std::shared_ptr<const std::vector<T>> table, std::size_t number_of_nodes)
         : table_(std::move(table)), number_of_nodes_(number_of_nodes)
     {
-        BOOST_ASSERT_MSG(table.size() == 0, "table is empty");
-        BOOST_ASSERT_MSG(number_of_nodes_ * number_of_nodes_ <= table_.size(),
+        BOOST_ASSERT_MSG(table_, "table is missing");
+        BOOST_ASSERT_MSG(number_of_nodes_ * number_of_nodes_ <= table_->size(),
                          "number_of_nodes_ is invalid");
     };
 
+    DistTableWrapper(std::vector<T> table, std::size_t number_of_nodes)
+        : DistTableWrapper(std::make_shared<const std::vector<T>>(std::move(table)),
+                           number_of_nodes)
+    {
+    }
+
     std::size_t GetNumberOfNodes() const { return number_of_nodes_; }
 
-    std::size_t size() const { return table_.size(); }
+    std::size_t size() const { return table_->size(); }
 
     EdgeWeight operator()(NodeID from, NodeID to) const
     {
@@ -60,28 +68,31 @@ template <typename T> class DistTableWrapper
 
         const auto index = from * number_of_nodes_ + to;
 
-        BOOST_ASSERT_MSG(index < table_.size(), "index is out of bound");
+        BOOST_ASSERT_MSG(index < table_->size(), "index is out of bound");
 
-        return table_[index];
+        return (*table_)[index];
     }
 
-    ConstIterator begin() const { return std::begin(table_); }
-
-    Iterator begin() { return std::begin(table_); }
+    // the distances from a node to all nodes, contiguous in memory
+    const T *GetRow(NodeID from) const
+    {
+        BOOST_ASSERT_MSG(from < number_of_nodes_, "from ID is out of bound");
+        return table_->data() + from * number_of_nodes_;
+    }
 
-    ConstIterator end() const { return std::end(table_); }
+    ConstIterator begin() const { return std::begin(*table_); }
 
-    Iterator end() { return std::end(table_); }
+    ConstIterator end() const { return std::end(*table_); }
 
     NodeID GetIndexOfMaxValue() const
     {
-        return std::distance(table_.begin(), std::max_element(table_.begin(), table_.end()));
+        return std::distance(table_->begin(), std::max_element(table_->begin(), table_->end()));
     }
 
-    std::vector<T> GetTable() const { return table_; }
+    const std::shared_ptr<const std::vector<T>> &GetTable() const { return table_; }
 
   private:
-    std::vector<T> table_;
+    std::shared_ptr<const std::vector<T>> table_;
     const std::size_t number_of_nodes_;
 };
 
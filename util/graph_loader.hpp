@@ -30,8 +30,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "fingerprint.hpp"
 #include "osrm_exception.hpp"
+#include "integer_range.hpp"
 #include "simple_logger.hpp"
 #include "../data_structures/external_memory_node.hpp"
+#include "../data_structures/graph_blocks.hpp"
 #include "../data_structures/import_edge.hpp"
 #include "../data_structures/query_node.hpp"
 #include "../data_structures/restriction.hpp"
@@ -41,8 +43,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
 
+#include <algorithm>
 #include <cmath>
 
 #include <fstream>
@@ -101,12 +107,15 @@ NodeID loadNodesFromFile(std::istream &input_stream,
 
     NodeID n;
     input_stream.read(reinterpret_cast<char *>(&n), sizeof(NodeID));
+    const bool is_compressed = graph_blocks::CompressedSectionMarker == n;
+    if (is_compressed)
+    {
+        input_stream.read(reinterpret_cast<char *>(&n), sizeof(NodeID));
+    }
     SimpleLogger().Write() << "Importing n = " << n << " nodes ";
 
-    ExternalMemoryNode current_node;
-    for (NodeID i = 0; i < n; ++i)
+    const auto add_node = [&](const NodeID i, const ExternalMemoryNode &current_node)
     {
-        input_stream.read(reinterpret_cast<char *>(&current_node), sizeof(ExternalMemoryNode));
         node_array.emplace_back(current_node.lat, current_node.lon, current_node.node_id);
         if (current_node.barrier)
         {
@@ -116,6 +125,82 @@ NodeID loadNodesFromFile(std::istream &input_stream,
         {
             traffic_light_node_list.emplace_back(i);
         }
+    };
+
+    if (is_compressed)
+    {
+        node_array.reserve(n);
+        std::vector<ExternalMemoryNode> block;
+        while (node_array.size() < n)
+        {
+            graph_blocks::read_node_block(input_stream, block);
+            if (block.empty() || node_array.size() + block.size() > n)
+            {
+                throw osrm::exception("corrupt node blocks in .osrm file");
+            }
+            for (const auto &current_node : block)
+            {
+                add_node(static_cast<NodeID>(node_array.size()), current_node);
+            }
+        }
+    }
+    else
+    {
+        // the nodes are read in large blocks, then converted and classified in parallel
+        constexpr NodeID node_block_size = 256 * 1024;
+        const std::size_t offset = node_array.size();
+        node_array.resize(offset + n);
+
+        tbb::enumerable_thread_specific<std::vector<NodeID>> local_barrier_nodes;
+        tbb::enumerable_thread_specific<std::vector<NodeID>> local_traffic_lights;
+        std::vector<ExternalMemoryNode> block;
+        for (NodeID first = 0; first < n; first += node_block_size)
+        {
+            const NodeID count = std::min(node_block_size, n - first);
+            block.resize(count);
+            input_stream.read(reinterpret_cast<char *>(block.data()),
+                              count * sizeof(ExternalMemoryNode));
+            if (!input_stream)
+            {
+                throw osrm::exception("unexpected end of nodes in .osrm file");
+            }
+
+            tbb::parallel_for(tbb::blocked_range<NodeID>(0, count, 4096),
+                              [&](const tbb::blocked_range<NodeID> &range)
+                              {
+                                  auto &barrier_nodes = local_barrier_nodes.local();
+                                  auto &traffic_lights = local_traffic_lights.local();
+                                  for (const auto i : osrm::irange(range.begin(), range.end()))
+                                  {
+                                      const auto &current_node = block[i];
+                                      node_array[offset + first + i] =
+                                          QueryNode(current_node.lat, current_node.lon,
+                                                    current_node.node_id);
+                                      if (current_node.barrier)
+                                      {
+                                          barrier_nodes.push_back(first + i);
+                                      }
+                                      if (current_node.traffic_lights)
+                                      {
+                                          traffic_lights.push_back(first + i);
+                                      }
+                                  }
+                              });
+        }
+
+        // the lists are sorted by id as if the nodes were classified one by one
+        const auto append_sorted = [](tbb::enumerable_thread_specific<std::vector<NodeID>> &local,
+                                      std::vector<NodeID> &node_list)
+        {
+            const auto old_size = node_list.size();
+            for (const auto &local_list : local)
+            {
+                node_list.insert(node_list.end(), local_list.begin(), local_list.end());
+            }
+            tbb::parallel_sort(node_list.begin() + old_size, node_list.end());
+        };
+        append_sorted(local_barrier_nodes, barrier_node_list);
+        append_sorted(local_traffic_lights, traffic_light_node_list);
     }
 
     // tighten vector sizes
@@ -132,10 +217,33 @@ NodeID loadEdgesFromFile(std::istream &input_stream, std::vector<NodeBasedEdge>
 {
     EdgeID m;
     input_stream.read(reinterpret_cast<char *>(&m), sizeof(unsigned));
-    edge_list.resize(m);
+    const bool is_compressed = graph_blocks::CompressedSectionMarker == m;
+    if (is_compressed)
+    {
+        input_stream.read(reinterpret_cast<char *>(&m), sizeof(unsigned));
+    }
     SimpleLogger().Write() << " and " << m << " edges ";
 
-    input_stream.read((char *)edge_list.data(), m * sizeof(NodeBasedEdge));
+    if (is_compressed)
+    {
+        edge_list.clear();
+        edge_list.reserve(m);
+        std::vector<NodeBasedEdge> block;
+        while (edge_list.size() < m)
+        {
+            graph_blocks::read_edge_block(input_stream, block);
+            if (block.empty() || edge_list.size() + block.size() > m)
+            {
+                throw osrm::exception("corrupt edge blocks in .osrm file");
+            }
+            edge_list.insert(edge_list.end(), block.begin(), block.end());
+        }
+    }
+    else
+    {
+        edge_list.resize(m);
+        input_stream.read((char *)edge_list.data(), m * sizeof(NodeBasedEdge));
+    }
 
     BOOST_ASSERT(edge_list.size() > 0);
 
@@ -219,4 +327,49 @@ unsigned readHSGRFromStream(const boost::filesystem::path &hsgr_file,
     return number_of_nodes;
 }
 
+/**
+ * Replaces the edge weights read by readHSGRFromStream with the ones osrm-customize wrote to a
+ * .weights file. The file stores the checksum of the .hsgr it belongs to, the number of edges
+ * and one weight per edge in the order of the .hsgr.
+ */
+template <typename EdgeT>
+void readHSGRWeightsFromStream(const boost::filesystem::path &weights_file,
+                               const unsigned check_sum,
+                               EdgeT *edge_list,
+                               const std::size_t number_of_edges)
+{
+    boost::filesystem::ifstream weights_input_stream(weights_file, std::ios::binary);
+    if (!weights_input_stream)
+    {
+        throw osrm::exception("cannot open " + weights_file.string());
+    }
+
+    unsigned weights_check_sum = 0;
+    unsigned number_of_weights = 0;
+    weights_input_stream.read(reinterpret_cast<char *>(&weights_check_sum), sizeof(unsigned));
+    weights_input_stream.read(reinterpret_cast<char *>(&number_of_weights), sizeof(unsigned));
+    if (weights_check_sum != check_sum || number_of_weights != number_of_edges)
+    {
+        throw osrm::exception(weights_file.string() + " was not customized for this .hsgr");
+    }
+
+    std::vector<EdgeWeight> weights(number_of_weights);
+    if (number_of_weights > 0)
+    {
+        weights_input_stream.read(reinterpret_cast<char *>(&weights[0]),
+                                  number_of_weights * sizeof(EdgeWeight));
+    }
+    if (!weights_input_stream)
+    {
+        throw osrm::exception("weights file is truncated");
+    }
+
+    for (const auto edge : osrm::irange<std::size_t>(0, number_of_edges))
+    {
+        edge_list[edge].data.distance = weights[edge];
+    }
+    SimpleLogger().Write() << "applied " << number_of_weights << " edge weights of "
+                           << weights_file.string();
+}
+
 #endif // GRAPH_LOADER_HPP
@@ -36,6 +36,13 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <osrm/json_container.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
 namespace osrm
 {
 namespace json
@@ -54,8 +61,7 @@ struct Renderer : mapbox::util::static_visitor<>
 
     void operator()(const Number &number) const
     {
-        out.precision(10);
-        out << number.value;
+        out << cast::to_string_with_precision(number.value);
     }
 
     void operator()(const Object &object) const
@@ -76,7 +82,7 @@ struct Renderer : mapbox::util::static_visitor<>
     void operator()(const Array &array) const
     {
         out << "[";
-        for (auto it = array.values.cend(), end = array.values.cend(); it != end;)
+        for (auto it = array.values.cbegin(), end = array.values.cend(); it != end;)
         {
             mapbox::util::apply_visitor(Renderer(out), *it);
             if (++it != end)
@@ -97,6 +103,98 @@ struct Renderer : mapbox::util::static_visitor<>
     std::ostream &out;
 };
 
+namespace detail
+{
+// Renders a number exactly like cast::to_string_with_precision, but without a stream:
+// integral values are printed digit by digit, all others by a single snprintf call.
+// Returns the number of characters written to buffer.
+inline std::size_t format_number(const double value, char (&buffer)[64])
+{
+    const bool is_integral = value == std::floor(value) && std::abs(value) < 1e15 &&
+                             !(value == 0. && std::signbit(value));
+    if (is_integral)
+    {
+        auto integer = static_cast<std::int64_t>(value);
+        const bool negative = integer < 0;
+        if (negative)
+        {
+            integer = -integer;
+        }
+        char *end = buffer + sizeof(buffer);
+        char *position = end;
+        do
+        {
+            *--position = static_cast<char>('0' + integer % 10);
+            integer /= 10;
+        } while (integer != 0);
+        if (negative)
+        {
+            *--position = '-';
+        }
+        const std::size_t length = end - position;
+        std::memmove(buffer, position, length);
+        return length;
+    }
+
+    const int length = std::snprintf(buffer, sizeof(buffer), "%.6f", value);
+    if (length < 0 || length >= static_cast<int>(sizeof(buffer)))
+    {
+        const auto number_string = cast::to_string_with_precision(value);
+        const auto copied = std::min(number_string.size(), sizeof(buffer));
+        std::copy(number_string.begin(), number_string.begin() + copied, buffer);
+        return copied;
+    }
+    // same trimming as cast::to_string_with_precision: X.Y000 -> X.Y, X.000 -> X
+    std::size_t trimmed = length;
+    if (std::find(buffer, buffer + trimmed, '.') != buffer + trimmed)
+    {
+        while (trimmed > 0 && buffer[trimmed - 1] == '0')
+        {
+            --trimmed;
+        }
+        if (trimmed > 0 && buffer[trimmed - 1] == '.')
+        {
+            --trimmed;
+        }
+    }
+    return trimmed;
+}
+
+// Approximates the rendered size of a value to reserve the output buffer up front
+struct SizeEstimator : mapbox::util::static_visitor<std::size_t>
+{
+    std::size_t operator()(const String &string) const { return string.value.size() + 2; }
+
+    std::size_t operator()(const Number &) const { return 10; }
+
+    std::size_t operator()(const Object &object) const
+    {
+        std::size_t size = 2;
+        for (const auto &entry : object.values)
+        {
+            size += entry.first.size() + 4 + mapbox::util::apply_visitor(*this, entry.second);
+        }
+        return size;
+    }
+
+    std::size_t operator()(const Array &array) const
+    {
+        std::size_t size = 2;
+        for (const auto &value : array.values)
+        {
+            size += 1 + mapbox::util::apply_visitor(*this, value);
+        }
+        return size;
+    }
+
+    std::size_t operator()(const True &) const { return 4; }
+
+    std::size_t operator()(const False &) const { return 5; }
+
+    std::size_t operator()(const Null &) const { return 4; }
+};
+}
+
 struct ArrayRenderer : mapbox::util::static_visitor<>
 {
     explicit ArrayRenderer(std::vector<char> &_out) : out(_out) {}
@@ -104,15 +202,48 @@ struct ArrayRenderer : mapbox::util::static_visitor<>
     void operator()(const String &string) const
     {
         out.push_back('\"');
-        const auto string_to_insert = escape_JSON(string.value);
-        out.insert(std::end(out), std::begin(string_to_insert), std::end(string_to_insert));
+        // escapes in place, see escape_JSON
+        for (const char letter : string.value)
+        {
+            switch (letter)
+            {
+            case '\\':
+                append("\\\\");
+                break;
+            case '"':
+                append("\\\"");
+                break;
+            case '/':
+                append("\\/");
+                break;
+            case '\b':
+                append("\\b");
+                break;
+            case '\f':
+                append("\\f");
+                break;
+            case '\n':
+                append("\\n");
+                break;
+            case '\r':
+                append("\\r");
+                break;
+            case '\t':
+                append("\\t");
+                break;
+            default:
+                out.push_back(letter);
+                break;
+            }
+        }
         out.push_back('\"');
     }
 
     void operator()(const Number &number) const
     {
-        const std::string number_string = cast::to_string_with_precision(number.value);
-        out.insert(out.end(), number_string.begin(), number_string.end());
+        char buffer[64];
+        const auto length = detail::format_number(number.value, buffer);
+        out.insert(out.end(), buffer, buffer + length);
     }
 
     void operator()(const Object &object) const
@@ -148,38 +279,35 @@ struct ArrayRenderer : mapbox::util::static_visitor<>
         out.push_back(']');
     }
 
-    void operator()(const True &) const
-    {
-        const std::string temp("true");
-        out.insert(out.end(), temp.begin(), temp.end());
-    }
+    void operator()(const True &) const { append("true"); }
 
-    void operator()(const False &) const
-    {
-        const std::string temp("false");
-        out.insert(out.end(), temp.begin(), temp.end());
-    }
+    void operator()(const False &) const { append("false"); }
 
-    void operator()(const Null &) const
+    void operator()(const Null &) const { append("null"); }
+
+  private:
+    template <std::size_t N> void append(const char (&literal)[N]) const
     {
-        const std::string temp("null");
-        out.insert(out.end(), temp.begin(), temp.end());
+        // N includes the terminating zero
+        out.insert(out.end(), literal, literal + N - 1);
     }
 
-  private:
     std::vector<char> &out;
 };
 
+// Note: visits the object directly, wrapping it into a Value would deep-copy the document
 inline void render(std::ostream &out, const Object &object)
 {
-    Value value = object;
-    mapbox::util::apply_visitor(Renderer(out), value);
+    const Renderer renderer(out);
+    renderer(object);
 }
 
 inline void render(std::vector<char> &out, const Object &object)
 {
-    Value value = object;
-    mapbox::util::apply_visitor(ArrayRenderer(out), value);
+    const detail::SizeEstimator estimator;
+    out.reserve(out.size() + estimator(object));
+    const ArrayRenderer renderer(out);
+    renderer(object);
 }
 
 } // namespace json
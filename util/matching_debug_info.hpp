@@ -102,9 +102,8 @@ struct MatchingDebugInfo
             .values.push_back(transistion);
     }
 
-    void set_viterbi(const std::vector<std::vector<double>> &viterbi,
-                     const std::vector<std::vector<bool>> &pruned,
-                     const std::vector<std::vector<bool>> &suspicious)
+    template <class CandidateLists>
+    void set_viterbi(const HiddenMarkovModel<CandidateLists> &model)
     {
         // json logger not enabled
         if (!logger)
@@ -112,16 +111,17 @@ struct MatchingDebugInfo
             return;
         }
 
-        for (auto t = 0u; t < viterbi.size(); t++)
+        for (auto t = 0u; t < model.breakage.size(); t++)
         {
-            for (auto s_prime = 0u; s_prime < viterbi[t].size(); ++s_prime)
+            for (auto s_prime = 0u; s_prime < model.num_states(t); ++s_prime)
             {
+                const auto index = model.state(t, s_prime);
                 osrm::json::get(*object, "states", t, s_prime, "viterbi") =
-                    osrm::json::clamp_float(viterbi[t][s_prime]);
+                    osrm::json::clamp_float(model.viterbi[index]);
                 osrm::json::get(*object, "states", t, s_prime, "pruned") =
-                    static_cast<unsigned>(pruned[t][s_prime]);
+                    static_cast<unsigned>(model.pruned[index]);
                 osrm::json::get(*object, "states", t, s_prime, "suspicious") =
-                    static_cast<unsigned>(suspicious[t][s_prime]);
+                    static_cast<unsigned>(model.suspicious[index]);
             }
         }
     }
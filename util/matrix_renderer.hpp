@@ -0,0 +1,93 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef MATRIX_RENDERER_HPP
+#define MATRIX_RENDERER_HPP
+
+#include "../typedefs.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace osrm
+{
+namespace json
+{
+
+// Serializes a distance table as a header of four little-endian uint32s, the magic number
+// "OTBL", the format version, the number of rows and the number of columns, followed by the
+// row-major entries as little-endian int32s. Unreachable entries are INVALID_EDGE_WEIGHT.
+// Behind the 16 byte header the table can be copied out with a single memcpy.
+struct MatrixRenderer
+{
+    static constexpr std::uint32_t MAGIC = 0x4c42544f; // "OTBL" in little-endian order
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::size_t HEADER_SIZE = 4 * sizeof(std::uint32_t);
+
+    explicit MatrixRenderer(std::string &_out) : out(_out) {}
+
+    void operator()(const unsigned number_of_rows,
+                    const unsigned number_of_columns,
+                    const std::vector<EdgeWeight> &table) const
+    {
+        out.reserve(out.size() + HEADER_SIZE + table.size() * sizeof(std::int32_t));
+        write_little_endian(MAGIC);
+        write_little_endian(VERSION);
+        write_little_endian(number_of_rows);
+        write_little_endian(number_of_columns);
+        for (const EdgeWeight entry : table)
+        {
+            write_little_endian(static_cast<std::uint32_t>(entry));
+        }
+    }
+
+  private:
+    void write_little_endian(const std::uint32_t value) const
+    {
+        out.push_back(static_cast<char>(value & 0xff));
+        out.push_back(static_cast<char>((value >> 8) & 0xff));
+        out.push_back(static_cast<char>((value >> 16) & 0xff));
+        out.push_back(static_cast<char>((value >> 24) & 0xff));
+    }
+
+    std::string &out;
+};
+
+inline void matrix_render(std::string &out,
+                          const unsigned number_of_rows,
+                          const unsigned number_of_columns,
+                          const std::vector<EdgeWeight> &table)
+{
+    const MatrixRenderer renderer(out);
+    renderer(number_of_rows, number_of_columns, table);
+}
+
+} // namespace json
+} // namespace osrm
+#endif // MATRIX_RENDERER_HPP
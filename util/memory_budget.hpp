@@ -0,0 +1,225 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef MEMORY_BUDGET_HPP
+#define MEMORY_BUDGET_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+namespace osrm
+{
+
+// Thrown where a request would allocate more than its own budget or than is left of the budget
+// that all requests share
+class memory_budget_exceeded final : public std::exception
+{
+  public:
+    explicit memory_budget_exceeded(const bool global) : global(global) {}
+
+    const char *what() const noexcept override
+    {
+        return global ? "memory budget of all requests exhausted"
+                      : "request exceeds its memory budget";
+    }
+
+    const bool global;
+};
+
+namespace memory
+{
+
+// Bytes charged by all requests in flight, against a limit that is set once at startup
+struct GlobalAccount
+{
+    GlobalAccount() : limit(0), in_use(0), peak(0), rejected(0) {}
+
+    // 0 for no limit
+    std::size_t limit;
+    std::atomic<std::size_t> in_use;
+    std::atomic<std::size_t> peak;
+    // requests that ran out of their own or the shared budget
+    std::atomic<std::uint64_t> rejected;
+};
+
+inline GlobalAccount &Global()
+{
+    static GlobalAccount account;
+    return account;
+}
+
+inline void UpdatePeak(std::atomic<std::size_t> &peak, const std::size_t value)
+{
+    auto current_peak = peak.load(std::memory_order_relaxed);
+    while (current_peak < value &&
+           !peak.compare_exchange_weak(current_peak, value, std::memory_order_relaxed))
+    {
+    }
+}
+}
+
+// Memory accounting of one request, shared by all threads that work on it. The allocations that
+// grow with the size of a request charge their bytes before they are made, or right after for
+// sizes that are not known up front. Whatever is still charged is returned to the shared budget
+// when the request is done.
+class MemoryBudget
+{
+  public:
+    // 0 for no limit of the request, the shared limit applies anyway
+    explicit MemoryBudget(const std::size_t limit)
+        : limit(limit), in_use(0), peak(0), exceeded(false), exceeded_globally(false)
+    {
+    }
+    MemoryBudget(const MemoryBudget &) = delete;
+    ~MemoryBudget()
+    {
+        memory::Global().in_use.fetch_sub(in_use.load(std::memory_order_relaxed),
+                                          std::memory_order_relaxed);
+    }
+
+    void Charge(const std::size_t bytes)
+    {
+        auto &global = memory::Global();
+        const auto request_bytes = in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        const auto global_bytes = global.in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        const bool request_exceeded = 0 != limit && request_bytes > limit;
+        if (request_exceeded || (0 != global.limit && global_bytes > global.limit))
+        {
+            Release(bytes);
+            exceeded_globally.store(!request_exceeded, std::memory_order_relaxed);
+            if (!exceeded.exchange(true, std::memory_order_relaxed))
+            {
+                global.rejected.fetch_add(1, std::memory_order_relaxed);
+            }
+            throw memory_budget_exceeded(!request_exceeded);
+        }
+        memory::UpdatePeak(peak, request_bytes);
+        memory::UpdatePeak(global.peak, global_bytes);
+    }
+
+    void Release(const std::size_t bytes)
+    {
+        in_use.fetch_sub(bytes, std::memory_order_relaxed);
+        memory::Global().in_use.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    std::size_t InUse() const { return in_use.load(std::memory_order_relaxed); }
+
+    std::size_t Peak() const { return peak.load(std::memory_order_relaxed); }
+
+    // the exception may arrive as a copy of another type from a worker thread, see
+    // tbb::captured_exception
+    bool Exceeded() const { return exceeded.load(std::memory_order_relaxed); }
+
+    // whether it was the budget that all requests share, the request may be retried later
+    bool ExceededGlobally() const { return exceeded_globally.load(std::memory_order_relaxed); }
+
+  private:
+    const std::size_t limit;
+    std::atomic<std::size_t> in_use;
+    std::atomic<std::size_t> peak;
+    std::atomic<bool> exceeded;
+    std::atomic<bool> exceeded_globally;
+};
+
+namespace memory
+{
+
+// in between requests and on threads that no request handed its budget to this is nullptr
+inline MemoryBudget *&Current()
+{
+    static thread_local MemoryBudget *current_budget = nullptr;
+    return current_budget;
+}
+
+// Makes budget the one of the calling thread for the lifetime of the scope
+class Scope
+{
+  public:
+    explicit Scope(MemoryBudget *budget) : previous_budget(Current()) { Current() = budget; }
+    Scope(const Scope &) = delete;
+    ~Scope() { Current() = previous_budget; }
+
+  private:
+    MemoryBudget *previous_budget;
+};
+
+// Charges memory that is kept until the request is done, e.g. its results
+inline void Charge(const std::size_t bytes)
+{
+    if (MemoryBudget *budget = Current())
+    {
+        budget->Charge(bytes);
+    }
+}
+
+// Returns memory that was charged with Charge before the request is done
+inline void Release(const std::size_t bytes)
+{
+    if (MemoryBudget *budget = Current())
+    {
+        budget->Release(bytes);
+    }
+}
+
+// Charges memory that is freed before the request is done, the bytes are released with the
+// reservation. It holds on to the budget of the thread that created it, so that worker threads
+// may add to it.
+class Reservation
+{
+  public:
+    Reservation() : budget(Current()), bytes(0) {}
+    explicit Reservation(const std::size_t initial_bytes) : Reservation() { Add(initial_bytes); }
+    Reservation(const Reservation &) = delete;
+    ~Reservation()
+    {
+        if (nullptr != budget)
+        {
+            budget->Release(bytes.load(std::memory_order_relaxed));
+        }
+    }
+
+    void Add(const std::size_t additional_bytes)
+    {
+        if (nullptr != budget)
+        {
+            budget->Charge(additional_bytes);
+            bytes.fetch_add(additional_bytes, std::memory_order_relaxed);
+        }
+    }
+
+  private:
+    MemoryBudget *budget;
+    std::atomic<std::size_t> bytes;
+};
+}
+}
+
+#endif // MEMORY_BUDGET_HPP
@@ -0,0 +1,215 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef MSGPACK_RENDERER_HPP
+#define MSGPACK_RENDERER_HPP
+
+#include <osrm/json_container.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace osrm
+{
+namespace json
+{
+
+// Serializes a json::Value into the MessagePack binary format (http://msgpack.org).
+// Numbers that hold integral values are emitted as (u)ints, all others as float64.
+struct MessagePackRenderer : mapbox::util::static_visitor<>
+{
+    explicit MessagePackRenderer(std::vector<char> &_out) : out(_out) {}
+
+    void operator()(const String &string) const { write_string(string.value); }
+
+    void operator()(const Number &number) const
+    {
+        const double value = number.value;
+        if (value == std::floor(value) && std::abs(value) < 9007199254740992.)
+        {
+            write_integer(static_cast<std::int64_t>(value));
+            return;
+        }
+        std::uint64_t bits;
+        static_assert(sizeof(bits) == sizeof(value), "double needs to be 64 bits wide");
+        std::memcpy(&bits, &value, sizeof(bits));
+        out.push_back(static_cast<char>(0xcb));
+        write_big_endian(bits, 8);
+    }
+
+    void operator()(const Object &object) const
+    {
+        write_header(object.values.size(), 0x80, 0xde, 0xdf);
+        for (const auto &entry : object.values)
+        {
+            write_string(entry.first);
+            mapbox::util::apply_visitor(MessagePackRenderer(out), entry.second);
+        }
+    }
+
+    void operator()(const Array &array) const
+    {
+        write_header(array.values.size(), 0x90, 0xdc, 0xdd);
+        for (const auto &value : array.values)
+        {
+            mapbox::util::apply_visitor(MessagePackRenderer(out), value);
+        }
+    }
+
+    void operator()(const True &) const { out.push_back(static_cast<char>(0xc3)); }
+
+    void operator()(const False &) const { out.push_back(static_cast<char>(0xc2)); }
+
+    void operator()(const Null &) const { out.push_back(static_cast<char>(0xc0)); }
+
+  private:
+    void write_big_endian(const std::uint64_t value, const unsigned bytes) const
+    {
+        for (unsigned shift = bytes * 8; shift > 0; shift -= 8)
+        {
+            out.push_back(static_cast<char>((value >> (shift - 8)) & 0xff));
+        }
+    }
+
+    // containers with less than 16 elements use the compact 'fix' type
+    void write_header(const std::size_t size,
+                      const unsigned char fix_type,
+                      const unsigned char type_16,
+                      const unsigned char type_32) const
+    {
+        if (size < 16)
+        {
+            out.push_back(static_cast<char>(fix_type | size));
+        }
+        else if (size <= 0xffff)
+        {
+            out.push_back(static_cast<char>(type_16));
+            write_big_endian(size, 2);
+        }
+        else
+        {
+            out.push_back(static_cast<char>(type_32));
+            write_big_endian(size, 4);
+        }
+    }
+
+    void write_string(const std::string &string) const
+    {
+        const auto size = string.size();
+        if (size < 32)
+        {
+            out.push_back(static_cast<char>(0xa0 | size));
+        }
+        else if (size <= 0xff)
+        {
+            out.push_back(static_cast<char>(0xd9));
+            write_big_endian(size, 1);
+        }
+        else if (size <= 0xffff)
+        {
+            out.push_back(static_cast<char>(0xda));
+            write_big_endian(size, 2);
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xdb));
+            write_big_endian(size, 4);
+        }
+        out.insert(out.end(), string.begin(), string.end());
+    }
+
+    void write_integer(const std::int64_t value) const
+    {
+        if (value >= 0)
+        {
+            if (value < 128)
+            { // positive fixint
+                out.push_back(static_cast<char>(value));
+            }
+            else if (value <= 0xff)
+            {
+                out.push_back(static_cast<char>(0xcc));
+                write_big_endian(value, 1);
+            }
+            else if (value <= 0xffff)
+            {
+                out.push_back(static_cast<char>(0xcd));
+                write_big_endian(value, 2);
+            }
+            else if (value <= 0xffffffffll)
+            {
+                out.push_back(static_cast<char>(0xce));
+                write_big_endian(value, 4);
+            }
+            else
+            {
+                out.push_back(static_cast<char>(0xcf));
+                write_big_endian(value, 8);
+            }
+            return;
+        }
+        if (value >= -32)
+        { // negative fixint
+            out.push_back(static_cast<char>(value));
+        }
+        else if (value >= -128)
+        {
+            out.push_back(static_cast<char>(0xd0));
+            write_big_endian(static_cast<std::uint64_t>(value), 1);
+        }
+        else if (value >= -32768)
+        {
+            out.push_back(static_cast<char>(0xd1));
+            write_big_endian(static_cast<std::uint64_t>(value), 2);
+        }
+        else if (value >= -2147483648ll)
+        {
+            out.push_back(static_cast<char>(0xd2));
+            write_big_endian(static_cast<std::uint64_t>(value), 4);
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xd3));
+            write_big_endian(static_cast<std::uint64_t>(value), 8);
+        }
+    }
+
+    std::vector<char> &out;
+};
+
+inline void msgpack_render(std::vector<char> &out, const Object &object)
+{
+    const MessagePackRenderer renderer(out);
+    renderer(object);
+}
+
+} // namespace json
+} // namespace osrm
+#endif // MSGPACK_RENDERER_HPP
@@ -0,0 +1,164 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef QUERY_CANCELLATION_HPP
+#define QUERY_CANCELLATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+
+namespace osrm
+{
+
+// Thrown out of the searches of a request whose deadline passed or whose client went away
+class query_cancelled final : public std::exception
+{
+  public:
+    explicit query_cancelled(const bool deadline_passed) : deadline_passed(deadline_passed) {}
+
+    const char *what() const noexcept override
+    {
+        return deadline_passed ? "query deadline passed" : "query cancelled";
+    }
+
+    const bool deadline_passed;
+};
+
+// Cancellation state of one request, shared by all threads that work on it. The searches poll
+// it cooperatively, see cancellation::Poll.
+class CancellationToken
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    CancellationToken()
+        : cancelled(false), deadline_passed(false), deadline(Clock::time_point::max())
+    {
+    }
+    CancellationToken(const CancellationToken &) = delete;
+
+    // the earlier of both deadlines is kept, set before the work on the request starts
+    void SetDeadline(const Clock::time_point new_deadline)
+    {
+        if (new_deadline < deadline)
+        {
+            deadline = new_deadline;
+        }
+    }
+
+    void SetTimeout(const std::chrono::milliseconds timeout)
+    {
+        SetDeadline(Clock::now() + timeout);
+    }
+
+    // Asked on every check whether the work is still wanted, e.g. if the client is connected.
+    // Called from the threads that check the token, it must not block.
+    void SetAbandonedCheck(std::function<bool()> check) { abandoned_check = std::move(check); }
+
+    void Cancel() { cancelled.store(true, std::memory_order_relaxed); }
+
+    bool IsCancelled()
+    {
+        if (cancelled.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+        if (Clock::now() > deadline)
+        {
+            deadline_passed.store(true, std::memory_order_relaxed);
+            Cancel();
+        }
+        else if (abandoned_check && abandoned_check())
+        {
+            Cancel();
+        }
+        return cancelled.load(std::memory_order_relaxed);
+    }
+
+    void ThrowIfCancelled()
+    {
+        if (IsCancelled())
+        {
+            throw query_cancelled(deadline_passed.load(std::memory_order_relaxed));
+        }
+    }
+
+  private:
+    std::atomic<bool> cancelled;
+    std::atomic<bool> deadline_passed;
+    Clock::time_point deadline;
+    std::function<bool()> abandoned_check;
+};
+
+namespace cancellation
+{
+
+// in between requests and on threads that no request handed its token to this is nullptr
+inline CancellationToken *&Current()
+{
+    static thread_local CancellationToken *current_token = nullptr;
+    return current_token;
+}
+
+// Makes token the one of the calling thread for the lifetime of the scope. The parallel sections
+// of a request open a scope in their tasks, so that the worker threads check the token as well.
+class Scope
+{
+  public:
+    explicit Scope(CancellationToken *token) : previous_token(Current()) { Current() = token; }
+    Scope(const Scope &) = delete;
+    ~Scope() { Current() = previous_token; }
+
+  private:
+    CancellationToken *previous_token;
+};
+
+// Checks the token of the calling thread right away, for coarse grained work
+inline void Check()
+{
+    if (CancellationToken *token = Current())
+    {
+        token->ThrowIfCancelled();
+    }
+}
+
+// Checks the token every POLL_INTERVAL calls only, cheap enough for the loops of the searches
+static constexpr unsigned POLL_INTERVAL = 1024;
+inline void Poll()
+{
+    static thread_local unsigned calls = 0;
+    if (0 == (++calls % POLL_INTERVAL))
+    {
+        Check();
+    }
+}
+}
+}
+
+#endif // QUERY_CANCELLATION_HPP
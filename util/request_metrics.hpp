@@ -0,0 +1,343 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef REQUEST_METRICS_HPP
+#define REQUEST_METRICS_HPP
+
+#include "trace.hpp"
+
+#include <boost/thread/tss.hpp>
+
+#include <osrm/json_container.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace osrm
+{
+namespace metrics
+{
+
+enum class Phase : unsigned
+{
+    parse,
+    queue_wait,
+    phantom_lookup,
+    search,
+    unpack,
+    render,
+    total,
+    number_of_phases
+};
+
+inline const char *phase_name(const Phase phase)
+{
+    switch (phase)
+    {
+    case Phase::parse:
+        return "parse";
+    case Phase::queue_wait:
+        return "queue_wait";
+    case Phase::phantom_lookup:
+        return "phantom_lookup";
+    case Phase::search:
+        return "search";
+    case Phase::unpack:
+        return "unpack";
+    case Phase::render:
+        return "render";
+    default:
+        return "total";
+    }
+}
+
+// Log-linear latency histogram in microseconds with 8 sub-buckets per power of two, i.e. a
+// relative error of at most 12.5%. Recording is a handful of relaxed atomic increments.
+class LatencyHistogram
+{
+    static constexpr unsigned LINEAR_BUCKETS = 16;
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr unsigned NUMBER_OF_BUCKETS = LINEAR_BUCKETS + (64 - 4) * 8;
+
+  public:
+    LatencyHistogram() : count(0), sum(0), max(0)
+    {
+        for (auto &bucket : buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Record(const std::uint64_t microseconds)
+    {
+        buckets[bucket_index(microseconds)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(microseconds, std::memory_order_relaxed);
+        auto current_max = max.load(std::memory_order_relaxed);
+        while (current_max < microseconds &&
+               !max.compare_exchange_weak(current_max, microseconds, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+
+    std::uint64_t Max() const { return max.load(std::memory_order_relaxed); }
+
+    double Mean() const
+    {
+        const auto samples = Count();
+        return samples == 0 ? 0. : static_cast<double>(sum.load(std::memory_order_relaxed)) /
+                                       static_cast<double>(samples);
+    }
+
+    // Returns the lower bound of the bucket that contains the given quantile in [0,1]
+    std::uint64_t Quantile(const double quantile) const
+    {
+        const auto samples = Count();
+        if (samples == 0)
+        {
+            return 0;
+        }
+        const auto rank = static_cast<std::uint64_t>(quantile * static_cast<double>(samples - 1));
+        std::uint64_t seen = 0;
+        for (unsigned index = 0; index < NUMBER_OF_BUCKETS; ++index)
+        {
+            seen += buckets[index].load(std::memory_order_relaxed);
+            if (seen > rank)
+            {
+                return bucket_lower_bound(index);
+            }
+        }
+        return Max();
+    }
+
+  private:
+    static unsigned bucket_index(const std::uint64_t value)
+    {
+        if (value < LINEAR_BUCKETS)
+        {
+            return static_cast<unsigned>(value);
+        }
+        unsigned exponent = 63;
+        while (0 == (value >> exponent))
+        {
+            --exponent;
+        }
+        const auto sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) & 7;
+        return LINEAR_BUCKETS + (exponent - 4) * 8 + static_cast<unsigned>(sub_bucket);
+    }
+
+    static std::uint64_t bucket_lower_bound(const unsigned index)
+    {
+        if (index < LINEAR_BUCKETS)
+        {
+            return index;
+        }
+        const unsigned exponent = (index - LINEAR_BUCKETS) / 8 + 4;
+        const std::uint64_t sub_bucket = (index - LINEAR_BUCKETS) % 8;
+        return (std::uint64_t(1) << exponent) | (sub_bucket << (exponent - SUB_BUCKET_BITS));
+    }
+
+    std::array<std::atomic<std::uint64_t>, NUMBER_OF_BUCKETS> buckets;
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> sum;
+    std::atomic<std::uint64_t> max;
+};
+
+struct PluginMetrics
+{
+    std::array<LatencyHistogram, static_cast<unsigned>(Phase::number_of_phases)> phases;
+    // peak memory charged by each request in KiB, the buckets work for any unit
+    LatencyHistogram memory_peaks;
+};
+
+// Phase durations of the request currently handled by this thread
+struct RequestTimings
+{
+    RequestTimings() { Reset(); }
+
+    void Reset()
+    {
+        durations.fill(0);
+        recorded.fill(false);
+    }
+
+    std::array<std::uint64_t, static_cast<unsigned>(Phase::number_of_phases)> durations;
+    std::array<bool, static_cast<unsigned>(Phase::number_of_phases)> recorded;
+};
+
+// Process wide metrics of all services. The set of services is fixed at construction, so the
+// hot path never takes a lock; unknown services are accounted under "other".
+class Registry
+{
+  public:
+    static Registry &get()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    RequestTimings &CurrentTimings()
+    {
+        if (!current_timings.get())
+        {
+            current_timings.reset(new RequestTimings());
+        }
+        return *current_timings;
+    }
+
+    void AddPhase(const Phase phase, const std::uint64_t microseconds)
+    {
+        auto &timings = CurrentTimings();
+        timings.durations[static_cast<unsigned>(phase)] += microseconds;
+        timings.recorded[static_cast<unsigned>(phase)] = true;
+    }
+
+    // Moves the phase durations of this thread's current request into the histograms
+    void Commit(const std::string &service)
+    {
+        auto &timings = CurrentTimings();
+        auto iter = plugin_metrics.find(service);
+        if (plugin_metrics.end() == iter)
+        {
+            iter = plugin_metrics.find("other");
+        }
+        auto &metrics = iter->second;
+        for (unsigned phase = 0; phase < static_cast<unsigned>(Phase::number_of_phases); ++phase)
+        {
+            if (timings.recorded[phase])
+            {
+                metrics.phases[phase].Record(timings.durations[phase]);
+            }
+        }
+        timings.Reset();
+    }
+
+    void RecordMemoryPeak(const std::string &service, const std::size_t bytes)
+    {
+        auto iter = plugin_metrics.find(service);
+        if (plugin_metrics.end() == iter)
+        {
+            iter = plugin_metrics.find("other");
+        }
+        iter->second.memory_peaks.Record(bytes >> 10);
+    }
+
+    void Render(osrm::json::Object &json_result) const
+    {
+        for (const auto &service : plugin_metrics)
+        {
+            osrm::json::Object service_json;
+            for (unsigned phase = 0; phase < static_cast<unsigned>(Phase::number_of_phases);
+                 ++phase)
+            {
+                const auto &histogram = service.second.phases[phase];
+                if (0 == histogram.Count())
+                {
+                    continue;
+                }
+                osrm::json::Object phase_json;
+                phase_json.values.emplace("count", osrm::json::Number(histogram.Count()));
+                phase_json.values.emplace("mean_us", osrm::json::Number(histogram.Mean()));
+                phase_json.values.emplace("p50_us", osrm::json::Number(histogram.Quantile(0.5)));
+                phase_json.values.emplace("p90_us", osrm::json::Number(histogram.Quantile(0.9)));
+                phase_json.values.emplace("p99_us",
+                                          osrm::json::Number(histogram.Quantile(0.99)));
+                phase_json.values.emplace("max_us", osrm::json::Number(histogram.Max()));
+                service_json.values.emplace(phase_name(static_cast<Phase>(phase)),
+                                            std::move(phase_json));
+            }
+            const auto &memory_peaks = service.second.memory_peaks;
+            if (0 != memory_peaks.Count())
+            {
+                osrm::json::Object memory_json;
+                memory_json.values.emplace("count", osrm::json::Number(memory_peaks.Count()));
+                memory_json.values.emplace("mean_kib", osrm::json::Number(memory_peaks.Mean()));
+                memory_json.values.emplace("p50_kib",
+                                           osrm::json::Number(memory_peaks.Quantile(0.5)));
+                memory_json.values.emplace("p99_kib",
+                                           osrm::json::Number(memory_peaks.Quantile(0.99)));
+                memory_json.values.emplace("max_kib", osrm::json::Number(memory_peaks.Max()));
+                service_json.values.emplace("memory_peak", std::move(memory_json));
+            }
+            json_result.values.emplace(service.first, std::move(service_json));
+        }
+    }
+
+  private:
+    Registry()
+    {
+        for (const auto service : {"viaroute", "table", "match", "trip", "nearest", "locate",
+                                   "timestamp", "hello", "metrics", "other"})
+        {
+            plugin_metrics[service];
+        }
+    }
+
+    std::unordered_map<std::string, PluginMetrics> plugin_metrics;
+    boost::thread_specific_ptr<RequestTimings> current_timings;
+};
+
+// Measures the time until Stop() or destruction and accounts it to the current request
+class PhaseTimer
+{
+  public:
+    explicit PhaseTimer(const Phase phase)
+        : phase(phase), start(std::chrono::steady_clock::now()), running(true)
+    {
+    }
+
+    ~PhaseTimer() { Stop(); }
+
+    void Stop()
+    {
+        if (!running)
+        {
+            return;
+        }
+        running = false;
+        const auto stop = std::chrono::steady_clock::now();
+        TRACE_SPAN(phase_name(phase), start, stop);
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+        Registry::get().AddPhase(phase, static_cast<std::uint64_t>(elapsed.count()));
+    }
+
+  private:
+    const Phase phase;
+    const std::chrono::steady_clock::time_point start;
+    bool running;
+};
+}
+}
+
+#endif // REQUEST_METRICS_HPP
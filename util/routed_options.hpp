@@ -40,6 +40,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <fstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
 const static unsigned INIT_OK_START_ENGINE = 0;
 const static unsigned INIT_OK_DO_NOT_START_ENGINE = 1;
 const static unsigned INIT_FAILED = -1;
@@ -69,6 +71,14 @@ inline void populate_base_path(ServerPaths &server_paths)
         BOOST_ASSERT(server_paths.find("ramindex") != server_paths.end());
         server_paths["fileindex"] = base_string + ".fileIndex";
         BOOST_ASSERT(server_paths.find("fileindex") != server_paths.end());
+        server_paths["gridindex"] = base_string + ".gridIndex";
+        BOOST_ASSERT(server_paths.find("gridindex") != server_paths.end());
+        server_paths["locateindex"] = base_string + ".locateIndex";
+        BOOST_ASSERT(server_paths.find("locateindex") != server_paths.end());
+        server_paths["landmarks"] = base_string + ".landmarks";
+        BOOST_ASSERT(server_paths.find("landmarks") != server_paths.end());
+        server_paths["weights"] = base_string + ".weights";
+        BOOST_ASSERT(server_paths.find("weights") != server_paths.end());
         server_paths["namesdata"] = base_string + ".names";
         BOOST_ASSERT(server_paths.find("namesdata") != server_paths.end());
         server_paths["timestamp"] = base_string + ".timestamp";
@@ -144,18 +154,78 @@ inline void populate_base_path(ServerPaths &server_paths)
     SimpleLogger().Write(logDEBUG) << "Timestamp file:\t" << server_paths["timestamp"];
 }
 
+// parses <name>=<base.osrm> declarations of additional datasets
+inline void populate_datasets(const std::vector<std::string> &declarations,
+                              std::unordered_map<std::string, ServerPaths> &datasets)
+{
+    for (const auto &declaration : declarations)
+    {
+        const auto equal_sign = declaration.find('=');
+        if (std::string::npos == equal_sign || 0 == equal_sign ||
+            declaration.size() == equal_sign + 1)
+        {
+            throw osrm::exception("malformed dataset: " + declaration);
+        }
+        const std::string name = declaration.substr(0, equal_sign);
+        if (datasets.find(name) != datasets.end())
+        {
+            throw osrm::exception("dataset declared twice: " + name);
+        }
+        datasets[name]["base"] = declaration.substr(equal_sign + 1);
+    }
+}
+
 // generate boost::program_options object for the routing part
 inline unsigned GenerateServerProgramOptions(const int argc,
                                              const char *argv[],
                                              ServerPaths &paths,
                                              std::string &ip_address,
                                              int &ip_port,
+                                             int &http2_port,
+                                             std::string &unix_socket_path,
                                              int &requested_num_threads,
                                              bool &use_shared_memory,
                                              bool &trial,
                                              int &max_locations_distance_table,
-                                             int &max_locations_map_matching)
+                                             int &max_locations_map_matching,
+                                             int &max_locations_target_set,
+                                             int &max_batch_routes,
+                                             int &max_isochrone_time,
+                                             int &max_matching_sessions,
+                                             int &matching_session_ttl,
+                                             int &keepalive_timeout,
+                                             int &keepalive_max_requests,
+                                             int &request_timeout,
+                                             bool &io_service_per_thread,
+                                             bool &pin_threads,
+                                             int &access_log_sampling,
+                                             std::vector<std::string> &service_limits,
+                                             int &response_cache_size,
+                                             int &gzip_level,
+                                             int &brotli_quality,
+                                             int &zstd_level,
+                                             std::string &compression_dictionary,
+                                             int &phantom_node_cache_size,
+                                             int &shortcut_cache_size,
+                                             int &trip_cache_size,
+                                             int &parallel_snapping_threshold,
+                                             int &max_request_memory,
+                                             int &max_total_request_memory,
+                                             bool &dense_query_heaps,
+                                             bool &compact_query_graph,
+                                             bool &split_query_graph,
+                                             bool &parallel_bidirectional_search,
+                                             bool &parallel_leg_search,
+                                             bool &approximate_alternatives,
+                                             bool &prefetch_search_graph,
+                                             bool &verify_image,
+                                             std::string &locked_image_blocks,
+                                             bool &warm_up_dataset,
+                                             std::string &warm_up_queries,
+                                             std::unordered_map<std::string, ServerPaths> &datasets)
 {
+    std::vector<std::string> dataset_declarations;
+
     // declare a group of options that will be allowed only on command line
     boost::program_options::options_description generic_options("Options");
     generic_options.add_options()("version,v", "Show version")("help,h", "Show this help message")(
@@ -181,6 +251,15 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         ".ramIndex file")(
         "fileindex", boost::program_options::value<boost::filesystem::path>(&paths["fileindex"]),
         "File index file")(
+        "gridindex", boost::program_options::value<boost::filesystem::path>(&paths["gridindex"]),
+        ".gridIndex file, optional")(
+        "locateindex",
+        boost::program_options::value<boost::filesystem::path>(&paths["locateindex"]),
+        ".locateIndex file, optional")(
+        "landmarks", boost::program_options::value<boost::filesystem::path>(&paths["landmarks"]),
+        ".landmarks file, optional")(
+        "weights", boost::program_options::value<boost::filesystem::path>(&paths["weights"]),
+        ".weights file of osrm-customize, optional")(
         "namesdata", boost::program_options::value<boost::filesystem::path>(&paths["namesdata"]),
         ".names file")("timestamp",
                        boost::program_options::value<boost::filesystem::path>(&paths["timestamp"]),
@@ -188,17 +267,142 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         "ip,i", boost::program_options::value<std::string>(&ip_address)->default_value("0.0.0.0"),
         "IP address")("port,p", boost::program_options::value<int>(&ip_port)->default_value(5000),
                       "TCP/IP port")(
+        "http2-port", boost::program_options::value<int>(&http2_port)->default_value(0),
+        "Additionally serve HTTP/2 with prior knowledge (h2c) on this TCP/IP port, its requests "
+        "are multiplexed over few connections. 0 disables it")(
+        "unix-socket", boost::program_options::value<std::string>(&unix_socket_path),
+        "Additionally serve requests on a Unix domain socket at this path")(
         "threads,t", boost::program_options::value<int>(&requested_num_threads)->default_value(8),
         "Number of threads to use")(
         "shared-memory,s",
         boost::program_options::value<bool>(&use_shared_memory)->implicit_value(true),
         "Load data from shared memory")(
+        "image", boost::program_options::value<boost::filesystem::path>(&paths["image"]),
+        "Map a dataset image written by osrm-prepare --image or osrm-datastore --image")(
+        "verify-image", boost::program_options::value<bool>(&verify_image)->implicit_value(true),
+        "Check the checksums of all blocks of the image before serving it, reads the whole "
+        "image at startup")(
+        "lock-image-blocks", boost::program_options::value<std::string>(&locked_image_blocks),
+        "Keep these blocks of the image in RAM, separated by commas, 'graph' for the blocks of "
+        "the search graph. The others are read from the file as queries touch them")(
+        "warm-up", boost::program_options::value<bool>(&warm_up_dataset)->implicit_value(true),
+        "Read every page of a new dataset and allocate the query heaps before serving it")(
+        "warm-up-queries", boost::program_options::value<std::string>(&warm_up_queries),
+        "Replay the requests of this file, one per line, on every new dataset before serving "
+        "it")(
         "max-table-size,m",
         boost::program_options::value<int>(&max_locations_distance_table)->default_value(100),
         "Max. locations supported in distance table query")(
         "max-matching-size,m",
         boost::program_options::value<int>(&max_locations_map_matching)->default_value(2),
-        "Max. locations supported in map matching query");
+        "Max. locations supported in map matching query")(
+        "max-target-set-size",
+        boost::program_options::value<int>(&max_locations_target_set)->default_value(5000),
+        "Max. targets of a set registered with the targets service")(
+        "max-batch-size",
+        boost::program_options::value<int>(&max_batch_routes)->default_value(10000),
+        "Max. origin-destination pairs of a single batch query")(
+        "max-isochrone-time",
+        boost::program_options::value<int>(&max_isochrone_time)->default_value(3600),
+        "Max. seconds of travel that bound an isochrone query")(
+        "max-matching-sessions",
+        boost::program_options::value<int>(&max_matching_sessions)->default_value(0),
+        "Max. online matching sessions kept, 0 disables sessions in the match service")(
+        "matching-session-ttl",
+        boost::program_options::value<int>(&matching_session_ttl)->default_value(300),
+        "Seconds after which an idle matching session starts over")(
+        "keepalive-timeout",
+        boost::program_options::value<int>(&keepalive_timeout)->default_value(5),
+        "Seconds an idle persistent connection is kept open, 0 disables keep-alive")(
+        "keepalive-requests",
+        boost::program_options::value<int>(&keepalive_max_requests)->default_value(100),
+        "Max. requests served over a single persistent connection")(
+        "request-timeout",
+        boost::program_options::value<int>(&request_timeout)->default_value(0),
+        "Milliseconds after which the searches of a request give up with 504, 0 for no limit. "
+        "A request may ask for less with the timeout parameter")(
+        "io-service-per-thread",
+        boost::program_options::value<bool>(&io_service_per_thread)->implicit_value(true),
+        "Run a separate reactor per thread instead of sharing one")(
+        "pin-threads",
+        boost::program_options::value<bool>(&pin_threads)->implicit_value(true),
+        "Pin every server thread to its own CPU of the allowed ones, combine with numactl to run "
+        "one server per NUMA node")(
+        "access-log-sampling",
+        boost::program_options::value<int>(&access_log_sampling)->default_value(1),
+        "Log every n-th request, 0 disables the access log")(
+        "service-limit",
+        boost::program_options::value<std::vector<std::string>>(&service_limits)->composing(),
+        "Limit concurrent queries of a service as <service>=<running>:<queued>, e.g. "
+        "table=2:8. Keep the sum of all limits below the number of threads")(
+        "response-cache-size",
+        boost::program_options::value<int>(&response_cache_size)->default_value(0),
+        "Number of replies cached for repeated identical queries, 0 disables the cache")(
+        "gzip-level", boost::program_options::value<int>(&gzip_level)->default_value(1),
+        "Compression level of gzip and deflate replies, 1-9")(
+        "brotli-quality", boost::program_options::value<int>(&brotli_quality)->default_value(4),
+        "Compression quality of brotli replies, 0-11")(
+        "zstd-level", boost::program_options::value<int>(&zstd_level)->default_value(3),
+        "Compression level of zstd replies, 1-19")(
+        "compression-dictionary",
+        boost::program_options::value<std::string>(&compression_dictionary),
+        "File of raw content that clients may hold as a shared dictionary, replies to those "
+        "that announce it with Available-Dictionary are compressed with it as dcz")(
+        "phantom-node-cache-size",
+        boost::program_options::value<int>(&phantom_node_cache_size)->default_value(0),
+        "Number of coordinates whose snapped phantom nodes are cached, 0 disables the cache")(
+        "shortcut-cache-size",
+        boost::program_options::value<int>(&shortcut_cache_size)->default_value(0),
+        "Number of shortcuts whose unpacked edges are cached, 0 disables the cache")(
+        "trip-cache-size",
+        boost::program_options::value<int>(&trip_cache_size)->default_value(0),
+        "Number of trip stops whose search spaces are cached to reuse their rows of the "
+        "distance table, 0 disables the cache")(
+        "parallel-snapping-threshold",
+        boost::program_options::value<int>(&parallel_snapping_threshold)->default_value(128),
+        "Number of coordinates from which a request snaps them on worker threads, 0 "
+        "disables parallel snapping")(
+        "max-request-memory",
+        boost::program_options::value<int>(&max_request_memory)->default_value(0),
+        "Megabytes a single request may allocate for its search spaces, results and response, "
+        "larger requests fail with 413. 0 for no limit")(
+        "max-total-request-memory",
+        boost::program_options::value<int>(&max_total_request_memory)->default_value(0),
+        "Megabytes all requests in flight may allocate together, requests beyond fail with "
+        "503. 0 for no limit")(
+        "dense-query-heaps",
+        boost::program_options::value<bool>(&dense_query_heaps)->implicit_value(true),
+        "Index query heaps by array instead of hash map, faster but needs 24 bytes per node "
+        "and thread")(
+        "compact-graph",
+        boost::program_options::value<bool>(&compact_query_graph)->implicit_value(true),
+        "Bit-pack the edges of the query graph, needs less memory and cache but decodes every "
+        "edge, not used with shared memory")(
+        "split-graph",
+        boost::program_options::value<bool>(&split_query_graph)->implicit_value(true),
+        "Keep the ids of the query graph edges apart from their targets and weights, so that "
+        "the searches read half the bytes per edge. With shared memory osrm-datastore "
+        "--split-graph chooses the layout")(
+        "parallel-search",
+        boost::program_options::value<bool>(&parallel_bidirectional_search)->implicit_value(true),
+        "Run the forward and reverse search of a route on two threads, lowers the latency of "
+        "long routes when cores are spare")(
+        "parallel-legs",
+        boost::program_options::value<bool>(&parallel_leg_search)->implicit_value(true),
+        "Search the legs of routes with via points on worker threads, lowers the latency of "
+        "routes with many waypoints")(
+        "approximate-alternatives",
+        boost::program_options::value<bool>(&approximate_alternatives)->implicit_value(true),
+        "Select alternative routes from the search of the shortest route alone, faster but "
+        "the alternatives may contain detours")(
+        "prefetch-graph",
+        boost::program_options::value<bool>(&prefetch_search_graph)->implicit_value(true),
+        "Prefetch the heap entries of edge targets and the edges of the next node in the "
+        "searches, hides memory latency on graphs that do not fit into the cache")(
+        "dataset",
+        boost::program_options::value<std::vector<std::string>>(&dataset_declarations)
+            ->composing(),
+        "Serve an additional dataset as <name>=<base.osrm>, selected with profile=<name>");
 
     // hidden options, will be allowed both on command line and in config
     // file, but will not be shown to the user
@@ -255,18 +459,85 @@ inline unsigned GenerateServerProgramOptions(const int argc,
         boost::program_options::store(parse_config_file(config_stream, config_file_options),
                                       option_variables);
         boost::program_options::notify(option_variables);
+        populate_datasets(dataset_declarations, datasets);
         return INIT_OK_START_ENGINE;
     }
 
+    populate_datasets(dataset_declarations, datasets);
+
     if (1 > requested_num_threads)
     {
         throw osrm::exception("Number of threads must be a positive number");
     }
+    if (0 > http2_port)
+    {
+        throw osrm::exception("HTTP/2 port must not be negative");
+    }
+    if (0 > response_cache_size)
+    {
+        throw osrm::exception("Response cache size must not be negative");
+    }
+    if (0 > phantom_node_cache_size)
+    {
+        throw osrm::exception("Phantom node cache size must not be negative");
+    }
+    if (0 > shortcut_cache_size)
+    {
+        throw osrm::exception("Shortcut cache size must not be negative");
+    }
+    if (1 > max_locations_target_set)
+    {
+        throw osrm::exception("Max. size of target sets must be a positive number");
+    }
+    if (0 > parallel_snapping_threshold)
+    {
+        throw osrm::exception("Parallel snapping threshold must not be negative");
+    }
+    if (1 > max_batch_routes)
+    {
+        throw osrm::exception("Max. size of batch queries must be a positive number");
+    }
+    if (1 > max_isochrone_time)
+    {
+        throw osrm::exception("Max. time of isochrone queries must be a positive number");
+    }
+    if (0 > max_matching_sessions)
+    {
+        throw osrm::exception("Max. matching sessions must not be negative");
+    }
+    if (1 > matching_session_ttl)
+    {
+        throw osrm::exception("Matching session TTL must be a positive number");
+    }
+    if (0 > access_log_sampling)
+    {
+        throw osrm::exception("Access log sampling must not be negative");
+    }
+    if (0 > keepalive_timeout)
+    {
+        throw osrm::exception("Keep-alive timeout must not be negative");
+    }
+    if (1 > keepalive_max_requests)
+    {
+        throw osrm::exception("Max. requests per connection must be a positive number");
+    }
+    if (0 > request_timeout)
+    {
+        throw osrm::exception("Request timeout must not be negative");
+    }
+    if (0 > max_request_memory || 0 > max_total_request_memory)
+    {
+        throw osrm::exception("Request memory limits must not be negative");
+    }
 
     if (!use_shared_memory && option_variables.count("base"))
     {
         return INIT_OK_START_ENGINE;
     }
+    if (!use_shared_memory && option_variables.count("image"))
+    {
+        return INIT_OK_START_ENGINE;
+    }
     if (use_shared_memory && !option_variables.count("base"))
     {
         return INIT_OK_START_ENGINE;
@@ -0,0 +1,136 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef SEARCH_STATISTICS_HPP
+#define SEARCH_STATISTICS_HPP
+
+#include "json_logger.hpp"
+#include "request_metrics.hpp"
+
+#include <osrm/json_container.hpp>
+
+#include <cstdint>
+
+namespace osrm
+{
+namespace search_statistics
+{
+
+// Work done by the searches of the request currently handled by this thread
+struct Counters
+{
+    std::uint64_t settled_nodes = 0;
+    std::uint64_t relaxed_edges = 0;
+    std::uint64_t heap_pushes = 0;
+    std::uint64_t stalled_nodes = 0;
+    std::uint64_t core_entries = 0;
+    std::uint64_t unpacked_shortcuts = 0;
+};
+
+// Counts nothing, every hook compiles to nothing
+struct NoStatistics
+{
+    static constexpr bool enabled = false;
+
+    static void Reset() {}
+    static void Settle() {}
+    static void Relax() {}
+    static void Push() {}
+    static void Stall() {}
+    static void EnterCore() {}
+    static void UnpackShortcut() {}
+    static Counters Get() { return Counters(); }
+};
+
+// Counts into thread local counters, the searches of a request run on the handling thread
+struct CountingStatistics
+{
+    static constexpr bool enabled = true;
+
+    static void Reset() { counters() = Counters(); }
+    static void Settle() { ++counters().settled_nodes; }
+    static void Relax() { ++counters().relaxed_edges; }
+    static void Push() { ++counters().heap_pushes; }
+    static void Stall() { ++counters().stalled_nodes; }
+    static void EnterCore() { ++counters().core_entries; }
+    static void UnpackShortcut() { ++counters().unpacked_shortcuts; }
+    static Counters Get() { return counters(); }
+
+  private:
+    static Counters &counters()
+    {
+        static thread_local Counters thread_counters;
+        return thread_counters;
+    }
+};
+
+// The statistics are collected in the builds that emit the JSON debug output
+#if !defined(NDEBUG) || defined(ENABLE_JSON_LOGGING)
+using Policy = CountingStatistics;
+#else
+using Policy = NoStatistics;
+#endif
+
+// Adds the counters and the phase durations measured so far to the debug output of the response
+inline void render(osrm::json::Object &json_result)
+{
+    if (!Policy::enabled || !osrm::json::Logger::get())
+    {
+        return;
+    }
+
+    const Counters counters = Policy::Get();
+    osrm::json::Object search;
+    search.values["settled_nodes"] = osrm::json::Number(counters.settled_nodes);
+    search.values["relaxed_edges"] = osrm::json::Number(counters.relaxed_edges);
+    search.values["heap_pushes"] = osrm::json::Number(counters.heap_pushes);
+    search.values["stalled_nodes"] = osrm::json::Number(counters.stalled_nodes);
+    search.values["core_entries"] = osrm::json::Number(counters.core_entries);
+    search.values["unpacked_shortcuts"] = osrm::json::Number(counters.unpacked_shortcuts);
+
+    const auto &timings = osrm::metrics::Registry::get().CurrentTimings();
+    osrm::json::Object phases;
+    for (unsigned phase = 0; phase < static_cast<unsigned>(osrm::metrics::Phase::number_of_phases);
+         ++phase)
+    {
+        if (timings.recorded[phase])
+        {
+            phases.values[osrm::metrics::phase_name(static_cast<osrm::metrics::Phase>(phase))] =
+                osrm::json::Number(timings.durations[phase]);
+        }
+    }
+    search.values["phase_us"] = phases;
+
+    osrm::json::Object debug;
+    debug.values["search"] = search;
+    json_result.values["debug"] = debug;
+}
+}
+}
+
+#endif // SEARCH_STATISTICS_HPP
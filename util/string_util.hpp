@@ -81,6 +81,15 @@ template <int length, int precision> static inline char *printInt(char *buffer,
     return buffer;
 }
 
+// Writes a fixed-point coordinate with six decimals, e.g. -33.868820, into buffer and returns
+// the start of the text, which ends at buffer + COORDINATE_STRING_LENGTH.
+constexpr int COORDINATE_STRING_LENGTH = 11;
+inline char *printCoordinate(char (&buffer)[COORDINATE_STRING_LENGTH + 1], const int value)
+{
+    buffer[COORDINATE_STRING_LENGTH] = 0; // zero termination
+    return printInt<COORDINATE_STRING_LENGTH, 6>(buffer, value);
+}
+
 inline std::string escape_JSON(const std::string &input)
 {
     // escape and skip reallocations if possible
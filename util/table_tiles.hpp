@@ -0,0 +1,323 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TABLE_TILES_HPP
+#define TABLE_TILES_HPP
+
+#include "matrix_renderer.hpp"
+
+#include "../typedefs.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace osrm
+{
+namespace table_tiles
+{
+
+// The parameters of a table query, split up so that the query of a part of the table can be put
+// together from them. The parameters are kept as they came, none of them is decoded.
+struct TableQuery
+{
+    TableQuery() : lengths(false), matrix_output(false) {}
+
+    // every location with the parameters that refer to it, e.g. "loc=52.5,13.4&hint=..."
+    std::vector<std::string> locations;
+    // the rows and columns of the table, all locations unless they are given
+    std::vector<unsigned> sources;
+    std::vector<unsigned> destinations;
+    // the other parameters joined by '&', they are the same for every tile
+    std::string shared_parameters;
+    bool lengths;
+    bool matrix_output;
+};
+
+// A tile of the table, in positions of the sources and destinations
+struct Tile
+{
+    unsigned first_row;
+    unsigned number_of_rows;
+    unsigned first_column;
+    unsigned number_of_columns;
+};
+
+// Splits the query string of a table request, the part behind '?'. Returns false if the query
+// can't be split into tiles: encoded polylines, bounded tables, jsonp and output formats other
+// than json and matrix are left to a single backend, and so are invalid indices for it to reject.
+inline bool ParseTableQuery(const std::string &query, TableQuery &table_query)
+{
+    table_query = TableQuery();
+    // the parameters of the locations, see RouteParameters::addHint
+    const auto is_location_parameter = [](const std::string &name)
+    {
+        return "hint" == name || "t" == name || "b" == name;
+    };
+    const auto is_true = [](const std::string &value)
+    {
+        return "true" == value || "1" == value;
+    };
+
+    std::size_t begin = 0;
+    while (begin < query.size())
+    {
+        std::size_t end = query.find('&', begin);
+        if (std::string::npos == end)
+        {
+            end = query.size();
+        }
+        const std::string parameter = query.substr(begin, end - begin);
+        begin = end + 1;
+        if (parameter.empty())
+        {
+            continue;
+        }
+        const std::size_t equal_sign = parameter.find('=');
+        const std::string name = parameter.substr(0, equal_sign);
+        const std::string value =
+            std::string::npos == equal_sign ? std::string() : parameter.substr(equal_sign + 1);
+
+        if ("loc" == name)
+        {
+            table_query.locations.push_back(parameter);
+        }
+        else if (is_location_parameter(name))
+        {
+            // those in front of the first location are ignored, as by the server
+            if (!table_query.locations.empty())
+            {
+                table_query.locations.back() += "&" + parameter;
+            }
+        }
+        else if ("src" == name || "dst" == name)
+        {
+            char *number_end = nullptr;
+            const unsigned long index = std::strtoul(value.c_str(), &number_end, 10);
+            if (value.empty() || '\0' != *number_end)
+            {
+                return false;
+            }
+            ("src" == name ? table_query.sources : table_query.destinations)
+                .push_back(static_cast<unsigned>(index));
+        }
+        else if ("output" == name)
+        {
+            if ("matrix" == value)
+            {
+                table_query.matrix_output = true;
+            }
+            else if ("json" != value)
+            {
+                return false;
+            }
+        }
+        else if ("locs" == name || "jsonp" == name || "max_duration" == name ||
+                 "target_set" == name)
+        {
+            return false;
+        }
+        else
+        {
+            if ("lengths" == name)
+            {
+                table_query.lengths = is_true(value);
+            }
+            if (!table_query.shared_parameters.empty())
+            {
+                table_query.shared_parameters.push_back('&');
+            }
+            table_query.shared_parameters += parameter;
+        }
+    }
+
+    const auto number_of_locations = static_cast<unsigned>(table_query.locations.size());
+    const auto index_is_invalid = [number_of_locations](const unsigned index)
+    {
+        return index >= number_of_locations;
+    };
+    if (std::any_of(table_query.sources.begin(), table_query.sources.end(), index_is_invalid) ||
+        std::any_of(table_query.destinations.begin(), table_query.destinations.end(),
+                    index_is_invalid))
+    {
+        return false;
+    }
+    if (table_query.sources.empty())
+    {
+        table_query.sources.resize(number_of_locations);
+        std::iota(table_query.sources.begin(), table_query.sources.end(), 0u);
+    }
+    if (table_query.destinations.empty())
+    {
+        table_query.destinations.resize(number_of_locations);
+        std::iota(table_query.destinations.begin(), table_query.destinations.end(), 0u);
+    }
+    return number_of_locations > 0;
+}
+
+// tiles of at most tile_size rows and columns, row by row
+inline std::vector<Tile>
+MakeTiles(const unsigned number_of_rows, const unsigned number_of_columns, const unsigned tile_size)
+{
+    std::vector<Tile> tiles;
+    for (unsigned row = 0; row < number_of_rows; row += tile_size)
+    {
+        for (unsigned column = 0; column < number_of_columns; column += tile_size)
+        {
+            tiles.push_back({row, std::min(tile_size, number_of_rows - row), column,
+                             std::min(tile_size, number_of_columns - column)});
+        }
+    }
+    return tiles;
+}
+
+// The query of a tile with the locations of its rows and columns only, each of them once. The
+// tile comes back as a matrix, see util/matrix_renderer.hpp.
+inline std::string TileQuery(const TableQuery &table_query, const Tile &tile)
+{
+    std::vector<unsigned> tile_locations;
+    tile_locations.reserve(tile.number_of_rows + tile.number_of_columns);
+    tile_locations.insert(tile_locations.end(),
+                          table_query.sources.begin() + tile.first_row,
+                          table_query.sources.begin() + tile.first_row + tile.number_of_rows);
+    tile_locations.insert(tile_locations.end(),
+                          table_query.destinations.begin() + tile.first_column,
+                          table_query.destinations.begin() + tile.first_column +
+                              tile.number_of_columns);
+    std::sort(tile_locations.begin(), tile_locations.end());
+    tile_locations.erase(std::unique(tile_locations.begin(), tile_locations.end()),
+                         tile_locations.end());
+    const auto position_of = [&tile_locations](const unsigned location)
+    {
+        return std::to_string(
+            std::lower_bound(tile_locations.begin(), tile_locations.end(), location) -
+            tile_locations.begin());
+    };
+
+    std::string query = table_query.shared_parameters;
+    const auto append = [&query](const std::string &parameter)
+    {
+        if (!query.empty())
+        {
+            query.push_back('&');
+        }
+        query += parameter;
+    };
+    for (const unsigned location : tile_locations)
+    {
+        append(table_query.locations[location]);
+    }
+    for (unsigned row = tile.first_row; row < tile.first_row + tile.number_of_rows; ++row)
+    {
+        append("src=" + position_of(table_query.sources[row]));
+    }
+    for (unsigned column = tile.first_column;
+         column < tile.first_column + tile.number_of_columns; ++column)
+    {
+        append("dst=" + position_of(table_query.destinations[column]));
+    }
+    append("output=matrix");
+    return query;
+}
+
+// Copies the matrix of a tile at position offset of a reply into the table of all rows and
+// columns. Returns false unless the reply holds a matrix of the size of the tile there.
+inline bool ReadTile(const std::string &reply,
+                     std::size_t &offset,
+                     const Tile &tile,
+                     const unsigned number_of_columns,
+                     std::vector<EdgeWeight> &table)
+{
+    const auto read_little_endian = [&reply](const std::size_t position)
+    {
+        std::uint32_t value = 0;
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            value |= static_cast<std::uint32_t>(static_cast<unsigned char>(reply[position + i]))
+                     << (8 * i);
+        }
+        return value;
+    };
+    const std::size_t size = json::MatrixRenderer::HEADER_SIZE +
+                             std::size_t(tile.number_of_rows) * tile.number_of_columns * 4;
+    if (reply.size() < offset + size || json::MatrixRenderer::MAGIC != read_little_endian(offset) ||
+        json::MatrixRenderer::VERSION != read_little_endian(offset + 4) ||
+        tile.number_of_rows != read_little_endian(offset + 8) ||
+        tile.number_of_columns != read_little_endian(offset + 12))
+    {
+        return false;
+    }
+    std::size_t position = offset + json::MatrixRenderer::HEADER_SIZE;
+    for (unsigned row = 0; row < tile.number_of_rows; ++row)
+    {
+        EdgeWeight *output =
+            &table[std::size_t(tile.first_row + row) * number_of_columns + tile.first_column];
+        for (unsigned column = 0; column < tile.number_of_columns; ++column, position += 4)
+        {
+            output[column] = static_cast<EdgeWeight>(read_little_endian(position));
+        }
+    }
+    offset += size;
+    return true;
+}
+
+// appends a table as a json array of its rows, as the table plugin renders it
+inline void RenderTable(std::string &out,
+                        const std::vector<EdgeWeight> &table,
+                        const unsigned number_of_rows,
+                        const unsigned number_of_columns)
+{
+    out.push_back('[');
+    for (unsigned row = 0; row < number_of_rows; ++row)
+    {
+        if (row > 0)
+        {
+            out.push_back(',');
+        }
+        out.push_back('[');
+        for (unsigned column = 0; column < number_of_columns; ++column)
+        {
+            if (column > 0)
+            {
+                out.push_back(',');
+            }
+            out += std::to_string(table[std::size_t(row) * number_of_columns + column]);
+        }
+        out.push_back(']');
+    }
+    out.push_back(']');
+}
+
+} // namespace table_tiles
+} // namespace osrm
+
+#endif // TABLE_TILES_HPP
@@ -0,0 +1,283 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TAG_VALUE_PARSER_HPP
+#define TAG_VALUE_PARSER_HPP
+
+#include <limits>
+
+// Allocation-free parsers for the values of OSM tags that the profiles look at for many ways.
+// All of them work on a [first, last) character range and never throw.
+namespace tag_value
+{
+namespace detail
+{
+inline bool is_digit(const char c) { return c >= '0' && c <= '9'; }
+
+inline void skip_spaces(const char *&first, const char *last)
+{
+    while (first != last && *first == ' ')
+    {
+        ++first;
+    }
+}
+
+inline bool consume(const char *&first, const char *last, const char *literal)
+{
+    const char *position = first;
+    for (; *literal != '\0'; ++literal, ++position)
+    {
+        if (position == last || *position != *literal)
+        {
+            return false;
+        }
+    }
+    first = position;
+    return true;
+}
+
+// reads between one and max_digits digits, fails on overflow
+inline bool
+parse_uint(const char *&first, const char *last, unsigned &value, unsigned max_digits)
+{
+    const char *position = first;
+    unsigned result = 0;
+    for (; position != last && is_digit(*position); ++position)
+    {
+        const unsigned digit = *position - '0';
+        if (static_cast<unsigned>(position - first) == max_digits ||
+            result > (std::numeric_limits<unsigned>::max() - digit) / 10)
+        {
+            return false;
+        }
+        result = 10 * result + digit;
+    }
+    if (position == first)
+    {
+        return false;
+    }
+    first = position;
+    value = result;
+    return true;
+}
+
+// reads a non-negative decimal number like 50 or 2.5
+inline bool parse_number(const char *&first, const char *last, double &value)
+{
+    const char *position = first;
+    double result = 0.;
+    for (; position != last && is_digit(*position); ++position)
+    {
+        result = 10. * result + (*position - '0');
+    }
+    if (position == first)
+    {
+        return false;
+    }
+    if (position != last && *position == '.')
+    {
+        double scale = 0.1;
+        for (++position; position != last && is_digit(*position); ++position)
+        {
+            result += scale * (*position - '0');
+            scale *= 0.1;
+        }
+    }
+    first = position;
+    value = result;
+    return true;
+}
+}
+
+// h, h:m or h:m:s with one or two digits per field, a single number gives minutes
+inline bool parse_simple_duration(const char *first, const char *last, unsigned &duration)
+{
+    unsigned fields[3];
+    unsigned number_of_fields = 0;
+    while (true)
+    {
+        if (!detail::parse_uint(first, last, fields[number_of_fields], 2))
+        {
+            return false;
+        }
+        ++number_of_fields;
+        if (first == last)
+        {
+            break;
+        }
+        if (*first != ':' || number_of_fields == 3)
+        {
+            return false;
+        }
+        ++first;
+    }
+
+    switch (number_of_fields)
+    {
+    case 1:
+        duration = 60 * fields[0];
+        break;
+    case 2:
+        duration = 3600 * fields[0] + 60 * fields[1];
+        break;
+    default:
+        duration = 3600 * fields[0] + 60 * fields[1] + fields[2];
+        break;
+    }
+    return true;
+}
+
+// PT followed by hours, minutes and seconds in this order, each one optional but at least one.
+// Like the grammar this replaces it accepts trailing characters, ignores components that are
+// out of range and reports a total of zero as the maximal duration.
+inline bool parse_iso_8601_duration(const char *first, const char *last, unsigned &duration)
+{
+    if (!detail::consume(first, last, "PT"))
+    {
+        return false;
+    }
+
+    unsigned hours = 0, minutes = 0, seconds = 0;
+    int previous_component = -1;
+    while (true)
+    {
+        unsigned value;
+        const char *position = first;
+        const unsigned any_length = std::numeric_limits<unsigned>::max();
+        if (!detail::parse_uint(position, last, value, any_length) || position == last)
+        {
+            break;
+        }
+
+        int component;
+        switch (*position)
+        {
+        case 'h':
+        case 'H':
+            component = 0;
+            break;
+        case 'm':
+        case 'M':
+            component = 1;
+            break;
+        case 's':
+        case 'S':
+            component = 2;
+            break;
+        default:
+            component = -1;
+            break;
+        }
+        if (component <= previous_component)
+        {
+            break;
+        }
+
+        const unsigned limit = component == 0 ? 24 : 60;
+        unsigned &target = component == 0 ? hours : (component == 1 ? minutes : seconds);
+        if (value < limit)
+        {
+            target = value;
+        }
+        previous_component = component;
+        first = position + 1;
+    }
+
+    if (previous_component < 0)
+    {
+        return false;
+    }
+
+    duration = 3600 * hours + 60 * minutes + seconds;
+    if (0 == duration)
+    {
+        duration = std::numeric_limits<unsigned>::max();
+    }
+    return true;
+}
+
+inline bool parse_duration(const char *first, const char *last, unsigned &duration)
+{
+    return parse_simple_duration(first, last, duration) ||
+           parse_iso_8601_duration(first, last, duration);
+}
+
+// speed in km/h from values like 50, 50 km/h, 30 mph or 10 knots, 0 if there is no number.
+// Anything after a recognized unit is ignored.
+inline double parse_speed(const char *first, const char *last)
+{
+    double speed;
+    if (!detail::parse_number(first, last, speed))
+    {
+        return 0.;
+    }
+    detail::skip_spaces(first, last);
+    if (detail::consume(first, last, "mph") || detail::consume(first, last, "mp/h"))
+    {
+        return speed * 1.609;
+    }
+    if (detail::consume(first, last, "knots") || detail::consume(first, last, "kn"))
+    {
+        return speed * 1.852;
+    }
+    return speed;
+}
+
+// length in meters from values like 3, 3.5 m, 12 ft, 7'6" or 80 in, 0 if there is no number
+inline double parse_length(const char *first, const char *last)
+{
+    double length;
+    if (!detail::parse_number(first, last, length))
+    {
+        return 0.;
+    }
+    detail::skip_spaces(first, last);
+    if (detail::consume(first, last, "'") || detail::consume(first, last, "ft"))
+    {
+        length *= 0.3048;
+        detail::skip_spaces(first, last);
+        double inches;
+        if (detail::parse_number(first, last, inches))
+        {
+            length += inches * 0.0254;
+        }
+        return length;
+    }
+    if (detail::consume(first, last, "\"") || detail::consume(first, last, "in"))
+    {
+        return length * 0.0254;
+    }
+    if (detail::consume(first, last, "cm"))
+    {
+        return length * 0.01;
+    }
+    return length;
+}
+}
+
+#endif // TAG_VALUE_PARSER_HPP
@@ -0,0 +1,122 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+#ifndef THREAD_AFFINITY_HPP
+#define THREAD_AFFINITY_HPP
+
+#include <tbb/task_scheduler_observer.h>
+
+#include <atomic>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace osrm
+{
+namespace affinity
+{
+
+// The CPUs the process may run on in ascending order, empty if the platform can't tell. Taking
+// them from the affinity mask keeps a 'numactl --cpunodebind' or 'taskset' of the caller intact.
+inline std::vector<unsigned> AllowedCPUs()
+{
+    std::vector<unsigned> cpus;
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (0 == sched_getaffinity(0, sizeof(cpu_set), &cpu_set))
+    {
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &cpu_set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+// Pins the calling thread to a single CPU. Returns false if that is not supported or failed.
+inline bool PinCurrentThread(const unsigned cpu)
+{
+#ifdef __linux__
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    return 0 == pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#else
+    static_cast<void>(cpu);
+    return false;
+#endif
+}
+
+// Pins every thread that joins the TBB scheduler to the next allowed CPU, round-robin, for as
+// long as the object lives. Memory that a pinned thread touches first is allocated on its NUMA
+// node and stays there, instead of being read across sockets once the thread migrates.
+class TBBThreadPinning final : public tbb::task_scheduler_observer
+{
+  public:
+    TBBThreadPinning() : cpus(AllowedCPUs()), next_cpu(0)
+    {
+        if (!cpus.empty())
+        {
+            observe(true);
+        }
+    }
+
+    ~TBBThreadPinning()
+    {
+        if (!cpus.empty())
+        {
+            observe(false);
+        }
+    }
+
+    void on_scheduler_entry(bool) override
+    {
+        // threads enter the scheduler again after they slept, they keep their first CPU
+        static thread_local bool is_pinned = false;
+        if (!is_pinned)
+        {
+            PinCurrentThread(cpus[next_cpu.fetch_add(1) % cpus.size()]);
+            is_pinned = true;
+        }
+    }
+
+  private:
+    const std::vector<unsigned> cpus;
+    std::atomic<unsigned> next_cpu;
+};
+}
+}
+
+#endif // THREAD_AFFINITY_HPP
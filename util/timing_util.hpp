@@ -28,6 +28,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef TIMING_UTIL_HPP
 #define TIMING_UTIL_HPP
 
+#include "trace.hpp"
+
 #include <atomic>
 #include <chrono>
 #include <cstdint>
@@ -73,7 +75,8 @@ class GlobalTimerFactory
 #define GLOBAL_TIMER_SEC(_X) (_X##_global_timer.time / 1000.0 / 1000.0 / 1000.0)
 
 #define TIMER_START(_X) auto _X##_start = std::chrono::steady_clock::now(), _X##_stop = _X##_start
-#define TIMER_STOP(_X) _X##_stop = std::chrono::steady_clock::now()
+#define TIMER_STOP(_X)                                                                             \
+    (_X##_stop = std::chrono::steady_clock::now(), TRACE_SPAN(#_X, _X##_start, _X##_stop))
 #define TIMER_NSEC(_X)                                                                             \
     std::chrono::duration_cast<std::chrono::nanoseconds>(_X##_stop - _X##_start).count()
 #define TIMER_USEC(_X)                                                                             \
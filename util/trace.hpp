@@ -0,0 +1,247 @@
+/*
+
+Copyright (c) 2015, Project OSRM contributors
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+Redistributions of source code must retain the above copyright notice, this list
+of conditions and the following disclaimer.
+Redistributions in binary form must reproduce the above copyright notice, this
+list of conditions and the following disclaimer in the documentation and/or
+other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*/
+
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// Spans of the preprocessing stages and of the request phases. Built with the ENABLE_TRACING
+// cmake option and run with OSRM_TRACE=<file>, a process writes its spans as a Chrome trace
+// to <file> when it exits. The trace opens in chrome://tracing and ui.perfetto.dev. Without
+// the option the macros compile to nothing.
+//
+//  TRACE_SCOPE("name")                   span until the end of the enclosing scope
+//  TRACE_SPAN("name", start, stop)       span between two steady_clock time points
+//
+// The names have to be string literals, only their address is recorded. TIMER_STOP of
+// timing_util.hpp records the span of its timer, too.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace osrm
+{
+namespace trace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Event
+{
+    const char *name;
+    std::int64_t start;
+    std::int64_t duration;
+};
+
+// Events of one thread in fixed size chunks. Only the owning thread appends, and a chunk is
+// published by its size, so that the trace can be written while threads are still running.
+class ThreadBuffer
+{
+    static constexpr std::size_t CHUNK_SIZE = 4096;
+
+    struct Chunk
+    {
+        Chunk() : size(0), next(nullptr) {}
+
+        std::array<Event, CHUNK_SIZE> events;
+        std::atomic<std::size_t> size;
+        std::atomic<Chunk *> next;
+    };
+
+  public:
+    explicit ThreadBuffer(const unsigned thread_id)
+        : thread_id(thread_id), head(new Chunk()), tail(head)
+    {
+    }
+
+    ThreadBuffer(const ThreadBuffer &) = delete;
+    ThreadBuffer &operator=(const ThreadBuffer &) = delete;
+
+    void Append(const Event &event)
+    {
+        auto size = tail->size.load(std::memory_order_relaxed);
+        if (CHUNK_SIZE == size)
+        {
+            Chunk *chunk = new Chunk();
+            tail->next.store(chunk, std::memory_order_release);
+            tail = chunk;
+            size = 0;
+        }
+        tail->events[size] = event;
+        tail->size.store(size + 1, std::memory_order_release);
+    }
+
+    template <typename Visitor> void ForEach(Visitor &&visitor) const
+    {
+        for (const Chunk *chunk = head; nullptr != chunk;
+             chunk = chunk->next.load(std::memory_order_acquire))
+        {
+            const auto size = chunk->size.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                visitor(chunk->events[i]);
+            }
+        }
+    }
+
+    const unsigned thread_id;
+
+  private:
+    Chunk *const head;
+    Chunk *tail;
+};
+
+class Tracer
+{
+  public:
+    static Tracer &get()
+    {
+        static Tracer instance;
+        return instance;
+    }
+
+    bool Enabled() const { return !output_path.empty(); }
+
+    void Record(const char *name, const Clock::time_point start, const Clock::time_point stop)
+    {
+        if (!Enabled())
+        {
+            return;
+        }
+        LocalBuffer().Append(
+            {name, Nanoseconds(start.time_since_epoch()), Nanoseconds(stop - start)});
+    }
+
+    // complete events in microseconds, one track per thread
+    void Write(std::ostream &output)
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (const ThreadBuffer *buffer : buffers)
+        {
+            buffer->ForEach([&](const Event &event)
+                            {
+                                output << (first ? "" : ",") << "\n{\"name\":\"" << event.name
+                                       << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                                       << buffer->thread_id << ",\"ts\":" << event.start / 1000
+                                       << "." << Fraction(event.start)
+                                       << ",\"dur\":" << event.duration / 1000 << "."
+                                       << Fraction(event.duration) << "}";
+                                first = false;
+                            });
+        }
+        output << "\n]}\n";
+    }
+
+  private:
+    Tracer()
+    {
+        const char *path = std::getenv("OSRM_TRACE");
+        if (nullptr != path)
+        {
+            output_path = path;
+        }
+    }
+
+    // the buffers are never freed, threads may record until the process is gone
+    ~Tracer()
+    {
+        if (Enabled())
+        {
+            std::ofstream output(output_path.c_str());
+            Write(output);
+        }
+    }
+
+    static std::int64_t Nanoseconds(const Clock::duration duration)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    }
+
+    // three digits of the nanoseconds below a microsecond
+    static std::string Fraction(const std::int64_t nanoseconds)
+    {
+        const auto remainder = static_cast<unsigned>(nanoseconds % 1000);
+        std::string digits = std::to_string(1000 + remainder);
+        return digits.substr(1);
+    }
+
+    ThreadBuffer &LocalBuffer()
+    {
+        static thread_local ThreadBuffer *buffer = nullptr;
+        if (nullptr == buffer)
+        {
+            std::lock_guard<std::mutex> lock(buffers_mutex);
+            buffers.push_back(new ThreadBuffer(static_cast<unsigned>(buffers.size() + 1)));
+            buffer = buffers.back();
+        }
+        return *buffer;
+    }
+
+    std::string output_path;
+    std::mutex buffers_mutex;
+    std::vector<ThreadBuffer *> buffers;
+};
+
+class Scope
+{
+  public:
+    explicit Scope(const char *name) : name(name), start(Clock::now()) {}
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    ~Scope() { Tracer::get().Record(name, start, Clock::now()); }
+
+  private:
+    const char *const name;
+    const Clock::time_point start;
+};
+}
+}
+
+#define OSRM_TRACE_CONCAT_IMPL(_A, _B) _A##_B
+#define OSRM_TRACE_CONCAT(_A, _B) OSRM_TRACE_CONCAT_IMPL(_A, _B)
+
+#ifdef OSRM_ENABLE_TRACING
+#define TRACE_SCOPE(_NAME) osrm::trace::Scope OSRM_TRACE_CONCAT(trace_scope_, __LINE__)(_NAME)
+#define TRACE_SPAN(_NAME, _START, _STOP) osrm::trace::Tracer::get().Record(_NAME, _START, _STOP)
+#else
+#define TRACE_SCOPE(_NAME)
+#define TRACE_SPAN(_NAME, _START, _STOP) static_cast<void>(0)
+#endif
+
+#endif // TRACE_HPP
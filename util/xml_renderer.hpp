@@ -29,9 +29,15 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define XML_RENDERER_HPP
 
 #include "cast.hpp"
+#include "string_util.hpp"
 
+#include <osrm/coordinate.hpp>
 #include <osrm/json_container.hpp>
 
+#include <iterator>
+#include <string>
+#include <vector>
+
 namespace osrm
 {
 namespace json
@@ -114,24 +120,55 @@ template <class JSONObject> inline void xml_render(std::vector<char> &out, const
     mapbox::util::apply_visitor(XMLToArrayRenderer(out), value);
 }
 
+namespace detail
+{
+constexpr const char GPX_HEADER[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?><gpx creator=\"OSRM Routing Engine\""
+    " version=\"1.1\" xmlns=\"http://www.topografix.com/GPX/1/1\" xmlns:xsi=\"http:"
+    "//www.w3.org/2001/XMLSchema-instance\" xsi:schemaLocation=\"http://www.topogr"
+    "afix.com/GPX/1/1 gpx.xsd\"><metadata><copyright author=\"Project OSRM\"><lice"
+    "nse>Data (c) OpenStreetMap contributors (ODbL)</license></copyright></metadat"
+    "a><rte>";
+constexpr const char GPX_FOOTER[] = "</rte></gpx>";
+}
+
 template <class JSONObject> inline void gpx_render(std::vector<char> &out, const JSONObject &object)
 {
-    // add header
+    out.insert(out.end(), std::begin(detail::GPX_HEADER), std::end(detail::GPX_HEADER) - 1);
+    xml_render(out, object);
+    out.insert(out.end(), std::begin(detail::GPX_FOOTER), std::end(detail::GPX_FOOTER) - 1);
+}
 
-    const std::string header{
-        "<?xml version=\"1.0\" encoding=\"UTF-8\"?><gpx creator=\"OSRM Routing Engine\""
-        " version=\"1.1\" xmlns=\"http://www.topografix.com/GPX/1/1\" xmlns:xsi=\"http:"
-        "//www.w3.org/2001/XMLSchema-instance\" xsi:schemaLocation=\"http://www.topogr"
-        "afix.com/GPX/1/1 gpx.xsd\"><metadata><copyright author=\"Project OSRM\"><lice"
-        "nse>Data (c) OpenStreetMap contributors (ODbL)</license></copyright></metadat"
-        "a><rte>"};
-    out.insert(out.end(), header.begin(), header.end());
+// Writes a GPX route point by point into a string, without a document tree in between. The
+// output matches gpx_render of an array of rtept elements with _lat and _lon attributes.
+class GPXRouteWriter
+{
+  public:
+    explicit GPXRouteWriter(std::string &_out, const std::size_t expected_number_of_points = 0)
+        : out(_out)
+    {
+        out.reserve(out.size() + sizeof(detail::GPX_HEADER) + sizeof(detail::GPX_FOOTER) +
+                    expected_number_of_points * MAX_ROUTE_POINT_LENGTH);
+        out.append(detail::GPX_HEADER);
+    }
 
-    xml_render(out, object);
+    void AddRoutePoint(const FixedPointCoordinate &coordinate)
+    {
+        char buffer[COORDINATE_STRING_LENGTH + 1];
+        out.append("<rtept lat=\"");
+        out.append(printCoordinate(buffer, coordinate.lat), buffer + COORDINATE_STRING_LENGTH);
+        out.append("\" lon=\"");
+        out.append(printCoordinate(buffer, coordinate.lon), buffer + COORDINATE_STRING_LENGTH);
+        out.append("\"/>");
+    }
 
-    const std::string footer{"</rte></gpx>"};
-    out.insert(out.end(), footer.begin(), footer.end());
-}
+    void Finish() { out.append(detail::GPX_FOOTER); }
+
+  private:
+    static constexpr std::size_t MAX_ROUTE_POINT_LENGTH = 24 + 2 * COORDINATE_STRING_LENGTH;
+
+    std::string &out;
+};
 } // namespace json
 } // namespace osrm
 #endif // XML_RENDERER_HPP